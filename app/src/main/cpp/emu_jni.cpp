@@ -3,22 +3,41 @@
 
 #include <csignal>
 #include <unistd.h>
+#include <android/native_window_jni.h>
 #include "skyline/loader/loader.h"
 #include "skyline/common.h"
 #include "skyline/os.h"
 #include "skyline/jvm.h"
 #include "skyline/input.h"
+#include "skyline/profiler.h"
+#include "skyline/perf_stats.h"
+#include "skyline/thread_priority.h"
+#include "skyline/headless.h"
+#include "skyline/boot_report.h"
+#include "skyline/footprint.h"
+#include "skyline/cache_registry.h"
+#include "skyline/save_state.h"
+#include "skyline/gpu/surface_gate.h"
 
 bool Halt;
-jobject Surface;
 uint FaultCount;
-skyline::GroupMutex JniMtx;
+skyline::SharedMutex JniMtx;
 skyline::u16 fps;
 skyline::u32 frametime;
+skyline::u32 frametimeDeviation;
+skyline::u16 speed;
 std::weak_ptr<skyline::input::Input> inputWeak;
+std::weak_ptr<skyline::Settings> settingsWeak;
+std::weak_ptr<skyline::CallProfiler> profilerWeak;
+std::weak_ptr<skyline::Logger> loggerWeak;
 
 void signalHandler(int signal) {
     syslog(LOG_ERR, "Halting program due to signal: %s", strsignal(signal));
+
+    // Any queued logs are written out as the process might not survive the signal, the writer thread isn't waited on as this could've interrupted it
+    if (auto logger{loggerWeak.lock()})
+        logger->Flush(false);
+
     if (FaultCount > 2)
         exit(SIGKILL);
     else
@@ -31,6 +50,11 @@ extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_executeApplication(
     FaultCount = 0;
     fps = 0;
     frametime = 0;
+    frametimeDeviation = 0;
+    speed = 0;
+    skyline::perf::Monitor.Reset();
+    skyline::priority::Hints.Reset();
+    skyline::footprint::Reset();
 
     std::signal(SIGTERM, signalHandler);
     std::signal(SIGSEGV, signalHandler);
@@ -39,56 +63,117 @@ extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_executeApplication(
     std::signal(SIGABRT, signalHandler);
     std::signal(SIGFPE, signalHandler);
 
-    setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), -8); // Set the priority of this process to the highest value
+    // This thread presents frames from the GPU, it's promoted above the guest threads and is part of the performance hint session
+    auto scheduling{skyline::priority::PromoteThread(skyline::priority::ThreadClass::Display)};
+    skyline::priority::Hints.AddThread();
 
     auto jvmManager = std::make_shared<skyline::JvmManager>(env, instance);
     auto settings = std::make_shared<skyline::Settings>(preferenceFd);
-
-    auto appFilesPath = env->GetStringUTFChars(appFilesPathJstring, nullptr);
-    auto logger = std::make_shared<skyline::Logger>(std::string(appFilesPath) + "skyline.log", static_cast<skyline::Logger::LogLevel>(std::stoi(settings->GetString("log_level"))));
+    settingsWeak = settings;
+
+    auto appFilesPathChars = env->GetStringUTFChars(appFilesPathJstring, nullptr);
+    std::string appFilesPath(appFilesPathChars);
+    env->ReleaseStringUTFChars(appFilesPathJstring, appFilesPathChars);
+    auto logger = std::make_shared<skyline::Logger>(appFilesPath + "skyline.log", static_cast<skyline::Logger::LogLevel>(settings->Get().logLevel));
+    loggerWeak = logger;
+    logger->Info("Emulation thread scheduling: {}", skyline::priority::GetSchedulingName(scheduling));
     //settings->List(logger); // (Uncomment when you want to print out all settings strings)
 
     auto start = std::chrono::steady_clock::now();
+    skyline::boot::Report.Start();
+    skyline::headless::Benchmark.Start();
 
+    std::shared_ptr<skyline::CallProfiler> profiler; // The profiler is retained past the OS so its statistics can be logged after emulation has ended
     try {
-        skyline::kernel::OS os(jvmManager, logger, settings, std::string(appFilesPath));
+        skyline::kernel::OS os(jvmManager, logger, settings, appFilesPath);
         inputWeak = os.state.input;
+        profiler = os.state.profiler;
+        profilerWeak = profiler;
         jvmManager->InitializeControllers();
-        env->ReleaseStringUTFChars(appFilesPathJstring, appFilesPath);
 
         auto romUri = env->GetStringUTFChars(romUriJstring, nullptr);
         logger->Info("Launching ROM {}", romUri);
         env->ReleaseStringUTFChars(romUriJstring, romUri);
 
+        // The input script is declared after the OS so it's stopped prior to the input it pushes events to being destroyed
+        std::unique_ptr<skyline::headless::ScriptedInput> scriptedInput;
+        if (!skyline::headless::HeadlessOptions.inputScript.empty())
+            scriptedInput = std::make_unique<skyline::headless::ScriptedInput>(os.state.input, skyline::headless::HeadlessOptions.inputScript);
+
         os.Execute(romFd, static_cast<skyline::loader::RomFormat>(romType));
     } catch (std::exception &e) {
         logger->Error(e.what());
+        logger->Flush();
     } catch (...) {
         logger->Error("An unknown exception has occurred");
+        logger->Flush();
     }
 
     inputWeak.reset();
+    settingsWeak.reset();
+    profilerWeak.reset();
+    loggerWeak.reset();
+    skyline::headless::Benchmark.Emit(*logger, profiler.get()); // This must be done prior to the headless options being reset as they hold the report and baseline paths
+    skyline::headless::HeadlessOptions = {};
 
     logger->Info("Emulation has ended");
+    skyline::boot::Report.Emit(*logger, appFilesPath); // This only emits a report if the title never queued a frame
+    if (profiler)
+        profiler->Log(*logger);
 
     auto end = std::chrono::steady_clock::now();
     logger->Info("Done in: {} ms", (std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()));
 }
 
+extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_setHeadless(JNIEnv *env, jobject, jint runDuration, jint frameDumpInterval, jstring inputScriptJstring, jstring reportPathJstring, jstring baselinePathJstring, jint regressionThreshold) {
+    auto &options = skyline::headless::HeadlessOptions;
+    options.enabled = true;
+    options.runDuration = static_cast<skyline::u32>(std::max(runDuration, 0));
+    options.frameDumpInterval = static_cast<skyline::u32>(std::max(frameDumpInterval, 0));
+    if (inputScriptJstring) {
+        auto inputScript = env->GetStringUTFChars(inputScriptJstring, nullptr);
+        options.inputScript = inputScript;
+        env->ReleaseStringUTFChars(inputScriptJstring, inputScript);
+    } else {
+        options.inputScript.clear();
+    }
+
+    auto getPath = [env](jstring pathJstring) {
+        if (!pathJstring)
+            return std::string{};
+        auto path = env->GetStringUTFChars(pathJstring, nullptr);
+        std::string result(path);
+        env->ReleaseStringUTFChars(pathJstring, path);
+        return result;
+    };
+    options.reportPath = getPath(reportPathJstring);
+    options.baselinePath = getPath(baselinePathJstring);
+    options.regressionThreshold = static_cast<skyline::u32>(std::max(regressionThreshold, 0));
+}
+
 extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_setHalt(JNIEnv *, jobject, jboolean halt) {
-    JniMtx.lock(skyline::GroupMutex::Group::Group2);
+    JniMtx.lock();
     Halt = halt;
     JniMtx.unlock();
+    skyline::gpu::HostSurface.Notify(); // Any threads waiting for a Surface need to observe the halt
+}
+
+extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_updateSettings(JNIEnv *, jobject, jint preferenceFd) {
+    auto settings = settingsWeak.lock();
+    if (!settings)
+        return;
+
+    try {
+        settings->Update(preferenceFd);
+    } catch (const std::exception &e) {
+        syslog(LOG_ERR, "Cannot update settings: %s", e.what());
+    }
 }
 
 extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_setSurface(JNIEnv *env, jobject, jobject surface) {
-    JniMtx.lock(skyline::GroupMutex::Group::Group2);
-    if (!env->IsSameObject(Surface, nullptr))
-        env->DeleteGlobalRef(Surface);
-    if (!env->IsSameObject(surface, nullptr))
-        Surface = env->NewGlobalRef(surface);
-    else
-        Surface = surface;
+    // The update is done with emulation locked out so any frame being presented to the prior Surface is done when this returns
+    JniMtx.lock();
+    skyline::gpu::HostSurface.Update(env->IsSameObject(surface, nullptr) ? nullptr : ANativeWindow_fromSurface(env, surface));
     JniMtx.unlock();
 }
 
@@ -96,10 +181,43 @@ extern "C" JNIEXPORT jint Java_emu_skyline_EmulationActivity_getFps(JNIEnv *, jo
     return fps;
 }
 
+extern "C" JNIEXPORT jint Java_emu_skyline_EmulationActivity_getSpeed(JNIEnv *, jobject) {
+    return speed;
+}
+
 extern "C" JNIEXPORT jfloat Java_emu_skyline_EmulationActivity_getFrametime(JNIEnv *, jobject) {
     return static_cast<float>(frametime) / 100;
 }
 
+extern "C" JNIEXPORT jfloat Java_emu_skyline_EmulationActivity_getFrametimeDeviation(JNIEnv *, jobject) {
+    return static_cast<float>(frametimeDeviation) / 100;
+}
+
+extern "C" JNIEXPORT jobject Java_emu_skyline_EmulationActivity_getPerformanceStatistics(JNIEnv *env, jobject) {
+    return env->NewDirectByteBuffer(&skyline::perf::Monitor.block, sizeof(skyline::perf::StatisticsBlock));
+}
+
+extern "C" JNIEXPORT jstring Java_emu_skyline_EmulationActivity_getCallStatistics(JNIEnv *env, jobject) {
+    auto profiler = profilerWeak.lock();
+    if (!profiler)
+        return env->NewStringUTF("");
+    return env->NewStringUTF(skyline::CallProfiler::Format(profiler->GetSnapshot()).c_str());
+}
+
+extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_trimMemory(JNIEnv *, jobject, jint level) {
+    auto logger = loggerWeak.lock();
+    if (logger)
+        logger->Warn("Trimming memory at level {}, host memory usage: {}", level, skyline::footprint::Format());
+
+    auto freed = skyline::cache::Registry.Trim(level);
+    if (logger)
+        logger->Info("Evicted {} KiB from caches, host memory usage: {}", freed / 1024, skyline::footprint::Format());
+}
+
+extern "C" JNIEXPORT void Java_emu_skyline_EmulationActivity_saveState(JNIEnv *, jobject) {
+    skyline::savestate::Requested = true;
+}
+
 extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_setController(JNIEnv *, jobject, jint index, jint type, jint partnerIndex) {
     auto input = inputWeak.lock();
     std::lock_guard guard(input->npad.mutex);
@@ -110,40 +228,13 @@ extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_updateContr
     inputWeak.lock()->npad.Update();
 }
 
-extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_setButtonState(JNIEnv *, jobject, jint index, jlong mask, jboolean pressed) {
-    try {
-        auto input = inputWeak.lock();
-        auto device = input->npad.controllers[index].device;
-        if (device)
-            device->SetButtonState(skyline::input::NpadButton{.raw = static_cast<skyline::u64>(mask)}, pressed);
-    } catch (const std::bad_weak_ptr &) {
-        // We don't mind if we miss button updates while input hasn't been initialized
-    }
-}
-
-extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_setAxisValue(JNIEnv *, jobject, jint index, jint axis, jint value) {
-    try {
-        auto input = inputWeak.lock();
-        auto device = input->npad.controllers[index].device;
-        if (device)
-            device->SetAxisValue(static_cast<skyline::input::NpadAxisId>(axis), value);
-    } catch (const std::bad_weak_ptr &) {
-        // We don't mind if we miss axis updates while input hasn't been initialized
-    }
-}
-
-extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_setTouchState(JNIEnv *env, jobject, jintArray pointsJni) {
-    try {
-        using Point = skyline::input::TouchScreenPoint;
-
-        auto input = inputWeak.lock();
-        jboolean isCopy{false};
+extern "C" JNIEXPORT void JNICALL Java_emu_skyline_EmulationActivity_pushInputEvents(JNIEnv *env, jobject, jobject eventsJni, jint count) {
+    auto input = inputWeak.lock();
+    if (!input)
+        return; // We don't mind if we miss input events while input hasn't been initialized
 
-        std::span<Point> points(reinterpret_cast<Point *>(env->GetIntArrayElements(pointsJni, &isCopy)), env->GetArrayLength(pointsJni) / (sizeof(Point) / sizeof(jint)));
-        input->touch.SetState(points);
+    using Event = skyline::input::InputEvent;
+    std::span<Event> events(reinterpret_cast<Event *>(env->GetDirectBufferAddress(eventsJni)), std::min(static_cast<size_t>(count), static_cast<size_t>(env->GetDirectBufferCapacity(eventsJni)) / sizeof(Event)));
 
-        env->ReleaseIntArrayElements(pointsJni, reinterpret_cast<jint *>(points.data()), JNI_ABORT);
-    } catch (const std::bad_weak_ptr &) {
-        // We don't mind if we miss axis updates while input hasn't been initialized
-    }
+    input->PushEvents(events);
 }
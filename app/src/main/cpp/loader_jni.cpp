@@ -4,59 +4,269 @@
 #include "skyline/crypto/key_store.h"
 #include "skyline/vfs/nca.h"
 #include "skyline/vfs/os_backing.h"
+#include "skyline/vfs/metadata_cache.h"
 #include "skyline/loader/nro.h"
 #include "skyline/loader/nso.h"
 #include "skyline/loader/nca.h"
 #include "skyline/loader/nsp.h"
+#include "skyline/loader/xci.h"
 #include "skyline/jvm.h"
 
-extern "C" JNIEXPORT jint JNICALL Java_emu_skyline_loader_RomFile_populate(JNIEnv *env, jobject thiz, jint jformat, jint fd, jstring appFilesPathJstring) {
-    skyline::loader::RomFormat format{static_cast<skyline::loader::RomFormat>(jformat)};
+namespace {
+    using namespace skyline;
 
-    auto appFilesPath{env->GetStringUTFChars(appFilesPathJstring, nullptr)};
-    auto keyStore{std::make_shared<skyline::crypto::KeyStore>(appFilesPath)};
-    env->ReleaseStringUTFChars(appFilesPathJstring, appFilesPath);
+    /**
+     * @brief The metadata of a ROM that is displayed in the game library
+     */
+    struct RomMetadata {
+        loader::LoaderResult result{loader::LoaderResult::Success};
+        bool hasNacp{}; //!< If the ROM has an NACP, the name, author, version and icon are only valid if this is true
+        u64 titleId{}; //!< The title ID of the ROM from its NACP, this is 0 for most homebrew
+        std::string applicationName;
+        std::string applicationAuthor;
+        std::string applicationVersion;
+        std::vector<u8> icon;
 
-    std::unique_ptr<skyline::loader::Loader> loader;
-    try {
-        auto backing{std::make_shared<skyline::vfs::OsBacking>(fd)};
+        /**
+         * @return The key of the ROM in the thumbnail store of the frontend, this is made up of the title ID and the version so a thumbnail is regenerated for updated ROMs
+         * @note Homebrew which doesn't have a title ID is keyed by a hash of its icon instead
+         */
+        std::string ThumbnailKey() const {
+            auto id{titleId ? titleId : util::Hash(std::string_view(reinterpret_cast<const char *>(icon.data()), icon.size()))};
+            std::string version{applicationVersion};
+            for (auto &character : version)
+                if (!std::isalnum(static_cast<unsigned char>(character)) && character != '.')
+                    character = '_'; // The key is used as a file name so anything that could be a path separator is replaced
+            return fmt::format("{:016X}_{}", id, version);
+        }
+    };
 
-        switch (format) {
-            case skyline::loader::RomFormat::NRO:
-                loader = std::make_unique<skyline::loader::NroLoader>(backing);
-                break;
-            case skyline::loader::RomFormat::NSO:
-                loader = std::make_unique<skyline::loader::NsoLoader>(backing);
-                break;
-            case skyline::loader::RomFormat::NCA:
-                loader = std::make_unique<skyline::loader::NcaLoader>(backing, keyStore);
-                break;
-            case skyline::loader::RomFormat::NSP:
-                loader = std::make_unique<skyline::loader::NspLoader>(backing, keyStore);
-                break;
-            default:
-                return static_cast<jint>(skyline::loader::LoaderResult::ParsingError);
+    constexpr auto MetadataCacheKey{"library2"}; //!< The key of the library metadata in the metadata cache of a ROM, this is changed whenever the format of the metadata is
+
+    /**
+     * @brief Serializes the metadata of a ROM for the metadata cache, it's made up of a u8 denoting if there's an NACP, the u64 title ID, the u32 sizes of the name, author and version, the name, the author, the version and the icon
+     */
+    std::vector<u8> SerializeMetadata(const RomMetadata &metadata) {
+        std::vector<u8> data{static_cast<u8>(metadata.hasNacp)};
+        data.insert(data.end(), reinterpret_cast<const u8 *>(&metadata.titleId), reinterpret_cast<const u8 *>(&metadata.titleId) + sizeof(metadata.titleId));
+        u32 sizes[3]{static_cast<u32>(metadata.applicationName.size()), static_cast<u32>(metadata.applicationAuthor.size()), static_cast<u32>(metadata.applicationVersion.size())};
+        data.insert(data.end(), reinterpret_cast<u8 *>(sizes), reinterpret_cast<u8 *>(sizes) + sizeof(sizes));
+        data.insert(data.end(), metadata.applicationName.begin(), metadata.applicationName.end());
+        data.insert(data.end(), metadata.applicationAuthor.begin(), metadata.applicationAuthor.end());
+        data.insert(data.end(), metadata.applicationVersion.begin(), metadata.applicationVersion.end());
+        data.insert(data.end(), metadata.icon.begin(), metadata.icon.end());
+        return data;
+    }
+
+    std::optional<RomMetadata> DeserializeMetadata(const std::vector<u8> &data) {
+        constexpr size_t HeaderSize{sizeof(u8) + sizeof(u64) + sizeof(u32[3])};
+        if (data.size() < HeaderSize)
+            return std::nullopt;
+
+        RomMetadata metadata{.hasNacp = data.front() != 0};
+        std::memcpy(&metadata.titleId, data.data() + sizeof(u8), sizeof(u64));
+        u32 sizes[3];
+        std::memcpy(sizes, data.data() + sizeof(u8) + sizeof(u64), sizeof(sizes));
+
+        auto name{data.begin() + HeaderSize};
+        if (static_cast<size_t>(data.end() - name) < static_cast<size_t>(sizes[0]) + sizes[1] + sizes[2])
+            return std::nullopt;
+
+        auto author{name + sizes[0]}, version{author + sizes[1]}, icon{version + sizes[2]};
+        metadata.applicationName.assign(name, author);
+        metadata.applicationAuthor.assign(author, version);
+        metadata.applicationVersion.assign(version, icon);
+        metadata.icon.assign(icon, data.end());
+        return metadata;
+    }
+
+    /**
+     * @brief Reads the metadata of a ROM, this is looked up in the metadata cache of the ROM first and only ROMs that have been modified since they were last read are parsed
+     * @note NSPs and XCIs are parsed without constructing a loader so only their control NCA gets decrypted, the other formats are cheap enough to load entirely
+     */
+    RomMetadata ReadMetadata(loader::RomFormat format, int fd, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::string &appFilesPath) {
+        // The metadata cache is purely an optimization, ROMs are still parsed without it if it can't be used
+        std::shared_ptr<vfs::MetadataCache> cache;
+        try {
+            cache = std::make_shared<vfs::MetadataCache>(appFilesPath + "metadata_cache/", fd);
+            if (auto cached{cache->Get(MetadataCacheKey)}) {
+                if (auto metadata{DeserializeMetadata(*cached)})
+                    return *metadata;
+            }
+        } catch (const std::exception &e) {
+            cache = nullptr;
         }
-    } catch (const skyline::loader::loader_exception &e) {
-        return static_cast<jint>(e.error);
-    } catch (const std::exception &e) {
-        return static_cast<jint>(skyline::loader::LoaderResult::ParsingError);
+
+        RomMetadata metadata;
+        try {
+            auto backing{std::make_shared<vfs::OsBacking>(fd)};
+
+            std::shared_ptr<vfs::NACP> nacp;
+            switch (format) {
+                case loader::RomFormat::NRO: {
+                    loader::NroLoader nro(backing);
+                    nacp = nro.nacp;
+                    if (nacp)
+                        metadata.icon = nro.GetIcon();
+                    break;
+                }
+                case loader::RomFormat::NSO: {
+                    loader::NsoLoader nso(backing);
+                    break;
+                }
+                case loader::RomFormat::NCA: {
+                    loader::NcaLoader nca(backing, keyStore, cache);
+                    break;
+                }
+                case loader::RomFormat::NSP:
+                    std::tie(nacp, metadata.icon) = loader::NspLoader::ReadMetadata(backing, keyStore, cache);
+                    break;
+                case loader::RomFormat::XCI:
+                    std::tie(nacp, metadata.icon) = loader::XciLoader::ReadMetadata(backing, keyStore, cache);
+                    break;
+                default:
+                    return RomMetadata{.result = loader::LoaderResult::ParsingError};
+            }
+
+            if (nacp) {
+                metadata.hasNacp = true;
+                metadata.applicationName = nacp->applicationName;
+                metadata.applicationAuthor = nacp->applicationPublisher;
+                metadata.applicationVersion = nacp->displayVersion;
+                metadata.titleId = nacp->nacpContents.saveDataOwnerId;
+            }
+        } catch (const loader::loader_exception &e) {
+            return RomMetadata{.result = e.error};
+        } catch (const std::exception &e) {
+            return RomMetadata{.result = loader::LoaderResult::ParsingError};
+        }
+
+        if (cache) {
+            try {
+                cache->Put(MetadataCacheKey, SerializeMetadata(metadata));
+                cache->Save();
+            } catch (const std::exception &e) {}
+        }
+
+        return metadata;
+    }
+
+    std::string GetString(JNIEnv *env, jstring jstring) {
+        auto chars{env->GetStringUTFChars(jstring, nullptr)};
+        std::string string(chars);
+        env->ReleaseStringUTFChars(jstring, chars);
+        return string;
     }
 
+    jbyteArray NewByteArray(JNIEnv *env, const std::vector<u8> &data) {
+        jbyteArray array{env->NewByteArray(data.size())};
+        env->SetByteArrayRegion(array, 0, data.size(), reinterpret_cast<const jbyte *>(data.data()));
+        return array;
+    }
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_emu_skyline_loader_RomFile_populate(JNIEnv *env, jobject thiz, jint jformat, jint fd, jstring appFilesPathJstring) {
+    auto appFilesPath{GetString(env, appFilesPathJstring)};
+    auto keyStore{skyline::crypto::KeyStore::Get(appFilesPath)};
+
+    auto metadata{ReadMetadata(static_cast<skyline::loader::RomFormat>(jformat), fd, keyStore, appFilesPath)};
+    if (metadata.result != skyline::loader::LoaderResult::Success)
+        return static_cast<jint>(metadata.result);
+
     jclass clazz{env->GetObjectClass(thiz)};
     jfieldID applicationNameField{env->GetFieldID(clazz, "applicationName", "Ljava/lang/String;")};
     jfieldID applicationAuthorField{env->GetFieldID(clazz, "applicationAuthor", "Ljava/lang/String;")};
     jfieldID rawIconField{env->GetFieldID(clazz, "rawIcon", "[B")};
+    jfieldID thumbnailKeyField{env->GetFieldID(clazz, "thumbnailKey", "Ljava/lang/String;")};
 
-    if (loader->nacp) {
-        env->SetObjectField(thiz, applicationNameField, env->NewStringUTF(loader->nacp->applicationName.c_str()));
-        env->SetObjectField(thiz, applicationAuthorField, env->NewStringUTF(loader->nacp->applicationPublisher.c_str()));
-
-        auto icon{loader->GetIcon()};
-        jbyteArray iconByteArray{env->NewByteArray(icon.size())};
-        env->SetByteArrayRegion(iconByteArray, 0, icon.size(), reinterpret_cast<const jbyte *>(icon.data()));
-        env->SetObjectField(thiz, rawIconField, iconByteArray);
+    if (metadata.hasNacp) {
+        env->SetObjectField(thiz, applicationNameField, env->NewStringUTF(metadata.applicationName.c_str()));
+        env->SetObjectField(thiz, applicationAuthorField, env->NewStringUTF(metadata.applicationAuthor.c_str()));
+        env->SetObjectField(thiz, rawIconField, NewByteArray(env, metadata.icon));
+        env->SetObjectField(thiz, thumbnailKeyField, env->NewStringUTF(metadata.ThumbnailKey().c_str()));
     }
 
     return static_cast<jint>(skyline::loader::LoaderResult::Success);
 }
+
+extern "C" JNIEXPORT jintArray JNICALL Java_emu_skyline_loader_RomFile_populateBatch(JNIEnv *env, jclass clazz, jint jformat, jintArray fdsJarray, jstring appFilesPathJstring, jobjectArray namesJarray, jobjectArray authorsJarray, jobjectArray iconsJarray, jobjectArray thumbnailKeysJarray) {
+    auto appFilesPath{GetString(env, appFilesPathJstring)};
+    auto keyStore{skyline::crypto::KeyStore::Get(appFilesPath)}; // The key store is only read from after construction so it's shared across threads
+
+    std::vector<jint> fds(env->GetArrayLength(fdsJarray));
+    env->GetIntArrayRegion(fdsJarray, 0, fds.size(), fds.data());
+
+    // ROMs are parsed on a pool of threads that each take the next unparsed ROM, they don't touch the JNI environment as it's only valid on this thread
+    std::vector<RomMetadata> metadata(fds.size());
+    std::atomic<size_t> next{};
+    auto worker{[&]() {
+        for (size_t index; (index = next.fetch_add(1, std::memory_order_relaxed)) < fds.size();)
+            metadata[index] = ReadMetadata(static_cast<skyline::loader::RomFormat>(jformat), fds[index], keyStore, appFilesPath);
+    }};
+
+    std::vector<std::thread> threads;
+    auto threadCount{std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), fds.size())};
+    for (size_t thread{1}; thread < threadCount; thread++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &thread : threads)
+        thread.join();
+
+    std::vector<jint> results(fds.size());
+    for (size_t index{}; index < metadata.size(); index++) {
+        auto &rom{metadata[index]};
+        results[index] = static_cast<jint>(rom.result);
+        if (rom.result != skyline::loader::LoaderResult::Success || !rom.hasNacp)
+            continue;
+
+        auto name{env->NewStringUTF(rom.applicationName.c_str())};
+        env->SetObjectArrayElement(namesJarray, index, name);
+        env->DeleteLocalRef(name);
+
+        auto author{env->NewStringUTF(rom.applicationAuthor.c_str())};
+        env->SetObjectArrayElement(authorsJarray, index, author);
+        env->DeleteLocalRef(author);
+
+        auto icon{NewByteArray(env, rom.icon)};
+        env->SetObjectArrayElement(iconsJarray, index, icon);
+        env->DeleteLocalRef(icon);
+
+        auto thumbnailKey{env->NewStringUTF(rom.ThumbnailKey().c_str())};
+        env->SetObjectArrayElement(thumbnailKeysJarray, index, thumbnailKey);
+        env->DeleteLocalRef(thumbnailKey);
+    }
+
+    jintArray resultsJarray{env->NewIntArray(results.size())};
+    env->SetIntArrayRegion(resultsJarray, 0, results.size(), results.data());
+    return resultsJarray;
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_emu_skyline_loader_RomFile_verify(JNIEnv *env, jclass clazz, jint jformat, jint fd, jstring appFilesPathJstring) {
+    using namespace skyline;
+    auto keyStore{crypto::KeyStore::Get(GetString(env, appFilesPathJstring))};
+
+    try {
+        auto backing{std::make_shared<vfs::OsBacking>(fd)};
+
+        bool intact;
+        switch (static_cast<loader::RomFormat>(jformat)) {
+            case loader::RomFormat::NCA:
+                intact = vfs::NCA(backing, keyStore).Verify();
+                break;
+            case loader::RomFormat::NSP:
+                intact = loader::NspLoader::Verify(backing, keyStore);
+                break;
+            case loader::RomFormat::XCI:
+                intact = loader::XciLoader::Verify(backing, keyStore);
+                break;
+            default:
+                return static_cast<jint>(loader::LoaderResult::ParsingError); // Only NCAs hold hashes of their contents
+        }
+
+        return static_cast<jint>(intact ? loader::LoaderResult::Success : loader::LoaderResult::IntegrityError);
+    } catch (const loader::loader_exception &e) {
+        return static_cast<jint>(e.error);
+    } catch (const std::exception &e) {
+        return static_cast<jint>(loader::LoaderResult::ParsingError);
+    }
+}
@@ -1,26 +1,150 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include "perf_stats.h"
 #include "audio.h"
 
 namespace skyline::audio {
-    Audio::Audio(const DeviceState &state) : oboe::AudioStreamCallback() {
+    /**
+     * @return The current CLOCK_MONOTONIC time in nanoseconds, this is the clock that stream timestamps are in
+     */
+    static i64 GetMonotonicTime() {
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return (static_cast<i64>(time.tv_sec) * static_cast<i64>(constant::NsInSecond)) + time.tv_nsec;
+    }
+
+    Audio::Audio(const DeviceState &state) : oboe::AudioStreamCallback(), sincResampling(state.settings->Get().sincResampling) {
+        // The sample rate is left unspecified so the stream is opened at the native rate of the device, this avoids the device resampling the mix again after tracks have been converted to it
         builder.setChannelCount(constant::ChannelCount);
-        builder.setSampleRate(constant::SampleRate);
         builder.setFormat(constant::PcmFormat);
-        builder.setFramesPerCallback(constant::MixBufferSize);
         builder.setUsage(oboe::Usage::Game);
+        builder.setPerformanceMode(oboe::PerformanceMode::LowLatency);
+        builder.setSharingMode(oboe::SharingMode::Exclusive); // This falls back to a shared stream on devices that don't support exclusive streams
         builder.setCallback(this);
 
+        OpenStream();
+    }
+
+    void Audio::OpenStream() {
         builder.openManagedStream(outputStream);
+        if (auto rate{outputStream->getSampleRate()}; rate > 0)
+            streamSampleRate.store(static_cast<u32>(rate), std::memory_order_relaxed);
+
+        lastXRunCount = 0;
+        stableFrames = 0;
+        latencyFrames = 0;
+
+        // The position of a new stream starts at 0, it's rebased so the audio clock and the checkpoints of tracks stay continuous
+        streamFrameBase = writtenFrames;
+        lastTimestamp.reset();
+        timestampFrames = TimestampUpdateFrames;
+        if (auto burst{outputStream->getFramesPerBurst()}; burst > 0)
+            outputStream->setBufferSizeInFrames(burst * 2);
+
         outputStream->requestStart();
     }
 
+    void Audio::TuneBufferSize(oboe::AudioStream *audioStream, int32_t numFrames) {
+        auto xRunCount{audioStream->getXRunCount()};
+        auto burst{audioStream->getFramesPerBurst()};
+        if (!xRunCount || burst <= 0)
+            return;
+
+        auto bufferSize{audioStream->getBufferSizeInFrames()};
+        if (xRunCount.value() > lastXRunCount) {
+            if (bufferSize + burst <= audioStream->getBufferCapacityInFrames())
+                audioStream->setBufferSizeInFrames(bufferSize + burst);
+            stableFrames = 0;
+        } else if ((stableFrames += static_cast<size_t>(numFrames)) >= StableFramesToShrink) {
+            if (bufferSize > burst * 2)
+                audioStream->setBufferSizeInFrames(bufferSize - burst);
+            stableFrames = 0;
+        }
+        lastXRunCount = xRunCount.value();
+        perf::Monitor.SetXrunCount(static_cast<u32>(lastXRunCount));
+    }
+
+    void Audio::UpdateClock(oboe::AudioStream *audioStream, u64 streamEnd, int32_t numFrames) {
+        auto now{GetMonotonicTime()};
+
+        if ((timestampFrames += static_cast<size_t>(numFrames)) >= TimestampUpdateFrames) {
+            timestampFrames = 0;
+            auto timestamp{audioStream->getTimestamp(CLOCK_MONOTONIC)};
+            if (timestamp) {
+                lastTimestamp = timestamp.value();
+                lastTimestamp->position += static_cast<i64>(streamFrameBase);
+            } else {
+                lastTimestamp.reset();
+            }
+        }
+
+        u64 presented{streamEnd};
+        if (lastTimestamp) {
+            auto elapsed{std::max<i64>(now - lastTimestamp->timestamp, 0)};
+            auto position{lastTimestamp->position + ((elapsed * audioStream->getSampleRate()) / static_cast<i64>(constant::NsInSecond))};
+            presented = std::clamp(static_cast<u64>(std::max<i64>(position, 0)), presentedFrames, streamEnd);
+        }
+        presentedFrames = presented;
+
+        clockSequence.fetch_add(1, std::memory_order_acq_rel);
+        clockFrames.store(presented, std::memory_order_relaxed);
+        clockLimit.store(streamEnd, std::memory_order_relaxed);
+        clockTime.store(now, std::memory_order_relaxed);
+        clockSequence.fetch_add(1, std::memory_order_release);
+    }
+
+    u64 Audio::GetPresentedFrames() {
+        u64 frames, limit;
+        i64 time;
+        u32 sequence;
+        do {
+            sequence = clockSequence.load(std::memory_order_acquire);
+            frames = clockFrames.load(std::memory_order_relaxed);
+            limit = clockLimit.load(std::memory_order_relaxed);
+            time = clockTime.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((sequence & 1) || sequence != clockSequence.load(std::memory_order_relaxed));
+
+        // The clock is extrapolated from the time it was published at, it can't run ahead of the frames that have been written
+        if (time) {
+            auto elapsed{std::max<i64>(GetMonotonicTime() - time, 0)};
+            frames = std::min(frames + static_cast<u64>((elapsed * streamSampleRate.load(std::memory_order_relaxed)) / static_cast<i64>(constant::NsInSecond)), limit);
+        }
+
+        auto last{clockLast.load(std::memory_order_relaxed)};
+        while (frames > last && !clockLast.compare_exchange_weak(last, frames, std::memory_order_relaxed));
+        return std::max(frames, last);
+    }
+
+    void Audio::PublishTracks(std::unique_ptr<TrackList> tracks) {
+        publishedTracks.store(tracks.get());
+
+        // Any callback which starts after the list was published uses the new list, so the previous list can be freed after all callbacks that were running at that point have returned
+        while (activeCallbacks.load())
+            std::this_thread::yield();
+
+        audioTracks = std::move(tracks);
+    }
+
+    void Audio::Pause() {
+        // A callback increments activeCallbacks prior to checking the flag, so any callback after this returns sees it
+        paused = true;
+        while (activeCallbacks.load())
+            std::this_thread::yield();
+    }
+
+    void Audio::Resume() {
+        paused = false;
+    }
+
     std::shared_ptr<AudioTrack> Audio::OpenTrack(u8 channelCount, u32 sampleRate, const std::function<void()> &releaseCallback) {
         std::lock_guard trackGuard(trackLock);
 
-        auto track{std::make_shared<AudioTrack>(channelCount, sampleRate, releaseCallback)};
-        audioTracks.push_back(track);
+        auto track{std::make_shared<AudioTrack>(channelCount, sampleRate, releaseCallback, sincResampling)};
+        auto tracks{std::make_unique<TrackList>(*audioTracks)};
+        tracks->push_back(track);
+        PublishTracks(std::move(tracks));
 
         return track;
     }
@@ -28,45 +152,56 @@ namespace skyline::audio {
     void Audio::CloseTrack(std::shared_ptr<AudioTrack> &track) {
         std::lock_guard trackGuard(trackLock);
 
-        audioTracks.erase(std::remove(audioTracks.begin(), audioTracks.end(), track), audioTracks.end());
+        auto tracks{std::make_unique<TrackList>(*audioTracks)};
+        tracks->erase(std::remove(tracks->begin(), tracks->end(), track), tracks->end());
+        PublishTracks(std::move(tracks));
+
         track.reset();
     }
 
     oboe::DataCallbackResult Audio::onAudioReady(oboe::AudioStream *audioStream, void *audioData, int32_t numFrames) {
+        TRACE_SECTION("Audio::onAudioReady");
+        auto callbackStart{util::GetTimeNs()};
         auto destBuffer{static_cast<i16 *>(audioData)};
-        auto streamSamples{static_cast<size_t>(numFrames) * audioStream->getChannelCount()};
+        auto streamChannels{static_cast<u8>(audioStream->getChannelCount())};
+        auto streamRate{static_cast<u32>(audioStream->getSampleRate())};
+        auto streamSamples{static_cast<size_t>(numFrames) * streamChannels};
         size_t writtenSamples{};
 
-        {
-            std::lock_guard trackGuard(trackLock);
-
-            for (auto &track : audioTracks) {
-                if (track->playbackState == AudioOutState::Stopped)
-                    continue;
-
-                std::lock_guard bufferGuard(track->bufferLock);
-
-                auto trackSamples = track->samples.Read(destBuffer, streamSamples, [](i16 *source, i16 *destination) {
-                    *destination = Saturate<i16, i32>(static_cast<u32>(*destination) + static_cast<u32>(*source));
-                }, writtenSamples);
+        auto streamEnd{writtenFrames + static_cast<u64>(numFrames)};
+        UpdateClock(audioStream, streamEnd, numFrames);
+        writtenFrames = streamEnd;
 
-                writtenSamples = std::max(trackSamples, writtenSamples);
+        // This runs on a real-time thread so it doesn't take any locks, the track list and the samples of every track are read without locking
+        activeCallbacks.fetch_add(1);
+        if (!paused.load()) {
+            for (auto &track : *publishedTracks.load()) {
+                // Samples of stopped tracks that are still in flight are presented all the same
+                if (track->playbackState != AudioOutState::Stopped)
+                    writtenSamples = std::max(track->Read(destBuffer, streamSamples, writtenSamples, streamRate, streamChannels), writtenSamples);
 
-                track->sampleCounter += trackSamples;
-                track->CheckReleasedBuffers();
+                track->UpdatePresentation(streamEnd, presentedFrames);
             }
         }
+        activeCallbacks.fetch_sub(1);
 
         if (streamSamples > writtenSamples)
             memset(destBuffer + writtenSamples, 0, (streamSamples - writtenSamples) * sizeof(i16));
 
+        TuneBufferSize(audioStream, numFrames);
+
+        if ((latencyFrames += static_cast<size_t>(numFrames)) >= LatencyUpdateFrames) {
+            auto latency{audioStream->calculateLatencyMillis()};
+            outputLatency.store(latency ? static_cast<i64>(latency.value() * 1000) : 0, std::memory_order_relaxed);
+            latencyFrames = 0;
+        }
+
+        perf::Monitor.AddAudioCallback(util::GetTimeNs() - callbackStart, (static_cast<u64>(numFrames) * constant::NsInSecond) / streamRate);
         return oboe::DataCallbackResult::Continue;
     }
 
     void Audio::onErrorAfterClose(oboe::AudioStream *audioStream, oboe::Result error) {
-        if (error == oboe::Result::ErrorDisconnected) {
-            builder.openManagedStream(outputStream);
-            outputStream->requestStart();
-        }
+        if (error == oboe::Result::ErrorDisconnected)
+            OpenStream();
     }
 }
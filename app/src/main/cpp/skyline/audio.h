@@ -4,6 +4,7 @@
 #pragma once
 
 #include <queue>
+#include <chrono>
 #include <oboe/Oboe.h>
 
 #include <kernel/types/KEvent.h>
@@ -16,18 +17,76 @@ namespace skyline::audio {
      */
     class Audio : public oboe::AudioStreamCallback {
       private:
+        using TrackList = std::vector<std::shared_ptr<AudioTrack>>;
+
+        // The track list is declared prior to the stream so it's destroyed after the stream, which stops the callback
+        std::unique_ptr<TrackList> audioTracks{std::make_unique<TrackList>()}; //!< A vector of shared_ptr to every open audio track, this is replaced rather than modified as the callback reads it without locking
+        std::atomic<TrackList *> publishedTracks{audioTracks.get()}; //!< The track list that the callback uses
+        std::atomic<u32> activeCallbacks{}; //!< The amount of callbacks that are currently using the published track list
+        std::atomic<bool> paused{}; //!< If the callback should output silence without reading or releasing any buffers of the tracks
+        Mutex trackLock; //!< This mutex is used to serialize modifications to the track list, it's never locked by the callback
+
+        static constexpr size_t StableFramesToShrink{constant::SampleRate * 5}; //!< The amount of frames that need to be played without an underrun before the buffer is shrunk by a burst
+        static constexpr size_t LatencyUpdateFrames{constant::SampleRate / 4}; //!< The amount of frames between updates of the measured output latency
+
+        // These are only accessed by the callback thread
+        i32 lastXRunCount{}; //!< The amount of underruns at the last callback
+        size_t stableFrames{}; //!< The amount of frames that were played since the buffer size was last changed or an underrun occurred
+        size_t latencyFrames{}; //!< The amount of frames that were played since the output latency was last measured
+
+        static constexpr size_t TimestampUpdateFrames{constant::SampleRate / 100}; //!< The amount of frames between queries of the stream's timestamp, the presented position is extrapolated from the last one in between them
+
+        // These are only accessed by the callback thread, besides being rebased by OpenStream when the stream is reopened
+        u64 writtenFrames{}; //!< The total amount of frames written to all output streams
+        u64 streamFrameBase{}; //!< The value of writtenFrames when the current output stream was opened, the positions of the stream are relative to this
+        u64 presentedFrames{}; //!< The total amount of frames presented by the output device at the last callback
+        std::optional<oboe::FrameTimestamp> lastTimestamp; //!< The last timestamp of the stream with its position rebased, this is empty if the stream doesn't support timestamps
+        size_t timestampFrames{TimestampUpdateFrames}; //!< The amount of frames that were written since the timestamp was last queried
+
+        // The audio clock is published by the callback with a sequence lock as it's made up of multiple values
+        std::atomic<u32> clockSequence{}; //!< This is odd while the clock is being updated
+        std::atomic<u64> clockFrames{}; //!< The amount of presented frames at clockTime
+        std::atomic<u64> clockLimit{}; //!< The amount of frames written to the stream at clockTime, the presented frames are never extrapolated past this
+        std::atomic<i64> clockTime{}; //!< The CLOCK_MONOTONIC time in nanoseconds that the clock was last published at
+        std::atomic<u64> clockLast{}; //!< The last value returned by GetPresentedFrames, this ensures the clock is monotonic across publishes
+
+        std::atomic<i64> outputLatency{}; //!< The measured latency of the output stream in microseconds, this is 0 if it couldn't be measured
+        std::atomic<u32> streamSampleRate{constant::SampleRate}; //!< The sample rate of the output stream, this is the native rate of the device which tracks are converted to
+        bool sincResampling; //!< If tracks are resampled with the windowed-sinc filter rather than the curve filters
         oboe::AudioStreamBuilder builder; //!< The audio stream builder, used to open
         oboe::ManagedStream outputStream; //!< The output oboe audio stream
-        std::vector<std::shared_ptr<AudioTrack>> audioTracks; //!< A vector of shared_ptr to every open audio track
-        Mutex trackLock; //!< This mutex is used to ensure that audioTracks isn't modified while it is being used
+
+        /**
+         * @brief Publishes a new track list to the callback and frees the previous one once no callback can be using it
+         * @note trackLock MUST be locked when calling this
+         */
+        void PublishTracks(std::unique_ptr<TrackList> tracks);
+
+        /**
+         * @brief Opens and starts the output stream with a buffer size of two bursts, this is the lowest latency configuration that doesn't underrun on most devices
+         */
+        void OpenStream();
+
+        /**
+         * @brief Adapts the buffer size of the stream to underruns, it's grown by a burst on an underrun and shrunk by one after playing stably for a while
+         * @note This is called by the callback thread with the amount of frames that were just played
+         */
+        void TuneBufferSize(oboe::AudioStream *audioStream, int32_t numFrames);
+
+        /**
+         * @brief Determines the amount of frames that have been presented by the output device from the stream's timestamp and publishes it to the audio clock
+         * @param streamEnd The value of writtenFrames after the frames of the current callback
+         * @note This is called by the callback thread, if the stream doesn't support timestamps frames are treated as presented as soon as they're written like before
+         */
+        void UpdateClock(oboe::AudioStream *audioStream, u64 streamEnd, int32_t numFrames);
 
       public:
         Audio(const DeviceState &state);
 
         /**
          * @brief Opens a new track that can be used to play sound
-         * @param channelCount The amount channels that are present in the track
-         * @param sampleRate The sample rate of the track
+         * @param channelCount The amount channels that are present in the track, this can be up to constant::ChannelCount
+         * @param sampleRate The sample rate of the track, this can be any rate as tracks are converted to the rate of the output stream
          * @param releaseCallback The callback to call when a buffer has been released
          * @return A shared pointer to a new AudioTrack object
          */
@@ -39,6 +98,38 @@ namespace skyline::audio {
          */
         void CloseTrack(std::shared_ptr<AudioTrack> &track);
 
+        /**
+         * @brief Waits for the callback in flight to return and outputs silence till Resume is called, no buffers are released to the guest while paused
+         */
+        void Pause();
+
+        /**
+         * @brief Resumes playing the tracks after Pause
+         */
+        void Resume();
+
+        /**
+         * @return The amount of frames that have been presented by the output device, this is monotonic and tracks the position of the DAC so it can be used as a master clock
+         */
+        u64 GetPresentedFrames();
+
+        /**
+         * @return The time of the audio clock, this is the duration of all frames presented by the output device
+         * @note The frames are in units of the current rate of the output stream, if the stream is reopened at a different rate the clock changes its pace
+         */
+        inline std::chrono::nanoseconds GetClock() {
+            auto frames{GetPresentedFrames()};
+            u64 rate{streamSampleRate.load(std::memory_order_relaxed)};
+            return std::chrono::nanoseconds(((frames / rate) * constant::NsInSecond) + (((frames % rate) * constant::NsInSecond) / rate));
+        }
+
+        /**
+         * @return The measured latency between a frame being written to the stream and it being presented by the output device, this can be used to synchronize audio and video
+         */
+        inline std::chrono::microseconds GetOutputLatency() {
+            return std::chrono::microseconds(outputLatency.load(std::memory_order_relaxed));
+        }
+
         /**
          * @brief The callback oboe uses to get audio sample data
          * @param audioStream The audio stream we are being called by
@@ -9,25 +9,20 @@
 namespace skyline::audio {
     AdpcmDecoder::AdpcmDecoder(const std::vector<std::array<i16, 2>> &coefficients) : coefficients(coefficients) {}
 
-    std::vector<i16> AdpcmDecoder::Decode(std::span<u8> adpcmData) {
-        constexpr size_t BytesPerFrame{0x8};
-        constexpr size_t SamplesPerFrame{0xE};
-
-        size_t remainingSamples{(adpcmData.size() / BytesPerFrame) * SamplesPerFrame};
-
-        std::vector<i16> output;
-        output.reserve(remainingSamples);
+    void AdpcmDecoder::LoadContext(const Context &context) {
+        history = {context.history[0], context.history[1]};
+    }
 
-        size_t inputOffset{};
+    size_t AdpcmDecoder::Decode(std::span<const u8> adpcmData, std::span<i16> output) {
+        size_t frameCount{std::min(adpcmData.size() / BytesPerFrame, output.size() / SamplesPerFrame)};
+        size_t inputOffset{}, outputOffset{};
 
-        while (inputOffset < adpcmData.size()) {
+        for (size_t frame{}; frame < frameCount; frame++) {
             FrameHeader header{adpcmData[inputOffset++]};
 
-            size_t frameSamples{std::min(SamplesPerFrame, remainingSamples)};
-
             i32 ctx{};
 
-            for (size_t index = 0; index < frameSamples; index++) {
+            for (size_t index = 0; index < SamplesPerFrame; index++) {
                 i32 sample{};
 
                 if (index & 1) {
@@ -41,14 +36,12 @@ namespace skyline::audio {
                 sample = (sample * (0x800 << header.scale) + prediction + 0x400) >> 11;
 
                 auto saturated = audio::Saturate<i16, i32>(sample);
-                output.push_back(saturated);
+                output[outputOffset++] = saturated;
                 history[1] = history[0];
                 history[0] = saturated;
             }
-
-            remainingSamples -= frameSamples;
         }
 
-        return output;
+        return outputOffset;
     }
 }
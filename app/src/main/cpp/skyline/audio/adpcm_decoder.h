@@ -11,6 +11,19 @@ namespace skyline::audio {
      * @brief The AdpcmDecoder class handles decoding single channel adaptive differential PCM data
      */
     class AdpcmDecoder {
+      public:
+        static constexpr size_t BytesPerFrame{0x8}; //!< The size of a single ADPCM frame in bytes
+        static constexpr size_t SamplesPerFrame{0xE}; //!< The amount of samples that a single ADPCM frame decodes into
+
+        /**
+         * @brief This struct holds the state of the decoder at a point in an ADPCM stream, it's supplied by the guest to resume decoding at the start of a looping buffer
+         */
+        struct Context {
+            u16 header; //!< The header of the frame that the context is at
+            i16 history[2]; //!< The last two decoded samples, the first one is the most recent
+        };
+        static_assert(sizeof(Context) == 0x6);
+
       private:
         /**
          * @brief This struct holds a single ADPCM frame header
@@ -33,10 +46,16 @@ namespace skyline::audio {
         AdpcmDecoder(const std::vector<std::array<i16, 2>> &coefficients);
 
         /**
-         * @brief This decodes a buffer of ADPCM data into I16 PCM
-         * @param adpcmData A buffer containing the raw ADPCM data
-         * @return A buffer containing decoded single channel I16 PCM data
+         * @brief This restores the history of the decoder from a context so decoding resumes from the point it was captured at
+         */
+        void LoadContext(const Context &context);
+
+        /**
+         * @brief This decodes a buffer of ADPCM frames into I16 PCM, the history is retained across calls so a stream can be decoded incrementally in frame-granular chunks
+         * @param adpcmData A buffer containing the raw ADPCM frames, a trailing partial frame is ignored
+         * @param output The buffer to write decoded single channel I16 PCM data into, only as many frames as entirely fit into it are decoded
+         * @return The amount of samples written into the output buffer
          */
-        std::vector<i16> Decode(std::span<u8> adpcmData);
+        size_t Decode(std::span<const u8> adpcmData, std::span<i16> output);
     };
 }
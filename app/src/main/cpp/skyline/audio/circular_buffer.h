@@ -9,145 +9,81 @@
 
 namespace skyline::audio {
     /**
-     * @brief This class is used to abstract an array into a circular buffer
+     * @brief This class is used to abstract an array into a wait-free single-producer single-consumer circular buffer
      * @tparam Type The type of elements stored in the buffer
      * @tparam Size The maximum size of the circular buffer
+     * @note Only a single thread may append to the buffer and only a single thread may read from it at any time, neither of them ever blocks on the other
      */
     template<typename Type, size_t Size>
     class CircularBuffer {
       private:
         std::array<Type, Size> array{}; //!< The internal array holding the circular buffer
-        Type *start{array.begin()}; //!< The start/oldest element of the internal array
-        Type *end{array.begin()}; //!< The end/newest element of the internal array
-        bool empty{true}; //!< This boolean is used to differentiate between the buffer being full or empty
-        Mutex mtx; //!< The mutex ensures that the buffer operations don't overlap
+        alignas(64) std::atomic<size_t> readPosition{}; //!< The total amount of elements that have been read from the buffer, this is only written to by the consumer
+        alignas(64) std::atomic<size_t> writePosition{}; //!< The total amount of elements that have been appended to the buffer, this is only written to by the producer
 
       public:
         /**
          * @brief This reads data from this buffer into the specified buffer
          * @param address The address to write buffer data into
          * @param maxSize The maximum amount of data to write in units of Type
-         * @param copyFunction If this is specified, then this is called rather than memcpy
+         * @param copyFunction If this is specified, then this is called rather than memcpy for the first copyOffset elements, it's called with the destination, the source and the amount of elements for every contiguous chunk
+         * @param copyOffset The amount of elements that copyFunction is used for, -1 uses it for all elements
          * @return The amount of data written into the input buffer in units of Type
          */
-        inline size_t Read(Type *address, ssize_t maxSize, void copyFunction(Type *, Type *) = {}, ssize_t copyOffset = -1) {
-            std::lock_guard guard(mtx);
-
-            if (empty)
+        inline size_t Read(Type *address, ssize_t maxSize, void copyFunction(Type *, const Type *, size_t) = {}, ssize_t copyOffset = -1) {
+            auto read{readPosition.load(std::memory_order_relaxed)};
+            auto size{std::min(writePosition.load(std::memory_order_acquire) - read, static_cast<size_t>(maxSize))};
+            if (!size)
                 return 0;
 
-            ssize_t size{}, sizeBegin{}, sizeEnd{};
-
-            if (start < end) {
-                sizeEnd = std::min(end - start, maxSize);
-
-                size = sizeEnd;
-            } else {
-                sizeEnd = std::min(array.end() - start, maxSize);
-                sizeBegin = std::min(end - array.begin(), maxSize - sizeEnd);
-
-                size = sizeBegin + sizeEnd;
-            }
-
-            if (copyFunction && copyOffset) {
-                auto sourceEnd = start + ((copyOffset != -1) ? copyOffset : sizeEnd);
+            size_t functionSize{copyFunction ? ((copyOffset == -1) ? size : std::min(static_cast<size_t>(copyOffset), size)) : 0};
 
-                for (auto source = start, destination = address; source < sourceEnd; source++, destination++)
-                    copyFunction(source, destination);
+            // The elements are copied out in up to two chunks as they can wrap around the end of the array
+            for (size_t copied{}; copied < size;) {
+                auto index{(read + copied) % Size};
+                auto chunkSize{std::min(size - copied, Size - index)};
+                auto source{array.data() + index}, destination{address + copied};
 
-                if (copyOffset != -1) {
-                    std::memcpy(address + copyOffset, start + copyOffset, (sizeEnd - copyOffset) * sizeof(Type));
-                    copyOffset -= sizeEnd;
-                }
-            } else {
-                std::memcpy(address, start, sizeEnd * sizeof(Type));
-            }
-
-            address += sizeEnd;
-
-            if (sizeBegin) {
-                if (copyFunction && copyOffset) {
-                    auto sourceEnd = array.begin() + ((copyOffset != -1) ? copyOffset : sizeBegin);
+                auto chunkFunctionSize{functionSize > copied ? std::min(chunkSize, functionSize - copied) : 0};
+                if (chunkFunctionSize)
+                    copyFunction(destination, source, chunkFunctionSize);
+                std::memcpy(destination + chunkFunctionSize, source + chunkFunctionSize, (chunkSize - chunkFunctionSize) * sizeof(Type));
 
-                    for (auto source = array.begin(), destination = address; source < sourceEnd; source++, destination++)
-                        copyFunction(source, destination);
-
-                    if (copyOffset != -1)
-                        std::memcpy(array.begin() + copyOffset, address + copyOffset, (sizeBegin - copyOffset) * sizeof(Type));
-                } else {
-                    std::memcpy(address, array.begin(), sizeBegin * sizeof(Type));
-                }
-
-                start = array.begin() + sizeBegin;
-            } else {
-                start += sizeEnd;
+                copied += chunkSize;
             }
 
-            if (start == end)
-                empty = true;
-
-            return static_cast<size_t>(size);
+            readPosition.store(read + size, std::memory_order_release);
+            return size;
         }
 
         /**
          * @brief This appends data from the specified buffer into this buffer
          * @param address The address of the buffer
          * @param size The size of the buffer in units of Type
+         * @return The amount of data that was appended in units of Type, anything that doesn't fit into the buffer is dropped as the consumer's data can't be overwritten
          */
-        inline void Append(Type *address, ssize_t size) {
-            std::lock_guard guard(mtx);
-
-            while (size) {
-                if (start <= end && end != array.end()) {
-                    auto sizeEnd = std::min(array.end() - end, size);
-                    std::memcpy(end, address, sizeEnd * sizeof(Type));
-
-                    address += sizeEnd;
-                    size -= sizeEnd;
-
-                    end += sizeEnd;
-                } else {
-                    auto sizePreStart = (end == array.end()) ? std::min(start - array.begin(), size) : std::min(start - end, size);
-                    auto sizePostStart = std::min(array.end() - start, size - sizePreStart);
-
-                    if (sizePreStart)
-                        std::memcpy((end == array.end()) ? array.begin() : end, address, sizePreStart * sizeof(Type));
-
-                    if (end == array.end())
-                        end = array.begin() + sizePreStart;
-                    else
-                        end += sizePreStart;
-
-                    address += sizePreStart;
-                    size -= sizePreStart;
-
-                    if (sizePostStart)
-                        std::memcpy(end, address, sizePostStart * sizeof(Type));
-
-                    if (start == array.end())
-                        start = array.begin() + sizePostStart;
-                    else
-                        start += sizePostStart;
-
-                    if (end == array.end())
-                        end = array.begin() + sizePostStart;
-                    else
-                        end += sizePostStart;
-
-                    address += sizePostStart;
-                    size -= sizePostStart;
-                }
-
-                empty = false;
+        inline size_t Append(Type *address, ssize_t size) {
+            auto write{writePosition.load(std::memory_order_relaxed)};
+            auto appendSize{std::min(static_cast<size_t>(size), Size - (write - readPosition.load(std::memory_order_acquire)))};
+
+            for (size_t copied{}; copied < appendSize;) {
+                auto index{(write + copied) % Size};
+                auto chunkSize{std::min(appendSize - copied, Size - index)};
+                std::memcpy(array.data() + index, address + copied, chunkSize * sizeof(Type));
+                copied += chunkSize;
             }
+
+            writePosition.store(write + appendSize, std::memory_order_release);
+            return appendSize;
         }
 
         /**
          * @brief This appends data from a span to the buffer
          * @param data A span containing the data to be appended
+         * @return The amount of data that was appended in units of Type
          */
-        inline void Append(std::span<Type> data) {
-            Append(data.data(), data.size());
+        inline size_t Append(std::span<Type> data) {
+            return Append(data.data(), data.size());
         }
     };
 }
@@ -43,7 +43,6 @@ namespace skyline {
         struct BufferIdentifier {
             u64 tag;
             u64 finalSample; //!< The final sample this buffer will be played in, after that the buffer can be safely released
-            bool released; //!< If the buffer has been released (fully played back)
         };
 
         /**
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <arm_neon.h>
+#include "common.h"
+#include "mix.h"
+
+namespace skyline::audio::mix {
+    constexpr size_t VectorSize{8}; //!< The amount of samples in a single vector
+
+    void Mix(i16 *destination, const i16 *source, size_t count) {
+        size_t index{};
+        for (; index + (VectorSize * 2) <= count; index += VectorSize * 2) {
+            auto samples{vld1q_s16_x2(source + index)}, mixed{vld1q_s16_x2(destination + index)};
+            mixed.val[0] = vqaddq_s16(mixed.val[0], samples.val[0]);
+            mixed.val[1] = vqaddq_s16(mixed.val[1], samples.val[1]);
+            vst1q_s16_x2(destination + index, mixed);
+        }
+        for (; index + VectorSize <= count; index += VectorSize)
+            vst1q_s16(destination + index, vqaddq_s16(vld1q_s16(destination + index), vld1q_s16(source + index)));
+        for (; index < count; index++)
+            destination[index] = Saturate<i16, i32>(static_cast<i32>(destination[index]) + source[index]);
+    }
+
+    /**
+     * @brief Scales samples by a volume and either mixes them into or writes them to the destination
+     * @tparam Accumulate If the scaled samples are added to the destination samples rather than overwriting them
+     */
+    template<bool Accumulate>
+    void ScaleSamples(i16 *destination, const i16 *source, size_t count, float volume) {
+        size_t index{};
+
+        if (volume >= 0.0f && volume < 1.0f) {
+            // VQRDMULH multiplies two Q15 values with rounding, so a volume below 1 can be applied directly to the samples as a Q15 factor
+            auto factor{static_cast<i16>(std::min(std::lround(volume * 0x8000), static_cast<long>(std::numeric_limits<i16>::max())))};
+            for (; index + VectorSize <= count; index += VectorSize) {
+                auto scaled{vqrdmulhq_n_s16(vld1q_s16(source + index), factor)};
+                vst1q_s16(destination + index, Accumulate ? vqaddq_s16(vld1q_s16(destination + index), scaled) : scaled);
+            }
+            for (; index < count; index++) {
+                auto scaled{(static_cast<i32>(source[index]) * factor + 0x4000) >> 15};
+                destination[index] = Saturate<i16, i32>(Accumulate ? scaled + destination[index] : scaled);
+            }
+        } else {
+            // Volumes outside of the Q15 range are applied to the samples widened to floats, the conversions back to integers saturate
+            for (; index + VectorSize <= count; index += VectorSize) {
+                auto samples{vld1q_s16(source + index)};
+                auto low{vcvtnq_s32_f32(vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), volume))};
+                auto high{vcvtnq_s32_f32(vmulq_n_f32(vcvtq_f32_s32(vmovl_high_s16(samples)), volume))};
+                auto scaled{vcombine_s16(vqmovn_s32(low), vqmovn_s32(high))};
+                vst1q_s16(destination + index, Accumulate ? vqaddq_s16(vld1q_s16(destination + index), scaled) : scaled);
+            }
+            for (; index < count; index++) {
+                auto scaled{Saturate<i16, float>(std::nearbyint(source[index] * volume))};
+                destination[index] = Accumulate ? Saturate<i16, i32>(static_cast<i32>(scaled) + destination[index]) : scaled;
+            }
+        }
+    }
+
+    void Mix(i16 *destination, const i16 *source, size_t count, float volume) {
+        if (volume == 1.0f)
+            Mix(destination, source, count);
+        else
+            ScaleSamples<true>(destination, source, count, volume);
+    }
+
+    void Scale(i16 *destination, const i16 *source, size_t count, float volume) {
+        if (volume == 1.0f)
+            std::memcpy(destination, source, count * sizeof(i16));
+        else
+            ScaleSamples<false>(destination, source, count, volume);
+    }
+
+    void Widen(i32 *destination, const i16 *source, size_t count) {
+        size_t index{};
+        for (; index + VectorSize <= count; index += VectorSize) {
+            auto samples{vld1q_s16(source + index)};
+            vst1q_s32(destination + index, vmovl_s16(vget_low_s16(samples)));
+            vst1q_s32(destination + index + (VectorSize / 2), vmovl_high_s16(samples));
+        }
+        for (; index < count; index++)
+            destination[index] = source[index];
+    }
+
+    void Narrow(i16 *destination, const i32 *source, size_t count) {
+        size_t index{};
+        for (; index + VectorSize <= count; index += VectorSize)
+            vst1q_s16(destination + index, vcombine_s16(vqmovn_s32(vld1q_s32(source + index)), vqmovn_s32(vld1q_s32(source + index + (VectorSize / 2)))));
+        for (; index < count; index++)
+            destination[index] = Saturate<i16, i32>(source[index]);
+    }
+}
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::audio::mix {
+    /**
+     * @brief Mixes samples into a buffer, every sample is added to the corresponding destination sample with saturation
+     * @param count The amount of samples to mix
+     */
+    void Mix(i16 *destination, const i16 *source, size_t count);
+
+    /**
+     * @brief Mixes samples into a buffer after scaling them by a volume, every scaled sample is added to the corresponding destination sample with saturation
+     * @param count The amount of samples to mix
+     * @note Volumes in the range [0, 1) are applied with a rounding Q15 multiply, any other volume is applied in floating-point
+     */
+    void Mix(i16 *destination, const i16 *source, size_t count, float volume);
+
+    /**
+     * @brief Writes samples scaled by a volume into a buffer, this overwrites the destination samples
+     * @param count The amount of samples to write
+     */
+    void Scale(i16 *destination, const i16 *source, size_t count, float volume);
+
+    /**
+     * @brief Widens samples to 32-bit integers, this is used to process samples with headroom for intermediate values
+     * @param count The amount of samples to widen
+     */
+    void Widen(i32 *destination, const i16 *source, size_t count);
+
+    /**
+     * @brief Narrows 32-bit integer samples back to 16-bit samples with saturation
+     * @param count The amount of samples to narrow
+     */
+    void Narrow(i16 *destination, const i32 *source, size_t count);
+}
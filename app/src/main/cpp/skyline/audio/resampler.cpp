@@ -2,6 +2,8 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <array>
+#include <cmath>
+#include <arm_neon.h>
 #include <common.h>
 #include "common.h"
 #include "resampler.h"
@@ -121,37 +123,183 @@ namespace skyline::audio {
         {-42, 3751, 26253, 2811},   {-38, 3608, 26270, 2936},   {-34, 3467, 26281, 3064},   {-32, 3329, 26287, 3195}}};
     // @fmt:on
 
-    std::vector<i16> Resampler::ResampleBuffer(std::span<i16> inputBuffer, double ratio, u8 channelCount) {
-        auto step{static_cast<u32>(ratio * 0x8000)};
-        auto outputSize{static_cast<size_t>(inputBuffer.size() / ratio)};
-        std::vector<i16> outputBuffer(outputSize);
+    constexpr size_t CurvePhaseShift{8}; //!< The amount the fraction is shifted right by to get the phase of a curve filter
+    constexpr size_t SincPhaseShift{7}; //!< The amount the fraction is shifted right by to get the phase of the windowed-sinc filter
+    constexpr size_t SincPhaseCount{0x8000 >> SincPhaseShift}; //!< The amount of phases of the windowed-sinc filter
 
-        const std::array<LutEntry, 128> &lut = [step] {
-            if (step > 0xAAAA)
-                return CurveLut0;
-            else if (step <= 0x8000)
-                return CurveLut1;
-            else
-                return CurveLut2;
-        }();
+    using CurveTable = std::array<std::array<i16, Resampler::CurveTapCount>, 128>;
+
+    /**
+     * @brief Converts a curve LUT into a table of Q15 coefficients in the layout used by the polyphase filter, all coefficients fit into an i16
+     */
+    constexpr CurveTable ToCurveTable(const std::array<LutEntry, 128> &lut) {
+        CurveTable table{};
+        for (size_t phase{}; phase < lut.size(); phase++)
+            table[phase] = {static_cast<i16>(lut[phase].a), static_cast<i16>(lut[phase].b), static_cast<i16>(lut[phase].c), static_cast<i16>(lut[phase].d)};
+        return table;
+    }
+
+    constexpr CurveTable CurveTable0{ToCurveTable(CurveLut0)};
+    constexpr CurveTable CurveTable1{ToCurveTable(CurveLut1)};
+    constexpr CurveTable CurveTable2{ToCurveTable(CurveLut2)};
+
+    /**
+     * @brief Generates the coefficients of every phase of a Blackman-windowed sinc filter with a cutoff suited to the step
+     */
+    void GenerateSincTable(std::vector<i16> &table, u32 step) {
+        constexpr double Pi{3.14159265358979323846};
+        constexpr double HalfWidth{Resampler::SincTapCount / 2};
+        constexpr size_t LeadingTaps{(Resampler::SincTapCount / 2) - 1};
+
+        // Frequencies above the output's Nyquist frequency are filtered out when downsampling so they don't alias
+        double cutoff{std::min(1.0, static_cast<double>(0x8000) / step)};
+
+        table.resize(SincPhaseCount * Resampler::SincTapCount);
+        for (size_t phase{}; phase < SincPhaseCount; phase++) {
+            std::array<double, Resampler::SincTapCount> coefficients;
+            double sum{};
+            for (size_t tap{}; tap < Resampler::SincTapCount; tap++) {
+                double position{static_cast<double>(tap) - LeadingTaps - (static_cast<double>(phase) / SincPhaseCount)};
+                double x{Pi * cutoff * position};
+                double window{0.42 + (0.5 * std::cos(Pi * position / HalfWidth)) + (0.08 * std::cos(2 * Pi * position / HalfWidth))};
+                coefficients[tap] = (std::abs(x) < 1e-9 ? 1.0 : std::sin(x) / x) * window;
+                sum += coefficients[tap];
+            }
+
+            // Every phase is normalized to unity gain so the filter doesn't modulate the amplitude of low frequencies
+            for (size_t tap{}; tap < Resampler::SincTapCount; tap++)
+                table[(phase * Resampler::SincTapCount) + tap] = Saturate<i16, long>(std::lround((coefficients[tap] / sum) * 0x8000));
+        }
+    }
+
+    /**
+     * @return The dot products of the taps of a single mono frame and the coefficients, split across the four lanes
+     */
+    template<size_t Taps>
+    inline int32x4_t FilterMono(const i16 *input, const i16 *coefficients) {
+        auto accumulator{vmull_s16(vld1_s16(input), vld1_s16(coefficients))};
+        for (size_t tap{4}; tap < Taps; tap += 4)
+            accumulator = vmlal_s16(accumulator, vld1_s16(input + tap), vld1_s16(coefficients + tap));
+        return accumulator;
+    }
+
+    /**
+     * @return The dot products of the taps of a single stereo frame and the coefficients for both channels, split across the four lanes
+     */
+    template<size_t Taps>
+    inline int32x4x2_t FilterStereo(const i16 *input, const i16 *coefficients) {
+        auto samples{vld2_s16(input)};
+        auto factors{vld1_s16(coefficients)};
+        int32x4x2_t accumulator{{vmull_s16(samples.val[0], factors), vmull_s16(samples.val[1], factors)}};
+        for (size_t tap{4}; tap < Taps; tap += 4) {
+            samples = vld2_s16(input + (tap * 2));
+            factors = vld1_s16(coefficients + tap);
+            accumulator.val[0] = vmlal_s16(accumulator.val[0], samples.val[0], factors);
+            accumulator.val[1] = vmlal_s16(accumulator.val[1], samples.val[1], factors);
+        }
+        return accumulator;
+    }
+
+    /**
+     * @brief Reduces the lane-split dot products of four output frames into their saturated Q15 results
+     */
+    inline int16x4_t Reduce(int32x4_t a, int32x4_t b, int32x4_t c, int32x4_t d) {
+        return vqshrn_n_s32(vpaddq_s32(vpaddq_s32(a, b), vpaddq_s32(c, d)), 15);
+    }
+
+    /**
+     * @brief Resamples frames with a polyphase filter, mono and stereo inputs are resampled four output frames at a time with NEON
+     * @tparam Taps The amount of taps of the filter, this must be a multiple of 4
+     * @param table The coefficients of the filter, there are Taps consecutive Q15 coefficients for every phase
+     * @param phaseShift The amount that the fraction is shifted right by to obtain the phase
+     */
+    template<size_t Taps>
+    std::pair<size_t, size_t> ResampleFrames(const i16 *table, size_t phaseShift, u32 step, u32 &fraction, std::span<const i16> inputBuffer, std::span<i16> outputBuffer, u8 inputChannels, u8 outputChannels) {
+        size_t inputFrames{inputBuffer.size() / inputChannels}, outputFrames{outputBuffer.size() / outputChannels};
+        size_t outIndex{}, inIndex{};
+
+        if (inputChannels <= 2 && outputChannels <= 2) {
+            for (; outIndex + 4 <= outputFrames; outIndex += 4) {
+                // The positions and phases of the block are determined upfront, it's only resampled if the taps of all of its frames are in the input
+                std::array<const i16 *, 4> inputs, coefficients;
+                auto position{inIndex}, lastPosition{inIndex};
+                auto blockFraction{fraction};
+                for (size_t frame{}; frame < 4; frame++) {
+                    inputs[frame] = inputBuffer.data() + (position * inputChannels);
+                    coefficients[frame] = table + ((blockFraction >> phaseShift) * Taps);
+                    lastPosition = position;
+
+                    u32 newOffset{blockFraction + step};
+                    position += newOffset >> 15;
+                    blockFraction = newOffset & 0x7FFF;
+                }
+                if (lastPosition + Taps > inputFrames)
+                    break;
+
+                auto output{outputBuffer.data() + (outIndex * outputChannels)};
+                if (inputChannels == 1) {
+                    auto samples{Reduce(FilterMono<Taps>(inputs[0], coefficients[0]), FilterMono<Taps>(inputs[1], coefficients[1]), FilterMono<Taps>(inputs[2], coefficients[2]), FilterMono<Taps>(inputs[3], coefficients[3]))};
+                    if (outputChannels == 1)
+                        vst1_s16(output, samples);
+                    else
+                        vst2_s16(output, int16x4x2_t{{samples, samples}});
+                } else {
+                    auto frame0{FilterStereo<Taps>(inputs[0], coefficients[0])}, frame1{FilterStereo<Taps>(inputs[1], coefficients[1])};
+                    auto frame2{FilterStereo<Taps>(inputs[2], coefficients[2])}, frame3{FilterStereo<Taps>(inputs[3], coefficients[3])};
+                    vst2_s16(output, int16x4x2_t{{Reduce(frame0.val[0], frame1.val[0], frame2.val[0], frame3.val[0]), Reduce(frame0.val[1], frame1.val[1], frame2.val[1], frame3.val[1])}});
+                }
+
+                inIndex = position;
+                fraction = blockFraction;
+            }
+        }
 
-        for (size_t outIndex{}, inIndex{}; outIndex < outputSize; outIndex += channelCount) {
-            u32 lutIndex{fraction >> 8};
+        for (; outIndex < outputFrames && inIndex + Taps <= inputFrames; outIndex++) {
+            auto factors{table + ((fraction >> phaseShift) * Taps)};
+            auto input{inputBuffer.data() + (inIndex * inputChannels)};
+            auto output{outputBuffer.data() + (outIndex * outputChannels)};
 
-            for (u8 channel{}; channel < channelCount; channel++) {
-                i32 data = inputBuffer[(inIndex + 0) * channelCount + channel] * lut[lutIndex].a +
-                    inputBuffer[(inIndex + 1) * channelCount + channel] * lut[lutIndex].b +
-                    inputBuffer[(inIndex + 2) * channelCount + channel] * lut[lutIndex].c +
-                    inputBuffer[(inIndex + 3) * channelCount + channel] * lut[lutIndex].d;
+            for (u8 channel{}; channel < inputChannels; channel++) {
+                i32 data{};
+                for (size_t tap{}; tap < Taps; tap++)
+                    data += input[(tap * inputChannels) + channel] * factors[tap];
 
-                outputBuffer[outIndex + channel] = Saturate<i16, i32>(data >> 15);
+                output[channel] = Saturate<i16, i32>(data >> 15);
             }
 
+            // Channels that aren't present in the input, such as the right channel of a mono input, are copies of the last input channel
+            for (u8 channel{inputChannels}; channel < outputChannels; channel++)
+                output[channel] = output[inputChannels - 1];
+
             u32 newOffset{fraction + step};
             inIndex += newOffset >> 15;
             fraction = newOffset & 0x7FFF;
         }
 
-        return outputBuffer;
+        return {inIndex, outIndex};
+    }
+
+    Resampler::Resampler(bool sinc) : sinc(sinc) {}
+
+    std::pair<size_t, size_t> Resampler::Resample(std::span<const i16> inputBuffer, std::span<i16> outputBuffer, double ratio, u8 inputChannels, u8 outputChannels) {
+        auto step{static_cast<u32>(ratio * 0x8000)};
+
+        if (sinc) {
+            if (step != sincStep || sincTable.empty()) {
+                GenerateSincTable(sincTable, step);
+                sincStep = step;
+            }
+            return ResampleFrames<SincTapCount>(sincTable.data(), SincPhaseShift, step, fraction, inputBuffer, outputBuffer, inputChannels, outputChannels);
+        }
+
+        const CurveTable &table = [step]() -> const CurveTable & {
+            if (step > 0xAAAA)
+                return CurveTable0;
+            else if (step <= 0x8000)
+                return CurveTable1;
+            else
+                return CurveTable2;
+        }();
+        return ResampleFrames<CurveTapCount>(table.front().data(), CurvePhaseShift, step, fraction, inputBuffer, outputBuffer, inputChannels, outputChannels);
     }
 }
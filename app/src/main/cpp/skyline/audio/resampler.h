@@ -8,19 +8,50 @@
 
 namespace skyline::audio {
     /**
-     * @brief The Resampler class handles resampling audio PCM data
+     * @brief The Resampler class handles resampling audio PCM data with a polyphase filter
+     * @note The curve filters match the ones used by the audio renderer on the Switch, the windowed-sinc filter is an optional higher quality one with anti-aliasing when downsampling
      */
     class Resampler {
+      public:
+        static constexpr size_t CurveTapCount{4}; //!< The amount of taps of the curve filters
+        static constexpr size_t SincTapCount{16}; //!< The amount of taps of the windowed-sinc filter
+        static constexpr size_t MaxTapCount{SincTapCount}; //!< The maximum amount of taps of any filter
+
       private:
         u32 fraction{}; //!< The fractional value used for storing the resamplers last frame
+        bool sinc; //!< If the windowed-sinc filter is used rather than the curve filters
+        u32 sincStep{}; //!< The step that the windowed-sinc filter was generated for
+        std::vector<i16> sincTable; //!< The Q15 coefficients of every phase of the windowed-sinc filter, this is regenerated when the step changes as its cutoff depends on it
 
       public:
         /**
-         * @brief Resamples the given sample buffer by the given ratio
-         * @param inputBuffer A buffer containing PCM sample data
+         * @param sinc If the windowed-sinc filter should be used rather than the curve filters
+         */
+        Resampler(bool sinc = false);
+
+        /**
+         * @return The amount of consecutive input frames that a single output frame is interpolated from
+         */
+        inline size_t GetTapCount() {
+            return sinc ? SincTapCount : CurveTapCount;
+        }
+
+        /**
+         * @return The amount of taps that precede the input frame an output frame is interpolated from, an output frame is interpolated between the frames at this tap and the next one
+         */
+        inline size_t GetLeadingTapCount() {
+            return (GetTapCount() / 2) - 1;
+        }
+
+        /**
+         * @brief Resamples frames from the input buffer into the output buffer by the given ratio, this can be called repeatedly to stream a buffer through it
+         * @param inputBuffer A buffer containing interleaved PCM frames, resampling stops once an output frame would require frames past its end
+         * @param outputBuffer A buffer to write interleaved PCM frames into, input channels are duplicated across any output channels beyond them
          * @param ratio The conversion ratio needed
-         * @param channelCount The amount of channels the buffer contains
+         * @param inputChannels The amount of channels the input buffer contains
+         * @param outputChannels The amount of channels the output buffer contains, this must be at least the amount of input channels
+         * @return The amount of input frames consumed and output frames written, the former can exceed the size of the input buffer if frames past it are skipped over
          */
-        std::vector<i16> ResampleBuffer(std::span<i16> inputBuffer, double ratio, u8 channelCount);
+        std::pair<size_t, size_t> Resample(std::span<const i16> inputBuffer, std::span<i16> outputBuffer, double ratio, u8 inputChannels, u8 outputChannels);
     };
 }
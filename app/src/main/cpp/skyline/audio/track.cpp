@@ -1,31 +1,39 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include "mix.h"
 #include "track.h"
 
 namespace skyline::audio {
-    AudioTrack::AudioTrack(u8 channelCount, u32 sampleRate, const std::function<void()> &releaseCallback) : channelCount(channelCount), sampleRate(sampleRate), releaseCallback(releaseCallback) {
-        if (sampleRate != constant::SampleRate)
+    AudioTrack::AudioTrack(u8 channelCount, u32 sampleRate, const std::function<void()> &releaseCallback, bool sincResampling) : channelCount(channelCount), sampleRate(sampleRate), releaseCallback(releaseCallback), resampler(sincResampling) {
+        if (!sampleRate)
             throw exception("Unsupported audio sample rate: {}", sampleRate);
 
-        if (channelCount != constant::ChannelCount)
+        if (!channelCount || channelCount > constant::ChannelCount)
             throw exception("Unsupported quantity of audio channels: {}", channelCount);
+
+        // The resampler interpolates between the frames following its leading taps, these are silent at the start of the track
+        conversionInputSize = resampler.GetLeadingTapCount() * channelCount;
     }
 
     void AudioTrack::Stop() {
-        while (!identifiers.end()->released);
+        u64 finalSample;
+        {
+            std::lock_guard guard(bufferLock);
+            finalSample = identifiers.empty() ? 0 : identifiers.front().finalSample;
+        }
+
+        while (playbackState == AudioOutState::Started && sampleCounter.load(std::memory_order_acquire) < finalSample)
+            std::this_thread::yield();
         playbackState = AudioOutState::Stopped;
     }
 
     bool AudioTrack::ContainsBuffer(u64 tag) {
-        // Iterate from front of queue as we don't want released samples
-        for (auto identifier = identifiers.crbegin(); identifier != identifiers.crend(); ++identifier) {
-            if (identifier->released)
-                return false;
+        std::lock_guard guard(bufferLock);
 
-            if (identifier->tag == tag)
-                return true;
-        }
+        for (const auto &identifier : identifiers)
+            if (identifier.tag == tag)
+                return !IsReleased(identifier);
 
         return false;
     }
@@ -35,39 +43,151 @@ namespace skyline::audio {
         std::lock_guard trackGuard(bufferLock);
 
         for (u32 index{}; index < max; index++) {
-            if (identifiers.empty() || !identifiers.back().released)
+            if (identifiers.empty() || !IsReleased(identifiers.back()))
                 break;
             bufferIds.push_back(identifiers.back().tag);
             identifiers.pop_back();
         }
 
+        UpdateReleaseThreshold();
         return bufferIds;
     }
 
     void AudioTrack::AppendBuffer(u64 tag, std::span<i16> buffer) {
-        BufferIdentifier identifier{
-            .released = false,
-            .tag = tag,
-            .finalSample = identifiers.empty() ? (buffer.size()) : (buffer.size() + identifiers.front().finalSample)
-        };
+        std::lock_guard guard(bufferLock);
+
+        // Only the samples that fit into the buffer are counted, so the buffer is still released if some of its samples were dropped
+        // Samples are only appended if there's space for their descriptor as they'd otherwise be read as a part of the next copied buffer
+        auto queueFull{descriptorWrite.load(std::memory_order_relaxed) - descriptorRead.load(std::memory_order_acquire) >= descriptors.size()};
+        QueueBuffer(tag, nullptr, queueFull ? 0 : samples.Append(buffer));
+    }
 
+    void AudioTrack::AppendBufferInPlace(u64 tag, std::span<const i16> buffer) {
         std::lock_guard guard(bufferLock);
+        QueueBuffer(tag, buffer.data(), buffer.size());
+    }
+
+    void AudioTrack::QueueBuffer(u64 tag, const i16 *data, size_t size) {
+        auto write{descriptorWrite.load(std::memory_order_relaxed)};
+        if (size && write - descriptorRead.load(std::memory_order_acquire) < descriptors.size()) {
+            descriptors[write % descriptors.size()] = {data, size};
+            descriptorWrite.store(write + 1, std::memory_order_release);
+            appendedSamples += size;
+        }
+
+        identifiers.push_front(BufferIdentifier{
+            .tag = tag,
+            .finalSample = appendedSamples,
+        });
+
+        UpdateReleaseThreshold();
+    }
+
+    size_t AudioTrack::ReadSamples(i16 *destination, size_t maxSamples, size_t mixSamples) {
+        size_t read{};
+        auto readIndex{descriptorRead.load(std::memory_order_relaxed)}, writeIndex{descriptorWrite.load(std::memory_order_acquire)};
+        for (; read < maxSamples && readIndex != writeIndex;) {
+            const auto &descriptor{descriptors[readIndex % descriptors.size()]};
+            auto count{std::min(descriptor.size - descriptorOffset, maxSamples - read)};
+            auto mixCount{mixSamples > read ? std::min(count, mixSamples - read) : 0};
+
+            if (descriptor.data) {
+                auto source{descriptor.data + descriptorOffset};
+                mix::Mix(destination + read, source, mixCount);
+                std::memcpy(destination + read + mixCount, source + mixCount, (count - mixCount) * sizeof(i16));
+            } else {
+                samples.Read(destination + read, count, mix::Mix, mixCount); // The samples of a copied buffer are always in the circular buffer before its descriptor is queued
+            }
 
-        identifiers.push_front(identifier);
-        samples.Append(buffer);
+            read += count;
+            if ((descriptorOffset += count) == descriptor.size) {
+                descriptorOffset = 0;
+                readIndex++;
+            }
+        }
+
+        descriptorRead.store(readIndex, std::memory_order_release);
+        readSamples += read;
+        return read;
     }
 
-    void AudioTrack::CheckReleasedBuffers() {
-        bool anyReleased{};
+    size_t AudioTrack::Read(i16 *destination, size_t maxSamples, size_t mixSamples, u32 outputRate, u8 outputChannels) {
+        if (sampleRate == outputRate && channelCount == outputChannels)
+            return ReadSamples(destination, maxSamples, mixSamples);
+
+        auto ratio{static_cast<double>(sampleRate) / outputRate};
+        size_t written{};
+        while (written < maxSamples) {
+            // Any samples the resampler skipped over are dropped before the conversion input is refilled
+            while (conversionSkip) {
+                auto skipped{ReadSamples(conversionInput.data() + conversionInputSize, std::min(conversionSkip, conversionInput.size() - conversionInputSize), 0)};
+                if (!skipped)
+                    break;
+                conversionSkip -= skipped;
+            }
+            if (!conversionSkip)
+                conversionInputSize += ReadSamples(conversionInput.data() + conversionInputSize, (((conversionInput.size() - conversionInputSize) / channelCount) * channelCount), 0);
 
-        for (auto &identifier : identifiers) {
-            if (identifier.finalSample <= sampleCounter && !identifier.released) {
-                anyReleased = true;
-                identifier.released = true;
+            auto outputFrames{std::min((maxSamples - written) / outputChannels, ConversionFrames)};
+            auto [consumed, produced]{resampler.Resample(std::span(conversionInput.data(), conversionInputSize), std::span(conversionOutput.data(), outputFrames * outputChannels), ratio, channelCount, outputChannels)};
+            if (!produced)
+                break;
+
+            auto consumedSamples{consumed * channelCount};
+            if (consumedSamples >= conversionInputSize) {
+                conversionSkip += consumedSamples - conversionInputSize;
+                conversionInputSize = 0;
+            } else {
+                conversionInputSize -= consumedSamples;
+                std::memmove(conversionInput.data(), conversionInput.data() + consumedSamples, conversionInputSize * sizeof(i16));
             }
+
+            auto producedSamples{produced * outputChannels};
+            auto mixCount{mixSamples > written ? std::min(producedSamples, mixSamples - written) : 0};
+            mix::Mix(destination + written, conversionOutput.data(), mixCount);
+            std::memcpy(destination + written + mixCount, conversionOutput.data() + mixCount, (producedSamples - mixCount) * sizeof(i16));
+            written += producedSamples;
+        }
+
+        return written;
+    }
+
+    void AudioTrack::UpdateReleaseThreshold() {
+        // Buffers that have been released but not retrieved yet are reported again on the next callback, this may report a release twice but never misses one
+        if (identifiers.empty())
+            releaseThreshold.store(NoPendingRelease, std::memory_order_release);
+        else if (IsReleased(identifiers.back()))
+            releaseThreshold.store(0, std::memory_order_release);
+        else
+            releaseThreshold.store(identifiers.back().finalSample, std::memory_order_release);
+    }
+
+    void AudioTrack::UpdatePresentation(u64 streamFrame, u64 presentedFrame) {
+        // Every checkpoint has been presented when the queue is empty, so the newest checkpoint is at the sample counter in that case
+        auto newest{checkpointCount ? checkpoints[(checkpointStart + checkpointCount - 1) % checkpoints.size()].sampleCount : sampleCounter.load(std::memory_order_relaxed)};
+        if (readSamples > newest) {
+            if (checkpointCount == checkpoints.size())
+                checkpoints[(checkpointStart + checkpointCount - 1) % checkpoints.size()] = {streamFrame, readSamples}; // The newest checkpoint is extended when the queue is full, its samples are only presented slightly later than they should be
+            else
+                checkpoints[(checkpointStart + checkpointCount++) % checkpoints.size()] = {streamFrame, readSamples};
         }
 
-        if (anyReleased)
+        auto counter{sampleCounter.load(std::memory_order_relaxed)}, presented{counter};
+        for (; checkpointCount && checkpoints[checkpointStart].streamFrame <= presentedFrame; checkpointCount--) {
+            presented = checkpoints[checkpointStart].sampleCount;
+            checkpointStart = (checkpointStart + 1) % checkpoints.size();
+        }
+
+        if (presented > counter)
+            AdvanceSampleCounter(presented - counter);
+    }
+
+    void AudioTrack::AdvanceSampleCounter(size_t playedSamples) {
+        auto counter{sampleCounter.fetch_add(playedSamples, std::memory_order_acq_rel) + playedSamples};
+
+        // The threshold is cleared when it's reached so the callback is only called once per release, it's set again when the buffers are retrieved or more are appended
+        auto threshold{releaseThreshold.load(std::memory_order_acquire)};
+        if (counter >= threshold && releaseThreshold.compare_exchange_strong(threshold, NoPendingRelease, std::memory_order_acq_rel))
             releaseCallback();
     }
 }
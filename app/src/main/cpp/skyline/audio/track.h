@@ -8,32 +8,102 @@
 #include <kernel/types/KEvent.h>
 #include <common.h>
 #include "common.h"
+#include "resampler.h"
 
 namespace skyline::audio {
     /**
      * @brief The AudioTrack class manages the buffers for an audio stream
+     * @note The audio callback only reads samples and advances the sample counter, it never takes any locks so it can't be blocked by a guest thread queuing buffers
+     * @note Tracks can have any sample rate and up to as many channels as the output stream, they're converted to the format of the stream as they're read
      */
     class AudioTrack {
       private:
+        static constexpr u64 NoPendingRelease{std::numeric_limits<u64>::max()}; //!< The value of releaseThreshold when there's no buffer that needs to be reported as released
+        static constexpr size_t MaxQueuedBuffers{64}; //!< The maximum amount of buffers that can be queued on the track and not have been read by the audio callback yet
+        static constexpr size_t ConversionFrames{0x100}; //!< The maximum amount of frames that are converted to the format of the stream at a time
+
         std::function<void()> releaseCallback; //!< Callback called when a buffer has been played
+        std::mutex bufferLock; //!< This mutex guards the buffer identifiers and serializes appending samples, it's never locked by the audio callback
         std::deque<BufferIdentifier> identifiers; //!< Queue of all appended buffer identifiers
+        u64 appendedSamples{}; //!< The total amount of samples that have been appended to the track
+        std::atomic<u64> releaseThreshold{NoPendingRelease}; //!< The value of the sample counter at which the oldest buffer that hasn't been reported as released will have been played
+
+        /**
+         * @brief A buffer of samples queued on the track, it either refers to memory that's read in-place or to samples that were copied into the track's circular buffer
+         */
+        struct BufferDescriptor {
+            const i16 *data; //!< A pointer to the samples of the buffer or nullptr if they were copied into the circular buffer
+            size_t size; //!< The amount of samples in the buffer
+        };
+
+        CircularBuffer<i16, constant::SampleRate * constant::ChannelCount * 10> samples; //!< A circular buffer with all appended audio samples that had to be copied
+        std::array<BufferDescriptor, MaxQueuedBuffers> descriptors; //!< A wait-free single-producer single-consumer circular queue of buffers in the order they're played in
+        alignas(64) std::atomic<size_t> descriptorRead{}; //!< The total amount of descriptors that have been fully read, this is only written to by the audio callback
+        alignas(64) std::atomic<size_t> descriptorWrite{}; //!< The total amount of descriptors that have been queued, this is only written to with bufferLock held
+        size_t descriptorOffset{}; //!< The amount of samples of the oldest descriptor that have already been read, this is only accessed by the audio callback
+
+        /**
+         * @brief A point in the track's samples and the position of the stream after them, they're presented once the stream's presented position reaches it
+         */
+        struct PresentationCheckpoint {
+            u64 streamFrame; //!< The position of the stream after the samples were written to it
+            u64 sampleCount; //!< The total amount of samples read from the track at that point
+        };
+
+        // These are only accessed by the audio callback
+        std::array<PresentationCheckpoint, 64> checkpoints; //!< A circular queue of the checkpoints of samples that have been written to the stream but not presented yet
+        size_t checkpointStart{}; //!< The index of the oldest checkpoint
+        size_t checkpointCount{}; //!< The amount of checkpoints in the queue
+        u64 readSamples{}; //!< The total amount of samples read from the track by the audio callback
+
+        // These are only accessed by the audio callback, they're used to convert tracks that don't match the format of the stream
+        Resampler resampler; //!< The resampler used to convert the sample rate and channel count of the track to those of the stream
+        std::array<i16, (ConversionFrames + Resampler::MaxTapCount) * constant::ChannelCount> conversionInput{}; //!< The samples of the track that haven't been fully consumed by the resampler yet
+        size_t conversionInputSize{}; //!< The amount of samples in the conversion input
+        size_t conversionSkip{}; //!< The amount of samples the resampler has skipped past the end of the conversion input, these are dropped from the next samples read
+        std::array<i16, ConversionFrames * constant::ChannelCount> conversionOutput; //!< The converted samples before they're mixed into the stream
 
         u8 channelCount;
         u32 sampleRate;
 
+        /**
+         * @return If a buffer has been fully played back
+         */
+        inline bool IsReleased(const BufferIdentifier &identifier) {
+            return identifier.finalSample <= sampleCounter.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Sets the release threshold to the final sample of the oldest buffer that hasn't been released yet
+         * @note bufferLock MUST be locked when calling this
+         */
+        void UpdateReleaseThreshold();
+
+        /**
+         * @brief Queues a descriptor for a buffer and its identifier, a buffer that doesn't fit into the queue is dropped and released as soon as possible
+         * @note bufferLock MUST be locked when calling this
+         */
+        void QueueBuffer(u64 tag, const i16 *data, size_t size);
+
+        /**
+         * @brief Reads samples from the queued buffers as they are, without converting them to the format of the stream
+         * @param mixSamples The amount of samples at the start of the destination which are mixed with rather than overwritten
+         * @return The amount of samples that were read
+         */
+        size_t ReadSamples(i16 *destination, size_t maxSamples, size_t mixSamples);
+
       public:
-        CircularBuffer<i16, constant::SampleRate * constant::ChannelCount * 10> samples; //!< A circular buffer with all appended audio samples
-        Mutex bufferLock; //!< This mutex ensures that appending to buffers doesn't overlap
 
-        AudioOutState playbackState{AudioOutState::Stopped}; //!< The current state of playback
-        u64 sampleCounter{}; //!< A counter used for tracking when buffers have been played and can be released
+        std::atomic<AudioOutState> playbackState{AudioOutState::Stopped}; //!< The current state of playback
+        std::atomic<u64> sampleCounter{}; //!< A counter of all samples presented by the output device used for tracking when buffers have been played and can be released, this is only written to by the audio callback
 
         /**
          * @param channelCount The amount channels that will be present in the track
          * @param sampleRate The sample rate to use for the track
          * @param releaseCallback A callback to call when a buffer has been played
+         * @param sincResampling If the windowed-sinc filter should be used when converting the sample rate of the track
          */
-        AudioTrack(u8 channelCount, u32 sampleRate, const std::function<void()> &releaseCallback);
+        AudioTrack(u8 channelCount, u32 sampleRate, const std::function<void()> &releaseCallback, bool sincResampling = false);
 
         /**
          * @brief Starts audio playback using data from appended buffers
@@ -62,16 +132,43 @@ namespace skyline::audio {
         std::vector<u64> GetReleasedBuffers(u32 max);
 
         /**
-         * @brief Appends audio samples to the output buffer
+         * @brief Appends audio samples to the output buffer, they're copied into the track so the source can be reused immediately
          * @param tag The tag of the buffer
          * @param buffer A span containing the source sample buffer
          */
         void AppendBuffer(u64 tag, std::span<i16> buffer = {});
 
         /**
-         * @brief Checks if any buffers have been released and calls the appropriate callback for them
-         * @note bufferLock MUST be locked when calling this
+         * @brief Appends a buffer of audio samples that's read in-place by the audio callback rather than being copied
+         * @param tag The tag of the buffer
+         * @param buffer A span containing the sample buffer, it must stay valid and unmodified until the buffer has been released or the track is closed
+         */
+        void AppendBufferInPlace(u64 tag, std::span<const i16> buffer);
+
+        /**
+         * @brief Reads samples from the queued buffers into the stream's buffer, they're resampled and upmixed if the format of the track doesn't match that of the stream
+         * @param destination The buffer to write the samples into
+         * @param maxSamples The maximum amount of samples to write
+         * @param mixSamples The amount of samples at the start of the destination which hold samples of other tracks and are mixed with rather than overwritten
+         * @param outputRate The sample rate of the stream
+         * @param outputChannels The amount of channels in the stream
+         * @return The amount of samples that were written
+         * @note This is only called by the audio callback, it doesn't take any locks
+         */
+        size_t Read(i16 *destination, size_t maxSamples, size_t mixSamples, u32 outputRate, u8 outputChannels);
+
+        /**
+         * @brief Advances the sample counter by the amount of samples that were played and calls the release callback if any buffers have been fully played
+         * @note This is only called by the audio callback, it doesn't take any locks
+         */
+        void AdvanceSampleCounter(size_t playedSamples);
+
+        /**
+         * @brief Records the samples read from the track by the audio callback and advances the sample counter to the samples that have been presented by the output device
+         * @param streamFrame The position of the stream after the frames the callback has written
+         * @param presentedFrame The position of the stream that has been presented by the output device
+         * @note This is only called by the audio callback, it doesn't take any locks
          */
-        void CheckReleasedBuffers();
+        void UpdatePresentation(u64 streamFrame, u64 presentedFrame);
     };
 }
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <fstream>
+#include "boot_report.h"
+
+namespace skyline::boot {
+    BootReport Report;
+
+    void BootReport::Start() {
+        for (auto &time : times)
+            time.store(0, std::memory_order_relaxed);
+        for (auto &count : counts)
+            count.store(0, std::memory_order_relaxed);
+        firstFrameTime.store(0, std::memory_order_relaxed);
+        emitted.store(false, std::memory_order_relaxed);
+        startTimestamp = util::GetTimeNs();
+    }
+
+    bool BootReport::OnQueueBuffer() {
+        if (firstFrameTime.load(std::memory_order_relaxed))
+            return false;
+
+        u64 expected{};
+        return firstFrameTime.compare_exchange_strong(expected, std::max<u64>(util::GetTimeNs() - startTimestamp, 1), std::memory_order_relaxed);
+    }
+
+    std::string BootReport::Format() {
+        constexpr std::array<std::string_view, static_cast<size_t>(Phase::Count)> PhaseNames{
+            "key_store",
+            "nca_header",
+            "filesystem_mount",
+            "nso_decompress",
+            "patch_code",
+            "memory_mapping",
+            "service_prewarm",
+            "shader_cache",
+        };
+
+        auto toMs{[](u64 time) { return static_cast<double>(time) / constant::NsInMillisecond; }};
+
+        std::string output{"{\"phases\": {"};
+        for (size_t phase{}; phase < PhaseNames.size(); phase++)
+            fmt::format_to(std::back_inserter(output), "{}\"{}\": {{\"time_ms\": {:.3f}, \"count\": {}}}", phase ? ", " : "", PhaseNames[phase], toMs(times[phase].load(std::memory_order_relaxed)), counts[phase].load(std::memory_order_relaxed));
+
+        auto firstFrame{firstFrameTime.load(std::memory_order_relaxed)};
+        if (firstFrame)
+            fmt::format_to(std::back_inserter(output), "}}, \"first_queue_buffer_ms\": {:.3f}}}", toMs(firstFrame));
+        else
+            output += "}, \"first_queue_buffer_ms\": null}";
+        return output;
+    }
+
+    void BootReport::Emit(Logger &logger, const std::string &directory) {
+        if (emitted.exchange(true, std::memory_order_relaxed))
+            return;
+
+        auto report{Format()};
+        logger.Info("Boot report: {}", report);
+
+        std::ofstream file(directory + "boot_report.json", std::ios::trunc);
+        file << report << '\n';
+    }
+}
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "common.h"
+
+namespace skyline::boot {
+    /**
+     * @brief The phases of booting a title that are timed
+     * @note Some phases run concurrently with others (such as services being pre-warmed while executables are patched), so the times of all phases can add up to more than the total boot time
+     */
+    enum class Phase : u8 {
+        KeyStore, //!< Parsing the key files
+        NcaHeader, //!< Reading and decrypting NCA headers
+        FilesystemMount, //!< Parsing the metadata of PFS0 and RomFS filesystems
+        NsoDecompress, //!< Reading and decompressing the segments of executables
+        PatchCode, //!< Patching SVCs and system register accesses in executables
+        MemoryMapping, //!< Setting up the guest address space and mapping the memory of the process
+        ServicePrewarm, //!< Constructing the services that are pre-warmed
+        ShaderCache, //!< Loading the shader cache of the title
+        Count,
+    };
+
+    /**
+     * @brief The BootReport class accumulates the time spent in every phase of booting a title till its first frame is queued
+     */
+    class BootReport {
+      private:
+        std::array<std::atomic<u64>, static_cast<size_t>(Phase::Count)> times{}; //!< The total time spent in every phase in nanoseconds
+        std::array<std::atomic<u32>, static_cast<size_t>(Phase::Count)> counts{}; //!< The amount of times every phase was entered
+        u64 startTimestamp{}; //!< The time at which booting started in nanoseconds
+        std::atomic<u64> firstFrameTime{}; //!< The time from booting starting to the first QueueBuffer in nanoseconds, this is 0 till it occurs
+        std::atomic<bool> emitted{}; //!< If the report has been emitted already
+
+      public:
+        /**
+         * @brief Resets the report and starts timing a boot
+         */
+        void Start();
+
+        void AddTime(Phase phase, u64 time) {
+            times[static_cast<size_t>(phase)].fetch_add(time, std::memory_order_relaxed);
+            counts[static_cast<size_t>(phase)].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Records the first time a frame is queued by the guest, this marks the end of booting
+         * @return If this was the first frame to be queued, the report should be emitted when this is true
+         */
+        bool OnQueueBuffer();
+
+        /**
+         * @return The time from booting starting to the first QueueBuffer in nanoseconds, this is 0 if it hasn't occurred
+         */
+        u64 GetFirstFrameTime() {
+            return firstFrameTime.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @return The report as a JSON object with the time and count of every phase along with the time to the first frame in milliseconds
+         */
+        std::string Format();
+
+        /**
+         * @brief Writes the report to the log and into boot_report.json in the supplied directory, this only does anything the first time it's called after Start
+         */
+        void Emit(Logger &logger, const std::string &directory);
+    };
+
+    extern BootReport Report; //!< The boot report of the current emulation session, this is a global as the loaders have no access to the device state
+
+    /**
+     * @brief Adds the time from construction to destruction of this object to a phase of the boot report
+     */
+    class ScopedPhase {
+      private:
+        Phase phase;
+        u64 start;
+
+      public:
+        ScopedPhase(Phase phase) : phase(phase), start(util::GetTimeNs()) {}
+
+        ~ScopedPhase() {
+            Report.AddTime(phase, util::GetTimeNs() - start);
+        }
+    };
+}
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "cache_registry.h"
+
+namespace skyline::cache {
+    CacheRegistry Registry;
+
+    size_t CacheRegistry::Evict(size_t target, Priority maxPriority) {
+        size_t freed{};
+        for (auto &cache : caches) {
+            if (freed >= target || cache.priority > maxPriority)
+                break;
+            freed += cache.evict(target - freed);
+        }
+        return freed;
+    }
+
+    CacheRegistry::Handle CacheRegistry::Register(std::string_view name, Priority priority, SizeCallback size, EvictCallback evict) {
+        std::lock_guard guard(mutex);
+        auto position{std::find_if(caches.begin(), caches.end(), [priority](const Cache &cache) { return cache.priority > priority; })};
+        return caches.insert(position, Cache{name, priority, std::move(size), std::move(evict)});
+    }
+
+    void CacheRegistry::Unregister(Handle handle) {
+        std::lock_guard guard(mutex);
+        caches.erase(handle);
+    }
+
+    size_t CacheRegistry::GetSize() {
+        std::lock_guard guard(mutex);
+        size_t size{};
+        for (auto &cache : caches)
+            size += cache.size();
+        return size;
+    }
+
+    void CacheRegistry::EnforceBudget(size_t budget) {
+        if (!budget)
+            return;
+
+        std::lock_guard guard(mutex);
+        auto now{util::GetTimeNs()};
+        if (now - enforcementTimestamp < constant::EnforcementInterval)
+            return;
+        enforcementTimestamp = now;
+
+        size_t size{};
+        for (auto &cache : caches)
+            size += cache.size();
+        if (size > budget)
+            Evict(size - budget, Priority::High);
+    }
+
+    size_t CacheRegistry::Trim(i32 level) {
+        Priority maxPriority{Priority::Low};
+        if (level != constant::TrimMemoryUiHidden) {
+            if (level >= constant::TrimMemoryRunningCritical)
+                maxPriority = Priority::High;
+            else if (level >= constant::TrimMemoryRunningLow)
+                maxPriority = Priority::Medium;
+        }
+
+        std::lock_guard guard(mutex);
+        return Evict(std::numeric_limits<size_t>::max(), maxPriority);
+    }
+}
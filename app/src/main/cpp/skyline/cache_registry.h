@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <list>
+#include "common.h"
+
+namespace skyline::cache {
+    namespace constant {
+        constexpr u64 EnforcementInterval{1'000'000'000}; //!< The minimum interval between the budget being enforced in nanoseconds
+        constexpr i32 TrimMemoryRunningLow{10}; //!< ComponentCallbacks2.TRIM_MEMORY_RUNNING_LOW
+        constexpr i32 TrimMemoryRunningCritical{15}; //!< ComponentCallbacks2.TRIM_MEMORY_RUNNING_CRITICAL
+        constexpr i32 TrimMemoryUiHidden{20}; //!< ComponentCallbacks2.TRIM_MEMORY_UI_HIDDEN, this isn't a sign of memory pressure by itself
+    }
+
+    /**
+     * @brief The priority of a cache determines the order in which caches are evicted, caches that are cheaper to repopulate should have a lower priority
+     */
+    enum class Priority : u8 {
+        Low, //!< The contents can be recreated cheaply, these are evicted first
+        Medium,
+        High, //!< Recreating the contents causes stutter, these are only evicted under severe memory pressure
+    };
+
+    /**
+     * @brief The CacheRegistry class holds every cache that can release memory on demand, it evicts them in order of priority when memory is low or their total size exceeds a budget
+     * @note Eviction callbacks are invoked with the registry locked, so they must not register or unregister caches
+     */
+    class CacheRegistry {
+      public:
+        using SizeCallback = std::function<size_t()>; //!< Returns the amount of memory held by a cache in bytes
+        using EvictCallback = std::function<size_t(size_t)>; //!< Evicts at least the supplied amount of bytes from a cache if it can and returns the amount that was evicted
+
+      private:
+        struct Cache {
+            std::string_view name;
+            Priority priority;
+            SizeCallback size;
+            EvictCallback evict;
+        };
+
+        std::mutex mutex; //!< This mutex guards all members
+        std::list<Cache> caches; //!< The registered caches sorted by their priority, caches with the same priority are in the order they were registered
+        u64 enforcementTimestamp{}; //!< The time at which the budget was last enforced
+
+        /**
+         * @brief Evicts caches in order of priority till the supplied amount of memory has been freed, the mutex must be locked when calling this
+         * @param maxPriority The highest priority of caches that are evicted
+         * @return The amount of memory freed in bytes
+         */
+        size_t Evict(size_t target, Priority maxPriority);
+
+      public:
+        using Handle = std::list<Cache>::iterator;
+
+        Handle Register(std::string_view name, Priority priority, SizeCallback size, EvictCallback evict);
+
+        void Unregister(Handle handle);
+
+        /**
+         * @return The total amount of memory held by all registered caches in bytes
+         */
+        size_t GetSize();
+
+        /**
+         * @brief Evicts caches till their total size is within the budget, this is rate-limited to EnforcementInterval so it can be called on every frame
+         * @param budget The maximum amount of memory all caches can hold in bytes, caches can grow unbounded if this is 0
+         */
+        void EnforceBudget(size_t budget);
+
+        /**
+         * @brief Evicts caches in response to a low-memory signal from Android
+         * @param level The level of memory pressure supplied to onTrimMemory, higher levels evict caches of a higher priority
+         * @return The amount of memory freed in bytes
+         */
+        size_t Trim(i32 level);
+    };
+
+    extern CacheRegistry Registry; //!< The registry of all caches in the emulator, this is a global as caches such as those in the VFS have no access to the device state
+
+    /**
+     * @brief A registration of a cache in the registry for the lifetime of this object, it should be declared last in the cache so it's unregistered before anything the callbacks use is destroyed
+     */
+    class Registration {
+      private:
+        CacheRegistry::Handle handle;
+
+      public:
+        Registration(std::string_view name, Priority priority, CacheRegistry::SizeCallback size, CacheRegistry::EvictCallback evict) : handle(Registry.Register(name, priority, std::move(size), std::move(evict))) {}
+
+        Registration(const Registration &) = delete;
+
+        Registration &operator=(const Registration &) = delete;
+
+        ~Registration() {
+            Registry.Unregister(handle);
+        }
+    };
+}
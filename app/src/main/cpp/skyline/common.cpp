@@ -1,90 +1,147 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <unistd.h>
+#include <linux/futex.h>
+#include <asm/unistd.h>
 #include <tinyxml2.h>
 #include "common.h"
 #include "nce.h"
 #include "gpu.h"
 #include "audio.h"
 #include "input.h"
+#include "profiler.h"
 #include "kernel/types/KThread.h"
 
 namespace skyline {
-    void Mutex::lock() {
-        while (true) {
-            for (int i = 0; i < 1000; ++i) {
-                if (!flag.test_and_set(std::memory_order_acquire))
-                    return;
+    void Mutex::LockContended() {
+        ContendedCount.fetch_add(1, std::memory_order_relaxed);
 
+        // The owner usually releases the mutex shortly, so it's polled with an increasing delay prior to parking which would cost two syscalls
+        for (u32 backoff{1}; backoff <= constant::MutexBackoffLimit; backoff <<= 1) {
+            for (u32 i{}; i < backoff; i++)
                 asm volatile("yield");
-            }
-            sched_yield();
+
+            u32 unlocked{};
+            if (state.load(std::memory_order_relaxed) == 0 && state.compare_exchange_weak(unlocked, 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+        }
+
+        // The state is set to 2 whenever a thread acquires it after parking as there might be other parked threads, which costs at most a spurious wake
+        while (state.exchange(2, std::memory_order_acquire) != 0) {
+            ParkCount.fetch_add(1, std::memory_order_relaxed);
+            syscall(__NR_futex, &state, FUTEX_WAIT_PRIVATE, 2, nullptr);
         }
     }
 
-    void GroupMutex::lock(Group group) {
-        auto none = Group::None;
-        constexpr u64 timeout = 100; // The timeout in ns
-        auto end = util::GetTimeNs() + timeout;
+    void Mutex::unlock() {
+        if (state.exchange(0, std::memory_order_release) == 2)
+            syscall(__NR_futex, &state, FUTEX_WAKE_PRIVATE, 1);
+    }
 
+    void SharedMutex::LockSharedContended() {
         while (true) {
-            if (next == group) {
-                if (flag == group) {
-                    std::lock_guard lock(mtx);
-
-                    if (flag == group) {
-                        auto groupT = group;
-                        next.compare_exchange_strong(groupT, Group::None);
-                        num++;
-
-                        return;
-                    }
-                } else {
-                    flag.compare_exchange_weak(none, group);
-                }
-            } else if (flag == group && (next == Group::None || util::GetTimeNs() >= end)) {
-                std::lock_guard lock(mtx);
+            auto current{state.load(std::memory_order_relaxed)};
+            if (current & (ExclusiveOwner | ExclusiveWaiter)) {
+                syscall(__NR_futex, &state, FUTEX_WAIT_PRIVATE, current, nullptr);
+                continue;
+            }
+
+            if (state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+        }
+    }
 
-                if (flag == group) {
-                    num++;
+    void SharedMutex::lock() {
+        while (true) {
+            auto current{state.load(std::memory_order_relaxed)};
+            if (!(current & (SharedMask | ExclusiveOwner))) {
+                // Any other waiting exclusive owner re-marks itself after being woken by the unlock, so the waiter bit doesn't have to be preserved
+                if (state.compare_exchange_weak(current, ExclusiveOwner, std::memory_order_acquire, std::memory_order_relaxed))
                     return;
-                }
-            } else {
-                next.compare_exchange_weak(none, group);
+                continue;
             }
 
-            none = Group::None;
-            asm volatile("yield");
+            if (!(current & ExclusiveWaiter) && !state.compare_exchange_weak(current, current | ExclusiveWaiter, std::memory_order_relaxed))
+                continue;
+            syscall(__NR_futex, &state, FUTEX_WAIT_PRIVATE, current | ExclusiveWaiter, nullptr);
         }
     }
 
-    void GroupMutex::unlock() {
-        std::lock_guard lock(mtx);
+    void SharedMutex::unlock() {
+        state.store(0, std::memory_order_release);
+        Wake(); // Exclusive ownership is rare enough that waking everything unconditionally isn't worth tracking shared waiters for
+    }
 
-        if (!--num)
-            flag.exchange(next);
+    void SharedMutex::Wake() {
+        syscall(__NR_futex, &state, FUTEX_WAKE_PRIVATE, INT32_MAX);
     }
 
-    Settings::Settings(int fd) {
-        tinyxml2::XMLDocument pref;
+    namespace {
+        /**
+         * @brief The raw values of all preferences in the XML by their type
+         */
+        struct Preferences {
+            std::unordered_map<std::string, std::string> strings;
+            std::unordered_map<std::string, bool> bools;
+            std::unordered_map<std::string, int> ints;
+        };
+
+        void ParseValue(const Preferences &preferences, const char *key, bool &value) {
+            if (auto it{preferences.bools.find(key)}; it != preferences.bools.end())
+                value = it->second;
+        }
+
+        void ParseValue(const Preferences &preferences, const char *key, std::string &value) {
+            if (auto it{preferences.strings.find(key)}; it != preferences.strings.end())
+                value = it->second;
+        }
+
+        /**
+         * @note ListPreference stores its values as strings, so integer settings are parsed from strings when they aren't stored as integers
+         */
+        template<typename Type> requires std::is_integral_v<Type>
+        void ParseValue(const Preferences &preferences, const char *key, Type &value) {
+            if (auto it{preferences.ints.find(key)}; it != preferences.ints.end()) {
+                value = static_cast<Type>(it->second);
+            } else if (auto it{preferences.strings.find(key)}; it != preferences.strings.end()) {
+                try {
+                    value = static_cast<Type>(std::stoll(it->second));
+                } catch (const std::exception &) {
+                    syslog(LOG_ALERT, "Setting %s has an invalid integer value: %s", key, it->second.c_str());
+                }
+            }
+        }
+    }
 
-        if (pref.LoadFile(fdopen(fd, "r")))
+    std::unique_ptr<const Settings::Values> Settings::Parse(int fd) {
+        // The FD is duplicated so the original is left open for any later updates
+        auto file{fdopen(dup(fd), "r")};
+        if (!file)
+            throw exception("Cannot open the preference XML: {}", strerror(errno));
+        std::rewind(file);
+
+        tinyxml2::XMLDocument pref;
+        auto error{pref.LoadFile(file)};
+        std::fclose(file);
+        if (error)
             throw exception("TinyXML2 Error: " + std::string(pref.ErrorStr()));
 
+        Preferences preferences;
         tinyxml2::XMLElement *elem = pref.LastChild()->FirstChild()->ToElement();
 
         while (elem) {
             switch (elem->Value()[0]) {
                 case 's':
-                    stringMap[elem->FindAttribute("name")->Value()] = elem->GetText();
+                    preferences.strings[elem->FindAttribute("name")->Value()] = elem->GetText() ? elem->GetText() : "";
                     break;
 
                 case 'b':
-                    boolMap[elem->FindAttribute("name")->Value()] = elem->FindAttribute("value")->BoolValue();
+                    preferences.bools[elem->FindAttribute("name")->Value()] = elem->FindAttribute("value")->BoolValue();
                     break;
 
                 case 'i':
-                    intMap[elem->FindAttribute("name")->Value()] = elem->FindAttribute("value")->IntValue();
+                    preferences.ints[elem->FindAttribute("name")->Value()] = elem->FindAttribute("value")->IntValue();
                     break;
 
                 default:
@@ -98,59 +155,308 @@ namespace skyline {
                 break;
         }
 
-        pref.Clear();
+        auto values{std::make_unique<Values>()};
+        #define SETTING(type, name, key, defaultValue) ParseValue(preferences, key, values->name);
+        SKYLINE_SETTINGS(SETTING)
+        #undef SETTING
+        return values;
+    }
+
+    Settings::Settings(int fd) {
+        snapshots.push_back(Parse(fd));
+        current.store(snapshots.back().get(), std::memory_order_release);
     }
 
-    std::string Settings::GetString(const std::string &key) {
-        return stringMap.at(key);
+    void Settings::Update(int fd) {
+        auto values{Parse(fd)};
+
+        std::lock_guard guard(updateMutex);
+        current.store(values.get(), std::memory_order_release);
+        snapshots.push_back(std::move(values));
+
+        for (const auto &[id, callback] : callbacks)
+            callback(*snapshots.back());
     }
 
-    bool Settings::GetBool(const std::string &key) {
-        return boolMap.at(key);
+    size_t Settings::AddCallback(std::function<void(const Values &)> callback) {
+        std::lock_guard guard(updateMutex);
+        callbacks.emplace(nextCallback, std::move(callback));
+        return nextCallback++;
     }
 
-    int Settings::GetInt(const std::string &key) {
-        return intMap.at(key);
+    void Settings::RemoveCallback(size_t id) {
+        std::lock_guard guard(updateMutex);
+        callbacks.erase(id);
     }
 
     void Settings::List(const std::shared_ptr<Logger> &logger) {
-        for (auto &iter : stringMap)
-            logger->Info("Key: {}, Value: {}, Type: String", iter.first, GetString(iter.first));
-
-        for (auto &iter : boolMap)
-            logger->Info("Key: {}, Value: {}, Type: Bool", iter.first, GetBool(iter.first));
+        const auto &values{Get()};
+        #define SETTING(type, name, key, defaultValue) logger->Info("Key: {}, Value: {}", key, values.name);
+        SKYLINE_SETTINGS(SETTING)
+        #undef SETTING
     }
 
-    Logger::Logger(const std::string &path, LogLevel configLevel) : configLevel(configLevel) {
+    /**
+     * @brief A single-producer single-consumer queue of serialized log records, every thread has its own queue so threads never contend with each other while logging
+     */
+    struct Logger::LogQueue {
+        static constexpr size_t Size{0x20000}; //!< The size of the queue in bytes
+        static constexpr size_t MaxRecordSize{Size / 4}; //!< The maximum size of a single record, longer logs are truncated to this
+
+        alignas(RecordHeader) std::array<u8, Size> buffer; //!< The buffer holding the records, a record never wraps around the end of it
+        alignas(64) std::atomic<size_t> readPosition{}; //!< The total amount of bytes that have been read from the queue, this is only written to by the writer thread
+        alignas(64) std::atomic<size_t> writePosition{}; //!< The total amount of bytes that have been written to the queue, this is only written to by the owning thread
+        std::atomic<u64> droppedRecords{}; //!< The amount of records that were dropped due to the queue being full since the writer thread last reported it
+        std::atomic<bool> abandoned{}; //!< If the owning thread has exited, the queue is removed after it's been drained
+
+        /**
+         * @brief Writes a record into the queue if there's enough space for it
+         * @param halfFull This is set to true if the queue became at least half full with this record
+         * @return If the record was written
+         */
+        bool Push(const RecordHeader &header, const void *data, size_t size, bool &halfFull) {
+            auto write{writePosition.load(std::memory_order_relaxed)};
+            auto offset{write % Size};
+            auto padding{Size - offset < header.size ? Size - offset : 0}; // The remaining space at the end of the buffer is skipped if the record doesn't fit into it
+            auto used{write - readPosition.load(std::memory_order_acquire)};
+            if (Size - used < header.size + padding)
+                return false;
+            halfFull = used < Size / 2 && used + header.size + padding >= Size / 2;
+
+            if (padding) {
+                buffer[offset] = static_cast<u8>(RecordType::Padding);
+                write += padding;
+                offset = 0;
+            }
+
+            std::memcpy(buffer.data() + offset, &header, sizeof(RecordHeader));
+            std::memcpy(buffer.data() + offset + sizeof(RecordHeader), data, size);
+            writePosition.store(write + header.size, std::memory_order_release);
+            return true;
+        }
+    };
+
+    /**
+     * @brief A record that has been read out of a queue by the writer thread
+     */
+    struct DrainedRecord {
+        u64 timestamp;
+        bool header;
+        Logger::LogLevel level;
+        std::string text;
+    };
+
+    static std::atomic<u64> nextLoggerId{}; //!< The identifier of the next logger that is created
+
+    Logger::Logger(const std::string &path, LogLevel configLevel) : configLevel(configLevel), id(nextLoggerId++) {
         logFile.open(path, std::ios::app);
+        writerThread = std::thread(&Logger::WriterThread, this);
         WriteHeader("Logging started");
     }
 
     Logger::~Logger() {
+        #ifdef SKYLINE_TRACE
+        trace::Dump(*this);
+        #endif
         WriteHeader("Logging ended");
+
+        {
+            std::lock_guard guard(queueMutex);
+            halt = true;
+        }
+        writerCondition.notify_all();
+        writerThread.join();
         logFile.flush();
     }
 
+    Logger::LogQueue &Logger::GetQueue() {
+        /**
+         * @brief The queue of the current thread, the logger holds a reference to it as well so the queue can be safely drained after the thread has exited
+         */
+        struct ThreadQueue {
+            u64 loggerId{}; //!< The identifier of the logger that the queue belongs to
+            std::shared_ptr<LogQueue> queue;
+
+            ~ThreadQueue() {
+                if (queue)
+                    queue->abandoned.store(true, std::memory_order_release);
+            }
+        };
+        thread_local ThreadQueue threadQueue;
+
+        if (!threadQueue.queue || threadQueue.loggerId != id) {
+            if (threadQueue.queue)
+                threadQueue.queue->abandoned.store(true, std::memory_order_release);
+
+            threadQueue.queue = std::make_shared<LogQueue>();
+            threadQueue.loggerId = id;
+
+            std::lock_guard guard(queueMutex);
+            queues.push_back(threadQueue.queue);
+        }
+
+        return *threadQueue.queue;
+    }
+
+    void Logger::Enqueue(RecordType type, LogLevel level, const void *data, size_t size, Formatter formatter, const char *format) {
+        size = std::min(size, LogQueue::MaxRecordSize - sizeof(RecordHeader));
+        RecordHeader header{
+            .type = type,
+            .level = level,
+            .size = static_cast<u32>(util::AlignUp(sizeof(RecordHeader) + size, alignof(RecordHeader))),
+            .dataSize = static_cast<u32>(size),
+            .timestamp = util::GetTimeNs(),
+            .formatter = formatter,
+            .format = format,
+        };
+
+        auto &queue{GetQueue()};
+        bool halfFull{};
+        while (!queue.Push(header, data, size, halfFull)) {
+            if (type == RecordType::Binary || (type != RecordType::Header && level > LogLevel::Warn)) {
+                queue.droppedRecords.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            writerCondition.notify_one();
+            std::this_thread::yield();
+        }
+
+        // The writer thread is woken up early rather than waiting for the drain interval when a queue is filling up quickly, this only happens once every time the queue fills up
+        if (halfFull)
+            writerCondition.notify_one();
+    }
+
     void Logger::WriteHeader(const std::string &str) {
-        syslog(LOG_ALERT, "%s", str.c_str());
+        Enqueue(RecordType::Header, LogLevel::Info, str.data(), str.size());
+    }
+
+    void Logger::Write(LogLevel level, const std::string &str) {
+        Enqueue(RecordType::Message, level, str.data(), str.size());
+    }
+
+    void Logger::WriteBinary(LogLevel level, Formatter formatter, std::span<const u8> data, const char *format) {
+        Enqueue(RecordType::Binary, level, data.data(), data.size(), formatter, format);
+    }
+
+    void Logger::WriterThread() {
+        constexpr auto DrainInterval{std::chrono::milliseconds(10)}; //!< The interval at which the queues are drained, this bounds how far the log file can lag behind
+
+        std::unique_lock lock(queueMutex);
+        while (!halt) {
+            lock.unlock();
+            Flush();
+            lock.lock();
+            writerCondition.wait_for(lock, DrainInterval, [this] { return halt; });
+        }
+        lock.unlock();
+
+        Flush();
+    }
+
+    void Logger::Flush(bool wait) {
+        std::unique_lock lock(drainMutex, std::defer_lock);
+        if (wait)
+            lock.lock();
+        else if (!lock.try_lock())
+            return;
+
+        Drain();
+    }
+
+    void Logger::Drain() {
+        std::vector<std::shared_ptr<LogQueue>> drainQueues;
+        {
+            std::lock_guard guard(queueMutex);
+            drainQueues = queues;
+        }
+
+        std::vector<DrainedRecord> records;
+        for (auto &queue : drainQueues) {
+            // A queue is checked for abandonment before it's read, this ensures anything its thread wrote before exiting is drained before it's removed
+            bool abandoned{queue->abandoned.load(std::memory_order_acquire)};
+
+            auto read{queue->readPosition.load(std::memory_order_relaxed)};
+            auto write{queue->writePosition.load(std::memory_order_acquire)};
+            while (read != write) {
+                auto offset{read % LogQueue::Size};
+                if (static_cast<RecordType>(queue->buffer[offset]) == RecordType::Padding) {
+                    read += LogQueue::Size - offset;
+                    continue;
+                }
+
+                auto &header{*reinterpret_cast<const RecordHeader *>(queue->buffer.data() + offset)};
+
+                auto data{queue->buffer.data() + offset + sizeof(RecordHeader)};
+                auto &record{records.emplace_back(DrainedRecord{header.timestamp, header.type == RecordType::Header, header.level})};
+                if (header.type == RecordType::Deferred || header.type == RecordType::Binary)
+                    record.text = header.formatter(header.format, data, header.dataSize);
+                else
+                    record.text.assign(reinterpret_cast<const char *>(data), header.dataSize);
+
+                read += header.size;
+            }
+            queue->readPosition.store(read, std::memory_order_release);
+
+            if (auto dropped{queue->droppedRecords.exchange(0, std::memory_order_relaxed)})
+                records.push_back(DrainedRecord{records.empty() ? util::GetTimeNs() : records.back().timestamp, false, LogLevel::Warn, fmt::format("Dropped {} logs as the logging queue of a thread was full", dropped)});
+
+            if (abandoned) {
+                std::lock_guard guard(queueMutex);
+                std::erase(queues, queue);
+            }
+        }
+
+        if (records.empty())
+            return;
 
-        std::lock_guard guard(mtx);
-        logFile << "0|" << str << "\n";
+        std::stable_sort(records.begin(), records.end(), [](const DrainedRecord &a, const DrainedRecord &b) {
+            return a.timestamp < b.timestamp;
+        });
+
+        for (auto &record : records) {
+            if (record.header) {
+                syslog(LOG_ALERT, "%s", record.text.c_str());
+                logFile << "0|" << record.text << "\n";
+            } else {
+                syslog(levelSyslog[static_cast<u8>(record.level)], "%s", record.text.c_str());
+
+                for (auto &character : record.text)
+                    if (character == '\n')
+                        character = '\\';
+
+                logFile << "1|" << levelStr[static_cast<u8>(record.level)] << "|" << record.text << "\n";
+            }
+        }
+        logFile.flush();
     }
 
-    void Logger::Write(LogLevel level, std::string str) {
-        syslog(levelSyslog[static_cast<u8>(level)], "%s", str.c_str());
+    namespace trace {
+        std::array<Record, RecordCount> records{};
+        std::atomic<u64> recordIndex{};
+
+        void Dump(Logger &logger) {
+            auto end{recordIndex.load(std::memory_order_acquire)};
+            for (auto index{end > RecordCount ? end - RecordCount : 0}; index < end; index++) {
+                auto &record{records[index % RecordCount]};
+                if (record.sequence.load(std::memory_order_acquire) != index + 1)
+                    continue;
+
+                auto format{record.format};
+                auto timestamp{record.timestamp};
+                auto arguments{record.arguments};
 
-        for (auto &character : str)
-            if (character == '\n')
-                character = '\\';
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (record.sequence.load(std::memory_order_relaxed) != index + 1)
+                    continue;
 
-        std::lock_guard guard(mtx);
-        logFile << "1|" << levelStr[static_cast<u8>(level)] << "|" << str << "\n";
+                // Any arguments that the format string doesn't use are ignored by libfmt
+                logger.Write(Logger::LogLevel::Debug, fmt::format("Trace [{}]: ", timestamp) + fmt::format(format, arguments[0], arguments[1], arguments[2], arguments[3]));
+            }
+        }
     }
 
     DeviceState::DeviceState(kernel::OS *os, std::shared_ptr<kernel::type::KProcess> &process, std::shared_ptr<JvmManager> jvmManager, std::shared_ptr<Settings> settings, std::shared_ptr<Logger> logger)
-        : os(os), jvm(std::move(jvmManager)), settings(std::move(settings)), logger(std::move(logger)), process(process) {
+        : os(os), jvm(std::move(jvmManager)), settings(std::move(settings)), logger(std::move(logger)), process(process), profiler(std::make_shared<CallProfiler>()) {
         // We assign these later as they use the state in their constructor and we don't want null pointers
         nce = std::make_shared<NCE>(*this);
         gpu = std::make_shared<gpu::GPU>(*this);
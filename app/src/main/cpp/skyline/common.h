@@ -4,11 +4,14 @@
 #pragma once
 
 #include <map>
+#include <functional>
 #include <unordered_map>
 #include <span>
 #include <vector>
 #include <fstream>
 #include <mutex>
+#include <condition_variable>
+#include <shared_mutex>
 #include <thread>
 #include <string>
 #include <cstdint>
@@ -16,14 +19,27 @@
 #include <string>
 #include <sstream>
 #include <memory>
+#include <array>
+#include <new>
 #include <syslog.h>
 #include <sys/mman.h>
 #include <fmt/format.h>
 #include <frozen/unordered_map.h>
 #include <frozen/string.h>
 #include <jni.h>
+#ifdef SKYLINE_ATRACE
+#include <android/trace.h>
+#endif
 #include "nce/guest_common.h"
 
+#ifndef SKYLINE_LOG_LEVEL
+#ifdef NDEBUG
+#define SKYLINE_LOG_LEVEL 2 //!< The most verbose level of logs that's compiled in, release builds compile out debug logs entirely
+#else
+#define SKYLINE_LOG_LEVEL 3
+#endif
+#endif
+
 namespace skyline {
     namespace frz = frozen;
     using KHandle = u32; //!< The type of a kernel handle
@@ -58,6 +74,7 @@ namespace skyline {
         // Memory
         constexpr u64 BaseAddress = 0x8000000; //!< The address space base
         constexpr u64 DefStackSize = 0x1E8480; //!< The default amount of stack: 2 MB
+        constexpr u64 HugePageSize = 0x200000; //!< The size of a transparent huge page on the host: 2 MB
         // Display
         constexpr u16 HandheldResolutionW = 1280; //!< The width component of the handheld resolution
         constexpr u16 HandheldResolutionH = 720; //!< The height component of the handheld resolution
@@ -65,6 +82,11 @@ namespace skyline {
         constexpr u16 DockedResolutionH = 1080; //!< The height component of the docked resolution
         // Time
         constexpr u64 NsInSecond = 1000000000; //!< This is the amount of nanoseconds in a second
+        constexpr u64 NsInMillisecond = 1000000; //!< This is the amount of nanoseconds in a millisecond
+        constexpr u64 TegraX1Frequency = 19200000; //!< The frequency of the system counter on the Tegra X1 (19.2 MHz)
+        // Kernel
+        constexpr u8 CoreCount = 4; //!< The amount of CPU cores on the Tegra X1
+        constexpr i8 DefaultCore = 0; //!< The ideal core of the main thread, this is also used for threads that request the process's ideal core
     }
 
     /**
@@ -82,16 +104,41 @@ namespace skyline {
 
     namespace util {
         /**
-         * @brief Returns the current time in nanoseconds
-         * @return The current time in nanoseconds
+         * @brief A fixed-point ratio that a tick count is scaled by, a scaled value is `value * integer + ((value * fraction) >> 64)`
+         * @note This is used rather than a division as it's exact to within a tick and can be computed with a multiply-high, this is also done by the patched guest code
          */
-        inline u64 GetTimeNs() {
-            static u64 frequency{};
-            if (!frequency)
+        struct ClockScale {
+            u64 integer; //!< The integer part of the ratio
+            u64 fraction; //!< The fractional part of the ratio as a 0.64 fixed-point number
+
+            constexpr ClockScale(u64 numerator, u64 denominator) : integer(numerator / denominator), fraction(static_cast<u64>((static_cast<unsigned __int128>(numerator % denominator) << 64) / denominator)) {}
+
+            constexpr u64 Scale(u64 value) const {
+                return value * integer + static_cast<u64>((static_cast<unsigned __int128>(value) * fraction) >> 64);
+            }
+        };
+
+        /**
+         * @brief The parameters for converting the host's system counter into all other time sources, these are shared by all of them so they're consistent with each other
+         */
+        struct TimeParameters {
+            u64 frequency; //!< The frequency of the host's system counter (CNTFRQ_EL0)
+            ClockScale guestTicks; //!< The scale from host ticks to guest ticks at the frequency of the Tegra X1
+            ClockScale nanoseconds; //!< The scale from host ticks to nanoseconds
+
+            TimeParameters(u64 frequency) : frequency(frequency), guestTicks(constant::TegraX1Frequency, frequency), nanoseconds(constant::NsInSecond, frequency) {}
+        };
+
+        /**
+         * @return The time parameters of the host, these are read once as the host's counter frequency doesn't change
+         */
+        inline const TimeParameters &GetTimeParameters() {
+            static const TimeParameters parameters{[] {
+                u64 frequency;
                 asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
-            u64 ticks;
-            asm("MRS %0, CNTVCT_EL0" : "=r"(ticks));
-            return ((ticks / frequency) * constant::NsInSecond) + (((ticks % frequency) * constant::NsInSecond + (frequency / 2)) / frequency);
+                return frequency;
+            }()};
+            return parameters;
         }
 
         /**
@@ -104,6 +151,21 @@ namespace skyline {
             return ticks;
         }
 
+        /**
+         * @brief Returns the current time in nanoseconds
+         * @return The current time in nanoseconds
+         */
+        inline u64 GetTimeNs() {
+            return GetTimeParameters().nanoseconds.Scale(GetTimeTicks());
+        }
+
+        /**
+         * @return The current value of the guest's system counter, this is what the guest reads from CNTPCT_EL0 and svcGetSystemTick
+         */
+        inline u64 GetGuestTicks() {
+            return GetTimeParameters().guestTicks.Scale(GetTimeTicks());
+        }
+
         /**
          * @brief Aligns up a value to a multiple of two
          * @tparam Type The type of the values
@@ -132,6 +194,16 @@ namespace skyline {
             return value & ~(multiple - 1);
         }
 
+        /**
+         * @param dividend The value to divide
+         * @param divisor The value to divide by
+         * @return The quotient of the division rounded up to the next integer
+         */
+        template<typename TypeVal, typename TypeDiv>
+        constexpr inline TypeVal DivideCeil(TypeVal dividend, TypeDiv divisor) {
+            return static_cast<TypeVal>((dividend + divisor - 1) / divisor);
+        }
+
         /**
          * @param value The value to check for alignment
          * @param multiple The multiple to check alignment with
@@ -221,79 +293,310 @@ namespace skyline {
     }
 
     /**
-     * @brief The Mutex class is a wrapper around an atomic bool used for synchronization
+     * @brief A vector with a fixed capacity that stores all of its elements inline, it never allocates and throws an exception rather than growing past its capacity
+     * @tparam Type The type of elements stored in the vector, these must be trivially copyable as they're copied bytewise and never destroyed
+     * @tparam Capacity The maximum amount of elements that can be stored in the vector
+     */
+    template<typename Type, size_t Capacity>
+    class StaticVector {
+        static_assert(std::is_trivially_copyable_v<Type>, "StaticVector elements must be trivially copyable");
+
+      private:
+        alignas(Type) u8 storage[sizeof(Type) * Capacity]; //!< The uninitialized storage for all elements, only the first count elements are constructed
+        size_t count{}; //!< The amount of elements that are currently stored
+
+      public:
+        using value_type = Type;
+        using iterator = Type *;
+        using const_iterator = const Type *;
+
+        /**
+         * @brief Constructs an element in-place at the end of the vector
+         * @return A reference to the constructed element
+         */
+        template<typename... Args>
+        inline Type &emplace_back(Args &&... args) {
+            if (count == Capacity)
+                throw exception("StaticVector cannot hold more than {} elements", Capacity);
+            return *new(data() + count++) Type(std::forward<Args>(args)...);
+        }
+
+        inline void push_back(const Type &value) {
+            emplace_back(value);
+        }
+
+        inline void clear() {
+            count = 0;
+        }
+
+        inline Type *data() {
+            return std::launder(reinterpret_cast<Type *>(storage));
+        }
+
+        inline const Type *data() const {
+            return std::launder(reinterpret_cast<const Type *>(storage));
+        }
+
+        inline size_t size() const {
+            return count;
+        }
+
+        constexpr size_t capacity() const {
+            return Capacity;
+        }
+
+        inline bool empty() const {
+            return !count;
+        }
+
+        inline Type &operator[](size_t index) {
+            return data()[index];
+        }
+
+        inline const Type &operator[](size_t index) const {
+            return data()[index];
+        }
+
+        /**
+         * @note This throws std::out_of_range like std::vector::at so callers can handle a missing element the same way
+         */
+        inline Type &at(size_t index) {
+            if (index >= count)
+                throw std::out_of_range(fmt::format("StaticVector index {} is out of range (Size: {})", index, count));
+            return data()[index];
+        }
+
+        inline const Type &at(size_t index) const {
+            if (index >= count)
+                throw std::out_of_range(fmt::format("StaticVector index {} is out of range (Size: {})", index, count));
+            return data()[index];
+        }
+
+        inline Type &front() {
+            return data()[0];
+        }
+
+        inline Type &back() {
+            return data()[count - 1];
+        }
+
+        inline iterator begin() {
+            return data();
+        }
+
+        inline iterator end() {
+            return data() + count;
+        }
+
+        inline const_iterator begin() const {
+            return data();
+        }
+
+        inline const_iterator end() const {
+            return data() + count;
+        }
+    };
+
+    namespace constant {
+        constexpr u32 MutexBackoffLimit = 0x40; //!< The maximum amount of YIELDs between two attempts at acquiring a contended Mutex, a thread parks on the futex once its backoff would exceed this
+    }
+
+    /**
+     * @brief The Mutex class is a lightweight lock which spins briefly with exponential backoff on contention and then parks the thread on a futex
+     * @details The state is 0 when unlocked, 1 when locked and 2 when locked with threads that might be parked on it, unlocking only wakes a thread in the last case
+     * @note Parking rather than yielding means a waiter stops competing for the CPU with the owner, which matters when there are more runnable threads than cores such as with the audio callback
      */
     class Mutex {
-        std::atomic_flag flag = ATOMIC_FLAG_INIT; //!< An atomic flag to hold the state of the mutex
+        std::atomic<u32> state{}; //!< The state of the mutex, this is also the futex word that waiters park on
+
+        /**
+         * @brief Acquires the mutex after the first attempt in lock() failed
+         */
+        void LockContended();
 
       public:
+        static inline std::atomic<u64> ContendedCount{}; //!< The amount of lock() calls on any Mutex that didn't acquire it on the first attempt
+        static inline std::atomic<u64> ParkCount{}; //!< The amount of times a thread has parked on the futex of any Mutex
+
         /**
          * @brief Wait on and lock the mutex
          */
-        void lock();
+        inline void lock() {
+            u32 unlocked{};
+            if (!state.compare_exchange_strong(unlocked, 1, std::memory_order_acquire, std::memory_order_relaxed))
+                LockContended();
+        }
 
         /**
          * @brief Try to lock the mutex if it is unlocked else return
          * @return If the mutex was successfully locked or not
          */
         inline bool try_lock() {
-            return !flag.test_and_set(std::memory_order_acquire);
+            u32 unlocked{};
+            return state.compare_exchange_strong(unlocked, 1, std::memory_order_acquire, std::memory_order_relaxed);
         }
 
         /**
          * @brief Unlock the mutex if it is held by this thread
          */
-        inline void unlock() {
-            flag.clear(std::memory_order_release);
-        }
+        void unlock();
     };
 
     /**
-     * @brief The GroupMutex class is a special type of mutex that allows two groups of users and only allows one group to run in parallel
+     * @brief The SharedMutex class is a reader-writer lock built on a futex which strongly favours shared owners, a shared lock or unlock without any exclusive owner is a single atomic operation
+     * @details The state holds the amount of shared owners alongside a bit for an exclusive owner and a bit for exclusive waiters, shared owners don't take the lock while an exclusive owner is waiting so it can't be starved by them
+     * @note This is meant for infrequent exclusive owners such as the JNI lifecycle (Surface changes and halting) gating emulation, any contended path parks on the futex rather than spinning
      */
-    class GroupMutex {
-      public:
+    class SharedMutex {
+        static constexpr u32 ExclusiveOwner{1U << 31}; //!< The bit set while the mutex is owned exclusively
+        static constexpr u32 ExclusiveWaiter{1U << 30}; //!< The bit set while an exclusive owner is waiting on the mutex
+        static constexpr u32 SharedMask{ExclusiveWaiter - 1}; //!< The bits holding the amount of shared owners
+
+        std::atomic<u32> state{}; //!< The state of the mutex, this is also the futex word that all waiters park on
+
         /**
-         * @brief This enumeration holds all the possible owners of the mutex
+         * @brief Acquires a shared lock after the first attempt in lock_shared() failed
          */
-        enum class Group : u8 {
-            None = 0, //!< No group owns this mutex
-            Group1 = 1, //!< Group 1 owns this mutex
-            Group2 = 2 //!< Group 2 owns this mutex
-        };
+        void LockSharedContended();
 
         /**
-         * @brief Wait on and lock the mutex
+         * @brief Wakes all threads parked on the mutex
+         */
+        void Wake();
+
+      public:
+        /**
+         * @brief Locks the mutex exclusively, this waits for all shared owners to unlock it
          */
-        void lock(Group group = Group::Group1);
+        void lock();
 
         /**
-         * @brief Unlock the mutex
-         * @note Undefined behavior in case unlocked by thread in non-owner group
+         * @brief Unlocks an exclusive lock and wakes all threads waiting on the mutex
          */
         void unlock();
 
-      private:
-        std::atomic<Group> flag{Group::None}; //!< An atomic flag to hold which group holds the mutex
-        std::atomic<Group> next{Group::None}; //!< An atomic flag to hold which group will hold the mutex next
-        std::atomic<u8> num{0}; //!< An atomic u8 keeping track of how many users are holding the mutex
-        Mutex mtx; //!< A mutex to lock before changing of num and flag
+        /**
+         * @brief Locks the mutex in a shared manner, any amount of threads can hold a shared lock at the same time
+         */
+        inline void lock_shared() {
+            auto current{state.load(std::memory_order_relaxed)};
+            if ((current & (ExclusiveOwner | ExclusiveWaiter)) || !state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                LockSharedContended();
+        }
+
+        /**
+         * @brief Unlocks a shared lock, the last shared owner wakes any waiting exclusive owner
+         */
+        inline void unlock_shared() {
+            if (state.fetch_sub(1, std::memory_order_release) == (ExclusiveWaiter | 1))
+                Wake();
+        }
     };
 
     /**
      * @brief The Logger class is to write log output to file and logcat
+     * @note Logs are only serialized into a queue owned by the calling thread, a background writer thread drains the queues and does all formatting and I/O so logging doesn't change the timing of the emulated threads
      */
     class Logger {
+      public:
+        enum class LogLevel { Error, Warn, Info, Debug }; //!< The level of a particular log
+        static constexpr LogLevel CompiledLevel{static_cast<LogLevel>(SKYLINE_LOG_LEVEL)}; //!< The most verbose level of logs that's compiled in, anything above this is never written regardless of configLevel
+        LogLevel configLevel; //!< The level of logs to write
+        using Formatter = std::string (*)(const char *format, const u8 *data, size_t size); //!< A function which formats a log on the writer thread from its format string and its serialized arguments or binary data
+
       private:
+
+        /**
+         * @brief The type of a record in a log queue
+         */
+        enum class RecordType : u8 {
+            Padding, //!< Unused space at the end of the queue, the next record starts at the beginning of the queue
+            Header, //!< A header which is written to the log file verbatim
+            Message, //!< A log which has been formatted by the producer
+            Deferred, //!< A log with trivially copyable arguments which are formatted by the writer thread
+            Binary, //!< A log of binary data which is formatted by the writer thread, these are never waited on when the queue is full
+        };
+
+        /**
+         * @brief The header of every record in a log queue, it's followed by the text of the log or its serialized arguments
+         */
+        struct RecordHeader {
+            RecordType type; //!< The type of the record, this is the first byte of the record so it can be written on its own for padding
+            LogLevel level;
+            u32 size; //!< The size of the record including this header, this is always aligned to the header's alignment
+            u32 dataSize; //!< The size of the data following the header
+            u64 timestamp; //!< The time at which the record was queued, this is used to order records from different queues
+            Formatter formatter; //!< The formatter of a deferred or binary record
+            const char *format; //!< The format string of a deferred or binary record, this has static storage duration
+        };
+
+        struct LogQueue;
+        static constexpr size_t DeferredArgumentSize{sizeof(u64)}; //!< The size of the slot that every deferred argument is serialized into
+
         std::ofstream logFile; //!< An output stream to the log file
         const char *levelStr[4] = {"0", "1", "2", "3"}; //!< This is used to denote the LogLevel when written out to a file
         static constexpr int levelSyslog[4] = {LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG}; //!< This corresponds to LogLevel and provides it's equivalent for syslog
-        Mutex mtx; //!< A mutex to lock before logging anything
+        u64 id; //!< A unique identifier for this logger, threads use this to find out if their queue belongs to it
+        std::mutex queueMutex; //!< This mutex guards the list of queues, it's only taken when a thread logs for the first time and by the writer thread
+        std::mutex drainMutex; //!< This mutex is held while draining the queues as they only have a single consumer, it's taken by the writer thread and by any thread flushing the logs
+        std::vector<std::shared_ptr<LogQueue>> queues; //!< The queues of all threads that have logged
+        std::condition_variable writerCondition; //!< The writer thread waits on this between draining the queues
+        bool halt{}; //!< If the writer thread should drain the queues a final time and exit, this is guarded by queueMutex
+        std::thread writerThread; //!< The thread which drains all queues, formats the records in them and writes them out
 
-      public:
-        enum class LogLevel { Error, Warn, Info, Debug }; //!< The level of a particular log
-        LogLevel configLevel; //!< The level of logs to write
+        /**
+         * @return The calling thread's queue for this logger, it's created on the first call from a thread
+         */
+        LogQueue &GetQueue();
+
+        /**
+         * @brief Serializes a record into the calling thread's queue
+         * @param data The text or serialized arguments of the record, anything that doesn't fit into a single record is truncated
+         * @note Errors, warnings and headers wait for the writer thread if the queue is full, other records and all binary records are dropped and accounted for instead
+         */
+        void Enqueue(RecordType type, LogLevel level, const void *data, size_t size, Formatter formatter = nullptr, const char *format = nullptr);
+
+        /**
+         * @brief The entry point of the writer thread
+         */
+        void WriterThread();
 
+        /**
+         * @brief Reads all records out of every queue and writes them out in the order they were queued
+         * @note drainMutex must be locked when calling this
+         */
+        void Drain();
+
+        /**
+         * @return The deferred argument at the specified index of a record
+         */
+        template<typename Type>
+        static Type LoadDeferredArgument(const u8 *arguments, size_t index) {
+            Type value;
+            std::memcpy(&value, arguments + (index * DeferredArgumentSize), sizeof(Type));
+            return value;
+        }
+
+        /**
+         * @brief Formats a deferred record with the types of its arguments, this is instantiated for every set of types a log is written with
+         */
+        template<typename... Args, size_t... Indices>
+        static std::string FormatDeferred(const char *format, const u8 *arguments, std::index_sequence<Indices...>) {
+            return fmt::format(format, LoadDeferredArgument<Args>(arguments, Indices)...);
+        }
+
+        template<typename... Args>
+        static std::string FormatDeferred(const char *format, const u8 *arguments, size_t) {
+            return FormatDeferred<Args...>(format, arguments, std::index_sequence_for<Args...>{});
+        }
+
+        /**
+         * @brief If a log with the specified format and argument types can have its formatting deferred to the writer thread, this requires a string literal format and arguments that can be copied bytewise without referencing any other memory
+         */
+        template<typename S, typename... Args>
+        static constexpr bool IsDeferrable{std::is_array_v<S> && ((std::is_arithmetic_v<Args> || std::is_enum_v<Args>) && ...) && ((sizeof(Args) <= DeferredArgumentSize) && ...)};
+
+      public:
         /**
          * @param path The path of the log file
          * @param configLevel The minimum level of logs to write
@@ -301,10 +604,27 @@ namespace skyline {
         Logger(const std::string &path, LogLevel configLevel);
 
         /**
-         * @brief Writes the termination message to the log file
+         * @brief Writes the termination message to the log file after writing out all queued logs
          */
         ~Logger();
 
+        /**
+         * @brief Synchronously writes out all queued logs on the calling thread, this is used on crash and exit paths where the writer thread might not get to drain them
+         * @param wait If the calling thread should wait for a drain in progress on another thread, this is false for signal handlers as they could've interrupted a drain on their own thread
+         */
+        void Flush(bool wait = true);
+
+        /**
+         * @return If logs of the specified level are written, this is always false for levels that aren't compiled in
+         */
+        template<LogLevel Level>
+        inline bool IsEnabled() const {
+            if constexpr (Level <= CompiledLevel)
+                return Level <= configLevel;
+            else
+                return false;
+        }
+
         /**
          * @brief Writes a header, should only be used for emulation starting and ending
          * @param str The value to be written
@@ -316,7 +636,33 @@ namespace skyline {
          * @param level The level of the log
          * @param str The value to be written
          */
-        void Write(LogLevel level, std::string str);
+        void Write(LogLevel level, const std::string &str);
+
+        /**
+         * @brief Writes binary data that's only parsed and formatted into the text of a log by the writer thread, this keeps the cost of logs that are expensive to format off the producer
+         * @param formatter The function which formats the data, it must not reference any state other than its arguments
+         * @param data The data to copy into the record, anything that doesn't fit into a single record is truncated
+         * @param format An optional string with static storage duration that's passed to the formatter
+         * @note The log is dropped rather than waited on if the queue is full regardless of its level, the amount of dropped logs is reported instead
+         */
+        void WriteBinary(LogLevel level, Formatter formatter, std::span<const u8> data, const char *format = nullptr);
+
+        /**
+         * @brief Write a log with libfmt formatting regardless of configLevel, formatting is done by the writer thread if the arguments allow it
+         * @param formatStr The value to be written, with libfmt formatting
+         * @param args The arguments based on format_str
+         */
+        template<LogLevel Level, typename S, typename... Args>
+        inline void Log(const S &formatStr, Args &&... args) {
+            if constexpr (IsDeferrable<S, std::decay_t<Args>...>) {
+                std::array<u8, sizeof...(Args) * DeferredArgumentSize> arguments{};
+                [[maybe_unused]] size_t index{};
+                ((std::memcpy(arguments.data() + (index++ * DeferredArgumentSize), &args, sizeof(args))), ...);
+                Enqueue(RecordType::Deferred, Level, arguments.data(), arguments.size(), &FormatDeferred<std::decay_t<Args>...>, formatStr);
+            } else {
+                Write(Level, fmt::format(formatStr, args...));
+            }
+        }
 
         /**
          * @brief Write an error log with libfmt formatting
@@ -325,8 +671,8 @@ namespace skyline {
          */
         template<typename S, typename... Args>
         inline void Error(const S &formatStr, Args &&... args) {
-            if (LogLevel::Error <= configLevel) {
-                Write(LogLevel::Error, fmt::format(formatStr, args...));
+            if (IsEnabled<LogLevel::Error>()) {
+                Log<LogLevel::Error>(formatStr, args...);
             }
         }
 
@@ -337,8 +683,8 @@ namespace skyline {
          */
         template<typename S, typename... Args>
         inline void Warn(const S &formatStr, Args &&... args) {
-            if (LogLevel::Warn <= configLevel) {
-                Write(LogLevel::Warn, fmt::format(formatStr, args...));
+            if (IsEnabled<LogLevel::Warn>()) {
+                Log<LogLevel::Warn>(formatStr, args...);
             }
         }
 
@@ -349,8 +695,8 @@ namespace skyline {
          */
         template<typename S, typename... Args>
         inline void Info(const S &formatStr, Args &&... args) {
-            if (LogLevel::Info <= configLevel) {
-                Write(LogLevel::Info, fmt::format(formatStr, args...));
+            if (IsEnabled<LogLevel::Info>()) {
+                Log<LogLevel::Info>(formatStr, args...);
             }
         }
 
@@ -361,20 +707,187 @@ namespace skyline {
          */
         template<typename S, typename... Args>
         inline void Debug(const S &formatStr, Args &&... args) {
-            if (LogLevel::Debug <= configLevel) {
-                Write(LogLevel::Debug, fmt::format(formatStr, args...));
+            if (IsEnabled<LogLevel::Debug>()) {
+                Log<LogLevel::Debug>(formatStr, args...);
             }
         }
     };
 
+    /**
+     * @brief Writes a log with libfmt formatting if the level is enabled, unlike Logger's functions the arguments are only evaluated when the log is written
+     * @note This should be used on hot paths where evaluating and passing the arguments has a measurable cost, logs above Logger::CompiledLevel compile to nothing
+     */
+    #define LOGGER_WRITE(logger, level, ...) do { if ((logger)->template IsEnabled<skyline::Logger::LogLevel::level>()) (logger)->template Log<skyline::Logger::LogLevel::level>(__VA_ARGS__); } while (false)
+    #define LOGE(logger, ...) LOGGER_WRITE(logger, Error, __VA_ARGS__)
+    #define LOGW(logger, ...) LOGGER_WRITE(logger, Warn, __VA_ARGS__)
+    #define LOGI(logger, ...) LOGGER_WRITE(logger, Info, __VA_ARGS__)
+    #define LOGD(logger, ...) LOGGER_WRITE(logger, Debug, __VA_ARGS__)
+
+    /**
+     * @brief A binary tracer for hot paths that are too frequent to log, events are written into a fixed-size ring of records and only formatted when the trace is dumped
+     * @note The tracer is only compiled in when SKYLINE_TRACE is defined, TRACE compiles to nothing otherwise
+     */
+    namespace trace {
+        constexpr size_t RecordCount{0x4000}; //!< The amount of records in the ring, older records are overwritten by newer ones
+        constexpr size_t MaxArguments{4}; //!< The maximum amount of arguments that can be stored in a record
+
+        /**
+         * @brief A single traced event with its arguments stored in binary form
+         */
+        struct Record {
+            std::atomic<u64> sequence; //!< The index of the event + 1 after the record has been written, this is 0 while the record is being written
+            const char *format; //!< The libfmt format string of the event, this must have static storage duration
+            u64 timestamp; //!< The time at which the event was recorded in nanoseconds
+            std::array<u64, MaxArguments> arguments; //!< The arguments of the event, these are passed to the format string in order
+        };
+
+        extern std::array<Record, RecordCount> records; //!< The ring of records which is shared by all threads
+        extern std::atomic<u64> recordIndex; //!< The index of the next event that will be recorded
+
+        /**
+         * @brief Records an event into the ring, this doesn't format or allocate anything
+         * @param format A libfmt format string with static storage duration, it's only used when the trace is dumped
+         * @param args The arguments of the event, these must be integers or enumerations
+         */
+        template<typename... Args>
+        inline void Write(const char *format, Args... args) {
+            static_assert(sizeof...(Args) <= MaxArguments, "Trace events cannot have more than MaxArguments arguments");
+            static_assert(((std::is_integral_v<Args> || std::is_enum_v<Args>) && ...), "Trace event arguments must be integers or enumerations");
+
+            auto index{recordIndex.fetch_add(1, std::memory_order_relaxed)};
+            auto &record{records[index % RecordCount]};
+            record.sequence.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            record.format = format;
+            record.timestamp = util::GetTimeNs();
+            record.arguments = {static_cast<u64>(args)...};
+            record.sequence.store(index + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Formats all records that are still in the ring and writes them to the log in the order they were recorded
+         * @note Records that are overwritten while they're being read are skipped
+         */
+        void Dump(Logger &logger);
+    }
+
+    #ifdef SKYLINE_TRACE
+    #define TRACE(...) skyline::trace::Write(__VA_ARGS__)
+    #else
+    #define TRACE(...) do {} while (false)
+    #endif
+
+    #ifdef SKYLINE_ATRACE
+    namespace trace {
+        /**
+         * @brief A section of the calling thread's timeline in ATrace which lasts for the lifetime of the object, these show up as slices in Perfetto and systrace
+         * @note Nothing is emitted unless a trace is being captured, in which case the name is copied by ATrace at construction
+         */
+        class Section {
+          private:
+            bool active{};
+
+          public:
+            Section(const char *name) {
+                if (name) {
+                    ATrace_beginSection(name);
+                    active = true;
+                }
+            }
+
+            Section(const Section &) = delete;
+
+            ~Section() {
+                if (active)
+                    ATrace_endSection();
+            }
+        };
+
+        /**
+         * @return The name of a section formatted into a buffer that's reused by every call on the calling thread, the name is truncated if it's too long
+         */
+        template<typename... Args>
+        const char *FormatSectionName(const char *format, Args &&... args) {
+            thread_local std::array<char, 0x80> name;
+            auto result{fmt::format_to_n(name.data(), name.size() - 1, format, std::forward<Args>(args)...)};
+            *result.out = '\0';
+            return name.data();
+        }
+    }
+
+    #define TRACE_SECTION_CONCAT_(a, b) a##b
+    #define TRACE_SECTION_VARIABLE_(line) TRACE_SECTION_CONCAT_(traceSection, line)
+
+    /**
+     * @brief Begins an ATrace section with a static name that ends at the end of the enclosing scope
+     */
+    #define TRACE_SECTION(name) skyline::trace::Section TRACE_SECTION_VARIABLE_(__LINE__){ATrace_isEnabled() ? (name) : nullptr}
+
+    /**
+     * @brief Begins an ATrace section with a libfmt formatted name that ends at the end of the enclosing scope, the arguments are only evaluated while a trace is being captured
+     */
+    #define TRACE_SECTION_FMT(format, ...) skyline::trace::Section TRACE_SECTION_VARIABLE_(__LINE__){ATrace_isEnabled() ? skyline::trace::FormatSectionName(format, __VA_ARGS__) : nullptr}
+    #else
+    #define TRACE_SECTION(name) do {} while (false)
+    #define TRACE_SECTION_FMT(format, ...) do {} while (false)
+    #endif
+
+    /**
+     * @brief A list of all settings used by libskyline, every entry is SETTING(Type, Name, Key, Default) where Key is the key of the preference in the Java component
+     * @note Fields of Settings::Values are generated from this, adding a setting only requires adding it here
+     */
+    #define SKYLINE_SETTINGS(SETTING)                                          \
+        SETTING(int, logLevel, "log_level", 2)                                 \
+        SETTING(std::string, username, "username_value", "Skyline")            \
+        SETTING(bool, operationMode, "operation_mode", true)                   \
+        SETTING(bool, macroJit, "macro_jit", true)                             \
+        SETTING(bool, presentMailbox, "present_mailbox", false)                \
+        SETTING(u32, upscalingFilter, "upscaling_filter", 0)                   \
+        SETTING(u32, presentationDepth, "presentation_depth", 3)               \
+        SETTING(bool, latestFrame, "latest_frame", false)                      \
+        SETTING(u32, speedLimit, "speed_limit", 100)                           \
+        SETTING(bool, frameSkip, "frame_skip", false)                          \
+        SETTING(bool, thermalFrameSkip, "thermal_frame_skip", true)            \
+        SETTING(bool, coreAffinity, "core_affinity", true)                     \
+        SETTING(bool, deterministicScheduling, "deterministic_scheduling", false) \
+        SETTING(bool, hugePages, "huge_pages", false)                          \
+        SETTING(bool, verifyIntegrity, "verify_integrity", false)              \
+        SETTING(bool, sincResampling, "sinc_resampling", false)                \
+        SETTING(bool, gpuCapture, "gpu_capture", false)                        \
+        SETTING(u32, cacheBudget, "cache_budget", 0)                           \
+        SETTING(bool, guestProfiler, "guest_profiler", false)                  \
+        SETTING(u32, inputSamplingInterval, "input_sampling_interval", 5)      \
+        SETTING(bool, motionControls, "motion_controls", true)
+
     /**
      * @brief The Settings class is used to access the parameters set in the Java component of the application
+     * @details The preference XML is only parsed into a typed snapshot when it's loaded, reading settings is just a read of a field in the current snapshot.
+     * The snapshot can be replaced at runtime with Update, this swaps an atomic pointer so readers never take a lock
      */
     class Settings {
+      public:
+        /**
+         * @brief A typed snapshot of all settings
+         */
+        struct Values {
+            #define SETTING(type, name, key, defaultValue) type name{defaultValue};
+            SKYLINE_SETTINGS(SETTING)
+            #undef SETTING
+        };
+
       private:
-        std::map<std::string, std::string> stringMap; //!< A mapping from all keys to their corresponding string value
-        std::map<std::string, bool> boolMap; //!< A mapping from all keys to their corresponding boolean value
-        std::map<std::string, int> intMap; //!< A mapping from all keys to their corresponding integer value
+        std::atomic<const Values *> current; //!< The current snapshot of the settings
+        std::mutex updateMutex; //!< This mutex serializes updates to the snapshot
+        std::vector<std::unique_ptr<const Values>> snapshots; //!< All snapshots that have been created, older snapshots are retained as readers might still be accessing them
+        std::map<size_t, std::function<void(const Values &)>> callbacks; //!< The callbacks invoked with every new snapshot, these are guarded by updateMutex
+        size_t nextCallback{}; //!< The ID of the next callback that's added
+
+        /**
+         * @brief Parses the preference XML into a new snapshot
+         * @param fd An FD to the preference XML file, this isn't closed and is read from the start
+         */
+        static std::unique_ptr<const Values> Parse(int fd);
 
       public:
         /**
@@ -383,25 +896,27 @@ namespace skyline {
         Settings(int fd);
 
         /**
-         * @brief Retrieves a particular setting as a string
-         * @param key The key of the setting
-         * @return The string value of the setting
+         * @return The current snapshot of the settings, a reference to it is valid for the lifetime of this object
          */
-        std::string GetString(const std::string &key);
+        inline const Values &Get() const {
+            return *current.load(std::memory_order_acquire);
+        }
 
         /**
-         * @brief Retrieves a particular setting as a boolean
-         * @param key The key of the setting
-         * @return The boolean value of the setting
+         * @brief Replaces the current snapshot with one parsed from the preference XML
+         * @param fd An FD to the preference XML file
+         * @note Settings that are only read on initialization won't be affected by this
          */
-        bool GetBool(const std::string &key);
+        void Update(int fd);
 
         /**
-         * @brief Retrieves a particular setting as a integer
-         * @param key The key of the setting
-         * @return The integer value of the setting
+         * @brief Adds a callback which is invoked with every new snapshot after it becomes the current one, this is used by settings that have to be applied when they're changed
+         * @return An ID which is used to remove the callback
+         * @note The callback is invoked on the thread that updates the settings with updateMutex held, so it mustn't update the settings itself
          */
-        int GetInt(const std::string &key);
+        size_t AddCallback(std::function<void(const Values &)> callback);
+
+        void RemoveCallback(size_t id);
 
         /**
          * @brief Writes all settings keys and values to syslog. This function is for development purposes.
@@ -411,6 +926,7 @@ namespace skyline {
 
     class NCE;
     class JvmManager;
+    class CallProfiler;
     namespace gpu {
         class GPU;
     }
@@ -449,5 +965,6 @@ namespace skyline {
         std::shared_ptr<JvmManager> jvm; //!< This holds a reference to the JvmManager class
         std::shared_ptr<Settings> settings; //!< This holds a reference to the Settings class
         std::shared_ptr<Logger> logger; //!< This holds a reference to the Logger class
+        std::shared_ptr<CallProfiler> profiler; //!< This holds a reference to the CallProfiler class
     };
 }
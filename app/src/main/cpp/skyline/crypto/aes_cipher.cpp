@@ -1,9 +1,95 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
 #include "aes_cipher.h"
 
+#define AES_TARGET __attribute__((target("crypto"))) //!< The ARMv8 Crypto Extensions are only enabled for the functions which use them, they're selected at runtime
+
 namespace skyline::crypto {
+    constexpr size_t BlockSize = 0x10; //!< The size of an AES block in bytes
+    constexpr size_t PipelineDepth = 4; //!< The amount of blocks that are decrypted at once, this hides the latency of the AES instructions as the blocks are independent
+
+    /**
+     * @return If the CPU supports the ARMv8 Crypto Extensions AES instructions
+     */
+    bool HasHardwareAes() {
+        static const bool supported{static_cast<bool>(getauxval(AT_HWCAP) & HWCAP_AES)};
+        return supported;
+    }
+
+    /**
+     * @brief Expands an AES-128 key into its encryption round keys
+     * @note SubWord is done with AESE on a vector of the word in every column with a zero round key, ShiftRows has no effect on it as all columns are the same
+     */
+    AES_TARGET void ExpandKey(const u8 *key, std::array<uint8x16_t, 11> &roundKeys) {
+        constexpr std::array<u8, 10> RoundConstants{0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36};
+
+        std::array<u32, 44> words;
+        std::memcpy(words.data(), key, BlockSize);
+        for (size_t index{4}; index < words.size(); index++) {
+            u32 word{words[index - 1]};
+            if (index % 4 == 0) {
+                word = (word >> 8) | (word << 24); // RotWord
+                word = vgetq_lane_u32(vreinterpretq_u32_u8(vaeseq_u8(vreinterpretq_u8_u32(vdupq_n_u32(word)), vdupq_n_u8(0))), 0); // SubWord
+                word ^= RoundConstants[(index / 4) - 1];
+            }
+            words[index] = words[index - 4] ^ word;
+        }
+
+        for (size_t index{}; index < roundKeys.size(); index++)
+            roundKeys[index] = vld1q_u8(reinterpret_cast<u8 *>(words.data() + (index * 4)));
+    }
+
+    /**
+     * @brief Converts AES-128 encryption round keys into the equivalent decryption round keys for AESD
+     */
+    AES_TARGET void InvertKey(std::array<uint8x16_t, 11> &roundKeys) {
+        std::array<uint8x16_t, 11> inverse;
+        inverse.front() = roundKeys.back();
+        for (size_t index{1}; index < roundKeys.size() - 1; index++)
+            inverse[index] = vaesimcq_u8(roundKeys[roundKeys.size() - 1 - index]);
+        inverse.back() = roundKeys.front();
+        roundKeys = inverse;
+    }
+
+    /**
+     * @brief Encrypts a batch of independent blocks, the rounds of all blocks are interleaved
+     */
+    template<size_t Count>
+    AES_TARGET FORCE_INLINE void EncryptBlocks(std::array<uint8x16_t, Count> &blocks, const std::array<uint8x16_t, 11> &roundKeys) {
+        for (size_t round{}; round < roundKeys.size() - 2; round++)
+            for (auto &block : blocks)
+                block = vaesmcq_u8(vaeseq_u8(block, roundKeys[round]));
+        for (auto &block : blocks)
+            block = veorq_u8(vaeseq_u8(block, roundKeys[roundKeys.size() - 2]), roundKeys.back());
+    }
+
+    /**
+     * @brief Decrypts a batch of independent blocks with decryption round keys, the rounds of all blocks are interleaved
+     */
+    template<size_t Count>
+    AES_TARGET FORCE_INLINE void DecryptBlocks(std::array<uint8x16_t, Count> &blocks, const std::array<uint8x16_t, 11> &roundKeys) {
+        for (size_t round{}; round < roundKeys.size() - 2; round++)
+            for (auto &block : blocks)
+                block = vaesimcq_u8(vaesdq_u8(block, roundKeys[round]));
+        for (auto &block : blocks)
+            block = veorq_u8(vaesdq_u8(block, roundKeys[roundKeys.size() - 2]), roundKeys.back());
+    }
+
+    /**
+     * @brief Multiplies an XTS tweak by the primitive element (x) of GF(2^128), the tweak is little-endian
+     */
+    FORCE_INLINE uint8x16_t MultiplyTweak(uint8x16_t tweak) {
+        auto words{vreinterpretq_u64_u8(tweak)};
+        u64 low{vgetq_lane_u64(words, 0)}, high{vgetq_lane_u64(words, 1)};
+        u64 carry{high >> 63};
+        high = (high << 1) | (low >> 63);
+        low = (low << 1) ^ (carry * 0x87);
+        return vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(low), vcreate_u64(high)));
+    }
+
     AesCipher::AesCipher(std::span<u8> key, mbedtls_cipher_type_t type) {
         mbedtls_cipher_init(&decryptContext);
         if (mbedtls_cipher_setup(&decryptContext, mbedtls_cipher_info_from_type(type)) != 0)
@@ -11,6 +97,20 @@ namespace skyline::crypto {
 
         if (mbedtls_cipher_setkey(&decryptContext, key.data(), key.size() * 8, MBEDTLS_DECRYPT) != 0)
             throw exception("Failed to set key for decryption context");
+
+        mode = mbedtls_cipher_get_cipher_mode(&decryptContext);
+        if (HasHardwareAes()) {
+            // mbedtls is still set up as it's used for every other mode, the key schedule for hardware decryption is only derived for the modes which support it
+            if (type == MBEDTLS_CIPHER_AES_128_CTR && key.size() == BlockSize) {
+                ExpandKey(key.data(), dataKeys);
+                hardware = true;
+            } else if (type == MBEDTLS_CIPHER_AES_128_XTS && key.size() == BlockSize * 2) {
+                ExpandKey(key.data(), dataKeys);
+                InvertKey(dataKeys);
+                ExpandKey(key.data() + BlockSize, tweakKeys);
+                hardware = true;
+            }
+        }
     }
 
     AesCipher::~AesCipher() {
@@ -18,11 +118,119 @@ namespace skyline::crypto {
     }
 
     void AesCipher::SetIV(const std::array<u8, 0x10> &iv) {
+        if (hardware) {
+            this->iv = iv;
+            keystreamOffset = sizeof(keystream);
+            return;
+        }
+
         if (mbedtls_cipher_set_iv(&decryptContext, iv.data(), iv.size()) != 0)
             throw exception("Failed to set IV for decryption context");
+
+        mbedtls_cipher_reset(&decryptContext);
+    }
+
+    AES_TARGET void AesCipher::HardwareCtrDecrypt(u8 *destination, const u8 *source, size_t size) {
+        // The remainder of a keystream block from the previous call is consumed first
+        for (; size && keystreamOffset < sizeof(keystream); size--)
+            *destination++ = *source++ ^ keystream[keystreamOffset++];
+
+        // The counter is a 128-bit big-endian integer, it's held as two native halves while decrypting
+        u64 high{__builtin_bswap64(*reinterpret_cast<u64 *>(iv.data()))}, low{__builtin_bswap64(*reinterpret_cast<u64 *>(iv.data() + sizeof(u64)))};
+        auto nextCounter{[&]() {
+            auto counter{vreinterpretq_u8_u64(vcombine_u64(vcreate_u64(__builtin_bswap64(high)), vcreate_u64(__builtin_bswap64(low))))};
+            if (++low == 0)
+                high++;
+            return counter;
+        }};
+
+        for (; size >= BlockSize * PipelineDepth; size -= BlockSize * PipelineDepth) {
+            std::array<uint8x16_t, PipelineDepth> blocks;
+            for (auto &block : blocks)
+                block = nextCounter();
+            EncryptBlocks(blocks, dataKeys);
+            for (auto &block : blocks) {
+                vst1q_u8(destination, veorq_u8(vld1q_u8(source), block));
+                source += BlockSize;
+                destination += BlockSize;
+            }
+        }
+
+        for (; size >= BlockSize; size -= BlockSize) {
+            std::array<uint8x16_t, 1> block{nextCounter()};
+            EncryptBlocks(block, dataKeys);
+            vst1q_u8(destination, veorq_u8(vld1q_u8(source), block[0]));
+            source += BlockSize;
+            destination += BlockSize;
+        }
+
+        if (size) {
+            std::array<uint8x16_t, 1> block{nextCounter()};
+            EncryptBlocks(block, dataKeys);
+            vst1q_u8(keystream.data(), block[0]);
+            for (keystreamOffset = 0; keystreamOffset < size; keystreamOffset++)
+                destination[keystreamOffset] = source[keystreamOffset] ^ keystream[keystreamOffset];
+        }
+
+        *reinterpret_cast<u64 *>(iv.data()) = __builtin_bswap64(high);
+        *reinterpret_cast<u64 *>(iv.data() + sizeof(u64)) = __builtin_bswap64(low);
+    }
+
+    AES_TARGET void AesCipher::HardwareXtsDecrypt(u8 *destination, const u8 *source, size_t size, const std::array<u8, 0x10> &dataUnit) {
+        if (size % BlockSize)
+            throw exception("XTS decryption without ciphertext stealing requires a multiple of the block size: 0x{:X}", size);
+
+        std::array<uint8x16_t, 1> tweak{vld1q_u8(dataUnit.data())};
+        EncryptBlocks(tweak, tweakKeys);
+
+        for (; size >= BlockSize * PipelineDepth; size -= BlockSize * PipelineDepth) {
+            std::array<uint8x16_t, PipelineDepth> tweaks, blocks;
+            for (size_t index{}; index < PipelineDepth; index++) {
+                tweaks[index] = tweak[0];
+                blocks[index] = veorq_u8(vld1q_u8(source + (index * BlockSize)), tweak[0]);
+                tweak[0] = MultiplyTweak(tweak[0]);
+            }
+            DecryptBlocks(blocks, dataKeys);
+            for (size_t index{}; index < PipelineDepth; index++)
+                vst1q_u8(destination + (index * BlockSize), veorq_u8(blocks[index], tweaks[index]));
+            source += BlockSize * PipelineDepth;
+            destination += BlockSize * PipelineDepth;
+        }
+
+        for (; size; size -= BlockSize) {
+            std::array<uint8x16_t, 1> block{veorq_u8(vld1q_u8(source), tweak[0])};
+            DecryptBlocks(block, dataKeys);
+            vst1q_u8(destination, veorq_u8(block[0], tweak[0]));
+            tweak[0] = MultiplyTweak(tweak[0]);
+            source += BlockSize;
+            destination += BlockSize;
+        }
     }
 
     void AesCipher::Decrypt(u8 *destination, u8 *source, size_t size) {
+        if (hardware) {
+            if (mode == MBEDTLS_MODE_CTR)
+                HardwareCtrDecrypt(destination, source, size);
+            else
+                HardwareXtsDecrypt(destination, source, size, iv);
+            return;
+        }
+
+        size_t outputSize{};
+
+        if (mode == MBEDTLS_MODE_CTR) {
+            // CTR is a stream cipher so it's decrypted in-place in a single pass, the keystream isn't reset so consecutive calls continue where the last one stopped
+            if (mbedtls_cipher_update(&decryptContext, source, size, destination, &outputSize) != 0)
+                throw exception("Failed to decrypt data with CTR");
+            return;
+        } else if (mode == MBEDTLS_MODE_ECB) {
+            // ECB only decrypts a single block per update, blocks are independent of each other so this can be done in-place
+            u32 blockSize{mbedtls_cipher_get_block_size(&decryptContext)};
+            for (size_t offset{}; offset < size; offset += blockSize)
+                mbedtls_cipher_update(&decryptContext, source + offset, std::min<size_t>(blockSize, size - offset), destination + offset, &outputSize);
+            return;
+        }
+
         std::optional<std::vector<u8>> buf{};
 
         u8 *targetDestination = [&]() {
@@ -40,18 +248,7 @@ namespace skyline::crypto {
         }();
 
         mbedtls_cipher_reset(&decryptContext);
-
-        size_t outputSize{};
-        if (mbedtls_cipher_get_cipher_mode(&decryptContext) == MBEDTLS_MODE_XTS) {
-            mbedtls_cipher_update(&decryptContext, source, size, targetDestination, &outputSize);
-        } else {
-            u32 blockSize{mbedtls_cipher_get_block_size(&decryptContext)};
-
-            for (size_t offset{}; offset < size; offset += blockSize) {
-                size_t length{size - offset > blockSize ? blockSize : size - offset};
-                mbedtls_cipher_update(&decryptContext, source + offset, length, targetDestination + offset, &outputSize);
-            }
-        }
+        mbedtls_cipher_update(&decryptContext, source, size, targetDestination, &outputSize);
 
         if (buf)
             std::memcpy(destination, buf->data(), size);
@@ -64,8 +261,12 @@ namespace skyline::crypto {
             throw exception("Size must be multiple of sector size");
 
         for (size_t i{}; i < size; i += sectorSize) {
-            SetIV(GetTweak(sector++));
-            Decrypt(destination + i, source + i, sectorSize);
+            if (hardware) {
+                HardwareXtsDecrypt(destination + i, source + i, sectorSize, GetTweak(sector++));
+            } else {
+                SetIV(GetTweak(sector++));
+                Decrypt(destination + i, source + i, sectorSize);
+            }
         }
     }
 }
@@ -5,17 +5,29 @@
 
 #include <array>
 #include <span>
+#include <arm_neon.h>
 #include <mbedtls/cipher.h>
 #include <common.h>
 
 namespace skyline::crypto {
     /**
      * @brief Wrapper for mbedtls for AES decryption using a cipher
+     * @note AES-128 CTR and XTS are decrypted with the ARMv8 Crypto Extensions when the CPU supports them, mbedtls is used for them otherwise
      */
     class AesCipher {
       private:
         mbedtls_cipher_context_t decryptContext;
 
+        using RoundKeys = std::array<uint8x16_t, 11>; //!< The round keys of an AES-128 key schedule
+
+        bool hardware{}; //!< If the ARMv8 Crypto Extensions are used for decryption rather than mbedtls
+        mbedtls_cipher_mode_t mode; //!< The mode of the cipher
+        RoundKeys dataKeys; //!< The round keys used for the data, these are encryption keys for CTR and decryption keys for XTS
+        RoundKeys tweakKeys; //!< The encryption round keys used for the XTS tweak
+        std::array<u8, 0x10> iv{}; //!< The current IV, this is the counter for CTR and the data unit for XTS
+        std::array<u8, 0x10> keystream{}; //!< The keystream block of CTR which is partially consumed
+        size_t keystreamOffset{sizeof(keystream)}; //!< The offset of the unused part of the keystream, it's fully consumed when this is the size of the block
+
         /**
          * @brief Buffer should grow bigger than 1 MiB
          */
@@ -36,18 +48,28 @@ namespace skyline::crypto {
             return tweak;
         }
 
+        /**
+         * @brief Decrypts data with CTR using the ARMv8 Crypto Extensions, the keystream is continued from the previous call
+         */
+        void HardwareCtrDecrypt(u8 *destination, const u8 *source, size_t size);
+
+        /**
+         * @brief Decrypts data with XTS as a single data unit using the ARMv8 Crypto Extensions, the data unit is the IV
+         */
+        void HardwareXtsDecrypt(u8 *destination, const u8 *source, size_t size, const std::array<u8, 0x10> &dataUnit);
+
       public:
         AesCipher(std::span<u8> key, mbedtls_cipher_type_t type);
 
         ~AesCipher();
 
         /**
-         * @brief Sets initilization vector
+         * @brief Sets initilization vector, this also restarts the keystream of CTR from the start of the counter
          */
         void SetIV(const std::array<u8, 0x10> &iv);
 
         /**
-         * @note destination and source can be the same
+         * @note destination and source can be the same, CTR and ECB are decrypted in-place without any intermediate buffer in that case
          */
         void Decrypt(u8 *destination, u8 *source, size_t size);
 
@@ -2,18 +2,51 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <functional>
+#include <sys/stat.h>
 #include <vfs/os_filesystem.h>
 #include "key_store.h"
 
 namespace skyline::crypto {
     KeyStore::KeyStore(const std::string &rootPath) {
         vfs::OsFileSystem root(rootPath);
-        if (root.FileExists("title.keys"))
+        if (root.FileExists("title.keys")) {
             ReadPairs(root.OpenFile("title.keys"), &KeyStore::PopulateTitleKeys);
+
+            // The first title key for any rights ID is the one that's used, a stable sort retains the order of duplicates so they can be dropped
+            std::stable_sort(titleKeys.begin(), titleKeys.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+            titleKeys.erase(std::unique(titleKeys.begin(), titleKeys.end(), [](const auto &a, const auto &b) { return a.first == b.first; }), titleKeys.end());
+            titleKeys.shrink_to_fit();
+        }
         if (root.FileExists("prod.keys"))
             ReadPairs(root.OpenFile("prod.keys"), &KeyStore::PopulateKeys);
     }
 
+    std::shared_ptr<KeyStore> KeyStore::Get(const std::string &rootPath) {
+        // A key file is identified by its inode, size and modification time, any modification to it changes one of these
+        using FileStamp = std::tuple<u64, i64, i64, i64>;
+        auto getStamp{[](const std::string &path) {
+            struct stat fileStat{};
+            if (stat(path.c_str(), &fileStat))
+                return FileStamp{};
+            return FileStamp{fileStat.st_ino, fileStat.st_size, fileStat.st_mtim.tv_sec, fileStat.st_mtim.tv_nsec};
+        }};
+
+        static std::mutex mutex;
+        static std::string cachedPath;
+        static std::array<FileStamp, 2> cachedStamps;
+        static std::shared_ptr<KeyStore> cached;
+
+        std::array<FileStamp, 2> stamps{getStamp(rootPath + "title.keys"), getStamp(rootPath + "prod.keys")};
+
+        std::lock_guard lock(mutex);
+        if (!cached || cachedPath != rootPath || cachedStamps != stamps) {
+            cached = std::make_shared<KeyStore>(rootPath);
+            cachedPath = rootPath;
+            cachedStamps = stamps;
+        }
+        return cached;
+    }
+
     void KeyStore::ReadPairs(const std::shared_ptr<vfs::Backing> &backing, ReadPairsCallback callback) {
         std::vector<char> fileContent(backing->size);
         backing->Read(fileContent.data(), 0, fileContent.size());
@@ -35,25 +68,33 @@ namespace skyline::crypto {
     }
 
     void KeyStore::PopulateTitleKeys(std::string_view keyName, std::string_view value) {
-        Key128 key{util::HexStringToArray<16>(keyName)};
-        Key128 valueArray{util::HexStringToArray<16>(value)};
-        titleKeys.insert({std::move(key), std::move(valueArray)});
+        titleKeys.emplace_back(util::HexStringToArray<16>(keyName), util::HexStringToArray<16>(value));
     }
 
     void KeyStore::PopulateKeys(std::string_view keyName, std::string_view value) {
-        {
-            auto it{key256Names.find(keyName)};
-            if (it != key256Names.end()) {
-                it->second = headerKey = util::HexStringToArray<32>(value);
-                return;
-            }
+        if (keyName == "header_key") {
+            headerKey = util::HexStringToArray<32>(value);
+            return;
         }
 
+        // Indexed keys are suffixed with their index as 2 hexadecimal digits
+        constexpr std::pair<std::string_view, IndexedKeys128 KeyStore::*> IndexedKeyNames[]{
+            {"titlekek_", &KeyStore::titleKek},
+            {"key_area_key_application_", &KeyStore::areaKeyApplication},
+            {"key_area_key_ocean_", &KeyStore::areaKeyOcean},
+            {"key_area_key_system_", &KeyStore::areaKeySystem},
+        };
+
         if (keyName.size() > 2) {
-            auto it = indexedKey128Names.find(keyName.substr(0, keyName.size() - 2));
-            if (it != indexedKey128Names.end()) {
-                size_t index{std::stoul(std::string(keyName.substr(it->first.size())), nullptr, 16)};
-                it->second[index] = util::HexStringToArray<16>(value);
+            auto prefix{keyName.substr(0, keyName.size() - 2)};
+            for (const auto &[name, keys] : IndexedKeyNames) {
+                if (prefix != name)
+                    continue;
+
+                size_t index{(static_cast<size_t>(util::HexDigitToByte(keyName[keyName.size() - 2])) << 4) | util::HexDigitToByte(keyName.back())};
+                if (index < (this->*keys).size())
+                    (this->*keys)[index] = util::HexStringToArray<16>(value);
+                return;
             }
         }
     }
@@ -16,6 +16,11 @@ namespace skyline::crypto {
       public:
         KeyStore(const std::string &rootPath);
 
+        /**
+         * @return A key store for the key files in rootPath, this is shared process-wide and is only parsed again once either of the files has been modified
+         */
+        static std::shared_ptr<KeyStore> Get(const std::string &rootPath);
+
         using Key128 = std::array<u8, 16>;
         using Key256 = std::array<u8, 32>;
         using IndexedKeys128 = std::array<std::optional<Key128>, 20>;
@@ -27,18 +32,7 @@ namespace skyline::crypto {
         IndexedKeys128 areaKeyOcean;
         IndexedKeys128 areaKeySystem;
       private:
-        std::map<Key128, Key128> titleKeys;
-
-        std::unordered_map<std::string_view, std::optional<Key256> &> key256Names{
-            {"header_key", headerKey}
-        };
-
-        std::unordered_map<std::string_view, IndexedKeys128 &> indexedKey128Names{
-            {"titlekek_", titleKek},
-            {"key_area_key_application_", areaKeyApplication},
-            {"key_area_key_ocean_", areaKeyOcean},
-            {"key_area_key_system_", areaKeySystem}
-        };
+        std::vector<std::pair<Key128, Key128>> titleKeys; //!< A flat array of rights IDs and their title keys sorted by the rights ID, it's searched with a binary search
 
         using ReadPairsCallback = void (skyline::crypto::KeyStore::*)(std::string_view, std::string_view);
 
@@ -49,9 +43,9 @@ namespace skyline::crypto {
         void PopulateKeys(std::string_view keyName, std::string_view value);
 
       public:
-        inline std::optional<Key128> GetTitleKey(const Key128 &title) {
-            auto it{titleKeys.find(title)};
-            if (it == titleKeys.end())
+        inline std::optional<Key128> GetTitleKey(const Key128 &title) const {
+            auto it{std::lower_bound(titleKeys.begin(), titleKeys.end(), title, [](const auto &pair, const Key128 &title) { return pair.first < title; })};
+            if (it == titleKeys.end() || it->first != title)
                 return std::nullopt;
             return it->second;
         }
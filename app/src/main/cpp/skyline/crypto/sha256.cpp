@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_neon.h>
+#include <mbedtls/sha256.h>
+#include "sha256.h"
+
+#define SHA_TARGET __attribute__((target("crypto"))) //!< The ARMv8 Crypto Extensions are only enabled for the functions which use them, they're selected at runtime
+
+namespace skyline::crypto {
+    constexpr size_t BlockSize = 0x40; //!< The size of a SHA-256 message block in bytes
+
+    constexpr std::array<u32, 64> RoundConstants{
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+        0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+        0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+        0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+        0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+        0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+        0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+        0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+    }; //!< The constants that are added to the message schedule in every round
+
+    /**
+     * @return If the CPU supports the ARMv8 Crypto Extensions SHA-256 instructions
+     */
+    bool HasHardwareSha256() {
+        static const bool supported{static_cast<bool>(getauxval(AT_HWCAP) & HWCAP_SHA2)};
+        return supported;
+    }
+
+    /**
+     * @brief Updates the hash state with a number of consecutive message blocks
+     * @note Every iteration of the round loop does 4 rounds, the message schedule is extended 4 words at a time for the first 48 rounds
+     */
+    SHA_TARGET void ProcessBlocks(std::array<u32, 8> &state, const u8 *data, size_t count) {
+        uint32x4_t abcd{vld1q_u32(state.data())}, efgh{vld1q_u32(state.data() + 4)};
+
+        for (; count; count--, data += BlockSize) {
+            std::array<uint32x4_t, 4> schedule;
+            for (size_t index{}; index < schedule.size(); index++)
+                schedule[index] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + (index * sizeof(uint32x4_t)))));
+
+            uint32x4_t blockAbcd{abcd}, blockEfgh{efgh};
+            for (size_t round{}; round < RoundConstants.size() / 4; round++) {
+                auto &words{schedule[round % 4]};
+                uint32x4_t roundWords{vaddq_u32(words, vld1q_u32(RoundConstants.data() + (round * 4)))};
+                if (round < 12)
+                    words = vsha256su1q_u32(vsha256su0q_u32(words, schedule[(round + 1) % 4]), schedule[(round + 2) % 4], schedule[(round + 3) % 4]);
+
+                uint32x4_t previousAbcd{abcd};
+                abcd = vsha256hq_u32(abcd, efgh, roundWords);
+                efgh = vsha256h2q_u32(efgh, previousAbcd, roundWords);
+            }
+
+            abcd = vaddq_u32(abcd, blockAbcd);
+            efgh = vaddq_u32(efgh, blockEfgh);
+        }
+
+        vst1q_u32(state.data(), abcd);
+        vst1q_u32(state.data() + 4, efgh);
+    }
+
+    Sha256Hash Sha256(std::span<const u8> data) {
+        Sha256Hash hash;
+        if (!HasHardwareSha256()) {
+            mbedtls_sha256_ret(data.data(), data.size(), hash.data(), 0);
+            return hash;
+        }
+
+        std::array<u32, 8> state{0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+        size_t wholeBlocks{data.size() / BlockSize};
+        ProcessBlocks(state, data.data(), wholeBlocks);
+
+        // The remaining data is padded with a set bit followed by zeroes and the big-endian length of the message in bits, this spills into another block if it doesn't fit
+        std::array<u8, BlockSize * 2> tail{};
+        size_t remaining{data.size() - (wholeBlocks * BlockSize)};
+        if (remaining)
+            std::memcpy(tail.data(), data.data() + (wholeBlocks * BlockSize), remaining);
+        tail[remaining] = 0x80;
+
+        size_t tailSize{remaining + 1 + sizeof(u64) > BlockSize ? BlockSize * 2 : BlockSize};
+        u64 bitLength{__builtin_bswap64(static_cast<u64>(data.size()) * 8)};
+        std::memcpy(tail.data() + tailSize - sizeof(u64), &bitLength, sizeof(u64));
+        ProcessBlocks(state, tail.data(), tailSize / BlockSize);
+
+        for (size_t index{}; index < state.size(); index++) {
+            u32 word{__builtin_bswap32(state[index])};
+            std::memcpy(hash.data() + (index * sizeof(u32)), &word, sizeof(u32));
+        }
+        return hash;
+    }
+}
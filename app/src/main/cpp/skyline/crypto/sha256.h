@@ -0,0 +1,18 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <array>
+#include <span>
+#include <common.h>
+
+namespace skyline::crypto {
+    using Sha256Hash = std::array<u8, 0x20>; //!< A SHA-256 hash
+
+    /**
+     * @return The SHA-256 hash of the data
+     * @note The hash is calculated with the ARMv8 Crypto Extensions when the CPU supports them, mbedtls is used otherwise
+     */
+    Sha256Hash Sha256(std::span<const u8> data);
+}
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "footprint.h"
+
+namespace skyline::footprint {
+    std::array<std::atomic<u64>, static_cast<size_t>(Subsystem::Count)> Usage{};
+
+    u64 GetTotal() {
+        u64 total{};
+        for (auto &usage : Usage)
+            total += usage.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    std::string Format() {
+        constexpr std::array<std::string_view, static_cast<size_t>(Subsystem::Count)> SubsystemNames{
+            "Texture",
+            "VFS Cache",
+            "Audio",
+            "Pushbuffer",
+            "Patch",
+        };
+
+        constexpr u64 KiB{1024};
+        std::string output{fmt::format("Total: {} KiB", GetTotal() / KiB)};
+        for (size_t subsystem{}; subsystem < SubsystemNames.size(); subsystem++)
+            fmt::format_to(std::back_inserter(output), ", {}: {} KiB", SubsystemNames[subsystem], Usage[subsystem].load(std::memory_order_relaxed) / KiB);
+        return output;
+    }
+
+    void Reset() {
+        for (auto &usage : Usage)
+            usage.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "common.h"
+
+namespace skyline::footprint {
+    /**
+     * @brief The subsystems of the emulator that host memory is accounted to
+     */
+    enum class Subsystem : u8 {
+        Texture, //!< The host copies of guest textures
+        VfsCache, //!< Decrypted and decompressed blocks cached by VFS backings
+        Audio, //!< The voices of audio renderers along with their decoded sample windows
+        Pushbuffer, //!< Copies of pushbuffer segments that aren't contiguous on the host
+        Patch, //!< The patch sections of loaded executables
+        Count,
+    };
+
+    extern std::array<std::atomic<u64>, static_cast<size_t>(Subsystem::Count)> Usage; //!< The amount of host memory in use by every subsystem in bytes
+
+    inline void Add(Subsystem subsystem, u64 size) {
+        Usage[static_cast<size_t>(subsystem)].fetch_add(size, std::memory_order_relaxed);
+    }
+
+    inline void Remove(Subsystem subsystem, u64 size) {
+        Usage[static_cast<size_t>(subsystem)].fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    inline u64 Get(Subsystem subsystem) {
+        return Usage[static_cast<size_t>(subsystem)].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return The total amount of host memory accounted to all subsystems in bytes
+     */
+    u64 GetTotal();
+
+    /**
+     * @return A human-readable breakdown of the memory used by every subsystem
+     */
+    std::string Format();
+
+    /**
+     * @brief Resets the usage of all subsystems, this must only be done when no accounted memory is alive such as prior to emulation starting
+     */
+    void Reset();
+
+    /**
+     * @brief An allocator that accounts all memory it allocates to a subsystem, this is used with containers that hold large amounts of emulator data
+     */
+    template<typename Type, Subsystem subsystem>
+    struct Allocator {
+        using value_type = Type;
+
+        template<typename Other>
+        struct rebind {
+            using other = Allocator<Other, subsystem>;
+        };
+
+        constexpr Allocator() noexcept = default;
+
+        template<typename Other>
+        constexpr Allocator(const Allocator<Other, subsystem> &) noexcept {}
+
+        Type *allocate(size_t count) {
+            auto pointer{std::allocator<Type>{}.allocate(count)};
+            Add(subsystem, count * sizeof(Type));
+            return pointer;
+        }
+
+        void deallocate(Type *pointer, size_t count) noexcept {
+            std::allocator<Type>{}.deallocate(pointer, count);
+            Remove(subsystem, count * sizeof(Type));
+        }
+
+        template<typename Other>
+        constexpr bool operator==(const Allocator<Other, subsystem> &) const noexcept {
+            return true;
+        }
+    };
+
+    template<typename Type, Subsystem subsystem>
+    using Vector = std::vector<Type, Allocator<Type, subsystem>>;
+}
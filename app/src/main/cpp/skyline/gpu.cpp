@@ -3,76 +3,182 @@
 
 #include "gpu.h"
 #include "jvm.h"
+#include <fstream>
+#include <sys/stat.h>
 #include <kernel/types/KProcess.h>
-#include <android/native_window_jni.h>
+#include <os.h>
+#include "perf_stats.h"
+#include "thread_priority.h"
+#include "headless.h"
+#include "cache_registry.h"
+#include "gpu/surface_gate.h"
 
 extern bool Halt;
-extern jobject Surface;
-extern skyline::u16 fps;
-extern skyline::u32 frametime;
 
 namespace skyline::gpu {
-    GPU::GPU(const DeviceState &state) : state(state), memoryManager(state), gpfifo(state), fermi2D(std::make_shared<engine::Engine>(state)), keplerMemory(std::make_shared<engine::Engine>(state)), maxwell3D(std::make_shared<engine::Maxwell3D>(state)), maxwellCompute(std::make_shared<engine::Engine>(state)), maxwellDma(std::make_shared<engine::Engine>(state)), window(ANativeWindow_fromSurface(state.jvm->GetEnv(), Surface)), vsyncEvent(std::make_shared<kernel::type::KEvent>(state)), bufferEvent(std::make_shared<kernel::type::KEvent>(state)) {
-        ANativeWindow_acquire(window);
-        resolution.width = static_cast<u32>(ANativeWindow_getWidth(window));
-        resolution.height = static_cast<u32>(ANativeWindow_getHeight(window));
-        format = ANativeWindow_getFormat(window);
+    GPU::GPU(const DeviceState &state) : state(state), presentationQueue(state.settings->Get().presentationDepth, state.settings->Get().latestFrame), memoryManager(state), textureCache(state), bufferCache(state), shaderCache(state), queryManager(state), fermi2D(std::make_shared<engine::Fermi2D>(state)), keplerMemory(std::make_shared<engine::KeplerMemory>(state)), maxwell3D(std::make_shared<engine::Maxwell3D>(state)), maxwellCompute(std::make_shared<engine::MaxwellCompute>(state)), maxwellDma(std::make_shared<engine::MaxwellDma>(state)), window(), vsyncEvent(std::make_shared<kernel::type::KEvent>(state)), bufferEvent(std::make_shared<kernel::type::KEvent>(state)), scheduler(vsyncEvent, state.settings->Get().speedLimit, state.settings->Get().frameSkip), host1x(state), channelScheduler(state) {
+        if (!headless::HeadlessOptions.enabled) {
+            // The Surface can be destroyed right before emulation starts, presentation can't be initialized without one
+            HostSurface.Wait();
+            HostSurface.Poll(surfaceGeneration, window);
+            if (!window)
+                throw exception("Emulation was halted prior to a Surface being available");
+
+            resolution.width = static_cast<u32>(ANativeWindow_getWidth(window));
+            resolution.height = static_cast<u32>(ANativeWindow_getHeight(window));
+            format = ANativeWindow_getFormat(window);
+
+            try {
+                presentation = std::make_unique<PresentationEngine>(state, window);
+            } catch (const std::exception &e) {
+                state.logger->Warn("Falling back to CPU presentation as Vulkan presentation couldn't be initialized: {}", e.what());
+            }
+        } else {
+            // Frames are presented to a null sink when headless, the resolution is only used to describe the display to the guest
+            resolution = {constant::HandheldResolutionW, constant::HandheldResolutionH};
+            if (headless::HeadlessOptions.frameDumpInterval) {
+                frameDumpDirectory = state.os->appFilesPath + "frames/";
+                mkdir(frameDumpDirectory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+            }
+            state.logger->Info("Running headless, frames won't be displayed");
+        }
+
+        if (state.settings->Get().gpuCapture) {
+            auto directory{state.os->appFilesPath + "captures/"};
+            mkdir(directory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+
+            auto path{fmt::format("{}{}.skgc", directory, std::time(nullptr))};
+            try {
+                recorder = std::make_unique<capture::Recorder>(path);
+                memoryManager.recorder = recorder.get();
+                state.logger->Info("Capturing GPU commands to {}", path);
+            } catch (const std::exception &e) {
+                state.logger->Warn("GPU capture is disabled: {}", e.what());
+            }
+        }
+
         vsyncEvent->Signal();
     }
 
     GPU::~GPU() {
-        ANativeWindow_release(window);
+        presentation.reset(); // The swapchain must be destroyed prior to the window it presents to
+        if (window)
+            ANativeWindow_release(window);
+    }
+
+    void GPU::DumpFrame(const Texture &texture) {
+        auto path{fmt::format("{}{}_{}x{}.raw", frameDumpDirectory, presentedFrames, texture.dimensions.width, texture.dimensions.height)};
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(texture.backing.data()), static_cast<std::streamsize>(texture.backing.size()));
+        if (!file)
+            state.logger->Warn("Failed to dump frame {} to {}", presentedFrames, path);
     }
 
     void GPU::Loop() {
-        gpfifo.Run();
-        vsyncEvent->Signal();
+        // There's no window to update when headless, frames are presented regardless of the Surface
+        ANativeWindow *surfaceWindow;
+        if (!headless::HeadlessOptions.enabled && HostSurface.Poll(surfaceGeneration, surfaceWindow)) {
+            if (surfaceWindow != window) {
+                if (window)
+                    ANativeWindow_release(window);
+                window = surfaceWindow;
+                if (window && presentation)
+                    presentation->UpdateWindow(window);
+            } else if (surfaceWindow) {
+                ANativeWindow_release(surfaceWindow); // The Surface was only resized, the swapchain is recreated by the presentation engine once it's out of date
+            }
 
-        if (surfaceUpdate) {
-            if (Surface == nullptr)
-                return;
-            window = ANativeWindow_fromSurface(state.jvm->GetEnv(), Surface);
-            ANativeWindow_acquire(window);
-            resolution.width = static_cast<u32>(ANativeWindow_getWidth(window));
-            resolution.height = static_cast<u32>(ANativeWindow_getHeight(window));
-            format = ANativeWindow_getFormat(window);
-            surfaceUpdate = false;
-        } else if (Surface == nullptr) {
-            surfaceUpdate = true;
-            return;
+            if (window) {
+                resolution.width = static_cast<u32>(ANativeWindow_getWidth(window));
+                resolution.height = static_cast<u32>(ANativeWindow_getHeight(window));
+                format = ANativeWindow_getFormat(window);
+            }
         }
 
-        if (!presentationQueue.empty()) {
-            auto &texture = presentationQueue.front();
-            presentationQueue.pop();
+        if (!window && !headless::HeadlessOptions.enabled)
+            return;
 
-            auto textureFormat = texture->GetAndroidFormat();
-            if (resolution != texture->dimensions || textureFormat != format) {
-                ANativeWindow_setBuffersGeometry(window, texture->dimensions.width, texture->dimensions.height, textureFormat);
-                resolution = texture->dimensions;
-                format = textureFormat;
-            }
+        PresentationFrame frame;
+        if (presentationQueue.Pop(frame)) {
+            auto &texture = frame.texture;
 
-            ANativeWindow_Buffer windowBuffer;
-            ARect rect;
+            // The acquire fences are waited on so that any GPU work rendering to the frame is done prior to it being presented
+            for (const auto &fence : frame.fences)
+                if (fence.id < constant::MaxHwSyncpointCount && !syncpoints.at(fence.id).Wait(fence.value, std::chrono::milliseconds(100)))
+                    state.logger->Warn("Presenting frame without its fence being reached: Syncpoint {} Value {}", fence.id, fence.value);
 
-            ANativeWindow_lock(window, &windowBuffer, &rect);
-            std::memcpy(windowBuffer.bits, texture->backing.data(), texture->backing.size());
-            ANativeWindow_unlockAndPost(window);
+            // A skipped frame is released prior to being deswizzled, its contents are copied by the next frame that's presented from the same buffer
+            if (scheduler.ShouldSkip(!presentationQueue.Empty())) {
+                texture->releaseCallback();
+                return;
+            }
+
+            // The guest framebuffer is copied once the fences have been reached, this is done prior to waiting for the display so the copy doesn't delay the present
+            texture->CompleteHostSynchronization();
 
-            vsyncEvent->Signal();
+            // Presentation only reads the host copy of the frame from here on, so the buffer is handed back to the guest right away and it can render the next frame while this one is being presented
             texture->releaseCallback();
 
-            if (frameTimestamp) {
-                auto now = util::GetTimeNs();
+            if (!scheduler.WaitForPresent(frame.swapInterval, !presentationQueue.Empty()))
+                return;
+
+            {
+                TRACE_SECTION("GPU::Present");
+                perf::ScopedTimer timer(perf::Timer::Present);
+                if (!window) {
+                    if (headless::HeadlessOptions.frameDumpInterval && presentedFrames % headless::HeadlessOptions.frameDumpInterval == 0)
+                        DumpFrame(*texture);
+                } else if (presentation) {
+                    presentation->Present(*texture);
+                } else {
+                    auto textureFormat = texture->GetAndroidFormat();
+                    if (resolution != texture->dimensions || textureFormat != format) {
+                        ANativeWindow_setBuffersGeometry(window, texture->dimensions.width, texture->dimensions.height, textureFormat);
+                        resolution = texture->dimensions;
+                        format = textureFormat;
+                    }
 
-                frametime = static_cast<u32>((now - frameTimestamp) / 10000); // frametime / 100 is the real ms value, this is to retain the first two decimals
-                fps = static_cast<u16>(constant::NsInSecond / (now - frameTimestamp));
+                    ANativeWindow_Buffer windowBuffer;
+                    ARect rect;
 
-                frameTimestamp = now;
-            } else {
-                frameTimestamp = util::GetTimeNs();
+                    ANativeWindow_lock(window, &windowBuffer, &rect);
+
+                    texture->CopyToWindow(reinterpret_cast<u8 *>(windowBuffer.bits), static_cast<u32>(windowBuffer.stride), static_cast<u32>(windowBuffer.height));
+
+                    ANativeWindow_unlockAndPost(window);
+                }
+            }
+
+            presentedFrames++;
+            auto frameTime{scheduler.OnPresent()};
+
+            u32 threadCount{};
+            {
+                std::lock_guard lock(state.process->threadMutex);
+                for (const auto &[tid, thread] : state.process->threads)
+                    if (thread->status == kernel::type::KThread::Status::Running)
+                        threadCount++;
             }
+            perf::Monitor.Publish(frameTime, threadCount);
+            headless::Benchmark.OnFrame(frameTime);
+
+            // The threads in the hint session work on a frame in parallel, so the frame's work is the longest that any stage of the pipeline took for it
+            // The SVC time is accumulated across all workers which makes it an upper bound of the time spent by any one of them
+            auto &statistics{perf::Monitor.block};
+            auto workDuration{std::max({statistics.svcTime, statistics.gpuTime, statistics.presentTime + statistics.deswizzleTime})};
+            priority::Hints.SetTargetDuration(priority::constant::DefaultFrameDuration * std::max<u64>(frame.swapInterval, 1));
+            priority::Hints.ReportDuration(static_cast<u64>(workDuration) * 1000);
+
+            if (state.settings->Get().thermalFrameSkip && thermalMonitor.Update()) {
+                scheduler.SetThermalFrameSkip(thermalMonitor.IsThrottling());
+                state.logger->Info("Thermal headroom is {:.2f}, {} frame skipping", thermalMonitor.GetHeadroom(), thermalMonitor.IsThrottling() ? "enabling" : "disabling");
+            }
+            cache::Registry.EnforceBudget(static_cast<size_t>(state.settings->Get().cacheBudget) * 1024 * 1024);
+            state.os->saveStates.Poll();
         }
     }
+
+    bool GPU::IsFormatSupported(vk::Format format) {
+        return presentation && presentation->IsFormatSupported(format);
+    }
 }
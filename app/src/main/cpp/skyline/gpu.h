@@ -3,17 +3,31 @@
 
 #pragma once
 
-#include <queue>
 #include <android/native_window.h>
 #include <kernel/ipc.h>
 #include <kernel/types/KEvent.h>
+#include <thermal.h>
 #include <services/nvdrv/devices/nvmap.h>
 #include "gpu/texture.h"
+#include "gpu/texture_cache.h"
+#include "gpu/buffer_cache.h"
+#include "gpu/shader_cache.h"
+#include "gpu/pipeline_cache.h"
+#include "gpu/query_manager.h"
+#include "gpu/presentation_engine.h"
+#include "gpu/presentation_scheduler.h"
+#include "gpu/presentation_queue.h"
 #include "gpu/memory_manager.h"
 #include "gpu/gpfifo.h"
+#include "gpu/capture.h"
 #include "gpu/syncpoint.h"
+#include "gpu/host1x/host1x.h"
 #include "gpu/engines/engine.h"
+#include "gpu/engines/fermi_2d.h"
+#include "gpu/engines/kepler_memory.h"
 #include "gpu/engines/maxwell_3d.h"
+#include "gpu/engines/maxwell_compute.h"
+#include "gpu/engines/maxwell_dma.h"
 
 namespace skyline::gpu {
     /**
@@ -22,25 +36,41 @@ namespace skyline::gpu {
      */
     class GPU {
       private:
-        ANativeWindow *window; //!< The ANativeWindow to render to
+        ANativeWindow *window; //!< The ANativeWindow to render to, this is nullptr when headless
         const DeviceState &state; //!< The state of the device
-        bool surfaceUpdate{}; //!< If the surface needs to be updated
-        u64 frameTimestamp{}; //!< The timestamp of the last frame being shown
+        u32 surfaceGeneration{}; //!< The generation of HostSurface that window was last updated to
+        std::unique_ptr<PresentationEngine> presentation; //!< The Vulkan presentation engine, this is nullptr if Vulkan presentation isn't supported in which case frames are copied into the window by the CPU
+        u64 presentedFrames{}; //!< The amount of frames that have been presented
+        std::string frameDumpDirectory; //!< The directory frames are dumped into when headless
+        thermal::HeadroomMonitor thermalMonitor; //!< The monitor of the thermal headroom, frame skipping is enabled while it considers the device to be about to throttle
+
+        /**
+         * @brief Writes the contents of a presented frame into a file in the frame dump directory, they're written as-is in the host format of the texture
+         */
+        void DumpFrame(const Texture &texture);
 
       public:
-        std::queue<std::shared_ptr<PresentationTexture>> presentationQueue; //!< A queue of all the PresentationTextures to be posted to the display
+        PresentationQueue presentationQueue; //!< A queue of all the frames to be posted to the display
         texture::Dimensions resolution{}; //!< The resolution of the surface
         i32 format{}; //!< The format of the display window
-        std::shared_ptr<kernel::type::KEvent> vsyncEvent; //!< This KEvent is triggered every time a frame is drawn
+        std::shared_ptr<kernel::type::KEvent> vsyncEvent; //!< This KEvent is triggered on every display refresh
         std::shared_ptr<kernel::type::KEvent> bufferEvent; //!< This KEvent is triggered every time a buffer is freed
+        PresentationScheduler scheduler; //!< The scheduler which paces presentation to the display refresh
+        std::unique_ptr<capture::Recorder> recorder; //!< The recorder for GPU captures, this is nullptr unless GPU capture is enabled
         vmm::MemoryManager memoryManager; //!< The GPU Virtual Memory Manager
-        std::shared_ptr<engine::Engine> fermi2D;
+        TextureCache textureCache; //!< The cache of all guest textures which tracks guest writes to them
+        BufferCache bufferCache; //!< The cache of all guest vertex and index buffers which tracks guest writes to them
+        ShaderCache shaderCache; //!< The cache of all guest shaders and their translations
+        PipelineCache pipelineCache; //!< The cache of all pipelines used by draws, this is only accessed by the GPFIFO worker thread
+        QueryManager queryManager; //!< The counters and pending reports of queries, this is only accessed by the GPFIFO worker thread
+        std::shared_ptr<engine::Fermi2D> fermi2D;
         std::shared_ptr<engine::Maxwell3D> maxwell3D;
-        std::shared_ptr<engine::Engine> maxwellCompute;
-        std::shared_ptr<engine::Engine> maxwellDma;
-        std::shared_ptr<engine::Engine> keplerMemory;
-        gpfifo::GPFIFO gpfifo;
+        std::shared_ptr<engine::MaxwellCompute> maxwellCompute;
+        std::shared_ptr<engine::MaxwellDma> maxwellDma;
+        std::shared_ptr<engine::KeplerMemory> keplerMemory;
         std::array<Syncpoint, constant::MaxHwSyncpointCount> syncpoints{};
+        host1x::Host1x host1x; //!< The multimedia engines and their channels
+        gpfifo::ChannelScheduler channelScheduler; //!< The scheduler of all GPFIFO channels, this is declared last so the worker thread is stopped before any state it uses is destroyed
 
         /**
          * @param window The ANativeWindow to render to
@@ -56,5 +86,10 @@ namespace skyline::gpu {
          * @brief The loop that executes routine GPU functions
          */
         void Loop();
+
+        /**
+         * @return If the host GPU supports sampling textures of the supplied format, this is always false when there's no Vulkan device
+         */
+        bool IsFormatSupported(vk::Format format);
     };
 }
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <arm_neon.h>
+#include <common.h>
+
+namespace skyline::gpu {
+    // Reference on Block-linear tiling: https://gist.github.com/PixelyIon/d9c35050af0ef5690566ca9f0965bc32
+    constexpr u8 GobWidth = 64; //!< The width of a GOB in bytes
+    constexpr u8 GobHeight = 8; //!< The height of a GOB in lines
+    constexpr u16 GobSize = 512; //!< The size of a GOB in bytes, it is made up of 32 16-byte sectors arranged in 2 lines by 4 sectors
+    constexpr u8 GobSectorWidth = 16; //!< The width of a sector in a GOB in bytes, the bytes of a sector are contiguous in memory
+
+    /**
+     * @brief This holds the offsets of the 4 sectors making up each line of a GOB relative to the start of the GOB
+     */
+    constexpr auto GobLineSectorOffsets = [] {
+        std::array<std::array<u16, 4>, GobHeight> table{};
+        for (u32 index = 0; index < 32; index++) {
+            u32 xT = ((index << 3) & 0b10000) | ((index << 1) & 0b100000); // Morton-Swizzle on the X-axis
+            u32 yT = ((index >> 1) & 0b110) | (index & 0b1); // Morton-Swizzle on the Y-axis
+            table[yT][xT / GobSectorWidth] = static_cast<u16>(index * GobSectorWidth);
+        }
+        return table;
+    }();
+
+    /**
+     * @param x The offset of the byte on the X-axis in bytes, this must be less than GobWidth
+     * @param y The offset of the byte on the Y-axis in lines, this must be less than GobHeight
+     * @return The offset of the byte relative to the start of the GOB
+     */
+    constexpr u16 GetGobOffset(u32 x, u32 y) {
+        return static_cast<u16>(GobLineSectorOffsets[y][x / GobSectorWidth] + (x % GobSectorWidth));
+    }
+
+    /**
+     * @brief Deswizzles a single GOB into linear memory, every line is assembled from its sectors in registers and written out with a single store
+     * @param lineStride The distance between two lines in the output in bytes
+     */
+    FORCE_INLINE void DeswizzleGob(const u8 *input, u8 *output, u32 lineStride) {
+        for (const auto &offsets : GobLineSectorOffsets) {
+            uint8x16x4_t sectors{vld1q_u8(input + offsets[0]), vld1q_u8(input + offsets[1]), vld1q_u8(input + offsets[2]), vld1q_u8(input + offsets[3])};
+            vst1q_u8_x4(output, sectors);
+            output += lineStride;
+        }
+    }
+
+    /**
+     * @brief Swizzles linear memory into a single GOB, every line is read with a single load and scattered into its sectors from registers
+     * @param lineStride The distance between two lines in the input in bytes
+     */
+    FORCE_INLINE void SwizzleGob(const u8 *input, u8 *output, u32 lineStride) {
+        for (const auto &offsets : GobLineSectorOffsets) {
+            auto sectors{vld1q_u8_x4(input)};
+            vst1q_u8(output + offsets[0], sectors.val[0]);
+            vst1q_u8(output + offsets[1], sectors.val[1]);
+            vst1q_u8(output + offsets[2], sectors.val[2]);
+            vst1q_u8(output + offsets[3], sectors.val[3]);
+            input += lineStride;
+        }
+    }
+
+    /**
+     * @param width The width of the surface in bytes
+     * @param height The height of the surface in lines
+     * @param blockHeight The height of a block in GOBs
+     * @return The size of a block-linear surface in bytes, this includes any padding GOBs
+     */
+    constexpr size_t GetBlockLinearSize(u32 width, u32 height, u32 blockHeight) {
+        auto robHeight{GobHeight * blockHeight}; // The height of a single ROB (Row of Blocks) in lines
+        auto robBytes{static_cast<size_t>(util::AlignUp(width, GobWidth) / GobWidth) * GobSize * blockHeight}; // The size of a ROB in bytes
+        return (util::AlignUp(height, robHeight) / robHeight) * robBytes;
+    }
+
+    /**
+     * @brief Copies a range of lines of a rectangular region between a block-linear surface and pitch-linear memory
+     * @tparam ToPitch If the copy is from the block-linear surface to pitch-linear memory rather than the inverse
+     * @param blockLinear The start of the block-linear surface
+     * @param surfaceWidth The width of the surface in bytes
+     * @param blockHeight The height of a block in GOBs
+     * @param pitchLinear The start of the region in pitch-linear memory
+     * @param pitch The distance between two lines in pitch-linear memory in bytes
+     * @param originX The offset of the region in the surface on the X-axis in bytes
+     * @param originY The offset of the region in the surface on the Y-axis in lines
+     * @param width The width of the region in bytes
+     * @param start The first line of the region that is copied
+     * @param end The line after the last line of the region that is copied, this must be greater than start
+     * @note GOBs that are entirely inside the region are copied with the vectorized kernels while GOBs on its edges are copied a sector at a time
+     */
+    template<bool ToPitch>
+    void CopyBlockLinearLines(u8 *blockLinear, u32 surfaceWidth, u32 blockHeight, u8 *pitchLinear, u32 pitch, u32 originX, u32 originY, u32 width, u32 start, u32 end) {
+        auto blockBytes{static_cast<size_t>(GobSize) * blockHeight}; // The size of a block in bytes, this includes any padding GOBs
+        auto robBytes{(util::AlignUp(surfaceWidth, GobWidth) / GobWidth) * blockBytes}; // The size of a ROB in bytes, the width of a block is always 1 GOB on the Tegra X1
+        auto xStart{originX}, xEnd{originX + width};
+
+        for (u32 gobRow = (originY + start) / GobHeight; gobRow <= (originY + end - 1) / GobHeight; gobRow++) {
+            auto rowTop{gobRow * GobHeight};
+            auto lineFirst{std::max(rowTop, originY + start)}, lineLast{std::min(rowTop + GobHeight, originY + end)};
+            auto rowGob{blockLinear + (gobRow / blockHeight) * robBytes + (gobRow % blockHeight) * GobSize}; // The address of the first GOB in the row
+
+            for (u32 gobX = xStart / GobWidth; gobX <= (xEnd - 1) / GobWidth; gobX++) {
+                auto gob{rowGob + gobX * blockBytes};
+                auto gobLeft{gobX * GobWidth};
+
+                if (lineFirst == rowTop && lineLast == rowTop + GobHeight && gobLeft >= xStart && gobLeft + GobWidth <= xEnd) {
+                    auto linear{pitchLinear + static_cast<size_t>(rowTop - originY) * pitch + (gobLeft - originX)};
+                    if constexpr (ToPitch)
+                        DeswizzleGob(gob, linear, pitch);
+                    else
+                        SwizzleGob(linear, gob, pitch);
+                    continue;
+                }
+
+                auto gobXStart{std::max(gobLeft, xStart)}, gobXEnd{std::min(gobLeft + GobWidth, xEnd)};
+                for (u32 line = lineFirst; line < lineLast; line++) {
+                    auto linearLine{pitchLinear + static_cast<size_t>(line - originY) * pitch};
+                    for (u32 x = gobXStart; x < gobXEnd;) {
+                        auto sectorEnd{std::min(util::AlignDown(x, GobSectorWidth) + GobSectorWidth, gobXEnd)};
+                        auto swizzled{gob + GetGobOffset(x % GobWidth, line % GobHeight)};
+                        if constexpr (ToPitch)
+                            std::memcpy(linearLine + (x - originX), swizzled, sectorEnd - x);
+                        else
+                            std::memcpy(swizzled, linearLine + (x - originX), sectorEnd - x);
+                        x = sectorEnd;
+                    }
+                }
+            }
+        }
+    }
+}
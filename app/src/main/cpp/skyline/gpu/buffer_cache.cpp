@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/mman.h>
+#include <asm/unistd.h>
+#include <nce.h>
+#include <os.h>
+#include <gpu.h>
+#include "buffer_cache.h"
+
+namespace skyline::gpu {
+    GuestBuffer::GuestBuffer(u64 address, u64 size, std::optional<u64> cpuAddress) : address(address), size(size), cpuAddress(cpuAddress), contents(size) {
+        // A buffer starts out with all of its pages dirty and none of them protected, they're protected when it's first synchronized
+        if (cpuAddress)
+            dirtyPages.resize((util::AlignUp(*cpuAddress + size, PAGE_SIZE) - util::AlignDown(*cpuAddress, PAGE_SIZE)) / PAGE_SIZE, true);
+    }
+
+    BufferCache::BufferCache(const DeviceState &state) : state(state), streamBuffer(constant::StreamBufferSize) {}
+
+    std::span<u8> BufferCache::AllocateStream(size_t size) {
+        if (streamOffset + size > streamBuffer.size())
+            streamOffset = 0;
+
+        auto span{std::span(streamBuffer).subspan(streamOffset, size)};
+        streamOffset = util::AlignUp(streamOffset + size, constant::StreamBufferAlignment);
+        return span;
+    }
+
+    std::shared_ptr<GuestBuffer> BufferCache::Get(u64 address, u64 size) {
+        std::lock_guard guard(mutex);
+
+        u64 start{address}, end{address + size};
+        auto buffer{buffers.upper_bound(address)};
+        if (buffer != buffers.begin() && std::prev(buffer)->second->address + std::prev(buffer)->second->size > address) {
+            buffer--;
+            if (buffer->second->address + buffer->second->size >= end)
+                return buffer->second;
+        }
+
+        // Any buffers overlapping the region are replaced with a single buffer covering all of them, draws commonly use different parts of the same guest buffer
+        while (buffer != buffers.end() && buffer->first < end) {
+            start = std::min(start, buffer->second->address);
+            end = std::max(end, buffer->second->address + buffer->second->size);
+            buffer = buffers.erase(buffer);
+        }
+
+        auto newBuffer{std::make_shared<GuestBuffer>(start, end - start, state.gpu->memoryManager.GetCpuAddress(start, end - start))};
+        buffers.emplace(start, newBuffer);
+        return newBuffer;
+    }
+
+    std::span<u8> BufferCache::Synchronize(GuestBuffer &buffer) {
+        std::lock_guard guard(mutex);
+        auto &memoryManager{state.gpu->memoryManager};
+
+        // A buffer that can't be write-tracked has to be copied in its entirety on every use
+        if (!buffer.cpuAddress) {
+            memoryManager.Read(buffer.contents.data(), buffer.address, buffer.size);
+            buffer.MarkModified(0, buffer.size);
+            return buffer.contents;
+        }
+
+        auto pageBase{util::AlignDown(*buffer.cpuAddress, PAGE_SIZE)};
+        if (!buffer.streamed) {
+            // Writes that the guest resolved on its own are only recorded in the fault table, they're applied to every buffer on the page the same way a fault handled by the kernel is
+            for (size_t page{}; page < buffer.dirtyPages.size(); page++)
+                if (state.nce->CollectDirtyPage(pageBase + (page * PAGE_SIZE)))
+                    MarkDirty(pageBase + (page * PAGE_SIZE));
+
+            if (std::find(buffer.dirtyPages.begin(), buffer.dirtyPages.end(), true) == buffer.dirtyPages.end()) {
+                buffer.dirtyStreak = 0;
+                return buffer.contents;
+            }
+
+            // The remaining protected pages of a buffer that's streamed are left as-is, they're only unprotected when the guest writes to them
+            if (++buffer.dirtyStreak >= constant::StreamDirtyThreshold && buffer.size <= streamBuffer.size() / 4)
+                buffer.streamed = true;
+        }
+
+        if (buffer.streamed) {
+            auto span{AllocateStream(buffer.size)};
+            memoryManager.Read(span.data(), buffer.address, buffer.size);
+            return span;
+        }
+
+        struct PageRun {
+            u64 address; //!< The CPU address of the first page in the run
+            u64 size;
+        };
+        std::vector<PageRun> runs;
+        std::vector<GuestSyscall> protect;
+
+        for (size_t page{}; page < buffer.dirtyPages.size();) {
+            if (!buffer.dirtyPages[page]) {
+                page++;
+                continue;
+            }
+
+            auto runStart{page};
+            while (page < buffer.dirtyPages.size() && buffer.dirtyPages[page])
+                buffer.dirtyPages[page++] = false;
+
+            PageRun run{pageBase + (runStart * PAGE_SIZE), (page - runStart) * PAGE_SIZE};
+            runs.push_back(run);
+
+            // Only write access is removed from each block in the run, executable pages are flagged so the guest restores PROT_EXEC along with write access when it resolves a fault on them
+            // Blocks the guest can't write to aren't protected at all, their contents can't change and the guest resolving a fault on them would make them writable
+            for (u64 address{run.address}, end{run.address + run.size}; address < end;) {
+                auto descriptor{state.os->memory.Get(address)};
+                u64 blockEnd{descriptor ? std::min(end, descriptor->block.address + descriptor->block.size) : end};
+                int permission{descriptor ? descriptor->block.permission.Get() : PROT_READ | PROT_WRITE};
+
+                if (!(permission & PROT_WRITE)) {
+                    state.nce->ClearFaultFlags(address, blockEnd - address, FaultTable::WriteTracked | FaultTable::Executable);
+                    address = blockEnd;
+                    continue;
+                } else if (permission & PROT_EXEC) {
+                    state.nce->SetFaultFlags(address, blockEnd - address, FaultTable::WriteTracked | FaultTable::Executable);
+                } else {
+                    state.nce->ClearFaultFlags(address, blockEnd - address, FaultTable::Executable);
+                    state.nce->SetFaultFlags(address, blockEnd - address, FaultTable::WriteTracked);
+                }
+                protect.push_back(GuestSyscall{.number = __NR_mprotect, .arguments = {address, blockEnd - address, static_cast<u64>(permission & ~PROT_WRITE)}});
+                address = blockEnd;
+            }
+        }
+
+        // The pages are protected prior to being copied so any write during the copy faults and marks them as dirty again
+        // Pages the texture cache has protected are left alone, a render target's pages would become readable otherwise without it having been flushed
+        state.gpu->textureCache.ProtectExcludingTextures(protect);
+
+        for (const auto &run : runs) {
+            auto runStart{std::max(run.address, *buffer.cpuAddress) - *buffer.cpuAddress};
+            auto runEnd{std::min(run.address + run.size, *buffer.cpuAddress + buffer.size) - *buffer.cpuAddress};
+            memoryManager.Read(buffer.contents.data() + runStart, buffer.address + runStart, runEnd - runStart);
+            buffer.MarkModified(runStart, runEnd);
+        }
+
+        return buffer.contents;
+    }
+
+    void BufferCache::Write(u64 address, std::span<const u8> data) {
+        // Buffers on the region are updated in place below, only textures on it need to be invalidated
+        std::lock_guard guard(mutex);
+        state.gpu->memoryManager.Write(const_cast<u8 *>(data.data()), address, data.size(), false);
+
+        // Streamed buffers and ones that can't be write-tracked are read from guest memory in their entirety on every use, so only tracked ones need their host copy to be updated
+        u64 end{address + data.size()};
+        auto buffer{buffers.upper_bound(address)};
+        if (buffer != buffers.begin())
+            buffer--;
+        for (; buffer != buffers.end() && buffer->first < end; buffer++) {
+            auto &guestBuffer{*buffer->second};
+            if (guestBuffer.address + guestBuffer.size <= address || !guestBuffer.cpuAddress || guestBuffer.streamed)
+                continue;
+
+            auto start{std::max(address, guestBuffer.address)};
+            auto copyEnd{std::min(end, guestBuffer.address + guestBuffer.size)};
+            std::memcpy(guestBuffer.contents.data() + (start - guestBuffer.address), data.data() + (start - address), copyEnd - start);
+            guestBuffer.MarkModified(start - guestBuffer.address, copyEnd - guestBuffer.address);
+        }
+    }
+
+    void BufferCache::Invalidate(u64 address, u64 size) {
+        std::lock_guard guard(mutex);
+
+        for (const auto &[gpuAddress, buffer] : buffers) {
+            if (!buffer->cpuAddress)
+                continue;
+
+            auto pageBase{util::AlignDown(*buffer->cpuAddress, PAGE_SIZE)};
+            auto pageEnd{pageBase + (buffer->dirtyPages.size() * PAGE_SIZE)};
+            if (pageBase >= address + size || pageEnd <= address)
+                continue;
+
+            auto first{(std::max(pageBase, util::AlignDown(address, PAGE_SIZE)) - pageBase) / PAGE_SIZE};
+            auto last{(std::min(pageEnd, util::AlignUp(address + size, PAGE_SIZE)) - pageBase) / PAGE_SIZE};
+            std::fill(buffer->dirtyPages.begin() + first, buffer->dirtyPages.begin() + last, true);
+        }
+    }
+
+    void BufferCache::InvalidateMappings(std::span<const Region> regions) {
+        std::lock_guard guard(mutex);
+
+        // Any pages the dropped buffers write-protected are still resolved by the guest through the fault table, so they don't need to be unprotected
+        for (const auto &region : regions) {
+            auto buffer{buffers.upper_bound(region.address)};
+            if (buffer != buffers.begin() && std::prev(buffer)->second->address + std::prev(buffer)->second->size > region.address)
+                buffer--;
+
+            while (buffer != buffers.end() && buffer->first < region.address + region.size)
+                buffer = buffers.erase(buffer);
+        }
+    }
+
+    bool BufferCache::MarkDirty(u64 address) {
+        // Streamed buffers are still marked as they may have pages that were protected prior to them being streamed
+        auto page{util::AlignDown(address, PAGE_SIZE)};
+        bool tracked{};
+        for (const auto &[gpuAddress, buffer] : buffers) {
+            if (!buffer->cpuAddress)
+                continue;
+
+            auto pageBase{util::AlignDown(*buffer->cpuAddress, PAGE_SIZE)};
+            if (page >= pageBase && page < pageBase + (buffer->dirtyPages.size() * PAGE_SIZE)) {
+                buffer->dirtyPages[(page - pageBase) / PAGE_SIZE] = true;
+                tracked = true;
+            }
+        }
+        return tracked;
+    }
+
+    std::optional<BufferCache::Region> BufferCache::HandleWriteFault(u64 address) {
+        std::lock_guard guard(mutex);
+
+        if (!MarkDirty(address))
+            return std::nullopt;
+        return Region{util::AlignDown(address, PAGE_SIZE), PAGE_SIZE};
+    }
+}
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+#include "texture_cache.h"
+
+namespace skyline {
+    namespace constant {
+        constexpr size_t StreamBufferSize{0x800000}; //!< The size of the ring that streamed buffers are copied into
+        constexpr size_t StreamBufferAlignment{0x100}; //!< The alignment of every allocation from the stream buffer, this matches the largest buffer offset alignment Vulkan allows implementations to require
+        constexpr u32 StreamDirtyThreshold{4}; //!< The amount of consecutive synchronizations a buffer has to be dirty on to be streamed rather than write-tracked
+    }
+
+    namespace gpu {
+        /**
+         * @brief A buffer in the GPU address space such as a vertex or index buffer, with a host copy of its contents
+         */
+        struct GuestBuffer {
+            u64 address; //!< The address of the buffer in the GPU address space
+            u64 size; //!< The size of the buffer in bytes
+            std::optional<u64> cpuAddress; //!< The address of the buffer in the CPU address space, this is std::nullopt if it isn't contiguous in it in which case it can't be write-tracked
+            std::vector<u8> contents; //!< The host copy of the buffer, copying into this is the equivalent of an upload into a host-visible buffer
+            std::vector<bool> dirtyPages; //!< If each CPU page the buffer is on was written to since it was last synchronized, dirty pages aren't write-protected
+            u32 dirtyStreak{}; //!< The amount of consecutive synchronizations that found the buffer to be dirty
+            bool streamed{}; //!< If the buffer is copied into the stream buffer on every use rather than being write-tracked, this is for buffers that the guest rewrites before every use
+            u64 modifiedStart{}; //!< The offset of the first byte of the host copy that was modified since the renderer last uploaded it
+            u64 modifiedEnd{}; //!< The offset past the last byte of the host copy that was modified since the renderer last uploaded it, the renderer resets both offsets after uploading the range
+
+            /**
+             * @brief Extends the modified range of the host copy to include the supplied range
+             */
+            void MarkModified(u64 start, u64 end) {
+                if (modifiedStart == modifiedEnd) {
+                    modifiedStart = start;
+                    modifiedEnd = end;
+                } else {
+                    modifiedStart = std::min(modifiedStart, start);
+                    modifiedEnd = std::max(modifiedEnd, end);
+                }
+            }
+
+            GuestBuffer(u64 address, u64 size, std::optional<u64> cpuAddress);
+        };
+
+        /**
+         * @brief The BufferCache class deduplicates guest buffers by their GPU address range and tracks guest writes to them at page granularity, so only the pages that changed are copied into the host copy of a buffer
+         * @note Buffers which are dirty on every use are copied into a ring instead, as tracking them would cost a fault per page on every use
+         * @note Write faults on tracked pages are resolved by the guest through the fault table, the dirty pages it records are collected when a buffer on them is synchronized
+         */
+        class BufferCache {
+          public:
+            using Region = TextureCache::Region;
+
+          private:
+            const DeviceState &state;
+            Mutex mutex; //!< This mutex guards all members of the cache
+            std::map<u64, std::shared_ptr<GuestBuffer>> buffers; //!< A map from the GPU address of every buffer to the buffer, buffers never overlap as overlapping ones are merged
+            std::vector<u8> streamBuffer; //!< The ring that streamed buffers are copied into, it's assumed that the host GPU is done with data in it by the time it wraps around
+            size_t streamOffset{}; //!< The offset of the next allocation from the stream buffer
+
+            /**
+             * @return A span of the stream buffer which is valid until it wraps around
+             */
+            std::span<u8> AllocateStream(size_t size);
+
+            /**
+             * @brief Marks the page containing the address as dirty in all buffers on it
+             * @return If any buffer is on the page
+             * @note The mutex must be locked when calling this
+             */
+            bool MarkDirty(u64 address);
+
+          public:
+            BufferCache(const DeviceState &state);
+
+            /**
+             * @return A buffer which contains the supplied region of the GPU address space, any buffers overlapping it are merged into a single one
+             * @note The returned buffer must be synchronized prior to reading its contents
+             */
+            std::shared_ptr<GuestBuffer> Get(u64 address, u64 size);
+
+            /**
+             * @brief Copies the pages of a buffer that were written to since it was last synchronized into its host copy and write-protects them again
+             * @return A span over the current contents of the buffer in host memory, this is a part of the stream buffer for streamed buffers
+             */
+            std::span<u8> Synchronize(GuestBuffer &buffer);
+
+            /**
+             * @brief Writes data to the GPU address space on behalf of the GPU, such as for an inline constant buffer update
+             * @details The host copies of write-tracked buffers overlapping the region are updated directly, as host writes to guest memory don't fault and wouldn't mark their pages as dirty
+             */
+            void Write(u64 address, std::span<const u8> data);
+
+            /**
+             * @brief Marks all pages of buffers in a region of the CPU address space as dirty, this is used when the region is made writable in the guest for another reason
+             */
+            void Invalidate(u64 address, u64 size);
+
+            /**
+             * @brief Drops all buffers overlapping any of the supplied regions of the GPU address space, this is used when the regions are remapped as the CPU regions backing the buffers might have changed
+             */
+            void InvalidateMappings(std::span<const Region> regions);
+
+            /**
+             * @brief Handles a guest write fault by marking the page containing the address as dirty in all buffers on it, this is only reached when the guest couldn't resolve the fault itself
+             * @return The region that needs to be made writable in the guest, this is std::nullopt if the fault wasn't caused by write tracking
+             */
+            std::optional<Region> HandleWriteFault(u64 address);
+        };
+    }
+}
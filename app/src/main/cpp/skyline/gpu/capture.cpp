@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "capture.h"
+
+namespace skyline::gpu::capture {
+    Recorder::Recorder(const std::string &path) : file(path, std::ios::binary | std::ios::trunc) {
+        if (!file)
+            throw exception("Failed to open the GPU capture file at {}", path);
+
+        FileHeader header{};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    void Recorder::WriteRecord(RecordType type, std::span<const u8> header, std::span<const u8> data) {
+        RecordHeader recordHeader{type, static_cast<u32>(header.size() + data.size())};
+        file.write(reinterpret_cast<const char *>(&recordHeader), sizeof(recordHeader));
+        file.write(reinterpret_cast<const char *>(header.data()), static_cast<std::streamsize>(header.size()));
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    void Recorder::RecordMemory(u64 address, std::span<const u8> data) {
+        if (data.empty())
+            return;
+
+        auto hash{std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char *>(data.data()), data.size()))};
+
+        std::lock_guard guard(mutex);
+        auto &region{recordedRegions[address]};
+        if (region.first == data.size() && region.second == hash)
+            return;
+        region = {data.size(), hash};
+
+        MemoryRecord record{address};
+        WriteRecord(RecordType::Memory, std::span(reinterpret_cast<const u8 *>(&record), sizeof(record)), data);
+    }
+
+    void Recorder::RecordEntry(gpfifo::GpEntry gpEntry) {
+        std::lock_guard guard(mutex);
+        EntryRecord record{gpEntry};
+        WriteRecord(RecordType::Entry, std::span(reinterpret_cast<const u8 *>(&record), sizeof(record)));
+    }
+
+    void Recorder::RecordSyncpointWait(u32 id, u32 threshold) {
+        std::lock_guard guard(mutex);
+        SyncpointRecord record{id, threshold};
+        WriteRecord(RecordType::SyncpointWait, std::span(reinterpret_cast<const u8 *>(&record), sizeof(record)));
+    }
+
+    void Recorder::RecordSyncpointIncrement(u32 id, u32 increments) {
+        std::lock_guard guard(mutex);
+        SyncpointRecord record{id, increments};
+        WriteRecord(RecordType::SyncpointIncrement, std::span(reinterpret_cast<const u8 *>(&record), sizeof(record)));
+
+        // Syncpoint increments are the points at which the guest observes GPU progress, so the file is flushed to keep captures usable if emulation is abruptly terminated
+        file.flush();
+    }
+
+    Reader::Reader(const std::string &path) : file(path, std::ios::binary) {
+        if (!file)
+            throw exception("Failed to open the GPU capture file at {}", path);
+
+        FileHeader header{};
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != CaptureMagic)
+            throw exception("{} isn't a GPU capture file", path);
+        if (header.version != CaptureVersion)
+            throw exception("GPU capture version {} is unsupported, only version {} can be read", header.version, CaptureVersion);
+    }
+
+    bool Reader::Read(Record &record) {
+        RecordHeader header{};
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+            return false;
+
+        auto readPayload{[&](auto &payload) {
+            if (header.size < sizeof(payload) || !file.read(reinterpret_cast<char *>(&payload), sizeof(payload)))
+                throw exception("GPU capture record of type {} is truncated", static_cast<u32>(header.type));
+        }};
+
+        record.type = header.type;
+        switch (header.type) {
+            case RecordType::Memory: {
+                MemoryRecord memory{};
+                readPayload(memory);
+                record.address = memory.address;
+                record.data.resize(header.size - sizeof(memory));
+                if (!file.read(reinterpret_cast<char *>(record.data.data()), static_cast<std::streamsize>(record.data.size())))
+                    throw exception("GPU capture memory record at 0x{:X} is truncated", memory.address);
+                return true;
+            }
+
+            case RecordType::Entry: {
+                EntryRecord entry{};
+                readPayload(entry);
+                record.gpEntry = entry.gpEntry;
+                break;
+            }
+
+            case RecordType::SyncpointWait:
+            case RecordType::SyncpointIncrement:
+                readPayload(record.syncpoint);
+                break;
+
+            default:
+                throw exception("Unknown GPU capture record type: {}", static_cast<u32>(header.type));
+        }
+
+        return true;
+    }
+}
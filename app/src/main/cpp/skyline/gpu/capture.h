@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <fstream>
+#include <common.h>
+#include "gpfifo.h"
+
+namespace skyline::gpu::capture {
+    constexpr u32 CaptureMagic{util::MakeMagic<u32>("SKGC")}; //!< The magic at the start of every capture file
+    constexpr u32 CaptureVersion{1}; //!< The version of the capture format, this is incremented on any change to the layout of records
+
+    /**
+     * @brief The header at the start of a capture file
+     */
+    struct FileHeader {
+        u32 magic{CaptureMagic};
+        u32 version{CaptureVersion};
+    };
+    static_assert(sizeof(FileHeader) == 0x8);
+
+    enum class RecordType : u32 {
+        Memory, //!< The contents of a region of the GPU address space as they were when the GPU read them, this is followed by the data of the region
+        Entry, //!< A GP entry which was executed, the pushbuffer it references is in a prior memory record
+        SyncpointWait, //!< A wait for a syncpoint to reach a threshold which was satisfied prior to any later records
+        SyncpointIncrement, //!< An increment of a syncpoint after all prior entries were executed
+    };
+
+    /**
+     * @brief The header of a single record in a capture file, records are written in the order they are executed by the GPFIFO worker
+     */
+    struct RecordHeader {
+        RecordType type;
+        u32 size; //!< The size of the record following this header in bytes
+    };
+    static_assert(sizeof(RecordHeader) == 0x8);
+
+    struct MemoryRecord {
+        u64 address; //!< The address of the region in the GPU address space
+    };
+
+    struct EntryRecord {
+        gpfifo::GpEntry gpEntry;
+    };
+
+    struct SyncpointRecord {
+        u32 id;
+        u32 value; //!< The threshold that was waited on or the amount of increments
+    };
+
+    /**
+     * @brief The Recorder class writes every pushbuffer the GPU executes along with all guest memory it reads and syncpoint operations to a capture file
+     * @details Memory is recorded at the point the GPU reads it, a region is only recorded again if its contents have changed since the last time it was recorded. As all memory an entry uses is read prior to it completing, writing the entry after it has been executed means every memory record it depends on precedes it
+     */
+    class Recorder {
+      private:
+        std::mutex mutex; //!< Synchronizes writes to the file, memory can be read by threads other than the GPFIFO worker
+        std::ofstream file;
+        std::unordered_map<u64, std::pair<u64, size_t>> recordedRegions; //!< A map from the address of a recorded region to its size and the hash of its contents when it was last recorded
+
+        void WriteRecord(RecordType type, std::span<const u8> header, std::span<const u8> data = {});
+
+      public:
+        /**
+         * @param path The path of the capture file, any existing file at the path is overwritten
+         */
+        Recorder(const std::string &path);
+
+        /**
+         * @brief Records the contents of a region of the GPU address space if they differ from when it was last recorded
+         */
+        void RecordMemory(u64 address, std::span<const u8> data);
+
+        void RecordEntry(gpfifo::GpEntry gpEntry);
+
+        void RecordSyncpointWait(u32 id, u32 threshold);
+
+        void RecordSyncpointIncrement(u32 id, u32 increments);
+    };
+
+    /**
+     * @brief The Reader class sequentially reads the records of a capture file, this is intended for tools to analyze or replay captures
+     */
+    class Reader {
+      private:
+        std::ifstream file;
+
+      public:
+        /**
+         * @brief A single record from a capture file, only the members corresponding to its type are valid
+         */
+        struct Record {
+            RecordType type;
+            u64 address; //!< The GPU address of a memory record
+            std::vector<u8> data; //!< The contents of a memory record
+            gpfifo::GpEntry gpEntry; //!< The GP entry of an entry record
+            SyncpointRecord syncpoint; //!< The syncpoint operation of a syncpoint record
+        };
+
+        /**
+         * @throws exception If the file isn't a capture file or has an unsupported version
+         */
+        Reader(const std::string &path);
+
+        /**
+         * @brief Reads the next record from the file
+         * @return If a record was read, this is false at the end of the file
+         */
+        bool Read(Record &record);
+    };
+}
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <array>
+#include <span>
+#include <common.h>
+
+namespace skyline::gpu {
+    /**
+     * @brief A fixed-size lock-free single-producer single-consumer circular queue
+     * @tparam Type The type of elements stored in the queue
+     * @tparam Size The maximum amount of elements in the queue, this must be a power of 2
+     * @note Push must only be called from a single thread at a time and the same goes for Pop, but they can be called concurrently with each other
+     */
+    template<typename Type, size_t Size>
+    class CircularQueue {
+      private:
+        static_assert(Size && (Size & (Size - 1)) == 0, "The size of a CircularQueue must be a power of 2");
+
+        std::array<Type, Size> array{}; //!< The internal array holding the elements of the queue
+        alignas(64) std::atomic<size_t> start{}; //!< The index of the oldest element in the queue, this is only written to by the consumer
+        alignas(64) std::atomic<size_t> end{}; //!< The index after the newest element in the queue, this is only written to by the producer
+
+      public:
+        /**
+         * @brief Inserts an element at the end of the queue
+         * @return If the element was inserted, this will be false if the queue is full
+         */
+        inline bool Push(const Type &item) {
+            auto index{end.load(std::memory_order_relaxed)};
+            if (index - start.load(std::memory_order_acquire) == Size)
+                return false;
+
+            array[index & (Size - 1)] = item;
+            end.store(index + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Inserts as many of the specified items as there is space for at the end of the queue, they're reserved and published together rather than one at a time
+         * @param transform A function that converts an item into the element that's inserted
+         * @return The amount of items that were inserted, this is less than the amount of items if the queue filled up
+         */
+        template<typename Item, typename Transform>
+        inline size_t Push(std::span<Item> items, Transform transform) {
+            auto index{end.load(std::memory_order_relaxed)};
+            auto count{std::min(items.size(), Size - (index - start.load(std::memory_order_acquire)))};
+
+            for (size_t offset{}; offset < count; offset++)
+                array[(index + offset) & (Size - 1)] = transform(items[offset]);
+            end.store(index + count, std::memory_order_release);
+            return count;
+        }
+
+        /**
+         * @brief Removes the oldest element from the queue
+         * @param item The object the element is written into
+         * @return If an element was popped, this will be false if the queue is empty
+         */
+        inline bool Pop(Type &item) {
+            auto index{start.load(std::memory_order_relaxed)};
+            if (index == end.load(std::memory_order_acquire))
+                return false;
+
+            item = array[index & (Size - 1)];
+            start.store(index + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @return If the queue currently has no elements in it
+         */
+        inline bool Empty() const {
+            return start.load(std::memory_order_acquire) == end.load(std::memory_order_acquire);
+        }
+    };
+}
@@ -29,6 +29,29 @@ namespace skyline::gpu {
         bool lastCall; //!< If this is the last call in the pushbuffer entry to this specific macro
     };
 
+    /**
+     * @brief This enumerates how the method changes between successive arguments of a batched method call
+     */
+    enum class MethodIncrement {
+        Increment, //!< The method is incremented after every argument
+        NonIncrement, //!< The method stays the same for every argument
+        IncrementOnce, //!< The method is incremented after the first argument and stays the same for the rest
+    };
+
+    /**
+     * @return The method that the argument at 'index' of a batched method call is for
+     */
+    constexpr u16 GetBatchMethod(u16 method, size_t index, MethodIncrement increment) {
+        switch (increment) {
+            case MethodIncrement::Increment:
+                return static_cast<u16>(method + index);
+            case MethodIncrement::NonIncrement:
+                return method;
+            case MethodIncrement::IncrementOnce:
+                return static_cast<u16>(method + bool(index));
+        }
+    }
+
     namespace engine {
         /**
         * @brief The Engine class provides an interface that can be used to communicate with the GPU's internal engines
@@ -48,6 +71,17 @@ namespace skyline::gpu {
             virtual void CallMethod(MethodParams params) {
                 state.logger->Warn("Called method in unimplemented engine: 0x{:X} args: 0x{:X}", params.method, params.argument);
             };
+
+            /**
+            * @brief Calls a sequence of engine methods, this is equivalent to calling CallMethod for every argument but engines can override it to handle the entire batch at once
+            * @param method The method of the first argument
+            * @param arguments The arguments of every method call, this must not be empty
+            * @param increment How the method changes between successive arguments
+            */
+            virtual void CallMethodBatch(u16 method, std::span<u32> arguments, MethodIncrement increment, u32 subChannel) {
+                for (size_t index{}; index < arguments.size(); index++)
+                    CallMethod(MethodParams{GetBatchMethod(method, index, increment), arguments[index], subChannel, index == arguments.size() - 1});
+            }
         };
     }
 }
@@ -0,0 +1,349 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <cmath>
+#include <gpu.h>
+#include <gpu/block_linear.h>
+#include "fermi_2d.h"
+
+namespace skyline::gpu::engine {
+    using Color = std::array<float, 4>; //!< The normalized RGBA channels of a texel, the color channels are in linear space
+
+    float SrgbToLinear(float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSrgb(float value) {
+        return value <= 0.0031308f ? value * 12.92f : (1.055f * std::pow(value, 1.0f / 2.4f)) - 0.055f;
+    }
+
+    /**
+     * @return The normalized channels of a single texel in the supplied format
+     */
+    Color LoadTexel(vk::Format format, const u8 *texel) {
+        switch (format) {
+            case vk::Format::eR8G8B8A8Unorm:
+                return {texel[0] / 255.0f, texel[1] / 255.0f, texel[2] / 255.0f, texel[3] / 255.0f};
+            case vk::Format::eR8G8B8A8Srgb:
+                return {SrgbToLinear(texel[0] / 255.0f), SrgbToLinear(texel[1] / 255.0f), SrgbToLinear(texel[2] / 255.0f), texel[3] / 255.0f};
+            case vk::Format::eB8G8R8A8Unorm:
+                return {texel[2] / 255.0f, texel[1] / 255.0f, texel[0] / 255.0f, texel[3] / 255.0f};
+            case vk::Format::eA2B10G10R10UnormPack32: {
+                u32 value;
+                std::memcpy(&value, texel, sizeof(u32));
+                return {(value & 0x3FF) / 1023.0f, ((value >> 10) & 0x3FF) / 1023.0f, ((value >> 20) & 0x3FF) / 1023.0f, (value >> 30) / 3.0f};
+            }
+            case vk::Format::eR5G6B5UnormPack16: {
+                u16 value;
+                std::memcpy(&value, texel, sizeof(u16));
+                return {(value >> 11) / 31.0f, ((value >> 5) & 0x3F) / 63.0f, (value & 0x1F) / 31.0f, 1.0f};
+            }
+            default:
+                throw exception("Fermi 2D blits from format {} aren't supported", static_cast<u32>(format));
+        }
+    }
+
+    /**
+     * @brief Writes a single texel in the supplied format from its normalized channels
+     */
+    void StoreTexel(vk::Format format, u8 *texel, const Color &color) {
+        auto quantize{[&color](size_t channel, u32 max) {
+            return static_cast<u32>((std::clamp(color[channel], 0.0f, 1.0f) * static_cast<float>(max)) + 0.5f);
+        }};
+
+        switch (format) {
+            case vk::Format::eR8G8B8A8Unorm:
+                for (size_t channel{}; channel < 4; channel++)
+                    texel[channel] = static_cast<u8>(quantize(channel, 0xFF));
+                break;
+            case vk::Format::eR8G8B8A8Srgb: {
+                Color encoded{LinearToSrgb(std::max(color[0], 0.0f)), LinearToSrgb(std::max(color[1], 0.0f)), LinearToSrgb(std::max(color[2], 0.0f)), color[3]};
+                for (size_t channel{}; channel < 4; channel++)
+                    texel[channel] = static_cast<u8>((std::clamp(encoded[channel], 0.0f, 1.0f) * 255.0f) + 0.5f);
+                break;
+            }
+            case vk::Format::eB8G8R8A8Unorm:
+                texel[0] = static_cast<u8>(quantize(2, 0xFF));
+                texel[1] = static_cast<u8>(quantize(1, 0xFF));
+                texel[2] = static_cast<u8>(quantize(0, 0xFF));
+                texel[3] = static_cast<u8>(quantize(3, 0xFF));
+                break;
+            case vk::Format::eA2B10G10R10UnormPack32: {
+                u32 value{quantize(0, 0x3FF) | (quantize(1, 0x3FF) << 10) | (quantize(2, 0x3FF) << 20) | (quantize(3, 0x3) << 30)};
+                std::memcpy(texel, &value, sizeof(u32));
+                break;
+            }
+            case vk::Format::eR5G6B5UnormPack16: {
+                auto value{static_cast<u16>((quantize(0, 0x1F) << 11) | (quantize(1, 0x3F) << 5) | quantize(2, 0x1F))};
+                std::memcpy(texel, &value, sizeof(u16));
+                break;
+            }
+            default:
+                throw exception("Fermi 2D blits to format {} aren't supported", static_cast<u32>(format));
+        }
+    }
+
+    /**
+     * @brief A rectangle of texels on a surface, the end coordinates are exclusive
+     */
+    struct Rect {
+        i32 x0, y0, x1, y1;
+    };
+
+    /**
+     * @brief A pitch-linear view of a rectangle of a surface that's blitted from or to
+     */
+    struct BlitView {
+        u8 *data; //!< The texel at the top-left corner of the rectangle
+        size_t stride; //!< The distance between two lines in bytes
+        texture::Format format;
+        Rect rect; //!< The rectangle of the surface which the view covers, samples outside it are clamped to its edges
+
+        u8 *Texel(i32 x, i32 y) const {
+            return data + (static_cast<size_t>(y - rect.y0) * stride) + (static_cast<size_t>(x - rect.x0) * format.bpb);
+        }
+    };
+
+    /**
+     * @brief Samples the source for every texel in a rectangle of the destination, this converts between formats when they differ
+     * @param u0 The position of the sample for the top-left texel of the rectangle on the X-axis of the source as 32.32 fixed-point
+     * @param v0 The position of the sample for the top-left texel of the rectangle on the Y-axis of the source as 32.32 fixed-point
+     */
+    void BlitTexels(const BlitView &src, const BlitView &dst, const Rect &rect, i64 u0, i64 v0, i64 duDx, i64 dvDy, bool bilinear) {
+        constexpr i64 One{1LL << 32}, Half{1LL << 31};
+
+        // An unscaled bilinear blit with samples on texel centers is equivalent to a point-sampled one
+        if (bilinear && duDx == One && dvDy == One && ((u0 - Half) & (One - 1)) == 0 && ((v0 - Half) & (One - 1)) == 0)
+            bilinear = false;
+
+        auto clampX{[&src](i64 x) { return static_cast<i32>(std::clamp<i64>(x, src.rect.x0, src.rect.x1 - 1)); }};
+        auto clampY{[&src](i64 y) { return static_cast<i32>(std::clamp<i64>(y, src.rect.y0, src.rect.y1 - 1)); }};
+        bool convert{src.format.vkFormat != dst.format.vkFormat};
+
+        for (i32 y{rect.y0}; y < rect.y1; y++) {
+            auto v{v0 + ((y - rect.y0) * dvDy)};
+            auto dstTexel{dst.Texel(rect.x0, y)};
+
+            if (!bilinear) {
+                auto srcY{clampY(v >> 32)};
+                auto srcXFirst{u0 >> 32};
+                i32 width{rect.x1 - rect.x0};
+
+                // Rows that are copied without scaling or conversion and don't need clamping are copied in their entirety
+                if (!convert && duDx == One && srcXFirst >= src.rect.x0 && srcXFirst + width <= src.rect.x1) {
+                    std::memcpy(dstTexel, src.Texel(static_cast<i32>(srcXFirst), srcY), static_cast<size_t>(width) * dst.format.bpb);
+                    continue;
+                }
+
+                auto u{u0};
+                for (i32 x{}; x < width; x++, u += duDx, dstTexel += dst.format.bpb) {
+                    auto srcTexel{src.Texel(clampX(u >> 32), srcY)};
+                    if (convert)
+                        StoreTexel(dst.format.vkFormat, dstTexel, LoadTexel(src.format.vkFormat, srcTexel));
+                    else
+                        std::memcpy(dstTexel, srcTexel, dst.format.bpb);
+                }
+                continue;
+            }
+
+            // Bilinear samples are interpolated between the 4 texels whose centers surround the sample position
+            auto vTexel{v - Half};
+            auto top{clampY(vTexel >> 32)}, bottom{clampY((vTexel >> 32) + 1)};
+            auto weightY{static_cast<float>(vTexel & (One - 1)) / static_cast<float>(One)};
+
+            auto u{u0};
+            for (i32 x{rect.x0}; x < rect.x1; x++, u += duDx, dstTexel += dst.format.bpb) {
+                auto uTexel{u - Half};
+                auto left{clampX(uTexel >> 32)}, right{clampX((uTexel >> 32) + 1)};
+                auto weightX{static_cast<float>(uTexel & (One - 1)) / static_cast<float>(One)};
+
+                auto topLeft{LoadTexel(src.format.vkFormat, src.Texel(left, top))}, topRight{LoadTexel(src.format.vkFormat, src.Texel(right, top))};
+                auto bottomLeft{LoadTexel(src.format.vkFormat, src.Texel(left, bottom))}, bottomRight{LoadTexel(src.format.vkFormat, src.Texel(right, bottom))};
+
+                Color color;
+                for (size_t channel{}; channel < color.size(); channel++) {
+                    auto upper{topLeft[channel] + ((topRight[channel] - topLeft[channel]) * weightX)};
+                    auto lower{bottomLeft[channel] + ((bottomRight[channel] - bottomLeft[channel]) * weightX)};
+                    color[channel] = upper + ((lower - upper) * weightY);
+                }
+                StoreTexel(dst.format.vkFormat, dstTexel, color);
+            }
+        }
+    }
+
+    /**
+     * @brief The attributes of a blit surface that are derived from its registers
+     */
+    struct SurfaceInfo {
+        u64 address; //!< The address of the surface in the GPU address space
+        std::optional<u64> cpuAddress; //!< The address of the surface in the CPU address space, this is std::nullopt if it isn't contiguous in it in which case it can't be in the texture cache
+        texture::Format format;
+        texture::Dimensions dimensions;
+        texture::TileMode tileMode;
+        texture::TileConfig tileConfig{};
+        u32 stride; //!< The width of a block-linear surface in bytes or the pitch of a pitch-linear surface
+        size_t size; //!< The size of the surface in guest memory
+    };
+
+    SurfaceInfo GetSurfaceInfo(const vmm::MemoryManager &memoryManager, Fermi2D::Registers::Surface &surface) {
+        SurfaceInfo info{
+            .address = surface.address.Pack(),
+            .format = ConvertRenderTargetFormat(surface.format),
+            .dimensions = texture::Dimensions(surface.width, surface.height),
+        };
+
+        // The attributes match those of render targets so blits between render targets find them in the texture cache
+        if (surface.linear) {
+            info.tileMode = texture::TileMode::Pitch;
+            info.tileConfig.pitch = surface.pitch / info.format.bpb;
+            info.stride = surface.pitch;
+            info.size = static_cast<size_t>(surface.pitch) * surface.height;
+        } else {
+            info.tileMode = texture::TileMode::Block;
+            info.tileConfig.blockHeight = static_cast<u8>(1U << surface.blockSize.heightLog2);
+            info.tileConfig.blockDepth = static_cast<u8>(1U << surface.blockSize.depthLog2);
+            info.tileConfig.surfaceWidth = static_cast<u16>(surface.width);
+            info.stride = surface.width * info.format.bpb;
+            info.size = GetBlockLinearSize(info.stride, surface.height, info.tileConfig.blockHeight);
+        }
+
+        info.cpuAddress = memoryManager.GetCpuAddress(info.address, info.size);
+        return info;
+    }
+
+    Fermi2D::Fermi2D(const DeviceState &state) : Engine(state) {}
+
+    void Fermi2D::Blit() {
+        auto &gpu{*state.gpu};
+        auto &textureCache{gpu.textureCache};
+        auto &memoryManager{gpu.memoryManager};
+
+        if (registers.src.layer || registers.dst.layer || registers.src.depth > 1 || registers.dst.depth > 1)
+            state.logger->Warn("Fermi 2D blit between 3D surfaces only blits the first layer: Source Layer: {}, Destination Layer: {}", registers.src.layer, registers.dst.layer);
+
+        auto src{GetSurfaceInfo(memoryManager, registers.src)};
+        auto dst{GetSurfaceInfo(memoryManager, registers.dst)};
+
+        // The destination region is clipped to the destination surface, the source is clamped to its edges when sampled instead
+        Rect rect{
+            std::max(registers.dstX0, 0),
+            std::max(registers.dstY0, 0),
+            std::min<i32>(registers.dstX0 + registers.dstWidth, static_cast<i32>(dst.dimensions.width)),
+            std::min<i32>(registers.dstY0 + registers.dstHeight, static_cast<i32>(dst.dimensions.height)),
+        };
+        if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1 || !src.dimensions.width || !src.dimensions.height)
+            return;
+
+        bool center{registers.sampleMode.origin == Registers::SampleOrigin::Center};
+        bool bilinear{registers.sampleMode.filter == Registers::SampleFilter::Bilinear};
+        auto duDx{registers.duDx}, dvDy{registers.dvDy};
+        auto u0{registers.srcX0 + ((rect.x0 - registers.dstX0) * duDx) + (center ? duDx / 2 : 0)};
+        auto v0{registers.srcY0 + ((rect.y0 - registers.dstY0) * dvDy) + (center ? dvDy / 2 : 0)};
+
+        state.logger->Debug("Fermi 2D Blit: 0x{:X} ({}x{}) -> 0x{:X} ({}x{}), Region: ({}, {}) to ({}, {}), Bilinear: {}", src.address, src.dimensions.width, src.dimensions.height, dst.address, dst.dimensions.width, dst.dimensions.height, rect.x0, rect.y0, rect.x1, rect.y1, bilinear);
+
+        // Both surfaces being in the texture cache means the blit can be done between the host textures without touching guest memory, the destination then becomes a render target
+        std::shared_ptr<GuestTexture> srcTexture, dstTexture;
+        if (src.cpuAddress && dst.cpuAddress) {
+            srcTexture = textureCache.Find(*src.cpuAddress, src.dimensions, src.format, src.tileMode, src.tileConfig);
+            dstTexture = textureCache.Find(*dst.cpuAddress, dst.dimensions, dst.format, dst.tileMode, dst.tileConfig);
+        }
+
+        if (srcTexture && srcTexture->host && dstTexture && dstTexture->host && dstTexture->host->format == dstTexture->format) {
+            auto &srcHost{*srcTexture->host}, &dstHost{*dstTexture->host};
+            srcHost.SynchronizeHost();
+            textureCache.MarkRenderTarget(*dstTexture);
+
+            // A blit within a single texture reads from a copy of it, the regions may overlap otherwise
+            std::vector<u8> srcCopy;
+            auto srcData{srcHost.backing.data()};
+            if (&srcHost == &dstHost) {
+                srcCopy = srcHost.backing;
+                srcData = srcCopy.data();
+            }
+
+            BlitView srcView{srcData, srcHost.format.GetSize(srcHost.dimensions.width, 1), srcHost.format, {0, 0, static_cast<i32>(srcHost.dimensions.width), static_cast<i32>(srcHost.dimensions.height)}};
+            BlitView dstView{dstHost.backing.data(), dstHost.format.GetSize(dstHost.dimensions.width, 1), dstHost.format, {0, 0, static_cast<i32>(dstHost.dimensions.width), static_cast<i32>(dstHost.dimensions.height)}};
+            BlitTexels(srcView, dstView, rect, u0, v0, duDx, dvDy, bilinear);
+            return;
+        }
+
+        // The guest surfaces are accessed directly, so render targets on them are flushed beforehand and the textures and buffers on the destination are invalidated as GPU writes aren't write-tracked
+        memoryManager.SynchronizeAccess(src.address, src.size, false);
+        memoryManager.SynchronizeAccess(dst.address, dst.size, true);
+
+        // Surfaces are accessed in-place when they're contiguous on the host, otherwise they're read into a staging buffer
+        std::vector<u8> srcStaging, dstStaging;
+        auto getSurface{[&memoryManager](const SurfaceInfo &info, std::vector<u8> &staging) {
+            auto span{memoryManager.GetHostSpan(info.address, info.size)};
+            if (span.empty()) {
+                staging.resize(info.size);
+                memoryManager.Read(staging.data(), info.address, info.size);
+                span = staging;
+            }
+            return span;
+        }};
+        auto srcSurface{getSurface(src, srcStaging)};
+        auto dstSurface{getSurface(dst, dstStaging)};
+
+        // Only the bounding box of the source texels that are sampled is read out of the source as it's commonly far smaller than the surface
+        auto uLast{u0 + ((rect.x1 - rect.x0 - 1) * duDx)}, vLast{v0 + ((rect.y1 - rect.y0 - 1) * dvDy)};
+        auto srcWidth{static_cast<i32>(src.dimensions.width)}, srcHeight{static_cast<i32>(src.dimensions.height)};
+        Rect srcRect;
+        srcRect.x0 = static_cast<i32>(std::clamp<i64>((std::min(u0, uLast) >> 32) - 1, 0, srcWidth - 1));
+        srcRect.y0 = static_cast<i32>(std::clamp<i64>((std::min(v0, vLast) >> 32) - 1, 0, srcHeight - 1));
+        srcRect.x1 = static_cast<i32>(std::clamp<i64>((std::max(u0, uLast) >> 32) + 2, srcRect.x0 + 1, srcWidth));
+        srcRect.y1 = static_cast<i32>(std::clamp<i64>((std::max(v0, vLast) >> 32) + 2, srcRect.y0 + 1, srcHeight));
+
+        auto bpb{src.format.bpb};
+        auto srcRectStride{static_cast<u32>(srcRect.x1 - srcRect.x0) * bpb};
+        auto srcRectLines{static_cast<u32>(srcRect.y1 - srcRect.y0)};
+        bool overlapping{src.address < dst.address + dst.size && dst.address < src.address + src.size};
+        std::vector<u8> srcLinear;
+        BlitView srcView{nullptr, src.stride, src.format, srcRect};
+        if (src.tileMode == texture::TileMode::Pitch && !overlapping) {
+            srcView.data = srcSurface.data() + (static_cast<size_t>(srcRect.y0) * src.stride) + (static_cast<size_t>(srcRect.x0) * bpb);
+        } else {
+            srcLinear.resize(static_cast<size_t>(srcRectStride) * srcRectLines);
+            if (src.tileMode == texture::TileMode::Block) {
+                CopyBlockLinearLines<true>(srcSurface.data(), src.stride, src.tileConfig.blockHeight, srcLinear.data(), srcRectStride, srcRect.x0 * bpb, srcRect.y0, srcRectStride, 0, srcRectLines);
+            } else {
+                for (u32 line{}; line < srcRectLines; line++)
+                    std::memcpy(srcLinear.data() + (static_cast<size_t>(line) * srcRectStride), srcSurface.data() + (static_cast<size_t>(srcRect.y0 + line) * src.stride) + (static_cast<size_t>(srcRect.x0) * bpb), srcRectStride);
+            }
+            srcView.data = srcLinear.data();
+            srcView.stride = srcRectStride;
+        }
+
+        if (dst.tileMode == texture::TileMode::Pitch) {
+            BlitView dstView{dstSurface.data() + (static_cast<size_t>(rect.y0) * dst.stride) + (static_cast<size_t>(rect.x0) * dst.format.bpb), dst.stride, dst.format, rect};
+            BlitTexels(srcView, dstView, rect, u0, v0, duDx, dvDy, bilinear);
+        } else {
+            // Every texel of the destination rectangle is written, so it's blitted into a staging buffer without reading it and swizzled into the surface afterwards
+            auto dstRectStride{static_cast<u32>(rect.x1 - rect.x0) * dst.format.bpb};
+            auto dstRectLines{static_cast<u32>(rect.y1 - rect.y0)};
+            std::vector<u8> dstLinear(static_cast<size_t>(dstRectStride) * dstRectLines);
+            BlitTexels(srcView, BlitView{dstLinear.data(), dstRectStride, dst.format, rect}, rect, u0, v0, duDx, dvDy, bilinear);
+            CopyBlockLinearLines<false>(dstSurface.data(), dst.stride, dst.tileConfig.blockHeight, dstLinear.data(), dstRectStride, rect.x0 * dst.format.bpb, rect.y0, dstRectStride, 0, dstRectLines);
+        }
+
+        if (!dstStaging.empty())
+            memoryManager.Write(dstStaging.data(), dst.address, dst.size);
+    }
+
+    void Fermi2D::CallMethod(MethodParams params) {
+        if (params.method >= constant::Fermi2DRegisterCount) {
+            state.logger->Warn("Called method outside of the Fermi 2D register space: 0x{:X} args: 0x{:X}", params.method, params.argument);
+            return;
+        }
+
+        registers.raw[params.method] = params.argument;
+        if (params.method == FERMI2D_OFFSET(srcY0) + 1) {
+            try {
+                Blit();
+            } catch (const exception &e) {
+                state.logger->Warn("Skipping Fermi 2D blit: {}", e.what());
+            }
+        }
+    }
+}
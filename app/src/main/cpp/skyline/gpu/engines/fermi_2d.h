@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <array>
+#include <common.h>
+#include "engine.h"
+#include "maxwell_3d.h"
+
+#define FERMI2D_OFFSET(field) U32_OFFSET(skyline::gpu::engine::Fermi2D::Registers, field)
+
+namespace skyline {
+    namespace constant {
+        constexpr u32 Fermi2DRegisterCount = 0x258; //!< The number of Fermi 2D registers
+    }
+
+    namespace gpu::engine {
+        /**
+        * @brief The Fermi 2D engine performs blits between surfaces with optional scaling, filtering and format conversion
+        */
+        class Fermi2D : public Engine {
+          public:
+            /**
+            * @brief This holds the Fermi 2D engine's register space
+            */
+#pragma pack(push, 1)
+            union Registers {
+                std::array<u32, constant::Fermi2DRegisterCount> raw;
+
+                using Address = Maxwell3D::Registers::Address;
+                using ColorFormat = Maxwell3D::Registers::ColorFormat;
+
+                struct Surface {
+                    ColorFormat format;
+                    bool linear : 1; //!< If the surface is pitch-linear rather than block-linear
+                    u32 _pad0_ : 31;
+
+                    struct {
+                        u8 widthLog2 : 4; //!< The width of a block in GOBs with log2 applied
+                        u8 heightLog2 : 4; //!< The height of a block in GOBs with log2 applied
+                        u8 depthLog2 : 4; //!< The depth of a block in GOBs with log2 applied
+                        u32 _pad_ : 20;
+                    } blockSize;
+
+                    u32 depth;
+                    u32 layer;
+                    u32 pitch; //!< The distance between two lines of a pitch-linear surface in bytes
+                    u32 width; //!< The width of the surface in pixels
+                    u32 height;
+                    Address address;
+                };
+                static_assert(sizeof(Surface) == (0xA * sizeof(u32)));
+
+                enum class SampleOrigin : u8 {
+                    Center = 0, //!< Samples are taken at the centers of destination pixels
+                    Corner = 1, //!< Samples are taken at the top-left corners of destination pixels
+                };
+
+                enum class SampleFilter : u8 {
+                    Point = 0,
+                    Bilinear = 1,
+                };
+
+                struct {
+                    u32 _pad0_[0x80]; // 0x0
+                    Surface dst; // 0x80
+                    u32 _pad1_[0x2]; // 0x8A
+                    Surface src; // 0x8C
+                    u32 _pad2_[0x18D]; // 0x96
+
+                    struct {
+                        SampleOrigin origin : 1;
+                        u8 _pad0_ : 3;
+                        SampleFilter filter : 1;
+                        u32 _pad1_ : 27;
+                    } sampleMode; // 0x223
+
+                    u32 _pad3_[0x8]; // 0x224
+                    i32 dstX0; // 0x22C
+                    i32 dstY0; // 0x22D
+                    i32 dstWidth; // 0x22E
+                    i32 dstHeight; // 0x22F
+                    i64 duDx; // 0x230 The distance between source samples on the X-axis per destination pixel as 32.32 fixed-point
+                    i64 dvDy; // 0x232 The distance between source samples on the Y-axis per destination pixel as 32.32 fixed-point
+                    i64 srcX0; // 0x234 The origin of the source region on the X-axis as 32.32 fixed-point
+                    i64 srcY0; // 0x236 The origin of the source region on the Y-axis as 32.32 fixed-point, writing the upper word of this triggers the blit
+                    u32 _pad4_[0x20]; // 0x238
+                };
+            };
+            static_assert(sizeof(Registers) == (constant::Fermi2DRegisterCount * sizeof(u32)));
+#pragma pack(pop)
+
+            Registers registers{}; //!< The Fermi 2D register space
+
+          private:
+            /**
+             * @brief Blits the source region into the destination region with the current register state, this is triggered by writing to the upper word of srcY0
+             * @note The blit is done between the host textures when both surfaces are in the texture cache, it's done on the guest surfaces otherwise
+             */
+            void Blit();
+
+          public:
+            Fermi2D(const DeviceState &state);
+
+            void CallMethod(MethodParams params);
+        };
+    }
+}
@@ -173,8 +173,6 @@ namespace skyline {
             GPFIFO(const DeviceState &state) : Engine(state) {}
 
             void CallMethod(MethodParams params) {
-                state.logger->Debug("Called method in GPFIFO: 0x{:X} args: 0x{:X}", params.method, params.argument);
-
                 registers.raw[params.method] = params.argument;
             };
         };
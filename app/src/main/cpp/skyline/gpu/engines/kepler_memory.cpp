@@ -0,0 +1,109 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include <gpu/block_linear.h>
+#include "kepler_memory.h"
+
+namespace skyline::gpu::engine {
+    KeplerMemory::KeplerMemory(const DeviceState &state) : Engine(state) {}
+
+    void KeplerMemory::LaunchDma() {
+        if (uploadSize)
+            state.logger->Warn("Kepler Memory upload was restarted with {} bytes of inline data outstanding", uploadSize - staging.size());
+
+        uploadSize = static_cast<size_t>(registers.lineLengthIn) * registers.lineCount;
+        staging.clear();
+        staging.reserve(util::AlignUp(uploadSize, sizeof(u32)));
+    }
+
+    void KeplerMemory::LoadInlineData(std::span<u32> data) {
+        if (!uploadSize) {
+            state.logger->Warn("Kepler Memory received {} words of inline data without an upload in progress", data.size());
+            return;
+        }
+
+        auto bytes{std::span(reinterpret_cast<u8 *>(data.data()), data.size_bytes())};
+        staging.insert(staging.end(), bytes.begin(), bytes.end());
+
+        // The last word of an upload is padded out to 4 bytes, the padding is never written to the destination
+        if (staging.size() >= uploadSize)
+            FlushUpload();
+    }
+
+    void KeplerMemory::FlushUpload() {
+        auto &memoryManager{state.gpu->memoryManager};
+        auto &dst{registers.dst};
+        auto lineLength{registers.lineLengthIn}, lineCount{registers.lineCount};
+        uploadSize = 0;
+
+        if (registers.launchDma.linear) {
+            if (lineCount == 1 || dst.pitch == lineLength) {
+                memoryManager.Write(staging.data(), dst.address.Pack(), static_cast<u64>(lineLength) * lineCount);
+            } else {
+                for (u32 line = 0; line < lineCount; line++)
+                    memoryManager.Write(staging.data() + static_cast<size_t>(line) * lineLength, dst.address.Pack() + static_cast<u64>(line) * dst.pitch, lineLength);
+            }
+            return;
+        }
+
+        if (dst.depth > 1 || dst.layer)
+            state.logger->Warn("Unsupported Kepler Memory upload to a 3D block-linear surface: Depth: {}, Layer: {}", dst.depth, dst.layer);
+
+        if (dst.x + lineLength > dst.width || dst.y + lineCount > dst.height)
+            throw exception("Kepler Memory upload region exceeds the block-linear surface: Origin: ({}, {}), Region: {}x{}, Surface: {}x{}", dst.x, dst.y, lineLength, lineCount, dst.width, dst.height);
+
+        u32 blockHeight{1U << dst.blockSize.height}; // The height of a block in GOBs
+        auto surfaceSize{GetBlockLinearSize(dst.width, dst.height, blockHeight)};
+
+        memoryManager.SynchronizeAccess(dst.address.Pack(), surfaceSize, true);
+
+        // The surface is swizzled into in-place when it's contiguous on the host, otherwise its contents are read back so the bytes outside the region are preserved
+        auto surface{memoryManager.GetHostSpan(dst.address.Pack(), surfaceSize)};
+        std::vector<u8> surfaceStaging;
+        if (surface.empty()) {
+            surfaceStaging.resize(surfaceSize);
+            memoryManager.Read(surfaceStaging.data(), dst.address.Pack(), surfaceSize);
+            surface = surfaceStaging;
+        }
+
+        CopyBlockLinearLines<false>(surface.data(), dst.width, blockHeight, staging.data(), lineLength, dst.x, dst.y, lineLength, 0, lineCount);
+
+        if (!surfaceStaging.empty())
+            memoryManager.Write(surfaceStaging.data(), dst.address.Pack(), surfaceSize);
+    }
+
+    void KeplerMemory::CallMethod(MethodParams params) {
+        CallMethodBatch(params.method, std::span(&params.argument, 1), MethodIncrement::Increment, params.subChannel);
+    }
+
+    void KeplerMemory::CallMethodBatch(u16 method, std::span<u32> arguments, MethodIncrement increment, u32 subChannel) {
+        constexpr u16 LoadInlineDataMethod{KEPLERMEMORY_OFFSET(loadInlineData)};
+
+        for (size_t index{}; index < arguments.size();) {
+            auto argumentMethod{GetBatchMethod(method, index, increment)};
+            if (argumentMethod >= constant::KeplerMemoryRegisterCount) {
+                state.logger->Warn("Called method outside of the Kepler Memory register space: 0x{:X} args: 0x{:X}", argumentMethod, arguments[index]);
+                index++;
+                continue;
+            }
+
+            if (argumentMethod == LoadInlineDataMethod) {
+                // Every argument that the method stays on loadInlineData for is appended to the upload at once
+                size_t count{1};
+                if (increment == MethodIncrement::NonIncrement || (increment == MethodIncrement::IncrementOnce && index))
+                    count = arguments.size() - index;
+
+                registers.loadInlineData = arguments[index + count - 1];
+                LoadInlineData(arguments.subspan(index, count));
+                index += count;
+                continue;
+            }
+
+            registers.raw[argumentMethod] = arguments[index];
+            if (argumentMethod == KEPLERMEMORY_OFFSET(launchDma))
+                LaunchDma();
+            index++;
+        }
+    }
+}
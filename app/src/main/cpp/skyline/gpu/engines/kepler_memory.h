@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <array>
+#include <common.h>
+#include "engine.h"
+
+#define KEPLERMEMORY_OFFSET(field) U32_OFFSET(skyline::gpu::engine::KeplerMemory::Registers, field)
+
+namespace skyline {
+    namespace constant {
+        constexpr u32 KeplerMemoryRegisterCount = 0x80; //!< The number of Kepler Memory registers
+    }
+
+    namespace gpu::engine {
+        /**
+        * @brief The Kepler Memory engine handles uploading inline data from the pushbuffer into pitch-linear or block-linear memory
+        */
+        class KeplerMemory : public Engine {
+          public:
+            /**
+            * @brief This holds the Kepler Memory engine's register space
+            */
+#pragma pack(push, 1)
+            union Registers {
+                std::array<u32, constant::KeplerMemoryRegisterCount> raw;
+
+                struct Address {
+                    u32 high;
+                    u32 low;
+
+                    u64 Pack() {
+                        return (static_cast<u64>(high) << 32) | low;
+                    }
+                };
+                static_assert(sizeof(Address) == sizeof(u64));
+
+                struct {
+                    u32 _pad0_[0x60]; // 0x0
+                    u32 lineLengthIn; // 0x60 The length of a line in bytes
+                    u32 lineCount; // 0x61
+
+                    struct {
+                        Address address; // 0x62
+                        u32 pitch; // 0x64
+
+                        struct {
+                            u8 width : 4; //!< The width of a block in GOBs as a power of 2
+                            u8 height : 4; //!< The height of a block in GOBs as a power of 2
+                            u8 depth : 4; //!< The depth of a block in GOBs as a power of 2
+                            u32 _pad_ : 20;
+                        } blockSize; // 0x65
+
+                        u32 width; // 0x66 The width of the surface in bytes
+                        u32 height; // 0x67
+                        u32 depth; // 0x68
+                        u32 layer; // 0x69
+                        u32 x; // 0x6A The offset of the region on the X-axis in bytes
+                        u32 y; // 0x6B The offset of the region on the Y-axis in lines
+                    } dst;
+
+                    struct {
+                        bool linear : 1; //!< If the destination is pitch-linear rather than block-linear
+                        u32 _pad_ : 31;
+                    } launchDma; // 0x6C
+
+                    u32 loadInlineData; // 0x6D
+                    u32 _pad1_[0x12]; // 0x6E
+                };
+            };
+            static_assert(sizeof(Registers) == (constant::KeplerMemoryRegisterCount * sizeof(u32)));
+#pragma pack(pop)
+
+            Registers registers{}; //!< The Kepler Memory register space
+
+          private:
+            std::vector<u8> staging; //!< The inline data of the current upload, its storage is retained between uploads so it only needs to be allocated once
+            size_t uploadSize{}; //!< The size of the current upload in bytes, the upload is written out once the staging buffer is this large
+
+            /**
+             * @brief Starts a new upload with the current register state, this is triggered by writing to launchDma
+             */
+            void LaunchDma();
+
+            /**
+             * @brief Appends inline data to the current upload and writes it out if it's complete
+             */
+            void LoadInlineData(std::span<u32> data);
+
+            /**
+             * @brief Writes out the contents of the staging buffer to the destination
+             */
+            void FlushUpload();
+
+          public:
+            KeplerMemory(const DeviceState &state);
+
+            void CallMethod(MethodParams params);
+
+            /**
+             * @brief Inline data is appended in bulk while any other methods are dispatched individually
+             */
+            void CallMethodBatch(u16 method, std::span<u32> arguments, MethodIncrement increment, u32 subChannel);
+        };
+    }
+}
@@ -1,17 +1,24 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <bitset>
 #include <gpu.h>
 #include <gpu/syncpoint.h>
+#include <gpu/pipeline_cache.h>
+#include <gpu/format.h>
+#include <gpu/block_linear.h>
 #include "maxwell_3d.h"
 
 namespace skyline::gpu::engine {
-    Maxwell3D::Maxwell3D(const DeviceState &state) : Engine(state), macroInterpreter(*this) {
+    Maxwell3D::Maxwell3D(const DeviceState &state) : Engine(state), macroInterpreter(*this), macroHle(state, *this), macroJit(*this), useMacroJit(state.settings->Get().macroJit), pipelineKey(std::make_unique<PipelineKey>()), dynamicState(std::make_unique<DynamicState>()) {
         ResetRegs();
     }
 
+    Maxwell3D::~Maxwell3D() = default;
+
     void Maxwell3D::ResetRegs() {
         registers = {};
+        dirtyFlags = DirtyAll;
 
         registers.rasterizerEnable = true;
 
@@ -74,52 +81,240 @@ namespace skyline::gpu::engine {
         registers.viewportTransformEnable = true;
     }
 
-    void Maxwell3D::CallMethod(MethodParams params) {
-        state.logger->Debug("Called method in Maxwell 3D: 0x{:X} args: 0x{:X}", params.method, params.argument);
+    /**
+     * @brief This holds if writing to a register has a side effect other than changing its value
+     */
+    constexpr auto SideEffectRegisters{[] {
+        std::array<bool, constant::Maxwell3DRegisterCounter> table{};
+        table[MAXWELL3D_OFFSET(mme.instructionRamLoad)] = true;
+        table[MAXWELL3D_OFFSET(mme.startAddressRamLoad)] = true;
+        table[MAXWELL3D_OFFSET(mme.shadowRamControl)] = true;
+        table[MAXWELL3D_OFFSET(syncpointAction)] = true;
+        table[MAXWELL3D_OFFSET(counterReset)] = true;
+        table[MAXWELL3D_OFFSET(semaphore.info)] = true;
+        table[MAXWELL3D_OFFSET(draw.vertexEndGl)] = true;
+        table[MAXWELL3D_OFFSET(firmwareCall[4])] = true;
+        for (size_t index{}; index < MAXWELL3D_SIZE(constantBufferUpdate.data); index++)
+            table[MAXWELL3D_OFFSET(constantBufferUpdate.data) + index] = true;
+        return table;
+    }()};
+
+    /**
+     * @brief This holds the DirtyFlag groups that every register is a part of, it's generated from the register layout so it always matches the registers that are translated
+     */
+    constexpr auto DirtyRegisters{[] {
+        std::array<u32, constant::Maxwell3DRegisterCounter> table{};
+        auto markRange{[&](u32 flag, size_t offset, size_t size) {
+            for (size_t index{offset}; index < offset + size; index++)
+                table[index] |= flag;
+        }};
+
+#define DIRTY_REGISTER(flag, field) markRange(Maxwell3D::flag, MAXWELL3D_OFFSET(field), MAXWELL3D_SIZE(field))
+        DIRTY_REGISTER(DirtyRasterizer, rasterizerEnable);
+        DIRTY_REGISTER(DirtyRasterizer, polygonMode);
+        DIRTY_REGISTER(DirtyRasterizer, cullFaceEnable);
+        DIRTY_REGISTER(DirtyRasterizer, frontFace);
+        DIRTY_REGISTER(DirtyRasterizer, cullFace);
+
+        DIRTY_REGISTER(DirtyDepthStencil, depthTestEnable);
+        DIRTY_REGISTER(DirtyDepthStencil, depthWriteEnable);
+        DIRTY_REGISTER(DirtyDepthStencil, depthTestFunc);
+        DIRTY_REGISTER(DirtyDepthStencil, stencilEnable);
+        DIRTY_REGISTER(DirtyDepthStencil, stencilFront);
+        DIRTY_REGISTER(DirtyDepthStencil, stencilTwoSideEnable);
+        DIRTY_REGISTER(DirtyDepthStencil, stencilBack);
+        DIRTY_REGISTER(DirtyDepthStencil, stencilBackExtra);
+
+        DIRTY_REGISTER(DirtyBlend, rtSeparateFragData);
+        DIRTY_REGISTER(DirtyBlend, independentBlendEnable);
+        DIRTY_REGISTER(DirtyBlend, blend);
+        DIRTY_REGISTER(DirtyBlend, colorMask);
+        DIRTY_REGISTER(DirtyBlend, independentBlend);
+
+        DIRTY_REGISTER(DirtyVertexAttributes, vertexAttributeState);
+
+        DIRTY_REGISTER(DirtyViewport, viewportTransform);
+        DIRTY_REGISTER(DirtyViewport, viewport);
+        DIRTY_REGISTER(DirtyViewport, viewportTransformEnable);
+
+        DIRTY_REGISTER(DirtyScissor, scissor);
+
+        DIRTY_REGISTER(DirtyRenderTargets, renderTargets);
+        DIRTY_REGISTER(DirtyRenderTargets, renderTargetControl);
+#undef DIRTY_REGISTER
+
+        return table;
+    }()};
 
+    void Maxwell3D::CallMethod(MethodParams params) {
+        TRACE("Maxwell 3D method 0x{:X}: 0x{:X}", params.method, params.argument);
         // Methods that are greater than the register size are for macro control
         if (params.method > constant::Maxwell3DRegisterCounter) {
-            if (!(params.method & 1))
-                macroInvocation.index = ((params.method - constant::Maxwell3DRegisterCounter) >> 1) % macroPositions.size();
-
-            macroInvocation.arguments.push_back(params.argument);
-
-            // Macros are always executed on the last method call in a pushbuffer entry
-            if (params.lastCall) {
-                macroInterpreter.Execute(macroPositions[macroInvocation.index], macroInvocation.arguments);
-
-                macroInvocation.arguments.clear();
-                macroInvocation.index = 0;
-            }
+            HandleMacroCall(params.method, std::span(&params.argument, 1), params.lastCall);
             return;
         }
 
         registers.raw[params.method] = params.argument;
+        dirtyFlags |= DirtyRegisters[params.method];
 
         if (shadowRegisters.mme.shadowRamControl == Registers::MmeShadowRamControl::MethodTrack || shadowRegisters.mme.shadowRamControl == Registers::MmeShadowRamControl::MethodTrackWithFilter)
             shadowRegisters.raw[params.method] = params.argument;
         else if (shadowRegisters.mme.shadowRamControl == Registers::MmeShadowRamControl::MethodReplay)
             params.argument = shadowRegisters.raw[params.method];
 
-        switch (params.method) {
+        if (SideEffectRegisters[params.method])
+            HandleMethodSideEffect(params.method, params.argument);
+    }
+
+    void Maxwell3D::CallMethodBatch(u16 method, std::span<u32> arguments, MethodIncrement increment, u32 subChannel) {
+        // Macro arguments are appended in bulk unless the method changes more than once, in which case the macro index has to be tracked per-method
+        if (method > constant::Maxwell3DRegisterCounter && (increment != MethodIncrement::Increment || arguments.size() <= 2)) {
+            HandleMacroCall(method, arguments.first(1), arguments.size() == 1);
+            if (arguments.size() > 1)
+                HandleMacroCall(GetBatchMethod(method, 1, increment), arguments.subspan(1), true);
+            return;
+        }
+
+        // Batches which cross into the macro methods are dispatched individually as they're very rare
+        if (GetBatchMethod(method, arguments.size() - 1, increment) >= constant::Maxwell3DRegisterCounter) {
+            Engine::CallMethodBatch(method, arguments, increment, subChannel);
+            return;
+        }
+
+        if (increment == MethodIncrement::IncrementOnce) {
+            CallMethodBatch(method, arguments.first(1), MethodIncrement::NonIncrement, subChannel);
+            if (arguments.size() > 1)
+                CallMethodBatch(static_cast<u16>(method + 1), arguments.subspan(1), MethodIncrement::NonIncrement, subChannel);
+            return;
+        }
+
+        while (!arguments.empty()) {
+            // The shadow RAM control may have been changed by a side effect, the replay mode substitutes arguments so it's handled per-method
+            auto shadowRamControl{shadowRegisters.mme.shadowRamControl};
+            if (shadowRamControl == Registers::MmeShadowRamControl::MethodReplay) {
+                Engine::CallMethodBatch(method, arguments, increment, subChannel);
+                return;
+            }
+            bool track{shadowRamControl == Registers::MmeShadowRamControl::MethodTrack || shadowRamControl == Registers::MmeShadowRamControl::MethodTrackWithFilter};
+
+            // Every constant buffer data write goes to the next word of the buffer regardless of which data register it targets, so an entire run of them is written at once
+            constexpr u16 ConstantBufferDataStart{MAXWELL3D_OFFSET(constantBufferUpdate.data)};
+            constexpr u16 ConstantBufferDataEnd{ConstantBufferDataStart + MAXWELL3D_SIZE(constantBufferUpdate.data)};
+            if (method >= ConstantBufferDataStart && method < ConstantBufferDataEnd) {
+                size_t count{increment == MethodIncrement::NonIncrement ? arguments.size() : std::min<size_t>(arguments.size(), ConstantBufferDataEnd - method)};
+                auto lastMethod{GetBatchMethod(method, count - 1, increment)};
+                registers.raw[lastMethod] = arguments[count - 1];
+                if (track)
+                    shadowRegisters.raw[lastMethod] = arguments[count - 1];
+                UpdateConstantBuffer(arguments.first(count));
+
+                method += (increment == MethodIncrement::NonIncrement) ? 0 : count;
+                arguments = arguments.subspan(count);
+                continue;
+            }
+
+            if (increment == MethodIncrement::NonIncrement) {
+                dirtyFlags |= DirtyRegisters[method];
+                if (!SideEffectRegisters[method]) {
+                    // Only the final write to a register without side effects is observable
+                    registers.raw[method] = arguments.back();
+                    if (track)
+                        shadowRegisters.raw[method] = arguments.back();
+                    return;
+                }
+
+                registers.raw[method] = arguments.front();
+                if (track)
+                    shadowRegisters.raw[method] = arguments.front();
+                HandleMethodSideEffect(method, arguments.front());
+
+                arguments = arguments.subspan(1);
+            } else {
+                // All registers up to and including the next register with side effects are written in bulk prior to dispatching the side effect
+                size_t count{};
+                while (count < arguments.size() && !SideEffectRegisters[method + count])
+                    count++;
+                bool sideEffect{count < arguments.size()};
+                if (sideEffect)
+                    count++;
+
+                std::memcpy(&registers.raw[method], arguments.data(), count * sizeof(u32));
+                if (track)
+                    std::memcpy(&shadowRegisters.raw[method], arguments.data(), count * sizeof(u32));
+                for (size_t index{}; index < count; index++)
+                    dirtyFlags |= DirtyRegisters[method + index];
+
+                if (sideEffect)
+                    HandleMethodSideEffect(static_cast<u16>(method + count - 1), arguments[count - 1]);
+
+                method += count;
+                arguments = arguments.subspan(count);
+            }
+        }
+    }
+
+    void Maxwell3D::HandleMacroCall(u16 method, std::span<u32> arguments, bool lastCall) {
+        if (!(method & 1))
+            macroInvocation.index = ((method - constant::Maxwell3DRegisterCounter) >> 1) % macroPositions.size();
+
+        // Macros are always executed on the last method call in a pushbuffer entry, the arguments are used directly from the pushbuffer when they're all supplied in a single call
+        if (!lastCall || !macroInvocation.arguments.empty())
+            macroInvocation.arguments.insert(macroInvocation.arguments.end(), arguments.begin(), arguments.end());
+
+        if (lastCall) {
+            std::span<const u32> invocationArguments{macroInvocation.arguments.empty() ? std::span<const u32>(arguments) : std::span<const u32>(macroInvocation.arguments)};
+            auto position{macroPositions[macroInvocation.index]};
+            TRACE_SECTION_FMT("Macro 0x{:X}: {} arguments", position, invocationArguments.size());
+            if (!macroHle.Execute(position, invocationArguments) && (!useMacroJit || !macroJit.Execute(position, invocationArguments)))
+                macroInterpreter.Execute(position, invocationArguments);
+
+            macroInvocation.arguments.clear();
+            macroInvocation.index = 0;
+        }
+    }
+
+    void Maxwell3D::HandleMethodSideEffect(u16 method, u32 argument) {
+        if (method >= MAXWELL3D_OFFSET(constantBufferUpdate.data) && method < MAXWELL3D_OFFSET(constantBufferUpdate.data) + MAXWELL3D_SIZE(constantBufferUpdate.data)) {
+            UpdateConstantBuffer(std::span(&argument, 1));
+            return;
+        }
+
+        switch (method) {
             case MAXWELL3D_OFFSET(mme.instructionRamLoad):
                 if (registers.mme.instructionRamPointer >= macroCode.size())
                     throw exception("Macro memory is full!");
 
-                macroCode[registers.mme.instructionRamPointer++] = params.argument;
+                macroCode[registers.mme.instructionRamPointer++] = argument;
+                macroHle.Invalidate();
+                macroJit.Invalidate();
                 break;
             case MAXWELL3D_OFFSET(mme.startAddressRamLoad):
                 if (registers.mme.startAddressRamPointer >= macroPositions.size())
                     throw exception("Maximum amount of macros reached!");
 
-                macroPositions[registers.mme.startAddressRamPointer++] = params.argument;
+                macroPositions[registers.mme.startAddressRamPointer++] = argument;
                 break;
             case MAXWELL3D_OFFSET(mme.shadowRamControl):
-                shadowRegisters.mme.shadowRamControl = static_cast<Registers::MmeShadowRamControl>(params.argument);
+                shadowRegisters.mme.shadowRamControl = static_cast<Registers::MmeShadowRamControl>(argument);
                 break;
             case MAXWELL3D_OFFSET(syncpointAction):
+                // Anything waiting on the syncpoint can read the reports made prior to it
+                state.gpu->queryManager.Flush();
                 state.gpu->syncpoints.at(registers.syncpointAction.id).Increment();
                 break;
+            case MAXWELL3D_OFFSET(counterReset):
+                switch (registers.counterReset) {
+                    case Registers::CounterReset::SampleCount:
+                        state.gpu->queryManager.ResetCounter(QueryManager::Counter::SamplesPassed);
+                        break;
+                    case Registers::CounterReset::PrimitivesGenerated:
+                        state.gpu->queryManager.ResetCounter(QueryManager::Counter::PrimitivesGenerated);
+                        break;
+                    default:
+                        state.logger->Debug("Unsupported counter reset: 0x{:X}", static_cast<u32>(registers.counterReset));
+                        break;
+                }
+                break;
             case MAXWELL3D_OFFSET(semaphore.info):
                 switch (registers.semaphore.info.op) {
                     case Registers::SemaphoreInfo::Op::Release:
@@ -133,17 +328,333 @@ namespace skyline::gpu::engine {
                         break;
                 }
                 break;
+            case MAXWELL3D_OFFSET(draw.vertexEndGl):
+                Draw();
+                break;
             case MAXWELL3D_OFFSET(firmwareCall[4]):
                 registers.raw[0xD00] = 1;
                 break;
         }
     }
 
+    void Maxwell3D::UpdateConstantBuffer(std::span<const u32> data) {
+        auto &update{registers.constantBufferUpdate};
+        auto size{data.size_bytes()};
+        if (update.offset + size > update.size) {
+            state.logger->Warn("Constant buffer update at 0x{:X} exceeds the buffer: 0x{:X} + 0x{:X} > 0x{:X}", update.address.Pack(), update.offset, size, update.size);
+            size = update.offset < update.size ? update.size - update.offset : 0;
+        }
+
+        if (size)
+            state.gpu->bufferCache.Write(update.address.Pack() + update.offset, std::span(reinterpret_cast<const u8 *>(data.data()), size));
+        update.offset += static_cast<u32>(data.size_bytes());
+    }
+
+    /**
+     * @return The amount of primitives that are assembled from the supplied amount of vertices
+     */
+    u32 GetPrimitiveCount(Maxwell3D::Registers::PrimitiveTopology topology, u32 count) {
+        using PrimitiveTopology = Maxwell3D::Registers::PrimitiveTopology;
+        switch (topology) {
+            case PrimitiveTopology::Points:
+                return count;
+            case PrimitiveTopology::Lines:
+                return count / 2;
+            case PrimitiveTopology::LineLoop:
+                return count >= 2 ? count : 0;
+            case PrimitiveTopology::LineStrip:
+                return count >= 2 ? count - 1 : 0;
+            case PrimitiveTopology::Triangles:
+                return count / 3;
+            case PrimitiveTopology::TriangleStrip:
+            case PrimitiveTopology::TriangleFan:
+                return count >= 3 ? count - 2 : 0;
+            case PrimitiveTopology::Quads:
+                return count / 4;
+            case PrimitiveTopology::Polygon:
+                return count >= 3 ? 1 : 0;
+            case PrimitiveTopology::QuadStrip:
+                return count >= 4 ? (count - 2) / 2 : 0;
+            case PrimitiveTopology::LinesAdjacency:
+                return count / 4;
+            case PrimitiveTopology::LineStripAdjacency:
+                return count >= 4 ? count - 3 : 0;
+            case PrimitiveTopology::TrianglesAdjacency:
+                return count / 6;
+            case PrimitiveTopology::TriangleStripAdjacency:
+                return count >= 6 ? (count - 4) / 2 : 0;
+            default:
+                return 0;
+        }
+    }
+
+    bool Maxwell3D::IsRenderEnabled() {
+        auto &queryManager{state.gpu->queryManager};
+        auto address{registers.renderEnable.address.Pack()};
+        switch (registers.renderEnable.mode) {
+            case Registers::RenderEnableMode::Never:
+                return false;
+            case Registers::RenderEnableMode::Always:
+                return true;
+            case Registers::RenderEnableMode::NonZero:
+                return queryManager.Read(address) != 0;
+            case Registers::RenderEnableMode::Equal:
+                return queryManager.Read(address) == queryManager.Read(address + 0x10);
+            case Registers::RenderEnableMode::NotEqual:
+                return queryManager.Read(address) != queryManager.Read(address + 0x10);
+            default:
+                state.logger->Warn("Unsupported render enable mode: 0x{:X}", static_cast<u32>(registers.renderEnable.mode));
+                return true;
+        }
+    }
+
+    void Maxwell3D::Draw() {
+        // A draw is indexed if an index count has been written since the last draw, both counts are reset after every draw so only the counts written for the next draw are considered
+        bool indexed{registers.indexArray.count != 0};
+        auto first{indexed ? registers.indexArray.first : registers.vertexArray.first};
+        auto count{indexed ? registers.indexArray.count : registers.vertexArray.count};
+        registers.vertexArray.count = 0;
+        registers.indexArray.count = 0;
+
+        if (!IsRenderEnabled())
+            return;
+
+        // Draws aren't rasterized on the host yet, so the amount of samples is approximated with the vertex count which keeps occlusion queries from culling visible geometry
+        auto &queryManager{state.gpu->queryManager};
+        auto primitives{GetPrimitiveCount(registers.draw.vertexBeginGl.topology, count)};
+        queryManager.Accumulate(QueryManager::Counter::InputVertices, count);
+        queryManager.Accumulate(QueryManager::Counter::InputPrimitives, primitives);
+        queryManager.Accumulate(QueryManager::Counter::PrimitivesGenerated, primitives);
+        if (registers.sampleCounterEnable)
+            queryManager.Accumulate(QueryManager::Counter::SamplesPassed, count);
+
+        // A draw can't do anything until graphics programs can be translated as its pipeline would never become ready, so its state and shaders aren't translated and no buffers or render targets are synchronized for it
+        if constexpr (!shader::IsStageSupported(shader::Stage::VertexB) || !shader::IsStageSupported(shader::Stage::Fragment)) {
+            state.logger->Debug("Skipping draw as graphics programs can't be translated yet");
+            return;
+        }
+
+        // Only the groups of state with registers that were written to since the last draw are translated again, draws with state that can't be translated are skipped rather than stopping the GPU as they only affect the draw itself
+        auto &pipelineState{pipelineKey->state};
+        try {
+            auto topology{pipelineState.topology};
+            pipelineState.TranslateTopology(registers);
+            if (pipelineState.topology != topology)
+                pipeline = nullptr;
+
+            if (dirtyFlags & DirtyPipelineState) {
+                pipeline = nullptr;
+                if (dirtyFlags & DirtyRasterizer) {
+                    pipelineState.TranslateRasterizer(registers);
+                    dirtyFlags &= ~DirtyRasterizer;
+                }
+                if (dirtyFlags & DirtyDepthStencil) {
+                    pipelineState.TranslateDepthStencil(registers);
+                    dirtyFlags &= ~DirtyDepthStencil;
+                }
+                if (dirtyFlags & DirtyBlend) {
+                    pipelineState.TranslateBlend(registers);
+                    dirtyFlags &= ~DirtyBlend;
+                }
+                if (dirtyFlags & DirtyVertexAttributes) {
+                    pipelineState.TranslateVertexAttributes(registers);
+                    dirtyFlags &= ~DirtyVertexAttributes;
+                }
+            }
+
+            if (dirtyFlags & DirtyViewport) {
+                for (size_t index{}; index < constant::MaxViewportCount; index++)
+                    dynamicState->viewports[index] = PipelineState::GetViewport(registers, index);
+                dirtyFlags &= ~DirtyViewport;
+            }
+            if (dirtyFlags & DirtyScissor) {
+                for (size_t index{}; index < constant::MaxViewportCount; index++)
+                    dynamicState->scissors[index] = PipelineState::GetScissor(registers, index);
+                dirtyFlags &= ~DirtyScissor;
+            }
+            if (dirtyFlags & DirtyRenderTargets) {
+                UpdateRenderTargets();
+                dirtyFlags &= ~DirtyRenderTargets;
+            }
+        } catch (const exception &e) {
+            state.logger->Warn("Skipping draw with untranslatable state: {}", e.what());
+            return;
+        }
+
+        try {
+            if (UpdateShaders())
+                pipeline = nullptr;
+        } catch (const exception &e) {
+            state.logger->Warn("Skipping draw with unreadable shaders: {}", e.what());
+            return;
+        }
+
+        if (!pipeline) {
+            std::array<std::shared_ptr<ShaderCache::Shader>, shader::StageCount> shaders;
+            for (size_t index{}; index < shader::StageCount; index++) {
+                shaders[index] = boundShaders[index].shader;
+                pipelineKey->shaders[index] = shaders[index] ? shaders[index]->hash : 0;
+            }
+            pipeline = &state.gpu->pipelineCache.Get(*pipelineKey, shaders);
+        }
+
+        // A draw can only be performed once all shaders of its pipeline are translated, it's skipped until then rather than waiting on them so translation never stalls the GPU
+        auto status{pipeline->UpdateStatus()};
+        state.logger->Debug("Draw: Topology: 0x{:X}, Indexed: {}, First: {}, Count: {}, Attributes: {}, Pipeline Status: {}", static_cast<u16>(registers.draw.vertexBeginGl.topology), indexed, first, count, pipelineKey->state.vertexAttributeCount, static_cast<u8>(status));
+        if (status != Pipeline::Status::Ready)
+            return;
+
+        try {
+            SynchronizeBuffers(indexed, first, count);
+
+            // Render targets are only written back into guest memory once the guest accesses them, so consecutive draws to them stay on the host
+            for (const auto &renderTarget : boundRenderTargets)
+                if (renderTarget)
+                    state.gpu->textureCache.MarkRenderTarget(*renderTarget);
+        } catch (const exception &e) {
+            state.logger->Warn("Skipping draw with inaccessible buffers or render targets: {}", e.what());
+            return;
+        }
+    }
+
+    /**
+     * @return The texture format corresponding to a render target format
+     */
+    texture::Format ConvertRenderTargetFormat(Maxwell3D::Registers::ColorFormat format) {
+        using ColorFormat = Maxwell3D::Registers::ColorFormat;
+        switch (format) {
+            case ColorFormat::A8B8G8R8Unorm:
+                return format::RGBA8888Unorm;
+            case ColorFormat::A8B8G8R8Srgb:
+                return format::RGBA8888Srgb;
+            case ColorFormat::A8R8G8B8Unorm:
+                return format::BGRA8888Unorm;
+            case ColorFormat::A2B10G10R10Unorm:
+                return format::A2BGR10Unorm;
+            case ColorFormat::R5G6B5Unorm:
+                return format::RGB565Unorm;
+            default:
+                throw exception("Unsupported render target format: 0x{:X}", static_cast<u32>(format));
+        }
+    }
+
+    void Maxwell3D::UpdateRenderTargets() {
+        auto &control{registers.renderTargetControl};
+        for (size_t index{}; index < boundRenderTargets.size(); index++) {
+            auto &bound{boundRenderTargets[index]};
+            auto &renderTarget{registers.renderTargets[control.Map(index)]};
+            auto gpuAddress{renderTarget.address.Pack()};
+            if (index >= control.count || renderTarget.format == Registers::ColorFormat::None || !gpuAddress) {
+                bound = nullptr;
+                continue;
+            }
+
+            auto format{ConvertRenderTargetFormat(renderTarget.format)};
+            texture::Dimensions dimensions;
+            texture::TileMode tileMode;
+            texture::TileConfig tileConfig{};
+            size_t size;
+            if (renderTarget.tileMode.isLinear) {
+                // The width of a pitch-linear render target is its pitch in bytes
+                dimensions = texture::Dimensions(renderTarget.width / format.bpb, renderTarget.height);
+                tileMode = texture::TileMode::Pitch;
+                tileConfig.pitch = dimensions.width;
+                size = static_cast<size_t>(renderTarget.width) * renderTarget.height;
+            } else {
+                dimensions = texture::Dimensions(renderTarget.width, renderTarget.height);
+                tileMode = texture::TileMode::Block;
+                tileConfig.blockHeight = static_cast<u8>(1U << renderTarget.tileMode.blockHeightLog2);
+                tileConfig.blockDepth = static_cast<u8>(1U << renderTarget.tileMode.blockDepthLog2);
+                tileConfig.surfaceWidth = static_cast<u16>(renderTarget.width);
+                size = GetBlockLinearSize(renderTarget.width * format.bpb, renderTarget.height, tileConfig.blockHeight);
+            }
+
+            // Textures are addressed by their CPU address as that's what the guest's own accesses to them fault on
+            auto address{state.gpu->memoryManager.GetCpuAddress(gpuAddress, size)};
+            if (!address)
+                throw exception("Render target {} at 0x{:X} isn't contiguous in CPU memory", index, gpuAddress);
+
+            auto texture{state.gpu->textureCache.FindOrCreate(*address, dimensions, format, tileMode, tileConfig)};
+            if (!texture->host)
+                texture->InitializeTexture();
+            bound = std::move(texture);
+        }
+    }
+
+    void Maxwell3D::SynchronizeBuffers(bool indexed, u32 first, u32 count) {
+        auto &bufferCache{state.gpu->bufferCache};
+
+        std::bitset<0x10> used;
+        const auto &pipelineState{pipelineKey->state};
+        for (u32 index{}; index < pipelineState.vertexAttributeCount; index++)
+            used.set(pipelineState.vertexAttributes[index].binding);
+
+        // Vertex buffers are synchronized in their entirety as the range of vertices a draw fetches from each depends on the contents of the index buffer and the instance divisor
+        for (size_t index{}; index < used.size(); index++) {
+            auto &vertexBuffer{registers.vertexBuffers[index]};
+            if (!used.test(index) || !vertexBuffer.config.enable)
+                continue;
+
+            auto address{vertexBuffer.address.Pack()};
+            auto limit{registers.vertexBufferLimits[index].Pack()};
+            if (limit < address)
+                continue;
+
+            bufferCache.Synchronize(*bufferCache.Get(address, (limit - address) + 1));
+        }
+
+        if (indexed) {
+            u64 indexSize{1U << static_cast<u32>(registers.indexArray.format)};
+            bufferCache.Synchronize(*bufferCache.Get(registers.indexArray.address.Pack() + (first * indexSize), count * indexSize));
+        }
+    }
+
+    bool Maxwell3D::UpdateShaders() {
+        bool changed{};
+        for (size_t index{}; index < shader::StageCount; index++) {
+            const auto &program{registers.setProgram[index]};
+            auto &bound{boundShaders[index]};
+            if (!program.info.enable) {
+                if (bound.shader) {
+                    bound = {};
+                    changed = true;
+                }
+                continue;
+            }
+
+            // Programs are usually left bound across many draws, so the code of the bound shader is compared against memory rather than reading and hashing the program again
+            auto address{registers.shaderProgramRegion.Pack() + program.offset};
+            if (!bound.shader || bound.address != address || bound.shader->stage != program.info.stage || !bound.shader->Matches(state, address)) {
+                auto shader{state.gpu->shaderCache.Get(program.info.stage, address)};
+                changed |= shader != bound.shader;
+                bound = {address, std::move(shader)};
+            }
+        }
+        return changed;
+    }
+
     void Maxwell3D::HandleSemaphoreCounterOperation() {
+        using CounterType = Registers::SemaphoreInfo::CounterType;
+        auto &queryManager{state.gpu->queryManager};
         switch (registers.semaphore.info.counterType) {
-            case Registers::SemaphoreInfo::CounterType::Zero:
+            case CounterType::Zero:
                 WriteSemaphoreResult(0);
                 break;
+            case CounterType::SamplesPassed:
+                WriteSemaphoreResult(queryManager.GetCounter(QueryManager::Counter::SamplesPassed));
+                break;
+            case CounterType::InputVertices:
+            case CounterType::VertexShaderInvocations:
+                WriteSemaphoreResult(queryManager.GetCounter(QueryManager::Counter::InputVertices));
+                break;
+            case CounterType::InputPrimitives:
+            case CounterType::ClipperInputPrimitives:
+            case CounterType::ClipperOutputPrimitives:
+                WriteSemaphoreResult(queryManager.GetCounter(QueryManager::Counter::InputPrimitives));
+                break;
+            case CounterType::PrimitivesGenerated:
+                WriteSemaphoreResult(queryManager.GetCounter(QueryManager::Counter::PrimitivesGenerated));
+                break;
             default:
                 state.logger->Warn("Unsupported semaphore counter type: 0x{:X}", static_cast<u8>(registers.semaphore.info.counterType));
                 break;
@@ -151,26 +662,6 @@ namespace skyline::gpu::engine {
     }
 
     void Maxwell3D::WriteSemaphoreResult(u64 result) {
-        struct FourWordResult {
-            u64 value;
-            u64 timestamp;
-        };
-
-        switch (registers.semaphore.info.structureSize) {
-            case Registers::SemaphoreInfo::StructureSize::OneWord:
-                state.gpu->memoryManager.Write<u32>(static_cast<u32>(result), registers.semaphore.address.Pack());
-                break;
-            case Registers::SemaphoreInfo::StructureSize::FourWords: {
-                // Convert the current nanosecond time to GPU ticks
-                constexpr u64 NsToTickNumerator = 384;
-                constexpr u64 NsToTickDenominator = 625;
-
-                u64 nsTime = util::GetTimeNs();
-                u64 timestamp = (nsTime / NsToTickDenominator) * NsToTickNumerator + ((nsTime % NsToTickDenominator) * NsToTickNumerator) / NsToTickDenominator;
-
-                state.gpu->memoryManager.Write<FourWordResult>(FourWordResult{result, timestamp}, registers.semaphore.address.Pack());
-                break;
-            }
-        }
+        state.gpu->queryManager.Report(registers.semaphore.address.Pack(), result, registers.semaphore.info.structureSize == Registers::SemaphoreInfo::StructureSize::FourWords);
     }
 }
@@ -4,18 +4,29 @@
 #pragma once
 
 #include <array>
+#include <utility>
 #include <common.h>
 #include <gpu/texture.h>
 #include <gpu/macro_interpreter.h>
+#include <gpu/macro_hle.h>
+#include <gpu/macro_jit.h>
+#include <gpu/shader_cache.h>
 #include "engine.h"
 
 #define MAXWELL3D_OFFSET(field) U32_OFFSET(skyline::gpu::engine::Maxwell3D::Registers, field)
+#define MAXWELL3D_SIZE(field) (sizeof(std::declval<skyline::gpu::engine::Maxwell3D::Registers>().field) / sizeof(u32))
 
 namespace skyline {
     namespace constant {
         constexpr u32 Maxwell3DRegisterCounter = 0xE00; //!< The number of Maxwell 3D registers
     }
 
+    namespace gpu {
+        struct PipelineKey;
+        struct Pipeline;
+        struct DynamicState;
+    }
+
     namespace gpu::engine {
         /**
         * @brief The Maxwell 3D engine handles processing 3D graphics
@@ -27,14 +38,88 @@ namespace skyline {
             struct {
                 u32 index;
                 std::vector<u32> arguments;
-            } macroInvocation{}; //!< This hold the index and arguments of the macro that is pending execution
+            } macroInvocation{}; //!< This hold the index and arguments of the macro that is pending execution, arguments are only accumulated here when a macro's arguments are split across several calls
 
             MacroInterpreter macroInterpreter;
+            MacroHle macroHle;
+            MacroJit macroJit;
+            bool useMacroJit{}; //!< If macros should be executed by the JIT rather than the interpreter, the interpreter is still used for macros that the JIT cannot compile
+
+            struct BoundShader {
+                u64 address; //!< The GPU address the shader was read from
+                std::shared_ptr<ShaderCache::Shader> shader;
+            };
+            std::array<BoundShader, shader::StageCount> boundShaders{}; //!< The shader bound to every SetProgram slot, a shader is only looked up again when its address or the code at it changes
+
+          public:
+            /**
+             * @brief The groups of registers which are translated together, a group is marked as dirty when any register in it is written to so only the groups that changed are translated again on the next draw
+             */
+            enum DirtyFlag : u32 {
+                DirtyRasterizer = 1U << 0,
+                DirtyDepthStencil = 1U << 1,
+                DirtyBlend = 1U << 2,
+                DirtyVertexAttributes = 1U << 3,
+                DirtyViewport = 1U << 4,
+                DirtyScissor = 1U << 5,
+                DirtyRenderTargets = 1U << 6,
+                DirtyAll = (1U << 7) - 1,
+                DirtyPipelineState = DirtyRasterizer | DirtyDepthStencil | DirtyBlend | DirtyVertexAttributes, //!< The groups that are a part of the pipeline state
+            };
+
+          private:
+            u32 dirtyFlags{DirtyAll}; //!< The DirtyFlag groups with registers that were written to since they were last translated
+            std::unique_ptr<PipelineKey> pipelineKey; //!< The key of the pipeline of the last draw, its state is only translated from the registers again when they change
+            std::unique_ptr<DynamicState> dynamicState; //!< The dynamic state of the last draw, it's only translated from the registers again when they change
+            Pipeline *pipeline{}; //!< The pipeline of the last draw, this is nullptr if the key changed since then
+            std::array<std::shared_ptr<GuestTexture>, 8> boundRenderTargets{}; //!< The texture bound to every fragment shader output, this is nullptr for outputs without a render target
 
             void HandleSemaphoreCounterOperation();
 
             void WriteSemaphoreResult(u64 result);
 
+            /**
+             * @return If draws are enabled by the conditional rendering registers, reports are read without being flushed so this doesn't wait on the GPU
+             */
+            bool IsRenderEnabled();
+
+            /**
+             * @brief Handles a draw which is triggered by the end of a vertex array or an index array, the pipeline state of the draw is translated from the registers
+             */
+            void Draw();
+
+            /**
+             * @brief Updates the bound shaders from the SetProgram registers
+             * @return If any of the bound shaders changed
+             */
+            bool UpdateShaders();
+
+            /**
+             * @brief Looks up the textures of the active render targets from the render target registers
+             */
+            void UpdateRenderTargets();
+
+            /**
+             * @brief Synchronizes the index buffer and the vertex buffers used by the vertex attributes of a draw with the guest
+             */
+            void SynchronizeBuffers(bool indexed, u32 first, u32 count);
+
+            /**
+             * @brief Handles any side effects of writing to a register, this should only be called after the register has been written to
+             */
+            void HandleMethodSideEffect(u16 method, u32 argument);
+
+            /**
+             * @brief Writes a sequence of words to the constant buffer selected by the 'constantBufferUpdate' registers at its current offset, then advances the offset past them
+             * @note Games stream all constant buffer contents through this, so entire runs of data writes from the pushbuffer are handled with a single call
+             */
+            void UpdateConstantBuffer(std::span<const u32> data);
+
+            /**
+             * @brief Appends arguments to the pending macro invocation and executes it if this is the last call to it in the pushbuffer entry
+             */
+            void HandleMacroCall(u16 method, std::span<u32> arguments, bool lastCall);
+
           public:
             /**
             * @brief This holds the Maxwell3D engine's register space
@@ -100,6 +185,23 @@ namespace skyline {
                 };
                 static_assert(sizeof(ViewportTransform) == (0x8 * sizeof(u32)));
 
+                struct Scissor {
+                    u32 enable;
+
+                    struct {
+                        u16 minimum;
+                        u16 maximum;
+                    } horizontal;
+
+                    struct {
+                        u16 minimum;
+                        u16 maximum;
+                    } vertical;
+
+                    u32 _pad0_;
+                };
+                static_assert(sizeof(Scissor) == (sizeof(u32) * 4));
+
                 struct Viewport {
                     struct {
                         u16 x;
@@ -375,11 +477,148 @@ namespace skyline {
                 };
                 static_assert(sizeof(SemaphoreInfo) == sizeof(u32));
 
+                enum class CounterReset : u32 {
+                    SampleCount = 0x01,
+                    PrimitivesGenerated = 0x1F,
+                };
+
+                /**
+                 * @brief The condition that draws are performed on, this is used for conditional rendering
+                 */
+                enum class RenderEnableMode : u32 {
+                    Never = 0,
+                    Always = 1,
+                    NonZero = 2, //!< If the value of the report at the address is non-zero
+                    Equal = 3, //!< If the values of the two consecutive four word reports at the address are equal
+                    NotEqual = 4, //!< If the values of the two consecutive four word reports at the address differ
+                };
+
+                enum class PrimitiveTopology : u16 {
+                    Points = 0x0,
+                    Lines = 0x1,
+                    LineLoop = 0x2,
+                    LineStrip = 0x3,
+                    Triangles = 0x4,
+                    TriangleStrip = 0x5,
+                    TriangleFan = 0x6,
+                    Quads = 0x7,
+                    QuadStrip = 0x8,
+                    Polygon = 0x9,
+                    LinesAdjacency = 0xA,
+                    LineStripAdjacency = 0xB,
+                    TrianglesAdjacency = 0xC,
+                    TriangleStripAdjacency = 0xD,
+                    Patches = 0xE,
+                };
+
+                union VertexBegin {
+                    u32 raw;
+
+                    struct {
+                        PrimitiveTopology topology : 16;
+                        u16 _pad0_ : 10;
+                        bool instanceNext : 1;
+                        bool instanceContinue : 1;
+                        u8 _pad1_ : 4;
+                    };
+                };
+                static_assert(sizeof(VertexBegin) == sizeof(u32));
+
+                enum class IndexFormat : u32 {
+                    UnsignedByte = 0,
+                    UnsignedShort = 1,
+                    UnsignedInt = 2,
+                };
+
+                struct VertexBuffer {
+                    struct {
+                        u16 stride : 12; //!< The amount of bytes between consecutive vertices
+                        bool enable : 1;
+                        u32 _pad_ : 19;
+                    } config;
+                    Address address;
+                    u32 divisor; //!< The amount of instances that share a vertex when instancing is enabled for the buffer
+                };
+                static_assert(sizeof(VertexBuffer) == (sizeof(u32) * 4));
+
                 enum class CoordOrigin : u8 {
                     LowerLeft = 0,
                     UpperLeft = 1
                 };
 
+                struct SetProgramInfo {
+                    struct {
+                        bool enable : 1;
+                        u8 _pad0_ : 3;
+                        gpu::shader::Stage stage : 4;
+                        u32 _pad1_ : 24;
+                    } info;
+                    u32 offset; //!< The offset of the program from the shader program region
+                    u32 _pad2_[0xE];
+                };
+                static_assert(sizeof(SetProgramInfo) == (sizeof(u32) * 0x10));
+
+                enum class ColorFormat : u32 {
+                    None = 0x0,
+                    A8R8G8B8Unorm = 0xCF,
+                    A2B10G10R10Unorm = 0xD1,
+                    A8B8G8R8Unorm = 0xD5,
+                    A8B8G8R8Srgb = 0xD6,
+                    R5G6B5Unorm = 0xE8,
+                };
+
+                struct RenderTarget {
+                    Address address;
+                    u32 width; //!< The width of the render target in pixels, this is the pitch in bytes for pitch-linear render targets
+                    u32 height;
+                    ColorFormat format;
+
+                    struct {
+                        u8 blockWidthLog2 : 4; //!< The width of a block in GOBs with log2 applied
+                        u8 blockHeightLog2 : 4; //!< The height of a block in GOBs with log2 applied
+                        u8 blockDepthLog2 : 4; //!< The depth of a block in GOBs with log2 applied
+                        bool isLinear : 1; //!< If the render target is pitch-linear rather than block-linear
+                        u8 _pad0_ : 3;
+                        bool is3d : 1;
+                        u16 _pad1_ : 15;
+                    } tileMode;
+
+                    struct {
+                        u16 layerCount;
+                        bool volume : 1;
+                        u16 _pad_ : 15;
+                    } arrayMode;
+
+                    u32 layerStrideLsr2; //!< The stride between layers in bytes with 2 bits right shifted
+                    u32 baseLayer;
+                    u32 _pad_[0x7];
+                };
+                static_assert(sizeof(RenderTarget) == (sizeof(u32) * 0x10));
+
+                union RenderTargetControl {
+                    u32 raw;
+
+                    struct {
+                        u8 count : 4; //!< The amount of active render targets, they're mapped to fragment shader outputs by the map
+                        u8 map0 : 3;
+                        u8 map1 : 3;
+                        u8 map2 : 3;
+                        u8 map3 : 3;
+                        u8 map4 : 3;
+                        u8 map5 : 3;
+                        u8 map6 : 3;
+                        u8 map7 : 3;
+                    };
+
+                    /**
+                     * @return The index of the render target that the supplied fragment shader output is written to
+                     */
+                    u8 Map(size_t index) {
+                        return static_cast<u8>((raw >> (4 + (index * 3))) & 0b111);
+                    }
+                };
+                static_assert(sizeof(RenderTargetControl) == sizeof(u32));
+
                 struct {
                     u32 _pad0_[0x40]; // 0x0
                     u32 noOperation; // 0x40
@@ -407,17 +646,27 @@ namespace skyline {
 
                     u32 _pad3_[0x2C]; // 0xB3
                     u32 rasterizerEnable; // 0xDF
-                    u32 _pad4_[0x1A0]; // 0xE0
+                    u32 _pad4_[0x120]; // 0xE0
+                    std::array<RenderTarget, 8> renderTargets; // 0x200
                     std::array<ViewportTransform, 0x10> viewportTransform; // 0x280
                     std::array<Viewport, 0x10> viewport; // 0x300
-                    u32 _pad5_[0x2B]; // 0x340
+                    u32 _pad5_[0x1D]; // 0x340
+
+                    struct {
+                        u32 first; // 0x35D
+                        u32 count; // 0x35E
+                    } vertexArray;
+
+                    u32 _pad6_[0xC]; // 0x35F
 
                     struct {
                         PolygonMode front; // 0x36B
                         PolygonMode back; // 0x36C
                     } polygonMode;
 
-                    u32 _pad6_[0x68]; // 0x36D
+                    u32 _pad7_[0x13]; // 0x36D
+                    std::array<Scissor, 0x10> scissor; // 0x380
+                    u32 _pad8_[0x15]; // 0x3C0
 
                     struct {
                         u32 compareRef; // 0x3D5
@@ -425,11 +674,18 @@ namespace skyline {
                         u32 compareMask; // 0x3D7
                     } stencilBackExtra;
 
-                    u32 _pad7_[0x13]; // 0x3D8
+                    u32 _pad9_[0x13]; // 0x3D8
                     u32 rtSeparateFragData; // 0x3EB
-                    u32 _pad8_[0x6C]; // 0x3EC
+                    u32 _pad10_[0x6C]; // 0x3EC
                     std::array<VertexAttribute, 0x20> vertexAttributeState; // 0x458
-                    u32 _pad9_[0x4B]; // 0x478
+                    u32 _pad11_[0xF]; // 0x478
+                    RenderTargetControl renderTargetControl; // 0x487
+                    u32 _pad12_[0x2B]; // 0x488
+                    u32 depthTestEnable; // 0x4B3
+                    u32 _pad13_[0x5]; // 0x4B4
+                    u32 independentBlendEnable; // 0x4B9
+                    u32 depthWriteEnable; // 0x4BA
+                    u32 _pad14_[0x8]; // 0x4BB
                     CompareOp depthTestFunc; // 0x4C3
                     float alphaTestRef; // 0x4C4
                     CompareOp alphaTestFunc; // 0x4C5
@@ -442,7 +698,7 @@ namespace skyline {
                         float a; // 0x4CA
                     } blendConstant;
 
-                    u32 _pad10_[0x4]; // 0x4CB
+                    u32 _pad15_[0x4]; // 0x4CB
 
                     struct {
                         u32 seperateAlpha; // 0x4CF
@@ -474,21 +730,22 @@ namespace skyline {
                         u32 writeMask; // 0x4E7
                     } stencilFront;
 
-                    u32 _pad11_[0x4]; // 0x4E8
+                    u32 _pad16_[0x4]; // 0x4E8
                     float lineWidthSmooth; // 0x4EC
                     float lineWidthAliased; // 0x4D
-                    u32 _pad12_[0x1F]; // 0x4EE
+                    u32 _pad17_[0x1F]; // 0x4EE
                     u32 drawBaseVertex; // 0x50D
                     u32 drawBaseInstance; // 0x50E
-                    u32 _pad13_[0x35]; // 0x50F
+                    u32 _pad18_[0x35]; // 0x50F
                     u32 clipDistanceEnable; // 0x544
                     u32 sampleCounterEnable; // 0x545
                     float pointSpriteSize; // 0x546
                     u32 zCullStatCountersEnable; // 0x547
                     u32 pointSpriteEnable; // 0x548
-                    u32 _pad14_; // 0x549
+                    u32 _pad19_; // 0x549
                     u32 shaderExceptions; // 0x54A
-                    u32 _pad15_[0x2]; // 0x54B
+                    u32 _pad20_; // 0x54B
+                    CounterReset counterReset; // 0x54C
                     u32 multisampleEnable; // 0x54D
                     u32 depthTargetEnable; // 0x54E
 
@@ -499,14 +756,19 @@ namespace skyline {
                         u32 _pad1_ : 27;
                     } multisampleControl; // 0x54F
 
-                    u32 _pad16_[0x7]; // 0x550
+                    u32 _pad21_[0x4]; // 0x550
+
+                    struct {
+                        Address address; // 0x554 The address of the reports that the condition is evaluated on
+                        RenderEnableMode mode; // 0x556
+                    } renderEnable;
 
                     struct {
                         Address address; // 0x557
                         u32 maximumIndex; // 0x559
                     } texSamplerPool;
 
-                    u32 _pad17_; // 0x55A
+                    u32 _pad22_; // 0x55A
                     u32 polygonOffsetFactor; // 0x55B
                     u32 lineSmoothEnable; // 0x55C
 
@@ -515,7 +777,7 @@ namespace skyline {
                         u32 maximumIndex; // 0x55F
                     } texHeaderPool;
 
-                    u32 _pad18_[0x5]; // 0x560
+                    u32 _pad23_[0x5]; // 0x560
 
                     u32 stencilTwoSideEnable; // 0x565
 
@@ -526,7 +788,7 @@ namespace skyline {
                         CompareOp compareOp; // 0x569
                     } stencilBack;
 
-                    u32 _pad19_[0x17]; // 0x56A
+                    u32 _pad24_[0x17]; // 0x56A
 
                     struct {
                         u8 _unk_ : 2;
@@ -535,16 +797,34 @@ namespace skyline {
                         u32 _pad_ : 19;
                     } pointCoordReplace; // 0x581
 
-                    u32 _pad20_[0xC4]; // 0x582
+                    Address shaderProgramRegion; // 0x582 The base address of all shader programs, the offsets of programs are relative to this
+                    u32 _pad25_; // 0x584
+
+                    struct {
+                        u32 vertexEndGl; // 0x585
+                        VertexBegin vertexBeginGl; // 0x586
+                    } draw;
+
+                    u32 _pad26_[0x6B]; // 0x587
+
+                    struct {
+                        Address address; // 0x5F2
+                        Address endAddress; // 0x5F4
+                        IndexFormat format; // 0x5F6
+                        u32 first; // 0x5F7
+                        u32 count; // 0x5F8
+                    } indexArray;
+
+                    u32 _pad27_[0x4D]; // 0x5F9
                     u32 cullFaceEnable; // 0x646
                     FrontFace frontFace; // 0x647
                     CullFace cullFace; // 0x648
                     u32 pixelCentreImage; // 0x649
-                    u32 _pad21_; // 0x64A
+                    u32 _pad28_; // 0x64A
                     u32 viewportTransformEnable; // 0x64B
-                    u32 _pad22_[0x34]; // 0x64A
+                    u32 _pad29_[0x34]; // 0x64A
                     std::array<ColorWriteMask, 8> colorMask; // 0x680 For each render target
-                    u32 _pad23_[0x38]; // 0x688
+                    u32 _pad30_[0x38]; // 0x688
 
                     struct {
                         Address address; // 0x6C0
@@ -552,10 +832,22 @@ namespace skyline {
                         SemaphoreInfo info; // 0x6C3
                     } semaphore;
 
-                    u32 _pad24_[0xBC]; // 0x6C4
+                    u32 _pad31_[0x3C]; // 0x6C4
+                    std::array<VertexBuffer, 0x10> vertexBuffers; // 0x700
+                    u32 _pad32_[0x40]; // 0x740
                     std::array<Blend, 8> independentBlend; // 0x780 For each render target
-                    u32 _pad25_[0x100]; // 0x7C0
+                    std::array<Address, 0x10> vertexBufferLimits; // 0x7C0 The address of the last byte of each vertex buffer
+                    u32 _pad33_[0x20]; // 0x7E0
+                    std::array<SetProgramInfo, gpu::shader::StageCount> setProgram; // 0x800
+                    u32 _pad34_[0x60]; // 0x860
                     u32 firmwareCall[0x20]; // 0x8C0
+
+                    struct {
+                        u32 size; // 0x8E0 The size of the constant buffer that's being updated in bytes
+                        Address address; // 0x8E1
+                        u32 offset; // 0x8E3 The offset into the constant buffer that the next data word is written to, this is incremented by every write
+                        std::array<u32, 0x10> data; // 0x8E4 Every write to any of these registers is written to the constant buffer
+                    } constantBufferUpdate;
                 };
             };
             static_assert(sizeof(Registers) == (constant::Maxwell3DRegisterCounter * sizeof(u32)));
@@ -568,12 +860,24 @@ namespace skyline {
 
             Maxwell3D(const DeviceState &state);
 
+            ~Maxwell3D();
+
             /**
              * @brief Resets the Maxwell 3D registers to their default values
              */
             void ResetRegs();
 
             void CallMethod(MethodParams params);
+
+            /**
+             * @brief Register writes are done in bulk with only registers that have side effects being dispatched individually
+             */
+            void CallMethodBatch(u16 method, std::span<u32> arguments, MethodIncrement increment, u32 subChannel);
         };
+
+        /**
+         * @return The texture format corresponding to a render target format, this is also used for the surfaces of the Fermi 2D engine
+         */
+        texture::Format ConvertRenderTargetFormat(Maxwell3D::Registers::ColorFormat format);
     }
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include "maxwell_compute.h"
+
+namespace skyline::gpu::engine {
+    MaxwellCompute::MaxwellCompute(const DeviceState &state) : Engine(state), upload(state) {}
+
+    void MaxwellCompute::Launch() {
+        // A launch can't do anything until compute programs can be translated, so its descriptor and program aren't read and no pipeline is created for it
+        if constexpr (!shader::IsStageSupported(shader::Stage::Compute)) {
+            state.logger->Debug("Skipping compute launch as compute programs can't be translated yet");
+            return;
+        }
+
+        auto &gpu{*state.gpu};
+        LaunchDescriptor descriptor;
+        try {
+            descriptor = gpu.memoryManager.Read<LaunchDescriptor>(static_cast<u64>(registers.launchDescriptorAddress) << 8);
+
+            // Compute programs are commonly launched repeatedly, so the code of the last program is compared against memory rather than reading and hashing it again
+            auto address{registers.shaderProgramRegion.Pack() + descriptor.programStart};
+            if (!boundShader || boundShaderAddress != address || !boundShader->Matches(state, address)) {
+                boundShader = gpu.shaderCache.Get(shader::Stage::Compute, address);
+                boundShaderAddress = address;
+            }
+        } catch (const exception &e) {
+            state.logger->Warn("Skipping compute launch with an unreadable descriptor or program: {}", e.what());
+            return;
+        }
+
+        ComputePipelineKey key{boundShader->hash, {descriptor.blockDimX, descriptor.blockDimY, descriptor.blockDimZ}, descriptor.sharedMemorySize};
+        auto &pipeline{gpu.pipelineCache.GetCompute(key, boundShader)};
+
+        // A launch is skipped until its shader is translated in the same way as draws, so translation never stalls the GPU
+        auto status{pipeline.UpdateStatus()};
+        state.logger->Debug("Compute Launch: Grid: {}x{}x{}, Block: {}x{}x{}, Shared Memory: 0x{:X}, Pipeline Status: {}", static_cast<u32>(descriptor.gridDimensions.x), descriptor.gridDimensions.y, descriptor.gridDimensions.z, descriptor.blockDimX, descriptor.blockDimY, descriptor.blockDimZ, static_cast<u32>(descriptor.sharedMemorySize), static_cast<u8>(status));
+        if (status != ComputePipeline::Status::Ready)
+            return;
+
+        try {
+            auto &bufferCache{gpu.bufferCache};
+            for (size_t index{}; index < descriptor.constantBuffers.size(); index++) {
+                const auto &constantBuffer{descriptor.constantBuffers[index]};
+                if (descriptor.constantBufferEnableMask & (1U << index) && constantBuffer.size)
+                    bufferCache.Synchronize(*bufferCache.Get(constantBuffer.Pack(), constantBuffer.size));
+            }
+        } catch (const exception &e) {
+            state.logger->Warn("Skipping compute launch with inaccessible constant buffers: {}", e.what());
+            return;
+        }
+    }
+
+    void MaxwellCompute::CallMethod(MethodParams params) {
+        CallMethodBatch(params.method, std::span(&params.argument, 1), MethodIncrement::Increment, params.subChannel);
+    }
+
+    void MaxwellCompute::CallMethodBatch(u16 method, std::span<u32> arguments, MethodIncrement increment, u32 subChannel) {
+        constexpr u16 UploadStart{MAXWELLCOMPUTE_OFFSET(upload)};
+        constexpr u16 UploadEnd{UploadStart + (sizeof(Registers::upload) / sizeof(u32))};
+        static_assert(UploadStart == KEPLERMEMORY_OFFSET(lineLengthIn) && UploadEnd == KEPLERMEMORY_OFFSET(loadInlineData) + 1);
+
+        for (size_t index{}; index < arguments.size();) {
+            auto argumentMethod{GetBatchMethod(method, index, increment)};
+            if (argumentMethod >= constant::MaxwellComputeRegisterCount) {
+                state.logger->Warn("Called method outside of the Maxwell Compute register space: 0x{:X} args: 0x{:X}", argumentMethod, arguments[index]);
+                index++;
+                continue;
+            }
+
+            if (argumentMethod >= UploadStart && argumentMethod < UploadEnd) {
+                // Every argument that stays within the upload registers is forwarded at once, this keeps inline data from being appended a word at a time
+                size_t count{1};
+                if (increment == MethodIncrement::NonIncrement || (increment == MethodIncrement::IncrementOnce && index))
+                    count = arguments.size() - index;
+                else if (increment == MethodIncrement::Increment)
+                    count = std::min<size_t>(arguments.size() - index, UploadEnd - argumentMethod);
+
+                upload.CallMethodBatch(argumentMethod, arguments.subspan(index, count), increment == MethodIncrement::Increment ? MethodIncrement::Increment : MethodIncrement::NonIncrement, subChannel);
+                std::copy_n(upload.registers.raw.begin() + UploadStart, UploadEnd - UploadStart, registers.upload);
+                index += count;
+                continue;
+            }
+
+            registers.raw[argumentMethod] = arguments[index];
+            if (argumentMethod == MAXWELLCOMPUTE_OFFSET(launch))
+                Launch();
+            index++;
+        }
+    }
+}
@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <array>
+#include <common.h>
+#include <gpu/pipeline_cache.h>
+#include "engine.h"
+#include "kepler_memory.h"
+
+#define MAXWELLCOMPUTE_OFFSET(field) U32_OFFSET(skyline::gpu::engine::MaxwellCompute::Registers, field)
+
+namespace skyline {
+    namespace constant {
+        constexpr u32 MaxwellComputeRegisterCount = 0xCF8; //!< The number of Maxwell Compute registers
+    }
+
+    namespace gpu::engine {
+        /**
+        * @brief The Maxwell Compute engine launches compute programs that are described by a launch descriptor in GPU memory
+        */
+        class MaxwellCompute : public Engine {
+          public:
+            /**
+            * @brief This holds the Maxwell Compute engine's register space
+            */
+#pragma pack(push, 1)
+            union Registers {
+                std::array<u32, constant::MaxwellComputeRegisterCount> raw;
+
+                struct Address {
+                    u32 high;
+                    u32 low;
+
+                    u64 Pack() {
+                        return (static_cast<u64>(high) << 32) | low;
+                    }
+                };
+                static_assert(sizeof(Address) == sizeof(u64));
+
+                struct {
+                    u32 _pad0_[0x60]; // 0x0
+                    u32 upload[0xE]; // 0x60 The inline upload registers, these are laid out identically to the ones in the Kepler Memory engine
+                    u32 _pad1_[0x3F]; // 0x6E
+                    u32 launchDescriptorAddress; // 0xAD The address of the launch descriptor shifted right by 8 bits
+                    u32 _pad2_; // 0xAE
+                    u32 launch; // 0xAF
+                    u32 _pad3_[0x4D2]; // 0xB0
+                    Address shaderProgramRegion; // 0x582
+                    u32 _pad4_[0x774]; // 0x584
+                };
+            };
+            static_assert(sizeof(Registers) == (constant::MaxwellComputeRegisterCount * sizeof(u32)));
+
+            /**
+            * @brief The launch descriptor (QMD) which describes a single launch of a compute program, only the fields which are used are defined
+            */
+            struct LaunchDescriptor {
+                u32 _pad0_[0x8]; // 0x0
+                u32 programStart; // 0x8 The offset of the program from the shader program region
+                u32 _pad1_[0x3]; // 0x9
+
+                struct {
+                    u32 x : 31;
+                    u32 _pad_ : 1;
+                    u16 y;
+                    u16 z;
+                } gridDimensions; // 0xC The amount of thread blocks on every axis
+
+                u32 _pad2_[0x3]; // 0xE
+
+                u32 sharedMemorySize : 18; // 0x11 The size of the shared memory of a thread block in bytes
+                u32 _pad3_ : 14;
+
+                u16 _pad4_; // 0x12
+                u16 blockDimX; // 0x12 The amount of threads in a block on every axis
+                u16 blockDimY; // 0x13
+                u16 blockDimZ; // 0x13
+
+                u32 constantBufferEnableMask : 8; // 0x14 A bitmask of the constant buffers which are bound to the program
+                u32 _pad5_ : 24;
+                u32 _pad6_[0x8]; // 0x15
+
+                struct ConstantBuffer {
+                    u32 addressLow;
+                    u32 addressHigh : 8;
+                    u32 _pad_ : 7;
+                    u32 size : 17; //!< The size of the constant buffer in bytes
+
+                    u64 Pack() const {
+                        return (static_cast<u64>(addressHigh) << 32) | addressLow;
+                    }
+                };
+                std::array<ConstantBuffer, 8> constantBuffers; // 0x1D
+
+                u32 _pad7_[0x13]; // 0x2D
+            };
+            static_assert(sizeof(LaunchDescriptor) == (0x40 * sizeof(u32)));
+#pragma pack(pop)
+
+            Registers registers{}; //!< The Maxwell Compute register space
+
+          private:
+            KeplerMemory upload; //!< The inline uploads of this engine are handled by a Kepler Memory engine with the upload registers mirrored into it
+            u64 boundShaderAddress{}; //!< The GPU address of the program that boundShader was looked up with
+            std::shared_ptr<ShaderCache::Shader> boundShader; //!< The shader of the last launch, it's reused while the program at its address doesn't change
+
+            /**
+             * @brief Launches the compute program described by the launch descriptor at launchDescriptorAddress, this is triggered by writing to launch
+             */
+            void Launch();
+
+          public:
+            MaxwellCompute(const DeviceState &state);
+
+            void CallMethod(MethodParams params);
+
+            /**
+             * @brief Methods in the upload registers are forwarded to the Kepler Memory engine in bulk so inline data is appended at once
+             */
+            void CallMethodBatch(u16 method, std::span<u32> arguments, MethodIncrement increment, u32 subChannel);
+        };
+    }
+}
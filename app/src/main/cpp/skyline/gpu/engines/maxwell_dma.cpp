@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <thread>
+#include <gpu.h>
+#include <gpu/block_linear.h>
+#include "maxwell_dma.h"
+
+namespace skyline::gpu::engine {
+    constexpr size_t ThreadedCopyThreshold = 1 << 20; //!< The minimum size of a copy in bytes for it to be split across multiple threads
+
+    /**
+     * @brief Runs a copy over a range of lines, large copies are split into contiguous ranges of lines with the calling thread copying the last range
+     * @param size The total size of the copy in bytes
+     * @param alignment The alignment of the boundaries between ranges in lines
+     * @param copyLines A function that copies all lines in the range [start, end)
+     */
+    template<typename Function>
+    void SplitLines(size_t size, u32 lineCount, u32 alignment, Function copyLines) {
+        auto threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1U), lineCount / alignment);
+        if (size < ThreadedCopyThreshold || threadCount <= 1) {
+            copyLines(0, lineCount);
+            return;
+        }
+
+        auto linesPerThread = util::AlignUp((lineCount + threadCount - 1) / threadCount, alignment);
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount - 1);
+        u32 line = 0;
+        for (; line + linesPerThread < lineCount; line += linesPerThread)
+            threads.emplace_back(copyLines, line, line + linesPerThread);
+
+        copyLines(line, lineCount);
+
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    MaxwellDma::MaxwellDma(const DeviceState &state) : Engine(state) {}
+
+    std::span<u8> MaxwellDma::MapRegion(u64 address, u64 size, std::vector<u8> &staging) {
+        auto span{state.gpu->memoryManager.GetHostSpan(address, size)};
+        if (!span.empty() || !size)
+            return span;
+
+        staging.resize(size);
+        state.gpu->memoryManager.Read(staging.data(), address, size);
+        return staging;
+    }
+
+    u32 MaxwellDma::GetBytesPerPixel() {
+        if (!registers.launchDma.remapEnable)
+            return 1;
+
+        auto &remap{registers.remapComponents};
+        using Swizzle = Registers::RemapComponents::Swizzle;
+        if (remap.numSrcComponents != remap.numDstComponents || remap.dstX != Swizzle::SrcX || (remap.numDstComponents >= 1 && remap.dstY != Swizzle::SrcY) || (remap.numDstComponents >= 2 && remap.dstZ != Swizzle::SrcZ) || (remap.numDstComponents >= 3 && remap.dstW != Swizzle::SrcW))
+            state.logger->Warn("Unsupported DMA component remapping: 0x{:X}", registers.raw[MAXWELLDMA_OFFSET(remapComponents)]);
+
+        return (static_cast<u32>(remap.componentSize) + 1) * (static_cast<u32>(remap.numDstComponents) + 1);
+    }
+
+    void MaxwellDma::CopyPitchToPitch() {
+        auto lineLength{registers.lineLengthIn * GetBytesPerPixel()};
+        if (!lineLength)
+            return;
+
+        if (!registers.launchDma.multiLineEnable) {
+            // A single line copy is split into arbitrary chunks as it's linear on both sides
+            constexpr u32 ChunkSize = 0x1000;
+
+            std::vector<u8> srcStaging, dstStaging;
+            state.gpu->memoryManager.SynchronizeAccess(registers.offsetIn.Pack(), lineLength, false);
+            state.gpu->memoryManager.SynchronizeAccess(registers.offsetOut.Pack(), lineLength, true);
+            auto src{MapRegion(registers.offsetIn.Pack(), lineLength, srcStaging)};
+            auto dst{MapRegion(registers.offsetOut.Pack(), lineLength, dstStaging)};
+
+            SplitLines(lineLength, util::AlignUp(lineLength, ChunkSize) / ChunkSize, 1, [&](u32 start, u32 end) {
+                auto offset{static_cast<size_t>(start) * ChunkSize};
+                std::memcpy(dst.data() + offset, src.data() + offset, std::min(static_cast<size_t>(end) * ChunkSize, static_cast<size_t>(lineLength)) - offset);
+            });
+
+            if (!dstStaging.empty())
+                state.gpu->memoryManager.Write(dstStaging.data(), registers.offsetOut.Pack(), dstStaging.size());
+            return;
+        }
+
+        auto lineCount{registers.lineCount};
+        if (!lineCount)
+            return;
+
+        auto pitchIn{registers.pitchIn}, pitchOut{registers.pitchOut};
+        auto srcSize{(static_cast<u64>(lineCount) - 1) * pitchIn + lineLength}, dstSize{(static_cast<u64>(lineCount) - 1) * pitchOut + lineLength};
+        std::vector<u8> srcStaging, dstStaging;
+        state.gpu->memoryManager.SynchronizeAccess(registers.offsetIn.Pack(), srcSize, false);
+        state.gpu->memoryManager.SynchronizeAccess(registers.offsetOut.Pack(), dstSize, true);
+        auto src{MapRegion(registers.offsetIn.Pack(), srcSize, srcStaging)};
+        auto dst{MapRegion(registers.offsetOut.Pack(), dstSize, dstStaging)};
+
+        SplitLines(static_cast<size_t>(lineLength) * lineCount, lineCount, 1, [&](u32 start, u32 end) {
+            if (pitchIn == lineLength && pitchOut == lineLength) {
+                std::memcpy(dst.data() + static_cast<size_t>(start) * lineLength, src.data() + static_cast<size_t>(start) * lineLength, static_cast<size_t>(end - start) * lineLength);
+                return;
+            }
+
+            auto inputLine{src.data() + static_cast<size_t>(start) * pitchIn};
+            auto outputLine{dst.data() + static_cast<size_t>(start) * pitchOut};
+            for (u32 line = start; line < end; line++) {
+                std::memcpy(outputLine, inputLine, lineLength);
+                inputLine += pitchIn;
+                outputLine += pitchOut;
+            }
+        });
+
+        if (!dstStaging.empty())
+            state.gpu->memoryManager.Write(dstStaging.data(), registers.offsetOut.Pack(), dstStaging.size());
+    }
+
+    void MaxwellDma::CopyBlockLinear(bool toPitch) {
+        auto &surface{toPitch ? registers.srcSurface : registers.dstSurface};
+        auto surfaceAddress{toPitch ? registers.offsetIn.Pack() : registers.offsetOut.Pack()};
+        auto pitchAddress{toPitch ? registers.offsetOut.Pack() : registers.offsetIn.Pack()};
+        auto pitch{toPitch ? registers.pitchOut : registers.pitchIn};
+
+        if (surface.depth > 1 || surface.layer)
+            state.logger->Warn("Unsupported DMA copy on a 3D block-linear surface: Depth: {}, Layer: {}", surface.depth, surface.layer);
+
+        auto bytesPerPixel{GetBytesPerPixel()};
+        auto lineLength{registers.lineLengthIn * bytesPerPixel}; // The width of the copied region in bytes
+        auto lineCount{registers.launchDma.multiLineEnable ? registers.lineCount : 1};
+        if (!lineCount || !lineLength)
+            return;
+
+        u32 blockHeight{1U << surface.blockSize.height}; // The height of a block in GOBs
+        auto originX{static_cast<u32>(surface.origin.x) * bytesPerPixel}, originY{static_cast<u32>(surface.origin.y)};
+        auto surfaceWidth{surface.width * bytesPerPixel}; // The width of the surface in bytes
+        if (originX + lineLength > surfaceWidth || originY + lineCount > surface.height)
+            throw exception("DMA copy region exceeds the block-linear surface: Origin: ({}, {}), Region: {}x{}, Surface: {}x{}", originX, originY, lineLength, lineCount, surfaceWidth, surface.height);
+
+        auto surfaceSize{GetBlockLinearSize(surfaceWidth, surface.height, blockHeight)}, pitchSize{(static_cast<u64>(lineCount) - 1) * pitch + lineLength};
+        std::vector<u8> surfaceStaging, pitchStaging;
+        state.gpu->memoryManager.SynchronizeAccess(surfaceAddress, surfaceSize, !toPitch);
+        state.gpu->memoryManager.SynchronizeAccess(pitchAddress, pitchSize, toPitch);
+        auto blockLinear{MapRegion(surfaceAddress, surfaceSize, surfaceStaging).data()};
+        auto pitchLinear{MapRegion(pitchAddress, pitchSize, pitchStaging).data()};
+
+        auto copyLines{[=](u32 start, u32 end) {
+            if (toPitch)
+                CopyBlockLinearLines<true>(blockLinear, surfaceWidth, blockHeight, pitchLinear, pitch, originX, originY, lineLength, start, end);
+            else
+                CopyBlockLinearLines<false>(blockLinear, surfaceWidth, blockHeight, pitchLinear, pitch, originX, originY, lineLength, start, end);
+        }};
+
+        // Ranges are split on GOB boundaries of the surface so that every GOB fully inside the region can still use the vectorized kernels
+        if (originY % GobHeight == 0)
+            SplitLines(static_cast<size_t>(lineLength) * lineCount, lineCount, GobHeight, copyLines);
+        else
+            copyLines(0, lineCount);
+
+        if (toPitch && !pitchStaging.empty())
+            state.gpu->memoryManager.Write(pitchStaging.data(), pitchAddress, pitchStaging.size());
+        else if (!toPitch && !surfaceStaging.empty())
+            state.gpu->memoryManager.Write(surfaceStaging.data(), surfaceAddress, surfaceStaging.size());
+    }
+
+    void MaxwellDma::ReleaseSemaphore() {
+        struct FourWordResult {
+            u64 value;
+            u64 timestamp;
+        };
+
+        switch (registers.launchDma.semaphoreType) {
+            case Registers::SemaphoreType::None:
+                break;
+            case Registers::SemaphoreType::ReleaseOneWord:
+                state.gpu->memoryManager.Write<u32>(registers.semaphore.payload, registers.semaphore.address.Pack());
+                break;
+            case Registers::SemaphoreType::ReleaseFourWord: {
+                // Convert the current nanosecond time to GPU ticks
+                constexpr u64 NsToTickNumerator = 384;
+                constexpr u64 NsToTickDenominator = 625;
+
+                u64 nsTime = util::GetTimeNs();
+                u64 timestamp = (nsTime / NsToTickDenominator) * NsToTickNumerator + ((nsTime % NsToTickDenominator) * NsToTickNumerator) / NsToTickDenominator;
+
+                state.gpu->memoryManager.Write<FourWordResult>(FourWordResult{registers.semaphore.payload, timestamp}, registers.semaphore.address.Pack());
+                break;
+            }
+            default:
+                state.logger->Warn("Unsupported DMA semaphore type: 0x{:X}", static_cast<u8>(registers.launchDma.semaphoreType));
+                break;
+        }
+    }
+
+    void MaxwellDma::LaunchDma() {
+        auto &launch{registers.launchDma};
+
+        if (launch.dataTransferType != Registers::DataTransferType::None) {
+            using MemoryLayout = Registers::MemoryLayout;
+            if (launch.srcMemoryLayout == MemoryLayout::Pitch && launch.dstMemoryLayout == MemoryLayout::Pitch)
+                CopyPitchToPitch();
+            else if (launch.srcMemoryLayout == MemoryLayout::BlockLinear && launch.dstMemoryLayout == MemoryLayout::Pitch)
+                CopyBlockLinear(true);
+            else if (launch.srcMemoryLayout == MemoryLayout::Pitch && launch.dstMemoryLayout == MemoryLayout::BlockLinear)
+                CopyBlockLinear(false);
+            else
+                state.logger->Warn("Unsupported DMA copy between two block-linear surfaces");
+        }
+
+        ReleaseSemaphore();
+    }
+
+    void MaxwellDma::CallMethod(MethodParams params) {
+        if (params.method >= constant::MaxwellDmaRegisterCount) {
+            state.logger->Warn("Called method outside of the Maxwell DMA register space: 0x{:X} args: 0x{:X}", params.method, params.argument);
+            return;
+        }
+
+        registers.raw[params.method] = params.argument;
+
+        if (params.method == MAXWELLDMA_OFFSET(launchDma))
+            LaunchDma();
+    }
+}
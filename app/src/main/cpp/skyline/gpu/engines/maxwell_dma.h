@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <array>
+#include <common.h>
+#include "engine.h"
+
+#define MAXWELLDMA_OFFSET(field) U32_OFFSET(skyline::gpu::engine::MaxwellDma::Registers, field)
+
+namespace skyline {
+    namespace constant {
+        constexpr u32 MaxwellDmaRegisterCount = 0x800; //!< The number of Maxwell DMA registers
+    }
+
+    namespace gpu::engine {
+        /**
+        * @brief The Maxwell DMA engine handles copying memory between pitch-linear and block-linear regions of the GPU address space
+        * @url https://github.com/NVIDIA/open-gpu-doc/blob/ab27fc22db5de0d02a4cabe08e555663b62db4d4/classes/dma-copy/clb0b5.h
+        */
+        class MaxwellDma : public Engine {
+          public:
+            /**
+            * @brief This holds the Maxwell DMA engine's register space
+            */
+#pragma pack(push, 1)
+            union Registers {
+                std::array<u32, constant::MaxwellDmaRegisterCount> raw;
+
+                struct Address {
+                    u32 high;
+                    u32 low;
+
+                    u64 Pack() {
+                        return (static_cast<u64>(high) << 32) | low;
+                    }
+                };
+                static_assert(sizeof(Address) == sizeof(u64));
+
+                enum class DataTransferType : u8 {
+                    None = 0,
+                    Pipelined = 1,
+                    NonPipelined = 2,
+                };
+
+                enum class SemaphoreType : u8 {
+                    None = 0,
+                    ReleaseOneWord = 1,
+                    ReleaseFourWord = 2,
+                };
+
+                enum class MemoryLayout : u8 {
+                    BlockLinear = 0,
+                    Pitch = 1,
+                };
+
+                struct LaunchDma {
+                    DataTransferType dataTransferType : 2;
+                    bool flushEnable : 1;
+                    SemaphoreType semaphoreType : 2;
+                    u8 interruptType : 2;
+                    MemoryLayout srcMemoryLayout : 1;
+                    MemoryLayout dstMemoryLayout : 1;
+                    bool multiLineEnable : 1;
+                    bool remapEnable : 1;
+                    bool rmwDisable : 1;
+                    u8 srcType : 1; //!< If the source address is virtual (0) or physical (1)
+                    u8 dstType : 1; //!< If the destination address is virtual (0) or physical (1)
+                    u8 semaphoreReduction : 4;
+                    u16 _pad_ : 14;
+                };
+                static_assert(sizeof(LaunchDma) == sizeof(u32));
+
+                struct RemapComponents {
+                    enum class Swizzle : u8 {
+                        SrcX = 0,
+                        SrcY = 1,
+                        SrcZ = 2,
+                        SrcW = 3,
+                        ConstA = 4,
+                        ConstB = 5,
+                        NoWrite = 6,
+                    };
+
+                    Swizzle dstX : 3;
+                    u8 _pad0_ : 1;
+                    Swizzle dstY : 3;
+                    u8 _pad1_ : 1;
+                    Swizzle dstZ : 3;
+                    u8 _pad2_ : 1;
+                    Swizzle dstW : 3;
+                    u8 _pad3_ : 1;
+                    u8 componentSize : 2; //!< The size of a component in bytes minus one
+                    u8 _pad4_ : 2;
+                    u8 numSrcComponents : 2; //!< The amount of components in a source pixel minus one
+                    u8 _pad5_ : 2;
+                    u8 numDstComponents : 2; //!< The amount of components in a destination pixel minus one
+                    u8 _pad6_ : 6;
+                };
+                static_assert(sizeof(RemapComponents) == sizeof(u32));
+
+                struct Surface {
+                    struct {
+                        u8 width : 4; //!< The width of a block in GOBs as a power of 2
+                        u8 height : 4; //!< The height of a block in GOBs as a power of 2
+                        u8 depth : 4; //!< The depth of a block in GOBs as a power of 2
+                        u8 gobHeight : 4;
+                        u16 _pad_ : 16;
+                    } blockSize;
+                    u32 width; //!< The width of the surface in pixels
+                    u32 height; //!< The height of the surface in lines
+                    u32 depth;
+                    u32 layer;
+
+                    struct {
+                        u16 x; //!< The offset of the region on the X-axis in pixels
+                        u16 y; //!< The offset of the region on the Y-axis in lines
+                    } origin;
+                };
+                static_assert(sizeof(Surface) == (0x6 * sizeof(u32)));
+
+                struct {
+                    u32 _pad0_[0x90]; // 0x0
+
+                    struct {
+                        Address address; // 0x90
+                        u32 payload; // 0x92
+                    } semaphore;
+
+                    u32 _pad1_[0x2D]; // 0x93
+                    LaunchDma launchDma; // 0xC0
+                    u32 _pad2_[0x3F]; // 0xC1
+
+                    Address offsetIn; // 0x100
+                    Address offsetOut; // 0x102
+                    u32 pitchIn; // 0x104
+                    u32 pitchOut; // 0x105
+                    u32 lineLengthIn; // 0x106 The length of a line in pixels, this is in bytes unless remapping is enabled
+                    u32 lineCount; // 0x107
+                    u32 _pad3_[0xB8]; // 0x108
+
+                    u32 remapConstA; // 0x1C0
+                    u32 remapConstB; // 0x1C1
+                    RemapComponents remapComponents; // 0x1C2
+                    Surface dstSurface; // 0x1C3
+                    u32 _pad4_; // 0x1C9
+                    Surface srcSurface; // 0x1CA
+                    u32 _pad5_[0x630]; // 0x1D0
+                };
+            };
+            static_assert(sizeof(Registers) == (constant::MaxwellDmaRegisterCount * sizeof(u32)));
+#pragma pack(pop)
+
+            Registers registers{}; //!< The Maxwell DMA register space
+
+          private:
+            /**
+             * @return A span of the GPU address space on the host, this is backed by the staging vector if the region isn't contiguous on the host
+             * @note If the span is written to, the staging vector must be written back to the region if it isn't empty
+             */
+            std::span<u8> MapRegion(u64 address, u64 size, std::vector<u8> &staging);
+
+            /**
+             * @return The size of a pixel in bytes, this is 1 unless remapping is enabled
+             */
+            u32 GetBytesPerPixel();
+
+            /**
+             * @brief Copies a region of pitch-linear memory to another region of pitch-linear memory
+             */
+            void CopyPitchToPitch();
+
+            /**
+             * @brief Copies a region between a block-linear surface and pitch-linear memory
+             * @param toPitch If the copy is from the block-linear surface to pitch-linear memory rather than the inverse
+             */
+            void CopyBlockLinear(bool toPitch);
+
+            /**
+             * @brief Releases the semaphore if one was requested by the launch
+             */
+            void ReleaseSemaphore();
+
+            /**
+             * @brief Executes a DMA with the current register state, this is triggered by writing to launchDma
+             */
+            void LaunchDma();
+
+          public:
+            MaxwellDma(const DeviceState &state);
+
+            void CallMethod(MethodParams params);
+        };
+    }
+}
@@ -10,4 +10,30 @@ namespace skyline::gpu::format {
 
     constexpr Format RGBA8888Unorm{sizeof(u8) * 4, 1, 1, vk::Format::eR8G8B8A8Unorm}; //!< 8-bits per channel 4-channel pixels
     constexpr Format RGB565Unorm{sizeof(u8) * 2, 1, 1, vk::Format::eR5G6B5UnormPack16}; //!< Red channel: 5-bit, Green channel: 6-bit, Blue channel: 5-bit
+    constexpr Format RGBA8888Srgb{sizeof(u8) * 4, 1, 1, vk::Format::eR8G8B8A8Srgb}; //!< 8-bits per channel 4-channel pixels with sRGB encoded color channels
+    constexpr Format A2BGR10Unorm{sizeof(u32), 1, 1, vk::Format::eA2B10G10R10UnormPack32}; //!< Red, green and blue channels: 10-bit, Alpha channel: 2-bit
+    constexpr Format BGRA8888Unorm{sizeof(u8) * 4, 1, 1, vk::Format::eB8G8R8A8Unorm}; //!< 8-bits per channel 4-channel pixels with the red and blue channels swapped
+
+    // Compressed formats are stored as blocks of texels, the size of a block is in the format as {bpb, blockHeight, blockWidth}
+    constexpr Format BC1Unorm{sizeof(u64), 4, 4, vk::Format::eBc1RgbaUnormBlock}; //!< 4x4 blocks of RGB565 endpoints with 2-bit indices and 1-bit alpha
+    constexpr Format BC2Unorm{sizeof(u64) * 2, 4, 4, vk::Format::eBc2UnormBlock}; //!< 4x4 blocks of BC1 color with explicit 4-bit alpha
+    constexpr Format BC3Unorm{sizeof(u64) * 2, 4, 4, vk::Format::eBc3UnormBlock}; //!< 4x4 blocks of BC1 color with interpolated alpha
+    constexpr Format BC4Unorm{sizeof(u64), 4, 4, vk::Format::eBc4UnormBlock}; //!< 4x4 blocks of a single interpolated channel
+    constexpr Format BC5Unorm{sizeof(u64) * 2, 4, 4, vk::Format::eBc5UnormBlock}; //!< 4x4 blocks of two interpolated channels
+    constexpr Format BC6HUfloat{sizeof(u64) * 2, 4, 4, vk::Format::eBc6HUfloatBlock}; //!< 4x4 blocks of unsigned half-float RGB
+    constexpr Format BC7Unorm{sizeof(u64) * 2, 4, 4, vk::Format::eBc7UnormBlock}; //!< 4x4 blocks of RGBA with a per-block mode
+    constexpr Format ASTC4x4Unorm{sizeof(u64) * 2, 4, 4, vk::Format::eAstc4x4UnormBlock}; //!< 4x4 blocks of ASTC LDR data
+    constexpr Format ASTC5x4Unorm{sizeof(u64) * 2, 4, 5, vk::Format::eAstc5x4UnormBlock}; //!< 5x4 blocks of ASTC LDR data
+    constexpr Format ASTC5x5Unorm{sizeof(u64) * 2, 5, 5, vk::Format::eAstc5x5UnormBlock}; //!< 5x5 blocks of ASTC LDR data
+    constexpr Format ASTC6x5Unorm{sizeof(u64) * 2, 5, 6, vk::Format::eAstc6x5UnormBlock}; //!< 6x5 blocks of ASTC LDR data
+    constexpr Format ASTC6x6Unorm{sizeof(u64) * 2, 6, 6, vk::Format::eAstc6x6UnormBlock}; //!< 6x6 blocks of ASTC LDR data
+    constexpr Format ASTC8x5Unorm{sizeof(u64) * 2, 5, 8, vk::Format::eAstc8x5UnormBlock}; //!< 8x5 blocks of ASTC LDR data
+    constexpr Format ASTC8x6Unorm{sizeof(u64) * 2, 6, 8, vk::Format::eAstc8x6UnormBlock}; //!< 8x6 blocks of ASTC LDR data
+    constexpr Format ASTC8x8Unorm{sizeof(u64) * 2, 8, 8, vk::Format::eAstc8x8UnormBlock}; //!< 8x8 blocks of ASTC LDR data
+    constexpr Format ASTC10x5Unorm{sizeof(u64) * 2, 5, 10, vk::Format::eAstc10x5UnormBlock}; //!< 10x5 blocks of ASTC LDR data
+    constexpr Format ASTC10x6Unorm{sizeof(u64) * 2, 6, 10, vk::Format::eAstc10x6UnormBlock}; //!< 10x6 blocks of ASTC LDR data
+    constexpr Format ASTC10x8Unorm{sizeof(u64) * 2, 8, 10, vk::Format::eAstc10x8UnormBlock}; //!< 10x8 blocks of ASTC LDR data
+    constexpr Format ASTC10x10Unorm{sizeof(u64) * 2, 10, 10, vk::Format::eAstc10x10UnormBlock}; //!< 10x10 blocks of ASTC LDR data
+    constexpr Format ASTC12x10Unorm{sizeof(u64) * 2, 10, 12, vk::Format::eAstc12x10UnormBlock}; //!< 12x10 blocks of ASTC LDR data
+    constexpr Format ASTC12x12Unorm{sizeof(u64) * 2, 12, 12, vk::Format::eAstc12x12UnormBlock}; //!< 12x12 blocks of ASTC LDR data
 }
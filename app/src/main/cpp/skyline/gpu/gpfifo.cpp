@@ -2,13 +2,17 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <gpu.h>
+#include <perf_stats.h>
+#include <thread_priority.h>
 #include <gpu/engines/maxwell_3d.h>
 #include "gpfifo.h"
 
+extern bool Halt;
+extern skyline::SharedMutex JniMtx;
+
 namespace skyline::gpu::gpfifo {
     void GPFIFO::Send(MethodParams params) {
-        state.logger->Debug("Called GPU method - method: 0x{:X} argument: 0x{:X} subchannel: 0x{:X} last: {}", params.method, params.argument, params.subChannel, params.lastCall);
-
+        TRACE("GPU method 0x{:X} on subchannel {}: 0x{:X}", params.method, params.subChannel, params.argument);
         if (params.method == 0) {
             switch (static_cast<EngineID>(params.argument)) {
                 case EngineID::Fermi2D:
@@ -42,33 +46,54 @@ namespace skyline::gpu::gpfifo {
         }
     }
 
-    void GPFIFO::Process(const std::vector<u32> &segment) {
-        for (auto entry = segment.begin(); entry != segment.end(); entry++) {
+    void GPFIFO::Send(u16 method, std::span<u32> arguments, u32 subChannel, MethodIncrement increment) {
+        TRACE("GPU method batch 0x{:X} on subchannel {}: {} arguments, Increment: {}", method, subChannel, arguments.size(), increment);
+        // Methods in the GPFIFO register space are infrequent, they're sent individually as they need to be dispatched differently
+        size_t index{};
+        for (; index < arguments.size(); index++) {
+            auto currentMethod{GetBatchMethod(method, index, increment)};
+            if (currentMethod >= constant::GpfifoRegisterCount)
+                break;
+
+            Send(MethodParams{currentMethod, arguments[index], subChannel, index == arguments.size() - 1});
+        }
+
+        if (index == arguments.size())
+            return;
+
+        auto &engine{subchannels.at(subChannel)};
+        if (engine == nullptr)
+            throw exception("Calling method on unbound channel");
+
+        engine->CallMethodBatch(GetBatchMethod(method, index, increment), arguments.subspan(index), (increment == MethodIncrement::IncrementOnce && index) ? MethodIncrement::NonIncrement : increment, subChannel);
+    }
+
+    void GPFIFO::Process(std::span<u32> segment) {
+        for (size_t index{}; index < segment.size(); index++) {
             // An entry containing all zeroes is a NOP, skip over it
-            if (*entry == 0)
+            if (segment[index] == 0)
                 continue;
 
-            auto methodHeader = reinterpret_cast<const PushBufferMethodHeader *>(&*entry);
+            PushBufferMethodHeader methodHeader{.raw = segment[index]};
 
-            switch (methodHeader->secOp) {
+            switch (methodHeader.secOp) {
                 case PushBufferMethodHeader::SecOp::IncMethod:
-                    for (u16 i{}; i < methodHeader->methodCount; i++)
-                        Send(MethodParams{static_cast<u16>(methodHeader->methodAddress + i), *++entry, methodHeader->methodSubChannel, i == methodHeader->methodCount - 1});
-
-                    break;
                 case PushBufferMethodHeader::SecOp::NonIncMethod:
-                    for (u16 i{}; i < methodHeader->methodCount; i++)
-                        Send(MethodParams{methodHeader->methodAddress, *++entry, methodHeader->methodSubChannel, i == methodHeader->methodCount - 1});
-
-                    break;
-                case PushBufferMethodHeader::SecOp::OneInc:
-                    for (u16 i{}; i < methodHeader->methodCount; i++)
-                        Send(MethodParams{static_cast<u16>(methodHeader->methodAddress + bool(i)), *++entry, methodHeader->methodSubChannel, i == methodHeader->methodCount - 1});
+                case PushBufferMethodHeader::SecOp::OneInc: {
+                    auto arguments{segment.subspan(index + 1, std::min<size_t>(methodHeader.methodCount, segment.size() - index - 1))};
+                    if (!arguments.empty()) {
+                        auto increment{methodHeader.secOp == PushBufferMethodHeader::SecOp::IncMethod ? MethodIncrement::Increment : (methodHeader.secOp == PushBufferMethodHeader::SecOp::NonIncMethod ? MethodIncrement::NonIncrement : MethodIncrement::IncrementOnce)};
+                        Send(methodHeader.methodAddress, arguments, methodHeader.methodSubChannel, increment);
+                    }
 
+                    index += arguments.size();
                     break;
-                case PushBufferMethodHeader::SecOp::ImmdDataMethod:
-                    Send(MethodParams{methodHeader->methodAddress, methodHeader->immdData, methodHeader->methodSubChannel, true});
+                }
+                case PushBufferMethodHeader::SecOp::ImmdDataMethod: {
+                    u32 argument{methodHeader.immdData};
+                    Send(methodHeader.methodAddress, std::span(&argument, 1), methodHeader.methodSubChannel, MethodIncrement::NonIncrement);
                     break;
+                }
                 case PushBufferMethodHeader::SecOp::EndPbSegment:
                     return;
                 default:
@@ -77,27 +102,227 @@ namespace skyline::gpu::gpfifo {
         }
     }
 
-    void GPFIFO::Run() {
-        std::lock_guard lock(pushBufferQueueLock);
-        while (!pushBufferQueue.empty()) {
-            auto pushBuffer = pushBufferQueue.front();
-            if (pushBuffer.segment.empty())
-                pushBuffer.Fetch(state.gpu->memoryManager);
+    GPFIFO::GPFIFO(const DeviceState &state, ChannelScheduler &scheduler) : state(state), scheduler(scheduler), gpfifoEngine(state) {}
+
+    void GPFIFO::SetTimeslice(u32 timeslice) {
+        entriesPerTurn = std::max(timeslice / constant::GpfifoBaseTimeslice, 1U);
+    }
+
+    bool GPFIFO::RunTurn() {
+        bool progress{};
+        for (u32 entries{entriesPerTurn}; entries;) {
+            Submission submission;
+            if (blockedWait) {
+                if (state.gpu->syncpoints.at(blockedWait->syncpointId).value < blockedWait->syncpointValue)
+                    return progress;
+                submission = *blockedWait;
+                blockedWait.reset();
+                blockedWaiter = 0;
+            } else if (!submissionQueue.Pop(submission)) {
+                return progress;
+            }
+
+            switch (submission.type) {
+                case Submission::Type::Entry: {
+                    auto &memoryManager{state.gpu->memoryManager};
+                    u64 address{(static_cast<u64>(submission.gpEntry.getHi) << 32) | (static_cast<u64>(submission.gpEntry.get) << 2)};
+                    u64 size{submission.gpEntry.size};
+                    TRACE_SECTION_FMT("GPFIFO Entry: 0x{:X} words", size);
+                    perf::ScopedTimer timer(perf::Timer::Gpu);
+
+                    // Segments are processed in-place when they're contiguous on the host, otherwise they're copied into the scratch buffer
+                    auto segment{memoryManager.GetHostSpan<u32>(address, size)};
+                    if (!segment.empty()) {
+                        Process(segment);
+                    } else {
+                        pushBuffer.resize(size);
+                        memoryManager.Read<u32>(pushBuffer, address);
+                        Process(pushBuffer);
+                    }
+
+                    if (state.gpu->recorder) [[unlikely]]
+                        state.gpu->recorder->RecordEntry(submission.gpEntry);
+
+                    entries--;
+                    break;
+                }
+
+                case Submission::Type::SyncpointWait: {
+                    // The channel is skipped till the syncpoint is reached, a waiter wakes the scheduler up once it has been so the channel doesn't need to be polled
+                    auto &syncpoint{state.gpu->syncpoints.at(submission.syncpointId)};
+                    if (syncpoint.value < submission.syncpointValue) {
+                        blockedWait = submission;
+                        blockedWaiter = syncpoint.RegisterWaiter(submission.syncpointValue, [&scheduler = scheduler]() { scheduler.Wake(); });
+                        return progress;
+                    }
+
+                    if (state.gpu->recorder) [[unlikely]]
+                        state.gpu->recorder->RecordSyncpointWait(submission.syncpointId, submission.syncpointValue);
+                    break;
+                }
+
+                case Submission::Type::SyncpointIncrement: {
+                    state.gpu->queryManager.Flush();
+                    auto &syncpoint{state.gpu->syncpoints.at(submission.syncpointId)};
+                    if (state.gpu->recorder) [[unlikely]]
+                        state.gpu->recorder->RecordSyncpointIncrement(submission.syncpointId, submission.syncpointValue);
+
+                    for (u32 i{}; i < submission.syncpointValue; i++)
+                        syncpoint.Increment();
+                    break;
+                }
+            }
+
+            progress = true;
+        }
+
+        return progress;
+    }
+
+    void GPFIFO::Push(std::span<GpEntry> entries, u32 syncpointId, u32 syncpointIncrements, u32 waitSyncpointId, u32 waitThreshold) {
+        std::lock_guard guard(pushLock);
+
+        auto push{[this](auto items, auto transform) {
+            while (true) {
+                items = items.subspan(submissionQueue.Push(items, transform));
+                if (items.empty())
+                    return;
+                if (scheduler.exit)
+                    throw exception("Cannot push to the GPFIFO after the worker has exited");
+
+                // The worker is woken up so it drains the queue while we wait for space
+                scheduler.Wake();
+                std::this_thread::yield();
+            }
+        }};
+
+        auto pushSyncpoint{[&](Submission::Type type, u32 id, u32 value) {
+            Submission submission{.type = type};
+            submission.syncpointId = id;
+            submission.syncpointValue = value;
+            push(std::span(&submission, 1), [](const Submission &submission) { return submission; });
+        }};
+
+        if (waitThreshold)
+            pushSyncpoint(Submission::Type::SyncpointWait, waitSyncpointId, waitThreshold);
+
+        // All entries are reserved in the queue together, they're only split up when there isn't enough space for them
+        push(entries, [](const GpEntry &entry) {
+            Submission submission{.type = Submission::Type::Entry};
+            submission.gpEntry = entry;
+            return submission;
+        });
 
-            Process(pushBuffer.segment);
-            pushBufferQueue.pop();
+        if (syncpointIncrements)
+            pushSyncpoint(Submission::Type::SyncpointIncrement, syncpointId, syncpointIncrements);
+
+        scheduler.Wake();
+    }
+
+    ChannelScheduler::ChannelScheduler(const DeviceState &state) : state(state), thread(&ChannelScheduler::Run, this) {}
+
+    ChannelScheduler::~ChannelScheduler() {
+        {
+            std::lock_guard lock(wakeMutex);
+            exit = true;
         }
+        wakeConditional.notify_one();
+        {
+            std::lock_guard lock(pauseMutex);
+        }
+        pauseConditional.notify_one();
+        thread.join();
+
+        // Any waiters of blocked channels refer to the scheduler, they're removed so they can't be called after it's been destroyed
+        std::lock_guard lock(channelMutex);
+        for (auto &weakChannel : channels)
+            if (auto channel{weakChannel.lock()}; channel && channel->blockedWaiter)
+                state.gpu->syncpoints.at(channel->blockedWait->syncpointId).DeregisterWaiter(channel->blockedWaiter);
     }
 
-    void GPFIFO::Push(std::span<GpEntry> entries) {
-        std::lock_guard lock(pushBufferQueueLock);
-        bool beforeBarrier{false};
+    std::shared_ptr<GPFIFO> ChannelScheduler::CreateChannel() {
+        auto channel{std::make_shared<GPFIFO>(state, *this)};
+        std::lock_guard lock(channelMutex);
+        channels.emplace_back(channel);
+        return channel;
+    }
 
-        for (const auto &entry : entries) {
-            if (entry.sync == GpEntry::Sync::Wait)
-                beforeBarrier = false;
+    void ChannelScheduler::Wake() {
+        {
+            std::lock_guard lock(wakeMutex);
+            wakePending = true;
+        }
+        wakeConditional.notify_one();
+    }
+
+    void ChannelScheduler::Pause() {
+        // The flag is set prior to locking so the worker doesn't start another round as soon as it releases the lock
+        paused = true;
+        std::lock_guard lock(pauseMutex);
+    }
+
+    void ChannelScheduler::Resume() {
+        {
+            std::lock_guard lock(pauseMutex);
+            paused = false;
+        }
+        pauseConditional.notify_one();
+    }
+
+    void ChannelScheduler::Run() {
+        // The worker executes the pushbuffers of every frame, it's on the critical path of presentation alongside the emulation thread
+        auto scheduling{priority::PromoteThread(priority::ThreadClass::Display)};
+        priority::Hints.AddThread();
+        state.logger->Debug("GPFIFO worker scheduling: {}", priority::GetSchedulingName(scheduling));
+
+        try {
+            std::vector<std::shared_ptr<GPFIFO>> scheduled; //!< The channels scheduled in the current round, they're kept alive till the round is over
+            while (!exit) {
+                std::unique_lock roundLock(pauseMutex);
+                pauseConditional.wait(roundLock, [this] { return exit || !paused; });
+                if (exit)
+                    break;
+
+                {
+                    std::lock_guard lock(channelMutex);
+                    std::erase_if(channels, [&scheduled](const std::weak_ptr<GPFIFO> &weakChannel) {
+                        auto channel{weakChannel.lock()};
+                        if (channel)
+                            scheduled.emplace_back(std::move(channel));
+                        return !channel;
+                    });
+                }
+
+                // Every channel gets a turn per round, a round without any progress means that every channel is either idle or blocked
+                bool progress{};
+                for (auto &channel : scheduled)
+                    progress |= channel->RunTurn();
+                scheduled.clear();
+
+                if (!progress) {
+                    // All reports are written prior to the worker going idle, the guest might poll a semaphore rather than waiting on a fence
+                    state.gpu->queryManager.Flush();
+                    roundLock.unlock();
+
+                    std::unique_lock lock(wakeMutex);
+                    wakeConditional.wait(lock, [this] { return exit || wakePending; });
+                    wakePending = false;
+                }
+            }
+            priority::Hints.RemoveThread();
+            return;
+        } catch (const std::exception &e) {
+            state.logger->Error(e.what());
+        } catch (...) {
+            state.logger->Error("An unknown exception has occurred in the GPFIFO worker");
+        }
 
-            pushBufferQueue.emplace(PushBuffer(entry, state.gpu->memoryManager, beforeBarrier));
+        priority::Hints.RemoveThread();
+        exit = true;
+        if (!Halt) {
+            JniMtx.lock();
+            Halt = true;
+            JniMtx.unlock();
         }
     }
 }
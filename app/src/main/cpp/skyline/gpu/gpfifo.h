@@ -3,14 +3,22 @@
 
 #pragma once
 
+#include <thread>
+#include <condition_variable>
 #include <common.h>
-#include <queue>
+#include <footprint.h>
 #include "engines/engine.h"
 #include "engines/gpfifo.h"
 #include "memory_manager.h"
+#include "circular_queue.h"
 
-namespace skyline::gpu {
-    namespace gpfifo {
+namespace skyline {
+    namespace constant {
+        constexpr size_t GpfifoQueueSize = 0x1000; //!< The maximum amount of submissions of a single channel that can be pending execution by the GPFIFO worker
+        constexpr u32 GpfifoBaseTimeslice = 1300; //!< The timeslice of a low priority channel in microseconds, a channel executes a GP entry in each of its turns per multiple of this in its timeslice
+    }
+
+    namespace gpu::gpfifo {
         /**
          * @brief This contains a single GPFIFO entry that is submitted through 'SubmitGpfifo'
          * @url https://nvidia.github.io/open-gpu-doc/manuals/volta/gv100/dev_pbdma.ref.txt
@@ -122,58 +130,143 @@ namespace skyline::gpu {
         };
         static_assert(sizeof(PushBufferMethodHeader) == sizeof(u32));
 
+        class ChannelScheduler;
+
         /**
-         * @brief The GPFIFO class handles creating pushbuffers from GP entries and then processing them
+         * @brief The GPFIFO class holds the state of a single GPU channel, it creates pushbuffers from GP entries which are then processed when the channel is scheduled by the ChannelScheduler
+         * @note Every channel has its own subchannel bindings, so binding an engine on one channel doesn't affect any other channel
          * @url https://github.com/NVIDIA/open-gpu-doc/blob/ab27fc22db5de0d02a4cabe08e555663b62db4d4/manuals/volta/gv100/dev_pbdma.ref.txt#L62
          */
         class GPFIFO {
           private:
             /**
-             * @brief This is used to hold a pushbuffer's GPFIFO entry and contents, pushbuffers are made up of several 32-bit words
+             * @brief This holds a single unit of work for the GPFIFO worker, either a GP entry or a syncpoint operation that's ordered with the entries around it
              */
-            struct PushBuffer {
-                GpEntry gpEntry;
-                std::vector<u32> segment;
-
-                PushBuffer(const GpEntry &gpEntry, const vmm::MemoryManager &memoryManager, bool fetch) : gpEntry(gpEntry) {
-                    if (fetch)
-                        Fetch(memoryManager);
-                }
-
-                inline void Fetch(const vmm::MemoryManager &memoryManager) {
-                    segment.resize(gpEntry.size);
-                    memoryManager.Read<u32>(segment, (static_cast<u64>(gpEntry.getHi) << 32) | (static_cast<u64>(gpEntry.get) << 2));
-                }
+            struct Submission {
+                enum class Type : u8 {
+                    Entry, //!< A GP entry that's executed
+                    SyncpointWait, //!< A wait for a syncpoint to reach a threshold before any later submissions are executed
+                    SyncpointIncrement, //!< An increment of a syncpoint after all prior submissions have been executed
+                } type;
+
+                union {
+                    GpEntry gpEntry; //!< The GP entry to execute
+                    struct {
+                        u32 syncpointId; //!< The ID of the syncpoint to wait on or increment
+                        u32 syncpointValue; //!< The threshold to wait for or the amount of times to increment the syncpoint
+                    };
+                };
             };
 
             const DeviceState &state;
+            ChannelScheduler &scheduler;
             engine::GPFIFO gpfifoEngine; //!< The engine for processing GPFIFO method calls
             std::array<std::shared_ptr<engine::Engine>, 8> subchannels;
-            std::queue<PushBuffer> pushBufferQueue;
-            skyline::Mutex pushBufferQueueLock; //!< This is used to lock pushbuffer queue insertions as the GPU runs on a seperate thread
+            CircularQueue<Submission, constant::GpfifoQueueSize> submissionQueue; //!< The queue of submissions from the guest that are yet to be executed by the worker
+            skyline::Mutex pushLock; //!< This serializes all calls to Push as the submission queue only supports a single producer
+            std::atomic<u32> entriesPerTurn{2}; //!< The amount of GP entries the channel executes every time it's scheduled, this is derived from the timeslice of the channel
+            std::optional<Submission> blockedWait; //!< A syncpoint wait that the channel is blocked on, no submissions of the channel are executed till it's been reached
+            u64 blockedWaiter{}; //!< The ID of the syncpoint waiter that wakes the scheduler up once blockedWait has been reached, this is 0 if it has been reached already
+            footprint::Vector<u32, footprint::Subsystem::Pushbuffer> pushBuffer; //!< A persistent scratch buffer that pushbuffer segments are copied into when they aren't contiguous on the host
+
+            friend ChannelScheduler;
 
             /**
              * @brief Processes a pushbuffer segment, calling methods as needed
              */
-            void Process(const std::vector<u32> &segment);
+            void Process(std::span<u32> segment);
 
             /**
              * @brief This sends a method call to the GPU hardware
              */
             void Send(MethodParams params);
 
+            /**
+             * @brief This sends a sequence of method calls from a single method header to the GPU hardware
+             * @param method The method of the first argument
+             * @param arguments The arguments of every method call
+             * @param increment How the method changes between successive arguments
+             */
+            void Send(u16 method, std::span<u32> arguments, u32 subChannel, MethodIncrement increment);
+
+            /**
+             * @brief Executes submissions of the channel till it has executed entriesPerTurn GP entries, it runs out of submissions or it's blocked on a syncpoint wait
+             * @return If any submission was executed
+             * @note This must only be called from the worker thread of the ChannelScheduler
+             */
+            bool RunTurn();
+
           public:
-            GPFIFO(const DeviceState &state) : state(state), gpfifoEngine(state) {}
+            GPFIFO(const DeviceState &state, ChannelScheduler &scheduler);
+
+            /**
+             * @brief Sets the timeslice of the channel, the channel executes a GP entry every time it's scheduled per multiple of constant::GpfifoBaseTimeslice it has
+             * @param timeslice The timeslice of the channel in microseconds
+             */
+            void SetTimeslice(u32 timeslice);
 
             /**
-             * @brief Executes all pending entries in the FIFO
+             * @brief Pushes a list of entries to the FIFO, these are executed asynchronously by the worker thread so this never blocks on the GPU
+             * @param syncpointId The ID of the syncpoint to increment after all the entries have been executed
+             * @param syncpointIncrements The amount of times to increment the syncpoint, no increment is done if this is 0
+             * @param waitSyncpointId The ID of the syncpoint that the worker waits on before executing the entries
+             * @param waitThreshold The value the syncpoint needs to reach before the entries are executed, no wait is done if this is 0
+             */
+            void Push(std::span<GpEntry> entries, u32 syncpointId = 0, u32 syncpointIncrements = 0, u32 waitSyncpointId = 0, u32 waitThreshold = 0);
+        };
+
+        /**
+         * @brief The ChannelScheduler class executes the submissions of every GPU channel on a dedicated worker thread, channels are scheduled round-robin with each getting a turn of a few GP entries
+         * @details A channel that's blocked on a syncpoint wait is skipped till the syncpoint is reached rather than stalling the worker, so a channel waiting on another channel (or the CPU) never delays the others
+         */
+        class ChannelScheduler {
+          private:
+            const DeviceState &state;
+            std::mutex channelMutex; //!< This mutex guards channels
+            std::vector<std::weak_ptr<GPFIFO>> channels; //!< Every channel that's been created, channels which have been destroyed are pruned by the worker
+            std::mutex wakeMutex; //!< This mutex is used alongside wakeConditional, it's only held for waking up or putting the worker to sleep
+            std::condition_variable wakeConditional; //!< The worker waits on this when no channel has any submissions that can be executed
+            bool wakePending{}; //!< If Wake has been called since the worker last went to sleep
+            std::mutex pauseMutex; //!< The worker holds this for the duration of every round, it's locked to wait for the round in flight to finish
+            std::condition_variable pauseConditional; //!< The worker waits on this prior to starting a round while it's paused
+            std::atomic<bool> paused{}; //!< If the worker should stop prior to its next round
+            std::atomic<bool> exit{false}; //!< If the worker should exit or has exited due to an error
+            std::thread thread; //!< The worker thread, this is declared last so it's started after all other members are initialized
+
+            friend GPFIFO;
+
+            /**
+             * @brief The entry point of the worker thread, it schedules channels till the ChannelScheduler is destroyed
              */
             void Run();
 
+          public:
+            ChannelScheduler(const DeviceState &state);
+
+            /**
+             * @brief This stops the worker thread and waits for it to exit
+             */
+            ~ChannelScheduler();
+
+            /**
+             * @return A new channel that's scheduled for as long as it's alive
+             */
+            std::shared_ptr<GPFIFO> CreateChannel();
+
+            /**
+             * @brief Wakes up the worker so it schedules every channel again, this is called whenever a channel might have become runnable
+             */
+            void Wake();
+
+            /**
+             * @brief Waits for the round in flight to finish and stops the worker from starting another one till Resume is called, nothing is written to guest memory by the GPU while it's paused
+             */
+            void Pause();
+
             /**
-             * @brief Pushes a list of entries to the FIFO, these commands will be executed on calls to 'Step'
+             * @brief Lets the worker schedule channels again after Pause
              */
-            void Push(std::span<GpEntry> entries);
+            void Resume();
         };
     }
 }
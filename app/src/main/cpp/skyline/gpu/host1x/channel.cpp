@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include "channel.h"
+
+extern bool Halt;
+extern skyline::SharedMutex JniMtx;
+
+namespace skyline::gpu::host1x {
+    Channel::Channel(const DeviceState &state, ClassId engineClass, ClassEngine &engine) : state(state), engineClass(engineClass), engine(engine), currentClass(engineClass), thread(&Channel::Run, this) {}
+
+    Channel::~Channel() {
+        {
+            std::lock_guard lock(queueMutex);
+            exit = true;
+        }
+        queueCondition.notify_one();
+        thread.join();
+    }
+
+    void Channel::Submit(std::vector<u32> &&commands) {
+        {
+            std::lock_guard lock(queueMutex);
+            queue.push(std::move(commands));
+        }
+        queueCondition.notify_one();
+    }
+
+    void Channel::IncrementSyncpoint(u32 argument) {
+        u32 id{argument & 0xFF};
+        if (id >= constant::MaxHwSyncpointCount) {
+            state.logger->Warn("Incrementing an invalid host1x syncpoint: {}", id);
+            return;
+        }
+
+        TRACE("Host1x syncpoint increment: {}", id);
+        state.gpu->syncpoints[id].Increment();
+    }
+
+    void Channel::Write(u32 method, u32 argument) {
+        if (currentClass == ClassId::Host1x) {
+            switch (static_cast<Host1xMethod>(method)) {
+                case Host1xMethod::IncrementSyncpoint:
+                    IncrementSyncpoint(argument);
+                    break;
+                case Host1xMethod::LoadSyncpointPayload:
+                    syncpointPayload = argument;
+                    break;
+                case Host1xMethod::WaitSyncpoint: {
+                    if (argument >= constant::MaxHwSyncpointCount) {
+                        state.logger->Warn("Waiting on an invalid host1x syncpoint: {}", argument);
+                        break;
+                    }
+
+                    auto &syncpoint{state.gpu->syncpoints[argument]};
+                    while (!syncpoint.Wait(syncpointPayload, std::chrono::milliseconds(100)))
+                        if (exit)
+                            return;
+                    break;
+                }
+                default:
+                    state.logger->Debug("Unimplemented host1x method: 0x{:X} = 0x{:X}", method, argument);
+                    break;
+            }
+        } else if (currentClass == engineClass) {
+            switch (static_cast<ThiMethod>(method)) {
+                case ThiMethod::IncrementSyncpoint:
+                    IncrementSyncpoint(argument);
+                    break;
+                case ThiMethod::SetMethod0:
+                    method0 = argument;
+                    break;
+                case ThiMethod::SetMethod1:
+                    // The engines access guest-supplied IOVAs and parameters, a fault in one of them only drops that method rather than the entire channel
+                    try {
+                        engine.CallMethod(method0, argument);
+                    } catch (const exception &e) {
+                        state.logger->Warn("Engine method 0x{:X} of class 0x{:X} failed: {}", method0, static_cast<u16>(currentClass), e.what());
+                    }
+                    break;
+                default:
+                    break;
+            }
+        } else {
+            state.logger->Warn("Writing to method 0x{:X} of class 0x{:X} which isn't on the channel", method, static_cast<u16>(currentClass));
+        }
+    }
+
+    void Channel::Process(std::span<u32> commands) {
+        for (size_t index{}; index < commands.size();) {
+            ChannelCommand command{.raw = commands[index++]};
+
+            // Masked writes are written to the methods corresponding to the set bits in order, one word each
+            auto writeMasked{[&](u32 mask) {
+                for (u32 bit{}; mask && index < commands.size(); bit++, mask >>= 1)
+                    if (mask & 1)
+                        Write(command.offset + bit, commands[index++]);
+            }};
+
+            switch (command.opcode) {
+                case ChannelCommand::Opcode::SetClass:
+                    currentClass = static_cast<ClassId>(command.classId);
+                    writeMasked(command.classMask);
+                    break;
+                case ChannelCommand::Opcode::Incrementing:
+                    for (u32 offset{}; offset < command.value && index < commands.size(); offset++)
+                        Write(command.offset + offset, commands[index++]);
+                    break;
+                case ChannelCommand::Opcode::NonIncrementing:
+                    for (u32 count{}; count < command.value && index < commands.size(); count++)
+                        Write(command.offset, commands[index++]);
+                    break;
+                case ChannelCommand::Opcode::Mask:
+                    writeMasked(command.value);
+                    break;
+                case ChannelCommand::Opcode::Immediate:
+                    Write(command.offset, command.value);
+                    break;
+                default:
+                    // The remainder of the command buffer can't be decoded without knowing the length of the command, so the rest of the submission is dropped
+                    state.logger->Warn("Unsupported host1x opcode: {}", static_cast<u8>(command.opcode));
+                    return;
+            }
+        }
+    }
+
+    void Channel::Run() {
+        try {
+            while (true) {
+                std::vector<u32> commands;
+                {
+                    std::unique_lock lock(queueMutex);
+                    queueCondition.wait(lock, [this] { return exit || !queue.empty(); });
+                    if (exit)
+                        return;
+                    commands = std::move(queue.front());
+                    queue.pop();
+                }
+
+                Process(commands);
+            }
+        } catch (const std::exception &e) {
+            state.logger->Error(e.what());
+        } catch (...) {
+            state.logger->Error("An unknown exception has occurred in a host1x channel worker");
+        }
+
+        if (!Halt) {
+            JniMtx.lock();
+            Halt = true;
+            JniMtx.unlock();
+        }
+    }
+}
@@ -0,0 +1,126 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <queue>
+#include <thread>
+#include <condition_variable>
+#include <common.h>
+
+namespace skyline::gpu::host1x {
+    /**
+     * @brief The IDs of the host1x client classes that command buffers can address
+     * @url https://github.com/NVIDIA/tegra-nouveau-rs/blob/master/host1x/src/class_ids.rs
+     */
+    enum class ClassId : u16 {
+        Host1x = 0x1,
+        Vic = 0x5D,
+        Nvdec = 0xF0,
+    };
+
+    /**
+     * @brief A single command in a host1x command buffer (https://http.download.nvidia.com/tegra-public-appnotes/host1x.html)
+     */
+    union ChannelCommand {
+        enum class Opcode : u8 {
+            SetClass = 0, //!< Sets the class subsequent commands address, it's followed by masked writes in the new class
+            Incrementing = 1, //!< Writes the following words to consecutive methods
+            NonIncrementing = 2, //!< Writes the following words to the same method
+            Mask = 3, //!< Writes the following words to the methods selected by a mask
+            Immediate = 4, //!< Writes the value of the command to a method
+            Restart = 5,
+            Gather = 6,
+            Extend = 14,
+        };
+
+        struct {
+            u32 value : 16; //!< The count of words for Incrementing/NonIncrementing, the mask for Mask or the argument for Immediate
+            u32 offset : 12; //!< The method that the command writes to
+            Opcode opcode : 4;
+        };
+
+        struct {
+            u32 classMask : 6; //!< The mask of methods relative to the offset that are written after a SetClass
+            u32 classId : 10;
+        };
+
+        u32 raw;
+    };
+    static_assert(sizeof(ChannelCommand) == sizeof(u32));
+
+    /**
+     * @brief The interface of a multimedia engine behind the THI (Tegra Host Interface) of a channel, methods are indirectly written to it through the METHOD0/METHOD1 registers of the THI
+     */
+    class ClassEngine {
+      public:
+        virtual ~ClassEngine() = default;
+
+        /**
+         * @brief Writes an argument to a method of the engine, this is called on the worker thread of the channel
+         */
+        virtual void CallMethod(u32 method, u32 argument) = 0;
+    };
+
+    /**
+     * @brief A host1x channel that executes command buffers for a single multimedia engine on a dedicated worker thread
+     * @note Submissions are processed asynchronously from the guest, completion is signalled by the syncpoint increments in the command buffers
+     */
+    class Channel {
+      private:
+        /**
+         * @brief The methods of the host1x class that are implemented
+         */
+        enum class Host1xMethod : u16 {
+            IncrementSyncpoint = 0x0,
+            LoadSyncpointPayload = 0x4E,
+            WaitSyncpoint = 0x50,
+        };
+
+        /**
+         * @brief The registers of the THI which every engine class has at the start of its method space
+         */
+        enum class ThiMethod : u16 {
+            IncrementSyncpoint = 0x0,
+            SetMethod0 = 0x10, //!< Selects the engine method that METHOD1 writes to
+            SetMethod1 = 0x11, //!< Writes an argument to the engine method selected by METHOD0
+        };
+
+        const DeviceState &state;
+        ClassId engineClass;
+        ClassEngine &engine;
+        ClassId currentClass; //!< The class addressed by the command buffer currently, this persists across submissions
+        u32 method0{}; //!< The engine method selected by the THI
+        u32 syncpointPayload{}; //!< The threshold used by WaitSyncpoint
+
+        std::mutex queueMutex; //!< Synchronizes accesses to queue and exit
+        std::condition_variable queueCondition;
+        std::queue<std::vector<u32>> queue; //!< The command buffers pending execution
+        std::atomic<bool> exit{false}; //!< If the worker thread should exit
+        std::thread thread; //!< The worker thread, this is declared last so all state it uses is initialized before it starts
+
+        /**
+         * @brief Increments a syncpoint, the increment condition is ignored as the engines complete all work synchronously
+         */
+        void IncrementSyncpoint(u32 argument);
+
+        /**
+         * @brief Writes an argument to a method in the currently addressed class
+         */
+        void Write(u32 method, u32 argument);
+
+        void Process(std::span<u32> commands);
+
+        void Run();
+
+      public:
+        Channel(const DeviceState &state, ClassId engineClass, ClassEngine &engine);
+
+        ~Channel();
+
+        /**
+         * @brief Queues a command buffer for execution
+         */
+        void Submit(std::vector<u32> &&commands);
+    };
+}
@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "smmu.h"
+#include "channel.h"
+#include "nvdec.h"
+#include "vic.h"
+
+namespace skyline::gpu::host1x {
+    /**
+     * @brief Host1x is the DMA engine that feeds command buffers to the multimedia engines of the Tegra X1, each engine has a single channel here
+     * @url https://http.download.nvidia.com/tegra-public-appnotes/host1x.html
+     */
+    class Host1x {
+      public:
+        Smmu smmu;
+        Nvdec nvdec;
+        Vic vic;
+        Channel nvdecChannel; //!< The channel of NVDEC, the channels are declared after the engines so their workers are stopped prior to the engines being destroyed
+        Channel vicChannel;
+
+        Host1x(const DeviceState &state) : smmu(state), nvdec(state, smmu), vic(state, smmu, nvdec), nvdecChannel(state, ClassId::Nvdec, nvdec), vicChannel(state, ClassId::Vic, vic) {}
+    };
+}
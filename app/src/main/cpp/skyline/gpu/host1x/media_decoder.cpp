@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "media_decoder.h"
+
+extern bool Halt;
+
+namespace skyline::gpu::host1x {
+    DecodedFrame::DecodedFrame(AImage *image) : image(image) {
+        AImageCropRect crop{};
+        AImage_getCropRect(image, &crop);
+        width = static_cast<u32>(crop.right - crop.left);
+        height = static_cast<u32>(crop.bottom - crop.top);
+
+        for (i32 plane{}; plane < 3; plane++) {
+            u8 *data{};
+            i32 length{};
+            AImage_getPlaneData(image, plane, &data, &length);
+            AImage_getPlaneRowStride(image, plane, &rowStrides[plane]);
+            AImage_getPlanePixelStride(image, plane, &pixelStrides[plane]);
+
+            // The chroma planes are subsampled by 2 on both axes, so the origin of the visible region is halved for them
+            auto shift{plane ? 1 : 0};
+            planes[plane] = data + (crop.top >> shift) * rowStrides[plane] + (crop.left >> shift) * pixelStrides[plane];
+        }
+    }
+
+    DecodedFrame::~DecodedFrame() {
+        AImage_delete(image);
+    }
+
+    MediaDecoder::MediaDecoder(const DeviceState &state, const char *mimeType, u32 width, u32 height) : state(state), width(width), height(height) {
+        if (AImageReader_new(static_cast<i32>(width), static_cast<i32>(height), AIMAGE_FORMAT_YUV_420_888, constant::MediaDecoderImageCount, &reader) != AMEDIA_OK)
+            throw exception("Failed to create an AImageReader for {}x{} frames", width, height);
+
+        AImageReader_ImageListener listener{this, &MediaDecoder::OnImageAvailable};
+        AImageReader_setImageListener(reader, &listener);
+
+        ANativeWindow *window{};
+        AImageReader_getWindow(reader, &window);
+
+        codec = AMediaCodec_createDecoderByType(mimeType);
+        if (!codec) {
+            AImageReader_delete(reader);
+            throw exception("The host has no decoder for '{}'", mimeType);
+        }
+
+        auto format{AMediaFormat_new()};
+        AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, mimeType);
+        AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_WIDTH, static_cast<i32>(width));
+        AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_HEIGHT, static_cast<i32>(height));
+        AMediaFormat_setInt32(format, "low-latency", 1); // Frames are consumed as soon as they're decoded, this is ignored by decoders that don't support it
+
+        auto status{AMediaCodec_configure(codec, format, window, nullptr, 0)};
+        AMediaFormat_delete(format);
+        if (status != AMEDIA_OK || AMediaCodec_start(codec) != AMEDIA_OK) {
+            AMediaCodec_delete(codec);
+            AImageReader_delete(reader);
+            throw exception("Failed to start the host decoder for '{}' at {}x{}: {}", mimeType, width, height, status);
+        }
+
+        state.logger->Info("Started the host decoder for '{}' at {}x{}", mimeType, width, height);
+    }
+
+    MediaDecoder::~MediaDecoder() {
+        AMediaCodec_stop(codec);
+        AMediaCodec_delete(codec);
+        AImageReader_delete(reader);
+    }
+
+    void MediaDecoder::OnImageAvailable(void *context, AImageReader *) {
+        auto decoder{static_cast<MediaDecoder *>(context)};
+        {
+            std::lock_guard lock(decoder->imageMutex);
+            decoder->imageAvailable = true;
+        }
+        decoder->imageCondition.notify_all();
+    }
+
+    void MediaDecoder::Drain(i64 timeout) {
+        while (true) {
+            AMediaCodecBufferInfo info{};
+            auto index{AMediaCodec_dequeueOutputBuffer(codec, &info, timeout)};
+            if (index >= 0) {
+                // Rendering the buffer hands it to the AImageReader without it ever being mapped by the CPU
+                AMediaCodec_releaseOutputBuffer(codec, static_cast<size_t>(index), info.size != 0);
+                std::lock_guard lock(imageMutex);
+                renderPending = true;
+            } else if (index != AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED && index != AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED) {
+                return;
+            }
+            timeout = 0;
+        }
+    }
+
+    void MediaDecoder::Decode(std::span<const u8> bitstream) {
+        ssize_t index;
+        while ((index = AMediaCodec_dequeueInputBuffer(codec, constant::MediaDecoderInputTimeout)) < 0) {
+            // All input buffers are held by the decoder, its output needs to be consumed for it to release them
+            Drain(0);
+            if (Halt)
+                return;
+        }
+
+        size_t capacity{};
+        auto buffer{AMediaCodec_getInputBuffer(codec, static_cast<size_t>(index), &capacity)};
+        if (bitstream.size() > capacity) {
+            state.logger->Warn("Frame bitstream is larger than the input buffer of the decoder: 0x{:X} > 0x{:X}", bitstream.size(), capacity);
+            bitstream = bitstream.first(capacity);
+        }
+        std::memcpy(buffer, bitstream.data(), bitstream.size());
+
+        AMediaCodec_queueInputBuffer(codec, static_cast<size_t>(index), 0, bitstream.size(), timestamp, 0);
+        timestamp += 1000;
+
+        Drain(constant::MediaDecoderOutputTimeout);
+    }
+
+    std::shared_ptr<DecodedFrame> MediaDecoder::AcquireFrame() {
+        {
+            std::unique_lock lock(imageMutex);
+            if (!imageAvailable && renderPending)
+                imageCondition.wait_for(lock, constant::MediaDecoderImageTimeout, [this] { return imageAvailable; });
+            if (!imageAvailable)
+                return nullptr;
+            imageAvailable = false;
+            renderPending = false;
+        }
+
+        AImage *image{};
+        if (AImageReader_acquireLatestImage(reader, &image) != AMEDIA_OK || !image)
+            return nullptr;
+        return std::make_shared<DecodedFrame>(image);
+    }
+}
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <condition_variable>
+#include <media/NdkMediaCodec.h>
+#include <media/NdkImageReader.h>
+#include <common.h>
+
+namespace skyline {
+    namespace constant {
+        constexpr i32 MediaDecoderImageCount = 4; //!< The maximum amount of decoded images that can be acquired from the AImageReader at once
+        constexpr i64 MediaDecoderInputTimeout = 10000; //!< The amount of microseconds to wait for an input buffer of the codec for before draining its output
+        constexpr i64 MediaDecoderOutputTimeout = 10000; //!< The amount of microseconds to wait for the output of a queued frame for, decoders with reordering might not output a frame for every input
+        constexpr auto MediaDecoderImageTimeout = std::chrono::milliseconds(16); //!< The maximum duration to wait for a rendered output frame to arrive at the AImageReader for
+    }
+
+    namespace gpu::host1x {
+        /**
+         * @brief A frame that has been decoded by the host decoder, it's held in the AImageReader till it's destroyed
+         */
+        struct DecodedFrame {
+            AImage *image;
+            u32 width; //!< The visible width of the frame in pixels
+            u32 height; //!< The visible height of the frame in pixels
+            std::array<const u8 *, 3> planes{}; //!< The Y, U and V planes of the frame offset to the visible region
+            std::array<i32, 3> rowStrides{};
+            std::array<i32, 3> pixelStrides{}; //!< The distance between two samples of a plane in bytes, semi-planar chroma has a pixel stride of 2
+
+            DecodedFrame(AImage *image);
+
+            DecodedFrame(const DecodedFrame &) = delete;
+
+            ~DecodedFrame();
+        };
+
+        /**
+         * @brief A hardware decoder of the host which is driven with AMediaCodec, decoded frames are rendered into an AImageReader so they never pass through a Java ByteBuffer
+         */
+        class MediaDecoder {
+          private:
+            const DeviceState &state;
+            AImageReader *reader{};
+            AMediaCodec *codec{};
+            i64 timestamp{}; //!< The presentation timestamp of the next frame, this only needs to be monotonic
+
+            std::mutex imageMutex; //!< Synchronizes accesses to imageAvailable and renderPending
+            std::condition_variable imageCondition;
+            bool imageAvailable{}; //!< If an image has arrived at the reader since the last acquire
+            bool renderPending{}; //!< If an output buffer has been rendered to the reader since the last acquire
+
+            static void OnImageAvailable(void *context, AImageReader *reader);
+
+            /**
+             * @brief Renders all output buffers of the codec into the reader
+             * @param timeout The amount of microseconds to wait for the first output buffer for
+             */
+            void Drain(i64 timeout);
+
+          public:
+            const u32 width; //!< The coded width of the stream
+            const u32 height; //!< The coded height of the stream
+
+            /**
+             * @param mimeType The MIME type of the stream, such as "video/avc"
+             */
+            MediaDecoder(const DeviceState &state, const char *mimeType, u32 width, u32 height);
+
+            MediaDecoder(const MediaDecoder &) = delete;
+
+            ~MediaDecoder();
+
+            /**
+             * @brief Queues the bitstream of a frame for decoding and renders any frames the decoder outputs
+             */
+            void Decode(std::span<const u8> bitstream);
+
+            /**
+             * @return The latest frame output by the decoder or nullptr if no frame has been output since the last call
+             */
+            std::shared_ptr<DecodedFrame> AcquireFrame();
+        };
+    }
+}
@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "nvdec.h"
+
+namespace skyline::gpu::host1x {
+    namespace {
+        /**
+         * @brief Writes the syntax elements of H.264 NAL units MSB-first (ITU-T H.264 7.2)
+         */
+        class H264BitWriter {
+          private:
+            std::vector<u8> &output;
+            u8 current{}; //!< The byte that bits are currently written into
+            u8 bitCount{}; //!< The amount of bits that have been written into current
+
+          public:
+            H264BitWriter(std::vector<u8> &output) : output(output) {}
+
+            void WriteBits(u32 value, u8 count) {
+                while (count--) {
+                    current = static_cast<u8>((current << 1) | ((value >> count) & 1));
+                    if (++bitCount == 8) {
+                        output.push_back(current);
+                        current = 0;
+                        bitCount = 0;
+                    }
+                }
+            }
+
+            void WriteBit(bool value) {
+                WriteBits(value, 1);
+            }
+
+            /**
+             * @brief Writes an unsigned Exp-Golomb code, ue(v)
+             */
+            void WriteUe(u32 value) {
+                u32 code{value + 1};
+                u8 length{static_cast<u8>(32 - std::countl_zero(code))};
+                WriteBits(0, length - 1);
+                WriteBits(code, length);
+            }
+
+            /**
+             * @brief Writes a signed Exp-Golomb code, se(v)
+             */
+            void WriteSe(i32 value) {
+                WriteUe(value > 0 ? static_cast<u32>(value) * 2 - 1 : static_cast<u32>(-value) * 2);
+            }
+
+            /**
+             * @brief Writes a scaling list as the delta coded scaling list syntax (ITU-T H.264 7.3.2.1.1.1)
+             * @param list The scaling list in raster order
+             * @param scan The zig-zag scan of the list, this is ordered by the index in the bitstream
+             */
+            void WriteScalingList(std::span<const u8> list, std::span<const u8> scan) {
+                u8 lastScale{8};
+                for (auto index : scan) {
+                    auto scale{list[index]};
+                    WriteSe(static_cast<i8>(static_cast<u8>(scale - lastScale)));
+                    lastScale = scale;
+                }
+            }
+
+            /**
+             * @brief Writes the start code and header of a NAL unit
+             */
+            void WriteNalHeader(u8 type) {
+                WriteBits(1, 32); // An Annex B start code of 0x00000001
+                WriteBits(0, 1); // forbidden_zero_bit
+                WriteBits(3, 2); // nal_ref_idc
+                WriteBits(type, 5);
+            }
+
+            /**
+             * @brief Writes the RBSP trailing bits which terminate a NAL unit
+             */
+            void WriteTrailingBits() {
+                WriteBit(true);
+                if (bitCount)
+                    WriteBits(0, 8 - bitCount);
+            }
+        };
+
+        constexpr std::array<u8, 16> ZigZag4x4{0, 1, 4, 8, 5, 2, 3, 6, 9, 12, 13, 10, 7, 11, 14, 15};
+        constexpr std::array<u8, 64> ZigZag8x8{
+            0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+            12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+            35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+            58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+        };
+
+        constexpr u8 NalTypeSps = 7;
+        constexpr u8 NalTypePps = 8;
+    }
+
+    Nvdec::Nvdec(const DeviceState &state, Smmu &smmu) : state(state), smmu(smmu) {}
+
+    void Nvdec::CallMethod(u32 method, u32 argument) {
+        if (method >= registers.size()) {
+            state.logger->Warn("Writing to an NVDEC method outside the method space: 0x{:X} = 0x{:X}", method, argument);
+            return;
+        }
+
+        registers[method] = argument;
+        if (static_cast<Method>(method) == Method::Execute)
+            Execute();
+    }
+
+    std::shared_ptr<DecodedFrame> Nvdec::GetFrame() {
+        std::lock_guard lock(frameMutex);
+        return frame;
+    }
+
+    void Nvdec::WriteH264ParameterSets(const H264PictureInfo &info) {
+        const auto &parameters{info.parameterSet};
+        H264BitWriter writer(bitstream);
+
+        writer.WriteNalHeader(NalTypeSps);
+        writer.WriteBits(100, 8); // profile_idc: High, this is the lowest profile that allows all the parameters NVDEC supports
+        writer.WriteBits(0, 8); // constraint_set_flags
+        writer.WriteBits(51, 8); // level_idc: The highest level, so the decoder never rejects a stream for exceeding its limits
+        writer.WriteUe(0); // seq_parameter_set_id
+        writer.WriteUe(static_cast<u32>(parameters.chromaFormatIdc));
+        if (parameters.chromaFormatIdc == 3)
+            writer.WriteBit(false); // separate_colour_plane_flag
+        writer.WriteUe(0); // bit_depth_luma_minus8
+        writer.WriteUe(0); // bit_depth_chroma_minus8
+        writer.WriteBit(false); // qpprime_y_zero_transform_bypass_flag
+        writer.WriteBit(false); // seq_scaling_matrix_present_flag, the scaling lists are in the PPS
+        writer.WriteUe(static_cast<u32>(parameters.log2MaxFrameNumMinus4));
+        writer.WriteUe(static_cast<u32>(parameters.picOrderCntType));
+        if (parameters.picOrderCntType == 0) {
+            writer.WriteUe(static_cast<u32>(parameters.log2MaxPicOrderCntLsbMinus4));
+        } else if (parameters.picOrderCntType == 1) {
+            writer.WriteBit(parameters.deltaPicOrderAlwaysZeroFlag != 0);
+            writer.WriteSe(0); // offset_for_non_ref_pic
+            writer.WriteSe(0); // offset_for_top_to_bottom_field
+            writer.WriteUe(0); // num_ref_frames_in_pic_order_cnt_cycle
+        }
+        writer.WriteUe(16); // max_num_ref_frames: This isn't supplied by the guest, the maximum is used so the decoder never runs out of references
+        writer.WriteBit(false); // gaps_in_frame_num_value_allowed_flag
+        writer.WriteUe(parameters.picWidthInMbs - 1);
+        writer.WriteUe(parameters.frameHeightInMbs / (parameters.frameMbsOnlyFlag ? 1 : 2) - 1); // pic_height_in_map_units_minus1
+        writer.WriteBit(parameters.frameMbsOnlyFlag != 0);
+        if (!parameters.frameMbsOnlyFlag)
+            writer.WriteBit(parameters.mbaffFrame);
+        writer.WriteBit(parameters.direct8x8Inference);
+        writer.WriteBit(false); // frame_cropping_flag
+        writer.WriteBit(false); // vui_parameters_present_flag
+        writer.WriteTrailingBits();
+
+        writer.WriteNalHeader(NalTypePps);
+        writer.WriteUe(0); // pic_parameter_set_id
+        writer.WriteUe(0); // seq_parameter_set_id
+        writer.WriteBit(parameters.entropyCodingModeFlag != 0);
+        writer.WriteBit(parameters.picOrderPresentFlag != 0);
+        writer.WriteUe(0); // num_slice_groups_minus1
+        writer.WriteUe(static_cast<u32>(parameters.numRefIdxL0ActiveMinus1));
+        writer.WriteUe(static_cast<u32>(parameters.numRefIdxL1ActiveMinus1));
+        writer.WriteBit(parameters.weightedPred);
+        writer.WriteBits(static_cast<u32>(parameters.weightedBipredIdc), 2);
+        writer.WriteSe(static_cast<i32>(parameters.picInitQpMinus26));
+        writer.WriteSe(0); // pic_init_qs_minus26
+        writer.WriteSe(static_cast<i32>(parameters.chromaQpIndexOffset));
+        writer.WriteBit(parameters.deblockingFilterControlPresentFlag != 0);
+        writer.WriteBit(parameters.constrainedIntraPred);
+        writer.WriteBit(parameters.redundantPicCntPresentFlag != 0);
+        writer.WriteBit(parameters.transform8x8ModeFlag != 0);
+        writer.WriteBit(true); // pic_scaling_matrix_present_flag
+        for (size_t list{}; list < 6; list++) {
+            writer.WriteBit(true); // pic_scaling_list_present_flag
+            writer.WriteScalingList(std::span(info.weightScale4x4).subspan(list * 16, 16), ZigZag4x4);
+        }
+        if (parameters.transform8x8ModeFlag) {
+            for (size_t list{}; list < 2; list++) {
+                writer.WriteBit(true);
+                writer.WriteScalingList(std::span(info.weightScale8x8).subspan(list * 64, 64), ZigZag8x8);
+            }
+        }
+        writer.WriteSe(static_cast<i32>(parameters.secondChromaQpIndexOffset));
+        writer.WriteTrailingBits();
+    }
+
+    void Nvdec::DecodeH264() {
+        auto info{smmu.Read<H264PictureInfo>(static_cast<u64>(registers[static_cast<u32>(Method::PictureInfoOffset)]) << 8)};
+        u32 width{info.parameterSet.picWidthInMbs * 16}, height{info.parameterSet.frameHeightInMbs * 16};
+
+        if (!decoder || decoder->width != width || decoder->height != height) {
+            // Frames of the previous stream are released prior to the reader they're from
+            {
+                std::lock_guard lock(frameMutex);
+                frame.reset();
+            }
+            decoder.reset();
+            decoder = std::make_unique<MediaDecoder>(state, "video/avc", width, height);
+        }
+
+        // The parameter sets are supplied in-band with every frame as the guest can change the PPS between any two frames
+        bitstream.clear();
+        WriteH264ParameterSets(info);
+        auto slices{smmu.Translate(static_cast<u64>(registers[static_cast<u32>(Method::FrameBitstreamOffset)]) << 8, info.streamLength)};
+        bitstream.insert(bitstream.end(), slices.begin(), slices.end());
+
+        decoder->Decode(bitstream);
+    }
+
+    void Nvdec::Execute() {
+        auto codec{static_cast<Codec>(registers[static_cast<u32>(Method::SetCodecId)])};
+        TRACE_SECTION_FMT("NVDEC Frame: {}", registers[static_cast<u32>(Method::FrameNumber)]);
+
+        switch (codec) {
+            case Codec::H264:
+                DecodeH264();
+                break;
+
+            default:
+                if (!unsupportedCodecs.test(static_cast<u8>(codec) & 0xF)) {
+                    state.logger->Warn("Unsupported NVDEC codec: {}", static_cast<u8>(codec));
+                    unsupportedCodecs.set(static_cast<u8>(codec) & 0xF);
+                }
+                return;
+        }
+
+        if (auto decoded{decoder->AcquireFrame()}) {
+            std::lock_guard lock(frameMutex);
+            frame = std::move(decoded);
+        }
+    }
+}
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "channel.h"
+#include "smmu.h"
+#include "media_decoder.h"
+
+namespace skyline {
+    namespace constant {
+        constexpr size_t NvdecRegisterCount = 0x200; //!< The amount of registers in the method space of NVDEC
+    }
+
+    namespace gpu::host1x {
+        /**
+         * @brief NVDEC is the fixed-function video decoder of the Tegra X1, the pictures it's handed are decoded by a hardware decoder of the host
+         * @note Decoded frames are kept in host images instead of being written into the guest surfaces, VIC consumes them directly which avoids a round-trip through guest memory
+         */
+        class Nvdec : public ClassEngine {
+          private:
+            enum class Codec : u8 {
+                None = 0,
+                H264 = 3,
+                Vp8 = 5,
+                H265 = 7,
+                Vp9 = 9,
+            };
+
+            /**
+             * @brief The methods of NVDEC, every register holds an IOVA shifted right by 8 unless noted otherwise
+             */
+            enum class Method : u32 {
+                SetCodecId = 0x80, //!< The Codec of subsequent pictures, this isn't shifted
+                Execute = 0xC0,
+                PictureInfoOffset = 0x101,
+                FrameBitstreamOffset = 0x102,
+                FrameNumber = 0x103, //!< This isn't shifted
+            };
+
+            /**
+             * @brief The picture parameters of an H.264 frame, they're a subset of the syntax elements of the SPS and PPS
+             */
+            struct H264ParameterSet {
+                i32 log2MaxPicOrderCntLsbMinus4;
+                i32 deltaPicOrderAlwaysZeroFlag;
+                i32 frameMbsOnlyFlag;
+                u32 picWidthInMbs;
+                u32 frameHeightInMbs;
+                u32 surfaceFormat; //!< The tiling of the output surfaces
+                u32 entropyCodingModeFlag;
+                i32 picOrderPresentFlag;
+                i32 numRefIdxL0ActiveMinus1;
+                i32 numRefIdxL1ActiveMinus1;
+                i32 deblockingFilterControlPresentFlag;
+                i32 redundantPicCntPresentFlag;
+                u32 transform8x8ModeFlag;
+                u32 pitchLuma;
+                u32 pitchChroma;
+                u32 lumaTopOffset;
+                u32 lumaBottomOffset;
+                u32 lumaFrameOffset;
+                u32 chromaTopOffset;
+                u32 chromaBottomOffset;
+                u32 chromaFrameOffset;
+                u32 histBufferSize;
+                u64 mbaffFrame : 1;
+                u64 direct8x8Inference : 1;
+                u64 weightedPred : 1;
+                u64 constrainedIntraPred : 1;
+                u64 refPic : 1;
+                u64 fieldPic : 1;
+                u64 bottomField : 1;
+                u64 secondField : 1;
+                u64 log2MaxFrameNumMinus4 : 4;
+                u64 chromaFormatIdc : 2;
+                u64 picOrderCntType : 2;
+                i64 picInitQpMinus26 : 6;
+                i64 chromaQpIndexOffset : 5;
+                i64 secondChromaQpIndexOffset : 5;
+                u64 weightedBipredIdc : 2;
+                u64 currPicIdx : 7;
+                u64 currColIdx : 5;
+                u64 frameNumber : 16;
+                u64 frameSurfaces : 1;
+                u64 outputMemoryLayout : 1;
+            };
+            static_assert(sizeof(H264ParameterSet) == 0x60);
+
+            /**
+             * @brief The picture info structure of an H.264 frame which PictureInfoOffset points to
+             */
+            struct H264PictureInfo {
+                u32 _pad0_[18];
+                u32 streamLength; //!< The size of the bitstream of the frame in bytes
+                u32 _pad1_[3];
+                H264ParameterSet parameterSet;
+                u32 _pad2_[66];
+                std::array<u8, 0x60> weightScale4x4; //!< The 6 4x4 scaling lists in raster order
+                std::array<u8, 0x80> weightScale8x8; //!< The 2 8x8 scaling lists in raster order
+            };
+            static_assert(sizeof(H264PictureInfo) == 0x2A0);
+
+            const DeviceState &state;
+            Smmu &smmu;
+            std::array<u32, constant::NvdecRegisterCount> registers{};
+            std::unique_ptr<MediaDecoder> decoder; //!< The host decoder of the current stream, this is recreated when the codec or resolution changes
+            std::vector<u8> bitstream; //!< A scratch buffer for the bitstream handed to the host decoder
+            std::bitset<0x10> unsupportedCodecs; //!< The codecs that have been warned about not being supported
+
+            std::mutex frameMutex; //!< Synchronizes accesses to frame
+            std::shared_ptr<DecodedFrame> frame; //!< The latest frame output by the decoder
+
+            /**
+             * @brief Appends an SPS and PPS reconstructed from the picture parameters to the bitstream, the guest only supplies the slices of a frame
+             */
+            void WriteH264ParameterSets(const H264PictureInfo &info);
+
+            void DecodeH264();
+
+            void Execute();
+
+          public:
+            Nvdec(const DeviceState &state, Smmu &smmu);
+
+            void CallMethod(u32 method, u32 argument) override;
+
+            /**
+             * @return The latest frame decoded by NVDEC or nullptr if no frame has been decoded yet
+             */
+            std::shared_ptr<DecodedFrame> GetFrame();
+        };
+    }
+}
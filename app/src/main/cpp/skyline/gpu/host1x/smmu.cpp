@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <kernel/types/KProcess.h>
+#include "smmu.h"
+
+namespace skyline::gpu::host1x {
+    Smmu::Smmu(const DeviceState &state) : state(state) {}
+
+    u32 Smmu::Map(u64 address, u64 size) {
+        auto alignedSize{util::AlignUp(size, constant::SmmuPageSize)};
+        std::lock_guard lock(mutex);
+
+        // The mappings are sorted by their IOVA, so the first gap that the mapping fits into can be found with a single pass
+        u64 iova{constant::SmmuIovaBase};
+        for (const auto &[mappingIova, mapping] : mappings) {
+            if (iova + alignedSize <= mappingIova)
+                break;
+            iova = util::AlignUp(mappingIova + mapping.size, constant::SmmuPageSize);
+        }
+
+        if (iova + alignedSize > constant::SmmuIovaEnd)
+            throw exception("The SMMU IOVA space has been exhausted: 0x{:X} bytes requested", size);
+
+        mappings.emplace(iova, Mapping{address, size});
+        return static_cast<u32>(iova);
+    }
+
+    void Smmu::Unmap(u32 iova) {
+        std::lock_guard lock(mutex);
+        if (!mappings.erase(iova))
+            throw exception("Unmapping an unmapped IOVA: 0x{:X}", iova);
+    }
+
+    std::span<u8> Smmu::Translate(u64 iova, u64 size) {
+        std::lock_guard lock(mutex);
+        auto mapping{mappings.upper_bound(iova)};
+        if (mapping == mappings.begin())
+            throw exception("Accessing an unmapped IOVA: 0x{:X}", iova);
+        mapping--;
+
+        auto offset{iova - mapping->first};
+        if (offset + size > mapping->second.size)
+            throw exception("Accessing an unmapped IOVA range: 0x{:X} - 0x{:X}", iova, iova + size);
+
+        auto span{state.process->GetSpan<u8>(mapping->second.address + offset, size)};
+        if (span.empty())
+            throw exception("IOVA range isn't backed by contiguous host memory: 0x{:X} - 0x{:X}", iova, iova + size);
+        return span;
+    }
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <map>
+#include <common.h>
+
+namespace skyline {
+    namespace constant {
+        constexpr u64 SmmuIovaBase = 0x100000; //!< The lowest IOVA that buffers are mapped at, the first megabyte is left unmapped so stray null offsets fault
+        constexpr u64 SmmuIovaEnd = 0x100000000; //!< The end of the IOVA space, addresses are exchanged with the guest as 32-bit values
+        constexpr u64 SmmuPageSize = 0x1000; //!< The granularity of mappings in the IOVA space
+    }
+
+    namespace gpu::host1x {
+        /**
+         * @brief The SMMU is the IOMMU that the multimedia engines access memory through, buffers are mapped into a 32-bit IOVA space by nvhost-nvdec and nvhost-vic
+         * @note The IOVA space is shared by all host1x clients as it is on the Tegra X1, this allows the output of NVDEC to be used by VIC with the same address
+         */
+        class Smmu {
+          private:
+            struct Mapping {
+                u64 address; //!< The guest address the mapping is backed by
+                u64 size;
+            };
+
+            const DeviceState &state;
+            std::mutex mutex; //!< Synchronizes all accesses to mappings
+            std::map<u64, Mapping> mappings; //!< All mappings in the IOVA space keyed by their IOVA
+
+          public:
+            Smmu(const DeviceState &state);
+
+            /**
+             * @brief Maps a range of guest memory into the IOVA space at the lowest IOVA it fits at
+             * @return The IOVA of the mapping
+             */
+            u32 Map(u64 address, u64 size);
+
+            /**
+             * @brief Unmaps a mapping that was created by Map
+             */
+            void Unmap(u32 iova);
+
+            /**
+             * @return A span over the host mirror of a range in the IOVA space, an exception is thrown if it isn't entirely inside a single mapping
+             */
+            std::span<u8> Translate(u64 iova, u64 size);
+
+            /**
+             * @brief Reads an object from the IOVA space
+             */
+            template<typename Type>
+            Type Read(u64 iova) {
+                Type object;
+                std::memcpy(&object, Translate(iova, sizeof(Type)).data(), sizeof(Type));
+                return object;
+            }
+        };
+    }
+}
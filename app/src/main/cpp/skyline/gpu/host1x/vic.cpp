@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu/block_linear.h>
+#include "vic.h"
+
+namespace skyline::gpu::host1x {
+    Vic::Vic(const DeviceState &state, Smmu &smmu, Nvdec &nvdec) : state(state), smmu(smmu), nvdec(nvdec) {}
+
+    void Vic::CallMethod(u32 method, u32 argument) {
+        u64 address{static_cast<u64>(argument) << 8};
+        switch (static_cast<Method>(method)) {
+            case Method::Execute:
+                Execute();
+                break;
+            case Method::SetConfigStructOffset:
+                configStructAddress = address;
+                break;
+            case Method::SetOutputSurfaceLumaOffset:
+                outputLumaAddress = address;
+                break;
+            case Method::SetOutputSurfaceChromaOffset:
+                outputChromaAddress = address;
+                break;
+            default:
+                break;
+        }
+    }
+
+    void Vic::WritePlane(u64 address, OutputSurfaceConfig config, u8 *linear, u32 widthBytes, u32 height) {
+        if (config.blockLinearKind) {
+            u32 blockHeight{1U << config.blockLinearHeightLog2};
+            auto surface{smmu.Translate(address, GetBlockLinearSize(widthBytes, height, blockHeight))};
+            CopyBlockLinearLines<false>(surface.data(), widthBytes, blockHeight, linear, widthBytes, 0, 0, widthBytes, 0, height);
+        } else {
+            auto surface{smmu.Translate(address, static_cast<u64>(widthBytes) * height)};
+            std::memcpy(surface.data(), linear, surface.size());
+        }
+    }
+
+    void Vic::Execute() {
+        auto frame{nvdec.GetFrame()};
+        if (!frame)
+            return;
+
+        auto config{smmu.Read<OutputSurfaceConfig>(configStructAddress + OutputSurfaceConfigOffset)};
+        u32 surfaceWidth{static_cast<u32>(config.widthMinus1) + 1}, surfaceHeight{static_cast<u32>(config.heightMinus1) + 1};
+        u32 width{std::min(frame->width, surfaceWidth)}, height{std::min(frame->height, surfaceHeight)};
+        TRACE_SECTION_FMT("VIC Composite: {}x{} -> {}x{}", frame->width, frame->height, surfaceWidth, surfaceHeight);
+
+        auto lumaPlane{frame->planes[0]}, uPlane{frame->planes[1]}, vPlane{frame->planes[2]};
+        auto lumaStride{frame->rowStrides[0]}, chromaStride{frame->rowStrides[1]}, chromaPixelStride{frame->pixelStrides[1]};
+
+        switch (config.pixelFormat) {
+            case PixelFormat::R8G8B8A8:
+            case PixelFormat::R8G8B8X8:
+            case PixelFormat::B8G8R8A8: {
+                u32 pitch{surfaceWidth * 4};
+                scratch.assign(static_cast<size_t>(pitch) * surfaceHeight, 0);
+                bool bgr{config.pixelFormat == PixelFormat::B8G8R8A8};
+
+                // The frames decoded by the host are in limited range BT.601, this is converted with 8-bit fixed-point coefficients
+                for (u32 y{}; y < height; y++) {
+                    auto luma{lumaPlane + static_cast<size_t>(y) * lumaStride};
+                    auto u{uPlane + static_cast<size_t>(y / 2) * chromaStride}, v{vPlane + static_cast<size_t>(y / 2) * chromaStride};
+                    auto output{scratch.data() + static_cast<size_t>(y) * pitch};
+
+                    for (u32 x{}; x < width; x++, output += 4) {
+                        i32 c{(luma[x] - 16) * 298}, d{u[(x / 2) * chromaPixelStride] - 128}, e{v[(x / 2) * chromaPixelStride] - 128};
+                        auto r{static_cast<u8>(std::clamp((c + 409 * e + 128) >> 8, 0, 255))};
+                        auto g{static_cast<u8>(std::clamp((c - 100 * d - 208 * e + 128) >> 8, 0, 255))};
+                        auto b{static_cast<u8>(std::clamp((c + 516 * d + 128) >> 8, 0, 255))};
+                        output[0] = bgr ? b : r;
+                        output[1] = g;
+                        output[2] = bgr ? r : b;
+                        output[3] = 0xFF;
+                    }
+                }
+
+                WritePlane(outputLumaAddress, config, scratch.data(), pitch, surfaceHeight);
+                break;
+            }
+
+            case PixelFormat::Y8U8V8N420: {
+                u32 chromaHeight{surfaceHeight / 2};
+                scratch.assign(static_cast<size_t>(surfaceWidth) * surfaceHeight, 0);
+                for (u32 y{}; y < height; y++)
+                    std::memcpy(scratch.data() + static_cast<size_t>(y) * surfaceWidth, lumaPlane + static_cast<size_t>(y) * lumaStride, width);
+                WritePlane(outputLumaAddress, config, scratch.data(), surfaceWidth, surfaceHeight);
+
+                scratch.assign(static_cast<size_t>(surfaceWidth) * chromaHeight, 0);
+                for (u32 y{}; y < height / 2; y++) {
+                    auto u{uPlane + static_cast<size_t>(y) * chromaStride}, v{vPlane + static_cast<size_t>(y) * chromaStride};
+                    auto output{scratch.data() + static_cast<size_t>(y) * surfaceWidth};
+                    for (u32 x{}; x < width / 2; x++) {
+                        output[x * 2] = u[x * chromaPixelStride];
+                        output[x * 2 + 1] = v[x * chromaPixelStride];
+                    }
+                }
+                WritePlane(outputChromaAddress, config, scratch.data(), surfaceWidth, chromaHeight);
+                break;
+            }
+
+            default:
+                throw exception("Unsupported VIC output pixel format: 0x{:X}", static_cast<u8>(config.pixelFormat));
+        }
+    }
+}
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "nvdec.h"
+
+namespace skyline::gpu::host1x {
+    /**
+     * @brief VIC (Video Image Compositor) converts the frames decoded by NVDEC into the surfaces that the guest samples from
+     * @note Only the conversion of a single decoded frame to the output surface is implemented, which is all that video playback uses it for
+     */
+    class Vic : public ClassEngine {
+      private:
+        enum class Method : u32 {
+            Execute = 0xC0,
+            SetConfigStructOffset = 0x1C2,
+            SetOutputSurfaceLumaOffset = 0x1C8,
+            SetOutputSurfaceChromaOffset = 0x1C9,
+        };
+
+        enum class PixelFormat : u8 {
+            R8G8B8A8 = 0x1F,
+            B8G8R8A8 = 0x20,
+            R8G8B8X8 = 0x23,
+            Y8U8V8N420 = 0x44, //!< NV12, a plane of luma followed by a plane of interleaved U and V subsampled by 2 on both axes
+        };
+
+        /**
+         * @brief The configuration of the output surface, this is at offset 0x20 of the config struct
+         */
+        union OutputSurfaceConfig {
+            struct {
+                PixelFormat pixelFormat : 7;
+                u64 chromaLocationHorizontal : 2;
+                u64 chromaLocationVertical : 2;
+                u64 blockLinearKind : 4; //!< The surface is pitch-linear if this is 0
+                u64 blockLinearHeightLog2 : 4; //!< The height of a block in GOBs as a log2
+                u64 _pad0_ : 13;
+                u64 widthMinus1 : 14;
+                u64 heightMinus1 : 14;
+            };
+            u64 raw;
+        };
+        static_assert(sizeof(OutputSurfaceConfig) == sizeof(u64));
+
+        static constexpr u64 OutputSurfaceConfigOffset{0x20}; //!< The offset of OutputSurfaceConfig in the config struct
+
+        const DeviceState &state;
+        Smmu &smmu;
+        Nvdec &nvdec;
+        u64 configStructAddress{};
+        u64 outputLumaAddress{};
+        u64 outputChromaAddress{};
+        std::vector<u8> scratch; //!< A scratch buffer that surfaces are assembled in prior to being swizzled
+
+        /**
+         * @brief Writes pitch-linear data into a plane of the output surface, it's swizzled if the surface is block-linear
+         * @param widthBytes The width of the plane in bytes, this is also the pitch of the linear data
+         */
+        void WritePlane(u64 address, OutputSurfaceConfig config, u8 *linear, u32 widthBytes, u32 height);
+
+        void Execute();
+
+      public:
+        Vic(const DeviceState &state, Smmu &smmu, Nvdec &nvdec);
+
+        void CallMethod(u32 method, u32 argument) override;
+    };
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "engines/maxwell_3d.h"
+#include "macro_hle.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief The registry of native macro implementations, entries are added here as the macros of the driver are identified from their logged hashes
+     * @note An implementation must have the exact same effect on the Maxwell 3D as the macro code, as the macro is only ever executed through it once it's matched
+     */
+    constexpr std::array<MacroHle::Entry, 0> HleMacros{};
+
+    const MacroHle::Entry *MacroHle::Lookup(size_t offset) {
+        auto &macroCode{maxwell3D.macroCode};
+        auto end{MacroInterpreter::FindEnd(macroCode, offset, constant::MacroHleMaxInstructions)};
+        if (!end)
+            return nullptr;
+
+        auto size{end - offset};
+        auto hash{HashCode(std::span(macroCode).subspan(offset, size))};
+        for (const auto &entry : HleMacros)
+            if (entry.hash == hash && entry.size == size)
+                return &entry;
+
+        LOGD(state.logger, "Macro at 0x{:X} has no HLE implementation: Hash: 0x{:016X}, Size: {}", offset, hash, size);
+        return nullptr;
+    }
+
+    bool MacroHle::Execute(size_t offset, std::span<const u32> arguments) {
+        if (dirty) {
+            lookups.clear();
+            dirty = false;
+        }
+
+        auto it{lookups.find(offset)};
+        if (it == lookups.end())
+            it = lookups.emplace(offset, Lookup(offset)).first;
+
+        auto entry{it->second};
+        if (!entry)
+            return false;
+
+        TRACE_SECTION_FMT("Macro HLE: {}", entry->name);
+        entry->function(maxwell3D, arguments);
+        return true;
+    }
+}
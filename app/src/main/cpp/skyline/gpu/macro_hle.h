@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+#include "macro_interpreter.h"
+
+namespace skyline {
+    namespace constant {
+        constexpr size_t MacroHleMaxInstructions = 0x200; //!< The maximum size of a macro in instructions that's looked up in the HLE registry, the macros of the driver are all far smaller than this
+    }
+
+    namespace gpu {
+        /**
+         * @brief The MacroHle class runs native implementations of macros that are shipped by the guest GPU driver in place of executing their code, these are identified by the hash of their code
+         * @details Titles share the macros of the driver, so they can be recognised by their code alone without any per-title configuration. A native implementation skips decoding the macro entirely and can batch the method calls it performs
+         * @note The hash of any macro which doesn't have an implementation is logged once, that's used to identify new macros
+         */
+        class MacroHle {
+          public:
+            using Function = void (*)(engine::Maxwell3D &maxwell3D, std::span<const u32> arguments); //!< The signature of a native implementation of a macro
+
+            /**
+             * @brief An entry in the HLE registry
+             */
+            struct Entry {
+                u64 hash; //!< The hash of the code of the macro from its first instruction to its exit delay slot, this is calculated with HashCode
+                size_t size; //!< The size of the macro in instructions, this is compared alongside the hash to rule out any collisions
+                Function function;
+                std::string_view name; //!< The name of the macro, this is used for logging and tracing
+            };
+
+          private:
+            const DeviceState &state;
+            engine::Maxwell3D &maxwell3D;
+            std::unordered_map<size_t, const Entry *> lookups; //!< A map from the position of a macro in macro memory to its entry in the registry, this holds nullptr for macros without an implementation
+            bool dirty{}; //!< If macro memory has been written to since the lookups were done
+
+            /**
+             * @brief Looks up the macro at the supplied offset in macro memory in the HLE registry
+             * @return The entry of the macro or nullptr if it doesn't have an implementation
+             */
+            const Entry *Lookup(size_t offset);
+
+          public:
+            MacroHle(const DeviceState &state, engine::Maxwell3D &maxwell3D) : state(state), maxwell3D(maxwell3D) {}
+
+            /**
+             * @return The 64-bit FNV-1a hash of a span of macro code, this is used to key the HLE registry
+             */
+            static constexpr u64 HashCode(std::span<const u32> code) {
+                u64 hash{0xCBF29CE484222325};
+                for (auto word : code) {
+                    for (size_t byte{}; byte < sizeof(u32); byte++) {
+                        hash ^= (word >> (byte * 8)) & 0xFF;
+                        hash *= 0x100000001B3;
+                    }
+                }
+                return hash;
+            }
+
+            /**
+             * @brief This discards the lookups of all macros, it should be called when macro memory is written to
+             */
+            inline void Invalidate() {
+                dirty = true;
+            }
+
+            /**
+             * @brief Executes the native implementation of the macro at the supplied offset in macro memory if there's one
+             * @return If the macro was executed, this will be false if it doesn't have a native implementation
+             */
+            bool Execute(size_t offset, std::span<const u32> arguments);
+        };
+    }
+}
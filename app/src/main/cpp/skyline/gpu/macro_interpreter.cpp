@@ -7,7 +7,7 @@
 #include "macro_interpreter.h"
 
 namespace skyline::gpu {
-    void MacroInterpreter::Execute(size_t offset, const std::vector<u32> &args) {
+    void MacroInterpreter::Execute(size_t offset, std::span<const u32> args) {
         // Reset the interpreter state
         registers = {};
         carryFlag = false;
@@ -21,6 +21,26 @@ namespace skyline::gpu {
         while (Step());
     }
 
+    size_t MacroInterpreter::FindEnd(std::span<const u32> macroCode, size_t offset, size_t limit) {
+        auto opcodes{reinterpret_cast<const Opcode *>(macroCode.data())};
+
+        size_t maxTarget{offset};
+        for (size_t index{offset}; index + 1 < macroCode.size() && index - offset < limit; index++) {
+            auto &opcode{opcodes[index]};
+            if (opcode.operation == Opcode::Operation::Branch) {
+                auto target{static_cast<ssize_t>(index) + opcode.immediate};
+                if (target < static_cast<ssize_t>(offset) || target + 1 >= static_cast<ssize_t>(macroCode.size()))
+                    return 0;
+                maxTarget = std::max(maxTarget, static_cast<size_t>(target));
+            }
+
+            if (opcode.exit && index >= maxTarget)
+                return index + 2;
+        }
+
+        return 0;
+    }
+
     FORCE_INLINE bool MacroInterpreter::Step(Opcode *delayedOpcode) {
         switch (opcode->operation) {
             case Opcode::Operation::AluRegister: {
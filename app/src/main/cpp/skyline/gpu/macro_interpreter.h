@@ -109,6 +109,8 @@ namespace skyline::gpu {
             };
         };
 
+        friend class MacroJit;
+
         engine::Maxwell3D &maxwell3D;
 
         std::array<u32, 8> registers{};
@@ -144,9 +146,16 @@ namespace skyline::gpu {
       public:
         MacroInterpreter(engine::Maxwell3D &maxwell3D) : maxwell3D(maxwell3D) {}
 
+        /**
+         * @brief Finds the end of the macro at the supplied offset, this is the first exit instruction after which no branch targets lie followed by its delay slot
+         * @param limit The maximum amount of instructions the macro can consist of
+         * @return The offset following the last instruction of the macro, this is 0 if it doesn't end within the limit or branches outside of macro memory or before its start
+         */
+        static size_t FindEnd(std::span<const u32> macroCode, size_t offset, size_t limit);
+
         /**
          * @brief Executes a GPU macro from macro memory with the given arguments
          */
-        void Execute(size_t offset, const std::vector<u32> &args);
+        void Execute(size_t offset, std::span<const u32> args);
     };
 }
@@ -0,0 +1,477 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/mman.h>
+#include "engines/maxwell_3d.h"
+#include "macro_jit.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief This contains encoders for the subset of AArch64 instructions that are emitted by the macro JIT
+     * @note All data processing instructions operate on 32-bit registers unless they're suffixed with an X
+     */
+    namespace arm64 {
+        constexpr u8 Zr{31}; //!< WZR/XZR or SP depending on the instruction
+        constexpr u8 Scratch0{9}; //!< A caller-saved register used to hold intermediate values
+        constexpr u8 Scratch1{10}; //!< A caller-saved register used to hold intermediate values
+        constexpr u8 Scratch2{11}; //!< A caller-saved register used to hold intermediate values
+        constexpr u8 CallTarget{16}; //!< The intra-procedure-call register used to hold the target of a call
+        constexpr u8 MethodAddress{26}; //!< The register holding the method address of the macro
+        constexpr u8 Carry{27}; //!< The register holding the carry flag of the macro
+        constexpr u8 Argument{28}; //!< The register holding the pointer to the next argument of the macro
+
+        /**
+         * @brief This enumerates the condition codes used by the JIT
+         */
+        enum class Condition : u8 {
+            Equal = 0b0000,
+            NotEqual = 0b0001,
+            CarrySet = 0b0010,
+            CarryClear = 0b0011,
+        };
+
+        /**
+         * @return The host register that a macro register is mapped to, register 0 is always zero so it's mapped to WZR
+         */
+        constexpr u8 HostRegister(u8 reg) {
+            return reg ? static_cast<u8>(18 + reg) : Zr;
+        }
+
+        constexpr u32 RegisterOperation(u32 base, u8 d, u8 n, u8 m) {
+            return base | (static_cast<u32>(m) << 16) | (static_cast<u32>(n) << 5) | d;
+        }
+
+        constexpr u32 Add(u8 d, u8 n, u8 m) { return RegisterOperation(0x0B000000, d, n, m); }
+
+        constexpr u32 Adds(u8 d, u8 n, u8 m) { return RegisterOperation(0x2B000000, d, n, m); }
+
+        constexpr u32 Adcs(u8 d, u8 n, u8 m) { return RegisterOperation(0x3A000000, d, n, m); }
+
+        constexpr u32 Subs(u8 d, u8 n, u8 m) { return RegisterOperation(0x6B000000, d, n, m); }
+
+        constexpr u32 Sbcs(u8 d, u8 n, u8 m) { return RegisterOperation(0x7A000000, d, n, m); }
+
+        constexpr u32 And(u8 d, u8 n, u8 m) { return RegisterOperation(0x0A000000, d, n, m); }
+
+        constexpr u32 Bic(u8 d, u8 n, u8 m) { return RegisterOperation(0x0A200000, d, n, m); }
+
+        constexpr u32 Orr(u8 d, u8 n, u8 m) { return RegisterOperation(0x2A000000, d, n, m); }
+
+        constexpr u32 Orn(u8 d, u8 n, u8 m) { return RegisterOperation(0x2A200000, d, n, m); }
+
+        constexpr u32 Eor(u8 d, u8 n, u8 m) { return RegisterOperation(0x4A000000, d, n, m); }
+
+        constexpr u32 Lslv(u8 d, u8 n, u8 m) { return RegisterOperation(0x1AC02000, d, n, m); }
+
+        constexpr u32 Lsrv(u8 d, u8 n, u8 m) { return RegisterOperation(0x1AC02400, d, n, m); }
+
+        constexpr u32 Mov(u8 d, u8 m) { return Orr(d, Zr, m); }
+
+        constexpr u32 MovX(u8 d, u8 m) { return RegisterOperation(0xAA000000, d, Zr, m); }
+
+        constexpr u32 Movz(u8 d, u16 imm, u8 shift) { return 0x52800000 | (static_cast<u32>(shift / 16) << 21) | (static_cast<u32>(imm) << 5) | d; }
+
+        constexpr u32 Movk(u8 d, u16 imm, u8 shift) { return 0x72800000 | (static_cast<u32>(shift / 16) << 21) | (static_cast<u32>(imm) << 5) | d; }
+
+        constexpr u32 MovzX(u8 d, u16 imm, u8 shift) { return 0xD2800000 | (static_cast<u32>(shift / 16) << 21) | (static_cast<u32>(imm) << 5) | d; }
+
+        constexpr u32 MovkX(u8 d, u16 imm, u8 shift) { return 0xF2800000 | (static_cast<u32>(shift / 16) << 21) | (static_cast<u32>(imm) << 5) | d; }
+
+        constexpr u32 CmpImmediate(u8 n, u16 imm) { return 0x7100001F | (static_cast<u32>(imm & 0xFFF) << 10) | (static_cast<u32>(n) << 5); }
+
+        constexpr u32 Cset(u8 d, Condition condition) { return 0x1A9F07E0 | (static_cast<u32>(static_cast<u8>(condition) ^ 1) << 12) | d; }
+
+        constexpr u32 Ubfx(u8 d, u8 n, u8 lsb, u8 width) { return 0x53000000 | (static_cast<u32>(lsb) << 16) | (static_cast<u32>(lsb + width - 1) << 10) | (static_cast<u32>(n) << 5) | d; }
+
+        constexpr u32 LdrPostIndex(u8 t, u8 n, i16 imm) { return 0xB8400400 | (static_cast<u32>(imm & 0x1FF) << 12) | (static_cast<u32>(n) << 5) | t; }
+
+        constexpr u32 LdrRegisterScaled(u8 t, u8 n, u8 m) { return 0xB8605800 | (static_cast<u32>(m) << 16) | (static_cast<u32>(n) << 5) | t; }
+
+        constexpr u32 LdrX(u8 t, u8 n, u16 offset) { return 0xF9400000 | (static_cast<u32>(offset / 8) << 10) | (static_cast<u32>(n) << 5) | t; }
+
+        constexpr u32 StpX(u8 t1, u8 t2, u8 n, i16 offset) { return 0xA9000000 | (static_cast<u32>((offset / 8) & 0x7F) << 15) | (static_cast<u32>(t2) << 10) | (static_cast<u32>(n) << 5) | t1; }
+
+        constexpr u32 LdpX(u8 t1, u8 t2, u8 n, i16 offset) { return 0xA9400000 | (static_cast<u32>((offset / 8) & 0x7F) << 15) | (static_cast<u32>(t2) << 10) | (static_cast<u32>(n) << 5) | t1; }
+
+        constexpr u32 SubSp(u16 imm) { return 0xD10003FF | (static_cast<u32>(imm & 0xFFF) << 10); }
+
+        constexpr u32 AddSp(u16 imm) { return 0x910003FF | (static_cast<u32>(imm & 0xFFF) << 10); }
+
+        constexpr u32 Blr(u8 n) { return 0xD63F0000 | (static_cast<u32>(n) << 5); }
+
+        constexpr u32 Ret() { return 0xD65F03C0; }
+
+        constexpr u32 B(i32 offset) { return 0x14000000 | (static_cast<u32>(offset >> 2) & 0x3FFFFFF); }
+
+        constexpr u32 Cbz(u8 t, i32 offset) { return 0x34000000 | ((static_cast<u32>(offset >> 2) & 0x7FFFF) << 5) | t; }
+
+        constexpr u32 Cbnz(u8 t, i32 offset) { return 0x35000000 | ((static_cast<u32>(offset >> 2) & 0x7FFFF) << 5) | t; }
+
+        constexpr u16 StackSize{0x60}; //!< The size of the stack frame of compiled macros
+        constexpr u16 ContextOffset{0x50}; //!< The offset of the context pointer in the stack frame
+    }
+
+    /**
+     * @brief The Assembler class is used to emit the code of a single macro, it tracks branches to macro instructions and resolves them once all instructions have been emitted
+     */
+    class Assembler {
+      private:
+        /**
+         * @brief This holds a branch that needs to be patched with the offset of its target instruction
+         */
+        struct Fixup {
+            size_t offset; //!< The index of the branch in the code
+            size_t target; //!< The index of the macro instruction that is the target of the branch
+        };
+
+        std::vector<Fixup> fixups;
+
+      public:
+        std::vector<u32> code; //!< The emitted code
+        std::vector<size_t> labels; //!< The index in the code of every macro instruction
+
+        Assembler(size_t instructions) : labels(instructions) {}
+
+        inline void Emit(u32 instruction) {
+            code.push_back(instruction);
+        }
+
+        /**
+         * @brief Emits a 32-bit immediate move using as few instructions as possible
+         */
+        void Move(u8 reg, u32 value) {
+            Emit(arm64::Movz(reg, static_cast<u16>(value), 0));
+            if (value >> 16)
+                Emit(arm64::Movk(reg, static_cast<u16>(value >> 16), 16));
+        }
+
+        /**
+         * @brief Emits a 64-bit immediate move using as few instructions as possible
+         */
+        void MoveX(u8 reg, u64 value) {
+            Emit(arm64::MovzX(reg, static_cast<u16>(value), 0));
+            for (u8 shift{16}; shift < 64; shift += 16)
+                if (static_cast<u16>(value >> shift))
+                    Emit(arm64::MovkX(reg, static_cast<u16>(value >> shift), shift));
+        }
+
+        /**
+         * @brief Emits a branch to a macro instruction which is patched by Resolve
+         * @param encode A function returning the encoded branch for a given offset
+         */
+        template<typename Encoder>
+        void Branch(size_t target, Encoder encode) {
+            fixups.push_back(Fixup{code.size(), target});
+            Emit(encode(0));
+        }
+
+        /**
+         * @brief Patches all branches to macro instructions with the offset of their targets
+         */
+        void Resolve() {
+            for (const auto &fixup : fixups) {
+                // Both B and CB(N)Z encode their offset relative to the branch in words, the offset bits are zero so they can just be OR'd in
+                auto offset{static_cast<i32>(labels[fixup.target] - fixup.offset)};
+                auto &instruction{code[fixup.offset]};
+                if ((instruction & 0xFC000000) == 0x14000000)
+                    instruction |= static_cast<u32>(offset) & 0x3FFFFFF;
+                else
+                    instruction |= (static_cast<u32>(offset) & 0x7FFFF) << 5;
+            }
+        }
+    };
+
+    MacroJit::Program::~Program() {
+        munmap(code, codeSize);
+    }
+
+    size_t MacroJit::Hash(size_t offset, size_t size) {
+        return std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char *>(maxwell3D.macroCode.data() + offset), size * sizeof(u32)));
+    }
+
+    u32 MacroJit::Send(Context *context, u32 methodAddress, u32 argument) {
+        MacroInterpreter::MethodAddress address{.raw = methodAddress};
+
+        if (!context->exception) {
+            // Exceptions cannot be propagated through the compiled code as it has no unwind information, they're rethrown once it returns
+            try {
+                context->maxwell3D.CallMethod(MethodParams{address.address, argument, 0, true});
+            } catch (...) {
+                context->exception = std::current_exception();
+            }
+        }
+
+        address.address += address.increment;
+        return address.raw;
+    }
+
+    std::unique_ptr<MacroJit::Program> MacroJit::Compile(size_t offset) {
+        auto &macroCode{maxwell3D.macroCode};
+        auto opcodes{reinterpret_cast<Opcode *>(macroCode.data())};
+
+        auto end{MacroInterpreter::FindEnd(macroCode, offset, constant::MacroJitMaxInstructions)};
+        if (!end)
+            return nullptr;
+
+        using namespace arm64;
+        Assembler assembler(end - offset);
+
+        auto fetch{[&](u8 reg) {
+            assembler.Emit(LdrPostIndex(reg, Argument, sizeof(u32)));
+        }};
+
+        auto send{[&](u8 reg) {
+            assembler.Emit(LdrX(0, Zr, ContextOffset));
+            assembler.Emit(Mov(1, MethodAddress));
+            assembler.Emit(Mov(2, reg));
+            assembler.MoveX(CallTarget, reinterpret_cast<u64>(&MacroJit::Send));
+            assembler.Emit(Blr(CallTarget));
+            assembler.Emit(Mov(MethodAddress, 0));
+        }};
+
+        // Emits the operation and assignment of an instruction, the result of the operation is held in Scratch0
+        auto emitBody{[&](const Opcode &opcode) {
+            u8 srcA{HostRegister(opcode.srcA)}, srcB{HostRegister(opcode.srcB)}, dest{HostRegister(opcode.dest)};
+
+            switch (opcode.operation) {
+                case Opcode::Operation::AluRegister:
+                    switch (opcode.aluOperation) {
+                        case Opcode::AluOperation::Add:
+                            assembler.Emit(Adds(Scratch0, srcA, srcB));
+                            assembler.Emit(Cset(Carry, Condition::CarrySet));
+                            break;
+                        case Opcode::AluOperation::AddWithCarry:
+                            assembler.Emit(CmpImmediate(Carry, 1)); // This sets the host carry flag to the macro carry flag
+                            assembler.Emit(Adcs(Scratch0, srcA, srcB));
+                            assembler.Emit(Cset(Carry, Condition::CarrySet));
+                            break;
+                        case Opcode::AluOperation::Subtract:
+                            // The carry flag is set to the truncated result, this matches the behaviour of the interpreter
+                            assembler.Emit(Subs(Scratch0, srcA, srcB));
+                            assembler.Emit(Cset(Carry, Condition::NotEqual));
+                            break;
+                        case Opcode::AluOperation::SubtractWithBorrow:
+                            assembler.Emit(CmpImmediate(Carry, 1));
+                            assembler.Emit(Sbcs(Scratch0, srcA, srcB));
+                            assembler.Emit(Cset(Carry, Condition::NotEqual));
+                            break;
+                        case Opcode::AluOperation::BitwiseXor:
+                            assembler.Emit(Eor(Scratch0, srcA, srcB));
+                            break;
+                        case Opcode::AluOperation::BitwiseOr:
+                            assembler.Emit(Orr(Scratch0, srcA, srcB));
+                            break;
+                        case Opcode::AluOperation::BitwiseAnd:
+                            assembler.Emit(And(Scratch0, srcA, srcB));
+                            break;
+                        case Opcode::AluOperation::BitwiseAndNot:
+                            assembler.Emit(Bic(Scratch0, srcA, srcB));
+                            break;
+                        case Opcode::AluOperation::BitwiseNand:
+                            assembler.Emit(And(Scratch0, srcA, srcB));
+                            assembler.Emit(Orn(Scratch0, Zr, Scratch0));
+                            break;
+                        default:
+                            return false;
+                    }
+                    break;
+                case Opcode::Operation::AddImmediate:
+                    assembler.Move(Scratch1, static_cast<u32>(opcode.immediate));
+                    assembler.Emit(Add(Scratch0, srcA, Scratch1));
+                    break;
+                case Opcode::Operation::BitfieldReplace: {
+                    auto bitfield{opcode.bitfield};
+                    u32 mask{bitfield.GetMask()};
+
+                    assembler.Move(Scratch1, bitfield.srcBit);
+                    assembler.Emit(Lsrv(Scratch0, srcB, Scratch1));
+                    assembler.Move(Scratch1, mask);
+                    assembler.Emit(And(Scratch0, Scratch0, Scratch1));
+                    assembler.Move(Scratch1, bitfield.destBit);
+                    assembler.Emit(Lslv(Scratch0, Scratch0, Scratch1));
+                    assembler.Move(Scratch1, mask << bitfield.destBit);
+                    assembler.Emit(Bic(Scratch1, srcA, Scratch1));
+                    assembler.Emit(Orr(Scratch0, Scratch0, Scratch1));
+                    break;
+                }
+                case Opcode::Operation::BitfieldExtractShiftLeftImmediate: {
+                    auto bitfield{opcode.bitfield};
+
+                    assembler.Emit(Lsrv(Scratch0, srcB, srcA));
+                    assembler.Move(Scratch1, bitfield.GetMask());
+                    assembler.Emit(And(Scratch0, Scratch0, Scratch1));
+                    assembler.Move(Scratch1, bitfield.destBit);
+                    assembler.Emit(Lslv(Scratch0, Scratch0, Scratch1));
+                    break;
+                }
+                case Opcode::Operation::BitfieldExtractShiftLeftRegister: {
+                    auto bitfield{opcode.bitfield};
+
+                    assembler.Move(Scratch1, bitfield.srcBit);
+                    assembler.Emit(Lsrv(Scratch0, srcB, Scratch1));
+                    assembler.Move(Scratch1, bitfield.GetMask());
+                    assembler.Emit(And(Scratch0, Scratch0, Scratch1));
+                    assembler.Emit(Lslv(Scratch0, Scratch0, srcA));
+                    break;
+                }
+                case Opcode::Operation::ReadImmediate:
+                    assembler.Move(Scratch1, static_cast<u32>(opcode.immediate));
+                    assembler.Emit(Add(Scratch0, srcA, Scratch1));
+                    assembler.MoveX(Scratch2, reinterpret_cast<u64>(maxwell3D.registers.raw.data()));
+                    assembler.Emit(LdrRegisterScaled(Scratch0, Scratch2, Scratch0));
+                    break;
+                case Opcode::Operation::Branch:
+                    return false;
+                default:
+                    // Any unknown operations are ignored by the interpreter, including their assignment
+                    return true;
+            }
+
+            // Writes to register 0 are discarded as it's mapped to WZR
+            switch (opcode.assignmentOperation) {
+                case Opcode::AssignmentOperation::IgnoreAndFetch:
+                    fetch(dest);
+                    break;
+                case Opcode::AssignmentOperation::Move:
+                    assembler.Emit(Mov(dest, Scratch0));
+                    break;
+                case Opcode::AssignmentOperation::MoveAndSetMethod:
+                    assembler.Emit(Mov(dest, Scratch0));
+                    assembler.Emit(Mov(MethodAddress, Scratch0));
+                    break;
+                case Opcode::AssignmentOperation::FetchAndSend:
+                    fetch(dest);
+                    send(Scratch0);
+                    break;
+                case Opcode::AssignmentOperation::MoveAndSend:
+                    assembler.Emit(Mov(dest, Scratch0));
+                    send(Scratch0);
+                    break;
+                case Opcode::AssignmentOperation::FetchAndSetMethod:
+                    fetch(dest);
+                    assembler.Emit(Mov(MethodAddress, Scratch0));
+                    break;
+                case Opcode::AssignmentOperation::MoveAndSetMethodThenFetchAndSend:
+                    assembler.Emit(Mov(dest, Scratch0));
+                    assembler.Emit(Mov(MethodAddress, Scratch0));
+                    fetch(Scratch1);
+                    send(Scratch1);
+                    break;
+                case Opcode::AssignmentOperation::MoveAndSetMethodThenSendHigh:
+                    assembler.Emit(Mov(dest, Scratch0));
+                    assembler.Emit(Mov(MethodAddress, Scratch0));
+                    assembler.Emit(Ubfx(Scratch1, Scratch0, 12, 6)); // The increment of the method address
+                    send(Scratch1);
+                    break;
+            }
+
+            return true;
+        }};
+
+        auto emitEpilogue{[&] {
+            assembler.Emit(LdpX(19, 20, Zr, 0x00));
+            assembler.Emit(LdpX(21, 22, Zr, 0x10));
+            assembler.Emit(LdpX(23, 24, Zr, 0x20));
+            assembler.Emit(LdpX(25, 26, Zr, 0x30));
+            assembler.Emit(LdpX(27, 28, Zr, 0x40));
+            assembler.Emit(LdrX(30, Zr, ContextOffset + sizeof(u64)));
+            assembler.Emit(AddSp(StackSize));
+            assembler.Emit(Ret());
+        }};
+
+        // The prologue saves all callee-saved registers that are used and initializes the macro state, the first argument is stored in register 1
+        assembler.Emit(SubSp(StackSize));
+        assembler.Emit(StpX(19, 20, Zr, 0x00));
+        assembler.Emit(StpX(21, 22, Zr, 0x10));
+        assembler.Emit(StpX(23, 24, Zr, 0x20));
+        assembler.Emit(StpX(25, 26, Zr, 0x30));
+        assembler.Emit(StpX(27, 28, Zr, 0x40));
+        assembler.Emit(StpX(0, 30, Zr, ContextOffset));
+        assembler.Emit(MovX(Argument, 1));
+        fetch(HostRegister(1));
+        for (u8 reg{2}; reg < 8; reg++)
+            assembler.Emit(Mov(HostRegister(reg), Zr));
+        assembler.Emit(Mov(MethodAddress, Zr));
+        assembler.Emit(Mov(Carry, Zr));
+
+        for (size_t index{offset}; index < end; index++) {
+            assembler.labels[index - offset] = assembler.code.size();
+
+            const auto &opcode{opcodes[index]};
+            if (opcode.operation == Opcode::Operation::Branch) {
+                u8 value{HostRegister(opcode.srcA)};
+                bool onZero{opcode.branchCondition == Opcode::BranchCondition::Zero};
+                size_t target{index + opcode.immediate - offset};
+
+                if (opcode.noDelay) {
+                    assembler.Branch(target, [&](i32 branchOffset) { return onZero ? Cbz(value, branchOffset) : Cbnz(value, branchOffset); });
+                } else {
+                    // The delay slot is executed prior to jumping to the target when the branch is taken, the branch is inverted to skip over it otherwise
+                    size_t skip{assembler.code.size()};
+                    assembler.Emit(0);
+
+                    if (index + 1 >= end || !emitBody(opcodes[index + 1]))
+                        return nullptr;
+                    assembler.Branch(target, [](i32 branchOffset) { return B(branchOffset); });
+
+                    auto skipOffset{static_cast<i32>((assembler.code.size() - skip) * sizeof(u32))};
+                    assembler.code[skip] = onZero ? Cbnz(value, skipOffset) : Cbz(value, skipOffset);
+                }
+            } else if (!emitBody(opcode)) {
+                return nullptr;
+            }
+
+            if (opcode.exit) {
+                // Exit has a delay slot, the exit flag of the delay slot is ignored
+                if (index + 1 >= end || !emitBody(opcodes[index + 1]))
+                    return nullptr;
+                emitEpilogue();
+            }
+        }
+
+        emitEpilogue();
+        assembler.Resolve();
+
+        auto program{std::make_unique<Program>()};
+        program->size = end - offset;
+        program->hash = Hash(offset, program->size);
+        program->codeSize = util::AlignUp(assembler.code.size() * sizeof(u32), PAGE_SIZE);
+
+        program->code = mmap(nullptr, program->codeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (program->code == MAP_FAILED)
+            throw exception("An error occurred while mapping the code of a macro: {}", strerror(errno));
+
+        std::memcpy(program->code, assembler.code.data(), assembler.code.size() * sizeof(u32));
+        if (mprotect(program->code, program->codeSize, PROT_READ | PROT_EXEC))
+            throw exception("An error occurred while protecting the code of a macro: {}", strerror(errno));
+        __builtin___clear_cache(reinterpret_cast<char *>(program->code), reinterpret_cast<char *>(program->code) + program->codeSize);
+
+        return program;
+    }
+
+    bool MacroJit::Execute(size_t offset, std::span<const u32> args) {
+        if (dirty) {
+            // Programs are only discarded when their code has changed as macros are usually uploaded once and reuploads tend to be identical
+            std::erase_if(programs, [this](const auto &entry) {
+                return !entry.second || entry.second->hash != Hash(entry.first, entry.second->size);
+            });
+            dirty = false;
+        }
+
+        auto it{programs.find(offset)};
+        if (it == programs.end())
+            it = programs.emplace(offset, Compile(offset)).first;
+
+        auto &program{it->second};
+        if (!program)
+            return false;
+
+        Context context{maxwell3D};
+        reinterpret_cast<Function>(program->code)(&context, args.data());
+
+        if (context.exception)
+            std::rethrow_exception(context.exception);
+
+        return true;
+    }
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+#include "macro_interpreter.h"
+
+namespace skyline {
+    namespace constant {
+        constexpr size_t MacroJitMaxInstructions = 0x1000; //!< The maximum amount of macro instructions that will be compiled for a single macro
+    }
+
+    namespace gpu {
+        /**
+         * @brief The MacroJit class compiles macros into AArch64 code the first time they're executed, subsequent executions run the compiled code directly
+         * @note Macros which can't be compiled are rejected by Execute and should be run on the MacroInterpreter instead
+         */
+        class MacroJit {
+          private:
+            using Opcode = MacroInterpreter::Opcode;
+
+            /**
+             * @brief This holds the state of a single execution of a compiled macro, it's passed into the compiled code
+             */
+            struct Context {
+                engine::Maxwell3D &maxwell3D;
+                std::exception_ptr exception; //!< An exception thrown by a method call, no further methods are called once this is set
+            };
+
+            using Function = void (*)(Context *context, const u32 *arguments); //!< The signature of the compiled code of a macro
+
+            /**
+             * @brief This holds a single compiled macro alongside the information required to verify that it's still valid
+             */
+            struct Program {
+                size_t size; //!< The size of the macro in instructions
+                size_t hash; //!< The hash of the macro code that was compiled
+                void *code; //!< The mapping holding the compiled code
+                size_t codeSize; //!< The size of the mapping holding the compiled code in bytes
+
+                ~Program();
+            };
+
+            engine::Maxwell3D &maxwell3D;
+            std::unordered_map<size_t, std::unique_ptr<Program>> programs; //!< A map from the position of a macro in macro memory to its compiled program, this holds nullptr for macros that couldn't be compiled
+            bool dirty{}; //!< If macro memory has been written to since the programs were last validated
+
+            /**
+             * @return The hash of a region of macro memory
+             */
+            size_t Hash(size_t offset, size_t size);
+
+            /**
+             * @brief Compiles the macro at the supplied offset in macro memory
+             * @return The compiled program or nullptr if the macro cannot be compiled
+             */
+            std::unique_ptr<Program> Compile(size_t offset);
+
+            /**
+             * @brief This is called by compiled code to send a method call to the Maxwell 3D
+             * @return The method address after it has been incremented
+             */
+            static u32 Send(Context *context, u32 methodAddress, u32 argument);
+
+          public:
+            MacroJit(engine::Maxwell3D &maxwell3D) : maxwell3D(maxwell3D) {}
+
+            /**
+             * @brief This marks all compiled programs as needing validation, it should be called when macro memory is written to
+             */
+            inline void Invalidate() {
+                dirty = true;
+            }
+
+            /**
+             * @brief Executes a GPU macro from macro memory with the given arguments
+             * @return If the macro was executed, this will be false if the macro couldn't be compiled
+             */
+            bool Execute(size_t offset, std::span<const u32> args);
+        };
+    }
+}
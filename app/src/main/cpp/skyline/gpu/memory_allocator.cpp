@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <bit>
+#include "memory_allocator.h"
+
+namespace skyline::gpu::memory {
+    Allocation::Allocation(Allocation &&other) noexcept : allocator(std::exchange(other.allocator, nullptr)), block(std::exchange(other.block, nullptr)), dedicatedMemory(std::move(other.dedicatedMemory)), order(other.order), memory(std::exchange(other.memory, nullptr)), offset(other.offset), size(other.size), mapping(std::exchange(other.mapping, nullptr)) {}
+
+    Allocation &Allocation::operator=(Allocation &&other) noexcept {
+        if (this != &other) {
+            Reset();
+            allocator = std::exchange(other.allocator, nullptr);
+            block = std::exchange(other.block, nullptr);
+            dedicatedMemory = std::move(other.dedicatedMemory);
+            order = other.order;
+            memory = std::exchange(other.memory, nullptr);
+            offset = other.offset;
+            size = other.size;
+            mapping = std::exchange(other.mapping, nullptr);
+        }
+        return *this;
+    }
+
+    Allocation::~Allocation() {
+        Reset();
+    }
+
+    void Allocation::Reset() {
+        if (allocator)
+            allocator->Free(*this);
+        allocator = nullptr;
+        block = nullptr;
+        memory = nullptr;
+        mapping = nullptr;
+    }
+
+    MemoryAllocator::MemoryAllocator(vk::PhysicalDevice physicalDevice, vk::Device device) : device(device), memoryProperties(physicalDevice.getMemoryProperties()), maxAllocationCount(physicalDevice.getProperties().limits.maxMemoryAllocationCount) {}
+
+    u32 MemoryAllocator::GetMemoryType(u32 typeBits, vk::MemoryPropertyFlags properties) {
+        for (u32 type{}; type < memoryProperties.memoryTypeCount; type++)
+            if ((typeBits & (1U << type)) && (memoryProperties.memoryTypes[type].propertyFlags & properties) == properties)
+                return type;
+        throw exception("Cannot find a Vulkan memory type with properties: {}", vk::to_string(properties));
+    }
+
+    vk::UniqueDeviceMemory MemoryAllocator::AllocateMemory(vk::DeviceSize size, u32 type, u8 *&mapping) {
+        if (allocationCount >= maxAllocationCount)
+            throw exception("Cannot allocate device memory as the maximum amount of allocations ({}) has been reached", maxAllocationCount);
+
+        auto memory{device.allocateMemoryUnique(vk::MemoryAllocateInfo(size, type))};
+        allocationCount++;
+
+        mapping = (memoryProperties.memoryTypes[type].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) ? static_cast<u8 *>(device.mapMemory(*memory, 0, VK_WHOLE_SIZE)) : nullptr;
+        return memory;
+    }
+
+    Allocation MemoryAllocator::Allocate(const vk::MemoryRequirements &requirements, vk::MemoryPropertyFlags properties, bool linear) {
+        auto type{GetMemoryType(requirements.memoryTypeBits, properties)};
+
+        std::lock_guard lock(mutex);
+        Allocation allocation; // The allocator is only set on the allocation once it's been made, an allocation that is destroyed by an exception prior to that isn't freed
+
+        if (requirements.size >= constant::DedicatedThreshold) {
+            allocation.dedicatedMemory = AllocateMemory(requirements.size, type, allocation.mapping);
+            allocation.allocator = this;
+            allocation.memory = *allocation.dedicatedMemory;
+            allocation.size = requirements.size;
+            return allocation;
+        }
+
+        // Ranges of an order are always aligned to their size, so rounding the size up to the alignment satisfies it as well
+        auto order{static_cast<u8>(std::max<size_t>(std::bit_width(std::max(requirements.size, requirements.alignment) - 1), constant::MinOrder))};
+
+        auto allocate{[&](MemoryBlock &block) {
+            size_t index{static_cast<size_t>(order - constant::MinOrder)};
+            while (index < block.freeLists.size() && block.freeLists[index].empty())
+                index++;
+            if (index == block.freeLists.size())
+                return false;
+
+            // The free range is split in halves till it's the requested order, the upper half of every split is a free buddy
+            auto offset{*block.freeLists[index].begin()};
+            block.freeLists[index].erase(block.freeLists[index].begin());
+            while (index > static_cast<size_t>(order - constant::MinOrder)) {
+                index--;
+                block.freeLists[index].insert(offset + (1ULL << (index + constant::MinOrder)));
+            }
+
+            block.allocationCount++;
+            allocation.allocator = this;
+            allocation.block = &block;
+            allocation.memory = *block.memory;
+            allocation.offset = offset;
+            allocation.size = 1ULL << order;
+            allocation.order = order;
+            allocation.mapping = block.mapping ? block.mapping + offset : nullptr;
+            return true;
+        }};
+
+        for (auto &block : blocks)
+            if (block->type == type && block->linear == linear && allocate(*block))
+                return allocation;
+
+        auto newBlock{std::make_unique<MemoryBlock>()};
+        newBlock->memory = AllocateMemory(constant::BlockSize, type, newBlock->mapping);
+        auto &block{*blocks.emplace_back(std::move(newBlock))};
+        block.type = type;
+        block.linear = linear;
+        block.freeLists.back().insert(0);
+        allocate(block);
+        return allocation;
+    }
+
+    void MemoryAllocator::Free(Allocation &allocation) {
+        std::lock_guard lock(mutex);
+        if (!allocation.block) {
+            allocation.dedicatedMemory.reset();
+            allocationCount--;
+            return;
+        }
+
+        // The range is merged with its buddy for as long as the buddy is free, this always coalesces back into the largest possible range
+        auto &block{*allocation.block};
+        auto offset{allocation.offset};
+        size_t index{static_cast<size_t>(allocation.order - constant::MinOrder)};
+        for (; index < block.freeLists.size() - 1; index++) {
+            auto buddy{offset ^ (1ULL << (index + constant::MinOrder))};
+            auto &freeList{block.freeLists[index]};
+            auto it{freeList.find(buddy)};
+            if (it == freeList.end())
+                break;
+            freeList.erase(it);
+            offset = std::min(offset, buddy);
+        }
+        block.freeLists[index].insert(offset);
+
+        // A single unused block of every kind is retained so recreating a resource doesn't free and allocate an entire block, any other unused blocks are freed
+        if (!--block.allocationCount) {
+            bool spare{std::any_of(blocks.begin(), blocks.end(), [&block](const std::unique_ptr<MemoryBlock> &candidate) {
+                return candidate.get() != &block && !candidate->allocationCount && candidate->type == block.type && candidate->linear == block.linear;
+            })};
+            if (spare) {
+                std::erase_if(blocks, [&block](const std::unique_ptr<MemoryBlock> &candidate) { return candidate.get() == &block; });
+                allocationCount--;
+            }
+        }
+    }
+
+    Allocation MemoryAllocator::AllocateBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties) {
+        auto allocation{Allocate(device.getBufferMemoryRequirements(buffer), properties, true)};
+        device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+        return allocation;
+    }
+
+    Allocation MemoryAllocator::AllocateImage(vk::Image image, vk::MemoryPropertyFlags properties) {
+        auto allocation{Allocate(device.getImageMemoryRequirements(image), properties, false)};
+        device.bindImageMemory(image, allocation.memory, allocation.offset);
+        return allocation;
+    }
+}
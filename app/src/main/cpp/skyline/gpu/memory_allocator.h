@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <set>
+#include <vulkan/vulkan.hpp>
+#include <common.h>
+
+namespace skyline::gpu::memory {
+    namespace constant {
+        constexpr u8 MinOrder{12}; //!< The order of the smallest allocation from a block, this is 4KiB so allocations never share a page
+        constexpr u8 BlockOrder{26}; //!< The order of the size of a block of device memory, every block is 64MiB
+        constexpr vk::DeviceSize BlockSize{1ULL << BlockOrder};
+        constexpr vk::DeviceSize DedicatedThreshold{BlockSize / 4}; //!< The size at and above which an allocation gets its own device memory rather than being suballocated, this is mostly hit by large render targets
+    }
+
+    class MemoryAllocator;
+
+    /**
+     * @brief A block of device memory of a single memory type which is split into power of two sized allocations with a buddy allocator
+     */
+    struct MemoryBlock {
+        vk::UniqueDeviceMemory memory;
+        u8 *mapping{}; //!< The persistent host mapping of the block, this is nullptr if the memory type isn't host-visible
+        u32 type; //!< The index of the memory type of the block
+        bool linear; //!< If the block holds buffers and linear images, these are kept apart from optimal images so bufferImageGranularity never has to be accounted for
+        std::array<std::set<vk::DeviceSize>, constant::BlockOrder - constant::MinOrder + 1> freeLists; //!< The offsets of all free ranges of every order, indexed by order - MinOrder
+        size_t allocationCount{}; //!< The amount of live allocations from the block
+    };
+
+    /**
+     * @brief An allocation of device memory, it's returned to the allocator when it's destroyed
+     * @note The allocation must be destroyed prior to the allocator it was allocated from
+     */
+    class Allocation {
+      private:
+        friend MemoryAllocator;
+
+        MemoryAllocator *allocator{};
+        MemoryBlock *block{}; //!< The block the allocation is from, this is nullptr for dedicated allocations
+        vk::UniqueDeviceMemory dedicatedMemory; //!< The memory of a dedicated allocation
+        u8 order{}; //!< The order of the allocation within its block
+
+      public:
+        vk::DeviceMemory memory; //!< The device memory the allocation is in
+        vk::DeviceSize offset{}; //!< The offset of the allocation within the memory
+        vk::DeviceSize size{}; //!< The size of the allocation, this might be larger than what was requested
+        u8 *mapping{}; //!< The host mapping of the allocation, this is nullptr if it isn't host-visible
+
+        Allocation() = default;
+
+        Allocation(const Allocation &) = delete;
+
+        Allocation &operator=(const Allocation &) = delete;
+
+        Allocation(Allocation &&other) noexcept;
+
+        Allocation &operator=(Allocation &&other) noexcept;
+
+        ~Allocation();
+
+        explicit operator bool() const {
+            return static_cast<bool>(memory);
+        }
+
+        /**
+         * @brief Returns the allocation to its allocator, this is a no-op if it's empty
+         */
+        void Reset();
+    };
+
+    /**
+     * @brief The MemoryAllocator class suballocates device memory to avoid a vk::DeviceMemory per resource, which is slow and runs into maxMemoryAllocationCount on some drivers
+     * @details Every memory type has its own blocks from which power of two sized allocations are made with a buddy allocator, allocations that are too large for a block get dedicated device memory instead. Host-visible blocks are persistently mapped
+     */
+    class MemoryAllocator {
+      private:
+        friend Allocation;
+
+        vk::Device device;
+        vk::PhysicalDeviceMemoryProperties memoryProperties;
+        u32 maxAllocationCount; //!< The maximum amount of device memory allocations the device supports
+        u32 allocationCount{}; //!< The amount of device memory allocations that have been made, this includes blocks and dedicated allocations
+        std::mutex mutex;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+
+        /**
+         * @brief Allocates device memory and maps it if it's host-visible, this must be called with the mutex held
+         */
+        vk::UniqueDeviceMemory AllocateMemory(vk::DeviceSize size, u32 type, u8 *&mapping);
+
+        /**
+         * @brief Returns an allocation to its block and frees the block if it's unused, this is called by Allocation
+         */
+        void Free(Allocation &allocation);
+
+      public:
+        MemoryAllocator(vk::PhysicalDevice physicalDevice, vk::Device device);
+
+        /**
+         * @return The index of a memory type which supports the supplied type bits and has all of the supplied properties
+         */
+        u32 GetMemoryType(u32 typeBits, vk::MemoryPropertyFlags properties);
+
+        /**
+         * @param requirements The requirements of the resource that the memory is for
+         * @param properties The properties that the memory must have
+         * @param linear If the memory is for a buffer or a linear image rather than an optimal image
+         */
+        Allocation Allocate(const vk::MemoryRequirements &requirements, vk::MemoryPropertyFlags properties, bool linear);
+
+        /**
+         * @brief Allocates memory for a buffer and binds it to the buffer
+         */
+        Allocation AllocateBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags properties);
+
+        /**
+         * @brief Allocates memory for an optimally tiled image and binds it to the image
+         */
+        Allocation AllocateImage(vk::Image image, vk::MemoryPropertyFlags properties);
+    };
+}
@@ -2,6 +2,8 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <kernel/types/KProcess.h>
+#include <gpu.h>
+#include "capture.h"
 #include "memory_manager.h"
 
 namespace skyline::gpu::vmm {
@@ -14,6 +16,26 @@ namespace skyline::gpu::vmm {
         chunkList.push_back(baseChunk);
     }
 
+    void MemoryManager::SetPages(u64 address, u64 cpuAddress, u64 size) {
+        for (u64 offset{}; offset < size; offset += constant::GpuPageSize) {
+            auto index{(address + offset) >> constant::GpuPageBits};
+            auto &table{pageTable.at(index >> constant::GpuPageTableL2Bits)};
+            if (!table) {
+                if (!cpuAddress)
+                    continue;
+                table = std::make_unique<PageTable>();
+            }
+
+            auto &page{(*table)[index & (constant::GpuPageTableL2Size - 1)]};
+            if (cpuAddress) {
+                page.cpuAddress = cpuAddress + offset;
+                page.host = reinterpret_cast<u8 *>(state.process->GetHostAddress(page.cpuAddress, constant::GpuPageSize));
+            } else {
+                page = {};
+            }
+        }
+    }
+
     std::optional<ChunkDescriptor> MemoryManager::FindChunk(u64 size, ChunkState state) {
         auto chunk = std::find_if(chunkList.begin(), chunkList.end(), [size, state](const ChunkDescriptor &chunk) -> bool {
             return chunk.size > size && chunk.state == state;
@@ -102,7 +124,9 @@ namespace skyline::gpu::vmm {
 
         size = util::AlignUp(size, constant::GpuPageSize);
 
-        return InsertChunk(ChunkDescriptor(address, size, 0, ChunkState::Reserved));
+        address = InsertChunk(ChunkDescriptor(address, size, 0, ChunkState::Reserved));
+        SetPages(address, 0, size);
+        return address;
     }
 
     u64 MemoryManager::MapAllocate(u64 address, u64 size) {
@@ -116,7 +140,9 @@ namespace skyline::gpu::vmm {
         chunk.size = size;
         chunk.state = ChunkState::Mapped;
 
-        return InsertChunk(chunk);
+        auto gpuAddress{InsertChunk(chunk)};
+        SetPages(gpuAddress, address, size);
+        return gpuAddress;
     }
 
     u64 MemoryManager::MapFixed(u64 address, u64 cpuAddress, u64 size) {
@@ -125,83 +151,235 @@ namespace skyline::gpu::vmm {
 
         size = util::AlignUp(size, constant::GpuPageSize);
 
-        return InsertChunk(ChunkDescriptor(address, size, cpuAddress, ChunkState::Mapped));
+        address = InsertChunk(ChunkDescriptor(address, size, cpuAddress, ChunkState::Mapped));
+        SetPages(address, cpuAddress, size);
+
+        BufferCache::Region region{address, size};
+        state.gpu->bufferCache.InvalidateMappings(std::span(&region, 1));
+        return address;
+    }
+
+    bool MemoryManager::MapBatch(std::span<const ChunkDescriptor> mappings) {
+        if (mappings.empty())
+            return true;
+
+        auto spaceStart{chunkList.front().address}, spaceEnd{chunkList.back().address + chunkList.back().size};
+        std::vector<ChunkDescriptor> sorted;
+        sorted.reserve(mappings.size());
+        for (const auto &mapping : mappings) {
+            if (!util::IsAligned(mapping.address, constant::GpuPageSize) || mapping.address < spaceStart || mapping.address + util::AlignUp(mapping.size, constant::GpuPageSize) > spaceEnd)
+                return false;
+            sorted.emplace_back(mapping.address, util::AlignUp(mapping.size, constant::GpuPageSize), mapping.cpuAddress, mapping.cpuAddress ? ChunkState::Mapped : ChunkState::Reserved);
+        }
+
+        // The mappings are applied in order, so sorting them must retain the order of those that overlap which is why a stable sort is used and overlaps are resolved prior to merging
+        std::stable_sort(sorted.begin(), sorted.end(), [](const ChunkDescriptor &a, const ChunkDescriptor &b) { return a.address < b.address; });
+        bool overlapping{};
+        for (size_t index{1}; index < sorted.size(); index++)
+            overlapping |= sorted[index - 1].address + sorted[index - 1].size > sorted[index].address;
+
+        if (overlapping) {
+            // Overlapping mappings are rare, so they're inserted one at a time rather than being split up to fit into the merge
+            for (const auto &mapping : mappings) {
+                auto size{util::AlignUp(mapping.size, constant::GpuPageSize)};
+                SetPages(InsertChunk(ChunkDescriptor(mapping.address, size, mapping.cpuAddress, mapping.cpuAddress ? ChunkState::Mapped : ChunkState::Reserved)), mapping.cpuAddress, size);
+            }
+        } else {
+            // The new chunk list is built by merging the sorted mappings into the existing chunks, the parts of the existing chunks that aren't covered by a mapping are retained
+            std::vector<ChunkDescriptor> merged;
+            merged.reserve(chunkList.size() + (sorted.size() * 2));
+
+            auto chunk{chunkList.begin()};
+            auto position{spaceStart};
+            auto copyUntil{[&](u64 end) {
+                while (position < end) {
+                    while (chunk->address + chunk->size <= position)
+                        chunk++;
+
+                    auto sliceEnd{std::min(chunk->address + chunk->size, end)};
+                    merged.emplace_back(position, sliceEnd - position, (chunk->state == ChunkState::Mapped) ? (chunk->cpuAddress + (position - chunk->address)) : 0, chunk->state);
+                    position = sliceEnd;
+                }
+            }};
+
+            for (const auto &mapping : sorted) {
+                copyUntil(mapping.address);
+                merged.push_back(mapping);
+                position = mapping.address + mapping.size;
+            }
+            copyUntil(spaceEnd);
+
+            chunkList = std::move(merged);
+            for (const auto &mapping : sorted)
+                SetPages(mapping.address, mapping.cpuAddress, mapping.size);
+        }
+
+        std::vector<BufferCache::Region> regions;
+        regions.reserve(sorted.size());
+        for (const auto &mapping : sorted)
+            regions.push_back({mapping.address, mapping.size});
+        state.gpu->bufferCache.InvalidateMappings(regions);
+
+        return true;
     }
 
     bool MemoryManager::Unmap(u64 address) {
         if (!util::IsAligned(address, constant::GpuPageSize))
             return false;
 
-        auto chunk = std::find_if(chunkList.begin(), chunkList.end(), [address](const ChunkDescriptor &chunk) -> bool {
-            return chunk.address == address;
+        // The chunk list is sorted by address so the chunk can be found with a binary search
+        auto chunk = std::lower_bound(chunkList.begin(), chunkList.end(), address, [](const ChunkDescriptor &chunk, const u64 address) -> bool {
+            return chunk.address < address;
         });
 
-        if (chunk == chunkList.end())
+        if (chunk == chunkList.end() || chunk->address != address)
             return false;
 
         chunk->state = ChunkState::Reserved;
         chunk->cpuAddress = 0;
+        SetPages(chunk->address, 0, chunk->size);
+
+        BufferCache::Region region{chunk->address, chunk->size};
+        state.gpu->bufferCache.InvalidateMappings(std::span(&region, 1));
 
         return true;
     }
 
-    void MemoryManager::Read(u8 *destination, u64 address, u64 size) const {
-        auto chunk = std::upper_bound(chunkList.begin(), chunkList.end(), address, [](const u64 address, const ChunkDescriptor &chunk) -> bool {
-            return address < chunk.address;
-        });
+    std::span<u8> MemoryManager::GetHostSpan(u64 address, u64 size) const {
+        auto page{GetPage(address)};
+        if (!page || !page->host)
+            return {};
+
+        auto host{page->host + (address & (constant::GpuPageSize - 1))};
 
-        if (chunk == chunkList.end() || chunk->state != ChunkState::Mapped)
-            throw exception("Failed to read region in GPU address space: Address: 0x{:X}, Size: 0x{:X}", address, size);
+        // Every subsequent page in the region must directly follow the previous one on the host for the region to be contiguous
+        for (u64 pageAddress{util::AlignDown(address, constant::GpuPageSize) + constant::GpuPageSize}; pageAddress < address + size; pageAddress += constant::GpuPageSize) {
+            page = GetPage(pageAddress);
+            if (!page || page->host != host + (pageAddress - address))
+                return {};
+        }
+
+        if (recorder) [[unlikely]]
+            recorder->RecordMemory(address, std::span(host, size));
 
-        chunk--;
+        return std::span(host, size);
+    }
+
+    std::optional<u64> MemoryManager::GetCpuAddress(u64 address, u64 size) const {
+        auto page{GetPage(address)};
+        if (!page || !page->cpuAddress)
+            return std::nullopt;
+
+        auto cpuAddress{page->cpuAddress + (address & (constant::GpuPageSize - 1))};
+        for (u64 pageAddress{util::AlignDown(address, constant::GpuPageSize) + constant::GpuPageSize}; pageAddress < address + size; pageAddress += constant::GpuPageSize) {
+            page = GetPage(pageAddress);
+            if (!page || page->cpuAddress != cpuAddress + (pageAddress - address))
+                return std::nullopt;
+        }
+
+        return cpuAddress;
+    }
 
-        u64 initialSize{size};
-        u64 chunkOffset{address - chunk->address};
-        u64 readAddress{chunk->cpuAddress + chunkOffset};
-        u64 readSize{std::min(chunk->size - chunkOffset, size)};
+    void MemoryManager::SynchronizeAccess(u64 address, u64 size, bool write, bool invalidateBuffers) const {
+        auto &gpu{*state.gpu};
+        auto synchronize{[&](u64 cpuAddress, u64 cpuSize) {
+            if (write) {
+                gpu.textureCache.Invalidate(cpuAddress, cpuSize);
+                if (invalidateBuffers)
+                    gpu.bufferCache.Invalidate(cpuAddress, cpuSize);
+            } else {
+                gpu.textureCache.Flush(cpuAddress, cpuSize);
+            }
+        }};
+
+        // Pages which are contiguous in the CPU address space are merged so the caches are only walked once for them
+        u64 runStart{}, runSize{};
+        for (u64 offset{}; offset < size;) {
+            auto page{GetPage(address + offset)};
+            auto pageOffset{(address + offset) & (constant::GpuPageSize - 1)};
+            auto copySize{std::min(constant::GpuPageSize - pageOffset, size - offset)};
+            offset += copySize;
+            if (!page || !page->cpuAddress)
+                continue;
+
+            auto cpuAddress{page->cpuAddress + pageOffset};
+            if (runSize && runStart + runSize == cpuAddress) {
+                runSize += copySize;
+                continue;
+            }
 
-        // A continuous region in the GPU address space may be made up of several discontinuous regions in physical memory so we have to iterate over all chunks
-        while (size) {
-            state.process->ReadMemory(destination + (initialSize - size), readAddress, readSize);
+            if (runSize)
+                synchronize(runStart, runSize);
+            runStart = cpuAddress;
+            runSize = copySize;
+        }
 
-            size -= readSize;
-            if (size) {
-                if (++chunk == chunkList.end() || chunk->state != ChunkState::Mapped)
-                    throw exception("Failed to read region in GPU address space: Address: 0x{:X}, Size: 0x{:X}", address, size);
+        if (runSize)
+            synchronize(runStart, runSize);
+    }
 
-                readAddress = chunk->cpuAddress;
-                readSize = std::min(chunk->size, size);
+    namespace {
+        /**
+         * @brief Appends a piece of a transfer to or from the guest, it's merged with the previous piece if both are contiguous
+         */
+        void AppendPiece(std::vector<kernel::type::KProcess::MemoryPiece> &pieces, u8 *host, u64 cpuAddress, u64 size) {
+            if (!pieces.empty()) {
+                auto &last{pieces.back()};
+                if (reinterpret_cast<u8 *>(last.host) + last.size == host && last.guest + last.size == cpuAddress) {
+                    last.size += size;
+                    return;
+                }
             }
+            pieces.push_back({host, cpuAddress, size});
         }
     }
 
-    void MemoryManager::Write(u8 *source, u64 address, u64 size) const {
-        auto chunk = std::upper_bound(chunkList.begin(), chunkList.end(), address, [](const u64 address, const ChunkDescriptor &chunk) -> bool {
-            return address < chunk.address;
-        });
+    void MemoryManager::Read(u8 *destination, u64 address, u64 size) const {
+        // A continuous region in the GPU address space may be made up of several discontinuous regions in physical memory so it's copied a page at a time
+        // Pages without a host mirror are gathered into pieces that are read from the guest at once, pages which are contiguous in the CPU address space are merged into a single piece
+        std::vector<kernel::type::KProcess::MemoryPiece> pieces;
+        for (u64 offset{}; offset < size;) {
+            auto page{GetPage(address + offset)};
+            if (!page || !page->cpuAddress)
+                throw exception("Failed to read region in GPU address space: Address: 0x{:X}, Size: 0x{:X}", address, size);
+
+            auto pageOffset{(address + offset) & (constant::GpuPageSize - 1)};
+            auto copySize{std::min(constant::GpuPageSize - pageOffset, size - offset)};
+            if (page->host)
+                std::memcpy(destination + offset, page->host + pageOffset, copySize);
+            else
+                AppendPiece(pieces, destination + offset, page->cpuAddress + pageOffset, copySize);
+
+            offset += copySize;
+        }
 
-        if (chunk == chunkList.end() || chunk->state != ChunkState::Mapped)
-            throw exception("Failed to write region in GPU address space: Address: 0x{:X}, Size: 0x{:X}", address, size);
+        if (!pieces.empty())
+            state.process->ReadMemory(pieces);
 
-        chunk--;
+        if (recorder) [[unlikely]]
+            recorder->RecordMemory(address, std::span(destination, size));
+    }
 
-        u64 initialSize{size};
-        u64 chunkOffset{address - chunk->address};
-        u64 writeAddress{chunk->cpuAddress + chunkOffset};
-        u64 writeSize{std::min(chunk->size - chunkOffset, size)};
+    void MemoryManager::Write(u8 *source, u64 address, u64 size, bool invalidateBuffers) const {
+        SynchronizeAccess(address, size, true, invalidateBuffers);
 
-        // A continuous region in the GPU address space may be made up of several discontinuous regions in physical memory so we have to iterate over all chunks
-        while (size) {
-            state.process->WriteMemory(source + (initialSize - size), writeAddress, writeSize);
+        std::vector<kernel::type::KProcess::MemoryPiece> pieces;
+        for (u64 offset{}; offset < size;) {
+            auto page{GetPage(address + offset)};
+            if (!page || !page->cpuAddress)
+                throw exception("Failed to write region in GPU address space: Address: 0x{:X}, Size: 0x{:X}", address, size);
 
-            size -= writeSize;
-            if (size) {
-                if (++chunk == chunkList.end() || chunk->state != ChunkState::Mapped)
-                    throw exception("Failed to write region in GPU address space: Address: 0x{:X}, Size: 0x{:X}", address, size);
+            auto pageOffset{(address + offset) & (constant::GpuPageSize - 1)};
+            auto copySize{std::min(constant::GpuPageSize - pageOffset, size - offset)};
+            if (page->host)
+                std::memcpy(page->host + pageOffset, source + offset, copySize);
+            else
+                AppendPiece(pieces, source + offset, page->cpuAddress + pageOffset, copySize);
 
-                writeAddress = chunk->cpuAddress;
-                writeSize = std::min(chunk->size, size);
-            }
+            offset += copySize;
         }
+
+        if (!pieces.empty())
+            state.process->WriteMemory(pieces);
     }
 }
@@ -8,6 +8,14 @@
 namespace skyline {
     namespace constant {
         constexpr u64 GpuPageSize = 1 << 16; //!< The page size of the GPU address space
+        constexpr u8 GpuPageBits = 16; //!< The amount of bits of an address which are the offset into a GPU page
+        constexpr u8 GpuPageTableL2Bits = 12; //!< The amount of bits of a page number which index into a second-level page table
+        constexpr size_t GpuPageTableL2Size = 1 << GpuPageTableL2Bits; //!< The amount of entries in a second-level page table
+        constexpr size_t GpuPageTableL1Size = 1 << 13; //!< The amount of entries in the first-level page table, this covers a 41-bit address space
+    }
+
+    namespace gpu::capture {
+        class Recorder;
     }
 
     namespace gpu::vmm {
@@ -40,13 +48,42 @@ namespace skyline {
             }
         };
 
+        /**
+         * @brief This describes the mapping of a single page in the GPU address space
+         */
+        struct PageEntry {
+            u64 cpuAddress; //!< The address of the page in the CPU address space, this is 0 if the page isn't mapped
+            u8 *host; //!< A pointer to the page in host memory, this is nullptr if the page isn't mirrored on the host
+        };
+
         /**
         * @brief The MemoryManager class handles the mapping of the GPU address space
+        * @note Chunks are used to allocate regions of the address space while translation is done with a two-level page table at GpuPageSize granularity
         */
         class MemoryManager {
           private:
             const DeviceState &state;
 
+            using PageTable = std::array<PageEntry, constant::GpuPageTableL2Size>;
+            std::array<std::unique_ptr<PageTable>, constant::GpuPageTableL1Size> pageTable; //!< The first-level page table, second-level tables are only allocated once a page in their range is mapped
+
+            /**
+             * @return The page table entry for the page containing the supplied address, or nullptr if no page in its range has been mapped
+             */
+            inline const PageEntry *GetPage(u64 address) const {
+                auto index{address >> constant::GpuPageBits};
+                if ((index >> constant::GpuPageTableL2Bits) >= constant::GpuPageTableL1Size)
+                    return nullptr;
+                auto &table{pageTable[index >> constant::GpuPageTableL2Bits]};
+                return table ? &(*table)[index & (constant::GpuPageTableL2Size - 1)] : nullptr;
+            }
+
+            /**
+             * @brief This sets the page table entries for a region of the GPU address space
+             * @param cpuAddress The CPU address the region is mapped to, this is 0 to unmap the region
+             */
+            void SetPages(u64 address, u64 cpuAddress, u64 size);
+
             /**
              * @brief This finds a chunk of the specified type in the GPU address space that is larger than the given size
              * @param size The minimum size of the chunk to find
@@ -63,6 +100,8 @@ namespace skyline {
             u64 InsertChunk(const ChunkDescriptor &newChunk);
 
           public:
+            capture::Recorder *recorder{}; //!< The recorder that all reads from the GPU address space are recorded to, this is nullptr when GPU capture is disabled
+
             MemoryManager(const DeviceState &state);
             std::vector<ChunkDescriptor> chunkList; //!< This vector holds all the chunk descriptors
 
@@ -98,12 +137,51 @@ namespace skyline {
              */
             u64 MapFixed(u64 address, u64 cpuAddress, u64 size);
 
+            /**
+             * @brief This maps a batch of physical CPU memory regions to fixed virtual memory regions, the chunk list is rebuilt in a single pass and the page table is only updated after it
+             * @param mappings The mappings to apply in order, their addresses must be aligned to GpuPageSize and later mappings replace earlier ones they overlap, a mapping with a CPU address of 0 unmaps its region while retaining the reservation
+             * @return If all mappings were applied, no mappings are applied if any of them is invalid
+             * @note Buffers overlapping the mapped regions are invalidated once for the whole batch
+             */
+            bool MapBatch(std::span<const ChunkDescriptor> mappings);
+
             /**
              * @brief This unmaps the chunk that starts at 'offset' from the GPU address space
              * @return Whether the operation succeeded
              */
             bool Unmap(u64 address);
 
+            /**
+             * @brief This translates a region of the GPU address space into a span of host memory
+             * @return A span over the region in host memory or an empty span if it isn't backed by a single contiguous host region
+             */
+            std::span<u8> GetHostSpan(u64 address, u64 size) const;
+
+            /**
+             * @brief This translates a region of the GPU address space into a region of the CPU address space
+             * @return The CPU address of the region or std::nullopt if it isn't mapped to a single contiguous CPU region
+             */
+            std::optional<u64> GetCpuAddress(u64 address, u64 size) const;
+
+            /**
+             * @brief Keeps the texture and buffer caches coherent with an engine accessing a region of the GPU address space directly rather than through them
+             * @param write If the region is written to, the textures and buffers on it are invalidated in addition to render targets on it being flushed into guest memory
+             * @param invalidateBuffers If buffers on the region are invalidated when it's written to, this is only false for writes by the buffer cache itself as it updates the buffers in place
+             * @note This must be called prior to the access, it's done for every CPU region that the GPU region is split across
+             */
+            void SynchronizeAccess(u64 address, u64 size, bool write, bool invalidateBuffers = true) const;
+
+            /**
+             * @brief This translates a region of the GPU address space into a span of host memory
+             * @tparam T The type of the elements in the span
+             * @return A span over the region in host memory or an empty span if it isn't backed by a single contiguous host region
+             */
+            template<typename T>
+            std::span<T> GetHostSpan(u64 address, size_t count) const {
+                auto span{GetHostSpan(address, count * sizeof(T))};
+                return std::span(reinterpret_cast<T *>(span.data()), span.size() / sizeof(T));
+            }
+
             void Read(u8 *destination, u64 address, u64 size) const;
 
             /**
@@ -126,7 +204,11 @@ namespace skyline {
                 return obj;
             }
 
-            void Write(u8 *source, u64 address, u64 size) const;
+            /**
+             * @brief Writes out a region of the GPU virtual address space, the caches are synchronized with the region prior to it as the write bypasses write tracking
+             * @param invalidateBuffers If buffers on the region are marked as dirty, this is false for writes by the buffer cache as it updates its buffers in place
+             */
+            void Write(u8 *source, u64 address, u64 size, bool invalidateBuffers = true) const;
 
             /**
              * @brief Writes out a span to a region of the GPU virtual address space
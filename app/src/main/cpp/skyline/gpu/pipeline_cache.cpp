@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "pipeline_cache.h"
+
+namespace skyline::gpu {
+    size_t PipelineKey::Hash() const {
+        auto hash{state.Hash()};
+        for (auto shader : shaders)
+            hash ^= shader + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+
+    Pipeline::Status Pipeline::UpdateStatus() {
+        if (status != Status::Pending)
+            return status;
+
+        bool ready{true};
+        for (const auto &shader : shaders) {
+            if (!shader)
+                continue;
+
+            auto shaderStatus{shader->status.load(std::memory_order_acquire)};
+            if (shaderStatus == ShaderCache::Shader::Status::Failed)
+                return status = Status::Failed;
+            else if (shaderStatus == ShaderCache::Shader::Status::Pending)
+                ready = false;
+        }
+
+        if (ready)
+            status = Status::Ready;
+        return status;
+    }
+
+    size_t ComputePipelineKey::Hasher::operator()(const ComputePipelineKey &key) const {
+        auto hash{key.shader};
+        hash ^= (static_cast<u64>(key.blockDimensions[0]) | (static_cast<u64>(key.blockDimensions[1]) << 16) | (static_cast<u64>(key.blockDimensions[2]) << 32)) + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+        hash ^= key.sharedMemorySize + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+
+    ComputePipeline::Status ComputePipeline::UpdateStatus() {
+        if (status != Status::Pending)
+            return status;
+
+        auto shaderStatus{shader->status.load(std::memory_order_acquire)};
+        if (shaderStatus == ShaderCache::Shader::Status::Failed)
+            status = Status::Failed;
+        else if (shaderStatus == ShaderCache::Shader::Status::Ready)
+            status = Status::Ready;
+        return status;
+    }
+
+    PipelineCache::PipelineCache() : slots(InitialCapacity) {}
+
+    void PipelineCache::Grow() {
+        std::vector<Slot> oldSlots(slots.size() * 2);
+        std::swap(slots, oldSlots);
+
+        auto mask{slots.size() - 1};
+        for (auto &slot : oldSlots) {
+            if (!slot.pipeline)
+                continue;
+
+            auto index{slot.hash & mask};
+            while (slots[index].pipeline)
+                index = (index + 1) & mask;
+            slots[index] = std::move(slot);
+        }
+    }
+
+    Pipeline &PipelineCache::Get(const PipelineKey &key, const std::array<std::shared_ptr<ShaderCache::Shader>, shader::StageCount> &shaders) {
+        auto hash{key.Hash()};
+        auto mask{slots.size() - 1};
+        auto index{hash & mask};
+
+        // Slots are linearly probed from the hash until the pipeline or an empty slot is found, the table is never more than half full so probes stay short
+        for (; slots[index].pipeline; index = (index + 1) & mask)
+            if (slots[index].hash == hash && slots[index].pipeline->key == key)
+                return *slots[index].pipeline;
+
+        auto pipeline{std::make_unique<Pipeline>(Pipeline{key, shaders})};
+        auto &result{*pipeline};
+        slots[index] = Slot{hash, std::move(pipeline)};
+
+        if (++count * 2 > slots.size())
+            Grow();
+
+        return result;
+    }
+
+    ComputePipeline &PipelineCache::GetCompute(const ComputePipelineKey &key, const std::shared_ptr<ShaderCache::Shader> &shader) {
+        auto &pipeline{computePipelines[key]};
+        if (!pipeline)
+            pipeline = std::make_unique<ComputePipeline>(ComputePipeline{key, shader});
+        return *pipeline;
+    }
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "pipeline_state.h"
+#include "shader_cache.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief The key that a pipeline is looked up with, it's made up of the translated pipeline state and the shaders bound to every stage
+     */
+    struct PipelineKey {
+        PipelineState state;
+        std::array<u64, shader::StageCount> shaders{}; //!< The hashes of the shaders bound to every SetProgram slot, this is 0 for slots without a shader
+
+        size_t Hash() const;
+
+        inline bool operator==(const PipelineKey &other) const {
+            return shaders == other.shaders && state == other.state;
+        }
+    };
+
+    /**
+     * @brief A single pipeline and the shaders it's made up of
+     */
+    struct Pipeline {
+        enum class Status : u8 {
+            Pending, //!< The pipeline is waiting for its shaders to be translated
+            Ready, //!< All shaders of the pipeline have been translated, so the pipeline can be created
+            Failed, //!< A shader of the pipeline couldn't be translated, draws with it are always skipped
+        };
+
+        PipelineKey key;
+        std::array<std::shared_ptr<ShaderCache::Shader>, shader::StageCount> shaders; //!< The shaders bound to every SetProgram slot
+        Status status{Status::Pending};
+
+        /**
+         * @brief Updates the status of a pending pipeline from the status of its shaders
+         * @return The updated status
+         */
+        Status UpdateStatus();
+    };
+
+    /**
+     * @brief The key that a compute pipeline is looked up with, the block dimensions and shared memory size are specialized into the pipeline
+     */
+    struct ComputePipelineKey {
+        u64 shader; //!< The hash of the compute shader
+        std::array<u16, 3> blockDimensions; //!< The dimensions of a thread block on the X, Y and Z axes
+        u32 sharedMemorySize; //!< The size of the shared memory of a thread block in bytes
+
+        inline bool operator==(const ComputePipelineKey &other) const {
+            return shader == other.shader && blockDimensions == other.blockDimensions && sharedMemorySize == other.sharedMemorySize;
+        }
+
+        struct Hasher {
+            size_t operator()(const ComputePipelineKey &key) const;
+        };
+    };
+
+    /**
+     * @brief A single compute pipeline and the shader it's made up of
+     */
+    struct ComputePipeline {
+        using Status = Pipeline::Status;
+
+        ComputePipelineKey key;
+        std::shared_ptr<ShaderCache::Shader> shader;
+        Status status{Status::Pending};
+
+        /**
+         * @brief Updates the status of a pending pipeline from the status of its shader
+         * @return The updated status
+         */
+        Status UpdateStatus();
+    };
+
+    /**
+     * @brief The PipelineCache class deduplicates pipelines by their key, it's an open-addressing hash table as it's looked up on every draw that changes the key
+     * @note This is only accessed from the GPFIFO thread so it isn't synchronized
+     */
+    class PipelineCache {
+      private:
+        constexpr static size_t InitialCapacity{0x400}; //!< The initial amount of slots in the table, this must be a power of two
+
+        struct Slot {
+            size_t hash; //!< The hash of the key of the pipeline in the slot
+            std::unique_ptr<Pipeline> pipeline; //!< The pipeline in the slot, this is nullptr for empty slots
+        };
+
+        std::vector<Slot> slots; //!< The slots of the table, the capacity is always a power of two and is kept at least twice the amount of pipelines
+        size_t count{}; //!< The amount of pipelines in the table
+        std::unordered_map<ComputePipelineKey, std::unique_ptr<ComputePipeline>, ComputePipelineKey::Hasher> computePipelines; //!< Compute pipelines are only looked up on launches which are far rarer than draws, so they're kept in a standard map
+
+        /**
+         * @brief Doubles the capacity of the table and reinserts all pipelines, their addresses stay the same
+         */
+        void Grow();
+
+      public:
+        PipelineCache();
+
+        /**
+         * @return The pipeline with the supplied key, it's created if it doesn't exist yet
+         * @note The returned reference stays valid for the lifetime of the cache
+         */
+        Pipeline &Get(const PipelineKey &key, const std::array<std::shared_ptr<ShaderCache::Shader>, shader::StageCount> &shaders);
+
+        /**
+         * @return The compute pipeline with the supplied key, it's created if it doesn't exist yet
+         * @note The returned reference stays valid for the lifetime of the cache
+         */
+        ComputePipeline &GetCompute(const ComputePipelineKey &key, const std::shared_ptr<ShaderCache::Shader> &shader);
+    };
+}
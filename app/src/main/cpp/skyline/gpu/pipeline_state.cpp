@@ -0,0 +1,378 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "pipeline_state.h"
+
+namespace skyline::gpu {
+    using Registers = PipelineState::Registers;
+
+    static vk::CompareOp ConvertCompareOp(Registers::CompareOp op) {
+        using MaxwellOp = Registers::CompareOp;
+        switch (op) {
+            case MaxwellOp::Never:
+            case MaxwellOp::NeverGL:
+                return vk::CompareOp::eNever;
+            case MaxwellOp::Less:
+            case MaxwellOp::LessGL:
+                return vk::CompareOp::eLess;
+            case MaxwellOp::Equal:
+            case MaxwellOp::EqualGL:
+                return vk::CompareOp::eEqual;
+            case MaxwellOp::LessOrEqual:
+            case MaxwellOp::LessOrEqualGL:
+                return vk::CompareOp::eLessOrEqual;
+            case MaxwellOp::Greater:
+            case MaxwellOp::GreaterGL:
+                return vk::CompareOp::eGreater;
+            case MaxwellOp::NotEqual:
+            case MaxwellOp::NotEqualGL:
+                return vk::CompareOp::eNotEqual;
+            case MaxwellOp::GreaterOrEqual:
+            case MaxwellOp::GreaterOrEqualGL:
+                return vk::CompareOp::eGreaterOrEqual;
+            case MaxwellOp::Always:
+            case MaxwellOp::AlwaysGL:
+                return vk::CompareOp::eAlways;
+        }
+        throw exception("Unsupported compare operation: 0x{:X}", static_cast<u32>(op));
+    }
+
+    static vk::StencilOp ConvertStencilOp(Registers::StencilOp op) {
+        using MaxwellOp = Registers::StencilOp;
+        switch (op) {
+            case MaxwellOp::Keep:
+                return vk::StencilOp::eKeep;
+            case MaxwellOp::Zero:
+                return vk::StencilOp::eZero;
+            case MaxwellOp::Replace:
+                return vk::StencilOp::eReplace;
+            case MaxwellOp::IncrementAndClamp:
+                return vk::StencilOp::eIncrementAndClamp;
+            case MaxwellOp::DecrementAndClamp:
+                return vk::StencilOp::eDecrementAndClamp;
+            case MaxwellOp::Invert:
+                return vk::StencilOp::eInvert;
+            case MaxwellOp::IncrementAndWrap:
+                return vk::StencilOp::eIncrementAndWrap;
+            case MaxwellOp::DecrementAndWrap:
+                return vk::StencilOp::eDecrementAndWrap;
+        }
+        throw exception("Unsupported stencil operation: 0x{:X}", static_cast<u32>(op));
+    }
+
+    static vk::BlendOp ConvertBlendOp(Registers::Blend::Op op) {
+        using MaxwellOp = Registers::Blend::Op;
+        switch (op) {
+            case MaxwellOp::Add:
+            case MaxwellOp::AddGL:
+                return vk::BlendOp::eAdd;
+            case MaxwellOp::Subtract:
+            case MaxwellOp::SubtractGL:
+                return vk::BlendOp::eSubtract;
+            case MaxwellOp::ReverseSubtract:
+            case MaxwellOp::ReverseSubtractGL:
+                return vk::BlendOp::eReverseSubtract;
+            case MaxwellOp::Minimum:
+            case MaxwellOp::MinimumGL:
+                return vk::BlendOp::eMin;
+            case MaxwellOp::Maximum:
+            case MaxwellOp::MaximumGL:
+                return vk::BlendOp::eMax;
+        }
+        throw exception("Unsupported blend operation: 0x{:X}", static_cast<u32>(op));
+    }
+
+    static vk::BlendFactor ConvertBlendFactor(Registers::Blend::Factor factor) {
+        using MaxwellFactor = Registers::Blend::Factor;
+        switch (factor) {
+            case MaxwellFactor::Zero:
+            case MaxwellFactor::ZeroGL:
+                return vk::BlendFactor::eZero;
+            case MaxwellFactor::One:
+            case MaxwellFactor::OneGL:
+                return vk::BlendFactor::eOne;
+            case MaxwellFactor::SourceColor:
+            case MaxwellFactor::SourceColorGL:
+                return vk::BlendFactor::eSrcColor;
+            case MaxwellFactor::OneMinusSourceColor:
+            case MaxwellFactor::OneMinusSourceColorGL:
+                return vk::BlendFactor::eOneMinusSrcColor;
+            case MaxwellFactor::SourceAlpha:
+            case MaxwellFactor::SourceAlphaGL:
+                return vk::BlendFactor::eSrcAlpha;
+            case MaxwellFactor::OneMinusSourceAlpha:
+            case MaxwellFactor::OneMinusSourceAlphaGL:
+                return vk::BlendFactor::eOneMinusSrcAlpha;
+            case MaxwellFactor::DestAlpha:
+            case MaxwellFactor::DestAlphaGL:
+                return vk::BlendFactor::eDstAlpha;
+            case MaxwellFactor::OneMinusDestAlpha:
+            case MaxwellFactor::OneMinusDestAlphaGL:
+                return vk::BlendFactor::eOneMinusDstAlpha;
+            case MaxwellFactor::DestColor:
+            case MaxwellFactor::DestColorGL:
+                return vk::BlendFactor::eDstColor;
+            case MaxwellFactor::OneMinusDestColor:
+            case MaxwellFactor::OneMinusDestColorGL:
+                return vk::BlendFactor::eOneMinusDstColor;
+            case MaxwellFactor::SourceAlphaSaturate:
+            case MaxwellFactor::SourceAlphaSaturateGL:
+                return vk::BlendFactor::eSrcAlphaSaturate;
+            case MaxwellFactor::Source1Color:
+            case MaxwellFactor::Source1ColorGL:
+                return vk::BlendFactor::eSrc1Color;
+            case MaxwellFactor::OneMinusSource1Color:
+            case MaxwellFactor::OneMinusSource1ColorGL:
+                return vk::BlendFactor::eOneMinusSrc1Color;
+            case MaxwellFactor::Source1Alpha:
+            case MaxwellFactor::Source1AlphaGL:
+                return vk::BlendFactor::eSrc1Alpha;
+            case MaxwellFactor::OneMinusSource1Alpha:
+            case MaxwellFactor::OneMinusSource1AlphaGL:
+                return vk::BlendFactor::eOneMinusSrc1Alpha;
+            case MaxwellFactor::ConstantColor:
+            case MaxwellFactor::ConstantColorGL:
+                return vk::BlendFactor::eConstantColor;
+            case MaxwellFactor::OneMinusConstantColor:
+            case MaxwellFactor::OneMinusConstantColorGL:
+                return vk::BlendFactor::eOneMinusConstantColor;
+            case MaxwellFactor::ConstantAlpha:
+            case MaxwellFactor::ConstantAlphaGL:
+                return vk::BlendFactor::eConstantAlpha;
+            case MaxwellFactor::OneMinusConstantAlpha:
+            case MaxwellFactor::OneMinusConstantAlphaGL:
+                return vk::BlendFactor::eOneMinusConstantAlpha;
+        }
+        throw exception("Unsupported blend factor: 0x{:X}", static_cast<u32>(factor));
+    }
+
+    /**
+     * @note Topologies without a Vulkan equivalent are mapped to the closest one, quad strips and polygons form the same primitives as triangle strips and fans while line loops lose their closing line and quads need their indices to be converted into triangles
+     */
+    static vk::PrimitiveTopology ConvertPrimitiveTopology(Registers::PrimitiveTopology topology) {
+        using MaxwellTopology = Registers::PrimitiveTopology;
+        switch (topology) {
+            case MaxwellTopology::Points:
+                return vk::PrimitiveTopology::ePointList;
+            case MaxwellTopology::Lines:
+                return vk::PrimitiveTopology::eLineList;
+            case MaxwellTopology::LineLoop:
+            case MaxwellTopology::LineStrip:
+                return vk::PrimitiveTopology::eLineStrip;
+            case MaxwellTopology::Triangles:
+            case MaxwellTopology::Quads:
+                return vk::PrimitiveTopology::eTriangleList;
+            case MaxwellTopology::TriangleStrip:
+            case MaxwellTopology::QuadStrip:
+                return vk::PrimitiveTopology::eTriangleStrip;
+            case MaxwellTopology::TriangleFan:
+            case MaxwellTopology::Polygon:
+                return vk::PrimitiveTopology::eTriangleFan;
+            case MaxwellTopology::LinesAdjacency:
+                return vk::PrimitiveTopology::eLineListWithAdjacency;
+            case MaxwellTopology::LineStripAdjacency:
+                return vk::PrimitiveTopology::eLineStripWithAdjacency;
+            case MaxwellTopology::TrianglesAdjacency:
+                return vk::PrimitiveTopology::eTriangleListWithAdjacency;
+            case MaxwellTopology::TriangleStripAdjacency:
+                return vk::PrimitiveTopology::eTriangleStripWithAdjacency;
+            case MaxwellTopology::Patches:
+                return vk::PrimitiveTopology::ePatchList;
+        }
+        throw exception("Unsupported primitive topology: 0x{:X}", static_cast<u16>(topology));
+    }
+
+    static vk::PolygonMode ConvertPolygonMode(Registers::PolygonMode mode) {
+        switch (mode) {
+            case Registers::PolygonMode::Point:
+                return vk::PolygonMode::ePoint;
+            case Registers::PolygonMode::Line:
+                return vk::PolygonMode::eLine;
+            case Registers::PolygonMode::Fill:
+                return vk::PolygonMode::eFill;
+        }
+        throw exception("Unsupported polygon mode: 0x{:X}", static_cast<u32>(mode));
+    }
+
+    static vk::CullModeFlags ConvertCullFace(Registers::CullFace face) {
+        switch (face) {
+            case Registers::CullFace::Front:
+                return vk::CullModeFlagBits::eFront;
+            case Registers::CullFace::Back:
+                return vk::CullModeFlagBits::eBack;
+            case Registers::CullFace::FrontAndBack:
+                return vk::CullModeFlagBits::eFrontAndBack;
+        }
+        throw exception("Unsupported cull face: 0x{:X}", static_cast<u32>(face));
+    }
+
+    /**
+     * @return The Vulkan format of a vertex attribute, this is eUndefined if there is no equivalent format
+     */
+    static vk::Format ConvertVertexAttributeFormat(Registers::VertexAttribute attribute) {
+        using Size = Registers::VertexAttribute::Size;
+        using Type = Registers::VertexAttribute::Type;
+
+        // Every component count has its formats in the order of the Type enumeration starting from SNorm, eUndefined is used for any combinations that aren't valid
+        auto select = [type = attribute.type](std::array<vk::Format, 7> formats) {
+            if (type == Type::None || static_cast<u8>(type) > static_cast<u8>(Type::Float))
+                return vk::Format::eUndefined;
+            return formats[static_cast<u8>(type) - static_cast<u8>(Type::SNorm)];
+        };
+
+        switch (attribute.size) {
+            case Size::Size_1x32:
+                return select({vk::Format::eUndefined, vk::Format::eUndefined, vk::Format::eR32Sint, vk::Format::eR32Uint, vk::Format::eUndefined, vk::Format::eUndefined, vk::Format::eR32Sfloat});
+            case Size::Size_2x32:
+                return select({vk::Format::eUndefined, vk::Format::eUndefined, vk::Format::eR32G32Sint, vk::Format::eR32G32Uint, vk::Format::eUndefined, vk::Format::eUndefined, vk::Format::eR32G32Sfloat});
+            case Size::Size_3x32:
+                return select({vk::Format::eUndefined, vk::Format::eUndefined, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32Uint, vk::Format::eUndefined, vk::Format::eUndefined, vk::Format::eR32G32B32Sfloat});
+            case Size::Size_4x32:
+                return select({vk::Format::eUndefined, vk::Format::eUndefined, vk::Format::eR32G32B32A32Sint, vk::Format::eR32G32B32A32Uint, vk::Format::eUndefined, vk::Format::eUndefined, vk::Format::eR32G32B32A32Sfloat});
+            case Size::Size_1x16:
+                return select({vk::Format::eR16Snorm, vk::Format::eR16Unorm, vk::Format::eR16Sint, vk::Format::eR16Uint, vk::Format::eR16Uscaled, vk::Format::eR16Sscaled, vk::Format::eR16Sfloat});
+            case Size::Size_2x16:
+                return select({vk::Format::eR16G16Snorm, vk::Format::eR16G16Unorm, vk::Format::eR16G16Sint, vk::Format::eR16G16Uint, vk::Format::eR16G16Uscaled, vk::Format::eR16G16Sscaled, vk::Format::eR16G16Sfloat});
+            case Size::Size_3x16:
+                return select({vk::Format::eR16G16B16Snorm, vk::Format::eR16G16B16Unorm, vk::Format::eR16G16B16Sint, vk::Format::eR16G16B16Uint, vk::Format::eR16G16B16Uscaled, vk::Format::eR16G16B16Sscaled, vk::Format::eR16G16B16Sfloat});
+            case Size::Size_4x16:
+                return select({vk::Format::eR16G16B16A16Snorm, vk::Format::eR16G16B16A16Unorm, vk::Format::eR16G16B16A16Sint, vk::Format::eR16G16B16A16Uint, vk::Format::eR16G16B16A16Uscaled, vk::Format::eR16G16B16A16Sscaled, vk::Format::eR16G16B16A16Sfloat});
+            case Size::Size_1x8:
+                return select({vk::Format::eR8Snorm, vk::Format::eR8Unorm, vk::Format::eR8Sint, vk::Format::eR8Uint, vk::Format::eR8Uscaled, vk::Format::eR8Sscaled, vk::Format::eUndefined});
+            case Size::Size_2x8:
+                return select({vk::Format::eR8G8Snorm, vk::Format::eR8G8Unorm, vk::Format::eR8G8Sint, vk::Format::eR8G8Uint, vk::Format::eR8G8Uscaled, vk::Format::eR8G8Sscaled, vk::Format::eUndefined});
+            case Size::Size_3x8:
+                return select({vk::Format::eR8G8B8Snorm, vk::Format::eR8G8B8Unorm, vk::Format::eR8G8B8Sint, vk::Format::eR8G8B8Uint, vk::Format::eR8G8B8Uscaled, vk::Format::eR8G8B8Sscaled, vk::Format::eUndefined});
+            case Size::Size_4x8:
+                if (attribute.bgra && attribute.type == Type::UNorm)
+                    return vk::Format::eB8G8R8A8Unorm;
+                return select({vk::Format::eR8G8B8A8Snorm, vk::Format::eR8G8B8A8Unorm, vk::Format::eR8G8B8A8Sint, vk::Format::eR8G8B8A8Uint, vk::Format::eR8G8B8A8Uscaled, vk::Format::eR8G8B8A8Sscaled, vk::Format::eUndefined});
+            case Size::Size_10_10_10_2:
+                return select({vk::Format::eA2B10G10R10SnormPack32, vk::Format::eA2B10G10R10UnormPack32, vk::Format::eA2B10G10R10SintPack32, vk::Format::eA2B10G10R10UintPack32, vk::Format::eA2B10G10R10UscaledPack32, vk::Format::eA2B10G10R10SscaledPack32, vk::Format::eUndefined});
+            case Size::Size_11_11_10:
+                return (attribute.type == Type::Float) ? vk::Format::eB10G11R11UfloatPack32 : vk::Format::eUndefined;
+        }
+        return vk::Format::eUndefined;
+    }
+
+    PipelineState::PipelineState(const Registers &registers) {
+        TranslateTopology(registers);
+        TranslateRasterizer(registers);
+        TranslateDepthStencil(registers);
+        TranslateBlend(registers);
+        TranslateVertexAttributes(registers);
+    }
+
+    void PipelineState::TranslateTopology(const Registers &registers) {
+        topology = ConvertPrimitiveTopology(registers.draw.vertexBeginGl.topology);
+    }
+
+    void PipelineState::TranslateRasterizer(const Registers &registers) {
+        polygonMode = ConvertPolygonMode(registers.polygonMode.front); // Vulkan doesn't support separate polygon modes for front and back faces
+        cullMode = registers.cullFaceEnable ? ConvertCullFace(registers.cullFace) : vk::CullModeFlagBits::eNone;
+        frontFace = (registers.frontFace == Registers::FrontFace::Clockwise) ? vk::FrontFace::eClockwise : vk::FrontFace::eCounterClockwise;
+        rasterizerDiscard = !registers.rasterizerEnable;
+    }
+
+    void PipelineState::TranslateDepthStencil(const Registers &registers) {
+        depthTestEnable = registers.depthTestEnable != 0;
+        depthWriteEnable = registers.depthWriteEnable != 0;
+        depthCompareOp = depthTestEnable ? ConvertCompareOp(registers.depthTestFunc) : vk::CompareOp::eAlways;
+
+        stencilTestEnable = registers.stencilEnable != 0;
+        stencilFront = stencilBack = vk::StencilOpState{};
+        if (stencilTestEnable) {
+            const auto &front{registers.stencilFront};
+            stencilFront = vk::StencilOpState(ConvertStencilOp(front.failOp), ConvertStencilOp(front.zPassOp), ConvertStencilOp(front.zFailOp), ConvertCompareOp(front.compare.op), front.compare.mask, front.writeMask, static_cast<u32>(front.compare.ref));
+
+            // The back face uses the front face's state unless two-sided stencil is enabled
+            if (registers.stencilTwoSideEnable) {
+                const auto &back{registers.stencilBack};
+                const auto &backExtra{registers.stencilBackExtra};
+                stencilBack = vk::StencilOpState(ConvertStencilOp(back.failOp), ConvertStencilOp(back.zPassOp), ConvertStencilOp(back.zFailOp), ConvertCompareOp(back.compareOp), backExtra.compareMask, backExtra.writeMask, backExtra.compareRef);
+            } else {
+                stencilBack = stencilFront;
+            }
+        }
+    }
+
+    void PipelineState::TranslateBlend(const Registers &registers) {
+        blendAttachments = {};
+        for (size_t index{}; index < constant::MaxRenderTargetCount; index++) {
+            auto &attachment{blendAttachments[index]};
+
+            const auto &mask{registers.colorMask[registers.rtSeparateFragData ? index : 0]};
+            vk::ColorComponentFlags writeMask{};
+            if (mask.r)
+                writeMask |= vk::ColorComponentFlagBits::eR;
+            if (mask.g)
+                writeMask |= vk::ColorComponentFlagBits::eG;
+            if (mask.b)
+                writeMask |= vk::ColorComponentFlagBits::eB;
+            if (mask.a)
+                writeMask |= vk::ColorComponentFlagBits::eA;
+            attachment.colorWriteMask = writeMask;
+
+            if (!registers.blend.enable[index])
+                continue;
+            attachment.blendEnable = true;
+
+            // Render targets either all use the common blend state or each use their own, both of which have the same fields and the alpha factors are only separate from the colour factors if that's enabled
+            auto applyBlend{[&attachment](const auto &blend) {
+                attachment.colorBlendOp = ConvertBlendOp(blend.colorOp);
+                attachment.srcColorBlendFactor = ConvertBlendFactor(blend.colorSrcFactor);
+                attachment.dstColorBlendFactor = ConvertBlendFactor(blend.colorDestFactor);
+                if (blend.seperateAlpha) {
+                    attachment.alphaBlendOp = ConvertBlendOp(blend.alphaOp);
+                    attachment.srcAlphaBlendFactor = ConvertBlendFactor(blend.alphaSrcFactor);
+                    attachment.dstAlphaBlendFactor = ConvertBlendFactor(blend.alphaDestFactor);
+                } else {
+                    attachment.alphaBlendOp = attachment.colorBlendOp;
+                    attachment.srcAlphaBlendFactor = attachment.srcColorBlendFactor;
+                    attachment.dstAlphaBlendFactor = attachment.dstColorBlendFactor;
+                }
+            }};
+
+            if (registers.independentBlendEnable)
+                applyBlend(registers.independentBlend[index]);
+            else
+                applyBlend(registers.blend);
+        }
+    }
+
+    void PipelineState::TranslateVertexAttributes(const Registers &registers) {
+        vertexAttributeCount = 0;
+        vertexAttributes = {};
+        for (u32 location{}; location < constant::MaxVertexAttributeCount; location++) {
+            auto attribute{registers.vertexAttributeState[location]};
+            if (attribute.fixed)
+                continue; // Constant attributes aren't fetched from a vertex buffer
+
+            auto format{ConvertVertexAttributeFormat(attribute)};
+            if (format == vk::Format::eUndefined)
+                throw exception("Unsupported vertex attribute format: Size: 0x{:X}, Type: {}", static_cast<u8>(attribute.size), static_cast<u8>(attribute.type));
+
+            vertexAttributes[vertexAttributeCount++] = vk::VertexInputAttributeDescription(location, attribute.bufferId, format, attribute.offset);
+        }
+    }
+
+    vk::Viewport PipelineState::GetViewport(const Registers &registers, size_t index) {
+        const auto &transform{registers.viewportTransform.at(index)};
+        const auto &viewport{registers.viewport.at(index)};
+
+        // The viewport transform maps [-1, 1] onto the viewport with a scale and offset, a negative height is used for transforms that flip the Y axis
+        if (registers.viewportTransformEnable)
+            return vk::Viewport(transform.translateX - transform.scaleX, transform.translateY - transform.scaleY, transform.scaleX * 2.0f, transform.scaleY * 2.0f, viewport.depthRangeNear, viewport.depthRangeFar);
+        return vk::Viewport(viewport.x, viewport.y, viewport.width, viewport.height, viewport.depthRangeNear, viewport.depthRangeFar);
+    }
+
+    vk::Rect2D PipelineState::GetScissor(const Registers &registers, size_t index) {
+        const auto &scissor{registers.scissor.at(index)};
+        if (!scissor.enable)
+            return vk::Rect2D({}, {static_cast<u32>(std::numeric_limits<i32>::max()), static_cast<u32>(std::numeric_limits<i32>::max())}); // A disabled scissor doesn't restrict rendering at all
+
+        auto width{scissor.horizontal.maximum > scissor.horizontal.minimum ? scissor.horizontal.maximum - scissor.horizontal.minimum : 0};
+        auto height{scissor.vertical.maximum > scissor.vertical.minimum ? scissor.vertical.maximum - scissor.vertical.minimum : 0};
+        return vk::Rect2D({scissor.horizontal.minimum, scissor.vertical.minimum}, {static_cast<u32>(width), static_cast<u32>(height)});
+    }
+}
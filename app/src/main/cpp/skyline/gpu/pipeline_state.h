@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <gpu/engines/maxwell_3d.h>
+
+namespace skyline {
+    namespace constant {
+        constexpr size_t MaxViewportCount = 16; //!< The amount of viewports that Maxwell 3D supports
+        constexpr size_t MaxRenderTargetCount = 8; //!< The amount of colour render targets that Maxwell 3D supports
+        constexpr size_t MaxVertexAttributeCount = 32; //!< The amount of vertex attributes that Maxwell 3D supports
+    }
+
+    namespace gpu {
+        /**
+         * @brief The PipelineState struct holds the subset of Maxwell 3D register state that's baked into a Vulkan graphics pipeline, it's translated from the registers for every draw
+         * @note This only contains Vulkan types which are made up of 32-bit fields so it has no padding and is hashed and compared bytewise, any dynamic state such as viewports is kept out of it
+         */
+        struct PipelineState {
+            using Registers = engine::Maxwell3D::Registers;
+
+            vk::PrimitiveTopology topology{};
+            vk::PolygonMode polygonMode{};
+            vk::CullModeFlags cullMode{};
+            vk::FrontFace frontFace{};
+            vk::Bool32 rasterizerDiscard{};
+
+            vk::Bool32 depthTestEnable{};
+            vk::Bool32 depthWriteEnable{};
+            vk::CompareOp depthCompareOp{};
+            vk::Bool32 stencilTestEnable{};
+            vk::StencilOpState stencilFront{};
+            vk::StencilOpState stencilBack{};
+
+            std::array<vk::PipelineColorBlendAttachmentState, constant::MaxRenderTargetCount> blendAttachments{};
+
+            u32 vertexAttributeCount{}; //!< The amount of valid entries in vertexAttributes
+            std::array<vk::VertexInputAttributeDescription, constant::MaxVertexAttributeCount> vertexAttributes{}; //!< The vertex attributes that are fetched from vertex buffers, constant attributes aren't included
+
+            PipelineState() = default;
+
+            /**
+             * @brief Translates the entire pipeline state from the Maxwell 3D registers, parts of it can be translated again individually when the registers they're translated from change
+             */
+            PipelineState(const Registers &registers);
+
+            /**
+             * @brief Translates the primitive topology, this is written for every draw so it's compared rather than tracked
+             */
+            void TranslateTopology(const Registers &registers);
+
+            /**
+             * @brief Translates the polygon mode, culling and rasterizer discard state
+             */
+            void TranslateRasterizer(const Registers &registers);
+
+            void TranslateDepthStencil(const Registers &registers);
+
+            /**
+             * @brief Translates the blend state and colour write masks of every render target
+             */
+            void TranslateBlend(const Registers &registers);
+
+            void TranslateVertexAttributes(const Registers &registers);
+
+            /**
+             * @return The viewport at the supplied index translated from the Maxwell 3D registers, viewports are dynamic state so they aren't a part of the pipeline state
+             */
+            static vk::Viewport GetViewport(const Registers &registers, size_t index);
+
+            /**
+             * @return The scissor at the supplied index translated from the Maxwell 3D registers, scissors are dynamic state so they aren't a part of the pipeline state
+             */
+            static vk::Rect2D GetScissor(const Registers &registers, size_t index);
+
+            /**
+             * @return A hash of the pipeline state, this is used as the key to look up pipelines
+             */
+            inline size_t Hash() const {
+                return std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char *>(this), sizeof(PipelineState)));
+            }
+
+            inline bool operator==(const PipelineState &other) const {
+                return std::memcmp(this, &other, sizeof(PipelineState)) == 0;
+            }
+        };
+
+        /**
+         * @brief The state of a draw which is set dynamically rather than being baked into its pipeline
+         */
+        struct DynamicState {
+            std::array<vk::Viewport, constant::MaxViewportCount> viewports{};
+            std::array<vk::Rect2D, constant::MaxViewportCount> scissors{};
+        };
+    }
+}
@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <os.h>
+#include "presentation_engine.h"
+
+namespace skyline::gpu {
+    PresentationEngine::PresentationEngine(const DeviceState &state, ANativeWindow *window) : state(state), mailbox(state.settings->Get().presentMailbox), filter(static_cast<UpscalingFilter>(state.settings->Get().upscalingFilter)) {
+        vk::ApplicationInfo applicationInfo("Skyline", VK_MAKE_VERSION(0, 3, 0), "Skyline", VK_MAKE_VERSION(0, 3, 0), VK_API_VERSION_1_0);
+        std::array<const char *, 2> instanceExtensions{VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_ANDROID_SURFACE_EXTENSION_NAME};
+        instance = vk::createInstanceUnique(vk::InstanceCreateInfo({}, &applicationInfo, 0, nullptr, instanceExtensions.size(), instanceExtensions.data()));
+
+        surface = instance->createAndroidSurfaceKHRUnique(vk::AndroidSurfaceCreateInfoKHR({}, window));
+
+        // The first device with a queue family that supports both transfers and presentation to the surface is used
+        for (const auto &candidate : instance->enumeratePhysicalDevices()) {
+            auto families = candidate.getQueueFamilyProperties();
+            for (u32 family = 0; family < families.size(); family++) {
+                if ((families[family].queueFlags & vk::QueueFlagBits::eGraphics) && candidate.getSurfaceSupportKHR(family, *surface)) {
+                    physicalDevice = candidate;
+                    queueFamily = family;
+                    break;
+                }
+            }
+            if (physicalDevice)
+                break;
+        }
+        if (!physicalDevice)
+            throw exception("Cannot find a Vulkan device which can present to the surface");
+
+        float queuePriority = 1.0f;
+        vk::DeviceQueueCreateInfo queueInfo({}, queueFamily, 1, &queuePriority);
+        std::array<const char *, 1> deviceExtensions{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        device = physicalDevice.createDeviceUnique(vk::DeviceCreateInfo({}, 1, &queueInfo, 0, nullptr, deviceExtensions.size(), deviceExtensions.data()));
+        queue = device->getQueue(queueFamily, 0);
+
+        allocator.emplace(physicalDevice, *device);
+        stagingRing.emplace(*device, *allocator);
+
+        for (auto &frame : frames) {
+            frame.commandPool = device->createCommandPoolUnique(vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eTransient, queueFamily));
+            frame.commandBuffer = std::move(device->allocateCommandBuffersUnique(vk::CommandBufferAllocateInfo(*frame.commandPool, vk::CommandBufferLevel::ePrimary, 1)).front());
+            frame.acquireSemaphore = device->createSemaphoreUnique({});
+            frame.presentSemaphore = device->createSemaphoreUnique({});
+        }
+
+        CreateSwapchain();
+
+        state.logger->Info("Presenting with Vulkan on {}", static_cast<const char *>(physicalDevice.getProperties().deviceName));
+    }
+
+    PresentationEngine::~PresentationEngine() {
+        if (device)
+            device->waitIdle();
+    }
+
+    void PresentationEngine::CreateSwapchain() {
+        device->waitIdle();
+
+        auto capabilities = physicalDevice.getSurfaceCapabilitiesKHR(*surface);
+        if (!(capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst))
+            throw exception("The surface doesn't support being the destination of transfers");
+
+        // RGBA8888 is preferred as it's what the guest framebuffers are in, any other format is converted into by the blit
+        auto formats = physicalDevice.getSurfaceFormatsKHR(*surface);
+        auto surfaceFormat = formats.front();
+        for (const auto &format : formats) {
+            if (format.format == vk::Format::eR8G8B8A8Unorm) {
+                surfaceFormat = format;
+                break;
+            }
+        }
+
+        auto presentMode = vk::PresentModeKHR::eFifo; // FIFO is the only present mode that is guaranteed to be supported
+        if (mailbox) {
+            auto presentModes = physicalDevice.getSurfacePresentModesKHR(*surface);
+            if (std::find(presentModes.begin(), presentModes.end(), vk::PresentModeKHR::eMailbox) != presentModes.end())
+                presentMode = vk::PresentModeKHR::eMailbox;
+        }
+
+        auto imageCount = std::max(capabilities.minImageCount + 1, 3U);
+        if (capabilities.maxImageCount)
+            imageCount = std::min(imageCount, capabilities.maxImageCount);
+
+        swapchainExtent = capabilities.currentExtent;
+        if (swapchainExtent.width == std::numeric_limits<u32>::max())
+            swapchainExtent = capabilities.minImageExtent;
+
+        auto compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eInherit;
+        for (auto alpha : {vk::CompositeAlphaFlagBitsKHR::eInherit, vk::CompositeAlphaFlagBitsKHR::eOpaque, vk::CompositeAlphaFlagBitsKHR::ePreMultiplied, vk::CompositeAlphaFlagBitsKHR::ePostMultiplied}) {
+            if (capabilities.supportedCompositeAlpha & alpha) {
+                compositeAlpha = alpha;
+                break;
+            }
+        }
+
+        vk::SwapchainCreateInfoKHR swapchainInfo({}, *surface, imageCount, surfaceFormat.format, surfaceFormat.colorSpace, swapchainExtent, 1, vk::ImageUsageFlagBits::eTransferDst, vk::SharingMode::eExclusive, 0, nullptr, capabilities.currentTransform, compositeAlpha, presentMode, true, *swapchain);
+        swapchain = device->createSwapchainKHRUnique(swapchainInfo);
+        swapchainImages = device->getSwapchainImagesKHR(*swapchain);
+        swapchainOutdated = false;
+    }
+
+    void PresentationEngine::PrepareResources(PresentationTexture &texture) {
+        if (!image || imageDimensions != texture.dimensions || imageFormat != texture.format.vkFormat) {
+            device->waitIdle();
+            image.reset();
+            imageAllocation.Reset();
+            image = device->createImageUnique(vk::ImageCreateInfo({}, vk::ImageType::e2D, texture.format.vkFormat, vk::Extent3D(texture.dimensions.width, texture.dimensions.height, 1), 1, 1, vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive, 0, nullptr, vk::ImageLayout::eUndefined));
+            imageAllocation = allocator->AllocateImage(*image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+            imageDimensions = texture.dimensions;
+            imageFormat = texture.format.vkFormat;
+        }
+    }
+
+    void PresentationEngine::UpdateWindow(ANativeWindow *window) {
+        device->waitIdle();
+        swapchain.reset();
+        surface = instance->createAndroidSurfaceKHRUnique(vk::AndroidSurfaceCreateInfoKHR({}, window));
+        if (!physicalDevice.getSurfaceSupportKHR(queueFamily, *surface))
+            throw exception("The Vulkan device cannot present to the new surface");
+        CreateSwapchain();
+    }
+
+    void PresentationEngine::Present(PresentationTexture &texture) {
+        if (swapchainOutdated)
+            CreateSwapchain();
+
+        // The resources of a frame are reused once the submission that last used them has completed, the ring recycles its staging region at the same time
+        auto &frame{frames[frameIndex]};
+        stagingRing->Wait(frame.serial);
+
+        PrepareResources(texture);
+        auto staging{stagingRing->Allocate(texture.backing.size())};
+        std::memcpy(staging.mapping.data(), texture.backing.data(), texture.backing.size());
+
+        u32 imageIndex;
+        try {
+            auto result = device->acquireNextImageKHR(*swapchain, std::numeric_limits<u64>::max(), *frame.acquireSemaphore, {});
+            if (result.result == vk::Result::eSuboptimalKHR)
+                swapchainOutdated = true;
+            imageIndex = result.value;
+        } catch (const vk::OutOfDateKHRError &) {
+            swapchainOutdated = true;
+            return; // The frame is dropped as the swapchain has to be recreated prior to presenting to it, its staging allocation is recycled alongside the next frame's
+        }
+        auto swapchainImage = swapchainImages.at(imageIndex);
+        auto &commandBuffer{frame.commandBuffer};
+        device->resetCommandPool(*frame.commandPool, {});
+
+        vk::ImageSubresourceRange subresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+        vk::ImageSubresourceLayers subresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+
+        commandBuffer->begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+        // The previous contents of both images are discarded as they are entirely overwritten
+        std::array<vk::ImageMemoryBarrier, 2> preCopyBarriers{
+            vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *image, subresourceRange),
+            vk::ImageMemoryBarrier({}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, swapchainImage, subresourceRange),
+        };
+        commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, preCopyBarriers);
+
+        commandBuffer->copyBufferToImage(staging.buffer, *image, vk::ImageLayout::eTransferDstOptimal, vk::BufferImageCopy(staging.offset, 0, 0, subresourceLayers, {}, vk::Extent3D(texture.dimensions.width, texture.dimensions.height, 1)));
+
+        commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, vk::ImageMemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *image, subresourceRange));
+
+        std::array<vk::Offset3D, 2> srcOffsets{vk::Offset3D{}, vk::Offset3D(static_cast<i32>(texture.dimensions.width), static_cast<i32>(texture.dimensions.height), 1)};
+        std::array<vk::Offset3D, 2> dstOffsets{vk::Offset3D{}, vk::Offset3D(static_cast<i32>(swapchainExtent.width), static_cast<i32>(swapchainExtent.height), 1)};
+        auto blitFilter = (filter == UpscalingFilter::Bilinear) ? vk::Filter::eLinear : vk::Filter::eNearest;
+
+        if (filter == UpscalingFilter::Integer) {
+            auto scale = std::min(swapchainExtent.width / texture.dimensions.width, swapchainExtent.height / texture.dimensions.height);
+            if (scale) {
+                auto width = texture.dimensions.width * scale, height = texture.dimensions.height * scale;
+                if (width != swapchainExtent.width || height != swapchainExtent.height) {
+                    // The borders around the frame are cleared to black as they aren't written to by the blit
+                    commandBuffer->clearColorImage(swapchainImage, vk::ImageLayout::eTransferDstOptimal, vk::ClearColorValue(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f}), subresourceRange);
+                    commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferWrite), nullptr, nullptr);
+                }
+
+                auto x = static_cast<i32>((swapchainExtent.width - width) / 2), y = static_cast<i32>((swapchainExtent.height - height) / 2);
+                dstOffsets = {vk::Offset3D(x, y, 0), vk::Offset3D(x + static_cast<i32>(width), y + static_cast<i32>(height), 1)};
+            } else {
+                blitFilter = vk::Filter::eLinear; // A window that's smaller than the frame can't be integer scaled into so the frame is downscaled to fill it
+            }
+        }
+
+        commandBuffer->blitImage(*image, vk::ImageLayout::eTransferSrcOptimal, swapchainImage, vk::ImageLayout::eTransferDstOptimal, vk::ImageBlit(subresourceLayers, srcOffsets, subresourceLayers, dstOffsets), blitFilter);
+
+        commandBuffer->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr, vk::ImageMemoryBarrier(vk::AccessFlagBits::eTransferWrite, {}, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::ePresentSrcKHR, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, swapchainImage, subresourceRange));
+
+        commandBuffer->end();
+
+        auto submission{stagingRing->Submit()};
+        vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eTransfer;
+        queue.submit(vk::SubmitInfo(1, &*frame.acquireSemaphore, &waitStage, 1, &*commandBuffer, 1, &*frame.presentSemaphore), submission.fence);
+        frame.serial = submission.serial;
+        frameIndex = (frameIndex + 1) % frames.size();
+
+        try {
+            if (queue.presentKHR(vk::PresentInfoKHR(1, &*frame.presentSemaphore, 1, &*swapchain, &imageIndex)) == vk::Result::eSuboptimalKHR)
+                swapchainOutdated = true;
+        } catch (const vk::OutOfDateKHRError &) {
+            swapchainOutdated = true;
+        }
+    }
+
+    bool PresentationEngine::IsFormatSupported(vk::Format format) {
+        return static_cast<bool>(physicalDevice.getFormatProperties(format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+    }
+}
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <android/native_window.h>
+#include <common.h>
+#include "texture.h"
+#include "staging_ring.h"
+
+namespace skyline::constant {
+    constexpr size_t FramesInFlight{2}; //!< The amount of frames that can be presenting at once, a frame's upload and blit can overlap with the copy of the next frame into the staging ring
+}
+
+namespace skyline::gpu {
+    /**
+     * @brief The filter used to scale frames from the guest resolution to the resolution of the window
+     */
+    enum class UpscalingFilter : u32 {
+        Bilinear = 0, //!< The frame is stretched over the entire window with linear filtering
+        Nearest = 1, //!< The frame is stretched over the entire window with nearest neighbour filtering
+        Integer = 2, //!< The frame is scaled by the largest integer factor that fits the window and centered in it, this keeps every guest pixel the same size
+    };
+
+    /**
+     * @brief The PresentationEngine class presents PresentationTextures to an ANativeWindow using a Vulkan swapchain
+     * @note Textures are uploaded through a staging ring and copied into an image which is blitted onto the swapchain image, this offloads the conversion and scaling to the host GPU
+     * @note The swapchain is always at the native resolution of the window so the compositor never has to scale it, rendering stays at the guest resolution
+     */
+    class PresentationEngine {
+      private:
+        const DeviceState &state; //!< The state of the device
+        bool mailbox; //!< If the mailbox present mode should be used when it's available rather than FIFO
+        UpscalingFilter filter; //!< The filter used to scale frames to the swapchain extent
+
+        vk::UniqueInstance instance;
+        vk::PhysicalDevice physicalDevice;
+        u32 queueFamily{}; //!< The index of the queue family used for transfers and presentation
+        vk::UniqueDevice device;
+        vk::Queue queue;
+        std::optional<memory::MemoryAllocator> allocator; //!< The allocator of all device memory, this is declared after the device so it's destroyed prior to it
+        std::optional<memory::StagingRing> stagingRing; //!< The ring that the contents of textures are uploaded through
+
+        /**
+         * @brief The resources used to present a single frame, they're reused once the submission of the frame that last used them has completed
+         */
+        struct Frame {
+            vk::UniqueCommandPool commandPool; //!< A transient pool that only the frame's command buffer is allocated from, it's reset in bulk rather than resetting the command buffer on its own
+            vk::UniqueCommandBuffer commandBuffer;
+            vk::UniqueSemaphore acquireSemaphore; //!< This is signalled when the acquired swapchain image is ready to be written to
+            vk::UniqueSemaphore presentSemaphore; //!< This is signalled when the swapchain image is ready to be presented
+            u64 serial{}; //!< The serial of the staging ring submission that last used the frame
+        };
+        std::array<Frame, constant::FramesInFlight> frames;
+        size_t frameIndex{}; //!< The index of the frame in frames that the next texture is presented with
+
+        vk::UniqueSurfaceKHR surface;
+        vk::UniqueSwapchainKHR swapchain;
+        vk::Extent2D swapchainExtent;
+        std::vector<vk::Image> swapchainImages;
+        bool swapchainOutdated{}; //!< If the swapchain needs to be recreated prior to the next presentation
+
+        vk::UniqueImage image; //!< The image which holds the last presented texture, it's the source of the blit onto the swapchain
+        memory::Allocation imageAllocation;
+        texture::Dimensions imageDimensions; //!< The dimensions of the image
+        vk::Format imageFormat{}; //!< The format of the image
+
+        /**
+         * @brief This (re)creates the swapchain for the current surface
+         */
+        void CreateSwapchain();
+
+        /**
+         * @brief This (re)creates the image if it doesn't fit the supplied texture
+         */
+        void PrepareResources(PresentationTexture &texture);
+
+      public:
+        /**
+         * @param window The ANativeWindow to present to
+         */
+        PresentationEngine(const DeviceState &state, ANativeWindow *window);
+
+        ~PresentationEngine();
+
+        /**
+         * @brief This recreates the surface and swapchain for a new ANativeWindow
+         */
+        void UpdateWindow(ANativeWindow *window);
+
+        /**
+         * @brief This presents a texture onto the window, it is scaled to the window with the configured UpscalingFilter
+         * @note The texture may be released as soon as this returns as its contents are copied into the staging ring
+         */
+        void Present(PresentationTexture &texture);
+
+        /**
+         * @return If the host GPU can sample optimally tiled images of the supplied format
+         */
+        bool IsFormatSupported(vk::Format format);
+    };
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "presentation_queue.h"
+
+namespace skyline::gpu {
+    PresentationQueue::PresentationQueue(size_t depth, bool latestFrameWins) : depth(std::clamp<size_t>(depth, 1, constant::PresentationQueueCapacity)), latestFrameWins(latestFrameWins) {
+        for (size_t index = 0; index < slots.size(); index++)
+            slots[index].sequence.store(index, std::memory_order_relaxed);
+    }
+
+    bool PresentationQueue::Push(const PresentationFrame &frame) {
+        auto position{end.load(std::memory_order_relaxed)};
+        while (true) {
+            auto head{start.load(std::memory_order_acquire)};
+            if (position >= head && position - head >= depth)
+                return false;
+
+            auto &slot{slots[position % slots.size()]};
+            auto sequence{slot.sequence.load(std::memory_order_acquire)};
+            if (sequence == position) {
+                // The slot is claimed by advancing the end, another producer may have claimed it first in which case it's retried with the updated position
+                if (end.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.frame = frame;
+                    slot.sequence.store(position + 1, std::memory_order_release); // This publishes the frame to the consumer
+                    return true;
+                }
+            } else if (sequence < position) {
+                return false; // The slot still holds a frame from the previous lap that hasn't been consumed yet
+            } else {
+                position = end.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void PresentationQueue::PushWait(const PresentationFrame &frame) {
+        if (Push(frame))
+            return;
+
+        // The waiter count is published prior to retrying the push, so either the retry sees the slot the consumer frees or the consumer sees the waiter
+        std::unique_lock lock(pushMutex);
+        pushWaiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        pushCondition.wait(lock, [&] { return Push(frame); });
+        pushWaiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void PresentationQueue::NotifyProducers() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (pushWaiters.load(std::memory_order_relaxed)) {
+            std::lock_guard lock(pushMutex);
+            pushCondition.notify_all();
+        }
+    }
+
+    bool PresentationQueue::Pop(PresentationFrame &frame) {
+        bool popped{};
+        auto position{start.load(std::memory_order_relaxed)};
+        while (true) {
+            auto &slot{slots[position % slots.size()]};
+            auto sequence{slot.sequence.load(std::memory_order_acquire)};
+            if (sequence == position + 1) {
+                if (start.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    // A frame that has been superseded is released without being presented, its buffer can be reused by the guest immediately
+                    if (popped && frame.texture->releaseCallback)
+                        frame.texture->releaseCallback();
+
+                    frame = std::move(slot.frame);
+                    slot.sequence.store(position + slots.size(), std::memory_order_release); // This hands the slot back to the producers
+                    popped = true;
+
+                    if (!latestFrameWins) {
+                        NotifyProducers();
+                        return true;
+                    }
+                    position++;
+                }
+            } else if (sequence < position + 1) {
+                if (popped)
+                    NotifyProducers();
+                return popped; // The queue is empty
+            } else {
+                position = start.load(std::memory_order_relaxed);
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <services/common/fence.h>
+#include "texture.h"
+
+namespace skyline {
+    namespace constant {
+        constexpr size_t PresentationQueueCapacity = 8; //!< The maximum amount of frames that can be queued for presentation, the depth of the queue can be configured up to this
+    }
+
+    namespace gpu {
+        /**
+         * @brief This holds a single frame that has been queued for presentation
+         */
+        struct PresentationFrame {
+            std::shared_ptr<PresentationTexture> texture; //!< The texture which holds the contents of the frame
+            u32 swapInterval; //!< The amount of display refreshes this frame should be presented for
+            std::array<service::nvdrv::Fence, 4> fences; //!< The fences that need to be reached before the contents of the frame can be presented
+        };
+
+        /**
+         * @brief A fixed-capacity lock-free queue of frames which are handed off from the GraphicBufferProducer to the presentation thread
+         * @note This is a bounded multi-producer multi-consumer ring where each slot has a sequence number that's used to hand it off between the producers and consumers
+         */
+        class PresentationQueue {
+          private:
+            /**
+             * @brief A single slot in the ring
+             */
+            struct Slot {
+                std::atomic<size_t> sequence; //!< The position in the queue this slot can be written to at when it's equal, it can be read from when it's one above its position
+                PresentationFrame frame;
+            };
+
+            std::array<Slot, constant::PresentationQueueCapacity> slots;
+            alignas(64) std::atomic<size_t> start{}; //!< The position of the oldest frame in the queue
+            alignas(64) std::atomic<size_t> end{}; //!< The position after the newest frame in the queue
+            size_t depth; //!< The amount of frames that can be in the queue at once
+            std::atomic<u32> pushWaiters{}; //!< The amount of producers waiting on a slot to be freed, the consumer only signals them if this is non-zero
+            std::mutex pushMutex; //!< This is held by producers while they check for a free slot, so the consumer can't free one and signal them in between the check and the wait
+            std::condition_variable pushCondition; //!< This is signalled by the consumer after popping a frame while producers are waiting on a slot
+
+            /**
+             * @brief Wakes up any producers that are waiting for a slot to be freed up
+             */
+            void NotifyProducers();
+
+          public:
+            const bool latestFrameWins; //!< If only the newest frame in the queue should be presented, any older frames are released without being presented
+
+            /**
+             * @param depth The amount of frames that can be in the queue at once, this is clamped to PresentationQueueCapacity
+             * @param latestFrameWins If only the newest frame in the queue should be presented
+             */
+            PresentationQueue(size_t depth, bool latestFrameWins);
+
+            /**
+             * @brief Inserts a frame at the end of the queue
+             * @return If the frame was inserted, this will be false if the queue is full
+             */
+            bool Push(const PresentationFrame &frame);
+
+            /**
+             * @brief Inserts a frame at the end of the queue, this blocks till the consumer frees up a slot if the queue is full
+             */
+            void PushWait(const PresentationFrame &frame);
+
+            /**
+             * @brief Removes the next frame that should be presented from the queue
+             * @param frame The object the frame is written into
+             * @return If a frame was popped, this will be false if the queue is empty
+             * @note If latestFrameWins is set, all frames except the newest one are released
+             */
+            bool Pop(PresentationFrame &frame);
+
+            /**
+             * @return If the queue currently has no frames in it
+             */
+            inline bool Empty() const {
+                return start.load(std::memory_order_acquire) == end.load(std::memory_order_acquire);
+            }
+        };
+    }
+}
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <cmath>
+#include <android/choreographer.h>
+#include "presentation_scheduler.h"
+
+extern skyline::u16 fps;
+extern skyline::u32 frametime;
+extern skyline::u32 frametimeDeviation;
+extern skyline::u16 speed;
+
+namespace skyline::gpu {
+    /**
+     * @brief Moves a deadline forward by a period, a deadline that has been missed by an entire period is moved forward from the current time rather than being caught up on as catching up would signal the guest in a burst
+     */
+    static void AdvanceDeadline(u64 &deadline, u64 period, u64 now) {
+        deadline = (now - deadline >= period) ? now + period : deadline + period;
+    }
+
+    PresentationScheduler::PresentationScheduler(std::shared_ptr<kernel::type::KEvent> vsyncEvent, u32 speedLimit, bool frameSkip)
+        : vsyncEvent(std::move(vsyncEvent)), guestVsyncPeriod(speedLimit == 100 ? 0 : (speedLimit ? constant::GuestVsyncPeriod * 100 / speedLimit : constant::UnlimitedVsyncPeriod)), frameSkip(frameSkip), speedTimestamp(util::GetTimeNs()), thread(&PresentationScheduler::Run, this) {}
+
+    PresentationScheduler::~PresentationScheduler() {
+        exit = true;
+        if (auto threadLooper = looper.load())
+            ALooper_wake(threadLooper);
+        thread.join();
+        if (auto threadLooper = looper.load())
+            ALooper_release(threadLooper);
+    }
+
+    void PresentationScheduler::FrameCallback(long frameTimeNanos, void *data) {
+        auto scheduler = reinterpret_cast<PresentationScheduler *>(data);
+        scheduler->OnVsync();
+        if (!scheduler->exit)
+            AChoreographer_postFrameCallback(AChoreographer_getInstance(), FrameCallback, data);
+    }
+
+    void PresentationScheduler::OnVsync() {
+        auto now{util::GetTimeNs()};
+        if (!guestVsyncPeriod) {
+            // Refreshes that occur before the next 60Hz deadline are skipped, this is what limits the guest to 60Hz on displays with a higher refresh rate
+            if (now + constant::VsyncTolerance < nextTiedVsync)
+                return;
+            AdvanceDeadline(nextTiedVsync, constant::GuestVsyncPeriod, now);
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            vsyncCount++;
+        }
+        vsyncConditional.notify_all();
+        if (!guestVsyncPeriod)
+            SignalGuestVsync(now);
+    }
+
+    void PresentationScheduler::SignalGuestVsync(u64 now) {
+        vsyncEvent->Signal();
+
+        // The speed is the rate at which the guest progresses through frames relative to it presenting every frame at 60Hz
+        auto elapsed = now - speedTimestamp;
+        if (elapsed >= constant::SpeedSampleInterval) {
+            auto intervals = queuedIntervals.exchange(0, std::memory_order_relaxed);
+            speed = static_cast<u16>(std::min<u64>(intervals * constant::GuestVsyncPeriod * 100 / elapsed, std::numeric_limits<u16>::max()));
+            speedTimestamp = now;
+        }
+    }
+
+    void PresentationScheduler::Run() {
+        // Choreographer callbacks are delivered on the looper of the thread that its instance was retrieved on
+        auto threadLooper = ALooper_prepare(0);
+        ALooper_acquire(threadLooper);
+        looper = threadLooper;
+
+        auto choreographer = AChoreographer_getInstance();
+        if (choreographer)
+            AChoreographer_postFrameCallback(choreographer, FrameCallback, this);
+
+        auto now = util::GetTimeNs();
+        u64 nextDisplayVsync = now + constant::FallbackRefreshPeriod, nextGuestVsync = now + guestVsyncPeriod;
+        while (!exit) {
+            now = util::GetTimeNs();
+            if (!choreographer && now >= nextDisplayVsync) {
+                OnVsync();
+                AdvanceDeadline(nextDisplayVsync, constant::FallbackRefreshPeriod, now);
+            }
+
+            if (guestVsyncPeriod && now >= nextGuestVsync) {
+                SignalGuestVsync(now);
+                AdvanceDeadline(nextGuestVsync, guestVsyncPeriod, now);
+            }
+
+            auto deadline = guestVsyncPeriod ? nextGuestVsync : std::numeric_limits<u64>::max();
+            if (choreographer) {
+                // Choreographer callbacks are delivered while the looper is polled, the timeout is rounded up as the looper only has millisecond granularity
+                constexpr u64 NsInMillisecond{1000000};
+                auto timeout = (deadline == std::numeric_limits<u64>::max()) ? -1 : static_cast<int>((deadline - now + NsInMillisecond - 1) / NsInMillisecond);
+                ALooper_pollOnce(timeout, nullptr, nullptr, nullptr);
+            } else {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(std::min(deadline, nextDisplayVsync) - now));
+            }
+        }
+    }
+
+    bool PresentationScheduler::WaitForPresent(u32 swapInterval, bool newerFrameQueued) {
+        if (!swapInterval)
+            return true;
+
+        std::unique_lock lock(mutex);
+
+        // The swap interval is in terms of the guest's vsync when it isn't tied to the display refresh, frames are presented as soon as possible and only the newest is presented
+        if (guestVsyncPeriod) {
+            if (newerFrameQueued)
+                return false;
+            lastPresentVsync = vsyncCount;
+            return true;
+        }
+
+        auto targetVsync = lastPresentVsync + swapInterval;
+
+        // A frame that's late by an entire swap interval would only delay the newer frame further if it was presented
+        if (newerFrameQueued && vsyncCount >= targetVsync + swapInterval)
+            return false;
+
+        // The wait is bounded so that presentation continues if Choreographer stops delivering callbacks, such as when the activity is paused
+        vsyncConditional.wait_for(lock, std::chrono::nanoseconds(constant::GuestVsyncPeriod * (swapInterval + 1)), [&] {
+            return vsyncCount >= targetVsync;
+        });
+
+        lastPresentVsync = vsyncCount;
+        return true;
+    }
+
+    bool PresentationScheduler::ShouldSkip(bool newerFrameQueued) {
+        if (!(frameSkip || thermalFrameSkip) || !newerFrameQueued || consecutiveSkips >= constant::MaxConsecutiveFrameSkips) {
+            consecutiveSkips = 0;
+            return false;
+        }
+
+        consecutiveSkips++;
+        return true;
+    }
+
+    u64 PresentationScheduler::OnPresent() {
+        auto now = util::GetTimeNs();
+        auto frameTime = lastPresentTimestamp ? now - lastPresentTimestamp : 0;
+
+        if (lastPresentTimestamp) {
+            frameTimes[frameTimeIndex] = frameTime;
+            frameTimeIndex = (frameTimeIndex + 1) % constant::FrameTimeSamples;
+            frameTimeCount = std::min(frameTimeCount + 1, constant::FrameTimeSamples);
+
+            u64 sum{};
+            for (size_t index = 0; index < frameTimeCount; index++)
+                sum += frameTimes[index];
+            auto mean = static_cast<double>(sum) / frameTimeCount;
+
+            double variance{};
+            for (size_t index = 0; index < frameTimeCount; index++)
+                variance += std::pow(static_cast<double>(frameTimes[index]) - mean, 2);
+            variance /= frameTimeCount;
+
+            // frametime / 100 is the real ms value, this is to retain the first two decimals and the same goes for the deviation
+            frametime = static_cast<u32>(mean / 10000);
+            frametimeDeviation = static_cast<u32>(std::sqrt(variance) / 10000);
+            fps = static_cast<u16>(constant::NsInSecond / mean);
+        }
+
+        lastPresentTimestamp = now;
+        return frameTime;
+    }
+}
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <thread>
+#include <android/looper.h>
+#include <kernel/types/KEvent.h>
+
+namespace skyline {
+    namespace constant {
+        constexpr u64 FallbackRefreshPeriod = NsInSecond / 60; //!< The period of the display refresh in nanoseconds, this is used when Choreographer isn't available or has stopped delivering callbacks
+        constexpr u64 GuestVsyncPeriod = NsInSecond / 60; //!< The period of the vsync of the guest's display in nanoseconds, the guest is never signalled faster than this regardless of the refresh rate of the host display
+        constexpr u64 VsyncTolerance = GuestVsyncPeriod / 4; //!< The amount of time a display refresh can precede a guest vsync deadline by and still signal it, this absorbs jitter in the timing of Choreographer callbacks
+        constexpr size_t FrameTimeSamples = 60; //!< The amount of frame-times that are kept to calculate the average and deviation of
+        constexpr u64 UnlimitedVsyncPeriod = NsInSecond / 1000; //!< The period at which the vsync event is signalled when the speed isn't limited, this is short enough to never hold the guest back while not spinning the vsync thread
+        constexpr u32 MaxConsecutiveFrameSkips = 3; //!< The maximum amount of frames that are skipped in a row, this ensures the display is still updated while presentation is behind
+        constexpr u64 SpeedSampleInterval = NsInSecond; //!< The interval at which the effective speed of the guest is recalculated in nanoseconds
+    }
+
+    namespace gpu {
+        /**
+         * @brief The PresentationScheduler class paces presentation to the display refresh using Choreographer frame callbacks
+         * @note The vsync event is signalled on display refreshes rather than at whatever rate frames are presented at, unless a speed limit other than 100% is used in which case it's signalled on a timer running at a multiple of 60Hz
+         * @note Displays that refresh faster than 60Hz (Such as 90Hz or 120Hz panels) only signal the guest on the first refresh at or after every 60Hz deadline, swap intervals are counted in these guest vsyncs so titles still run and present at 60Hz
+         */
+        class PresentationScheduler {
+          private:
+            std::shared_ptr<kernel::type::KEvent> vsyncEvent; //!< This KEvent is triggered on every display refresh
+            u64 guestVsyncPeriod; //!< The period at which the vsync event is signalled in nanoseconds, this is 0 if it's signalled on every display refresh
+            bool frameSkip; //!< If frames should be skipped without being deswizzled or presented when presentation is behind
+            bool thermalFrameSkip{}; //!< If frames should be skipped when presentation is behind regardless of frameSkip, this is set while the device is about to throttle
+            u32 consecutiveSkips{}; //!< The amount of frames that have been skipped since the last presented frame
+            std::atomic<bool> exit{false}; //!< If the vsync thread should exit
+            std::atomic<ALooper *> looper{}; //!< The looper of the vsync thread, it's used to wake the thread up on exit
+
+            std::mutex mutex; //!< This mutex guards the vsync counter
+            std::condition_variable vsyncConditional; //!< This is notified on every guest vsync that's tied to a display refresh
+            u64 vsyncCount{}; //!< The amount of guest vsyncs that have occurred on display refreshes
+            u64 nextTiedVsync{}; //!< The time at which the guest vsync is due on the next display refresh, this is only used by the vsync thread
+            u64 lastPresentVsync{}; //!< The value of vsyncCount when the last frame was presented
+
+            u64 lastPresentTimestamp{}; //!< The timestamp of the last presentation in nanoseconds
+            std::array<u64, constant::FrameTimeSamples> frameTimes{}; //!< A circular buffer of the most recent frame-times in nanoseconds
+            size_t frameTimeIndex{}; //!< The index in frameTimes that the next frame-time is written to
+            size_t frameTimeCount{}; //!< The amount of valid entries in frameTimes
+
+            std::atomic<u64> queuedIntervals{}; //!< The sum of the swap intervals of all frames queued since the speed was last calculated
+            u64 speedTimestamp{}; //!< The timestamp at which the speed was last calculated in nanoseconds
+
+            std::thread thread; //!< The thread which receives Choreographer callbacks, this is declared last so that it's joined prior to the state it uses being destroyed
+
+            /**
+             * @brief This is called by Choreographer on every display refresh
+             */
+            static void FrameCallback(long frameTimeNanos, void *data);
+
+            /**
+             * @brief This is called on every display refresh, it wakes up anything waiting on it if a guest vsync is due
+             */
+            void OnVsync();
+
+            /**
+             * @brief Signals the vsync event and updates the effective speed of the guest if it's due
+             * @param now The current time in nanoseconds
+             */
+            void SignalGuestVsync(u64 now);
+
+            /**
+             * @brief The entry point of the vsync thread
+             */
+            void Run();
+
+          public:
+            /**
+             * @param speedLimit The speed the guest is limited to as a percentage, the guest is only limited by how fast it can run if this is 0
+             * @param frameSkip If frames should be skipped when presentation is behind
+             */
+            PresentationScheduler(std::shared_ptr<kernel::type::KEvent> vsyncEvent, u32 speedLimit, bool frameSkip);
+
+            ~PresentationScheduler();
+
+            /**
+             * @brief Blocks till the display refresh a frame with the supplied swap interval should be presented on
+             * @param swapInterval The amount of refreshes between presented frames, a frame with a swap interval of 0 is presented immediately
+             * @param newerFrameQueued If there's a frame queued after this one which could replace it
+             * @return If the frame should be presented, this will be false if the frame is late enough that it should be dropped in favour of the newer frame
+             */
+            bool WaitForPresent(u32 swapInterval, bool newerFrameQueued);
+
+            /**
+             * @brief Decides if a frame should be skipped entirely, this is done prior to it being deswizzled so skipping a frame saves all presentation work for it
+             * @param newerFrameQueued If there's a frame queued after this one, presentation is considered to be behind if there is
+             * @return If the frame should be released without being presented
+             * @note This must only be called from the presentation thread
+             */
+            bool ShouldSkip(bool newerFrameQueued);
+
+            /**
+             * @brief Enables or disables frame skipping in addition to what it was configured with, this is used to shed presentation work while the device is about to throttle
+             * @note This must only be called from the presentation thread
+             */
+            void SetThermalFrameSkip(bool enable) {
+                thermalFrameSkip = enable;
+            }
+
+            /**
+             * @brief This should be called whenever the guest queues a frame, it's used to calculate the effective speed of the guest
+             * @param swapInterval The swap interval of the queued frame
+             */
+            inline void OnQueue(u32 swapInterval) {
+                queuedIntervals.fetch_add(std::max<u32>(swapInterval, 1), std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief This should be called after a frame has been presented, it updates the frame-time statistics
+             * @return The time since the previous frame was presented in nanoseconds, this is 0 for the first frame
+             */
+            u64 OnPresent();
+        };
+    }
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include "query_manager.h"
+
+namespace skyline::gpu {
+    QueryManager::QueryManager(const DeviceState &state) : state(state) {}
+
+    u64 QueryManager::GetTimestamp() {
+        // Convert the current nanosecond time to GPU ticks
+        constexpr u64 NsToTickNumerator{384};
+        constexpr u64 NsToTickDenominator{625};
+
+        u64 nsTime{util::GetTimeNs()};
+        return (nsTime / NsToTickDenominator) * NsToTickNumerator + ((nsTime % NsToTickDenominator) * NsToTickNumerator) / NsToTickDenominator;
+    }
+
+    void QueryManager::Report(u64 address, u64 value, bool fourWords) {
+        pending.push_back(PendingReport{address, value, fourWords ? GetTimestamp() : 0, fourWords});
+    }
+
+    u64 QueryManager::Read(u64 address) {
+        state.gpu->memoryManager.SynchronizeAccess(address, sizeof(u64), false);
+
+        // The latest report to the address is the one that determines its value, reports to other addresses don't overlap it as the guest aligns them
+        for (auto report{pending.rbegin()}; report != pending.rend(); report++) {
+            if (report->address == address) {
+                if (report->fourWords)
+                    return report->value;
+
+                // A single word report only replaces the lower half of the value
+                return (state.gpu->memoryManager.Read<u64>(address) & 0xFFFFFFFF00000000) | static_cast<u32>(report->value);
+            }
+        }
+
+        return state.gpu->memoryManager.Read<u64>(address);
+    }
+
+    void QueryManager::Flush() {
+        struct FourWordResult {
+            u64 value;
+            u64 timestamp;
+        };
+
+        auto &memoryManager{state.gpu->memoryManager};
+        for (const auto &report : pending) {
+            if (report.fourWords)
+                memoryManager.Write<FourWordResult>(FourWordResult{report.value, report.timestamp}, report.address);
+            else
+                memoryManager.Write<u32>(static_cast<u32>(report.value), report.address);
+        }
+        pending.clear();
+    }
+}
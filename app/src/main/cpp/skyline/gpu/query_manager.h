@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::gpu {
+    /**
+     * @brief The QueryManager class holds the host-side counters that the guest queries and defers writing query and semaphore reports into guest memory until a fence is signalled
+     * @note Writing every report as it's made would require all prior work to be complete at that point, the guest can only observe reports after waiting on a fence so they're batched up till then
+     * @note This is only accessed from the GPFIFO thread so it isn't synchronized
+     */
+    class QueryManager {
+      public:
+        /**
+         * @brief The counters which are tracked on the host
+         */
+        enum class Counter : u8 {
+            SamplesPassed, //!< The amount of samples that passed the depth and stencil tests
+            InputVertices, //!< The amount of vertices that were fetched by draws
+            InputPrimitives, //!< The amount of primitives that were assembled from the vertices of draws
+            PrimitivesGenerated, //!< The amount of primitives that were generated after any geometry or tessellation stages
+            Count,
+        };
+
+      private:
+        /**
+         * @brief A single report that hasn't been written into guest memory yet
+         */
+        struct PendingReport {
+            u64 address; //!< The GPU address that the report is written to
+            u64 value;
+            u64 timestamp; //!< The GPU timestamp at the time the report was made
+            bool fourWords; //!< If the report is written as a 16-byte structure with the timestamp rather than as a single word
+        };
+
+        const DeviceState &state;
+        std::vector<PendingReport> pending; //!< The reports that have yet to be written in the order they were made
+        std::array<u64, static_cast<size_t>(Counter::Count)> counters{};
+
+      public:
+        QueryManager(const DeviceState &state);
+
+        /**
+         * @return The current GPU timestamp, this is the time since boot in GPU ticks
+         */
+        static u64 GetTimestamp();
+
+        /**
+         * @brief Adds to the value of a counter
+         */
+        void Accumulate(Counter counter, u64 value) {
+            counters[static_cast<size_t>(counter)] += value;
+        }
+
+        void ResetCounter(Counter counter) {
+            counters[static_cast<size_t>(counter)] = 0;
+        }
+
+        u64 GetCounter(Counter counter) const {
+            return counters[static_cast<size_t>(counter)];
+        }
+
+        /**
+         * @brief Makes a report of a value to guest memory with the current timestamp, it's written at the next flush
+         * @param fourWords If the report is a 16-byte structure of the 64-bit value and a 64-bit timestamp, otherwise only the lower 32 bits of the value are written
+         */
+        void Report(u64 address, u64 value, bool fourWords);
+
+        /**
+         * @return The 64-bit value at a GPU address as it would be after all pending reports are written, this avoids a flush when the GPU itself consumes a report
+         */
+        u64 Read(u64 address);
+
+        /**
+         * @brief Writes all pending reports into guest memory, this must be done before any fence is signalled
+         */
+        void Flush();
+    };
+}
@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/stat.h>
+#include <gpu.h>
+#include <vfs/os_filesystem.h>
+#include "shader_cache.h"
+
+namespace skyline::gpu {
+    constexpr auto ShaderFileName{"shaders"}; //!< The name of the file in the disk cache of a title which holds its shaders
+    constexpr auto PipelineCacheFileName{"pipeline_cache"}; //!< The name of the file in the disk cache of a title which holds its Vulkan pipeline cache
+
+    ShaderCache::Shader::Shader(shader::Stage stage, u64 hash, std::vector<u64> code) : stage(stage), hash(hash), code(std::move(code)) {}
+
+    bool ShaderCache::Shader::Matches(const DeviceState &state, u64 address) const {
+        auto span{state.gpu->memoryManager.GetHostSpan<u64>(address, code.size())};
+        if (span.size() == code.size())
+            return std::memcmp(span.data(), code.data(), code.size() * sizeof(u64)) == 0;
+
+        std::vector<u64> current(code.size());
+        state.gpu->memoryManager.Read<u64>(current, address);
+        return current == code;
+    }
+
+    ShaderCache::ShaderCache(const DeviceState &state) : state(state), registration("Shader Cache", cache::Priority::High, [this] { return GetCacheSize(); }, [this](size_t target) { return Evict(target); }) {}
+
+    ShaderCache::~ShaderCache() {
+        {
+            std::lock_guard lock(mutex);
+            exit = true;
+        }
+        queueConditional.notify_all();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    void ShaderCache::WorkerThread() {
+        while (true) {
+            std::shared_ptr<Shader> shader;
+            {
+                std::unique_lock lock(mutex);
+                queueConditional.wait(lock, [this] { return exit || !queue.empty(); });
+                if (exit)
+                    return;
+                shader = std::move(queue.front());
+                queue.pop();
+            }
+
+            try {
+                shader->spirv = shader::Compile(shader->stage, shader->code);
+            } catch (const std::exception &e) {
+                shader->status.store(Shader::Status::Failed, std::memory_order_release);
+                state.logger->Warn("Failed to translate shader 0x{:016X} (Stage {}): {}", shader->hash, static_cast<u8>(shader->stage), e.what());
+                continue;
+            }
+            shader->status.store(Shader::Status::Ready, std::memory_order_release);
+
+            std::lock_guard lock(mutex);
+            if (!path.empty() && !shaderFileFailed) {
+                try {
+                    WriteShader(*shader);
+                } catch (const std::exception &e) {
+                    state.logger->Warn("Failed to write to the shader cache, it won't be written to for the rest of this run: {}", e.what());
+                    shaderFile.reset();
+                    shaderFileFailed = true;
+                }
+            }
+        }
+    }
+
+    void ShaderCache::Insert(std::shared_ptr<Shader> shader) {
+        auto &stageShaders{shaders[static_cast<size_t>(shader->stage)]};
+        if (shader->status.load(std::memory_order_relaxed) == Shader::Status::Pending) {
+            // A shader the compiler can't translate fails right away, so the worker threads aren't started for programs that would only be rejected
+            if (!shader::IsStageSupported(shader->stage)) {
+                shader->status.store(Shader::Status::Failed, std::memory_order_release);
+            } else {
+                if (threads.empty()) {
+                    // Translation competes with the emulated CPU cores for host cores, so it's limited to a couple of threads
+                    constexpr size_t MaxThreadCount{2};
+                    auto threadCount{std::min<size_t>(std::max(std::thread::hardware_concurrency() / 2, 1U), MaxThreadCount)};
+                    for (size_t thread{}; thread < threadCount; thread++)
+                        threads.emplace_back(&ShaderCache::WorkerThread, this);
+                }
+
+                queue.push(shader);
+                queueConditional.notify_one();
+            }
+        }
+        stageShaders.insert_or_assign(shader->hash, std::move(shader));
+    }
+
+    size_t ShaderCache::GetCacheSize() {
+        std::lock_guard lock(mutex);
+        size_t size{};
+        for (const auto &stageShaders : shaders)
+            for (const auto &[hash, shader] : stageShaders)
+                if (shader->status.load(std::memory_order_acquire) != Shader::Status::Pending) // The SPIR-V of pending shaders is being written to by the worker threads
+                    size += (shader->code.size() * sizeof(u64)) + (shader->spirv.size() * sizeof(u32));
+        return size;
+    }
+
+    size_t ShaderCache::Evict(size_t target) {
+        std::lock_guard lock(mutex);
+        size_t freed{};
+        for (auto &stageShaders : shaders) {
+            for (auto it{stageShaders.begin()}; it != stageShaders.end() && freed < target;) {
+                // Pending shaders are referenced by the queue and shaders in use by pipelines are referenced by them, neither can be evicted
+                auto &shader{it->second};
+                if (shader.use_count() == 1 && shader->status.load(std::memory_order_acquire) != Shader::Status::Pending) {
+                    freed += (shader->code.size() * sizeof(u64)) + (shader->spirv.size() * sizeof(u32));
+                    it = stageShaders.erase(it);
+                } else {
+                    it++;
+                }
+            }
+        }
+        return freed;
+    }
+
+    void ShaderCache::WriteShader(const Shader &shader) {
+        if (!shaderFile) {
+            vfs::OsFileSystem directory(path);
+            if (shaderFileSize) {
+                shaderFile = directory.OpenFile(ShaderFileName, {false, true, false});
+                shaderFile->Resize(shaderFileSize);
+            } else {
+                ShaderFileHeader header{
+                    .magic = util::MakeMagic<u32>("SSC0"),
+                    .version = shader::CompilerVersion,
+                };
+
+                if (!directory.CreateFile(ShaderFileName, sizeof(ShaderFileHeader)))
+                    throw exception("Failed to create the shader cache file: {}{}", path, ShaderFileName);
+                shaderFile = directory.OpenFile(ShaderFileName, {false, true, false});
+                shaderFile->Write(&header);
+                shaderFileSize = sizeof(ShaderFileHeader);
+            }
+        }
+
+        ShaderEntry entry{
+            .hash = shader.hash,
+            .stage = static_cast<u32>(shader.stage),
+            .codeSize = static_cast<u32>(shader.code.size()),
+            .spirvSize = static_cast<u32>(shader.spirv.size()),
+        };
+
+        // The shader is assembled in memory and appended with a single write, so it's either entirely present or truncated
+        std::vector<u8> buffer(sizeof(ShaderEntry) + (shader.code.size() * sizeof(u64)) + (shader.spirv.size() * sizeof(u32)));
+        std::memcpy(buffer.data(), &entry, sizeof(ShaderEntry));
+        std::memcpy(buffer.data() + sizeof(ShaderEntry), shader.code.data(), shader.code.size() * sizeof(u64));
+        std::memcpy(buffer.data() + sizeof(ShaderEntry) + (shader.code.size() * sizeof(u64)), shader.spirv.data(), shader.spirv.size() * sizeof(u32));
+
+        shaderFile->Write(buffer.data(), shaderFileSize, buffer.size());
+        shaderFileSize += buffer.size();
+    }
+
+    void ShaderCache::Load(const std::string &cachePath, u64 titleId) {
+        if (!titleId)
+            return;
+
+        std::lock_guard lock(mutex);
+        auto titlePath{fmt::format("{}{:016X}/", cachePath, titleId)};
+        path = titlePath;
+        shaderFile.reset();
+        shaderFileSize = 0;
+        shaderFileFailed = false;
+
+        // The disk cache of a title is only created once a shader has been translated, so titles that never have one don't get an empty cache
+        struct stat fileStat;
+        if (stat((titlePath + ShaderFileName).c_str(), &fileStat) != 0)
+            return;
+
+        vfs::OsFileSystem directory(titlePath);
+
+        ShaderFileHeader expectedHeader{
+            .magic = util::MakeMagic<u32>("SSC0"),
+            .version = shader::CompilerVersion,
+        };
+
+        // A shader file from a different version of the compiler is discarded entirely, as is any truncated shader at the end of the file
+        size_t shaderCount{};
+        auto backing{directory.OpenFile(ShaderFileName)};
+        std::vector<u8> file(backing->size);
+        backing->Read(file.data(), 0, file.size());
+
+        ShaderFileHeader header{};
+        if (file.size() >= sizeof(ShaderFileHeader))
+            std::memcpy(&header, file.data(), sizeof(ShaderFileHeader));
+
+        if (header.magic == expectedHeader.magic && header.version == expectedHeader.version) {
+            size_t offset{sizeof(ShaderFileHeader)};
+            while (offset + sizeof(ShaderEntry) <= file.size()) {
+                ShaderEntry entry;
+                std::memcpy(&entry, file.data() + offset, sizeof(ShaderEntry));
+
+                auto codeSize{entry.codeSize * sizeof(u64)};
+                auto spirvSize{entry.spirvSize * sizeof(u32)};
+                if (entry.stage >= shader::AllStageCount || offset + sizeof(ShaderEntry) + codeSize + spirvSize > file.size())
+                    break;
+
+                std::vector<u64> code(entry.codeSize);
+                std::memcpy(code.data(), file.data() + offset + sizeof(ShaderEntry), codeSize);
+
+                auto shader{std::make_shared<Shader>(static_cast<shader::Stage>(entry.stage), entry.hash, std::move(code))};
+                shader->spirv.resize(entry.spirvSize);
+                std::memcpy(shader->spirv.data(), file.data() + offset + sizeof(ShaderEntry) + codeSize, spirvSize);
+                shader->status.store(Shader::Status::Ready, std::memory_order_relaxed);
+                Insert(std::move(shader));
+
+                shaderCount++;
+                offset += sizeof(ShaderEntry) + codeSize + spirvSize;
+            }
+
+            // The file is only reopened for writing when a shader is appended to it, a file that doesn't match is replaced at that point
+            shaderFileSize = offset;
+        }
+
+        state.logger->Info("Loaded {} shaders from the shader cache of {:016X}", shaderCount, titleId);
+    }
+
+    std::shared_ptr<ShaderCache::Shader> ShaderCache::Get(shader::Stage stage, u64 address) {
+        // The size of a program isn't known upfront, it's read in chunks until its end is found
+        constexpr size_t ChunkSize{0x200}; //!< The amount of 64-bit words read at a time
+        std::vector<u64> code;
+        std::optional<size_t> size;
+        while (!size) {
+            if (code.size() * sizeof(u64) >= constant::MaxShaderProgramSize)
+                throw exception("Shader program at 0x{:X} has no end within 0x{:X} bytes", address, constant::MaxShaderProgramSize);
+
+            auto offset{code.size()};
+            code.resize(offset + ChunkSize);
+            state.gpu->memoryManager.Read(std::span(code).subspan(offset), address + (offset * sizeof(u64)));
+            size = shader::GetProgramSize(code, stage);
+        }
+        code.resize(*size);
+
+        auto hash{std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char *>(code.data()), code.size() * sizeof(u64)))};
+
+        std::lock_guard lock(mutex);
+        auto &stageShaders{shaders[static_cast<size_t>(stage)]};
+        auto it{stageShaders.find(hash)};
+        if (it != stageShaders.end() && it->second->code == code)
+            return it->second;
+
+        auto shader{std::make_shared<Shader>(stage, hash, std::move(code))};
+        Insert(shader);
+        return shader;
+    }
+
+    std::vector<u8> ShaderCache::GetPipelineCacheData() {
+        std::lock_guard lock(mutex);
+        if (path.empty())
+            return {};
+
+        vfs::OsFileSystem directory(path);
+        if (!directory.FileExists(PipelineCacheFileName))
+            return {};
+
+        auto backing{directory.OpenFile(PipelineCacheFileName)};
+        std::vector<u8> data(backing->size);
+        backing->Read(data.data(), 0, data.size());
+        return data;
+    }
+
+    void ShaderCache::SetPipelineCacheData(std::span<const u8> data) {
+        std::lock_guard lock(mutex);
+        if (path.empty() || !shaderFileSize)
+            return; // Pipelines can only exist for translated shaders, so there's nothing worth caching for a title without any
+
+        vfs::OsFileSystem directory(path);
+        if (!directory.CreateFile(PipelineCacheFileName, data.size()))
+            throw exception("Failed to create the pipeline cache file: {}{}", path, PipelineCacheFileName);
+        directory.OpenFile(PipelineCacheFileName, {false, true, false})->Write(const_cast<u8 *>(data.data()), 0, data.size());
+    }
+}
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <condition_variable>
+#include <queue>
+#include <thread>
+#include <vfs/backing.h>
+#include <cache_registry.h>
+#include "shader_compiler.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief The ShaderCache class translates guest shader programs into SPIR-V on background threads and caches the result in memory and on disk
+     * @note Shaders are keyed by their stage and a hash of their code, the disk cache holds every successfully translated shader and the Vulkan pipeline cache of a title so they're available from the first draw of subsequent runs
+     */
+    class ShaderCache {
+      public:
+        /**
+         * @brief A single guest shader program and its translation
+         */
+        struct Shader {
+            enum class Status : u8 {
+                Pending, //!< The shader is queued for translation or being translated
+                Ready, //!< The shader was translated successfully and spirv is valid
+                Failed, //!< The shader couldn't be translated, this is never retried
+            };
+
+            shader::Stage stage;
+            u64 hash; //!< A hash of the code of the shader
+            std::vector<u64> code; //!< The code of the shader including its header, this is kept to verify that a bound shader hasn't been overwritten
+            std::vector<u32> spirv; //!< The SPIR-V module of the shader, this must only be accessed after the status has been observed as Ready
+            std::atomic<Status> status{Status::Pending};
+
+            Shader(shader::Stage stage, u64 hash, std::vector<u64> code);
+
+            /**
+             * @return If the code of the shader is still at the supplied GPU address
+             */
+            bool Matches(const DeviceState &state, u64 address) const;
+        };
+
+      private:
+        /**
+         * @brief The header of the file in the disk cache which holds the shaders, this is followed by all of the shaders
+         * @note Every shader is made up of a ShaderEntry, its code and its SPIR-V, they're appended as they're translated so a truncated shader at the end of the file is discarded
+         */
+        struct ShaderFileHeader {
+            u32 magic; //!< The magic of a shader cache file: 'SSC0'
+            u32 version; //!< The version of the compiler that translated the shaders, the file is discarded if it doesn't match the current version
+        };
+
+        struct ShaderEntry {
+            u64 hash;
+            u32 stage;
+            u32 codeSize; //!< The size of the code in 64-bit words
+            u32 spirvSize; //!< The size of the SPIR-V module in 32-bit words
+            u32 _pad0_;
+        };
+        static_assert(sizeof(ShaderEntry) == 0x18);
+
+        const DeviceState &state; //!< The state of the device
+        std::mutex mutex; //!< This mutex guards all members other than the threads, it's never held while translating
+        std::condition_variable queueConditional; //!< The worker threads wait on this for a shader to be queued
+        std::array<std::unordered_map<u64, std::shared_ptr<Shader>>, shader::AllStageCount> shaders; //!< A map from the hash of a shader to the shader for every stage
+        std::queue<std::shared_ptr<Shader>> queue; //!< The shaders that are pending translation
+        bool exit{}; //!< If the worker threads should exit
+        std::string path; //!< The directory that holds the disk cache of the current title, this is empty if the disk cache isn't used
+        std::shared_ptr<vfs::Backing> shaderFile; //!< The file in the disk cache that translated shaders are appended to, it's only created once the first shader has been translated
+        size_t shaderFileSize{}; //!< The size of the valid contents of the shader file, this is 0 if it needs to be created
+        bool shaderFileFailed{}; //!< If writing to the shader file failed, it isn't written to for the rest of the run after this
+        std::vector<std::thread> threads; //!< The worker threads, they're only started once a shader of a stage the compiler supports is queued
+        cache::Registration registration; //!< The registration of the in-memory cache in the cache registry, this is declared last so it's unregistered prior to the cache being destroyed
+
+        /**
+         * @brief The entry point of a worker thread, it translates queued shaders until the cache is destroyed
+         */
+        void WorkerThread();
+
+        /**
+         * @brief Inserts a shader into the cache and queues it for translation if required, mutex must be held by the caller
+         */
+        void Insert(std::shared_ptr<Shader> shader);
+
+        /**
+         * @brief Appends a translated shader to the shader file in the disk cache and creates the file if it doesn't exist yet, mutex must be held by the caller
+         */
+        void WriteShader(const Shader &shader);
+
+        /**
+         * @return The size of the code and SPIR-V of all cached shaders in bytes
+         */
+        size_t GetCacheSize();
+
+        /**
+         * @brief Evicts translated shaders which aren't referenced outside of the cache till at least the supplied amount of bytes has been freed
+         * @return The amount of bytes that were freed
+         * @note Evicted shaders are translated again if they're used after this, they're still in the disk cache but it's only read when a title is loaded
+         */
+        size_t Evict(size_t target);
+
+      public:
+        ShaderCache(const DeviceState &state);
+
+        ~ShaderCache();
+
+        /**
+         * @brief Loads the disk cache of a title and writes any subsequently translated shaders to it
+         * @param cachePath The directory that holds the disk caches of all titles
+         * @param titleId The ID of the title, the disk cache is only used for a non-zero ID
+         */
+        void Load(const std::string &cachePath, u64 titleId);
+
+        /**
+         * @brief Looks up the shader program at a GPU address, it's read and queued for translation if it isn't in the cache already
+         * @return The shader, this never blocks on translation so it might still be pending
+         */
+        std::shared_ptr<Shader> Get(shader::Stage stage, u64 address);
+
+        /**
+         * @return The contents of the title's Vulkan pipeline cache from the disk cache, this is empty if there isn't one
+         */
+        std::vector<u8> GetPipelineCacheData();
+
+        /**
+         * @brief Replaces the title's Vulkan pipeline cache in the disk cache
+         * @param data The data returned by vkGetPipelineCacheData
+         */
+        void SetPipelineCacheData(std::span<const u8> data);
+    };
+}
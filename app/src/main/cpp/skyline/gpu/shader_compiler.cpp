@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "shader_compiler.h"
+
+namespace skyline::gpu::shader {
+    std::optional<size_t> GetProgramSize(std::span<const u64> code, Stage stage) {
+        constexpr u64 SelfBranch{0xE2400FFFFF07000F}; //!< An unconditional BRA with an offset of -1 instruction, compilers emit it after the final EXIT
+        constexpr u64 SelfBranchMask{0xFFFFFFFFFF7FFFFF}; //!< A mask for all bits of a BRA other than its predicate negation bit
+
+        auto start{stage == Stage::Compute ? 0 : HeaderInstructionCount};
+        for (size_t index{start}; index < code.size(); index++) {
+            // Every group of 3 instructions is preceded by a word holding their scheduling control information
+            if ((index - start) % 4 == 0)
+                continue;
+
+            auto instruction{code[index]};
+            if ((instruction & SelfBranchMask) == SelfBranch || instruction == 0)
+                return index + 1;
+        }
+
+        return std::nullopt;
+    }
+
+    std::vector<u32> Compile(Stage stage, std::span<const u64> code) {
+        if (stage == Stage::Compute)
+            throw exception("Translating Maxwell instructions into SPIR-V isn't implemented: Compute, {} instructions", code.size());
+
+        if (code.size() < HeaderInstructionCount)
+            throw exception("Shader program is smaller than its header: 0x{:X}", code.size_bytes());
+
+        ShaderHeader header;
+        std::memcpy(&header, code.data(), sizeof(ShaderHeader));
+
+        ShaderHeader::Type type;
+        switch (stage) {
+            case Stage::VertexA:
+            case Stage::VertexB:
+                type = ShaderHeader::Type::Vertex;
+                break;
+            case Stage::TessellationControl:
+                type = ShaderHeader::Type::TessellationControl;
+                break;
+            case Stage::TessellationEvaluation:
+                type = ShaderHeader::Type::TessellationEvaluation;
+                break;
+            case Stage::Geometry:
+                type = ShaderHeader::Type::Geometry;
+                break;
+            case Stage::Fragment:
+                type = ShaderHeader::Type::Fragment;
+                break;
+            default:
+                throw exception("Invalid shader stage: {}", static_cast<u8>(stage));
+        }
+
+        if (header.shaderType != type)
+            throw exception("Shader program header type ({}) doesn't match its stage ({})", static_cast<u32>(header.shaderType), static_cast<u8>(stage));
+
+        // Programs are only validated for now, the translation of Maxwell instructions into SPIR-V is yet to be written
+        throw exception("Translating Maxwell instructions into SPIR-V isn't implemented: SPH Type {}, Version {}, {} instructions", static_cast<u32>(header.sphType), static_cast<u32>(header.version), code.size() - HeaderInstructionCount);
+    }
+}
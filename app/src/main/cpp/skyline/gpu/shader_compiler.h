@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline {
+    namespace constant {
+        constexpr size_t MaxShaderProgramSize = 0x10000; //!< The maximum size of a Maxwell shader program including its header in bytes, programs without an end within this size are rejected
+    }
+
+    namespace gpu::shader {
+        constexpr u32 CompilerVersion = 1; //!< The version of the compiler's output, this must be incremented whenever the SPIR-V it generates changes as it invalidates all cached shaders
+
+        /**
+         * @brief The stage of the pipeline a Maxwell shader program is bound to, the graphics stages are the values used by the SetProgram registers
+         */
+        enum class Stage : u8 {
+            VertexA = 0, //!< The first half of a split vertex shader, this is only used alongside VertexB
+            VertexB = 1,
+            TessellationControl = 2,
+            TessellationEvaluation = 3,
+            Geometry = 4,
+            Fragment = 5,
+            Compute = 6, //!< A compute program launched by the Maxwell Compute engine, unlike graphics programs it has no header
+        };
+        constexpr size_t StageCount = 6; //!< The amount of graphics shader stages and programs that can be bound at once
+        constexpr size_t AllStageCount = 7; //!< The amount of shader stages including compute
+
+        /**
+         * @brief The Shader Program Header which precedes the instructions of every graphics shader program
+         * @url https://nvidia.github.io/open-gpu-doc/Shader-Program-Header/Shader-Program-Header.html
+         */
+        struct ShaderHeader {
+            enum class Type : u32 {
+                Vertex = 1,
+                TessellationControl = 2,
+                TessellationEvaluation = 3,
+                Geometry = 4,
+                Fragment = 5,
+            };
+
+            struct {
+                u32 sphType : 5; //!< 1 for the header of vertex processing stages and 2 for the header of fragment shaders
+                u32 version : 5;
+                Type shaderType : 4;
+                bool mrtEnable : 1;
+                bool killsPixels : 1;
+                bool doesGlobalStore : 1;
+                u32 sassVersion : 4;
+                u32 _pad0_ : 5;
+                bool doesLoadOrStore : 1;
+                bool doesFp64 : 1;
+                u32 streamOutMask : 4;
+            };
+            u32 _unk_[19]; //!< The rest of the header describes register usage and the inputs and outputs of the program, it's specific to the header type
+        };
+        static_assert(sizeof(ShaderHeader) == 0x50);
+
+        constexpr size_t HeaderInstructionCount = sizeof(ShaderHeader) / sizeof(u64); //!< The amount of 64-bit words taken up by the header at the start of a program
+
+        /**
+         * @brief Finds the end of a shader program, it's marked by a branch to itself or an empty instruction
+         * @param code The start of the program including its header, this doesn't need to contain the entire program
+         * @param stage The stage of the program, this determines if the program has a header
+         * @return The size of the program in 64-bit words including the end marker, this is std::nullopt if the end isn't within the supplied code
+         */
+        std::optional<size_t> GetProgramSize(std::span<const u64> code, Stage stage);
+
+        /**
+         * @return If Compile can translate programs of the supplied stage, programs of other stages are rejected without being looked at
+         * @note The translation of Maxwell instructions into SPIR-V isn't implemented for any stage yet, so callers can skip any work done solely to translate a program
+         */
+        constexpr bool IsStageSupported(Stage) {
+            return false;
+        }
+
+        /**
+         * @brief Translates a Maxwell shader program into a SPIR-V module
+         * @param stage The stage the program is bound to
+         * @param code The program including any header, as determined by GetProgramSize
+         * @return The words of the SPIR-V module
+         * @note This throws an exception for any program that can't be translated, such programs shouldn't be attempted again, as instructions aren't translated yet this currently only validates the header and rejects every program, see IsStageSupported
+         */
+        std::vector<u32> Compile(Stage stage, std::span<const u64> code);
+    }
+}
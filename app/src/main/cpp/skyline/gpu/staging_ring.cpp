@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <bit>
+#include "staging_ring.h"
+
+namespace skyline::gpu::memory {
+    StagingRing::StagingRing(vk::Device device, MemoryAllocator &allocator, vk::DeviceSize ringSize) : device(device), allocator(allocator) {
+        Create(ringSize);
+    }
+
+    void StagingRing::Create(vk::DeviceSize ringSize) {
+        buffer.reset();
+        allocation.Reset();
+
+        buffer = device.createBufferUnique(vk::BufferCreateInfo({}, ringSize, vk::BufferUsageFlagBits::eTransferSrc, vk::SharingMode::eExclusive));
+        allocation = allocator.AllocateBuffer(*buffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+        size = ringSize;
+        head = tail = 0;
+    }
+
+    void StagingRing::RecycleOldest() {
+        auto &region{regions.front()};
+        if (device.waitForFences(*region.fence, true, std::numeric_limits<u64>::max()) != vk::Result::eSuccess)
+            throw exception("Waiting on the fence of a staging region has failed");
+        device.resetFences(*region.fence);
+
+        tail = region.end;
+        completedSerial = region.serial;
+        fencePool.push_back(std::move(region.fence));
+        regions.pop_front();
+    }
+
+    StagingRing::Span StagingRing::Allocate(vk::DeviceSize allocationSize) {
+        auto alignedSize{util::AlignUp(allocationSize, constant::StagingAlignment)};
+        if (alignedSize > size) {
+            // The ring can only be grown once it's entirely unused, as any regions in use are in the buffer that's replaced
+            while (!regions.empty())
+                RecycleOldest();
+            if (head != tail)
+                throw exception("A staging allocation of 0x{:X} bytes doesn't fit into the ring alongside the open region", allocationSize);
+            Create(std::bit_ceil(alignedSize));
+        }
+
+        while (true) {
+            // An allocation never wraps around the end of the ring, the remainder of the ring is skipped if it doesn't fit into it
+            auto position{head};
+            auto offset{position % size};
+            if (offset + alignedSize > size) {
+                position += size - offset;
+                offset = 0;
+            }
+
+            if (position + alignedSize - tail <= size) {
+                head = position + alignedSize;
+                return Span{*buffer, offset, std::span(allocation.mapping + offset, allocationSize)};
+            }
+
+            if (regions.empty())
+                throw exception("The open region of the staging ring has exhausted it");
+            RecycleOldest();
+        }
+    }
+
+    StagingRing::Submission StagingRing::Submit() {
+        vk::UniqueFence fence;
+        if (!fencePool.empty()) {
+            fence = std::move(fencePool.back());
+            fencePool.pop_back();
+        } else {
+            fence = device.createFenceUnique({});
+        }
+
+        auto &region{regions.emplace_back(Region{nextSerial++, head, std::move(fence)})};
+        return {*region.fence, region.serial};
+    }
+
+    void StagingRing::Wait(u64 serial) {
+        while (completedSerial < serial && !regions.empty())
+            RecycleOldest();
+    }
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <deque>
+#include "memory_allocator.h"
+
+namespace skyline::gpu::memory {
+    namespace constant {
+        constexpr vk::DeviceSize StagingRingSize{32 * 1024 * 1024}; //!< The initial size of the staging ring, this fits multiple frames at the handheld resolution
+        constexpr vk::DeviceSize StagingAlignment{256}; //!< The alignment of every staging allocation, this satisfies the optimal buffer copy offset alignment of all devices
+    }
+
+    /**
+     * @brief The StagingRing class is a persistently mapped host-visible buffer that uploads are linearly allocated from, regions are recycled once the fence of the submission that used them has been signalled
+     * @details Allocations since the last submission form the open region, Submit closes it and returns a fence for the submission that consumes it. The ring only waits on fences when it runs out of space, so uploads of multiple submissions can be in flight at once
+     * @note This isn't thread-safe, a ring should only be used by a single thread. The device must be idle prior to the ring being destroyed
+     */
+    class StagingRing {
+      public:
+        /**
+         * @brief A range of the ring that can be written to by the host and used as the source of copies on the device
+         */
+        struct Span {
+            vk::Buffer buffer;
+            vk::DeviceSize offset;
+            std::span<u8> mapping;
+        };
+
+        /**
+         * @brief The fence and serial of a submission which consumes the open region of the ring
+         */
+        struct Submission {
+            vk::Fence fence; //!< The fence that the submission must signal, this is owned by the ring
+            u64 serial; //!< The serial of the submission, it can be waited on with Wait
+        };
+
+      private:
+        /**
+         * @brief A region of the ring that's in use by a submission which might not have completed yet
+         */
+        struct Region {
+            u64 serial;
+            u64 end; //!< The position in the ring that the region ends at
+            vk::UniqueFence fence;
+        };
+
+        vk::Device device;
+        MemoryAllocator &allocator;
+        vk::UniqueBuffer buffer;
+        Allocation allocation;
+        vk::DeviceSize size{}; //!< The size of the ring, this is only increased if an allocation doesn't fit into the entire ring
+        u64 head{}; //!< The position in the ring that the next allocation is made at, positions increase monotonically and wrap around the ring at its size
+        u64 tail{}; //!< The position in the ring that the oldest region in use starts at
+        u64 nextSerial{1};
+        u64 completedSerial{}; //!< The serial of the most recent submission whose region has been recycled
+        std::deque<Region> regions; //!< All regions consumed by submissions that haven't been recycled, in submission order
+        std::vector<vk::UniqueFence> fencePool; //!< Fences of recycled regions, they're unsignalled and can be reused
+
+        /**
+         * @brief (Re)creates the ring buffer with the supplied size, this must only be done while no region is in use
+         */
+        void Create(vk::DeviceSize ringSize);
+
+        /**
+         * @brief Waits on the oldest region in use and recycles it
+         */
+        void RecycleOldest();
+
+      public:
+        StagingRing(vk::Device device, MemoryAllocator &allocator, vk::DeviceSize ringSize = constant::StagingRingSize);
+
+        /**
+         * @brief Allocates a span from the open region of the ring, this waits for submissions to complete if there isn't enough space
+         */
+        Span Allocate(vk::DeviceSize allocationSize);
+
+        /**
+         * @brief Closes the open region of the ring, the returned fence must be signalled by the submission that uses the region
+         */
+        Submission Submit();
+
+        /**
+         * @brief Waits for the submission with the supplied serial to complete, this is a no-op if it has already been recycled
+         */
+        void Wait(u64 serial);
+    };
+}
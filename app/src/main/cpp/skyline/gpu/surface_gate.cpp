@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <headless.h>
+#include "surface_gate.h"
+
+extern bool Halt;
+
+namespace skyline::gpu {
+    SurfaceGate HostSurface;
+
+    void SurfaceGate::Update(ANativeWindow *window) {
+        {
+            std::lock_guard lock(mutex);
+            if (this->window)
+                ANativeWindow_release(this->window);
+            this->window = window;
+            available.store(window != nullptr, std::memory_order_release);
+            generation.fetch_add(1, std::memory_order_release);
+        }
+        condition.notify_all();
+    }
+
+    void SurfaceGate::Notify() {
+        {
+            std::lock_guard lock(mutex);
+        }
+        condition.notify_all();
+    }
+
+    void SurfaceGate::Wait() {
+        if (headless::HeadlessOptions.enabled || available.load(std::memory_order_acquire))
+            return;
+
+        std::unique_lock lock(mutex);
+        // Halt can also be set by the signal handler which can't notify the gate, so it's rechecked every second regardless
+        while (!window && !Halt)
+            condition.wait_for(lock, std::chrono::seconds(1));
+    }
+
+    bool SurfaceGate::Poll(u32 &generation, ANativeWindow *&window) {
+        if (generation == this->generation.load(std::memory_order_acquire))
+            return false;
+
+        std::lock_guard lock(mutex);
+        generation = this->generation.load(std::memory_order_relaxed);
+        window = this->window;
+        if (window)
+            ANativeWindow_acquire(window);
+        return true;
+    }
+}
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <android/native_window.h>
+#include <common.h>
+
+namespace skyline::gpu {
+    /**
+     * @brief The SurfaceGate class delivers changes to the Android Surface from the JNI thread to the presentation thread and blocks any threads that can't progress without a Surface
+     * @details Every creation, destruction or resize of the Surface bumps a generation which the presentation thread compares against the last one it has seen, nothing but an atomic load is done if it hasn't changed. Threads waiting for a Surface sleep on a condition variable rather than polling, so emulation doesn't use any CPU while the activity is in the background
+     */
+    class SurfaceGate {
+      private:
+        std::mutex mutex; //!< This mutex guards window and is used to wait on condition
+        std::condition_variable condition; //!< This is notified when the window changes or emulation is halted
+        ANativeWindow *window{}; //!< The window backing the current Surface, this is nullptr when there's no Surface
+        std::atomic<bool> available{}; //!< If there's a window currently, this is used to avoid locking the mutex in Wait
+        std::atomic<u32> generation{}; //!< A counter that's incremented on every change to the Surface
+
+      public:
+        /**
+         * @brief Replaces the window with the window of a new Surface, this wakes up any threads waiting for a Surface
+         * @param window The window of the new Surface or nullptr if it has been destroyed, the gate takes over the reference to it
+         * @note The same window being supplied again signifies that the Surface was resized
+         */
+        void Update(ANativeWindow *window);
+
+        /**
+         * @brief Wakes up all threads waiting for a Surface so they can check if emulation has been halted
+         */
+        void Notify();
+
+        /**
+         * @brief Blocks the calling thread till there's a Surface or emulation has been halted, this returns immediately when headless
+         */
+        void Wait();
+
+        /**
+         * @brief Checks if the Surface has changed since the supplied generation
+         * @param generation The generation that was last seen by the caller, this is updated to the current generation if it has changed
+         * @param window This is set to an acquired reference to the current window if the Surface has changed, it may be nullptr
+         * @return If the Surface has changed
+         */
+        bool Poll(u32 &generation, ANativeWindow *&window);
+    };
+
+    extern SurfaceGate HostSurface; //!< The gate for the Surface of the emulation activity, this is a global as it's updated by the frontend regardless of an emulation session existing
+}
@@ -11,52 +11,85 @@ namespace skyline::gpu {
             return 0;
         }
 
-        std::lock_guard guard(waiterLock);
-        waiterMap.insert({nextWaiterId, Waiter{threshold, callback}});
+        std::unique_lock guard(waiterLock);
+
+        // The waiter count is published prior to checking the value again so an increment either observes it or its new value is observed here
+        waiterCount++;
+        if (value >= threshold) {
+            waiterCount--;
+            guard.unlock();
+            callback();
+            return 0;
+        }
+
+        auto id{nextWaiterId++};
+        waiters.push_back(Waiter{threshold, id, callback});
+        std::push_heap(waiters.begin(), waiters.end());
 
-        return nextWaiterId++;
+        return id;
     }
 
     void Syncpoint::DeregisterWaiter(u64 id) {
         std::lock_guard guard(waiterLock);
-        waiterMap.erase(id);
+
+        auto waiter{std::find_if(waiters.begin(), waiters.end(), [id](const Waiter &waiter) { return waiter.id == id; })};
+        if (waiter == waiters.end())
+            return;
+
+        waiters.erase(waiter);
+        std::make_heap(waiters.begin(), waiters.end());
+        waiterCount--;
     }
 
     u32 Syncpoint::Increment() {
-        value++;
+        auto newValue{++value};
 
-        std::lock_guard guard(waiterLock);
-        std::erase_if(waiterMap, [this](const auto &entry) {
-            if (value >= entry.second.threshold) {
-                entry.second.callback();
-                return true;
-            } else {
-                return false;
+        if (waiterCount) {
+            std::lock_guard guard(waiterLock);
+            while (!waiters.empty() && waiters.front().threshold <= newValue) {
+                std::pop_heap(waiters.begin(), waiters.end());
+                waiters.back().callback();
+                waiters.pop_back();
+                waiterCount--;
             }
-        });
+        }
+
+        if (sleeperCount)
+            FutexSyscall(reinterpret_cast<volatile u32 *>(&value), FUTEX_WAKE_PRIVATE, INT32_MAX);
 
-        return value;
+        return newValue;
     }
 
     bool Syncpoint::Wait(u32 threshold, std::chrono::steady_clock::duration timeout) {
-        std::mutex mtx;
-        std::condition_variable cv;
-        bool flag{};
-
-        if (timeout == timeout.max())
-            timeout = std::chrono::seconds(1);
-
-        if (!RegisterWaiter(threshold, [&cv, &mtx, &flag] {
-            std::unique_lock lock(mtx);
-            flag = true;
-            lock.unlock();
-            cv.notify_all();
-        })) {
+        if (value >= threshold)
             return true;
+
+        bool infinite{timeout == timeout.max()};
+        auto deadline{infinite ? std::chrono::steady_clock::time_point{} : std::chrono::steady_clock::now() + timeout};
+
+        sleeperCount++;
+        bool reached{};
+        while (true) {
+            // The futex only sleeps if the value is still the one that was checked, so an increment between the check and the sleep isn't missed
+            auto current{value.load()};
+            if (current >= threshold) {
+                reached = true;
+                break;
+            }
+
+            timespec remaining{};
+            if (!infinite) {
+                auto duration{deadline - std::chrono::steady_clock::now()};
+                if (duration <= std::chrono::steady_clock::duration::zero())
+                    break;
+                auto ns{std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()};
+                remaining = {.tv_sec = static_cast<time_t>(ns / constant::NsInSecond), .tv_nsec = static_cast<long>(ns % constant::NsInSecond)};
+            }
+
+            FutexSyscall(reinterpret_cast<volatile u32 *>(&value), FUTEX_WAIT_PRIVATE, current, infinite ? nullptr : &remaining);
         }
+        sleeperCount--;
 
-        std::unique_lock lock(mtx);
-        return cv.wait_for(lock, timeout, [&flag] { return flag; });
+        return reached;
     }
 };
-
@@ -13,6 +13,7 @@ namespace skyline {
     namespace gpu {
         /**
          * @brief The Syncpoint class represents a single syncpoint in the GPU which is used for GPU -> CPU synchronisation
+         * @note Callback waiters are held in a min-heap ordered by their threshold so an increment only touches the waiters that it expires while blocking waits sleep on a futex keyed on the value
          */
         class Syncpoint {
           private:
@@ -21,11 +22,21 @@ namespace skyline {
              */
             struct Waiter {
                 u32 threshold;
+                u64 id;
                 std::function<void()> callback;
+
+                /**
+                 * @note This is inverted so that the standard heap functions create a min-heap with the lowest threshold at the front
+                 */
+                bool operator<(const Waiter &other) const {
+                    return threshold > other.threshold;
+                }
             };
 
             Mutex waiterLock{}; //!< Locks insertions and deletions of waiters
-            std::map<u64, Waiter> waiterMap{};
+            std::vector<Waiter> waiters{}; //!< A min-heap of all pending waiters ordered by their threshold
+            std::atomic<u32> waiterCount{}; //!< The amount of pending waiters, this is checked without locking so increments without waiters don't need to lock
+            std::atomic<u32> sleeperCount{}; //!< The amount of threads sleeping on the futex in Wait, increments only wake the futex if this is non-zero
             u64 nextWaiterId{1};
 
           public:
@@ -51,6 +62,7 @@ namespace skyline {
 
             /**
              * @brief Waits for the syncpoint to reach given threshold
+             * @param timeout The maximum duration to wait for, the wait is infinite if this is the maximum duration
              * @return false if the timeout was reached, otherwise true
              */
             bool Wait(u32 threshold, std::chrono::steady_clock::duration timeout);
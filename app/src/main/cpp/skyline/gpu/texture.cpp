@@ -4,84 +4,276 @@
 #include <android/native_window.h>
 #include <kernel/types/KProcess.h>
 #include <unistd.h>
+#include <gpu.h>
+#include <perf_stats.h>
+#include <arm_neon.h>
+#include "block_linear.h"
+#include "format.h"
+#include "texture_decoder.h"
 #include "texture.h"
 
 namespace skyline::gpu {
     GuestTexture::GuestTexture(const DeviceState &state, u64 address, texture::Dimensions dimensions, texture::Format format, texture::TileMode tiling, texture::TileConfig layout) : state(state), address(address), dimensions(dimensions), format(format), tileMode(tiling), tileConfig(layout) {}
 
+    size_t GuestTexture::GuestSize() {
+        if (tileMode == texture::TileMode::Block) {
+            auto robHeight = GobHeight * tileConfig.blockHeight; // The height of a single ROB (Row of Blocks) in lines
+            auto surfaceHeightRobs = util::AlignUp(util::AlignUp(dimensions.height, format.blockHeight) / format.blockHeight, robHeight) / robHeight; // The height of the surface in ROBs (Row Of Blocks)
+            auto robWidthBytes = util::AlignUp((util::AlignUp(tileConfig.surfaceWidth, format.blockWidth) / format.blockWidth) * format.bpb, GobWidth); // The width of a ROB in bytes
+            return static_cast<size_t>(surfaceHeightRobs) * robWidthBytes * robHeight;
+        } else if (tileMode == texture::TileMode::Pitch) {
+            return format.GetSize(tileConfig.pitch, dimensions.height);
+        } else {
+            return Size();
+        }
+    }
+
     Texture::Texture(const DeviceState &state, std::shared_ptr<GuestTexture> guest, texture::Dimensions dimensions, texture::Format format, texture::Swizzle swizzle) : state(state), guest(guest), dimensions(dimensions), format(format), swizzle(swizzle) {
+        // Compressed formats which the host GPU can't sample are decoded into RGBA8888 on the CPU
+        if (this->format.IsCompressed() && !state.gpu->IsFormatSupported(this->format.vkFormat)) {
+            if (!decoder::CanDecode(this->format)) {
+                state.logger->Warn("Texture format {} is neither supported by the host GPU nor decodable, using a blank placeholder", static_cast<u32>(this->format.vkFormat));
+                placeholder = true;
+            }
+            this->format = format::RGBA8888Unorm;
+        }
+
         SynchronizeHost();
     }
 
     void Texture::SynchronizeHost() {
+        RequestHostSynchronization();
+        CompleteHostSynchronization();
+    }
+
+    void Texture::RequestHostSynchronization() {
+        if (!guest->dirty)
+            return;
+
+        // The texture is marked clean prior to reading it so that any writes during synchronization mark it as dirty again
+        guest->dirty = false;
+        state.gpu->textureCache.TrackWrites(*guest);
+        synchronizationPending.store(true, std::memory_order_release);
+    }
+
+    void Texture::CompleteHostSynchronization() {
+        if (synchronizationPending.exchange(false, std::memory_order_acq_rel))
+            CopyFromGuest();
+    }
+
+    void Texture::CopyFromGuest() {
+        TRACE_SECTION("Texture::CopyFromGuest");
+        perf::ScopedTimer timer(perf::Timer::Deswizzle);
+        if (placeholder) {
+            backing.assign(format.GetSize(dimensions), 0);
+            return;
+        }
+
         auto texture = state.process->GetPointer<u8>(guest->address);
-        auto size = format.GetSize(dimensions);
-        backing.resize(size);
-        auto output = reinterpret_cast<u8 *>(backing.data());
+
+        // A compressed texture which the host can't sample is deswizzled into a staging buffer in its guest format and decoded from it into the host texture
+        bool decode = guest->format.IsCompressed() && format != guest->format;
+        auto layout = decode ? guest->format : format; // The format the contents are copied from the guest in
+        auto size = layout.GetSize(dimensions);
+        std::vector<u8> staging;
+        size_t stagingStride = layout.GetSize(dimensions.width, layout.blockHeight); // The distance between two lines of blocks in the staging buffer
+        u8 *output;
+        if (decode) {
+            staging.resize(size);
+            output = staging.data();
+        } else {
+            backing.resize(size);
+            output = backing.data();
+        }
 
         if (guest->tileMode == texture::TileMode::Block) {
             // Reference on Block-linear tiling: https://gist.github.com/PixelyIon/d9c35050af0ef5690566ca9f0965bc32
-            constexpr u8 sectorWidth = 16; // The width of a sector in bytes
-            constexpr u8 sectorHeight = 2; // The height of a sector in lines
-            constexpr u8 gobWidth = 64; // The width of a GOB in bytes
-            constexpr u8 gobHeight = 8; // The height of a GOB in lines
+            constexpr size_t ThreadedDeswizzleThreshold = 1 << 20; // The minimum size of a surface in bytes for it to be deswizzled with multiple threads
 
             auto blockHeight = guest->tileConfig.blockHeight; // The height of the blocks in GOBs
-            auto robHeight = gobHeight * blockHeight; // The height of a single ROB (Row of Blocks) in lines
-            auto surfaceHeight = dimensions.height / format.blockHeight; // The height of the surface in lines
+            auto robHeight = GobHeight * blockHeight; // The height of a single ROB (Row of Blocks) in lines
+            auto surfaceHeight = util::AlignUp(dimensions.height, layout.blockHeight) / layout.blockHeight; // The height of the surface in lines
             auto surfaceHeightRobs = util::AlignUp(surfaceHeight, robHeight) / robHeight; // The height of the surface in ROBs (Row Of Blocks)
-            auto robWidthBytes = util::AlignUp((guest->tileConfig.surfaceWidth / format.blockWidth) * format.bpb, gobWidth); // The width of a ROB in bytes
-            auto robWidthBlocks = robWidthBytes / gobWidth; // The width of a ROB in blocks (and GOBs because block width == 1 on the Tegra X1)
+            auto robWidthBytes = util::AlignUp((util::AlignUp(guest->tileConfig.surfaceWidth, layout.blockWidth) / layout.blockWidth) * layout.bpb, GobWidth); // The width of a ROB in bytes
+            auto robWidthBlocks = robWidthBytes / GobWidth; // The width of a ROB in blocks (and GOBs because block width == 1 on the Tegra X1)
+            if (decode) {
+                // Lines are deswizzled with the stride of the guest surface, which can be wider than the texture
+                staging.resize(static_cast<size_t>(robWidthBytes) * surfaceHeight);
+                output = staging.data();
+                stagingStride = robWidthBytes;
+            }
             auto robBytes = robWidthBytes * robHeight; // The size of a ROB in bytes
-            auto gobYOffset = robWidthBytes * gobHeight; // The offset of the next Y-axis GOB from the current one in linear space
-
-            auto inputSector = texture; // The address of the input sector
-            auto outputRob = output; // The address of the output block
-
-            for (u32 rob = 0, y = 0, paddingY = 0; rob < surfaceHeightRobs; rob++) { // Every Surface contains `surfaceHeightRobs` ROBs
-                auto outputBlock = outputRob; // We iterate through a block independently of the ROB
-                for (u32 block = 0; block < robWidthBlocks; block++) { // Every ROB contains `surfaceWidthBlocks` Blocks
-                    auto outputGob = outputBlock; // We iterate through a GOB independently of the block
-                    for (u32 gobY = 0; gobY < blockHeight; gobY++) { // Every Block contains `blockHeight` Y-axis GOBs
-                        for (u32 index = 0; index < sectorWidth * sectorHeight; index++) { // Every Y-axis GOB contains `sectorWidth * sectorHeight` sectors
-                            u32 xT = ((index << 3) & 0b10000) | ((index << 1) & 0b100000); // Morton-Swizzle on the X-axis
-                            u32 yT = ((index >> 1) & 0b110) | (index & 0b1); // Morton-Swizzle on the Y-axis
-                            std::memcpy(outputGob + (yT * robWidthBytes) + xT, inputSector, sectorWidth);
-                            inputSector += sectorWidth; // `sectorWidth` bytes are of sequential image data
+            auto gobYOffset = robWidthBytes * GobHeight; // The offset of the next Y-axis GOB from the current one in linear space
+            auto blockBytes = GobSize * blockHeight; // The size of a block in bytes, this includes any padding GOBs
+
+            // ROBs are independent of each other so any range of them can be deswizzled without knowledge of the others
+            auto deswizzleRobs = [=](u32 robStart, u32 robEnd) {
+                for (u32 rob = robStart; rob < robEnd; rob++) {
+                    auto inputBlock = texture + (static_cast<size_t>(rob) * robWidthBlocks * blockBytes); // The address of the input block
+                    auto outputBlock = output + (static_cast<size_t>(rob) * robBytes); // The address of the output block
+                    auto robLines = std::min(static_cast<u32>(robHeight), surfaceHeight - (rob * robHeight)); // The amount of lines in the ROB which aren't padding
+                    auto robBlockHeight = util::DivideCeil(robLines, GobHeight); // The amount of Y GOBs which aren't padding, a partially filled GOB is included
+                    auto lastGobLines = robLines - ((robBlockHeight - 1) * GobHeight); // The amount of lines in the last Y GOB which aren't padding
+
+                    for (u32 block = 0; block < robWidthBlocks; block++) { // Every ROB contains `robWidthBlocks` Blocks
+                        auto inputGob = inputBlock;
+                        auto outputGob = outputBlock;
+                        for (u32 gobY = 0; gobY < robBlockHeight; gobY++) { // Every Block contains `robBlockHeight` non-padding Y-axis GOBs
+                            if (gobY == robBlockHeight - 1 && lastGobLines != GobHeight) {
+                                // A partially filled GOB is deswizzled into a scratch GOB so the lines past the end of the surface aren't written
+                                std::array<u8, GobSize> gob;
+                                DeswizzleGob(inputGob, gob.data(), GobWidth);
+                                for (u32 line = 0; line < lastGobLines; line++)
+                                    std::memcpy(outputGob + (static_cast<size_t>(line) * robWidthBytes), gob.data() + (line * GobWidth), GobWidth);
+                            } else {
+                                DeswizzleGob(inputGob, outputGob, robWidthBytes);
+                            }
+                            inputGob += GobSize;
+                            outputGob += gobYOffset; // Increment the output GOB to the next Y-axis GOB
                         }
-                        outputGob += gobYOffset; // Increment the output GOB to the next Y-axis GOB
+                        inputBlock += blockBytes; // Padding GOBs at the end of the block are skipped over
+                        outputBlock += GobWidth; // Increment the output block to the next block (As Block Width = 1 GOB Width)
                     }
-                    inputSector += paddingY; // Increment the input sector to the next sector
-                    outputBlock += gobWidth; // Increment the output block to the next block (As Block Width = 1 GOB Width)
                 }
-                outputRob += robBytes; // Increment the output block to the next ROB
+            };
 
-                y += robHeight; // Increment the Y position to the next ROB
-                blockHeight = static_cast<u8>(std::min(static_cast<u32>(blockHeight), (surfaceHeight - y) / gobHeight)); // Calculate the amount of Y GOBs which aren't padding
-                paddingY = (guest->tileConfig.blockHeight - blockHeight) * (sectorWidth * sectorWidth * sectorHeight); // Calculate the amount of padding between contiguous sectors
+            auto threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1U), surfaceHeightRobs);
+            if (size >= ThreadedDeswizzleThreshold && threadCount > 1) {
+                // Large surfaces are split into contiguous ranges of ROBs with the calling thread deswizzling the last range
+                auto robsPerThread = (surfaceHeightRobs + threadCount - 1) / threadCount;
+
+                std::vector<std::thread> threads;
+                threads.reserve(threadCount - 1);
+                u32 rob = 0;
+                for (; rob + robsPerThread < surfaceHeightRobs; rob += robsPerThread)
+                    threads.emplace_back(deswizzleRobs, rob, rob + robsPerThread);
+
+                deswizzleRobs(rob, surfaceHeightRobs);
+
+                for (auto &thread : threads)
+                    thread.join();
+            } else {
+                deswizzleRobs(0, surfaceHeightRobs);
             }
         } else if (guest->tileMode == texture::TileMode::Pitch) {
-            auto sizeLine = guest->format.GetSize(dimensions.width, 1); // The size of a single line of pixel data
-            auto sizeStride = guest->format.GetSize(guest->tileConfig.pitch, 1); // The size of a single stride of pixel data
+            auto sizeLine = layout.GetSize(dimensions.width, layout.blockHeight); // The size of a single line of blocks
+            auto sizeStride = layout.GetSize(guest->tileConfig.pitch, layout.blockHeight); // The size of a single stride of blocks
+            auto lineCount = util::AlignUp(dimensions.height, layout.blockHeight) / layout.blockHeight;
 
-            auto inputLine = texture; // The address of the input line
-            auto outputLine = output; // The address of the output line
+            if (sizeStride == sizeLine) {
+                // A surface without any padding between its lines is contiguous, so it's copied in bulk
+                std::memcpy(output, texture, sizeLine * lineCount);
+            } else {
+                auto inputLine = texture; // The address of the input line
+                auto outputLine = output; // The address of the output line
 
-            for (u32 line = 0; line < dimensions.height; line++) {
-                std::memcpy(outputLine, inputLine, sizeLine);
-                inputLine += sizeStride;
-                outputLine += sizeLine;
+                for (u32 line = 0; line < lineCount; line++) {
+                    std::memcpy(outputLine, inputLine, sizeLine);
+                    inputLine += sizeStride;
+                    outputLine += sizeLine;
+                }
             }
         } else if (guest->tileMode == texture::TileMode::Linear) {
             std::memcpy(output, texture, size);
         }
+
+        // The decoded texture is kept in the host texture, so it's only decoded again after the guest writes to it
+        if (decode) {
+            backing.resize(format.GetSize(dimensions));
+            decoder::Decode(guest->format, staging.data(), stagingStride, backing.data(), dimensions.width, dimensions.height);
+        }
+    }
+
+    void Texture::SynchronizeGuest() {
+        CopyToGuest();
+    }
+
+    void Texture::CopyToGuest() {
+        TRACE_SECTION("Texture::CopyToGuest");
+        perf::ScopedTimer timer(perf::Timer::Deswizzle);
+        if (guest->format.IsCompressed() && format != guest->format)
+            throw exception("Texture can't be written back into guest memory as it was decoded from format {}", static_cast<u32>(guest->format.vkFormat));
+
+        auto texture = state.process->GetPointer<u8>(guest->address);
+        auto input = backing.data();
+        auto sizeLine = format.GetSize(dimensions.width, format.blockHeight); // The size of a single line of blocks in the host texture
+        auto lineCount = util::AlignUp(dimensions.height, format.blockHeight) / format.blockHeight; // The amount of lines of blocks in the texture
+        if (!lineCount)
+            return;
+
+        if (guest->tileMode == texture::TileMode::Block) {
+            auto surfaceWidth = (guest->tileConfig.surfaceWidth / format.blockWidth) * format.bpb; // The width of the guest surface in bytes
+            CopyBlockLinearLines<false>(texture, surfaceWidth, guest->tileConfig.blockHeight, input, sizeLine, 0, 0, sizeLine, 0, lineCount);
+        } else if (guest->tileMode == texture::TileMode::Pitch) {
+            auto sizeStride = format.GetSize(guest->tileConfig.pitch, format.blockHeight); // The size of a single stride of pixel data
+
+            if (sizeStride == sizeLine) {
+                std::memcpy(texture, input, sizeLine * lineCount);
+            } else {
+                for (u32 line = 0; line < lineCount; line++) {
+                    std::memcpy(texture, input, sizeLine);
+                    texture += sizeStride;
+                    input += sizeLine;
+                }
+            }
+        } else if (guest->tileMode == texture::TileMode::Linear) {
+            std::memcpy(texture, input, format.GetSize(dimensions));
+        }
     }
 
     PresentationTexture::PresentationTexture(const DeviceState &state, const std::shared_ptr<GuestTexture> &guest, const texture::Dimensions &dimensions, const texture::Format &format, const std::function<void()> &releaseCallback) : releaseCallback(releaseCallback), Texture(state, guest, dimensions, format, {}) {}
 
+    namespace {
+        /**
+         * @brief Converts a line of BGRA8888 pixels into RGBA8888 by swapping the red and blue channels, 16 pixels are converted at a time
+         */
+        void ConvertBgraLine(const u8 *input, u8 *output, u32 width) {
+            u32 x{};
+            for (; x + 16 <= width; x += 16, input += 64, output += 64) {
+                auto pixels{vld4q_u8(input)};
+                std::swap(pixels.val[0], pixels.val[2]);
+                vst4q_u8(output, pixels);
+            }
+
+            for (; x < width; x++, input += 4, output += 4) {
+                output[0] = input[2];
+                output[1] = input[1];
+                output[2] = input[0];
+                output[3] = input[3];
+            }
+        }
+
+        /**
+         * @brief Converts a line of A2B10G10R10 pixels into RGBA8888 by truncating the color channels to their 8 most significant bits and expanding the alpha channel, 4 pixels are converted at a time
+         */
+        void ConvertA2Bgr10Line(const u8 *input, u8 *output, u32 width) {
+            auto inputPixels{reinterpret_cast<const u32 *>(input)};
+            auto outputPixels{reinterpret_cast<u32 *>(output)};
+            auto channelMask{vdupq_n_u32(0xFF)};
+
+            u32 x{};
+            for (; x + 4 <= width; x += 4) {
+                auto pixels{vld1q_u32(inputPixels + x)};
+                auto red{vandq_u32(vshrq_n_u32(pixels, 2), channelMask)};
+                auto green{vandq_u32(vshrq_n_u32(pixels, 12), channelMask)};
+                auto blue{vandq_u32(vshrq_n_u32(pixels, 22), channelMask)};
+                auto alpha{vmulq_n_u32(vshrq_n_u32(pixels, 30), 0x55)}; // A 2-bit channel is expanded by replicating its bits
+                vst1q_u32(outputPixels + x, vorrq_u32(vorrq_u32(red, vshlq_n_u32(green, 8)), vorrq_u32(vshlq_n_u32(blue, 16), vshlq_n_u32(alpha, 24))));
+            }
+
+            for (; x < width; x++) {
+                auto pixel{inputPixels[x]};
+                outputPixels[x] = ((pixel >> 2) & 0xFF) | (((pixel >> 12) & 0xFF) << 8) | (((pixel >> 22) & 0xFF) << 16) | (((pixel >> 30) * 0x55) << 24);
+            }
+        }
+    }
+
     i32 PresentationTexture::GetAndroidFormat() {
         switch (format.vkFormat) {
             case vk::Format::eR8G8B8A8Unorm:
+            case vk::Format::eR8G8B8A8Srgb:
+            case vk::Format::eB8G8R8A8Unorm:
+            case vk::Format::eA2B10G10R10UnormPack32:
                 return WINDOW_FORMAT_RGBA_8888;
             case vk::Format::eR5G6B5UnormPack16:
                 return WINDOW_FORMAT_RGB_565;
@@ -89,4 +281,35 @@ namespace skyline::gpu {
                 throw exception("GetAndroidFormat: Cannot find corresponding Android surface format");
         }
     }
+
+    void PresentationTexture::CopyToWindow(u8 *output, u32 stride, u32 height) {
+        TRACE_SECTION("PresentationTexture::CopyToWindow");
+        auto input = backing.data();
+        auto lineSize = format.GetSize(dimensions.width, 1);
+        auto windowBpp = GetAndroidFormat() == WINDOW_FORMAT_RGB_565 ? sizeof(u16) : sizeof(u32);
+        auto strideSize = static_cast<size_t>(stride) * windowBpp;
+        auto lineCount = std::min(dimensions.height, height);
+
+        switch (format.vkFormat) {
+            case vk::Format::eB8G8R8A8Unorm:
+                for (u32 line = 0; line < lineCount; line++, input += lineSize, output += strideSize)
+                    ConvertBgraLine(input, output, dimensions.width);
+                break;
+
+            case vk::Format::eA2B10G10R10UnormPack32:
+                for (u32 line = 0; line < lineCount; line++, input += lineSize, output += strideSize)
+                    ConvertA2Bgr10Line(input, output, dimensions.width);
+                break;
+
+            default:
+                // Formats that match the window are copied as-is, the copy collapses to a single one when the window has no padding between lines
+                if (strideSize == lineSize) {
+                    std::memcpy(output, input, lineSize * lineCount);
+                } else {
+                    for (u32 line = 0; line < lineCount; line++, input += lineSize, output += strideSize)
+                        std::memcpy(output, input, lineSize);
+                }
+                break;
+        }
+    }
 }
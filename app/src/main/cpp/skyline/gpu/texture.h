@@ -4,6 +4,7 @@
 #pragma once
 
 #include <common.h>
+#include <footprint.h>
 #include <vulkan/vulkan.hpp>
 
 namespace skyline {
@@ -61,10 +62,10 @@ namespace skyline {
                  * @param width The width of the texture in pixels
                  * @param height The height of the texture in pixels
                  * @param depth The depth of the texture in layers
-                 * @return The size of the texture in bytes
+                 * @return The size of the texture in bytes, partial blocks on the edges of the texture are included
                  */
                 inline constexpr size_t GetSize(u32 width, u32 height, u32 depth = 1) {
-                    return (((width / blockWidth) * (height / blockHeight)) * bpb) * depth;
+                    return ((((width + blockWidth - 1) / blockWidth) * ((height + blockHeight - 1) / blockHeight)) * bpb) * depth;
                 }
 
                 /**
@@ -158,6 +159,8 @@ namespace skyline {
             texture::Format format; //!< The format of the texture
             texture::TileMode tileMode; //!< The tiling mode of the texture
             texture::TileConfig tileConfig; //!< The tiling configuration of the texture
+            std::atomic<bool> dirty{true}; //!< If the guest texture might have been written to since the host texture was last synchronized with it
+            std::atomic<bool> hostModified{}; //!< If the host texture was rendered to since the guest texture was last synchronized with it, the guest texture is stale until it's flushed
 
             GuestTexture(const DeviceState &state, u64 address, texture::Dimensions dimensions, texture::Format format, texture::TileMode tileMode = texture::TileMode::Linear, texture::TileConfig tileConfig = {});
 
@@ -165,6 +168,11 @@ namespace skyline {
                 return format.GetSize(dimensions);
             }
 
+            /**
+             * @return The size of the texture in guest memory, this includes any padding from the tiling mode
+             */
+            size_t GuestSize();
+
             /**
              * @brief This creates a corresponding host texture object for this guest texture
              * @param format The format of the host texture (Defaults to the format of the guest texture)
@@ -198,9 +206,21 @@ namespace skyline {
         class Texture {
           private:
             const DeviceState &state; //!< The state of the device
+            std::atomic<bool> synchronizationPending{}; //!< If the guest texture has been marked clean but hasn't been copied into the host texture yet
+            bool placeholder{}; //!< If the guest format can neither be sampled by the host nor decoded, the texture is left blank rather than being copied from the guest
+
+            /**
+             * @brief This copies the contents of the guest texture into the host texture, deswizzling it if required
+             */
+            void CopyFromGuest();
+
+            /**
+             * @brief This copies the contents of the host texture into the guest texture, swizzling it if required
+             */
+            void CopyToGuest();
 
           public:
-            std::vector<u8> backing; //!< The object that holds a host copy of the guest texture (Will be replaced with a vk::Image)
+            footprint::Vector<u8, footprint::Subsystem::Texture> backing; //!< The object that holds a host copy of the guest texture (Will be replaced with a vk::Image)
             std::shared_ptr<GuestTexture> guest; //!< The corresponding guest texture object
             texture::Dimensions dimensions; //!< The dimensions of the texture
             texture::Format format; //!< The format of the host texture
@@ -240,8 +260,20 @@ namespace skyline {
              */
             void SynchronizeHost();
 
+            /**
+             * @brief This starts tracking writes to the guest texture if it has been modified, the copy into the host texture is deferred to CompleteHostSynchronization
+             * @note This is cheap enough to be done on guest threads while the copy can be done on any thread later, writes after this are caught by the next synchronization
+             */
+            void RequestHostSynchronization();
+
+            /**
+             * @brief This copies the guest texture into the host texture if a synchronization has been requested since the last copy
+             */
+            void CompleteHostSynchronization();
+
             /**
              * @brief This synchronizes the guest texture with the host texture after it has been modified
+             * @note The guest memory is written through the host mapping so this works while the guest pages are protected
              */
             void SynchronizeGuest();
         };
@@ -256,9 +288,16 @@ namespace skyline {
             PresentationTexture(const DeviceState &state, const std::shared_ptr<GuestTexture> &guest, const texture::Dimensions &dimensions, const texture::Format &format, const std::function<void()> &releaseCallback = {});
 
             /**
-             * @return The corresponding Android surface format for the current texture format
+             * @return The Android surface format the texture is presented in when it's copied into the window by the CPU, formats the window doesn't support are converted into RGBA8888
              */
             i32 GetAndroidFormat();
+
+            /**
+             * @brief Copies the texture into a locked window buffer, converting it into the format returned by GetAndroidFormat
+             * @param stride The stride of the window buffer in pixels
+             * @param height The height of the window buffer in lines
+             */
+            void CopyToWindow(u8 *output, u32 stride, u32 height);
         };
     }
 }
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/mman.h>
+#include <asm/unistd.h>
+#include <nce.h>
+#include "texture_cache.h"
+
+namespace skyline::gpu {
+    TextureCache::TextureCache(const DeviceState &state) : state(state) {}
+
+    void TextureCache::Protect(u64 address, u64 size, int protection) {
+        u64 start = util::AlignDown(address, PAGE_SIZE);
+        u64 end = util::AlignUp(address + size, PAGE_SIZE);
+
+        // Any regions that overlap or are adjacent to the new one are merged into it as a fault anywhere in them unprotects all of it
+        u64 regionStart = start, regionEnd = end;
+        auto region = protectedRegions.upper_bound(start);
+        if (region != protectedRegions.begin() && std::prev(region)->second >= start)
+            region--;
+        while (region != protectedRegions.end() && region->first <= end) {
+            regionStart = std::min(regionStart, region->first);
+            regionEnd = std::max(regionEnd, region->second);
+            region = protectedRegions.erase(region);
+        }
+        protectedRegions[regionStart] = regionEnd;
+
+        // Faults on the region have to flush render targets and dirty textures, so the guest can't resolve them on its own even if buffers on the same pages are write-tracked
+        state.nce->SetFaultFlags(start, end - start, FaultTable::KernelProtected);
+
+        Registers fregs{
+            .x0 = start,
+            .x1 = end - start,
+            .x2 = static_cast<u64>(protection),
+            .x8 = __NR_mprotect,
+        };
+
+        state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
+        if (fregs.x0 < 0)
+            throw exception("An error occurred while protecting a texture in the child process");
+    }
+
+    bool TextureCache::OverlapsRenderTarget(u64 address, u64 size) {
+        for (const auto &weakTexture : textures) {
+            auto texture = weakTexture.lock();
+            if (texture && texture->hostModified && texture->address < address + size && (texture->address + texture->GuestSize()) > address)
+                return true;
+        }
+        return false;
+    }
+
+    std::shared_ptr<GuestTexture> TextureCache::FindOrCreate(u64 address, texture::Dimensions dimensions, texture::Format format, texture::TileMode tileMode, texture::TileConfig tileConfig) {
+        std::lock_guard guard(mutex);
+
+        std::erase_if(textures, [](const auto &texture) { return texture.expired(); });
+
+        for (const auto &weakTexture : textures) {
+            auto texture = weakTexture.lock();
+            if (texture && texture->address == address && texture->dimensions == dimensions && texture->format == format && texture->tileMode == tileMode && texture->tileConfig.pitch == tileConfig.pitch)
+                return texture;
+        }
+
+        auto texture = std::make_shared<GuestTexture>(state, address, dimensions, format, tileMode, tileConfig);
+
+        // A render target can't be reinterpreted on the host when the attributes differ, so it's flushed for the new texture to read it from guest memory instead
+        for (const auto &weakTexture : textures) {
+            auto other = weakTexture.lock();
+            if (other && other->hostModified && other->address < address + texture->GuestSize() && (other->address + other->GuestSize()) > address) {
+                other->host->SynchronizeGuest();
+                other->hostModified = false;
+            }
+        }
+
+        textures.push_back(texture);
+        return texture;
+    }
+
+    std::shared_ptr<GuestTexture> TextureCache::Find(u64 address, texture::Dimensions dimensions, texture::Format format, texture::TileMode tileMode, texture::TileConfig tileConfig) {
+        std::lock_guard guard(mutex);
+
+        for (const auto &weakTexture : textures) {
+            auto texture = weakTexture.lock();
+            if (texture && texture->address == address && texture->dimensions == dimensions && texture->format == format && texture->tileMode == tileMode && texture->tileConfig.pitch == tileConfig.pitch)
+                return texture;
+        }
+        return nullptr;
+    }
+
+    void TextureCache::Flush(u64 address, u64 size) {
+        std::lock_guard guard(mutex);
+
+        for (const auto &weakTexture : textures) {
+            auto texture = weakTexture.lock();
+            if (texture && texture->hostModified && texture->address < address + size && (texture->address + texture->GuestSize()) > address) {
+                texture->host->SynchronizeGuest();
+                texture->hostModified = false;
+            }
+        }
+    }
+
+    void TextureCache::Invalidate(u64 address, u64 size) {
+        std::lock_guard guard(mutex);
+
+        // A render target is flushed prior to the write so that flushing it later doesn't overwrite what was written
+        for (const auto &weakTexture : textures) {
+            auto texture = weakTexture.lock();
+            if (texture && texture->address < address + size && (texture->address + texture->GuestSize()) > address) {
+                if (texture->hostModified) {
+                    texture->host->SynchronizeGuest();
+                    texture->hostModified = false;
+                }
+                texture->dirty = true;
+            }
+        }
+    }
+
+    void TextureCache::TrackWrites(GuestTexture &texture) {
+        std::lock_guard guard(mutex);
+
+        // Pages shared with a render target that hasn't been flushed have to stay inaccessible so guest reads of them still fault
+        auto size = texture.GuestSize();
+        Protect(texture.address, size, OverlapsRenderTarget(texture.address, size) ? PROT_NONE : PROT_READ);
+    }
+
+    void TextureCache::MarkRenderTarget(GuestTexture &texture) {
+        if (texture.hostModified)
+            return;
+
+        // Any guest writes to the texture need to be in the host texture prior to it being rendered to, they'd be overwritten when it's flushed otherwise
+        texture.host->SynchronizeHost();
+
+        std::lock_guard guard(mutex);
+        texture.hostModified = true;
+        Protect(texture.address, texture.GuestSize(), PROT_NONE);
+    }
+
+    void TextureCache::ProtectExcludingTextures(std::span<const GuestSyscall> calls) {
+        std::lock_guard guard(mutex);
+
+        // Every call is split around the protected regions it overlaps, the mutex is held till they've been executed so a region can't be protected in between
+        std::vector<GuestSyscall> split;
+        for (const auto &call : calls) {
+            u64 address{call.arguments[0]}, end{call.arguments[0] + call.arguments[1]};
+            auto region{protectedRegions.upper_bound(address)};
+            if (region != protectedRegions.begin() && std::prev(region)->second > address)
+                region--;
+
+            for (; address < end && region != protectedRegions.end() && region->first < end; region++) {
+                if (region->first > address)
+                    split.push_back(GuestSyscall{.number = call.number, .arguments = {address, region->first - address, call.arguments[2]}});
+                address = std::max(address, region->second);
+            }
+
+            if (address < end)
+                split.push_back(GuestSyscall{.number = call.number, .arguments = {address, end - address, call.arguments[2]}});
+        }
+
+        state.nce->ExecuteSyscalls(split);
+        for (const auto &syscall : split)
+            if (syscall.result < 0)
+                throw exception("An error occurred while protecting guest memory around textures in the child process");
+    }
+
+    std::optional<TextureCache::Region> TextureCache::HandleFault(u64 address) {
+        std::lock_guard guard(mutex);
+
+        auto region = protectedRegions.upper_bound(address);
+        if (region == protectedRegions.begin() || (--region)->second <= address)
+            return std::nullopt;
+
+        u64 start = region->first, end = region->second;
+        protectedRegions.erase(region);
+        state.nce->ClearFaultFlags(start, end - start, FaultTable::KernelProtected);
+
+        // Every texture on the region loses write tracking, not just the one that was accessed, render targets are flushed as the guest can read them after this
+        for (const auto &weakTexture : textures) {
+            auto texture = weakTexture.lock();
+            if (texture && texture->address < end && (texture->address + texture->GuestSize()) > start) {
+                if (texture->hostModified) {
+                    texture->host->SynchronizeGuest();
+                    texture->hostModified = false;
+                }
+                texture->dirty = true;
+            }
+        }
+
+        return Region{start, end - start};
+    }
+}
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+#include "texture.h"
+
+namespace skyline::gpu {
+    /**
+     * @brief The TextureCache class deduplicates guest textures and tracks guest writes to them so unchanged textures don't need to be synchronized
+     * @note Writes are tracked by write-protecting the pages of a texture in the guest after it's synchronized, the first write to them faults and marks any textures on them as dirty
+     * @note Render targets are kept on the host until the guest accesses them, their pages are made inaccessible so the first guest read or write faults and flushes them into guest memory
+     */
+    class TextureCache {
+      public:
+        /**
+         * @brief This describes a region of guest memory
+         */
+        struct Region {
+            u64 address;
+            u64 size;
+        };
+
+      private:
+        const DeviceState &state; //!< The state of the device
+        Mutex mutex; //!< This mutex guards all members of the cache
+        std::vector<std::weak_ptr<GuestTexture>> textures; //!< All textures that have been created by the cache and might still be alive
+        std::map<u64, u64> protectedRegions; //!< A map from the start of every non-overlapping write-protected region to its end
+
+        /**
+         * @brief This protects a region of guest memory and merges it into the protected regions
+         * @note The mutex must be locked when calling this
+         */
+        void Protect(u64 address, u64 size, int protection);
+
+        /**
+         * @return If any render target that hasn't been flushed into guest memory overlaps the supplied region
+         * @note The mutex must be locked when calling this
+         */
+        bool OverlapsRenderTarget(u64 address, u64 size);
+
+      public:
+        TextureCache(const DeviceState &state);
+
+        /**
+         * @return A guest texture with the supplied attributes, an existing one is returned if it's still alive
+         * @note Render targets that alias the texture with different attributes are flushed into guest memory so the texture reads what was rendered to them
+         */
+        std::shared_ptr<GuestTexture> FindOrCreate(u64 address, texture::Dimensions dimensions, texture::Format format, texture::TileMode tileMode = texture::TileMode::Linear, texture::TileConfig tileConfig = {});
+
+        /**
+         * @return The guest texture with the supplied attributes if it's still alive, this is nullptr otherwise
+         */
+        std::shared_ptr<GuestTexture> Find(u64 address, texture::Dimensions dimensions, texture::Format format, texture::TileMode tileMode = texture::TileMode::Linear, texture::TileConfig tileConfig = {});
+
+        /**
+         * @brief Flushes any render targets overlapping a region into guest memory, this is used prior to the GPU reading guest memory directly
+         */
+        void Flush(u64 address, u64 size);
+
+        /**
+         * @brief Flushes any render targets overlapping a region into guest memory and marks all textures overlapping it as dirty, this is used prior to the GPU writing to guest memory directly
+         * @note Writes by the GPU aren't caught by write tracking as they don't go through the guest's mappings
+         */
+        void Invalidate(u64 address, u64 size);
+
+        /**
+         * @brief This write-protects the pages backing a texture in the guest so any subsequent guest writes to it mark it as dirty
+         * @note This must be called prior to reading the contents of the texture to avoid missing any writes
+         */
+        void TrackWrites(GuestTexture &texture);
+
+        /**
+         * @brief This marks a texture as having been rendered to by the host, the guest texture isn't written to until the guest accesses it
+         * @note The texture must have a host texture, it's synchronized with the guest prior to being marked
+         */
+        void MarkRenderTarget(GuestTexture &texture);
+
+        /**
+         * @brief Executes a batch of mprotect calls in the guest without changing the protection of any pages protected by the texture cache, so the buffer cache re-arming write tracking can't make the pages of a render target readable
+         * @note Skipping those pages doesn't lose any writes, a fault on them always goes through the kernel which invalidates the buffers on them
+         */
+        void ProtectExcludingTextures(std::span<const GuestSyscall> calls);
+
+        /**
+         * @brief Handles a guest access fault by flushing any render targets in the protected region containing the address and marking all textures in it as dirty
+         * @return The region that needs to be made writable in the guest, this is std::nullopt if the fault wasn't caused by the texture cache
+         */
+        std::optional<Region> HandleFault(u64 address);
+    };
+}
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "texture_decoder.h"
+
+namespace skyline::gpu::decoder {
+    // Reference on BCn compression: https://docs.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression
+    constexpr u8 BlockSize{4}; //!< The width and height of a BCn block in texels
+
+    using Texel = std::array<u8, 4>; //!< A single RGBA8888 texel
+    using Block = std::array<Texel, BlockSize * BlockSize>; //!< The texels of a single block in rows
+    using BlockDecoder = void (*)(const u8 *input, Block &block);
+
+    /**
+     * @return An RGB565 color expanded into an opaque RGBA8888 texel, the high bits of every channel are replicated into its low bits
+     */
+    constexpr Texel ExpandRgb565(u16 color) {
+        u8 red{static_cast<u8>((color >> 11) & 0x1F)}, green{static_cast<u8>((color >> 5) & 0x3F)}, blue{static_cast<u8>(color & 0x1F)};
+        return {static_cast<u8>((red << 3) | (red >> 2)), static_cast<u8>((green << 2) | (green >> 4)), static_cast<u8>((blue << 3) | (blue >> 2)), 0xFF};
+    }
+
+    /**
+     * @brief Decodes the color half of a BC1, BC2 or BC3 block
+     * @param punchthrough If the block uses 3 colors and transparent black when its first endpoint isn't greater than its second, this is only the case for BC1
+     */
+    void DecodeColor(const u8 *input, Block &block, bool punchthrough) {
+        u16 color0, color1;
+        u32 indices;
+        std::memcpy(&color0, input, sizeof(u16));
+        std::memcpy(&color1, input + sizeof(u16), sizeof(u16));
+        std::memcpy(&indices, input + (sizeof(u16) * 2), sizeof(u32));
+
+        std::array<Texel, 4> palette{ExpandRgb565(color0), ExpandRgb565(color1)};
+        if (color0 > color1 || !punchthrough) {
+            for (size_t channel{}; channel < 3; channel++) {
+                palette[2][channel] = static_cast<u8>(((2 * palette[0][channel]) + palette[1][channel]) / 3);
+                palette[3][channel] = static_cast<u8>((palette[0][channel] + (2 * palette[1][channel])) / 3);
+            }
+            palette[2][3] = palette[3][3] = 0xFF;
+        } else {
+            for (size_t channel{}; channel < 3; channel++)
+                palette[2][channel] = static_cast<u8>((palette[0][channel] + palette[1][channel]) / 2);
+            palette[2][3] = 0xFF;
+            palette[3] = {};
+        }
+
+        for (size_t texel{}; texel < block.size(); texel++)
+            block[texel] = palette[(indices >> (texel * 2)) & 0b11];
+    }
+
+    /**
+     * @brief Decodes a single channel that's interpolated between two 8-bit endpoints with 3-bit indices, this is the alpha half of BC3 blocks and the channels of BC4 and BC5 blocks
+     * @param channel The channel of the texels in the block that's written to
+     */
+    void DecodeInterpolated(const u8 *input, Block &block, size_t channel) {
+        u8 value0{input[0]}, value1{input[1]};
+        u64 indices{};
+        std::memcpy(&indices, input + 2, 6);
+
+        std::array<u8, 8> palette{value0, value1};
+        if (value0 > value1) {
+            for (u32 index{1}; index < 7; index++)
+                palette[index + 1] = static_cast<u8>((((7 - index) * value0) + (index * value1)) / 7);
+        } else {
+            for (u32 index{1}; index < 5; index++)
+                palette[index + 1] = static_cast<u8>((((5 - index) * value0) + (index * value1)) / 5);
+            palette[6] = 0x00;
+            palette[7] = 0xFF;
+        }
+
+        for (size_t texel{}; texel < block.size(); texel++)
+            block[texel][channel] = palette[(indices >> (texel * 3)) & 0b111];
+    }
+
+    void DecodeBc1(const u8 *input, Block &block) {
+        DecodeColor(input, block, true);
+    }
+
+    void DecodeBc2(const u8 *input, Block &block) {
+        DecodeColor(input + sizeof(u64), block, false);
+
+        u64 alpha;
+        std::memcpy(&alpha, input, sizeof(u64));
+        for (size_t texel{}; texel < block.size(); texel++)
+            block[texel][3] = static_cast<u8>(((alpha >> (texel * 4)) & 0xF) * 0x11);
+    }
+
+    void DecodeBc3(const u8 *input, Block &block) {
+        DecodeColor(input + sizeof(u64), block, false);
+        DecodeInterpolated(input, block, 3);
+    }
+
+    void DecodeBc4(const u8 *input, Block &block) {
+        block.fill({0, 0, 0, 0xFF});
+        DecodeInterpolated(input, block, 0);
+    }
+
+    void DecodeBc5(const u8 *input, Block &block) {
+        block.fill({0, 0, 0, 0xFF});
+        DecodeInterpolated(input, block, 0);
+        DecodeInterpolated(input + sizeof(u64), block, 1);
+    }
+
+    /**
+     * @return The function which decodes a single block of the supplied format, this is nullptr if the format can't be decoded
+     */
+    BlockDecoder GetBlockDecoder(texture::Format format) {
+        switch (format.vkFormat) {
+            case vk::Format::eBc1RgbaUnormBlock:
+                return DecodeBc1;
+            case vk::Format::eBc2UnormBlock:
+                return DecodeBc2;
+            case vk::Format::eBc3UnormBlock:
+                return DecodeBc3;
+            case vk::Format::eBc4UnormBlock:
+                return DecodeBc4;
+            case vk::Format::eBc5UnormBlock:
+                return DecodeBc5;
+            default:
+                return nullptr;
+        }
+    }
+
+    bool CanDecode(texture::Format format) {
+        return GetBlockDecoder(format) != nullptr;
+    }
+
+    void Decode(texture::Format format, const u8 *input, size_t inputStride, u8 *output, u32 width, u32 height) {
+        constexpr size_t ThreadedDecodeThreshold{1 << 20}; //!< The minimum size of the decoded texture in bytes for it to be decoded with multiple threads
+
+        auto decodeBlock{GetBlockDecoder(format)};
+        if (!decodeBlock)
+            throw exception("Decoding textures of format {} isn't supported", static_cast<u32>(format.vkFormat));
+
+        u32 blockCountX{(width + BlockSize - 1) / BlockSize}, blockCountY{(height + BlockSize - 1) / BlockSize};
+        size_t outputStride{static_cast<size_t>(width) * sizeof(Texel)};
+
+        // Rows of blocks are independent of each other, so any range of them can be decoded without knowledge of the others
+        auto decodeRows{[=](u32 rowStart, u32 rowEnd) {
+            Block block;
+            for (u32 row{rowStart}; row < rowEnd; row++) {
+                auto inputBlock{input + (static_cast<size_t>(row) * inputStride)};
+                auto outputRow{output + (static_cast<size_t>(row) * BlockSize * outputStride)};
+                auto lineCount{std::min<u32>(BlockSize, height - (row * BlockSize))};
+                for (u32 column{}; column < blockCountX; column++) {
+                    decodeBlock(inputBlock, block);
+                    auto texelCount{std::min<u32>(BlockSize, width - (column * BlockSize))};
+                    for (u32 line{}; line < lineCount; line++)
+                        std::memcpy(outputRow + (line * outputStride) + (column * BlockSize * sizeof(Texel)), &block[line * BlockSize], texelCount * sizeof(Texel));
+                    inputBlock += format.bpb;
+                }
+            }
+        }};
+
+        auto threadCount{std::min(std::max(std::thread::hardware_concurrency(), 1U), blockCountY)};
+        if (outputStride * height >= ThreadedDecodeThreshold && threadCount > 1) {
+            // Large textures are split into contiguous ranges of rows with the calling thread decoding the last range
+            auto rowsPerThread{(blockCountY + threadCount - 1) / threadCount};
+
+            std::vector<std::thread> threads;
+            threads.reserve(threadCount - 1);
+            u32 row{};
+            for (; row + rowsPerThread < blockCountY; row += rowsPerThread)
+                threads.emplace_back(decodeRows, row, row + rowsPerThread);
+
+            decodeRows(row, blockCountY);
+
+            for (auto &thread : threads)
+                thread.join();
+        } else {
+            decodeRows(0, blockCountY);
+        }
+    }
+}
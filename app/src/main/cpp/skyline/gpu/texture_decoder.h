@@ -0,0 +1,22 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "texture.h"
+
+namespace skyline::gpu::decoder {
+    /**
+     * @return If textures in the supplied compressed format can be decoded on the CPU
+     */
+    bool CanDecode(texture::Format format);
+
+    /**
+     * @brief Decodes a pitch-linear compressed texture into RGBA8888 texels, large textures are decoded on multiple threads
+     * @param input The blocks of the texture in rows
+     * @param inputStride The distance between two rows of blocks in the input in bytes
+     * @param output The texels of the texture, they're tightly packed in rows of the supplied width
+     * @note Partial blocks on the right and bottom edges are decoded with the texels outside the texture discarded
+     */
+    void Decode(texture::Format format, const u8 *input, size_t inputStride, u8 *output, u32 width, u32 height);
+}
@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <fstream>
+#include <sstream>
+#include <numeric>
+#include "profiler.h"
+#include "perf_stats.h"
+#include "boot_report.h"
+#include "footprint.h"
+#include "headless.h"
+
+namespace skyline::headless {
+    Options HeadlessOptions;
+    BenchmarkReport Benchmark;
+
+    ScriptedInput::ScriptedInput(std::shared_ptr<input::Input> input, const std::string &path) : input(std::move(input)) {
+        std::ifstream script(path);
+        if (!script)
+            throw exception("Failed to open the input script at {}", path);
+
+        std::string line;
+        for (size_t lineNumber{1}; std::getline(script, line); lineNumber++) {
+            std::istringstream stream(line);
+            u64 time;
+            std::string type;
+            if (!(stream >> time))
+                continue; // Empty lines and comments don't start with a time
+
+            input::InputEvent event{};
+            i32 index;
+            stream >> type >> index;
+            event.index = index;
+            if (type == "button") {
+                event.type = input::InputEventType::Button;
+                stream >> std::hex >> event.button.mask >> std::dec >> event.button.pressed;
+            } else if (type == "axis") {
+                u32 axis;
+                event.type = input::InputEventType::Axis;
+                stream >> axis >> event.axis.value;
+                event.axis.axis = static_cast<input::NpadAxisId>(axis);
+            } else {
+                throw exception("Unknown event type '{}' on line {} of the input script", type, lineNumber);
+            }
+
+            if (stream.fail())
+                throw exception("Malformed event on line {} of the input script", lineNumber);
+
+            events.push_back(ScriptedEvent{time * (constant::NsInSecond / 1000), event});
+        }
+
+        thread = std::thread(&ScriptedInput::Run, this);
+    }
+
+    ScriptedInput::~ScriptedInput() {
+        {
+            std::lock_guard lock(mutex);
+            exit = true;
+        }
+        exitConditional.notify_all();
+        thread.join();
+    }
+
+    void ScriptedInput::Run() {
+        auto start{std::chrono::steady_clock::now()};
+        std::unique_lock lock(mutex);
+        for (auto &scriptedEvent : events) {
+            if (exitConditional.wait_until(lock, start + std::chrono::nanoseconds(scriptedEvent.time), [this] { return exit; }))
+                return;
+
+            // Events are pushed one at a time as they're spaced apart, the queue is only full if the sampler has stopped
+            while (!input->PushEvents(std::span(&scriptedEvent.event, 1)))
+                if (exitConditional.wait_for(lock, std::chrono::milliseconds(1), [this] { return exit; }))
+                    return;
+        }
+    }
+
+    void BenchmarkReport::Start() {
+        std::lock_guard lock(mutex);
+        frameTimes.clear();
+        peakFootprint = 0;
+        startTimestamp = util::GetTimeNs();
+    }
+
+    void BenchmarkReport::OnFrame(u64 frameTime) {
+        if (HeadlessOptions.reportPath.empty())
+            return;
+
+        std::lock_guard lock(mutex);
+        if (frameTime)
+            frameTimes.push_back(static_cast<u32>(frameTime / 1000));
+        peakFootprint = std::max(peakFootprint, footprint::GetTotal());
+    }
+
+    namespace {
+        /**
+         * @return The peak resident set size of the emulator in bytes, this is 0 if it couldn't be read
+         */
+        u64 GetPeakResidentSetSize() {
+            std::ifstream status("/proc/self/status");
+            std::string line;
+            while (std::getline(status, line))
+                if (line.starts_with("VmHWM:"))
+                    return std::strtoull(line.c_str() + std::char_traits<char>::length("VmHWM:"), nullptr, 10) * 1024;
+            return 0;
+        }
+
+        /**
+         * @return The numeric members of the "metrics" object of a benchmark report, members that aren't numbers (such as null) are skipped
+         * @note This isn't a general JSON parser, it relies on the metrics being a flat object which is what Emit writes
+         */
+        std::vector<std::pair<std::string, double>> ParseMetrics(const std::string &report) {
+            std::vector<std::pair<std::string, double>> metrics;
+            auto position{report.find("\"metrics\"")};
+            if (position == std::string::npos || (position = report.find('{', position)) == std::string::npos)
+                return metrics;
+
+            auto end{report.find('}', position)};
+            while ((position = report.find('"', position)) < end) {
+                auto nameEnd{report.find('"', position + 1)};
+                auto name{report.substr(position + 1, nameEnd - position - 1)};
+                position = report.find(':', nameEnd) + 1;
+
+                char *valueEnd;
+                auto value{std::strtod(report.c_str() + position, &valueEnd)};
+                if (valueEnd != report.c_str() + position)
+                    metrics.emplace_back(std::move(name), value);
+                position = report.find_first_of(",}", position);
+            }
+            return metrics;
+        }
+    }
+
+    bool BenchmarkReport::Emit(Logger &logger, CallProfiler *profiler) {
+        constexpr size_t ReportedCallCount{32}; //!< The amount of the most expensive calls that are included in the report
+
+        if (HeadlessOptions.reportPath.empty())
+            return true;
+
+        std::lock_guard lock(mutex);
+        auto duration{static_cast<double>(util::GetTimeNs() - startTimestamp) / constant::NsInSecond};
+        auto toMs{[](u64 time) { return static_cast<double>(time) / constant::NsInMillisecond; }};
+        auto toMiB{[](u64 size) { return static_cast<double>(size) / (1024 * 1024); }};
+
+        std::vector<std::pair<std::string, double>> metrics;
+        if (!frameTimes.empty()) {
+            auto sorted{frameTimes};
+            std::sort(sorted.begin(), sorted.end());
+            auto percentile{[&](size_t numerator) { return static_cast<double>(sorted[(sorted.size() * numerator) / 100]) / 1000; }};
+            auto total{std::accumulate(sorted.begin(), sorted.end(), u64{})};
+
+            metrics.emplace_back("frame_time_average_ms", static_cast<double>(total) / static_cast<double>(sorted.size()) / 1000);
+            metrics.emplace_back("frame_time_p50_ms", percentile(50));
+            metrics.emplace_back("frame_time_p99_ms", percentile(99));
+            metrics.emplace_back("frame_time_max_ms", static_cast<double>(sorted.back()) / 1000);
+        }
+
+        if (auto firstFrame{boot::Report.GetFirstFrameTime()})
+            metrics.emplace_back("first_queue_buffer_ms", toMs(firstFrame));
+
+        std::vector<CallProfiler::Entry> calls;
+        if (profiler) {
+            calls = profiler->GetSnapshot();
+
+            // The time spent in calls scales with the amount of frames that were presented, so it's normalized to a frame to be comparable across runs of the same duration
+            if (!frameTimes.empty()) {
+                u64 svcTime{}, ipcTime{};
+                for (const auto &entry : calls)
+                    (entry.name.starts_with("svc") ? svcTime : ipcTime) += entry.statistics.totalTime;
+                metrics.emplace_back("svc_time_per_frame_ms", toMs(svcTime) / static_cast<double>(frameTimes.size()));
+                metrics.emplace_back("ipc_time_per_frame_ms", toMs(ipcTime) / static_cast<double>(frameTimes.size()));
+            }
+        }
+
+        if (auto peakResidentSetSize{GetPeakResidentSetSize()})
+            metrics.emplace_back("peak_rss_mib", toMiB(peakResidentSetSize));
+        metrics.emplace_back("peak_footprint_mib", toMiB(peakFootprint));
+
+        struct Regression {
+            std::string_view metric;
+            double value;
+            double baseline;
+        };
+        std::vector<Regression> regressions;
+        if (!HeadlessOptions.baselinePath.empty()) {
+            std::ifstream file(HeadlessOptions.baselinePath);
+            if (file) {
+                std::string baseline{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+                auto threshold{1.0 + static_cast<double>(HeadlessOptions.regressionThreshold) / 100};
+                for (const auto &[name, baselineValue] : ParseMetrics(baseline)) {
+                    auto metric{std::find_if(metrics.begin(), metrics.end(), [&name = name](const auto &metric) { return metric.first == name; })};
+                    if (metric != metrics.end() && baselineValue > 0 && metric->second > baselineValue * threshold)
+                        regressions.push_back(Regression{metric->first, metric->second, baselineValue});
+                }
+            } else {
+                logger.Warn("Cannot open the benchmark baseline at {}", HeadlessOptions.baselinePath);
+            }
+        }
+
+        std::string output{fmt::format("{{\"duration_s\": {:.3f}, \"frame_count\": {}, \"metrics\": {{", duration, frameTimes.size())};
+        for (size_t index{}; index < metrics.size(); index++)
+            fmt::format_to(std::back_inserter(output), "{}\"{}\": {:.3f}", index ? ", " : "", metrics[index].first, metrics[index].second);
+
+        fmt::format_to(std::back_inserter(output), "}}, \"boot\": {}, \"calls\": [", boot::Report.Format());
+        for (size_t index{}; index < calls.size() && index < ReportedCallCount; index++) {
+            const auto &[name, statistics]{calls[index]};
+            fmt::format_to(std::back_inserter(output), "{}{{\"name\": \"{}\", \"count\": {}, \"total_ms\": {:.3f}, \"p50_ns\": {}, \"p99_ns\": {}, \"max_ns\": {}}}", index ? ", " : "", name, statistics.count, toMs(statistics.totalTime), statistics.GetPercentile(0.5), statistics.GetPercentile(0.99), statistics.maxTime);
+        }
+
+        output += "], \"memory\": {";
+        const auto &statistics{perf::Monitor.block};
+        fmt::format_to(std::back_inserter(output), "\"resident_set_size\": {}, \"subsystems\": [", statistics.residentSetSize);
+        for (size_t subsystem{}; subsystem < statistics.subsystemMemory.size(); subsystem++)
+            fmt::format_to(std::back_inserter(output), "{}{}", subsystem ? ", " : "", statistics.subsystemMemory[subsystem]);
+
+        output += "]}, \"regressions\": [";
+        for (size_t index{}; index < regressions.size(); index++) {
+            const auto &regression{regressions[index]};
+            fmt::format_to(std::back_inserter(output), "{}{{\"metric\": \"{}\", \"value\": {:.3f}, \"baseline\": {:.3f}}}", index ? ", " : "", regression.metric, regression.value, regression.baseline);
+            logger.Warn("Benchmark regression in {}: {:.3f} against a baseline of {:.3f} (+{:.1f}%)", regression.metric, regression.value, regression.baseline, ((regression.value / regression.baseline) - 1) * 100);
+        }
+        fmt::format_to(std::back_inserter(output), "], \"passed\": {}}}", regressions.empty());
+
+        std::ofstream file(HeadlessOptions.reportPath, std::ios::trunc);
+        file << output << '\n';
+        if (!file)
+            logger.Warn("Cannot write the benchmark report to {}", HeadlessOptions.reportPath);
+        logger.Info("Benchmark report: {}", output);
+
+        return regressions.empty();
+    }
+}
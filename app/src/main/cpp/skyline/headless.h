@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <thread>
+#include <condition_variable>
+#include "input.h"
+
+namespace skyline {
+    class CallProfiler;
+}
+
+namespace skyline::headless {
+    /**
+     * @brief The options for running emulation without a Surface, this is used for benchmarking where nothing is displayed
+     */
+    struct Options {
+        bool enabled{}; //!< If emulation is headless, frames are presented to a null sink and the Surface is ignored
+        u32 runDuration{}; //!< The duration after which emulation is halted in seconds, it runs indefinitely if this is 0
+        u32 frameDumpInterval{}; //!< The interval between frames that are dumped to files, no frames are dumped if this is 0
+        std::string inputScript; //!< The path to a script of input events to replay during emulation, no input is scripted if this is empty
+        std::string reportPath; //!< The path the benchmark report is written to when emulation ends, no report is written if this is empty
+        std::string baselinePath; //!< The path to a benchmark report that the report is compared against, no comparison is done if this is empty
+        u32 regressionThreshold{5}; //!< The percentage by which a metric can be worse than its baseline before it's flagged as a regression
+    };
+
+    extern Options HeadlessOptions; //!< The headless options of the current emulation session, these are set by the frontend prior to emulation starting
+
+    /**
+     * @brief The ScriptedInput class replays a script of input events at fixed times relative to its construction
+     * @details Every non-empty line of the script that doesn't start with '#' is an event in one of the following forms, times are in milliseconds and are expected to be in increasing order:
+     * "<time> button <controller index> <button mask in hex> <pressed (0 or 1)>"
+     * "<time> axis <controller index> <axis (0-3)> <value>"
+     */
+    class ScriptedInput {
+      private:
+        struct ScriptedEvent {
+            u64 time; //!< The time the event is pushed at relative to the start of the script in nanoseconds
+            input::InputEvent event;
+        };
+
+        std::shared_ptr<input::Input> input;
+        std::vector<ScriptedEvent> events;
+        std::mutex mutex;
+        std::condition_variable exitConditional;
+        bool exit{};
+        std::thread thread; //!< The thread which pushes events at their scheduled time, this is declared last so it's started after the script has been parsed
+
+        void Run();
+
+      public:
+        /**
+         * @param path The path to the script
+         */
+        ScriptedInput(std::shared_ptr<input::Input> input, const std::string &path);
+
+        ~ScriptedInput();
+    };
+
+    /**
+     * @brief The BenchmarkReport class records the frame-times of a headless run and writes them into a JSON report when it ends, along with the boot phases, the most expensive calls and the memory usage
+     * @details The report has a flat "metrics" object where lower is always better, these are compared against the same object of a baseline report and any that are worse by more than the regression threshold are listed under "regressions"
+     * @note The subsystem memory under "memory" is indexed by footprint::Subsystem and is from the last time the performance monitor updated it
+     */
+    class BenchmarkReport {
+      private:
+        std::mutex mutex;
+        std::vector<u32> frameTimes; //!< The frame-times of every presented frame in microseconds
+        u64 startTimestamp{}; //!< The time at which the run started in nanoseconds
+        u64 peakFootprint{}; //!< The highest amount of host memory accounted to subsystems at any presented frame in bytes
+
+      public:
+        /**
+         * @brief Resets the report and starts timing a run
+         */
+        void Start();
+
+        /**
+         * @param frameTime The time since the previous frame was presented in nanoseconds, this is 0 for the first frame
+         */
+        void OnFrame(u64 frameTime);
+
+        /**
+         * @brief Writes the report to the report path of the headless options and compares it against the baseline, this is a no-op if there's no report path
+         * @param profiler The profiler of the run, this may be nullptr if emulation failed to start
+         * @return If no metric regressed relative to the baseline, this is always true if there's no baseline
+         */
+        bool Emit(Logger &logger, CallProfiler *profiler);
+    };
+
+    extern BenchmarkReport Benchmark; //!< The benchmark report of the current emulation session, this is a global as it's fed by the presentation thread and emitted after the OS has been destroyed
+}
@@ -4,5 +4,78 @@
 #include "input.h"
 
 namespace skyline::input {
-    Input::Input(const DeviceState &state) : state(state), kHid(std::make_shared<kernel::type::KSharedMemory>(state, NULL, sizeof(HidSharedMemory), memory::Permission(true, false, false))), hid(reinterpret_cast<HidSharedMemory *>(kHid->kernel.address)), npad(state, hid), touch(state, hid) {}
+    Input::Input(const DeviceState &state) : state(state), kHid(std::make_shared<kernel::type::KSharedMemory>(state, NULL, sizeof(HidSharedMemory), memory::Permission(true, false, false))), hid(reinterpret_cast<HidSharedMemory *>(kHid->kernel.address)), npad(state, hid), touch(state, hid), samplingInterval(std::chrono::milliseconds(state.settings->Get().inputSamplingInterval)), motion(state.settings->Get().motionControls ? std::make_unique<MotionSensor>() : nullptr), samplerThread(&Input::Sampler, this) {}
+
+    Input::~Input() {
+        samplerExit = true;
+        if (samplerThread.joinable())
+            samplerThread.join();
+    }
+
+    size_t Input::PushEvents(std::span<InputEvent> newEvents) {
+        return events.Push(newEvents, [](const InputEvent &event) { return event; });
+    }
+
+    void Input::ProcessEvents() {
+        std::optional<u32> touchCount;
+
+        InputEvent event;
+        while (events.Pop(event)) {
+            switch (event.type) {
+                case InputEventType::Button:
+                case InputEventType::Axis: {
+                    if (static_cast<u32>(event.index) >= constant::ControllerCount)
+                        break;
+
+                    auto device{npad.controllers[event.index].device};
+                    if (!device)
+                        break;
+
+                    if (event.type == InputEventType::Button)
+                        device->SetButtonState(NpadButton{.raw = event.button.mask}, event.button.pressed);
+                    else
+                        device->SetAxisValue(event.axis.axis, event.axis.value);
+                    break;
+                }
+
+                case InputEventType::TouchPoint:
+                    if (static_cast<u32>(event.index) < constant::TouchPointCount)
+                        touchPoints[event.index] = event.point;
+                    break;
+
+                case InputEventType::TouchCommit:
+                    touchCount = std::min<u32>(event.touchCount, constant::TouchPointCount);
+                    break;
+            }
+        }
+
+        if (touchCount)
+            touch.SetState(std::span(touchPoints.data(), *touchCount));
+    }
+
+    void Input::Sampler() {
+        auto nextSample{std::chrono::steady_clock::now()};
+        while (!samplerExit) {
+            {
+                std::lock_guard guard(npad.mutex);
+                ProcessEvents();
+
+                // The host only has a single IMU, so its state is used for every controller
+                auto sixAxisState{motion ? motion->GetState() : std::nullopt};
+                for (auto &device : npad.npads) {
+                    if (sixAxisState)
+                        device.SetSixAxisState(*sixAxisState);
+                    device.UpdateSharedMemory();
+                }
+            }
+            touch.UpdateSharedMemory();
+
+            // If we fall behind then samples are skipped rather than written in a burst to catch up, as the guest only ever cares about the latest state
+            nextSample += samplingInterval;
+            auto now{std::chrono::steady_clock::now()};
+            if (nextSample < now)
+                nextSample = now;
+            std::this_thread::sleep_until(nextSample);
+        }
+    }
 }
@@ -5,25 +5,97 @@
 
 #include "common.h"
 #include "kernel/types/KSharedMemory.h"
+#include "gpu/circular_queue.h"
 #include "input/shared_mem.h"
 #include "input/npad.h"
 #include "input/touch.h"
+#include "input/motion.h"
 
-namespace skyline::input {
-    /**
-     * @brief The Input class manages translating host input to guest input
-     */
-    class Input {
-      private:
-        const DeviceState &state;
+namespace skyline {
+    namespace constant {
+        constexpr size_t InputEventQueueSize = 0x400; //!< The maximum amount of host input events that can be pending processing
+    }
 
-      public:
-        std::shared_ptr<kernel::type::KSharedMemory> kHid; //!< The kernel shared memory object for HID Shared Memory
-        HidSharedMemory *hid; //!< A pointer to HID Shared Memory on the host
+    namespace input {
+        /**
+         * @brief This enumerates the types of host input events
+         */
+        enum class InputEventType : u32 {
+            Button, //!< The state of buttons on a controller has changed
+            Axis, //!< The value of an axis on a controller has changed
+            TouchPoint, //!< A single point of the touch-screen, these are followed by a TouchCommit
+            TouchCommit, //!< The touch-screen state has been fully described by the preceding TouchPoint events
+        };
 
-        NpadManager npad;
-        TouchManager touch;
+        /**
+         * @brief A single host input event, these are written into a direct ByteBuffer by EmulationActivity and passed in batches
+         * @note The layout of this structure is mirrored in Kotlin, any changes to it need to be reflected there
+         */
+        struct InputEvent {
+            InputEventType type;
+            i32 index; //!< The index of the controller for Button/Axis events or the index of the point for TouchPoint events
+            union {
+                struct {
+                    u64 mask; //!< A bit-field mask of all the buttons to change
+                    u32 pressed; //!< If the buttons were pressed or released
+                } button;
 
-        Input(const DeviceState &state);
-    };
+                struct {
+                    NpadAxisId axis;
+                    i32 value;
+                } axis;
+
+                TouchScreenPoint point;
+
+                u32 touchCount; //!< The amount of points that are being touched for TouchCommit events
+            };
+        };
+        static_assert(sizeof(InputEvent) == 0x20);
+
+        /**
+         * @brief The Input class manages translating host input to guest input
+         * @details Host input events are queued by the JNI thread and applied by a sampler thread, which writes the state of every device into HID Shared Memory at a fixed interval like the HID sysmodule does
+         */
+        class Input {
+          private:
+            const DeviceState &state;
+            gpu::CircularQueue<InputEvent, constant::InputEventQueueSize> events; //!< A queue of host input events that haven't been processed yet, this is filled by the JNI thread
+            std::array<TouchScreenPoint, constant::TouchPointCount> touchPoints{}; //!< The touch-screen points that have been received since the last TouchCommit
+
+            /**
+             * @brief Applies all queued host input events to the host state of the controllers and touch-screen
+             */
+            void ProcessEvents();
+
+            /**
+             * @brief The entry point of the sampler thread, this processes events and writes a new entry for every device on every interval
+             */
+            void Sampler();
+
+          public:
+            std::shared_ptr<kernel::type::KSharedMemory> kHid; //!< The kernel shared memory object for HID Shared Memory
+            HidSharedMemory *hid; //!< A pointer to HID Shared Memory on the host
+
+            NpadManager npad;
+            TouchManager touch;
+
+          private:
+            std::unique_ptr<MotionSensor> motion; //!< The reader of the host's IMU, this is nullptr if motion controls are disabled
+            std::chrono::nanoseconds samplingInterval; //!< The interval at which the state of all devices is written to HID Shared Memory
+            std::atomic<bool> samplerExit{false}; //!< If the sampler thread should exit
+            std::thread samplerThread; //!< The thread which samples host input, this is declared last so it's started after and joined before all the state it uses
+
+          public:
+            Input(const DeviceState &state);
+
+            ~Input();
+
+            /**
+             * @brief Queues host input events to be processed
+             * @return The amount of events that were queued, any events past this were dropped as the queue is full
+             * @note This must only be called from a single thread at a time
+             */
+            size_t PushEvents(std::span<InputEvent> newEvents);
+        };
+    }
 }
@@ -0,0 +1,127 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <android/looper.h>
+#include <android/sensor.h>
+#include <cmath>
+#include "motion.h"
+
+namespace skyline::input {
+    namespace {
+        constexpr float Tau{6.283185307f};
+        constexpr int PollTimeout{100}; //!< The maximum duration the looper is polled for in milliseconds, the exit flag is checked after every poll
+
+        /**
+         * @return A vector from the frame of the host device in its natural orientation converted into the frame of a Switch held in landscape
+         */
+        SixAxisVector ToLandscape(const ASensorVector &vector) {
+            return {-vector.y, vector.x, vector.z};
+        }
+
+        SixAxisVector Cross(const SixAxisVector &a, const SixAxisVector &b) {
+            return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+        }
+    }
+
+    MotionSensor::MotionSensor() : thread(&MotionSensor::Run, this) {}
+
+    MotionSensor::~MotionSensor() {
+        exit = true;
+        if (thread.joinable())
+            thread.join();
+    }
+
+    void MotionSensor::Run() {
+        pthread_setname_np(pthread_self(), "Sky-Motion");
+
+        auto manager{ASensorManager_getInstanceForPackage("emu.skyline")};
+        auto accelerometer{manager ? ASensorManager_getDefaultSensor(manager, ASENSOR_TYPE_ACCELEROMETER) : nullptr};
+        auto gyroscope{manager ? ASensorManager_getDefaultSensor(manager, ASENSOR_TYPE_GYROSCOPE) : nullptr};
+        if (!accelerometer || !gyroscope)
+            return; // The Six-Axis sensors stay at rest without both sensors, an orientation can't be derived from just one of them
+
+        auto looper{ALooper_prepare(0)};
+        auto queue{ASensorManager_createEventQueue(manager, looper, 0, nullptr, nullptr)};
+        if (!queue)
+            return;
+
+        ASensorEventQueue_registerSensor(queue, accelerometer, constant::MotionSamplingPeriod, 0);
+        ASensorEventQueue_registerSensor(queue, gyroscope, constant::MotionSamplingPeriod, 0);
+
+        std::array<ASensorEvent, 16> events;
+        while (!exit) {
+            ALooper_pollOnce(PollTimeout, nullptr, nullptr, nullptr);
+
+            ssize_t count;
+            while ((count = ASensorEventQueue_getEvents(queue, events.data(), events.size())) > 0)
+                for (ssize_t index{}; index < count; index++)
+                    Fuse(events[static_cast<size_t>(index)]);
+        }
+
+        ASensorEventQueue_disableSensor(queue, accelerometer);
+        ASensorEventQueue_disableSensor(queue, gyroscope);
+        ASensorManager_destroyEventQueue(manager, queue);
+    }
+
+    void MotionSensor::Fuse(const ASensorEvent &event) {
+        if (event.type == ASENSOR_TYPE_ACCELEROMETER) {
+            // Android reports the reaction to gravity while the Switch reports gravity itself
+            auto vector{ToLandscape(event.acceleration)};
+            acceleration = {-vector.x / ASENSOR_STANDARD_GRAVITY, -vector.y / ASENSOR_STANDARD_GRAVITY, -vector.z / ASENSOR_STANDARD_GRAVITY};
+            return;
+        } else if (event.type != ASENSOR_TYPE_GYROSCOPE) {
+            return;
+        }
+
+        auto angularVelocity{ToLandscape(event.vector)}; // In radians per second
+        auto deltaTime{lastGyroscopeTimestamp ? static_cast<float>(event.timestamp - lastGyroscopeTimestamp) / constant::NsInSecond : 0.0f};
+        lastGyroscopeTimestamp = event.timestamp;
+
+        auto &q{orientation};
+
+        // The direction away from gravity as measured by the accelerometer is compared to the one predicted by the orientation, the error between them is fed back into the angular velocity so the orientation converges on the measured one without drifting
+        auto magnitude{std::sqrt(acceleration.x * acceleration.x + acceleration.y * acceleration.y + acceleration.z * acceleration.z)};
+        if (magnitude > 0.5f && magnitude < 1.5f) { // Samples with a large linear acceleration don't point towards gravity
+            SixAxisVector measured{-acceleration.x / magnitude, -acceleration.y / magnitude, -acceleration.z / magnitude};
+            SixAxisVector predicted{2 * (q.x * q.z - q.w * q.y), 2 * (q.w * q.x + q.y * q.z), q.w * q.w - q.x * q.x - q.y * q.y + q.z * q.z};
+            auto error{Cross(measured, predicted)};
+            angularVelocity.x += constant::MotionCorrectionGain * error.x;
+            angularVelocity.y += constant::MotionCorrectionGain * error.y;
+            angularVelocity.z += constant::MotionCorrectionGain * error.z;
+        }
+
+        // The orientation is integrated by its derivative of 0.5 * q * (0, w)
+        auto halfTime{0.5f * deltaTime};
+        Quaternion next{
+            q.w + halfTime * (-q.x * angularVelocity.x - q.y * angularVelocity.y - q.z * angularVelocity.z),
+            q.x + halfTime * (q.w * angularVelocity.x + q.y * angularVelocity.z - q.z * angularVelocity.y),
+            q.y + halfTime * (q.w * angularVelocity.y - q.x * angularVelocity.z + q.z * angularVelocity.x),
+            q.z + halfTime * (q.w * angularVelocity.z + q.x * angularVelocity.y - q.y * angularVelocity.x),
+        };
+        auto norm{std::sqrt(next.w * next.w + next.x * next.x + next.y * next.y + next.z * next.z)};
+        q = {next.w / norm, next.x / norm, next.y / norm, next.z / norm};
+
+        // The gyroscope is reported without the correction in rotations per second, the orientation is reported as the axes of the device in the frame of the world
+        auto gyroscope{ToLandscape(event.vector)};
+        std::lock_guard guard(mutex);
+        sixAxisState.accelerometer = acceleration;
+        sixAxisState.gyroscope = {gyroscope.x / Tau, gyroscope.y / Tau, gyroscope.z / Tau};
+        sixAxisState.rotation.x += sixAxisState.gyroscope.x * deltaTime;
+        sixAxisState.rotation.y += sixAxisState.gyroscope.y * deltaTime;
+        sixAxisState.rotation.z += sixAxisState.gyroscope.z * deltaTime;
+        sixAxisState.orientation = {{
+            {1 - 2 * (q.y * q.y + q.z * q.z), 2 * (q.x * q.y + q.w * q.z), 2 * (q.x * q.z - q.w * q.y)},
+            {2 * (q.x * q.y - q.w * q.z), 1 - 2 * (q.x * q.x + q.z * q.z), 2 * (q.y * q.z + q.w * q.x)},
+            {2 * (q.x * q.z + q.w * q.y), 2 * (q.y * q.z - q.w * q.x), 1 - 2 * (q.x * q.x + q.y * q.y)},
+        }};
+        sixAxisState._unk2_ = 1;
+        available = true;
+    }
+
+    std::optional<NpadSixAxisState> MotionSensor::GetState() {
+        std::lock_guard guard(mutex);
+        if (!available)
+            return std::nullopt;
+        return sixAxisState;
+    }
+}
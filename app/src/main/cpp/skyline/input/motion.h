@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <thread>
+#include <common.h>
+#include "sections/Npad.h"
+
+struct ASensorEvent;
+
+namespace skyline {
+    namespace constant {
+        constexpr i32 MotionSamplingPeriod{5000}; //!< The period at which the host's IMU is sampled in microseconds, this is the 200Hz that the Switch samples its IMUs at
+        constexpr float MotionCorrectionGain{0.5f}; //!< The proportional gain that the orientation is corrected towards gravity with, higher values trust the accelerometer more over the gyroscope
+    }
+
+    namespace input {
+        /**
+         * @brief The MotionSensor class reads the host's accelerometer and gyroscope on a native looper thread and fuses them into the state of a Six-Axis sensor, the HID sampler reads the latest state directly so no samples go through JNI
+         * @details Samples are converted into the frame of a Switch held in landscape: X to the right of the screen, Y to the top of the screen and Z out of it, accelerations are in G with the direction of gravity and angular velocities are in rotations per second. The orientation is integrated from the gyroscope and corrected towards the gravity measured by the accelerometer with a complementary filter
+         * @note The default landscape rotation is assumed for the conversion, the host's display rotation isn't available natively
+         */
+        class MotionSensor {
+          private:
+            /**
+             * @brief A rotation quaternion
+             */
+            struct Quaternion {
+                float w{1}, x{}, y{}, z{};
+            };
+
+            std::mutex mutex; //!< This mutex guards the state and if it's available
+            NpadSixAxisState sixAxisState{}; //!< The latest fused state of the host's IMU
+            bool available{}; //!< If a gyroscope sample has been fused into the state yet
+
+            SixAxisVector acceleration{0, 0, -1}; //!< The latest acceleration in G
+            Quaternion orientation{}; //!< The rotation from the frame of the device to that of the world, the world's Z axis points away from gravity
+            i64 lastGyroscopeTimestamp{}; //!< The timestamp of the last gyroscope sample in nanoseconds, this is 0 prior to the first one
+
+            std::atomic<bool> exit{}; //!< If the sensor thread should exit
+            std::thread thread; //!< The thread which reads the host's sensors, this is declared last so it's started after all other members are initialized
+
+            /**
+             * @brief The entry point of the sensor thread
+             */
+            void Run();
+
+            /**
+             * @brief Fuses a single event from the host's accelerometer or gyroscope into the state
+             */
+            void Fuse(const ASensorEvent &event);
+
+          public:
+            MotionSensor();
+
+            ~MotionSensor();
+
+            /**
+             * @return The latest state of the host's IMU or std::nullopt if the host lacks an accelerometer or gyroscope or hasn't reported any samples yet
+             * @note The timestamps of the state aren't set, they're written when it's inserted into HID Shared Memory
+             */
+            std::optional<NpadSixAxisState> GetState();
+        };
+    }
+}
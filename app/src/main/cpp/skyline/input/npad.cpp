@@ -11,7 +11,7 @@ namespace skyline::input {
          {*this, hid->npad[4], NpadId::Player5}, {*this, hid->npad[5], NpadId::Player6},
          {*this, hid->npad[6], NpadId::Player7}, {*this, hid->npad[7], NpadId::Player8},
          {*this, hid->npad[8], NpadId::Unknown}, {*this, hid->npad[9], NpadId::Handheld},
-        } {}
+        }, vibrator(state) {}
 
     void NpadManager::Update() {
         std::lock_guard guard(mutex);
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "npad_device.h"
+#include "vibrator.h"
 
 namespace skyline::input {
     /**
@@ -48,6 +49,7 @@ namespace skyline::input {
         std::vector<NpadId> supportedIds; //!< The NpadId(s) that are supported by the application
         NpadStyleSet styles; //!< The styles that are supported by the application
         NpadJoyOrientation orientation{}; //!< The orientation all of Joy-Cons are in (This affects stick transformation for them)
+        Vibrator vibrator; //!< The vibrator that all vibrations from NpadDevices are dispatched through
 
         /**
          * @param hid A pointer to HID Shared Memory on the host
@@ -1,7 +1,6 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
-#include <jvm.h>
 #include "npad_device.h"
 #include "npad.h"
 
@@ -142,9 +141,17 @@ namespace skyline::input {
         type = newType;
         controllerInfo = &GetControllerInfo();
 
-        GetNextEntry(*controllerInfo);
-        GetNextEntry(section.defaultController);
-        globalTimestamp++;
+        controllerState = {};
+        defaultState = {};
+
+        // The controller is at rest and facing upwards, the accelerometer measures gravity in units of G
+        sixAxisState = {
+            .accelerometer = {0, 0, -1},
+            .orientation = {{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}},
+            ._unk2_ = 1,
+        };
+
+        UpdateSharedMemory();
 
         updateEvent->Signal();
     }
@@ -155,6 +162,8 @@ namespace skyline::input {
 
         section = {};
         globalTimestamp = 0;
+        controllerState = {};
+        defaultState = {};
 
         index = -1;
         partnerIndex = -1;
@@ -182,37 +191,66 @@ namespace skyline::input {
         }
     }
 
-    NpadControllerState &NpadDevice::GetNextEntry(NpadControllerInfo &info) {
-        auto &lastEntry = info.state.at(info.header.currentEntry);
+    void NpadDevice::SetSixAxisState(const NpadSixAxisState &state) {
+        sixAxisState = state;
+    }
+
+    void NpadDevice::WriteNextEntry(NpadControllerInfo &info, const NpadControllerState &state) {
+        input::WriteNextEntry(info.header, info.state, [&](NpadControllerState &entry, const NpadControllerState &lastEntry) {
+            entry = state;
+            entry.globalTimestamp = globalTimestamp;
+            entry.localTimestamp = lastEntry.localTimestamp + 1;
+            entry.status.raw = connectionState.raw;
+        });
+    }
+
+    void NpadDevice::WriteNextEntry(NpadSixAxisInfo &info, const NpadSixAxisState &state) {
+        input::WriteNextEntry(info.header, info.state, [&](NpadSixAxisState &entry, const NpadSixAxisState &lastEntry) {
+            entry = state;
+            entry.globalTimestamp = globalTimestamp;
+            entry.localTimestamp = lastEntry.localTimestamp + 1;
+        });
+    }
 
-        info.header.timestamp = util::GetTimeTicks();
-        info.header.entryCount = std::min(static_cast<u8>(info.header.entryCount + 1), constant::HidEntryCount);
-        info.header.currentEntry = (info.header.currentEntry != constant::HidEntryCount - 1) ? info.header.currentEntry + 1 : 0;
+    void NpadDevice::UpdateSharedMemory() {
+        if (!connectionState.connected)
+            return;
 
-        auto &entry = info.state.at(info.header.currentEntry);
+        WriteNextEntry(*controllerInfo, controllerState);
+        WriteNextEntry(section.defaultController, defaultState);
 
-        entry.globalTimestamp = globalTimestamp;
-        entry.localTimestamp = lastEntry.localTimestamp + 1;
-        entry.buttons = lastEntry.buttons;
-        entry.leftX = lastEntry.leftX;
-        entry.leftY = lastEntry.leftY;
-        entry.rightX = lastEntry.rightX;
-        entry.rightY = lastEntry.rightY;
-        entry.status.raw = connectionState.raw;
+        switch (type) {
+            case NpadControllerType::ProController:
+                WriteNextEntry(section.fullKeySixAxis, sixAxisState);
+                break;
+            case NpadControllerType::Handheld:
+                WriteNextEntry(section.handheldSixAxis, sixAxisState);
+                break;
+            case NpadControllerType::JoyconDual:
+                WriteNextEntry(section.dualLeftSixAxis, sixAxisState);
+                WriteNextEntry(section.dualRightSixAxis, sixAxisState);
+                break;
+            case NpadControllerType::JoyconLeft:
+                WriteNextEntry(section.leftSixAxis, sixAxisState);
+                break;
+            case NpadControllerType::JoyconRight:
+                WriteNextEntry(section.rightSixAxis, sixAxisState);
+                break;
+            default:
+                break;
+        }
 
-        return entry;
+        globalTimestamp++;
     }
 
     void NpadDevice::SetButtonState(NpadButton mask, bool pressed) {
         if (!connectionState.connected)
             return;
 
-        auto &entry = GetNextEntry(*controllerInfo);
-
         if (pressed)
-            entry.buttons.raw |= mask.raw;
+            controllerState.buttons.raw |= mask.raw;
         else
-            entry.buttons.raw &= ~mask.raw;
+            controllerState.buttons.raw &= ~mask.raw;
 
         if (manager.orientation == NpadJoyOrientation::Horizontal && (type == NpadControllerType::JoyconLeft || type == NpadControllerType::JoyconRight)) {
             NpadButton orientedMask{};
@@ -247,21 +285,18 @@ namespace skyline::input {
             mask = orientedMask;
         }
 
-        auto &defaultEntry = GetNextEntry(section.defaultController);
         if (pressed)
-            defaultEntry.buttons.raw |= mask.raw;
+            defaultState.buttons.raw |= mask.raw;
         else
-            defaultEntry.buttons.raw &= ~mask.raw;
-
-        globalTimestamp++;
+            defaultState.buttons.raw &= ~mask.raw;
     }
 
     void NpadDevice::SetAxisValue(NpadAxisId axis, i32 value) {
         if (!connectionState.connected)
             return;
 
-        auto &controllerEntry = GetNextEntry(*controllerInfo);
-        auto &defaultEntry = GetNextEntry(section.defaultController);
+        auto &controllerEntry = controllerState;
+        auto &defaultEntry = defaultState;
 
         constexpr i16 threshold = std::numeric_limits<i16>::max() / 2; // A 50% deadzone for the stick buttons
 
@@ -348,79 +383,6 @@ namespace skyline::input {
                     break;
             }
         }
-
-        globalTimestamp++;
-    }
-
-    struct VibrationInfo {
-        jlong period;
-        jint amplitude;
-        jlong start;
-        jlong end;
-
-        VibrationInfo(float frequency, float amplitude) : period(constant::MsInSecond / frequency), amplitude(amplitude), start(0), end(period) {}
-    };
-
-    template<size_t Size>
-    void VibrateDevice(const std::shared_ptr<JvmManager> &jvm, i8 index, std::array<VibrationInfo, Size> vibrations) {
-        jlong totalTime{};
-        std::sort(vibrations.begin(), vibrations.end(), [](const VibrationInfo &a, const VibrationInfo &b) {
-            return a.period < b.period;
-        });
-
-        jint totalAmplitude{};
-        for (const auto &vibration : vibrations)
-            totalAmplitude += vibration.amplitude;
-
-        // If this vibration is essentially null then we don't play rather clear any running vibrations
-        if (totalAmplitude == 0 || vibrations[3].period == 0) {
-            jvm->ClearVibrationDevice(index);
-            return;
-        }
-
-        // We output an approximation of the combined + linearized vibration data into these arrays, larger arrays would allow for more accurate reproduction of data
-        std::array<jlong, 50> timings;
-        std::array<jint, 50> amplitudes;
-
-        // We are essentially unrolling the bands into a linear sequence, due to the data not being always linearizable there will be inaccuracies at the ends unless there's a pattern that's repeatable which will happen when all band's frequencies are factors of each other
-        u8 i{};
-        for (; i < timings.size(); i++) {
-            jlong time{};
-
-            u8 startCycleCount{};
-            for (u8 n{}; n < vibrations.size(); n++) {
-                auto &vibration = vibrations[n];
-                if (totalTime <= vibration.start) {
-                    vibration.start = vibration.end + vibration.period;
-                    totalAmplitude += vibration.amplitude;
-                    time = std::max(vibration.period, time);
-                    startCycleCount++;
-                } else if (totalTime <= vibration.start) {
-                    vibration.end = vibration.start + vibration.period;
-                    totalAmplitude -= vibration.amplitude;
-                    time = std::max(vibration.period, time);
-                }
-            }
-
-            // If all bands start again at this point then we can end the pattern here as a loop to the front will be flawless
-            if (i && startCycleCount == vibrations.size())
-                break;
-
-            timings[i] = time;
-            totalTime += time;
-
-            amplitudes[i] = std::min(totalAmplitude, constant::AmplitudeMax);
-        }
-
-        jvm->VibrateDevice(index, std::span(timings.begin(), timings.begin() + i), std::span(amplitudes.begin(), amplitudes.begin() + i));
-    }
-
-    void VibrateDevice(const std::shared_ptr<JvmManager> &jvm, i8 index, const NpadVibrationValue &value) {
-        std::array<VibrationInfo, 2> vibrations{
-            VibrationInfo{value.frequencyLow, value.amplitudeLow * (constant::AmplitudeMax / 2)},
-            {value.frequencyHigh, value.amplitudeHigh * (constant::AmplitudeMax / 2)},
-        };
-        VibrateDevice(jvm, index, vibrations);
     }
 
     void NpadDevice::Vibrate(bool isRight, const NpadVibrationValue &value) {
@@ -432,21 +394,15 @@ namespace skyline::input {
         if (vibrationRight)
             Vibrate(vibrationLeft, *vibrationRight);
         else
-            VibrateDevice(manager.state.jvm, index, value);
+            manager.vibrator.Post(index, value);
     }
 
     void NpadDevice::Vibrate(const NpadVibrationValue &left, const NpadVibrationValue &right) {
         if (partnerIndex == constant::NullIndex) {
-            std::array<VibrationInfo, 4> vibrations{
-                VibrationInfo{left.frequencyLow, left.amplitudeLow * (constant::AmplitudeMax / 4)},
-                {left.frequencyHigh, left.amplitudeHigh * (constant::AmplitudeMax / 4)},
-                {right.frequencyLow, right.amplitudeLow * (constant::AmplitudeMax / 4)},
-                {right.frequencyHigh, right.amplitudeHigh * (constant::AmplitudeMax / 4)},
-            };
-            VibrateDevice<4>(manager.state.jvm, index, vibrations);
+            manager.vibrator.Post(index, left, right);
         } else {
-            VibrateDevice(manager.state.jvm, index, left);
-            VibrateDevice(manager.state.jvm, partnerIndex, right);
+            manager.vibrator.Post(index, left);
+            manager.vibrator.Post(partnerIndex, right);
         }
     }
 }
@@ -122,13 +122,21 @@ namespace skyline::input {
         NpadSection &section; //!< The section in HID shared memory for this controller
         NpadControllerInfo *controllerInfo; //!< The NpadControllerInfo for this controller's type
         u64 globalTimestamp{}; //!< An incrementing timestamp that's common across all sections
+        NpadControllerState controllerState{}; //!< The host state of the controller, this is written into the entries of the controller's type by UpdateSharedMemory
+        NpadControllerState defaultState{}; //!< The host state of the controller as seen by the default controller, this differs from controllerState for Joy-Cons held horizontally
+        NpadSixAxisState sixAxisState{}; //!< The host state of the controller's IMU, this is at rest unless the host's IMU is available
 
         /**
-         * @brief This updates the headers and creates a new entry in HID Shared Memory
+         * @brief This writes a new entry with the supplied state into HID Shared Memory
          * @param info The controller info of the NPad that needs to be updated
-         * @return The next entry that has been created with values from the last entry
          */
-        NpadControllerState &GetNextEntry(NpadControllerInfo &info);
+        void WriteNextEntry(NpadControllerInfo &info, const NpadControllerState &state);
+
+        /**
+         * @brief This writes a new entry with the supplied state into HID Shared Memory
+         * @param info The IMU info of the NPad that needs to be updated
+         */
+        void WriteNextEntry(NpadSixAxisInfo &info, const NpadSixAxisState &state);
 
         /**
         * @return The NpadControllerInfo for this controller based on it's type
@@ -177,6 +185,7 @@ namespace skyline::input {
          * @brief This changes the state of buttons to the specified state
          * @param mask A bit-field mask of all the buttons to change
          * @param pressed If the buttons were pressed or released
+         * @note This only changes the host state, it's written to HID Shared Memory by UpdateSharedMemory
          */
         void SetButtonState(NpadButton mask, bool pressed);
 
@@ -184,9 +193,22 @@ namespace skyline::input {
          * @brief This sets the value of an axis to the specified value
          * @param axis The axis to set the value of
          * @param value The value to set
+         * @note This only changes the host state, it's written to HID Shared Memory by UpdateSharedMemory
          */
         void SetAxisValue(NpadAxisId axis, i32 value);
 
+        /**
+         * @brief This sets the state of the controller's IMU
+         * @note This only changes the host state, it's written to HID Shared Memory by UpdateSharedMemory
+         */
+        void SetSixAxisState(const NpadSixAxisState &state);
+
+        /**
+         * @brief This writes the host state of the controller into a new entry in HID Shared Memory
+         * @note This is called by the input sampler at a fixed rate regardless of if the state has changed, as the guest expects entries at regular intervals
+         */
+        void UpdateSharedMemory();
+
         void Vibrate(bool isRight, const NpadVibrationValue &value);
 
         void Vibrate(const NpadVibrationValue &left, const NpadVibrationValue &right);
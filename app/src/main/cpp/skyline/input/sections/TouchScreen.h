@@ -34,7 +34,7 @@ namespace skyline::input {
         u64 localTimestamp; //!< The local timestamp in samples
 
         u64 touchCount; //!< The amount of active touch instances
-        std::array<TouchScreenStateData, 16> data;
+        std::array<TouchScreenStateData, constant::TouchPointCount> data;
     };
     static_assert(sizeof(TouchScreenState) == 0x298);
 
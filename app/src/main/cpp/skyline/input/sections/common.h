@@ -12,6 +12,7 @@ namespace skyline {
         constexpr u8 NpadCount = 10; //!< The amount of NPads in shared memory
         constexpr u8 ControllerCount = 8; //!< The maximum amount of guest controllers
         constexpr u32 NpadBatteryFull = 2; //!< The full battery state of an npad
+        constexpr u8 TouchPointCount = 16; //!< The maximum amount of points that can be touched on the touch-screen at once
     }
 
     namespace input {
@@ -25,5 +26,26 @@ namespace skyline {
             u64 maxEntry{constant::HidEntryCount - 1}; //!< The maximum entry index (16)
         };
         static_assert(sizeof(CommonHeader) == 0x20);
+
+        /**
+         * @brief This writes a new entry into the ring of entries of a section and then updates the header to point to it
+         * @param write A function which fills in the new entry, it's supplied the new entry and the last entry
+         * @note The guest reads sections without any synchronization, so the header is only updated with release ordering after the entry has been fully written
+         * @note The entry is filled in on the host stack and published into shared memory with a single copy, this keeps the cache lines that the guest polls from bouncing between cores for every field that's written
+         */
+        template<typename Entry, size_t Size, typename Function>
+        void WriteNextEntry(CommonHeader &header, std::array<Entry, Size> &entries, Function write) {
+            const auto &lastEntry{entries[header.currentEntry]};
+            auto entryIndex{(header.currentEntry != Size - 1) ? header.currentEntry + 1 : 0};
+
+            Entry entry{};
+            write(entry, lastEntry);
+            entries[entryIndex] = entry;
+
+            std::atomic_thread_fence(std::memory_order_release);
+            header.timestamp = util::GetTimeTicks();
+            header.entryCount = std::min<u64>(header.entryCount + 1, Size);
+            __atomic_store_n(&header.currentEntry, entryIndex, __ATOMIC_RELEASE);
+        }
     }
 }
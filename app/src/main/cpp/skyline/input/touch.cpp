@@ -10,34 +10,37 @@ namespace skyline::input {
     }
 
     void TouchManager::Activate() {
+        std::lock_guard guard(mutex);
         activated = true;
-        SetState({});
+        pointCount = 0;
     }
 
-    void TouchManager::SetState(const std::span<TouchScreenPoint> &points) {
+    void TouchManager::SetState(const std::span<TouchScreenPoint> &newPoints) {
+        std::lock_guard guard(mutex);
+        pointCount = std::min(newPoints.size(), points.size());
+        std::copy_n(newPoints.begin(), pointCount, points.begin());
+    }
+
+    void TouchManager::UpdateSharedMemory() {
+        std::lock_guard guard(mutex);
         if (!activated)
             return;
 
-        const auto& lastEntry = section.entries[section.header.currentEntry];
-        auto entryIndex = (section.header.currentEntry != constant::HidEntryCount - 1) ? section.header.currentEntry + 1 : 0;
-        auto& entry = section.entries[entryIndex];
-        entry.globalTimestamp = lastEntry.globalTimestamp + 1;
-        entry.localTimestamp = lastEntry.localTimestamp + 1;
-        entry.touchCount = points.size();
-
-        for (size_t i{}; i < points.size(); i++) {
-            const auto& host = points[i];
-            auto& guest = entry.data[i];
-            guest.index = i;
-            guest.positionX = host.x;
-            guest.positionY = host.y;
-            guest.minorAxis = host.minor;
-            guest.majorAxis = host.major;
-            guest.angle = host.angle;
-        }
+        WriteNextEntry(section.header, section.entries, [&](TouchScreenState &entry, const TouchScreenState &lastEntry) {
+            entry.globalTimestamp = lastEntry.globalTimestamp + 1;
+            entry.localTimestamp = lastEntry.localTimestamp + 1;
+            entry.touchCount = pointCount;
 
-        section.header.timestamp = util::GetTimeTicks();
-        section.header.entryCount = std::min(static_cast<u8>(section.header.entryCount + 1), constant::HidEntryCount);
-        section.header.currentEntry = entryIndex;
+            for (size_t i{}; i < pointCount; i++) {
+                const auto &host{points[i]};
+                auto &guest{entry.data[i]};
+                guest.index = i;
+                guest.positionX = host.x;
+                guest.positionY = host.y;
+                guest.minorAxis = host.minor;
+                guest.majorAxis = host.major;
+                guest.angle = host.angle;
+            }
+        });
     }
 }
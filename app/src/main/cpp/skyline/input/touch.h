@@ -28,6 +28,9 @@ namespace skyline::input {
         const DeviceState &state;
         bool activated{};
         TouchScreenSection &section;
+        std::mutex mutex; //!< This mutex guards the host state and the activation state
+        std::array<TouchScreenPoint, constant::TouchPointCount> points{}; //!< The host state of the points on the touch-screen
+        size_t pointCount{}; //!< The amount of valid points in the host state
 
       public:
         /**
@@ -37,6 +40,15 @@ namespace skyline::input {
 
         void Activate();
 
-        void SetState(const std::span<TouchScreenPoint> &points);
+        /**
+         * @brief This sets the host state of the touch-screen, it's written to HID Shared Memory by UpdateSharedMemory
+         */
+        void SetState(const std::span<TouchScreenPoint> &newPoints);
+
+        /**
+         * @brief This writes the host state of the touch-screen into a new entry in HID Shared Memory
+         * @note This is called by the input sampler at a fixed rate regardless of if the state has changed, as the guest expects entries at regular intervals
+         */
+        void UpdateSharedMemory();
     };
 }
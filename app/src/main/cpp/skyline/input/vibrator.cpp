@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/resource.h>
+#include <jvm.h>
+#include "vibrator.h"
+
+namespace skyline::input {
+    struct VibrationInfo {
+        jlong period;
+        jint amplitude;
+        jlong start;
+        jlong end;
+
+        VibrationInfo(float frequency, float amplitude) : period(constant::MsInSecond / frequency), amplitude(amplitude), start(0), end(period) {}
+    };
+
+    template<size_t Size>
+    void VibrateDevice(const std::shared_ptr<JvmManager> &jvm, i8 index, std::array<VibrationInfo, Size> vibrations) {
+        jlong totalTime{};
+        std::sort(vibrations.begin(), vibrations.end(), [](const VibrationInfo &a, const VibrationInfo &b) {
+            return a.period < b.period;
+        });
+
+        jint totalAmplitude{};
+        for (const auto &vibration : vibrations)
+            totalAmplitude += vibration.amplitude;
+
+        // If this vibration is essentially null then we don't play rather clear any running vibrations
+        if (totalAmplitude == 0 || vibrations.back().period == 0) {
+            jvm->ClearVibrationDevice(index);
+            return;
+        }
+
+        // We output an approximation of the combined + linearized vibration data into these arrays, larger arrays would allow for more accurate reproduction of data
+        std::array<jlong, 50> timings;
+        std::array<jint, 50> amplitudes;
+
+        // We are essentially unrolling the bands into a linear sequence, due to the data not being always linearizable there will be inaccuracies at the ends unless there's a pattern that's repeatable which will happen when all band's frequencies are factors of each other
+        u8 i{};
+        for (; i < timings.size(); i++) {
+            jlong time{};
+
+            u8 startCycleCount{};
+            for (u8 n{}; n < vibrations.size(); n++) {
+                auto &vibration = vibrations[n];
+                if (totalTime <= vibration.start) {
+                    vibration.start = vibration.end + vibration.period;
+                    totalAmplitude += vibration.amplitude;
+                    time = std::max(vibration.period, time);
+                    startCycleCount++;
+                } else if (totalTime <= vibration.start) {
+                    vibration.end = vibration.start + vibration.period;
+                    totalAmplitude -= vibration.amplitude;
+                    time = std::max(vibration.period, time);
+                }
+            }
+
+            // If all bands start again at this point then we can end the pattern here as a loop to the front will be flawless
+            if (i && startCycleCount == vibrations.size())
+                break;
+
+            timings[i] = time;
+            totalTime += time;
+
+            amplitudes[i] = std::min(totalAmplitude, constant::AmplitudeMax);
+        }
+
+        jvm->VibrateDevice(index, std::span(timings.begin(), timings.begin() + i), std::span(amplitudes.begin(), amplitudes.begin() + i));
+    }
+
+    bool Vibrator::Request::operator==(const Request &other) const {
+        return count == other.count && std::memcmp(values.data(), other.values.data(), count * sizeof(NpadVibrationValue)) == 0;
+    }
+
+    Vibrator::Vibrator(const DeviceState &state) : jvm(state.jvm), thread(&Vibrator::Run, this) {}
+
+    Vibrator::~Vibrator() {
+        {
+            std::lock_guard guard(mutex);
+            exit = true;
+        }
+        condition.notify_all();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    void Vibrator::Post(i8 index, const Request &request) {
+        if (index < 0 || index >= constant::ControllerCount)
+            return;
+
+        {
+            std::lock_guard guard(mutex);
+            mailboxes[index].pending = request;
+        }
+        condition.notify_one();
+    }
+
+    void Vibrator::Post(i8 index, const NpadVibrationValue &value) {
+        Post(index, Request{{value}, 1});
+    }
+
+    void Vibrator::Post(i8 index, const NpadVibrationValue &left, const NpadVibrationValue &right) {
+        Post(index, Request{{left, right}, 2});
+    }
+
+    void Vibrator::Dispatch(jint index, const Request &request) {
+        if (request.count == 1) {
+            const auto &value{request.values[0]};
+            VibrateDevice<2>(jvm, index, {
+                VibrationInfo{value.frequencyLow, value.amplitudeLow * (constant::AmplitudeMax / 2)},
+                {value.frequencyHigh, value.amplitudeHigh * (constant::AmplitudeMax / 2)},
+            });
+        } else {
+            const auto &left{request.values[0]}, &right{request.values[1]};
+            VibrateDevice<4>(jvm, index, {
+                VibrationInfo{left.frequencyLow, left.amplitudeLow * (constant::AmplitudeMax / 4)},
+                {left.frequencyHigh, left.amplitudeHigh * (constant::AmplitudeMax / 4)},
+                {right.frequencyLow, right.amplitudeLow * (constant::AmplitudeMax / 4)},
+                {right.frequencyHigh, right.amplitudeHigh * (constant::AmplitudeMax / 4)},
+            });
+        }
+    }
+
+    void Vibrator::Run() {
+        // Vibration isn't latency critical, so it shouldn't take any time away from the guest
+        setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), 10);
+        jvm->AttachThread();
+
+        std::unique_lock lock(mutex);
+        while (!exit) {
+            auto now{std::chrono::steady_clock::now()};
+            std::optional<std::chrono::steady_clock::time_point> nextDispatch;
+
+            for (jint index{}; index < constant::ControllerCount; index++) {
+                auto &mailbox{mailboxes[index]};
+                if (!mailbox.pending)
+                    continue;
+
+                if (mailbox.last && *mailbox.pending == *mailbox.last) {
+                    mailbox.pending.reset();
+                    continue;
+                }
+
+                auto dispatchTime{mailbox.lastDispatch + constant::VibrationInterval};
+                if (dispatchTime > now) {
+                    nextDispatch = nextDispatch ? std::min(*nextDispatch, dispatchTime) : dispatchTime;
+                    continue;
+                }
+
+                auto request{*mailbox.pending};
+                mailbox.pending.reset();
+                mailbox.last = request;
+                mailbox.lastDispatch = now;
+
+                // The JNI call is done without the lock held so guest threads posting requests never wait on it
+                lock.unlock();
+                Dispatch(index, request);
+                lock.lock();
+            }
+
+            if (exit)
+                break;
+
+            bool hasPending{std::any_of(mailboxes.begin(), mailboxes.end(), [](const Mailbox &mailbox) { return mailbox.pending.has_value(); })};
+            if (nextDispatch)
+                condition.wait_until(lock, *nextDispatch);
+            else if (!hasPending)
+                condition.wait(lock);
+        }
+
+        lock.unlock();
+        jvm->DetachThread();
+    }
+}
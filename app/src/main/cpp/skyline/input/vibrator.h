@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "npad_device.h"
+
+namespace skyline {
+    namespace constant {
+        constexpr std::chrono::milliseconds VibrationInterval{16}; //!< The minimum interval between two vibrations being dispatched to the same host device
+    }
+
+    namespace input {
+        /**
+         * @brief The Vibrator class renders guest vibration values into Android vibration patterns and dispatches them on its own thread
+         * @details Guest vibration requests are coalesced into a latest-value mailbox for every host device, so titles that vibrate every frame don't stall on a JNI transition for each request.
+         * A mailbox is only dispatched once at least VibrationInterval has passed since the last dispatch to the same device and redundant requests that match the last dispatched one are dropped
+         */
+        class Vibrator {
+          private:
+            /**
+             * @brief A vibration request for a single host device, this is either a single set of bands or a left and right set of bands that are mixed together
+             */
+            struct Request {
+                std::array<NpadVibrationValue, 2> values;
+                u8 count; //!< The amount of valid values
+
+                bool operator==(const Request &other) const;
+            };
+
+            /**
+             * @brief The state of the vibration of a single host device
+             */
+            struct Mailbox {
+                std::optional<Request> pending; //!< The latest request which hasn't been dispatched yet
+                std::optional<Request> last; //!< The request that was last dispatched
+                std::chrono::steady_clock::time_point lastDispatch{}; //!< The time at which the last request was dispatched
+            };
+
+            std::shared_ptr<JvmManager> jvm; //!< A reference to the JvmManager, this is held separately as the vibration thread might outlive the one in DeviceState
+            std::mutex mutex; //!< This mutex guards the mailboxes and the exit flag
+            std::condition_variable condition; //!< This is notified when a request is posted or the thread should exit
+            std::array<Mailbox, constant::ControllerCount> mailboxes{};
+            bool exit{}; //!< If the vibration thread should exit
+            std::thread thread; //!< The vibration thread, this is declared last so it's started after all other members are initialized
+
+            /**
+             * @brief Renders a request into a vibration pattern and passes it to Kotlin
+             */
+            void Dispatch(jint index, const Request &request);
+
+            /**
+             * @brief The entry point of the vibration thread
+             */
+            void Run();
+
+            void Post(i8 index, const Request &request);
+
+          public:
+            Vibrator(const DeviceState &state);
+
+            ~Vibrator();
+
+            /**
+             * @brief Posts a vibration for a host device which is comprised of a single set of bands, this replaces any request that hasn't been dispatched yet
+             */
+            void Post(i8 index, const NpadVibrationValue &value);
+
+            /**
+             * @brief Posts a vibration for a host device which is comprised of a left and right set of bands that are mixed together, this replaces any request that hasn't been dispatched yet
+             */
+            void Post(i8 index, const NpadVibrationValue &left, const NpadVibrationValue &right);
+        };
+    }
+}
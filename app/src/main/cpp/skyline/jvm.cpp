@@ -3,63 +3,108 @@
 
 #include "jvm.h"
 
-thread_local JNIEnv *env;
+namespace {
+    JavaVM *Vm{}; //!< The Java VM, this is valid for the lifetime of the process once a JvmManager has been created
+
+    /**
+     * @brief The cached JNI environment of a thread
+     */
+    struct ThreadEnvironment {
+        JNIEnv *env{};
+        bool attached{}; //!< If the thread was attached to the Java VM by the JvmManager, it's detached when the thread exits in that case
+
+        ~ThreadEnvironment() {
+            if (attached)
+                Vm->DetachCurrentThread();
+        }
+    };
+
+    thread_local ThreadEnvironment Environment;
+}
 
 namespace skyline {
-    JvmManager::JvmManager(JNIEnv *environ, jobject instance) : instance(environ->NewGlobalRef(instance)), instanceClass(reinterpret_cast<jclass>(environ->NewGlobalRef(environ->GetObjectClass(instance)))), initializeControllersId(environ->GetMethodID(instanceClass, "initializeControllers", "()V")), vibrateDeviceId(environ->GetMethodID(instanceClass, "vibrateDevice", "(I[J[I)V")), clearVibrationDeviceId(environ->GetMethodID(instanceClass, "clearVibrationDevice", "(I)V")) {
-        env = environ;
-        if (env->GetJavaVM(&vm) < 0)
+    JvmManager::JvmManager(JNIEnv *environ, jobject instance) : instance(environ->NewGlobalRef(instance)), instanceClass(reinterpret_cast<jclass>(environ->NewGlobalRef(environ->GetObjectClass(instance)))), initializeControllersId(environ->GetMethodID(instanceClass, "initializeControllers", "()V")), vibrateDeviceId(environ->GetMethodID(instanceClass, "vibrateDevice", "(I[J[II)V")), clearVibrationDeviceId(environ->GetMethodID(instanceClass, "clearVibrationDevice", "(I)V")) {
+        Environment.env = environ;
+        if (environ->GetJavaVM(&vm) < 0)
             throw exception("Cannot get JavaVM from environment");
+        Vm = vm;
     }
 
     JvmManager::~JvmManager() {
+        auto env{GetEnv()};
+        if (vibrationTimings) {
+            env->DeleteGlobalRef(vibrationTimings);
+            env->DeleteGlobalRef(vibrationAmplitudes);
+        }
         env->DeleteGlobalRef(instanceClass);
         env->DeleteGlobalRef(instance);
     }
 
     void JvmManager::AttachThread() {
-        if (!env)
-            vm->AttachCurrentThread(&env, nullptr);
+        GetEnv();
     }
 
     void JvmManager::DetachThread() {
-        if (env)
+        if (Environment.attached) {
             vm->DetachCurrentThread();
+            Environment = {};
+        }
     }
 
     JNIEnv *JvmManager::GetEnv() {
-        return env;
+        auto &environment{Environment};
+        if (!environment.env && Vm) {
+            // Threads created by the JVM are already attached and only need their environment looked up
+            if (Vm->GetEnv(reinterpret_cast<void **>(&environment.env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+                if (Vm->AttachCurrentThread(&environment.env, nullptr) != JNI_OK)
+                    throw exception("Cannot attach thread to the JavaVM");
+                environment.attached = true;
+            }
+        }
+        return environment.env;
     }
 
     jobject JvmManager::GetField(const char *key, const char *signature) {
+        auto env{GetEnv()};
         return env->GetObjectField(instance, env->GetFieldID(instanceClass, key, signature));
     }
 
     bool JvmManager::CheckNull(const char *key, const char *signature) {
+        auto env{GetEnv()};
         return env->IsSameObject(env->GetObjectField(instance, env->GetFieldID(instanceClass, key, signature)), nullptr);
     }
 
     bool JvmManager::CheckNull(jobject &object) {
-        return env->IsSameObject(object, nullptr);
+        return GetEnv()->IsSameObject(object, nullptr);
     }
 
     void JvmManager::InitializeControllers() {
-        env->CallVoidMethod(instance, initializeControllersId);
+        GetEnv()->CallVoidMethod(instance, initializeControllersId);
     }
 
     void JvmManager::VibrateDevice(jint index, const std::span<jlong> &timings, const std::span<jint> &amplitudes) {
-        auto jTimings = env->NewLongArray(timings.size());
-        env->SetLongArrayRegion(jTimings, 0, timings.size(), timings.data());
-        auto jAmplitudes = env->NewIntArray(amplitudes.size());
-        env->SetIntArrayRegion(jAmplitudes, 0, amplitudes.size(), amplitudes.data());
+        auto env{GetEnv()};
+        auto count{static_cast<jsize>(timings.size())};
+        if (count > vibrationCapacity) {
+            if (vibrationTimings) {
+                env->DeleteGlobalRef(vibrationTimings);
+                env->DeleteGlobalRef(vibrationAmplitudes);
+            }
 
-        env->CallVoidMethod(instance, vibrateDeviceId, index, jTimings, jAmplitudes);
+            auto jTimings{env->NewLongArray(count)}, jAmplitudes{env->NewIntArray(count)};
+            vibrationTimings = reinterpret_cast<jlongArray>(env->NewGlobalRef(jTimings));
+            vibrationAmplitudes = reinterpret_cast<jintArray>(env->NewGlobalRef(jAmplitudes));
+            env->DeleteLocalRef(jTimings);
+            env->DeleteLocalRef(jAmplitudes);
+            vibrationCapacity = count;
+        }
 
-        env->DeleteLocalRef(jTimings);
-        env->DeleteLocalRef(jAmplitudes);
+        env->SetLongArrayRegion(vibrationTimings, 0, count, timings.data());
+        env->SetIntArrayRegion(vibrationAmplitudes, 0, count, amplitudes.data());
+        env->CallVoidMethod(instance, vibrateDeviceId, index, vibrationTimings, vibrationAmplitudes, count);
     }
 
     void JvmManager::ClearVibrationDevice(jint index) {
-        env->CallVoidMethod(instance, clearVibrationDeviceId, index);
+        GetEnv()->CallVoidMethod(instance, clearVibrationDeviceId, index);
     }
 }
@@ -9,6 +9,7 @@
 namespace skyline {
     /**
      * @brief The JvmManager class is used to simplify transactions with the Java component
+     * @note The JNI environment of every thread is cached in thread-local storage the first time it's needed, threads which aren't attached to the JVM at that point are attached and detached when they exit
      */
     class JvmManager {
       public:
@@ -25,17 +26,17 @@ namespace skyline {
         ~JvmManager();
 
         /**
-         * @brief Attach the current thread to the Java VM
+         * @brief Attach the current thread to the Java VM, this is only needed to attach a thread ahead of its first JNI call
          */
         void AttachThread();
 
         /**
-         * @brief Detach the current thread to the Java VM
+         * @brief Detach the current thread from the Java VM, this only detaches threads that were attached by the JvmManager
          */
         void DetachThread();
 
         /**
-         * @brief Returns a pointer to the JNI environment for the current thread
+         * @brief Returns a pointer to the JNI environment for the current thread, the thread is attached to the Java VM if it isn't already
          */
         static JNIEnv *GetEnv();
 
@@ -96,6 +97,7 @@ namespace skyline {
 
         /**
          * @brief A call to EmulationActivity.vibrateDevice in Kotlin
+         * @note The pattern is passed in arrays that are reused across calls, so this must only be called from a single thread at a time
          */
         void VibrateDevice(jint index, const std::span<jlong> &timings, const std::span<jint> &amplitudes);
 
@@ -108,5 +110,8 @@ namespace skyline {
         jmethodID initializeControllersId;
         jmethodID vibrateDeviceId;
         jmethodID clearVibrationDeviceId;
+        jlongArray vibrationTimings{}; //!< A global reference to the array that vibration timings are passed in, it's only reallocated when a pattern doesn't fit into it
+        jintArray vibrationAmplitudes{}; //!< A global reference to the array that vibration amplitudes are passed in, this is the same size as vibrationTimings
+        jsize vibrationCapacity{}; //!< The size of the vibration arrays
     };
 }
@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "handle_table.h"
+
+namespace skyline::kernel {
+    HandleTable::~HandleTable() {
+        for (auto &chunk : chunks)
+            delete[] chunk.load(std::memory_order_relaxed);
+    }
+
+    KHandle HandleTable::Reserve() {
+        std::lock_guard guard(mutex);
+
+        u32 index;
+        if (!freeIndices.empty()) {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        } else {
+            index = slotCount.load(std::memory_order_relaxed);
+            if (index >= MaxHandles)
+                throw exception("Cannot allocate more than {} handles", MaxHandles);
+
+            auto &chunk{chunks[index / ChunkSize]};
+            if (!chunk.load(std::memory_order_relaxed))
+                chunk.store(new Slot[ChunkSize], std::memory_order_release);
+
+            slotCount.store(index + 1, std::memory_order_release);
+        }
+
+        // The generation is never 0 so a handle is never 0 either, it's incremented from the previous occupant of the slot so stale handles don't resolve to the new object
+        auto &slot{*GetSlot(index)};
+        auto generation{(slot.tag.load(std::memory_order_relaxed) & GenerationMask) + 1};
+        if (generation > GenerationMask)
+            generation = 1;
+        slot.tag.store(generation | ReservedFlag, std::memory_order_release);
+
+        return static_cast<KHandle>((generation << IndexBits) | index);
+    }
+
+    void HandleTable::Publish(KHandle handle, std::shared_ptr<type::KObject> object) {
+        std::lock_guard guard(mutex);
+
+        auto index{handle & IndexMask}, generation{(handle >> IndexBits) & GenerationMask};
+        auto slot{index < slotCount.load(std::memory_order_relaxed) ? GetSlot(index) : nullptr};
+        if (!slot || slot->tag.load(std::memory_order_relaxed) != (generation | ReservedFlag))
+            throw exception("Cannot publish an object with a handle that wasn't reserved: 0x{:X}", handle);
+
+        auto type{static_cast<u32>(object->objectType)};
+        slot->borrowed.store(object.get(), std::memory_order_relaxed);
+        std::atomic_store_explicit(&slot->object, std::move(object), std::memory_order_release);
+        slot->tag.store(generation | (type << TypeShift) | PublishedFlag, std::memory_order_release);
+    }
+
+    bool HandleTable::Delete(KHandle handle) {
+        std::vector<std::shared_ptr<type::KObject>> reclaimed;
+        {
+            std::lock_guard guard(mutex);
+
+            auto index{handle & IndexMask}, generation{(handle >> IndexBits) & GenerationMask};
+            auto slot{index < slotCount.load(std::memory_order_relaxed) ? GetSlot(index) : nullptr};
+            auto tag{slot ? slot->tag.load(std::memory_order_relaxed) : 0};
+            if (!(tag & (PublishedFlag | ReservedFlag)) || (tag & GenerationMask) != generation)
+                return false; // The slot of a handle that has already been deleted mustn't be returned to the free list again
+
+            // The slot is unpublished before the object is removed from it, a concurrent lookup that read the object will observe the changed tag and discard it
+            slot->tag.store(generation, std::memory_order_release);
+            auto object{std::atomic_exchange_explicit(&slot->object, std::shared_ptr<type::KObject>{}, std::memory_order_acq_rel)};
+            freeIndices.push_back(index);
+
+            if (object) {
+                // Borrow scopes that are active in the current epoch might still be using the object, so it's only released after the epoch has been advanced twice
+                retired[epoch.load(std::memory_order_relaxed) & 1].push_back(std::move(object));
+                retiring.store(true, std::memory_order_seq_cst);
+            }
+            reclaimed = AdvanceEpoch();
+        }
+        return true;
+    }
+
+    std::vector<std::shared_ptr<type::KObject>> HandleTable::AdvanceEpoch() {
+        std::vector<std::shared_ptr<type::KObject>> reclaimed;
+        for (u8 step{}; step < 2 && retiring.load(std::memory_order_relaxed); step++) {
+            // Objects retired in the prior epoch can only be referenced by scopes started in it or earlier, these are all counted under the parity of the next epoch
+            auto current{epoch.load(std::memory_order_relaxed)}, next{current + 1};
+            if (borrowers[next & 1].load(std::memory_order_seq_cst))
+                break;
+
+            auto &released{retired[next & 1]};
+            std::move(released.begin(), released.end(), std::back_inserter(reclaimed));
+            released.clear();
+            epoch.store(next, std::memory_order_seq_cst);
+            retiring.store(!retired[current & 1].empty(), std::memory_order_release);
+        }
+        return reclaimed;
+    }
+
+    void HandleTable::Reclaim() {
+        std::vector<std::shared_ptr<type::KObject>> reclaimed;
+        {
+            std::unique_lock guard(mutex, std::try_to_lock);
+            if (!guard)
+                return;
+            reclaimed = AdvanceEpoch();
+        }
+    }
+}
@@ -0,0 +1,239 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+#include "types/KObject.h"
+
+namespace skyline::kernel {
+    /**
+     * @brief The HandleTable class maps handles to kernel objects, it's a dense table of slots that are recycled through a free list
+     * @details A handle consists of the index of its slot and the generation of that slot at the time it was allocated, the generation is incremented every time a slot is reused so stale handles are detected rather than resolving to a newer object.
+     * Lookups don't take any locks, they validate the generation of the slot before and after reading it and only allocations and deletions are serialized amongst each other.
+     * Objects can also be borrowed as a raw pointer without any reference counting for the duration of a BorrowScope, deleted objects are retired rather than being destroyed immediately and are only released once every scope that could have borrowed them has ended (An epoch-based scheme with two alternating counters of active scopes)
+     */
+    class HandleTable {
+      public:
+        static constexpr u8 IndexBits{15}; //!< The amount of bits in a handle used for the index of the slot
+        static constexpr u8 GenerationBits{15}; //!< The amount of bits in a handle used for the generation of the slot, the handle is kept below bit 30 as it's used as a flag in mutex owner values
+        static constexpr size_t MaxHandles{1U << IndexBits}; //!< The maximum amount of handles that can be allocated at once
+        static constexpr size_t ChunkSize{0x400}; //!< The amount of slots that are allocated together, chunks are only allocated when the table grows into them
+
+        /**
+         * @brief An object resolved from a handle along with its type
+         */
+        struct Entry {
+            std::shared_ptr<type::KObject> object; //!< The object the handle refers to, this is null if the handle is invalid
+            type::KType type; //!< The type of the object
+        };
+
+        /**
+         * @brief An object borrowed from a handle along with its type, the object is only guaranteed to be alive till the BorrowScope it was borrowed in ends
+         */
+        struct BorrowedEntry {
+            type::KObject *object; //!< The object the handle refers to, this is null if the handle is invalid
+            type::KType type; //!< The type of the object
+        };
+
+        /**
+         * @brief A RAII wrapper over a section of code that borrows objects from the table, no objects that were deleted after the scope started are destroyed till it has ended
+         * @note Scopes are meant to be short-lived as they hold back the destruction of all deleted objects, they shouldn't be held across any waits that could be indefinite
+         */
+        class BorrowScope {
+          private:
+            HandleTable &table;
+            u32 epoch; //!< The epoch that the scope was started in
+
+          public:
+            BorrowScope(HandleTable &table) : table(table), epoch(table.EnterBorrow()) {}
+
+            BorrowScope(const BorrowScope &) = delete;
+
+            ~BorrowScope() {
+                table.ExitBorrow(epoch);
+            }
+        };
+
+      private:
+        static constexpr u32 IndexMask{(1U << IndexBits) - 1};
+        static constexpr u32 GenerationMask{(1U << GenerationBits) - 1};
+        static constexpr u8 TypeShift{16}; //!< The offset of the object's type in a slot's tag
+        static constexpr u32 PublishedFlag{1U << 31}; //!< The flag in a slot's tag which is set while the slot holds an object that can be looked up
+        static constexpr u32 ReservedFlag{1U << 30}; //!< The flag in a slot's tag which is set while the slot's handle has been reserved but no object has been published in it
+        static constexpr u32 AnyGeneration{std::numeric_limits<u32>::max()}; //!< A placeholder generation for lookups which accept a slot with any generation
+
+        /**
+         * @brief A single slot of the table
+         */
+        struct Slot {
+            std::atomic<u32> tag{}; //!< The generation of the slot in the low bits along with the type of the object and PublishedFlag when it holds an object
+            std::shared_ptr<type::KObject> object; //!< The object in the slot, this is only accessed with the atomic shared_ptr functions as it can be read concurrently with being replaced
+            std::atomic<type::KObject *> borrowed{}; //!< A raw pointer to the object in the slot for borrowed lookups, this is left stale after a deletion as the tag is validated around reading it
+        };
+
+        std::array<std::atomic<Slot *>, MaxHandles / ChunkSize> chunks{}; //!< The chunks of slots, these are only allocated once and aren't freed till the table is destroyed
+        std::mutex mutex; //!< This mutex serializes allocations and deletions, lookups never take it
+        std::vector<u32> freeIndices; //!< The indices of slots that have been freed and can be reused
+        std::atomic<u32> slotCount{}; //!< The amount of slots that have ever been allocated, all slots past this are unused
+
+        std::atomic<u32> epoch{}; //!< The current epoch of reclamation, this is only advanced while holding the mutex
+        std::array<std::atomic<u32>, 2> borrowers{}; //!< The amount of active borrow scopes that were started in even and odd epochs
+        std::array<std::vector<std::shared_ptr<type::KObject>>, 2> retired; //!< The objects that were deleted in even and odd epochs and are yet to be released, these are guarded by the mutex
+        std::atomic<bool> retiring{}; //!< If there are any retired objects that are yet to be released
+
+        /**
+         * @return The epoch that the borrow scope was started in
+         */
+        inline u32 EnterBorrow() {
+            while (true) {
+                // The epoch is validated after announcing the scope, if it was advanced concurrently the scope might've been missed by the check for active scopes and is retried in the new epoch
+                auto current{epoch.load(std::memory_order_acquire)};
+                borrowers[current & 1].fetch_add(1, std::memory_order_seq_cst);
+                if (epoch.load(std::memory_order_seq_cst) == current)
+                    return current;
+                borrowers[current & 1].fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        inline void ExitBorrow(u32 current) {
+            if (borrowers[current & 1].fetch_sub(1, std::memory_order_acq_rel) == 1 && retiring.load(std::memory_order_acquire))
+                Reclaim();
+        }
+
+        /**
+         * @brief Advances the epoch as far as possible, this must be called with the mutex held
+         * @return The retired objects that can be released, they should be destroyed after the mutex has been unlocked
+         */
+        std::vector<std::shared_ptr<type::KObject>> AdvanceEpoch();
+
+        /**
+         * @brief Releases any retired objects that are no longer reachable by a borrow scope, this is skipped if the table is locked in which case it's retried when the next scope ends
+         */
+        void Reclaim();
+
+        /**
+         * @return The slot at the specified index, this is null if the chunk it's in hasn't been allocated
+         */
+        inline Slot *GetSlot(u32 index) {
+            auto chunk{chunks[index / ChunkSize].load(std::memory_order_acquire)};
+            return chunk ? chunk + (index % ChunkSize) : nullptr;
+        }
+
+        /**
+         * @brief Looks up the entry for a slot, this validates the tag before and after reading it so a concurrent deletion or reuse of the slot is never observed
+         * @param generation The generation that the slot should have, any generation is accepted if this is AnyGeneration in which case it's set to the generation of the slot
+         */
+        inline Entry Lookup(Slot &slot, u32 &generation) {
+            auto tag{slot.tag.load(std::memory_order_acquire)};
+            if (!(tag & PublishedFlag))
+                return {};
+            if (generation == AnyGeneration)
+                generation = tag & GenerationMask;
+            else if ((tag & GenerationMask) != generation)
+                return {};
+
+            auto object{std::atomic_load_explicit(&slot.object, std::memory_order_acquire)};
+            if (slot.tag.load(std::memory_order_acquire) != tag)
+                return {};
+
+            return {std::move(object), static_cast<type::KType>((tag & ~PublishedFlag) >> TypeShift)};
+        }
+
+        /**
+         * @brief Looks up the borrowed entry for a slot, this validates the tag in the same way as Lookup
+         */
+        inline BorrowedEntry LookupBorrowed(Slot &slot, u32 generation) {
+            auto tag{slot.tag.load(std::memory_order_acquire)};
+            if (!(tag & PublishedFlag) || (tag & GenerationMask) != generation)
+                return {};
+
+            auto object{slot.borrowed.load(std::memory_order_acquire)};
+            if (slot.tag.load(std::memory_order_acquire) != tag)
+                return {};
+
+            return {object, static_cast<type::KType>((tag & ~PublishedFlag) >> TypeShift)};
+        }
+
+      public:
+        HandleTable() = default;
+
+        HandleTable(const HandleTable &) = delete;
+
+        ~HandleTable();
+
+        /**
+         * @brief Reserves a handle without an object, this is used for objects that need to know their handle during construction
+         * @return The reserved handle, this must be passed to Publish or Delete afterwards
+         */
+        KHandle Reserve();
+
+        /**
+         * @brief Publishes an object with a handle that was returned by Reserve, it can be looked up after this
+         */
+        void Publish(KHandle handle, std::shared_ptr<type::KObject> object);
+
+        /**
+         * @brief Inserts an object into the table
+         * @return The handle of the object
+         */
+        inline KHandle Insert(std::shared_ptr<type::KObject> object) {
+            auto handle{Reserve()};
+            Publish(handle, std::move(object));
+            return handle;
+        }
+
+        /**
+         * @brief Removes a handle from the table, the slot is reused by a later handle with a different generation
+         * @return If the handle was valid and has been removed
+         * @note The table's reference to the object is retired and dropped once no borrow scope can reference it, this is always done after the table has been unlocked as destruction might call into the guest
+         */
+        bool Delete(KHandle handle);
+
+        /**
+         * @brief Looks up the object that a handle refers to without taking any locks
+         * @return The entry for the handle, the object in it is null if the handle is invalid
+         */
+        inline Entry Get(KHandle handle) {
+            auto index{handle & IndexMask}, generation{(handle >> IndexBits) & GenerationMask};
+            if (!generation || (handle >> (IndexBits + GenerationBits)) || index >= slotCount.load(std::memory_order_acquire))
+                return {};
+
+            auto slot{GetSlot(index)};
+            return slot ? Lookup(*slot, generation) : Entry{};
+        }
+
+        /**
+         * @brief Looks up the object that a handle refers to without taking any locks or references
+         * @return The borrowed entry for the handle, the object in it is null if the handle is invalid
+         * @note This must only be called within a BorrowScope on this table, the object isn't guaranteed to be alive once the scope has ended
+         */
+        inline BorrowedEntry Borrow(KHandle handle) {
+            auto index{handle & IndexMask}, generation{(handle >> IndexBits) & GenerationMask};
+            if (!generation || (handle >> (IndexBits + GenerationBits)) || index >= slotCount.load(std::memory_order_acquire))
+                return {};
+
+            auto slot{GetSlot(index)};
+            return slot ? LookupBorrowed(*slot, generation) : BorrowedEntry{};
+        }
+
+        /**
+         * @brief Calls the specified function with the handle and entry of every object in the table till it returns true
+         * @note Objects that are inserted or deleted concurrently might not be visited
+         */
+        template<typename Function>
+        void ForEach(Function function) {
+            auto count{slotCount.load(std::memory_order_acquire)};
+            for (u32 index{}; index < count; index++) {
+                auto slot{GetSlot(index)};
+                if (!slot)
+                    continue;
+
+                auto generation{AnyGeneration};
+                auto entry{Lookup(*slot, generation)};
+                if (entry.object && function(static_cast<KHandle>((generation << IndexBits) | index), entry))
+                    return;
+            }
+        }
+    };
+}
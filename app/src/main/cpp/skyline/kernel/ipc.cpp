@@ -15,69 +15,125 @@ namespace skyline::kernel::ipc {
 
     OutputBuffer::OutputBuffer(kernel::ipc::BufferDescriptorC *cBuf) : IpcBuffer(cBuf->address, cBuf->size, IpcBufferType::C) {}
 
-    IpcRequest::IpcRequest(bool isDomain, const DeviceState &state) : isDomain(isDomain) {
-        u8 *tls = state.process->GetPointer<u8>(state.thread->tls);
-        u8 *pointer = tls;
+    IpcRequestLayout IpcRequestLayout::Compute(u64 rawHeader, u32 rawHandleDesc, bool isDomain) {
+        CommandHeader header;
+        std::memcpy(&header, &rawHeader, sizeof(CommandHeader));
+
+        IpcRequestLayout layout{
+            .header = rawHeader,
+            .handleDesc = rawHandleDesc,
+            .isDomain = isDomain,
+            .valid = true,
+        };
+
+        size_t offset{sizeof(CommandHeader)};
+        if (header.handleDesc) {
+            HandleDescriptor handleDesc;
+            std::memcpy(&handleDesc, &rawHandleDesc, sizeof(HandleDescriptor));
+            offset += sizeof(HandleDescriptor) + (handleDesc.sendPid ? sizeof(u64) : 0);
+            layout.handlesOffset = static_cast<u16>(offset);
+            offset += (handleDesc.copyCount + handleDesc.moveCount) * sizeof(KHandle);
+        }
 
-        header = reinterpret_cast<CommandHeader *>(pointer);
-        pointer += sizeof(CommandHeader);
+        layout.xOffset = static_cast<u16>(offset);
+        offset += header.xNo * sizeof(BufferDescriptorX);
+        layout.aOffset = static_cast<u16>(offset);
+        offset += header.aNo * sizeof(BufferDescriptorABW);
+        layout.bOffset = static_cast<u16>(offset);
+        offset += header.bNo * sizeof(BufferDescriptorABW);
+        layout.wOffset = static_cast<u16>(offset);
+        offset += header.wNo * sizeof(BufferDescriptorABW);
 
-        size_t cBufferLengthSize = util::AlignUp(((header->cFlag == BufferCFlag::None) ? 0 : ((header->cFlag > BufferCFlag::SingleDescriptor) ? (static_cast<u8>(header->cFlag) - 2) : 1)) * sizeof(u16), sizeof(u32));
+        layout.padding = static_cast<u8>(util::AlignUp(offset, constant::IpcPaddingSum) - offset); // Calculate the amount of padding at the front
+        layout.dataOffset = static_cast<u16>(offset + layout.padding);
+        layout.cBufferLengthSize = static_cast<u8>(util::AlignUp(((header.cFlag == BufferCFlag::None) ? 0 : ((header.cFlag > BufferCFlag::SingleDescriptor) ? (static_cast<u8>(header.cFlag) - 2) : 1)) * sizeof(u16), sizeof(u32)));
 
-        if (header->handleDesc) {
-            handleDesc = reinterpret_cast<HandleDescriptor *>(pointer);
-            pointer += sizeof(HandleDescriptor) + (handleDesc->sendPid ? sizeof(u64) : 0);
-            for (u32 index = 0; handleDesc->copyCount > index; index++) {
-                copyHandles.push_back(*reinterpret_cast<KHandle *>(pointer));
-                pointer += sizeof(KHandle);
-            }
-            for (u32 index = 0; handleDesc->moveCount > index; index++) {
-                moveHandles.push_back(*reinterpret_cast<KHandle *>(pointer));
-                pointer += sizeof(KHandle);
-            }
+        layout.cmdArgSz = (header.rawSize * sizeof(u32)) - (constant::IpcPaddingSum + sizeof(PayloadHeader)) - layout.cBufferLengthSize;
+        layout.cOffset = static_cast<u16>(layout.dataOffset + sizeof(PayloadHeader) + layout.cmdArgSz + constant::IpcPaddingSum - layout.padding + layout.cBufferLengthSize);
+
+        return layout;
+    }
+
+    const IpcRequestLayout &IpcLayoutCache::Get(u64 rawHeader, u32 rawHandleDesc, bool isDomain, bool &hit) {
+        auto &layout{layouts[(rawHeader ^ (rawHeader >> 32) ^ rawHandleDesc) % Size]};
+        hit = layout.Matches(rawHeader, rawHandleDesc, isDomain);
+        if (!hit)
+            layout = IpcRequestLayout::Compute(rawHeader, rawHandleDesc, isDomain);
+        return layout;
+    }
+
+    IpcRequest::IpcRequest(bool isDomain, const DeviceState &state, IpcLayoutCache *layoutCache) : isDomain(isDomain) {
+        u8 *tls = state.process->GetPointer<u8>(state.thread->tls);
+
+        header = reinterpret_cast<CommandHeader *>(tls);
+        if (header->handleDesc)
+            handleDesc = reinterpret_cast<HandleDescriptor *>(tls + sizeof(CommandHeader));
+
+        u64 rawHeader;
+        std::memcpy(&rawHeader, header, sizeof(CommandHeader));
+        u32 rawHandleDesc{};
+        if (handleDesc)
+            std::memcpy(&rawHandleDesc, handleDesc, sizeof(HandleDescriptor));
+
+        // Requests with a shape that has been seen before on the session reuse its layout and aren't logged in detail again
+        bool cached{};
+        IpcRequestLayout computedLayout;
+        const IpcRequestLayout *layoutPointer;
+        if (layoutCache) {
+            layoutPointer = &layoutCache->Get(rawHeader, rawHandleDesc, isDomain, cached);
+        } else {
+            computedLayout = IpcRequestLayout::Compute(rawHeader, rawHandleDesc, isDomain);
+            layoutPointer = &computedLayout;
+        }
+        const auto &layout{*layoutPointer};
+
+        if (handleDesc) {
+            auto handles{reinterpret_cast<KHandle *>(tls + layout.handlesOffset)};
+            for (u32 index = 0; handleDesc->copyCount > index; index++)
+                copyHandles.push_back(*handles++);
+            for (u32 index = 0; handleDesc->moveCount > index; index++)
+                moveHandles.push_back(*handles++);
         }
 
-        for (u8 index = 0; header->xNo > index; index++) {
-            auto bufX = reinterpret_cast<BufferDescriptorX *>(pointer);
+        auto bufX = reinterpret_cast<BufferDescriptorX *>(tls + layout.xOffset);
+        for (u8 index = 0; header->xNo > index; index++, bufX++) {
             if (bufX->Address()) {
                 inputBuf.emplace_back(bufX);
-                state.logger->Debug("Buf X #{} AD: 0x{:X} SZ: 0x{:X} CTR: {}", index, u64(bufX->Address()), u16(bufX->size), u16(bufX->Counter()));
+                if (!cached)
+                    LOGD(state.logger, "Buf X #{} AD: 0x{:X} SZ: 0x{:X} CTR: {}", index, u64(bufX->Address()), u16(bufX->size), u16(bufX->Counter()));
             }
-            pointer += sizeof(BufferDescriptorX);
         }
 
-        for (u8 index = 0; header->aNo > index; index++) {
-            auto bufA = reinterpret_cast<BufferDescriptorABW *>(pointer);
+        auto bufA = reinterpret_cast<BufferDescriptorABW *>(tls + layout.aOffset);
+        for (u8 index = 0; header->aNo > index; index++, bufA++) {
             if (bufA->Address()) {
                 inputBuf.emplace_back(bufA);
-                state.logger->Debug("Buf A #{} AD: 0x{:X} SZ: 0x{:X}", index, u64(bufA->Address()), u64(bufA->Size()));
+                if (!cached)
+                    LOGD(state.logger, "Buf A #{} AD: 0x{:X} SZ: 0x{:X}", index, u64(bufA->Address()), u64(bufA->Size()));
             }
-            pointer += sizeof(BufferDescriptorABW);
         }
 
-        for (u8 index = 0; header->bNo > index; index++) {
-            auto bufB = reinterpret_cast<BufferDescriptorABW *>(pointer);
+        auto bufB = reinterpret_cast<BufferDescriptorABW *>(tls + layout.bOffset);
+        for (u8 index = 0; header->bNo > index; index++, bufB++) {
             if (bufB->Address()) {
                 outputBuf.emplace_back(bufB);
-                state.logger->Debug("Buf B #{} AD: 0x{:X} SZ: 0x{:X}", index, u64(bufB->Address()), u64(bufB->Size()));
+                if (!cached)
+                    LOGD(state.logger, "Buf B #{} AD: 0x{:X} SZ: 0x{:X}", index, u64(bufB->Address()), u64(bufB->Size()));
             }
-            pointer += sizeof(BufferDescriptorABW);
         }
 
-        for (u8 index = 0; header->wNo > index; index++) {
-            auto bufW = reinterpret_cast<BufferDescriptorABW *>(pointer);
+        auto bufW = reinterpret_cast<BufferDescriptorABW *>(tls + layout.wOffset);
+        for (u8 index = 0; header->wNo > index; index++, bufW++) {
             if (bufW->Address()) {
                 inputBuf.emplace_back(bufW, IpcBufferType::W);
                 outputBuf.emplace_back(bufW, IpcBufferType::W);
-                state.logger->Debug("Buf W #{} AD: 0x{:X} SZ: 0x{:X}", index, u64(bufW->Address()), u16(bufW->Size()));
+                if (!cached)
+                    LOGD(state.logger, "Buf W #{} AD: 0x{:X} SZ: 0x{:X}", index, u64(bufW->Address()), u16(bufW->Size()));
             }
-            pointer += sizeof(BufferDescriptorABW);
         }
 
-        auto offset = reinterpret_cast<u64>(pointer) - reinterpret_cast<u64>(tls); // We calculate the relative offset as the absolute one might differ
-        auto padding = util::AlignUp(offset, constant::IpcPaddingSum) - offset; // Calculate the amount of padding at the front
-        pointer += padding;
-
+        u8 *pointer = tls + layout.dataOffset;
+        u8 *cPointer;
         if (isDomain && (header->type == CommandType::Request || header->type == CommandType::RequestWithContext)) {
             domain = reinterpret_cast<DomainHeaderRequest *>(pointer);
             pointer += sizeof(DomainHeaderRequest);
@@ -93,46 +149,51 @@ namespace skyline::kernel::ipc {
                 domainObjects.push_back(*reinterpret_cast<KHandle *>(pointer));
                 pointer += sizeof(KHandle);
             }
+
+            cPointer = pointer + constant::IpcPaddingSum - layout.padding + layout.cBufferLengthSize;
         } else {
             payload = reinterpret_cast<PayloadHeader *>(pointer);
-            pointer += sizeof(PayloadHeader);
-
-            cmdArg = pointer;
-            cmdArgSz = (header->rawSize * sizeof(u32)) - (constant::IpcPaddingSum + sizeof(PayloadHeader)) - cBufferLengthSize;
-            pointer += cmdArgSz;
+            cmdArg = pointer + sizeof(PayloadHeader);
+            cmdArgSz = layout.cmdArgSz;
+            cPointer = tls + layout.cOffset;
         }
 
         payloadOffset = cmdArg;
 
         if (payload->magic != util::MakeMagic<u32>("SFCI") && (header->type != CommandType::Control && header->type != CommandType::ControlWithContext)) // SFCI is the magic in received IPC messages
-            state.logger->Debug("Unexpected Magic in PayloadHeader: 0x{:X}", u32(payload->magic));
-
-        pointer += constant::IpcPaddingSum - padding + cBufferLengthSize;
+            LOGD(state.logger, "Unexpected Magic in PayloadHeader: 0x{:X}", u32(payload->magic));
 
         if (header->cFlag == BufferCFlag::SingleDescriptor) {
-            auto bufC = reinterpret_cast<BufferDescriptorC *>(pointer);
+            auto bufC = reinterpret_cast<BufferDescriptorC *>(cPointer);
             if (bufC->address) {
                 outputBuf.emplace_back(bufC);
-                state.logger->Debug("Buf C: AD: 0x{:X} SZ: 0x{:X}", u64(bufC->address), u16(bufC->size));
+                if (!cached)
+                    LOGD(state.logger, "Buf C: AD: 0x{:X} SZ: 0x{:X}", u64(bufC->address), u16(bufC->size));
             }
         } else if (header->cFlag > BufferCFlag::SingleDescriptor) {
-            for (u8 index = 0; (static_cast<u8>(header->cFlag) - 2) > index; index++) { // (cFlag - 2) C descriptors are present
-                auto bufC = reinterpret_cast<BufferDescriptorC *>(pointer);
+            auto bufC = reinterpret_cast<BufferDescriptorC *>(cPointer);
+            for (u8 index = 0; (static_cast<u8>(header->cFlag) - 2) > index; index++, bufC++) { // (cFlag - 2) C descriptors are present
                 if (bufC->address) {
                     outputBuf.emplace_back(bufC);
-                    state.logger->Debug("Buf C #{} AD: 0x{:X} SZ: 0x{:X}", index, u64(bufC->address), u16(bufC->size));
+                    if (!cached)
+                        LOGD(state.logger, "Buf C #{} AD: 0x{:X} SZ: 0x{:X}", index, u64(bufC->address), u16(bufC->size));
                 }
-                pointer += sizeof(BufferDescriptorC);
             }
         }
 
+        // Services write into output buffers through the host mirror, this bypasses write tracking so the writes are reported up front for every buffer
+        for (const auto &buffer : outputBuf)
+            state.process->MarkHostWrite(buffer.address, buffer.size);
+
         if (header->type == CommandType::Request || header->type == CommandType::RequestWithContext) {
-            state.logger->Debug("Header: Input No: {}, Output No: {}, Raw Size: {}", inputBuf.size(), outputBuf.size(), u64(cmdArgSz));
-            if (header->handleDesc)
-                state.logger->Debug("Handle Descriptor: Send PID: {}, Copy Count: {}, Move Count: {}", bool(handleDesc->sendPid), u32(handleDesc->copyCount), u32(handleDesc->moveCount));
-            if (isDomain)
-                state.logger->Debug("Domain Header: Command: {}, Input Object Count: {}, Object ID: 0x{:X}", domain->command, domain->inputCount, domain->objectId);
-            state.logger->Debug("Command ID: 0x{:X}", u32(payload->value));
+            if (!cached) {
+                LOGD(state.logger, "Header: Input No: {}, Output No: {}, Raw Size: {}", inputBuf.size(), outputBuf.size(), u64(cmdArgSz));
+                if (header->handleDesc)
+                    LOGD(state.logger, "Handle Descriptor: Send PID: {}, Copy Count: {}, Move Count: {}", bool(handleDesc->sendPid), u32(handleDesc->copyCount), u32(handleDesc->moveCount));
+                if (isDomain)
+                    LOGD(state.logger, "Domain Header: Command: {}, Input Object Count: {}, Object ID: 0x{:X}", domain->command, domain->inputCount, domain->objectId);
+            }
+            LOGD(state.logger, "Command ID: 0x{:X}", u32(payload->value));
         }
     }
 
@@ -142,11 +203,19 @@ namespace skyline::kernel::ipc {
         auto tls = state.process->GetPointer<u8>(state.thread->tls);
         u8 *pointer = tls;
 
-        memset(tls, 0, constant::TlsIpcSize);
+        auto rawSize = static_cast<u32>((sizeof(PayloadHeader) + payloadSize + (domainObjects.size() * sizeof(KHandle)) + constant::IpcPaddingSum + (isDomain ? sizeof(DomainHeaderRequest) : 0)) / sizeof(u32)); // Size is in 32-bit units because Nintendo
+        bool hasHandles = (!copyHandles.empty() || !moveHandles.empty());
+
+        // Only the part of the command buffer covered by the response is cleared as the guest doesn't read past the raw data
+        auto handlesSize = sizeof(CommandHeader) + (hasHandles ? sizeof(HandleDescriptor) + (copyHandles.size() + moveHandles.size()) * sizeof(KHandle) : 0);
+        auto responseSize = handlesSize + rawSize * sizeof(u32);
+        if (responseSize > constant::TlsIpcSize)
+            throw exception("IPC response is larger than the TLS command buffer: 0x{:X}", responseSize);
+        std::memset(tls, 0, responseSize);
 
         auto header = reinterpret_cast<CommandHeader *>(pointer);
-        header->rawSize = static_cast<u32>((sizeof(PayloadHeader) + payload.size() + (domainObjects.size() * sizeof(KHandle)) + constant::IpcPaddingSum + (isDomain ? sizeof(DomainHeaderRequest) : 0)) / sizeof(u32)); // Size is in 32-bit units because Nintendo
-        header->handleDesc = (!copyHandles.empty() || !moveHandles.empty());
+        header->rawSize = rawSize;
+        header->handleDesc = hasHandles;
         pointer += sizeof(CommandHeader);
 
         if (header->handleDesc) {
@@ -182,9 +251,8 @@ namespace skyline::kernel::ipc {
         payloadHeader->value = errorCode;
         pointer += sizeof(PayloadHeader);
 
-        if (!payload.empty())
-            std::memcpy(pointer, payload.data(), payload.size());
-        pointer += payload.size();
+        std::memcpy(pointer, payload.data(), payloadSize);
+        pointer += payloadSize;
 
         if (isDomain) {
             for (auto &domainObject : domainObjects) {
@@ -193,6 +261,6 @@ namespace skyline::kernel::ipc {
             }
         }
 
-        state.logger->Debug("Output: Raw Size: {}, Command ID: 0x{:X}, Copy Handles: {}, Move Handles: {}", u32(header->rawSize), u32(payloadHeader->value), copyHandles.size(), moveHandles.size());
+        LOGD(state.logger, "Output: Raw Size: {}, Command ID: 0x{:X}, Copy Handles: {}, Move Handles: {}", u32(header->rawSize), u32(payloadHeader->value), copyHandles.size(), moveHandles.size());
     }
 }
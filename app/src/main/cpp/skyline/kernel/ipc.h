@@ -10,6 +10,10 @@ namespace skyline {
     namespace constant {
         constexpr auto IpcPaddingSum = 0x10; // The sum of the padding surrounding the data payload
         constexpr auto TlsIpcSize = 0x100; // The size of the IPC command buffer in a TLS slot
+        constexpr size_t IpcMaxHandles = 0xF; // The maximum amount of copy or move handles in an IPC message, this is limited by the size of HandleDescriptor::copyCount and HandleDescriptor::moveCount
+        constexpr size_t IpcMaxDomainObjects = TlsIpcSize / sizeof(u32); // The maximum amount of domain objects in an IPC message, this is limited by how many handles would fit into the TLS command buffer
+        constexpr size_t IpcMaxInputBuffers = 0xF * 3; // The maximum amount of input buffers in an IPC request, there can be up to 15 X, A and W buffers each
+        constexpr size_t IpcMaxOutputBuffers = 0xF * 2 + 0xD; // The maximum amount of output buffers in an IPC request, there can be up to 15 B and W buffers each and 13 C buffers
     }
 
     namespace kernel::ipc {
@@ -242,6 +246,52 @@ namespace skyline {
             OutputBuffer(kernel::ipc::BufferDescriptorC *cBuf);
         };
 
+        /**
+         * @brief The offsets of all sections of an IPC request in the TLS command buffer, these only depend on the command header and the handle descriptor so they're reused across requests with the same shape
+         */
+        struct IpcRequestLayout {
+            u64 header; //!< The raw command header this layout was computed for
+            u32 handleDesc; //!< The raw handle descriptor this layout was computed for, this is 0 if there's no handle descriptor
+            bool isDomain; //!< If this layout was computed for a domain session
+            bool valid; //!< If this layout has been computed, this is false for unused entries of a cache
+            u16 handlesOffset; //!< The offset of the copy handles, the move handles follow them
+            u16 xOffset; //!< The offset of the X buffer descriptors
+            u16 aOffset; //!< The offset of the A buffer descriptors
+            u16 bOffset; //!< The offset of the B buffer descriptors
+            u16 wOffset; //!< The offset of the W buffer descriptors
+            u16 dataOffset; //!< The offset of the data payload or the domain header, this is after the padding in front of it
+            u8 padding; //!< The amount of padding between the buffer descriptors and the data payload
+            u8 cBufferLengthSize; //!< The size of the C buffer size list in the data payload
+            u16 cOffset; //!< The offset of the C buffer descriptors for non-domain requests, the offset in domain requests depends on the domain header
+            u64 cmdArgSz; //!< The size of the data payload in non-domain requests
+
+            /**
+             * @return If this layout applies to a request with the specified shape
+             */
+            inline bool Matches(u64 rawHeader, u32 rawHandleDesc, bool domain) const {
+                return valid && header == rawHeader && handleDesc == rawHandleDesc && isDomain == domain;
+            }
+
+            /**
+             * @brief Computes the layout of a request with the specified shape
+             */
+            static IpcRequestLayout Compute(u64 rawHeader, u32 rawHandleDesc, bool isDomain);
+        };
+
+        /**
+         * @brief A small direct-mapped cache of request layouts, sessions see the same few request shapes repeatedly so their layouts only have to be computed once
+         */
+        struct IpcLayoutCache {
+            static constexpr size_t Size{8}; //!< The amount of layouts held by the cache
+            std::array<IpcRequestLayout, Size> layouts{};
+
+            /**
+             * @param hit This is set to true if the layout was already in the cache
+             * @return The layout of a request with the specified shape
+             */
+            const IpcRequestLayout &Get(u64 rawHeader, u32 rawHandleDesc, bool isDomain, bool &hit);
+        };
+
         /**
          * @brief This class encapsulates an IPC Request (https://switchbrew.org/wiki/IPC_Marshalling)
          */
@@ -257,17 +307,18 @@ namespace skyline {
             PayloadHeader *payload{}; //!< This is the header of the payload
             u8 *cmdArg{}; //!< This is a pointer to the data payload (End of PayloadHeader)
             u64 cmdArgSz{}; //!< This is the size of the data payload
-            std::vector<KHandle> copyHandles; //!< A vector of handles that should be copied from the server to the client process (The difference is just to match application expectations, there is no real difference b/w copying and moving handles)
-            std::vector<KHandle> moveHandles; //!< A vector of handles that should be moved from the server to the client process rather than copied
-            std::vector<KHandle> domainObjects; //!< A vector of all input domain objects
-            std::vector<InputBuffer> inputBuf; //!< This is a vector of input buffers
-            std::vector<OutputBuffer> outputBuf; //!< This is a vector of output buffers
+            StaticVector<KHandle, constant::IpcMaxHandles> copyHandles; //!< A vector of handles that should be copied from the server to the client process (The difference is just to match application expectations, there is no real difference b/w copying and moving handles)
+            StaticVector<KHandle, constant::IpcMaxHandles> moveHandles; //!< A vector of handles that should be moved from the server to the client process rather than copied
+            StaticVector<KHandle, constant::IpcMaxDomainObjects> domainObjects; //!< A vector of all input domain objects
+            StaticVector<InputBuffer, constant::IpcMaxInputBuffers> inputBuf; //!< This is a vector of input buffers
+            StaticVector<OutputBuffer, constant::IpcMaxOutputBuffers> outputBuf; //!< This is a vector of output buffers
 
             /**
              * @param isDomain If the following request is a domain request
              * @param state The state of the device
+             * @param layoutCache A cache of request layouts to look the layout of this request up in, the request's buffers are only logged when its layout isn't cached
              */
-            IpcRequest(bool isDomain, const DeviceState &state);
+            IpcRequest(bool isDomain, const DeviceState &state, IpcLayoutCache *layoutCache = nullptr);
 
             /**
              * @brief This returns a reference to an item from the top of the payload
@@ -306,13 +357,27 @@ namespace skyline {
         class IpcResponse {
           private:
             const DeviceState &state; //!< The state of the device
-            std::vector<u8> payload; //!< This holds all of the contents to be pushed to the payload
+            std::array<u8, constant::TlsIpcSize> payload; //!< This holds all of the contents to be pushed to the payload, it can't be larger than the TLS command buffer it's written into
+            size_t payloadSize{}; //!< The amount of bytes in the payload that have been pushed
+
+            /**
+             * @brief Reserves space at the end of the payload
+             * @param size The amount of bytes to reserve
+             * @return A pointer to the reserved space
+             */
+            inline u8 *ReservePayload(size_t size) {
+                if (payloadSize + size > payload.size())
+                    throw exception("IPC response payload cannot be larger than 0x{:X} bytes", payload.size());
+                auto pointer{payload.data() + payloadSize};
+                payloadSize += size;
+                return pointer;
+            }
 
           public:
             Result errorCode{}; //!< The error code to respond with, it is 0 (Success) by default
-            std::vector<KHandle> copyHandles; //!< A vector of handles to copy
-            std::vector<KHandle> moveHandles; //!< A vector of handles to move
-            std::vector<KHandle> domainObjects; //!< A vector of domain objects to write
+            StaticVector<KHandle, constant::IpcMaxHandles> copyHandles; //!< A vector of handles to copy
+            StaticVector<KHandle, constant::IpcMaxHandles> moveHandles; //!< A vector of handles to move
+            StaticVector<KHandle, constant::IpcMaxDomainObjects> domainObjects; //!< A vector of domain objects to write
 
             /**
              * @param isDomain If the following request is a domain request
@@ -327,10 +392,7 @@ namespace skyline {
              */
             template<typename ValueType>
             inline void Push(const ValueType &value) {
-                auto size = payload.size();
-                payload.resize(size + sizeof(ValueType));
-
-                std::memcpy(payload.data() + size, reinterpret_cast<const u8 *>(&value), sizeof(ValueType));
+                std::memcpy(ReservePayload(sizeof(ValueType)), reinterpret_cast<const u8 *>(&value), sizeof(ValueType));
             }
 
             /**
@@ -339,14 +401,11 @@ namespace skyline {
              */
             template<>
             inline void Push(const std::string &string) {
-                auto size = payload.size();
-                payload.resize(size + string.size());
-
-                std::memcpy(payload.data() + size, string.data(), string.size());
+                std::memcpy(ReservePayload(string.size()), string.data(), string.size());
             }
 
             /**
-             * @brief Writes this IpcResponse object's contents into TLS
+             * @brief Writes this IpcResponse object's contents into TLS, only the part of the command buffer that's used by the response is cleared
              * @param isDomain Indicates if this is a domain response
              */
             void WriteResponse(bool isDomain);
@@ -1,19 +1,46 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <boot_report.h>
 #include "memory.h"
 #include "types/KProcess.h"
 
 namespace skyline::kernel {
+    namespace {
+        thread_local size_t LastUpperChunk; //!< The index of the chunk returned by the last lookup of a thread, this is only a hint as it's validated prior to being used
+    }
+
+    std::vector<ChunkDescriptor>::iterator MemoryManager::FindUpperChunk(u64 address) {
+        auto isUpper{[&](size_t index) {
+            return index <= chunkList.size() && (index == 0 || chunkList[index - 1].address <= address) && (index == chunkList.size() || address < chunkList[index].address);
+        }};
+
+        // Walks of the address space query the region following the last one, so the memoized chunk and the one after it are checked first
+        if (isUpper(LastUpperChunk))
+            return chunkList.begin() + static_cast<ssize_t>(LastUpperChunk);
+        if (isUpper(LastUpperChunk + 1))
+            return chunkList.begin() + static_cast<ssize_t>(++LastUpperChunk);
+
+        auto upperChunk = std::upper_bound(chunkList.begin(), chunkList.end(), address, [](const u64 address, const ChunkDescriptor &chunk) -> bool {
+            return address < chunk.address;
+        });
+        LastUpperChunk = static_cast<size_t>(std::distance(chunkList.begin(), upperChunk));
+        return upperChunk;
+    }
+
     ChunkDescriptor *MemoryManager::GetChunk(u64 address) {
+        std::shared_lock lock(mutex);
         auto chunk = std::upper_bound(chunkList.begin(), chunkList.end(), address, [](const u64 address, const ChunkDescriptor &chunk) -> bool {
             return address < chunk.address;
         });
 
-        if (chunk-- != chunkList.begin()) {
-            if ((chunk->address + chunk->size) > address)
-                return chunk.base();
-        }
+        // The iterator can't be decremented past the start of the list, an address below the first chunk isn't in any chunk
+        if (chunk == chunkList.begin())
+            return nullptr;
+
+        chunk--;
+        if ((chunk->address + chunk->size) > address)
+            return chunk.base();
 
         return nullptr;
     }
@@ -27,7 +54,8 @@ namespace skyline::kernel {
                 return address < block.address;
             });
 
-            if (block-- != chunk->blockList.begin()) {
+            if (block != chunk->blockList.begin()) {
+                block--;
                 if ((block->address + block->size) > address)
                     return block.base();
             }
@@ -37,6 +65,7 @@ namespace skyline::kernel {
     }
 
     void MemoryManager::InsertChunk(const ChunkDescriptor &chunk) {
+        std::unique_lock lock(mutex);
         auto upperChunk = std::upper_bound(chunkList.begin(), chunkList.end(), chunk.address, [](const u64 address, const ChunkDescriptor &chunk) -> bool {
             return address < chunk.address;
         });
@@ -52,12 +81,14 @@ namespace skyline::kernel {
     }
 
     void MemoryManager::DeleteChunk(u64 address) {
-        for (auto chunk = chunkList.begin(), end = chunkList.end(); chunk != end;) {
-            if (chunk->address <= address && (chunk->address + chunk->size) > address)
-                chunk = chunkList.erase(chunk);
-            else
-                ++chunk;
-        }
+        std::unique_lock lock(mutex);
+        auto chunk = std::upper_bound(chunkList.begin(), chunkList.end(), address, [](const u64 address, const ChunkDescriptor &chunk) -> bool {
+            return address < chunk.address;
+        });
+
+        // Chunks never overlap so only the chunk directly below the address can contain it
+        if (chunk != chunkList.begin() && (std::prev(chunk)->address + std::prev(chunk)->size) > address)
+            chunkList.erase(std::prev(chunk));
     }
 
     void MemoryManager::ResizeChunk(ChunkDescriptor *chunk, size_t size) {
@@ -78,12 +109,11 @@ namespace skyline::kernel {
         } else if (size < chunk->size) {
             auto endAddress = chunk->address + size;
 
-            for (auto block = chunk->blockList.begin(), end = chunk->blockList.end(); block != end;) {
-                if (block->address > endAddress)
-                    block = chunk->blockList.erase(block);
-                else
-                    ++block;
-            }
+            // The block list is sorted so every block past the new end can be erased at once
+            auto firstErased = std::upper_bound(chunk->blockList.begin(), chunk->blockList.end(), endAddress, [](const u64 address, const BlockDescriptor &block) -> bool {
+                return address < block.address;
+            });
+            chunk->blockList.erase(firstErased, chunk->blockList.end());
 
             auto end = std::prev(chunk->blockList.end());
             end->size = endAddress - end->address;
@@ -96,29 +126,30 @@ namespace skyline::kernel {
         if (chunk->address + chunk->size < block.address + block.size)
             throw exception("InsertBlock: Inserting block past chunk end is not allowed");
 
-        for (auto iter = chunk->blockList.begin(); iter != chunk->blockList.end(); iter++) {
-            if (iter->address <= block.address) {
-                if ((iter->address + iter->size) > block.address) {
-                    if (iter->address == block.address && iter->size == block.size) {
-                        iter->attributes = block.attributes;
-                        iter->permission = block.permission;
-                    } else {
-                        auto endBlock = *iter;
-                        endBlock.address = (block.address + block.size);
-                        endBlock.size = (iter->address + iter->size) - endBlock.address;
-
-                        iter->size = block.address - iter->address;
-                        chunk->blockList.insert(std::next(iter), {block, endBlock});
-                    }
-                    return;
-                }
-            }
-        }
+        auto iter = std::upper_bound(chunk->blockList.begin(), chunk->blockList.end(), block.address, [](const u64 address, const BlockDescriptor &block) -> bool {
+            return address < block.address;
+        });
+
+        if (iter == chunk->blockList.begin() || (std::prev(iter)->address + std::prev(iter)->size) <= block.address)
+            throw exception("InsertBlock: Block offset not present within current block list");
+        iter--;
+
+        if (iter->address == block.address && iter->size == block.size) {
+            iter->attributes = block.attributes;
+            iter->permission = block.permission;
+        } else {
+            auto endBlock = *iter;
+            endBlock.address = (block.address + block.size);
+            endBlock.size = (iter->address + iter->size) - endBlock.address;
 
-        throw exception("InsertBlock: Block offset not present within current block list");
+            iter->size = block.address - iter->address;
+            chunk->blockList.insert(std::next(iter), {block, endBlock});
+        }
     }
 
     void MemoryManager::InitializeRegions(u64 address, u64 size, memory::AddressSpaceType type) {
+        boot::ScopedPhase phase(boot::Phase::MemoryMapping);
+
         switch (type) {
             case memory::AddressSpaceType::AddressSpace32Bit:
                 throw exception("32-bit address spaces are not supported");
@@ -148,8 +179,9 @@ namespace skyline::kernel {
                 addressSpace.size = 1UL << 39;
                 base.address = constant::BaseAddress;
                 base.size = 0x7FF8000000;
-                code.address = util::AlignDown(address, 0x200000);
-                code.size = util::AlignUp(address + size, 0x200000) - code.address;
+                // All regions are aligned to huge pages so memory mapped at the start of them can be backed by huge pages
+                code.address = util::AlignDown(address, constant::HugePageSize);
+                code.size = util::AlignUp(address + size, constant::HugePageSize) - code.address;
                 alias.address = code.address + code.size;
                 alias.size = 0x1000000000;
                 heap.address = alias.address + alias.size;
@@ -169,34 +201,27 @@ namespace skyline::kernel {
     MemoryManager::MemoryManager(const DeviceState &state) : state(state) {}
 
     std::optional<DescriptorPack> MemoryManager::Get(u64 address, bool requireMapped) {
-        auto chunk = GetChunk(address);
+        // The descriptors are copied out under a single lock, so they are consistent even if the memory map is modified concurrently
+        std::shared_lock lock(mutex);
+        auto upperChunk = FindUpperChunk(address);
 
-        if (chunk)
-            return DescriptorPack{*GetBlock(address, chunk), *chunk};
+        if (upperChunk != chunkList.begin()) {
+            auto chunk = std::prev(upperChunk);
+            if ((chunk->address + chunk->size) > address) {
+                auto block = std::upper_bound(chunk->blockList.begin(), chunk->blockList.end(), address, [](const u64 address, const BlockDescriptor &block) -> bool {
+                    return address < block.address;
+                });
+                if (block == chunk->blockList.begin())
+                    throw exception("Chunk at 0x{:X} has no block containing 0x{:X}", chunk->address, address);
+
+                return DescriptorPack{*std::prev(block), *chunk};
+            }
+        }
 
         // If the requested address is in the address space but no chunks are present then we return a new unmapped region
         if (addressSpace.IsInside(address) && !requireMapped) {
-            auto upperChunk = std::upper_bound(chunkList.begin(), chunkList.end(), address, [](const u64 address, const ChunkDescriptor &chunk) -> bool {
-                return address < chunk.address;
-            });
-
-            u64 upperAddress{};
-            u64 lowerAddress{};
-
-            if (upperChunk != chunkList.end()) {
-                upperAddress = upperChunk->address;
-
-                if (upperChunk == chunkList.begin()) {
-                    lowerAddress = addressSpace.address;
-                } else {
-                    upperChunk--;
-                    lowerAddress = upperChunk->address + upperChunk->size;
-                }
-            } else {
-                upperAddress = addressSpace.address + addressSpace.size;
-                lowerAddress = chunkList.back().address + chunkList.back().size;
-            }
-
+            u64 upperAddress{upperChunk != chunkList.end() ? upperChunk->address : addressSpace.address + addressSpace.size};
+            u64 lowerAddress{upperChunk != chunkList.begin() ? std::prev(upperChunk)->address + std::prev(upperChunk)->size : addressSpace.address};
             u64 size = upperAddress - lowerAddress;
 
             return DescriptorPack{
@@ -218,9 +243,43 @@ namespace skyline::kernel {
     size_t MemoryManager::GetProgramSize() {
         size_t size = 0;
 
+        std::shared_lock lock(mutex);
         for (const auto &chunk : chunkList)
             size += chunk.size;
 
         return size;
     }
+
+    size_t MemoryManager::GetCommittedSize() {
+        constexpr size_t ResidencyBatch{0x1000}; //!< The amount of pages that the residency of is queried at once
+        std::array<u8, ResidencyBatch> residency;
+        size_t size{};
+
+        std::shared_lock lock(mutex);
+        for (const auto &chunk : chunkList) {
+            if (!chunk.host) {
+                // Mappings without a host mirror aren't backed by shared memory that is sparse, so they're assumed to be committed entirely
+                size += chunk.size;
+                continue;
+            }
+
+            for (size_t offset{}; offset < chunk.size; offset += ResidencyBatch * PAGE_SIZE) {
+                auto batchSize{std::min(chunk.size - offset, ResidencyBatch * PAGE_SIZE)};
+                if (mincore(reinterpret_cast<void *>(chunk.host + offset), batchSize, residency.data())) {
+                    size += batchSize;
+                    continue;
+                }
+
+                auto pages{util::AlignUp(batchSize, PAGE_SIZE) / PAGE_SIZE};
+                size += static_cast<size_t>(std::count_if(residency.begin(), residency.begin() + static_cast<ssize_t>(pages), [](u8 page) { return page & 1; })) * PAGE_SIZE;
+            }
+        }
+
+        return size;
+    }
+
+    std::vector<ChunkDescriptor> MemoryManager::GetChunks() {
+        std::shared_lock lock(mutex);
+        return chunkList;
+    }
 }
@@ -198,6 +198,7 @@ namespace skyline {
     }
 
     namespace loader {
+        class Loader;
         class NroLoader;
         class NsoLoader;
         class NcaLoader;
@@ -233,6 +234,8 @@ namespace skyline {
             u64 address; //!< The address of the current chunk
             u64 size; //!< The size of the current chunk in bytes
             u64 host; //!< The address of the chunk in the host
+            int fd{-1}; //!< The shared memory that the host mirror is mapped from, this is -1 if there's no host mirror
+            u64 fdOffset{}; //!< The offset of the chunk in the shared memory
             memory::MemoryState state; //!< The MemoryState for the current block
             std::vector<BlockDescriptor> blockList; //!< This vector holds the block descriptors for all the children blocks of this Chunk
         };
@@ -252,6 +255,13 @@ namespace skyline {
           private:
             const DeviceState &state; //!< The state of the device
             std::vector<ChunkDescriptor> chunkList; //!< This vector holds all the chunk descriptors
+            std::shared_mutex mutex; //!< This mutex guards chunkList, lookups are shared while insertions and deletions are exclusive
+
+            /**
+             * @brief Finds the first chunk after an address, the last lookup is memoized per thread so sequential lookups such as walks of the address space are O(1) rather than O(log n)
+             * @note The mutex must be locked while calling this
+             */
+            std::vector<ChunkDescriptor>::iterator FindUpperChunk(u64 address);
 
             /**
              * @param address The address to find a chunk at
@@ -304,6 +314,7 @@ namespace skyline {
             friend class type::KSharedMemory;
             friend class type::KTransferMemory;
             friend class type::KProcess;
+            friend class loader::Loader;
             friend class loader::NroLoader;
             friend class loader::NsoLoader;
             friend class loader::NcaLoader;
@@ -334,6 +345,18 @@ namespace skyline {
              * @return The cumulative size of all memory mappings in bytes
              */
             size_t GetProgramSize();
+
+            /**
+             * @brief The amount of space in bytes occupied by memory mappings which has been committed, pages of host mirrored mappings are only committed once they are touched
+             * @return The cumulative size of all resident pages of host mirrored mappings and of all other mappings in bytes
+             * @note This walks the page tables of every mapping so it's far more expensive than GetProgramSize, it's intended for accounting rather than being called frequently
+             */
+            size_t GetCommittedSize();
+
+            /**
+             * @return A copy of the descriptors of all chunks, so the memory map can be iterated over without holding its lock
+             */
+            std::vector<ChunkDescriptor> GetChunks();
         };
     }
 }
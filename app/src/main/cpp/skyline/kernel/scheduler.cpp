@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <nce/guest_common.h>
+#include "scheduler.h"
+
+namespace skyline::kernel {
+    void DeterministicScheduler::Dispatch() {
+        while (!current && !readyThreads.empty()) {
+            auto next{std::move(readyThreads.extract(readyThreads.begin()).value().thread)};
+            if (next->status == type::KThread::Status::Dead)
+                continue; // Threads that were killed while they were waiting for the core are dropped
+
+            current = next->tid;
+            SetThreadState(reinterpret_cast<ThreadContext *>(next->ctxMemory->kernel.address), ThreadState::WaitRun);
+        }
+    }
+
+    void DeterministicScheduler::Resume(const std::shared_ptr<type::KThread> &thread) {
+        std::lock_guard lock(mutex);
+        if (current == thread->tid) {
+            if (readyThreads.empty() || readyThreads.begin()->priority >= thread->priority) {
+                SetThreadState(reinterpret_cast<ThreadContext *>(thread->ctxMemory->kernel.address), ThreadState::WaitRun);
+                return;
+            }
+            current = 0; // A thread with a higher priority is ready, so the core is handed over to it
+        }
+
+        readyThreads.insert(ReadyThread{thread->priority, nextSequence++, thread});
+        Dispatch();
+    }
+
+    void DeterministicScheduler::Release(pid_t tid) {
+        std::lock_guard lock(mutex);
+        if (current != tid)
+            return;
+
+        current = 0;
+        Dispatch();
+    }
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <set>
+#include "types/KThread.h"
+
+namespace skyline::kernel {
+    /**
+     * @brief The DeterministicScheduler class serializes all guest threads onto a single virtual core, so the interleaving of guest threads is the same on every run regardless of host scheduling
+     * @details Only the thread holding the core runs guest code, all other threads are held in the kernel till they're handed the core. The core is only handed over at SVC boundaries: when its holder blocks, exits or when a thread of a higher priority is ready at the end of one of its SVCs. Ready threads are handed the core in order of their guest priority and in the order that they became ready within a priority, so yielding round-robins between threads of the same priority
+     * @note Threads of a single virtual core can't be preempted while they're running guest code, a guest thread that spins on another thread without calling an SVC will never let it run
+     * @note Core masks aren't considered as only a single virtual core exists, running multiple cores concurrently would reintroduce the host scheduling this is meant to eliminate
+     */
+    class DeterministicScheduler {
+      private:
+        /**
+         * @brief A thread that's waiting to be handed the core
+         */
+        struct ReadyThread {
+            i8 priority; //!< The guest priority of the thread at the time it became ready, lower values have a higher priority
+            u64 sequence; //!< The order in which threads became ready, this is used to break ties between threads of the same priority
+            std::shared_ptr<type::KThread> thread;
+
+            bool operator<(const ReadyThread &other) const {
+                return priority != other.priority ? priority < other.priority : sequence < other.sequence;
+            }
+        };
+
+        std::mutex mutex; //!< This mutex guards all members of the scheduler
+        std::set<ReadyThread> readyThreads;
+        pid_t current{}; //!< The TID of the thread holding the core, this is 0 if the core is idle
+        u64 nextSequence{};
+
+        /**
+         * @brief Hands the core to the highest priority ready thread if it's idle, this must be called with the mutex held
+         */
+        void Dispatch();
+
+      public:
+        /**
+         * @brief Resumes a thread in the kernel that's waiting to return to guest code, this is done to a thread after it has been started or an SVC it called has returned
+         * @details If the thread holds the core then it keeps it unless a thread with a higher priority is ready, otherwise it's only resumed once it's handed the core
+         */
+        void Resume(const std::shared_ptr<type::KThread> &thread);
+
+        /**
+         * @brief Takes the core from a thread if it holds it and hands it to the next ready thread, this is done when a thread blocks in an SVC or is killed
+         */
+        void Release(pid_t tid);
+    };
+}
@@ -23,7 +23,7 @@ namespace skyline::kernel::svc {
         state.ctx->registers.w0 = Result{};
         state.ctx->registers.x1 = heap->address;
 
-        state.logger->Debug("svcSetHeapSize: Allocated at 0x{:X} for 0x{:X} bytes", heap->address, heap->size);
+        LOGD(state.logger, "svcSetHeapSize: Allocated at 0x{:X} for 0x{:X} bytes (Committed: 0x{:X} bytes)", heap->address, heap->size, state.os->memory.GetCommittedSize());
     }
 
     void SetMemoryAttribute(DeviceState &state) {
@@ -68,7 +68,7 @@ namespace skyline::kernel::svc {
         block->attributes.isUncached = value.isUncached;
         MemoryManager::InsertBlock(chunk, *block);
 
-        state.logger->Debug("svcSetMemoryAttribute: Set caching to {} at 0x{:X} for 0x{:X} bytes", !block->attributes.isUncached, address, size);
+        LOGD(state.logger, "svcSetMemoryAttribute: Set caching to {} at 0x{:X} for 0x{:X} bytes", !block->attributes.isUncached, address, size);
         state.ctx->registers.w0 = Result{};
     }
 
@@ -108,16 +108,22 @@ namespace skyline::kernel::svc {
             return;
         }
 
-        state.process->NewHandle<type::KPrivateMemory>(destination, size, descriptor->block.permission, memory::states::Stack);
-        state.process->CopyMemory(source, destination, size);
-
         auto object = state.process->GetMemoryObject(source);
         if (!object)
             throw exception("svcMapMemory: Cannot find memory object in handle table for address 0x{:X}", source);
 
+        // Private memory is aliased by mapping its shared memory at the destination, other memory has its contents copied into a new mapping
+        auto privateMemory{object->item->objectType == type::KType::KPrivateMemory ? std::static_pointer_cast<type::KPrivateMemory>(object->item) : nullptr};
+        if (privateMemory && privateMemory->CanAlias(source, size)) {
+            state.process->NewHandle<type::KPrivateMemory>(destination, size, descriptor->block.permission, memory::states::Stack, privateMemory, source);
+        } else {
+            state.process->NewHandle<type::KPrivateMemory>(destination, size, descriptor->block.permission, memory::states::Stack);
+            state.process->CopyMemory(source, destination, size);
+        }
+
         object->item->UpdatePermission(source, size, {false, false, false});
 
-        state.logger->Debug("svcMapMemory: Mapped range 0x{:X} - 0x{:X} to 0x{:X} - 0x{:X} (Size: 0x{:X} bytes)", source, source + size, destination, destination + size, size);
+        LOGD(state.logger, "svcMapMemory: Mapped range 0x{:X} - 0x{:X} to 0x{:X} - 0x{:X} (Size: 0x{:X} bytes)", source, source + size, destination, destination + size, size);
         state.ctx->registers.w0 = Result{};
     }
 
@@ -165,15 +171,17 @@ namespace skyline::kernel::svc {
 
         destObject->item->UpdatePermission(destination, size, sourceDesc->block.permission);
 
-        state.process->CopyMemory(destination, source, size);
-
-        auto sourceObject = state.process->GetMemoryObject(destination);
+        auto sourceObject = state.process->GetMemoryObject(source);
         if (!sourceObject)
             throw exception("svcUnmapMemory: Cannot find source memory object in handle table for address 0x{:X}", source);
 
+        // An alias shares its memory with the destination, so only copies need to have their contents written back
+        if (sourceObject->item->objectType != type::KType::KPrivateMemory || !std::static_pointer_cast<type::KPrivateMemory>(sourceObject->item)->IsAlias())
+            state.process->CopyMemory(source, destination, size);
+
         state.process->DeleteHandle(sourceObject->handle);
 
-        state.logger->Debug("svcUnmapMemory: Unmapped range 0x{:X} - 0x{:X} to 0x{:X} - 0x{:X} (Size: 0x{:X} bytes)", source, source + size, destination, destination + size, size);
+        LOGD(state.logger, "svcUnmapMemory: Unmapped range 0x{:X} - 0x{:X} to 0x{:X} - 0x{:X} (Size: 0x{:X} bytes)", source, source + size, destination, destination + size, size);
         state.ctx->registers.w0 = Result{};
     }
 
@@ -194,7 +202,7 @@ namespace skyline::kernel::svc {
                 .ipcRefCount = 0,
             };
 
-            state.logger->Debug("svcQueryMemory: Address: 0x{:X}, Size: 0x{:X}, Type: 0x{:X}, Is Uncached: {}, Permissions: {}{}{}", memInfo.address, memInfo.size, memInfo.type, static_cast<bool>(descriptor->block.attributes.isUncached), descriptor->block.permission.r ? "R" : "-", descriptor->block.permission.w ? "W" : "-", descriptor->block.permission.x ? "X" : "-");
+            LOGD(state.logger, "svcQueryMemory: Address: 0x{:X}, Size: 0x{:X}, Type: 0x{:X}, Is Uncached: {}, Permissions: {}{}{}", memInfo.address, memInfo.size, memInfo.type, static_cast<bool>(descriptor->block.attributes.isUncached), descriptor->block.permission.r ? "R" : "-", descriptor->block.permission.w ? "W" : "-", descriptor->block.permission.x ? "X" : "-");
         } else {
             auto addressSpaceEnd = state.os->memory.addressSpace.address + state.os->memory.addressSpace.size;
 
@@ -204,7 +212,7 @@ namespace skyline::kernel::svc {
                 .type = static_cast<u32>(memory::MemoryType::Reserved),
             };
 
-            state.logger->Debug("svcQueryMemory: Trying to query memory outside of the application's address space: 0x{:X}", address);
+            LOGD(state.logger, "svcQueryMemory: Trying to query memory outside of the application's address space: 0x{:X}", address);
         }
 
         state.process->WriteMemory(memInfo, state.ctx->registers.x0);
@@ -213,7 +221,7 @@ namespace skyline::kernel::svc {
     }
 
     void ExitProcess(DeviceState &state) {
-        state.logger->Debug("svcExitProcess: Exiting current process: {}", state.process->pid);
+        LOGD(state.logger, "svcExitProcess: Exiting current process: {}", state.process->pid);
         state.os->KillThread(state.process->pid);
     }
 
@@ -222,6 +230,7 @@ namespace skyline::kernel::svc {
         auto entryArgument = state.ctx->registers.x2;
         auto stackTop = state.ctx->registers.x3;
         auto priority = static_cast<i8>(state.ctx->registers.w4);
+        auto idealCore = static_cast<i8>(state.ctx->registers.w5);
 
         if (!state.thread->switchPriority.Valid(priority)) {
             state.ctx->registers.w0 = result::InvalidAddress;
@@ -229,8 +238,17 @@ namespace skyline::kernel::svc {
             return;
         }
 
-        auto thread = state.process->CreateThread(entryAddress, entryArgument, stackTop, priority);
-        state.logger->Debug("svcCreateThread: Created thread with handle 0x{:X} (Entry Point: 0x{:X}, Argument: 0x{:X}, Stack Pointer: 0x{:X}, Priority: {}, TID: {})", thread->handle, entryAddress, entryArgument, stackTop, priority, thread->tid);
+        constexpr i8 IdealCoreUseProcessValue = -2;
+        if (idealCore == IdealCoreUseProcessValue) {
+            idealCore = constant::DefaultCore;
+        } else if (idealCore < 0 || idealCore >= constant::CoreCount) {
+            state.ctx->registers.w0 = result::InvalidCoreId;
+            state.logger->Warn("svcCreateThread: 'idealCore' invalid: {}", idealCore);
+            return;
+        }
+
+        auto thread = state.process->CreateThread(entryAddress, entryArgument, stackTop, priority, idealCore);
+        LOGD(state.logger, "svcCreateThread: Created thread with handle 0x{:X} (Entry Point: 0x{:X}, Argument: 0x{:X}, Stack Pointer: 0x{:X}, Priority: {}, Ideal Core: {}, TID: {})", thread->handle, entryAddress, entryArgument, stackTop, priority, idealCore, thread->tid);
 
         state.ctx->registers.w1 = thread->handle;
         state.ctx->registers.w0 = Result{};
@@ -238,109 +256,217 @@ namespace skyline::kernel::svc {
 
     void StartThread(DeviceState &state) {
         auto handle = state.ctx->registers.w0;
-        try {
-            auto thread = state.process->GetHandle<type::KThread>(handle);
-            state.logger->Debug("svcStartThread: Starting thread: 0x{:X}, PID: {}", handle, thread->tid);
-            thread->Start();
-            state.ctx->registers.w0 = Result{};
-        } catch (const std::exception &) {
+        auto thread = state.process->TryBorrowHandle<type::KThread>(handle);
+        if (!thread) {
             state.logger->Warn("svcStartThread: 'handle' invalid: 0x{:X}", handle);
             state.ctx->registers.w0 = result::InvalidHandle;
+            return;
         }
+
+        LOGD(state.logger, "svcStartThread: Starting thread: 0x{:X}, PID: {}", handle, thread->tid);
+        thread->Start();
+        state.ctx->registers.w0 = Result{};
     }
 
     void ExitThread(DeviceState &state) {
-        state.logger->Debug("svcExitThread: Exiting current thread: {}", state.thread->tid);
+        LOGD(state.logger, "svcExitThread: Exiting current thread: {}", state.thread->tid);
         state.os->KillThread(state.thread->tid);
     }
 
     void SleepThread(DeviceState &state) {
-        auto in = state.ctx->registers.x0;
+        auto in = static_cast<i64>(state.ctx->registers.x0);
 
         switch (in) {
             case 0:
-            case 1:
-            case 2:
-                state.logger->Debug("svcSleepThread: Yielding thread: {}", in);
+                LOGD(state.logger, "svcSleepThread: Yielding thread without core migration");
+                state.thread->Yield(false);
                 break;
-            default:
-                state.logger->Debug("svcSleepThread: Thread sleeping for {} ns", in);
-                struct timespec spec = {
-                    .tv_sec = static_cast<time_t>(state.ctx->registers.x0 / 1000000000),
-                    .tv_nsec = static_cast<long>(state.ctx->registers.x0 % 1000000000)
-                };
+            case -1:
+                LOGD(state.logger, "svcSleepThread: Yielding thread with core migration");
+                state.thread->Yield(true);
+                break;
+            case -2: {
+                // A yield to lower priority threads can't be done with sched_yield as it only yields to threads of the same or higher priority, a minimal sleep takes the thread off the run queue instead
+                LOGD(state.logger, "svcSleepThread: Yielding thread to any thread");
+                struct timespec spec{.tv_nsec = 1};
                 nanosleep(&spec, nullptr);
+                break;
+            }
+            default: {
+                if (in < 0)
+                    break;
+
+                LOGD(state.logger, "svcSleepThread: Thread sleeping for {} ns", in);
+
+                // The sleep is done in two parts: a sleep till shortly before the deadline and a spin for the rest of it, the spin absorbs the wakeup latency of the host scheduler so the guest's frame pacing stays precise
+                auto deadline{util::GetTimeNs() + static_cast<u64>(in)};
+                if (in > constant::SleepSpinThreshold) {
+                    auto coarse{static_cast<u64>(in - constant::SleepSpinThreshold)};
+                    struct timespec spec{
+                        .tv_sec = static_cast<time_t>(coarse / constant::NsInSecond),
+                        .tv_nsec = static_cast<long>(coarse % constant::NsInSecond)
+                    };
+                    while (nanosleep(&spec, &spec) == -1 && errno == EINTR);
+                }
+
+                while (util::GetTimeNs() < deadline)
+                    asm volatile("yield");
+            }
         }
     }
 
     void GetThreadPriority(DeviceState &state) {
         auto handle = state.ctx->registers.w1;
-        try {
-            auto priority = state.process->GetHandle<type::KThread>(handle)->priority;
-            state.logger->Debug("svcGetThreadPriority: Writing thread priority {}", priority);
-
-            state.ctx->registers.w1 = priority;
-            state.ctx->registers.w0 = Result{};
-        } catch (const std::exception &) {
+        auto thread = state.process->TryBorrowHandle<type::KThread>(handle);
+        if (!thread) {
             state.logger->Warn("svcGetThreadPriority: 'handle' invalid: 0x{:X}", handle);
             state.ctx->registers.w0 = result::InvalidHandle;
+            return;
         }
+
+        auto priority = thread->priority;
+        LOGD(state.logger, "svcGetThreadPriority: Writing thread priority {}", priority);
+
+        state.ctx->registers.w1 = priority;
+        state.ctx->registers.w0 = Result{};
     }
 
     void SetThreadPriority(DeviceState &state) {
         auto handle = state.ctx->registers.w0;
         auto priority = state.ctx->registers.w1;
 
-        try {
-            state.logger->Debug("svcSetThreadPriority: Setting thread priority to {}", priority);
-            state.process->GetHandle<type::KThread>(handle)->UpdatePriority(static_cast<u8>(priority));
-            state.ctx->registers.w0 = Result{};
-        } catch (const std::exception &) {
+        auto thread = state.process->TryBorrowHandle<type::KThread>(handle);
+        if (!thread) {
             state.logger->Warn("svcSetThreadPriority: 'handle' invalid: 0x{:X}", handle);
             state.ctx->registers.w0 = result::InvalidHandle;
+            return;
         }
+
+        LOGD(state.logger, "svcSetThreadPriority: Setting thread priority to {}", priority);
+        thread->UpdatePriority(static_cast<u8>(priority));
+        state.ctx->registers.w0 = Result{};
     }
 
-    void ClearEvent(DeviceState &state) {
-        auto object = state.process->GetHandle<type::KEvent>(state.ctx->registers.w0);
-        object->signalled = false;
+    void GetThreadCoreMask(DeviceState &state) {
+        constexpr KHandle threadSelf = 0xFFFF8000; // This is the handle used by threads to refer to themselves
+        auto handle = state.ctx->registers.w2;
+        auto thread = handle == threadSelf ? state.thread.get() : state.process->TryBorrowHandle<type::KThread>(handle);
+        if (!thread) {
+            state.logger->Warn("svcGetThreadCoreMask: 'handle' invalid: 0x{:X}", handle);
+            state.ctx->registers.w0 = result::InvalidHandle;
+            return;
+        }
+
+        LOGD(state.logger, "svcGetThreadCoreMask: Writing thread core mask: Ideal Core: {}, Affinity Mask: 0x{:X}", thread->idealCore, thread->affinityMask);
+
+        state.ctx->registers.w1 = static_cast<u32>(thread->idealCore);
+        state.ctx->registers.x2 = thread->affinityMask;
         state.ctx->registers.w0 = Result{};
     }
 
-    void MapSharedMemory(DeviceState &state) {
-        try {
-            auto object = state.process->GetHandle<type::KSharedMemory>(state.ctx->registers.w0);
-            auto address = state.ctx->registers.x1;
+    void SetThreadCoreMask(DeviceState &state) {
+        constexpr KHandle threadSelf = 0xFFFF8000; // This is the handle used by threads to refer to themselves
+        constexpr i8 IdealCoreDontCare = -1;
+        constexpr i8 IdealCoreUseProcessValue = -2;
+        constexpr i8 IdealCoreNoUpdate = -3;
+        constexpr u64 ProcessCoreMask = (1ULL << constant::CoreCount) - 1; // The process is allowed to run on every core
+
+        auto handle = state.ctx->registers.w0;
+        auto idealCore = static_cast<i8>(state.ctx->registers.w1);
+        auto affinityMask = state.ctx->registers.x2;
 
-            if (!util::PageAligned(address)) {
-                state.ctx->registers.w0 = result::InvalidAddress;
-                state.logger->Warn("svcMapSharedMemory: 'address' not page aligned: 0x{:X}", address);
+        auto thread = handle == threadSelf ? state.thread.get() : state.process->TryBorrowHandle<type::KThread>(handle);
+        if (!thread) {
+            state.logger->Warn("svcSetThreadCoreMask: 'handle' invalid: 0x{:X}", handle);
+            state.ctx->registers.w0 = result::InvalidHandle;
+            return;
+        }
+
+        if (idealCore == IdealCoreUseProcessValue) {
+            idealCore = constant::DefaultCore;
+            affinityMask = 1ULL << idealCore;
+        } else {
+            if ((affinityMask | ProcessCoreMask) != ProcessCoreMask) {
+                state.logger->Warn("svcSetThreadCoreMask: 'affinityMask' has cores outside of the process: 0x{:X}", affinityMask);
+                state.ctx->registers.w0 = result::InvalidCoreId;
                 return;
             }
 
-            auto size = state.ctx->registers.x2;
-            if (!util::PageAligned(size)) {
-                state.ctx->registers.w0 = result::InvalidSize;
-                state.logger->Warn("svcMapSharedMemory: 'size' {}: 0x{:X}", size ? "not page aligned" : "is zero", size);
+            if (!affinityMask) {
+                state.logger->Warn("svcSetThreadCoreMask: 'affinityMask' is zero");
+                state.ctx->registers.w0 = result::InvalidCombination;
                 return;
             }
 
-            memory::Permission permission = *reinterpret_cast<memory::Permission *>(&state.ctx->registers.w3);
-            if ((permission.w && !permission.r) || (permission.x && !permission.r)) {
-                state.logger->Warn("svcMapSharedMemory: 'permission' invalid: {}{}{}", permission.r ? "R" : "-", permission.w ? "W" : "-", permission.x ? "X" : "-");
-                state.ctx->registers.w0 = result::InvalidNewMemoryPermission;
+            if (idealCore == IdealCoreNoUpdate) {
+                idealCore = thread->idealCore;
+            } else if (idealCore < IdealCoreDontCare || idealCore >= constant::CoreCount) {
+                state.logger->Warn("svcSetThreadCoreMask: 'idealCore' invalid: {}", idealCore);
+                state.ctx->registers.w0 = result::InvalidCoreId;
                 return;
             }
 
-            state.logger->Debug("svcMapSharedMemory: Mapping shared memory at 0x{:X} for {} bytes ({}{}{})", address, size, permission.r ? "R" : "-", permission.w ? "W" : "-", permission.x ? "X" : "-");
+            if (idealCore >= 0 && !(affinityMask & (1ULL << idealCore))) {
+                state.logger->Warn("svcSetThreadCoreMask: 'affinityMask' doesn't contain the ideal core: Ideal Core: {}, Affinity Mask: 0x{:X}", idealCore, affinityMask);
+                state.ctx->registers.w0 = result::InvalidCombination;
+                return;
+            }
+        }
 
-            object->Map(address, size, permission);
+        LOGD(state.logger, "svcSetThreadCoreMask: Setting thread core mask: Ideal Core: {}, Affinity Mask: 0x{:X}", idealCore, affinityMask);
+        thread->UpdateCoreMask(idealCore, affinityMask);
+        state.ctx->registers.w0 = Result{};
+    }
 
-            state.ctx->registers.w0 = Result{};
-        } catch (const std::exception &) {
-            state.logger->Warn("svcMapSharedMemory: 'handle' invalid: 0x{:X}", state.ctx->registers.w0);
+    void ClearEvent(DeviceState &state) {
+        auto handle = state.ctx->registers.w0;
+        auto object = state.process->TryBorrowHandle<type::KEvent>(handle);
+        if (!object) {
+            state.logger->Warn("svcClearEvent: 'handle' invalid: 0x{:X}", handle);
             state.ctx->registers.w0 = result::InvalidHandle;
+            return;
         }
+
+        object->ResetSignal();
+        state.ctx->registers.w0 = Result{};
+    }
+
+    void MapSharedMemory(DeviceState &state) {
+        auto handle = state.ctx->registers.w0;
+        auto object = state.process->TryBorrowHandle<type::KSharedMemory>(handle);
+        if (!object) {
+            state.logger->Warn("svcMapSharedMemory: 'handle' invalid: 0x{:X}", handle);
+            state.ctx->registers.w0 = result::InvalidHandle;
+            return;
+        }
+
+        auto address = state.ctx->registers.x1;
+
+        if (!util::PageAligned(address)) {
+            state.ctx->registers.w0 = result::InvalidAddress;
+            state.logger->Warn("svcMapSharedMemory: 'address' not page aligned: 0x{:X}", address);
+            return;
+        }
+
+        auto size = state.ctx->registers.x2;
+        if (!util::PageAligned(size)) {
+            state.ctx->registers.w0 = result::InvalidSize;
+            state.logger->Warn("svcMapSharedMemory: 'size' {}: 0x{:X}", size ? "not page aligned" : "is zero", size);
+            return;
+        }
+
+        memory::Permission permission = *reinterpret_cast<memory::Permission *>(&state.ctx->registers.w3);
+        if ((permission.w && !permission.r) || (permission.x && !permission.r)) {
+            state.logger->Warn("svcMapSharedMemory: 'permission' invalid: {}{}{}", permission.r ? "R" : "-", permission.w ? "W" : "-", permission.x ? "X" : "-");
+            state.ctx->registers.w0 = result::InvalidNewMemoryPermission;
+            return;
+        }
+
+        LOGD(state.logger, "svcMapSharedMemory: Mapping shared memory at 0x{:X} for {} bytes ({}{}{})", address, size, permission.r ? "R" : "-", permission.w ? "W" : "-", permission.x ? "X" : "-");
+
+        object->Map(address, size, permission);
+
+        state.ctx->registers.w0 = Result{};
     }
 
     void CreateTransferMemory(DeviceState &state) {
@@ -365,7 +491,7 @@ namespace skyline::kernel::svc {
             return;
         }
 
-        state.logger->Debug("svcCreateTransferMemory: Creating transfer memory at 0x{:X} for {} bytes ({}{}{})", address, size, permission.r ? "R" : "-", permission.w ? "W" : "-", permission.x ? "X" : "-");
+        LOGD(state.logger, "svcCreateTransferMemory: Creating transfer memory at 0x{:X} for {} bytes ({}{}{})", address, size, permission.r ? "R" : "-", permission.w ? "W" : "-", permission.x ? "X" : "-");
 
         auto shmem = state.process->NewHandle<type::KTransferMemory>(state.process->pid, address, size, permission);
 
@@ -375,43 +501,43 @@ namespace skyline::kernel::svc {
 
     void CloseHandle(DeviceState &state) {
         auto handle = static_cast<KHandle>(state.ctx->registers.w0);
-        try {
-            state.process->handles.erase(handle);
-            state.logger->Debug("svcCloseHandle: Closing handle: 0x{:X}", handle);
-            state.ctx->registers.w0 = Result{};
-        } catch (const std::exception &) {
+        if (!state.process->DeleteHandle(handle)) {
             state.logger->Warn("svcCloseHandle: 'handle' invalid: 0x{:X}", handle);
             state.ctx->registers.w0 = result::InvalidHandle;
+            return;
         }
+
+        LOGD(state.logger, "svcCloseHandle: Closing handle: 0x{:X}", handle);
+        state.ctx->registers.w0 = Result{};
     }
 
     void ResetSignal(DeviceState &state) {
         auto handle = state.ctx->registers.w0;
-        try {
-            auto &object = state.process->handles.at(handle);
-            switch (object->objectType) {
-                case type::KType::KEvent:
-                    std::static_pointer_cast<type::KEvent>(object)->ResetSignal();
-                    break;
-
-                case type::KType::KProcess:
-                    std::static_pointer_cast<type::KProcess>(object)->ResetSignal();
-                    break;
-
-                default: {
-                    state.logger->Warn("svcResetSignal: 'handle' type invalid: 0x{:X} ({})", handle, object->objectType);
-                    state.ctx->registers.w0 = result::InvalidHandle;
-                    return;
-                }
-            }
-
-            state.logger->Debug("svcResetSignal: Resetting signal: 0x{:X}", handle);
-            state.ctx->registers.w0 = Result{};
-        } catch (const std::out_of_range &) {
+        auto object = state.process->TryBorrowHandle<type::KObject>(handle);
+        if (!object) {
             state.logger->Warn("svcResetSignal: 'handle' invalid: 0x{:X}", handle);
             state.ctx->registers.w0 = result::InvalidHandle;
             return;
         }
+
+        switch (object->objectType) {
+            case type::KType::KEvent:
+                static_cast<type::KEvent *>(object)->ResetSignal();
+                break;
+
+            case type::KType::KProcess:
+                static_cast<type::KProcess *>(object)->ResetSignal();
+                break;
+
+            default: {
+                state.logger->Warn("svcResetSignal: 'handle' type invalid: 0x{:X} ({})", handle, object->objectType);
+                state.ctx->registers.w0 = result::InvalidHandle;
+                return;
+            }
+        }
+
+        LOGD(state.logger, "svcResetSignal: Resetting signal: 0x{:X}", handle);
+        state.ctx->registers.w0 = Result{};
     }
 
     void WaitSynchronization(DeviceState &state) {
@@ -423,17 +549,19 @@ namespace skyline::kernel::svc {
             return;
         }
 
-        std::string handleStr;
-        std::vector<std::shared_ptr<type::KSyncObject>> objectTable;
-        std::vector<KHandle> waitHandles(numHandles);
-
+        // The handles and objects are held in fixed-size arrays on the stack as this is called every frame by most titles
+        std::array<KHandle, maxSyncHandles> waitHandles;
+        std::array<std::shared_ptr<type::KSyncObject>, maxSyncHandles> objects; // The objects are referenced rather than borrowed as the wait can be indefinite
         state.process->ReadMemory(waitHandles.data(), state.ctx->registers.x1, numHandles * sizeof(KHandle));
 
-        for (const auto &handle : waitHandles) {
-            handleStr += fmt::format("* 0x{:X}\n", handle);
+        for (u32 index{}; index < numHandles; index++) {
+            auto entry{state.process->handles.Get(waitHandles[index])};
+            if (!entry.object) {
+                state.ctx->registers.w0 = result::InvalidHandle;
+                return;
+            }
 
-            auto object = state.process->handles.at(handle);
-            switch (object->objectType) {
+            switch (entry.type) {
                 case type::KType::KProcess:
                 case type::KType::KThread:
                 case type::KType::KEvent:
@@ -446,13 +574,23 @@ namespace skyline::kernel::svc {
                 }
             }
 
-            objectTable.push_back(std::static_pointer_cast<type::KSyncObject>(object));
+            objects[index] = std::static_pointer_cast<type::KSyncObject>(std::move(entry.object));
         }
 
-        auto timeout = state.ctx->registers.x3;
-        state.logger->Debug("svcWaitSynchronization: Waiting on handles:\n{}Timeout: 0x{:X} ns", handleStr, timeout);
+        std::span objectTable(objects.data(), numHandles);
+        auto timeout = static_cast<i64>(state.ctx->registers.x3);
+        LOGD(state.logger, "svcWaitSynchronization: Waiting on handles: {:#X}, Timeout: 0x{:X} ns", fmt::join(waitHandles.begin(), waitHandles.begin() + numHandles, ", "), timeout);
+
+        auto &waiter = state.thread->syncWaiter;
+        for (const auto &object : objectTable)
+            object->AddWaiter(&waiter);
+
+        auto now = std::chrono::steady_clock::now();
+        bool infinite = timeout < 0 || timeout >= std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::time_point::max() - now).count(); // A negative timeout denotes an infinite wait
+        auto deadline = infinite ? now : now + std::chrono::nanoseconds(timeout);
+        std::unique_lock lock(waiter.mutex);
+        waiter.woken = false;
 
-        auto start = util::GetTimeNs();
         while (true) {
             if (state.thread->cancelSync) {
                 state.thread->cancelSync = false;
@@ -460,32 +598,43 @@ namespace skyline::kernel::svc {
                 break;
             }
 
-            uint index{};
-            for (const auto &object : objectTable) {
-                if (object->signalled) {
-                    state.logger->Debug("svcWaitSynchronization: Signalled handle: 0x{:X}", waitHandles.at(index));
-                    state.ctx->registers.w0 = Result{};
-                    state.ctx->registers.w1 = index;
-                    return;
-                }
-                index++;
+            auto signalled = std::find_if(objectTable.begin(), objectTable.end(), [](const auto &object) { return object->signalled.load(); });
+            if (signalled != objectTable.end()) {
+                auto index = static_cast<u32>(std::distance(objectTable.begin(), signalled));
+                LOGD(state.logger, "svcWaitSynchronization: Signalled handle: 0x{:X}", waitHandles[index]);
+                state.ctx->registers.w0 = Result{};
+                state.ctx->registers.w1 = index;
+                break;
             }
 
-            if ((util::GetTimeNs() - start) >= timeout) {
-                state.logger->Debug("svcWaitSynchronization: Wait has timed out");
+            if (infinite) {
+                waiter.conditional.wait(lock, [&waiter] { return waiter.woken; });
+            } else if (!waiter.conditional.wait_until(lock, deadline, [&waiter] { return waiter.woken; })) {
+                LOGD(state.logger, "svcWaitSynchronization: Wait has timed out");
                 state.ctx->registers.w0 = result::TimedOut;
-                return;
+                break;
             }
+
+            waiter.woken = false;
         }
+
+        lock.unlock();
+        for (const auto &object : objectTable)
+            object->RemoveWaiter(&waiter);
     }
 
     void CancelSynchronization(DeviceState &state) {
-        try {
-            state.process->GetHandle<type::KThread>(state.ctx->registers.w0)->cancelSync = true;
-        } catch (const std::exception &) {
-            state.logger->Warn("svcCancelSynchronization: 'handle' invalid: 0x{:X}", state.ctx->registers.w0);
+        auto handle = state.ctx->registers.w0;
+        auto thread = state.process->TryBorrowHandle<type::KThread>(handle);
+        if (!thread) {
+            state.logger->Warn("svcCancelSynchronization: 'handle' invalid: 0x{:X}", handle);
             state.ctx->registers.w0 = result::InvalidHandle;
+            return;
         }
+
+        thread->cancelSync = true;
+        thread->syncWaiter.Wake();
+        state.ctx->registers.w0 = Result{};
     }
 
     void ArbitrateLock(DeviceState &state) {
@@ -501,12 +650,12 @@ namespace skyline::kernel::svc {
         if (requesterHandle != state.thread->handle)
             throw exception("svcWaitProcessWideKeyAtomic: Handle doesn't match current thread: 0x{:X} for thread 0x{:X}", requesterHandle, state.thread->handle);
 
-        state.logger->Debug("svcArbitrateLock: Locking mutex at 0x{:X}", address);
+        LOGD(state.logger, "svcArbitrateLock: Locking mutex at 0x{:X}", address);
 
         if (state.process->MutexLock(address, ownerHandle))
-            state.logger->Debug("svcArbitrateLock: Locked mutex at 0x{:X}", address);
+            LOGD(state.logger, "svcArbitrateLock: Locked mutex at 0x{:X}", address);
         else
-            state.logger->Debug("svcArbitrateLock: Owner handle did not match current owner for mutex or didn't have waiter flag at 0x{:X}", address);
+            LOGD(state.logger, "svcArbitrateLock: Owner handle did not match current owner for mutex or didn't have waiter flag at 0x{:X}", address);
 
         state.ctx->registers.w0 = Result{};
     }
@@ -519,13 +668,13 @@ namespace skyline::kernel::svc {
             return;
         }
 
-        state.logger->Debug("svcArbitrateUnlock: Unlocking mutex at 0x{:X}", address);
+        LOGD(state.logger, "svcArbitrateUnlock: Unlocking mutex at 0x{:X}", address);
 
         if (state.process->MutexUnlock(address)) {
-            state.logger->Debug("svcArbitrateUnlock: Unlocked mutex at 0x{:X}", address);
+            LOGD(state.logger, "svcArbitrateUnlock: Unlocked mutex at 0x{:X}", address);
             state.ctx->registers.w0 = Result{};
         } else {
-            state.logger->Debug("svcArbitrateUnlock: A non-owner thread tried to release a mutex at 0x{:X}", address);
+            LOGD(state.logger, "svcArbitrateUnlock: A non-owner thread tried to release a mutex at 0x{:X}", address);
             state.ctx->registers.w0 = result::InvalidAddress;
         }
     }
@@ -544,19 +693,19 @@ namespace skyline::kernel::svc {
             throw exception("svcWaitProcessWideKeyAtomic: Handle doesn't match current thread: 0x{:X} for thread 0x{:X}", handle, state.thread->handle);
 
         if (!state.process->MutexUnlock(mtxAddress)) {
-            state.logger->Debug("WaitProcessWideKeyAtomic: A non-owner thread tried to release a mutex at 0x{:X}", mtxAddress);
+            LOGD(state.logger, "WaitProcessWideKeyAtomic: A non-owner thread tried to release a mutex at 0x{:X}", mtxAddress);
             state.ctx->registers.w0 = result::InvalidAddress;
             return;
         }
 
         auto timeout = state.ctx->registers.x3;
-        state.logger->Debug("svcWaitProcessWideKeyAtomic: Mutex: 0x{:X}, Conditional-Variable: 0x{:X}, Timeout: {} ns", mtxAddress, condAddress, timeout);
+        LOGD(state.logger, "svcWaitProcessWideKeyAtomic: Mutex: 0x{:X}, Conditional-Variable: 0x{:X}, Timeout: {} ns", mtxAddress, condAddress, timeout);
 
         if (state.process->ConditionalVariableWait(condAddress, mtxAddress, timeout)) {
-            state.logger->Debug("svcWaitProcessWideKeyAtomic: Waited for conditional variable and relocked mutex");
+            LOGD(state.logger, "svcWaitProcessWideKeyAtomic: Waited for conditional variable and relocked mutex");
             state.ctx->registers.w0 = Result{};
         } else {
-            state.logger->Debug("svcWaitProcessWideKeyAtomic: Wait has timed out");
+            LOGD(state.logger, "svcWaitProcessWideKeyAtomic: Wait has timed out");
             state.ctx->registers.w0 = result::TimedOut;
         }
     }
@@ -565,22 +714,13 @@ namespace skyline::kernel::svc {
         auto address = state.ctx->registers.x0;
         auto count = state.ctx->registers.w1;
 
-        state.logger->Debug("svcSignalProcessWideKey: Signalling Conditional-Variable at 0x{:X} for {}", address, count);
+        LOGD(state.logger, "svcSignalProcessWideKey: Signalling Conditional-Variable at 0x{:X} for {}", address, count);
         state.process->ConditionalVariableSignal(address, count);
         state.ctx->registers.w0 = Result{};
     }
 
     void GetSystemTick(DeviceState &state) {
-        u64 tick;
-        asm("STR X1, [SP, #-16]!\n\t"
-            "MRS %0, CNTVCT_EL0\n\t"
-            "MOV X1, #0xF800\n\t"
-            "MOVK X1, #0x124, lsl #16\n\t"
-            "MUL %0, %0, X1\n\t"
-            "MRS X1, CNTFRQ_EL0\n\t"
-            "UDIV %0, %0, X1\n\t"
-            "LDR X1, [SP], #16" : "=r"(tick));
-        state.ctx->registers.x0 = tick;
+        state.ctx->registers.x0 = util::GetGuestTicks();
     }
 
     void ConnectToNamedPort(DeviceState &state) {
@@ -596,28 +736,29 @@ namespace skyline::kernel::svc {
             return;
         }
 
-        state.logger->Debug("svcConnectToNamedPort: Connecting to port '{}' at 0x{:X}", port, handle);
+        LOGD(state.logger, "svcConnectToNamedPort: Connecting to port '{}' at 0x{:X}", port, handle);
 
         state.ctx->registers.w1 = handle;
         state.ctx->registers.w0 = Result{};
     }
 
     void SendSyncRequest(DeviceState &state) {
-        state.os->serviceManager.SyncRequestHandler(static_cast<KHandle>(state.ctx->registers.x0));
-        state.ctx->registers.w0 = Result{};
+        state.ctx->registers.w0 = state.os->serviceManager.SyncRequestHandler(static_cast<KHandle>(state.ctx->registers.x0));
     }
 
     void GetThreadId(DeviceState &state) {
         constexpr KHandle threadSelf = 0xFFFF8000; // This is the handle used by threads to refer to themselves
         auto handle = state.ctx->registers.w1;
-        pid_t pid{};
+        auto thread = handle == threadSelf ? state.thread.get() : state.process->TryBorrowHandle<type::KThread>(handle);
+        if (!thread) {
+            state.logger->Warn("svcGetThreadId: 'handle' invalid: 0x{:X}", handle);
+            state.ctx->registers.w0 = result::InvalidHandle;
+            return;
+        }
 
-        if (handle != threadSelf)
-            pid = state.process->GetHandle<type::KThread>(handle)->tid;
-        else
-            pid = state.thread->tid;
+        auto pid = thread->tid;
 
-        state.logger->Debug("svcGetThreadId: Handle: 0x{:X}, PID: {}", handle, pid);
+        LOGD(state.logger, "svcGetThreadId: Handle: 0x{:X}, PID: {}", handle, pid);
 
         state.ctx->registers.x1 = static_cast<u64>(pid);
         state.ctx->registers.w0 = Result{};
@@ -716,7 +857,7 @@ namespace skyline::kernel::svc {
                 return;
         }
 
-        state.logger->Debug("svcGetInfo: ID0: {}, ID1: {}, Out: 0x{:X}", id0, id1, out);
+        LOGD(state.logger, "svcGetInfo: ID0: {}, ID1: {}, Out: 0x{:X}", id0, id1, out);
 
         state.ctx->registers.x1 = out;
         state.ctx->registers.w0 = Result{};
@@ -7,6 +7,10 @@
 #include "ipc.h"
 
 namespace skyline {
+    namespace constant {
+        constexpr i64 SleepSpinThreshold = 50000; //!< The amount of nanoseconds at the end of a sleep that are spun rather than slept for, this covers the wakeup latency of the host scheduler
+    }
+
     namespace constant::infoState {
         // 1.0.0+
         constexpr u8 AllowedCpuIdBitmask = 0x0;
@@ -100,6 +104,16 @@ namespace skyline {
          */
         void SetThreadPriority(DeviceState &state);
 
+        /**
+         * @brief Get the ideal core and affinity mask of provided thread handle (https://switchbrew.org/wiki/SVC#GetThreadCoreMask)
+         */
+        void GetThreadCoreMask(DeviceState &state);
+
+        /**
+         * @brief Set the ideal core and affinity mask of provided thread handle (https://switchbrew.org/wiki/SVC#SetThreadCoreMask)
+         */
+        void SetThreadCoreMask(DeviceState &state);
+
         /**
          * @brief Clears a KEvent of it's signal (https://switchbrew.org/wiki/SVC#ClearEvent)
          */
@@ -203,8 +217,8 @@ namespace skyline {
             SleepThread, // 0x0B
             GetThreadPriority, // 0x0C
             SetThreadPriority, // 0x0D
-            nullptr, // 0x0E
-            nullptr, // 0x0F
+            GetThreadCoreMask, // 0x0E
+            SetThreadCoreMask, // 0x0F
             nullptr, // 0x10
             nullptr, // 0x11
             ClearEvent, // 0x12
@@ -318,5 +332,139 @@ namespace skyline {
             nullptr, // 0x7E
             nullptr // 0x7F
         };
+
+        /**
+         * @brief The names of all SVCs in SvcTable, these are used to label them in traces and statistics
+         */
+        constexpr const char *SvcNames[0x80] = {
+            nullptr, // 0x00
+            "SetHeapSize", // 0x01
+            nullptr, // 0x02
+            "SetMemoryAttribute", // 0x03
+            "MapMemory", // 0x04
+            "UnmapMemory", // 0x05
+            "QueryMemory", // 0x06
+            "ExitProcess", // 0x07
+            "CreateThread", // 0x08
+            "StartThread", // 0x09
+            "ExitThread", // 0x0A
+            "SleepThread", // 0x0B
+            "GetThreadPriority", // 0x0C
+            "SetThreadPriority", // 0x0D
+            "GetThreadCoreMask", // 0x0E
+            "SetThreadCoreMask", // 0x0F
+            nullptr, // 0x10
+            nullptr, // 0x11
+            "ClearEvent", // 0x12
+            "MapSharedMemory", // 0x13
+            nullptr, // 0x14
+            "CreateTransferMemory", // 0x15
+            "CloseHandle", // 0x16
+            "ResetSignal", // 0x17
+            "WaitSynchronization", // 0x18
+            "CancelSynchronization", // 0x19
+            "ArbitrateLock", // 0x1A
+            "ArbitrateUnlock", // 0x1B
+            "WaitProcessWideKeyAtomic", // 0x1C
+            "SignalProcessWideKey", // 0x1D
+            "GetSystemTick", // 0x1E
+            "ConnectToNamedPort", // 0x1F
+            nullptr, // 0x20
+            "SendSyncRequest", // 0x21
+            nullptr, // 0x22
+            nullptr, // 0x23
+            nullptr, // 0x24
+            "GetThreadId", // 0x25
+            nullptr, // 0x26
+            "OutputDebugString", // 0x27
+            nullptr, // 0x28
+            "GetInfo", // 0x29
+            nullptr, // 0x2A
+            nullptr, // 0x2B
+            nullptr, // 0x2C
+            nullptr, // 0x2D
+            nullptr, // 0x2E
+            nullptr, // 0x2F
+            nullptr, // 0x30
+            nullptr, // 0x31
+            nullptr, // 0x32
+            nullptr, // 0x33
+            nullptr, // 0x34
+            nullptr, // 0x35
+            nullptr, // 0x36
+            nullptr, // 0x37
+            nullptr, // 0x38
+            nullptr, // 0x39
+            nullptr, // 0x3A
+            nullptr, // 0x3B
+            nullptr, // 0x3C
+            nullptr, // 0x3D
+            nullptr, // 0x3E
+            nullptr, // 0x3F
+            nullptr, // 0x40
+            nullptr, // 0x41
+            nullptr, // 0x42
+            nullptr, // 0x43
+            nullptr, // 0x44
+            nullptr, // 0x45
+            nullptr, // 0x46
+            nullptr, // 0x47
+            nullptr, // 0x48
+            nullptr, // 0x49
+            nullptr, // 0x4A
+            nullptr, // 0x4B
+            nullptr, // 0x4C
+            nullptr, // 0x4D
+            nullptr, // 0x4E
+            nullptr, // 0x4F
+            nullptr, // 0x50
+            nullptr, // 0x51
+            nullptr, // 0x52
+            nullptr, // 0x53
+            nullptr, // 0x54
+            nullptr, // 0x55
+            nullptr, // 0x56
+            nullptr, // 0x57
+            nullptr, // 0x58
+            nullptr, // 0x59
+            nullptr, // 0x5A
+            nullptr, // 0x5B
+            nullptr, // 0x5C
+            nullptr, // 0x5D
+            nullptr, // 0x5E
+            nullptr, // 0x5F
+            nullptr, // 0x60
+            nullptr, // 0x61
+            nullptr, // 0x62
+            nullptr, // 0x63
+            nullptr, // 0x64
+            nullptr, // 0x65
+            nullptr, // 0x66
+            nullptr, // 0x67
+            nullptr, // 0x68
+            nullptr, // 0x69
+            nullptr, // 0x6A
+            nullptr, // 0x6B
+            nullptr, // 0x6C
+            nullptr, // 0x6D
+            nullptr, // 0x6E
+            nullptr, // 0x6F
+            nullptr, // 0x70
+            nullptr, // 0x71
+            nullptr, // 0x72
+            nullptr, // 0x73
+            nullptr, // 0x74
+            nullptr, // 0x75
+            nullptr, // 0x76
+            nullptr, // 0x77
+            nullptr, // 0x78
+            nullptr, // 0x79
+            nullptr, // 0x7A
+            nullptr, // 0x7B
+            nullptr, // 0x7C
+            nullptr, // 0x7D
+            nullptr, // 0x7E
+            nullptr // 0x7F
+        };
     }
 }
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <android/sharedmem.h>
+#include <linux/memfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "KMemory.h"
+
+namespace skyline::kernel::type {
+    int KMemory::CreateSharedMemory(const char *name, size_t size, bool &resizable) {
+        // A memfd is preferred as it can be grown with ftruncate, ashmem is used on kernels without memfd_create (< 3.17)
+        auto fd = static_cast<int>(syscall(__NR_memfd_create, name, MFD_CLOEXEC));
+        if (fd >= 0) {
+            if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+                close(fd);
+                throw exception("An error occurred while resizing shared memory: {}", strerror(errno));
+            }
+            resizable = true;
+            return fd;
+        }
+
+        fd = ASharedMemory_create(name, size);
+        if (fd < 0)
+            throw exception("An error occurred while creating shared memory: {}", fd);
+        resizable = false;
+        return fd;
+    }
+}
@@ -11,6 +11,16 @@ namespace skyline::kernel::type {
      * @brief The base kernel memory object that other memory classes derieve from
      */
     class KMemory : public KObject {
+      protected:
+        /**
+         * @brief Creates the shared memory that backs mappings of a memory object, the same memory can be mapped into both the host and the guest
+         * @param name The name of the shared memory, this is only used for debugging
+         * @param size The initial size of the shared memory, it is only committed when it is touched
+         * @param resizable This is set to if the shared memory is a memfd which can be resized with ftruncate rather than ashmem which has a fixed size
+         * @return A file descriptor to the shared memory
+         */
+        static int CreateSharedMemory(const char *name, size_t size, bool &resizable);
+
       public:
         KMemory(const DeviceState &state, KType objectType) : KObject(state, objectType) {}
 
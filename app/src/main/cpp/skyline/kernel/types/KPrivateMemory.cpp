@@ -9,108 +9,199 @@
 #include "KProcess.h"
 
 namespace skyline::kernel::type {
-    KPrivateMemory::KPrivateMemory(const DeviceState &state, u64 address, size_t size, memory::Permission permission, memory::MemoryState memState) : size(size), KMemory(state, KType::KPrivateMemory) {
+    KPrivateMemory::KPrivateMemory(const DeviceState &state, u64 address, size_t size, memory::Permission permission, memory::MemoryState memState, size_t reserved) : size(size), reserved(std::max(size, reserved)), KMemory(state, KType::KPrivateMemory) {
         if (address && !util::PageAligned(address))
             throw exception("KPrivateMemory was created with non-page-aligned address: 0x{:X}", address);
-
-        fd = ASharedMemory_create("KPrivateMemory", size);
-        if (fd < 0)
-            throw exception("An error occurred while creating shared memory: {}", fd);
-
-        auto host = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED, fd, 0);
+        if (!address && this->reserved != size)
+            throw exception("KPrivateMemory can only reserve space at a fixed address");
+
+        // The backing of the reservation is only committed when it is touched, so reserving a large amount of space only costs address space
+        fd = CreateSharedMemory("KPrivateMemory", this->reserved, resizable);
+
+        // Large mappings at huge page aligned addresses such as the heap and code can be backed by huge pages to reduce TLB pressure while executing guest code
+        // Huge pages are only allocated when the mapping they're faulted in through is aligned and advised, so this applies to both the host and guest mappings
+        bool hugePages{state.settings->Get().hugePages && address && this->reserved >= constant::HugePageSize && util::IsAligned(address, constant::HugePageSize)};
+
+        void *host;
+        if (hugePages) {
+            // An oversized reservation is trimmed down to a huge page aligned region that the shared memory is mapped over
+            auto area = reinterpret_cast<u64>(mmap(nullptr, this->reserved + constant::HugePageSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0));
+            if (reinterpret_cast<void *>(area) == MAP_FAILED)
+                throw exception("An occurred while reserving host memory: {}", strerror(errno));
+
+            auto aligned = util::AlignUp(area, constant::HugePageSize);
+            if (aligned != area)
+                munmap(reinterpret_cast<void *>(area), aligned - area);
+            munmap(reinterpret_cast<void *>(aligned + this->reserved), (area + constant::HugePageSize) - aligned);
+
+            host = mmap(reinterpret_cast<void *>(aligned), this->reserved, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED | MAP_FIXED, fd, 0);
+        } else {
+            host = mmap(nullptr, this->reserved, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED, fd, 0);
+        }
         if (host == MAP_FAILED)
             throw exception("An occurred while mapping shared memory: {}", strerror(errno));
 
-        Registers fregs{
-            .x0 = address,
-            .x1 = size,
-            .x2 = static_cast<u64>(permission.Get()),
-            .x3 = static_cast<u64>(MAP_SHARED | ((address) ? MAP_FIXED : 0)),
-            .x4 = static_cast<u64>(fd),
-            .x8 = __NR_mmap,
+        // Space past the size is reserved as inaccessible so it can be brought into the memory by only changing its permissions
+        std::array<GuestSyscall, 2> map{
+            GuestSyscall{.number = __NR_mmap, .arguments = {address, this->reserved, static_cast<u64>(this->reserved == size ? permission.Get() : PROT_NONE), static_cast<u64>(MAP_SHARED | ((address) ? MAP_FIXED : 0)), static_cast<u64>(fd)}},
+            GuestSyscall{.number = __NR_mprotect, .arguments = {address, size, static_cast<u64>(permission.Get())}},
         };
 
-        state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-        if (fregs.x0 < 0)
+        state.nce->ExecuteSyscalls(std::span(map).first(this->reserved == size ? 1 : 2));
+        if (map[0].result < 0)
             throw exception("An error occurred while mapping private memory in child process");
+        if (this->reserved != size && map[1].result < 0)
+            throw exception("An error occurred while updating private memory's permissions in child process");
+
+        this->address = static_cast<u64>(map[0].result);
 
-        this->address = fregs.x0;
+        if (hugePages) {
+            // This is only advice, kernels without transparent huge pages for shared memory reject it and the memory is backed by regular pages
+            GuestSyscall advise{.number = __NR_madvise, .arguments = {this->address, this->reserved, static_cast<u64>(MADV_HUGEPAGE)}};
+            state.nce->ExecuteSyscalls(std::span(&advise, 1));
+            if (advise.result < 0 || madvise(host, this->reserved, MADV_HUGEPAGE))
+                state.logger->Debug("Huge pages are unavailable for private memory at 0x{:X}", this->address);
+        }
 
         BlockDescriptor block{
-            .address = fregs.x0,
+            .address = this->address,
             .size = size,
             .permission = permission,
         };
         ChunkDescriptor chunk{
-            .address = fregs.x0,
+            .address = this->address,
             .size = size,
             .host = reinterpret_cast<u64>(host),
+            .fd = fd,
             .state = memState,
             .blockList = {block},
         };
         state.os->memory.InsertChunk(chunk);
     }
 
-    void KPrivateMemory::Resize(size_t nSize) {
-        if (close(fd) < 0)
-            throw exception("An error occurred while trying to close shared memory FD: {}", strerror(errno));
+    KPrivateMemory::KPrivateMemory(const DeviceState &state, u64 address, size_t size, memory::Permission permission, memory::MemoryState memState, const std::shared_ptr<KPrivateMemory> &source, u64 sourceAddress) : address(address), size(size), reserved(size), alias(true), KMemory(state, KType::KPrivateMemory) {
+        if (!address || !util::PageAligned(address) || !util::PageAligned(sourceAddress))
+            throw exception("KPrivateMemory aliases require page-aligned fixed addresses: 0x{:X} -> 0x{:X}", sourceAddress, address);
+        if (!source->CanAlias(sourceAddress, size))
+            throw exception("KPrivateMemory alias isn't inside of the source: 0x{:X} - 0x{:X}", sourceAddress, sourceAddress + size);
 
-        fd = ASharedMemory_create("KPrivateMemory", nSize);
+        // The alias holds its own reference to the shared memory, so it stays valid regardless of which of the two is destroyed first
+        fd = dup(source->fd);
         if (fd < 0)
-            throw exception("An error occurred while creating shared memory: {}", fd);
+            throw exception("An error occurred while duplicating shared memory FD: {}", strerror(errno));
 
-        Registers fregs{
-            .x0 = address,
-            .x1 = size,
-            .x8 = __NR_munmap
-        };
+        auto offset{sourceAddress - source->address};
+        auto host = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED, fd, static_cast<off_t>(offset));
+        if (host == MAP_FAILED)
+            throw exception("An occurred while mapping shared memory: {}", strerror(errno));
 
-        state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-        if (fregs.x0 < 0)
-            throw exception("An error occurred while unmapping private memory in child process");
+        GuestSyscall map{.number = __NR_mmap, .arguments = {address, size, static_cast<u64>(permission.Get()), static_cast<u64>(MAP_SHARED | MAP_FIXED), static_cast<u64>(fd), offset}};
+        state.nce->ExecuteSyscalls(std::span(&map, 1));
+        if (map.result < 0)
+            throw exception("An error occurred while mapping private memory alias in child process");
 
-        fregs = {
-            .x0 = address,
-            .x1 = nSize,
-            .x2 = static_cast<u64>(PROT_READ | PROT_WRITE | PROT_EXEC),
-            .x3 = static_cast<u64>(MAP_SHARED | MAP_FIXED),
-            .x4 = static_cast<u64>(fd),
-            .x8 = __NR_mmap,
+        BlockDescriptor block{
+            .address = address,
+            .size = size,
+            .permission = permission,
+        };
+        ChunkDescriptor chunk{
+            .address = address,
+            .size = size,
+            .host = reinterpret_cast<u64>(host),
+            .fd = fd,
+            .fdOffset = offset,
+            .state = memState,
+            .blockList = {block},
         };
+        state.os->memory.InsertChunk(chunk);
+    }
 
-        state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-        if (fregs.x0 < 0)
-            throw exception("An error occurred while remapping private memory in child process");
+    void KPrivateMemory::Resize(size_t nSize) {
+        if (alias)
+            throw exception("KPrivateMemory aliases can't be resized");
 
         auto chunk = state.os->memory.GetChunk(address);
-        state.process->WriteMemory(reinterpret_cast<void *>(chunk->host), address, std::min(nSize, size), true);
 
-        for (const auto &block : chunk->blockList) {
-            if ((block.address - chunk->address) < size) {
-                fregs = {
-                    .x0 = block.address,
-                    .x1 = std::min(block.size, (chunk->address + nSize) - block.address),
-                    .x2 = static_cast<u64>(block.permission.Get()),
-                    .x8 = __NR_mprotect,
-                };
+        if (nSize <= reserved) {
+            // Resizing inside of the reservation only needs the permissions of the space between the sizes to be changed as the mapping stays the same
+            if (nSize != size) {
+                auto protect = nSize > size ? GuestSyscall{.number = __NR_mprotect, .arguments = {address + size, nSize - size, static_cast<u64>(chunk->blockList.front().permission.Get())}} : GuestSyscall{.number = __NR_mprotect, .arguments = {address + nSize, size - nSize, static_cast<u64>(PROT_NONE)}};
 
-                state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-                if (fregs.x0 < 0)
+                state.nce->ExecuteSyscalls(std::span(&protect, 1));
+                if (protect.result < 0)
                     throw exception("An error occurred while updating private memory's permissions in child process");
-            } else {
-                break;
             }
+
+            // Pages past the new size are released by the kernel, their contents are zero if they are brought back into the memory
+            if (nSize < size && madvise(reinterpret_cast<void *>(chunk->host + nSize), size - nSize, MADV_REMOVE))
+                state.logger->Warn("Failed to release the pages of private memory past 0x{:X}: {}", nSize, strerror(errno));
+
+            MemoryManager::ResizeChunk(chunk, nSize);
+            size = nSize;
+            return;
         }
 
-        munmap(reinterpret_cast<void *>(chunk->host), size);
+        int nFd{fd};
+        void *host;
+        if (resizable) {
+            // The memfd is extended in place and the host mapping is grown by the kernel moving its page tables, so none of the contents are copied
+            if (ftruncate(fd, static_cast<off_t>(nSize)) < 0)
+                throw exception("An error occurred while resizing shared memory: {}", strerror(errno));
+
+            host = mremap(reinterpret_cast<void *>(chunk->host), reserved, nSize, MREMAP_MAYMOVE);
+            if (host == MAP_FAILED)
+                throw exception("An occurred while remapping shared memory: {}", strerror(errno));
+        } else {
+            nFd = ASharedMemory_create("KPrivateMemory", nSize);
+            if (nFd < 0)
+                throw exception("An error occurred while creating shared memory: {}", nFd);
+
+            // The contents are copied into the new backing on the host rather than being written into the guest through its memory file
+            host = mmap(nullptr, nSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED, nFd, 0);
+            if (host == MAP_FAILED)
+                throw exception("An occurred while mapping shared memory: {}", strerror(errno));
+            std::memcpy(host, reinterpret_cast<void *>(chunk->host), std::min(nSize, size));
+        }
 
-        auto host = mmap(reinterpret_cast<void *>(chunk->host), nSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED, fd, 0);
-        if (host == MAP_FAILED)
-            throw exception("An occurred while mapping shared memory: {}", strerror(errno));
+        // The old mapping is replaced and then its permissions are restored, each of these is done in a single round trip to the guest
+        // A memfd backing is the same file with a larger size, so it's mapped over the old mapping atomically rather than unmapping it first
+        std::array<GuestSyscall, 2> remap{
+            GuestSyscall{.number = __NR_munmap, .arguments = {address, reserved}},
+            GuestSyscall{.number = __NR_mmap, .arguments = {address, nSize, static_cast<u64>(PROT_READ | PROT_WRITE | PROT_EXEC), static_cast<u64>(MAP_SHARED | MAP_FIXED), static_cast<u64>(nFd)}},
+        };
+
+        state.nce->ExecuteSyscalls(resizable ? std::span<GuestSyscall>(remap).last(1) : std::span<GuestSyscall>(remap));
+        if (!resizable && remap[0].result < 0)
+            throw exception("An error occurred while unmapping private memory in child process");
+        if (remap[1].result < 0)
+            throw exception("An error occurred while remapping private memory in child process");
+
+        std::vector<GuestSyscall> protect;
+        for (const auto &block : chunk->blockList) {
+            if ((block.address - chunk->address) < size)
+                protect.push_back(GuestSyscall{.number = __NR_mprotect, .arguments = {block.address, std::min(block.size, (chunk->address + nSize) - block.address), static_cast<u64>(block.permission.Get())}});
+            else
+                break;
+        }
+
+        state.nce->ExecuteSyscalls(protect);
+        for (const auto &syscall : protect)
+            if (syscall.result < 0)
+                throw exception("An error occurred while updating private memory's permissions in child process");
+
+        if (!resizable) {
+            munmap(reinterpret_cast<void *>(chunk->host), reserved);
+            if (close(fd) < 0)
+                state.logger->Warn("An error occurred while trying to close shared memory FD: {}", strerror(errno));
+            fd = nFd;
+        }
 
         chunk->host = reinterpret_cast<u64>(host);
+        chunk->fd = fd;
         MemoryManager::ResizeChunk(chunk, nSize);
         size = nSize;
+        reserved = nSize;
     }
 
     void KPrivateMemory::UpdatePermission(u64 address, u64 size, memory::Permission permission) {
@@ -144,7 +235,7 @@ namespace skyline::kernel::type {
             if (state.process) {
                 Registers fregs{
                     .x0 = address,
-                    .x1 = size,
+                    .x1 = reserved,
                     .x8 = __NR_munmap,
                 };
                 state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
@@ -154,8 +245,10 @@ namespace skyline::kernel::type {
 
         auto chunk = state.os->memory.GetChunk(address);
         if (chunk) {
-            munmap(reinterpret_cast<void *>(chunk->host), chunk->size);
+            munmap(reinterpret_cast<void *>(chunk->host), reserved);
             state.os->memory.DeleteChunk(address);
         }
+
+        close(fd);
     }
 };
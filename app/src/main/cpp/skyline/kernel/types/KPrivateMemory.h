@@ -12,10 +12,13 @@ namespace skyline::kernel::type {
     class KPrivateMemory : public KMemory {
       private:
         int fd; //!< A file descriptor to the underlying shared memory
+        bool resizable{}; //!< If the shared memory is a memfd which can be resized with ftruncate, this is false if it's ashmem which has a fixed size
+        bool alias{}; //!< If this maps a part of the shared memory of another KPrivateMemory rather than its own, it can't be resized
 
       public:
         u64 address{}; //!< The address of the allocated memory
         size_t size{}; //!< The size of the allocated memory
+        size_t reserved{}; //!< The size of the address space reserved for the memory, it can be resized up to this without being remapped
 
         /**
          * @param state The state of the device
@@ -23,11 +26,40 @@ namespace skyline::kernel::type {
          * @param size The size of the allocation
          * @param permission The permissions for the allocated memory
          * @param memState The MemoryState of the chunk of memory
+         * @param reserved The size of the address space to reserve for growing the memory, this requires a fixed address (If it's less than size then nothing past size is reserved)
          */
-        KPrivateMemory(const DeviceState &state, u64 address, size_t size, memory::Permission permission, memory::MemoryState memState);
+        KPrivateMemory(const DeviceState &state, u64 address, size_t size, memory::Permission permission, memory::MemoryState memState, size_t reserved = 0);
 
         /**
-         * @brief Remap a chunk of memory as to change the size occupied by it
+         * @brief Creates an alias of a part of another KPrivateMemory, the same shared memory is mapped at both addresses so writes to either are visible in the other
+         * @param state The state of the device
+         * @param address The address to map the alias to, this must be fixed
+         * @param size The size of the alias
+         * @param permission The permissions for the alias
+         * @param memState The MemoryState of the chunk of memory
+         * @param source The memory to alias, the aliased range must be inside of it
+         * @param sourceAddress The address in the source memory the alias starts at
+         */
+        KPrivateMemory(const DeviceState &state, u64 address, size_t size, memory::Permission permission, memory::MemoryState memState, const std::shared_ptr<KPrivateMemory> &source, u64 sourceAddress);
+
+        /**
+         * @return If the supplied range is entirely inside of this memory, so it can be aliased with the constructor above
+         */
+        inline bool CanAlias(u64 address, size_t size) {
+            return (this->address <= address) && ((address + size) <= (this->address + this->size));
+        }
+
+        /**
+         * @return If this is an alias of another KPrivateMemory
+         */
+        inline bool IsAlias() {
+            return alias;
+        }
+
+        /**
+         * @brief Changes the size occupied by the memory, this only changes permissions inside of the reservation and remaps the memory otherwise
+         * @note The contents are only copied when growing past the reservation while the memory is backed by ashmem, memfd backings are grown in place
+         * @note Aliases can't be resized, aliases of this memory don't observe the new backing if it's ashmem and grown past the reservation
          * @param size The new size of the memory
          * @return The address the memory was remapped to
          */
@@ -4,6 +4,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/uio.h>
+#include <climits>
 #include <asm/unistd.h>
 #include <nce/guest.h>
 #include <nce.h>
@@ -17,8 +18,17 @@ namespace skyline::kernel::type {
         if (Full())
             throw exception("Trying to get TLS slot from full page");
 
-        slot[index] = true;
-        return Get(index++); // ++ on right will cause increment after evaluation of expression
+        auto index{static_cast<u8>(__builtin_ctz(~reserved))};
+        reserved |= (1 << index);
+        return Get(index);
+    }
+
+    void KProcess::TlsPage::ReleaseSlot(u64 slotAddress) {
+        auto index{(slotAddress - address) / constant::TlsSlotSize};
+        if (slotAddress < address || index >= constant::TlsSlots)
+            throw exception("TLS slot 0x{:X} isn't in page 0x{:X}", slotAddress, address);
+
+        reserved &= ~(1 << index);
     }
 
     u64 KProcess::TlsPage::Get(u8 slotNo) {
@@ -29,13 +39,14 @@ namespace skyline::kernel::type {
     }
 
     bool KProcess::TlsPage::Full() {
-        return slot[constant::TlsSlots - 1];
+        return reserved == (1 << constant::TlsSlots) - 1;
     }
 
     u64 KProcess::GetTlsSlot() {
-        for (auto &tlsPage: tlsPages)
-            if (!tlsPage->Full())
-                return tlsPage->ReserveSlot();
+        std::lock_guard lock(tlsMutex);
+        for (; tlsPageHint < tlsPages.size(); tlsPageHint++)
+            if (!tlsPages[tlsPageHint]->Full())
+                return tlsPages[tlsPageHint]->ReserveSlot();
 
         u64 address;
         if (tlsPages.empty()) {
@@ -49,22 +60,83 @@ namespace skyline::kernel::type {
         tlsPages.push_back(std::make_shared<TlsPage>(tlsMem->address));
 
         auto &tlsPage = tlsPages.back();
-        if (tlsPages.empty())
+        if (tlsPages.size() == 1)
             tlsPage->ReserveSlot(); // User-mode exception handling
 
         return tlsPage->ReserveSlot();
     }
 
+    void KProcess::FreeTlsSlot(u64 address) {
+        std::lock_guard lock(tlsMutex);
+        if (tlsPages.empty() || address < tlsPages.front()->address)
+            throw exception("TLS slot 0x{:X} doesn't belong to any TLS page", address);
+
+        auto index{(address - tlsPages.front()->address) / PAGE_SIZE};
+        if (index >= tlsPages.size())
+            throw exception("TLS slot 0x{:X} doesn't belong to any TLS page", address);
+
+        tlsPages[index]->ReleaseSlot(address);
+        tlsPageHint = std::min(tlsPageHint, index);
+    }
+
+    std::shared_ptr<KSharedMemory> KProcess::GetThreadContext() {
+        {
+            std::lock_guard lock(contextMutex);
+
+            // A killed thread might still be unwinding and writing to its context and TLS, so neither is reused till the thread is gone
+            for (auto entry{contextPool.begin()}; entry != contextPool.end();) {
+                if (entry->tid && tgkill(pid, entry->tid, 0) == -1 && errno == ESRCH) {
+                    if (entry->tls)
+                        FreeTlsSlot(entry->tls);
+                    entry->tid = 0;
+                    entry->tls = 0;
+                }
+
+                if (!entry->memory && !entry->tid)
+                    entry = contextPool.erase(entry);
+                else
+                    entry++;
+            }
+
+            for (auto entry{contextPool.rbegin()}; entry != contextPool.rend(); entry++) {
+                if (entry->tid)
+                    continue;
+
+                auto context{std::move(entry->memory)};
+                contextPool.erase(std::next(entry).base());
+                std::memset(reinterpret_cast<void *>(context->kernel.address), 0, context->kernel.size);
+                return context;
+            }
+        }
+
+        auto size = (sizeof(ThreadContext) + (PAGE_SIZE - 1)) & ~(PAGE_SIZE - 1);
+        auto context = std::make_shared<type::KSharedMemory>(state, 0, size, memory::Permission{true, true, false}, memory::states::Reserved);
+        context->Map(0, size, memory::Permission{true, true, false});
+        return context;
+    }
+
+    void KProcess::RecycleThreadContext(const std::shared_ptr<KSharedMemory> &memory, pid_t tid, u64 tls) {
+        std::lock_guard lock(contextMutex);
+
+        // A context past the size of the pool is dropped, its entry is still kept till the thread has exited so the TLS slot is released then
+        auto pooled{static_cast<size_t>(std::count_if(contextPool.begin(), contextPool.end(), [](const PooledContext &entry) { return entry.memory != nullptr; }))};
+        contextPool.push_back(PooledContext{pooled < constant::ThreadContextPoolSize ? memory : nullptr, tid, tls});
+    }
+
     void KProcess::InitializeMemory() {
         constexpr size_t DefHeapSize = 0x200000; // The default amount of heap
-        heap = NewHandle<KPrivateMemory>(state.os->memory.heap.address, DefHeapSize, memory::Permission{true, true, false}, memory::states::Heap).item;
-        threads[pid]->tls = GetTlsSlot();
+        heap = NewHandle<KPrivateMemory>(state.os->memory.heap.address, DefHeapSize, memory::Permission{true, true, false}, memory::states::Heap, state.os->memory.heap.size).item; // The entire heap region is reserved so svcSetHeapSize doesn't need to remap the heap
+        GetThread(pid)->tls = GetTlsSlot();
+
+        // A few thread contexts are created ahead of time as most titles create several threads while they're starting up
+        for (size_t index{}; index < constant::ThreadContextPrewarm; index++)
+            contextPool.push_back(PooledContext{GetThreadContext(), 0, 0});
     }
 
     KProcess::KProcess(const DeviceState &state, pid_t pid, u64 entryPoint, std::shared_ptr<type::KSharedMemory> &stack, std::shared_ptr<type::KSharedMemory> &tlsMemory) : pid(pid), stack(stack), KSyncObject(state, KType::KProcess) {
         constexpr auto DefaultPriority = 44; // The default priority of a process
 
-        auto thread = NewHandle<KThread>(pid, entryPoint, 0x0, stack->guest.address + stack->guest.size, 0, DefaultPriority, this, tlsMemory).item;
+        auto thread = NewHandle<KThread>(pid, entryPoint, 0x0, stack->guest.address + stack->guest.size, 0, DefaultPriority, constant::DefaultCore, this, tlsMemory).item;
         threads[pid] = thread;
         state.nce->WaitThreadInit(thread);
 
@@ -78,14 +150,13 @@ namespace skyline::kernel::type {
         status = Status::Exiting;
     }
 
-    std::shared_ptr<KThread> KProcess::CreateThread(u64 entryPoint, u64 entryArg, u64 stackTop, i8 priority) {
-        auto size = (sizeof(ThreadContext) + (PAGE_SIZE - 1)) & ~(PAGE_SIZE - 1);
-        auto tlsMem = std::make_shared<type::KSharedMemory>(state, 0, size, memory::Permission{true, true, false}, memory::states::Reserved);
+    std::shared_ptr<KThread> KProcess::CreateThread(u64 entryPoint, u64 entryArg, u64 stackTop, i8 priority, i8 idealCore) {
+        auto tlsMem = GetThreadContext();
 
         Registers fregs{
             .x0 = CLONE_THREAD | CLONE_SIGHAND | CLONE_PTRACE | CLONE_FS | CLONE_VM | CLONE_FILES | CLONE_IO,
             .x1 = stackTop,
-            .x3 = tlsMem->Map(0, size, memory::Permission{true, true, false}),
+            .x3 = tlsMem->guest.address,
             .x8 = __NR_clone,
             .x5 = reinterpret_cast<u64>(&guest::GuestEntry),
             .x6 = entryPoint,
@@ -96,7 +167,9 @@ namespace skyline::kernel::type {
             throw exception("Cannot create thread: Address: 0x{:X}, Stack Top: 0x{:X}", entryPoint, stackTop);
 
         auto pid = static_cast<pid_t>(fregs.x0);
-        auto process = NewHandle<KThread>(pid, entryPoint, entryArg, stackTop, GetTlsSlot(), priority, this, tlsMem).item;
+        auto process = NewHandle<KThread>(pid, entryPoint, entryArg, stackTop, GetTlsSlot(), priority, idealCore, this, tlsMem).item;
+
+        std::lock_guard lock(threadMutex);
         threads[pid] = process;
 
         return process;
@@ -107,62 +180,92 @@ namespace skyline::kernel::type {
         return (chunk && chunk->host) ? chunk->host + (address - chunk->address) : 0;
     }
 
-    void KProcess::ReadMemory(void *destination, u64 offset, size_t size, bool forceGuest) {
-        if (!forceGuest) {
-            auto source = GetHostAddress(offset);
+    u64 KProcess::GetHostAddress(u64 address, size_t size) {
+        auto chunk = state.os->memory.GetChunk(address);
+        return (chunk && chunk->host && (address + size) <= (chunk->address + chunk->size)) ? chunk->host + (address - chunk->address) : 0;
+    }
+
+    void KProcess::TransferMemory(std::span<const MemoryPiece> pieces, bool write, bool forceGuest) {
+        std::vector<iovec> local;
+        std::vector<iovec> remote;
+
+        for (const auto &piece : pieces) {
+            auto pointer{reinterpret_cast<u8 *>(piece.host)};
+            auto offset{piece.guest};
+            auto size{piece.size};
+
+            while (size) {
+                // Any regions which are mirrored into the host are copied directly, this is split on chunk boundaries as they're not contiguous on the host
+                if (!forceGuest) {
+                    auto chunk = state.os->memory.GetChunk(offset);
+                    if (chunk && chunk->host) {
+                        auto copySize = std::min(size, static_cast<size_t>((chunk->address + chunk->size) - offset));
+                        auto host{reinterpret_cast<u8 *>(chunk->host + (offset - chunk->address))};
+                        if (write)
+                            std::memcpy(host, pointer, copySize);
+                        else
+                            std::memcpy(pointer, host, copySize);
+
+                        pointer += copySize;
+                        offset += copySize;
+                        size -= copySize;
+                        continue;
+                    }
+                }
 
-            if (source) {
-                std::memcpy(destination, reinterpret_cast<void *>(source), size);
-                return;
+                local.push_back(iovec{pointer, size});
+                remote.push_back(iovec{reinterpret_cast<void *>(offset), size});
+                break;
             }
         }
 
-        struct iovec local{
-            .iov_base = destination,
-            .iov_len = size,
-        };
-
-        struct iovec remote{
-            .iov_base = reinterpret_cast<void *>(offset),
-            .iov_len = size,
-        };
-
-        if (process_vm_readv(pid, &local, 1, &remote, 1, 0) < 0)
-            pread64(memFd, destination, size, offset);
-    }
-
-    void KProcess::WriteMemory(const void *source, u64 offset, size_t size, bool forceGuest) {
-        if (!forceGuest) {
-            auto destination = GetHostAddress(offset);
-
-            if (destination) {
-                std::memcpy(reinterpret_cast<void *>(destination), source, size);
-                return;
+        for (size_t index{}; index < local.size(); index += IOV_MAX) {
+            auto count{std::min<size_t>(IOV_MAX, local.size() - index)};
+            ssize_t expected{};
+            for (size_t piece{index}; piece < index + count; piece++)
+                expected += static_cast<ssize_t>(local[piece].iov_len);
+
+            auto result{write ? process_vm_writev(pid, local.data() + index, count, remote.data() + index, count, 0) : process_vm_readv(pid, local.data() + index, count, remote.data() + index, count, 0)};
+            if (result != expected) {
+                // The transfer stops at the first piece that fails, so every piece in the batch is retried through the memory file of the process
+                for (size_t piece{index}; piece < index + count; piece++) {
+                    if (write)
+                        pwrite64(memFd, local[piece].iov_base, local[piece].iov_len, reinterpret_cast<off64_t>(remote[piece].iov_base));
+                    else
+                        pread64(memFd, local[piece].iov_base, local[piece].iov_len, reinterpret_cast<off64_t>(remote[piece].iov_base));
+                }
             }
         }
+    }
 
-        struct iovec local{
-            .iov_base = const_cast<void *>(source),
-            .iov_len = size,
-        };
+    void KProcess::ReadMemory(void *destination, u64 offset, size_t size, bool forceGuest) {
+        std::array<MemoryPiece, 1> piece{MemoryPiece{destination, offset, size}};
+        TransferMemory(piece, false, forceGuest);
+    }
 
-        struct iovec remote{
-            .iov_base = reinterpret_cast<void *>(offset),
-            .iov_len = size,
-        };
+    void KProcess::MarkHostWrite(u64 address, size_t size) {
+        // Most host writes are to memory that isn't tracked (Such as IPC buffers), the fault table is checked so they don't need to walk the caches
+        if (!state.nce->HasFaultFlags(address, size, FaultTable::WriteTracked | FaultTable::KernelProtected))
+            return;
 
-        if (process_vm_writev(pid, &local, 1, &remote, 1, 0) < 0)
-            pwrite64(memFd, source, size, offset);
+        state.gpu->textureCache.Invalidate(address, size);
+        state.gpu->bufferCache.Invalidate(address, size);
+    }
+
+    void KProcess::WriteMemory(const void *source, u64 offset, size_t size, bool forceGuest) {
+        MarkHostWrite(offset, size);
+        std::array<MemoryPiece, 1> piece{MemoryPiece{const_cast<void *>(source), offset, size}};
+        TransferMemory(piece, true, forceGuest);
     }
 
     void KProcess::CopyMemory(u64 source, u64 destination, size_t size) {
-        auto sourceHost = GetHostAddress(source);
-        auto destinationHost = GetHostAddress(destination);
+        auto sourceChunk = state.os->memory.GetChunk(source);
+        auto destinationChunk = state.os->memory.GetChunk(destination);
 
-        if (sourceHost && destinationHost) {
-            std::memcpy(reinterpret_cast<void *>(destinationHost), reinterpret_cast<const void *>(sourceHost), size);
+        if (sourceChunk && sourceChunk->host && destinationChunk && destinationChunk->host && (source + size) <= (sourceChunk->address + sourceChunk->size) && (destination + size) <= (destinationChunk->address + destinationChunk->size)) {
+            std::memmove(reinterpret_cast<void *>(destinationChunk->host + (destination - destinationChunk->address)), reinterpret_cast<const void *>(sourceChunk->host + (source - sourceChunk->address)), size);
         } else {
-            if (size <= PAGE_SIZE) {
+            if (size <= PAGE_SIZE || (sourceChunk && sourceChunk->host) || (destinationChunk && destinationChunk->host)) {
                 std::vector<u8> buffer(size);
 
                 state.process->ReadMemory(buffer.data(), source, size);
@@ -180,71 +283,73 @@ namespace skyline::kernel::type {
     }
 
     std::optional<KProcess::HandleOut<KMemory>> KProcess::GetMemoryObject(u64 address) {
-        for (auto&[handle, object] : state.process->handles) {
-            switch (object->objectType) {
+        std::optional<KProcess::HandleOut<KMemory>> memory;
+        handles.ForEach([&](KHandle handle, const HandleTable::Entry &entry) {
+            switch (entry.type) {
                 case type::KType::KPrivateMemory:
                 case type::KType::KSharedMemory:
                 case type::KType::KTransferMemory: {
-                    auto mem = std::static_pointer_cast<type::KMemory>(object);
-                    if (mem->IsInside(address))
-                        return std::make_optional<KProcess::HandleOut<KMemory>>({mem, handle});
+                    auto mem = std::static_pointer_cast<type::KMemory>(entry.object);
+                    if (mem->IsInside(address)) {
+                        memory.emplace(KProcess::HandleOut<KMemory>{mem, handle});
+                        return true;
+                    }
                 }
                 default:
-                    break;
+                    return false;
             }
-        }
+        });
+
+        return memory;
+    }
+
+    void KProcess::InsertArbitrationWaiter(std::vector<KThread *> &queue, KThread *thread) {
+        auto position = std::find_if(queue.begin(), queue.end(), [thread](KThread *waiter) {
+            return waiter->priority > thread->priority; // A lower value denotes a higher priority
+        });
+        queue.insert(position, thread);
+    }
 
-        return std::nullopt;
+    void KProcess::WakeArbitrationWaiter(KThread *thread) {
+        thread->mutexWaitAddress = 0;
+        thread->arbitrationWoken = true;
+        thread->arbitrationConditional.notify_one();
     }
 
     bool KProcess::MutexLock(u64 address, KHandle owner) {
-        std::unique_lock lock(mutexLock);
+        std::unique_lock lock(arbitrationMutex);
 
+        auto thread = state.thread.get();
         auto mtx = GetPointer<u32>(address);
         auto &mtxWaiters = mutexes[address];
 
         if (mtxWaiters.empty()) {
             u32 mtxExpected = 0;
-            if (__atomic_compare_exchange_n(mtx, &mtxExpected, (constant::MtxOwnerMask & state.thread->handle), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+            if (__atomic_compare_exchange_n(mtx, &mtxExpected, (constant::MtxOwnerMask & thread->handle), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
                 return true;
         }
 
         if (__atomic_load_n(mtx, __ATOMIC_SEQ_CST) != (owner | ~constant::MtxOwnerMask))
             return false;
 
-        std::shared_ptr<WaitStatus> status;
-        for (auto it = mtxWaiters.begin();; ++it) {
-            if (it != mtxWaiters.end() && (*it)->priority >= state.thread->priority)
-                continue;
-
-            status = std::make_shared<WaitStatus>(state.thread->priority, state.thread->handle);
-            mtxWaiters.insert(it, status);
-            break;
-        }
-
-        lock.unlock();
-        while (!status->flag);
-        lock.lock();
-        status->flag = false;
+        thread->arbitrationWoken = false;
+        thread->mutexWaitAddress = address;
+        InsertArbitrationWaiter(mtxWaiters, thread);
 
-        for (auto it = mtxWaiters.begin(); it != mtxWaiters.end(); ++it) {
-            if ((*it)->handle == state.thread->handle) {
-                mtxWaiters.erase(it);
-                break;
-            }
-        }
+        // The unlocking thread hands ownership over to us and removes us from the queue prior to waking us up
+        thread->arbitrationConditional.wait(lock, [thread] { return thread->arbitrationWoken; });
 
         return true;
     }
 
     bool KProcess::MutexUnlock(u64 address) {
-        std::unique_lock lock(mutexLock);
+        std::lock_guard lock(arbitrationMutex);
 
         auto mtx = GetPointer<u32>(address);
         auto &mtxWaiters = mutexes[address];
         u32 mtxDesired{};
         if (!mtxWaiters.empty())
-            mtxDesired = (*mtxWaiters.begin())->handle | ((mtxWaiters.size() > 1) ? ~constant::MtxOwnerMask : 0);
+            mtxDesired = mtxWaiters.front()->handle | ((mtxWaiters.size() > 1) ? ~constant::MtxOwnerMask : 0);
 
         u32 mtxExpected = (constant::MtxOwnerMask & state.thread->handle) | ~constant::MtxOwnerMask;
         if (!__atomic_compare_exchange_n(mtx, &mtxExpected, mtxDesired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
@@ -255,120 +360,70 @@ namespace skyline::kernel::type {
         }
 
         if (mtxDesired) {
-            auto status = (*mtxWaiters.begin());
-            status->flag = true;
-            lock.unlock();
-            while (status->flag);
-            lock.lock();
+            auto next = mtxWaiters.front();
+            mtxWaiters.erase(mtxWaiters.begin());
+            WakeArbitrationWaiter(next);
         }
 
         return true;
     }
 
     bool KProcess::ConditionalVariableWait(u64 conditionalAddress, u64 mutexAddress, u64 timeout) {
-        std::unique_lock lock(conditionalLock);
-        auto &condWaiters = conditionals[conditionalAddress];
-
-        std::shared_ptr<WaitStatus> status;
-        for (auto it = condWaiters.begin();; ++it) {
-            if (it != condWaiters.end() && (*it)->priority >= state.thread->priority)
-                continue;
-
-            status = std::make_shared<WaitStatus>(state.thread->priority, state.thread->handle, mutexAddress);
-            condWaiters.insert(it, status);
-            break;
-        }
-
-        lock.unlock();
-
-        bool timedOut{};
-        auto start = util::GetTimeNs();
-        while (!status->flag)
-            if ((util::GetTimeNs() - start) >= timeout)
-                timedOut = true;
-
-        lock.lock();
-
-        if (!status->flag)
-            timedOut = false;
-        else
-            status->flag = false;
-
-        for (auto it = condWaiters.begin(); it != condWaiters.end(); ++it) {
-            if ((*it)->handle == state.thread->handle) {
-                condWaiters.erase(it);
-                break;
+        std::unique_lock lock(arbitrationMutex);
+
+        auto thread = state.thread.get();
+        thread->arbitrationWoken = false;
+        thread->mutexWaitAddress = mutexAddress;
+        thread->condVarWaitAddress = conditionalAddress;
+        InsertArbitrationWaiter(conditionals[conditionalAddress], thread);
+
+        auto predicate = [thread] { return thread->arbitrationWoken; };
+        auto now = std::chrono::steady_clock::now();
+        if (timeout >= static_cast<u64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::time_point::max() - now).count())) {
+            thread->arbitrationConditional.wait(lock, predicate);
+        } else if (!thread->arbitrationConditional.wait_until(lock, now + std::chrono::nanoseconds(timeout), predicate)) {
+            if (thread->condVarWaitAddress) {
+                std::erase(conditionals[conditionalAddress], thread);
+                thread->condVarWaitAddress = 0;
+                thread->mutexWaitAddress = 0;
+                return false;
             }
-        }
 
-        lock.unlock();
+            // The conditional variable was signalled but the mutex is still owned by another thread, we need to wait till it's handed over to us
+            thread->arbitrationConditional.wait(lock, predicate);
+        }
 
-        return !timedOut;
+        return true;
     }
 
     void KProcess::ConditionalVariableSignal(u64 address, u64 amount) {
-        std::unique_lock condLock(conditionalLock);
+        std::lock_guard lock(arbitrationMutex);
 
         auto &condWaiters = conditionals[address];
         u64 count{};
 
-        auto iter = condWaiters.begin();
-        while (iter != condWaiters.end() && count < amount) {
-            auto &thread = *iter;
-            auto mtx = GetPointer<u32>(thread->mutexAddress);
+        while (!condWaiters.empty() && count < amount) {
+            auto thread = condWaiters.front();
+            condWaiters.erase(condWaiters.begin());
+            thread->condVarWaitAddress = 0;
+            count++;
+
+            auto mtx = GetPointer<u32>(thread->mutexWaitAddress);
             u32 mtxValue = __atomic_load_n(mtx, __ATOMIC_SEQ_CST);
 
             while (true) {
-                u32 mtxDesired{};
-
-                if (!mtxValue)
-                    mtxDesired = (constant::MtxOwnerMask & thread->handle);
-                else if ((mtxValue & constant::MtxOwnerMask) == state.thread->handle)
-                    mtxDesired = mtxValue | (constant::MtxOwnerMask & thread->handle);
-                else if (mtxValue & ~constant::MtxOwnerMask)
-                    mtxDesired = mtxValue | ~constant::MtxOwnerMask;
-                else
-                    break;
-
-                if (__atomic_compare_exchange_n(mtx, &mtxValue, mtxDesired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
-                    break;
-            }
-            if (mtxValue && ((mtxValue & constant::MtxOwnerMask) != state.thread->handle)) {
-                std::unique_lock mtxLock(mutexLock);
-
-                auto &mtxWaiters = mutexes[thread->mutexAddress];
-                std::shared_ptr<WaitStatus> status;
-
-                for (auto it = mtxWaiters.begin();; ++it) {
-                    if (it != mtxWaiters.end() && (*it)->priority >= thread->priority)
-                        continue;
-                    status = std::make_shared<WaitStatus>(thread->priority, thread->handle);
-                    mtxWaiters.insert(it, status);
-                    break;
-                }
-
-                mtxLock.unlock();
-                while (!status->flag);
-                mtxLock.lock();
-                status->flag = false;
-
-                for (auto it = mtxWaiters.begin(); it != mtxWaiters.end(); ++it) {
-                    if ((*it)->handle == thread->handle) {
-                        mtxWaiters.erase(it);
+                if (!mtxValue) {
+                    // If the mutex is free, we acquire it on behalf of the waiter and wake it up directly
+                    if (__atomic_compare_exchange_n(mtx, &mtxValue, (constant::MtxOwnerMask & thread->handle), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                        WakeArbitrationWaiter(thread);
                         break;
                     }
+                } else if ((mtxValue & ~constant::MtxOwnerMask) || __atomic_compare_exchange_n(mtx, &mtxValue, mtxValue | ~constant::MtxOwnerMask, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                    // If the mutex is owned by another thread, we flag it as contended and queue the waiter so the owner hands it over on unlocking
+                    InsertArbitrationWaiter(mutexes[thread->mutexWaitAddress], thread);
+                    break;
                 }
-
-                mtxLock.unlock();
             }
-
-            thread->flag = true;
-            iter++;
-            count++;
-
-            condLock.unlock();
-            while (thread->flag);
-            condLock.lock();
         }
     }
 }
@@ -3,8 +3,8 @@
 
 #pragma once
 
-#include <list>
 #include <kernel/memory.h>
+#include <kernel/handle_table.h>
 #include "KThread.h"
 #include "KPrivateMemory.h"
 #include "KTransferMemory.h"
@@ -16,8 +16,9 @@ namespace skyline {
     namespace constant {
         constexpr auto TlsSlotSize = 0x200; //!< The size of a single TLS slot
         constexpr auto TlsSlots = PAGE_SIZE / TlsSlotSize; //!< The amount of TLS slots in a single page
-        constexpr KHandle BaseHandleIndex = 0xD000; // The index of the base handle
         constexpr u32 MtxOwnerMask = 0xBFFFFFFF; //!< The mask of values which contain the owner of a mutex
+        constexpr size_t ThreadContextPrewarm = 4; //!< The amount of thread contexts that are created prior to the guest starting
+        constexpr size_t ThreadContextPoolSize = 32; //!< The maximum amount of thread contexts of exited threads that are kept for reuse
     }
 
     namespace kernel::type {
@@ -35,8 +36,8 @@ namespace skyline {
             */
             struct TlsPage {
                 u64 address; //!< The address of the page allocated for TLS
-                u8 index = 0; //!< The slots are assigned sequentially, this holds the index of the last TLS slot reserved
-                bool slot[constant::TlsSlots]{0}; //!< An array of booleans denoting which TLS slots are reserved
+                u8 reserved{}; //!< A bitmap of the TLS slots that are reserved, the lowest free slot is reserved first
+                static_assert(constant::TlsSlots <= sizeof(reserved) * 8);
 
                 /**
                 * @param address The address of the allocated page
@@ -49,6 +50,12 @@ namespace skyline {
                 */
                 u64 ReserveSlot();
 
+                /**
+                * @brief Releases a TLS slot so it can be reserved again
+                * @param address The address of the slot
+                */
+                void ReleaseSlot(u64 address);
+
                 /**
                 * @brief Returns the address of a particular slot
                 * @param slotNo The number of the slot to be returned
@@ -69,11 +76,60 @@ namespace skyline {
             */
             u64 GetTlsSlot();
 
+            size_t tlsPageHint{}; //!< The index of the first TLS page that might have a free slot, all pages prior to it are full
+
+            /**
+            * @brief A thread context that can be reused by a new thread
+            */
+            struct PooledContext {
+                std::shared_ptr<KSharedMemory> memory; //!< The shared memory holding the ThreadContext, it's mapped into the guest (nullptr if it was dropped as the pool was full)
+                pid_t tid; //!< The TID of the last thread that used the context, it is only reused once this thread has exited (0 if it was never used)
+                u64 tls; //!< The TLS slot of the last thread that used the context, it's released once the thread has exited as it might still be unwinding through it (0 if it has been released)
+            };
+            std::vector<PooledContext> contextPool; //!< Thread contexts which can be reused, creating and mapping shared memory is a large part of the cost of creating a thread
+            Mutex contextMutex; //!< This mutex guards contextPool
+
+            /**
+            * @return A thread context mapped into the guest that isn't used by any thread, its contents are zeroed
+            */
+            std::shared_ptr<KSharedMemory> GetThreadContext();
+
             /**
             * @brief This initializes heap and the initial TLS page
             */
             void InitializeMemory();
 
+            /**
+            * @brief Inserts a thread into an arbitration queue after all threads with the same or a higher priority
+            * @param queue The queue to insert the thread into
+            * @param thread The thread to insert
+            */
+            static void InsertArbitrationWaiter(std::vector<KThread *> &queue, KThread *thread);
+
+            /**
+            * @brief Wakes up a thread parked in MutexLock or ConditionalVariableWait after it has been handed ownership of the mutex
+            * @param thread The thread to wake up
+            * @note arbitrationMutex must be held while calling this
+            */
+            static void WakeArbitrationWaiter(KThread *thread);
+
+          public:
+            /**
+            * @brief A single piece of a scatter-gather transfer between the host and the guest's memory
+            */
+            struct MemoryPiece {
+                void *host; //!< The host buffer the piece is read into or written from
+                u64 guest; //!< The address of the piece in the guest's memory
+                size_t size; //!< The size of the piece
+            };
+
+          private:
+            /**
+            * @brief Transfers a set of pieces between the host and the guest's memory, pieces in host mirrors are copied directly and the rest are batched into as few process_vm_readv/process_vm_writev calls as possible
+            * @param write If the pieces are written to the guest rather than read from it
+            */
+            void TransferMemory(std::span<const MemoryPiece> pieces, bool write, bool forceGuest);
+
           public:
             friend OS;
 
@@ -96,32 +152,18 @@ namespace skyline {
                 Exiting //!< The process is exiting
             } status = Status::Created; //!< The state of the process
 
-            /**
-            * @brief This is used to hold information about a single waiting thread for mutexes and conditional variables
-            */
-            struct WaitStatus {
-                std::atomic_bool flag{false}; //!< The underlying atomic flag of the thread
-                u8 priority; //!< The priority of the thread
-                KHandle handle; //!< The handle of the thread
-                u64 mutexAddress{}; //!< The address of the mutex
-
-                WaitStatus(u8 priority, KHandle handle) : priority(priority), handle(handle) {}
-
-                WaitStatus(u8 priority, KHandle handle, u64 mutexAddress) : priority(priority), handle(handle), mutexAddress(mutexAddress) {}
-            };
-
-            KHandle handleIndex = constant::BaseHandleIndex; //!< This is used to keep track of what to map as an handle
             pid_t pid; //!< The PID of the process or TGID of the threads
             int memFd; //!< The file descriptor to the memory of the process
-            std::unordered_map<KHandle, std::shared_ptr<KObject>> handles; //!< A mapping from a handle_t to it's corresponding KObject which is the actual underlying object
+            HandleTable handles; //!< The table mapping handles to their corresponding KObject which is the actual underlying object
             std::unordered_map<pid_t, std::shared_ptr<KThread>> threads; //!< A mapping from a PID to it's corresponding KThread object
-            std::unordered_map<u64, std::vector<std::shared_ptr<WaitStatus>>> mutexes; //!< A map from a mutex's address to a vector of Mutex objects for threads waiting on it
-            std::unordered_map<u64, std::list<std::shared_ptr<WaitStatus>>> conditionals; //!< A map from a conditional variable's address to a vector of threads waiting on it
-            std::vector<std::shared_ptr<TlsPage>> tlsPages; //!< A vector of all allocated TLS pages
+            Mutex threadMutex; //!< This mutex guards insertions and lookups into the thread map
+            std::unordered_map<u64, std::vector<KThread *>> mutexes; //!< A map from a mutex's address to a priority-ordered queue of the threads waiting on it
+            std::unordered_map<u64, std::vector<KThread *>> conditionals; //!< A map from a conditional variable's address to a priority-ordered queue of the threads waiting on it
+            std::vector<std::shared_ptr<TlsPage>> tlsPages; //!< A vector of all allocated TLS pages, they're contiguous so the page of a slot can be found from its address
+            Mutex tlsMutex; //!< This mutex is to prevent concurrent reservation of TLS slots
             std::shared_ptr<type::KSharedMemory> stack; //!< The shared memory used to hold the stack of the main thread
             std::shared_ptr<KPrivateMemory> heap; //!< The kernel memory object backing the allocated heap
-            Mutex mutexLock; //!< This mutex is to prevent concurrent mutex operations to happen at once
-            Mutex conditionalLock; //!< This mutex is to prevent concurrent conditional variable operations to happen at once
+            std::mutex arbitrationMutex; //!< This mutex guards the mutex and conditional variable queues along with the arbitration state of all threads
 
             /**
             * @brief Creates a KThread object for the main thread and opens the process's memory file
@@ -144,9 +186,24 @@ namespace skyline {
             * @param entryArg An argument to the function
             * @param stackTop The top of the stack
             * @param priority The priority of the thread
+            * @param idealCore The ideal guest CPU core of the thread
             * @return An instance of KThread class for the corresponding thread
             */
-            std::shared_ptr<KThread> CreateThread(u64 entryPoint, u64 entryArg, u64 stackTop, i8 priority);
+            std::shared_ptr<KThread> CreateThread(u64 entryPoint, u64 entryArg, u64 stackTop, i8 priority, i8 idealCore = constant::DefaultCore);
+
+            /**
+            * @brief Releases the TLS slot of a thread that has exited, the slot and its page are reused by threads created later
+            * @param address The address of the TLS slot
+            */
+            void FreeTlsSlot(u64 address);
+
+            /**
+            * @brief Returns the context and TLS slot of a thread that has been killed to the pool, so they can be used by a thread that's created after it has exited
+            * @param memory The shared memory holding the ThreadContext of the thread
+            * @param tid The TID of the thread
+            * @param tls The address of the TLS slot of the thread
+            */
+            void RecycleThreadContext(const std::shared_ptr<KSharedMemory> &memory, pid_t tid, u64 tls);
 
             /**
             * @brief This returns the host address for a specific address in guest memory
@@ -155,6 +212,14 @@ namespace skyline {
             */
             u64 GetHostAddress(u64 address);
 
+            /**
+            * @brief This returns the host address for a region of guest memory if it's contiguous on the host
+            * @param address The corresponding guest address
+            * @param size The size of the region
+            * @return The corresponding host address or 0 if the region isn't entirely backed by a single host mirror
+            */
+            u64 GetHostAddress(u64 address, size_t size);
+
             /**
             * @tparam Type The type of the pointer to return
             * @param address The address on the guest
@@ -166,6 +231,19 @@ namespace skyline {
                 return reinterpret_cast<Type *>(GetHostAddress(address));
             }
 
+            /**
+            * @brief Returns a span over an array of objects in guest memory, the range is validated once so the elements can be accessed without any further lookups
+            * @tparam Type The type of the objects in the span
+            * @param address The address of the first object
+            * @param count The amount of objects in the span
+            * @return A span over the host mirror of the range or an empty span if it isn't entirely backed by a single host mirror
+            */
+            template<typename Type>
+            inline std::span<Type> GetSpan(u64 address, size_t count) {
+                auto host{GetHostAddress(address, count * sizeof(Type))};
+                return host ? std::span<Type>(reinterpret_cast<Type *>(host), count) : std::span<Type>();
+            }
+
             /**
             * @brief Returns a reference to an object from guest memory
             * @tparam Type The type of the object to be read
@@ -224,6 +302,7 @@ namespace skyline {
             inline void WriteMemory(Type &item, u64 address) {
                 auto destination = GetPointer<Type>(address);
                 if (destination) {
+                    MarkHostWrite(address, sizeof(Type));
                     *destination = item;
                 } else {
                     WriteMemory(&item, address, sizeof(Type));
@@ -240,12 +319,19 @@ namespace skyline {
             inline void WriteMemory(const Type &item, u64 address) {
                 auto destination = GetPointer<Type>(address);
                 if (destination) {
+                    MarkHostWrite(address, sizeof(Type));
                     *destination = item;
                 } else {
                     WriteMemory(&item, address, sizeof(Type));
                 }
             }
 
+            /**
+            * @brief Reports a write by the host into guest memory to the caches that track guest writes, this has to precede any write that doesn't go through WriteMemory (Such as one through GetPointer)
+            * @note Writes through the host mirror or the memory file of the process bypass the page protections that guest writes are tracked with, any textures and buffers on the region wouldn't be synchronized otherwise
+            */
+            void MarkHostWrite(u64 address, size_t size);
+
             /**
             * @brief Read data from the guest's memory
             * @param destination The address to the location where the process memory is written
@@ -264,6 +350,25 @@ namespace skyline {
             */
             void WriteMemory(const void *source, u64 offset, size_t size, bool forceGuest = false);
 
+            /**
+            * @brief Reads a set of discontiguous pieces of the guest's memory
+            * @param pieces The pieces to read, these are read into their host buffers
+            * @param forceGuest This flag forces the read to be performed in guest address space
+            */
+            inline void ReadMemory(std::span<const MemoryPiece> pieces, bool forceGuest = false) {
+                TransferMemory(pieces, false, forceGuest);
+            }
+
+            /**
+            * @brief Writes a set of discontiguous pieces to the guest's memory
+            * @param pieces The pieces to write, these are written from their host buffers
+            * @param forceGuest This flag forces the write to be performed in guest address space
+            * @note The write isn't reported with MarkHostWrite, this is used by the GPU which synchronizes its caches with the region itself
+            */
+            inline void WriteMemory(std::span<const MemoryPiece> pieces, bool forceGuest = false) {
+                TransferMemory(pieces, true, forceGuest);
+            }
+
             /**
             * @brief Copy one chunk to another in the guest's memory
             * @param source The address of where the data to read is present
@@ -281,12 +386,21 @@ namespace skyline {
             template<typename objectClass, typename ...objectArgs>
             HandleOut<objectClass> NewHandle(objectArgs... args) {
                 std::shared_ptr<objectClass> item;
-                if constexpr (std::is_same<objectClass, KThread>())
-                    item = std::make_shared<objectClass>(state, handleIndex, args...);
-                else
-                    item = std::make_shared<objectClass>(state, args...);
-                handles[handleIndex] = std::static_pointer_cast<KObject>(item);
-                return {item, handleIndex++};
+                KHandle handle;
+                if constexpr (std::is_same<objectClass, KThread>()) {
+                    handle = handles.Reserve();
+                    try {
+                        item = std::make_shared<objectClass>(state, handle, args...);
+                    } catch (...) {
+                        handles.Delete(handle);
+                        throw;
+                    }
+                    handles.Publish(handle, item);
+                } else {
+                    item = std::make_shared<objectClass>(state, args...); // The object is constructed outside the table as it might call into the guest
+                    handle = handles.Insert(item);
+                }
+                return {item, handle};
             }
 
             /**
@@ -296,46 +410,120 @@ namespace skyline {
             */
             template<typename objectClass>
             KHandle InsertItem(std::shared_ptr<objectClass> &item) {
-                handles[handleIndex] = std::static_pointer_cast<KObject>(item);
-                return handleIndex++;
+                return handles.Insert(item);
             }
 
             /**
-            * @brief Returns the underlying kernel object for a handle
-            * @tparam objectClass The class of the kernel object present in the handle
-            * @param handle The handle of the object
-            * @return A shared pointer to the object
+            * @return The KType of a kernel object class
             */
             template<typename objectClass>
-            std::shared_ptr<objectClass> GetHandle(KHandle handle) {
-                KType objectType;
+            static constexpr KType GetKType() {
                 if constexpr(std::is_same<objectClass, KThread>())
-                    objectType = KType::KThread;
+                    return KType::KThread;
                 else if constexpr(std::is_same<objectClass, KProcess>())
-                    objectType = KType::KProcess;
+                    return KType::KProcess;
                 else if constexpr(std::is_same<objectClass, KSharedMemory>())
-                    objectType = KType::KSharedMemory;
+                    return KType::KSharedMemory;
                 else if constexpr(std::is_same<objectClass, KTransferMemory>())
-                    objectType = KType::KTransferMemory;
+                    return KType::KTransferMemory;
                 else if constexpr(std::is_same<objectClass, KPrivateMemory>())
-                    objectType = KType::KPrivateMemory;
+                    return KType::KPrivateMemory;
                 else if constexpr(std::is_same<objectClass, KSession>())
-                    objectType = KType::KSession;
+                    return KType::KSession;
                 else if constexpr(std::is_same<objectClass, KEvent>())
-                    objectType = KType::KEvent;
+                    return KType::KEvent;
                 else
-                    throw exception("KProcess::GetHandle couldn't determine object type");
-                try {
-                    auto item = handles.at(handle);
-                    if (item->objectType == objectType)
-                        return std::static_pointer_cast<objectClass>(item);
-                    else
-                        throw exception("Tried to get kernel object (0x{:X}) with different type: {} when object is {}", handle, objectType, item->objectType);
-                } catch (std::out_of_range) {
+                    static_assert(!sizeof(objectClass *), "KProcess::GetKType couldn't determine object type");
+            }
+
+            /**
+            * @brief Returns the underlying kernel object for a handle
+            * @tparam objectClass The class of the kernel object present in the handle
+            * @param handle The handle of the object
+            * @return A shared pointer to the object
+            */
+            template<typename objectClass>
+            std::shared_ptr<objectClass> GetHandle(KHandle handle) {
+                auto entry{handles.Get(handle)};
+                if (!entry.object)
                     throw exception("GetHandle was called with invalid handle: 0x{:X}", handle);
+
+                if constexpr(std::is_same<objectClass, KObject>()) {
+                    return entry.object;
+                } else {
+                    constexpr auto objectType{GetKType<objectClass>()};
+                    if (entry.type == objectType)
+                        return std::static_pointer_cast<objectClass>(std::move(entry.object));
+                    else
+                        throw exception("Tried to get kernel object (0x{:X}) with different type: {} when object is {}", handle, objectType, entry.type);
                 }
             }
 
+            /**
+            * @brief Returns the underlying kernel object for a handle without taking a reference to it
+            * @tparam objectClass The class of the kernel object present in the handle
+            * @param handle The handle of the object
+            * @return A pointer to the object, this is only valid till the HandleTable::BorrowScope on the handle table that it was borrowed in has ended
+            */
+            template<typename objectClass>
+            objectClass *BorrowHandle(KHandle handle) {
+                auto entry{handles.Borrow(handle)};
+                if (!entry.object)
+                    throw exception("BorrowHandle was called with invalid handle: 0x{:X}", handle);
+
+                if constexpr(std::is_same<objectClass, KObject>()) {
+                    return entry.object;
+                } else {
+                    constexpr auto objectType{GetKType<objectClass>()};
+                    if (entry.type == objectType)
+                        return static_cast<objectClass *>(entry.object);
+                    else
+                        throw exception("Tried to borrow kernel object (0x{:X}) with different type: {} when object is {}", handle, objectType, entry.type);
+                }
+            }
+
+            /**
+            * @brief Returns the underlying kernel object for a handle, this doesn't throw so it can be used where an invalid handle is an error that's returned to the guest
+            * @tparam objectClass The class of the kernel object present in the handle
+            * @return A shared pointer to the object, this is null if the handle is invalid or refers to an object of a different type
+            */
+            template<typename objectClass>
+            std::shared_ptr<objectClass> TryGetHandle(KHandle handle) {
+                auto entry{handles.Get(handle)};
+                if constexpr(std::is_same<objectClass, KObject>())
+                    return entry.object;
+                else if (entry.object && entry.type == GetKType<objectClass>())
+                    return std::static_pointer_cast<objectClass>(std::move(entry.object));
+                else
+                    return nullptr;
+            }
+
+            /**
+            * @brief Returns the underlying kernel object for a handle without taking a reference to it, this doesn't throw so it can be used where an invalid handle is an error that's returned to the guest
+            * @tparam objectClass The class of the kernel object present in the handle
+            * @return A pointer to the object, this is null if the handle is invalid or refers to an object of a different type. It's only valid till the HandleTable::BorrowScope on the handle table that it was borrowed in has ended
+            */
+            template<typename objectClass>
+            objectClass *TryBorrowHandle(KHandle handle) {
+                auto entry{handles.Borrow(handle)};
+                if constexpr(std::is_same<objectClass, KObject>())
+                    return entry.object;
+                else if (entry.object && entry.type == GetKType<objectClass>())
+                    return static_cast<objectClass *>(entry.object);
+                else
+                    return nullptr;
+            }
+
+            /**
+            * @brief Returns the KThread object for a thread in this process
+            * @param tid The TID of the thread
+            * @return A shared pointer to the corresponding KThread object
+            */
+            inline std::shared_ptr<KThread> GetThread(pid_t tid) {
+                std::lock_guard lock(threadMutex);
+                return threads.at(tid);
+            }
+
             /**
             * @brief Retrieves a kernel memory object that owns the specified address
             * @param address The address to look for
@@ -346,9 +534,10 @@ namespace skyline {
             /**
             * @brief This deletes a certain handle from the handle table
             * @param handle The handle to delete
+            * @return If the handle was valid and has been deleted
             */
-            inline void DeleteHandle(KHandle handle) {
-                handles.erase(handle);
+            inline bool DeleteHandle(KHandle handle) {
+                return handles.Delete(handle); // The object is destroyed once it can't be borrowed anymore and after the table has been unlocked as destruction might call into the guest
             }
 
             /**
@@ -14,10 +14,30 @@ namespace skyline::kernel::type {
     class KSession : public KSyncObject {
       public:
         std::shared_ptr<service::BaseService> serviceObject; //!< A shared pointer to the service class
-        std::unordered_map<KHandle, std::shared_ptr<service::BaseService>> domainTable; //!< This maps from a virtual handle to it's service
-        KHandle handleIndex{0x1}; //!< The currently allocated handle index
+        std::vector<std::shared_ptr<service::BaseService>> domainTable; //!< The objects in the domain indexed by their object ID - 1, the slots of closed objects are empty till their ID is reused
+        std::vector<KHandle> freeDomainIds; //!< The IDs of closed objects, these are reused prior to the table being grown
         enum class ServiceStatus { Open, Closed } serviceStatus{ServiceStatus::Open}; //!< If the session is open or closed
         bool isDomain{}; //!< Holds if this is a domain session or not
+        Mutex mutex; //!< This mutex serializes requests on this session, requests on different sessions are handled concurrently
+        kernel::ipc::IpcLayoutCache layoutCache; //!< The layouts of requests recently made on this session, this is guarded by mutex
+
+        /**
+         * @brief Unlock releases the lock on a session for the duration of its scope, this prevents requests that block on something unrelated to the state of the session from holding up other requests on it
+         * @note This must only be used inside of a request handler as the lock has to be held by the calling thread
+         */
+        class Unlock {
+          private:
+            Mutex &mutex; //!< The mutex of the session
+
+          public:
+            Unlock(KSession &session) : mutex(session.mutex) {
+                mutex.unlock();
+            }
+
+            ~Unlock() {
+                mutex.lock();
+            }
+        };
 
         /**
          * @param state The state of the device
@@ -31,8 +51,42 @@ namespace skyline::kernel::type {
          */
         KHandle ConvertDomain() {
             isDomain = true;
-            domainTable[handleIndex] = serviceObject;
-            return handleIndex++;
+            return AddDomainObject(serviceObject);
+        }
+
+        /**
+         * @brief Adds an object to the domain
+         * @return The object ID of the object in the domain
+         */
+        KHandle AddDomainObject(std::shared_ptr<service::BaseService> object) {
+            if (!freeDomainIds.empty()) {
+                auto id{freeDomainIds.back()};
+                freeDomainIds.pop_back();
+                domainTable[id - 1] = std::move(object);
+                return id;
+            }
+
+            domainTable.push_back(std::move(object));
+            return static_cast<KHandle>(domainTable.size());
+        }
+
+        /**
+         * @return A borrowed pointer to the object with the supplied ID in the domain or nullptr if there's no such object, it's only valid till the object is closed
+         */
+        service::BaseService *GetDomainObject(KHandle id) {
+            return (id && id <= domainTable.size()) ? domainTable[id - 1].get() : nullptr;
+        }
+
+        /**
+         * @brief Removes the object with the supplied ID from the domain, its ID can be reused by objects added after this
+         * @return The removed object or nullptr if there was no such object
+         */
+        std::shared_ptr<service::BaseService> RemoveDomainObject(KHandle id) {
+            if (!GetDomainObject(id))
+                return nullptr;
+
+            freeDomainIds.push_back(id);
+            return std::move(domainTable[id - 1]);
         }
     };
 }
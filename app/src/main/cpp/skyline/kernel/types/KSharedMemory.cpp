@@ -35,6 +35,7 @@ namespace skyline::kernel::type {
             ChunkDescriptor chunk{
                 .address = address,
                 .host = address,
+                .fd = fd,
                 .size = size,
                 .state = initialState,
                 .blockList = {block},
@@ -71,6 +72,7 @@ namespace skyline::kernel::type {
         ChunkDescriptor chunk{
             .address = fregs.x0,
             .host = kernel.address,
+            .fd = fd,
             .size = size,
             .state = initialState,
             .blockList = {block},
@@ -89,55 +91,44 @@ namespace skyline::kernel::type {
             if (fd < 0)
                 throw exception("An error occurred while creating shared memory: {}", fd);
 
-            Registers fregs{
-                .x0 = guest.address,
-                .x1 = guest.size,
-                .x8 = __NR_munmap
-            };
-
-            state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-            if (fregs.x0 < 0)
-                throw exception("An error occurred while unmapping private memory in child process");
+            // The contents are copied into the new backing on the host rather than being written into the guest through its memory file
+            auto host = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED, fd, 0);
+            if (host == MAP_FAILED)
+                throw exception("An occurred while mapping shared memory: {}", strerror(errno));
+            std::memcpy(host, reinterpret_cast<void *>(kernel.address), std::min(guest.size, size));
 
-            fregs = {
-                .x0 = guest.address,
-                .x1 = size,
-                .x2 = static_cast<u64>(PROT_READ | PROT_WRITE | PROT_EXEC),
-                .x3 = static_cast<u64>(MAP_SHARED | MAP_FIXED),
-                .x4 = static_cast<u64>(fd),
-                .x8 = __NR_mmap,
+            // The old mapping is replaced and then its permissions are restored, each of these is done in a single round trip to the guest
+            std::array<GuestSyscall, 2> remap{
+                GuestSyscall{.number = __NR_munmap, .arguments = {guest.address, guest.size}},
+                GuestSyscall{.number = __NR_mmap, .arguments = {guest.address, size, static_cast<u64>(PROT_READ | PROT_WRITE | PROT_EXEC), static_cast<u64>(MAP_SHARED | MAP_FIXED), static_cast<u64>(fd)}},
             };
 
-            state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-            if (fregs.x0 < 0)
+            state.nce->ExecuteSyscalls(remap);
+            if (remap[0].result < 0)
+                throw exception("An error occurred while unmapping private memory in child process");
+            if (remap[1].result < 0)
                 throw exception("An error occurred while remapping private memory in child process");
 
-            state.process->WriteMemory(reinterpret_cast<void *>(kernel.address), guest.address, std::min(guest.size, size), true);
-
             auto chunk = state.os->memory.GetChunk(guest.address);
+            std::vector<GuestSyscall> protect;
             for (const auto &block : chunk->blockList) {
-                if ((block.address - chunk->address) < guest.size) {
-                    fregs = {
-                        .x0 = block.address,
-                        .x1 = std::min(block.size, (chunk->address + size) - block.address),
-                        .x2 = static_cast<u64>(block.permission.Get()),
-                        .x8 = __NR_mprotect,
-                    };
-
-                    state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-                    if (fregs.x0 < 0)
-                        throw exception("An error occurred while updating private memory's permissions in child process");
-                } else {
+                if ((block.address - chunk->address) < guest.size)
+                    protect.push_back(GuestSyscall{.number = __NR_mprotect, .arguments = {block.address, std::min(block.size, (chunk->address + size) - block.address), static_cast<u64>(block.permission.Get())}});
+                else
                     break;
-                }
             }
 
-            munmap(reinterpret_cast<void *>(kernel.address), kernel.size);
+            state.nce->ExecuteSyscalls(protect);
+            for (const auto &syscall : protect)
+                if (syscall.result < 0)
+                    throw exception("An error occurred while updating private memory's permissions in child process");
 
-            auto host = mmap(reinterpret_cast<void *>(chunk->host), size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_SHARED, fd, 0);
-            if (host == MAP_FAILED)
-                throw exception("An occurred while mapping shared memory: {}", strerror(errno));
+            munmap(reinterpret_cast<void *>(kernel.address), kernel.size);
 
+            kernel.address = reinterpret_cast<u64>(host);
+            kernel.size = size;
+            chunk->host = kernel.address;
+            chunk->fd = fd;
             guest.size = size;
             MemoryManager::ResizeChunk(chunk, size);
         } else if (kernel.Valid()) {
@@ -3,14 +3,39 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <common.h>
 #include "KObject.h"
 
 namespace skyline::kernel::type {
+    /**
+     * @brief SyncWaiter is used by a thread to block on one or more KSyncObjects till it's woken up by any of them
+     */
+    struct SyncWaiter {
+        std::mutex mutex; //!< The mutex guarding woken, this must be held while checking the wait condition
+        std::condition_variable conditional; //!< The conditional variable the waiting thread blocks on
+        bool woken{}; //!< If the waiter has been woken up since it was last reset
+
+        /**
+         * @brief Wakes up the thread waiting on this object
+         */
+        void Wake() {
+            {
+                std::lock_guard lock(mutex);
+                woken = true;
+            }
+            conditional.notify_one();
+        }
+    };
+
     /**
      * @brief KSyncObject holds the state of a waitable object
      */
     class KSyncObject : public KObject {
+      private:
+        Mutex waiterMutex; //!< This mutex guards the waiter list
+        std::vector<SyncWaiter *> waiters; //!< A list of all the waiters currently blocked on this object
+
       public:
         std::atomic<bool> signalled{false}; //!< If the current object is signalled (Used as object stays signalled till the signal is consumed)
 
@@ -21,10 +46,33 @@ namespace skyline::kernel::type {
         KSyncObject(const DeviceState &state, skyline::kernel::type::KType type) : KObject(state, type) {};
 
         /**
-         * @brief A function for calling when a particular KSyncObject is signalled
+         * @brief A function for calling when a particular KSyncObject is signalled, it wakes up all the waiters on this object
          */
         virtual void Signal() {
             signalled = true;
+
+            std::lock_guard lock(waiterMutex);
+            for (auto waiter : waiters)
+                waiter->Wake();
+        }
+
+        /**
+         * @brief Registers a waiter to be woken up when this object is signalled
+         * @param waiter The waiter to register
+         * @note The waiter must be registered prior to checking if the object is signalled to avoid missing a signal
+         */
+        void AddWaiter(SyncWaiter *waiter) {
+            std::lock_guard lock(waiterMutex);
+            waiters.push_back(waiter);
+        }
+
+        /**
+         * @brief Unregisters a waiter that was registered with AddWaiter
+         * @param waiter The waiter to unregister
+         */
+        void RemoveWaiter(SyncWaiter *waiter) {
+            std::lock_guard lock(waiterMutex);
+            std::erase(waiters, waiter);
         }
 
         virtual ~KSyncObject() = default;
@@ -1,15 +1,18 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <sched.h>
 #include <sys/resource.h>
 #include <nce.h>
+#include <thread_priority.h>
 #include "KThread.h"
 #include "KProcess.h"
 
 namespace skyline::kernel::type {
-    KThread::KThread(const DeviceState &state, KHandle handle, pid_t selfTid, u64 entryPoint, u64 entryArg, u64 stackTop, u64 tls, i8 priority, KProcess *parent, const std::shared_ptr<type::KSharedMemory> &tlsMemory) : handle(handle), tid(selfTid), entryPoint(entryPoint), entryArg(entryArg), stackTop(stackTop), tls(tls), priority(priority), parent(parent), ctxMemory(tlsMemory), KSyncObject(state,
+    KThread::KThread(const DeviceState &state, KHandle handle, pid_t selfTid, u64 entryPoint, u64 entryArg, u64 stackTop, u64 tls, i8 priority, i8 idealCore, KProcess *parent, const std::shared_ptr<type::KSharedMemory> &tlsMemory) : handle(handle), tid(selfTid), entryPoint(entryPoint), entryArg(entryArg), stackTop(stackTop), tls(tls), priority(priority), idealCore(idealCore), affinityMask(1ULL << idealCore), parent(parent), ctxMemory(tlsMemory), KSyncObject(state,
         KType::KThread) {
         UpdatePriority(priority);
+        UpdateCoreMask(idealCore, affinityMask);
     }
 
     KThread::~KThread() {
@@ -22,7 +25,8 @@ namespace skyline::kernel::type {
                 parent->status = KProcess::Status::Started;
             status = Status::Running;
 
-            state.nce->StartThread(entryArg, handle, parent->threads.at(tid));
+            auto thread = parent->GetThread(tid);
+            state.nce->StartThread(entryArg, handle, thread);
         }
     }
 
@@ -32,9 +36,22 @@ namespace skyline::kernel::type {
             Signal();
 
             tgkill(parent->pid, tid, SIGTERM);
+
+            // This pairs with the fence in NCE::HandleKernelRequest, either Release sees the worker servicing the thread or the worker sees that the thread is dead
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            Release();
         }
     }
 
+    void KThread::Release() {
+        // The main thread's resources aren't released as the process exits with it, neither are those of threads killed while the process is being destroyed
+        if (inKernel || tid == parent->pid || parent->status == KProcess::Status::Exiting || released.exchange(true))
+            return;
+
+        parent->RecycleThreadContext(ctxMemory, tid, tls);
+        tls = 0;
+    }
+
     void KThread::UpdatePriority(i8 priority) {
         this->priority = priority;
         auto priorityValue = androidPriority.Rescale(switchPriority, priority);
@@ -42,4 +59,51 @@ namespace skyline::kernel::type {
         if (setpriority(PRIO_PROCESS, static_cast<id_t>(tid), priorityValue) == -1)
             throw exception("Couldn't set process priority to {} for PID: {}", priorityValue, tid);
     }
+
+    void KThread::UpdateCoreMask(i8 idealCore, u64 affinityMask) {
+        this->idealCore = idealCore;
+        this->affinityMask = affinityMask;
+
+        if (!state.settings->Get().coreAffinity)
+            return;
+
+        auto hostCores{GetHostCores(idealCore, affinityMask)};
+        if (sched_setaffinity(tid, sizeof(hostCores), &hostCores) == -1)
+            throw exception("Couldn't set the host core affinity for TID: {}: {}", tid, strerror(errno));
+    }
+
+    cpu_set_t KThread::GetHostCores(i8 idealCore, u64 affinityMask) {
+        // Guest cores 0-2 are mapped onto the big host cores and guest core 3 onto the little host cores
+        const auto &hostCoreMap{priority::GetHostCoreMap()};
+        auto getHostCores{[&hostCoreMap](u8 core) -> const cpu_set_t & { return core == 3 ? hostCoreMap.little : hostCoreMap.big; }};
+
+        cpu_set_t hostCores;
+        if (idealCore >= 0) {
+            hostCores = getHostCores(static_cast<u8>(idealCore));
+        } else {
+            CPU_ZERO(&hostCores);
+            for (u8 core = 0; core < constant::CoreCount; core++)
+                if (affinityMask & (1ULL << core))
+                    CPU_OR(&hostCores, &hostCores, &getHostCores(core));
+        }
+        return hostCores;
+    }
+
+    void KThread::Yield(bool migrate) {
+        // A thread pinned to the host cores of its ideal core is left unpinned till its next SVC, so the host scheduler can move it onto any core in its affinity mask when it resumes after the yield
+        if (migrate && idealCore >= 0 && state.settings->Get().coreAffinity) {
+            auto hostCores{GetHostCores(-1, affinityMask)};
+            if (sched_setaffinity(tid, sizeof(hostCores), &hostCores) == 0)
+                unpinned = true;
+        }
+
+        // The SVC is serviced on a kernel worker while the thread is blocked on its context, so the yield is run on the thread itself rather than yielding the worker
+        GuestSyscall yield{.number = __NR_sched_yield};
+        state.nce->ExecuteSyscalls(std::span(&yield, 1));
+    }
+
+    void KThread::RestorePinning() {
+        if (unpinned.exchange(false))
+            UpdateCoreMask(idealCore, affinityMask);
+    }
 }
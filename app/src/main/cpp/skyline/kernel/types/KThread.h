@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <sched.h>
 #include "KSyncObject.h"
 #include "KSharedMemory.h"
 
@@ -48,12 +49,22 @@ namespace skyline::kernel::type {
             Dead //!< The thread is dead and not running
         } status = Status::Created; //!< The state of the thread
         std::atomic<bool> cancelSync{false}; //!< This is to flag to a thread to cancel a synchronization call it currently is in
+        std::atomic<bool> inKernel{}; //!< If a kernel worker is servicing a request of the thread, the resources of a dead thread are only released once this is cleared
+        std::atomic<bool> released{}; //!< If the resources of the dead thread have been released
+        std::atomic<bool> unpinned{}; //!< If the thread was unpinned from the host cores of its ideal core by a yield with migration, it's pinned again on its next SVC
+        SyncWaiter syncWaiter; //!< The waiter this thread uses to block on KSyncObjects during synchronization calls
+        std::condition_variable arbitrationConditional; //!< The conditional variable this thread parks on while waiting on a guest mutex or conditional variable
+        bool arbitrationWoken{}; //!< If this thread has been handed the mutex it was parked on (Guarded by KProcess::arbitrationMutex)
+        u64 mutexWaitAddress{}; //!< The address of the mutex this thread is waiting to acquire (Guarded by KProcess::arbitrationMutex)
+        u64 condVarWaitAddress{}; //!< The address of the conditional variable this thread is waiting on or 0 if it isn't waiting on one (Guarded by KProcess::arbitrationMutex)
         std::shared_ptr<type::KSharedMemory> ctxMemory; //!< The KSharedMemory of the shared memory allocated by the guest process TLS
         KHandle handle; // The handle of the object in the handle table
         pid_t tid; //!< The TID of the current thread
         u64 stackTop; //!< The top of the stack (Where it starts growing downwards from)
         u64 tls; //!< The address of TLS (Thread Local Storage) slot assigned to the current thread
         i8 priority; //!< The priority of a thread in Nintendo format
+        i8 idealCore; //!< The ideal guest CPU core of the thread, this is -1 if the thread has no ideal core
+        u64 affinityMask; //!< A mask of the guest CPU cores that the thread can run on
 
         Priority androidPriority{19, -8}; //!< The range of priorities for Android
         Priority switchPriority{0, 63}; //!< The range of priorities for the Nintendo Switch
@@ -67,10 +78,11 @@ namespace skyline::kernel::type {
          * @param stackTop The top of the stack
          * @param tls The address of the TLS slot assigned
          * @param priority The priority of the thread in Nintendo format
+         * @param idealCore The ideal guest CPU core of the thread, this is the only core in its affinity mask
          * @param parent The parent process of this thread
          * @param tlsMemory The KSharedMemory object for TLS memory allocated by the guest process
          */
-        KThread(const DeviceState &state, KHandle handle, pid_t selfTid, u64 entryPoint, u64 entryArg, u64 stackTop, u64 tls, i8 priority, KProcess *parent, const std::shared_ptr<type::KSharedMemory> &tlsMemory);
+        KThread(const DeviceState &state, KHandle handle, pid_t selfTid, u64 entryPoint, u64 entryArg, u64 stackTop, u64 tls, i8 priority, i8 idealCore, KProcess *parent, const std::shared_ptr<type::KSharedMemory> &tlsMemory);
 
         /**
          * @brief Kills the thread and deallocates the memory allocated for stack.
@@ -87,11 +99,41 @@ namespace skyline::kernel::type {
          */
         void Kill();
 
+        /**
+         * @brief Releases the TLS slot and the context of the dead thread unless a kernel worker is still servicing it
+         * @note This is called by Kill and by a kernel worker once it's done servicing a dead thread, so the resources are released by whichever of them is last
+         */
+        void Release();
+
         /**
          * @brief Update the priority level for the process.
          * @details Set the priority of the current thread to `priority` using setpriority [https://linux.die.net/man/3/setpriority]. We rescale the priority from Nintendo scale to that of Android.
          * @param priority The priority of the thread in Nintendo format
          */
         void UpdatePriority(i8 priority);
+
+        /**
+         * @brief Updates the guest CPU cores that the thread can run on and maps them onto host CPU cores
+         * @details Guest cores 0-2 are mapped onto the fastest host cores and guest core 3 is mapped onto the slowest host cores, a thread with an ideal core is restricted to the host cores of its ideal core so it doesn't migrate between clusters
+         * @param idealCore The ideal guest CPU core of the thread or -1 if it has none
+         * @param affinityMask A mask of the guest CPU cores that the thread can run on
+         */
+        void UpdateCoreMask(i8 idealCore, u64 affinityMask);
+
+        /**
+         * @return The host cores that a thread with the supplied ideal core and affinity mask is restricted to
+         */
+        static cpu_set_t GetHostCores(i8 idealCore, u64 affinityMask);
+
+        /**
+         * @brief Yields the host core of the thread to other threads, this must be called while servicing an SVC of this thread
+         * @param migrate If the thread may be moved onto another core in its affinity mask, it stays unpinned till RestorePinning is called on its next SVC
+         */
+        void Yield(bool migrate);
+
+        /**
+         * @brief Pins the thread to the host cores of its ideal core again if it was unpinned by a yield with migration
+         */
+        void RestorePinning();
     };
 }
@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <android/sharedmem.h>
 #include <asm/unistd.h>
+#include <unistd.h>
 #include <nce.h>
 #include <os.h>
 #include "KTransferMemory.h"
@@ -11,44 +13,129 @@ namespace skyline::kernel::type {
         if (address && !util::PageAligned(address))
             throw exception("KTransferMemory was created with non-page-aligned address: 0x{:X}", address);
 
+        fd = CreateSharedMemory("KTransferMemory", size, resizable);
+
         BlockDescriptor block{
+            .address = address,
             .size = size,
             .permission = permission,
         };
         ChunkDescriptor chunk{
+            .address = address,
             .size = size,
             .state = memState,
             .blockList = {block},
         };
 
-        if (host) {
-            address = reinterpret_cast<u64>(mmap(reinterpret_cast<void *>(address), size, permission.Get(), MAP_ANONYMOUS | MAP_PRIVATE | ((address) ? MAP_FIXED : 0), -1, 0));
-            if (reinterpret_cast<void *>(address) == MAP_FAILED)
-                throw exception("An error occurred while mapping transfer memory in host");
+        Map(host, chunk);
+        this->address = chunk.address;
 
-            this->address = address;
-            chunk.address = address;
-            chunk.blockList.front().address = address;
+        if (host) {
             hostChunk = chunk;
+        } else {
+            CreateMirror(size);
+            chunk.host = mirror;
+            chunk.fd = fd;
+            state.os->memory.InsertChunk(chunk);
+        }
+    }
+
+    void KTransferMemory::Map(bool mHost, ChunkDescriptor &chunk) {
+        u64 mAddress;
+        if (mHost) {
+            auto pointer = mmap(reinterpret_cast<void *>(chunk.address), chunk.size, PROT_READ | PROT_WRITE, MAP_SHARED | ((chunk.address) ? MAP_FIXED : 0), fd, 0);
+            if (pointer == MAP_FAILED)
+                throw exception("An error occurred while mapping transfer memory in host: {}", strerror(errno));
+            mAddress = reinterpret_cast<u64>(pointer);
+        } else {
+            GuestSyscall map{.number = __NR_mmap, .arguments = {chunk.address, chunk.size, static_cast<u64>(PROT_READ | PROT_WRITE), static_cast<u64>(MAP_SHARED | ((chunk.address) ? MAP_FIXED : 0)), static_cast<u64>(fd)}};
+            state.nce->ExecuteSyscalls(std::span(&map, 1));
+            if (map.result < 0)
+                throw exception("An error occurred while mapping transfer memory in child process");
+            mAddress = static_cast<u64>(map.result);
+        }
+
+        // The permissions of all blocks are applied in a single round trip to the guest
+        std::vector<GuestSyscall> protect;
+        for (auto &block : chunk.blockList) {
+            block.address = mAddress + (block.address - chunk.address);
+            if (block.permission.Get() == (PROT_READ | PROT_WRITE))
+                continue;
+
+            if (mHost) {
+                if (mprotect(reinterpret_cast<void *>(block.address), block.size, block.permission.Get()) < 0)
+                    throw exception("An error occurred while updating transfer memory's permissions in host: {}", strerror(errno));
+            } else {
+                protect.push_back(GuestSyscall{.number = __NR_mprotect, .arguments = {block.address, block.size, static_cast<u64>(block.permission.Get())}});
+            }
+        }
+
+        if (!protect.empty()) {
+            state.nce->ExecuteSyscalls(protect);
+            for (const auto &syscall : protect)
+                if (syscall.result < 0)
+                    throw exception("An error occurred while updating transfer memory's permissions in guest");
+        }
+
+        chunk.address = mAddress;
+    }
+
+    void KTransferMemory::Unmap() {
+        if (host) {
+            if (munmap(reinterpret_cast<void *>(address), size) < 0)
+                throw exception("An error occurred while unmapping transfer memory in host: {}", strerror(errno));
         } else {
             Registers fregs{
                 .x0 = address,
                 .x1 = size,
-                .x2 = static_cast<u64 >(permission.Get()),
-                .x3 = static_cast<u64>(MAP_ANONYMOUS | MAP_PRIVATE | ((address) ? MAP_FIXED : 0)),
-                .x4 = static_cast<u64>(-1),
-                .x8 = __NR_mmap,
+                .x8 = __NR_munmap,
             };
 
             state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
             if (fregs.x0 < 0)
-                throw exception("An error occurred while mapping shared region in child process");
+                throw exception("An error occurred while unmapping transfer memory in child process");
 
-            this->address = fregs.x0;
-            chunk.address = fregs.x0;
-            chunk.blockList.front().address = fregs.x0;
+            state.os->memory.DeleteChunk(address);
+            ReleaseMirror();
+        }
+    }
 
-            state.os->memory.InsertChunk(chunk);
+    void KTransferMemory::ResizeBacking(size_t nSize) {
+        if (resizable) {
+            if (ftruncate(fd, static_cast<off_t>(nSize)) < 0)
+                throw exception("An error occurred while resizing shared memory: {}", strerror(errno));
+            return;
+        }
+
+        // Ashmem can't be resized, so the contents are copied into a new region through temporary host mappings
+        auto nFd = ASharedMemory_create("KTransferMemory", nSize);
+        if (nFd < 0)
+            throw exception("An error occurred while creating shared memory: {}", nFd);
+
+        auto source = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        auto destination = mmap(nullptr, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+        if (source == MAP_FAILED || destination == MAP_FAILED)
+            throw exception("An occurred while mapping shared memory: {}", strerror(errno));
+
+        std::memcpy(destination, source, std::min(size, nSize));
+        munmap(source, size);
+        munmap(destination, nSize);
+
+        close(fd);
+        fd = nFd;
+    }
+
+    void KTransferMemory::CreateMirror(size_t mSize) {
+        auto pointer = mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (pointer == MAP_FAILED)
+            throw exception("An occurred while mapping shared memory: {}", strerror(errno));
+        mirror = reinterpret_cast<u64>(pointer);
+    }
+
+    void KTransferMemory::ReleaseMirror() {
+        if (mirror) {
+            munmap(reinterpret_cast<void *>(mirror), size);
+            mirror = 0;
         }
     }
 
@@ -59,117 +146,71 @@ namespace skyline::kernel::type {
         nSize = nSize ? nSize : size;
 
         ChunkDescriptor chunk = host ? hostChunk : *state.os->memory.GetChunk(address);
+        for (auto &block : chunk.blockList)
+            block.address = nAddress + (block.address - address);
         chunk.address = nAddress;
-        chunk.size = nSize;
+        chunk.host = 0;
         MemoryManager::ResizeChunk(&chunk, nSize);
 
-        for (auto &block : chunk.blockList) {
-            block.address = nAddress + (block.address - address);
-
-            if ((mHost && !host) || (!mHost && !host)) {
-                Registers fregs{
-                    .x0 = block.address,
-                    .x1 = block.size,
-                    .x2 = (block.permission.w) ? static_cast<u64>(block.permission.Get()) : (PROT_READ | PROT_WRITE),
-                    .x3 = static_cast<u64>(MAP_ANONYMOUS | MAP_PRIVATE | ((nAddress) ? MAP_FIXED : 0)),
-                    .x4 = static_cast<u64>(-1),
-                    .x8 = __NR_mmap,
-                };
-
-                state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-                if (fregs.x0 < 0)
-                    throw exception("An error occurred while mapping transfer memory in child process");
-
-                nAddress = fregs.x0;
-            } else if ((!mHost && host) || (mHost && host)) {
-                nAddress = reinterpret_cast<u64>(mmap(reinterpret_cast<void *>(block.address), block.size, block.permission.Get(), MAP_ANONYMOUS | MAP_PRIVATE | ((nAddress) ? MAP_FIXED : 0), -1, 0));
-                if (reinterpret_cast<void *>(nAddress) == MAP_FAILED)
-                    throw exception("An error occurred while mapping transfer memory in host");
-            }
+        if (nSize > size)
+            ResizeBacking(nSize);
 
-            if (block.permission.r) {
-                if (mHost && !host)
-                    state.process->ReadMemory(reinterpret_cast<void *>(nAddress), address, block.size);
-                else if (!mHost && host)
-                    state.process->WriteMemory(reinterpret_cast<void *>(address), nAddress, block.size);
-                else if (!mHost && !host)
-                    state.process->CopyMemory(address, nAddress, block.size);
-                else if (mHost && host)
-                    std::memcpy(reinterpret_cast<void *>(nAddress), reinterpret_cast<void *>(address), block.size);
-            }
-            if (!block.permission.w) {
-                if (mHost) {
-                    if (mprotect(reinterpret_cast<void *>(block.address), block.size, block.permission.Get()) == reinterpret_cast<u64>(MAP_FAILED))
-                        throw exception("An error occurred while remapping transfer memory: {}", strerror(errno));
-                } else {
-                    Registers fregs{
-                        .x0 = block.address,
-                        .x1 = block.size,
-                        .x2 = static_cast<u64>(block.permission.Get()),
-                        .x8 = __NR_mprotect,
-                    };
-
-                    state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-                    if (fregs.x0 < 0)
-                        throw exception("An error occurred while updating transfer memory's permissions in guest");
-                }
-            }
-        }
+        // The same shared memory is mapped at the destination prior to the source being unmapped, so the contents carry over without being copied
+        Map(mHost, chunk);
+        Unmap();
 
-        if (mHost && !host) {
-            state.os->memory.DeleteChunk(address);
+        if (mHost) {
             hostChunk = chunk;
-        } else if (!mHost && host) {
-            state.os->memory.InsertChunk(chunk);
-        } else if (mHost && host) {
-            hostChunk = chunk;
-        } else if (!mHost && !host) {
-            state.os->memory.DeleteChunk(address);
+        } else {
+            CreateMirror(nSize);
+            chunk.host = mirror;
+            chunk.fd = fd;
             state.os->memory.InsertChunk(chunk);
         }
 
-        if ((mHost && !host) || (!mHost && !host)) {
-            Registers fregs{
-                .x0 = address,
-                .x1 = size,
-                .x8 = __NR_munmap,
-            };
-
-            state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-            if (fregs.x0 < 0)
-                throw exception("An error occurred while unmapping transfer memory in child process");
-        } else if ((!mHost && host) || (mHost && host)) {
-            if (reinterpret_cast<void *>(munmap(reinterpret_cast<void *>(address), size)) == MAP_FAILED)
-                throw exception("An error occurred while unmapping transfer memory in host: {}");
-        }
-
         host = mHost;
-        address = nAddress;
+        address = chunk.address;
         size = nSize;
         return address;
     }
 
     void KTransferMemory::Resize(size_t nSize) {
-        if (host) {
-            if (mremap(reinterpret_cast<void *>(address), size, nSize, 0) == MAP_FAILED)
-                throw exception("An error occurred while remapping transfer memory in host: {}", strerror(errno));
-        } else {
-            Registers fregs{
-                .x0 = address,
-                .x1 = size,
-                .x2 = nSize,
-                .x8 = __NR_mremap,
-            };
-
-            state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-            if (fregs.x0 < 0)
-                throw exception("An error occurred while remapping transfer memory in guest");
+        if (nSize > size)
+            ResizeBacking(nSize);
+
+        auto chunk = host ? &hostChunk : state.os->memory.GetChunk(address);
+        if (resizable || nSize <= size) {
+            // The mapping still refers to the same shared memory, so it only needs to be resized in place
+            if (host) {
+                if (mremap(reinterpret_cast<void *>(address), size, nSize, 0) == MAP_FAILED)
+                    throw exception("An error occurred while remapping transfer memory in host: {}", strerror(errno));
+            } else {
+                Registers fregs{
+                    .x0 = address,
+                    .x1 = size,
+                    .x2 = nSize,
+                    .x8 = __NR_mremap,
+                };
 
-            size = nSize;
+                state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
+                if (fregs.x0 < 0)
+                    throw exception("An error occurred while remapping transfer memory in guest");
+            }
+            MemoryManager::ResizeChunk(chunk, nSize);
+        } else {
+            // The ashmem backing was replaced while growing it, so it's mapped over the old mapping
+            MemoryManager::ResizeChunk(chunk, nSize);
+            Map(host, *chunk);
+        }
 
-            auto chunk = state.os->memory.GetChunk(address);
-            MemoryManager::ResizeChunk(chunk, size);
+        if (!host) {
+            ReleaseMirror();
+            CreateMirror(nSize);
+            chunk->host = mirror;
+            chunk->fd = fd;
         }
+
+        size = nSize;
     }
 
     void KTransferMemory::UpdatePermission(u64 address, u64 size, memory::Permission permission) {
@@ -202,21 +243,13 @@ namespace skyline::kernel::type {
     }
 
     KTransferMemory::~KTransferMemory() {
-        if (host) {
-            munmap(reinterpret_cast<void *>(address), size);
-        } else if (state.process) {
-            try {
-                Registers fregs{
-                    .x0 = address,
-                    .x1 = size,
-                    .x8 = __NR_munmap,
-                };
-
-                state.nce->ExecuteFunction(ThreadCall::Syscall, fregs);
-
-                state.os->memory.DeleteChunk(address);
-            } catch (const std::exception &) {
-            }
+        try {
+            if (host || state.process)
+                Unmap();
+        } catch (const std::exception &) {
         }
+
+        ReleaseMirror();
+        close(fd);
     }
 };
@@ -12,6 +12,38 @@ namespace skyline::kernel::type {
     class KTransferMemory : public KMemory {
       private:
         ChunkDescriptor hostChunk{};
+        int fd{-1}; //!< A file descriptor to the shared memory backing the memory, it's mapped wherever the memory is transferred to so the contents never have to be copied
+        bool resizable{}; //!< If the shared memory is a memfd which can be resized with ftruncate, this is false if it's ashmem which has a fixed size
+        u64 mirror{}; //!< The address of the host mirror of the guest mapping (0 if there is no mirror)
+
+        /**
+         * @brief Maps the shared memory at the address of the supplied chunk and applies the permissions of its blocks
+         * @param host If to map the memory on the host or the guest
+         * @param chunk The chunk to map, if its address is 0 then an arbitrary address is picked and the chunk is relocated to it
+         */
+        void Map(bool host, ChunkDescriptor &chunk);
+
+        /**
+         * @brief Unmaps the current mapping of the memory along with its host mirror
+         */
+        void Unmap();
+
+        /**
+         * @brief Grows the shared memory to the supplied size, this is only a copy if the shared memory is ashmem
+         * @note Existing mappings of ashmem still refer to the old shared memory, so they must be remapped
+         */
+        void ResizeBacking(size_t size);
+
+        /**
+         * @brief Maps the shared memory into the host so accesses to guest mappings from the kernel don't require any syscalls
+         */
+        void CreateMirror(size_t size);
+
+        /**
+         * @brief Unmaps the host mirror of the guest mapping
+         */
+        void ReleaseMirror();
+
       public:
         bool host; //!< If the memory is mapped on the host or the guest
         u64 address; //!< The current address of the allocated memory for the kernel
@@ -29,7 +61,7 @@ namespace skyline::kernel::type {
         KTransferMemory(const DeviceState &state, bool host, u64 address, size_t size, memory::Permission permission, memory::MemoryState memState = memory::states::TransferMemory);
 
         /**
-         * @brief Transfers this piece of memory to another process
+         * @brief Transfers this piece of memory to another process, the shared memory is remapped at the destination so none of the contents are copied
          * @param host If to transfer memory to host or guest
          * @param address The address to map to (If NULL an arbitrary address is picked)
          * @param size The amount of shared memory to map
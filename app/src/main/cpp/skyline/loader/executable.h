@@ -3,7 +3,7 @@
 
 #pragma once
 
-#include <common.h>
+#include <vfs/backing.h>
 
 namespace skyline::loader {
     /**
@@ -11,10 +11,15 @@ namespace skyline::loader {
      */
     struct Executable {
         /**
-         * @brief This holds the contents and offset of an executable segment
+         * @brief This holds the location of an executable segment in its backing and the offset it's loaded at
+         * @note The contents of a segment are read directly into its memory when the executable is loaded, so they're never buffered in their entirety
          */
         struct Segment {
-            std::vector<u8> contents; //!< The raw contents of the segment
+            std::shared_ptr<vfs::Backing> backing; //!< The backing that the segment is read from
+            size_t fileOffset; //!< The offset of the segment in the backing
+            size_t fileSize; //!< The size of the segment in the backing, this is the compressed size if the segment is compressed
+            size_t size; //!< The size of the contents of the segment in memory
+            bool compressed; //!< If the segment is LZ4 compressed in the backing
             size_t offset; //!< The offset from the base address to load the segment at
         };
 
@@ -23,5 +28,19 @@ namespace skyline::loader {
         Segment data; //!< The .data segment container
 
         size_t bssSize; //!< The size of the .bss segment
+
+        std::array<u8, 0x20> buildId{}; //!< The build ID of the executable, this is used to key the patch cache and is zero if the executable doesn't have one
+
+        /**
+         * @brief This holds the .rodata-relative offset and size of a section
+         */
+        struct RelativeExtent {
+            u32 offset;
+            u32 size; //!< The size of the section, it isn't present if this is 0
+        };
+
+        std::string name{"main"}; //!< The name of the executable, this is used to identify it in profiles
+        RelativeExtent dynstr{}; //!< The extent of the dynamic symbol string table in .rodata
+        RelativeExtent dynsym{}; //!< The extent of the dynamic symbol table in .rodata
     };
 }
@@ -1,48 +1,110 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <lz4.h>
 #include <nce.h>
 #include <os.h>
 #include <kernel/memory.h>
+#include <boot_report.h>
+#include <footprint.h>
 #include "loader.h"
 
 namespace skyline::loader {
-    Loader::ExecutableLoadInfo Loader::LoadExecutable(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state, Executable &executable, size_t offset) {
+    void Loader::ReadSegment(const Executable::Segment &segment, std::span<u8> output) {
+        boot::ScopedPhase phase(boot::Phase::NsoDecompress);
+
+        if (output.size() < segment.size)
+            throw exception("Segment doesn't fit into its memory: 0x{:X} > 0x{:X}", segment.size, output.size());
+
+        if (!segment.compressed) {
+            segment.backing->Read(output.data(), segment.fileOffset, segment.size);
+            return;
+        }
+
+        // The compressed contents are only buffered when the backing can't be accessed directly, they're decompressed directly into the memory of the segment
+        auto input{segment.backing->GetSpan(segment.fileOffset, segment.fileSize)};
+        std::vector<u8> compressed;
+        if (input.empty()) {
+            compressed.resize(segment.fileSize);
+            segment.backing->Read(compressed.data(), segment.fileOffset, segment.fileSize);
+            input = compressed;
+        }
+
+        auto result = LZ4_decompress_safe(reinterpret_cast<const char *>(input.data()), reinterpret_cast<char *>(output.data()), static_cast<int>(segment.fileSize), static_cast<int>(segment.size));
+        if (result != static_cast<int>(segment.size))
+            throw exception("Failed to decompress segment: 0x{:X} bytes were decompressed out of 0x{:X}", result, segment.size);
+    }
+
+    Loader::ExecutableLoadInfo Loader::LoadExecutable(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state, Executable &executable, size_t offset, std::vector<std::future<void>> *pending) {
         u64 base = constant::BaseAddress + offset;
 
-        u64 textSize = executable.text.contents.size();
-        u64 roSize = executable.ro.contents.size();
-        u64 dataSize = executable.data.contents.size() + executable.bssSize;
+        u64 textSize = util::AlignUp(executable.text.size, PAGE_SIZE);
+        u64 roSize = util::AlignUp(executable.ro.size, PAGE_SIZE);
+        u64 dataSize = util::AlignUp(executable.data.size, PAGE_SIZE) + executable.bssSize;
 
-        if (!util::PageAligned(textSize) || !util::PageAligned(roSize) || !util::PageAligned(dataSize))
-            throw exception("LoadProcessData: Sections are not aligned with page size: 0x{:X}, 0x{:X}, 0x{:X}", textSize, roSize, dataSize);
+        if (!util::PageAligned(dataSize))
+            throw exception("LoadProcessData: .bss is not aligned with page size: 0x{:X}", executable.bssSize);
 
         if (!util::PageAligned(executable.text.offset) || !util::PageAligned(executable.ro.offset) || !util::PageAligned(executable.data.offset))
             throw exception("LoadProcessData: Section offsets are not aligned with page size: 0x{:X}, 0x{:X}, 0x{:X}", executable.text.offset, executable.ro.offset, executable.data.offset);
 
+        // The host mapping of every section is written to directly, the memory is zero-filled so any padding and .bss don't need to be cleared
+        auto getHost = [&](u64 address, u64 size) {
+            return std::span(reinterpret_cast<u8 *>(state.os->memory.GetChunk(address)->host), size);
+        };
+
+        {
+            boot::ScopedPhase phase(boot::Phase::MemoryMapping);
+            process->NewHandle<kernel::type::KPrivateMemory>(base + executable.text.offset, textSize, memory::Permission{true, false, true}, memory::states::CodeStatic); // R-X
+            state.logger->Debug("Successfully mapped section .text @ 0x{0:X}, Size = 0x{1:X}", base + executable.text.offset, textSize);
+
+            process->NewHandle<kernel::type::KPrivateMemory>(base + executable.ro.offset, roSize, memory::Permission{true, false, false}, memory::states::CodeReadOnly); // R--
+            state.logger->Debug("Successfully mapped section .rodata @ 0x{0:X}, Size = 0x{1:X}", base + executable.ro.offset, roSize);
+
+            process->NewHandle<kernel::type::KPrivateMemory>(base + executable.data.offset, dataSize, memory::Permission{true, true, false}, memory::states::CodeMutable); // RW-
+            state.logger->Debug("Successfully mapped section .data @ 0x{0:X}, Size = 0x{1:X}", base + executable.data.offset, dataSize);
+        }
+
+        // .rodata and .data aren't required for patching, so they're read concurrently with .text (and any executables loaded after this one when they're pending)
+        std::vector<std::future<void>> reads;
+        auto &readQueue = pending ? *pending : reads;
+        readQueue.push_back(std::async(std::launch::async, ReadSegment, executable.ro, getHost(base + executable.ro.offset, roSize)));
+        readQueue.push_back(std::async(std::launch::async, ReadSegment, executable.data, getHost(base + executable.data.offset, dataSize)));
+
+        auto text = getHost(base + executable.text.offset, textSize);
+        ReadSegment(executable.text, text);
+
         // The data section will always be the last section in memory, so put the patch section after it
         u64 patchOffset = executable.data.offset + dataSize;
-        std::vector<u32> patch = state.nce->PatchCode(executable.text.contents, base, patchOffset);
+        std::vector<u32> patch;
+        {
+            boot::ScopedPhase phase(boot::Phase::PatchCode);
+            patch = state.nce->PatchCode(text, base, patchOffset, executable.buildId);
+        }
 
         u64 patchSize = patch.size() * sizeof(u32);
         u64 padding = util::AlignUp(patchSize, PAGE_SIZE) - patchSize;
 
-        process->NewHandle<kernel::type::KPrivateMemory>(base + executable.text.offset, textSize, memory::Permission{true, false, true}, memory::states::CodeStatic); // R-X
-        state.logger->Debug("Successfully mapped section .text @ 0x{0:X}, Size = 0x{1:X}", base + executable.text.offset, textSize);
-
-        process->NewHandle<kernel::type::KPrivateMemory>(base + executable.ro.offset, roSize, memory::Permission{true, false, false}, memory::states::CodeReadOnly); // R--
-        state.logger->Debug("Successfully mapped section .rodata @ 0x{0:X}, Size = 0x{1:X}", base + executable.ro.offset, roSize);
-
-        process->NewHandle<kernel::type::KPrivateMemory>(base + executable.data.offset, dataSize, memory::Permission{true, true, false}, memory::states::CodeMutable); // RW-
-        state.logger->Debug("Successfully mapped section .data @ 0x{0:X}, Size = 0x{1:X}", base + executable.data.offset, dataSize);
-
         process->NewHandle<kernel::type::KPrivateMemory>(base + patchOffset, patchSize + padding, memory::Permission{true, true, true}, memory::states::CodeMutable); // RWX
+        std::memcpy(getHost(base + patchOffset, patchSize).data(), patch.data(), patchSize);
+        footprint::Add(footprint::Subsystem::Patch, patchSize + padding); // The patch section lives as long as the executable, this is only removed when a module loaded by ldr:ro is unloaded
         state.logger->Debug("Successfully mapped section .patch @ 0x{0:X}, Size = 0x{1:X}", base + patchOffset, patchSize + padding);
 
-        process->WriteMemory(executable.text.contents.data(), base + executable.text.offset, textSize);
-        process->WriteMemory(executable.ro.contents.data(), base + executable.ro.offset, roSize);
-        process->WriteMemory(executable.data.contents.data(), base + executable.data.offset, dataSize - executable.bssSize);
-        process->WriteMemory(patch.data(), base + patchOffset, patchSize);
+        // Executables loaded at runtime by ldr:ro are tracked alongside those loaded by LoadProcessData, so they're always added to the loader in the device state
+        u64 roBase{base + executable.ro.offset};
+        state.loader->modules.push_back(Module{
+            .name = executable.name,
+            .base = base,
+            .patchOffset = patchOffset,
+            .size = patchOffset + patchSize + padding,
+            .dynstr = roBase + executable.dynstr.offset,
+            .dynstrSize = executable.dynstr.size,
+            .dynsym = roBase + executable.dynsym.offset,
+            .dynsymSize = executable.dynsym.size,
+        });
+
+        for (auto &read : reads)
+            read.get();
 
         return {base, patchOffset + patchSize + padding};
     }
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <future>
 #include <vfs/backing.h>
 #include <vfs/nacp.h>
 #include "executable.h"
@@ -30,7 +31,8 @@ namespace skyline::loader {
         MissingHeaderKey,
         MissingTitleKey,
         MissingTitleKek,
-        MissingKeyArea
+        MissingKeyArea,
+        IntegrityError,
     };
 
     /**
@@ -43,11 +45,33 @@ namespace skyline::loader {
         loader_exception(LoaderResult error, const std::string &message = "No message") : exception("Loader exception {}: {}", error, message), error(error) {}
     };
 
+    /**
+     * @brief This describes an executable that has been loaded into guest memory
+     */
+    struct Module {
+        std::string name; //!< The name of the executable
+        u64 base; //!< The address of the start of the executable
+        u64 patchOffset; //!< The offset of the patch section from the base, everything after this is code generated by the NCE
+        u64 size; //!< The total size of the executable including its patch section
+        u64 dynstr; //!< The address of the dynamic symbol string table
+        u64 dynstrSize; //!< The size of the dynamic symbol string table, the executable has no dynamic symbols if this is 0
+        u64 dynsym; //!< The address of the dynamic symbol table
+        u64 dynsymSize; //!< The size of the dynamic symbol table
+    };
+
     /**
      * @brief The Loader class provides an abstract interface for ROM loaders
      */
     class Loader {
       protected:
+        /**
+         * @brief This reads the contents of a segment from its backing into memory, decompressing it if needed
+         * @param segment The segment to read
+         * @param output The memory to write the contents to, this must be at least as large as the segment
+         */
+        static void ReadSegment(const Executable::Segment &segment, std::span<u8> output);
+
+      public:
         /**
          * @brief This contains information about the placement of an executable in memory
          */
@@ -61,13 +85,16 @@ namespace skyline::loader {
          * @param process The process to load the executable into
          * @param executable The executable itself
          * @param offset The offset from the base address that the executable should be placed at
+         * @param pending If this isn't null, .rodata and .data are read asynchronously and their futures are appended to this, otherwise they're read before returning
          * @return An ExecutableLoadInfo struct containing the load base and size
+         * @note .text is always read before returning as it needs to be patched, that determines the size of the executable
+         * @note This is also used by ldr:ro to load modules at runtime, the executable is added to the modules of the loader in the device state in either case
          */
-        static ExecutableLoadInfo LoadExecutable(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state, Executable &executable, size_t offset = 0);
+        static ExecutableLoadInfo LoadExecutable(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state, Executable &executable, size_t offset = 0, std::vector<std::future<void>> *pending = nullptr);
 
-      public:
         std::shared_ptr<vfs::NACP> nacp; //!< The NACP of the current application
         std::shared_ptr<vfs::Backing> romFs; //!< The RomFS of the current application
+        std::vector<Module> modules; //!< The executables that have been loaded by LoadProcessData and ldr:ro in the order they were loaded
 
         virtual ~Loader() = default;
 
@@ -4,11 +4,12 @@
 #include <nce.h>
 #include <os.h>
 #include <kernel/memory.h>
+#include <vfs/npdm.h>
 #include "nso.h"
 #include "nca.h"
 
 namespace skyline::loader {
-    NcaLoader::NcaLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) : nca(backing, keyStore) {
+    NcaLoader::NcaLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache, bool verifyIntegrity) : nca(backing, keyStore, cache, "nca", std::nullopt, verifyIntegrity) {
         if (nca.exeFs == nullptr)
             throw exception("Only NCAs with an ExeFS can be loaded directly");
     }
@@ -21,7 +22,28 @@ namespace skyline::loader {
         if (nsoFile == nullptr)
             throw exception("Cannot load an ExeFS that doesn't contain rtld");
 
-        auto loadInfo = NsoLoader::LoadNso(nsoFile, process, state);
+        // The NPDM is checked prior to loading anything as AArch32 applications can't be executed at all, NCE only runs AArch64 code natively
+        auto addressSpaceType{memory::AddressSpaceType::AddressSpace39Bit};
+        if (auto npdmFile{exeFs->OpenFile("main.npdm")}) {
+            vfs::NPDM npdm(npdmFile);
+            if (!npdm.Is64Bit())
+                throw exception("Cannot load an AArch32 application as only AArch64 code can be executed");
+
+            switch (npdm.GetProcessAddressSpace()) {
+                case vfs::NPDM::ProcessAddressSpace::AddressSpace64BitOld:
+                    addressSpaceType = memory::AddressSpaceType::AddressSpace36Bit;
+                    break;
+                case vfs::NPDM::ProcessAddressSpace::AddressSpace64Bit:
+                    addressSpaceType = memory::AddressSpaceType::AddressSpace39Bit;
+                    break;
+                default:
+                    throw exception("Cannot load an application with a 32-bit address space");
+            }
+        }
+
+        // Only the placement and patching of each NSO are sequential, the rest of their segments are read in the background while the following NSOs are loaded
+        std::vector<std::future<void>> pending;
+        auto loadInfo = NsoLoader::LoadNso(nsoFile, process, state, 0, &pending, "rtld");
         u64 offset = loadInfo.size;
         u64 base = loadInfo.base;
 
@@ -33,12 +55,15 @@ namespace skyline::loader {
             if (nsoFile == nullptr)
                 continue;
 
-            loadInfo = NsoLoader::LoadNso(nsoFile, process, state, offset);
+            loadInfo = NsoLoader::LoadNso(nsoFile, process, state, offset, &pending, nso);
             state.logger->Info("Loaded nso '{}' at 0x{:X}", nso, base + offset);
             offset += loadInfo.size;
         }
 
-        state.os->memory.InitializeRegions(base, offset, memory::AddressSpaceType::AddressSpace39Bit);
+        for (auto &read : pending)
+            read.get();
+
+        state.os->memory.InitializeRegions(base, offset, addressSpaceType);
     }
 
     void NcaLoader::LoadProcessData(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state) {
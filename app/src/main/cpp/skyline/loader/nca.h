@@ -17,7 +17,11 @@ namespace skyline::loader {
         vfs::NCA nca; //!< The backing NCA of the loader
 
       public:
-        NcaLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
+        /**
+         * @param cache A metadata cache for the NCA, this is optional
+         * @param verifyIntegrity If the contents of the NCA are verified against their hashes as they're read
+         */
+        NcaLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache = nullptr, bool verifyIntegrity = false);
 
         /**
          * @brief This loads an ExeFS into memory
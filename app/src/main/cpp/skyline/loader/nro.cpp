@@ -22,6 +22,11 @@ namespace skyline::loader {
             if (assetHeader.magic != util::MakeMagic<u32>("ASET"))
                 throw exception("Invalid ASET magic! 0x{0:X}", assetHeader.magic);
 
+            // The asset sections are served straight out of the mapping of the NRO, so they can't be allowed to extend past the end of it
+            for (const auto &section : {assetHeader.icon, assetHeader.nacp, assetHeader.romFs})
+                if (section.offset > backing->size || section.size > backing->size - section.offset || header.size > backing->size - section.offset - section.size)
+                    throw exception("NRO asset section at 0x{:X} with size 0x{:X} is outside of the file", header.size + section.offset, section.size);
+
             NroAssetSection &nacpHeader = assetHeader.nacp;
             nacp = std::make_shared<vfs::NACP>(std::make_shared<vfs::RegionBacking>(backing, header.size + nacpHeader.offset, nacpHeader.size));
 
@@ -32,32 +37,38 @@ namespace skyline::loader {
 
     std::vector<u8> NroLoader::GetIcon() {
         NroAssetSection &segmentHeader = assetHeader.icon;
+        auto span{backing->GetSpan(header.size + segmentHeader.offset, segmentHeader.size)};
+        if (!span.empty())
+            return {span.begin(), span.end()};
+
         std::vector<u8> buffer(segmentHeader.size);
 
         backing->Read(buffer.data(), header.size + segmentHeader.offset, segmentHeader.size);
         return buffer;
     }
 
-    std::vector<u8> NroLoader::GetSegment(const NroSegmentHeader &segment) {
-        std::vector<u8> buffer(segment.size);
-
-        backing->Read(buffer.data(), segment.offset, segment.size);
-        return buffer;
+    Executable::Segment NroLoader::GetSegment(const NroSegmentHeader &segment, size_t offset) {
+        return Executable::Segment{
+            .backing = backing,
+            .fileOffset = segment.offset,
+            .fileSize = segment.size,
+            .size = segment.size,
+            .offset = offset,
+        };
     }
 
     void NroLoader::LoadProcessData(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state) {
         Executable nroExecutable{};
 
-        nroExecutable.text.contents = GetSegment(header.text);
-        nroExecutable.text.offset = 0;
-
-        nroExecutable.ro.contents = GetSegment(header.ro);
-        nroExecutable.ro.offset = header.text.size;
-
-        nroExecutable.data.contents = GetSegment(header.data);
-        nroExecutable.data.offset = header.text.size + header.ro.size;
+        nroExecutable.text = GetSegment(header.text, 0);
+        nroExecutable.ro = GetSegment(header.ro, header.text.size);
+        nroExecutable.data = GetSegment(header.data, header.text.size + header.ro.size);
 
         nroExecutable.bssSize = header.bssSize;
+        std::memcpy(nroExecutable.buildId.data(), header.buildId, sizeof(header.buildId));
+
+        nroExecutable.dynstr = {header.dynstr.offset, header.dynstr.size};
+        nroExecutable.dynsym = {header.dynsym.offset, header.dynsym.size};
 
         auto loadInfo = LoadExecutable(process, state, nroExecutable);
         state.os->memory.InitializeRegions(loadInfo.base, loadInfo.size, memory::AddressSpaceType::AddressSpace39Bit);
@@ -11,7 +11,7 @@ namespace skyline::loader {
      * @brief The NroLoader class abstracts access to an NRO file through the Loader interface (https://switchbrew.org/wiki/NRO)
      */
     class NroLoader : public Loader {
-      private:
+      public:
         /**
          * @brief This holds a single data segment's offset and size
          */
@@ -45,7 +45,11 @@ namespace skyline::loader {
             NroSegmentHeader apiInfo; //!< The .apiInfo segment header
             NroSegmentHeader dynstr; //!< The .dynstr segment header
             NroSegmentHeader dynsym; //!< The .dynsym segment header
-        } header{};
+        };
+        static_assert(sizeof(NroHeader) == 0x80);
+
+      private:
+        NroHeader header{};
 
         /**
          * @brief This holds a single asset section's offset and size
@@ -69,11 +73,11 @@ namespace skyline::loader {
         std::shared_ptr<vfs::Backing> backing; //!< The backing of the NRO loader
 
         /**
-         * @brief This reads the data of the specified segment
-         * @param segment The header of the segment to read
-         * @return A buffer containing the data of the requested segment
+         * @param segment The header of the segment
+         * @param offset The offset from the base address to load the segment at
+         * @return A segment which describes where the contents of the segment are in the backing
          */
-        std::vector<u8> GetSegment(const NroSegmentHeader &segment);
+        Executable::Segment GetSegment(const NroSegmentHeader &segment, size_t offset);
 
       public:
         NroLoader(const std::shared_ptr<vfs::Backing> &backing);
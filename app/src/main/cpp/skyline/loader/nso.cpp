@@ -1,7 +1,6 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
-#include <lz4.h>
 #include <nce.h>
 #include <os.h>
 #include <kernel/memory.h>
@@ -16,22 +15,18 @@ namespace skyline::loader {
             throw exception("Invalid NSO magic! 0x{0:X}", magic);
     }
 
-    std::vector<u8> NsoLoader::GetSegment(const std::shared_ptr<vfs::Backing> &backing, const NsoSegmentHeader &segment, u32 compressedSize) {
-        std::vector<u8> outputBuffer(segment.decompressedSize);
-
-        if (compressedSize) {
-            std::vector<u8> compressedBuffer(compressedSize);
-            backing->Read(compressedBuffer.data(), segment.fileOffset, compressedSize);
-
-            LZ4_decompress_safe(reinterpret_cast<char *>(compressedBuffer.data()), reinterpret_cast<char *>(outputBuffer.data()), compressedSize, segment.decompressedSize);
-        } else {
-            backing->Read(outputBuffer.data(), segment.fileOffset, segment.decompressedSize);
-        }
-
-        return outputBuffer;
+    Executable::Segment NsoLoader::GetSegment(const std::shared_ptr<vfs::Backing> &backing, const NsoSegmentHeader &segment, u32 compressedSize) {
+        return Executable::Segment{
+            .backing = backing,
+            .fileOffset = segment.fileOffset,
+            .fileSize = compressedSize ? compressedSize : segment.decompressedSize,
+            .size = segment.decompressedSize,
+            .compressed = compressedSize != 0,
+            .offset = segment.memoryOffset,
+        };
     }
 
-    Loader::ExecutableLoadInfo NsoLoader::LoadNso(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state, size_t offset) {
+    Loader::ExecutableLoadInfo NsoLoader::LoadNso(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state, size_t offset, std::vector<std::future<void>> *pending, std::string_view name) {
         NsoHeader header{};
         backing->Read(&header);
 
@@ -40,21 +35,18 @@ namespace skyline::loader {
 
         Executable nsoExecutable{};
 
-        nsoExecutable.text.contents = GetSegment(backing, header.text, header.flags.textCompressed ? header.textCompressedSize : 0);
-        nsoExecutable.text.contents.resize(util::AlignUp(nsoExecutable.text.contents.size(), PAGE_SIZE));
-        nsoExecutable.text.offset = header.text.memoryOffset;
-
-        nsoExecutable.ro.contents = GetSegment(backing, header.ro, header.flags.textCompressed ? header.textCompressedSize : 0);
-        nsoExecutable.ro.contents.resize(util::AlignUp(nsoExecutable.ro.contents.size(), PAGE_SIZE));
-        nsoExecutable.ro.offset = header.ro.memoryOffset;
-
-        nsoExecutable.data.contents = GetSegment(backing, header.data, header.flags.textCompressed ? header.textCompressedSize : 0);
-        nsoExecutable.data.contents.resize(util::AlignUp(nsoExecutable.data.contents.size(), PAGE_SIZE));
-        nsoExecutable.data.offset = header.data.memoryOffset;
+        nsoExecutable.text = GetSegment(backing, header.text, header.flags.textCompressed ? header.textCompressedSize : 0);
+        nsoExecutable.ro = GetSegment(backing, header.ro, header.flags.roCompressed ? header.roCompressedSize : 0);
+        nsoExecutable.data = GetSegment(backing, header.data, header.flags.dataCompressed ? header.dataCompressedSize : 0);
 
         nsoExecutable.bssSize = util::AlignUp(header.bssSize, PAGE_SIZE);
+        std::memcpy(nsoExecutable.buildId.data(), header.buildId, sizeof(header.buildId));
+
+        nsoExecutable.name = name;
+        nsoExecutable.dynstr = {header.dynstr.offset, header.dynstr.size};
+        nsoExecutable.dynsym = {header.dynsym.offset, header.dynsym.size};
 
-        return LoadExecutable(process, state, nsoExecutable, offset);
+        return LoadExecutable(process, state, nsoExecutable, offset, pending);
     }
 
     void NsoLoader::LoadProcessData(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state) {
@@ -35,6 +35,15 @@ namespace skyline::loader {
         };
         static_assert(sizeof(NsoSegmentHeader) == 0xC);
 
+        /**
+         * @brief This holds the .rodata-relative offset and size of a section
+         */
+        struct NsoRelativeExtent {
+            u32 offset; //!< The .rodata-relative offset of the section
+            u32 size; //!< The size of the section
+        };
+        static_assert(sizeof(NsoRelativeExtent) == 0x8);
+
         /**
          * @brief This holds the header of an NSO file
          */
@@ -59,9 +68,9 @@ namespace skyline::loader {
 
             u32 _pad1_[7];
 
-            u64 apiInfo; //!< The .rodata-relative offset of .apiInfo
-            u64 dynstr; //!< The .rodata-relative offset of .dynstr
-            u64 dynsym; //!< The .rodata-relative offset of .dynsym
+            NsoRelativeExtent apiInfo; //!< The .rodata-relative extent of .apiInfo
+            NsoRelativeExtent dynstr; //!< The .rodata-relative extent of .dynstr
+            NsoRelativeExtent dynsym; //!< The .rodata-relative extent of .dynsym
 
             u64 segmentHashes[3][4]; //!< The SHA256 checksums of the .text, .rodata and .data segments
         };
@@ -70,12 +79,11 @@ namespace skyline::loader {
         std::shared_ptr<vfs::Backing> backing; //!< The backing of the NSO loader
 
         /**
-         * @brief This reads the specified segment from the backing and decompresses it if needed
-         * @param segment The header of the segment to read
+         * @param segment The header of the segment
          * @param compressedSize The compressed size of the segment, 0 if the segment is not compressed
-         * @return A buffer containing the data of the requested segment
+         * @return A segment which describes where the contents of the segment are in the backing
          */
-        static std::vector<u8> GetSegment(const std::shared_ptr<vfs::Backing> &backing, const NsoSegmentHeader &segment, u32 compressedSize);
+        static Executable::Segment GetSegment(const std::shared_ptr<vfs::Backing> &backing, const NsoSegmentHeader &segment, u32 compressedSize);
 
       public:
         NsoLoader(const std::shared_ptr<vfs::Backing> &backing);
@@ -85,9 +93,11 @@ namespace skyline::loader {
          * @param backing The backing of the NSO
          * @param process The process to load the NSO into
          * @param offset The offset from the base address to place the NSO
+         * @param pending If this isn't null, the segments that aren't needed for patching are read asynchronously and their futures are appended to this
+         * @param name The name of the NSO in its ExeFS
          * @return An ExecutableLoadInfo struct containing the load base and size
          */
-        static ExecutableLoadInfo LoadNso(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state, size_t offset = 0);
+        static ExecutableLoadInfo LoadNso(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state, size_t offset = 0, std::vector<std::future<void>> *pending = nullptr, std::string_view name = "main");
 
         void LoadProcessData(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state);
     };
@@ -5,20 +5,33 @@
 #include "nsp.h"
 
 namespace skyline::loader {
-    NspLoader::NspLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) : nsp(std::make_shared<vfs::PartitionFileSystem>(backing)) {
+    /**
+     * @return If the name of a file in an NSP is that of an NCA, NSZs hold NCZs in place of some NCAs
+     */
+    static bool IsNcaName(const std::string &name) {
+        auto extension{name.substr(name.find_last_of(".") + 1)};
+        return extension == "nca" || extension == "ncz";
+    }
+
+    NspLoader::NspLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache, bool verifyIntegrity) : NspLoader(std::make_shared<vfs::PartitionFileSystem>(backing, cache, "nsp"), keyStore, cache, verifyIntegrity) {}
+
+    NspLoader::NspLoader(std::shared_ptr<vfs::PartitionFileSystem> partition, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache, bool verifyIntegrity) : nsp(std::move(partition)) {
         auto root{nsp->OpenDirectory("", {false, true})};
+        std::string controlName; // The name of the control NCA, this is used as the prefix for its RomFS in the metadata cache
 
         for (const auto &entry : root->Read()) {
-            if (entry.name.substr(entry.name.find_last_of(".") + 1) != "nca")
+            if (!IsNcaName(entry.name))
                 continue;
 
             try {
-                auto nca{vfs::NCA(nsp->OpenFile(entry.name), keyStore)};
+                auto nca{vfs::NCA(nsp->OpenFile(entry.name), keyStore, cache, entry.name, std::nullopt, verifyIntegrity)};
 
-                if (nca.contentType == vfs::NcaContentType::Program && nca.romFs != nullptr && nca.exeFs != nullptr)
+                if (nca.contentType == vfs::NcaContentType::Program && nca.romFs != nullptr && nca.exeFs != nullptr) {
                     programNca = std::move(nca);
-                else if (nca.contentType == vfs::NcaContentType::Control && nca.romFs != nullptr)
+                } else if (nca.contentType == vfs::NcaContentType::Control && nca.romFs != nullptr) {
                     controlNca = std::move(nca);
+                    controlName = entry.name;
+                }
             } catch (const loader_exception &e) {
                 throw loader_exception(e.error);
             } catch (const std::exception &e) {
@@ -30,18 +43,63 @@ namespace skyline::loader {
             throw exception("Incomplete NSP file");
 
         romFs = programNca->romFs;
-        controlRomFs = std::make_shared<vfs::RomFileSystem>(controlNca->romFs);
+        controlRomFs = std::make_shared<vfs::RomFileSystem>(controlNca->romFs, cache, controlName + "/romfs");
         nacp = std::make_shared<vfs::NACP>(controlRomFs->OpenFile("control.nacp"));
     }
 
-    void NspLoader::LoadProcessData(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state) {
-        NcaLoader::LoadExeFs(programNca->exeFs, process, state);
+    void NspLoader::ApplyUpdate(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) {
+        auto updateNsp{std::make_shared<vfs::PartitionFileSystem>(backing)};
+        auto root{updateNsp->OpenDirectory("", {false, true})};
+
+        std::optional<vfs::NCA> patchNca, patchControlNca;
+        for (const auto &entry : root->Read()) {
+            if (!IsNcaName(entry.name))
+                continue;
+
+            try {
+                auto nca{vfs::NCA(updateNsp->OpenFile(entry.name), keyStore)};
+
+                if (nca.contentType == vfs::NcaContentType::Program && nca.IsPatch() && nca.exeFs != nullptr)
+                    patchNca = std::move(nca);
+                else if (nca.contentType == vfs::NcaContentType::Control && nca.romFs != nullptr)
+                    patchControlNca = std::move(nca);
+            } catch (const loader_exception &e) {
+                throw loader_exception(e.error);
+            } catch (const std::exception &e) {
+                continue;
+            }
+        }
+
+        if (!patchNca)
+            throw exception("The update doesn't contain a patch program NCA");
+
+        // The program ID of an update is always that of its application with 0x800 added
+        if (patchNca->programId != (programNca->programId | 0x800))
+            throw exception("The update is for 0x{:016X} rather than 0x{:016X}", patchNca->programId & ~0x800ULL, programNca->programId);
+
+        auto patchedRomFs{patchNca->CreatePatchedRomFs(*programNca)};
+        std::shared_ptr<vfs::RomFileSystem> patchControlRomFs;
+        std::shared_ptr<vfs::NACP> patchNacp;
+        if (patchControlNca) {
+            patchControlRomFs = std::make_shared<vfs::RomFileSystem>(patchControlNca->romFs);
+            patchNacp = std::make_shared<vfs::NACP>(patchControlRomFs->OpenFile("control.nacp"));
+        }
+
+        update = std::move(updateNsp);
+        updateProgramNca = std::move(patchNca);
+        romFs = std::move(patchedRomFs);
+        if (patchControlNca) {
+            updateControlNca = std::move(patchControlNca);
+            controlRomFs = std::move(patchControlRomFs);
+            nacp = std::move(patchNacp);
+        }
     }
 
-    std::vector<u8> NspLoader::GetIcon() {
-        if (romFs == nullptr)
-            return std::vector<u8>();
+    void NspLoader::LoadProcessData(const std::shared_ptr<kernel::type::KProcess> process, const DeviceState &state) {
+        NcaLoader::LoadExeFs(updateProgramNca ? updateProgramNca->exeFs : programNca->exeFs, process, state);
+    }
 
+    std::vector<u8> NspLoader::ReadIcon(const std::shared_ptr<vfs::RomFileSystem> &controlRomFs) {
         auto root{controlRomFs->OpenDirectory("", {false, true})};
         std::shared_ptr<vfs::Backing> icon;
 
@@ -61,4 +119,69 @@ namespace skyline::loader {
         icon->Read(buffer.data(), 0, icon->size);
         return buffer;
     }
+
+    std::pair<std::shared_ptr<vfs::NACP>, std::vector<u8>> NspLoader::ReadMetadata(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache) {
+        return ReadMetadata(std::make_shared<vfs::PartitionFileSystem>(backing, cache, "nsp"), keyStore, cache);
+    }
+
+    std::pair<std::shared_ptr<vfs::NACP>, std::vector<u8>> NspLoader::ReadMetadata(const std::shared_ptr<vfs::PartitionFileSystem> &nsp, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache) {
+        auto root{nsp->OpenDirectory("", {false, true})};
+
+        bool hasProgram{};
+        std::shared_ptr<vfs::RomFileSystem> controlRomFs;
+        for (const auto &entry : root->Read()) {
+            if (!IsNcaName(entry.name))
+                continue;
+
+            try {
+                // Only the control NCA has its sections parsed, every other NCA only has its header decrypted to determine its content type
+                vfs::NCA nca(nsp->OpenFile(entry.name), keyStore, cache, entry.name, vfs::NcaContentType::Control);
+
+                if (nca.contentType == vfs::NcaContentType::Program)
+                    hasProgram = true;
+                else if (nca.contentType == vfs::NcaContentType::Control && nca.romFs != nullptr)
+                    controlRomFs = std::make_shared<vfs::RomFileSystem>(nca.romFs, cache, entry.name + "/romfs");
+            } catch (const loader_exception &e) {
+                throw loader_exception(e.error);
+            } catch (const std::exception &e) {
+                continue;
+            }
+        }
+
+        if (!hasProgram || !controlRomFs)
+            throw exception("Incomplete NSP file");
+
+        return {std::make_shared<vfs::NACP>(controlRomFs->OpenFile("control.nacp")), ReadIcon(controlRomFs)};
+    }
+
+    bool NspLoader::Verify(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) {
+        return Verify(std::make_shared<vfs::PartitionFileSystem>(backing), keyStore);
+    }
+
+    bool NspLoader::Verify(const std::shared_ptr<vfs::PartitionFileSystem> &nsp, const std::shared_ptr<crypto::KeyStore> &keyStore) {
+        auto root{nsp->OpenDirectory("", {false, true})};
+
+        for (const auto &entry : root->Read()) {
+            if (!IsNcaName(entry.name))
+                continue;
+
+            try {
+                if (!vfs::NCA(nsp->OpenFile(entry.name), keyStore).Verify())
+                    return false;
+            } catch (const loader_exception &e) {
+                throw;
+            } catch (const std::exception &e) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::vector<u8> NspLoader::GetIcon() {
+        if (romFs == nullptr)
+            return std::vector<u8>();
+
+        return ReadIcon(controlRomFs);
+    }
 }
@@ -20,9 +20,56 @@ namespace skyline::loader {
         std::shared_ptr<vfs::RomFileSystem> controlRomFs; //!< A pointer to the control NCA's RomFS
         std::optional<vfs::NCA> programNca; //!< The main program NCA within the NSP
         std::optional<vfs::NCA> controlNca; //!< The main control NCA within the NSP
+        std::shared_ptr<vfs::PartitionFileSystem> update; //!< A shared pointer to the PFS0 of the update NSP, if one was applied
+        std::optional<vfs::NCA> updateProgramNca; //!< The patch program NCA within the update NSP, its ExeFS replaces that of the main program NCA
+        std::optional<vfs::NCA> updateControlNca; //!< The control NCA within the update NSP
+
+        /**
+         * @return The contents of the first icon in the RomFS of a control NCA, this is empty if there are no icons
+         */
+        static std::vector<u8> ReadIcon(const std::shared_ptr<vfs::RomFileSystem> &controlRomFs);
+
+      protected:
+        /**
+         * @param partition The partition filesystem holding the NCAs of the application, this is the PFS0 of an NSP or the secure partition of an XCI
+         */
+        NspLoader(std::shared_ptr<vfs::PartitionFileSystem> partition, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache, bool verifyIntegrity);
+
+        /**
+         * @brief Reads the NACP and icon of the application in a partition filesystem holding its NCAs
+         */
+        static std::pair<std::shared_ptr<vfs::NACP>, std::vector<u8>> ReadMetadata(const std::shared_ptr<vfs::PartitionFileSystem> &nsp, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache);
+
+        /**
+         * @brief Verifies the entire contents of every NCA in a partition filesystem against their hashes
+         */
+        static bool Verify(const std::shared_ptr<vfs::PartitionFileSystem> &nsp, const std::shared_ptr<crypto::KeyStore> &keyStore);
 
       public:
-        NspLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
+        /**
+         * @param cache A metadata cache for the NSP, this is optional
+         * @param verifyIntegrity If the contents of the NCAs are verified against their hashes as they're read
+         */
+        NspLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache = nullptr, bool verifyIntegrity = false);
+
+        /**
+         * @brief Reads the NACP and icon of an NSP without constructing a loader for it, only the RomFS of the control NCA and the headers of the other NCAs are parsed
+         * @param cache A metadata cache for the NSP, this is optional
+         * @return The NACP and the icon of the NSP, the icon is empty if there are none
+         */
+        static std::pair<std::shared_ptr<vfs::NACP>, std::vector<u8>> ReadMetadata(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache = nullptr);
+
+        /**
+         * @brief Verifies the entire contents of every NCA in an NSP against their hashes
+         * @return If all NCAs match their hashes
+         */
+        static bool Verify(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
+
+        /**
+         * @brief Applies an update NSP over the application, its RomFS is patched over the RomFS of the application and its ExeFS and NACP replace those of the application
+         * @note The loader is left unchanged if the update can't be applied
+         */
+        void ApplyUpdate(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
 
         std::vector<u8> GetIcon();
 
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <vfs/region_backing.h>
+#include "xci.h"
+
+namespace skyline::loader {
+    std::shared_ptr<vfs::PartitionFileSystem> XciLoader::OpenSecurePartition(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<vfs::MetadataCache> &cache) {
+        // Dumps that include the key area of the gamecard have it prepended to the header, all offsets in the header are relative to the header in that case
+        GamecardHeader header{};
+        size_t headerOffset{};
+        for (auto offset : {size_t{}, size_t{0x1000}}) {
+            if (backing->Read(&header, offset) == sizeof(GamecardHeader) && header.magic == util::MakeMagic<u32>("HEAD")) {
+                headerOffset = offset;
+                break;
+            }
+            header.magic = 0;
+        }
+
+        if (header.magic != util::MakeMagic<u32>("HEAD"))
+            throw exception("Invalid XCI header magic");
+
+        size_t rootOffset{headerOffset + header.partitionFsHeaderAddress};
+        if (rootOffset >= backing->size)
+            throw exception("The root partition of the XCI is outside of it: 0x{:X}", rootOffset);
+
+        auto root{std::make_shared<vfs::PartitionFileSystem>(std::make_shared<vfs::RegionBacking>(backing, rootOffset, backing->size - rootOffset), cache, "xci/root")};
+        auto secure{root->OpenFile("secure")};
+        if (!secure)
+            throw exception("The XCI doesn't contain a secure partition");
+
+        return std::make_shared<vfs::PartitionFileSystem>(secure, cache, "xci/secure");
+    }
+
+    XciLoader::XciLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache, bool verifyIntegrity) : NspLoader(OpenSecurePartition(backing, cache), keyStore, cache, verifyIntegrity) {}
+
+    std::pair<std::shared_ptr<vfs::NACP>, std::vector<u8>> XciLoader::ReadMetadata(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache) {
+        return NspLoader::ReadMetadata(OpenSecurePartition(backing, cache), keyStore, cache);
+    }
+
+    bool XciLoader::Verify(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) {
+        return NspLoader::Verify(OpenSecurePartition(backing), keyStore);
+    }
+}
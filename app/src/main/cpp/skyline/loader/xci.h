@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "nsp.h"
+
+namespace skyline::loader {
+    /**
+     * @brief The XciLoader class loads an application from the secure partition of a gamecard image (https://switchbrew.org/wiki/XCI)
+     * @note The secure partition holds the same NCAs as an NSP of the application, they're read in place out of the XCI through regions of its backing
+     */
+    class XciLoader : public NspLoader {
+      private:
+        /**
+         * @brief The header of a gamecard image, the encrypted gamecard info at its end isn't used
+         */
+        struct GamecardHeader {
+            std::array<u8, 0x100> signature; //!< An RSA-2048 PKCS #1 signature over the header
+            u32 magic; //!< The magic of the header: 'HEAD'
+            u32 secureAreaStartAddress; //!< The start of the secure area in units of 0x200 bytes
+            u32 backupAreaStartAddress; //!< This is always 0xFFFFFFFF
+            u8 titleKeyDecIndex; //!< The index of the key used to decrypt the title key
+            u8 romSize; //!< The size of the gamecard
+            u8 version; //!< The version of the header
+            u8 flags; //!< The flags of the gamecard
+            u64 packageId; //!< The ID of the gamecard package
+            u64 validDataEndAddress; //!< The end of the valid data in units of 0x200 bytes
+            std::array<u8, 0x10> iv; //!< The IV of the encrypted gamecard info, this is stored in reverse
+            u64 partitionFsHeaderAddress; //!< The offset of the root HFS0 partition
+            u64 partitionFsHeaderSize; //!< The size of the header of the root HFS0 partition
+            std::array<u8, 0x20> partitionFsHeaderHash; //!< A SHA-256 hash of the header of the root HFS0 partition
+            std::array<u8, 0x20> initialDataHash; //!< A SHA-256 hash of the initial data
+            u32 selSec; //!< The security mode of the gamecard
+            u32 selT1Key; //!< The index of the T1 key
+            u32 selKey; //!< The index of the key
+            u32 limAreaPage; //!< The end of the normal area in units of 0x200 bytes
+            std::array<u8, 0x70> encryptedGamecardInfo; //!< The encrypted gamecard info
+        };
+        static_assert(sizeof(GamecardHeader) == 0x200);
+
+      public:
+        /**
+         * @return The secure partition of an XCI, this holds the NCAs of the application
+         * @param cache A metadata cache for the XCI, this is optional
+         */
+        static std::shared_ptr<vfs::PartitionFileSystem> OpenSecurePartition(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<vfs::MetadataCache> &cache = nullptr);
+
+        /**
+         * @param cache A metadata cache for the XCI, this is optional
+         * @param verifyIntegrity If the contents of the NCAs are verified against their hashes as they're read
+         */
+        XciLoader(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache = nullptr, bool verifyIntegrity = false);
+
+        /**
+         * @brief Reads the NACP and icon of an XCI without constructing a loader for it, only the RomFS of the control NCA and the headers of the other NCAs are parsed
+         * @param cache A metadata cache for the XCI, this is optional
+         * @return The NACP and the icon of the XCI, the icon is empty if there are none
+         */
+        static std::pair<std::shared_ptr<vfs::NACP>, std::vector<u8>> ReadMetadata(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<vfs::MetadataCache> &cache = nullptr);
+
+        /**
+         * @brief Verifies the entire contents of every NCA in the secure partition of an XCI against their hashes
+         * @return If all NCAs match their hashes
+         */
+        static bool Verify(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
+    };
+}
@@ -2,132 +2,436 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <sched.h>
+#include <sys/prctl.h>
+#include <asm/unistd.h>
 #include <unistd.h>
+#include <arm_neon.h>
 #include "os.h"
 #include "jvm.h"
 #include "nce/guest.h"
 #include "nce/instructions.h"
 #include "kernel/svc.h"
+#include "vfs/os_filesystem.h"
 #include "nce.h"
+#include "profiler.h"
+#include "perf_stats.h"
+#include "thread_priority.h"
+#include "headless.h"
+#include "gpu/surface_gate.h"
 
 extern bool Halt;
-extern jobject Surface;
-extern skyline::GroupMutex JniMtx;
+extern skyline::SharedMutex JniMtx;
 
 namespace skyline {
-    void NCE::KernelThread(pid_t thread) {
+    /**
+     * @brief This blocks the calling thread till the state of a guest thread satisfies the supplied predicate
+     * @param ctx The ThreadContext of the guest thread
+     * @param predicate A function which returns true when the supplied state is the one being waited for
+     * @param timeout The maximum amount of time to sleep for (nullptr means an infinite timeout)
+     * @return If the predicate was satisfied, this is false only if the timeout expired
+     */
+    template<typename Predicate>
+    bool WaitContextState(volatile ThreadContext *ctx, Predicate predicate, const timespec *timeout = nullptr) {
+        for (u32 spin{}; spin < constant::StateSpinCount; spin++) {
+            if (predicate(GetThreadState(ctx)))
+                return true;
+            asm volatile("yield");
+        }
+
+        while (true) {
+            u32 word = LoadAcquire(&ctx->futex);
+            if (predicate(static_cast<ThreadState>(word & 0xFF)))
+                return true;
+            if (FutexSyscall(&ctx->futex, FUTEX_WAIT, word, timeout) == -ETIMEDOUT)
+                return predicate(GetThreadState(ctx));
+        }
+    }
+
+    /**
+     * @brief Pops a request off the kernel queue
+     * @param tid The TID of the guest thread that pushed the request is written to this
+     * @return If a request was popped, this is false if the queue is empty or the request at its start is still being written
+     */
+    bool PopKernelRequest(KernelQueue *queue, pid_t &tid) {
+        auto position = __atomic_load_n(&queue->start, __ATOMIC_RELAXED);
+        while (true) {
+            auto &slot = queue->slots[position & (constant::KernelQueueSlots - 1)];
+            auto difference = static_cast<i32>(__atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE) - (position + 1));
+            if (difference == 0) {
+                if (__atomic_compare_exchange_n(&queue->start, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    tid = static_cast<pid_t>(slot.tid);
+                    __atomic_store_n(&slot.sequence, position + constant::KernelQueueSlots, __ATOMIC_RELEASE); // This frees up the slot for the next lap
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = __atomic_load_n(&queue->start, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    /**
+     * @return If an SVC can block for an unbounded amount of time, a kernel worker calling these isn't counted as available for the duration of the call
+     */
+    constexpr bool IsBlockingSvc(u16 svc) {
+        switch (svc) {
+            case 0x0B: // svcSleepThread
+            case 0x18: // svcWaitSynchronization
+            case 0x1A: // svcArbitrateLock
+            case 0x1C: // svcWaitProcessWideKeyAtomic
+            case 0x21: // svcSendSyncRequest, services can wait on other guest threads (Such as with nvhost syncpoints)
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * @return If an SVC borrows handles without referencing them, this excludes SVCs that can wait indefinitely on the guest as they'd hold back the destruction of every closed object
+     */
+    constexpr bool IsBorrowingSvc(u16 svc) {
+        return !IsBlockingSvc(svc);
+    }
+
+    NCE::NCE(DeviceState &state) : state(state), workerTarget(std::max(std::thread::hardware_concurrency(), 1U)) {
+        // The queue is mapped as shared prior to the guest process being cloned from this one so it's inherited at the same address
+        auto address = mmap(nullptr, util::AlignUp(sizeof(KernelQueue), PAGE_SIZE), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (address == MAP_FAILED)
+            throw exception("Failed to map the kernel queue: {}", strerror(errno));
+
+        queue = new(address) KernelQueue{};
+        for (u32 index = 0; index < constant::KernelQueueSlots; index++)
+            queue->slots[index].sequence = index;
+
+        // The fault table covers the entire guest address space but only the parts of it that have pages with flags on them are ever backed by memory
+        address = mmap(nullptr, sizeof(FaultTable), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (address == MAP_FAILED)
+            throw exception("Failed to map the fault table: {}", strerror(errno));
+        faultTable = reinterpret_cast<FaultTable *>(address);
+
+        if (state.settings->Get().deterministicScheduling) {
+            scheduler.emplace();
+            state.logger->Info("Guest threads are scheduled deterministically on a single virtual core");
+        }
+    }
+
+    NCE::~NCE() {
+        // Workers are detached as surplus ones exit on their own, all of them exit once Halt is set
+        while (workerCount.load(std::memory_order_acquire))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        munmap(queue, util::AlignUp(sizeof(KernelQueue), PAGE_SIZE));
+        munmap(faultTable, sizeof(FaultTable));
+    }
+
+    void NCE::SpawnWorker() {
+        workerCount.fetch_add(1, std::memory_order_relaxed);
+        availableWorkers.fetch_add(1, std::memory_order_relaxed);
+        std::thread(&NCE::KernelWorker, this).detach();
+    }
+
+    void NCE::KernelWorker() {
         state.jvm->AttachThread();
-        try {
-            state.thread = state.process->threads.at(thread);
-            state.ctx = reinterpret_cast<ThreadContext *>(state.thread->ctxMemory->kernel.address);
+        priority::Hints.AddThread(); // SVCs are serviced on workers so they're on the critical path of every frame
+        prctl(PR_SET_TIMERSLACK, 1); // Guest sleeps are done by workers, the default timer slack of 50us would be added to every one of them
 
-            while (true) {
-                asm("yield");
+        constexpr timespec PollTimeout{.tv_nsec = 100000000}; // The kernel queue is waited on for a maximum of 100ms so Halt is checked periodically
 
-                if (__predict_false(Halt))
-                    break;
-                if (__predict_false(!Surface))
-                    continue;
+        while (!Halt) {
+            pid_t tid;
+            if (!WaitKernelRequest(tid, &PollTimeout))
+                continue;
+
+            // Requests are held while there's no Surface, this pauses the guest at its next SVC till the activity is in the foreground again
+            gpu::HostSurface.Wait();
+
+            if (__predict_false(Halt) || HandleKernelRequest(tid))
+                break;
+        }
+
+        state.thread = nullptr;
+        state.ctx = nullptr;
+        state.jvm->DetachThread();
+        priority::Hints.RemoveThread();
+
+        workerCount.fetch_sub(1, std::memory_order_release);
+    }
+
+    bool NCE::WaitKernelRequest(pid_t &tid, const timespec *timeout) {
+        for (u32 spin{}; spin < constant::StateSpinCount; spin++) {
+            if (PopKernelRequest(queue, tid))
+                return true;
+            asm volatile("yield");
+        }
+
+        while (true) {
+            // The doorbell is read prior to popping, any request pushed after a failed pop changes it so the wait returns immediately
+            auto doorbell = __atomic_load_n(&queue->doorbell, __ATOMIC_ACQUIRE);
+            if (PopKernelRequest(queue, tid))
+                return true;
+
+            __atomic_fetch_add(&queue->sleepers, 1, __ATOMIC_SEQ_CST);
+            auto result = FutexSyscall(&queue->doorbell, FUTEX_WAIT, doorbell, timeout);
+            __atomic_fetch_sub(&queue->sleepers, 1, __ATOMIC_SEQ_CST);
+
+            if (result == -ETIMEDOUT)
+                return PopKernelRequest(queue, tid);
+        }
+    }
+
+    bool NCE::PauseWorkers(std::chrono::nanoseconds timeout) {
+        return pauseMutex.try_lock_for(timeout);
+    }
 
-                if (state.ctx->state == ThreadState::WaitKernel) {
-                    std::lock_guard jniGd(JniMtx);
+    void NCE::ResumeWorkers() {
+        pauseMutex.unlock();
+    }
 
-                    if (__predict_false(Halt))
-                        break;
-                    if (__predict_false(!Surface))
-                        continue;
+    bool NCE::HandleKernelRequest(pid_t tid) {
+        bool retire{};
+        std::shared_lock pauseLock(pauseMutex);
+
+        // The context of a thread that's killed while it's being serviced is still written to, so it's only released once the worker is done with it
+        std::shared_ptr<kernel::type::KThread> serviced;
+        auto finish{[&serviced] {
+            if (serviced) {
+                serviced->inKernel = false;
+                if (serviced->status == kernel::type::KThread::Status::Dead)
+                    serviced->Release();
+            }
+        }};
 
-                    auto svc = state.ctx->svc;
+        try {
+            // Consecutive requests on a worker are often from the same thread, the thread map is only looked up when it changes or the TID could've been reused by a new thread
+            if (!state.thread || state.thread->tid != tid || state.thread->status == kernel::type::KThread::Status::Dead)
+                state.thread = state.process->GetThread(tid);
+
+            serviced = state.thread;
+            serviced->inKernel = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (serviced->status == kernel::type::KThread::Status::Dead) {
+                // A request that was pushed by a thread prior to it being killed is dropped as its context might've already been released
+                serviced->inKernel = false;
+                serviced.reset();
+                if (scheduler)
+                    scheduler->Release(tid);
+                return retire;
+            }
 
-                    try {
-                        if (kernel::svc::SvcTable[svc]) {
-                            state.logger->Debug("SVC called 0x{:X}", svc);
+            state.ctx = reinterpret_cast<ThreadContext *>(state.thread->ctxMemory->kernel.address);
+
+            auto threadState{GetThreadState(state.ctx)};
+            if (threadState == ThreadState::WaitKernel) {
+                auto svc = state.ctx->svc;
+
+                // A thread that yielded with migration ran unpinned since, so the host scheduler could move it onto another core of its affinity mask
+                state.thread->RestorePinning();
+
+                try {
+                    if (!kernel::svc::SvcTable[svc])
+                        throw exception("Unimplemented SVC 0x{:X}", svc);
+
+                    LOGD(state.logger, "SVC called 0x{:X}", svc);
+                    TRACE("SVC 0x{:X} called by {}", svc, tid);
+                    TRACE_SECTION(kernel::svc::SvcNames[svc]);
+                    std::optional<kernel::HandleTable::BorrowScope> borrowScope;
+                    if (IsBorrowingSvc(svc))
+                        borrowScope.emplace(state.process->handles);
+
+                    if (IsBlockingSvc(svc)) {
+                        // The core is handed over for the duration of every blocking SVC even if it wouldn't block, whether it does depends on the timing of other threads
+                        if (scheduler)
+                            scheduler->Release(tid);
+
+                        // A blocked worker can't service any other requests, another one is started if this was the last available one as the SVC could be waiting on a request queued behind it
+                        if (availableWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                            SpawnWorker();
+
+                        // A worker waiting on other guest threads doesn't hold back a pause as they can't make progress till it's over, services still do as they write into guest memory when they return
+                        bool releasePause{svc != 0x21};
+                        if (releasePause)
+                            pauseLock.unlock();
+                        try {
+                            auto start{util::GetTimeNs()};
                             (*kernel::svc::SvcTable[svc])(state);
-                        } else {
-                            throw exception("Unimplemented SVC 0x{:X}", svc);
+                            state.profiler->RecordSvc(svc, util::GetTimeNs() - start);
+                        } catch (...) {
+                            if (releasePause)
+                                pauseLock.lock();
+                            availableWorkers.fetch_add(1, std::memory_order_acq_rel);
+                            throw;
+                        }
+                        if (releasePause)
+                            pauseLock.lock();
+
+                        // Workers that are surplus to the target exit once they return from blocking, so the amount of workers converges back to the target
+                        if (availableWorkers.fetch_add(1, std::memory_order_acq_rel) >= workerTarget) {
+                            availableWorkers.fetch_sub(1, std::memory_order_acq_rel);
+                            retire = true;
                         }
-                    } catch (const std::exception &e) {
-                        throw exception("{} (SVC: 0x{:X})", e.what(), svc);
+                    } else {
+                        auto start{util::GetTimeNs()};
+                        (*kernel::svc::SvcTable[svc])(state);
+                        auto time{util::GetTimeNs() - start};
+                        state.profiler->RecordSvc(svc, time);
+                        perf::Monitor.AddTime(perf::Timer::Svc, time);
                     }
+                } catch (const std::exception &e) {
+                    throw exception("{} (SVC: 0x{:X})", e.what(), svc);
+                }
 
-                    state.ctx->state = ThreadState::WaitRun;
-                } else if (__predict_false(state.ctx->state == ThreadState::GuestCrash)) {
-                    state.logger->Warn("Thread with PID {} has crashed due to signal: {}", thread, strsignal(state.ctx->svc));
-                    ThreadTrace();
+                // A thread which exited or was killed during the SVC isn't resumed, its context is released after this
+                if (state.thread->status == kernel::type::KThread::Status::Dead) {
+                    if (scheduler)
+                        scheduler->Release(tid);
+                } else if (!scheduler) {
+                    SetThreadState(state.ctx, ThreadState::WaitRun);
+                } else {
+                    scheduler->Resume(state.thread);
+                }
+            } else if (__predict_false(threadState == ThreadState::GuestCrash)) {
+                if (state.ctx->signal == SIGSEGV) {
+                    // A texture region is made writable in its entirety, so any buffer pages on it lose their write tracking as well
+                    auto region = state.gpu->textureCache.HandleFault(state.ctx->faultAddress);
+                    if (region)
+                        state.gpu->bufferCache.Invalidate(region->address, region->size);
+                    else
+                        region = state.gpu->bufferCache.HandleWriteFault(state.ctx->faultAddress);
+
+                    if (region) {
+                        // The region is restored to the permissions of the blocks it spans rather than being made RW, so tracking an executable or read-only mapping doesn't change what the guest can do with it
+                        u32 count{};
+                        u64 end{region->address + region->size};
+                        for (u64 address{region->address}; address < end;) {
+                            auto descriptor{state.os->memory.Get(address)};
+                            u64 runEnd{descriptor ? std::min(end, descriptor->block.address + descriptor->block.size) : end};
+                            auto protection{static_cast<u64>(descriptor ? descriptor->block.permission.Get() : PROT_READ | PROT_WRITE)};
+
+                            auto previous{count ? &state.ctx->syscalls[count - 1] : nullptr};
+                            if (previous && previous->arguments[2] == protection) {
+                                previous->arguments[1] = runEnd - previous->arguments[0];
+                            } else if (count == constant::SyscallBatchSize) {
+                                // A region spanning more blocks than fit into a batch has its remainder restored with the protection of the last batched block
+                                previous->arguments[1] = end - previous->arguments[0];
+                                break;
+                            } else {
+                                state.ctx->syscalls[count++] = GuestSyscall{.number = __NR_mprotect, .arguments = {address, runEnd - address, protection}};
+                            }
+                            address = runEnd;
+                        }
+                        state.ctx->syscallCount = count;
 
-                    state.ctx->state = ThreadState::WaitRun;
-                    break;
+                        SetThreadState(state.ctx, ThreadState::Running);
+                        finish();
+                        return retire;
+                    }
                 }
+
+                state.logger->Warn("Thread with PID {} has crashed due to signal: {}", tid, strsignal(state.ctx->svc));
+                ThreadTrace();
+                state.logger->Flush(); // The crash is written out prior to the thread being killed as it could take the process down with it
+
+                SetThreadState(state.ctx, ThreadState::WaitRun);
+                KillGuestThread(tid);
             }
         } catch (const std::exception &e) {
             state.logger->Error(e.what());
+            state.logger->Flush();
+            KillGuestThread(tid);
         } catch (...) {
             state.logger->Error("An unknown exception has occurred");
+            state.logger->Flush();
+            KillGuestThread(tid);
         }
 
-        if (!Halt) {
-            if (thread == state.process->pid) {
-                JniMtx.lock(GroupMutex::Group::Group2);
+        finish();
+        return retire;
+    }
 
-                state.os->KillThread(thread);
-                Halt = true;
+    void NCE::KillGuestThread(pid_t tid) {
+        if (Halt)
+            return;
 
-                JniMtx.unlock();
-            } else {
-                state.os->KillThread(thread);
-            }
-        }
+        if (scheduler)
+            scheduler->Release(tid);
 
-        state.jvm->DetachThread();
-    }
+        if (tid == state.process->pid) {
+            JniMtx.lock();
 
-    NCE::NCE(DeviceState &state) : state(state) {}
+            state.os->KillThread(tid);
+            Halt = true;
 
-    NCE::~NCE() {
-        for (auto &thread : threadMap)
-            thread.second->join();
+            JniMtx.unlock();
+            gpu::HostSurface.Notify();
+        } else {
+            state.os->KillThread(tid);
+        }
     }
 
     void NCE::Execute() {
+        for (u32 worker = 0; worker < workerTarget; worker++)
+            SpawnWorker();
+
+        // A headless run with a duration is halted once it has elapsed, this is checked alongside Halt
+        auto deadline{headless::HeadlessOptions.runDuration ? util::GetTimeNs() + (static_cast<u64>(headless::HeadlessOptions.runDuration) * constant::NsInSecond) : std::numeric_limits<u64>::max()};
+
         try {
             while (true) {
-                std::lock_guard guard(JniMtx);
+                gpu::HostSurface.Wait(); // This is done without holding JniMtx as the Surface is updated while holding it exclusively
+                std::shared_lock guard(JniMtx);
                 if (Halt)
                     break;
+                if (util::GetTimeNs() >= deadline) [[unlikely]] {
+                    state.logger->Info("Halting emulation as the headless run duration has elapsed");
+                    break;
+                }
                 state.gpu->Loop();
             }
         } catch (const std::exception &e) {
             state.logger->Error(e.what());
+            state.logger->Flush();
         } catch (...) {
             state.logger->Error("An unknown exception has occurred");
+            state.logger->Flush();
         }
 
         if (!Halt) {
-            JniMtx.lock(GroupMutex::Group::Group2);
+            JniMtx.lock();
             Halt = true;
             JniMtx.unlock();
+            gpu::HostSurface.Notify();
         }
     }
 
     /**
-     * This function will not work if optimizations are enabled as ThreadContext isn't volatile
-     * and due to that is not read on every iteration of the while loop.
-     * However, making ThreadContext or parts of it volatile slows down the applications as a whole.
-     * So, we opted to use the hacky solution and disable optimizations for this single function.
+     * @return If a guest thread is in a state where it can run a function
      */
-    void ExecuteFunctionCtx(ThreadCall call, Registers &funcRegs, ThreadContext *ctx) __attribute__ ((optnone)) {
-        ctx->threadCall = call;
-        Registers registers = ctx->registers;
+    constexpr bool FunctionReady(ThreadState threadState) {
+        return threadState == ThreadState::WaitInit || threadState == ThreadState::WaitKernel;
+    }
+
+    /**
+     * @note The ThreadContext is accessed as volatile as it's concurrently modified by the guest, the registers are ordered against the state by its release stores and acquire loads
+     */
+    void ExecuteFunctionCtx(ThreadCall call, Registers &funcRegs, volatile ThreadContext *ctx) {
+        WaitContextState(ctx, FunctionReady);
 
-        while (ctx->state != ThreadState::WaitInit && ctx->state != ThreadState::WaitKernel);
+        Registers registers;
+        for (u8 index = 0; index < 30; index++) {
+            registers.regs[index] = ctx->registers.regs[index];
+            ctx->registers.regs[index] = funcRegs.regs[index];
+        }
 
-        ctx->registers = funcRegs;
-        ctx->state = ThreadState::WaitFunc;
+        ctx->threadCall = call;
+        SetThreadState(ctx, ThreadState::WaitFunc);
 
-        while (ctx->state != ThreadState::WaitInit && ctx->state != ThreadState::WaitKernel);
+        WaitContextState(ctx, FunctionReady);
 
-        funcRegs = ctx->registers;
-        ctx->registers = registers;
+        for (u8 index = 0; index < 30; index++) {
+            funcRegs.regs[index] = ctx->registers.regs[index];
+            ctx->registers.regs[index] = registers.regs[index];
+        }
     }
 
     void NCE::ExecuteFunction(ThreadCall call, Registers &funcRegs, std::shared_ptr<kernel::type::KThread> &thread) {
@@ -138,26 +442,106 @@ namespace skyline {
         if (state.process->status == kernel::type::KProcess::Status::Exiting)
             throw exception("Executing function on Exiting process");
 
-        auto thread = state.thread ? state.thread : state.process->threads.at(state.process->pid);
+        auto thread = state.thread ? state.thread : state.process->GetThread(state.process->pid);
         ExecuteFunctionCtx(call, funcRegs, reinterpret_cast<ThreadContext *>(thread->ctxMemory->kernel.address));
     }
 
+    void NCE::ExecuteSyscalls(std::span<GuestSyscall> syscalls) {
+        if (state.process->status == kernel::type::KProcess::Status::Exiting)
+            throw exception("Executing syscalls on Exiting process");
+
+        auto thread = state.thread ? state.thread : state.process->GetThread(state.process->pid);
+        auto ctx = reinterpret_cast<volatile ThreadContext *>(thread->ctxMemory->kernel.address);
+
+        for (size_t offset{}; offset < syscalls.size(); offset += constant::SyscallBatchSize) {
+            auto batch = syscalls.subspan(offset, std::min(syscalls.size() - offset, static_cast<size_t>(constant::SyscallBatchSize)));
+
+            WaitContextState(ctx, FunctionReady);
+
+            for (size_t index{}; index < batch.size(); index++) {
+                auto &syscall = ctx->syscalls[index];
+                syscall.number = batch[index].number;
+                for (u8 argument = 0; argument < 6; argument++)
+                    syscall.arguments[argument] = batch[index].arguments[argument];
+                syscall.result = -ECANCELED;
+            }
+            ctx->syscallCount = static_cast<u32>(batch.size());
+            ctx->threadCall = ThreadCall::SyscallBatch;
+
+            std::atomic_thread_fence(std::memory_order_release);
+            SetThreadState(ctx, ThreadState::WaitFunc);
+
+            WaitContextState(ctx, FunctionReady);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            bool failed{};
+            for (size_t index{}; index < batch.size(); index++)
+                failed |= (batch[index].result = ctx->syscalls[index].result) < 0;
+
+            if (failed) {
+                for (auto &syscall : syscalls.subspan(offset + batch.size()))
+                    syscall.result = -ECANCELED;
+                return;
+            }
+        }
+    }
+
     void NCE::WaitThreadInit(std::shared_ptr<kernel::type::KThread> &thread) __attribute__ ((optnone)) {
         auto ctx = reinterpret_cast<ThreadContext *>(thread->ctxMemory->kernel.address);
-        while (ctx->state == ThreadState::NotReady);
+        WaitThreadState(ctx, ThreadState::NotReady);
     }
 
     void NCE::StartThread(u64 entryArg, u32 handle, std::shared_ptr<kernel::type::KThread> &thread) {
         auto ctx = reinterpret_cast<ThreadContext *>(thread->ctxMemory->kernel.address);
-        while (ctx->state != ThreadState::WaitInit);
+        WaitContextState(ctx, [](ThreadState threadState) {
+            return threadState == ThreadState::WaitInit;
+        });
 
         ctx->tpidrroEl0 = thread->tls;
         ctx->registers.x0 = entryArg;
         ctx->registers.x1 = handle;
-        ctx->state = ThreadState::WaitRun;
+        ctx->kernelQueue = queue;
+        ctx->faultTable = faultTable;
+        ctx->tid = static_cast<u32>(thread->tid);
+
+        state.logger->Debug("Starting guest thread: {}", thread->tid);
+        if (scheduler)
+            scheduler->Resume(thread);
+        else
+            SetThreadState(ctx, ThreadState::WaitRun);
+    }
+
+    static_assert(constant::FaultTablePageSize == PAGE_SIZE);
+
+    void NCE::SetFaultFlags(u64 address, u64 size, u8 flags) {
+        auto end{std::min(util::AlignUp(address + size, PAGE_SIZE), constant::FaultTableAddressSpace)};
+        for (auto page{util::AlignDown(address, PAGE_SIZE)}; page < end; page += PAGE_SIZE)
+            __atomic_fetch_or(&faultTable->pages[page / PAGE_SIZE], flags, __ATOMIC_RELEASE);
+    }
+
+    void NCE::ClearFaultFlags(u64 address, u64 size, u8 flags) {
+        auto end{std::min(util::AlignUp(address + size, PAGE_SIZE), constant::FaultTableAddressSpace)};
+        for (auto page{util::AlignDown(address, PAGE_SIZE)}; page < end; page += PAGE_SIZE)
+            __atomic_fetch_and(&faultTable->pages[page / PAGE_SIZE], static_cast<u8>(~flags), __ATOMIC_RELEASE);
+    }
+
+    bool NCE::HasFaultFlags(u64 address, u64 size, u8 flags) {
+        auto end{std::min(util::AlignUp(address + size, PAGE_SIZE), constant::FaultTableAddressSpace)};
+        for (auto page{util::AlignDown(address, PAGE_SIZE)}; page < end; page += PAGE_SIZE)
+            if (__atomic_load_n(&faultTable->pages[page / PAGE_SIZE], __ATOMIC_ACQUIRE) & flags)
+                return true;
+        return false;
+    }
+
+    bool NCE::CollectDirtyPage(u64 address) {
+        if (address >= constant::FaultTableAddressSpace)
+            return false;
 
-        state.logger->Debug("Starting kernel thread for guest thread: {}", thread->tid);
-        threadMap[thread->tid] = std::make_shared<std::thread>(&NCE::KernelThread, this, thread->tid);
+        // The flag is checked prior to clearing it as most pages aren't dirty, this avoids an atomic RMW on them
+        auto &page{faultTable->pages[address / PAGE_SIZE]};
+        if (!(__atomic_load_n(&page, __ATOMIC_ACQUIRE) & FaultTable::Dirty))
+            return false;
+        return __atomic_fetch_and(&page, static_cast<u8>(~FaultTable::Dirty), __ATOMIC_ACQ_REL) & FaultTable::Dirty;
     }
 
     void NCE::ThreadTrace(u16 numHist, ThreadContext *ctx) {
@@ -209,207 +593,491 @@ namespace skyline {
         }
     }
 
-    std::vector<u32> NCE::PatchCode(std::vector<u8> &code, u64 baseAddress, i64 offset) {
-        constexpr u32 TpidrEl0 = 0x5E82;      // ID of TPIDR_EL0 in MRS
-        constexpr u32 TpidrroEl0 = 0x5E83;    // ID of TPIDRRO_EL0 in MRS
-        constexpr u32 CntfrqEl0 = 0x5F00;     // ID of CNTFRQ_EL0 in MRS
-        constexpr u32 CntpctEl0 = 0x5F01;     // ID of CNTPCT_EL0 in MRS
-        constexpr u32 CntvctEl0 = 0x5F02;     // ID of CNTVCT_EL0 in MRS
-        constexpr u32 TegraX1Freq = 19200000; // The clock frequency of the Tegra X1 (19.2 MHz)
+    constexpr u32 TpidrEl0 = 0x5E82;      // ID of TPIDR_EL0 in MRS
+    constexpr u32 TpidrroEl0 = 0x5E83;    // ID of TPIDRRO_EL0 in MRS
+    constexpr u32 CntfrqEl0 = 0x5F00;     // ID of CNTFRQ_EL0 in MRS
+    constexpr u32 CntpctEl0 = 0x5F01;     // ID of CNTPCT_EL0 in MRS
+    constexpr u32 CntvctEl0 = 0x5F02;     // ID of CNTVCT_EL0 in MRS
+    constexpr u16 GetSystemTickSvc = 0x1E; // ID of svcGetSystemTick, this is computed inline in the patch section rather than by the kernel
 
-        u32 *start = reinterpret_cast<u32 *>(code.data());
-        u32 *end = start + (code.size() / sizeof(u32));
-        i64 patchOffset = offset;
+    constexpr size_t RescaleClockSize{17}; //!< The amount of instructions in the code generated by RescaleClock
 
-        std::vector<u32> patch((guest::SaveCtxSize + guest::LoadCtxSize + guest::SvcHandlerSize) / sizeof(u32));
+    /**
+     * @brief Generates code that rescales the host's clock to the Tegra X1's clock frequency using the same scale as util::GetGuestTicks, the result is left on the stack
+     * @details This lowers SP by 32 bytes and leaves the result at [SP], all registers are preserved. It computes `ticks * integer + UMULH(ticks, fraction)` with the scale baked into it as immediates, so it's only valid for the host it was generated on
+     */
+    const std::array<u32, RescaleClockSize> &RescaleClock() {
+        static const auto code{[] {
+            const auto &scale{util::GetTimeParameters().guestTicks};
+            auto fraction{instr::MoveRegister<u64>(regs::X1, scale.fraction)};
+            auto integer{instr::MoveRegister<u64>(regs::X2, scale.integer)};
+
+            return std::array<u32, RescaleClockSize>{
+                0xD10083FF, // SUB SP, SP, #32
+                0xA90107E0, // STP X0, X1, [SP, #16]
+                0xF90007E2, // STR X2, [SP, #8]
+                instr::Mrs(CntvctEl0, regs::X0).raw,
+                fraction[0], fraction[1], fraction[2], fraction[3],
+                0x9BC17C01, // UMULH X1, X0, X1
+                integer[0], integer[1], integer[2], integer[3],
+                0x9B020400, // MADD X0, X0, X2, X1
+                0xF90003E0, // STR X0, [SP]
+                0xF94007E2, // LDR X2, [SP, #8]
+                0xA94107E0, // LDP X0, X1, [SP, #16]
+            };
+        }()};
+        return code;
+    }
 
-        std::memcpy(patch.data(), reinterpret_cast<void *>(&guest::SaveCtx), guest::SaveCtxSize);
-        offset += guest::SaveCtxSize;
+    constexpr size_t SvcTrampolineSize = 8; //!< The size of the trampoline shared by all sites of an SVC in instructions
 
-        std::memcpy(reinterpret_cast<u8 *>(patch.data()) + guest::SaveCtxSize, reinterpret_cast<void *>(&guest::LoadCtx), guest::LoadCtxSize);
-        offset += guest::LoadCtxSize;
+    /**
+     * @brief Appends the trampoline shared by all sites of an SVC to the patch section, it saves the context and calls the SVC handler with the SVC number before restoring it
+     * @param svc The number of the SVC
+     * @param patch The patch section to append to, the guest functions must be at its start
+     * @note The return address into the stub of the site is on top of the stack on entry, it's passed to the SVC handler as the PC
+     */
+    void AppendSvcTrampoline(u16 svc, std::vector<u32> &patch) {
+        auto offset{static_cast<i64>(patch.size() * sizeof(u32))}; // The offset from the start of the patch section to the current instruction
 
-        std::memcpy(reinterpret_cast<u8 *>(patch.data()) + guest::SaveCtxSize + guest::LoadCtxSize, reinterpret_cast<void *>(&guest::SvcHandler), guest::SvcHandlerSize);
-        offset += guest::SvcHandlerSize;
+        constexpr u32 strLr = 0xF81F0FFE; // STR LR, [SP, #-16]!
+        offset += sizeof(strLr);
 
-        static u64 frequency{};
-        if (!frequency)
-            asm("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+        instr::BL bSvCtx(-offset);
+        offset += sizeof(bSvCtx);
 
-        for (u32 *address = start; address < end; address++) {
-            auto instrSvc = reinterpret_cast<instr::Svc *>(address);
-            auto instrMrs = reinterpret_cast<instr::Mrs *>(address);
-            auto instrMsr = reinterpret_cast<instr::Msr *>(address);
+        constexpr u32 ldrX0 = 0xF94003E0; // LDR X0, [SP]
+        offset += sizeof(ldrX0);
 
-            if (instrSvc->Verify()) {
-                // If this is an SVC we need to branch to saveCtx then to the SVC Handler after putting the PC + SVC into X0 and W1 and finally loadCtx before returning to where we were before
-                instr::B bJunc(offset);
+        instr::Movz movCmd(regs::W1, svc);
+        offset += sizeof(movCmd);
 
-                constexpr u32 strLr = 0xF81F0FFE; // STR LR, [SP, #-16]!
-                offset += sizeof(strLr);
+        instr::BL bSvcHandler(static_cast<i64>(guest::SaveCtxSize + guest::LoadCtxSize) - offset);
+        offset += sizeof(bSvcHandler);
 
-                instr::BL bSvCtx(patchOffset - offset);
-                offset += sizeof(bSvCtx);
+        instr::BL bLdCtx(static_cast<i64>(guest::SaveCtxSize) - offset);
+        offset += sizeof(bLdCtx);
 
-                auto movPc = instr::MoveRegister<u64>(regs::X0, baseAddress + (address - start));
-                offset += sizeof(u32) * movPc.size();
+        constexpr u32 ldrLr = 0xF84107FE; // LDR LR, [SP], #16
+        constexpr u32 ret = 0xD65F03C0; // RET
 
-                instr::Movz movCmd(regs::W1, static_cast<u16>(instrSvc->value));
-                offset += sizeof(movCmd);
+        patch.push_back(strLr);
+        patch.push_back(bSvCtx.raw);
+        patch.push_back(ldrX0);
+        patch.push_back(movCmd.raw);
+        patch.push_back(bSvcHandler.raw);
+        patch.push_back(bLdCtx.raw);
+        patch.push_back(ldrLr);
+        patch.push_back(ret);
+    }
 
-                instr::BL bSvcHandler((patchOffset + guest::SaveCtxSize + guest::LoadCtxSize) - offset);
-                offset += sizeof(bSvcHandler);
+    /**
+     * @brief A class of instructions that PatchInstruction might patch, an instruction belongs to it if its bits under the mask match the signature
+     */
+    struct PatchClass {
+        u32 mask;
+        u32 signature;
+    };
 
-                instr::BL bLdCtx((patchOffset + guest::SaveCtxSize) - offset);
-                offset += sizeof(bLdCtx);
+    constexpr std::array<PatchClass, 3> PatchClasses{{
+        {instr::Svc::Mask, instr::Svc::Signature},
+        {instr::Mrs::Mask, instr::Mrs::Signature},
+        {instr::Msr::Mask, instr::Msr::Signature},
+    }};
 
-                constexpr u32 ldrLr = 0xF84107FE; // LDR LR, [SP], #16
-                offset += sizeof(ldrLr);
+    /**
+     * @return If the instruction belongs to any patch class, PatchInstruction leaves every other instruction untouched
+     */
+    constexpr bool IsPatchCandidate(u32 instruction) {
+        for (const auto &patchClass : PatchClasses)
+            if ((instruction & patchClass.mask) == patchClass.signature)
+                return true;
+        return false;
+    }
+
+    /**
+     * @return The index of the first instruction in [index, end) that belongs to any patch class or end if there isn't one
+     * @note Almost no instructions are candidates so this is dominated by rejecting them, four instructions are tested against all classes at once with NEON and only a group holding a candidate is looked at individually
+     */
+    u32 FindPatchCandidate(const u32 *code, u32 index, u32 end) {
+        std::array<uint32x4_t, PatchClasses.size()> masks, signatures;
+        for (size_t i{}; i < PatchClasses.size(); i++) {
+            masks[i] = vdupq_n_u32(PatchClasses[i].mask);
+            signatures[i] = vdupq_n_u32(PatchClasses[i].signature);
+        }
+
+        for (; index + 4 <= end; index += 4) {
+            auto words{vld1q_u32(code + index)};
+            auto matches{vceqq_u32(vandq_u32(words, masks[0]), signatures[0])};
+            for (size_t i{1}; i < PatchClasses.size(); i++)
+                matches = vorrq_u32(matches, vceqq_u32(vandq_u32(words, masks[i]), signatures[i]));
+            if (vmaxvq_u32(matches))
+                break; // The candidate is located within the group by the scalar loop below
+        }
+
+        for (; index < end; index++)
+            if (IsPatchCandidate(code[index]))
+                return index;
+        return end;
+    }
+
+    /**
+     * @brief Patches a single instruction, any code that it's redirected to is appended to the patch section
+     * @param instruction The instruction to patch, this is overwritten with the instruction replacing it
+     * @param trampolines A map from the number of every SVC to the index of its trampoline in the patch section, this can be null if the offsets aren't required
+     * @param offset The offset from the instruction to the end of the patch section
+     * @param patchOffset The offset from the instruction to the start of the patch section
+     * @param frequency The clock frequency of the host
+     * @param patch The patch section to append to
+     * @note The amount of code appended for an instruction doesn't depend on the offsets, only on the instruction itself
+     */
+    void PatchInstruction(u32 &instruction, const std::unordered_map<u16, size_t> *trampolines, i64 offset, i64 patchOffset, u64 frequency, std::vector<u32> &patch) {
+        auto instrSvc = reinterpret_cast<instr::Svc *>(&instruction);
+        auto instrMrs = reinterpret_cast<instr::Mrs *>(&instruction);
+        auto instrMsr = reinterpret_cast<instr::Msr *>(&instruction);
+
+        if (instrSvc->Verify() && instrSvc->value == GetSystemTickSvc) {
+            // svcGetSystemTick only reads the clock, so its result is computed in the guest the same way as a read of CNTPCT_EL0 into X0 without a round trip to the kernel
+            if (frequency != constant::TegraX1Frequency) {
+                instr::B bJunc(offset);
+                offset += RescaleClockSize * sizeof(u32);
+
+                constexpr u32 ldrX0 = 0xF94003E0; // LDR X0, [SP]
+                offset += sizeof(ldrX0);
+
+                constexpr u32 addSp = 0x910083FF; // ADD SP, SP, #32
+                offset += sizeof(addSp);
 
                 instr::B bret(-offset + sizeof(u32));
                 offset += sizeof(bret);
 
-                *address = bJunc.raw;
-                patch.push_back(strLr);
-                patch.push_back(bSvCtx.raw);
-                for (auto &instr : movPc)
-                    patch.push_back(instr);
-                patch.push_back(movCmd.raw);
-                patch.push_back(bSvcHandler.raw);
-                patch.push_back(bLdCtx.raw);
-                patch.push_back(ldrLr);
+                instruction = bJunc.raw;
+                const auto &rescaleClock{RescaleClock()};
+                patch.insert(patch.end(), rescaleClock.begin(), rescaleClock.end());
+                patch.push_back(ldrX0);
+                patch.push_back(addSp);
                 patch.push_back(bret.raw);
-            } else if (instrMrs->Verify()) {
-                if (instrMrs->srcReg == TpidrroEl0 || instrMrs->srcReg == TpidrEl0) {
-                    // If this moves TPIDR(RO)_EL0 into a register then we retrieve the value of our virtual TPIDR(RO)_EL0 from TLS and write it to the register
+            } else {
+                instruction = instr::Mrs(CntvctEl0, regs::X0).raw;
+            }
+        } else if (instrSvc->Verify()) {
+            // If this is an SVC we save LR and call the trampoline shared by all sites of the SVC, it does the context switch to the SVC handler so every site only needs a small stub
+            instr::B bJunc(offset);
+
+            constexpr u32 strLr = 0xF81F0FFE; // STR LR, [SP, #-16]!
+            offset += sizeof(strLr);
+
+            auto trampoline{trampolines ? static_cast<i64>(trampolines->at(static_cast<u16>(instrSvc->value)) * sizeof(u32)) : 0};
+            instr::BL bTrampoline((patchOffset + trampoline) - offset);
+            offset += sizeof(bTrampoline);
+
+            constexpr u32 ldrLr = 0xF84107FE; // LDR LR, [SP], #16
+            offset += sizeof(ldrLr);
+
+            instr::B bret(-offset + sizeof(u32));
+            offset += sizeof(bret);
+
+            instruction = bJunc.raw;
+            patch.push_back(strLr);
+            patch.push_back(bTrampoline.raw);
+            patch.push_back(ldrLr);
+            patch.push_back(bret.raw);
+        } else if (instrMrs->Verify()) {
+            if (instrMrs->srcReg == TpidrroEl0 || instrMrs->srcReg == TpidrEl0) {
+                // If this moves TPIDR(RO)_EL0 into a register then we retrieve the value of our virtual TPIDR(RO)_EL0 from the context and write it to the register
+                constexpr u8 Xzr = 31; // The encoding of XZR as the destination of MRS
+                if (instrMrs->destReg == Xzr) {
+                    constexpr u32 nop = 0xD503201F; // NOP
+                    instruction = nop; // The value is discarded, so the read has no effect
+                } else {
+                    // The destination register holds the address of the context prior to being loaded into, so no register has to be spilled to the stack
                     instr::B bJunc(offset);
 
-                    u32 strX0{};
-                    if (instrMrs->destReg != regs::X0) {
-                        strX0 = 0xF81F0FE0; // STR X0, [SP, #-16]!
-                        offset += sizeof(strX0);
-                    }
-
-                    constexpr u32 mrsX0 = 0xD53BD040; // MRS X0, TPIDR_EL0
-                    offset += sizeof(mrsX0);
-
-                    u32 ldrTls;
-                    if (instrMrs->srcReg == TpidrroEl0)
-                        ldrTls = 0xF9408000; // LDR X0, [X0, #256] (ThreadContext::tpidrroEl0)
-                    else
-                        ldrTls = 0xF9408400; // LDR X0, [X0, #264] (ThreadContext::tpidrEl0)
+                    u32 mrsXn = 0xD53BD040 | instrMrs->destReg; // MRS Xn, TPIDR_EL0
+                    offset += sizeof(mrsXn);
 
+                    u32 ldrTls = (instrMrs->srcReg == TpidrroEl0 ? 0xF9409C00 : 0xF940A000) | instrMrs->destReg | (static_cast<u32>(instrMrs->destReg) << 5); // LDR Xn, [Xn, #312] (ThreadContext::tpidrroEl0) or LDR Xn, [Xn, #320] (ThreadContext::tpidrEl0)
                     offset += sizeof(ldrTls);
 
-                    u32 movXn{};
-                    u32 ldrX0{};
-                    if (instrMrs->destReg != regs::X0) {
-                        movXn = instr::Mov(regs::X(instrMrs->destReg), regs::X0).raw;
-                        offset += sizeof(movXn);
-
-                        ldrX0 = 0xF84107E0; // LDR X0, [SP], #16
-                        offset += sizeof(ldrX0);
-                    }
-
                     instr::B bret(-offset + sizeof(u32));
                     offset += sizeof(bret);
 
-                    *address = bJunc.raw;
-                    if (strX0)
-                        patch.push_back(strX0);
-                    patch.push_back(mrsX0);
+                    instruction = bJunc.raw;
+                    patch.push_back(mrsXn);
                     patch.push_back(ldrTls);
-                    if (movXn)
-                        patch.push_back(movXn);
-                    if (ldrX0)
-                        patch.push_back(ldrX0);
                     patch.push_back(bret.raw);
-                } else if (frequency != TegraX1Freq) {
-                    // These deal with changing the timer registers, we only do this if the clock frequency doesn't match the X1's clock frequency
-                    if (instrMrs->srcReg == CntpctEl0) {
-                        // If this moves CNTPCT_EL0 into a register then call RescaleClock to rescale the device's clock to the X1's clock frequency and write result to register
-                        instr::B bJunc(offset);
-                        offset += guest::RescaleClockSize;
-
-                        instr::Ldr ldr(0xF94003E0); // LDR XOUT, [SP]
-                        ldr.destReg = instrMrs->destReg;
-                        offset += sizeof(ldr);
-
-                        constexpr u32 addSp = 0x910083FF; // ADD SP, SP, #32
-                        offset += sizeof(addSp);
-
-                        instr::B bret(-offset + sizeof(u32));
-                        offset += sizeof(bret);
-
-                        *address = bJunc.raw;
-                        auto size = patch.size();
-                        patch.resize(size + (guest::RescaleClockSize / sizeof(u32)));
-                        std::memcpy(patch.data() + size, reinterpret_cast<void *>(&guest::RescaleClock), guest::RescaleClockSize);
-                        patch.push_back(ldr.raw);
-                        patch.push_back(addSp);
-                        patch.push_back(bret.raw);
-                    } else if (instrMrs->srcReg == CntfrqEl0) {
-                        // If this moves CNTFRQ_EL0 into a register then move the Tegra X1's clock frequency into the register (Rather than the host clock frequency)
-                        instr::B bJunc(offset);
-
-                        auto movFreq = instr::MoveRegister<u32>(static_cast<regs::X>(instrMrs->destReg), TegraX1Freq);
-                        offset += sizeof(u32) * movFreq.size();
-
-                        instr::B bret(-offset + sizeof(u32));
-                        offset += sizeof(bret);
-
-                        *address = bJunc.raw;
-                        for (auto &instr : movFreq)
-                            patch.push_back(instr);
-                        patch.push_back(bret.raw);
-                    }
-                } else {
-                    // If the host clock frequency is the same as the Tegra X1's clock frequency
-                    if (instrMrs->srcReg == CntpctEl0) {
-                        // If this moves CNTPCT_EL0 into a register, change the instruction to move CNTVCT_EL0 instead as Linux or most other OSes don't allow access to CNTPCT_EL0 rather only CNTVCT_EL0 can be accessed from userspace
-                        *address = instr::Mrs(CntvctEl0, regs::X(instrMrs->destReg)).raw;
-                    }
                 }
-            } else if (instrMsr->Verify()) {
-                if (instrMsr->destReg == TpidrEl0) {
-                    // If this moves a register into TPIDR_EL0 then we retrieve the value of the register and write it to our virtual TPIDR_EL0 in TLS
+            } else if (frequency != constant::TegraX1Frequency) {
+                // These deal with changing the timer registers, we only do this if the clock frequency doesn't match the X1's clock frequency
+                if (instrMrs->srcReg == CntpctEl0) {
+                    // If this moves CNTPCT_EL0 into a register then insert the code from RescaleClock to rescale the device's clock to the X1's clock frequency and write result to register
                     instr::B bJunc(offset);
+                    offset += RescaleClockSize * sizeof(u32);
 
-                    // Used to avoid conflicts as we cannot read the source register from the stack
-                    bool x0x1 = instrMrs->srcReg != regs::X0 && instrMrs->srcReg != regs::X1;
+                    instr::Ldr ldr(0xF94003E0); // LDR XOUT, [SP]
+                    ldr.destReg = instrMrs->destReg;
+                    offset += sizeof(ldr);
 
-                    // Push two registers to stack that can be used to load the TLS and arguments into
-                    u32 pushXn = x0x1 ? 0xA9BF07E0 : 0xA9BF0FE2; // STP X(0/2), X(1/3), [SP, #-16]!
-                    offset += sizeof(pushXn);
+                    constexpr u32 addSp = 0x910083FF; // ADD SP, SP, #32
+                    offset += sizeof(addSp);
 
-                    u32 loadRealTls = x0x1 ? 0xD53BD040 : 0xD53BD042; // MRS X(0/2), TPIDR_EL0
-                    offset += sizeof(loadRealTls);
-
-                    instr::Mov moveParam(x0x1 ? regs::X1 : regs::X3, regs::X(instrMsr->srcReg));
-                    offset += sizeof(moveParam);
+                    instr::B bret(-offset + sizeof(u32));
+                    offset += sizeof(bret);
 
-                    u32 storeEmuTls = x0x1 ? 0xF9008401 : 0xF9008403; // STR X(1/3), [X0, #264] (ThreadContext::tpidrEl0)
-                    offset += sizeof(storeEmuTls);
+                    instruction = bJunc.raw;
+                    const auto &rescaleClock{RescaleClock()};
+                    patch.insert(patch.end(), rescaleClock.begin(), rescaleClock.end());
+                    patch.push_back(ldr.raw);
+                    patch.push_back(addSp);
+                    patch.push_back(bret.raw);
+                } else if (instrMrs->srcReg == CntfrqEl0) {
+                    // If this moves CNTFRQ_EL0 into a register then move the Tegra X1's clock frequency into the register (Rather than the host clock frequency)
+                    instr::B bJunc(offset);
 
-                    u32 popXn = x0x1 ? 0xA8C107E0 : 0xA8C10FE2; // LDP X(0/2), X(1/3), [SP], #16
-                    offset += sizeof(popXn);
+                    auto movFreq = instr::MoveRegister<u32>(static_cast<regs::X>(instrMrs->destReg), constant::TegraX1Frequency);
+                    offset += sizeof(u32) * movFreq.size();
 
                     instr::B bret(-offset + sizeof(u32));
                     offset += sizeof(bret);
 
-                    *address = bJunc.raw;
-                    patch.push_back(pushXn);
-                    patch.push_back(loadRealTls);
-                    patch.push_back(moveParam.raw);
-                    patch.push_back(storeEmuTls);
-                    patch.push_back(popXn);
+                    instruction = bJunc.raw;
+                    for (auto &instr : movFreq)
+                        patch.push_back(instr);
                     patch.push_back(bret.raw);
                 }
+            } else {
+                // If the host clock frequency is the same as the Tegra X1's clock frequency
+                if (instrMrs->srcReg == CntpctEl0) {
+                    // If this moves CNTPCT_EL0 into a register, change the instruction to move CNTVCT_EL0 instead as Linux or most other OSes don't allow access to CNTPCT_EL0 rather only CNTVCT_EL0 can be accessed from userspace
+                    instruction = instr::Mrs(CntvctEl0, regs::X(instrMrs->destReg)).raw;
+                }
             }
+        } else if (instrMsr->Verify()) {
+            if (instrMsr->destReg == TpidrEl0) {
+                // If this moves a register into TPIDR_EL0 then we write the value of the register to our virtual TPIDR_EL0 in the context
+                instr::B bJunc(offset);
+
+                // A single scratch register which isn't the source is spilled to hold the address of the context, the source is stored directly from its own register
+                u8 scratch = instrMsr->srcReg != regs::X0 ? regs::X0 : regs::X1;
+
+                u32 pushXt = 0xF81F0FE0 | scratch; // STR Xt, [SP, #-16]!
+                offset += sizeof(pushXt);
+
+                u32 loadRealTls = 0xD53BD040 | scratch; // MRS Xt, TPIDR_EL0
+                offset += sizeof(loadRealTls);
+
+                u32 storeEmuTls = 0xF900A000 | instrMsr->srcReg | (static_cast<u32>(scratch) << 5); // STR Xn, [Xt, #320] (ThreadContext::tpidrEl0)
+                offset += sizeof(storeEmuTls);
 
-            offset -= sizeof(u32);
-            patchOffset -= sizeof(u32);
+                u32 popXt = 0xF84107E0 | scratch; // LDR Xt, [SP], #16
+                offset += sizeof(popXt);
+
+                instr::B bret(-offset + sizeof(u32));
+                offset += sizeof(bret);
+
+                instruction = bJunc.raw;
+                patch.push_back(pushXt);
+                patch.push_back(loadRealTls);
+                patch.push_back(storeEmuTls);
+                patch.push_back(popXt);
+                patch.push_back(bret.raw);
+            }
         }
+
+    }
+
+    /**
+     * @brief The header of a patch cache file, it's followed by the code patches and then the patch section
+     */
+    struct PatchCacheHeader {
+        u32 magic; //!< The magic of the cache "PCH3", this is bumped whenever the layout of the patch section changes
+        u32 codeSize; //!< The size of the code that was patched in bytes
+        u64 baseAddress; //!< The address at which the code was mapped, this isn't compared as the patched code doesn't depend on it
+        i64 offset; //!< The offset of the patch section from the base address
+        u64 frequency; //!< The clock frequency of the host that the code was patched on
+        u64 stubHash; //!< A hash of the guest functions that are copied into the patch section, this changes when they are modified
+        u64 codePatchCount; //!< The amount of instructions in the code that were replaced
+        u64 patchSize; //!< The size of the patch section in instructions
+    };
+
+    /**
+     * @brief This holds a single instruction in the code that was replaced while patching
+     */
+    struct CodePatch {
+        u32 index; //!< The index of the instruction in the code
+        u32 instruction; //!< The instruction that replaced it
+    };
+
+    /**
+     * @return A hash of all guest functions that are copied into the patch section
+     */
+    u64 GetStubHash() {
+        auto hashStub = [](const void *stub, size_t size) {
+            return util::Hash(std::string_view(reinterpret_cast<const char *>(stub), size));
+        };
+        return hashStub(reinterpret_cast<void *>(&guest::SaveCtx), guest::SaveCtxSize) ^ (hashStub(reinterpret_cast<void *>(&guest::LoadCtx), guest::LoadCtxSize) << 1) ^ (hashStub(reinterpret_cast<void *>(&guest::SvcHandler), guest::SvcHandlerSize) << 2) ^ (hashStub(RescaleClock().data(), RescaleClockSize * sizeof(u32)) << 3);
+    }
+
+    std::vector<u32> NCE::PatchCode(std::span<u8> code, u64 baseAddress, i64 offset, std::span<u8> buildId) {
+        auto frequency{util::GetTimeParameters().frequency};
+
+        PatchCacheHeader cacheHeader{
+            .magic = util::MakeMagic<u32>("PCH3"),
+            .codeSize = static_cast<u32>(code.size()),
+            .baseAddress = baseAddress,
+            .offset = offset,
+            .frequency = frequency,
+            .stubHash = GetStubHash(),
+        };
+
+        // The cache is keyed by the build ID of the executable, this is unique to every build of it
+        std::string cacheName;
+        for (auto byte : buildId)
+            cacheName += fmt::format("{:02X}", byte);
+        if (std::all_of(buildId.begin(), buildId.end(), [](u8 byte) { return byte == 0; }))
+            cacheName.clear();
+
+        std::optional<vfs::OsFileSystem> cache;
+        if (!cacheName.empty()) {
+            try {
+                cache.emplace(state.os->appFilesPath + "patch_cache/");
+                if (cache->FileExists(cacheName)) {
+                    auto backing = cache->OpenFile(cacheName);
+                    PatchCacheHeader header{};
+                    backing->Read(&header);
+
+                    if (header.magic == cacheHeader.magic && header.codeSize == cacheHeader.codeSize && header.offset == cacheHeader.offset && header.frequency == cacheHeader.frequency && header.stubHash == cacheHeader.stubHash && backing->size == sizeof(PatchCacheHeader) + (header.codePatchCount * sizeof(CodePatch)) + (header.patchSize * sizeof(u32))) {
+                        std::vector<CodePatch> codePatches(header.codePatchCount);
+                        backing->Read(codePatches.data(), sizeof(PatchCacheHeader), codePatches.size() * sizeof(CodePatch));
+
+                        std::vector<u32> patch(header.patchSize);
+                        backing->Read(patch.data(), sizeof(PatchCacheHeader) + (codePatches.size() * sizeof(CodePatch)), patch.size() * sizeof(u32));
+
+                        auto instructions = reinterpret_cast<u32 *>(code.data());
+                        for (const auto &codePatch : codePatches)
+                            instructions[codePatch.index] = codePatch.instruction;
+
+                        state.logger->Debug("Loaded {} patched instructions from the patch cache: {}", codePatches.size(), cacheName);
+                        return patch;
+                    }
+                }
+            } catch (const std::exception &e) {
+                state.logger->Warn("Failed to read the patch cache: {}", e.what());
+            }
+        }
+
+        u32 *start = reinterpret_cast<u32 *>(code.data());
+        u32 count = static_cast<u32>(code.size() / sizeof(u32));
+
+        std::vector<u32> patch((guest::SaveCtxSize + guest::LoadCtxSize + guest::SvcHandlerSize) / sizeof(u32));
+        std::memcpy(patch.data(), reinterpret_cast<void *>(&guest::SaveCtx), guest::SaveCtxSize);
+        std::memcpy(reinterpret_cast<u8 *>(patch.data()) + guest::SaveCtxSize, reinterpret_cast<void *>(&guest::LoadCtx), guest::LoadCtxSize);
+        std::memcpy(reinterpret_cast<u8 *>(patch.data()) + guest::SaveCtxSize + guest::LoadCtxSize, reinterpret_cast<void *>(&guest::SvcHandler), guest::SvcHandlerSize);
+
+        /**
+         * @brief The code is split into page-aligned ranges of instructions which are patched independently
+         */
+        struct Range {
+            u32 start; //!< The index of the first instruction in the range
+            u32 end; //!< The index after the last instruction in the range
+            std::vector<u32> sites; //!< The indices of all instructions in the range that need to be patched
+            std::unordered_map<u16, u32> svcSites; //!< The amount of sites of every SVC in the range that are redirected to its trampoline
+            std::vector<u32> patch; //!< The code appended to the patch section for the instructions in the range
+            size_t patchStart; //!< The offset of the range's code in the patch section in instructions
+        };
+
+        constexpr u32 PageInstructions = PAGE_SIZE / sizeof(u32);
+        auto pageCount = util::AlignUp(count, PageInstructions) / PageInstructions;
+        auto threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1U), std::max(pageCount, 1U));
+        auto pagesPerThread = (pageCount + threadCount - 1) / threadCount;
+
+        std::vector<Range> ranges;
+        for (u32 index = 0; index < count; index += pagesPerThread * PageInstructions)
+            ranges.push_back(Range{index, std::min(index + pagesPerThread * PageInstructions, count)});
+
+        // Every range is run on its own thread with the calling thread running the last one
+        auto runRanges = [&](auto function) {
+            std::vector<std::thread> threads;
+            threads.reserve(ranges.size());
+            for (size_t index = 0; index + 1 < ranges.size(); index++)
+                threads.emplace_back(function, std::ref(ranges[index]));
+            if (!ranges.empty())
+                function(ranges.back());
+            for (auto &thread : threads)
+                thread.join();
+        };
+
+        // The first pass finds every instruction that needs to be patched, only the instructions that are candidates for patching are passed to PatchInstruction and the size of the code it's redirected to, this is required to know where the code for each range is placed in the patch section
+        runRanges([&](Range &range) {
+            for (u32 index = FindPatchCandidate(start, range.start, range.end); index < range.end; index = FindPatchCandidate(start, index + 1, range.end)) {
+                auto instruction = start[index];
+                auto svc = reinterpret_cast<instr::Svc *>(&instruction);
+                if (svc->Verify() && svc->value != GetSystemTickSvc)
+                    range.svcSites[static_cast<u16>(svc->value)]++;
+
+                auto size = range.patch.size();
+                PatchInstruction(instruction, nullptr, 0, 0, frequency, range.patch);
+                if (instruction != start[index] || range.patch.size() != size)
+                    range.sites.push_back(index);
+            }
+        });
+
+        // Every SVC has a single trampoline placed right after the guest functions, they're ordered by their amount of sites so the code shared by the most sites is contiguous with the handler
+        std::unordered_map<u16, u32> svcSites;
+        for (const auto &range : ranges)
+            for (const auto &[svc, sites] : range.svcSites)
+                svcSites[svc] += sites;
+
+        std::vector<std::pair<u16, u32>> svcOrder(svcSites.begin(), svcSites.end());
+        std::sort(svcOrder.begin(), svcOrder.end(), [](const auto &a, const auto &b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+
+        std::unordered_map<u16, size_t> trampolines;
+        patch.reserve(patch.size() + (svcOrder.size() * SvcTrampolineSize));
+        for (const auto &[svc, sites] : svcOrder) {
+            trampolines[svc] = patch.size();
+            AppendSvcTrampoline(svc, patch);
+        }
+
+        auto patchSize = patch.size();
+        for (auto &range : ranges) {
+            range.patchStart = patchSize;
+            patchSize += range.patch.size();
+        }
+        patch.resize(patchSize);
+
+        // The second pass patches the instructions with their final offsets and writes each range's code into its place in the patch section
+        runRanges([&](Range &range) {
+            range.patch.clear();
+            for (auto index : range.sites) {
+                auto instructionOffset = static_cast<i64>(index) * sizeof(u32);
+                PatchInstruction(start[index], &trampolines, offset + static_cast<i64>((range.patchStart + range.patch.size()) * sizeof(u32)) - instructionOffset, offset - instructionOffset, frequency, range.patch);
+            }
+            std::memcpy(patch.data() + range.patchStart, range.patch.data(), range.patch.size() * sizeof(u32));
+        });
+
+        if (cache) {
+            try {
+                std::vector<CodePatch> codePatches;
+                for (const auto &range : ranges)
+                    for (auto index : range.sites)
+                        codePatches.push_back(CodePatch{index, start[index]});
+
+                cacheHeader.codePatchCount = codePatches.size();
+                cacheHeader.patchSize = patch.size();
+
+                auto cacheSize = sizeof(PatchCacheHeader) + (codePatches.size() * sizeof(CodePatch)) + (patch.size() * sizeof(u32));
+                cache->CreateFile(cacheName, cacheSize);
+                auto backing = cache->OpenFile(cacheName, {false, true, false});
+                backing->Write(&cacheHeader);
+                backing->Write(codePatches.data(), sizeof(PatchCacheHeader), codePatches.size() * sizeof(CodePatch));
+                backing->Write(patch.data(), sizeof(PatchCacheHeader) + (codePatches.size() * sizeof(CodePatch)), patch.size() * sizeof(u32));
+            } catch (const std::exception &e) {
+                state.logger->Warn("Failed to write the patch cache: {}", e.what());
+            }
+        }
+
         return patch;
     }
 }
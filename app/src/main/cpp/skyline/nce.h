@@ -8,8 +8,11 @@
 #include <sys/wait.h>
 #include <vector>
 #include <unordered_map>
+#include <atomic>
+#include <shared_mutex>
 #include "common.h"
 #include "kernel/types/KSharedMemory.h"
+#include "kernel/scheduler.h"
 
 namespace skyline {
     /**
@@ -18,27 +21,71 @@ namespace skyline {
     class NCE {
       private:
         DeviceState &state; //!< The state of the device
-        std::unordered_map<pid_t, std::shared_ptr<std::thread>> threadMap; //!< This maps all of the host threads to their corresponding kernel thread
+        KernelQueue *queue; //!< The queue of guest threads waiting on the kernel, this is mapped into the guest process at the same address as it's inherited by it
+        u32 workerTarget; //!< The amount of kernel workers that are kept available to service requests, this is the amount of host cores
+        std::atomic<u32> workerCount{}; //!< The amount of kernel workers that are currently running
+        std::atomic<u32> availableWorkers{}; //!< The amount of kernel workers that aren't blocked inside an SVC
+        std::shared_timed_mutex pauseMutex; //!< Kernel workers hold this shared while servicing a request, except while they're blocked on other guest threads inside an SVC, it's locked exclusively to pause all of them
+        std::optional<kernel::DeterministicScheduler> scheduler; //!< The scheduler that guest threads are serialized with when deterministic scheduling is enabled, they're scheduled by the host otherwise
 
         /**
-         * @brief This function is the event loop of a kernel thread managing a guest thread
-         * @param thread The PID of the thread to manage
+         * @brief Starts a new kernel worker and counts it as available
          */
-        void KernelThread(pid_t thread);
+        void SpawnWorker();
+
+        /**
+         * @brief This function is the event loop of a kernel worker, it services requests from any guest thread that are pushed onto the kernel queue
+         */
+        void KernelWorker();
+
+        /**
+         * @brief Blocks the calling kernel worker till a request is available on the kernel queue
+         * @param tid The TID of the guest thread that pushed the request is written to this
+         * @param timeout The maximum amount of time to sleep for
+         * @return If a request was popped, this is false only if the timeout expired
+         */
+        bool WaitKernelRequest(pid_t &tid, const timespec *timeout);
+
+        /**
+         * @brief Services a single request from a guest thread, this is either an SVC or a crash
+         * @param tid The TID of the guest thread that pushed the request
+         * @return If the calling kernel worker should exit as it's surplus to the target
+         */
+        bool HandleKernelRequest(pid_t tid);
+
+        /**
+         * @brief Kills a guest thread after it has crashed or an SVC it called has failed, this halts emulation if it's the main thread
+         */
+        void KillGuestThread(pid_t tid);
 
       public:
+        FaultTable *faultTable; //!< The table that guest threads resolve deliberate faults with, it's mapped into the guest process the same way as the kernel queue
+
         NCE(DeviceState &state);
 
         /**
-         * @brief The destructor for NCE, this calls join() on all the threads
+         * @brief The destructor for NCE, this waits for all kernel workers to exit
          */
         ~NCE();
 
         /**
-         * @brief This function is the main event loop of the program
+         * @brief This function is the main event loop of the program, it starts the kernel workers prior to entering it
          */
         void Execute();
 
+        /**
+         * @brief Waits for every kernel worker to finish the request it's servicing and holds back all further requests till ResumeWorkers is called
+         * @param timeout The maximum amount of time to wait for, a service can be waiting on a request that is held back by the pause
+         * @return If the workers were paused, ResumeWorkers must only be called if this is true
+         * @note Workers blocked on other guest threads inside an SVC are only held back once they return, while paused they can only wake up from a timeout and write the results of the SVC into the ThreadContext of their own thread
+         */
+        bool PauseWorkers(std::chrono::nanoseconds timeout);
+
+        /**
+         * @brief Lets kernel workers service requests again after PauseWorkers
+         */
+        void ResumeWorkers();
+
         /**
          * @brief Execute any arbitrary function on a specific child thread
          * @param call The specific call to execute
@@ -54,6 +101,13 @@ namespace skyline {
          */
         void ExecuteFunction(ThreadCall call, Registers &funcRegs);
 
+        /**
+         * @brief Executes a sequence of syscalls on the child process with a single round trip for every batch of constant::SyscallBatchSize syscalls
+         * @param syscalls The syscalls to execute, their results are written back into them
+         * @note The sequence is stopped at the first syscall that fails, the result of every syscall after it is -ECANCELED
+         */
+        void ExecuteSyscalls(std::span<GuestSyscall> syscalls);
+
         /**
          * @brief Waits till a thread is ready to execute commands
          * @param thread The KThread to wait for initialization
@@ -61,7 +115,7 @@ namespace skyline {
         void WaitThreadInit(std::shared_ptr<kernel::type::KThread> &thread);
 
         /**
-         * @brief Sets the X0 and X1 registers in a thread and starts it and it's kernel thread
+         * @brief Sets the X0 and X1 registers in a thread and starts it, its requests are serviced by the kernel workers
          * @param entryArg The argument to pass in for the entry function
          * @param handle The handle of the main thread
          * @param thread The thread to set the registers and start
@@ -76,12 +130,39 @@ namespace skyline {
          */
         void ThreadTrace(u16 numHist = 10, ThreadContext *ctx = nullptr);
 
+        /**
+         * @brief Sets flags on all pages of a region in the fault table
+         * @param flags The FaultTable::PageFlags to set
+         * @note This must be done prior to protecting the region so the guest never sees a fault on it without the flags
+         */
+        void SetFaultFlags(u64 address, u64 size, u8 flags);
+
+        /**
+         * @brief Clears flags on all pages of a region in the fault table
+         * @param flags The FaultTable::PageFlags to clear
+         */
+        void ClearFaultFlags(u64 address, u64 size, u8 flags);
+
+        /**
+         * @return If any page of a region has any of the supplied flags set in the fault table
+         */
+        bool HasFaultFlags(u64 address, u64 size, u8 flags);
+
+        /**
+         * @brief Clears the Dirty flag of a page in the fault table
+         * @return If the page was written to after a fault that the guest resolved since this was last called on it
+         */
+        bool CollectDirtyPage(u64 address);
+
         /**
          * @brief This patches specific parts of the code
-         * @param code A vector with the code to be patched
+         * @param code The code to be patched, this is modified in-place
          * @param baseAddress The address at which the code is mapped
          * @param offset The offset of the code block from the base address
+         * @param buildId The build ID of the executable, if this isn't empty or zero then the result is cached on disk and reused for subsequent loads
+         * @return The contents of the patch section
+         * @note The code is scanned in parallel across page-aligned ranges
          */
-        std::vector<u32> PatchCode(std::vector<u8> &code, u64 baseAddress, i64 offset);
+        std::vector<u32> PatchCode(std::span<u8> code, u64 baseAddress, i64 offset, std::span<u8> buildId = {});
     };
 }
@@ -5,6 +5,8 @@
 #include <cstdlib>
 #include <initializer_list> // This is used implicitly
 #include <asm/siginfo.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
 #include <unistd.h>
 #include <asm/unistd.h>
 #include "guest_common.h"
@@ -53,21 +55,21 @@ namespace skyline::guest {
     FORCE_INLINE void SaveCtxTls() {
         asm("STR LR, [SP, #-16]!\n\t"
             "MRS LR, TPIDR_EL0\n\t"
-            "STP X0, X1, [LR, #16]\n\t"
-            "STP X2, X3, [LR, #32]\n\t"
-            "STP X4, X5, [LR, #48]\n\t"
-            "STP X6, X7, [LR, #64]\n\t"
-            "STP X8, X9, [LR, #80]\n\t"
-            "STP X10, X11, [LR, #96]\n\t"
-            "STP X12, X13, [LR, #112]\n\t"
-            "STP X14, X15, [LR, #128]\n\t"
-            "STP X16, X17, [LR, #144]\n\t"
-            "STP X18, X19, [LR, #160]\n\t"
-            "STP X20, X21, [LR, #176]\n\t"
-            "STP X22, X23, [LR, #192]\n\t"
-            "STP X24, X25, [LR, #208]\n\t"
-            "STP X26, X27, [LR, #224]\n\t"
-            "STP X28, X29, [LR, #240]\n\t"
+            "STP X0, X1, [LR, #64]\n\t"
+            "STP X2, X3, [LR, #80]\n\t"
+            "STP X4, X5, [LR, #96]\n\t"
+            "STP X6, X7, [LR, #112]\n\t"
+            "STP X8, X9, [LR, #128]\n\t"
+            "STP X10, X11, [LR, #144]\n\t"
+            "STP X12, X13, [LR, #160]\n\t"
+            "STP X14, X15, [LR, #176]\n\t"
+            "STP X16, X17, [LR, #192]\n\t"
+            "STP X18, X19, [LR, #208]\n\t"
+            "STP X20, X21, [LR, #224]\n\t"
+            "STP X22, X23, [LR, #240]\n\t"
+            "STP X24, X25, [LR, #256]\n\t"
+            "STP X26, X27, [LR, #272]\n\t"
+            "STP X28, X29, [LR, #288]\n\t"
             "LDR LR, [SP], #16\n\t"
             "DSB ST"
         );
@@ -76,25 +78,37 @@ namespace skyline::guest {
     FORCE_INLINE void LoadCtxTls() {
         asm("STR LR, [SP, #-16]!\n\t"
             "MRS LR, TPIDR_EL0\n\t"
-            "LDP X0, X1, [LR, #16]\n\t"
-            "LDP X2, X3, [LR, #32]\n\t"
-            "LDP X4, X5, [LR, #48]\n\t"
-            "LDP X6, X7, [LR, #64]\n\t"
-            "LDP X8, X9, [LR, #80]\n\t"
-            "LDP X10, X11, [LR, #96]\n\t"
-            "LDP X12, X13, [LR, #112]\n\t"
-            "LDP X14, X15, [LR, #128]\n\t"
-            "LDP X16, X17, [LR, #144]\n\t"
-            "LDP X18, X19, [LR, #160]\n\t"
-            "LDP X20, X21, [LR, #176]\n\t"
-            "LDP X22, X23, [LR, #192]\n\t"
-            "LDP X24, X25, [LR, #208]\n\t"
-            "LDP X26, X27, [LR, #224]\n\t"
-            "LDP X28, X29, [LR, #240]\n\t"
+            "LDP X0, X1, [LR, #64]\n\t"
+            "LDP X2, X3, [LR, #80]\n\t"
+            "LDP X4, X5, [LR, #96]\n\t"
+            "LDP X6, X7, [LR, #112]\n\t"
+            "LDP X8, X9, [LR, #128]\n\t"
+            "LDP X10, X11, [LR, #144]\n\t"
+            "LDP X12, X13, [LR, #160]\n\t"
+            "LDP X14, X15, [LR, #176]\n\t"
+            "LDP X16, X17, [LR, #192]\n\t"
+            "LDP X18, X19, [LR, #208]\n\t"
+            "LDP X20, X21, [LR, #224]\n\t"
+            "LDP X22, X23, [LR, #240]\n\t"
+            "LDP X24, X25, [LR, #256]\n\t"
+            "LDP X26, X27, [LR, #272]\n\t"
+            "LDP X28, X29, [LR, #288]\n\t"
             "LDR LR, [SP], #16"
         );
     }
 
+    /**
+     * @brief Runs the batch of syscalls in the ThreadContext, the batch is stopped at the first syscall that fails
+     */
+    FORCE_INLINE void ExecuteSyscallBatch(volatile ThreadContext *ctx) {
+        for (u32 index = 0; index < ctx->syscallCount; index++) {
+            auto &syscall = ctx->syscalls[index];
+            syscall.result = RawSyscall(syscall.number, syscall.arguments[0], syscall.arguments[1], syscall.arguments[2], syscall.arguments[3], syscall.arguments[4], syscall.arguments[5]);
+            if (syscall.result < 0)
+                break;
+        }
+    }
+
     /**
      * @note Do not use any functions that cannot be inlined from this, as this function is placed at an arbitrary address in the guest. In addition, do not use any static variables or globals as the .bss section is not copied into the guest.
      */
@@ -105,36 +119,15 @@ namespace skyline::guest {
         ctx->pc = pc;
         ctx->svc = svc;
 
-        if (svc == 0x1E) { // svcGetSystemTick
-            asm("STP X1, X2, [SP, #-16]!\n\t"
-                "STR Q0, [SP, #-16]!\n\t"
-                "STR Q1, [SP, #-16]!\n\t"
-                "STR Q2, [SP, #-16]!\n\t"
-                "MRS X1, CNTFRQ_EL0\n\t"
-                "MRS X2, CNTVCT_EL0\n\t"
-                "UCVTF D0, X0\n\t"
-                "MOV X1, 87411174408192\n\t"
-                "MOVK X1, 0x4172, LSL 48\n\t"
-                "FMOV D2, X1\n\t"
-                "UCVTF D1, X1\n\t"
-                "FDIV D0, D0, D2\n\t"
-                "FMUL D0, D0, D1\n\t"
-                "FCVTZU %0, D0\n\t"
-                "LDR Q2, [SP], #16\n\t"
-                "LDR Q1, [SP], #16\n\t"
-                "LDR Q0, [SP], #16\n\t"
-                "LDP X1, X2, [SP], #16"::"r"(ctx->registers.x0));
-            return;
-        }
+        SetThreadState(ctx, ThreadState::WaitKernel);
+        PushKernelRequest(ctx->kernelQueue, ctx->tid);
 
         while (true) {
-            ctx->state = ThreadState::WaitKernel;
+            WaitThreadState(ctx, ThreadState::WaitKernel);
 
-            while (ctx->state == ThreadState::WaitKernel);
-
-            if (ctx->state == ThreadState::WaitRun) {
+            if (GetThreadState(ctx) == ThreadState::WaitRun) {
                 break;
-            } else if (ctx->state == ThreadState::WaitFunc) {
+            } else if (GetThreadState(ctx) == ThreadState::WaitFunc) {
                 if (ctx->threadCall == ThreadCall::Syscall) {
                     SaveCtxStack();
                     LoadCtxTls();
@@ -147,6 +140,8 @@ namespace skyline::guest {
 
                     SaveCtxTls();
                     LoadCtxStack();
+                } else if (ctx->threadCall == ThreadCall::SyscallBatch) {
+                    ExecuteSyscallBatch(ctx);
                 } else if (ctx->threadCall == ThreadCall::Memcopy) {
                     auto src = reinterpret_cast<u8 *>(ctx->registers.x0);
                     auto dest = reinterpret_cast<u8 *>(ctx->registers.x1);
@@ -203,9 +198,12 @@ namespace skyline::guest {
                     LoadCtxStack();
                 }
             }
+
+            // The kernel is still servicing the request after running a function, so only the function caller is woken up rather than the request being pushed again
+            SetThreadState(ctx, ThreadState::WaitKernel);
         }
 
-        ctx->state = ThreadState::Running;
+        StoreRelease(reinterpret_cast<volatile u8 *>(&ctx->state), static_cast<u8>(ThreadState::Running));
     }
 
     [[noreturn]] void Exit(int) {
@@ -216,24 +214,61 @@ namespace skyline::guest {
         __builtin_unreachable();
     }
 
-    [[noreturn]] void SignalHandler(int signal, siginfo_t *info, ucontext_t *ucontext) {
+    void SignalHandler(int signal, siginfo_t *info, ucontext_t *ucontext) {
         volatile ThreadContext *ctx;
         asm("MRS %0, TPIDR_EL0":"=r"(ctx));
 
+        // A write to a write-tracked page is resolved in place by making the page writable and marking it as dirty for the kernel to collect, this avoids a round trip to the kernel for the most common deliberate fault
+        // The page is made writable before it's marked so the kernel can't collect it and write-protect it again in between, which would leave it writable without being tracked
+        u64 faultAddress{ucontext->uc_mcontext.fault_address};
+        if (signal == SIGSEGV && ctx->faultTable && faultAddress < constant::FaultTableAddressSpace) {
+            auto page{&ctx->faultTable->pages[faultAddress / constant::FaultTablePageSize]};
+            auto flags{LoadAcquire(page)};
+            if ((flags & (FaultTable::WriteTracked | FaultTable::KernelProtected)) == FaultTable::WriteTracked) {
+                if (MprotectSyscall(faultAddress & ~(constant::FaultTablePageSize - 1), constant::FaultTablePageSize, PROT_READ | PROT_WRITE | ((flags & FaultTable::Executable) ? PROT_EXEC : 0)) == 0) {
+                    AtomicOrRelease(page, FaultTable::Dirty);
+                    return;
+                }
+            }
+        }
+
         for (u8 index = 0; index < 30; index++)
             ctx->registers.regs[index] = ucontext->uc_mcontext.regs[index];
 
         ctx->pc = ucontext->uc_mcontext.pc;
         ctx->signal = static_cast<u32>(signal);
-        ctx->faultAddress = ucontext->uc_mcontext.fault_address;
+        ctx->faultAddress = faultAddress;
         ctx->sp = ucontext->uc_mcontext.sp;
 
-        while (true) {
-            ctx->state = ThreadState::GuestCrash;
+        SetThreadState(ctx, ThreadState::GuestCrash);
+        PushKernelRequest(ctx->kernelQueue, ctx->tid);
 
-            if (ctx->state == ThreadState::WaitRun)
-                Exit(0);
-        }
+        while (GetThreadState(ctx) == ThreadState::GuestCrash)
+            WaitThreadState(ctx, ThreadState::GuestCrash);
+
+        if (GetThreadState(ctx) == ThreadState::WaitRun)
+            Exit(0);
+
+        // The kernel can resolve faults caused by write tracking, in which case it supplies the mprotect calls restoring the region as a syscall batch and the faulting instruction is retried
+        ExecuteSyscallBatch(ctx);
+    }
+
+    /**
+     * @brief Records the location of the thread into its sample ring, the kernel signals running guest threads with SIGPROF when sampling is enabled
+     * @note A sample is dropped if the ring is full, the kernel drains it before every signal so this only happens if it falls behind
+     */
+    void SampleHandler(int, siginfo_t *, ucontext_t *ucontext) {
+        volatile ThreadContext *ctx;
+        asm("MRS %0, TPIDR_EL0":"=r"(ctx));
+
+        u32 write{ctx->sampleWrite};
+        if (write - __atomic_load_n(&ctx->sampleRead, __ATOMIC_ACQUIRE) >= constant::SampleSlots)
+            return;
+
+        auto &sample{ctx->samples[write & (constant::SampleSlots - 1)]};
+        sample.pc = ucontext->uc_mcontext.pc;
+        sample.lr = ucontext->uc_mcontext.regs[30];
+        __atomic_store_n(&ctx->sampleWrite, write + 1, __ATOMIC_RELEASE);
     }
 
     void GuestEntry(u64 address) {
@@ -241,12 +276,12 @@ namespace skyline::guest {
         asm("MRS %0, TPIDR_EL0":"=r"(ctx));
 
         while (true) {
-            ctx->state = ThreadState::WaitInit;
-            while (ctx->state == ThreadState::WaitInit);
+            SetThreadState(ctx, ThreadState::WaitInit);
+            WaitThreadState(ctx, ThreadState::WaitInit);
 
-            if (ctx->state == ThreadState::WaitRun) {
+            if (GetThreadState(ctx) == ThreadState::WaitRun) {
                 break;
-            } else if (ctx->state == ThreadState::WaitFunc) {
+            } else if (GetThreadState(ctx) == ThreadState::WaitFunc) {
                 if (ctx->threadCall == ThreadCall::Syscall) {
                     SaveCtxStack();
                     LoadCtxTls();
@@ -259,6 +294,8 @@ namespace skyline::guest {
 
                     SaveCtxTls();
                     LoadCtxStack();
+                } else if (ctx->threadCall == ThreadCall::SyscallBatch) {
+                    ExecuteSyscallBatch(ctx);
                 }
             } else if (ctx->threadCall == ThreadCall::Memcopy) {
                 auto src = reinterpret_cast<u8 *>(ctx->registers.x0);
@@ -279,13 +316,24 @@ namespace skyline::guest {
         for (int signal : {SIGILL, SIGTRAP, SIGBUS, SIGFPE, SIGSEGV})
             sigaction(signal, &sigact, nullptr);
 
+        // Any futex waits in the SVC handler that are interrupted by a sample are restarted as it's transparent to the guest
+        sigact = {
+            .sa_sigaction = reinterpret_cast<void (*)(int, struct siginfo *, void *)>(reinterpret_cast<void *>(SampleHandler)),
+            .sa_flags = SA_SIGINFO | SA_RESTART,
+        };
+
+        sigaction(SIGPROF, &sigact, nullptr);
+
         sigact = {
             .sa_handler = Exit,
         };
 
         sigaction(SIGTERM, &sigact, nullptr);
 
-        ctx->state = ThreadState::Running;
+        // The default timer slack of 50us is added to every timed wait of a thread, it's lowered to the minimum for guest threads so any host waits they do are only delayed by scheduling latency
+        prctl(PR_SET_TIMERSLACK, 1);
+
+        StoreRelease(reinterpret_cast<volatile u8 *>(&ctx->state), static_cast<u8>(ThreadState::Running));
 
         asm("MOV LR, %0\n\t"
             "MOV X0, %1\n\t"
@@ -9,11 +9,10 @@ namespace skyline {
     namespace guest {
         constexpr size_t SaveCtxSize = 20 * sizeof(u32); //!< The size of the SaveCtx function in 32-bit ARMv8 instructions
         constexpr size_t LoadCtxSize = 20 * sizeof(u32); //!< The size of the LoadCtx function in 32-bit ARMv8 instructions
-        constexpr size_t RescaleClockSize = 16 * sizeof(u32); //!< The size of the RescaleClock function in 32-bit ARMv8 instructions
         #ifdef NDEBUG
-        constexpr size_t SvcHandlerSize = 225 * sizeof(u32); //!< The size of the SvcHandler (Release) function in 32-bit ARMv8 instructions
+        constexpr size_t SvcHandlerSize = 300 * sizeof(u32); //!< The size of the SvcHandler (Release) function in 32-bit ARMv8 instructions
         #else
-        constexpr size_t SvcHandlerSize = 400 * sizeof(u32); //!< The size of the SvcHandler (Debug) function in 32-bit ARMv8 instructions
+        constexpr size_t SvcHandlerSize = 500 * sizeof(u32); //!< The size of the SvcHandler (Debug) function in 32-bit ARMv8 instructions
         #endif
 
         /**
@@ -32,11 +31,6 @@ namespace skyline {
          */
         extern "C" void LoadCtx(void);
 
-        /**
-         * @brief This rescales the clock to Tegra X1 levels and puts the output on stack
-         */
-        extern "C" __noreturn void RescaleClock(void);
-
         /**
          * @brief This is used to handle all SVC calls
          * @param pc The address of PC when the call was being done
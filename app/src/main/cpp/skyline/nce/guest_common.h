@@ -4,6 +4,10 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <ctime>
+#include <asm/unistd.h>
+#include <linux/futex.h>
 
 #define FORCE_INLINE __attribute__((always_inline)) inline // NOLINT(cppcoreguidelines-macro-usage)
 
@@ -142,21 +146,288 @@ namespace skyline {
         Syscall = 1, //!< A linux syscall needs to be called from the guest
         Memcopy = 2, //!< To copy memory from one location to another
         Clone = 3, //!< Use the clone syscall to create a new thread
+        SyscallBatch = 4, //!< A batch of linux syscalls need to be called from the guest
+    };
+
+    namespace constant {
+        constexpr u32 SyscallBatchSize = 0x10; //!< The maximum amount of syscalls in a single batch
+    }
+
+    /**
+     * @brief A single linux syscall in a batch that's run on the guest
+     */
+    struct GuestSyscall {
+        u64 number; //!< The number of the syscall (__NR_*)
+        u64 arguments[6]; //!< The arguments to the syscall in X0-X5
+        i64 result; //!< The value returned by the syscall, negative values are errno codes
+    };
+
+    namespace constant {
+        constexpr u32 KernelQueueSlots = 0x100; //!< The amount of slots in the kernel queue, this must be a power of 2
+    }
+
+    /**
+     * @brief A bounded lock-free MPMC queue of guest threads that are waiting on the kernel, guest threads push their TID onto it and it's popped by the pool of kernel workers
+     * @note It's mapped at the same address in the kernel and guest process, all accesses to it must be atomic as it's shared across processes
+     * @note The per-slot sequence numbers are from https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+     */
+    struct KernelQueue {
+        struct Slot {
+            u32 sequence; //!< The position this slot is written at next by a producer, it's advanced by one once the slot has been written to
+            u32 tid; //!< The TID of the guest thread which pushed the request
+        };
+
+        u32 end; //!< The position that the next request is pushed at
+        u32 doorbell; //!< A futex that's incremented after every request is pushed, idle workers sleep on this
+        u32 sleepers; //!< The amount of workers sleeping on the doorbell, the guest only wakes the doorbell if this is non-zero
+        u32 _pad0_[13];
+        u32 start; //!< The position that the next request is popped from, it's on a separate cache line as it's only accessed by the kernel
+        u32 _pad1_[15];
+        Slot slots[constant::KernelQueueSlots];
+    };
+
+    namespace constant {
+        constexpr u64 FaultTablePageSize = 0x1000; //!< The size of a page in the fault table, this is the host page size
+        constexpr u64 FaultTableAddressSpace = 1ULL << 39; //!< The size of the guest address space covered by the fault table, this is the largest address space a guest can have
+    }
+
+    /**
+     * @brief A table holding the state of every page in the guest address space, the guest's signal handler uses it to resolve faults the kernel causes deliberately without a round trip to the kernel
+     * @note It's mapped at the same address in the kernel and guest process like KernelQueue, all accesses to it must be atomic as it's shared across processes
+     * @note Any fault that the table doesn't resolve is handed to the kernel as a GuestCrash, this is the path that genuine crashes take
+     */
+    struct FaultTable {
+        /**
+         * @brief The flags of a single page in the table
+         */
+        enum PageFlags : u8 {
+            WriteTracked = 1 << 0, //!< The page is write-protected to track writes to it, a write fault on it makes it writable and sets Dirty directly in the guest
+            Dirty = 1 << 1, //!< A write fault on the page was resolved by the guest since the kernel last collected it
+            KernelProtected = 1 << 2, //!< The page is protected for a reason only the kernel can handle (Such as a render target needing to be flushed), faults on it always go through the kernel
+            Executable = 1 << 3, //!< The page was executable before it was write-protected, resolving a write fault on it restores PROT_EXEC as well
+        };
+
+        u8 pages[constant::FaultTableAddressSpace / constant::FaultTablePageSize];
+    };
+
+    namespace constant {
+        constexpr u32 SampleSlots = 0x40; //!< The amount of slots in the sample ring of a thread, this must be a power of 2
+    }
+
+    /**
+     * @brief A sample of the location a guest thread was executing at, this is written by the guest on a profiling signal
+     */
+    struct GuestSample {
+        u64 pc; //!< The program counter at the time of the sample
+        u64 lr; //!< The link register at the time of the sample, this is only the caller of the sampled function if it hasn't spilled LR yet or is a leaf
     };
 
     /**
      * @brief This structure holds the context of a thread during kernel calls
+     * @note The handshake word is on a cache line of its own as it's polled by the kernel while the guest is writing its registers, the registers start on the next line so every STP in SaveCtx/LoadCtx is to a single line
+     * @note SaveCtx/LoadCtx hardcode the offset of the registers and the TLS patches hardcode the offsets of tpidrroEl0 and tpidrEl0, these are checked with static assertions below
      */
-    struct ThreadContext {
-        ThreadState state; //!< The state of the guest
-        ThreadCall threadCall; //!< The function to run in the guest process
-        u16 svc; //!< The SVC ID of the current kernel call
-        u32 signal; //!< The signal caught by the guest process
-        u64 pc; //!< The program counter register on the guest
+    struct alignas(64) ThreadContext {
+        union {
+            struct {
+                ThreadState state; //!< The state of the guest, this is always stored with release ordering and loaded with acquire ordering
+                ThreadCall threadCall; //!< The function to run in the guest process
+                u16 svc; //!< The SVC ID of the current kernel call
+            };
+            u32 futex; //!< The 32-bit word aliasing the fields above, it's used as a futex to wait on changes to the state
+        };
+        u32 _pad0_[15];
         Registers registers; //!< The general purpose registers on the guest
+        u64 pc; //!< The program counter register on the guest, for SVCs this is the return address into the patch section stub of the site
         u64 tpidrroEl0; //!< The value for TPIDRRO_EL0 for the current thread
         u64 tpidrEl0; //!< The value for TPIDR_EL0 for the current thread
-        u64 faultAddress; //!< The address a fault has occurred at during guest crash
         u64 sp; //!< The current location of the stack pointer set during guest crash
+        u64 faultAddress; //!< The address a fault has occurred at during guest crash
+        u32 signal; //!< The signal caught by the guest process
+        u32 tid; //!< The TID of the thread, this is what's pushed onto the kernel queue
+        KernelQueue *kernelQueue; //!< The queue that the thread pushes itself onto when it's waiting on the kernel
+        FaultTable *faultTable; //!< The table that the thread's signal handler resolves deliberate faults with
+        u32 syscallCount; //!< The amount of syscalls in the batch for ThreadCall::SyscallBatch
+        GuestSyscall syscalls[constant::SyscallBatchSize]; //!< The batch of syscalls for ThreadCall::SyscallBatch
+        u32 sampleWrite; //!< The position that the next sample is written at, this is only written to by the guest
+        u32 sampleRead; //!< The position that the next sample is read from, this is only written to by the kernel
+        GuestSample samples[constant::SampleSlots]; //!< A single-producer single-consumer ring of samples taken by the guest's profiling signal handler
     };
+    static_assert(offsetof(ThreadContext, registers) == 0x40);
+    static_assert(offsetof(ThreadContext, tpidrroEl0) == 0x138);
+    static_assert(offsetof(ThreadContext, tpidrEl0) == 0x140);
+
+    namespace constant {
+        constexpr u32 StateSpinCount = 0x200; //!< The amount of times the state is polled before a thread sleeps on the ThreadContext futex
+    }
+
+    /**
+     * @brief This does a raw futex syscall on a word inside a ThreadContext
+     * @param address The address of the futex word
+     * @param operation The futex operation to perform
+     * @param value The value used by the operation (The expected value for FUTEX_WAIT or the amount of waiters for FUTEX_WAKE)
+     * @param timeout The timeout for FUTEX_WAIT (nullptr means an infinite timeout)
+     * @return The value returned by the syscall, negative values are errno codes
+     * @note This uses an SVC directly rather than libc as it is also inlined into guest code which cannot call any functions
+     * @note The futex is not private as ThreadContext is mapped into both the kernel and guest process
+     */
+    FORCE_INLINE i64 FutexSyscall(volatile u32 *address, u32 operation, u32 value, const timespec *timeout = nullptr) {
+        register u64 x0 asm("x0") = reinterpret_cast<u64>(address);
+        register u64 x1 asm("x1") = operation;
+        register u64 x2 asm("x2") = value;
+        register u64 x3 asm("x3") = reinterpret_cast<u64>(timeout);
+        register u64 x8 asm("x8") = __NR_futex;
+        asm volatile("SVC #0" : "+r"(x0) : "r"(x1), "r"(x2), "r"(x3), "r"(x8) : "memory");
+        return static_cast<i64>(x0);
+    }
+
+    /**
+     * @brief This does a raw syscall with an arbitrary number and arguments
+     * @return The value returned by the syscall, negative values are errno codes
+     * @note This uses an SVC directly rather than libc for the same reasons as FutexSyscall
+     */
+    FORCE_INLINE i64 RawSyscall(u64 number, u64 arg0, u64 arg1, u64 arg2, u64 arg3, u64 arg4, u64 arg5) {
+        register u64 x0 asm("x0") = arg0;
+        register u64 x1 asm("x1") = arg1;
+        register u64 x2 asm("x2") = arg2;
+        register u64 x3 asm("x3") = arg3;
+        register u64 x4 asm("x4") = arg4;
+        register u64 x5 asm("x5") = arg5;
+        register u64 x8 asm("x8") = number;
+        asm volatile("SVC #0" : "+r"(x0) : "r"(x1), "r"(x2), "r"(x3), "r"(x4), "r"(x5), "r"(x8) : "memory");
+        return static_cast<i64>(x0);
+    }
+
+    /**
+     * @brief This does a raw mprotect syscall to change the protection of guest memory
+     * @param address The address of the first page to change the protection of
+     * @param size The size of the region in bytes
+     * @param protection The new protection of the region (PROT_*)
+     * @return The value returned by the syscall, negative values are errno codes
+     * @note This uses an SVC directly rather than libc for the same reasons as FutexSyscall
+     */
+    FORCE_INLINE i64 MprotectSyscall(u64 address, u64 size, u64 protection) {
+        register u64 x0 asm("x0") = address;
+        register u64 x1 asm("x1") = size;
+        register u64 x2 asm("x2") = protection;
+        register u64 x8 asm("x8") = __NR_mprotect;
+        asm volatile("SVC #0" : "+r"(x0) : "r"(x1), "r"(x2), "r"(x8) : "memory");
+        return static_cast<i64>(x0);
+    }
+
+    /**
+     * @brief Atomically adds a value to a 32-bit word with sequentially-consistent ordering
+     * @return The value of the word prior to the addition
+     * @note This uses an exclusive load/store loop directly as the compiler may outline atomics into library calls, which cannot be done from guest code
+     */
+    FORCE_INLINE u32 AtomicFetchAdd(volatile u32 *address, u32 value) {
+        u32 result, sum, status;
+        asm volatile("1:\n\t"
+                     "LDAXR %w0, [%3]\n\t"
+                     "ADD %w1, %w0, %w4\n\t"
+                     "STLXR %w2, %w1, [%3]\n\t"
+                     "CBNZ %w2, 1b" : "=&r"(result), "=&r"(sum), "=&r"(status) : "r"(address), "r"(value) : "memory");
+        return result;
+    }
+
+    /**
+     * @brief Atomically ORs a value into a byte with release ordering
+     * @note This uses an exclusive load/store loop directly for the same reasons as AtomicFetchAdd
+     */
+    FORCE_INLINE void AtomicOrRelease(volatile u8 *address, u8 value) {
+        u32 result, status;
+        asm volatile("1:\n\t"
+                     "LDXRB %w0, [%2]\n\t"
+                     "ORR %w0, %w0, %w3\n\t"
+                     "STLXRB %w1, %w0, [%2]\n\t"
+                     "CBNZ %w1, 1b" : "=&r"(result), "=&r"(status) : "r"(address), "r"(static_cast<u32>(value)) : "memory");
+    }
+
+    /**
+     * @brief Loads a byte with acquire ordering
+     */
+    FORCE_INLINE u8 LoadAcquire(volatile u8 *address) {
+        u32 value;
+        asm volatile("LDARB %w0, [%1]" : "=r"(value) : "r"(address) : "memory");
+        return static_cast<u8>(value);
+    }
+
+    /**
+     * @brief Loads a 32-bit word with acquire ordering
+     */
+    FORCE_INLINE u32 LoadAcquire(volatile u32 *address) {
+        u32 value;
+        asm volatile("LDAR %w0, [%1]" : "=r"(value) : "r"(address) : "memory");
+        return value;
+    }
+
+    /**
+     * @brief Stores a byte with release ordering
+     */
+    FORCE_INLINE void StoreRelease(volatile u8 *address, u8 value) {
+        asm volatile("STLRB %w0, [%1]" : : "r"(static_cast<u32>(value)), "r"(address) : "memory");
+    }
+
+    /**
+     * @brief Stores a 32-bit word with release ordering
+     */
+    FORCE_INLINE void StoreRelease(volatile u32 *address, u32 value) {
+        asm volatile("STLR %w0, [%1]" : : "r"(value), "r"(address) : "memory");
+    }
+
+    /**
+     * @brief Pushes a guest thread onto the kernel queue and wakes up a worker if they're all asleep
+     * @param queue The kernel queue to push onto
+     * @param tid The TID of the guest thread, its ThreadContext must already be in the state it needs to be serviced in
+     * @note A guest thread only has a single outstanding request, a slot can only be occupied when this is called if a worker is still reading it from the prior lap in which case it's polled till it's free
+     */
+    FORCE_INLINE void PushKernelRequest(volatile KernelQueue *queue, u32 tid) {
+        auto position = AtomicFetchAdd(&queue->end, 1);
+        auto &slot = queue->slots[position & (constant::KernelQueueSlots - 1)];
+        while (LoadAcquire(&slot.sequence) != position)
+            asm volatile("YIELD");
+
+        slot.tid = tid;
+        StoreRelease(&slot.sequence, position + 1);
+
+        AtomicFetchAdd(&queue->doorbell, 1);
+        if (LoadAcquire(&queue->sleepers))
+            FutexSyscall(&queue->doorbell, FUTEX_WAKE, 1);
+    }
+
+    /**
+     * @return The state of a thread, this is loaded with acquire ordering so all writes to the context prior to the state being set are visible
+     */
+    FORCE_INLINE ThreadState GetThreadState(volatile ThreadContext *ctx) {
+        return static_cast<ThreadState>(LoadAcquire(reinterpret_cast<volatile u8 *>(&ctx->state)));
+    }
+
+    /**
+     * @brief This sets the state of a thread and wakes up everything waiting on it
+     * @param ctx The ThreadContext of the thread
+     * @param state The new state of the thread
+     * @note The state is stored with release ordering so all prior writes to the context (Such as the registers) are visible to whoever observes the new state
+     */
+    FORCE_INLINE void SetThreadState(volatile ThreadContext *ctx, ThreadState state) {
+        StoreRelease(reinterpret_cast<volatile u8 *>(&ctx->state), static_cast<u8>(state));
+        FutexSyscall(&ctx->futex, FUTEX_WAKE, INT32_MAX);
+    }
+
+    /**
+     * @brief This blocks the calling thread while a ThreadContext is in a specific state
+     * @param ctx The ThreadContext of the thread
+     * @param state The state to wait on changing
+     * @note The state is polled for a short duration prior to sleeping so that quick transitions (Such as SVCs) don't incur the futex latency
+     */
+    FORCE_INLINE void WaitThreadState(volatile ThreadContext *ctx, ThreadState state) {
+        for (u32 spin{}; spin < constant::StateSpinCount; spin++) {
+            if (GetThreadState(ctx) != state)
+                return;
+            asm volatile("YIELD");
+        }
+
+        u32 word;
+        while (static_cast<ThreadState>((word = LoadAcquire(&ctx->futex)) & 0xFF) == state)
+            FutexSyscall(&ctx->futex, FUTEX_WAIT, word);
+    }
 }
@@ -56,6 +56,9 @@ namespace skyline {
                 return (sig0 == 0x1 && sig1 == 0x6A0);
             }
 
+            static constexpr u32 Mask{0xFFE0001F}; //!< The bits that are fixed in every SVC instruction
+            static constexpr u32 Signature{0xD4000001}; //!< The value of the fixed bits of a SVC instruction, an instruction is a SVC if its bits under Mask match this
+
             union {
                 struct {
                     u8 sig0   : 5;  //!< 5-bit signature (0x0)
@@ -90,6 +93,9 @@ namespace skyline {
                 return (sig == 0xD53);
             }
 
+            static constexpr u32 Mask{0xFFF00000}; //!< The bits that are fixed in every MRS instruction
+            static constexpr u32 Signature{0xD5300000}; //!< The value of the fixed bits of a MRS instruction, an instruction is a MRS if its bits under Mask match this
+
             union {
                 struct {
                     u8 destReg  : 5; //!< 5-bit destination register
@@ -113,6 +119,9 @@ namespace skyline {
                 return (sig == 0xD51);
             }
 
+            static constexpr u32 Mask{0xFFF00000}; //!< The bits that are fixed in every MSR instruction
+            static constexpr u32 Signature{0xD5100000}; //!< The value of the fixed bits of a MSR instruction, an instruction is a MSR if its bits under Mask match this
+
             union {
                 struct {
                     u8 srcReg  : 5; //!< 5-bit destination register
@@ -1,37 +1,123 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <sys/stat.h>
+#include <fcntl.h>
 #include "vfs/os_backing.h"
+#include "vfs/metadata_cache.h"
+#include "vfs/layered_filesystem.h"
 #include "loader/nro.h"
 #include "loader/nso.h"
 #include "loader/nca.h"
 #include "loader/nsp.h"
+#include "loader/xci.h"
 #include "nce/guest.h"
+#include "gpu.h"
+#include "boot_report.h"
+#include "sampling_profiler.h"
 #include "os.h"
 
 namespace skyline::kernel {
-    OS::OS(std::shared_ptr<JvmManager> &jvmManager, std::shared_ptr<Logger> &logger, std::shared_ptr<Settings> &settings, const std::string &appFilesPath) : state(this, process, jvmManager, settings, logger), memory(state), serviceManager(state), appFilesPath(appFilesPath) {}
+    OS::OS(std::shared_ptr<JvmManager> &jvmManager, std::shared_ptr<Logger> &logger, std::shared_ptr<Settings> &settings, const std::string &appFilesPath) : state(this, process, jvmManager, settings, logger), memory(state), serviceManager(state), appFilesPath(appFilesPath), saveStates(state, appFilesPath + "states/") {}
 
     void OS::Execute(int romFd, loader::RomFormat romType) {
         auto romFile{std::make_shared<vfs::OsBacking>(romFd)};
-        auto keyStore{std::make_shared<crypto::KeyStore>(appFilesPath)};
+        std::shared_ptr<crypto::KeyStore> keyStore;
+        {
+            boot::ScopedPhase phase(boot::Phase::KeyStore);
+            keyStore = crypto::KeyStore::Get(appFilesPath);
+        }
+
+        // The metadata cache is purely an optimization, the ROM is still loaded without it if it can't be used. An NRO has no metadata of its own but the index of RomFS overrides applied to its asset RomFS is cached
+        std::shared_ptr<vfs::MetadataCache> metadataCache;
+        if (romType == loader::RomFormat::NRO || romType == loader::RomFormat::NCA || romType == loader::RomFormat::NSP || romType == loader::RomFormat::XCI) {
+            try {
+                metadataCache = std::make_shared<vfs::MetadataCache>(appFilesPath + "metadata_cache/", romFd);
+            } catch (const std::exception &e) {
+                state.logger->Warn("Failed to open the metadata cache: {}", e.what());
+            }
+        }
 
         if (romType == loader::RomFormat::NRO) {
             state.loader = std::make_shared<loader::NroLoader>(romFile);
         } else if (romType == loader::RomFormat::NSO) {
             state.loader = std::make_shared<loader::NsoLoader>(romFile);
         } else if (romType == loader::RomFormat::NCA) {
-            state.loader = std::make_shared<loader::NcaLoader>(romFile, keyStore);
+            state.loader = std::make_shared<loader::NcaLoader>(romFile, keyStore, metadataCache, state.settings->Get().verifyIntegrity);
         } else if (romType == loader::RomFormat::NSP) {
-            state.loader = std::make_shared<loader::NspLoader>(romFile, keyStore);
+            state.loader = std::make_shared<loader::NspLoader>(romFile, keyStore, metadataCache, state.settings->Get().verifyIntegrity);
+        } else if (romType == loader::RomFormat::XCI) {
+            state.loader = std::make_shared<loader::XciLoader>(romFile, keyStore, metadataCache, state.settings->Get().verifyIntegrity);
         } else {
             throw exception("Unsupported ROM extension.");
         }
 
-        process = CreateProcess(constant::BaseAddress, 0, constant::DefStackSize);
+        // An update for the title is applied over it if one is present, updates are looked up by the application ID of the title so the ROM itself never needs to be modified
+        if ((romType == loader::RomFormat::NSP || romType == loader::RomFormat::XCI) && state.loader->nacp) {
+            auto updatePath{fmt::format("{}updates/{:016X}.nsp", appFilesPath, state.loader->nacp->nacpContents.saveDataOwnerId)};
+            int updateFd{open(updatePath.c_str(), O_RDONLY | O_CLOEXEC)};
+            if (updateFd >= 0) {
+                try {
+                    static_cast<loader::NspLoader &>(*state.loader).ApplyUpdate(std::make_shared<vfs::OsBacking>(updateFd, true), keyStore);
+                    state.logger->Info("Applied the update in {}", updatePath);
+                } catch (const std::exception &e) {
+                    state.logger->Warn("Failed to apply the update in {}: {}", updatePath, e.what());
+                }
+            }
+        }
+
+        // Mods replace files of the title by placing them in its override directory, the merged RomFS is resolved here once so the guest never causes the directory to be probed
+        if (state.loader->romFs && state.loader->nacp) {
+            auto overridePath{fmt::format("{}mods/{:016X}/romfs/", appFilesPath, state.loader->nacp->nacpContents.saveDataOwnerId)};
+            struct stat overrideStat{};
+            if (!stat(overridePath.c_str(), &overrideStat) && S_ISDIR(overrideStat.st_mode)) {
+                try {
+                    vfs::LayeredFileSystem layeredFs(state.loader->romFs, overridePath, metadataCache, "layeredfs");
+                    state.loader->romFs = layeredFs.OpenRomFs();
+                    state.logger->Info("Applied the RomFS overrides in {}", overridePath);
+                } catch (const std::exception &e) {
+                    state.logger->Warn("Failed to apply the RomFS overrides in {}: {}", overridePath, e.what());
+                }
+            }
+        }
+
+        if (metadataCache) {
+            try {
+                metadataCache->Save();
+            } catch (const std::exception &e) {
+                state.logger->Warn("Failed to write the metadata cache: {}", e.what());
+            }
+        }
+
+        // Shaders translated on previous runs of the title are loaded before it starts so they're available for its first draws
+        if (state.loader->nacp) {
+            try {
+                boot::ScopedPhase phase(boot::Phase::ShaderCache);
+                state.gpu->shaderCache.Load(appFilesPath + "shader_cache/", state.loader->nacp->nacpContents.saveDataOwnerId);
+            } catch (const std::exception &e) {
+                state.logger->Warn("Failed to load the shader cache: {}", e.what());
+            }
+        }
+
+        {
+            boot::ScopedPhase phase(boot::Phase::MemoryMapping);
+            process = CreateProcess(constant::BaseAddress, 0, constant::DefStackSize);
+        }
+        serviceManager.PrewarmServices(); // The services are constructed while the loader is patching the executables
         state.loader->LoadProcessData(process, state);
-        process->InitializeMemory();
-        process->threads.at(process->pid)->Start(); // The kernel itself is responsible for starting the main thread
+        {
+            boot::ScopedPhase phase(boot::Phase::MemoryMapping);
+            process->InitializeMemory();
+        }
+
+        std::optional<SamplingProfiler> profiler;
+        if (state.settings->Get().guestProfiler) {
+            auto directory{appFilesPath + "profiles/"};
+            mkdir(directory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+            profiler.emplace(state, fmt::format("{}{}.folded", directory, std::time(nullptr)));
+        }
+
+        process->GetThread(process->pid)->Start(); // The kernel itself is responsible for starting the main thread
 
         state.nce->Execute();
     }
@@ -57,11 +143,12 @@ namespace skyline::kernel {
     void OS::KillThread(pid_t pid) {
         if (process->pid == pid) {
             state.logger->Debug("Killing process with PID: {}", pid);
+            std::lock_guard lock(process->threadMutex);
             for (auto &thread: process->threads)
                 thread.second->Kill();
         } else {
             state.logger->Debug("Killing thread with TID: {}", pid);
-            process->threads.at(pid)->Kill();
+            process->GetThread(pid)->Kill();
         }
     }
 }
@@ -12,6 +12,7 @@
 #include "kernel/types/KThread.h"
 #include "services/serviceman.h"
 #include "gpu.h"
+#include "save_state.h"
 
 namespace skyline::kernel {
     /**
@@ -24,6 +25,7 @@ namespace skyline::kernel {
         service::ServiceManager serviceManager; //!< This manages all of the service functions
         MemoryManager memory; //!< The MemoryManager object for this process
         std::string appFilesPath; //!< The full path to the app's files directory
+        savestate::SaveStateWriter saveStates; //!< This captures save states of the guest when they're requested by the frontend
 
         /**
          * @param logger An instance of the Logger class
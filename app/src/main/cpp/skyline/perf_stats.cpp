@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <unistd.h>
+#include <cstdio>
+#include "perf_stats.h"
+
+namespace skyline::perf {
+    PerformanceMonitor Monitor;
+
+    void PerformanceMonitor::UpdateSlowStatistics() {
+        // The 1% low is the frame-time which 99% of recent frames were faster than
+        if (frameTimeCount) {
+            std::array<u32, constant::FrameHistorySize> sorted;
+            std::copy_n(frameTimes.begin(), frameTimeCount, sorted.begin());
+            auto percentile{sorted.begin() + ((frameTimeCount * 99) / 100)};
+            std::nth_element(sorted.begin(), percentile, sorted.begin() + frameTimeCount);
+            lowFrameTime = *percentile;
+        }
+
+        auto callbackTime{audioCallbackTime.load(std::memory_order_relaxed)}, duration{audioTime.load(std::memory_order_relaxed)};
+        if (duration != publishedAudioTime)
+            audioLoad = static_cast<u32>(((callbackTime - publishedAudioCallbackTime) * 1000) / (duration - publishedAudioTime));
+        else
+            audioLoad = 0;
+        publishedAudioCallbackTime = callbackTime;
+        publishedAudioTime = duration;
+
+        if (auto statm{std::fopen("/proc/self/statm", "r")}) {
+            u64 size, resident;
+            if (std::fscanf(statm, "%lu %lu", &size, &resident) == 2)
+                residentSetSize = resident * static_cast<u64>(sysconf(_SC_PAGESIZE));
+            std::fclose(statm);
+        }
+
+        for (size_t subsystem{}; subsystem < subsystemMemory.size(); subsystem++)
+            subsystemMemory[subsystem] = footprint::Get(static_cast<footprint::Subsystem>(subsystem));
+    }
+
+    void PerformanceMonitor::Publish(u64 frameTime, u32 threadCount) {
+        auto frameTimeUs{static_cast<u32>(frameTime / 1000)};
+        if (frameTime) {
+            frameTimes[frameTimeIndex] = frameTimeUs;
+            frameTimeIndex = (frameTimeIndex + 1) % constant::FrameHistorySize;
+            frameTimeCount = std::min(frameTimeCount + 1, constant::FrameHistorySize);
+        }
+
+        std::array<u32, static_cast<size_t>(Timer::Count)> frameTimers;
+        for (size_t timer{}; timer < timers.size(); timer++) {
+            auto value{timers[timer].load(std::memory_order_relaxed)};
+            frameTimers[timer] = static_cast<u32>((value - publishedTimers[timer]) / 1000);
+            publishedTimers[timer] = value;
+        }
+
+        auto contendedLocks{Mutex::ContendedCount.load(std::memory_order_relaxed)}, parkedLocks{Mutex::ParkCount.load(std::memory_order_relaxed)};
+        auto frameContendedLocks{static_cast<u32>(contendedLocks - publishedContendedLocks)}, frameParkedLocks{static_cast<u32>(parkedLocks - publishedParkedLocks)};
+        publishedContendedLocks = contendedLocks;
+        publishedParkedLocks = parkedLocks;
+
+        auto now{util::GetTimeNs()};
+        if (now - slowUpdateTimestamp >= constant::SlowUpdateInterval) {
+            UpdateSlowStatistics();
+            slowUpdateTimestamp = now;
+        }
+
+        auto sequence{block.sequence.load(std::memory_order_relaxed)};
+        block.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        block.frameTime = frameTimeUs;
+        block.lowFrameTime = lowFrameTime;
+        block.svcTime = frameTimers[static_cast<size_t>(Timer::Svc)];
+        block.gpuTime = frameTimers[static_cast<size_t>(Timer::Gpu)];
+        block.presentTime = frameTimers[static_cast<size_t>(Timer::Present)];
+        block.deswizzleTime = frameTimers[static_cast<size_t>(Timer::Deswizzle)];
+        block.audioLoad = audioLoad;
+        block.threadCount = threadCount;
+        block.residentSetSize = residentSetSize;
+        block.subsystemMemory = subsystemMemory;
+        block.contendedLocks = frameContendedLocks;
+        block.parkedLocks = frameParkedLocks;
+
+        block.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    void PerformanceMonitor::Reset() {
+        for (auto &timer : timers)
+            timer.store(0, std::memory_order_relaxed);
+        audioCallbackTime.store(0, std::memory_order_relaxed);
+        audioTime.store(0, std::memory_order_relaxed);
+
+        publishedTimers = {};
+        publishedAudioCallbackTime = 0;
+        publishedAudioTime = 0;
+        publishedContendedLocks = Mutex::ContendedCount.load(std::memory_order_relaxed);
+        publishedParkedLocks = Mutex::ParkCount.load(std::memory_order_relaxed);
+        slowUpdateTimestamp = 0;
+        lowFrameTime = 0;
+        audioLoad = 0;
+        residentSetSize = 0;
+        subsystemMemory = {};
+        frameTimeIndex = 0;
+        frameTimeCount = 0;
+
+        auto sequence{block.sequence.load(std::memory_order_relaxed)};
+        block.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        block.frameTime = block.lowFrameTime = block.svcTime = block.gpuTime = block.presentTime = block.deswizzleTime = block.audioLoad = block.xrunCount = block.threadCount = 0;
+        block.residentSetSize = 0;
+        block.subsystemMemory = {};
+        block.contendedLocks = block.parkedLocks = 0;
+        block.sequence.store(sequence + 2, std::memory_order_release);
+    }
+}
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "footprint.h"
+
+namespace skyline::perf {
+    namespace constant {
+        constexpr size_t FrameHistorySize{600}; //!< The amount of frame-times the 1% low is calculated over
+        constexpr u64 SlowUpdateInterval{1'000'000'000}; //!< The interval at which the statistics that are expensive to gather or noisy are updated in nanoseconds
+    }
+
+    /**
+     * @brief The sources of time that are accumulated by the performance monitor
+     */
+    enum class Timer : u8 {
+        Svc, //!< Time spent on the host servicing SVCs that don't block
+        Gpu, //!< Time spent by the GPFIFO worker processing pushbuffers
+        Present, //!< Time spent presenting frames to the display
+        Deswizzle, //!< Time spent copying textures from and to the guest
+        Count,
+    };
+
+    /**
+     * @brief A block of performance statistics that's shared with the Kotlin frontend through a direct ByteBuffer, the layout of this is mirrored in EmulationActivity
+     * @details This is a seqlock with a single writer, the sequence is odd while the block is being written. Readers retry if the sequence is odd or changes across their read
+     * @note All times are in microseconds and are for the most recently presented frame unless otherwise specified
+     */
+    struct StatisticsBlock {
+        std::atomic<u32> sequence;
+        u32 frameTime; //!< The time between the two most recently presented frames
+        u32 lowFrameTime; //!< The 1% low frame-time over the last FrameHistorySize frames, this is updated every SlowUpdateInterval
+        u32 svcTime;
+        u32 gpuTime;
+        u32 presentTime;
+        u32 deswizzleTime;
+        u32 audioLoad; //!< The time spent in audio callbacks relative to the duration of audio they produced in per-mille, this is updated every SlowUpdateInterval
+        u32 xrunCount; //!< The amount of underruns on the audio stream since it was opened
+        u32 threadCount; //!< The amount of running guest threads
+        u64 residentSetSize; //!< The resident set size of the emulator in bytes, this is updated every SlowUpdateInterval
+        std::array<u64, static_cast<size_t>(footprint::Subsystem::Count)> subsystemMemory; //!< The host memory used by every subsystem in bytes, indexed by footprint::Subsystem and updated every SlowUpdateInterval
+        u32 contendedLocks; //!< The amount of times a Mutex was contended during the frame
+        u32 parkedLocks; //!< The amount of times a thread parked on a contended Mutex during the frame
+    };
+    static_assert(sizeof(StatisticsBlock) == 0x60);
+
+    /**
+     * @brief The PerformanceMonitor class accumulates performance statistics from all threads and publishes them into a StatisticsBlock on every presented frame
+     * @note Accumulation is done with relaxed atomic additions so it never blocks, publishing must only be done by a single thread
+     */
+    class PerformanceMonitor {
+      private:
+        std::array<std::atomic<u64>, static_cast<size_t>(Timer::Count)> timers{}; //!< The total time accumulated by every timer in nanoseconds
+        std::atomic<u64> audioCallbackTime{}; //!< The total time spent in audio callbacks in nanoseconds
+        std::atomic<u64> audioTime{}; //!< The total duration of the audio produced by callbacks in nanoseconds
+
+        std::array<u64, static_cast<size_t>(Timer::Count)> publishedTimers{}; //!< The values of timers when the block was last published
+        u64 publishedAudioCallbackTime{};
+        u64 publishedAudioTime{};
+        u64 publishedContendedLocks{}; //!< The value of Mutex::ContendedCount when the block was last published
+        u64 publishedParkedLocks{}; //!< The value of Mutex::ParkCount when the block was last published
+        u64 slowUpdateTimestamp{}; //!< The time at which the statistics that are updated every SlowUpdateInterval were last updated
+        u32 lowFrameTime{};
+        u32 audioLoad{};
+        u64 residentSetSize{};
+        std::array<u64, static_cast<size_t>(footprint::Subsystem::Count)> subsystemMemory{};
+        std::array<u32, constant::FrameHistorySize> frameTimes{}; //!< A circular buffer of the most recent frame-times in microseconds
+        size_t frameTimeIndex{};
+        size_t frameTimeCount{};
+
+        void UpdateSlowStatistics();
+
+      public:
+        StatisticsBlock block{}; //!< The block the statistics are published into, this must outlive any reader of it so it's only ever a global
+
+        void AddTime(Timer timer, u64 time) {
+            timers[static_cast<size_t>(timer)].fetch_add(time, std::memory_order_relaxed);
+        }
+
+        /**
+         * @param callbackTime The time spent in an audio callback
+         * @param duration The duration of the audio produced by the callback
+         */
+        void AddAudioCallback(u64 callbackTime, u64 duration) {
+            audioCallbackTime.fetch_add(callbackTime, std::memory_order_relaxed);
+            audioTime.fetch_add(duration, std::memory_order_relaxed);
+        }
+
+        void SetXrunCount(u32 count) {
+            __atomic_store_n(&block.xrunCount, count, __ATOMIC_RELAXED);
+        }
+
+        /**
+         * @brief Publishes the statistics of a presented frame into the block
+         * @param frameTime The time since the previous frame was presented in nanoseconds, this is 0 for the first frame
+         * @param threadCount The amount of running guest threads
+         */
+        void Publish(u64 frameTime, u32 threadCount);
+
+        /**
+         * @brief Resets all statistics, this should be done prior to emulation starting
+         */
+        void Reset();
+    };
+
+    extern PerformanceMonitor Monitor; //!< The performance monitor for the emulation session, this is a global as the frontend can read its block at any point
+
+    /**
+     * @brief Adds the time from construction to destruction of this object to a timer of the monitor
+     */
+    class ScopedTimer {
+      private:
+        Timer timer;
+        u64 start;
+
+      public:
+        ScopedTimer(Timer timer) : timer(timer), start(util::GetTimeNs()) {}
+
+        ~ScopedTimer() {
+            Monitor.AddTime(timer, util::GetTimeNs() - start);
+        }
+    };
+}
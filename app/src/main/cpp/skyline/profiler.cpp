@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <cxxabi.h>
+#include <kernel/svc.h>
+#include "profiler.h"
+
+namespace skyline {
+    void CallStatistics::Merge(const CallStatistics &other) {
+        count += other.count;
+        totalTime += other.totalTime;
+        maxTime = std::max(maxTime, other.maxTime);
+        for (size_t bucket{}; bucket < BucketCount; bucket++)
+            buckets[bucket] += other.buckets[bucket];
+    }
+
+    u64 CallStatistics::GetPercentile(double percentile) const {
+        auto target{static_cast<u64>(static_cast<double>(count) * percentile)};
+        u64 accumulated{};
+        for (size_t bucket{}; bucket < BucketCount - 1; bucket++) {
+            accumulated += buckets[bucket];
+            if (accumulated > target)
+                return std::min<u64>(1ULL << (BucketShift + bucket), maxTime);
+        }
+        return maxTime;
+    }
+
+    namespace {
+        std::atomic<u64> nextProfilerId{1};
+
+        /**
+         * @brief The shard of the calling thread along with the profiler it belongs to, this avoids taking the profiler's lock on every call
+         */
+        thread_local struct {
+            u64 profilerId;
+            void *shard;
+        } threadShard{};
+
+        /**
+         * @return The name of a service without its namespace, this is the same as BaseService::GetName
+         */
+        std::string GetServiceName(std::type_index service) {
+            int status{};
+            size_t length{};
+            std::unique_ptr<char, decltype(&std::free)> demangled{abi::__cxa_demangle(service.name(), nullptr, &length, &status), std::free};
+            return (status == 0) ? std::string(demangled.get() + std::char_traits<char>::length("skyline::service::")) : service.name();
+        }
+    }
+
+    CallProfiler::CallProfiler() : id(nextProfilerId.fetch_add(1, std::memory_order_relaxed)) {}
+
+    CallProfiler::Shard &CallProfiler::GetShard() {
+        if (threadShard.profilerId == id) [[likely]]
+            return *static_cast<Shard *>(threadShard.shard);
+
+        std::lock_guard guard(mutex);
+        auto &shard{shards.emplace_back()};
+        threadShard = {id, &shard};
+        return shard;
+    }
+
+    void CallProfiler::RecordSvc(u8 svc, u64 time) {
+        auto &shard{GetShard()};
+        std::lock_guard guard(shard.mutex);
+        shard.svcs[svc].Record(time);
+    }
+
+    void CallProfiler::RecordIpc(std::type_index service, std::string_view function, u64 time) {
+        auto &shard{GetShard()};
+        std::lock_guard guard(shard.mutex);
+        shard.ipcCommands[IpcKey{service, function}].Record(time);
+    }
+
+    std::vector<CallProfiler::Entry> CallProfiler::GetSnapshot() {
+        std::array<CallStatistics, 0x80> svcs{};
+        std::unordered_map<IpcKey, CallStatistics, IpcKey::Hash> ipcCommands;
+        {
+            std::lock_guard guard(mutex);
+            for (auto &shard : shards) {
+                std::lock_guard shardGuard(shard.mutex);
+                for (size_t svc{}; svc < svcs.size(); svc++)
+                    svcs[svc].Merge(shard.svcs[svc]);
+                for (const auto &[key, statistics] : shard.ipcCommands)
+                    ipcCommands[key].Merge(statistics);
+            }
+        }
+
+        std::vector<Entry> entries;
+        for (size_t svc{}; svc < svcs.size(); svc++) {
+            if (!svcs[svc].count)
+                continue;
+            auto name{kernel::svc::SvcNames[svc]};
+            entries.push_back(Entry{name ? fmt::format("svc{}", name) : fmt::format("svc0x{:02X}", svc), svcs[svc]});
+        }
+
+        std::unordered_map<std::type_index, std::string> serviceNames;
+        for (const auto &[key, statistics] : ipcCommands) {
+            auto serviceName{serviceNames.find(key.service)};
+            if (serviceName == serviceNames.end())
+                serviceName = serviceNames.emplace(key.service, GetServiceName(key.service)).first;
+            entries.push_back(Entry{fmt::format("{}::{}", serviceName->second, key.function), statistics});
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.statistics.totalTime > b.statistics.totalTime;
+        });
+        return entries;
+    }
+
+    std::string CallProfiler::Format(const std::vector<Entry> &entries, size_t limit) {
+        std::string output;
+        size_t index{};
+        for (; index < entries.size() && index < limit; index++) {
+            const auto &[name, statistics]{entries[index]};
+            fmt::format_to(std::back_inserter(output), "{}: {} calls, {:.3f}ms total, {}ns average, {}ns p50, {}ns p99, {}ns max\n", name, statistics.count, static_cast<double>(statistics.totalTime) / constant::NsInMillisecond, statistics.totalTime / statistics.count, statistics.GetPercentile(0.5), statistics.GetPercentile(0.99), statistics.maxTime);
+        }
+
+        if (index < entries.size()) {
+            CallStatistics remaining{};
+            for (; index < entries.size(); index++)
+                remaining.Merge(entries[index].statistics);
+            fmt::format_to(std::back_inserter(output), "{} other calls: {:.3f}ms total\n", remaining.count, static_cast<double>(remaining.totalTime) / constant::NsInMillisecond);
+        }
+
+        return output;
+    }
+
+    void CallProfiler::Log(Logger &logger) {
+        constexpr size_t LoggedEntryCount{32}; //!< The amount of the most expensive calls that are written to the log
+
+        auto entries{GetSnapshot()};
+        if (entries.empty())
+            return;
+
+        logger.Info("Call statistics:\n{}", Format(entries, LoggedEntryCount));
+    }
+}
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <list>
+#include <typeindex>
+#include "common.h"
+
+namespace skyline {
+    /**
+     * @brief The accumulated latency of a single kind of call, the latencies are bucketed into a histogram with power-of-two boundaries
+     */
+    struct CallStatistics {
+        static constexpr size_t BucketCount{16}; //!< The amount of buckets in the histogram, they span from below 1μs to above 16ms
+        static constexpr size_t BucketShift{10}; //!< The log2 of the upper bound of the first bucket in nanoseconds
+
+        u64 count{}; //!< The amount of calls
+        u64 totalTime{}; //!< The total time spent in calls in nanoseconds
+        u64 maxTime{}; //!< The longest time spent in a single call in nanoseconds
+        std::array<u64, BucketCount> buckets{}; //!< The amount of calls which fell into each bucket, a bucket covers twice the range of the one before it
+
+        void Record(u64 time) {
+            count++;
+            totalTime += time;
+            maxTime = std::max(maxTime, time);
+
+            size_t bucket{time >> BucketShift ? static_cast<size_t>(64 - __builtin_clzll(time >> BucketShift)) : 0};
+            buckets[std::min(bucket, BucketCount - 1)]++;
+        }
+
+        void Merge(const CallStatistics &other);
+
+        /**
+         * @return The upper bound of the bucket which contains the supplied percentile of calls in nanoseconds, this is the maximum time for the last bucket
+         */
+        u64 GetPercentile(double percentile) const;
+    };
+
+    /**
+     * @brief The CallProfiler class keeps always-on counters and latency histograms for every SVC and IPC command
+     * @note Every thread records into its own shard so recording is uncontended, shards are only merged when a snapshot is taken
+     */
+    class CallProfiler {
+      private:
+        struct IpcKey {
+            std::type_index service; //!< The type of the service, this is used rather than its name as it's cheap to obtain
+            std::string_view function; //!< The name of the function, this points into the static dispatch table of the service
+
+            bool operator==(const IpcKey &) const = default;
+
+            struct Hash {
+                size_t operator()(const IpcKey &key) const {
+                    return key.service.hash_code() ^ std::hash<const void *>{}(key.function.data());
+                }
+            };
+        };
+
+        struct Shard {
+            std::mutex mutex; //!< Synchronizes the owning thread with snapshots, it's uncontended otherwise
+            std::array<CallStatistics, 0x80> svcs{};
+            std::unordered_map<IpcKey, CallStatistics, IpcKey::Hash> ipcCommands;
+        };
+
+        u64 id; //!< A unique ID for this profiler, this is used to detect cached shards of a previous profiler on the same thread
+        std::mutex mutex; //!< Synchronizes the creation of shards with snapshots
+        std::list<Shard> shards; //!< The shards of all threads that have recorded calls, these outlive their threads as their statistics are still relevant
+
+        /**
+         * @return The shard of the calling thread, it's created if this is the first call the thread records
+         */
+        Shard &GetShard();
+
+      public:
+        /**
+         * @brief The merged statistics of a single kind of call
+         */
+        struct Entry {
+            std::string name; //!< The name of the SVC or the service and function of the IPC command
+            CallStatistics statistics;
+        };
+
+        CallProfiler();
+
+        void RecordSvc(u8 svc, u64 time);
+
+        void RecordIpc(std::type_index service, std::string_view function, u64 time);
+
+        /**
+         * @return The merged statistics of all calls that have been recorded, sorted by the total time spent in them
+         */
+        std::vector<Entry> GetSnapshot();
+
+        /**
+         * @return A human-readable table of the supplied entries with one line for each of them
+         * @param limit The maximum amount of entries to include, the rest are summarised in a single line
+         */
+        static std::string Format(const std::vector<Entry> &entries, size_t limit = std::numeric_limits<size_t>::max());
+
+        /**
+         * @brief Writes the statistics of the most expensive calls to the log
+         */
+        void Log(Logger &logger);
+    };
+}
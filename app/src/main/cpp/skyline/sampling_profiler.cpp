@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <elf.h>
+#include <csignal>
+#include <fstream>
+#include <map>
+#include <cxxabi.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <kernel/types/KProcess.h>
+#include <loader/loader.h>
+#include "sampling_profiler.h"
+
+namespace skyline {
+    SamplingProfiler::SamplingProfiler(const DeviceState &state, std::string path) : state(state), path(std::move(path)), thread(&SamplingProfiler::Run, this) {}
+
+    SamplingProfiler::~SamplingProfiler() {
+        {
+            std::lock_guard lock(mutex);
+            exit = true;
+        }
+        exitConditional.notify_all();
+        thread.join();
+
+        try {
+            Write();
+            state.logger->Info("Wrote {} guest samples to {}", sampleCount, path);
+        } catch (const std::exception &e) {
+            state.logger->Warn("Failed to write the guest profile: {}", e.what());
+        }
+    }
+
+    void SamplingProfiler::Run() {
+        auto &process{state.process}; // The process is created prior to the profiler and outlives it
+        std::unique_lock lock(mutex);
+        while (!exitConditional.wait_for(lock, std::chrono::nanoseconds(constant::SampleInterval), [this] { return exit; })) {
+            std::lock_guard threadLock(process->threadMutex);
+            for (auto &[tid, guestThread] : process->threads) {
+                if (guestThread->status != kernel::type::KThread::Status::Running)
+                    continue;
+
+                auto ctx{reinterpret_cast<volatile ThreadContext *>(guestThread->ctxMemory->kernel.address)};
+                auto write{__atomic_load_n(&ctx->sampleWrite, __ATOMIC_ACQUIRE)};
+                for (auto read{ctx->sampleRead}; read != write; read++) {
+                    auto &sample{ctx->samples[read & (constant::SampleSlots - 1)]};
+                    u64 pc{sample.pc}, lr{sample.lr};
+                    samples[pc][lr]++;
+                    sampleCount++;
+                }
+                __atomic_store_n(&ctx->sampleRead, write, __ATOMIC_RELEASE);
+
+                // Threads waiting on the kernel aren't executing guest code, so they aren't sampled
+                if (GetThreadState(ctx) == ThreadState::Running)
+                    syscall(__NR_tgkill, process->pid, tid, SIGPROF);
+            }
+        }
+    }
+
+    void SamplingProfiler::Write() {
+        struct Symbol {
+            u64 address;
+            u64 size; //!< The size of the function, the symbol covers everything up to the next one if this is 0
+            std::string name;
+        };
+
+        // The dynamic symbol tables are still in guest memory, so functions are resolved from them after all samples have been taken
+        const auto &modules{state.loader->modules};
+        std::vector<std::vector<Symbol>> moduleSymbols(modules.size());
+        for (size_t index{}; index < modules.size(); index++) {
+            const auto &module{modules[index]};
+            auto symbols{state.process->GetPointer<Elf64_Sym>(module.dynsym)};
+            auto strings{state.process->GetPointer<char>(module.dynstr)};
+            if (!module.dynsymSize || !module.dynstrSize || !symbols || !strings)
+                continue;
+
+            auto &resolved{moduleSymbols[index]};
+            for (size_t symbol{}; symbol < module.dynsymSize / sizeof(Elf64_Sym); symbol++) {
+                const auto &entry{symbols[symbol]};
+                if (ELF64_ST_TYPE(entry.st_info) != STT_FUNC || !entry.st_value || entry.st_name >= module.dynstrSize)
+                    continue;
+
+                std::string name(strings + entry.st_name, strnlen(strings + entry.st_name, module.dynstrSize - entry.st_name));
+                int status;
+                if (auto demangled{abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status)}) {
+                    name = demangled;
+                    std::free(demangled);
+                }
+                std::replace(name.begin(), name.end(), ';', ':'); // Semicolons separate frames in the folded format
+                resolved.push_back(Symbol{module.base + entry.st_value, entry.st_size, std::move(name)});
+            }
+            std::sort(resolved.begin(), resolved.end(), [](const Symbol &a, const Symbol &b) { return a.address < b.address; });
+        }
+
+        std::unordered_map<u64, std::string> frames; //!< A cache of the frame names of addresses
+        auto getFrame{[&](u64 address) -> const std::string & {
+            auto [frame, inserted]{frames.try_emplace(address)};
+            if (!inserted)
+                return frame->second;
+
+            auto module{std::find_if(modules.begin(), modules.end(), [address](const loader::Module &module) { return address >= module.base && address < module.base + module.size; })};
+            if (module == modules.end()) {
+                frame->second = "[unknown]";
+            } else if (address >= module->base + module->patchOffset) {
+                frame->second = fmt::format("{}![patch]", module->name);
+            } else {
+                const auto &symbols{moduleSymbols[static_cast<size_t>(std::distance(modules.begin(), module))]};
+                auto symbol{std::upper_bound(symbols.begin(), symbols.end(), address, [](u64 address, const Symbol &symbol) { return address < symbol.address; })};
+                if (symbol != symbols.begin() && (!std::prev(symbol)->size || address < std::prev(symbol)->address + std::prev(symbol)->size))
+                    frame->second = fmt::format("{}!{}", module->name, std::prev(symbol)->name);
+                else
+                    frame->second = fmt::format("{}+0x{:X}", module->name, address - module->base);
+            }
+            return frame->second;
+        }};
+
+        std::map<std::string, u64> stacks;
+        for (const auto &[pc, callers] : samples)
+            for (const auto &[lr, count] : callers)
+                stacks[fmt::format("{};{}", getFrame(lr), getFrame(pc))] += count;
+
+        std::ofstream file(path, std::ios::trunc);
+        if (!file)
+            throw exception("Failed to open {}", path);
+        for (const auto &[stack, count] : stacks)
+            file << stack << ' ' << count << '\n';
+    }
+}
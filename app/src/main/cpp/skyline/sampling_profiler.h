@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <thread>
+#include <condition_variable>
+#include "common.h"
+
+namespace skyline {
+    namespace constant {
+        constexpr u64 SampleInterval{1'000'000}; //!< The interval at which running guest threads are sampled in nanoseconds
+    }
+
+    /**
+     * @brief The SamplingProfiler class periodically samples the PC and LR of all running guest threads and writes them out as a flamegraph-compatible profile
+     * @details Threads are sent SIGPROF and record their location into the sample ring in their ThreadContext, which is drained by the sampling thread. The profile is written in the folded stack format (https://github.com/brendangregg/FlameGraph) with every sample being a two-frame stack of the function containing LR and the one containing PC, resolved with the dynamic symbols of the loaded executables
+     * @note LR is only the caller of the sampled function while it hasn't been overwritten, so the caller frames are approximate
+     */
+    class SamplingProfiler {
+      private:
+        const DeviceState &state;
+        std::string path; //!< The path of the file the profile is written to
+        std::unordered_map<u64, std::unordered_map<u64, u64>> samples; //!< A map from a PC to a map from an LR to the amount of samples taken with them
+        u64 sampleCount{}; //!< The total amount of samples taken
+        std::mutex mutex; //!< This mutex is used with exitConditional
+        std::condition_variable exitConditional;
+        bool exit{};
+        std::thread thread; //!< The sampling thread, this is declared last so it's started after all other members are initialized
+
+        /**
+         * @brief The entry point of the sampling thread, it drains the rings and signals running threads every SampleInterval
+         */
+        void Run();
+
+        /**
+         * @brief Resolves the samples into symbols and writes the profile to the path
+         */
+        void Write();
+
+      public:
+        /**
+         * @param path The path of the file the profile is written to when the profiler is destroyed
+         */
+        SamplingProfiler(const DeviceState &state, std::string path);
+
+        ~SamplingProfiler();
+    };
+}
@@ -0,0 +1,280 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <csignal>
+#include <fstream>
+#include <lz4.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <kernel/types/KProcess.h>
+#include <nce.h>
+#include <gpu.h>
+#include <audio.h>
+#include <os.h>
+#include "save_state.h"
+
+namespace skyline::savestate {
+    std::atomic<bool> Requested{};
+
+    namespace {
+        /**
+         * @return If the supplied thread is stopped or has exited
+         */
+        bool IsStopped(pid_t pid, pid_t tid) {
+            std::ifstream file(fmt::format("/proc/{}/task/{}/stat", pid, tid));
+            if (!file)
+                return true;
+
+            // The state follows the command name which is in parentheses and can contain spaces
+            std::string stat((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            auto end{stat.rfind(')')};
+            if (end == std::string::npos || end + 2 >= stat.size())
+                return true;
+
+            auto threadState{stat[end + 2]};
+            return threadState == 'T' || threadState == 't' || threadState == 'Z' || threadState == 'X';
+        }
+
+        /**
+         * @brief Finds the runs of a chunk that hold data from the holes in the shared memory backing it
+         * @note Residency can't be used for this as pages that were swapped out or written back aren't resident but still hold data, the entire chunk is a single run if the shared memory doesn't support seeking for holes
+         */
+        void FindDataRuns(const kernel::ChunkDescriptor &chunk, std::vector<PageRun> &runs) {
+            auto start{static_cast<off64_t>(chunk.fdOffset)};
+            auto end{start + static_cast<off64_t>(chunk.size)};
+            auto offset{start};
+            if (chunk.fd >= 0) {
+                while (offset < end) {
+                    auto data{lseek64(chunk.fd, offset, SEEK_DATA)};
+                    if (data < 0 && errno == ENXIO)
+                        return; // There's no data past the offset
+                    if (data < 0)
+                        break;
+                    if (data >= end)
+                        return;
+
+                    auto hole{lseek64(chunk.fd, data, SEEK_HOLE)};
+                    if (hole < 0) {
+                        offset = data;
+                        break;
+                    }
+
+                    hole = std::min(hole, end);
+                    runs.push_back(PageRun{static_cast<u64>(data - start), static_cast<u64>(hole - data)});
+                    offset = hole;
+                }
+
+                if (offset >= end)
+                    return;
+            }
+
+            runs.push_back(PageRun{static_cast<u64>(offset - start), static_cast<u64>(end - offset)});
+        }
+    }
+
+    BlockWriter::BlockWriter(std::ofstream &file) : file(file), compressed(static_cast<size_t>(LZ4_compressBound(static_cast<int>(constant::BlockSize)))) {
+        block.reserve(constant::BlockSize);
+    }
+
+    void BlockWriter::Append(const void *data, size_t dataSize) {
+        auto input{reinterpret_cast<const u8 *>(data)};
+        while (dataSize) {
+            auto copySize{std::min<size_t>(dataSize, constant::BlockSize - block.size())};
+            block.insert(block.end(), input, input + copySize);
+            input += copySize;
+            dataSize -= copySize;
+            size += copySize;
+
+            if (block.size() == constant::BlockSize)
+                Flush();
+        }
+    }
+
+    void BlockWriter::Flush() {
+        if (block.empty())
+            return;
+
+        auto blockCompressedSize{LZ4_compress_default(reinterpret_cast<const char *>(block.data()), compressed.data(), static_cast<int>(block.size()), static_cast<int>(compressed.size()))};
+        if (blockCompressedSize <= 0)
+            throw exception("Failed to compress the save state at offset 0x{:X}", size - block.size());
+
+        BlockHeader header{static_cast<u32>(block.size()), static_cast<u32>(blockCompressedSize)};
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(compressed.data(), blockCompressedSize);
+        if (!file)
+            throw exception("Failed to write the save state at offset 0x{:X}", size - block.size());
+
+        compressedSize += static_cast<u64>(blockCompressedSize);
+        block.clear();
+    }
+
+    SaveStateWriter::SaveStateWriter(const DeviceState &state, std::string directory) : state(state), directory(std::move(directory)) {}
+
+    SaveStateWriter::~SaveStateWriter() {
+        if (writer.joinable())
+            writer.join();
+    }
+
+    void SaveStateWriter::Stop() {
+        auto &process{state.process};
+
+        // SIGSTOP stops every thread of the guest at once and can't be caught or delayed by the guest
+        if (kill(process->pid, SIGSTOP))
+            throw exception("Failed to stop the guest process: {}", strerror(errno));
+
+        std::vector<pid_t> tids;
+        {
+            std::lock_guard lock(process->threadMutex);
+            for (const auto &[tid, thread] : process->threads)
+                if (thread->status != kernel::type::KThread::Status::Dead)
+                    tids.push_back(tid);
+        }
+
+        auto deadline{util::GetTimeNs() + constant::StopTimeout};
+        for (auto tid : tids) {
+            while (!IsStopped(process->pid, tid)) {
+                if (util::GetTimeNs() > deadline) {
+                    state.logger->Warn("Capturing a save state without thread {} having stopped", tid);
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void SaveStateWriter::Capture(BlockWriter &stream) {
+        auto &process{state.process};
+        auto chunks{state.os->memory.GetChunks()};
+
+        std::vector<std::shared_ptr<kernel::type::KThread>> threads;
+        {
+            std::lock_guard lock(process->threadMutex);
+            for (const auto &[tid, thread] : process->threads)
+                if (thread->status != kernel::type::KThread::Status::Dead)
+                    threads.push_back(thread);
+        }
+
+        stream.Append(StreamHeader{static_cast<u32>(chunks.size()), static_cast<u32>(threads.size())});
+
+        std::vector<PageRun> runs;
+        std::vector<u8> buffer; // Chunks without a host mirror are read out through the memory file of the guest a block at a time into this
+        for (const auto &chunk : chunks) {
+            runs.clear();
+            if (chunk.host)
+                FindDataRuns(chunk, runs);
+            else
+                runs.push_back(PageRun{0, chunk.size});
+
+            stream.Append(RegionHeader{
+                .address = chunk.address,
+                .size = chunk.size,
+                .state = chunk.state.value,
+                .blockCount = static_cast<u32>(chunk.blockList.size()),
+                .runCount = static_cast<u32>(runs.size()),
+            });
+
+            for (const auto &block : chunk.blockList) {
+                stream.Append(block.address);
+                stream.Append(static_cast<u64>(block.size));
+                stream.Append(static_cast<u64>(block.permission.Get()));
+            }
+
+            for (const auto &run : runs) {
+                stream.Append(run);
+                if (chunk.host) {
+                    stream.Append(reinterpret_cast<const void *>(chunk.host + run.offset), run.size);
+                } else {
+                    buffer.resize(std::min<u64>(run.size, constant::BlockSize));
+                    for (u64 offset{}; offset < run.size; offset += buffer.size()) {
+                        auto size{std::min<u64>(buffer.size(), run.size - offset)};
+                        process->ReadMemory(buffer.data(), chunk.address + run.offset + offset, size, true);
+                        stream.Append(buffer.data(), size);
+                    }
+                }
+            }
+        }
+
+        for (const auto &thread : threads) {
+            stream.Append(ThreadHeader{
+                .tid = static_cast<u32>(thread->tid),
+                .status = static_cast<u32>(thread->status),
+                .tls = thread->tls,
+                .contextSize = sizeof(ThreadContext),
+            });
+            stream.Append(reinterpret_cast<const void *>(thread->ctxMemory->kernel.address), sizeof(ThreadContext));
+        }
+    }
+
+    void SaveStateWriter::Run(std::string path, u64 titleId) {
+        try {
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            if (!file)
+                throw exception("Failed to open {}", path);
+
+            // The header is rewritten with the size of the stream once it's been captured
+            FileHeader header{
+                .streamSize = 0,
+                .titleId = titleId,
+            };
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+            // Everything on the host that writes into the guest is paused prior to the guest itself, the kernel workers are paused first as services can be waiting on the GPU
+            if (!state.nce->PauseWorkers(std::chrono::nanoseconds(constant::PauseTimeout)))
+                throw exception("Timed out waiting for the kernel workers to pause");
+            state.gpu->channelScheduler.Pause();
+            state.audio->Pause();
+
+            auto resume{[&] {
+                kill(state.process->pid, SIGCONT);
+                state.audio->Resume();
+                state.gpu->channelScheduler.Resume();
+                state.nce->ResumeWorkers();
+            }};
+
+            BlockWriter stream(file);
+            auto start{util::GetTimeNs()};
+            try {
+                Stop();
+                Capture(stream);
+                stream.Flush();
+            } catch (...) {
+                resume();
+                throw;
+            }
+            resume();
+            state.logger->Info("Captured a save state of {} KiB with the guest stopped for {}ms", stream.size / 1024, (util::GetTimeNs() - start) / 1'000'000);
+
+            header.streamSize = stream.size;
+            file.seekp(0);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.close();
+            if (!file)
+                throw exception("Failed to write {}", path);
+            state.logger->Info("Wrote a save state to {} ({} KiB compressed to {} KiB)", path, stream.size / 1024, stream.compressedSize / 1024);
+        } catch (const std::exception &e) {
+            std::remove(path.c_str());
+            state.logger->Warn("Failed to capture a save state: {}", e.what());
+        }
+
+        writing = false;
+    }
+
+    void SaveStateWriter::Poll() {
+        if (!Requested.load(std::memory_order_relaxed) || !Requested.exchange(false))
+            return;
+
+        if (writing) {
+            state.logger->Warn("Ignoring a save state request as the previous save state is still being written");
+            return;
+        }
+        if (writer.joinable())
+            writer.join();
+
+        u64 titleId{state.loader && state.loader->nacp ? state.loader->nacp->nacpContents.saveDataOwnerId : 0};
+        mkdir(directory.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+        auto path{fmt::format("{}{:016X}_{}.skss", directory, titleId, std::time(nullptr))};
+
+        writing = true;
+        writer = std::thread(&SaveStateWriter::Run, this, std::move(path), titleId);
+    }
+}
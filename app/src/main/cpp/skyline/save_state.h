@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <thread>
+#include <fstream>
+#include "common.h"
+
+namespace skyline::savestate {
+    namespace constant {
+        constexpr u32 Magic{util::MakeMagic<u32>("SKSS")}; //!< The magic of a save state file
+        constexpr u32 Version{2}; //!< The version of the save state format, this is bumped whenever the layout of any structure in it changes
+        constexpr u32 BlockSize{4 * 1024 * 1024}; //!< The size of the blocks the stream is compressed in
+        constexpr u64 StopTimeout{100'000'000}; //!< The maximum amount of time to wait for all guest threads to stop in nanoseconds
+        constexpr u64 PauseTimeout{1'000'000'000}; //!< The maximum amount of time to wait for the kernel workers to pause in nanoseconds
+    }
+
+    /**
+     * @brief The header of a save state file, it is followed by the stream compressed as a sequence of LZ4 blocks each prefixed with a BlockHeader
+     */
+    struct FileHeader {
+        u32 magic{constant::Magic};
+        u32 version{constant::Version};
+        u64 streamSize; //!< The size of the uncompressed stream
+        u64 titleId; //!< The save data owner ID of the title (0 if the title has no NACP)
+    };
+
+    struct BlockHeader {
+        u32 size; //!< The uncompressed size of the block
+        u32 compressedSize; //!< The size of the LZ4 compressed data following this header
+    };
+
+    /**
+     * @brief The header of the stream, it is followed by every RegionHeader and then every ThreadHeader
+     */
+    struct StreamHeader {
+        u32 regionCount;
+        u32 threadCount;
+    };
+
+    /**
+     * @brief A chunk of guest memory, this is followed by its blocks as (address, size, permission) tuples and then the runs of pages that hold data
+     * @note Holes in the shared memory backing a chunk were never written to or were released by the guest, so they are zero and aren't stored
+     */
+    struct RegionHeader {
+        u64 address;
+        u64 size;
+        u32 state; //!< The raw value of the memory::MemoryState of the chunk
+        u32 blockCount;
+        u32 runCount; //!< The amount of PageRuns that follow the blocks
+        u32 _pad_;
+    };
+
+    struct PageRun {
+        u64 offset; //!< The offset of the run from the start of the region
+        u64 size; //!< The size of the run, its contents immediately follow this
+    };
+
+    struct ThreadHeader {
+        u32 tid;
+        u32 status; //!< The raw value of the KThread::Status of the thread
+        u64 tls; //!< The address of the TLS slot of the thread
+        u64 contextSize; //!< The size of the ThreadContext following this header
+    };
+
+    /**
+     * @brief The BlockWriter class compresses the stream into a file as it's appended to, so only a single block of it is held in memory at a time
+     */
+    class BlockWriter {
+      private:
+        std::ofstream &file;
+        std::vector<u8> block; //!< The uncompressed contents of the block that's being filled
+        std::vector<char> compressed; //!< The compressed contents of the block that's being written out
+
+      public:
+        u64 size{}; //!< The total uncompressed size of the stream
+        u64 compressedSize{}; //!< The total compressed size of the stream, this excludes the BlockHeaders
+
+        BlockWriter(std::ofstream &file);
+
+        void Append(const void *data, size_t size);
+
+        template<typename Type>
+        void Append(const Type &item) {
+            Append(&item, sizeof(Type));
+        }
+
+        /**
+         * @brief Compresses and writes out the block that's being filled, this must be called after the last append
+         */
+        void Flush();
+    };
+
+    extern std::atomic<bool> Requested; //!< If the frontend has requested a save state, this is a global as the frontend has no access to the device state
+
+    /**
+     * @brief The SaveStateWriter class captures the memory and thread contexts of the guest process and writes them to a file
+     * @details The kernel workers, the GPU and audio are paused prior to the guest being stopped so nothing on the host writes into guest memory or thread contexts while it's copied, memory is compressed and written out as it's copied on a background thread rather than being held in memory
+     * @note Service, handle table and GPU engine state aren't captured as none of them are serializable, a save state is a snapshot of the guest's side only
+     */
+    class SaveStateWriter {
+      private:
+        const DeviceState &state;
+        std::string directory; //!< The directory save states are written to
+        std::thread writer; //!< The thread capturing the previous save state
+        std::atomic<bool> writing{}; //!< If the writer thread is still running
+
+        /**
+         * @brief Stops the guest process and waits till all of its threads have stopped
+         */
+        void Stop();
+
+        /**
+         * @brief Serializes the guest memory and thread contexts into a stream, the guest must be stopped while this is called
+         */
+        void Capture(BlockWriter &stream);
+
+        /**
+         * @brief Pauses everything that writes into the guest, captures a save state to the supplied path and resumes the guest, this runs on the writer thread
+         */
+        void Run(std::string path, u64 titleId);
+
+      public:
+        SaveStateWriter(const DeviceState &state, std::string directory);
+
+        ~SaveStateWriter();
+
+        /**
+         * @brief Starts capturing a save state on the writer thread if one has been requested, this should be called regularly from a thread that doesn't run guest code or service SVCs
+         */
+        void Poll();
+    };
+}
@@ -77,6 +77,16 @@ namespace skyline {
             * @brief This returns a handle to an IManagerForApplication which can be used for reading Nintendo Online info
             */
             Result GetBaasAccountManagerForApplication(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            SERVICE_DECL(
+                SFUNC(0x1, IAccountServiceForApplication, GetUserExistence),
+                SFUNC(0x2, IAccountServiceForApplication, ListAllUsers),
+                SFUNC(0x3, IAccountServiceForApplication, ListOpenUsers),
+                SFUNC(0x4, IAccountServiceForApplication, GetLastOpenedUser),
+                SFUNC(0x5, IAccountServiceForApplication, GetProfile),
+                SFUNC(0x64, IAccountServiceForApplication, InitializeApplicationInfoV0),
+                SFUNC(0x65, IAccountServiceForApplication, GetBaasAccountManagerForApplication)
+            )
         };
     }
 
@@ -8,13 +8,7 @@
 #include "IAllSystemAppletProxiesService.h"
 
 namespace skyline::service::am {
-    IAllSystemAppletProxiesService::IAllSystemAppletProxiesService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x64, SFUNC(IAllSystemAppletProxiesService::OpenSystemAppletProxy)},
-        {0xC8, SFUNC(IAllSystemAppletProxiesService::OpenLibraryAppletProxy)},
-        {0xC9, SFUNC(IAllSystemAppletProxiesService::OpenLibraryAppletProxy)},
-        {0x12C, SFUNC(IAllSystemAppletProxiesService::OpenOverlayAppletProxy)},
-        {0x15E, SFUNC(IAllSystemAppletProxiesService::OpenApplicationProxy)}
-    }) {}
+    IAllSystemAppletProxiesService::IAllSystemAppletProxiesService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IAllSystemAppletProxiesService::OpenLibraryAppletProxy(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         manager.RegisterService(SRVREG(ILibraryAppletProxy), session, response);
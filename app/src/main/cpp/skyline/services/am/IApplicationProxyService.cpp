@@ -5,9 +5,7 @@
 #include "IApplicationProxyService.h"
 
 namespace skyline::service::am {
-    IApplicationProxyService::IApplicationProxyService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(IApplicationProxyService::OpenApplicationProxy)}
-    }) {}
+    IApplicationProxyService::IApplicationProxyService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IApplicationProxyService::OpenApplicationProxy(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         manager.RegisterService(SRVREG(IApplicationProxy), session, response);
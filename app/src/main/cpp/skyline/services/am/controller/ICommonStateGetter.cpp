@@ -6,21 +6,30 @@
 
 namespace skyline::service::am {
     void ICommonStateGetter::QueueMessage(ICommonStateGetter::Message message) {
+        std::lock_guard lock(messageMutex);
         messageQueue.emplace(message);
         messageEvent->Signal();
     }
 
-    ICommonStateGetter::ICommonStateGetter(const DeviceState &state, ServiceManager &manager) : messageEvent(std::make_shared<type::KEvent>(state)), BaseService(state, manager, {
-        {0x0, SFUNC(ICommonStateGetter::GetEventHandle)},
-        {0x1, SFUNC(ICommonStateGetter::ReceiveMessage)},
-        {0x5, SFUNC(ICommonStateGetter::GetOperationMode)},
-        {0x6, SFUNC(ICommonStateGetter::GetPerformanceMode)},
-        {0x9, SFUNC(ICommonStateGetter::GetCurrentFocusState)},
-        {0x3C, SFUNC(ICommonStateGetter::GetDefaultDisplayResolution)}
-    }) {
-        operationMode = static_cast<OperationMode>(state.settings->GetBool("operation_mode"));
-        state.logger->Info("Switch to mode: {}", static_cast<bool>(operationMode) ? "Docked" : "Handheld");
+    ICommonStateGetter::ICommonStateGetter(const DeviceState &state, ServiceManager &manager) : messageEvent(std::make_shared<type::KEvent>(state)), BaseService(state, manager) {
+        operationMode = static_cast<OperationMode>(state.settings->Get().operationMode);
+        state.logger->Info("Switch to mode: {}", static_cast<bool>(operationMode.load()) ? "Docked" : "Handheld");
         QueueMessage(Message::FocusStateChange);
+
+        // Switching the operation mode lets titles drop to their handheld resolution and effects on the fly, this is the same as the console being docked or undocked
+        settingsCallback = state.settings->AddCallback([this](const Settings::Values &values) {
+            auto mode{static_cast<OperationMode>(values.operationMode)};
+            if (operationMode.exchange(mode) == mode)
+                return;
+
+            this->state.logger->Info("Switch to mode: {}", static_cast<bool>(mode) ? "Docked" : "Handheld");
+            QueueMessage(Message::OperationModeChange);
+            QueueMessage(Message::PerformanceModeChange);
+        });
+    }
+
+    ICommonStateGetter::~ICommonStateGetter() {
+        state.settings->RemoveCallback(settingsCallback);
     }
 
     Result ICommonStateGetter::GetEventHandle(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
@@ -31,6 +40,7 @@ namespace skyline::service::am {
     }
 
     Result ICommonStateGetter::ReceiveMessage(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        std::lock_guard lock(messageMutex);
         if (messageQueue.empty())
             return result::NoMessages;
 
@@ -45,20 +55,21 @@ namespace skyline::service::am {
     }
 
     Result ICommonStateGetter::GetOperationMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        response.Push(operationMode);
+        response.Push(operationMode.load());
         return {};
     }
 
     Result ICommonStateGetter::GetPerformanceMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        response.Push(static_cast<u32>(operationMode));
+        response.Push(static_cast<u32>(operationMode.load()));
         return {};
     }
 
     Result ICommonStateGetter::GetDefaultDisplayResolution(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        if (operationMode == OperationMode::Handheld) {
+        auto mode{operationMode.load()};
+        if (mode == OperationMode::Handheld) {
             response.Push<u32>(constant::HandheldResolutionW);
             response.Push<u32>(constant::HandheldResolutionH);
-        } else if (operationMode == OperationMode::Docked) {
+        } else if (mode == OperationMode::Docked) {
             response.Push<u32>(constant::DockedResolutionW);
             response.Push<u32>(constant::DockedResolutionH);
         }
@@ -33,6 +33,7 @@ namespace skyline::service::am {
         };
 
         std::shared_ptr<type::KEvent> messageEvent; //!< The event signalled when there is a message available
+        std::mutex messageMutex; //!< This mutex guards messageQueue as messages are also queued by the thread updating the settings
         std::queue<Message> messageQueue;
 
         enum class FocusState : u8 {
@@ -43,7 +44,9 @@ namespace skyline::service::am {
         enum class OperationMode : u8 {
             Handheld = 0, //!< The device is in handheld mode
             Docked = 1 //!< The device is in docked mode
-        } operationMode;
+        };
+        std::atomic<OperationMode> operationMode; //!< The operation mode, this is changed at runtime when the setting for it is updated
+        size_t settingsCallback; //!< The ID of the settings callback which applies changes to the operation mode
 
         /**
          * @brief This queues a message for the application to read via ReceiveMessage
@@ -54,6 +57,8 @@ namespace skyline::service::am {
       public:
         ICommonStateGetter(const DeviceState &state, ServiceManager &manager);
 
+        ~ICommonStateGetter();
+
         /**
          * @brief This returns the handle to a KEvent object that is signalled whenever RecieveMessage has a message (https://switchbrew.org/wiki/Applet_Manager_services#GetEventHandle)
          */
@@ -75,7 +80,7 @@ namespace skyline::service::am {
         Result GetOperationMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
         /**
-         * @brief This returns the current PerformanceMode (Same as operationMode but u32) (https://switchbrew.org/wiki/Applet_Manager_services#GetPerformanceMode)
+         * @brief This returns the current PerformanceMode (Same as operationMode but u32), this is boost in docked mode and normal in handheld mode (https://switchbrew.org/wiki/Applet_Manager_services#GetPerformanceMode)
          */
         Result GetPerformanceMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
@@ -83,5 +88,14 @@ namespace skyline::service::am {
          * @brief This returns the current display width and height in two u32s (https://switchbrew.org/wiki/Applet_Manager_services#GetDefaultDisplayResolution)
          */
         Result GetDefaultDisplayResolution(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, ICommonStateGetter, GetEventHandle),
+            SFUNC(0x1, ICommonStateGetter, ReceiveMessage),
+            SFUNC(0x5, ICommonStateGetter, GetOperationMode),
+            SFUNC(0x6, ICommonStateGetter, GetPerformanceMode),
+            SFUNC(0x9, ICommonStateGetter, GetCurrentFocusState),
+            SFUNC(0x3C, ICommonStateGetter, GetDefaultDisplayResolution)
+        )
     };
 }
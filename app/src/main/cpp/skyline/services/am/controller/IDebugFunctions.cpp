@@ -4,6 +4,5 @@
 #include "IDebugFunctions.h"
 
 namespace skyline::service::am {
-    IDebugFunctions::IDebugFunctions(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-    }) {}
+    IDebugFunctions::IDebugFunctions(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 }
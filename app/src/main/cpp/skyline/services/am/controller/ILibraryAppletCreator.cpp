@@ -1,15 +1,13 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <kernel/types/KProcess.h>
 #include <services/am/storage/IStorage.h>
 #include <services/am/applet/ILibraryAppletAccessor.h>
 #include "ILibraryAppletCreator.h"
 
 namespace skyline::service::am {
-    ILibraryAppletCreator::ILibraryAppletCreator(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(ILibraryAppletCreator::CreateLibraryApplet)},
-        {0xA, SFUNC(ILibraryAppletCreator::CreateStorage)}
-    }) {}
+    ILibraryAppletCreator::ILibraryAppletCreator(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result ILibraryAppletCreator::CreateLibraryApplet(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         manager.RegisterService(SRVREG(ILibraryAppletAccessor), session, response);
@@ -25,4 +23,26 @@ namespace skyline::service::am {
         manager.RegisterService(std::make_shared<IStorage>(state, manager, size), session, response);
         return {};
     }
+
+    Result ILibraryAppletCreator::CreateTransferMemoryStorage(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto writable = request.Pop<u64>() & 1;
+        auto size = request.Pop<i64>();
+        if (size < 0)
+            throw exception("Cannot create an IStorage with a negative size");
+
+        // The storage accesses the transfer memory in place, nothing is copied out of it on creation
+        auto transferMemory = state.process->GetHandle<type::KTransferMemory>(request.copyHandles.at(0));
+        manager.RegisterService(std::make_shared<IStorage>(state, manager, transferMemory, size, writable), session, response);
+        return {};
+    }
+
+    Result ILibraryAppletCreator::CreateHandleStorage(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto size = request.Pop<i64>();
+        if (size < 0)
+            throw exception("Cannot create an IStorage with a negative size");
+
+        auto transferMemory = state.process->GetHandle<type::KTransferMemory>(request.copyHandles.at(0));
+        manager.RegisterService(std::make_shared<IStorage>(state, manager, transferMemory, size, true), session, response);
+        return {};
+    }
 }
@@ -23,5 +23,22 @@ namespace skyline::service::am {
          * @brief This function creates an IStorage that can be used by the application (https://switchbrew.org/wiki/Applet_Manager_services#CreateStorage)
          */
         Result CreateStorage(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief This function creates an IStorage whose contents are a transfer memory object of the application (https://switchbrew.org/wiki/Applet_Manager_services#CreateTransferMemoryStorage)
+         */
+        Result CreateTransferMemoryStorage(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief This function creates a writable IStorage whose contents are a transfer memory object of the application (https://switchbrew.org/wiki/Applet_Manager_services#CreateHandleStorage)
+         */
+        Result CreateHandleStorage(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, ILibraryAppletCreator, CreateLibraryApplet),
+            SFUNC(0xA, ILibraryAppletCreator, CreateStorage),
+            SFUNC(0xB, ILibraryAppletCreator, CreateTransferMemoryStorage),
+            SFUNC(0xC, ILibraryAppletCreator, CreateHandleStorage)
+        )
     };
 }
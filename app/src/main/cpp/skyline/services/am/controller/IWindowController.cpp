@@ -5,10 +5,7 @@
 #include "IWindowController.h"
 
 namespace skyline::service::am {
-    IWindowController::IWindowController(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x1, SFUNC(IWindowController::GetAppletResourceUserId)},
-        {0xA, SFUNC(IWindowController::AcquireForegroundRights)}
-    }) {}
+    IWindowController::IWindowController(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IWindowController::GetAppletResourceUserId(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         response.Push(static_cast<u64>(state.process->pid));
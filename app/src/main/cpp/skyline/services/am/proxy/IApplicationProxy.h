@@ -17,5 +17,16 @@ namespace skyline::service::am {
          * @brief This returns #IApplicationFunctions (https://switchbrew.org/wiki/Applet_Manager_services#IApplicationFunctions)
          */
         Result GetApplicationFunctions(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC_BASE(0x0, IApplicationProxy, BaseProxy, GetCommonStateGetter),
+            SFUNC_BASE(0x1, IApplicationProxy, BaseProxy, GetSelfController),
+            SFUNC_BASE(0x2, IApplicationProxy, BaseProxy, GetWindowController),
+            SFUNC_BASE(0x3, IApplicationProxy, BaseProxy, GetAudioController),
+            SFUNC_BASE(0x4, IApplicationProxy, BaseProxy, GetDisplayController),
+            SFUNC_BASE(0xB, IApplicationProxy, BaseProxy, GetLibraryAppletCreator),
+            SFUNC(0x14, IApplicationProxy, GetApplicationFunctions),
+            SFUNC_BASE(0x3E8, IApplicationProxy, BaseProxy, GetDebugFunctions)
+        )
     };
 }
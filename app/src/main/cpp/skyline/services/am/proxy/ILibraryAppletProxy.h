@@ -12,5 +12,15 @@ namespace skyline::service::am {
     class ILibraryAppletProxy : public BaseProxy {
       public:
         ILibraryAppletProxy(const DeviceState &state, ServiceManager &manager);
+
+        SERVICE_DECL(
+            SFUNC_BASE(0x0, ILibraryAppletProxy, BaseProxy, GetCommonStateGetter),
+            SFUNC_BASE(0x1, ILibraryAppletProxy, BaseProxy, GetSelfController),
+            SFUNC_BASE(0x2, ILibraryAppletProxy, BaseProxy, GetWindowController),
+            SFUNC_BASE(0x3, ILibraryAppletProxy, BaseProxy, GetAudioController),
+            SFUNC_BASE(0x4, ILibraryAppletProxy, BaseProxy, GetDisplayController),
+            SFUNC_BASE(0xB, ILibraryAppletProxy, BaseProxy, GetLibraryAppletCreator),
+            SFUNC_BASE(0x3E8, ILibraryAppletProxy, BaseProxy, GetDebugFunctions)
+        )
     };
 }
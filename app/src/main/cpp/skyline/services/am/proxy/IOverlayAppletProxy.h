@@ -12,5 +12,16 @@ namespace skyline::service::am {
     class IOverlayAppletProxy : public BaseProxy {
       public:
         IOverlayAppletProxy(const DeviceState &state, ServiceManager &manager);
+
+        SERVICE_DECL(
+            SFUNC_BASE(0x0, IOverlayAppletProxy, BaseProxy, GetCommonStateGetter),
+            SFUNC_BASE(0x1, IOverlayAppletProxy, BaseProxy, GetSelfController),
+            SFUNC_BASE(0x2, IOverlayAppletProxy, BaseProxy, GetWindowController),
+            SFUNC_BASE(0x3, IOverlayAppletProxy, BaseProxy, GetAudioController),
+            SFUNC_BASE(0x4, IOverlayAppletProxy, BaseProxy, GetDisplayController),
+            SFUNC_BASE(0xB, IOverlayAppletProxy, BaseProxy, GetLibraryAppletCreator),
+            SFUNC_BASE(0x15, IOverlayAppletProxy, BaseProxy, GetAppletCommonFunctions),
+            SFUNC_BASE(0x3E8, IOverlayAppletProxy, BaseProxy, GetDebugFunctions)
+        )
     };
 }
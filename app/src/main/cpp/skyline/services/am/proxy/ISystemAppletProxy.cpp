@@ -4,14 +4,5 @@
 #include "ISystemAppletProxy.h"
 
 namespace skyline::service::am {
-    ISystemAppletProxy::ISystemAppletProxy(const DeviceState &state, ServiceManager &manager) : BaseProxy(state, manager, {
-        {0x0, SFUNC(BaseProxy::GetCommonStateGetter)},
-        {0x1, SFUNC(BaseProxy::GetSelfController)},
-        {0x2, SFUNC(BaseProxy::GetWindowController)},
-        {0x3, SFUNC(BaseProxy::GetAudioController)},
-        {0x4, SFUNC(BaseProxy::GetDisplayController)},
-        {0xB, SFUNC(BaseProxy::GetLibraryAppletCreator)},
-        {0x17, SFUNC(BaseProxy::GetAppletCommonFunctions)},
-        {0x3E8, SFUNC(BaseProxy::GetDebugFunctions)}
-    }) {}
+    ISystemAppletProxy::ISystemAppletProxy(const DeviceState &state, ServiceManager &manager) : BaseProxy(state, manager) {}
 }
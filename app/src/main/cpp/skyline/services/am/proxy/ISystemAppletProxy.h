@@ -12,5 +12,16 @@ namespace skyline::service::am {
     class ISystemAppletProxy : public BaseProxy {
       public:
         ISystemAppletProxy(const DeviceState &state, ServiceManager &manager);
+
+        SERVICE_DECL(
+            SFUNC_BASE(0x0, ISystemAppletProxy, BaseProxy, GetCommonStateGetter),
+            SFUNC_BASE(0x1, ISystemAppletProxy, BaseProxy, GetSelfController),
+            SFUNC_BASE(0x2, ISystemAppletProxy, BaseProxy, GetWindowController),
+            SFUNC_BASE(0x3, ISystemAppletProxy, BaseProxy, GetAudioController),
+            SFUNC_BASE(0x4, ISystemAppletProxy, BaseProxy, GetDisplayController),
+            SFUNC_BASE(0xB, ISystemAppletProxy, BaseProxy, GetLibraryAppletCreator),
+            SFUNC_BASE(0x17, ISystemAppletProxy, BaseProxy, GetAppletCommonFunctions),
+            SFUNC_BASE(0x3E8, ISystemAppletProxy, BaseProxy, GetDebugFunctions)
+        )
     };
 }
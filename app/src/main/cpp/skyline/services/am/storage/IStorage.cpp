@@ -1,13 +1,38 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <kernel/types/KProcess.h>
 #include "IStorageAccessor.h"
 #include "IStorage.h"
 
 namespace skyline::service::am {
-    IStorage::IStorage(const DeviceState &state, ServiceManager &manager, size_t size) : content(size), BaseService(state, manager, {
-        {0x0, SFUNC(IStorage::Open)}
-    }) {}
+    constexpr size_t SharedMemoryThreshold{0x10000}; //!< The size at and above which an IStorage is backed by shared memory rather than a vector, shared memory is only committed when it's written to and can be mapped into the guest
+
+    IStorage::IStorage(const DeviceState &state, ServiceManager &manager, size_t size) : size(size), BaseService(state, manager) {
+        if (size >= SharedMemoryThreshold) {
+            sharedMemory = std::make_shared<type::KSharedMemory>(state, 0, util::AlignUp(size, PAGE_SIZE), memory::Permission{true, true, false});
+            content = std::span(reinterpret_cast<u8 *>(sharedMemory->kernel.address), size);
+        } else {
+            buffer.resize(size);
+            content = buffer;
+        }
+    }
+
+    IStorage::IStorage(const DeviceState &state, ServiceManager &manager, std::shared_ptr<type::KTransferMemory> transferMemory, size_t size, bool writable) : transferMemory(std::move(transferMemory)), size(std::min(size, this->transferMemory->size)), writable(writable), BaseService(state, manager) {}
+
+    void IStorage::Read(u64 address, size_t offset, size_t length) {
+        if (transferMemory)
+            state.process->CopyMemory(transferMemory->address + offset, address, length);
+        else
+            state.process->WriteMemory(content.data() + offset, address, length);
+    }
+
+    void IStorage::Write(u64 address, size_t offset, size_t length) {
+        if (transferMemory)
+            state.process->CopyMemory(address, transferMemory->address + offset, length);
+        else
+            state.process->ReadMemory(content.data() + offset, address, length);
+    }
 
     Result IStorage::Open(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         manager.RegisterService(std::make_shared<IStorageAccessor>(state, manager, shared_from_this()), session, response);
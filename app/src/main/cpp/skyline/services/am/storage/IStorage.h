@@ -3,22 +3,53 @@
 
 #pragma once
 
+#include <kernel/types/KSharedMemory.h>
+#include <kernel/types/KTransferMemory.h>
 #include <services/base_service.h>
 #include <services/serviceman.h>
 
 namespace skyline::service::am {
     /**
      * @brief IStorage is used to open an IStorageAccessor to access a region of memory (https://switchbrew.org/wiki/Applet_Manager_services#IStorage)
+     * @details The contents are held in a vector when they're small, in shared memory when they're large or directly in the guest's transfer memory when the storage was created from it, accesses are a single copy between the contents and guest memory in all cases
      */
     class IStorage : public BaseService, public std::enable_shared_from_this<IStorage> {
       private:
         size_t offset{}; //!< The current offset within the content for pushing data
+        std::vector<u8> buffer; //!< The backing of the contents of small storage
+        std::shared_ptr<type::KSharedMemory> sharedMemory; //!< The backing of the contents of large storage
+        std::shared_ptr<type::KTransferMemory> transferMemory; //!< The guest transfer memory which holds the contents of the storage, the contents aren't on the host if this is set
 
       public:
-        std::vector<u8> content; //!< The container for this IStorage's contents
+        std::span<u8> content; //!< The contents on the host, this is empty if they're in transfer memory
+        size_t size; //!< The size of the contents in bytes
+        bool writable{true}; //!< If the guest is allowed to write to the contents
 
         IStorage(const DeviceState &state, ServiceManager &manager, size_t size);
 
+        /**
+         * @param transferMemory The transfer memory which holds the contents
+         * @param size The size of the storage, this is clamped to the size of the transfer memory
+         * @param writable If the guest is allowed to write to the contents
+         */
+        IStorage(const DeviceState &state, ServiceManager &manager, std::shared_ptr<type::KTransferMemory> transferMemory, size_t size, bool writable);
+
+        /**
+         * @brief Copies a range of the contents into guest memory
+         * @param address The guest address to copy the contents to
+         * @param offset The offset of the range within the contents, this must be bounds-checked by the caller
+         * @param length The size of the range
+         */
+        void Read(u64 address, size_t offset, size_t length);
+
+        /**
+         * @brief Copies guest memory into a range of the contents
+         * @param address The guest address to copy the contents from
+         * @param offset The offset of the range within the contents, this must be bounds-checked by the caller
+         * @param length The size of the range
+         */
+        void Write(u64 address, size_t offset, size_t length);
+
         /**
          * @brief This returns an IStorageAccessor that can read and write data to an IStorage
          */
@@ -37,5 +68,9 @@ namespace skyline::service::am {
             std::memcpy(content.data() + offset, reinterpret_cast<const u8 *>(&value), sizeof(ValueType));
             offset += sizeof(ValueType);
         }
+
+        SERVICE_DECL(
+            SFUNC(0x0, IStorage, Open)
+        )
     };
 }
@@ -18,5 +18,9 @@ namespace skyline::service::apm {
          * @brief This returns an handle to ISession
          */
         Result OpenSession(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, IManager, OpenSession)
+        )
     };
 }
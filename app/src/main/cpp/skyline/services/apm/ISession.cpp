@@ -1,25 +1,45 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <thread_priority.h>
 #include "ISession.h"
 
 namespace skyline::service::apm {
-    ISession::ISession(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(ISession::SetPerformanceConfiguration)},
-        {0x1, SFUNC(ISession::GetPerformanceConfiguration)}
-    }) {}
+    ISession::ISession(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
+
+    ISession::~ISession() {
+        if (boosted)
+            priority::Hints.SetBoost(false);
+    }
+
+    void ISession::UpdateBoost() {
+        bool boost{IsBoostConfiguration(performanceConfig[state.settings->Get().operationMode ? 1 : 0])};
+        if (boost == boosted)
+            return;
+
+        boosted = boost;
+        priority::Hints.SetBoost(boost);
+        state.logger->Debug("{} host threads", boost ? "Boosting" : "Unboosting");
+    }
 
     Result ISession::SetPerformanceConfiguration(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         auto mode = request.Pop<u32>();
         auto config = request.Pop<u32>();
-        performanceConfig.at(mode) = config;
+        if (mode >= performanceConfig.size())
+            return result::InvalidParameters;
+
+        performanceConfig[mode] = config;
         state.logger->Info("SetPerformanceConfiguration called with 0x{:X} ({})", config, mode ? "Docked" : "Handheld");
+        UpdateBoost();
         return {};
     }
 
     Result ISession::GetPerformanceConfiguration(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         auto performanceMode = request.Pop<u32>();
-        response.Push<u32>(performanceConfig.at(performanceMode));
+        if (performanceMode >= performanceConfig.size())
+            return result::InvalidParameters;
+
+        response.Push<u32>(performanceConfig[performanceMode]);
         return {};
     }
 }
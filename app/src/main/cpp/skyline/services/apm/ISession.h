@@ -7,18 +7,37 @@
 #include <services/serviceman.h>
 
 namespace skyline::service::apm {
+    namespace result {
+        constexpr Result InvalidParameters(148, 2);
+    }
+
     /**
      * @brief ISession is a service opened when OpenSession is called by apm for controlling performance
      */
     class ISession : public BaseService {
       private:
         std::array<u32, 2> performanceConfig = {0x00010000, 0x00020001}; //!< This holds the performance config for both handheld(0) and docked(1) mode
+        bool boosted{}; //!< If this session has boosted the host threads
+
+        /**
+         * @return If a performance configuration is a CPU boost configuration, these are requested by titles during loading screens
+         */
+        static constexpr bool IsBoostConfiguration(u32 config) {
+            return config == 0x92220009 || config == 0x9222000A;
+        }
+
+        /**
+         * @brief Boosts the host threads in the performance hint session while the configuration of the current operation mode is a boost one
+         */
+        void UpdateBoost();
 
       public:
         ISession(const DeviceState &state, ServiceManager &manager);
 
+        ~ISession();
+
         /**
-         * @brief This sets performanceConfig to the given arguments, it doesn't affect anything else (https://switchbrew.org/wiki/PPC_services#SetPerformanceConfiguration)
+         * @brief This sets performanceConfig to the given arguments, boost configurations boost the host threads that service the guest (https://switchbrew.org/wiki/PPC_services#SetPerformanceConfiguration)
          */
         Result SetPerformanceConfiguration(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
 
@@ -26,5 +45,10 @@ namespace skyline::service::apm {
          * @brief This retrieves the particular performanceConfig for a mode and returns it to the client (https://switchbrew.org/wiki/PPC_services#SetPerformanceConfiguration)
          */
         Result GetPerformanceConfiguration(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, ISession, SetPerformanceConfiguration),
+            SFUNC(0x1, ISession, GetPerformanceConfiguration)
+        )
     };
 }
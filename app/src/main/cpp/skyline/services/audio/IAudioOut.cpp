@@ -5,18 +5,9 @@
 #include "IAudioOut.h"
 
 namespace skyline::service::audio {
-    IAudioOut::IAudioOut(const DeviceState &state, ServiceManager &manager, u8 channelCount, u32 sampleRate) : sampleRate(sampleRate), channelCount(channelCount), releaseEvent(std::make_shared<type::KEvent>(state)), BaseService(state, manager, {
-        {0x0, SFUNC(IAudioOut::GetAudioOutState)},
-        {0x1, SFUNC(IAudioOut::StartAudioOut)},
-        {0x2, SFUNC(IAudioOut::StopAudioOut)},
-        {0x3, SFUNC(IAudioOut::AppendAudioOutBuffer)},
-        {0x4, SFUNC(IAudioOut::RegisterBufferEvent)},
-        {0x5, SFUNC(IAudioOut::GetReleasedAudioOutBuffer)},
-        {0x6, SFUNC(IAudioOut::ContainsAudioOutBuffer)},
-        {0x7, SFUNC(IAudioOut::AppendAudioOutBuffer)},
-        {0x8, SFUNC(IAudioOut::GetReleasedAudioOutBuffer)}
-    }) {
-        track = state.audio->OpenTrack(channelCount, constant::SampleRate, [this]() { this->releaseEvent->Signal(); });
+    IAudioOut::IAudioOut(const DeviceState &state, ServiceManager &manager, u8 channelCount, u32 sampleRate) : sampleRate(sampleRate), channelCount(channelCount), releaseEvent(std::make_shared<type::KEvent>(state)), BaseService(state, manager) {
+        // The track is opened in the format of the guest's samples, they're converted to the format of the output stream as they're played
+        track = state.audio->OpenTrack(channelCount, sampleRate, [this]() { this->releaseEvent->Signal(); });
     }
 
     IAudioOut::~IAudioOut() {
@@ -24,7 +15,7 @@ namespace skyline::service::audio {
     }
 
     Result IAudioOut::GetAudioOutState(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        response.Push(static_cast<u32>(track->playbackState));
+        response.Push(static_cast<u32>(track->playbackState.load()));
         return {};
     }
 
@@ -52,11 +43,13 @@ namespace skyline::service::audio {
 
         state.logger->Debug("IAudioOut: Appending buffer with address: 0x{:X}, size: 0x{:X}", data.sampleBufferPtr, data.sampleSize);
 
-        if (sampleRate != constant::SampleRate) {
-            auto resampledBuffer = resampler.ResampleBuffer(std::span(state.process->GetPointer<i16>(data.sampleBufferPtr), data.sampleSize / sizeof(i16)), static_cast<double>(sampleRate) / constant::SampleRate, channelCount);
-            track->AppendBuffer(tag, resampledBuffer);
+        if (auto hostAddress{state.process->GetHostAddress(data.sampleBufferPtr, data.sampleSize)}) {
+            // The buffer is read straight from guest memory by the audio callback, the guest can't touch it until it's been released
+            track->AppendBufferInPlace(tag, std::span(reinterpret_cast<const i16 *>(hostAddress), data.sampleSize / sizeof(i16)));
         } else {
-            track->AppendBuffer(tag, std::span(state.process->GetPointer<i16>(data.sampleBufferPtr), data.sampleSize / sizeof(i16)));
+            std::vector<i16> samples(data.sampleSize / sizeof(i16));
+            state.process->ReadMemory(samples.data(), data.sampleBufferPtr, samples.size() * sizeof(i16));
+            track->AppendBuffer(tag, samples);
         }
 
         return {};
@@ -6,7 +6,6 @@
 #include <kernel/types/KEvent.h>
 #include <services/base_service.h>
 #include <services/serviceman.h>
-#include <audio/resampler.h>
 #include <audio.h>
 
 namespace skyline::service::audio {
@@ -15,7 +14,6 @@ namespace skyline::service::audio {
      */
     class IAudioOut : public BaseService {
       private:
-        skyline::audio::Resampler resampler; //!< The audio resampler object used to resample audio
         std::shared_ptr<skyline::audio::AudioTrack> track; //!< The audio track associated with the audio out
         std::shared_ptr<type::KEvent> releaseEvent; //!< The KEvent that is signalled when a buffer has been released
 
@@ -68,5 +66,17 @@ namespace skyline::service::audio {
          * @brief Checks if the given buffer ID is in the playback queue (https://switchbrew.org/wiki/Audio_services#ContainsAudioOutBuffer)
          */
         Result ContainsAudioOutBuffer(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, IAudioOut, GetAudioOutState),
+            SFUNC(0x1, IAudioOut, StartAudioOut),
+            SFUNC(0x2, IAudioOut, StopAudioOut),
+            SFUNC(0x3, IAudioOut, AppendAudioOutBuffer),
+            SFUNC(0x4, IAudioOut, RegisterBufferEvent),
+            SFUNC(0x5, IAudioOut, GetReleasedAudioOutBuffer),
+            SFUNC(0x6, IAudioOut, ContainsAudioOutBuffer),
+            SFUNC(0x7, IAudioOut, AppendAudioOutBuffer),
+            SFUNC(0x8, IAudioOut, GetReleasedAudioOutBuffer)
+        )
     };
 }
@@ -2,32 +2,37 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <kernel/types/KProcess.h>
+#include <audio/mix.h>
+#include <thread_priority.h>
 #include "IAudioRenderer.h"
 
 namespace skyline::service::audio::IAudioRenderer {
+    constexpr size_t MaxRenderThreads{4}; //!< The maximum amount of threads voices are rendered on, the renderer only has a few milliseconds for every update so a small pool is enough
+    constexpr size_t BufferedFrames{constant::MixBufferSize * 3}; //!< The amount of frames that are kept in flight on the track, this is split into as many update-sized buffers as it takes
+
     IAudioRenderer::IAudioRenderer(const DeviceState &state, ServiceManager &manager, AudioRendererParameters &parameters)
-        : systemEvent(std::make_shared<type::KEvent>(state)), parameters(parameters), BaseService(state, manager, {
-        {0x0, SFUNC(IAudioRenderer::GetSampleRate)},
-        {0x1, SFUNC(IAudioRenderer::GetSampleCount)},
-        {0x2, SFUNC(IAudioRenderer::GetMixBufferCount)},
-        {0x3, SFUNC(IAudioRenderer::GetState)},
-        {0x4, SFUNC(IAudioRenderer::RequestUpdate)},
-        {0x5, SFUNC(IAudioRenderer::Start)},
-        {0x6, SFUNC(IAudioRenderer::Stop)},
-        {0x7, SFUNC(IAudioRenderer::QuerySystemEvent)},
-        {0xA, SFUNC(IAudioRenderer::RequestUpdate)},
-    }) {
-        track = state.audio->OpenTrack(constant::ChannelCount, constant::SampleRate, []() {});
+        : systemEvent(std::make_shared<type::KEvent>(state)), parameters(parameters), performance(parameters.performanceManagerCount, parameters.voiceCount + parameters.subMixCount + parameters.sinkCount + 1), renderPool(MaxRenderThreads), BaseService(state, manager) {
+        // The DSP renders sampleCount samples at sampleRate for every update, this is the same duration at the output sample rate
+        if (!parameters.sampleRate)
+            throw exception("Cannot open an audio renderer with a sample rate of 0");
+        auto updateFrames{std::clamp<u64>(static_cast<u64>(parameters.sampleCount) * constant::SampleRate / parameters.sampleRate, 1, constant::MixBufferSize)};
+        updateSamples = static_cast<u32>(updateFrames * constant::ChannelCount);
+
+        // The system event is signalled whenever the output device has played a buffer, this paces the guest's updates to the device rather than to how fast it can call RequestUpdate
+        track = state.audio->OpenTrack(constant::ChannelCount, constant::SampleRate, [this]() { systemEvent->Signal(); });
         track->Start();
 
         memoryPools.resize(parameters.effectCount + parameters.voiceCount * 4);
         effects.resize(parameters.effectCount);
         voices.resize(parameters.voiceCount, Voice(state));
-
-        // Fill track with empty samples that we will triple buffer
-        track->AppendBuffer(0);
-        track->AppendBuffer(1);
-        track->AppendBuffer(2);
+        partialMixes.resize(renderPool.GetThreadCount());
+        if (performance.Enabled())
+            voiceTimes.resize(parameters.voiceCount);
+
+        // Fill the track with enough empty buffers to cover the buffered duration, these are remixed as they're released
+        auto bufferCount{(BufferedFrames + updateFrames - 1) / updateFrames};
+        for (u64 tag{}; tag < bufferCount; tag++)
+            track->AppendBuffer(tag, std::span(sampleBuffer.data(), updateSamples));
     }
 
     IAudioRenderer::~IAudioRenderer() {
@@ -55,6 +60,16 @@ namespace skyline::service::audio::IAudioRenderer {
     }
 
     Result IAudioRenderer::RequestUpdate(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        TRACE_SECTION("IAudioRenderer::RequestUpdate");
+
+        // The guest thread that requests updates renders all of the audio, it's promoted once so its updates aren't delayed behind other threads
+        static thread_local bool promoted{};
+        if (!promoted) {
+            promoted = true;
+            auto scheduling{priority::PromoteThread(priority::ThreadClass::Audio)};
+            state.logger->Info("Audio renderer thread {} scheduling: {}", gettid(), priority::GetSchedulingName(scheduling));
+        }
+
         auto inputAddress{request.inputBuf.at(0).address};
 
         auto inputHeader{state.process->GetObject<UpdateDataHeader>(inputAddress)};
@@ -62,30 +77,30 @@ namespace skyline::service::audio::IAudioRenderer {
         inputAddress += sizeof(UpdateDataHeader);
         inputAddress += inputHeader.behaviorSize; // Unused
 
-        auto memoryPoolCount{memoryPools.size()};
-        std::vector<MemoryPoolIn> memoryPoolsIn(memoryPoolCount);
-        state.process->ReadMemory(memoryPoolsIn.data(), inputAddress, memoryPoolCount * sizeof(MemoryPoolIn));
-        inputAddress += inputHeader.memoryPoolSize;
-
-        for (auto i = 0; i < memoryPoolsIn.size(); i++)
+        // The input structures are parsed directly from guest memory rather than being copied out first
+        auto memoryPoolsIn{state.process->GetPointer<MemoryPoolIn>(inputAddress)};
+        for (size_t i{}; i < memoryPools.size(); i++)
             memoryPools[i].ProcessInput(memoryPoolsIn[i]);
+        inputAddress += inputHeader.memoryPoolSize;
 
         inputAddress += inputHeader.voiceResourceSize;
-        std::vector<VoiceIn> voicesIn(parameters.voiceCount);
-        state.process->ReadMemory(voicesIn.data(), inputAddress, parameters.voiceCount * sizeof(VoiceIn));
-        inputAddress += inputHeader.voiceSize;
-
-        for (auto i = 0; i < voicesIn.size(); i++)
+        auto voicesIn{state.process->GetPointer<VoiceIn>(inputAddress)};
+        for (size_t i{}; i < voices.size(); i++)
             voices[i].ProcessInput(voicesIn[i]);
+        inputAddress += inputHeader.voiceSize;
 
-        std::vector<EffectIn> effectsIn(parameters.effectCount);
-        state.process->ReadMemory(effectsIn.data(), inputAddress, parameters.effectCount * sizeof(EffectIn));
-
-        for (auto i = 0; i < effectsIn.size(); i++)
+        auto effectsIn{state.process->GetPointer<EffectIn>(inputAddress)};
+        activeEffects.clear();
+        for (size_t i{}; i < effects.size(); i++) {
             effects[i].ProcessInput(effectsIn[i]);
+            if (effects[i].Active())
+                activeEffects.push_back(&effects[i]);
+        }
+        std::stable_sort(activeEffects.begin(), activeEffects.end(), [](const Effect *a, const Effect *b) {
+            return a->processingOrder < b->processingOrder;
+        });
 
         UpdateAudio();
-        systemEvent->Signal();
 
         UpdateDataHeader outputHeader{
             .revision = constant::RevMagic,
@@ -115,20 +130,32 @@ namespace skyline::service::audio::IAudioRenderer {
         state.process->WriteMemory(outputHeader, outputAddress);
         outputAddress += sizeof(UpdateDataHeader);
 
-        for (const auto &memoryPool : memoryPools) {
-            state.process->WriteMemory(memoryPool.output, outputAddress);
-            outputAddress += sizeof(MemoryPoolOut);
-        }
+        // Every section is resolved to host memory once and written directly, it's only written through the guest when it isn't mirrored
+        auto writeOutputs{[&](const auto &objects, auto member) {
+            using Output = std::remove_cvref_t<decltype(objects[0].*member)>;
+            auto outputs{state.process->GetSpan<Output>(outputAddress, objects.size())};
+            for (size_t i{}; i < objects.size(); i++) {
+                if (!outputs.empty())
+                    outputs[i] = objects[i].*member;
+                else
+                    state.process->WriteMemory(objects[i].*member, outputAddress + (i * sizeof(Output)));
+            }
+            outputAddress += objects.size() * sizeof(Output);
+        }};
 
-        for (const auto &voice : voices) {
-            state.process->WriteMemory(voice.output, outputAddress);
-            outputAddress += sizeof(VoiceOut);
-        }
+        writeOutputs(memoryPools, &MemoryPool::output);
+        writeOutputs(voices, &Voice::output);
+        writeOutputs(effects, &Effect::output);
+
+        // Sinks aren't emulated so their output is left as it is
+        outputAddress += outputHeader.sinkSize;
 
-        for (const auto &effect : effects) {
-            state.process->WriteMemory(effect.output, outputAddress);
-            outputAddress += sizeof(EffectOut);
+        PerformanceOut performanceOut{};
+        if (request.outputBuf.size() > 1) {
+            auto &performanceBuffer{request.outputBuf[1]};
+            performanceOut.historySize = performance.CopyHistories(std::span(state.process->GetPointer<u8>(performanceBuffer.address), performanceBuffer.size), revisionInfo.UsesPerformanceMetricDataFormatV2());
         }
+        state.process->WriteMemory(performanceOut, outputAddress);
 
         return {};
     }
@@ -137,44 +164,84 @@ namespace skyline::service::audio::IAudioRenderer {
         auto released{track->GetReleasedBuffers(2)};
 
         for (auto &tag : released) {
+            performance.BeginFrame();
             MixFinalBuffer();
-            track->AppendBuffer(tag, sampleBuffer);
+
+            auto sinkStart{performance.Enabled() ? util::GetTimeNs() : 0};
+            track->AppendBuffer(tag, std::span(sampleBuffer.data(), updateSamples));
+            if (performance.Enabled())
+                performance.AddEntry(MakeNodeId(NodeIdType::Sink, 0), PerformanceEntryType::Sink, sinkStart, util::GetTimeNs());
+            performance.EndFrame();
         }
     }
 
     void IAudioRenderer::MixFinalBuffer() {
-        u32 writtenSamples = 0;
+        for (auto &partialMix : partialMixes)
+            partialMix.writtenSamples = 0;
 
-        for (auto &voice : voices) {
+        // Every voice is a job, they're independent of each other so they're decoded and resampled in parallel
+        bool measure{performance.Enabled()};
+        renderPool.Run(voices.size(), [this, measure](size_t index, size_t worker) {
+            auto &voice{voices[index]};
             if (!voice.Playable())
-                continue;
-
-            u32 bufferOffset{};
-            u32 pendingSamples = constant::MixBufferSize;
+                return;
 
-            while (pendingSamples > 0) {
-                u32 voiceBufferOffset{};
-                u32 voiceBufferSize{};
-                auto &voiceSamples{voice.GetBufferData(pendingSamples, voiceBufferOffset, voiceBufferSize)};
+            auto start{measure ? util::GetTimeNs() : 0};
 
-                if (voiceBufferSize == 0)
-                    break;
+            auto &partialMix{partialMixes[worker]};
+            auto voiceSamples{voice.Render(std::span(partialMix.voiceBuffer.data(), updateSamples)) * constant::ChannelCount};
 
-                pendingSamples -= voiceBufferSize / constant::ChannelCount;
+            // Samples are mixed into the part of the buffer that a previous voice has written to and overwrite the rest of it
+            auto mixSize{std::min(voiceSamples, partialMix.writtenSamples)};
+            skyline::audio::mix::Mix(partialMix.sampleBuffer.data(), partialMix.voiceBuffer.data(), mixSize, voice.volume);
+            skyline::audio::mix::Scale(partialMix.sampleBuffer.data() + mixSize, partialMix.voiceBuffer.data() + mixSize, voiceSamples - mixSize, voice.volume);
 
-                for (auto index{voiceBufferOffset}; index < voiceBufferOffset + voiceBufferSize; index++) {
-                    if (writtenSamples == bufferOffset) {
-                        sampleBuffer[bufferOffset] = skyline::audio::Saturate<i16, i32>(voiceSamples[index] * voice.volume);
+            partialMix.writtenSamples = std::max(partialMix.writtenSamples, voiceSamples);
 
-                        writtenSamples++;
-                    } else {
-                        sampleBuffer[bufferOffset] = skyline::audio::Saturate<i16, i32>(sampleBuffer[bufferOffset] + (voiceSamples[index] * voice.volume));
-                    }
+            // Every job writes the times of its own voice, so they don't need to be synchronized till the pool has finished running
+            if (measure)
+                voiceTimes[index] = {start, util::GetTimeNs()};
+        });
 
-                    bufferOffset++;
-                }
+        u64 mixStart{};
+        if (measure) {
+            for (size_t index{}; index < voiceTimes.size(); index++) {
+                auto &[start, end]{voiceTimes[index]};
+                if (end)
+                    performance.AddEntry(voices[index].nodeId, PerformanceEntryType::Voice, start, end);
+                start = end = 0;
             }
+            mixStart = util::GetTimeNs();
+        }
+
+        u32 writtenSamples{};
+        for (auto &partialMix : partialMixes) {
+            auto mixSize{std::min(partialMix.writtenSamples, writtenSamples)};
+            skyline::audio::mix::Mix(sampleBuffer.data(), partialMix.sampleBuffer.data(), mixSize);
+            std::memcpy(sampleBuffer.data() + mixSize, partialMix.sampleBuffer.data() + mixSize, (partialMix.writtenSamples - mixSize) * sizeof(i16));
+
+            writtenSamples = std::max(writtenSamples, partialMix.writtenSamples);
         }
+
+        // Any part of the buffer that no voice has written to is silent rather than holding the samples of the previous mix
+        std::fill(sampleBuffer.begin() + writtenSamples, sampleBuffer.begin() + updateSamples, 0);
+
+        if (!activeEffects.empty())
+            ApplyEffects();
+
+        // Voices are mixed straight into the final mix as submixes aren't emulated, so the reduction and effects are all accounted to it
+        if (measure)
+            performance.AddEntry(MakeNodeId(NodeIdType::Mix, 0), PerformanceEntryType::FinalMix, mixStart, util::GetTimeNs());
+    }
+
+    void IAudioRenderer::ApplyEffects() {
+        TRACE_SECTION("IAudioRenderer::ApplyEffects");
+
+        // Effects are applied to 32-bit samples so intermediate values don't saturate between effects, the result is only saturated once they're all done
+        skyline::audio::mix::Widen(effectBuffer.data(), sampleBuffer.data(), updateSamples);
+        for (auto effect : activeEffects)
+            effect->Process(state, std::span(effectBuffer.data(), updateSamples), effectScratch);
+        skyline::audio::mix::Narrow(sampleBuffer.data(), effectBuffer.data(), updateSamples);
     }
 
     Result IAudioRenderer::Start(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
@@ -7,9 +7,12 @@
 #include <services/base_service.h>
 #include <services/serviceman.h>
 #include <audio.h>
+#include <footprint.h>
 #include "memory_pool.h"
 #include "effect.h"
+#include "performance.h"
 #include "voice.h"
+#include "render_pool.h"
 #include "revision_info.h"
 
 namespace skyline {
@@ -66,19 +69,40 @@ namespace skyline {
             AudioRendererParameters parameters;
             RevisionInfo revisionInfo{}; //!< Stores info about supported features for the audren revision used
             std::shared_ptr<skyline::audio::AudioTrack> track; //!< The audio track associated with the audio renderer
-            std::shared_ptr<type::KEvent> systemEvent; //!< The KEvent that is signalled when the DSP has processed all the commands
+            std::shared_ptr<type::KEvent> systemEvent; //!< The KEvent that is signalled when the output device has played a buffer, the guest is expected to update the renderer after this
             std::vector<MemoryPool> memoryPools;
             std::vector<Effect> effects;
-            std::vector<Voice> voices;
+            std::vector<Effect *> activeEffects; //!< The effects that modify the final mix, sorted by their processing order
+            footprint::Vector<Voice, footprint::Subsystem::Audio> voices;
             std::array<i16, constant::MixBufferSize * constant::ChannelCount> sampleBuffer{}; //!< The final output data that is appended to the stream
+            u32 updateSamples{}; //!< The amount of samples in the sample buffer that are mixed for every buffer, this corresponds to the sample count of an update on the DSP
+            PerformanceManager performance;
+            std::vector<std::pair<u64, u64>> voiceTimes; //!< The time every voice started and finished rendering at in the current frame, this is only recorded with performance frames enabled and is zero for voices that weren't rendered
+
+            /**
+             * @brief The voices rendered by a single thread of the render pool are mixed into its own partial mix, these are reduced into the final output data
+             */
+            struct PartialMix {
+                std::array<i16, constant::MixBufferSize * constant::ChannelCount> voiceBuffer; //!< The output of a single voice before it's mixed into the partial mix
+                std::array<i16, constant::MixBufferSize * constant::ChannelCount> sampleBuffer; //!< The mixed output of all voices rendered by the thread
+                u32 writtenSamples; //!< The amount of samples in the sample buffer that have been written to by any voice
+            };
+            footprint::Vector<PartialMix, footprint::Subsystem::Audio> partialMixes; //!< The partial mix of every thread in the render pool, indexed by the thread's index
+            std::array<i32, constant::MixBufferSize * constant::ChannelCount> effectBuffer; //!< The final output data widened to 32-bit samples while effects are applied to it
+            std::array<i32, constant::MixBufferSize * constant::ChannelCount> effectScratch; //!< The channels of the final output data that an effect is routed through when they aren't its own
             skyline::audio::AudioOutState playbackState{skyline::audio::AudioOutState::Stopped};
+            RenderPool renderPool; //!< The pool of threads that voices are rendered on, this is declared last so it's destroyed before any state its jobs use
 
             /**
-             * @brief Obtains new sample data from voices and mixes it together into the sample buffer
-             * @return The amount of samples present in the buffer
+             * @brief Obtains new sample data from voices and mixes it together into the sample buffer, voices are decoded and resampled in parallel into partial mixes that are then reduced
              */
             void MixFinalBuffer();
 
+            /**
+             * @brief Applies all active effects to the sample buffer in their processing order
+             */
+            void ApplyEffects();
+
             /**
              * @brief Appends all released buffers with new mixed sample data
              */
@@ -134,6 +158,18 @@ namespace skyline {
             * @brief Returns a handle to the sample release KEvent
             */
             Result QuerySystemEvent(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            SERVICE_DECL(
+                SFUNC(0x0, IAudioRenderer, GetSampleRate),
+                SFUNC(0x1, IAudioRenderer, GetSampleCount),
+                SFUNC(0x2, IAudioRenderer, GetMixBufferCount),
+                SFUNC(0x3, IAudioRenderer, GetState),
+                SFUNC(0x4, IAudioRenderer, RequestUpdate),
+                SFUNC(0x5, IAudioRenderer, Start),
+                SFUNC(0x6, IAudioRenderer, Stop),
+                SFUNC(0x7, IAudioRenderer, QuerySystemEvent),
+                SFUNC(0xA, IAudioRenderer, RequestUpdate)
+            )
         };
     }
 }
@@ -0,0 +1,401 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <arm_neon.h>
+#include <kernel/types/KProcess.h>
+#include "effect.h"
+
+namespace skyline::service::audio::IAudioRenderer {
+    constexpr i32 Q14One{1 << 14};
+    constexpr u32 FramesPerMillisecond{constant::SampleRate / 1000};
+    constexpr u32 MaxDelayTime{5000}; //!< The maximum delay time of a delay effect in milliseconds, this bounds the size of its delay lines
+    constexpr float MaxReflectionsDelay{0.3f}; //!< The maximum delay of the early reflections of a reverb in seconds
+    constexpr float MaxReverbDelay{0.1f}; //!< The maximum delay of the late reverberation of a reverb relative to the early reflections in seconds
+    constexpr std::array<float, 4> ReflectionTapTimes{0.0f, 0.0071f, 0.0113f, 0.0187f}; //!< The time of every early reflection tap relative to the first one in seconds
+    constexpr std::array<float, 4> ReflectionTapGains{0.6f, 0.55f, -0.45f, -0.4f}; //!< The gain of every early reflection tap, taps alternate between the lanes
+    constexpr std::array<float, 4> LineTimes{0.0297f, 0.0371f, 0.0411f, 0.0437f}; //!< The delay of every line in the feedback delay network at full density in seconds, these are spread apart so the echoes of different lines rarely coincide
+    constexpr float DiffuserTime{0.0053f}; //!< The delay of the all-pass filter that diffuses the input of the late reverberation in seconds
+    constexpr int ReverbFractionalBits{8}; //!< The amount of fractional bits samples are scaled up by in the reverb, this keeps the precision of the feedback paths
+    constexpr int DelayFractionalBits{6}; //!< The amount of fractional bits samples are scaled up by in the delay
+
+    namespace {
+        /**
+         * @return The supplied value as a Q31 fixed-point value, this is saturated to the range of Q31
+         */
+        i32 ToQ31(double value) {
+            return static_cast<i32>(std::clamp(value * 2147483648.0, -2147483648.0, 2147483647.0));
+        }
+
+        /**
+         * @return The linear gain of a level in millibels
+         */
+        double FromMillibels(float level) {
+            return std::pow(10.0, std::clamp(level, -10000.0f, 0.0f) / 2000.0);
+        }
+
+        /**
+         * @param nyquistGain The gain of a one-pole low-pass filter at the Nyquist frequency relative to its gain at DC
+         * @return The coefficient of the filter's feedback, the input is scaled by 1 minus this
+         */
+        double LowPassCoefficient(double nyquistGain) {
+            nyquistGain = std::clamp(nyquistGain, 0.0, 1.0);
+            return std::min((1.0 - nyquistGain) / (1.0 + nyquistGain), 0.99);
+        }
+
+        /**
+         * @return The index of the sample that's the supplied distance behind a position in a ring
+         */
+        u32 RingBehind(u32 position, u32 distance, u32 size) {
+            return (position >= distance) ? position - distance : position + size - distance;
+        }
+    }
+
+    void Effect::UpdateChannels(std::span<const u8> input, std::span<const u8> output, size_t count) {
+        count = std::min<size_t>(count, constant::ChannelCount);
+        inputs.fill(constant::ChannelCount);
+        outputs.fill(constant::ChannelCount);
+
+        channelCount = 0;
+        for (size_t lane{}; lane < count; lane++) {
+            inputs[lane] = std::min<u8>(input[lane], constant::ChannelCount);
+            outputs[lane] = std::min<u8>(output[lane], constant::ChannelCount);
+            if (outputs[lane] != constant::ChannelCount)
+                channelCount = static_cast<u8>(count); // An effect is only processed if any of its channels end up in the final mix
+        }
+    }
+
+    void Effect::UpdateDelay(const DelayParameter &parameter, bool reset) {
+        auto lineFrames{std::clamp<u32>(parameter.delayTimeMax, 1, MaxDelayTime) * FramesPerMillisecond};
+        if (reset || delay.line.size() != lineFrames * constant::ChannelCount) {
+            delay.line.assign(lineFrames * constant::ChannelCount, 0);
+            delay.position = 0;
+            delay.lowPass = {};
+        }
+
+        delay.length = std::clamp<u32>(parameter.delayTime * FramesPerMillisecond, 1, lineFrames);
+        if (delay.position >= delay.length)
+            delay.position = 0;
+
+        delay.inGain = parameter.inGain;
+        delay.dryGain = parameter.dryGain;
+        delay.outGain = parameter.outGain;
+
+        // The spread moves feedback from a channel's own delay line to the other channel's, this can only be done with both of them
+        auto spread{channelCount == 2 ? std::clamp(parameter.channelSpread, 0, Q14One) : 0};
+        delay.feedbackGain = static_cast<i32>((static_cast<i64>(parameter.feedbackGain) * (Q14One - spread)) >> 14);
+        delay.crossGain = static_cast<i32>((static_cast<i64>(parameter.feedbackGain) * spread) >> 14);
+
+        constexpr i32 MaxLowPass{(Q14One * 95) / 100}; //!< The low-pass filter is never fully closed as the feedback would be stuck at a constant
+        delay.lowPassFeedback = static_cast<i32>((static_cast<i64>(std::clamp(parameter.lowPassAmount, 0, Q14One)) * MaxLowPass) >> 14);
+        delay.lowPassGain = Q14One - delay.lowPassFeedback;
+    }
+
+    void Effect::UpdateI3dl2Reverb(const I3dl2ReverbParameter &parameter, bool reset) {
+        constexpr double SampleRate{constant::SampleRate};
+        auto toFrames{[](double time) { return static_cast<u32>(std::lround(time * SampleRate)); }};
+
+        auto preDelayFrames{toFrames(MaxReflectionsDelay + MaxReverbDelay + ReflectionTapTimes.back()) + 1};
+        if (reset || reverb.preDelay.size() != preDelayFrames) {
+            reverb.preDelay.assign(preDelayFrames, 0);
+            reverb.preDelayPosition = 0;
+            reverb.roomHf = 0;
+            reverb.lineDamping = {};
+            reverb.diffuser.assign(toFrames(DiffuserTime), 0);
+            reverb.diffuserPosition = 0;
+        }
+
+        auto reflectionsDelay{std::clamp(static_cast<double>(parameter.reflectionsDelay), 0.0, static_cast<double>(MaxReflectionsDelay))};
+        auto reverbDelay{std::clamp(static_cast<double>(parameter.reverbDelay), 0.0, static_cast<double>(MaxReverbDelay))};
+        for (size_t tap{}; tap < ReverbTapCount; tap++)
+            reverb.taps[tap] = toFrames(reflectionsDelay + ReflectionTapTimes[tap]);
+        reverb.lateTap = toFrames(reflectionsDelay + reverbDelay);
+
+        // The density scales the lengths of the lines which changes how closely spaced the modes of the late reverberation are
+        auto densityScale{0.5 + (std::clamp(parameter.density, 0.0f, 100.0f) / 200.0)};
+        auto decayTime{std::clamp(static_cast<double>(parameter.decayTime), 0.1, 20.0)};
+        auto hfDecayRatio{std::clamp(static_cast<double>(parameter.hfDecayRatio), 0.1, 2.0)};
+        double totalLength{};
+        for (size_t line{}; line < ReverbLineCount; line++) {
+            auto length{std::max<u32>(toFrames(LineTimes[line] * densityScale), 1)};
+            if (reverb.lines[line].size() != length) {
+                reverb.lines[line].assign(length, 0);
+                reverb.linePositions[line] = 0;
+            }
+            totalLength += length;
+
+            // Every pass through a line attenuates it by the amount that results in a 60dB decay over the decay time
+            reverb.lineGains[line] = ToQ31(std::pow(10.0, (-3.0 * length) / (SampleRate * decayTime)));
+        }
+
+        // High frequencies decay faster than the rest by the decay time ratio, this is the additional attenuation of them per pass through an average line
+        auto averageLength{totalLength / ReverbLineCount};
+        auto hfGain{std::pow(10.0, ((-3.0 * averageLength) / (SampleRate * decayTime)) * ((1.0 / hfDecayRatio) - 1.0))};
+        reverb.lineDampingGain = ToQ31(LowPassCoefficient(hfGain));
+        reverb.roomHfGain = ToQ31(LowPassCoefficient(FromMillibels(parameter.roomHf)));
+        reverb.diffusionGain = ToQ31((std::clamp(parameter.diffusion, 0.0f, 100.0f) / 100.0) * 0.6);
+
+        auto earlyGain{FromMillibels(parameter.room + parameter.reflections)};
+        for (size_t tap{}; tap < ReverbTapCount; tap++)
+            reverb.tapGains[tap] = ToQ31(ReflectionTapGains[tap] * earlyGain);
+        reverb.lateGain = ToQ31(FromMillibels(parameter.room + parameter.reverb) * 0.5); // Every lane is the sum of two lines
+        reverb.dryGain = ToQ31(std::clamp(parameter.dryGain, 0.0f, 1.0f));
+    }
+
+    void Effect::ProcessInput(const EffectIn &input) {
+        if (!input.isNew && std::memcmp(&input, &lastInput, sizeof(EffectIn)) == 0)
+            return;
+        lastInput = input;
+
+        bool reset{input.isNew || input.type != type};
+        type = input.type;
+        enabled = input.isEnabled;
+        processingOrder = input.processingOrder;
+
+        switch (type) {
+            case EffectType::BiquadFilter: {
+                const auto &parameter{input.biquadFilter};
+                UpdateChannels(parameter.input, parameter.output, parameter.channelCount);
+                std::copy(parameter.numerator.begin(), parameter.numerator.end(), biquad.numerator.begin());
+                std::copy(parameter.denominator.begin(), parameter.denominator.end(), biquad.denominator.begin());
+                if (reset)
+                    biquad.history = {};
+                break;
+            }
+
+            case EffectType::Delay: {
+                const auto &parameter{input.delay};
+                UpdateChannels(parameter.input, parameter.output, parameter.channelCount);
+                UpdateDelay(parameter, reset);
+                break;
+            }
+
+            case EffectType::I3dl2Reverb: {
+                const auto &parameter{input.i3dl2Reverb};
+                UpdateChannels(parameter.input, parameter.output, parameter.channelCount);
+                UpdateI3dl2Reverb(parameter, reset);
+                break;
+            }
+
+            case EffectType::Aux: {
+                const auto &parameter{input.aux};
+                UpdateChannels(parameter.input, parameter.output, parameter.channelCount);
+                aux.storageSize = parameter.bufferStorageSize;
+                aux.sendInfo = parameter.sendBufferInfo;
+                aux.sendStorage = parameter.sendBufferStorage;
+                aux.returnInfo = parameter.returnBufferInfo;
+                aux.returnStorage = parameter.returnBufferStorage;
+                break;
+            }
+
+            default:
+                channelCount = 0; // Effects that aren't implemented leave the final mix as it is
+                break;
+        }
+
+        if (input.isNew)
+            output.state = EffectState::New;
+        else if (type != EffectType::None)
+            output.state = enabled ? EffectState::Enabled : EffectState::Disabled;
+    }
+
+    void Effect::ProcessBiquadFilter(i32 *samples, u32 frames) {
+        auto b0{vdup_n_s32(biquad.numerator[0])}, b1{vdup_n_s32(biquad.numerator[1])}, b2{vdup_n_s32(biquad.numerator[2])};
+        auto a1{vdup_n_s32(biquad.denominator[0])}, a2{vdup_n_s32(biquad.denominator[1])};
+        auto x1{vld1_s32(biquad.history.data())}, x2{vld1_s32(biquad.history.data() + 2)}, y1{vld1_s32(biquad.history.data() + 4)}, y2{vld1_s32(biquad.history.data() + 6)};
+
+        // Both lanes are filtered at once, the denominator is stored negated so every term is accumulated
+        for (u32 frame{}; frame < frames; frame++) {
+            auto x{vld1_s32(samples + (frame * constant::ChannelCount))};
+            auto accumulator{vmull_s32(x, b0)};
+            accumulator = vmlal_s32(accumulator, x1, b1);
+            accumulator = vmlal_s32(accumulator, x2, b2);
+            accumulator = vmlal_s32(accumulator, y1, a1);
+            accumulator = vmlal_s32(accumulator, y2, a2);
+            auto y{vqrshrn_n_s64(accumulator, 14)};
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            vst1_s32(samples + (frame * constant::ChannelCount), y);
+        }
+
+        vst1_s32(biquad.history.data(), x1);
+        vst1_s32(biquad.history.data() + 2, x2);
+        vst1_s32(biquad.history.data() + 4, y1);
+        vst1_s32(biquad.history.data() + 6, y2);
+    }
+
+    void Effect::ProcessDelay(i32 *samples, u32 frames) {
+        auto inGain{vdup_n_s32(delay.inGain)}, dryGain{vdup_n_s32(delay.dryGain)}, outGain{vdup_n_s32(delay.outGain)};
+        auto feedbackGain{vdup_n_s32(delay.feedbackGain)}, crossGain{vdup_n_s32(delay.crossGain)};
+        auto lowPassGain{vdup_n_s32(delay.lowPassGain)}, lowPassFeedback{vdup_n_s32(delay.lowPassFeedback)};
+        auto lowPass{vld1_s32(delay.lowPass.data())};
+        auto line{delay.line.data()};
+        auto position{delay.position};
+
+        for (u32 frame{}; frame < frames; frame++) {
+            auto x{vshl_n_s32(vld1_s32(samples + (frame * constant::ChannelCount)), DelayFractionalBits)};
+            auto delayed{vld1_s32(line + (position * constant::ChannelCount))};
+
+            // The feedback of a lane is a mix of its own delay line and the other lane's, VREV64 swaps the lanes
+            auto accumulator{vmull_s32(x, inGain)};
+            accumulator = vmlal_s32(accumulator, delayed, feedbackGain);
+            accumulator = vmlal_s32(accumulator, vrev64_s32(delayed), crossGain);
+            auto feedback{vqrshrn_n_s64(accumulator, 14)};
+
+            lowPass = vqrshrn_n_s64(vmlal_s32(vmull_s32(feedback, lowPassGain), lowPass, lowPassFeedback), 14);
+            vst1_s32(line + (position * constant::ChannelCount), lowPass);
+
+            auto y{vqrshrn_n_s64(vmlal_s32(vmull_s32(x, dryGain), delayed, outGain), 14)};
+            vst1_s32(samples + (frame * constant::ChannelCount), vrshr_n_s32(y, DelayFractionalBits));
+
+            if (++position == delay.length)
+                position = 0;
+        }
+
+        vst1_s32(delay.lowPass.data(), lowPass);
+        delay.position = position;
+    }
+
+    void Effect::ProcessI3dl2Reverb(i32 *samples, u32 frames) {
+        auto tapGains{vld1q_s32(reverb.tapGains.data())}, lineGains{vld1q_s32(reverb.lineGains.data())};
+        auto lineDampingGain{vdupq_n_s32(reverb.lineDampingGain)};
+        auto lineDamping{vld1q_s32(reverb.lineDamping.data())};
+        auto lateGain{vdup_n_s32(reverb.lateGain)}, dryGain{vdup_n_s32(reverb.dryGain)};
+        auto preDelaySize{static_cast<u32>(reverb.preDelay.size())}, diffuserSize{static_cast<u32>(reverb.diffuser.size())};
+
+        for (u32 frame{}; frame < frames; frame++) {
+            auto x{vshl_n_s32(vld1_s32(samples + (frame * constant::ChannelCount)), ReverbFractionalBits)};
+
+            // The reverb is fed a mono downmix which is darkened by the room's high-frequency attenuation
+            auto mono{channelCount == 1 ? vget_lane_s32(x, 0) : (vget_lane_s32(x, 0) >> 1) + (vget_lane_s32(x, 1) >> 1)};
+            reverb.roomHf = mono + vqrdmulhs_s32(reverb.roomHf - mono, reverb.roomHfGain);
+            reverb.preDelay[reverb.preDelayPosition] = reverb.roomHf;
+
+            std::array<i32, ReverbTapCount> taps;
+            for (size_t tap{}; tap < ReverbTapCount; tap++)
+                taps[tap] = reverb.preDelay[RingBehind(reverb.preDelayPosition, reverb.taps[tap], preDelaySize)];
+            auto earlyTaps{vqrdmulhq_s32(vld1q_s32(taps.data()), tapGains)};
+            auto early{vadd_s32(vget_low_s32(earlyTaps), vget_high_s32(earlyTaps))};
+
+            // A Schroeder all-pass filter smears the input of the late reverberation in time without colouring it
+            auto lateInput{reverb.preDelay[RingBehind(reverb.preDelayPosition, reverb.lateTap, preDelaySize)]};
+            auto diffused{reverb.diffuser[reverb.diffuserPosition]};
+            auto diffuserInput{lateInput + vqrdmulhs_s32(diffused, reverb.diffusionGain)};
+            reverb.diffuser[reverb.diffuserPosition] = diffuserInput;
+            lateInput = diffused - vqrdmulhs_s32(diffuserInput, reverb.diffusionGain);
+
+            std::array<i32, ReverbLineCount> lineOutputs;
+            for (size_t line{}; line < ReverbLineCount; line++)
+                lineOutputs[line] = reverb.lines[line][reverb.linePositions[line]];
+            auto lines{vld1q_s32(lineOutputs.data())};
+            lineDamping = vaddq_s32(lines, vqrdmulhq_s32(vsubq_s32(lineDamping, lines), lineDampingGain));
+
+            // The lines are mixed into each other with a 4x4 Hadamard matrix scaled by 1/2, this is orthogonal so it doesn't add or remove energy from the network
+            auto swapped{vrev64q_s32(lineDamping)};
+            auto pairs{vtrn2q_s32(vaddq_s32(lineDamping, swapped), vsubq_s32(swapped, lineDamping))};
+            auto rotated{vextq_s32(pairs, pairs, 2)};
+            auto mixed{vcombine_s32(vget_low_s32(vaddq_s32(pairs, rotated)), vget_low_s32(vsubq_s32(pairs, rotated)))};
+            auto feedback{vaddq_s32(vqrdmulhq_s32(vshrq_n_s32(mixed, 1), lineGains), vdupq_n_s32(lateInput))};
+
+            vst1q_s32(lineOutputs.data(), feedback);
+            for (size_t line{}; line < ReverbLineCount; line++) {
+                reverb.lines[line][reverb.linePositions[line]] = lineOutputs[line];
+                if (++reverb.linePositions[line] == reverb.lines[line].size())
+                    reverb.linePositions[line] = 0;
+            }
+
+            auto late{vqrdmulh_s32(vadd_s32(vget_low_s32(lineDamping), vget_high_s32(lineDamping)), lateGain)};
+            auto y{vadd_s32(vadd_s32(vqrdmulh_s32(x, dryGain), early), late)};
+            vst1_s32(samples + (frame * constant::ChannelCount), vrshr_n_s32(y, ReverbFractionalBits));
+
+            if (++reverb.preDelayPosition == preDelaySize)
+                reverb.preDelayPosition = 0;
+            if (++reverb.diffuserPosition == diffuserSize)
+                reverb.diffuserPosition = 0;
+        }
+
+        vst1q_s32(reverb.lineDamping.data(), lineDamping);
+    }
+
+    void Effect::ProcessAux(const DeviceState &state, i32 *samples, u32 frames) {
+        auto size{aux.storageSize};
+        if (!size || !aux.sendInfo || !aux.sendStorage || !aux.returnInfo || !aux.returnStorage)
+            return;
+
+        // The samples of every channel are written to the send buffer as a contiguous block, the guest returns them in the same layout
+        auto sendInfo{state.process->GetPointer<AuxBufferInfo>(aux.sendInfo)};
+        auto sendStorage{state.process->GetPointer<i32>(aux.sendStorage)};
+        auto writeOffset{sendInfo->writeOffset % size};
+        for (u8 lane{}; lane < channelCount; lane++) {
+            for (u32 frame{}; frame < frames; frame++) {
+                sendStorage[writeOffset] = samples[(frame * constant::ChannelCount) + lane];
+                if (++writeOffset == size)
+                    writeOffset = 0;
+            }
+        }
+        sendInfo->writeOffset = writeOffset;
+
+        auto returnInfo{state.process->GetPointer<AuxBufferInfo>(aux.returnInfo)};
+        auto returnStorage{state.process->GetPointer<i32>(aux.returnStorage)};
+        auto readOffset{returnInfo->readOffset % size};
+        auto available{RingBehind(returnInfo->writeOffset % size, readOffset, size) % size};
+        if (available < frames * channelCount) {
+            // The guest hasn't returned the samples of this update yet, the effect's output is silent till it does
+            for (u32 frame{}; frame < frames; frame++)
+                for (u8 lane{}; lane < channelCount; lane++)
+                    samples[(frame * constant::ChannelCount) + lane] = 0;
+            return;
+        }
+
+        for (u8 lane{}; lane < channelCount; lane++) {
+            for (u32 frame{}; frame < frames; frame++) {
+                samples[(frame * constant::ChannelCount) + lane] = returnStorage[readOffset];
+                if (++readOffset == size)
+                    readOffset = 0;
+            }
+        }
+        returnInfo->readOffset = readOffset;
+    }
+
+    void Effect::Process(const DeviceState &state, std::span<i32> buffer, std::span<i32> scratch) {
+        auto frames{static_cast<u32>(buffer.size() / constant::ChannelCount)};
+
+        // Effects that are routed straight through the final mix are processed in place, any others have their channels gathered into the scratch buffer
+        bool direct{true};
+        for (u8 lane{}; lane < constant::ChannelCount; lane++)
+            direct &= inputs[lane] == lane && outputs[lane] == lane;
+
+        auto samples{buffer.data()};
+        if (!direct) {
+            samples = scratch.data();
+            for (u32 frame{}; frame < frames; frame++)
+                for (u8 lane{}; lane < constant::ChannelCount; lane++)
+                    samples[(frame * constant::ChannelCount) + lane] = (inputs[lane] < constant::ChannelCount) ? buffer[(frame * constant::ChannelCount) + inputs[lane]] : 0;
+        }
+
+        switch (type) {
+            case EffectType::BiquadFilter:
+                ProcessBiquadFilter(samples, frames);
+                break;
+            case EffectType::Delay:
+                ProcessDelay(samples, frames);
+                break;
+            case EffectType::I3dl2Reverb:
+                ProcessI3dl2Reverb(samples, frames);
+                break;
+            case EffectType::Aux:
+                ProcessAux(state, samples, frames);
+                break;
+            default:
+                break;
+        }
+
+        if (!direct)
+            for (u32 frame{}; frame < frames; frame++)
+                for (u8 lane{}; lane < constant::ChannelCount; lane++)
+                    if (outputs[lane] < constant::ChannelCount)
+                        buffer[(frame * constant::ChannelCount) + outputs[lane]] = samples[(frame * constant::ChannelCount) + lane];
+    }
+}
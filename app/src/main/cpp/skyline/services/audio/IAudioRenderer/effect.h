@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <audio/common.h>
 #include <common.h>
 
 namespace skyline::service::audio::IAudioRenderer {
@@ -12,15 +13,134 @@ namespace skyline::service::audio::IAudioRenderer {
     enum class EffectState : u8 {
         None = 0, //!< The effect isn't being used
         New = 1,
+        Enabled = 2,
+        Disabled = 3,
     };
 
+    /**
+     * @brief The types of effects that can be applied to mix buffers
+     */
+    enum class EffectType : u8 {
+        None = 0,
+        BufferMix = 1,
+        Aux = 2, //!< The samples are sent to the guest and replaced with the samples it returns
+        Delay = 3,
+        Reverb = 4,
+        I3dl2Reverb = 5,
+        BiquadFilter = 6,
+    };
+
+    /**
+     * @brief The parameters of a biquad filter effect
+     * @note The coefficients are Q14 fixed-point values
+     */
+    struct BiquadFilterParameter {
+        std::array<u8, 6> input; //!< The mix buffer indices of every input channel
+        std::array<u8, 6> output; //!< The mix buffer indices of every output channel
+        std::array<i16, 3> numerator;
+        std::array<i16, 2> denominator;
+        u8 channelCount;
+        u8 status;
+    };
+    static_assert(sizeof(BiquadFilterParameter) == 0x18);
+
+    /**
+     * @brief The parameters of a delay effect
+     * @note The gains, channel spread and low-pass amount are Q14 fixed-point values
+     */
+    struct DelayParameter {
+        std::array<u8, 6> input;
+        std::array<u8, 6> output;
+        u16 channelCountMax;
+        u16 channelCount;
+        u32 delayTimeMax; //!< The maximum delay time in milliseconds, this determines the size of the delay lines
+        u32 delayTime; //!< The delay time in milliseconds
+        u32 sampleRate;
+        i32 inGain;
+        i32 feedbackGain;
+        i32 outGain;
+        i32 dryGain;
+        i32 channelSpread; //!< The fraction of the feedback from a channel's delay line that goes into the other channel's
+        i32 lowPassAmount; //!< The amount of low-pass filtering applied to the feedback
+        u8 status;
+        u8 _pad0_[3];
+    };
+    static_assert(sizeof(DelayParameter) == 0x38);
+
+    /**
+     * @brief The parameters of an I3DL2 reverb effect, the levels are in millibels
+     */
+    struct I3dl2ReverbParameter {
+        std::array<u8, 6> input;
+        std::array<u8, 6> output;
+        u16 channelCountMax;
+        u16 channelCount;
+        u32 _pad0_;
+        u32 sampleRate;
+        float roomHf; //!< The attenuation of high frequencies in the room
+        float hfReference;
+        float decayTime; //!< The decay time of the late reverberation at low frequencies in seconds
+        float hfDecayRatio; //!< The ratio of the decay time at high frequencies to the decay time at low frequencies
+        float room; //!< The attenuation of the room effect
+        float reflections; //!< The attenuation of the early reflections relative to the room
+        float reverb; //!< The attenuation of the late reverberation relative to the room
+        float diffusion; //!< The echo density of the late reverberation in percent
+        float reflectionsDelay; //!< The delay of the first early reflection in seconds
+        float reverbDelay; //!< The delay of the late reverberation relative to the first early reflection in seconds
+        float density; //!< The modal density of the late reverberation in percent
+        float dryGain;
+        u8 status;
+        u8 _pad1_[3];
+    };
+    static_assert(sizeof(I3dl2ReverbParameter) == 0x4C);
+
+    /**
+     * @brief The parameters of an auxiliary buffer effect, the guest reads the samples of the mix buffers from the send buffer and writes their replacements into the return buffer
+     */
+    struct AuxParameter {
+        std::array<u8, 24> input;
+        std::array<u8, 24> output;
+        u32 channelCount;
+        u32 sampleRate;
+        u32 bufferStorageSize; //!< The amount of samples that fit into the storage of each buffer
+        u32 _pad0_;
+        u64 sendBufferInfo; //!< The address of the AuxBufferInfo of the send buffer
+        u64 sendBufferStorage; //!< The address of the 32-bit samples of the send buffer
+        u64 returnBufferInfo;
+        u64 returnBufferStorage;
+    };
+    static_assert(sizeof(AuxParameter) == 0x60);
+
+    /**
+     * @brief The read and write offsets of a ring of samples in guest memory which is shared between the DSP and the guest
+     */
+    struct AuxBufferInfo {
+        u32 readOffset;
+        u32 writeOffset;
+        u8 _pad0_[0x38];
+    };
+    static_assert(sizeof(AuxBufferInfo) == 0x40);
+
     /**
      * @brief This is in input containing information on what effects to use on an audio stream
      */
     struct EffectIn {
-        u8 _unk0_;
+        EffectType type;
         u8 isNew; //!< Whether the effect was used in the previous samples
-        u8 _unk1_[0xBE];
+        u8 isEnabled;
+        u8 _pad0_;
+        u32 mixId;
+        u64 bufferAddress;
+        u64 bufferSize;
+        i32 processingOrder;
+        u32 _pad1_;
+        union {
+            BiquadFilterParameter biquadFilter;
+            DelayParameter delay;
+            I3dl2ReverbParameter i3dl2Reverb;
+            AuxParameter aux;
+            u8 raw[0xA0];
+        };
     };
     static_assert(sizeof(EffectIn) == 0xC0);
 
@@ -34,15 +154,103 @@ namespace skyline::service::audio::IAudioRenderer {
     static_assert(sizeof(EffectOut) == 0x10);
 
     /**
-    * @brief The Effect class stores the state of audio post processing effects
+    * @brief The Effect class stores the state of audio post processing effects and applies them to the final mix
+    * @details The renderer doesn't have mix buffers, so the mix buffer indices that an effect's channels are routed through are instead treated as channels of the final mix and those beyond it are dropped
+    * @note Samples are processed as interleaved 32-bit integers with two lanes, a lane for each channel of the final mix. Filters in the feedback paths use Q14 and Q31 fixed-point coefficients with NEON
     */
     class Effect {
+      private:
+        EffectIn lastInput{}; //!< The input of the last update, the parameters of an effect usually stay the same and recomputing them involves transcendental functions for reverbs
+        EffectType type{};
+        bool enabled{};
+        u8 channelCount{}; //!< The amount of channels that are processed, this is limited to the channels of the final mix
+        std::array<u8, constant::ChannelCount> inputs{}; //!< The channel of the final mix that every lane is read from
+        std::array<u8, constant::ChannelCount> outputs{}; //!< The channel of the final mix that every lane is written to, this is ChannelCount for lanes that are dropped
+
+        struct {
+            std::array<i32, 3> numerator; //!< The Q14 coefficients applied to the current and the last two inputs
+            std::array<i32, 2> denominator; //!< The Q14 coefficients applied to the last two outputs
+            std::array<i32, constant::ChannelCount * 4> history; //!< The last two inputs and outputs of every lane in that order
+        } biquad{};
+
+        struct {
+            std::vector<i32> line; //!< The interleaved delay lines of every lane
+            u32 length; //!< The amount of frames that samples are delayed by
+            u32 position; //!< The frame of the delay line that's read and then written
+            i32 inGain, dryGain, outGain, feedbackGain, crossGain, lowPassGain, lowPassFeedback; //!< Q14 gains
+            std::array<i32, constant::ChannelCount> lowPass; //!< The last output of the low-pass filter of every lane
+        } delay{};
+
+        /**
+         * @brief The state of an I3DL2 reverb, it's a tapped pre-delay line for early reflections that feeds a 4 line feedback delay network for late reverberation
+         * @note All gains are Q31 fixed-point values and samples are scaled up to have 8 fractional bits
+         */
+        static constexpr size_t ReverbTapCount{4}; //!< The amount of early reflection taps of a reverb, every other tap goes to the other lane
+        static constexpr size_t ReverbLineCount{4}; //!< The amount of delay lines in the feedback delay network of a reverb
+
+        struct {
+            std::vector<i32> preDelay; //!< The mono input to the reverb after the room high-frequency filter
+            u32 preDelayPosition;
+            std::array<u32, ReverbTapCount> taps; //!< The distance of every early reflection tap from the write position of the pre-delay line
+            u32 lateTap; //!< The distance of the input of the late reverberation from the write position of the pre-delay line
+            std::array<std::vector<i32>, ReverbLineCount> lines;
+            std::array<u32, ReverbLineCount> linePositions;
+            std::array<i32, ReverbLineCount> lineDamping; //!< The last output of the high-frequency damping filter of every line
+            std::array<i32, ReverbLineCount> lineGains; //!< The gain applied to every line for its decay time
+            std::array<i32, ReverbTapCount> tapGains;
+            i32 lineDampingGain; //!< The coefficient of the one-pole low-pass filter applied to the output of every line, this is the same for all as it's derived from the ratio of decay times
+            i32 roomHfGain; //!< The coefficient of the one-pole low-pass filter applied to the input
+            i32 roomHf; //!< The last output of the input filter
+            std::vector<i32> diffuser; //!< The all-pass filter applied to the input of the late reverberation
+            u32 diffuserPosition;
+            i32 diffusionGain;
+            i32 lateGain, dryGain;
+        } reverb{};
+
+        struct {
+            u32 channelCount;
+            u32 storageSize;
+            u64 sendInfo, sendStorage, returnInfo, returnStorage;
+        } aux{};
+
+        void ProcessBiquadFilter(i32 *samples, u32 frames);
+
+        void ProcessDelay(i32 *samples, u32 frames);
+
+        void ProcessI3dl2Reverb(i32 *samples, u32 frames);
+
+        void ProcessAux(const DeviceState &state, i32 *samples, u32 frames);
+
+        void UpdateDelay(const DelayParameter &parameter, bool reset);
+
+        void UpdateI3dl2Reverb(const I3dl2ReverbParameter &parameter, bool reset);
+
+        /**
+         * @brief Maps the input and output mix buffer indices of the effect onto the lanes of the final mix
+         */
+        void UpdateChannels(std::span<const u8> input, std::span<const u8> output, size_t count);
+
       public:
         EffectOut output{};
+        i32 processingOrder{}; //!< The order in which the effect is applied relative to other effects
 
-        inline void ProcessInput(const EffectIn &input) {
-            if (input.isNew)
-                output.state = EffectState::New;
+        /**
+         * @note An input that's identical to the last one isn't processed again unless the effect is new
+         */
+        void ProcessInput(const EffectIn &input);
+
+        /**
+         * @return If the effect modifies the final mix
+         */
+        bool Active() const {
+            return enabled && channelCount;
         }
+
+        /**
+         * @brief Applies the effect to the final mix
+         * @param buffer The interleaved samples of the final mix
+         * @param scratch A buffer of the same size as the final mix which the routed channels are processed in
+         */
+        void Process(const DeviceState &state, std::span<i32> buffer, std::span<i32> scratch);
     };
 }
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "performance.h"
+
+namespace skyline::service::audio::IAudioRenderer {
+    PerformanceManager::PerformanceManager(u32 historyCount, size_t entryLimit) : frames(historyCount), entryLimit(entryLimit) {
+        for (auto &historyFrame : frames)
+            historyFrame.entries.reserve(entryLimit);
+    }
+
+    u64 PerformanceManager::BeginFrame() {
+        if (frames.empty())
+            return 0;
+
+        // The oldest frame is overwritten if the guest hasn't updated the renderer for long enough to fill the ring
+        if (frameCount == frames.size()) {
+            frameHead = (frameHead + 1) % frames.size();
+            frameCount--;
+        }
+
+        frame = &frames[(frameHead + frameCount) % frames.size()];
+        frame->entries.clear();
+        frame->startTicks = util::GetGuestTicks();
+        frameStart = util::GetTimeNs();
+        return frameStart;
+    }
+
+    void PerformanceManager::AddEntry(u32 nodeId, PerformanceEntryType type, u64 start, u64 end) {
+        if (!frame || frame->entries.size() == entryLimit)
+            return;
+
+        frame->entries.push_back(Entry{
+            .nodeId = nodeId,
+            .startTime = static_cast<u32>((start - frameStart) / 1000),
+            .processingTime = static_cast<u32>((end - start) / 1000),
+            .type = type,
+        });
+    }
+
+    void PerformanceManager::EndFrame() {
+        if (!frame)
+            return;
+
+        frame->totalProcessingTime = static_cast<u32>((util::GetTimeNs() - frameStart) / 1000);
+        frame = nullptr;
+        frameCount++;
+    }
+
+    template<typename Header, typename EntryType>
+    u32 PerformanceManager::CopyFrames(std::span<u8> buffer) {
+        size_t offset{};
+        for (; frameCount; frameCount--, frameHead = (frameHead + 1) % frames.size()) {
+            const auto &historyFrame{frames[frameHead]};
+            auto frameSize{sizeof(Header) + (historyFrame.entries.size() * sizeof(EntryType))};
+            if (offset + frameSize > buffer.size())
+                break;
+
+            Header header{
+                .magic = constant::PerformanceFrameMagic,
+                .entryCount = static_cast<u32>(historyFrame.entries.size()),
+                .nextOffset = static_cast<u32>(frameSize),
+                .totalProcessingTime = historyFrame.totalProcessingTime,
+            };
+            if constexpr (std::is_same_v<Header, PerformanceFrameHeaderV2>)
+                header.startRenderingTicks = historyFrame.startTicks;
+            std::memcpy(buffer.data() + offset, &header, sizeof(Header));
+            offset += sizeof(Header);
+
+            for (const auto &entry : historyFrame.entries) {
+                EntryType guestEntry{
+                    .nodeId = entry.nodeId,
+                    .startTime = entry.startTime,
+                    .processingTime = entry.processingTime,
+                    .type = entry.type,
+                };
+                std::memcpy(buffer.data() + offset, &guestEntry, sizeof(EntryType));
+                offset += sizeof(EntryType);
+            }
+        }
+
+        // Any frames that didn't fit are dropped rather than being reported late
+        frameHead = (frameHead + frameCount) % frames.size();
+        frameCount = 0;
+        return static_cast<u32>(offset);
+    }
+
+    u32 PerformanceManager::CopyHistories(std::span<u8> buffer, bool v2) {
+        if (frames.empty())
+            return 0;
+        return v2 ? CopyFrames<PerformanceFrameHeaderV2, PerformanceEntryV2>(buffer) : CopyFrames<PerformanceFrameHeaderV1, PerformanceEntryV1>(buffer);
+    }
+}
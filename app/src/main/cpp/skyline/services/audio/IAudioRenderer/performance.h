@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline {
+    namespace constant {
+        constexpr u32 PerformanceFrameMagic{util::MakeMagic<u32>("PERF")}; //!< The magic of the header of every frame in the performance buffer
+    }
+
+    namespace service::audio::IAudioRenderer {
+        /**
+         * @brief The kinds of nodes that performance entries are recorded for
+         */
+        enum class PerformanceEntryType : u8 {
+            Invalid = 0,
+            Voice = 1,
+            SubMix = 2,
+            FinalMix = 3,
+            Sink = 4,
+        };
+
+        /**
+         * @brief The kinds of nodes that IDs are generated for, this is in the upper 4 bits of a node ID
+         */
+        enum class NodeIdType : u8 {
+            Voice = 1,
+            Mix = 2,
+            Sink = 3,
+            Effect = 4,
+        };
+
+        /**
+         * @return The ID of a node which doesn't have a guest-supplied one
+         */
+        constexpr u32 MakeNodeId(NodeIdType type, u32 index) {
+            return (static_cast<u32>(type) << 28) | ((index & 0xFFF) << 16);
+        }
+
+        /**
+         * @brief This is returned in the update data to inform the guest of the size of the performance frames written into the performance buffer
+         */
+        struct PerformanceOut {
+            u32 historySize; //!< The amount of bytes of performance frames that have been written into the performance buffer
+            u32 _pad0_[3];
+        };
+        static_assert(sizeof(PerformanceOut) == 0x10);
+
+        struct PerformanceFrameHeaderV1 {
+            u32 magic;
+            u32 entryCount;
+            u32 detailCount;
+            u32 nextOffset; //!< The offset from this header to the next frame's
+            u32 totalProcessingTime; //!< The time spent rendering the entire frame in microseconds
+            u32 voiceDropCount;
+        };
+        static_assert(sizeof(PerformanceFrameHeaderV1) == 0x18);
+
+        struct PerformanceEntryV1 {
+            u32 nodeId;
+            u32 startTime; //!< The time the node started being processed at relative to the start of the frame in microseconds
+            u32 processingTime; //!< The time spent processing the node in microseconds
+            PerformanceEntryType type;
+            u8 _pad0_[3];
+        };
+        static_assert(sizeof(PerformanceEntryV1) == 0x10);
+
+        /**
+         * @note This is used from REV5 onwards
+         */
+        struct PerformanceFrameHeaderV2 {
+            u32 magic;
+            u32 entryCount;
+            u32 detailCount;
+            u32 nextOffset;
+            u32 totalProcessingTime;
+            u32 voiceDropCount;
+            u64 startRenderingTicks; //!< The time rendering of the frame started at in ticks of the system counter
+            u8 renderingTimeLimitExceeded;
+            u8 _pad0_[3];
+            u32 renderingTimeLimit; //!< The percentage of the frame's duration that rendering is allowed to take
+            u32 _pad1_[2];
+        };
+        static_assert(sizeof(PerformanceFrameHeaderV2) == 0x30);
+
+        struct PerformanceEntryV2 {
+            u32 nodeId;
+            u32 startTime;
+            u32 processingTime;
+            PerformanceEntryType type;
+            u8 _pad0_[11];
+        };
+        static_assert(sizeof(PerformanceEntryV2) == 0x18);
+
+        /**
+         * @brief The PerformanceManager class records the time spent rendering every node of a frame and copies the frames into the guest's performance buffer on every update
+         * @note Frames are recorded by the thread that mixes the final output, the times of voices are collected from the render pool prior to being recorded
+         */
+        class PerformanceManager {
+          private:
+            struct Entry {
+                u32 nodeId;
+                u32 startTime;
+                u32 processingTime;
+                PerformanceEntryType type;
+            };
+
+            struct Frame {
+                u32 totalProcessingTime;
+                u64 startTicks;
+                std::vector<Entry> entries;
+            };
+
+            std::vector<Frame> frames; //!< A ring of the frames that haven't been copied to the guest yet, the oldest frame is overwritten when it's full
+            size_t frameHead{}; //!< The index of the oldest frame in the ring
+            size_t frameCount{}; //!< The amount of frames in the ring
+            size_t entryLimit; //!< The maximum amount of entries in a frame, this is what the guest's performance buffer is sized for
+            u64 frameStart{}; //!< The time the frame being recorded started at in nanoseconds
+            Frame *frame{}; //!< The frame being recorded, this is nullptr if no frame is being recorded
+
+            template<typename Header, typename EntryType>
+            u32 CopyFrames(std::span<u8> buffer);
+
+          public:
+            /**
+             * @param historyCount The amount of frames that can be buffered between updates, no frames are recorded if this is 0
+             * @param entryLimit The maximum amount of entries in a frame
+             */
+            PerformanceManager(u32 historyCount, size_t entryLimit);
+
+            bool Enabled() const {
+                return !frames.empty();
+            }
+
+            /**
+             * @brief Starts recording a frame, this is a no-op if the manager isn't enabled
+             * @return The time the frame started at in nanoseconds
+             */
+            u64 BeginFrame();
+
+            /**
+             * @brief Records the processing of a node in the current frame
+             * @param start The time processing of the node started at in nanoseconds
+             * @param end The time processing of the node ended at in nanoseconds
+             */
+            void AddEntry(u32 nodeId, PerformanceEntryType type, u64 start, u64 end);
+
+            /**
+             * @brief Finishes recording the current frame and adds it to the ring
+             */
+            void EndFrame();
+
+            /**
+             * @brief Copies all recorded frames into the guest's performance buffer and removes them from the ring, frames that don't fit are dropped
+             * @param v2 If the REV5 format of performance frames is used
+             * @return The amount of bytes written into the buffer
+             */
+            u32 CopyHistories(std::span<u8> buffer, bool v2);
+        };
+    }
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "render_pool.h"
+
+namespace skyline::service::audio::IAudioRenderer {
+    RenderPool::RenderPool(size_t maxThreadCount) {
+        auto threadCount{std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), std::max<size_t>(maxThreadCount, 1))};
+        for (size_t worker{1}; worker < threadCount; worker++)
+            threads.emplace_back(&RenderPool::WorkerThread, this, worker);
+    }
+
+    RenderPool::~RenderPool() {
+        {
+            std::lock_guard lock(mutex);
+            exit = true;
+        }
+        wakeConditional.notify_all();
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    void RenderPool::Work(size_t worker) {
+        for (size_t job; (job = nextJob.fetch_add(1, std::memory_order_relaxed)) < jobCount;) {
+            try {
+                jobFunction(jobContext, job, worker);
+            } catch (...) {
+                std::lock_guard lock(mutex);
+                if (!exception)
+                    exception = std::current_exception();
+            }
+        }
+    }
+
+    void RenderPool::WorkerThread(size_t worker) {
+        u64 finishedGeneration{};
+        while (true) {
+            {
+                std::unique_lock lock(mutex);
+                wakeConditional.wait(lock, [&] { return exit || generation != finishedGeneration; });
+                if (exit)
+                    return;
+                finishedGeneration = generation;
+            }
+
+            Work(worker);
+
+            std::lock_guard lock(mutex);
+            if (!--activeWorkers)
+                doneConditional.notify_one();
+        }
+    }
+
+    void RenderPool::Dispatch(size_t count, JobFunction function, void *context) {
+        jobFunction = function;
+        jobContext = context;
+        jobCount = count;
+        nextJob.store(0, std::memory_order_relaxed);
+
+        if (count <= 1 || threads.empty()) {
+            for (size_t job{}; job < count; job++)
+                function(context, job, 0);
+            return;
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            activeWorkers = threads.size();
+            generation++;
+        }
+        wakeConditional.notify_all();
+
+        Work(0);
+
+        std::unique_lock lock(mutex);
+        doneConditional.wait(lock, [this] { return activeWorkers == 0; });
+        if (exception)
+            std::rethrow_exception(std::exchange(exception, nullptr));
+    }
+}
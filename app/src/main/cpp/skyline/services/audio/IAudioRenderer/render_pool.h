@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <condition_variable>
+#include <thread>
+#include <common.h>
+
+namespace skyline::service::audio::IAudioRenderer {
+    /**
+     * @brief The RenderPool class runs the jobs of a renderer update on a small pool of persistent worker threads alongside the calling thread
+     * @note The workers are only woken up for updates that have more than a single job as waking them up costs more than a trivial job
+     */
+    class RenderPool {
+      private:
+        using JobFunction = void (*)(void *context, size_t job, size_t worker);
+
+        std::mutex mutex; //!< This mutex guards the job being dispatched and is used alongside the conditional variables
+        std::condition_variable wakeConditional; //!< The workers wait on this for a new job to be dispatched
+        std::condition_variable doneConditional; //!< The dispatching thread waits on this for all workers to finish a job
+        u64 generation{}; //!< This is incremented for every dispatched job so workers can tell a new one apart from the one they've finished
+        bool exit{}; //!< If the workers should exit
+        JobFunction jobFunction{};
+        void *jobContext{};
+        size_t jobCount{};
+        std::atomic<size_t> nextJob{}; //!< The index of the next job that hasn't been picked up by any thread
+        size_t activeWorkers{}; //!< The amount of workers that haven't finished the current job yet
+        std::exception_ptr exception; //!< The first exception thrown by a job, it's rethrown on the dispatching thread
+        std::vector<std::thread> threads; //!< The worker threads, this is declared last so they're started after all other members are initialized
+
+        /**
+         * @brief Runs jobs until there are none left
+         * @param worker The index of the thread running the jobs, this is 0 for the dispatching thread
+         */
+        void Work(size_t worker);
+
+        /**
+         * @brief The entry point of a worker thread, it runs every dispatched job until the pool is destroyed
+         */
+        void WorkerThread(size_t worker);
+
+        void Dispatch(size_t count, JobFunction function, void *context);
+
+      public:
+        /**
+         * @param maxThreadCount The maximum amount of threads that run jobs including the dispatching thread, this is further limited by the amount of host cores
+         */
+        RenderPool(size_t maxThreadCount);
+
+        ~RenderPool();
+
+        /**
+         * @return The amount of threads that run jobs including the dispatching thread, worker indices are always less than this
+         */
+        inline size_t GetThreadCount() {
+            return threads.size() + 1;
+        }
+
+        /**
+         * @brief Runs a function for every job index in parallel and returns once all of them have finished
+         * @param function A function taking the job index and the index of the thread running it, every thread only runs a single job at a time
+         */
+        template<typename Function>
+        void Run(size_t count, Function &&function) {
+            Dispatch(count, [](void *context, size_t job, size_t worker) {
+                (*static_cast<std::remove_reference_t<Function> *>(context))(job, worker);
+            }, &function);
+        }
+    };
+}
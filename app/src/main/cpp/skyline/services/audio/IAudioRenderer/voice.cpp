@@ -10,9 +10,15 @@ namespace skyline::service::audio::IAudioRenderer {
         bufferReload = true;
     }
 
-    Voice::Voice(const DeviceState &state) : state(state) {}
+    Voice::Voice(const DeviceState &state) : state(state), resampler(state.settings->Get().sincResampling) {}
 
     void Voice::ProcessInput(const VoiceIn &input) {
+        if (!input.firstUpdate && std::memcmp(&input, &lastInput, sizeof(VoiceIn)) == 0) {
+            playbackState = input.playbackState;
+            return;
+        }
+        lastInput = input;
+
         // Voice no longer in use, reset it
         if (acquired && !input.acquired) {
             bufferReload = true;
@@ -25,6 +31,7 @@ namespace skyline::service::audio::IAudioRenderer {
         }
 
         acquired = input.acquired;
+        nodeId = input.nodeId;
 
         if (!acquired)
             return;
@@ -36,7 +43,7 @@ namespace skyline::service::audio::IAudioRenderer {
             format = input.format;
             sampleRate = input.sampleRate;
 
-            if (input.channelCount > (input.format == skyline::audio::AudioFormat::ADPCM ? 1 : 2))
+            if (!input.channelCount || input.channelCount > (input.format == skyline::audio::AudioFormat::ADPCM ? 1 : MaxChannelCount))
                 throw exception("Unsupported voice channel count: {}", input.channelCount);
 
             channelCount = static_cast<u8>(input.channelCount);
@@ -59,68 +66,166 @@ namespace skyline::service::audio::IAudioRenderer {
     void Voice::UpdateBuffers() {
         const auto &currentBuffer{waveBuffers.at(bufferIndex)};
 
-        if (currentBuffer.size == 0)
-            return;
-
         switch (format) {
             case skyline::audio::AudioFormat::Int16:
-                samples.resize(currentBuffer.size / sizeof(i16));
-                state.process->ReadMemory(samples.data(), currentBuffer.address, currentBuffer.size);
+                bufferFrames = static_cast<u32>(currentBuffer.size / (sizeof(i16) * channelCount));
                 break;
-            case skyline::audio::AudioFormat::ADPCM: {
-                samples = adpcmDecoder->Decode(std::span(state.process->GetPointer<u8>(currentBuffer.address), currentBuffer.size));
+            case skyline::audio::AudioFormat::ADPCM:
+                bufferFrames = static_cast<u32>((currentBuffer.size / skyline::audio::AdpcmDecoder::BytesPerFrame) * skyline::audio::AdpcmDecoder::SamplesPerFrame);
                 break;
-            }
             default:
                 throw exception("Unsupported PCM format used by Voice: {}", format);
         }
 
-        if (sampleRate != constant::SampleRate)
-            samples = resampler.ResampleBuffer(samples, static_cast<double>(sampleRate) / constant::SampleRate, channelCount);
-
-        if (channelCount == 1 && constant::ChannelCount != channelCount) {
-            auto originalSize{samples.size()};
-            samples.resize((originalSize / channelCount) * constant::ChannelCount);
+        // A looping ADPCM buffer can supply the decoder context at its start, without it decoding continues from the history at the end of the buffer
+        if (bufferLooped && format == skyline::audio::AudioFormat::ADPCM && currentBuffer.adpcmLoopContextPosition && currentBuffer.adpcmLoopContextSize >= sizeof(skyline::audio::AdpcmDecoder::Context))
+            adpcmDecoder->LoadContext(state.process->GetReference<skyline::audio::AdpcmDecoder::Context>(currentBuffer.adpcmLoopContextPosition));
+        bufferLooped = false;
+
+        sampleOffset = 0;
+        sourceOffset = 0;
+        skipFrames = 0;
+        windowOffset = 0;
+        windowSize = 0;
+        windowPadded = false;
+    }
 
-            for (auto monoIndex{originalSize - 1}, targetIndex{samples.size()}; monoIndex > 0; monoIndex--) {
-                auto sample{samples[monoIndex]};
-                for (u8 i{}; i < constant::ChannelCount; i++)
-                    samples[--targetIndex] = sample;
+    bool Voice::FillWindow(u32 demand) {
+        const auto &currentBuffer{waveBuffers.at(bufferIndex)};
+        bool resampling{sampleRate != constant::SampleRate};
+        if (sourceOffset == bufferFrames && (windowPadded || !resampling))
+            return false;
+
+        // The frames that haven't been consumed yet are the taps of the next output frame, they're kept at the start of the window
+        auto remaining{windowSize - windowOffset};
+        std::memmove(window.data(), window.data() + (windowOffset * channelCount), remaining * channelCount * sizeof(i16));
+        windowOffset = 0;
+        windowSize = remaining;
+
+        // The resampler interpolates from the frames around the current one, the first frame is repeated before the start of the wave buffer so it's interpolated from as well
+        bool firstFill{resampling && !sourceOffset && !windowSize && !windowPadded};
+        auto leadingFrames{static_cast<u32>(resampler.GetLeadingTapCount())};
+        if (firstFill)
+            windowSize = leadingFrames;
+
+        // Frames that are skipped over still have to be decoded for ADPCM so they're a part of the demand
+        auto demandEnd{sourceOffset + skipFrames + demand};
+
+        while (windowSize < WindowFrames && sourceOffset < std::min(bufferFrames, demandEnd)) {
+            auto destination{window.data() + (windowSize * channelCount)};
+            u32 frames{};
+
+            if (format == skyline::audio::AudioFormat::Int16) {
+                // Skipped PCM frames don't need to be read at all
+                auto skipped{std::min(skipFrames, bufferFrames - sourceOffset)};
+                sourceOffset += skipped;
+                skipFrames -= skipped;
+
+                frames = std::min({static_cast<u32>(WindowFrames - windowSize), bufferFrames - sourceOffset, demandEnd > sourceOffset ? demandEnd - sourceOffset : 0});
+                state.process->ReadMemory(destination, currentBuffer.address + (sourceOffset * channelCount * sizeof(i16)), frames * channelCount * sizeof(i16));
+            } else {
+                // ADPCM frames always have to be decoded in their entirety as every sample depends on the ones before it
+                constexpr auto BytesPerFrame{skyline::audio::AdpcmDecoder::BytesPerFrame}, SamplesPerFrame{skyline::audio::AdpcmDecoder::SamplesPerFrame};
+                auto adpcmFrames{std::min({(WindowFrames - windowSize) / SamplesPerFrame, (bufferFrames - sourceOffset) / SamplesPerFrame, (demandEnd - sourceOffset + SamplesPerFrame - 1) / SamplesPerFrame})};
+                frames = static_cast<u32>(adpcmDecoder->Decode(std::span(state.process->GetPointer<u8>(currentBuffer.address + ((sourceOffset / SamplesPerFrame) * BytesPerFrame)), adpcmFrames * BytesPerFrame), std::span(destination, adpcmFrames * SamplesPerFrame)));
+                if (!frames)
+                    break;
+
+                auto skipped{std::min(skipFrames, frames)};
+                std::memmove(destination, destination + skipped, (frames - skipped) * sizeof(i16));
+                skipFrames -= skipped;
+                sourceOffset += skipped;
+                frames -= skipped;
             }
+
+            sourceOffset += frames;
+            windowSize += frames;
         }
+
+        if (firstFill)
+            for (u32 frame{}; frame < leadingFrames; frame++)
+                for (u8 channel{}; channel < channelCount; channel++)
+                    window[(frame * channelCount) + channel] = (windowSize > leadingFrames) ? window[(leadingFrames * channelCount) + channel] : 0;
+
+        // The last frame is repeated past the end of the wave buffer for the same reason, every frame in it is rendered once the padding is consumed
+        if (resampling && sourceOffset == bufferFrames && !windowPadded) {
+            for (size_t tap{1 + leadingFrames}; tap < resampler.GetTapCount(); tap++, windowSize++)
+                for (u8 channel{}; channel < channelCount; channel++)
+                    window[(windowSize * channelCount) + channel] = windowSize ? window[((windowSize - 1) * channelCount) + channel] : 0;
+            windowPadded = true;
+        }
+
+        return true;
     }
 
-    std::vector<i16> &Voice::GetBufferData(u32 maxSamples, u32 &outOffset, u32 &outSize) {
-        auto &currentBuffer{waveBuffers.at(bufferIndex)};
+    u32 Voice::ConvertWindow(std::span<i16> output) {
+        u32 frames;
+        if (sampleRate != constant::SampleRate) {
+            auto [consumed, written]{resampler.Resample(std::span(window.data() + (windowOffset * channelCount), (windowSize - windowOffset) * channelCount), output, static_cast<double>(sampleRate) / constant::SampleRate, channelCount, constant::ChannelCount)};
+            frames = static_cast<u32>(written);
 
-        if (!acquired || playbackState != skyline::audio::AudioOutState::Started) {
-            outSize = 0;
-            return samples;
-        }
+            windowOffset += consumed;
+            if (windowOffset > windowSize) {
+                skipFrames += windowOffset - windowSize;
+                windowOffset = windowSize;
+            }
+        } else {
+            frames = std::min(static_cast<u32>(output.size() / constant::ChannelCount), windowSize - windowOffset);
+            auto source{window.data() + (windowOffset * channelCount)};
+            if (channelCount == constant::ChannelCount) {
+                std::memcpy(output.data(), source, frames * channelCount * sizeof(i16));
+            } else {
+                for (u32 frame{}; frame < frames; frame++)
+                    for (u8 channel{}; channel < constant::ChannelCount; channel++)
+                        output[(frame * constant::ChannelCount) + channel] = source[(frame * channelCount) + std::min<u8>(channel, channelCount - 1)];
+            }
 
-        if (bufferReload) {
-            bufferReload = false;
-            UpdateBuffers();
+            windowOffset += frames;
         }
 
-        outOffset = sampleOffset;
-        outSize = std::min(maxSamples * constant::ChannelCount, static_cast<u32>(samples.size() - sampleOffset));
+        return frames;
+    }
 
-        output.playedSamplesCount += outSize / constant::ChannelCount;
-        sampleOffset += outSize;
+    u32 Voice::Render(std::span<i16> buffer) {
+        u32 maxFrames{static_cast<u32>(buffer.size() / constant::ChannelCount)}, frames{};
 
-        if (sampleOffset == samples.size()) {
-            sampleOffset = 0;
+        while (frames < maxFrames && Playable()) {
+            if (bufferReload) {
+                bufferReload = false;
+                UpdateBuffers();
+            }
+
+            auto converted{ConvertWindow(buffer.subspan(frames * constant::ChannelCount))};
+            frames += converted;
+            sampleOffset += converted;
+
+            // The source frames needed for the remaining output frames, resampling requires the taps around them as well
+            u32 remaining{maxFrames - frames};
+            u32 demand{sampleRate != constant::SampleRate ? static_cast<u32>(((static_cast<u64>(remaining) * sampleRate + constant::SampleRate - 1) / constant::SampleRate) + resampler.GetTapCount()) : remaining};
+
+            if (frames == maxFrames || FillWindow(demand))
+                continue;
+
+            // The current wave buffer has been rendered entirely
+            auto &currentBuffer{waveBuffers.at(bufferIndex)};
+            auto bufferEmpty{sampleOffset == 0};
 
             if (currentBuffer.lastBuffer)
                 playbackState = skyline::audio::AudioOutState::Paused;
 
             if (!currentBuffer.looping)
                 SetWaveBufferIndex(static_cast<u8>(bufferIndex + 1));
+            else
+                bufferReload = bufferLooped = true;
 
             output.playedWaveBuffersCount++;
+
+            // A wave buffer too small to hold a single frame would otherwise be looped over indefinitely
+            if (bufferEmpty)
+                break;
         }
 
-        return samples;
+        output.playedSamplesCount += frames;
+        return frames;
     }
 }
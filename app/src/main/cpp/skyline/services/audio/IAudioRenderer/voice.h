@@ -87,27 +87,53 @@ namespace skyline::service::audio::IAudioRenderer {
     * @brief The Voice class manages an audio voice
     */
     class Voice {
+      public:
+        static constexpr u8 MaxChannelCount{2}; //!< The maximum amount of channels a voice can have
+        static constexpr size_t WindowFrames{0x100}; //!< The amount of source frames that are decoded from a wave buffer at once
+
       private:
         const DeviceState &state;
         std::array<WaveBuffer, 4> waveBuffers;
-        std::vector<i16> samples; //!< A vector containing processed sample data
+        VoiceIn lastInput{}; //!< The input of the last update, an update with the same input only has to reapply the playback state as it's the only state the input overrides that rendering changes
+        std::array<i16, (WindowFrames + skyline::audio::Resampler::MaxTapCount - 1) * MaxChannelCount> window{}; //!< The decoded source frames of the current wave buffer that haven't been rendered yet, it has space to pad the end of the wave buffer for the resampler
         skyline::audio::Resampler resampler; //!< The resampler object used for changing the sample rate of a wave buffer's stream
         std::optional<skyline::audio::AdpcmDecoder> adpcmDecoder;
 
         bool acquired{false}; //!< If the voice is in use
         bool bufferReload{true};
         u8 bufferIndex{}; //!< The index of the wave buffer currently in use
-        u32 sampleOffset{}; //!< The offset in the sample data of the current wave buffer
+        u32 sampleOffset{}; //!< The amount of output frames that have been rendered from the current wave buffer
+        u32 bufferFrames{}; //!< The total amount of source frames in the current wave buffer
+        u32 sourceOffset{}; //!< The amount of source frames of the current wave buffer that have been decoded into the window or skipped
+        u32 skipFrames{}; //!< The amount of source frames that the resampler has stepped over past the end of the window, these are dropped when they're decoded
+        u32 windowOffset{}; //!< The offset of the first unconsumed frame in the window
+        u32 windowSize{}; //!< The amount of valid frames in the window
+        bool bufferLooped{}; //!< If the current wave buffer is being restarted as it's looping
+        bool windowPadded{}; //!< If the end of the current wave buffer has been padded in the window, the start of it is always padded by the first fill
         u32 sampleRate{};
         u8 channelCount{};
         skyline::audio::AudioOutState playbackState{skyline::audio::AudioOutState::Stopped};
         skyline::audio::AudioFormat format{skyline::audio::AudioFormat::Invalid};
 
         /**
-         * @brief This updates the sample buffer with data from the current wave buffer and processes it
+         * @brief This resets the decoding state for the current wave buffer so rendering starts at its beginning
          */
         void UpdateBuffers();
 
+        /**
+         * @brief This decodes the next chunk of source frames from the current wave buffer into the window, the unconsumed frames are moved to the start of it
+         * @param demand The amount of source frames required to render the remaining output frames, only these are decoded (rounded up to an entire ADPCM frame) so a long wave buffer isn't decoded ahead of playback
+         * @return If any frames could still be loaded, this is false once the entire wave buffer has been loaded
+         */
+        bool FillWindow(u32 demand);
+
+        /**
+         * @brief This converts the frames in the window into output frames at the output sample rate and channel count
+         * @param output The buffer to write output frames into
+         * @return The amount of output frames written
+         */
+        u32 ConvertWindow(std::span<i16> output);
+
         /**
          * @brief Sets the current wave buffer index to use
          * @param index The index to use
@@ -117,21 +143,23 @@ namespace skyline::service::audio::IAudioRenderer {
       public:
         VoiceOut output{};
         float volume{};
+        u32 nodeId{}; //!< The ID of the voice's node in the guest's audio graph, this identifies it in performance entries
 
         Voice(const DeviceState &state);
 
         /**
          * @brief This reads the input voice data from the guest and sets internal data based off it
          * @param input The input data struct from guest
+         * @note Most voices don't change between updates, so an input that's identical to the last one is only compared rather than processed
          */
         void ProcessInput(const VoiceIn &input);
 
         /**
-         * @brief This obtains the voices audio sample data, updating it if required
-         * @param maxSamples The maximum amount of samples the output buffer should contain
-         * @return A vector of I16 PCM sample data
+         * @brief This decodes, resamples and upmixes the voice's wave buffers into a buffer of output frames, moving onto the next wave buffer when one ends
+         * @param buffer The buffer to write the I16 PCM output frames into, the voice's volume isn't applied to them
+         * @return The amount of output frames written
          */
-        std::vector<i16> &GetBufferData(u32 maxSamples, u32 &outOffset, u32 &outSize);
+        u32 Render(std::span<i16> buffer);
 
         /**
          * @return If the voice is currently playable
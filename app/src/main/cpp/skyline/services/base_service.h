@@ -3,12 +3,19 @@
 
 #pragma once
 
-#include <functional>
+#include <array>
 #include <cxxabi.h>
 #include <kernel/ipc.h>
 #include <common.h>
+#include <profiler.h>
 
-#define SFUNC(function) std::bind(&function, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3)
+#define SFUNC(id, Class, Function) ::skyline::service::ServiceFunction<Class>{id, &Class::Function, #Function}
+#define SFUNC_BASE(id, Class, BaseClass, Function) ::skyline::service::ServiceFunction<Class>{id, static_cast<::skyline::service::ServiceFunctionPointer<Class>>(&BaseClass::Function), #Function}
+#define SERVICE_DECL(...)                                                                                            \
+static constexpr auto ServiceFunctions{::skyline::service::MakeServiceFunctionTable({__VA_ARGS__})};                 \
+Result CallServiceFunction(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) override { \
+    return DispatchServiceFunction(this, ServiceFunctions, session, request, response);                              \
+}
 #define SRVREG(class) std::make_shared<class>(state, manager)
 
 namespace skyline::kernel::type {
@@ -21,6 +28,38 @@ namespace skyline::service {
 
     class ServiceManager;
 
+    template<typename Class>
+    using ServiceFunctionPointer = Result (Class::*)(type::KSession &, ipc::IpcRequest &, ipc::IpcResponse &);
+
+    /**
+     * @brief A single entry of the dispatch table of a service, this maps a command ID to a member function of the service
+     */
+    template<typename Class>
+    struct ServiceFunction {
+        u32 id; //!< The command ID of the function
+        ServiceFunctionPointer<Class> function;
+        std::string_view name; //!< The name of the function, this is used for logging
+    };
+
+    /**
+     * @brief Sorts the functions of a service by their command ID at compile-time, so they can be looked up with a binary search
+     * @note This fails to compile if any command ID is used by more than one function
+     */
+    template<typename Class, size_t Size>
+    constexpr std::array<ServiceFunction<Class>, Size> MakeServiceFunctionTable(const ServiceFunction<Class> (&functions)[Size]) {
+        std::array<ServiceFunction<Class>, Size> table{};
+        for (size_t index{}; index < Size; index++) {
+            auto function{functions[index]};
+            auto position{index};
+            for (; position && table[position - 1].id > function.id; position--)
+                table[position] = table[position - 1];
+            if (position && table[position - 1].id == function.id)
+                throw exception("Duplicate command ID in the functions of a service");
+            table[position] = function;
+        }
+        return table;
+    }
+
     /**
      * @brief The BaseService class is a class for all Services to inherit from
      */
@@ -28,28 +67,74 @@ namespace skyline::service {
       protected:
         const DeviceState &state; //!< The state of the device
         ServiceManager &manager; //!< A reference to the service manager
-        std::unordered_map<u32, std::function<Result(type::KSession &, ipc::IpcRequest &, ipc::IpcResponse &)>> vTable; //!< This holds the mapping from a function's CmdId to the actual function
+        std::string name; //!< The name of the service, this is lazily populated by GetName
+
+        /**
+         * @brief Calls the function of the service that corresponds to the command ID of the request, this is implemented by SERVICE_DECL
+         * @note Services without a dispatch table use this implementation, which treats every command as unimplemented
+         */
+        virtual Result CallServiceFunction(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+            state.logger->Warn("Cannot find function in service '{0}': 0x{1:X} ({1})", GetName(), static_cast<u32>(request.payload->value));
+            return {};
+        }
+
+        /**
+         * @brief Looks up the function for the command ID of the request in the dispatch table of a service and calls it
+         * @param service The service to call the function on, this is the most derived class that declared the table
+         * @param functions The dispatch table of the service, sorted by command ID
+         */
+        template<typename Class, size_t Size>
+        Result DispatchServiceFunction(Class *service, const std::array<ServiceFunction<Class>, Size> &functions, type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+            auto id{static_cast<u32>(request.payload->value)};
+
+            size_t low{}, high{Size};
+            while (low < high) {
+                auto middle{(low + high) / 2};
+                if (functions[middle].id < id)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+
+            if (low == Size || functions[low].id != id)
+                return BaseService::CallServiceFunction(session, request, response);
+
+            auto &function{functions[low]};
+            try {
+                auto start{util::GetTimeNs()};
+                auto result{(service->*function.function)(session, request, response)};
+                state.profiler->RecordIpc(typeid(*service), function.name, util::GetTimeNs() - start);
+                return result;
+            } catch (std::exception &e) {
+                throw exception("{} (Service: {}::{})", e.what(), GetName(), function.name);
+            }
+        }
 
       public:
         /**
          * @param state The state of the device
-         * @param vTable The functions of the service
          */
-        BaseService(const DeviceState &state, ServiceManager &manager, const std::unordered_map<u32, std::function<Result(type::KSession &, ipc::IpcRequest &, ipc::IpcResponse &)>> &vTable) : state(state), manager(manager), vTable(vTable) {}
+        BaseService(const DeviceState &state, ServiceManager &manager) : state(state), manager(manager) {}
 
         /**
          * @note To be able to extract the name of the underlying class and ensure correct destruction order
          */
         virtual ~BaseService() = default;
 
-        std::string GetName() {
-            int status{};
-            size_t length{};
-            auto mangledName{typeid(*this).name()};
+        /**
+         * @return The name of the class of the service without its namespace, this is demangled on the first call and cached after
+         */
+        const std::string &GetName() {
+            if (name.empty()) {
+                int status{};
+                size_t length{};
+                auto mangledName{typeid(*this).name()};
 
-            std::unique_ptr<char, decltype(&std::free)> demangled{ abi::__cxa_demangle(mangledName, nullptr, &length, &status), std::free};
+                std::unique_ptr<char, decltype(&std::free)> demangled{abi::__cxa_demangle(mangledName, nullptr, &length, &status), std::free};
 
-            return (status == 0) ? std::string(demangled.get() + std::char_traits<char>::length("skyline::service::")) : mangledName;
+                name = (status == 0) ? std::string(demangled.get() + std::char_traits<char>::length("skyline::service::")) : mangledName;
+            }
+            return name;
         }
 
         /**
@@ -57,20 +142,9 @@ namespace skyline::service {
          * @param request The corresponding IpcRequest object
          * @param response The corresponding IpcResponse object
          */
-        Result HandleRequest(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-            std::function<Result(type::KSession &, ipc::IpcRequest &, ipc::IpcResponse &)> function;
-            try {
-                function = vTable.at(request.payload->value);
-            } catch (std::out_of_range &) {
-                state.logger->Warn("Cannot find function in service '{0}': 0x{1:X} ({1})", GetName(), static_cast<u32>(request.payload->value));
-                return {};
-            }
-
-            try {
-                return function(session, request, response);
-            } catch (std::exception &e) {
-                throw exception("{} (Service: {})", e.what(), GetName());
-            }
+        inline Result HandleRequest(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+            TRACE_SECTION_FMT("{}: 0x{:X}", GetName(), static_cast<u32>(request.payload->value));
+            return CallServiceFunction(session, request, response);
         };
     };
 }
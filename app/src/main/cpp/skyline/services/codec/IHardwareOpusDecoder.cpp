@@ -0,0 +1,354 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <kernel/types/KProcess.h>
+#include "IHardwareOpusDecoder.h"
+
+extern bool Halt;
+
+namespace skyline::service::codec {
+    namespace {
+        constexpr u32 MaxPacketSamples{5760}; //!< The amount of samples in the longest possible packet, this is 120ms at 48kHz
+
+        /**
+         * @brief The header that precedes every packet in the input buffer
+         */
+        struct OpusPacketHeader {
+            u32 size; //!< The size of the packet in big-endian
+            u32 finalRange; //!< The final state of the range coder after the packet has been encoded in big-endian, this isn't verified
+        };
+        static_assert(sizeof(OpusPacketHeader) == 0x8);
+
+        /**
+         * @return The amount of samples per channel that a packet decodes to at 48kHz, this is 0 for malformed packets
+         * @note The duration of the frames is derived from the configuration in the TOC byte (RFC 6716 Section 3.1)
+         */
+        u32 GetPacketSamples(std::span<const u8> packet) {
+            if (packet.empty())
+                return 0;
+
+            u8 config{static_cast<u8>(packet[0] >> 3)};
+            u32 frameSamples;
+            if (config < 12)
+                frameSamples = (config & 3) == 3 ? 2880 : (480U << (config & 3)); // SILK: 10, 20, 40 or 60ms
+            else if (config < 16)
+                frameSamples = (config & 1) ? 960 : 480; // Hybrid: 10 or 20ms
+            else
+                frameSamples = 120U << (config & 3); // CELT: 2.5, 5, 10 or 20ms
+
+            switch (packet[0] & 3) {
+                case 0:
+                    return frameSamples;
+                case 1:
+                case 2:
+                    return frameSamples * 2;
+                default:
+                    return packet.size() > 1 ? frameSamples * (packet[1] & 0x3F) : 0;
+            }
+        }
+
+        /**
+         * @brief Converts a packet with self-delimiting framing (RFC 6716 Appendix B) into one with regular framing by removing the size of its last frame
+         * @param output The vector that the converted packet is appended to
+         * @return The amount of bytes of the input that the packet spans, this is 0 for malformed packets
+         */
+        size_t ConvertSelfDelimited(std::span<const u8> input, std::vector<u8> &output) {
+            if (input.empty())
+                return 0;
+
+            size_t offset{1};
+            bool valid{true};
+            auto readSize{[&]() -> size_t {
+                if (offset >= input.size()) {
+                    valid = false;
+                    return 0;
+                }
+                size_t size{input[offset++]};
+                if (size >= 252) {
+                    if (offset >= input.size()) {
+                        valid = false;
+                        return 0;
+                    }
+                    size += static_cast<size_t>(input[offset++]) * 4;
+                }
+                return size;
+            }};
+
+            size_t sizeOffset{offset}; // The offset of the size field that only exists with self-delimiting framing
+            size_t dataSize{};
+            switch (input[0] & 3) {
+                case 0:
+                    dataSize = readSize();
+                    break;
+                case 1:
+                    dataSize = readSize() * 2;
+                    break;
+                case 2:
+                    dataSize = readSize();
+                    sizeOffset = offset;
+                    dataSize += readSize();
+                    break;
+                default: {
+                    if (offset >= input.size())
+                        return 0;
+                    u8 frameCountByte{input[offset++]};
+                    size_t frameCount{frameCountByte & 0x3FU};
+                    if (!frameCount)
+                        return 0;
+
+                    if (frameCountByte & 0x40) {
+                        // Every padding length byte of 255 adds 254 bytes of padding and is followed by another length byte
+                        u8 length;
+                        do {
+                            if (offset >= input.size())
+                                return 0;
+                            length = input[offset++];
+                            dataSize += length == 255 ? 254 : length;
+                        } while (length == 255);
+                    }
+
+                    if (frameCountByte & 0x80) {
+                        for (size_t frame{1}; frame < frameCount; frame++)
+                            dataSize += readSize();
+                        sizeOffset = offset;
+                        dataSize += readSize();
+                    } else {
+                        sizeOffset = offset;
+                        dataSize += readSize() * frameCount;
+                    }
+                }
+            }
+
+            size_t end{offset + dataSize};
+            if (!valid || end > input.size())
+                return 0;
+
+            output.insert(output.end(), input.begin(), input.begin() + sizeOffset);
+            output.insert(output.end(), input.begin() + offset, input.begin() + end);
+            return end;
+        }
+    }
+
+    OpusStream::OpusStream(u8 channelCount) : channelCount(channelCount) {
+        codec = AMediaCodec_createDecoderByType("audio/opus");
+        if (!codec)
+            throw exception("The host has no Opus decoder");
+
+        // The decoder requires an OpusHead (RFC 7845 Section 5.1) alongside the codec delay and the seek pre-roll in nanoseconds, there is no pre-skip as the guest expects every packet to be decoded in full
+        std::array<u8, 19> head{'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1, channelCount, 0, 0, 0x80, 0xBB, 0, 0, 0, 0, 0};
+        u64 delay{};
+
+        auto format{AMediaFormat_new()};
+        AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, "audio/opus");
+        AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_SAMPLE_RATE, constant::OpusSampleRate);
+        AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_CHANNEL_COUNT, channelCount);
+        AMediaFormat_setBuffer(format, "csd-0", head.data(), head.size());
+        AMediaFormat_setBuffer(format, "csd-1", &delay, sizeof(delay));
+        AMediaFormat_setBuffer(format, "csd-2", &delay, sizeof(delay));
+
+        auto status{AMediaCodec_configure(codec, format, nullptr, nullptr, 0)};
+        AMediaFormat_delete(format);
+        if (status != AMEDIA_OK || AMediaCodec_start(codec) != AMEDIA_OK) {
+            AMediaCodec_delete(codec);
+            throw exception("Failed to start the host Opus decoder with {} channels: {}", channelCount, status);
+        }
+    }
+
+    OpusStream::~OpusStream() {
+        AMediaCodec_stop(codec);
+        AMediaCodec_delete(codec);
+    }
+
+    size_t OpusStream::Drain(std::span<i16> output, size_t written, i64 timeout) {
+        while (written < output.size()) {
+            AMediaCodecBufferInfo info{};
+            auto index{AMediaCodec_dequeueOutputBuffer(codec, &info, timeout)};
+            if (index >= 0) {
+                size_t capacity{};
+                auto buffer{AMediaCodec_getOutputBuffer(codec, static_cast<size_t>(index), &capacity)};
+                auto count{std::min(static_cast<size_t>(info.size) / sizeof(i16), output.size() - written)};
+                std::memcpy(output.data() + written, buffer + info.offset, count * sizeof(i16));
+                written += count;
+                AMediaCodec_releaseOutputBuffer(codec, static_cast<size_t>(index), false);
+            } else if (index != AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED && index != AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED) {
+                break;
+            }
+            timeout = 0;
+        }
+        return written;
+    }
+
+    void OpusStream::Decode(std::span<const std::span<const u8>> packets, std::span<i16> output) {
+        size_t written{};
+        for (auto packet : packets) {
+            ssize_t index;
+            while ((index = AMediaCodec_dequeueInputBuffer(codec, constant::OpusInputTimeout)) < 0) {
+                // All input buffers are held by the codec, its output needs to be consumed for it to release them
+                written = Drain(output, written, 0);
+                if (Halt)
+                    return;
+            }
+
+            size_t capacity{};
+            auto buffer{AMediaCodec_getInputBuffer(codec, static_cast<size_t>(index), &capacity)};
+            if (packet.size() > capacity)
+                throw exception("Opus packet is larger than the input buffer of the host decoder: 0x{:X} > 0x{:X}", packet.size(), capacity);
+            std::memcpy(buffer, packet.data(), packet.size());
+
+            AMediaCodec_queueInputBuffer(codec, static_cast<size_t>(index), 0, packet.size(), timestamp, 0);
+            timestamp += 1000;
+        }
+
+        while (written < output.size()) {
+            auto drained{Drain(output, written, constant::OpusOutputTimeout)};
+            if (drained == written)
+                break; // The codec has dropped a packet, the missing samples are silenced
+            written = drained;
+        }
+
+        if (written < output.size())
+            std::fill(output.begin() + static_cast<ssize_t>(written), output.end(), 0);
+    }
+
+    void OpusStream::Flush() {
+        AMediaCodec_flush(codec);
+    }
+
+    IHardwareOpusDecoder::IHardwareOpusDecoder(const DeviceState &state, ServiceManager &manager, const OpusMultiStreamParameters &parameters)
+        : sampleRate(parameters.sampleRate), channelCount(parameters.channelCount), decimation(constant::OpusSampleRate / parameters.sampleRate), stereoStreamCount(parameters.stereoStreamCount), mappings(parameters.mappings), pool(std::min<size_t>(parameters.streamCount, constant::OpusMaxDecodeThreads)), BaseService(state, manager) {
+        for (u32 stream{}; stream < parameters.streamCount; stream++)
+            streams.emplace_back(std::make_unique<OpusStream>(stream < stereoStreamCount ? 2 : 1));
+
+        streamPackets.resize(streams.size());
+        streamBuffers.resize(streams.size());
+        streamSamples.resize(streams.size());
+    }
+
+    Result IHardwareOpusDecoder::DecodeInterleavedImpl(ipc::IpcRequest &request, ipc::IpcResponse &response, bool withPerf, bool multiStream) {
+        auto startTime{util::GetTimeNs()};
+
+        auto &inputBuffer{request.inputBuf.at(0)};
+        auto &outputBuffer{request.outputBuf.at(0)};
+        auto input{state.process->GetSpan<const u8>(inputBuffer.address, inputBuffer.size)};
+        auto output{state.process->GetSpan<i16>(outputBuffer.address, outputBuffer.size / sizeof(i16))};
+        if (input.empty() || output.empty()) {
+            state.logger->Warn("Opus buffers are empty or not contiguous on the host: Input: 0x{:X} (0x{:X} bytes), Output: 0x{:X} (0x{:X} bytes)", inputBuffer.address, inputBuffer.size, outputBuffer.address, outputBuffer.size);
+            return result::OpusBadArgument;
+        }
+
+        for (size_t stream{}; stream < streams.size(); stream++) {
+            streamPackets[stream].clear();
+            streamBuffers[stream].clear();
+            if (multiStream)
+                streamBuffers[stream].reserve(input.size()); // Converted packets are never larger than the input, reserving it upfront keeps the spans into the buffer valid
+        }
+
+        // Packets are batched till the input runs out or the samples of the next packet don't fit into the output
+        size_t consumed{}, decodedSamples{}, outputSamples{output.size() / channelCount};
+        while (consumed + sizeof(OpusPacketHeader) <= input.size()) {
+            auto &header{*reinterpret_cast<const OpusPacketHeader *>(input.data() + consumed)};
+            size_t size{__builtin_bswap32(header.size)};
+            if (consumed + sizeof(OpusPacketHeader) + size > input.size())
+                break;
+
+            auto packet{input.subspan(consumed + sizeof(OpusPacketHeader), size)};
+            auto samples{GetPacketSamples(packet)};
+            if (!samples || samples > MaxPacketSamples)
+                return result::OpusInvalidPacket;
+            if ((decodedSamples + samples) / decimation > outputSamples)
+                break;
+
+            if (multiStream) {
+                // All streams but the last one use self-delimiting framing so the boundaries between them can be determined
+                for (size_t stream{}; stream + 1 < streams.size(); stream++) {
+                    auto &buffer{streamBuffers[stream]};
+                    auto offset{buffer.size()};
+                    auto length{ConvertSelfDelimited(packet, buffer)};
+                    if (!length)
+                        return result::OpusInvalidPacket;
+                    streamPackets[stream].emplace_back(buffer.data() + offset, buffer.size() - offset);
+                    packet = packet.subspan(length);
+                }
+            }
+            streamPackets.back().emplace_back(packet);
+
+            decodedSamples += samples;
+            consumed += sizeof(OpusPacketHeader) + size;
+        }
+
+        if (!consumed)
+            return result::InvalidLength;
+
+        if (IsDirect()) {
+            streams.front()->Decode(streamPackets.front(), output.first(decodedSamples * channelCount));
+        } else {
+            pool.Run(streams.size(), [this, decodedSamples](size_t stream, size_t) {
+                auto &samples{streamSamples[stream]};
+                samples.resize(decodedSamples * streams[stream]->channelCount);
+                streams[stream]->Decode(streamPackets[stream], samples);
+            });
+
+            // Every output channel is gathered from the channel of the stream it's mapped to, the samples are decimated by averaging them
+            auto frameCount{decodedSamples / decimation};
+            for (u32 channel{}; channel < channelCount; channel++) {
+                auto mapping{mappings[channel]};
+                if (mapping == 0xFF) {
+                    for (size_t frame{}; frame < frameCount; frame++)
+                        output[frame * channelCount + channel] = 0;
+                    continue;
+                }
+
+                auto stream{mapping < stereoStreamCount * 2 ? mapping / 2 : mapping - stereoStreamCount};
+                auto streamChannel{mapping < stereoStreamCount * 2 ? mapping % 2 : 0};
+                auto stride{streams[stream]->channelCount};
+                auto samples{streamSamples[stream].data() + streamChannel};
+                for (size_t frame{}; frame < frameCount; frame++) {
+                    i32 sum{};
+                    for (u32 tap{}; tap < decimation; tap++)
+                        sum += samples[(frame * decimation + tap) * stride];
+                    output[frame * channelCount + channel] = static_cast<i16>(sum / static_cast<i32>(decimation));
+                }
+            }
+        }
+
+        response.Push<u32>(static_cast<u32>(consumed));
+        response.Push<u32>(static_cast<u32>(decodedSamples / decimation));
+        if (withPerf)
+            response.Push<u64>((util::GetTimeNs() - startTime) / 1000);
+        return {};
+    }
+
+    Result IHardwareOpusDecoder::DecodeInterleavedOld(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return DecodeInterleavedImpl(request, response, false, false);
+    }
+
+    Result IHardwareOpusDecoder::SetContext(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return {};
+    }
+
+    Result IHardwareOpusDecoder::DecodeInterleavedForMultiStreamOld(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return DecodeInterleavedImpl(request, response, false, true);
+    }
+
+    Result IHardwareOpusDecoder::DecodeInterleavedWithPerfOld(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return DecodeInterleavedImpl(request, response, true, false);
+    }
+
+    Result IHardwareOpusDecoder::DecodeInterleavedForMultiStreamWithPerfOld(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return DecodeInterleavedImpl(request, response, true, true);
+    }
+
+    Result IHardwareOpusDecoder::DecodeInterleaved(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        if (request.Pop<u8>())
+            for (auto &stream : streams)
+                stream->Flush();
+        return DecodeInterleavedImpl(request, response, true, false);
+    }
+
+    Result IHardwareOpusDecoder::DecodeInterleavedForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        if (request.Pop<u8>())
+            for (auto &stream : streams)
+                stream->Flush();
+        return DecodeInterleavedImpl(request, response, true, true);
+    }
+}
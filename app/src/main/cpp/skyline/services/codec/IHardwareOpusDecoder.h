@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <media/NdkMediaCodec.h>
+#include <services/base_service.h>
+#include <services/serviceman.h>
+#include <services/audio/IAudioRenderer/render_pool.h>
+
+namespace skyline {
+    namespace constant {
+        constexpr u32 OpusSampleRate{48000}; //!< The sample rate that Opus is always decoded at, lower sample rates are decimated from it
+        constexpr size_t OpusMaxStreamCount{255};
+        constexpr size_t OpusMaxDecodeThreads{4}; //!< The maximum amount of threads that the streams of a multistream decoder are decoded on
+        constexpr i64 OpusInputTimeout{10000}; //!< The amount of microseconds to wait for an input buffer of the host codec for before draining its output
+        constexpr i64 OpusOutputTimeout{50000}; //!< The amount of microseconds to wait for decoded samples for before a packet is considered to have been dropped by the host codec
+    }
+
+    namespace service::codec {
+        namespace result {
+            constexpr Result InvalidLength(111, 22);
+            constexpr Result OpusBadArgument(111, 131);
+            constexpr Result OpusInvalidPacket(111, 133);
+        }
+
+        /**
+         * @brief The parameters of a multistream decoder, these correspond to the channel mapping table of an OpusHead with channel mapping family 1
+         */
+        struct OpusMultiStreamParameters {
+            u32 sampleRate;
+            u32 channelCount;
+            u32 streamCount;
+            u32 stereoStreamCount; //!< The amount of streams that have two coupled channels, these are the first streams
+            std::array<u8, 0x100> mappings; //!< The channel of the decoded streams that every output channel is from, 255 denotes a silent channel
+        };
+        static_assert(sizeof(OpusMultiStreamParameters) == 0x110);
+
+        /**
+         * @brief A single Opus stream that's decoded by the host's Opus decoder with AMediaCodec
+         */
+        class OpusStream {
+          private:
+            AMediaCodec *codec{};
+            i64 timestamp{}; //!< The presentation timestamp of the next packet, this only needs to be monotonic
+
+            /**
+             * @brief Copies all output buffers of the codec into the output till it has been filled
+             * @return The amount of samples that have been written
+             */
+            size_t Drain(std::span<i16> output, size_t written, i64 timeout);
+
+          public:
+            const u8 channelCount;
+
+            OpusStream(u8 channelCount);
+
+            OpusStream(const OpusStream &) = delete;
+
+            ~OpusStream();
+
+            /**
+             * @brief Decodes a batch of packets into interleaved 48kHz samples
+             * @param output The buffer that the samples of all packets are written into, this must exactly fit them
+             * @note All packets are queued before any output is drained so the host codec can process them back-to-back
+             */
+            void Decode(std::span<const std::span<const u8>> packets, std::span<i16> output);
+
+            /**
+             * @brief Discards all state of the codec, this is used when the guest resets the decoder
+             */
+            void Flush();
+        };
+
+        /**
+         * @brief IHardwareOpusDecoder decodes Opus packets into interleaved PCM samples (https://switchbrew.org/wiki/Audio_services#IHardwareOpusDecoder)
+         * @details A decoder with one or two channels is treated as a multistream decoder with a single stream, every stream is decoded by a separate host codec in parallel with the others
+         */
+        class IHardwareOpusDecoder : public BaseService {
+          private:
+            u32 sampleRate;
+            u32 channelCount;
+            u32 decimation; //!< The ratio between the decoding sample rate and the output sample rate
+            u32 stereoStreamCount;
+            std::array<u8, 0x100> mappings{};
+            std::vector<std::unique_ptr<OpusStream>> streams;
+            std::vector<std::vector<std::span<const u8>>> streamPackets; //!< The packets of every stream in a batch
+            std::vector<std::vector<u8>> streamBuffers; //!< The packets of every stream with self-delimiting framing converted to regular framing
+            std::vector<std::vector<i16>> streamSamples; //!< The decoded samples of every stream, this is unused if samples are decoded directly into the output
+            audio::IAudioRenderer::RenderPool pool; //!< The pool of threads that streams are decoded on, this is declared last so it's destroyed before any state its jobs use
+
+            /**
+             * @return If the samples of the only stream match the output and can be decoded directly into it
+             */
+            bool IsDirect() const {
+                return streams.size() == 1 && decimation == 1 && (channelCount == 1 || mappings[0] == 0 && mappings[1] == 1);
+            }
+
+            /**
+             * @brief Decodes as many packets from the input as fit into the output
+             * @param withPerf If the time spent decoding should be returned to the guest
+             * @param multiStream If the packets contain multiple streams with self-delimiting framing
+             */
+            Result DecodeInterleavedImpl(ipc::IpcRequest &request, ipc::IpcResponse &response, bool withPerf, bool multiStream);
+
+          public:
+            IHardwareOpusDecoder(const DeviceState &state, ServiceManager &manager, const OpusMultiStreamParameters &parameters);
+
+            /**
+             * @brief Decodes Opus packets into the output buffer and returns the amount of input bytes consumed and the amount of samples written per channel
+             */
+            Result DecodeInterleavedOld(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Sets the context of the decoder which is only used for the performance statistics of the guest
+             */
+            Result SetContext(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            Result DecodeInterleavedForMultiStreamOld(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief This additionally returns the time spent decoding in microseconds
+             */
+            Result DecodeInterleavedWithPerfOld(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            Result DecodeInterleavedForMultiStreamWithPerfOld(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief This additionally takes a flag which resets the state of the decoder prior to decoding
+             */
+            Result DecodeInterleaved(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            Result DecodeInterleavedForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            SERVICE_DECL(
+                SFUNC(0x0, IHardwareOpusDecoder, DecodeInterleavedOld),
+                SFUNC(0x1, IHardwareOpusDecoder, SetContext),
+                SFUNC(0x2, IHardwareOpusDecoder, DecodeInterleavedForMultiStreamOld),
+                SFUNC(0x3, IHardwareOpusDecoder, SetContext),
+                SFUNC(0x4, IHardwareOpusDecoder, DecodeInterleavedWithPerfOld),
+                SFUNC(0x5, IHardwareOpusDecoder, DecodeInterleavedForMultiStreamWithPerfOld),
+                SFUNC(0x6, IHardwareOpusDecoder, DecodeInterleaved),
+                SFUNC(0x7, IHardwareOpusDecoder, DecodeInterleavedForMultiStream),
+                SFUNC(0x8, IHardwareOpusDecoder, DecodeInterleaved),
+                SFUNC(0x9, IHardwareOpusDecoder, DecodeInterleavedForMultiStream)
+            )
+        };
+    }
+}
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <kernel/types/KProcess.h>
+#include "IHardwareOpusDecoder.h"
+#include "IHardwareOpusDecoderManager.h"
+
+namespace skyline::service::codec {
+    namespace {
+        bool IsValidSampleRate(u32 sampleRate) {
+            return sampleRate == 8000 || sampleRate == 12000 || sampleRate == 16000 || sampleRate == 24000 || sampleRate == 48000;
+        }
+
+        /**
+         * @return The size of the state of a libopus decoder with the supplied amount of channels, this is what the work buffer of the guest's decoder holds
+         */
+        u32 GetDecoderSize(u32 channelCount) {
+            constexpr u32 OpusDecoderSize{0x4C}, SilkDecoderSize{0x2160}, CeltDecoderSize{0x58}, CeltDecodeBufferSize{0x2030}, CeltOverlap{120}, CeltBandCount{21};
+            return OpusDecoderSize + SilkDecoderSize + CeltDecoderSize + (CeltDecodeBufferSize + CeltOverlap * 4) * channelCount + CeltBandCount * 16;
+        }
+
+        /**
+         * @return The size of a buffer holding a 40ms frame of all channels at the supplied sample rate
+         */
+        u32 GetFrameSize(u32 sampleRate, u32 channelCount) {
+            return util::AlignUp(channelCount * 1920 / (constant::OpusSampleRate / sampleRate), 64);
+        }
+
+        bool IsValidMultiStream(const OpusMultiStreamParameters &parameters) {
+            if (!IsValidSampleRate(parameters.sampleRate) || !parameters.channelCount || parameters.channelCount > constant::OpusMaxStreamCount || !parameters.streamCount || parameters.stereoStreamCount > parameters.streamCount || parameters.streamCount + parameters.stereoStreamCount > constant::OpusMaxStreamCount)
+                return false;
+            for (u32 channel{}; channel < parameters.channelCount; channel++)
+                if (parameters.mappings[channel] != 0xFF && parameters.mappings[channel] >= parameters.streamCount + parameters.stereoStreamCount)
+                    return false;
+            return true;
+        }
+    }
+
+    IHardwareOpusDecoderManager::IHardwareOpusDecoderManager(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
+
+    Result IHardwareOpusDecoderManager::Initialize(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto sampleRate{request.Pop<u32>()};
+        auto channelCount{request.Pop<u32>()};
+        if (!IsValidSampleRate(sampleRate) || channelCount < 1 || channelCount > 2)
+            return result::OpusBadArgument;
+
+        OpusMultiStreamParameters parameters{
+            .sampleRate = sampleRate,
+            .channelCount = channelCount,
+            .streamCount = 1,
+            .stereoStreamCount = channelCount - 1,
+            .mappings = {0, 1},
+        };
+
+        state.logger->Debug("IHardwareOpusDecoderManager: Opening an IHardwareOpusDecoder with sample rate: {}, channel count: {}", sampleRate, channelCount);
+        manager.RegisterService(std::make_shared<IHardwareOpusDecoder>(state, manager, parameters), session, response);
+        return {};
+    }
+
+    Result IHardwareOpusDecoderManager::GetWorkBufferSize(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto sampleRate{request.Pop<u32>()};
+        auto channelCount{request.Pop<u32>()};
+        if (!IsValidSampleRate(sampleRate) || channelCount < 1 || channelCount > 2)
+            return result::OpusBadArgument;
+
+        response.Push<u32>(GetDecoderSize(channelCount) + 0x600 + GetFrameSize(sampleRate, channelCount));
+        return {};
+    }
+
+    Result IHardwareOpusDecoderManager::InitializeForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto &parameters{state.process->GetReference<OpusMultiStreamParameters>(request.inputBuf.at(0).address)};
+        if (!IsValidMultiStream(parameters))
+            return result::OpusBadArgument;
+
+        state.logger->Debug("IHardwareOpusDecoderManager: Opening a multistream IHardwareOpusDecoder with sample rate: {}, channel count: {}, stream count: {}, stereo stream count: {}", parameters.sampleRate, parameters.channelCount, parameters.streamCount, parameters.stereoStreamCount);
+        manager.RegisterService(std::make_shared<IHardwareOpusDecoder>(state, manager, parameters), session, response);
+        return {};
+    }
+
+    Result IHardwareOpusDecoderManager::GetWorkBufferSizeForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto &parameters{state.process->GetReference<OpusMultiStreamParameters>(request.inputBuf.at(0).address)};
+        if (!IsValidMultiStream(parameters))
+            return result::OpusBadArgument;
+
+        auto monoStreamCount{parameters.streamCount - parameters.stereoStreamCount};
+        u32 decoderSize{parameters.stereoStreamCount * util::AlignUp(GetDecoderSize(2), 4) + monoStreamCount * util::AlignUp(GetDecoderSize(1), 4)};
+        response.Push<u32>(decoderSize + util::AlignUp(parameters.streamCount * 1500, 64) + GetFrameSize(parameters.sampleRate, parameters.channelCount));
+        return {};
+    }
+}
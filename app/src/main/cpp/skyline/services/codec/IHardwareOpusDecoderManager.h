@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <services/base_service.h>
+#include <services/serviceman.h>
+
+namespace skyline::service::codec {
+    /**
+     * @brief IHardwareOpusDecoderManager or hwopus is used to create Opus decoders (https://switchbrew.org/wiki/Audio_services#hwopus)
+     * @note The work buffers supplied by the guest aren't used as the state of the decoders is held by the host
+     */
+    class IHardwareOpusDecoderManager : public BaseService {
+      public:
+        IHardwareOpusDecoderManager(const DeviceState &state, ServiceManager &manager);
+
+        /**
+         * @brief Creates a new IHardwareOpusDecoder for a stream with one or two channels and returns a handle to it
+         */
+        Result Initialize(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Calculates the size of the work buffer the guest needs to allocate for a decoder
+         */
+        Result GetWorkBufferSize(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Creates a new IHardwareOpusDecoder for multiple streams and returns a handle to it
+         */
+        Result InitializeForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Calculates the size of the work buffer the guest needs to allocate for a multistream decoder
+         */
+        Result GetWorkBufferSizeForMultiStream(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, IHardwareOpusDecoderManager, Initialize),
+            SFUNC(0x1, IHardwareOpusDecoderManager, GetWorkBufferSize),
+            SFUNC(0x2, IHardwareOpusDecoderManager, InitializeForMultiStream),
+            SFUNC(0x3, IHardwareOpusDecoderManager, GetWorkBufferSizeForMultiStream)
+        )
+    };
+}
@@ -6,44 +6,74 @@
 #include "parcel.h"
 
 namespace skyline::service {
-    Parcel::Parcel(kernel::ipc::InputBuffer &buffer, const DeviceState &state, bool hasToken) : Parcel(buffer.address, buffer.size, state, hasToken) {}
+    void Parcel::MapBuffer(u64 size, bool read) {
+        if (size < sizeof(ParcelHeader))
+            throw exception("The parcel's buffer is smaller than its header: 0x{:X}", size);
 
-    Parcel::Parcel(u64 address, u64 size, const DeviceState &state, bool hasToken) : state(state) {
-        state.process->ReadMemory(&header, address, sizeof(ParcelHeader));
+        auto host = state.process->GetHostAddress(address, size);
+        if (host) {
+            buffer = std::span(reinterpret_cast<u8 *>(host), size);
+        } else {
+            fallback.resize(size);
+            if (read)
+                state.process->ReadMemory(fallback.data(), address, size);
+            buffer = fallback;
+        }
+    }
 
-        if (size < (sizeof(ParcelHeader) + header.dataSize + header.objectsSize))
-            throw exception("The size of the parcel according to the header exceeds the specified size");
+    Parcel::Parcel(kernel::ipc::InputBuffer &input, const DeviceState &state, bool hasToken) : state(state), address(input.address) {
+        MapBuffer(input.size, true);
+
+        ParcelHeader header;
+        std::memcpy(&header, buffer.data(), sizeof(ParcelHeader));
 
         constexpr auto tokenLength = 0x50; // The length of the token on BufferQueue parcels
+        auto tokenSize = hasToken ? tokenLength : 0;
 
-        data.resize(header.dataSize - (hasToken ? tokenLength : 0));
-        state.process->ReadMemory(data.data(), address + header.dataOffset + (hasToken ? tokenLength : 0), header.dataSize - (hasToken ? tokenLength : 0));
+        if (static_cast<u64>(header.dataOffset) + header.dataSize > buffer.size() || static_cast<u64>(header.objectsOffset) + header.objectsSize > buffer.size())
+            throw exception("The size of the parcel according to the header exceeds the specified size");
+        if (header.dataSize < tokenSize)
+            throw exception("The data of the parcel is smaller than its token: 0x{:X}", header.dataSize);
 
-        objects.resize(header.objectsSize);
-        state.process->ReadMemory(objects.data(), address + header.objectsOffset, header.objectsSize);
+        data = buffer.subspan(header.dataOffset + tokenSize, header.dataSize - tokenSize);
+        objects = buffer.subspan(header.objectsOffset, header.objectsSize);
     }
 
-    Parcel::Parcel(const DeviceState &state) : state(state) {}
-
-    u64 Parcel::WriteParcel(kernel::ipc::OutputBuffer &buffer) {
-        return WriteParcel(buffer.address, buffer.size);
+    Parcel::Parcel(kernel::ipc::OutputBuffer &output, const DeviceState &state) : state(state), address(output.address) {
+        MapBuffer(output.size, false);
+        data = buffer.subspan(sizeof(ParcelHeader), 0);
+        objects = buffer.subspan(sizeof(ParcelHeader), 0);
     }
 
-    u64 Parcel::WriteParcel(u64 address, u64 maxSize) {
-        header.dataSize = static_cast<u32>(data.size());
-        header.dataOffset = sizeof(ParcelHeader);
+    u8 *Parcel::Reserve(size_t size, bool object) {
+        if (sizeof(ParcelHeader) + data.size() + objects.size() + size > buffer.size())
+            throw exception("The size of the parcel exceeds the size of its buffer: 0x{:X}", buffer.size());
 
-        header.objectsSize = static_cast<u32>(objects.size());
-        header.objectsOffset = sizeof(ParcelHeader) + data.size();
+        if (object) {
+            objects = std::span(objects.data(), objects.size() + size);
+            return objects.data() + objects.size() - size;
+        }
 
-        auto totalSize = sizeof(ParcelHeader) + header.dataSize + header.objectsSize;
+        // Objects follow the data in the buffer, so any that have already been written are moved along to make space
+        if (!objects.empty())
+            std::memmove(objects.data() + size, objects.data(), objects.size());
+        objects = std::span(objects.data() + size, objects.size());
+        data = std::span(data.data(), data.size() + size);
+        return data.data() + data.size() - size;
+    }
 
-        if (maxSize < totalSize)
-            throw exception("The size of the parcel exceeds maxSize");
+    u64 Parcel::WriteParcel() {
+        ParcelHeader header{
+            .dataSize = static_cast<u32>(data.size()),
+            .dataOffset = sizeof(ParcelHeader),
+            .objectsSize = static_cast<u32>(objects.size()),
+            .objectsOffset = static_cast<u32>(sizeof(ParcelHeader) + data.size()),
+        };
+        std::memcpy(buffer.data(), &header, sizeof(ParcelHeader));
 
-        state.process->WriteMemory(header, address);
-        state.process->WriteMemory(data.data(), address + header.dataOffset, data.size());
-        state.process->WriteMemory(objects.data(), address + header.objectsOffset, objects.size());
+        auto totalSize = sizeof(ParcelHeader) + header.dataSize + header.objectsSize;
+        if (!fallback.empty())
+            state.process->WriteMemory(fallback.data(), address, totalSize);
 
         return totalSize;
     }
@@ -9,6 +9,7 @@
 namespace skyline::service {
     /**
      * @brief This class encapsulates a Parcel object (https://switchbrew.org/wiki/Display_services#Parcel)
+     * @note A Parcel is a view into the IPC buffer it's constructed from rather than a copy of it, an input parcel is read directly from guest memory and an output parcel is written directly into it
      */
     class Parcel {
       private:
@@ -20,18 +21,35 @@ namespace skyline::service {
             u32 dataOffset;
             u32 objectsSize;
             u32 objectsOffset;
-        } header{};
+        };
         static_assert(sizeof(ParcelHeader) == 0x10);
 
         const DeviceState &state; //!< The state of the device
+        u64 address; //!< The guest address of the buffer the parcel is in
+        std::span<u8> buffer; //!< The host mapping of the buffer the parcel is in
+        std::vector<u8> fallback; //!< The storage of the parcel if the buffer isn't contiguous in host memory, this is copied from and to the guest and is unused otherwise
+
+        /**
+         * @brief Maps the parcel's buffer, this falls back to a copy of it if it isn't contiguous in host memory
+         * @param read If the contents of the buffer should be copied into the fallback storage when it's used
+         */
+        void MapBuffer(u64 size, bool read);
+
+        /**
+         * @brief Reserves space for a value at the end of the data or objects in the buffer
+         * @param size The size of the value in bytes
+         * @param object If the space is for an object rather than for data, any objects are moved along when data is written after them
+         * @return A pointer to the reserved space
+         */
+        u8 *Reserve(size_t size, bool object);
 
       public:
-        std::vector<u8> data; //!< A vector filled with data in the parcel
-        std::vector<u8> objects; //!< A vector filled with objects in the parcel
+        std::span<u8> data; //!< The data in the parcel
+        std::span<u8> objects; //!< The objects in the parcel
         size_t dataOffset{}; //!< This is the offset of the data read from the parcel
 
         /**
-         * @brief This constructor fills in the Parcel object with data from a IPC buffer
+         * @brief This constructor creates a view of a parcel in an IPC buffer
          * @param buffer The buffer that contains the parcel
          * @param state The state of the device
          * @param hasToken If the parcel starts with a token, it is skipped if this flag is true
@@ -39,25 +57,19 @@ namespace skyline::service {
         Parcel(kernel::ipc::InputBuffer &buffer, const DeviceState &state, bool hasToken = false);
 
         /**
-         * @brief This constructor fills in the Parcel object with data from a Parcel on a remote process
-         * @param address The remote address of the parcel
-         * @param size The size of the parcel
+         * @brief This constructor creates an empty parcel which is written directly into an IPC buffer
+         * @param buffer The buffer to write the parcel into
          * @param state The state of the device
-         * @param hasToken If the parcel starts with a token, it is skipped if this flag is true
          */
-        Parcel(u64 address, u64 size, const DeviceState &state, bool hasToken = false);
-
-        /**
-         * @brief This constructor is used to create an empty parcel then write to a process
-         * @param state The state of the device
-         */
-        Parcel(const DeviceState &state);
+        Parcel(kernel::ipc::OutputBuffer &buffer, const DeviceState &state);
 
         /**
          * @return A reference to an item from the top of data
          */
         template<typename ValueType>
         inline ValueType &Pop() {
+            if (dataOffset + sizeof(ValueType) > data.size())
+                throw exception("Popping 0x{:X} bytes from a parcel exceeds its data size: 0x{:X}", sizeof(ValueType), data.size());
             ValueType &value = *reinterpret_cast<ValueType *>(data.data() + dataOffset);
             dataOffset += sizeof(ValueType);
             return value;
@@ -69,13 +81,8 @@ namespace skyline::service {
          * @param value The object to be written
          */
         template<typename ValueType>
-        void Push(const ValueType &value) {
-            data.reserve(data.size() + sizeof(ValueType));
-            auto item = reinterpret_cast<const u8 *>(&value);
-            for (size_t index{}; sizeof(ValueType) > index; index++) {
-                data.push_back(*item);
-                item++;
-            }
+        inline void Push(const ValueType &value) {
+            std::memcpy(Reserve(sizeof(ValueType), false), &value, sizeof(ValueType));
         }
 
         /**
@@ -84,28 +91,14 @@ namespace skyline::service {
          * @param value The object to be written
          */
         template<typename ValueType>
-        void PushObject(const ValueType &value) {
-            objects.reserve(objects.size() + sizeof(ValueType));
-            auto item = reinterpret_cast<const u8 *>(&value);
-            for (size_t index{}; sizeof(ValueType) > index; index++) {
-                objects.push_back(*item);
-                item++;
-            }
+        inline void PushObject(const ValueType &value) {
+            std::memcpy(Reserve(sizeof(ValueType), true), &value, sizeof(ValueType));
         }
 
         /**
-         * @brief Writes the Parcel object into a particular output buffer on a process
-         * @param buffer The buffer to write into
-         * @return The total size of the message
-         */
-        u64 WriteParcel(kernel::ipc::OutputBuffer &buffer);
-
-        /**
-         * @brief Writes the Parcel object into the process's memory
-         * @param address The address to write the Parcel object to
-         * @param maxSize The maximum size of the Parcel
+         * @brief Writes the header of the Parcel into its buffer, the data and objects have already been written by this point
          * @return The total size of the message
          */
-        u64 WriteParcel(u64 address, u64 maxSize);
+        u64 WriteParcel();
     };
 }
@@ -4,11 +4,7 @@
 #include "IService.h"
 
 namespace skyline::service::fatalsrv {
-    IService::IService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(IService::ThrowFatal)},
-        {0x1, SFUNC(IService::ThrowFatal)},
-        {0x2, SFUNC(IService::ThrowFatal)}
-    }) {}
+    IService::IService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IService::ThrowFatal(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         throw exception("A fatal error with code: 0x{:X} has caused emulation to stop", request.Pop<u32>());
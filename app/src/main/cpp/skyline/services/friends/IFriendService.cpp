@@ -4,6 +4,5 @@
 #include "IFriendService.h"
 
 namespace skyline::service::friends {
-    IFriendService::IFriendService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-    }) {}
+    IFriendService::IFriendService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 }
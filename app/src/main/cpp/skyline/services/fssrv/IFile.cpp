@@ -6,13 +6,7 @@
 #include "IFile.h"
 
 namespace skyline::service::fssrv {
-    IFile::IFile(std::shared_ptr<vfs::Backing> &backing, const DeviceState &state, ServiceManager &manager) : backing(backing), BaseService(state, manager, {
-        {0x0, SFUNC(IFile::Read)},
-        {0x1, SFUNC(IFile::Write)},
-        {0x2, SFUNC(IFile::Flush)},
-        {0x3, SFUNC(IFile::SetSize)},
-        {0x4, SFUNC(IFile::GetSize)}
-    }) {}
+    IFile::IFile(std::shared_ptr<vfs::Backing> &backing, const DeviceState &state, ServiceManager &manager) : backing(backing), BaseService(state, manager) {}
 
     Result IFile::Read(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         auto readOption = request.Pop<u32>();
@@ -30,7 +24,14 @@ namespace skyline::service::fssrv {
             return result::InvalidSize;
         }
 
-        response.Push<u32>(static_cast<u32>(backing->Read(state.process->GetPointer<u8>(request.outputBuf.at(0).address), offset, size)));
+        size_t read;
+        {
+            // Reads from backings are thread-safe and can block on I/O for a long time, so other requests on the session are handled meanwhile
+            type::KSession::Unlock unlock(session);
+            read = backing->Read(state.process->GetPointer<u8>(request.outputBuf.at(0).address), offset, size);
+        }
+
+        response.Push<u32>(static_cast<u32>(read));
         return {};
     }
 
@@ -55,7 +56,7 @@ namespace skyline::service::fssrv {
             return result::InvalidSize;
         }
 
-        if (backing->Write(state.process->GetPointer<u8>(request.inputBuf.at(0).address), offset, request.inputBuf.at(0).size) != size) {
+        if (backing->Write(state.process->GetPointer<u8>(request.inputBuf.at(0).address), offset, size) != size) {
             state.logger->Warn("Failed to write all data to the backing");
             return result::UnexpectedFailure;
         }
@@ -64,6 +65,9 @@ namespace skyline::service::fssrv {
     }
 
     Result IFile::Flush(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        // Flushing a backing can block on I/O for a long time while it makes any buffered writes durable
+        type::KSession::Unlock unlock(session);
+        backing->Flush();
         return {};
     }
 
@@ -1,19 +1,31 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <unistd.h>
+#include <linux/futex.h>
+#include <asm/unistd.h>
 #include <gpu.h>
 #include <os.h>
 #include <kernel/types/KProcess.h>
 #include <services/nvdrv/driver.h>
 #include <services/common/fence.h>
 #include <gpu/format.h>
+#include <boot_report.h>
 #include "GraphicBufferProducer.h"
 
+extern bool Halt;
+
 namespace skyline::service::hosbinder {
     Buffer::Buffer(const GbpBuffer &gbpBuffer, const std::shared_ptr<gpu::PresentationTexture> &texture) : gbpBuffer(gbpBuffer), texture(texture) {}
 
     GraphicBufferProducer::GraphicBufferProducer(const DeviceState &state) : state(state) {}
 
+    void GraphicBufferProducer::ReleaseBuffer(Buffer &buffer) {
+        buffer.status.store(BufferStatus::Free, std::memory_order_release);
+        releaseCount.fetch_add(1, std::memory_order_release);
+        syscall(__NR_futex, &releaseCount, FUTEX_WAKE_PRIVATE, INT32_MAX);
+    }
+
     void GraphicBufferProducer::RequestBuffer(Parcel &in, Parcel &out) {
         u32 slot{in.Pop<u32>()};
 
@@ -34,13 +46,24 @@ namespace skyline::service::hosbinder {
 
         std::optional<u32> slot{std::nullopt};
         while (!slot) {
+            // The release count is read prior to scanning, any buffer released after the scan changes it so the wait returns immediately
+            auto releases{releaseCount.load(std::memory_order_acquire)};
             for (auto &buffer : queue) {
-                if (buffer.second->status == BufferStatus::Free && buffer.second->gbpBuffer.format == format && buffer.second->gbpBuffer.width == width && buffer.second->gbpBuffer.height == height && (buffer.second->gbpBuffer.usage & usage) == usage) {
+                auto expected{BufferStatus::Free};
+                if (buffer.second->gbpBuffer.format == format && buffer.second->gbpBuffer.width == width && buffer.second->gbpBuffer.height == height && (buffer.second->gbpBuffer.usage & usage) == usage && buffer.second->status.compare_exchange_strong(expected, BufferStatus::Dequeued, std::memory_order_acquire)) {
                     slot = buffer.first;
-                    buffer.second->status = BufferStatus::Dequeued;
                     break;
                 }
             }
+
+            if (!slot) {
+                if (Halt)
+                    throw exception("Emulation was halted while waiting for a free buffer");
+
+                // The wait is bounded so that halting emulation is observed even if no buffer is ever released
+                constexpr timespec Timeout{.tv_nsec = 100000000};
+                syscall(__NR_futex, &releaseCount, FUTEX_WAIT_PRIVATE, releases, &Timeout);
+            }
         }
 
         out.Push(*slot);
@@ -66,15 +89,17 @@ namespace skyline::service::hosbinder {
         auto buffer = queue.at(data.slot);
         buffer->status = BufferStatus::Queued;
 
-        auto slot = data.slot;
-        auto bufferEvent = state.gpu->bufferEvent;
-        buffer->texture->releaseCallback = [this, slot, bufferEvent]() {
-            queue.at(slot)->status = BufferStatus::Free;
-            bufferEvent->Signal();
-        };
+        // Only write tracking is done here, the guest framebuffer is copied and deswizzled by the presentation thread after the fences of the frame have been reached
+        buffer->texture->RequestHostSynchronization();
+
+        // The queue only fills up when frames are queued faster than they're presented, in which case this waits for the presentation thread to catch up
+        gpu::PresentationFrame frame{buffer->texture, data.swapInterval};
+        std::copy(std::begin(data.fence), std::end(data.fence), frame.fences.begin());
+        state.gpu->presentationQueue.PushWait(frame);
+        state.gpu->scheduler.OnQueue(data.swapInterval);
 
-        buffer->texture->SynchronizeHost();
-        state.gpu->presentationQueue.push(buffer->texture);
+        if (boot::Report.OnQueueBuffer())
+            boot::Report.Emit(*state.logger, state.os->appFilesPath);
 
         struct {
             u32 width;
@@ -93,7 +118,7 @@ namespace skyline::service::hosbinder {
         u32 slot{in.Pop<u32>()};
         //auto fences{in.Pop<std::array<nvdrv::Fence, 4>>()};
 
-        queue.at(slot)->status = BufferStatus::Free;
+        ReleaseBuffer(*queue.at(slot));
 
         state.logger->Debug("CancelBuffer: Slot: {}", slot);
     }
@@ -120,23 +145,13 @@ namespace skyline::service::hosbinder {
 
         auto& gbpBuffer = in.Pop<GbpBuffer>();
 
-        std::shared_ptr<nvdrv::device::NvMap::NvMapObject> nvBuffer{};
-
         auto driver = nvdrv::driver.lock();
         auto nvmap = driver->nvMap.lock();
 
-        if (gbpBuffer.nvmapHandle) {
-            nvBuffer = nvmap->handleTable.at(gbpBuffer.nvmapHandle);
-        } else {
-            for (const auto &object : nvmap->handleTable) {
-                if (object.second->id == gbpBuffer.nvmapId) {
-                    nvBuffer = object.second;
-                    break;
-                }
-            }
-            if (!nvBuffer)
-                throw exception("A QueueBuffer request has an invalid NVMap Handle ({}) and ID ({})", gbpBuffer.nvmapHandle, gbpBuffer.nvmapId);
-        }
+        // The ID of an nvmap object is the same as its handle, so either of them can be used to look it up
+        auto nvBuffer{nvmap->GetObject(gbpBuffer.nvmapHandle ? gbpBuffer.nvmapHandle : gbpBuffer.nvmapId)};
+        if (!nvBuffer)
+            throw exception("A QueueBuffer request has an invalid NVMap Handle ({}) and ID ({})", gbpBuffer.nvmapHandle, gbpBuffer.nvmapId);
 
         gpu::texture::Format format;
         switch (gbpBuffer.format) {
@@ -151,9 +166,23 @@ namespace skyline::service::hosbinder {
                 throw exception("Unknown pixel format used for FB");
         }
 
-        auto texture = std::make_shared<gpu::GuestTexture>(state, nvBuffer->address + gbpBuffer.offset, gpu::texture::Dimensions(gbpBuffer.width, gbpBuffer.height), format, gpu::texture::TileMode::Block, gpu::texture::TileConfig{.surfaceWidth = static_cast<u16>(gbpBuffer.stride), .blockHeight = static_cast<u8>(1U << gbpBuffer.blockHeightLog2), .blockDepth = 1});
+        auto texture = state.gpu->textureCache.FindOrCreate(nvBuffer->address + gbpBuffer.offset, gpu::texture::Dimensions(gbpBuffer.width, gbpBuffer.height), format, gpu::texture::TileMode::Block, gpu::texture::TileConfig{.surfaceWidth = static_cast<u16>(gbpBuffer.stride), .blockHeight = static_cast<u8>(1U << gbpBuffer.blockHeightLog2), .blockDepth = 1});
+
+        // A buffer that's preallocated again with the same attributes reuses its existing presentation texture, the host texture of a framebuffer is always a PresentationTexture
+        auto presentation = std::static_pointer_cast<gpu::PresentationTexture>(texture->host);
+        if (!presentation)
+            presentation = texture->InitializePresentationTexture();
+
+        // The release callback is set once here rather than for every QueueBuffer as it only depends on the buffer, it holds a weak reference as the buffer holds the texture
+        auto buffer = std::make_shared<Buffer>(gbpBuffer, presentation);
+        auto bufferEvent = state.gpu->bufferEvent;
+        presentation->releaseCallback = [this, weakBuffer = std::weak_ptr<Buffer>(buffer), bufferEvent]() {
+            if (auto buffer = weakBuffer.lock())
+                ReleaseBuffer(*buffer);
+            bufferEvent->Signal();
+        };
 
-        queue[data.slot] = std::make_shared<Buffer>(gbpBuffer, texture->InitializePresentationTexture());
+        queue[data.slot] = buffer;
         state.gpu->bufferEvent->Signal();
 
         state.logger->Debug("SetPreallocatedBuffer: Slot: {}, Magic: 0x{:X}, Width: {}, Height: {}, Stride: {}, Format: {}, Usage: {}, Index: {}, ID: {}, Handle: {}, Offset: 0x{:X}, Block Height: {}, Size: 0x{:X}", data.slot, gbpBuffer.magic, gbpBuffer.width, gbpBuffer.height, gbpBuffer.stride, gbpBuffer.format, gbpBuffer.usage, gbpBuffer.index, gbpBuffer.nvmapId, gbpBuffer.nvmapHandle, gbpBuffer.offset, (1U << gbpBuffer.blockHeightLog2), gbpBuffer.size);
@@ -42,7 +42,7 @@ namespace skyline::service::hosbinder {
      */
     class Buffer {
       public:
-        BufferStatus status{BufferStatus::Free};
+        std::atomic<BufferStatus> status{BufferStatus::Free}; //!< The status of the buffer, this is atomic as the presentation thread frees buffers once their contents have been copied to the host
         std::shared_ptr<gpu::PresentationTexture> texture;
         GbpBuffer gbpBuffer;
 
@@ -73,6 +73,12 @@ namespace skyline::service::hosbinder {
       private:
         const DeviceState &state;
         std::unordered_map<u32, std::shared_ptr<Buffer>> queue; //!< A vector of shared pointers to all the queued buffers
+        std::atomic<u32> releaseCount{}; //!< A counter that's incremented whenever a buffer is freed, it's used as a futex word for DequeueBuffer to wait on when no buffer is free
+
+        /**
+         * @brief Frees a buffer so it can be dequeued again and wakes up any thread waiting in DequeueBuffer
+         */
+        void ReleaseBuffer(Buffer &buffer);
 
         /**
          * @brief Request for the GbpBuffer of a buffer
@@ -80,7 +86,7 @@ namespace skyline::service::hosbinder {
         void RequestBuffer(Parcel &in, Parcel &out);
 
         /**
-         * @brief Try to dequeue a free graphics buffer that has been consumed
+         * @brief Dequeue a free graphics buffer that has been consumed, this blocks till one is released by the presentation thread if there are none
          */
         void DequeueBuffer(Parcel &in, Parcel &out);
 
@@ -33,5 +33,12 @@ namespace skyline::service::hosbinder {
          * @brief This adjusts the reference counts to the underlying binder, it is stubbed as we aren't using the real symbols (https://switchbrew.org/wiki/Nvnflinger_services#GetNativeHandle)
          */
         Result GetNativeHandle(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, IHOSBinderDriver, TransactParcel),
+            SFUNC(0x1, IHOSBinderDriver, AdjustRefcount),
+            SFUNC(0x2, IHOSBinderDriver, GetNativeHandle),
+            SFUNC(0x3, IHOSBinderDriver, TransactParcel)
+        )
     };
 }
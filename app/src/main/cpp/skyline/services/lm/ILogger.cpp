@@ -5,10 +5,19 @@
 #include "ILogger.h"
 
 namespace skyline::service::lm {
-    ILogger::ILogger(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(ILogger::Log)},
-        {0x1, SFUNC(ILogger::SetDestination)}
-    }) {}
+    namespace {
+        /**
+         * @return The value of a field, fields aren't guaranteed to be aligned so they're copied out
+         */
+        template<typename Type>
+        Type LoadField(const u8 *field) {
+            Type value;
+            std::memcpy(&value, field, sizeof(Type));
+            return value;
+        }
+    }
+
+    ILogger::ILogger(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     std::string ILogger::GetFieldName(LogFieldType type) {
         switch (type) {
@@ -35,68 +44,80 @@ namespace skyline::service::lm {
         }
     }
 
-    Result ILogger::Log(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        struct Data {
-            u64 pid;
-            u64 threadContext;
-            u16 flags;
-            LogLevel level;
-            u8 verbosity;
-            u32 payloadLength;
-        } &data = state.process->GetReference<Data>(request.inputBuf.at(0).address);
-
-        std::ostringstream logMessage;
-        logMessage << "Guest log:";
+    std::string ILogger::FormatPacket(const char *, const u8 *data, size_t size) {
+        std::string message{"Guest log:"};
 
-        u64 offset = sizeof(Data);
-        while (offset < request.inputBuf.at(0).size) {
-            auto fieldType = state.process->GetObject<LogFieldType>(request.inputBuf.at(0).address + offset++);
-            auto length = state.process->GetObject<u8>(request.inputBuf.at(0).address + offset++);
-            auto address = request.inputBuf.at(0).address + offset;
+        size_t offset{sizeof(PacketHeader)};
+        while (offset + 2 <= size) {
+            auto fieldType{static_cast<LogFieldType>(data[offset++])};
+            auto length{std::min<size_t>(data[offset++], size - offset)};
+            if (fieldType == LogFieldType::Stop)
+                break;
 
-            logMessage << " ";
+            auto field{data + offset};
+            offset += length;
 
             switch (fieldType) {
                 case LogFieldType::Start:
-                    offset += length;
-                    continue;
+                    break;
                 case LogFieldType::Line:
-                    logMessage << GetFieldName(fieldType) << ": " << state.process->GetObject<u32>(address);
-                    offset += sizeof(u32);
-                    continue;
+                    if (length >= sizeof(u32))
+                        message += fmt::format(" {}: {}", GetFieldName(fieldType), LoadField<u32>(field));
+                    break;
                 case LogFieldType::DropCount:
-                    logMessage << GetFieldName(fieldType) << ": " << state.process->GetObject<u64>(address);
-                    offset += sizeof(u64);
-                    continue;
+                    if (length >= sizeof(u64))
+                        message += fmt::format(" {}: {}", GetFieldName(fieldType), LoadField<u64>(field));
+                    break;
                 case LogFieldType::Time:
-                    logMessage << GetFieldName(fieldType) << ": " << state.process->GetObject<u64>(address) << "s";
-                    offset += sizeof(u64);
-                    continue;
-                case LogFieldType::Stop:
+                    if (length >= sizeof(u64))
+                        message += fmt::format(" {}: {}s", GetFieldName(fieldType), LoadField<u64>(field));
                     break;
                 default:
-                    logMessage << GetFieldName(fieldType) << ": " << state.process->GetString(address, length);
-                    offset += length;
-                    continue;
+                    message += fmt::format(" {}: {}", GetFieldName(fieldType), std::string_view(reinterpret_cast<const char *>(field), strnlen(reinterpret_cast<const char *>(field), length)));
+                    break;
             }
-            break;
         }
 
-        switch (data.level) {
+        return message;
+    }
+
+    Result ILogger::Log(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto &buffer{request.inputBuf.at(0)};
+        if (buffer.size < sizeof(PacketHeader))
+            return {};
+
+        Logger::LogLevel level;
+        bool enabled;
+        switch (state.process->GetObject<PacketHeader>(buffer.address).level) {
             case LogLevel::Trace:
-                state.logger->Debug("{}", logMessage.str());
+                level = Logger::LogLevel::Debug;
+                enabled = state.logger->IsEnabled<Logger::LogLevel::Debug>();
                 break;
             case LogLevel::Info:
-                state.logger->Info("{}", logMessage.str());
+                level = Logger::LogLevel::Info;
+                enabled = state.logger->IsEnabled<Logger::LogLevel::Info>();
                 break;
             case LogLevel::Warning:
-                state.logger->Warn("{}", logMessage.str());
+                level = Logger::LogLevel::Warn;
+                enabled = state.logger->IsEnabled<Logger::LogLevel::Warn>();
                 break;
-            case LogLevel::Error:
-            case LogLevel::Critical:
-                state.logger->Error("{}", logMessage.str());
+            default:
+                level = Logger::LogLevel::Error;
+                enabled = state.logger->IsEnabled<Logger::LogLevel::Error>();
                 break;
         }
+        if (!enabled)
+            return {};
+
+        // The raw packet is copied straight from guest memory into the logging queue, it's parsed by the writer thread and is dropped if the queue is full
+        auto packet{state.process->GetSpan<u8>(buffer.address, buffer.size)};
+        if (!packet.empty()) {
+            state.logger->WriteBinary(level, &FormatPacket, packet);
+        } else {
+            std::vector<u8> copy(buffer.size);
+            state.process->ReadMemory(copy.data(), buffer.address, copy.size());
+            state.logger->WriteBinary(level, &FormatPacket, copy);
+        }
 
         return {};
     }
@@ -40,12 +40,31 @@ namespace skyline::service::lm {
             Critical //!< This is a critical log
         };
 
+        /**
+         * @brief The header of a log packet, it's followed by the fields of the packet
+         */
+        struct PacketHeader {
+            u64 pid;
+            u64 threadContext;
+            u16 flags;
+            LogLevel level;
+            u8 verbosity;
+            u32 payloadLength;
+        };
+        static_assert(sizeof(PacketHeader) == 0x18);
+
         /**
          * @brief Obtains a string containing the name of the given field type
          * @param type The field type to return the name of
          * @return The name of the given field type
          */
-        std::string GetFieldName(LogFieldType type);
+        static std::string GetFieldName(LogFieldType type);
+
+        /**
+         * @brief Parses a log packet into the text of a log, this is called by the writer thread of the logger so parsing doesn't cost the guest any time
+         * @param data The log packet including its header, this might be truncated so every field is bounds-checked
+         */
+        static std::string FormatPacket(const char *, const u8 *data, size_t size);
 
       public:
         ILogger(const DeviceState &state, ServiceManager &manager);
@@ -59,5 +78,10 @@ namespace skyline::service::lm {
          * @brief This sets the log destination (https://switchbrew.org/wiki/Log_services#SetDestination)
          */
         Result SetDestination(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, ILogger, Log),
+            SFUNC(0x1, ILogger, SetDestination)
+        )
     };
 }
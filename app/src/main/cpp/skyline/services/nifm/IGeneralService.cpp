@@ -5,9 +5,7 @@
 #include "IGeneralService.h"
 
 namespace skyline::service::nifm {
-    IGeneralService::IGeneralService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x4, SFUNC(IGeneralService::CreateRequest)}
-    }) {}
+    IGeneralService::IGeneralService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IGeneralService::CreateRequest(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         manager.RegisterService(SRVREG(IRequest), session, response);
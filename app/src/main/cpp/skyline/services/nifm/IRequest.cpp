@@ -5,12 +5,7 @@
 #include "IRequest.h"
 
 namespace skyline::service::nifm {
-    IRequest::IRequest(const DeviceState &state, ServiceManager &manager) : event0(std::make_shared<type::KEvent>(state)), event1(std::make_shared<type::KEvent>(state)), BaseService(state, manager, {
-        {0x0, SFUNC(IRequest::GetRequestState)},
-        {0x1, SFUNC(IRequest::GetResult)},
-        {0x2, SFUNC(IRequest::GetSystemEventReadableHandles)},
-        {0x4, SFUNC(IRequest::Submit)},
-    }) {}
+    IRequest::IRequest(const DeviceState &state, ServiceManager &manager) : event0(std::make_shared<type::KEvent>(state)), event1(std::make_shared<type::KEvent>(state)), BaseService(state, manager) {}
 
     Result IRequest::GetRequestState(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         constexpr u32 Unsubmitted = 1; //!< The request has not been submitted
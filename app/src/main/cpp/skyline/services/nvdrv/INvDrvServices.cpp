@@ -7,15 +7,7 @@
 #include "devices/nvdevice.h"
 
 namespace skyline::service::nvdrv {
-    INvDrvServices::INvDrvServices(const DeviceState &state, ServiceManager &manager) : driver(nvdrv::driver.expired() ? std::make_shared<Driver>(state) : nvdrv::driver.lock()), BaseService(state, manager, {
-        {0x0, SFUNC(INvDrvServices::Open)},
-        {0x1, SFUNC(INvDrvServices::Ioctl)},
-        {0x2, SFUNC(INvDrvServices::Close)},
-        {0x3, SFUNC(INvDrvServices::Initialize)},
-        {0x4, SFUNC(INvDrvServices::QueryEvent)},
-        {0x8, SFUNC(INvDrvServices::SetAruid)},
-        {0xD, SFUNC(INvDrvServices::SetGraphicsFirmwareMemoryMarginEnabled)}
-    }) {
+    INvDrvServices::INvDrvServices(const DeviceState &state, ServiceManager &manager) : driver(nvdrv::driver.expired() ? std::make_shared<Driver>(state) : nvdrv::driver.lock()), BaseService(state, manager) {
         if (nvdrv::driver.expired())
             nvdrv::driver = driver;
     }
@@ -35,9 +27,11 @@ namespace skyline::service::nvdrv {
         auto cmd = request.Pop<u32>();
 
         auto device = driver->GetDevice(fd);
-
-        // Strip the permissions from the command leaving only the ID
-        cmd &= 0xFFFF;
+        if (!device) {
+            state.logger->Warn("IOCTL on invalid FD: {}", fd);
+            response.Push(device::NvStatus::BadParameter);
+            return {};
+        }
 
         std::optional<kernel::ipc::IpcBuffer> buffer{std::nullopt};
         if (request.inputBuf.empty() || request.outputBuf.empty()) {
@@ -77,6 +71,12 @@ namespace skyline::service::nvdrv {
         auto eventId = request.Pop<u32>();
 
         auto device = driver->GetDevice(fd);
+        if (!device) {
+            state.logger->Warn("QueryEvent on invalid FD: {}", fd);
+            response.Push(device::NvStatus::BadParameter);
+            return {};
+        }
+
         auto event = device->QueryEvent(eventId);
 
         if (event != nullptr) {
@@ -103,9 +103,11 @@ namespace skyline::service::nvdrv {
         auto cmd = request.Pop<u32>();
 
         auto device = driver->GetDevice(fd);
-
-        // Strip the permissions from the command leaving only the ID
-        cmd &= 0xFFFF;
+        if (!device) {
+            state.logger->Warn("IOCTL on invalid FD: {}", fd);
+            response.Push(device::NvStatus::BadParameter);
+            return {};
+        }
 
         if (request.inputBuf.size() < 2 || request.outputBuf.empty())
             throw exception("Inadequate amount of buffers for IOCTL2: I - {}, O - {}", request.inputBuf.size(), request.outputBuf.size());
@@ -121,9 +123,11 @@ namespace skyline::service::nvdrv {
         auto cmd = request.Pop<u32>();
 
         auto device = driver->GetDevice(fd);
-
-        // Strip the permissions from the command leaving only the ID
-        cmd &= 0xFFFF;
+        if (!device) {
+            state.logger->Warn("IOCTL on invalid FD: {}", fd);
+            response.Push(device::NvStatus::BadParameter);
+            return {};
+        }
 
         if (request.inputBuf.empty() || request.outputBuf.size() < 2)
             throw exception("Inadequate amount of buffers for IOCTL3: I - {}, O - {}", request.inputBuf.size(), request.outputBuf.size());
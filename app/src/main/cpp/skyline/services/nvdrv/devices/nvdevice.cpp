@@ -17,30 +17,14 @@ namespace skyline::service::nvdrv::device {
         return name;
     }
 
-    NvStatus NvDevice::HandleIoctl(u32 cmd, IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
-        std::string_view typeString{[type] {
-            switch (type) {
-                case IoctlType::Ioctl:
-                    return "IOCTL";
-                case IoctlType::Ioctl2:
-                    return "IOCTL2";
-                case IoctlType::Ioctl3:
-                    return "IOCTL3";
-            }
-        }()};
-
-        std::pair<std::function<NvStatus(IoctlType, std::span<u8>, std::span<u8>)>, std::string_view> function;
-        try {
-            function = GetIoctlFunction(cmd);
-            state.logger->Debug("{} @ {}: {}", typeString, GetName(), function.second);
-        } catch (std::out_of_range &) {
-            state.logger->Warn("Cannot find IOCTL for device '{}': 0x{:X}", GetName(), cmd);
-            return NvStatus::NotImplemented;
-        }
-        try {
-            return function.first(type, buffer, inlineBuffer);
-        } catch (const std::exception &e) {
-            throw exception("{} ({} @ {}: {})", e.what(), typeString, GetName(), function.second);
+    std::string_view NvDevice::GetTypeName(IoctlType type) {
+        switch (type) {
+            case IoctlType::Ioctl:
+                return "IOCTL";
+            case IoctlType::Ioctl2:
+                return "IOCTL2";
+            case IoctlType::Ioctl3:
+                return "IOCTL3";
         }
     }
 }
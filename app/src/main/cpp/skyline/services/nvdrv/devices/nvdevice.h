@@ -8,13 +8,11 @@
 #include <kernel/ipc.h>
 #include <kernel/types/KEvent.h>
 
-#define NVFUNC(id, Class, Function) std::pair<u32, std::pair<std::function<NvStatus(Class*, IoctlType, std::span<u8>, std::span<u8>)>, std::string_view>>{id, {&Class::Function, #Function}}
-#define NVDEVICE_DECL_AUTO(name, value) decltype(value) name = value
-#define NVDEVICE_DECL(...)                                                                                                                        \
-NVDEVICE_DECL_AUTO(functions, frz::make_unordered_map({__VA_ARGS__}));                                                                            \
-std::pair<std::function<NvStatus(IoctlType, std::span<u8>, std::span<u8>)>, std::string_view> GetIoctlFunction(u32 id) {                          \
-    auto& function = functions.at(id);                                                                                                            \
-    return std::make_pair(std::bind(function.first, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3), function.second); \
+#define NVFUNC(id, Class, Function) ::skyline::service::nvdrv::device::IoctlFunction<Class>{id, &Class::Function, #Function}
+#define NVDEVICE_DECL(...)                                                                                                     \
+static constexpr auto IoctlFunctions{::skyline::service::nvdrv::device::MakeIoctlFunctionTable({__VA_ARGS__})};                \
+NvStatus CallIoctlFunction(IoctlDescriptor cmd, IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) override { \
+    return DispatchIoctlFunction(this, IoctlFunctions, cmd, type, buffer, inlineBuffer);                                     \
 }
 
 namespace skyline::service::nvdrv::device {
@@ -58,6 +56,62 @@ namespace skyline::service::nvdrv::device {
         Ioctl3, //!< 1 input/output buffer + 1 output buffer
     };
 
+    /**
+     * @brief The command of an IOCTL call, this follows the encoding of Linux IOCTLs (https://switchbrew.org/wiki/NV_services#Ioctls)
+     */
+    union IoctlDescriptor {
+        struct {
+            u8 number; //!< The number of the IOCTL, this is unique amongst IOCTLs with the same magic
+            u8 magic; //!< The magic of the IOCTL, this is shared by all IOCTLs of a device
+            u16 size : 14; //!< The size of the structure the IOCTL operates on in the input/output buffer
+            bool in : 1; //!< If the IOCTL reads its structure from the input/output buffer
+            bool out : 1; //!< If the IOCTL writes its structure to the input/output buffer
+        };
+        u32 raw;
+
+        constexpr IoctlDescriptor(u32 raw) : raw(raw) {}
+
+        /**
+         * @return The ID of the IOCTL, this is the magic and number without the size and direction
+         */
+        constexpr u16 GetId() const {
+            return static_cast<u16>(raw);
+        }
+    };
+    static_assert(sizeof(IoctlDescriptor) == sizeof(u32));
+
+    template<typename Class>
+    using IoctlFunctionPointer = NvStatus (Class::*)(IoctlType, std::span<u8>, std::span<u8>);
+
+    /**
+     * @brief A single entry of the IOCTL dispatch table of a device, this maps an IOCTL ID to a member function of the device
+     */
+    template<typename Class>
+    struct IoctlFunction {
+        u16 id; //!< The ID of the IOCTL, this is the magic and number of it
+        IoctlFunctionPointer<Class> function;
+        std::string_view name; //!< The name of the function, this is used for logging
+    };
+
+    /**
+     * @brief Sorts the IOCTLs of a device by their ID at compile-time, so they can be looked up with a binary search
+     * @note This fails to compile if any ID is used by more than one function
+     */
+    template<typename Class, size_t Size>
+    constexpr std::array<IoctlFunction<Class>, Size> MakeIoctlFunctionTable(const IoctlFunction<Class> (&functions)[Size]) {
+        std::array<IoctlFunction<Class>, Size> table{};
+        for (size_t index{}; index < Size; index++) {
+            auto function{functions[index]};
+            auto position{index};
+            for (; position && table[position - 1].id > function.id; position--)
+                table[position] = table[position - 1];
+            if (position && table[position - 1].id == function.id)
+                throw exception("Duplicate IOCTL ID in the functions of a device");
+            table[position] = function;
+        }
+        return table;
+    }
+
     /**
      * @brief NvDevice is the base class that all /dev/nv* devices inherit from
      */
@@ -68,13 +122,62 @@ namespace skyline::service::nvdrv::device {
       protected:
         const DeviceState &state; //!< The state of the device
 
+        /**
+         * @return A string representation of the IOCTL variant, this is used for logging
+         */
+        static std::string_view GetTypeName(IoctlType type);
+
+        /**
+         * @brief Calls the function of the device that corresponds to the IOCTL command, this is implemented by NVDEVICE_DECL
+         * @note Devices without a dispatch table use this implementation, which treats every IOCTL as unimplemented
+         */
+        virtual NvStatus CallIoctlFunction(IoctlDescriptor cmd, IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+            state.logger->Warn("Cannot find IOCTL for device '{}': 0x{:X}", GetName(), cmd.raw);
+            return NvStatus::NotImplemented;
+        }
+
+        /**
+         * @brief Looks up the function for an IOCTL in the dispatch table of a device and calls it
+         * @param device The device to call the function on, this is the most derived class that declared the table
+         * @param functions The dispatch table of the device, sorted by IOCTL ID
+         * @note The input/output buffer is validated against the size encoded in the command here, so functions can access the structure they operate on without checking its size
+         */
+        template<typename Class, size_t Size>
+        NvStatus DispatchIoctlFunction(Class *device, const std::array<IoctlFunction<Class>, Size> &functions, IoctlDescriptor cmd, IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+            auto id{cmd.GetId()};
+
+            size_t low{}, high{Size};
+            while (low < high) {
+                auto middle{(low + high) / 2};
+                if (functions[middle].id < id)
+                    low = middle + 1;
+                else
+                    high = middle;
+            }
+
+            if (low == Size || functions[low].id != id)
+                return NvDevice::CallIoctlFunction(cmd, type, buffer, inlineBuffer);
+
+            auto &function{functions[low]};
+            LOGD(state.logger, "{} @ {}: {}", GetTypeName(type), GetName(), function.name);
+
+            if ((cmd.in || cmd.out) && buffer.size() < cmd.size) {
+                state.logger->Warn("IOCTL buffer is smaller than its structure ({} @ {}: {}): 0x{:X} < 0x{:X}", GetTypeName(type), GetName(), function.name, buffer.size(), static_cast<u16>(cmd.size));
+                return NvStatus::InvalidSize;
+            }
+
+            try {
+                return (device->*function.function)(type, buffer, inlineBuffer);
+            } catch (const std::exception &e) {
+                throw exception("{} ({} @ {}: {})", e.what(), GetTypeName(type), GetName(), function.name);
+            }
+        }
+
       public:
         inline NvDevice(const DeviceState &state) : state(state) {}
 
         virtual ~NvDevice() = default;
 
-        virtual std::pair<std::function<NvStatus(IoctlType, std::span<u8>, std::span<u8>)>, std::string_view> GetIoctlFunction(u32 id) = 0;
-
         /**
          * @return The name of the class
          * @note The lifetime of the returned string is tied to that of the class
@@ -83,9 +186,11 @@ namespace skyline::service::nvdrv::device {
 
         /**
          * @brief This handles IOCTL calls for devices
-         * @param cmd The IOCTL command that was called
+         * @param cmd The IOCTL command that was called, this includes the size and direction of the IOCTL
          */
-        NvStatus HandleIoctl(u32 cmd, IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer);
+        inline NvStatus HandleIoctl(u32 cmd, IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+            return CallIoctlFunction(cmd, type, buffer, inlineBuffer);
+        }
 
         inline virtual std::shared_ptr<kernel::type::KEvent> QueryEvent(u32 eventId) {
             return nullptr;
@@ -11,6 +11,19 @@
 namespace skyline::service::nvdrv::device {
     NvHostAsGpu::NvHostAsGpu(const DeviceState &state) : NvDevice(state) {}
 
+    void NvHostAsGpu::EraseMapping(std::unordered_map<u64, Mapping>::iterator mapping) {
+        if (!mapping->second.fixed) {
+            auto handleMapping{handleMappings.find(mapping->second.handle)};
+            if (handleMapping != handleMappings.end()) {
+                auto &offsets{handleMapping->second};
+                offsets.erase(std::remove(offsets.begin(), offsets.end(), mapping->first), offsets.end());
+                if (offsets.empty())
+                    handleMappings.erase(handleMapping);
+            }
+        }
+        mappings.erase(mapping);
+    }
+
     NvStatus NvHostAsGpu::BindChannel(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
         return NvStatus::Success;
     }
@@ -45,6 +58,16 @@ namespace skyline::service::nvdrv::device {
     NvStatus NvHostAsGpu::UnmapBuffer(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
         u64 offset{util::As<u64>(buffer)};
 
+        std::lock_guard guard(mappingLock);
+        auto mapping{mappings.find(offset)};
+        if (mapping != mappings.end()) {
+            // A mapping that has been reused is only unmapped after it's been unmapped as many times as it was mapped
+            if (!mapping->second.fixed && --mapping->second.references)
+                return NvStatus::Success;
+
+            EraseMapping(mapping);
+        }
+
         if (!state.gpu->memoryManager.Unmap(offset))
             state.logger->Warn("Failed to unmap chunk at 0x{:X}", offset);
 
@@ -62,29 +85,54 @@ namespace skyline::service::nvdrv::device {
             u64 offset;       // InOut
         }  &data = util::As<Data>(buffer);
 
-        try {
-            auto driver = nvdrv::driver.lock();
-            auto nvmap = driver->nvMap.lock();
-            auto mapping = nvmap->handleTable.at(data.nvmapHandle);
-
-            u64 mapPhysicalAddress = data.bufferOffset + mapping->address;
-            u64 mapSize = data.mappingSize ? data.mappingSize : mapping->size;
-
-            if (data.flags & 1)
-                data.offset = state.gpu->memoryManager.MapFixed(data.offset, mapPhysicalAddress, mapSize);
-            else
-                data.offset = state.gpu->memoryManager.MapAllocate(mapPhysicalAddress, mapSize);
+        auto driver = nvdrv::driver.lock();
+        auto nvmap = driver->nvMap.lock();
+        auto object{nvmap->GetObject(data.nvmapHandle)};
+        if (!object) {
+            state.logger->Warn("Invalid NvMap handle: 0x{:X}", data.nvmapHandle);
+            return NvStatus::BadParameter;
+        }
 
-            if (data.offset == 0) {
-                state.logger->Warn("Failed to map GPU address space region!");
-                return NvStatus::BadParameter;
+        u64 mapPhysicalAddress = data.bufferOffset + object->address;
+        u64 mapSize = data.mappingSize ? data.mappingSize : object->size;
+        bool fixed{static_cast<bool>(data.flags & 1)};
+
+        std::lock_guard guard(mappingLock);
+        if (!fixed) {
+            // Mapping the same region of a buffer again returns the existing mapping rather than creating another one
+            auto offsets{handleMappings.find(data.nvmapHandle)};
+            if (offsets != handleMappings.end()) {
+                for (auto offset : offsets->second) {
+                    auto &mapping{mappings.at(offset)};
+                    if (mapping.object.lock() == object && mapping.cpuAddress == mapPhysicalAddress && mapping.size == mapSize && mapping.kind == data.kind) {
+                        mapping.references++;
+                        data.offset = mapping.offset;
+                        return NvStatus::Success;
+                    }
+                }
             }
+        }
 
-            return NvStatus::Success;
-        } catch (const std::out_of_range &) {
-            state.logger->Warn("Invalid NvMap handle: 0x{:X}", data.nvmapHandle);
+        if (fixed)
+            data.offset = state.gpu->memoryManager.MapFixed(data.offset, mapPhysicalAddress, mapSize);
+        else
+            data.offset = state.gpu->memoryManager.MapAllocate(mapPhysicalAddress, mapSize);
+
+        if (data.offset == 0) {
+            state.logger->Warn("Failed to map GPU address space region!");
             return NvStatus::BadParameter;
         }
+
+        // A fixed mapping replaces any mapping that was at the same address
+        auto previous{mappings.find(data.offset)};
+        if (previous != mappings.end())
+            EraseMapping(previous);
+
+        mappings.emplace(data.offset, Mapping{object, data.nvmapHandle, mapPhysicalAddress, mapSize, data.offset, data.kind, 1, fixed});
+        if (!fixed)
+            handleMappings[data.nvmapHandle].push_back(data.offset);
+
+        return NvStatus::Success;
     }
 
     NvStatus NvHostAsGpu::GetVaRegions(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
@@ -132,22 +180,36 @@ namespace skyline::service::nvdrv::device {
 
         constexpr u32 MinAlignmentShift{0x10}; // This shift is applied to all addresses passed to Remap
 
+        auto driver = nvdrv::driver.lock();
+        auto nvmap = driver->nvMap.lock();
+
+        // All entries are applied as a single batch, sparse textures can remap thousands of pages at a time which would otherwise each be a separate insertion into the chunk list
         auto entries{util::AsSpan<Entry>(buffer)};
+        std::vector<gpu::vmm::ChunkDescriptor> mappings;
+        mappings.reserve(entries.size());
         for (auto entry : entries) {
-            try {
-                auto driver = nvdrv::driver.lock();
-                auto nvmap = driver->nvMap.lock();
-                auto mapping = nvmap->handleTable.at(entry.nvmapHandle);
+            u64 mapAddress = static_cast<u64>(entry.gpuOffset) << MinAlignmentShift;
+            u64 mapSize = static_cast<u64>(entry.pages) << MinAlignmentShift;
 
-                u64 mapAddress = static_cast<u64>(entry.gpuOffset) << MinAlignmentShift;
-                u64 mapPhysicalAddress = mapping->address + (static_cast<u64>(entry.mapOffset) << MinAlignmentShift);
-                u64 mapSize = static_cast<u64>(entry.pages) << MinAlignmentShift;
+            // An entry without a handle unmaps its pages, this is used to unbind the pages of sparse resources
+            if (!entry.nvmapHandle) {
+                mappings.emplace_back(mapAddress, mapSize, 0, gpu::vmm::ChunkState::Reserved);
+                continue;
+            }
 
-                state.gpu->memoryManager.MapFixed(mapAddress, mapPhysicalAddress, mapSize);
-            } catch (const std::out_of_range &) {
+            auto object{nvmap->GetObject(entry.nvmapHandle)};
+            if (!object) {
                 state.logger->Warn("Invalid NvMap handle: 0x{:X}", entry.nvmapHandle);
                 return NvStatus::BadParameter;
             }
+
+            u64 mapPhysicalAddress = object->address + (static_cast<u64>(entry.mapOffset) << MinAlignmentShift);
+            mappings.emplace_back(mapAddress, mapSize, mapPhysicalAddress, gpu::vmm::ChunkState::Mapped);
+        }
+
+        if (!state.gpu->memoryManager.MapBatch(mappings)) {
+            state.logger->Warn("Failed to remap {} GPU address space regions", mappings.size());
+            return NvStatus::BadParameter;
         }
 
         return NvStatus::Success;
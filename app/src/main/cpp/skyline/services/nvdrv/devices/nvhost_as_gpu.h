@@ -3,13 +3,38 @@
 
 #pragma once
 
-#include "nvdevice.h"
+#include "nvmap.h"
 
 namespace skyline::service::nvdrv::device {
     /**
      * @brief NvHostAsGpu (/dev/nvhost-as-gpu) is used to access GPU virtual address spaces (https://switchbrew.org/wiki/NV_services#.2Fdev.2Fnvhost-as-gpu)
      */
     class NvHostAsGpu : public NvDevice {
+      private:
+        /**
+         * @brief A mapping of an NvMapObject into the GPU address space
+         */
+        struct Mapping {
+            std::weak_ptr<NvMap::NvMapObject> object; //!< The object that is mapped, this is compared so a handle that's freed and reused isn't confused with the object that was mapped, it's a weak reference as NvMap::Free uses the reference count of the object
+            KHandle handle; //!< The nvmap handle the mapping was created with, this is stored separately as the object may have been freed
+            u64 cpuAddress; //!< The CPU address the mapping is backed by, this is compared rather than the offset into the object as the object may be reallocated at a different address
+            u64 size; //!< The size of the mapping
+            u64 offset; //!< The address of the mapping in the GPU address space
+            u32 kind; //!< The kind the mapping was created with
+            u32 references; //!< The amount of times the mapping has been returned by Modify without being unmapped
+            bool fixed; //!< If the mapping was at a fixed address, these are never reused for other mappings
+        };
+
+        Mutex mappingLock; //!< This guards both mappings and handleMappings
+        std::unordered_map<u64, Mapping> mappings; //!< A map from the GPU address of each mapping to it, this is used to find the mapping being unmapped by UnmapBuffer
+        std::unordered_map<KHandle, std::vector<u64>> handleMappings; //!< A map from an nvmap handle to the GPU addresses of all of its non-fixed mappings, this is used to reuse existing mappings of the same buffer
+
+        /**
+         * @brief Removes a mapping from the mappings of the address space, this doesn't unmap it from the GPU address space
+         * @note mappingLock must be held when calling this
+         */
+        void EraseMapping(std::unordered_map<u64, Mapping>::iterator mapping);
+
       public:
         NvHostAsGpu(const DeviceState &state);
 
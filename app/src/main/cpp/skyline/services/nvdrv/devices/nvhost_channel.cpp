@@ -8,7 +8,7 @@
 #include "nvhost_channel.h"
 
 namespace skyline::service::nvdrv::device {
-    NvHostChannel::NvHostChannel(const DeviceState &state) : smExceptionBreakpointIntReportEvent(std::make_shared<type::KEvent>(state)), smExceptionBreakpointPauseReportEvent(std::make_shared<type::KEvent>(state)), errorNotifierEvent(std::make_shared<type::KEvent>(state)), NvDevice(state) {
+    NvHostChannel::NvHostChannel(const DeviceState &state) : smExceptionBreakpointIntReportEvent(std::make_shared<type::KEvent>(state)), smExceptionBreakpointPauseReportEvent(std::make_shared<type::KEvent>(state)), errorNotifierEvent(std::make_shared<type::KEvent>(state)), gpfifo(state.gpu->channelScheduler.CreateChannel()), NvDevice(state) {
         auto driver = nvdrv::driver.lock();
         auto &hostSyncpoint = driver->hostSyncpoint;
 
@@ -46,23 +46,27 @@ namespace skyline::service::nvdrv::device {
         auto driver = nvdrv::driver.lock();
         auto &hostSyncpoint = driver->hostSyncpoint;
 
+        // The wait is done by the GPFIFO worker prior to executing the entries, so the guest never blocks on it here
+        u32 waitSyncpointId{}, waitThreshold{};
         if (data.flags.fenceWait) {
             if (data.flags.incrementWithValue)
                 return NvStatus::BadValue;
+            if (data.fence.id >= skyline::constant::MaxHwSyncpointCount)
+                return NvStatus::BadParameter;
 
-            if (hostSyncpoint.HasSyncpointExpired(data.fence.id, data.fence.value))
-                throw exception("Waiting on a fence through SubmitGpfifo is unimplemented");
+            if (!hostSyncpoint.HasSyncpointExpired(data.fence.id, data.fence.value)) {
+                waitSyncpointId = data.fence.id;
+                waitThreshold = data.fence.value;
+            }
         }
 
-        state.gpu->gpfifo.Push(std::span(state.process->GetPointer<gpu::gpfifo::GpEntry>(data.address), data.numEntries));
-
         data.fence.id = channelFence.id;
 
         u32 increment = (data.flags.fenceIncrement ? 2 : 0) + (data.flags.incrementWithValue ? data.fence.value : 0);
         data.fence.value = hostSyncpoint.IncrementSyncpointMaxExt(data.fence.id, increment);
 
-        if (data.flags.fenceIncrement)
-            throw exception("Incrementing a fence through SubmitGpfifo is unimplemented");
+        // The fence increment is done by the GPFIFO worker after all the entries have been executed, the maximum value must be incremented prior to pushing so it's never behind the actual value
+        gpfifo->Push(std::span(state.process->GetPointer<gpu::gpfifo::GpEntry>(data.address), data.numEntries), data.fence.id, data.flags.fenceIncrement ? 2 : 0, waitSyncpointId, waitThreshold);
 
         data.flags.raw = 0;
 
@@ -94,6 +98,8 @@ namespace skyline::service::nvdrv::device {
                 break;
         }
 
+        gpfifo->SetTimeslice(timeslice);
+
         return NvStatus::Success;
     }
 
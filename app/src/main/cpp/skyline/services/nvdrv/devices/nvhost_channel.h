@@ -6,6 +6,10 @@
 #include <services/common/fence.h>
 #include "nvdevice.h"
 
+namespace skyline::gpu::gpfifo {
+    class GPFIFO;
+}
+
 namespace skyline::service::nvdrv::device {
     /**
      * @brief NvHostChannel is used as a common interface for all Channel devices (https://switchbrew.org/wiki/NV_services#Channels)
@@ -23,6 +27,7 @@ namespace skyline::service::nvdrv::device {
         std::shared_ptr<type::KEvent> smExceptionBreakpointIntReportEvent;
         std::shared_ptr<type::KEvent> smExceptionBreakpointPauseReportEvent;
         std::shared_ptr<type::KEvent> errorNotifierEvent;
+        std::shared_ptr<gpu::gpfifo::GPFIFO> gpfifo; //!< The GPFIFO of this channel, submissions to it are scheduled alongside those of other channels
 
       public:
         NvHostChannel(const DeviceState &state);
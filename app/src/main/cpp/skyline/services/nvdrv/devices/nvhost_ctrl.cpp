@@ -11,30 +11,40 @@ namespace skyline::service::nvdrv::device {
     NvHostEvent::NvHostEvent(const DeviceState &state) : event(std::make_shared<type::KEvent>(state)) {}
 
     void NvHostEvent::Signal() {
-        auto oldState = state;
-        state = State::Signaling;
-
         // This is to ensure that the HOS event isn't signalled when the nvhost event is cancelled
-        if (oldState == State::Waiting)
+        auto expected{State::Waiting};
+        if (state.compare_exchange_strong(expected, State::Signaling)) {
             event->Signal();
-
-        state = State::Signaled;
+            state = State::Signaled;
+        }
     }
 
     void NvHostEvent::Cancel(const std::shared_ptr<gpu::GPU> &gpuState) {
-        gpuState->syncpoints.at(fence.id).DeregisterWaiter(waiterId);
-        Signal();
+        // Once the waiter is deregistered its callback is guaranteed to have either run to completion or to never run
+        if (waiterId) {
+            gpuState->syncpoints.at(fence.id).DeregisterWaiter(waiterId);
+            waiterId = 0;
+        }
+
+        state = State::Signaled;
         event->ResetSignal();
     }
 
     void NvHostEvent::Wait(const std::shared_ptr<gpu::GPU> &gpuState, const Fence &fence) {
+        // The event is put into the waiting state before registering as the callback is run immediately if the fence has already been hit
+        this->fence = fence;
+        state = State::Waiting;
         waiterId = gpuState->syncpoints.at(fence.id).RegisterWaiter(fence.value, [this] { Signal(); });
+    }
 
-        // If waiter ID is zero then the fence has already been hit and was signalled in the call to RegisterWaiter
-        if (waiterId) {
-            this->fence = fence;
-            state = State::Waiting;
-        }
+    void NvHostEvent::Reset(const std::shared_ptr<gpu::GPU> &gpuState) {
+        auto expected{State::Waiting};
+        if (state.compare_exchange_strong(expected, State::Cancelling))
+            Cancel(gpuState);
+
+        fence = {};
+        state = State::Available;
+        event->ResetSignal();
     }
 
     NvHostCtrl::NvHostCtrl(const DeviceState &state) : NvDevice(state) {}
@@ -46,8 +56,9 @@ namespace skyline::service::nvdrv::device {
         for (u32 i{}; i < constant::NvHostEventCount; i++) {
             if (events[i]) {
                 const auto &event = *events[i];
+                auto eventState{event.state.load()};
 
-                if (event.state == NvHostEvent::State::Cancelled || event.state == NvHostEvent::State::Available || event.state == NvHostEvent::State::Signaled) {
+                if (eventState == NvHostEvent::State::Cancelled || eventState == NvHostEvent::State::Available || eventState == NvHostEvent::State::Signaled) {
                     eventIndex = i;
 
                     // This event is already attached to the requested syncpoint, so use it
@@ -61,7 +72,7 @@ namespace skyline::service::nvdrv::device {
 
         // Use an unused event if possible
         if (freeIndex < constant::NvHostEventCount) {
-            events.at(freeIndex) = static_cast<const std::optional<NvHostEvent>>(NvHostEvent(state));
+            events.at(freeIndex).emplace(state);
             return freeIndex;
         }
 
@@ -114,7 +125,8 @@ namespace skyline::service::nvdrv::device {
         }
 
         auto& event = *events.at(userEventId);
-        if (event.state == NvHostEvent::State::Cancelled || event.state == NvHostEvent::State::Available || event.state == NvHostEvent::State::Signaled) {
+        auto eventState{event.state.load()};
+        if (eventState == NvHostEvent::State::Cancelled || eventState == NvHostEvent::State::Available || eventState == NvHostEvent::State::Signaled) {
             state.logger->Debug("Now waiting on nvhost event: {} with fence: {}", userEventId, data.fence.id);
             event.Wait(state.gpu, data.fence);
 
@@ -148,8 +160,9 @@ namespace skyline::service::nvdrv::device {
 
         auto &event = *events.at(userEventId);
 
-        if (event.state == NvHostEvent::State::Waiting) {
-            event.state = NvHostEvent::State::Cancelling;
+        // The event is only cancelled if it's still waiting as the GPU thread might signal it concurrently
+        auto expected{NvHostEvent::State::Waiting};
+        if (event.state.compare_exchange_strong(expected, NvHostEvent::State::Cancelling)) {
             state.logger->Debug("Cancelling waiting nvhost event: {}", userEventId);
             event.Cancel(state.gpu);
         }
@@ -175,10 +188,15 @@ namespace skyline::service::nvdrv::device {
         auto userEventId{util::As<u32>(buffer)};
         state.logger->Debug("Registering nvhost event: {}", userEventId);
 
+        if (userEventId >= constant::NvHostEventCount)
+            return NvStatus::BadValue;
+
+        // A previously registered event is reset rather than recreated so its KEvent is retained
         auto &event = events.at(userEventId);
         if (event)
-            throw exception("Recreating events is unimplemented");
-        event = NvHostEvent(state);
+            event->Reset(state.gpu);
+        else
+            event.emplace(state);
 
         return NvStatus::Success;
     }
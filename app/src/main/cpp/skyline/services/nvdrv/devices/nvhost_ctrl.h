@@ -14,11 +14,15 @@ namespace skyline {
     namespace service::nvdrv::device {
         /**
          * @brief This represents a single registered event with an attached fence
+         * @note Events are signalled directly from the syncpoint callback on the GPU thread, the event's state is atomic as it's transitioned by both that and the guest
          */
         class NvHostEvent {
           private:
-            u64 waiterId{};
+            u64 waiterId{}; //!< The ID of the syncpoint waiter for the current wait, this is 0 if there's no pending waiter
 
+            /**
+             * @brief Signals the KEvent if the event is still waiting, this is called by the syncpoint when the fence is reached
+             */
             void Signal();
 
           public:
@@ -36,7 +40,7 @@ namespace skyline {
 
             NvHostEvent(const DeviceState &state);
 
-            State state{State::Available};
+            std::atomic<State> state{State::Available};
             Fence fence{}; //!< The fence that is attached to this event
             std::shared_ptr<type::KEvent> event{}; //!< Returned by 'QueryEvent'
 
@@ -47,8 +51,14 @@ namespace skyline {
 
             /**
              * @brief Asynchronously waits on an event using the given fence
+             * @note The KEvent is signalled prior to this returning if the fence has already been reached
              */
             void Wait(const std::shared_ptr<gpu::GPU> &gpuState, const Fence &fence);
+
+            /**
+             * @brief Returns the event to its initial state while retaining its KEvent so it can be reused
+             */
+            void Reset(const std::shared_ptr<gpu::GPU> &gpuState);
         };
 
         /**
@@ -79,7 +89,7 @@ namespace skyline {
             };
             static_assert(sizeof(EventValue) == sizeof(u32));
 
-            std::array<std::optional<NvHostEvent>, constant::NvHostEventCount> events{};
+            std::array<std::optional<NvHostEvent>, constant::NvHostEventCount> events{}; //!< A pool of events, an event is constructed the first time its slot is used and is reused for every subsequent wait on it
 
             /**
              * @brief Finds a free event for the given syncpoint id
@@ -0,0 +1,234 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <gpu.h>
+#include <kernel/types/KProcess.h>
+#include <services/nvdrv/driver.h>
+#include "nvmap.h"
+#include "nvhost_host1x_channel.h"
+
+namespace skyline::service::nvdrv::device {
+    NvHostHost1xChannel::NvHostHost1xChannel(const DeviceState &state, gpu::host1x::Channel &channel) : NvDevice(state), channel(channel) {
+        auto driver{nvdrv::driver.lock()};
+        syncpointId = driver->hostSyncpoint.AllocateSyncpoint(false);
+    }
+
+    NvHostHost1xChannel::~NvHostHost1xChannel() {
+        std::lock_guard lock(mappingMutex);
+        for (const auto &[handle, mapping] : mappings)
+            state.gpu->host1x.smmu.Unmap(mapping.iova);
+    }
+
+    std::optional<u32> NvHostHost1xChannel::MapHandle(u32 handle) {
+        auto mapping{mappings.find(handle)};
+        if (mapping != mappings.end())
+            return mapping->second.iova;
+
+        auto driver{nvdrv::driver.lock()};
+        auto object{driver->nvMap.lock()->GetObject(handle)};
+        if (!object || !object->address)
+            return std::nullopt;
+
+        auto iova{state.gpu->host1x.smmu.Map(object->address, object->size)};
+        mappings.emplace(handle, BufferMapping{iova, 0});
+        return iova;
+    }
+
+    NvStatus NvHostHost1xChannel::Submit(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+        struct Data {
+            u32 numCommandBuffers; // In
+            u32 numRelocations;    // In
+            u32 numSyncpointIncrements; // In
+            u32 numFences;         // In
+        } data = util::As<Data>(buffer);
+
+        struct CommandBuffer {
+            u32 handle;
+            u32 offset; //!< The offset of the commands in the object in bytes
+            u32 words;
+        };
+
+        struct Relocation {
+            u32 commandBufferHandle;
+            u32 commandBufferOffset; //!< The offset of the word that is patched in the object of the command buffer in bytes
+            u32 targetHandle;
+            u32 targetOffset;
+        };
+
+        struct SyncpointIncrement {
+            u32 id;
+            u32 increments;
+        };
+
+        // The arrays of the submission follow the header in the order of their counts, they're all variable-length
+        auto arrays{buffer.subspan(sizeof(Data))};
+        auto takeArray{[&arrays]<typename Type>(u32 count) -> std::span<Type> {
+            auto size{static_cast<size_t>(count) * sizeof(Type)};
+            if (size > arrays.size())
+                return {};
+            std::span<Type> array(reinterpret_cast<Type *>(arrays.data()), count);
+            arrays = arrays.subspan(size);
+            return array;
+        }};
+
+        auto commandBuffers{takeArray.template operator()<CommandBuffer>(data.numCommandBuffers)};
+        auto relocations{takeArray.template operator()<Relocation>(data.numRelocations)};
+        auto relocationShifts{takeArray.template operator()<u32>(data.numRelocations)};
+        auto syncpointIncrements{takeArray.template operator()<SyncpointIncrement>(data.numSyncpointIncrements)};
+        auto fences{takeArray.template operator()<u32>(data.numFences)};
+        if (commandBuffers.size() != data.numCommandBuffers || relocations.size() != data.numRelocations || relocationShifts.size() != data.numRelocations || syncpointIncrements.size() != data.numSyncpointIncrements || fences.size() != data.numFences)
+            return NvStatus::InvalidSize;
+
+        auto driver{nvdrv::driver.lock()};
+        auto nvmap{driver->nvMap.lock()};
+
+        // The command buffers are copied at submission so the guest can reuse them as soon as the IOCTL returns, the relocations are applied to the copy
+        std::vector<u32> commands;
+        std::vector<size_t> commandBufferStarts; //!< The index of the first word of each command buffer in commands
+        for (const auto &commandBuffer : commandBuffers) {
+            auto object{nvmap->GetObject(commandBuffer.handle)};
+            if (!object || !object->address) {
+                state.logger->Warn("Invalid NvMap handle for a command buffer: 0x{:X}", commandBuffer.handle);
+                return NvStatus::BadParameter;
+            }
+
+            auto size{static_cast<u64>(commandBuffer.words) * sizeof(u32)};
+            if (static_cast<u64>(commandBuffer.offset) + size > object->size) {
+                state.logger->Warn("Command buffer exceeds its NvMap object: 0x{:X} + 0x{:X} > 0x{:X}", commandBuffer.offset, size, object->size);
+                return NvStatus::BadParameter;
+            }
+
+            // The object isn't necessarily backed by contiguous host memory, ReadMemory copies it piecewise in that case
+            commandBufferStarts.push_back(commands.size());
+            commands.resize(commands.size() + commandBuffer.words);
+            if (size)
+                state.process->ReadMemory(commands.data() + commandBufferStarts.back(), object->address + commandBuffer.offset, size);
+        }
+
+        {
+            std::lock_guard lock(mappingMutex);
+            for (size_t index{}; index < relocations.size(); index++) {
+                const auto &relocation{relocations[index]};
+                auto iova{MapHandle(relocation.targetHandle)};
+                if (!iova)
+                    return NvStatus::BadParameter;
+
+                for (size_t buffer{}; buffer < commandBuffers.size(); buffer++) {
+                    const auto &commandBuffer{commandBuffers[buffer]};
+                    if (commandBuffer.handle == relocation.commandBufferHandle && relocation.commandBufferOffset >= commandBuffer.offset && relocation.commandBufferOffset < commandBuffer.offset + commandBuffer.words * sizeof(u32)) {
+                        commands[commandBufferStarts[buffer] + (relocation.commandBufferOffset - commandBuffer.offset) / sizeof(u32)] = static_cast<u32>((static_cast<u64>(*iova) + relocation.targetOffset) >> relocationShifts[index]);
+                        break;
+                    }
+                }
+            }
+        }
+
+        // The maximum values of the syncpoints are incremented prior to submitting so they're never behind the actual values
+        for (size_t index{}; index < syncpointIncrements.size(); index++) {
+            const auto &increment{syncpointIncrements[index]};
+            if (increment.id >= skyline::constant::MaxHwSyncpointCount)
+                return NvStatus::BadParameter;
+            auto threshold{driver->hostSyncpoint.IncrementSyncpointMaxExt(increment.id, increment.increments)};
+            if (index < fences.size())
+                fences[index] = threshold;
+        }
+
+        channel.Submit(std::move(commands));
+        return NvStatus::Success;
+    }
+
+    NvStatus NvHostHost1xChannel::GetSyncpoint(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+        struct Data {
+            u32 parameter; // In
+            u32 value;     // Out
+        } &data = util::As<Data>(buffer);
+
+        data.value = syncpointId;
+        return NvStatus::Success;
+    }
+
+    NvStatus NvHostHost1xChannel::GetWaitBase(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+        struct Data {
+            u32 parameter; // In
+            u32 value;     // Out
+        } &data = util::As<Data>(buffer);
+
+        data.value = 0;
+        return NvStatus::Success;
+    }
+
+    NvStatus NvHostHost1xChannel::SetSubmitTimeout(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+        return NvStatus::Success;
+    }
+
+    NvStatus NvHostHost1xChannel::MapBuffer(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+        struct Data {
+            u32 numEntries;      // In
+            u32 dataAddress;     // In
+            u32 attachHostChDas; // In
+        } data = util::As<Data>(buffer);
+
+        struct Entry {
+            u32 handle;  // In
+            u32 address; // Out
+        };
+
+        if (sizeof(Data) + static_cast<size_t>(data.numEntries) * sizeof(Entry) > buffer.size())
+            return NvStatus::InvalidSize;
+        std::span<Entry> entries(reinterpret_cast<Entry *>(buffer.data() + sizeof(Data)), data.numEntries);
+
+        std::lock_guard lock(mappingMutex);
+        for (auto &entry : entries) {
+            auto iova{MapHandle(entry.handle)};
+            if (!iova) {
+                state.logger->Warn("Invalid NvMap handle: 0x{:X}", entry.handle);
+                return NvStatus::BadParameter;
+            }
+
+            mappings.at(entry.handle).references++;
+            entry.address = *iova;
+        }
+
+        return NvStatus::Success;
+    }
+
+    NvStatus NvHostHost1xChannel::UnmapBuffer(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+        struct Data {
+            u32 numEntries;      // In
+            u32 dataAddress;     // In
+            u32 attachHostChDas; // In
+        } data = util::As<Data>(buffer);
+
+        struct Entry {
+            u32 handle;  // In
+            u32 address; // In
+        };
+
+        if (sizeof(Data) + static_cast<size_t>(data.numEntries) * sizeof(Entry) > buffer.size())
+            return NvStatus::InvalidSize;
+        std::span<Entry> entries(reinterpret_cast<Entry *>(buffer.data() + sizeof(Data)), data.numEntries);
+
+        // Mappings created implicitly by relocations have no references of their own, they're only unmapped with the device
+        std::lock_guard lock(mappingMutex);
+        for (const auto &entry : entries) {
+            auto mapping{mappings.find(entry.handle)};
+            if (mapping == mappings.end() || !mapping->second.references)
+                continue;
+
+            if (!--mapping->second.references) {
+                state.gpu->host1x.smmu.Unmap(mapping->second.iova);
+                mappings.erase(mapping);
+            }
+        }
+
+        return NvStatus::Success;
+    }
+
+    NvStatus NvHostHost1xChannel::SetNvmapFd(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
+        return NvStatus::Success;
+    }
+
+    NvHostNvdec::NvHostNvdec(const DeviceState &state) : NvHostHost1xChannel(state, state.gpu->host1x.nvdecChannel) {}
+
+    NvHostVic::NvHostVic(const DeviceState &state) : NvHostHost1xChannel(state, state.gpu->host1x.vicChannel) {}
+}
@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <services/common/fence.h>
+#include "nvdevice.h"
+
+namespace skyline::gpu::host1x {
+    class Channel;
+}
+
+namespace skyline::service::nvdrv::device {
+    /**
+     * @brief NvHostHost1xChannel is the common interface of the devices for the host1x channels of the multimedia engines (https://switchbrew.org/wiki/NV_services#Channels)
+     */
+    class NvHostHost1xChannel : public NvDevice {
+      private:
+        /**
+         * @brief A mapping of an NvMap object into the SMMU
+         */
+        struct BufferMapping {
+            u32 iova;
+            u32 references;
+        };
+
+        gpu::host1x::Channel &channel;
+        u32 syncpointId; //!< The syncpoint that's allocated for the channel
+        std::mutex mappingMutex; //!< Synchronizes accesses to mappings
+        std::unordered_map<u32, BufferMapping> mappings; //!< The SMMU mappings of NvMap objects keyed by their handle
+
+        /**
+         * @return The IOVA an NvMap object is mapped at, the object is mapped if it isn't already
+         * @note mappingMutex must be locked when calling this
+         */
+        std::optional<u32> MapHandle(u32 handle);
+
+      public:
+        NvHostHost1xChannel(const DeviceState &state, gpu::host1x::Channel &channel);
+
+        ~NvHostHost1xChannel();
+
+        /**
+         * @brief Submits command buffers to the channel (https://switchbrew.org/wiki/NV_services#NVHOST_IOCTL_CHANNEL_SUBMIT)
+         */
+        NvStatus Submit(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer);
+
+        /**
+         * @brief Returns the syncpoint of the channel (https://switchbrew.org/wiki/NV_services#NVHOST_IOCTL_CHANNEL_GET_SYNCPOINT)
+         */
+        NvStatus GetSyncpoint(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer);
+
+        /**
+         * @brief Returns the wait base of the channel, wait bases are never used so this is always 0 (https://switchbrew.org/wiki/NV_services#NVHOST_IOCTL_CHANNEL_GET_WAITBASE)
+         */
+        NvStatus GetWaitBase(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer);
+
+        /**
+         * @brief Sets the timeout for submissions, this is ignored (https://switchbrew.org/wiki/NV_services#NVHOST_IOCTL_CHANNEL_SET_SUBMIT_TIMEOUT)
+         */
+        NvStatus SetSubmitTimeout(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer);
+
+        /**
+         * @brief Maps NvMap objects into the SMMU and returns their IOVAs (https://switchbrew.org/wiki/NV_services#NVHOST_IOCTL_CHANNEL_MAP_CMD_BUFFER)
+         */
+        NvStatus MapBuffer(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer);
+
+        /**
+         * @brief Unmaps NvMap objects from the SMMU (https://switchbrew.org/wiki/NV_services#NVHOST_IOCTL_CHANNEL_UNMAP_CMD_BUFFER)
+         */
+        NvStatus UnmapBuffer(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer);
+
+        /**
+         * @brief Sets the NvMap file descriptor, this is ignored as there's only a single NvMap (https://switchbrew.org/wiki/NV_services#NVGPU_IOCTL_CHANNEL_SET_NVMAP_FD)
+         */
+        NvStatus SetNvmapFd(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer);
+
+        NVDEVICE_DECL(
+            NVFUNC(0x0001, NvHostHost1xChannel, Submit),
+            NVFUNC(0x0002, NvHostHost1xChannel, GetSyncpoint),
+            NVFUNC(0x0003, NvHostHost1xChannel, GetWaitBase),
+            NVFUNC(0x0007, NvHostHost1xChannel, SetSubmitTimeout),
+            NVFUNC(0x0009, NvHostHost1xChannel, MapBuffer),
+            NVFUNC(0x000A, NvHostHost1xChannel, UnmapBuffer),
+            NVFUNC(0x4801, NvHostHost1xChannel, SetNvmapFd)
+        )
+    };
+
+    /**
+     * @brief NvHostNvdec (/dev/nvhost-nvdec) is the channel of the NVDEC video decoder
+     */
+    class NvHostNvdec : public NvHostHost1xChannel {
+      public:
+        NvHostNvdec(const DeviceState &state);
+    };
+
+    /**
+     * @brief NvHostVic (/dev/nvhost-vic) is the channel of the VIC video image compositor
+     */
+    class NvHostVic : public NvHostHost1xChannel {
+      public:
+        NvHostVic(const DeviceState &state);
+    };
+}
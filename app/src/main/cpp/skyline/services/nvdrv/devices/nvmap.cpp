@@ -9,14 +9,32 @@ namespace skyline::service::nvdrv::device {
 
     NvMap::NvMap(const DeviceState &state) : NvDevice(state) {}
 
+    std::shared_ptr<NvMap::NvMapObject> NvMap::GetObject(KHandle handle) {
+        std::shared_lock lock(mutex);
+        // Handles are offset by 1 so that a handle of 0 is always invalid
+        if (handle == 0 || handle > objects.size())
+            return nullptr;
+        return objects[handle - 1];
+    }
+
     NvStatus NvMap::Create(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
         struct Data {
             u32 size;   // In
             u32 handle; // Out
         } &data = util::As<Data>(buffer);
 
-        handleTable[handleIndex] = std::make_shared<NvMapObject>(idIndex++, data.size);
-        data.handle = handleIndex++;
+        std::unique_lock lock(mutex);
+        u32 index;
+        if (freeIndices.empty()) {
+            index = static_cast<u32>(objects.size());
+            objects.emplace_back();
+        } else {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+
+        data.handle = index + 1;
+        objects[index] = std::make_shared<NvMapObject>(data.handle, data.size);
 
         state.logger->Debug("Size: 0x{:X} -> Handle: 0x{:X}", data.size, data.handle);
         return NvStatus::Success;
@@ -28,12 +46,10 @@ namespace skyline::service::nvdrv::device {
             u32 handle; // Out
         } &data = util::As<Data>(buffer);
 
-        for (const auto &object : handleTable) {
-            if (object.second->id == data.id) {
-                data.handle = object.first;
-                state.logger->Debug("ID: 0x{:X} -> Handle: 0x{:X}", data.id, data.handle);
-                return NvStatus::Success;
-            }
+        if (GetObject(data.id)) {
+            data.handle = data.id;
+            state.logger->Debug("ID: 0x{:X} -> Handle: 0x{:X}", data.id, data.handle);
+            return NvStatus::Success;
         }
 
         state.logger->Warn("Handle not found for ID: 0x{:X}", data.id);
@@ -51,21 +67,21 @@ namespace skyline::service::nvdrv::device {
             u64 address;  // InOut
         } &data = util::As<Data>(buffer);
 
-        try {
-            auto &object = handleTable.at(data.handle);
-            object->heapMask = data.heapMask;
-            object->flags = data.flags;
-            object->align = data.align;
-            object->kind = data.kind;
-            object->address = data.address;
-            object->status = NvMapObject::Status::Allocated;
-
-            state.logger->Debug("Handle: 0x{:X}, HeapMask: 0x{:X}, Flags: {}, Align: 0x{:X}, Kind: {}, Address: 0x{:X}", data.handle, data.heapMask, data.flags, data.align, data.kind, data.address);
-            return NvStatus::Success;
-        } catch (const std::out_of_range &) {
+        auto object{GetObject(data.handle)};
+        if (!object) {
             state.logger->Warn("Invalid NvMap handle: 0x{:X}", data.handle);
             return NvStatus::BadParameter;
         }
+
+        object->heapMask = data.heapMask;
+        object->flags = data.flags;
+        object->align = data.align;
+        object->kind = data.kind;
+        object->address = data.address;
+        object->status = NvMapObject::Status::Allocated;
+
+        state.logger->Debug("Handle: 0x{:X}, HeapMask: 0x{:X}, Flags: {}, Align: 0x{:X}, Kind: {}, Address: 0x{:X}", data.handle, data.heapMask, data.flags, data.align, data.kind, data.address);
+        return NvStatus::Success;
     }
 
     NvStatus NvMap::Free(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
@@ -77,25 +93,31 @@ namespace skyline::service::nvdrv::device {
             u32 flags;    // Out
         } &data = util::As<Data>(buffer);
 
-        try {
-            const auto &object = handleTable.at(data.handle);
-            if (object.use_count() > 1) {
-                data.address = static_cast<u32>(object->address);
-                data.flags = 0x0;
-            } else {
-                data.address = 0x0;
-                data.flags = 0x1; // Not free yet
+        std::shared_ptr<NvMapObject> object;
+        {
+            std::unique_lock lock(mutex);
+            if (data.handle == 0 || data.handle > objects.size() || !objects[data.handle - 1]) {
+                state.logger->Warn("Invalid NvMap handle: 0x{:X}", data.handle);
+                return NvStatus::BadParameter;
             }
 
-            data.size = object->size;
-            handleTable.erase(data.handle);
+            object = std::move(objects[data.handle - 1]);
+            freeIndices.push_back(data.handle - 1);
+        }
 
-            state.logger->Debug("Handle: 0x{:X} -> Address: 0x{:X}, Size: 0x{:X}, Flags: 0x{:X}", data.handle, data.address, data.size, data.flags);
-            return NvStatus::Success;
-        } catch (const std::out_of_range &) {
-            state.logger->Warn("Invalid NvMap handle: 0x{:X}", data.handle);
-            return NvStatus::BadParameter;
+        // GPU mappings only hold weak references to objects, so the object is only referenced elsewhere while another ioctl is using it
+        if (object.use_count() > 1) {
+            data.address = static_cast<u32>(object->address);
+            data.flags = 0x0;
+        } else {
+            data.address = 0x0;
+            data.flags = 0x1; // Not free yet
         }
+
+        data.size = object->size;
+
+        state.logger->Debug("Handle: 0x{:X} -> Address: 0x{:X}, Size: 0x{:X}, Flags: 0x{:X}", data.handle, data.address, data.size, data.flags);
+        return NvStatus::Success;
     }
 
     NvStatus NvMap::Param(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
@@ -106,41 +128,40 @@ namespace skyline::service::nvdrv::device {
             u32 result;          // Out
         } &data = util::As<Data>(buffer);
 
-        try {
-            auto &object = handleTable.at(data.handle);
-
-            switch (data.parameter) {
-                case Parameter::Size:
-                    data.result = object->size;
-                    break;
+        auto object{GetObject(data.handle)};
+        if (!object) {
+            state.logger->Warn("Invalid NvMap handle: 0x{:X}", data.handle);
+            return NvStatus::BadParameter;
+        }
 
-                case Parameter::Alignment:
-                    data.result = object->align;
-                    break;
+        switch (data.parameter) {
+            case Parameter::Size:
+                data.result = object->size;
+                break;
 
-                case Parameter::HeapMask:
-                    data.result = object->heapMask;
-                    break;
+            case Parameter::Alignment:
+                data.result = object->align;
+                break;
 
-                case Parameter::Kind:
-                    data.result = object->kind;
-                    break;
+            case Parameter::HeapMask:
+                data.result = object->heapMask;
+                break;
 
-                case Parameter::Compr:
-                    data.result = 0;
-                    break;
+            case Parameter::Kind:
+                data.result = object->kind;
+                break;
 
-                default:
-                    state.logger->Warn("Parameter not implemented: 0x{:X}", data.parameter);
-                    return NvStatus::NotImplemented;
-            }
+            case Parameter::Compr:
+                data.result = 0;
+                break;
 
-            state.logger->Debug("Handle: 0x{:X}, Parameter: {} -> Result: 0x{:X}", data.handle, data.parameter, data.result);
-            return NvStatus::Success;
-        } catch (const std::out_of_range &) {
-            state.logger->Warn("Invalid NvMap handle: 0x{:X}", data.handle);
-            return NvStatus::BadParameter;
+            default:
+                state.logger->Warn("Parameter not implemented: 0x{:X}", data.parameter);
+                return NvStatus::NotImplemented;
         }
+
+        state.logger->Debug("Handle: 0x{:X}, Parameter: {} -> Result: 0x{:X}", data.handle, data.parameter, data.result);
+        return NvStatus::Success;
     }
 
     NvStatus NvMap::GetId(IoctlType type, std::span<u8> buffer, std::span<u8> inlineBuffer) {
@@ -149,13 +170,14 @@ namespace skyline::service::nvdrv::device {
             u32 handle; // In
         } &data = util::As<Data>(buffer);
 
-        try {
-            data.id = handleTable.at(data.handle)->id;
-            state.logger->Debug("Handle: 0x{:X} -> ID: 0x{:X}", data.handle, data.id);
-            return NvStatus::Success;
-        } catch (const std::out_of_range &) {
+        auto object{GetObject(data.handle)};
+        if (!object) {
             state.logger->Warn("Invalid NvMap handle: 0x{:X}", data.handle);
             return NvStatus::BadParameter;
         }
+
+        data.id = object->id;
+        state.logger->Debug("Handle: 0x{:X} -> ID: 0x{:X}", data.handle, data.id);
+        return NvStatus::Success;
     }
 }
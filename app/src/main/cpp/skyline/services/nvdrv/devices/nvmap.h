@@ -35,12 +35,20 @@ namespace skyline::service::nvdrv::device {
             NvMapObject(u32 id, u32 size);
         };
 
-        std::unordered_map<KHandle, std::shared_ptr<NvMapObject>> handleTable; //!< A mapping from a handle to it's corresponding NvMapObject
-        KHandle handleIndex{1}; //!< This is used to keep track of the next handle to allocate
-        u32 idIndex{1}; //!< This is used to keep track of the next ID to allocate
+      private:
+        std::vector<std::shared_ptr<NvMapObject>> objects; //!< A slab of all objects indexed by their handle, the slot of a freed object is null till it's reused
+        std::vector<u32> freeIndices; //!< The indices of slots in the slab that have been freed and can be reused
+        std::shared_mutex mutex; //!< This guards the slab, lookups from other devices only take it shared
 
+      public:
         NvMap(const DeviceState &state);
 
+        /**
+         * @return The object corresponding to the handle, or nullptr if the handle is invalid
+         * @note The ID of an object is the same as its handle, so this can also be used to look up an object by its ID
+         */
+        std::shared_ptr<NvMapObject> GetObject(KHandle handle);
+
         /**
          * @brief This creates an NvMapObject and returns an handle to it (https://switchbrew.org/wiki/NV_services#NVMAP_IOC_CREATE)
          */
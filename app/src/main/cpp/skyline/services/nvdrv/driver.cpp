@@ -6,6 +6,7 @@
 #include "devices/nvhost_ctrl_gpu.h"
 #include "devices/nvmap.h"
 #include "devices/nvhost_channel.h"
+#include "devices/nvhost_host1x_channel.h"
 #include "devices/nvhost_as_gpu.h"
 
 namespace skyline::service::nvdrv {
@@ -38,23 +39,17 @@ namespace skyline::service::nvdrv {
     }
 
     std::shared_ptr<device::NvDevice> Driver::GetDevice(u32 fd) {
-        try {
-            auto item = devices.at(fd);
-            if (!item)
-                throw exception("GetDevice was called with a closed file descriptor: 0x{:X}", fd);
-            return item;
-        } catch (std::out_of_range) {
-            throw exception("GetDevice was called with invalid file descriptor: 0x{:X}", fd);
-        }
+        if (fd >= devices.size())
+            return nullptr;
+        return devices[fd];
     }
 
     void Driver::CloseDevice(u32 fd) {
-        try {
-            auto &device = devices.at(fd);
-            device.reset();
-        } catch (const std::out_of_range &) {
+        if (fd >= devices.size() || !devices[fd]) {
             state.logger->Warn("Trying to close non-existent FD");
+            return;
         }
+        devices[fd].reset();
     }
 
     std::weak_ptr<Driver> driver{};
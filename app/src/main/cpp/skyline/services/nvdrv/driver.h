@@ -8,8 +8,8 @@
 #define NVDEVICE_LIST                                              \
     NVDEVICE(NvHostCtrl,    nvHostCtrl,    "/dev/nvhost-ctrl")     \
     NVDEVICE(NvHostChannel, nvHostGpu,     "/dev/nvhost-gpu")      \
-    NVDEVICE(NvHostChannel, nvHostNvdec,   "/dev/nvhost-nvdec")    \
-    NVDEVICE(NvHostChannel, nvHostVic,     "/dev/nvhost-vic")      \
+    NVDEVICE(NvHostNvdec,   nvHostNvdec,   "/dev/nvhost-nvdec")    \
+    NVDEVICE(NvHostVic,     nvHostVic,     "/dev/nvhost-vic")      \
     NVDEVICE(NvMap,         nvMap,         "/dev/nvmap")           \
     NVDEVICE(NvHostAsGpu,   nvHostAsGpu,   "/dev/nvhost-as-gpu")   \
     NVDEVICE(NvHostCtrlGpu, nvHostCtrlGpu, "/dev/nvhost-ctrl-gpu")
@@ -51,7 +51,7 @@ namespace skyline::service::nvdrv {
         /**
          * @brief Returns a particular device with a specific FD
          * @param fd The file descriptor to retrieve
-         * @return A shared pointer to the device
+         * @return A shared pointer to the device, this is null if the FD is invalid or has been closed
          */
         std::shared_ptr<device::NvDevice> GetDevice(u32 fd);
 
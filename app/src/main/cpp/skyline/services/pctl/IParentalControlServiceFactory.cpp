@@ -5,10 +5,7 @@
 #include "IParentalControlServiceFactory.h"
 
 namespace skyline::service::pctl {
-    IParentalControlServiceFactory::IParentalControlServiceFactory(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(IParentalControlServiceFactory::CreateService)},
-        {0x1, SFUNC(IParentalControlServiceFactory::CreateService)}
-    }) {}
+    IParentalControlServiceFactory::IParentalControlServiceFactory(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IParentalControlServiceFactory::CreateService(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         manager.RegisterService(SRVREG(IParentalControlService), session, response);
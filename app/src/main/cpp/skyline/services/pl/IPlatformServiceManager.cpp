@@ -21,7 +21,7 @@ namespace skyline::service::pl {
     };
 
     std::array<FontEntry, 6> fontTable = {{
-                                              {FontChineseSimplified, FontExtendedChineseSimplifiedLength},
+                                              {FontChineseSimplified, FontChineseSimplifiedLength},
                                               {FontChineseTraditional, FontChineseTraditionalLength},
                                               {FontExtendedChineseSimplified, FontExtendedChineseSimplifiedLength},
                                               {FontKorean, FontKoreanLength},
@@ -29,24 +29,28 @@ namespace skyline::service::pl {
                                               {FontStandard, FontStandardLength}
                                           }};
 
-    IPlatformServiceManager::IPlatformServiceManager(const DeviceState &state, ServiceManager &manager) : fontSharedMem(std::make_shared<kernel::type::KSharedMemory>(state, NULL, constant::FontSharedMemSize, memory::Permission{true, false, false})), BaseService(state, manager, {
-        {0x1, SFUNC(IPlatformServiceManager::GetLoadState)},
-        {0x2, SFUNC(IPlatformServiceManager::GetSize)},
-        {0x3, SFUNC(IPlatformServiceManager::GetSharedMemoryAddressOffset)},
-        {0x4, SFUNC(IPlatformServiceManager::GetSharedMemoryNativeHandle)}
-    }) {
+    constexpr u32 SharedFontHeaderSize = sizeof(u32) * 2; //!< The size of the header preceding every font in the shared font data, this is the magic followed by the encrypted size
+
+    IPlatformServiceManager::IPlatformServiceManager(const DeviceState &state, ServiceManager &manager) : fontSharedMem(std::make_shared<kernel::type::KSharedMemory>(state, NULL, constant::FontSharedMemSize, memory::Permission{true, false, false})), BaseService(state, manager) {
+        // The layout of the shared memory only depends on the lengths of the fonts, so it's computed upfront while the fonts are only copied in once the guest maps the shared memory
+        size_t offset{};
+        for (auto &font : fontTable) {
+            offset += SharedFontHeaderSize;
+            font.offset = offset;
+            offset += font.length;
+        }
+    }
+
+    void IPlatformServiceManager::LoadFonts() {
         constexpr u32 SharedFontResult = 0x7F9A0218; //!< This is the decrypted magic for a single font in the shared font data
         constexpr u32 SharedFontMagic = 0x36F81A1E; //!< This is the encrypted magic for a single font in the shared font data
         constexpr u32 SharedFontKey = SharedFontMagic ^SharedFontResult; //!< This is the XOR key for encrypting the font size
 
-        auto pointer = reinterpret_cast<u32 *>(fontSharedMem->kernel.address);
-        for (auto &font : fontTable) {
+        for (const auto &font : fontTable) {
+            auto pointer = reinterpret_cast<u32 *>(fontSharedMem->kernel.address + font.offset - SharedFontHeaderSize);
             *pointer++ = SharedFontResult;
             *pointer++ = font.length ^ SharedFontKey;
-            font.offset = reinterpret_cast<u64>(pointer) - fontSharedMem->kernel.address;
-
             memcpy(pointer, font.data, font.length);
-            pointer = reinterpret_cast<u32 *>(reinterpret_cast<u64>(pointer) + font.length);
         }
     }
 
@@ -72,6 +76,8 @@ namespace skyline::service::pl {
     }
 
     Result IPlatformServiceManager::GetSharedMemoryNativeHandle(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        std::call_once(fontLoad, &IPlatformServiceManager::LoadFonts, this);
+
         auto handle = state.process->InsertItem<type::KSharedMemory>(fontSharedMem);
         response.copyHandles.push_back(handle);
         return {};
@@ -18,6 +18,12 @@ namespace skyline {
         class IPlatformServiceManager : public BaseService {
           private:
             std::shared_ptr<kernel::type::KSharedMemory> fontSharedMem; //!< This shared memory stores the TTF data of all shared fonts
+            std::once_flag fontLoad; //!< This is used to copy the fonts into fontSharedMem once, when the shared memory is first requested
+
+            /**
+             * @brief Copies every font alongside its header into fontSharedMem, the pages of the shared memory aren't backed by memory till this is done
+             */
+            void LoadFonts();
 
           public:
             IPlatformServiceManager(const DeviceState &state, ServiceManager &manager);
@@ -41,6 +47,13 @@ namespace skyline {
              * @brief This returns a handle to the whole font shared memory (https://switchbrew.org/wiki/Shared_Database_services#GetSharedMemoryNativeHandle)
              */
             Result GetSharedMemoryNativeHandle(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            SERVICE_DECL(
+                SFUNC(0x1, IPlatformServiceManager, GetLoadState),
+                SFUNC(0x2, IPlatformServiceManager, GetSize),
+                SFUNC(0x3, IPlatformServiceManager, GetSharedMemoryAddressOffset),
+                SFUNC(0x4, IPlatformServiceManager, GetSharedMemoryNativeHandle)
+            )
         };
     }
 }
@@ -4,9 +4,7 @@
 #include "IPrepoService.h"
 
 namespace skyline::service::prepo {
-    IPrepoService::IPrepoService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x2775, SFUNC(IPrepoService::SaveReportWithUser)},
-    }) {}
+    IPrepoService::IPrepoService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IPrepoService::SaveReportWithUser(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         return {};
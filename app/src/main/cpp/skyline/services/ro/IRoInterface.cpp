@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <os.h>
+#include <kernel/types/KProcess.h>
+#include <loader/nro.h>
+#include <footprint.h>
+#include "IRoInterface.h"
+
+namespace skyline::service::ro {
+    namespace {
+        /**
+         * @brief A backing over a region of guest memory, this is used to load an NRO from the memory the application has read it into
+         */
+        class GuestBacking : public vfs::Backing {
+          private:
+            const DeviceState &state;
+            u64 address; //!< The address of the region in guest memory
+
+          public:
+            GuestBacking(const DeviceState &state, u64 address, size_t size) : Backing({true, false, false}, size), state(state), address(address) {}
+
+            size_t Read(u8 *output, size_t offset, size_t size) {
+                size = std::min(offset + size, this->size) - offset;
+                state.process->ReadMemory(output, address + offset, size);
+                return size;
+            }
+
+            std::span<const u8> GetSpan(size_t offset, size_t size) {
+                if (offset + size > this->size)
+                    return {};
+                return state.process->GetSpan<const u8>(address + offset, size);
+            }
+        };
+    }
+
+    IRoInterface::IRoInterface(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
+
+    u64 IRoInterface::FindModuleAddress(size_t size) {
+        auto &memory{state.os->memory};
+        if (!nextAddress)
+            for (const auto &region : {memory.code, memory.alias, memory.heap, memory.stack, memory.tlsIo})
+                nextAddress = std::max(nextAddress, util::AlignUp(region.address + region.size, constant::HugePageSize));
+
+        // Memory which the kernel picked the address of might be past all regions, modules are placed after any of it
+        while (auto descriptor{memory.Get(nextAddress)})
+            nextAddress = util::AlignUp(descriptor->chunk.address + descriptor->chunk.size, constant::HugePageSize);
+
+        if (nextAddress + size > memory.base.address + memory.base.size)
+            return 0;
+        return nextAddress;
+    }
+
+    Result IRoInterface::MapManualLoadModuleMemory(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        request.Skip<u64>(); // The PID placeholder
+        auto nroAddress{request.Pop<u64>()};
+        auto nroSize{request.Pop<u64>()};
+        auto bssAddress{request.Pop<u64>()};
+        auto bssSize{request.Pop<u64>()};
+
+        if (!util::PageAligned(nroAddress) || !util::PageAligned(bssAddress))
+            return result::InvalidAddress;
+        if (!nroSize || !util::PageAligned(nroSize) || !util::PageAligned(bssSize))
+            return result::InvalidSize;
+
+        auto header{state.process->GetObject<loader::NroLoader::NroHeader>(nroAddress)};
+        if (header.magic != util::MakeMagic<u32>("NRO0") || header.size > nroSize || util::AlignUp(header.bssSize, PAGE_SIZE) > bssSize)
+            return result::InvalidNro;
+
+        std::array<u8, 0x20> buildId;
+        std::memcpy(buildId.data(), header.buildId, buildId.size());
+
+        std::lock_guard lock(mutex);
+        for (const auto &[base, module] : modules)
+            if (module.buildId == buildId)
+                return result::AlreadyLoaded;
+
+        auto address{FindModuleAddress(nroSize + bssSize)};
+        if (!address)
+            return result::OutOfAddressSpace;
+
+        // The segments are read straight out of the application's copy of the NRO, its memory stays accessible to it unlike on HOS
+        auto backing{std::make_shared<GuestBacking>(state, nroAddress, header.size)};
+        auto getSegment{[&](const loader::NroLoader::NroSegmentHeader &segment) {
+            return loader::Executable::Segment{
+                .backing = backing,
+                .fileOffset = segment.offset,
+                .fileSize = segment.size,
+                .size = segment.size,
+                .offset = segment.offset,
+            };
+        }};
+
+        loader::Executable executable{};
+        executable.text = getSegment(header.text);
+        executable.ro = getSegment(header.ro);
+        executable.data = getSegment(header.data);
+        executable.bssSize = bssSize;
+        executable.buildId = buildId;
+        executable.dynstr = {header.dynstr.offset, header.dynstr.size};
+        executable.dynsym = {header.dynsym.offset, header.dynsym.size};
+
+        executable.name = "nro_";
+        for (auto byte : std::span(buildId).first(8))
+            executable.name += fmt::format("{:02X}", byte);
+
+        // The code is patched by the same parallel patcher as executables loaded at boot, the patch cache is keyed by the build ID so a module is only patched once
+        auto loadInfo{loader::Loader::LoadExecutable(state.process, state, executable, address - constant::BaseAddress)};
+        nextAddress = util::AlignUp(loadInfo.base + loadInfo.size, constant::HugePageSize);
+        modules.emplace(loadInfo.base, LoadedModule{loadInfo.size, buildId});
+
+        state.logger->Info("Loaded module '{}' at 0x{:X} (Size: 0x{:X})", executable.name, loadInfo.base, loadInfo.size);
+        response.Push<u64>(loadInfo.base);
+        return {};
+    }
+
+    Result IRoInterface::UnmapManualLoadModuleMemory(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        request.Skip<u64>(); // The PID placeholder
+        auto address{request.Pop<u64>()};
+
+        std::lock_guard lock(mutex);
+        auto module{modules.find(address)};
+        if (module == modules.end())
+            return result::NotLoaded;
+
+        // Every section of the module is its own memory object, they're all destroyed to unmap it in the guest
+        for (u64 offset{}; offset < module->second.size;) {
+            auto object{state.process->GetMemoryObject(address + offset)};
+            if (!object || object->item->objectType != type::KType::KPrivateMemory)
+                throw exception("ldr:ro module at 0x{:X} has no memory object at 0x{:X}", address, address + offset);
+
+            offset += std::static_pointer_cast<type::KPrivateMemory>(object->item)->size;
+            state.process->DeleteHandle(object->handle);
+        }
+
+        auto &loaded{state.loader->modules};
+        auto loadedModule{std::find_if(loaded.begin(), loaded.end(), [address](const loader::Module &loadedModule) { return loadedModule.base == address; })};
+        if (loadedModule != loaded.end()) {
+            footprint::Remove(footprint::Subsystem::Patch, loadedModule->size - loadedModule->patchOffset);
+            loaded.erase(loadedModule);
+        }
+
+        state.logger->Info("Unloaded module at 0x{:X}", address);
+        modules.erase(module);
+        return {};
+    }
+
+    Result IRoInterface::RegisterModuleInfo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        request.Skip<u64>(); // The PID placeholder
+        auto nrrAddress{request.Pop<u64>()};
+        auto nrrSize{request.Pop<u64>()};
+
+        state.logger->Debug("Registering NRR at 0x{:X} (Size: 0x{:X})", nrrAddress, nrrSize);
+        return {};
+    }
+
+    Result IRoInterface::UnregisterModuleInfo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return {};
+    }
+
+    Result IRoInterface::RegisterProcessHandle(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return {};
+    }
+
+    Result IRoInterface::RegisterProcessModuleInfo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return RegisterModuleInfo(session, request, response);
+    }
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <services/base_service.h>
+#include <services/serviceman.h>
+
+namespace skyline::service::ro {
+    namespace result {
+        constexpr Result OutOfAddressSpace(22, 2);
+        constexpr Result AlreadyLoaded(22, 3);
+        constexpr Result InvalidNro(22, 4);
+        constexpr Result InvalidAddress(22, 1025);
+        constexpr Result InvalidSize(22, 1026);
+        constexpr Result NotLoaded(22, 1028);
+    }
+
+    /**
+     * @brief IRoInterface is used by applications to load NROs at runtime (https://switchbrew.org/wiki/RO_services#LoadModule)
+     * @note The NRO is copied out of the memory supplied by the application into code memory and patched like executables loaded at boot, NRRs aren't validated as code signatures aren't enforced
+     */
+    class IRoInterface : public BaseService {
+      private:
+        /**
+         * @brief An NRO that has been loaded by this service
+         */
+        struct LoadedModule {
+            u64 size; //!< The total size of the module including its patch section
+            std::array<u8, 0x20> buildId; //!< The build ID of the NRO, an NRO can only be loaded once at a time
+        };
+        std::unordered_map<u64, LoadedModule> modules; //!< A map from the base address of every loaded module to it
+        std::mutex mutex; //!< This mutex guards modules and nextAddress
+        u64 nextAddress{}; //!< The address after the last loaded module, modules are placed consecutively past all other regions so they never collide with memory the application maps
+
+        /**
+         * @return The address to load a module of at least the supplied size at, or 0 if the address space is exhausted
+         */
+        u64 FindModuleAddress(size_t size);
+
+      public:
+        IRoInterface(const DeviceState &state, ServiceManager &manager);
+
+        /**
+         * @brief This loads an NRO from the memory of the application into code memory (https://switchbrew.org/wiki/RO_services#MapManualLoadModuleMemory)
+         */
+        Result MapManualLoadModuleMemory(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief This unloads an NRO that was loaded by MapManualLoadModuleMemory (https://switchbrew.org/wiki/RO_services#UnmapManualLoadModuleMemory)
+         */
+        Result UnmapManualLoadModuleMemory(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief This registers an NRR which holds the hashes of NROs that are allowed to be loaded (https://switchbrew.org/wiki/RO_services#RegisterModuleInfo)
+         */
+        Result RegisterModuleInfo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief This unregisters an NRR registered by RegisterModuleInfo (https://switchbrew.org/wiki/RO_services#UnregisterModuleInfo)
+         */
+        Result UnregisterModuleInfo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief This registers the process that modules are loaded into (https://switchbrew.org/wiki/RO_services#RegisterProcessHandle)
+         */
+        Result RegisterProcessHandle(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief This registers an NRR along with the process it applies to (https://switchbrew.org/wiki/RO_services#RegisterProcessModuleInfo)
+         */
+        Result RegisterProcessModuleInfo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, IRoInterface, MapManualLoadModuleMemory),
+            SFUNC(0x1, IRoInterface, UnmapManualLoadModuleMemory),
+            SFUNC(0x2, IRoInterface, RegisterModuleInfo),
+            SFUNC(0x3, IRoInterface, UnregisterModuleInfo),
+            SFUNC(0x4, IRoInterface, RegisterProcessHandle),
+            SFUNC(0xA, IRoInterface, RegisterProcessModuleInfo)
+        )
+    };
+}
@@ -2,6 +2,8 @@
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
 #include <kernel/types/KProcess.h>
+#include <kernel/results.h>
+#include <boot_report.h>
 #include "sm/IUserInterface.h"
 #include "settings/ISettingsServer.h"
 #include "settings/ISystemSettingsServer.h"
@@ -10,6 +12,7 @@
 #include "am/IAllSystemAppletProxiesService.h"
 #include "audio/IAudioOutManager.h"
 #include "audio/IAudioRendererManager.h"
+#include "codec/IHardwareOpusDecoderManager.h"
 #include "fatalsrv/IService.h"
 #include "hid/IHidServer.h"
 #include "timesrv/IStaticService.h"
@@ -27,23 +30,19 @@
 #include "socket/bsd/IClient.h"
 #include "ssl/ISslService.h"
 #include "prepo/IPrepoService.h"
+#include "ro/IRoInterface.h"
 #include "serviceman.h"
 
 #define SERVICE_CASE(class, name) \
-    case util::MakeMagic<ServiceName>(name): { \
-            std::shared_ptr<BaseService> serviceObject = std::make_shared<class>(state, *this); \
-            serviceMap[util::MakeMagic<ServiceName>(name)] = serviceObject; \
-            return serviceObject; \
-        }
+    case util::MakeMagic<ServiceName>(name): \
+        return std::make_shared<class>(state, *this);
 
 namespace skyline::service {
-    ServiceManager::ServiceManager(const DeviceState &state) : state(state), smUserInterface(std::make_shared<sm::IUserInterface>(state, *this)) {}
+    constexpr std::array<std::string_view, 5> PrewarmedServices{"hid", "audren:u", "nvdrv", "vi:m", "fsp-srv"}; //!< The services that practically every title opens during startup, these are constructed ahead of time
 
-    std::shared_ptr<BaseService> ServiceManager::CreateService(ServiceName name) {
-        auto serviceIter = serviceMap.find(name);
-        if (serviceIter != serviceMap.end())
-            return (*serviceIter).second;
+    ServiceManager::ServiceManager(const DeviceState &state) : state(state), smUserInterface(std::make_shared<sm::IUserInterface>(state, *this)) {}
 
+    std::shared_ptr<BaseService> ServiceManager::ConstructService(ServiceName name) {
         switch (name) {
             SERVICE_CASE(fatalsrv::IService, "fatal:u")
             SERVICE_CASE(settings::ISettingsServer, "set")
@@ -53,6 +52,7 @@ namespace skyline::service {
             SERVICE_CASE(am::IAllSystemAppletProxiesService, "appletAE")
             SERVICE_CASE(audio::IAudioOutManager, "audout:u")
             SERVICE_CASE(audio::IAudioRendererManager, "audren:u")
+            SERVICE_CASE(codec::IHardwareOpusDecoderManager, "hwopus")
             SERVICE_CASE(hid::IHidServer, "hid")
             SERVICE_CASE(timesrv::IStaticService, "time:s")
             SERVICE_CASE(timesrv::IStaticService, "time:a")
@@ -79,24 +79,73 @@ namespace skyline::service {
             SERVICE_CASE(socket::IClient, "bsd:u")
             SERVICE_CASE(ssl::ISslService, "ssl")
             SERVICE_CASE(prepo::IPrepoService, "prepo:u")
+            SERVICE_CASE(ro::IRoInterface, "ldr:ro")
+            SERVICE_CASE(ro::IRoInterface, "ro:1")
             default:
-                throw exception("CreateService called with an unknown service name: {}", name);
+                return nullptr;
         }
     }
 
+    void ServiceManager::PrewarmServices() {
+        std::lock_guard serviceGuard(mutex);
+        if (prewarm.valid())
+            return;
+
+        prewarm = std::async(std::launch::async, [this]() {
+            boot::ScopedPhase phase(boot::Phase::ServicePrewarm);
+            std::unordered_map<ServiceName, std::shared_ptr<BaseService>> services;
+            for (auto name : PrewarmedServices) {
+                auto serviceName{util::MakeMagic<ServiceName>(name)};
+                services[serviceName] = ConstructService(serviceName);
+            }
+            return services;
+        });
+    }
+
+    std::shared_ptr<BaseService> ServiceManager::CreateService(ServiceName name) {
+        auto serviceIter = serviceMap.find(name);
+        if (serviceIter != serviceMap.end())
+            return (*serviceIter).second;
+
+        // Any service construction waits for the pre-warm to complete as services can share global state (such as the nvdrv driver) with the ones being pre-warmed
+        if (prewarm.valid()) {
+            try {
+                warmServices = prewarm.get();
+            } catch (const std::exception &e) {
+                state.logger->Warn("Failed to pre-warm services: {}", e.what());
+            }
+        }
+
+        std::shared_ptr<BaseService> serviceObject;
+        auto warmIter = warmServices.find(name);
+        if (warmIter != warmServices.end()) {
+            serviceObject = std::move(warmIter->second);
+            warmServices.erase(warmIter);
+        } else {
+            serviceObject = ConstructService(name);
+            if (!serviceObject)
+                return nullptr;
+        }
+
+        serviceMap[name] = serviceObject;
+        return serviceObject;
+    }
+
     std::shared_ptr<BaseService> ServiceManager::NewService(ServiceName name, type::KSession &session, ipc::IpcResponse &response) {
         std::lock_guard serviceGuard(mutex);
         auto serviceObject = CreateService(name);
+        if (!serviceObject)
+            return nullptr;
+
         KHandle handle{};
         if (session.isDomain) {
-            session.domainTable[++session.handleIndex] = serviceObject;
-            response.domainObjects.push_back(session.handleIndex);
-            handle = session.handleIndex;
+            handle = session.AddDomainObject(serviceObject);
+            response.domainObjects.push_back(handle);
         } else {
             handle = state.process->NewHandle<type::KSession>(serviceObject).handle;
             response.moveHandles.push_back(handle);
         }
-        state.logger->Debug("Service has been created: \"{}\" (0x{:X})", serviceObject->GetName(), handle);
+        LOGD(state.logger, "Service has been created: \"{}\" (0x{:X})", serviceObject->GetName(), handle);
         return serviceObject;
     }
 
@@ -105,26 +154,26 @@ namespace skyline::service {
         KHandle handle{};
 
         if (session.isDomain) {
-            session.domainTable[session.handleIndex] = serviceObject;
-            response.domainObjects.push_back(session.handleIndex);
-            handle = session.handleIndex++;
+            handle = session.AddDomainObject(serviceObject);
+            response.domainObjects.push_back(handle);
         } else {
             handle = state.process->NewHandle<type::KSession>(serviceObject).handle;
             response.moveHandles.push_back(handle);
         }
 
-        state.logger->Debug("Service has been registered: \"{}\" (0x{:X})", serviceObject->GetName(), handle);
+        LOGD(state.logger, "Service has been registered: \"{}\" (0x{:X})", serviceObject->GetName(), handle);
     }
 
     void ServiceManager::CloseSession(KHandle handle) {
         std::lock_guard serviceGuard(mutex);
-        auto session = state.process->GetHandle<type::KSession>(handle);
+        auto session = state.process->GetHandle<type::KSession>(handle); // This is called from svcSendSyncRequest which doesn't borrow handles
         if (session->serviceStatus == type::KSession::ServiceStatus::Open) {
             if (session->isDomain) {
-                for (const auto &domainEntry : session->domainTable)
-                    std::erase_if(serviceMap, [domainEntry](const auto &entry) {
-                        return entry.second == domainEntry.second;
-                    });
+                for (const auto &object : session->domainTable)
+                    if (object)
+                        std::erase_if(serviceMap, [&object](const auto &entry) {
+                            return entry.second == object;
+                        });
             } else {
                 std::erase_if(serviceMap, [session](const auto &entry) {
                     return entry.second == session->serviceObject;
@@ -134,34 +183,42 @@ namespace skyline::service {
         }
     }
 
-    void ServiceManager::SyncRequestHandler(KHandle handle) {
-        auto session = state.process->GetHandle<type::KSession>(handle);
-        state.logger->Debug("----Start----");
-        state.logger->Debug("Handle is 0x{:X}", handle);
+    Result ServiceManager::SyncRequestHandler(KHandle handle) {
+        auto session = state.process->TryGetHandle<type::KSession>(handle); // The session is referenced as services can block for an unbounded amount of time, a borrow would hold back the destruction of every closed object till they return
+        if (!session) {
+            state.logger->Warn("svcSendSyncRequest called on invalid handle: 0x{:X}", handle);
+            return kernel::result::InvalidHandle;
+        }
+
+        LOGD(state.logger, "----Start----");
+        LOGD(state.logger, "Handle is 0x{:X}", handle);
 
+        std::unique_lock sessionGuard(session->mutex);
         if (session->serviceStatus == type::KSession::ServiceStatus::Open) {
-            ipc::IpcRequest request(session->isDomain, state);
+            ipc::IpcRequest request(session->isDomain, state, &session->layoutCache);
             ipc::IpcResponse response(state);
+            TRACE("IPC request on handle 0x{:X}: Type: {}, Command ID: 0x{:X}", handle, request.header->type, request.payload->value);
 
             switch (request.header->type) {
                 case ipc::CommandType::Request:
                 case ipc::CommandType::RequestWithContext:
                     if (session->isDomain) {
-                        try {
-                            auto service = session->domainTable.at(request.domain->objectId);
-                            switch (static_cast<ipc::DomainCommand>(request.domain->command)) {
-                                case ipc::DomainCommand::SendMessage:
-                                    response.errorCode = service->HandleRequest(*session, request, response);
-                                    break;
-                                case ipc::DomainCommand::CloseVHandle:
-                                    std::erase_if(serviceMap, [service](const auto &entry) {
-                                        return entry.second == service;
-                                    });
-                                    session->domainTable.erase(request.domain->objectId);
-                                    break;
-                            }
-                        } catch (std::out_of_range &) {
+                        auto service{session->GetDomainObject(request.domain->objectId)};
+                        if (!service)
                             throw exception("Invalid object ID was used with domain request");
+
+                        switch (static_cast<ipc::DomainCommand>(request.domain->command)) {
+                            case ipc::DomainCommand::SendMessage:
+                                response.errorCode = service->HandleRequest(*session, request, response);
+                                break;
+                            case ipc::DomainCommand::CloseVHandle: {
+                                std::lock_guard serviceGuard(mutex);
+                                std::erase_if(serviceMap, [service](const auto &entry) {
+                                    return entry.second.get() == service;
+                                });
+                                session->RemoveDomainObject(request.domain->objectId);
+                                break;
+                            }
                         }
                     } else {
                         response.errorCode = session->serviceObject->HandleRequest(*session, request, response);
@@ -170,15 +227,16 @@ namespace skyline::service {
                     break;
                 case ipc::CommandType::Control:
                 case ipc::CommandType::ControlWithContext:
-                    state.logger->Debug("Control IPC Message: 0x{:X}", request.payload->value);
+                    LOGD(state.logger, "Control IPC Message: 0x{:X}", request.payload->value);
                     switch (static_cast<ipc::ControlCommand>(request.payload->value)) {
                         case ipc::ControlCommand::ConvertCurrentObjectToDomain:
                             response.Push(session->ConvertDomain());
                             break;
                         case ipc::ControlCommand::CloneCurrentObject:
-                        case ipc::ControlCommand::CloneCurrentObjectEx:
+                        case ipc::ControlCommand::CloneCurrentObjectEx: {
                             response.moveHandles.push_back(state.process->InsertItem(session));
                             break;
+                        }
                         case ipc::ControlCommand::QueryPointerBufferSize:
                             response.Push<u32>(0x1000);
                             break;
@@ -188,7 +246,8 @@ namespace skyline::service {
                     response.WriteResponse(false);
                     break;
                 case ipc::CommandType::Close:
-                    state.logger->Debug("Closing Session");
+                    LOGD(state.logger, "Closing Session");
+                    sessionGuard.unlock();
                     CloseSession(handle);
                     break;
                 default:
@@ -197,6 +256,7 @@ namespace skyline::service {
         } else {
             state.logger->Warn("svcSendSyncRequest called on closed handle: 0x{:X}", handle);
         }
-        state.logger->Debug("====End====");
+        LOGD(state.logger, "====End====");
+        return {};
     }
 }
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <future>
 #include <kernel/types/KSession.h>
 #include <nce.h>
 #include "base_service.h"
@@ -16,12 +17,21 @@ namespace skyline::service {
       private:
         const DeviceState &state; //!< The state of the device
         std::unordered_map<ServiceName, std::shared_ptr<BaseService>> serviceMap; //!< A mapping from a Service to the underlying object
+        std::unordered_map<ServiceName, std::shared_ptr<BaseService>> warmServices; //!< Services which were constructed ahead of time and haven't been requested yet
         Mutex mutex; //!< This mutex is used to ensure concurrent access to services doesn't cause crashes
+        std::future<std::unordered_map<ServiceName, std::shared_ptr<BaseService>>> prewarm; //!< The construction of the pre-warmed services, this is declared after the members it uses so it's joined before they're destroyed
+
+        /**
+         * @brief Constructs a new instance of a service without registering it
+         * @param name The name of the service to construct
+         * @return A shared pointer to the service, this is null if the service isn't implemented
+         */
+        std::shared_ptr<BaseService> ConstructService(ServiceName name);
 
         /**
          * @brief Creates an instance of the service if it doesn't already exist, otherwise returns an existing instance
          * @param name The name of the service to create
-         * @return A shared pointer to an instance of the service
+         * @return A shared pointer to an instance of the service, this is null if the service isn't implemented
          */
         std::shared_ptr<BaseService> CreateService(ServiceName name);
 
@@ -33,11 +43,18 @@ namespace skyline::service {
          */
         ServiceManager(const DeviceState &state);
 
+        /**
+         * @brief Starts constructing the services which are opened by practically every title on a background thread, these are handed out by the first request for them
+         * @note This is called while the loader is still loading the process so that the construction of the services overlaps with it
+         */
+        void PrewarmServices();
+
         /**
          * @brief Creates a new service using it's type enum and writes it's handle or virtual handle (If it's a domain request) to IpcResponse
          * @param name The service's name
          * @param session The session object of the command
          * @param response The response object to write the handle or virtual handle to
+         * @return A shared pointer to the service, this is null if the service isn't implemented in which case nothing is written to the response
          */
         std::shared_ptr<BaseService> NewService(ServiceName name, type::KSession &session, ipc::IpcResponse &response);
 
@@ -56,10 +73,15 @@ namespace skyline::service {
          * @tparam The class of the service
          * @return A shared pointer to an instance of the service
          * @note This only works for services created with `NewService` as sub-interfaces used with `RegisterService` can have multiple instances
+         * @note An exception is thrown if the guest hasn't opened the service
          */
         template<typename Type>
         std::shared_ptr<Type> GetService(ServiceName name) {
-            return std::static_pointer_cast<Type>(serviceMap.at(name));
+            std::lock_guard serviceGuard(mutex);
+            auto serviceIter{serviceMap.find(name)};
+            if (serviceIter == serviceMap.end())
+                throw exception("GetService called on a service that hasn't been opened: {}", std::string_view(reinterpret_cast<const char *>(&name), strnlen(reinterpret_cast<const char *>(&name), sizeof(name))));
+            return std::static_pointer_cast<Type>(serviceIter->second);
         }
 
         template<typename Type>
@@ -76,7 +98,8 @@ namespace skyline::service {
         /**
          * @brief Handles a Synchronous IPC Request
          * @param handle The handle of the object
+         * @return The result of svcSendSyncRequest, this is only an error if the handle isn't a session
          */
-        void SyncRequestHandler(KHandle handle);
+        Result SyncRequestHandler(KHandle handle);
     };
 }
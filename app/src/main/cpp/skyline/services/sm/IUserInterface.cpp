@@ -4,10 +4,7 @@
 #include "IUserInterface.h"
 
 namespace skyline::service::sm {
-    IUserInterface::IUserInterface(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(IUserInterface::Initialize)},
-        {0x1, SFUNC(IUserInterface::GetService)}
-    }) {}
+    IUserInterface::IUserInterface(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IUserInterface::Initialize(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         return {};
@@ -19,9 +16,7 @@ namespace skyline::service::sm {
         if (!name)
             return result::InvalidServiceName;
 
-        try {
-            manager.NewService(name, session, response);
-        } catch (std::out_of_range &) {
+        if (!manager.NewService(name, session, response)) {
             std::string_view stringName(reinterpret_cast<char *>(&name), sizeof(u64));
             state.logger->Warn("Service has not been implemented: \"{}\"", stringName);
         }
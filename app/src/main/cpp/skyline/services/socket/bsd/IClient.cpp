@@ -1,13 +1,356 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <kernel/types/KProcess.h>
 #include "IClient.h"
 
+extern bool Halt;
+
 namespace skyline::service::socket {
-    IClient::IClient(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(IClient::RegisterClient)},
-        {0x1, SFUNC(IClient::StartMonitoring)},
-    }) {}
+    namespace {
+        /**
+         * @brief A sockaddr_in as it's laid out on the guest, BSD addresses have an 8-bit length followed by an 8-bit family rather than a 16-bit family
+         */
+        struct GuestSockAddrIn {
+            u8 length;
+            u8 family;
+            u16 port; //!< The port in network byte order
+            u32 address; //!< The IPv4 address in network byte order
+            u8 _pad_[8];
+        };
+        static_assert(sizeof(GuestSockAddrIn) == 0x10);
+
+        /**
+         * @brief The timeval structure as it's laid out on the guest
+         */
+        struct GuestTimeval {
+            i64 seconds;
+            i64 microseconds;
+        };
+
+        constexpr int GuestSolSocket{0xFFFF}; //!< The level of socket options on the guest
+        constexpr int GuestNonBlock{0x4}; //!< O_NONBLOCK on the guest
+        constexpr int GuestSockNonBlock{0x20000000}; //!< SOCK_NONBLOCK on the guest
+        constexpr int GuestSockCloexec{0x10000000}; //!< SOCK_CLOEXEC on the guest
+        constexpr int GuestMsgWaitAll{0x40}; //!< MSG_WAITALL on the guest
+        constexpr int GuestMsgDontWait{0x80}; //!< MSG_DONTWAIT on the guest
+        constexpr int GuestMsgPassthrough{0x7}; //!< MSG_OOB, MSG_PEEK and MSG_DONTROUTE have the same values on the guest and host
+        constexpr int GuestSoReceiveTimeout{0x1006}; //!< SO_RCVTIMEO on the guest
+        constexpr int GuestSoSendTimeout{0x1005}; //!< SO_SNDTIMEO on the guest
+
+        constexpr int GuestEio{5}; //!< EIO on the guest, this is returned for host errors without a guest equivalent
+
+        /**
+         * @return The guest equivalent of a host errno, the guest uses the FreeBSD numbering which only matches Linux below 35 other than for EAGAIN, this is -1 if there's no equivalent
+         */
+        constexpr int ToGuestErrno(int error) {
+            if (error > 0 && error < 35 && error != EAGAIN)
+                return error;
+
+            switch (error) {
+                case EDEADLK:
+                    return 11;
+                case EAGAIN:
+                    return 35;
+                case EINPROGRESS:
+                    return 36;
+                case EALREADY:
+                    return 37;
+                case ENOTSOCK:
+                    return 38;
+                case EDESTADDRREQ:
+                    return 39;
+                case EMSGSIZE:
+                    return 40;
+                case EPROTOTYPE:
+                    return 41;
+                case ENOPROTOOPT:
+                    return 42;
+                case EPROTONOSUPPORT:
+                    return 43;
+                case ESOCKTNOSUPPORT:
+                    return 44;
+                case EOPNOTSUPP:
+                    return 45;
+                case EPFNOSUPPORT:
+                    return 46;
+                case EAFNOSUPPORT:
+                    return 47;
+                case EADDRINUSE:
+                    return 48;
+                case EADDRNOTAVAIL:
+                    return 49;
+                case ENETDOWN:
+                    return 50;
+                case ENETUNREACH:
+                    return 51;
+                case ENETRESET:
+                    return 52;
+                case ECONNABORTED:
+                    return 53;
+                case ECONNRESET:
+                    return 54;
+                case ENOBUFS:
+                    return 55;
+                case EISCONN:
+                    return 56;
+                case ENOTCONN:
+                    return 57;
+                case ESHUTDOWN:
+                    return 58;
+                case ETOOMANYREFS:
+                    return 59;
+                case ETIMEDOUT:
+                    return 60;
+                case ECONNREFUSED:
+                    return 61;
+                case ELOOP:
+                    return 62;
+                case ENAMETOOLONG:
+                    return 63;
+                case EHOSTDOWN:
+                    return 64;
+                case EHOSTUNREACH:
+                    return 65;
+                case ENOTEMPTY:
+                    return 66;
+                case EUSERS:
+                    return 68;
+                case EDQUOT:
+                    return 69;
+                case ESTALE:
+                    return 70;
+                case ENOLCK:
+                    return 77;
+                case ENOSYS:
+                    return 78;
+                case EOVERFLOW:
+                    return 84;
+                case ECANCELED:
+                    return 85;
+                case EILSEQ:
+                    return 86;
+                case EBADMSG:
+                    return 89;
+                case EMULTIHOP:
+                    return 90;
+                case ENOLINK:
+                    return 91;
+                case EPROTO:
+                    return 92;
+                default:
+                    return -1;
+            }
+        }
+
+        /**
+         * @return The host equivalent of a socket-level option of the guest, this is -1 if there's no equivalent
+         */
+        int ToHostSocketOption(int name) {
+            switch (name) {
+                case 0x2:
+                    return SO_ACCEPTCONN;
+                case 0x4:
+                    return SO_REUSEADDR;
+                case 0x8:
+                    return SO_KEEPALIVE;
+                case 0x10:
+                    return SO_DONTROUTE;
+                case 0x20:
+                    return SO_BROADCAST;
+                case 0x80:
+                    return SO_LINGER;
+                case 0x100:
+                    return SO_OOBINLINE;
+                case 0x200:
+                    return SO_REUSEPORT;
+                case 0x1001:
+                    return SO_SNDBUF;
+                case 0x1002:
+                    return SO_RCVBUF;
+                case 0x1003:
+                    return SO_SNDLOWAT;
+                case 0x1004:
+                    return SO_RCVLOWAT;
+                case 0x1007:
+                    return SO_ERROR;
+                case 0x1008:
+                    return SO_TYPE;
+                default:
+                    return -1;
+            }
+        }
+
+        /**
+         * @brief Translates the flags of a transfer from the guest to the host, MSG_DONTWAIT is always set as host sockets never block
+         */
+        int ToHostMessageFlags(int flags) {
+            return (flags & GuestMsgPassthrough) | MSG_DONTWAIT | MSG_NOSIGNAL;
+        }
+
+        /**
+         * @brief Translates a guest address into a host address
+         * @return The size of the host address, this is 0 if the address is invalid or isn't IPv4
+         */
+        socklen_t ToHostAddress(std::span<u8> guest, sockaddr_in &host) {
+            if (guest.size() < sizeof(GuestSockAddrIn))
+                return 0;
+
+            GuestSockAddrIn address;
+            std::memcpy(&address, guest.data(), sizeof(GuestSockAddrIn));
+            if (address.family != AF_INET)
+                return 0;
+
+            host = {
+                .sin_family = AF_INET,
+                .sin_port = address.port,
+                .sin_addr = {.s_addr = address.address},
+            };
+            return sizeof(sockaddr_in);
+        }
+
+        /**
+         * @brief Translates a host address into a guest address, it's truncated to the size of the guest buffer
+         * @return The size of the guest address
+         */
+        u32 ToGuestAddress(const sockaddr_in &host, std::span<u8> guest) {
+            GuestSockAddrIn address{
+                .length = sizeof(GuestSockAddrIn),
+                .family = static_cast<u8>(host.sin_family),
+                .port = host.sin_port,
+                .address = host.sin_addr.s_addr,
+            };
+            std::memcpy(guest.data(), &address, std::min(guest.size(), sizeof(GuestSockAddrIn)));
+            return sizeof(GuestSockAddrIn);
+        }
+
+        /**
+         * @return A timeout of the guest in milliseconds, a zero timeout denotes an infinite timeout in which case this is -1
+         */
+        i32 ToTimeout(const GuestTimeval &timeval) {
+            if (timeval.seconds <= 0 && timeval.microseconds <= 0)
+                return -1;
+            return static_cast<i32>(std::min<i64>((timeval.seconds * 1000) + ((timeval.microseconds + 999) / 1000), std::numeric_limits<i32>::max()));
+        }
+    }
+
+    IClient::IClient(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
+
+    IClient::~IClient() {
+        for (const auto &socket : sockets)
+            if (socket.fd != -1)
+                close(socket.fd);
+    }
+
+    IClient::Descriptor IClient::GetSocket(i32 fd) {
+        std::lock_guard lock(mutex);
+        if (fd < 0 || static_cast<size_t>(fd) >= sockets.size())
+            return {};
+        return sockets[static_cast<size_t>(fd)];
+    }
+
+    i32 IClient::AllocateSocket(int hostFd) {
+        std::lock_guard lock(mutex);
+        auto free{std::find_if(sockets.begin(), sockets.end(), [](const Descriptor &socket) { return socket.fd == -1; })};
+        if (free == sockets.end()) {
+            if (sockets.size() >= constant::MaxSocketCount) {
+                close(hostFd);
+                return -1;
+            }
+            free = sockets.emplace(sockets.end());
+        }
+
+        *free = {.fd = hostFd};
+        return static_cast<i32>(std::distance(sockets.begin(), free));
+    }
+
+    int IClient::PollHost(std::span<pollfd> fds, i32 timeout) {
+        auto deadline{timeout >= 0 ? util::GetTimeNs() + (static_cast<u64>(timeout) * 1000000) : 0};
+        while (true) {
+            auto slice{constant::SocketWaitSlice};
+            if (timeout >= 0) {
+                auto now{util::GetTimeNs()};
+                slice = (now >= deadline) ? 0 : static_cast<i32>(std::min<u64>(static_cast<u64>(slice), (deadline - now + 999999) / 1000000));
+            }
+
+            auto result{poll(fds.data(), fds.size(), slice)};
+            if (result < 0 && errno == EINTR)
+                continue;
+            if (result != 0 || (timeout >= 0 && util::GetTimeNs() >= deadline))
+                return result;
+
+            if (Halt) {
+                errno = EINTR;
+                return -1;
+            }
+        }
+    }
+
+    int IClient::DuplicateSocket(i32 fd) {
+        auto socket{GetSocket(fd)};
+        return socket.fd == -1 ? -1 : fcntl(socket.fd, F_DUPFD_CLOEXEC, 0);
+    }
+
+    i32 IClient::CloseSocket(i32 fd) {
+        std::lock_guard lock(mutex);
+        if (fd < 0 || static_cast<size_t>(fd) >= sockets.size() || sockets[static_cast<size_t>(fd)].fd == -1)
+            return EBADF;
+
+        auto &socket{sockets[static_cast<size_t>(fd)]};
+        auto result{close(socket.fd)};
+        socket = {};
+        return result ? errno : 0;
+    }
+
+    template<typename Function>
+    std::pair<i64, i32> IClient::Transfer(const Descriptor &socket, short events, i32 timeout, bool dontWait, Function transfer) {
+        while (true) {
+            auto result{static_cast<i64>(transfer(socket.fd))};
+            if (result >= 0)
+                return {result, 0};
+
+            auto error{errno};
+            if (error != EAGAIN || socket.nonBlocking || dontWait)
+                return {-1, error};
+
+            // A blocking transfer waits for the socket to be ready and is retried, a transfer that times out fails with EAGAIN like one with SO_RCVTIMEO or SO_SNDTIMEO on BSD, PushResult translates it into the guest's EAGAIN
+            pollfd fd{.fd = socket.fd, .events = events};
+            auto ready{PollHost(std::span(&fd, 1), timeout)};
+            if (ready < 0)
+                return {-1, errno};
+            else if (ready == 0)
+                return {-1, EAGAIN};
+        }
+    }
+
+    std::span<u8> IClient::MapBuffer(const ipc::IpcBuffer &buffer, std::vector<u8> &staging, bool input) {
+        auto span{state.process->GetSpan<u8>(buffer.address, buffer.size)};
+        if (!span.empty() || !buffer.size)
+            return span;
+
+        staging.resize(buffer.size);
+        if (input)
+            state.process->ReadMemory(staging.data(), buffer.address, buffer.size);
+        return staging;
+    }
+
+    void IClient::PushResult(ipc::IpcResponse &response, i64 result, i32 error) {
+        i32 guestError{};
+        if (result < 0) {
+            guestError = ToGuestErrno(error);
+            if (guestError == -1) {
+                state.logger->Warn("Host errno {} ({}) has no guest equivalent, returning EIO", error, strerror(error));
+                guestError = GuestEio;
+            }
+        }
+
+        response.Push<i32>(static_cast<i32>(result));
+        response.Push<u32>(static_cast<u32>(guestError));
+    }
 
     Result IClient::RegisterClient(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         response.Push<u32>(0);
@@ -17,4 +360,567 @@ namespace skyline::service::socket {
     Result IClient::StartMonitoring(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         return {};
     }
-}
\ No newline at end of file
+
+    Result IClient::Socket(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto domain{request.Pop<i32>()};
+        auto type{request.Pop<i32>()};
+        auto protocol{request.Pop<i32>()};
+
+        auto hostFd{::socket(domain, (type & ~(GuestSockNonBlock | GuestSockCloexec)) | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol)};
+        if (hostFd < 0) {
+            PushResult(response, -1, errno);
+            return {};
+        }
+
+        auto fd{AllocateSocket(hostFd)};
+        if (fd >= 0 && (type & GuestSockNonBlock)) {
+            std::lock_guard lock(mutex);
+            sockets[static_cast<size_t>(fd)].nonBlocking = true;
+        }
+
+        state.logger->Debug("Socket: Domain: {}, Type: 0x{:X}, Protocol: {}, FD: {}", domain, type, protocol, fd);
+        PushResult(response, fd, EMFILE);
+        return {};
+    }
+
+    Result IClient::Select(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        struct Data {
+            i32 nfds;
+            u32 _pad0_;
+            GuestTimeval timeout;
+            bool nullTimeout; //!< If the guest didn't supply a timeout, the wait is infinite in that case
+        } &data = request.Pop<Data>();
+
+        constexpr size_t SetCount{3}; //!< The amount of descriptor sets: read, write and exceptional conditions
+        constexpr size_t SetWords{FD_SETSIZE / 64};
+        auto nfds{static_cast<size_t>(std::clamp(data.nfds, 0, static_cast<i32>(FD_SETSIZE)))};
+
+        std::array<std::array<u64, SetWords>, SetCount> sets{};
+        for (size_t index{}; index < SetCount && index < request.inputBuf.size(); index++)
+            if (request.inputBuf[index].size)
+                state.process->ReadMemory(sets[index].data(), request.inputBuf[index].address, std::min(request.inputBuf[index].size, sizeof(sets[index])));
+
+        constexpr std::array<short, SetCount> SetEvents{POLLIN, POLLOUT, POLLPRI};
+        std::vector<pollfd> fds;
+        std::vector<i32> guestFds;
+        for (size_t fd{}; fd < nfds; fd++) {
+            short events{};
+            for (size_t index{}; index < SetCount; index++)
+                if (sets[index][fd / 64] & (1ULL << (fd % 64)))
+                    events |= SetEvents[index];
+            if (!events)
+                continue;
+
+            auto socket{GetSocket(static_cast<i32>(fd))};
+            if (socket.fd == -1) {
+                PushResult(response, -1, EBADF);
+                return {};
+            }
+
+            fds.push_back({.fd = socket.fd, .events = events});
+            guestFds.push_back(static_cast<i32>(fd));
+        }
+
+        auto timeout{data.nullTimeout ? -1 : static_cast<i32>(std::min<i64>((data.timeout.seconds * 1000) + (data.timeout.microseconds / 1000), std::numeric_limits<i32>::max()))};
+        auto result{PollHost(fds, timeout)};
+        if (result < 0) {
+            PushResult(response, -1, errno);
+            return {};
+        }
+
+        // A socket with an error or a hung up peer is reported as readable and writable, any pending error is then returned by the transfer
+        sets = {};
+        i32 count{};
+        constexpr std::array<short, SetCount> SetReadyEvents{POLLIN | POLLHUP | POLLERR, POLLOUT | POLLERR, POLLPRI};
+        for (size_t index{}; index < fds.size(); index++) {
+            auto fd{static_cast<size_t>(guestFds[index])};
+            for (size_t set{}; set < SetCount; set++) {
+                if ((fds[index].events & SetEvents[set]) && (fds[index].revents & SetReadyEvents[set])) {
+                    sets[set][fd / 64] |= 1ULL << (fd % 64);
+                    count++;
+                }
+            }
+        }
+
+        for (size_t index{}; index < SetCount && index < request.outputBuf.size(); index++)
+            if (request.outputBuf[index].size)
+                state.process->WriteMemory(sets[index].data(), request.outputBuf[index].address, std::min(request.outputBuf[index].size, sizeof(sets[index])));
+
+        PushResult(response, count, 0);
+        return {};
+    }
+
+    Result IClient::Poll(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto nfds{request.Pop<u32>()};
+        auto timeout{request.Pop<i32>()};
+
+        // The layout of pollfd and the values of the events are the same on the guest and host, only the descriptors are translated
+        auto &input{request.inputBuf.at(0)};
+        auto &output{request.outputBuf.at(0)};
+        if (nfds * sizeof(pollfd) > input.size || nfds * sizeof(pollfd) > output.size) {
+            PushResult(response, -1, EINVAL);
+            return {};
+        }
+
+        std::vector<pollfd> guestFds(nfds), fds(nfds);
+        state.process->ReadMemory(guestFds.data(), input.address, nfds * sizeof(pollfd));
+
+        i32 invalid{};
+        for (size_t index{}; index < nfds; index++) {
+            auto &guestFd{guestFds[index]};
+            guestFd.revents = 0;
+            if (guestFd.fd < 0) {
+                fds[index] = {.fd = -1};
+                continue;
+            }
+
+            auto socket{GetSocket(guestFd.fd)};
+            if (socket.fd == -1) {
+                guestFd.revents = POLLNVAL;
+                invalid++;
+            }
+            fds[index] = {.fd = socket.fd, .events = guestFd.events};
+        }
+
+        // Invalid descriptors are reported immediately rather than after waiting on the others
+        auto result{PollHost(fds, invalid ? 0 : timeout)};
+        if (result < 0) {
+            PushResult(response, -1, errno);
+            return {};
+        }
+
+        for (size_t index{}; index < nfds; index++)
+            if (fds[index].fd != -1)
+                guestFds[index].revents = fds[index].revents;
+
+        state.process->WriteMemory(guestFds.data(), output.address, nfds * sizeof(pollfd));
+        PushResult(response, result + invalid, 0);
+        return {};
+    }
+
+    Result IClient::Recv(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto flags{request.Pop<i32>()};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            return {};
+        }
+
+        auto &buffer{request.outputBuf.at(0)};
+        std::vector<u8> staging;
+        auto data{MapBuffer(buffer, staging, false)};
+
+        // MSG_WAITALL is emulated by receiving till the buffer is full as the host socket never blocks, anything that's been received is returned if the peer shuts down or an error occurs
+        size_t received{};
+        std::pair<i64, i32> result;
+        do {
+            result = Transfer(socket, POLLIN, socket.receiveTimeout, flags & GuestMsgDontWait, [&](int fd) {
+                return recv(fd, data.data() + received, data.size() - received, ToHostMessageFlags(flags));
+            });
+            if (result.first > 0)
+                received += static_cast<size_t>(result.first);
+        } while ((flags & GuestMsgWaitAll) && result.first > 0 && received < data.size());
+
+        if (received)
+            result = {static_cast<i64>(received), 0};
+        if (!staging.empty() && received)
+            state.process->WriteMemory(staging.data(), buffer.address, received);
+
+        PushResult(response, result.first, result.second);
+        return {};
+    }
+
+    Result IClient::RecvFrom(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto flags{request.Pop<i32>()};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        auto &buffer{request.outputBuf.at(0)};
+        std::vector<u8> staging;
+        auto data{MapBuffer(buffer, staging, false)};
+
+        sockaddr_in address{};
+        socklen_t addressLength{};
+        auto result{Transfer(socket, POLLIN, socket.receiveTimeout, flags & GuestMsgDontWait, [&](int fd) {
+            addressLength = sizeof(address);
+            return recvfrom(fd, data.data(), data.size(), ToHostMessageFlags(flags), reinterpret_cast<sockaddr *>(&address), &addressLength);
+        })};
+
+        if (!staging.empty() && result.first > 0)
+            state.process->WriteMemory(staging.data(), buffer.address, static_cast<size_t>(result.first));
+
+        u32 guestLength{};
+        if (result.first >= 0 && addressLength && request.outputBuf.size() > 1) {
+            auto &addressBuffer{request.outputBuf[1]};
+            std::array<u8, sizeof(GuestSockAddrIn)> guestAddress{};
+            guestLength = ToGuestAddress(address, std::span(guestAddress).first(std::min(addressBuffer.size, guestAddress.size())));
+            state.process->WriteMemory(guestAddress.data(), addressBuffer.address, std::min(addressBuffer.size, guestAddress.size()));
+        }
+
+        PushResult(response, result.first, result.second);
+        response.Push<u32>(guestLength);
+        return {};
+    }
+
+    Result IClient::Send(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto flags{request.Pop<i32>()};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            return {};
+        }
+
+        std::vector<u8> staging;
+        auto data{MapBuffer(request.inputBuf.at(0), staging, true)};
+        auto result{Transfer(socket, POLLOUT, socket.sendTimeout, flags & GuestMsgDontWait, [&](int fd) {
+            return send(fd, data.data(), data.size(), ToHostMessageFlags(flags));
+        })};
+
+        PushResult(response, result.first, result.second);
+        return {};
+    }
+
+    Result IClient::SendTo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto flags{request.Pop<i32>()};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            return {};
+        }
+
+        sockaddr_in address{};
+        socklen_t addressLength{};
+        if (request.inputBuf.size() > 1 && request.inputBuf[1].size) {
+            std::vector<u8> addressStaging;
+            addressLength = ToHostAddress(MapBuffer(request.inputBuf[1], addressStaging, true), address);
+            if (!addressLength) {
+                PushResult(response, -1, EAFNOSUPPORT);
+                return {};
+            }
+        }
+
+        std::vector<u8> staging;
+        auto data{MapBuffer(request.inputBuf.at(0), staging, true)};
+        auto result{Transfer(socket, POLLOUT, socket.sendTimeout, flags & GuestMsgDontWait, [&](int fd) {
+            return sendto(fd, data.data(), data.size(), ToHostMessageFlags(flags), addressLength ? reinterpret_cast<sockaddr *>(&address) : nullptr, addressLength);
+        })};
+
+        PushResult(response, result.first, result.second);
+        return {};
+    }
+
+    Result IClient::Accept(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        sockaddr_in address{};
+        socklen_t addressLength{};
+        auto result{Transfer(socket, POLLIN, -1, false, [&](int fd) {
+            addressLength = sizeof(address);
+            return accept4(fd, reinterpret_cast<sockaddr *>(&address), &addressLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        })};
+
+        u32 guestLength{};
+        if (result.first >= 0) {
+            result.first = AllocateSocket(static_cast<int>(result.first));
+            result.second = EMFILE;
+
+            if (result.first >= 0 && !request.outputBuf.empty()) {
+                auto &addressBuffer{request.outputBuf[0]};
+                std::array<u8, sizeof(GuestSockAddrIn)> guestAddress{};
+                guestLength = ToGuestAddress(address, std::span(guestAddress).first(std::min(addressBuffer.size, guestAddress.size())));
+                state.process->WriteMemory(guestAddress.data(), addressBuffer.address, std::min(addressBuffer.size, guestAddress.size()));
+            }
+        }
+
+        PushResult(response, result.first, result.second);
+        response.Push<u32>(guestLength);
+        return {};
+    }
+
+    Result IClient::Bind(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            return {};
+        }
+
+        std::vector<u8> staging;
+        sockaddr_in address{};
+        auto addressLength{ToHostAddress(MapBuffer(request.inputBuf.at(0), staging, true), address)};
+        if (!addressLength) {
+            PushResult(response, -1, EAFNOSUPPORT);
+            return {};
+        }
+
+        auto result{bind(socket.fd, reinterpret_cast<sockaddr *>(&address), addressLength)};
+        PushResult(response, result, errno);
+        return {};
+    }
+
+    Result IClient::Connect(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            return {};
+        }
+
+        std::vector<u8> staging;
+        sockaddr_in address{};
+        auto addressLength{ToHostAddress(MapBuffer(request.inputBuf.at(0), staging, true), address)};
+        if (!addressLength) {
+            PushResult(response, -1, EAFNOSUPPORT);
+            return {};
+        }
+
+        auto result{connect(socket.fd, reinterpret_cast<sockaddr *>(&address), addressLength)};
+        auto error{errno};
+        if (result < 0 && error == EINPROGRESS && !socket.nonBlocking) {
+            // A blocking connect waits for the host socket to become writable, which is when the connection has either been established or has failed
+            pollfd fd{.fd = socket.fd, .events = POLLOUT};
+            auto ready{PollHost(std::span(&fd, 1), socket.sendTimeout)};
+            if (ready > 0) {
+                socklen_t errorLength{sizeof(error)};
+                getsockopt(socket.fd, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+                result = error ? -1 : 0;
+            } else {
+                error = ready ? errno : ETIMEDOUT;
+            }
+        }
+
+        state.logger->Debug("Connect: FD: {}, Result: {}, Errno: {}", socket.fd, result, result < 0 ? error : 0);
+        PushResult(response, result, error);
+        return {};
+    }
+
+    Result IClient::GetPeerName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        sockaddr_in address{};
+        socklen_t addressLength{sizeof(address)};
+        auto result{socket.fd == -1 ? -1 : getpeername(socket.fd, reinterpret_cast<sockaddr *>(&address), &addressLength)};
+        auto error{socket.fd == -1 ? EBADF : errno};
+
+        u32 guestLength{};
+        if (result == 0 && !request.outputBuf.empty()) {
+            std::vector<u8> staging;
+            auto &buffer{request.outputBuf[0]};
+            guestLength = ToGuestAddress(address, MapBuffer(buffer, staging, false));
+            if (!staging.empty())
+                state.process->WriteMemory(staging.data(), buffer.address, staging.size());
+        }
+
+        PushResult(response, result, error);
+        response.Push<u32>(guestLength);
+        return {};
+    }
+
+    Result IClient::GetSockName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        sockaddr_in address{};
+        socklen_t addressLength{sizeof(address)};
+        auto result{socket.fd == -1 ? -1 : getsockname(socket.fd, reinterpret_cast<sockaddr *>(&address), &addressLength)};
+        auto error{socket.fd == -1 ? EBADF : errno};
+
+        u32 guestLength{};
+        if (result == 0 && !request.outputBuf.empty()) {
+            std::vector<u8> staging;
+            auto &buffer{request.outputBuf[0]};
+            guestLength = ToGuestAddress(address, MapBuffer(buffer, staging, false));
+            if (!staging.empty())
+                state.process->WriteMemory(staging.data(), buffer.address, staging.size());
+        }
+
+        PushResult(response, result, error);
+        response.Push<u32>(guestLength);
+        return {};
+    }
+
+    Result IClient::GetSockOpt(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto level{request.Pop<i32>()};
+        auto name{request.Pop<i32>()};
+
+        auto socket{GetSocket(fd)};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            response.Push<u32>(0);
+            return {};
+        }
+
+        auto &buffer{request.outputBuf.at(0)};
+        std::vector<u8> staging;
+        auto value{MapBuffer(buffer, staging, false)};
+        socklen_t valueLength{static_cast<socklen_t>(value.size())};
+
+        int result, error{};
+        if (level == GuestSolSocket && (name == GuestSoReceiveTimeout || name == GuestSoSendTimeout)) {
+            // Timeouts are emulated rather than being applied to the host socket as it never blocks
+            auto timeout{name == GuestSoReceiveTimeout ? socket.receiveTimeout : socket.sendTimeout};
+            GuestTimeval timeval{timeout < 0 ? GuestTimeval{} : GuestTimeval{timeout / 1000, (timeout % 1000) * 1000}};
+            valueLength = static_cast<socklen_t>(std::min(value.size(), sizeof(timeval)));
+            std::memcpy(value.data(), &timeval, valueLength);
+            result = 0;
+        } else {
+            auto hostName{level == GuestSolSocket ? ToHostSocketOption(name) : name};
+            if (hostName == -1) {
+                result = -1;
+                error = ENOPROTOOPT;
+            } else {
+                result = getsockopt(socket.fd, level == GuestSolSocket ? SOL_SOCKET : level, hostName, value.data(), &valueLength);
+                error = errno;
+
+                // SO_ERROR returns a pending host errno which has to be translated in the same way as the errno of a call
+                if (result == 0 && level == GuestSolSocket && hostName == SO_ERROR && valueLength >= sizeof(int)) {
+                    int pending;
+                    std::memcpy(&pending, value.data(), sizeof(int));
+                    if (pending) {
+                        auto guestPending{ToGuestErrno(pending)};
+                        pending = guestPending == -1 ? GuestEio : guestPending;
+                        std::memcpy(value.data(), &pending, sizeof(int));
+                    }
+                }
+            }
+        }
+
+        if (!staging.empty() && result == 0)
+            state.process->WriteMemory(staging.data(), buffer.address, valueLength);
+
+        PushResult(response, result, error);
+        response.Push<u32>(result == 0 ? valueLength : 0);
+        return {};
+    }
+
+    Result IClient::Listen(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto backlog{request.Pop<i32>()};
+        auto result{socket.fd == -1 ? -1 : listen(socket.fd, backlog)};
+        PushResult(response, result, socket.fd == -1 ? EBADF : errno);
+        return {};
+    }
+
+    Result IClient::Fcntl(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto command{request.Pop<i32>()};
+        auto argument{request.Pop<i32>()};
+
+        std::lock_guard lock(mutex);
+        if (fd < 0 || static_cast<size_t>(fd) >= sockets.size() || sockets[static_cast<size_t>(fd)].fd == -1) {
+            PushResult(response, -1, EBADF);
+            return {};
+        }
+
+        // Only the non-blocking flag is tracked, the host socket always stays non-blocking
+        auto &socket{sockets[static_cast<size_t>(fd)]};
+        if (command == F_GETFL) {
+            PushResult(response, O_RDWR | (socket.nonBlocking ? GuestNonBlock : 0), 0);
+        } else if (command == F_SETFL) {
+            socket.nonBlocking = argument & GuestNonBlock;
+            PushResult(response, 0, 0);
+        } else {
+            state.logger->Warn("Fcntl: Unsupported command: {}", command);
+            PushResult(response, -1, EINVAL);
+        }
+        return {};
+    }
+
+    Result IClient::SetSockOpt(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto level{request.Pop<i32>()};
+        auto name{request.Pop<i32>()};
+
+        std::vector<u8> staging;
+        auto value{MapBuffer(request.inputBuf.at(0), staging, true)};
+
+        if (level == GuestSolSocket && (name == GuestSoReceiveTimeout || name == GuestSoSendTimeout)) {
+            std::lock_guard lock(mutex);
+            if (fd < 0 || static_cast<size_t>(fd) >= sockets.size() || sockets[static_cast<size_t>(fd)].fd == -1) {
+                PushResult(response, -1, EBADF);
+                return {};
+            } else if (value.size() < sizeof(GuestTimeval)) {
+                PushResult(response, -1, EINVAL);
+                return {};
+            }
+
+            GuestTimeval timeval;
+            std::memcpy(&timeval, value.data(), sizeof(timeval));
+            auto &socket{sockets[static_cast<size_t>(fd)]};
+            (name == GuestSoReceiveTimeout ? socket.receiveTimeout : socket.sendTimeout) = ToTimeout(timeval);
+            PushResult(response, 0, 0);
+            return {};
+        }
+
+        auto socket{GetSocket(fd)};
+        auto hostName{level == GuestSolSocket ? ToHostSocketOption(name) : name};
+        if (socket.fd == -1 || hostName == -1) {
+            PushResult(response, -1, socket.fd == -1 ? EBADF : ENOPROTOOPT);
+            return {};
+        }
+
+        auto result{setsockopt(socket.fd, level == GuestSolSocket ? SOL_SOCKET : level, hostName, value.data(), static_cast<socklen_t>(value.size()))};
+        PushResult(response, result, errno);
+        return {};
+    }
+
+    Result IClient::Shutdown(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        auto how{request.Pop<i32>()};
+        auto result{socket.fd == -1 ? -1 : shutdown(socket.fd, how)};
+        PushResult(response, result, socket.fd == -1 ? EBADF : errno);
+        return {};
+    }
+
+    Result IClient::Write(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            return {};
+        }
+
+        std::vector<u8> staging;
+        auto data{MapBuffer(request.inputBuf.at(0), staging, true)};
+        auto result{Transfer(socket, POLLOUT, socket.sendTimeout, false, [&](int fd) {
+            return send(fd, data.data(), data.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        })};
+
+        PushResult(response, result.first, result.second);
+        return {};
+    }
+
+    Result IClient::Read(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socket{GetSocket(request.Pop<i32>())};
+        if (socket.fd == -1) {
+            PushResult(response, -1, EBADF);
+            return {};
+        }
+
+        auto &buffer{request.outputBuf.at(0)};
+        std::vector<u8> staging;
+        auto data{MapBuffer(buffer, staging, false)};
+        auto result{Transfer(socket, POLLIN, socket.receiveTimeout, false, [&](int fd) {
+            return recv(fd, data.data(), data.size(), MSG_DONTWAIT);
+        })};
+
+        if (!staging.empty() && result.first > 0)
+            state.process->WriteMemory(staging.data(), buffer.address, static_cast<size_t>(result.first));
+
+        PushResult(response, result.first, result.second);
+        return {};
+    }
+
+    Result IClient::Close(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto fd{request.Pop<i32>()};
+        auto error{CloseSocket(fd)};
+
+        state.logger->Debug("Close: FD: {}", fd);
+        PushResult(response, error ? -1 : 0, error);
+        return {};
+    }
+}
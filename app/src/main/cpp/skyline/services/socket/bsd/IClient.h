@@ -3,25 +3,231 @@
 
 #pragma once
 
+#include <poll.h>
 #include <services/base_service.h>
 #include <services/serviceman.h>
 
-namespace skyline::service::socket {
-    /**
-     * @brief IClient or bsd:u is used by applications create network sockets (https://switchbrew.org/wiki/Sockets_services#bsd:u.2C_bsd:s)
-     */
-    class IClient : public BaseService {
-      public:
-        IClient(const DeviceState &state, ServiceManager &manager);
+namespace skyline {
+    namespace constant {
+        constexpr size_t MaxSocketCount = 0x400; //!< The maximum amount of sockets a client can have open at once
+        constexpr i32 SocketWaitSlice = 100; //!< The maximum duration in milliseconds that a blocking operation waits on the host for at once, halting emulation is checked between slices
+    }
 
+    namespace service::socket {
         /**
-         * @brief This initializes a socket client with the given parameters (https://switchbrew.org/wiki/Sockets_services#Initialize)
+         * @brief IClient or bsd:u is used by applications create network sockets (https://switchbrew.org/wiki/Sockets_services#bsd:u.2C_bsd:s)
+         * @details Every guest socket is backed by a non-blocking host socket, blocking semantics are emulated by polling the host socket for readiness so a halt of emulation can interrupt any wait. Data is transferred directly between the guest buffers and the host socket without any intermediate copies
+         * @note The errno values of the guest match the ones of Linux, so they're returned as-is while addresses, socket options and flags are translated from their BSD equivalents
          */
-        Result RegisterClient(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+        class IClient : public BaseService {
+          private:
+            /**
+             * @brief The state of a guest socket
+             */
+            struct Descriptor {
+                int fd{-1}; //!< The host socket, this is -1 if the guest descriptor is free
+                bool nonBlocking{}; //!< If the guest has made the socket non-blocking, the host socket is always non-blocking
+                i32 receiveTimeout{-1}; //!< The timeout of blocking receives in milliseconds set with SO_RCVTIMEO, this is -1 for an infinite timeout
+                i32 sendTimeout{-1}; //!< The timeout of blocking sends in milliseconds set with SO_SNDTIMEO, this is -1 for an infinite timeout
+            };
 
-        /**
-         * @brief This starts the monitoring of the socket
-         */
-        Result StartMonitoring(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
-    };
-}
\ No newline at end of file
+            std::mutex mutex; //!< This mutex guards sockets, it's never held while waiting on a host socket
+            std::vector<Descriptor> sockets; //!< The sockets of the client indexed by their guest descriptor
+
+            /**
+             * @return A copy of the state of the socket with the supplied guest descriptor, the host socket is -1 if the descriptor is invalid
+             */
+            Descriptor GetSocket(i32 fd);
+
+            /**
+             * @brief Allocates the lowest free guest descriptor for a host socket
+             * @return The guest descriptor or -1 if the client has too many sockets open, the host socket is closed in that case
+             */
+            i32 AllocateSocket(int hostFd);
+
+            /**
+             * @brief Runs a transfer on a socket, a transfer that would block on a blocking socket is retried once the socket is ready
+             * @param events The events on the host socket that the transfer waits on
+             * @param timeout The timeout of the wait in milliseconds, this is -1 for an infinite timeout
+             * @param dontWait If the transfer shouldn't wait regardless of the socket being blocking, this is set by MSG_DONTWAIT
+             * @param transfer A function that performs the transfer on the host socket and returns its result
+             * @return The result of the transfer and the errno it failed with, if it did
+             */
+            template<typename Function>
+            std::pair<i64, i32> Transfer(const Descriptor &socket, short events, i32 timeout, bool dontWait, Function transfer);
+
+            /**
+             * @brief Maps a guest buffer for a host socket to transfer directly to or from, a buffer that isn't backed by a single host mirror is staged through a host buffer instead
+             * @param staging The staging buffer, this is only used when the guest buffer can't be mapped directly in which case received data has to be written back from it
+             * @param input If data is sent from the buffer, its contents are copied into the staging buffer if it's used
+             */
+            std::span<u8> MapBuffer(const ipc::IpcBuffer &buffer, std::vector<u8> &staging, bool input);
+
+            /**
+             * @brief Pushes the result of an operation and the errno it failed with into the response, errno is 0 if the result isn't negative
+             * @param error The host errno the operation failed with, it's translated into the guest's numbering
+             */
+            void PushResult(ipc::IpcResponse &response, i64 result, i32 error);
+
+          public:
+            IClient(const DeviceState &state, ServiceManager &manager);
+
+            ~IClient();
+
+            /**
+             * @brief Waits for events on host sockets in slices of constant::SocketWaitSlice, so that halting emulation is observed during indefinite waits
+             * @param timeout The timeout of the wait in milliseconds, this is -1 for an infinite timeout
+             * @return The result of the last host poll, this is 0 if the wait timed out
+             */
+            static int PollHost(std::span<pollfd> fds, i32 timeout);
+
+            /**
+             * @return A duplicate of the host socket of a guest descriptor that's owned by the caller, this is -1 if the descriptor is invalid
+             * @note This is used by other services that take over a socket from the guest, such as ssl
+             */
+            int DuplicateSocket(i32 fd);
+
+            /**
+             * @brief Closes a guest descriptor and its host socket
+             * @return The errno the close failed with or 0 if it succeeded
+             */
+            i32 CloseSocket(i32 fd);
+
+            /**
+             * @brief This initializes a socket client with the given parameters (https://switchbrew.org/wiki/Sockets_services#Initialize)
+             */
+            Result RegisterClient(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief This starts the monitoring of the socket
+             */
+            Result StartMonitoring(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Creates a socket (https://switchbrew.org/wiki/Sockets_services#Socket)
+             */
+            Result Socket(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Waits for events on a set of sockets described by file descriptor sets (https://switchbrew.org/wiki/Sockets_services#Select)
+             */
+            Result Select(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Waits for events on an array of sockets (https://switchbrew.org/wiki/Sockets_services#Poll)
+             */
+            Result Poll(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Receives data from a socket (https://switchbrew.org/wiki/Sockets_services#Recv)
+             */
+            Result Recv(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Receives data from a socket along with the address it was sent from (https://switchbrew.org/wiki/Sockets_services#RecvFrom)
+             */
+            Result RecvFrom(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Sends data on a connected socket (https://switchbrew.org/wiki/Sockets_services#Send)
+             */
+            Result Send(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Sends data on a socket to an address (https://switchbrew.org/wiki/Sockets_services#SendTo)
+             */
+            Result SendTo(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Accepts a connection on a listening socket (https://switchbrew.org/wiki/Sockets_services#Accept)
+             */
+            Result Accept(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Binds a socket to an address (https://switchbrew.org/wiki/Sockets_services#Bind)
+             */
+            Result Bind(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Connects a socket to an address (https://switchbrew.org/wiki/Sockets_services#Connect)
+             */
+            Result Connect(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Returns the address of the peer of a connected socket (https://switchbrew.org/wiki/Sockets_services#GetPeerName)
+             */
+            Result GetPeerName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Returns the address a socket is bound to (https://switchbrew.org/wiki/Sockets_services#GetSockName)
+             */
+            Result GetSockName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Reads an option of a socket (https://switchbrew.org/wiki/Sockets_services#GetSockOpt)
+             */
+            Result GetSockOpt(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Marks a socket as accepting connections (https://switchbrew.org/wiki/Sockets_services#Listen)
+             */
+            Result Listen(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Reads or modifies the flags of a socket, only O_NONBLOCK is supported (https://switchbrew.org/wiki/Sockets_services#Fcntl)
+             */
+            Result Fcntl(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Modifies an option of a socket (https://switchbrew.org/wiki/Sockets_services#SetSockOpt)
+             */
+            Result SetSockOpt(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Shuts down a part of a full-duplex connection (https://switchbrew.org/wiki/Sockets_services#Shutdown)
+             */
+            Result Shutdown(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Writes data to a socket (https://switchbrew.org/wiki/Sockets_services#Write)
+             */
+            Result Write(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Reads data from a socket (https://switchbrew.org/wiki/Sockets_services#Read)
+             */
+            Result Read(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            /**
+             * @brief Closes a socket (https://switchbrew.org/wiki/Sockets_services#Close)
+             */
+            Result Close(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+            SERVICE_DECL(
+                SFUNC(0x0, IClient, RegisterClient),
+                SFUNC(0x1, IClient, StartMonitoring),
+                SFUNC(0x2, IClient, Socket),
+                SFUNC(0x3, IClient, Socket),
+                SFUNC(0x5, IClient, Select),
+                SFUNC(0x6, IClient, Poll),
+                SFUNC(0x8, IClient, Recv),
+                SFUNC(0x9, IClient, RecvFrom),
+                SFUNC(0xA, IClient, Send),
+                SFUNC(0xB, IClient, SendTo),
+                SFUNC(0xC, IClient, Accept),
+                SFUNC(0xD, IClient, Bind),
+                SFUNC(0xE, IClient, Connect),
+                SFUNC(0xF, IClient, GetPeerName),
+                SFUNC(0x10, IClient, GetSockName),
+                SFUNC(0x11, IClient, GetSockOpt),
+                SFUNC(0x12, IClient, Listen),
+                SFUNC(0x14, IClient, Fcntl),
+                SFUNC(0x15, IClient, SetSockOpt),
+                SFUNC(0x16, IClient, Shutdown),
+                SFUNC(0x18, IClient, Write),
+                SFUNC(0x19, IClient, Read),
+                SFUNC(0x1A, IClient, Close)
+            )
+        };
+    }
+}
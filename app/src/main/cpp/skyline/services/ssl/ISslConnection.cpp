@@ -0,0 +1,428 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <mbedtls/net_sockets.h>
+#include <kernel/types/KProcess.h>
+#include <services/socket/bsd/IClient.h>
+#include "ISslConnection.h"
+
+namespace skyline::service::ssl {
+    namespace {
+        /**
+         * @brief The events that Poll waits on (https://switchbrew.org/wiki/SSL_services#PollEvent)
+         */
+        union PollEvent {
+            struct {
+                bool read : 1;
+                bool write : 1;
+                bool except : 1;
+            };
+            u32 raw;
+        };
+        static_assert(sizeof(PollEvent) == sizeof(u32));
+    }
+
+    ISslConnection::ISslConnection(const DeviceState &state, ServiceManager &manager, std::shared_ptr<TlsState> tls, std::shared_ptr<ISslContext> context) : tls(std::move(tls)), context(std::move(context)), BaseService(state, manager) {
+        mbedtls_ssl_config_init(&config);
+        mbedtls_ssl_init(&ssl);
+        this->context->connectionCount++;
+    }
+
+    ISslConnection::~ISslConnection() {
+        if (handshakeDone)
+            mbedtls_ssl_close_notify(&ssl); // This is only attempted once as the host socket is non-blocking, the peer can't rely on it regardless
+        mbedtls_ssl_free(&ssl);
+        mbedtls_ssl_config_free(&config);
+        if (fd != -1)
+            close(fd);
+        context->connectionCount--;
+    }
+
+    int ISslConnection::SendCallback(void *connection, const unsigned char *buffer, size_t size) {
+        auto result{send(static_cast<ISslConnection *>(connection)->fd, buffer, size, MSG_DONTWAIT | MSG_NOSIGNAL)};
+        if (result >= 0)
+            return static_cast<int>(result);
+        else if (errno == EAGAIN || errno == EINTR)
+            return MBEDTLS_ERR_SSL_WANT_WRITE;
+        else if (errno == EPIPE || errno == ECONNRESET)
+            return MBEDTLS_ERR_NET_CONN_RESET;
+        return MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+
+    int ISslConnection::ReceiveCallback(void *connection, unsigned char *buffer, size_t size) {
+        auto result{recv(static_cast<ISslConnection *>(connection)->fd, buffer, size, MSG_DONTWAIT)};
+        if (result >= 0)
+            return static_cast<int>(result);
+        else if (errno == EAGAIN || errno == EINTR)
+            return MBEDTLS_ERR_SSL_WANT_READ;
+        else if (errno == ECONNRESET)
+            return MBEDTLS_ERR_NET_CONN_RESET;
+        return MBEDTLS_ERR_NET_RECV_FAILED;
+    }
+
+    int ISslConnection::VerifyCallback(void *connection, mbedtls_x509_crt *certificate, int depth, uint32_t *flags) {
+        auto self{static_cast<ISslConnection *>(connection)};
+        if (self->options.test(static_cast<size_t>(OptionType::SkipDefaultVerify))) {
+            *flags = 0;
+            return 0;
+        }
+
+        if (!self->verifyOption.hostName)
+            *flags &= ~MBEDTLS_X509_BADCERT_CN_MISMATCH;
+        if (!self->verifyOption.dateCheck)
+            *flags &= ~(MBEDTLS_X509_BADCERT_EXPIRED | MBEDTLS_X509_BADCERT_FUTURE);
+        return 0;
+    }
+
+    void ISslConnection::Setup() {
+        if (setup)
+            return;
+
+        if (mbedtls_ssl_config_defaults(&config, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT))
+            throw exception("Failed to initialize the configuration of an SSL connection");
+
+        mbedtls_ssl_conf_rng(&config, TlsState::Random, tls.get());
+        chain = context->GetCertificateChain();
+        mbedtls_ssl_conf_ca_chain(&config, &chain->chain, nullptr);
+        mbedtls_ssl_conf_authmode(&config, verifyOption.peerCa ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_NONE);
+        mbedtls_ssl_conf_verify(&config, VerifyCallback, this);
+        mbedtls_ssl_conf_session_tickets(&config, sessionCacheMode == SessionCacheMode::SessionTicket ? MBEDTLS_SSL_SESSION_TICKETS_ENABLED : MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+
+        if (mbedtls_ssl_setup(&ssl, &config))
+            throw exception("Failed to set up an SSL connection");
+        if (!hostName.empty())
+            mbedtls_ssl_set_hostname(&ssl, hostName.c_str());
+        mbedtls_ssl_set_bio(&ssl, this, SendCallback, ReceiveCallback, nullptr);
+
+        setup = true;
+    }
+
+    template<typename Function>
+    int ISslConnection::Run(Function operation) {
+        while (true) {
+            auto result{operation()};
+            if ((result != MBEDTLS_ERR_SSL_WANT_READ && result != MBEDTLS_ERR_SSL_WANT_WRITE) || ioMode == IoMode::NonBlocking)
+                return result;
+
+            pollfd pollFd{.fd = fd, .events = static_cast<short>(result == MBEDTLS_ERR_SSL_WANT_READ ? POLLIN : POLLOUT)};
+            if (socket::IClient::PollHost(std::span(&pollFd, 1), -1) < 0)
+                return MBEDTLS_ERR_NET_RECV_FAILED;
+        }
+    }
+
+    Result ISslConnection::DoHandshakeImpl() {
+        if (fd == -1)
+            return result::NoSocket;
+
+        Setup();
+        if (handshakeDone)
+            return {};
+
+        // A cached session is only restored before the first attempt at the handshake, a non-blocking handshake is resumed where it left off by subsequent attempts
+        bool caching{sessionCacheMode != SessionCacheMode::None && !hostName.empty()};
+        if (caching && ssl.state == MBEDTLS_SSL_HELLO_REQUEST)
+            tls->RestoreSession(hostName, ssl);
+
+        auto result{Run([this]() { return mbedtls_ssl_handshake(&ssl); })};
+        verifyResult = mbedtls_ssl_get_verify_result(&ssl);
+        if (result)
+            return ToResult(result);
+
+        handshakeDone = true;
+        if (caching)
+            tls->SaveSession(hostName, ssl);
+
+        LOGD(state.logger, "SSL handshake completed: Host: {}, Cipher Suite: {}", hostName, mbedtls_ssl_get_ciphersuite(&ssl));
+        return {};
+    }
+
+    Result ISslConnection::ToResult(int error) {
+        switch (error) {
+            case 0:
+                return {};
+            case MBEDTLS_ERR_SSL_WANT_READ:
+            case MBEDTLS_ERR_SSL_WANT_WRITE:
+                return result::WouldBlock;
+            case MBEDTLS_ERR_SSL_TIMEOUT:
+                return result::Timeout;
+            case MBEDTLS_ERR_NET_CONN_RESET:
+            case MBEDTLS_ERR_NET_SEND_FAILED:
+            case MBEDTLS_ERR_NET_RECV_FAILED:
+                return result::InvalidSocket;
+            default:
+                state.logger->Warn("SSL operation failed on host '{}': -0x{:X}", hostName, -error);
+                return result::InternalError;
+        }
+    }
+
+    Result ISslConnection::SetSocketDescriptor(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto socketFd{request.Pop<i32>()};
+        if (fd != -1)
+            return result::InternalError;
+
+        auto bsd{manager.GetService<socket::IClient>("bsd:u")};
+        fd = bsd->DuplicateSocket(socketFd);
+        if (fd == -1)
+            return result::InvalidSocket;
+
+        // HOS takes ownership of the socket and closes the guest's descriptor unless DoNotCloseSocket is set
+        guestFd = socketFd;
+        if (!options.test(static_cast<size_t>(OptionType::DoNotCloseSocket))) {
+            bsd->CloseSocket(socketFd);
+            response.Push<i32>(-1);
+        } else {
+            response.Push<i32>(socketFd);
+        }
+        return {};
+    }
+
+    Result ISslConnection::SetHostName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto &buffer{request.inputBuf.at(0)};
+        hostName.resize(buffer.size);
+        state.process->ReadMemory(hostName.data(), buffer.address, buffer.size);
+        hostName.resize(strnlen(hostName.data(), hostName.size()));
+
+        if (setup)
+            mbedtls_ssl_set_hostname(&ssl, hostName.c_str());
+        return {};
+    }
+
+    Result ISslConnection::SetVerifyOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        verifyOption.raw = request.Pop<u32>();
+        if (setup)
+            mbedtls_ssl_conf_authmode(&config, verifyOption.peerCa ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_NONE);
+        return {};
+    }
+
+    Result ISslConnection::SetIoMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        ioMode = request.Pop<IoMode>();
+        return {};
+    }
+
+    Result ISslConnection::GetSocketDescriptor(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        response.Push<i32>(guestFd);
+        return {};
+    }
+
+    Result ISslConnection::GetHostName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto &buffer{request.outputBuf.at(0)};
+        auto size{std::min(buffer.size, hostName.size())};
+        state.process->WriteMemory(hostName.data(), buffer.address, size);
+        response.Push<u32>(static_cast<u32>(size));
+        return {};
+    }
+
+    Result ISslConnection::GetVerifyOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        response.Push<u32>(verifyOption.raw);
+        return {};
+    }
+
+    Result ISslConnection::GetIoMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        response.Push(ioMode);
+        return {};
+    }
+
+    Result ISslConnection::DoHandshake(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return DoHandshakeImpl();
+    }
+
+    Result ISslConnection::DoHandshakeGetServerCert(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto result{DoHandshakeImpl()};
+        if (result)
+            return result;
+
+        // Only the certificate of the server itself is returned as the rest of its chain isn't retained by mbedtls
+        u32 size{}, count{};
+        auto certificate{mbedtls_ssl_get_peer_cert(&ssl)};
+        if (certificate && !request.outputBuf.empty()) {
+            auto &buffer{request.outputBuf[0]};
+            if (certificate->raw.len <= buffer.size) {
+                state.process->WriteMemory(certificate->raw.p, buffer.address, certificate->raw.len);
+                size = static_cast<u32>(certificate->raw.len);
+                count = 1;
+            }
+        }
+
+        response.Push<u32>(size);
+        response.Push<u32>(count);
+        return {};
+    }
+
+    Result ISslConnection::Read(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto result{DoHandshakeImpl()};
+        if (result)
+            return result;
+
+        auto &buffer{request.outputBuf.at(0)};
+        if (!peeked.empty()) {
+            auto size{std::min(buffer.size, peeked.size())};
+            state.process->WriteMemory(peeked.data(), buffer.address, size);
+            peeked.erase(peeked.begin(), peeked.begin() + static_cast<ssize_t>(size));
+            response.Push<u32>(static_cast<u32>(size));
+            return {};
+        }
+
+        std::vector<u8> staging;
+        auto data{state.process->GetSpan<u8>(buffer.address, buffer.size)};
+        if (data.empty() && buffer.size) {
+            staging.resize(buffer.size);
+            data = staging;
+        }
+
+        auto read{Run([&]() { return mbedtls_ssl_read(&ssl, data.data(), data.size()); })};
+        if (read == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
+            read = 0;
+        if (read < 0)
+            return ToResult(read);
+
+        if (!staging.empty())
+            state.process->WriteMemory(staging.data(), buffer.address, static_cast<size_t>(read));
+        response.Push<u32>(static_cast<u32>(read));
+        return {};
+    }
+
+    Result ISslConnection::Write(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto result{DoHandshakeImpl()};
+        if (result)
+            return result;
+
+        auto &buffer{request.inputBuf.at(0)};
+        std::vector<u8> staging;
+        auto data{state.process->GetSpan<u8>(buffer.address, buffer.size)};
+        if (data.empty() && buffer.size) {
+            staging.resize(buffer.size);
+            state.process->ReadMemory(staging.data(), buffer.address, buffer.size);
+            data = staging;
+        }
+
+        // mbedtls writes at most a single record at once, a blocking write continues till all of the data has been written
+        size_t written{};
+        while (written < data.size()) {
+            auto count{Run([&]() { return mbedtls_ssl_write(&ssl, data.data() + written, data.size() - written); })};
+            if (count < 0) {
+                if (!written)
+                    return ToResult(count);
+                break;
+            }
+
+            written += static_cast<size_t>(count);
+            if (ioMode == IoMode::NonBlocking)
+                break;
+        }
+
+        response.Push<u32>(static_cast<u32>(written));
+        return {};
+    }
+
+    Result ISslConnection::Pending(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        response.Push<i32>(static_cast<i32>(peeked.size() + (handshakeDone ? mbedtls_ssl_get_bytes_avail(&ssl) : 0)));
+        return {};
+    }
+
+    Result ISslConnection::Peek(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto result{DoHandshakeImpl()};
+        if (result)
+            return result;
+
+        auto &buffer{request.outputBuf.at(0)};
+        if (peeked.size() < buffer.size && (peeked.empty() || mbedtls_ssl_get_bytes_avail(&ssl))) {
+            // Data is only waited for if nothing has been peeked yet, otherwise only the data that's already been decrypted is appended
+            auto offset{peeked.size()};
+            peeked.resize(buffer.size);
+            auto read{Run([&]() { return mbedtls_ssl_read(&ssl, peeked.data() + offset, peeked.size() - offset); })};
+            if (read == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY)
+                read = 0;
+            peeked.resize(offset + static_cast<size_t>(std::max(read, 0)));
+            if (read < 0 && !offset)
+                return ToResult(read);
+        }
+
+        auto size{std::min(buffer.size, peeked.size())};
+        state.process->WriteMemory(peeked.data(), buffer.address, size);
+        response.Push<u32>(static_cast<u32>(size));
+        return {};
+    }
+
+    Result ISslConnection::Poll(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        PollEvent events{.raw = request.Pop<u32>()};
+        auto timeout{request.Pop<u32>()};
+        if (fd == -1)
+            return result::NoSocket;
+
+        // Data that's already been decrypted is readable without the host socket being readable
+        PollEvent ready{};
+        if (events.read && (!peeked.empty() || (handshakeDone && mbedtls_ssl_get_bytes_avail(&ssl)))) {
+            ready.read = true;
+        } else {
+            pollfd pollFd{.fd = fd, .events = static_cast<short>((events.read ? POLLIN : 0) | (events.write ? POLLOUT : 0) | (events.except ? POLLPRI : 0))};
+            if (socket::IClient::PollHost(std::span(&pollFd, 1), static_cast<i32>(std::min<u32>(timeout, std::numeric_limits<i32>::max()))) < 0)
+                return result::InvalidSocket;
+
+            ready.read = events.read && (pollFd.revents & (POLLIN | POLLHUP | POLLERR));
+            ready.write = events.write && (pollFd.revents & (POLLOUT | POLLERR));
+            ready.except = events.except && (pollFd.revents & POLLPRI);
+        }
+
+        response.Push<u32>(ready.raw);
+        return {};
+    }
+
+    Result ISslConnection::GetVerifyCertError(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        return verifyResult ? result::InternalError : Result{};
+    }
+
+    Result ISslConnection::GetNeededServerCertBufferSize(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto certificate{handshakeDone ? mbedtls_ssl_get_peer_cert(&ssl) : nullptr};
+        response.Push<u32>(certificate ? static_cast<u32>(certificate->raw.len) : 0);
+        return {};
+    }
+
+    Result ISslConnection::SetSessionCacheMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        sessionCacheMode = request.Pop<SessionCacheMode>();
+        if (setup)
+            mbedtls_ssl_conf_session_tickets(&config, sessionCacheMode == SessionCacheMode::SessionTicket ? MBEDTLS_SSL_SESSION_TICKETS_ENABLED : MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+        return {};
+    }
+
+    Result ISslConnection::GetSessionCacheMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        response.Push(sessionCacheMode);
+        return {};
+    }
+
+    Result ISslConnection::FlushSessionCache(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        if (!hostName.empty())
+            tls->FlushSession(hostName);
+        return {};
+    }
+
+    Result ISslConnection::SetRenegotiationMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        renegotiationMode = request.Pop<u32>();
+        return {};
+    }
+
+    Result ISslConnection::GetRenegotiationMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        response.Push<u32>(renegotiationMode);
+        return {};
+    }
+
+    Result ISslConnection::SetOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        struct Data {
+            bool value;
+            u8 _pad0_[3];
+            OptionType option;
+        } &data = request.Pop<Data>();
+
+        auto index{static_cast<size_t>(data.option)};
+        if (index < options.size())
+            options.set(index, data.value);
+        return {};
+    }
+
+    Result ISslConnection::GetOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto index{static_cast<size_t>(request.Pop<OptionType>())};
+        response.Push<u8>(index < options.size() && options.test(index));
+        return {};
+    }
+}
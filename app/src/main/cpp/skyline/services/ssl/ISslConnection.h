@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <services/base_service.h>
+#include <services/serviceman.h>
+#include "ISslContext.h"
+
+namespace skyline::service::ssl {
+    /**
+     * @brief ISslConnection is used to transfer data over a TLS connection on a socket (https://switchbrew.org/wiki/SSL_services#ISslConnection)
+     * @details The connection takes a duplicate of the host socket behind the guest's bsd:u descriptor and runs TLS on it with mbedtls, blocking operations wait on the host socket in the same way bsd:u does
+     */
+    class ISslConnection : public BaseService {
+      private:
+        /**
+         * @brief The options that control how the certificates of the server are verified (https://switchbrew.org/wiki/SSL_services#VerifyOption)
+         */
+        union VerifyOption {
+            struct {
+                bool peerCa : 1; //!< If the certificate chain of the server should be verified against the trusted certificates
+                bool hostName : 1; //!< If the host name should be verified against the certificate of the server
+                bool dateCheck : 1; //!< If the validity period of the certificates should be verified
+            };
+            u32 raw;
+        };
+        static_assert(sizeof(VerifyOption) == sizeof(u32));
+
+        /**
+         * @brief If operations on the connection block till they can be completed (https://switchbrew.org/wiki/SSL_services#IoMode)
+         */
+        enum class IoMode : u32 {
+            Blocking = 1,
+            NonBlocking = 2,
+        };
+
+        /**
+         * @brief If and how the TLS session is cached for resumption (https://switchbrew.org/wiki/SSL_services#SessionCacheMode)
+         */
+        enum class SessionCacheMode : u32 {
+            None = 0,
+            SessionId = 1,
+            SessionTicket = 2,
+        };
+
+        /**
+         * @brief The options of a connection which are toggled individually (https://switchbrew.org/wiki/SSL_services#OptionType)
+         */
+        enum class OptionType : u32 {
+            DoNotCloseSocket = 0,
+            GetServerCertChain = 1,
+            SkipDefaultVerify = 2,
+            EnableAlpn = 3,
+        };
+
+        std::shared_ptr<TlsState> tls;
+        std::shared_ptr<ISslContext> context;
+        std::shared_ptr<CertificateChain> chain; //!< The chain of trusted certificates, this is held for as long as the configuration refers to it
+
+        i32 guestFd{-1}; //!< The guest descriptor that was supplied to SetSocketDescriptor
+        int fd{-1}; //!< The host socket the connection is running on, this is owned by the connection
+        std::string hostName;
+        VerifyOption verifyOption{.peerCa = true, .hostName = true};
+        IoMode ioMode{IoMode::Blocking};
+        SessionCacheMode sessionCacheMode{SessionCacheMode::SessionId};
+        u32 renegotiationMode{};
+        std::bitset<32> options{}; //!< The options of the connection indexed by their OptionType
+
+        bool setup{}; //!< If the mbedtls contexts have been set up, this happens on the first operation that requires them
+        bool handshakeDone{};
+        u32 verifyResult{}; //!< The result of verifying the certificates of the server as mbedtls_x509_crt_verify flags
+        std::vector<u8> peeked; //!< Data that has been decrypted by Peek without being consumed, this is returned by Read before any other data
+
+        mbedtls_ssl_config config;
+        mbedtls_ssl_context ssl;
+
+        /**
+         * @brief The BIO callbacks supplied to mbedtls, they transfer data on the non-blocking host socket
+         */
+        static int SendCallback(void *connection, const unsigned char *buffer, size_t size);
+
+        static int ReceiveCallback(void *connection, unsigned char *buffer, size_t size);
+
+        /**
+         * @brief Masks verification failures of a certificate which were disabled by the verify options or SkipDefaultVerify
+         */
+        static int VerifyCallback(void *connection, mbedtls_x509_crt *certificate, int depth, uint32_t *flags);
+
+        /**
+         * @brief Configures mbedtls with the current state of the connection, this is done lazily as the guest changes it up till the handshake
+         */
+        void Setup();
+
+        /**
+         * @brief Runs an mbedtls operation, in blocking mode it's retried whenever the host socket is ready for it till it completes
+         * @return The result of the operation
+         */
+        template<typename Function>
+        int Run(Function operation);
+
+        /**
+         * @brief Runs the handshake with the server, the session is restored from and saved in the cache of the TlsState according to the SessionCacheMode
+         */
+        Result DoHandshakeImpl();
+
+        /**
+         * @return The equivalent HOS result of an mbedtls error code
+         */
+        Result ToResult(int error);
+
+      public:
+        ISslConnection(const DeviceState &state, ServiceManager &manager, std::shared_ptr<TlsState> tls, std::shared_ptr<ISslContext> context);
+
+        ~ISslConnection();
+
+        /**
+         * @brief Sets the bsd:u socket the connection runs on (https://switchbrew.org/wiki/SSL_services#SetSocketDescriptor)
+         */
+        Result SetSocketDescriptor(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Sets the name of the host for SNI and verification (https://switchbrew.org/wiki/SSL_services#SetHostName)
+         */
+        Result SetHostName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Sets which verifications are performed on the certificates of the server (https://switchbrew.org/wiki/SSL_services#SetVerifyOption)
+         */
+        Result SetVerifyOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Sets if operations on the connection block (https://switchbrew.org/wiki/SSL_services#SetIoMode)
+         */
+        Result SetIoMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the guest descriptor of the socket (https://switchbrew.org/wiki/SSL_services#GetSocketDescriptor)
+         */
+        Result GetSocketDescriptor(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the name of the host (https://switchbrew.org/wiki/SSL_services#GetHostName)
+         */
+        Result GetHostName(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the verify options (https://switchbrew.org/wiki/SSL_services#GetVerifyOption)
+         */
+        Result GetVerifyOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the I/O mode (https://switchbrew.org/wiki/SSL_services#GetIoMode)
+         */
+        Result GetIoMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Runs the handshake with the server (https://switchbrew.org/wiki/SSL_services#DoHandshake)
+         */
+        Result DoHandshake(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Runs the handshake with the server and returns its certificate (https://switchbrew.org/wiki/SSL_services#DoHandshakeGetServerCert)
+         */
+        Result DoHandshakeGetServerCert(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Reads decrypted data from the connection (https://switchbrew.org/wiki/SSL_services#Read)
+         */
+        Result Read(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Writes data to be encrypted to the connection (https://switchbrew.org/wiki/SSL_services#Write)
+         */
+        Result Write(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the amount of decrypted data which can be read without blocking (https://switchbrew.org/wiki/SSL_services#Pending)
+         */
+        Result Pending(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Reads decrypted data from the connection without consuming it (https://switchbrew.org/wiki/SSL_services#Peek)
+         */
+        Result Peek(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Waits for the connection to be readable or writable (https://switchbrew.org/wiki/SSL_services#Poll)
+         */
+        Result Poll(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the result of verifying the certificates of the server (https://switchbrew.org/wiki/SSL_services#GetVerifyCertError)
+         */
+        Result GetVerifyCertError(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the size of the buffer required by DoHandshakeGetServerCert (https://switchbrew.org/wiki/SSL_services#GetNeededServerCertBufferSize)
+         */
+        Result GetNeededServerCertBufferSize(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Sets if and how the TLS session is cached (https://switchbrew.org/wiki/SSL_services#SetSessionCacheMode)
+         */
+        Result SetSessionCacheMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the session cache mode (https://switchbrew.org/wiki/SSL_services#GetSessionCacheMode)
+         */
+        Result GetSessionCacheMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Removes the cached session of the host (https://switchbrew.org/wiki/SSL_services#FlushSessionCache)
+         */
+        Result FlushSessionCache(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Sets the renegotiation mode, renegotiation is never initiated so this is only stored (https://switchbrew.org/wiki/SSL_services#SetRenegotiationMode)
+         */
+        Result SetRenegotiationMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the renegotiation mode (https://switchbrew.org/wiki/SSL_services#GetRenegotiationMode)
+         */
+        Result GetRenegotiationMode(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Toggles an option of the connection (https://switchbrew.org/wiki/SSL_services#SetOption_2)
+         */
+        Result SetOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns if an option of the connection is enabled (https://switchbrew.org/wiki/SSL_services#GetOption_2)
+         */
+        Result GetOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, ISslConnection, SetSocketDescriptor),
+            SFUNC(0x1, ISslConnection, SetHostName),
+            SFUNC(0x2, ISslConnection, SetVerifyOption),
+            SFUNC(0x3, ISslConnection, SetIoMode),
+            SFUNC(0x4, ISslConnection, GetSocketDescriptor),
+            SFUNC(0x5, ISslConnection, GetHostName),
+            SFUNC(0x6, ISslConnection, GetVerifyOption),
+            SFUNC(0x7, ISslConnection, GetIoMode),
+            SFUNC(0x8, ISslConnection, DoHandshake),
+            SFUNC(0x9, ISslConnection, DoHandshakeGetServerCert),
+            SFUNC(0xA, ISslConnection, Read),
+            SFUNC(0xB, ISslConnection, Write),
+            SFUNC(0xC, ISslConnection, Pending),
+            SFUNC(0xD, ISslConnection, Peek),
+            SFUNC(0xE, ISslConnection, Poll),
+            SFUNC(0xF, ISslConnection, GetVerifyCertError),
+            SFUNC(0x10, ISslConnection, GetNeededServerCertBufferSize),
+            SFUNC(0x11, ISslConnection, SetSessionCacheMode),
+            SFUNC(0x12, ISslConnection, GetSessionCacheMode),
+            SFUNC(0x13, ISslConnection, FlushSessionCache),
+            SFUNC(0x14, ISslConnection, SetRenegotiationMode),
+            SFUNC(0x15, ISslConnection, GetRenegotiationMode),
+            SFUNC(0x16, ISslConnection, SetOption),
+            SFUNC(0x17, ISslConnection, GetOption)
+        )
+    };
+}
@@ -1,9 +1,101 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <kernel/types/KProcess.h>
+#include "ISslConnection.h"
 #include "ISslContext.h"
 
 namespace skyline::service::ssl {
-    ISslContext::ISslContext(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-    }) {}
+    ISslContext::ISslContext(const DeviceState &state, ServiceManager &manager, std::shared_ptr<TlsState> tls) : tls(std::move(tls)), BaseService(state, manager) {}
+
+    std::shared_ptr<CertificateChain> ISslContext::GetCertificateChain() {
+        std::lock_guard lock(mutex);
+        if (chain)
+            return chain;
+
+        // mbedtls only accepts a single chain of CA certificates, so the host certificates are parsed again into a chain that's exclusive to this context alongside the imported ones
+        chain = std::make_shared<CertificateChain>();
+        auto hostCertificates{tls->GetHostCertificates()};
+        for (auto certificate{&hostCertificates->chain}; certificate && certificate->raw.p; certificate = certificate->next)
+            mbedtls_x509_crt_parse_der(&chain->chain, certificate->raw.p, certificate->raw.len);
+        for (const auto &pki : serverPki)
+            mbedtls_x509_crt_parse_der(&chain->chain, pki.der.data(), pki.der.size());
+
+        return chain;
+    }
+
+    Result ISslContext::SetOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto option{request.Pop<u32>()};
+        auto value{request.Pop<i32>()};
+
+        std::lock_guard lock(mutex);
+        options[option] = value;
+        return {};
+    }
+
+    Result ISslContext::GetOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto option{request.Pop<u32>()};
+
+        std::lock_guard lock(mutex);
+        auto value{options.find(option)};
+        response.Push<i32>(value != options.end() ? value->second : 0);
+        return {};
+    }
+
+    Result ISslContext::CreateConnection(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        manager.RegisterService(std::make_shared<ISslConnection>(state, manager, tls, shared_from_this()), session, response);
+        return {};
+    }
+
+    Result ISslContext::GetConnectionCount(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        response.Push<u32>(connectionCount);
+        return {};
+    }
+
+    Result ISslContext::ImportServerPki(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto format{request.Pop<CertificateFormat>()};
+        auto &buffer{request.inputBuf.at(0)};
+
+        std::vector<u8> data(buffer.size);
+        state.process->ReadMemory(data.data(), buffer.address, buffer.size);
+
+        // Certificates are stored in DER form regardless of the format they were imported in, PEM certificates need to be NUL-terminated for mbedtls to parse them
+        if (format == CertificateFormat::Pem && (data.empty() || data.back() != '\0'))
+            data.push_back('\0');
+
+        CertificateChain certificates;
+        auto result{format == CertificateFormat::Der ? mbedtls_x509_crt_parse_der(&certificates.chain, data.data(), data.size()) : mbedtls_x509_crt_parse(&certificates.chain, data.data(), data.size())};
+        if (result != 0 || certificates.Empty()) {
+            state.logger->Warn("Failed to import server PKI: Format: {}, Error: -0x{:X}", static_cast<u32>(format), -result);
+            return result::InternalError;
+        }
+
+        std::lock_guard lock(mutex);
+        auto id{nextId++};
+        for (auto certificate{&certificates.chain}; certificate && certificate->raw.p; certificate = certificate->next)
+            serverPki.push_back({id, std::vector<u8>(certificate->raw.p, certificate->raw.p + certificate->raw.len)});
+        chain = nullptr;
+
+        response.Push<u64>(id);
+        return {};
+    }
+
+    Result ISslContext::RemoveServerPki(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto id{request.Pop<u64>()};
+
+        std::lock_guard lock(mutex);
+        if (!std::erase_if(serverPki, [id](const ServerPki &pki) { return pki.id == id; }))
+            return result::InternalError;
+        chain = nullptr;
+        return {};
+    }
+
+    Result ISslContext::RegisterInternalPki(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto pki{request.Pop<u32>()};
+        state.logger->Warn("Registering internal PKI {} which isn't available, connections won't present a client certificate", pki);
+
+        std::lock_guard lock(mutex);
+        response.Push<u64>(nextId++);
+        return {};
+    }
 }
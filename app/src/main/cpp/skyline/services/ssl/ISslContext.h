@@ -5,13 +5,100 @@
 
 #include <services/base_service.h>
 #include <services/serviceman.h>
+#include "tls_state.h"
 
 namespace skyline::service::ssl {
+    namespace result {
+        constexpr Result NoSocket(123, 103);
+        constexpr Result InvalidSocket(123, 106);
+        constexpr Result WouldBlock(123, 204);
+        constexpr Result Timeout(123, 205);
+        constexpr Result InternalError(123, 999);
+    }
+
     /**
      * @brief ISslContext is used to manage SSL certificates (https://switchbrew.org/wiki/SSL_services#ISslContext)
+     * @note The trusted CA certificates of the host are used in place of the built-in certificates of HOS
      */
-    class ISslContext : public BaseService {
+    class ISslContext : public BaseService, public std::enable_shared_from_this<ISslContext> {
+      private:
+        /**
+         * @brief The formats of certificates that can be imported (https://switchbrew.org/wiki/SSL_services#CertificateFormat)
+         */
+        enum class CertificateFormat : u32 {
+            Pem = 1,
+            Der = 2,
+        };
+
+        /**
+         * @brief A server certificate imported by the guest
+         */
+        struct ServerPki {
+            u64 id;
+            std::vector<u8> der; //!< The DER encoding of the certificate
+        };
+
+        std::shared_ptr<TlsState> tls;
+        std::mutex mutex; //!< This mutex guards serverPki, nextId and chain
+        std::vector<ServerPki> serverPki;
+        u64 nextId{1}; //!< The ID of the next certificate that's imported
+        std::shared_ptr<CertificateChain> chain; //!< The chain of trusted certificates, this is built when a connection requires it and is reset whenever it's modified
+        std::unordered_map<u32, i32> options; //!< The values of context options set by the guest (https://switchbrew.org/wiki/SSL_services#ContextOption)
+
       public:
-        ISslContext(const DeviceState &state, ServiceManager &manager);
+        std::atomic<u32> connectionCount{}; //!< The amount of connections created from this context which are alive
+
+        ISslContext(const DeviceState &state, ServiceManager &manager, std::shared_ptr<TlsState> tls);
+
+        /**
+         * @return The chain of trusted certificates, this is the trusted certificates of the host followed by any imported server certificates
+         * @note The chain is shared with every connection using it and never modified after it's been built
+         */
+        std::shared_ptr<CertificateChain> GetCertificateChain();
+
+        /**
+         * @brief Sets the value of an option of the context (https://switchbrew.org/wiki/SSL_services#SetOption)
+         */
+        Result SetOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the value of an option of the context (https://switchbrew.org/wiki/SSL_services#GetOption)
+         */
+        Result GetOption(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Creates an ISslConnection using the certificates of this context (https://switchbrew.org/wiki/SSL_services#CreateConnection)
+         */
+        Result CreateConnection(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Returns the amount of connections created from this context which are alive (https://switchbrew.org/wiki/SSL_services#GetConnectionCount)
+         */
+        Result GetConnectionCount(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Imports a CA certificate to be trusted by connections (https://switchbrew.org/wiki/SSL_services#ImportServerPki)
+         */
+        Result ImportServerPki(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Removes a CA certificate imported with ImportServerPki (https://switchbrew.org/wiki/SSL_services#RemoveServerPki)
+         */
+        Result RemoveServerPki(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief Registers a built-in client certificate, these aren't available so this only returns an ID for it (https://switchbrew.org/wiki/SSL_services#RegisterInternalPki)
+         */
+        Result RegisterInternalPki(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, ISslContext, SetOption),
+            SFUNC(0x1, ISslContext, GetOption),
+            SFUNC(0x2, ISslContext, CreateConnection),
+            SFUNC(0x3, ISslContext, GetConnectionCount),
+            SFUNC(0x4, ISslContext, ImportServerPki),
+            SFUNC(0x6, ISslContext, RemoveServerPki),
+            SFUNC(0x8, ISslContext, RegisterInternalPki)
+        )
     };
 }
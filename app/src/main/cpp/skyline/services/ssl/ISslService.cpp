@@ -5,13 +5,10 @@
 #include "ISslService.h"
 
 namespace skyline::service::ssl {
-    ISslService::ISslService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(ISslService::CreateContext)},
-        {0x5, SFUNC(ISslService::SetInterfaceVersion)}
-    }) {}
+    ISslService::ISslService(const DeviceState &state, ServiceManager &manager) : tls(std::make_shared<TlsState>()), BaseService(state, manager) {}
 
     Result ISslService::CreateContext(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        manager.RegisterService(SRVREG(ISslContext), session, response);
+        manager.RegisterService(std::make_shared<ISslContext>(state, manager, tls), session, response);
         return {};
     }
 
@@ -5,12 +5,16 @@
 
 #include <services/base_service.h>
 #include <services/serviceman.h>
+#include "tls_state.h"
 
 namespace skyline::service::ssl {
     /**
      * @brief ISslService or ssl is used by applications to manage SSL connections (https://switchbrew.org/wiki/SSL_services#ssl)
      */
     class ISslService : public BaseService {
+      private:
+        std::shared_ptr<TlsState> tls; //!< The state shared by every context, this includes the session cache so sessions are resumed across contexts
+
       public:
         ISslService(const DeviceState &state, ServiceManager &manager);
 
@@ -23,5 +27,10 @@ namespace skyline::service::ssl {
          * @brief This sets the SSL interface version (https://switchbrew.org/wiki/SSL_services#SetInterfaceVersion)
          */
         Result SetInterfaceVersion(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x0, ISslService, CreateContext),
+            SFUNC(0x5, ISslService, SetInterfaceVersion)
+        )
     };
 }
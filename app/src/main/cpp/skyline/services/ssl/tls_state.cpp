@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "tls_state.h"
+
+namespace skyline::service::ssl {
+    /**
+     * @brief The directories the trusted CA certificates of Android are stored in, they're tried in order till one succeeds
+     * @note Android 14 moved the certificates into the Conscrypt APEX so they could be updated independently
+     */
+    constexpr std::array<const char *, 2> HostCertificatePaths{"/apex/com.android.conscrypt/cacerts", "/system/etc/security/cacerts"};
+
+    TlsState::TlsState() {
+        mbedtls_entropy_init(&entropy);
+        mbedtls_ctr_drbg_init(&drbg);
+
+        constexpr std::string_view Personalization{"skyline-ssl"};
+        if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, reinterpret_cast<const unsigned char *>(Personalization.data()), Personalization.size()))
+            throw exception("Failed to seed the random number generator of SSL");
+    }
+
+    TlsState::~TlsState() {
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+    }
+
+    int TlsState::Random(void *tlsState, unsigned char *output, size_t size) {
+        auto tls{static_cast<TlsState *>(tlsState)};
+        std::lock_guard lock(tls->randomMutex);
+        return mbedtls_ctr_drbg_random(&tls->drbg, output, size);
+    }
+
+    std::shared_ptr<CertificateChain> TlsState::GetHostCertificates() {
+        std::lock_guard lock(certificateMutex);
+        if (hostCertificates)
+            return hostCertificates;
+
+        // A positive result is the amount of certificates that couldn't be parsed, the rest of them are still usable
+        hostCertificates = std::make_shared<CertificateChain>();
+        for (auto path : HostCertificatePaths)
+            if (mbedtls_x509_crt_parse_path(&hostCertificates->chain, path) >= 0 && !hostCertificates->Empty())
+                break;
+
+        return hostCertificates;
+    }
+
+    bool TlsState::RestoreSession(const std::string &host, mbedtls_ssl_context &ssl) {
+        std::lock_guard lock(sessionMutex);
+        auto cached{sessions.find(host)};
+        if (cached == sessions.end())
+            return false;
+
+        cached->second->lastUse = util::GetTimeNs();
+        return mbedtls_ssl_set_session(&ssl, &cached->second->session) == 0;
+    }
+
+    void TlsState::SaveSession(const std::string &host, const mbedtls_ssl_context &ssl) {
+        auto cached{std::make_unique<CachedSession>()};
+        if (mbedtls_ssl_get_session(&ssl, &cached->session))
+            return;
+        cached->lastUse = util::GetTimeNs();
+
+        std::lock_guard lock(sessionMutex);
+        if (sessions.size() >= constant::SslSessionCacheSize && !sessions.contains(host))
+            sessions.erase(std::min_element(sessions.begin(), sessions.end(), [](const auto &a, const auto &b) {
+                return a.second->lastUse < b.second->lastUse;
+            }));
+        sessions[host] = std::move(cached);
+    }
+
+    void TlsState::FlushSession(const std::string &host) {
+        std::lock_guard lock(sessionMutex);
+        sessions.erase(host);
+    }
+}
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/x509_crt.h>
+#include <common.h>
+
+namespace skyline {
+    namespace constant {
+        constexpr size_t SslSessionCacheSize = 0x40; //!< The maximum amount of hosts that TLS sessions are cached for
+    }
+
+    namespace service::ssl {
+        /**
+         * @brief A chain of X.509 certificates
+         */
+        struct CertificateChain {
+            mbedtls_x509_crt chain;
+
+            CertificateChain() {
+                mbedtls_x509_crt_init(&chain);
+            }
+
+            CertificateChain(const CertificateChain &) = delete;
+
+            ~CertificateChain() {
+                mbedtls_x509_crt_free(&chain);
+            }
+
+            /**
+             * @return If the chain doesn't contain any certificates
+             */
+            bool Empty() const {
+                return chain.raw.p == nullptr;
+            }
+        };
+
+        /**
+         * @brief The TlsState class holds state that's shared by all TLS connections of the guest: the random number generator, the trusted certificates of the host and the cache of TLS sessions
+         * @note mbedtls is built without threading support, every shared mbedtls context is guarded by a mutex here
+         */
+        class TlsState {
+          private:
+            /**
+             * @brief A TLS session that was established with a host, it's used to resume the session on the next connection to the host which skips the key exchange
+             */
+            struct CachedSession {
+                mbedtls_ssl_session session;
+                u64 lastUse; //!< The time of the last use of the session in nanoseconds, the least recently used session is evicted when the cache is full
+
+                CachedSession() {
+                    mbedtls_ssl_session_init(&session);
+                }
+
+                CachedSession(const CachedSession &) = delete;
+
+                ~CachedSession() {
+                    mbedtls_ssl_session_free(&session);
+                }
+            };
+
+            std::mutex randomMutex; //!< This mutex guards entropy and drbg
+            mbedtls_entropy_context entropy;
+            mbedtls_ctr_drbg_context drbg;
+
+            std::mutex certificateMutex; //!< This mutex guards hostCertificates
+            std::shared_ptr<CertificateChain> hostCertificates; //!< The trusted CA certificates of the host, these are loaded on first use
+
+            std::mutex sessionMutex; //!< This mutex guards sessions
+            std::unordered_map<std::string, std::unique_ptr<CachedSession>> sessions; //!< The cached TLS sessions by the name of the host they were established with
+
+          public:
+            TlsState();
+
+            ~TlsState();
+
+            /**
+             * @brief Generates random data for mbedtls, this is supplied to mbedtls_ssl_conf_rng with the TlsState as the context
+             */
+            static int Random(void *tlsState, unsigned char *output, size_t size);
+
+            /**
+             * @return The trusted CA certificates of the host, this is empty if they couldn't be loaded
+             */
+            std::shared_ptr<CertificateChain> GetHostCertificates();
+
+            /**
+             * @brief Sets the cached session of a host on an SSL context prior to its handshake, the session is resumed if the host accepts it
+             * @return If there was a cached session for the host
+             */
+            bool RestoreSession(const std::string &host, mbedtls_ssl_context &ssl);
+
+            /**
+             * @brief Caches the session of an SSL context that's completed its handshake with a host
+             */
+            void SaveSession(const std::string &host, const mbedtls_ssl_context &ssl);
+
+            /**
+             * @brief Removes the cached session of a host
+             */
+            void FlushSession(const std::string &host);
+        };
+    }
+}
@@ -4,12 +4,10 @@
 #include "ISteadyClock.h"
 
 namespace skyline::service::timesrv {
-    ISteadyClock::ISteadyClock(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x0, SFUNC(ISteadyClock::GetCurrentTimePoint)}
-    }) {}
+    ISteadyClock::ISteadyClock(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result ISteadyClock::GetCurrentTimePoint(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        response.Push(SteadyClockTimePoint{static_cast<u64>(std::time(nullptr))});
+        response.Push(SteadyClockTimePoint{util::GetTimeNs() / constant::NsInSecond});
         return {};
     }
 }
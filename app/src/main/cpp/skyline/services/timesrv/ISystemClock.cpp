@@ -5,10 +5,7 @@
 #include "ISystemClock.h"
 
 namespace skyline::service::timesrv {
-    ISystemClock::ISystemClock(const SystemClockType clockType, const DeviceState &state, ServiceManager &manager) : type(clockType), BaseService(state, manager, {
-        {0x0, SFUNC(ISystemClock::GetCurrentTime)},
-        {0x2, SFUNC(ISystemClock::GetSystemClockContext)}
-    }) {}
+    ISystemClock::ISystemClock(const SystemClockType clockType, const DeviceState &state, ServiceManager &manager) : type(clockType), BaseService(state, manager) {}
 
     Result ISystemClock::GetCurrentTime(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         response.Push<u64>(static_cast<u64>(std::time(nullptr)));
@@ -16,8 +13,10 @@ namespace skyline::service::timesrv {
     }
 
     Result ISystemClock::GetSystemClockContext(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        response.Push<u64>(static_cast<u64>(std::time(nullptr)));
-        response.Push(SteadyClockTimePoint{static_cast<u64>(std::time(nullptr))});
+        // The context is the offset of the system clock from the steady clock, along with the steady clock timepoint it was taken at
+        auto timepoint{util::GetTimeNs() / constant::NsInSecond};
+        response.Push<u64>(static_cast<u64>(std::time(nullptr)) - timepoint);
+        response.Push(SteadyClockTimePoint{timepoint});
         return {};
     }
 }
@@ -1,34 +1,176 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <ctime>
+#include <kernel/types/KProcess.h>
 #include "ITimeZoneService.h"
 
 namespace skyline::service::timesrv {
-    ITimeZoneService::ITimeZoneService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager, {
-        {0x65, SFUNC(ITimeZoneService::ToCalendarTimeWithMyRule)}
-    }) {}
+    namespace {
+        constexpr i64 SecondsInDay{24 * 60 * 60};
+        constexpr i64 ProbeStart{0}; //!< 1970-01-01, the host's rules are only probed from the start of the epoch
+        constexpr i64 ProbeEnd{4102444800}; //!< 2100-01-01
+        constexpr i64 ProbeInterval{7 * SecondsInDay}; //!< The interval at which the host's rules are probed, time zones don't have multiple transitions within a week
+
+        TimeZoneRules::Transition ProbeHostRules(i64 time) {
+            auto posixTime{static_cast<time_t>(time)};
+            std::tm calendar{};
+            localtime_r(&posixTime, &calendar);
+
+            TimeZoneRules::Transition transition{.time = time, .offset = static_cast<i32>(calendar.tm_gmtoff), .dst = calendar.tm_isdst > 0};
+            if (calendar.tm_zone)
+                std::strncpy(reinterpret_cast<char *>(&transition.name), calendar.tm_zone, sizeof(transition.name));
+            return transition;
+        }
+
+        bool IsSameRule(const TimeZoneRules::Transition &a, const TimeZoneRules::Transition &b) {
+            return a.offset == b.offset && a.dst == b.dst && a.name == b.name;
+        }
+
+        /**
+         * @return The amount of days since the epoch of a date in the proleptic Gregorian calendar (http://howardhinnant.github.io/date_algorithms.html#days_from_civil)
+         */
+        constexpr i64 DaysFromCivil(i64 year, u32 month, u32 day) {
+            year -= month <= 2;
+            auto era{(year >= 0 ? year : year - 399) / 400};
+            auto yearOfEra{static_cast<u32>(year - era * 400)};
+            auto dayOfYear{(153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1};
+            auto dayOfEra{yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear};
+            return era * 146097 + static_cast<i64>(dayOfEra) - 719468;
+        }
+
+        /**
+         * @brief A date in the proleptic Gregorian calendar
+         */
+        struct CivilDate {
+            i64 year;
+            u32 month; //!< The month of the year from 1 to 12
+            u32 day; //!< The day of the month from 1 to 31
+        };
+
+        /**
+         * @return The date that's the supplied amount of days since the epoch (http://howardhinnant.github.io/date_algorithms.html#civil_from_days)
+         */
+        constexpr CivilDate CivilFromDays(i64 days) {
+            days += 719468;
+            auto era{(days >= 0 ? days : days - 146096) / 146097};
+            auto dayOfEra{static_cast<u32>(days - era * 146097)};
+            auto yearOfEra{(dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365};
+            auto dayOfYear{dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100)};
+            auto monthPosition{(5 * dayOfYear + 2) / 153};
+            auto month{monthPosition < 10 ? monthPosition + 3 : monthPosition - 9};
+            return CivilDate{static_cast<i64>(yearOfEra) + era * 400 + (month <= 2), month, dayOfYear - (153 * monthPosition + 2) / 5 + 1};
+        }
+
+        static_assert(DaysFromCivil(2000, 3, 1) == 11017);
+        static_assert(CivilFromDays(11017).year == 2000 && CivilFromDays(11017).month == 3 && CivilFromDays(11017).day == 1);
+    }
+
+    TimeZoneRules::TimeZoneRules() {
+        auto previous{ProbeHostRules(ProbeStart)};
+        transitions.push_back(previous);
+        transitions.back().time = std::numeric_limits<i64>::min();
+
+        for (auto time{ProbeStart + ProbeInterval}; time < ProbeEnd; time += ProbeInterval) {
+            auto current{ProbeHostRules(time)};
+            if (IsSameRule(previous, current))
+                continue;
+
+            // The exact second of the transition is bisected, the rule at 'low' is always the previous one and the rule at 'high' the current one
+            auto low{time - ProbeInterval}, high{time};
+            while (high - low > 1) {
+                auto middle{low + (high - low) / 2};
+                if (IsSameRule(ProbeHostRules(middle), previous))
+                    low = middle;
+                else
+                    high = middle;
+            }
+
+            current.time = high;
+            transitions.push_back(current);
+            previous = current;
+        }
+    }
+
+    const TimeZoneRules::Transition &TimeZoneRules::Find(i64 time) const {
+        auto index{cachedIndex.load(std::memory_order_relaxed)};
+        if (time >= transitions[index].time && (index + 1 == transitions.size() || time < transitions[index + 1].time))
+            return transitions[index];
+
+        auto next{std::upper_bound(transitions.begin(), transitions.end(), time, [](i64 time, const Transition &transition) {
+            return time < transition.time;
+        })};
+        index = static_cast<size_t>(std::distance(transitions.begin(), next)) - 1;
+        cachedIndex.store(index, std::memory_order_relaxed);
+        return transitions[index];
+    }
+
+    std::span<const TimeZoneRules::Transition> TimeZoneRules::FindAround(i64 localTime) const {
+        // A local time can only be affected by the transition it falls into when it's treated as UTC and its neighbors, as offsets are always less than a day and transitions are further apart than that
+        auto index{static_cast<size_t>(&Find(localTime) - transitions.data())};
+        auto first{index ? index - 1 : index};
+        auto last{std::min(index + 2, transitions.size())};
+        return std::span(transitions).subspan(first, last - first);
+    }
+
+    const TimeZoneRules &TimeZoneRules::Host() {
+        static const TimeZoneRules rules;
+        return rules;
+    }
+
+    ITimeZoneService::ITimeZoneService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager), rules(TimeZoneRules::Host()) {}
 
     Result ITimeZoneService::ToCalendarTimeWithMyRule(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
-        auto curTime = std::time(nullptr);
-        auto calender = *std::gmtime(&curTime);
+        auto posixTime{request.Pop<i64>()};
+        const auto &transition{rules.Find(posixTime)};
+
+        auto localTime{posixTime + transition.offset};
+        auto days{localTime / SecondsInDay - (localTime % SecondsInDay < 0)};
+        auto secondOfDay{localTime - (days * SecondsInDay)};
+        auto date{CivilFromDays(days)};
 
         CalendarTime calendarTime{
-            .year = static_cast<u16>(calender.tm_year),
-            .month = static_cast<u8>(calender.tm_mon),
-            .day = static_cast<u8>(calender.tm_hour),
-            .minute = static_cast<u8>(calender.tm_min),
-            .second = static_cast<u8>(calender.tm_sec),
+            .year = static_cast<u16>(date.year),
+            .month = static_cast<u8>(date.month),
+            .day = static_cast<u8>(date.day),
+            .hour = static_cast<u8>(secondOfDay / 3600),
+            .minute = static_cast<u8>((secondOfDay / 60) % 60),
+            .second = static_cast<u8>(secondOfDay % 60),
         };
         response.Push(calendarTime);
 
         CalendarAdditionalInfo calendarInfo{
-            .dayWeek = static_cast<u32>(calender.tm_wday),
-            .dayMonth = static_cast<u32>(calender.tm_mday),
-            .name = *reinterpret_cast<const u64 *>(calender.tm_zone),
-            .dst = static_cast<i32>(calender.tm_isdst),
-            .utcRel = static_cast<u32>(calender.tm_gmtoff),
+            .dayWeek = static_cast<u32>(((days % 7) + 11) % 7), // 1970-01-01 was a Thursday
+            .dayYear = static_cast<u32>(days - DaysFromCivil(date.year, 1, 1)),
+            .name = transition.name,
+            .dst = transition.dst,
+            .utcRel = transition.offset,
         };
         response.Push(calendarInfo);
         return {};
     }
+
+    Result ITimeZoneService::ToPosixTimeWithMyRule(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
+        auto calendarTime{request.Pop<CalendarTime>()};
+        auto localTime{DaysFromCivil(calendarTime.year, calendarTime.month, calendarTime.day) * SecondsInDay + calendarTime.hour * 3600 + calendarTime.minute * 60 + calendarTime.second};
+
+        // A candidate is only valid if the offset it was converted with is the one in effect at the resulting time
+        std::array<i64, 2> posixTimes{};
+        u32 count{};
+        for (const auto &transition : rules.FindAround(localTime)) {
+            auto posixTime{localTime - transition.offset};
+            if (count < posixTimes.size() && rules.Find(posixTime).offset == transition.offset && std::find(posixTimes.begin(), posixTimes.begin() + count, posixTime) == posixTimes.begin() + count)
+                posixTimes[count++] = posixTime;
+        }
+        std::sort(posixTimes.begin(), posixTimes.begin() + count);
+
+        if (!request.outputBuf.empty()) {
+            count = std::min(count, static_cast<u32>(request.outputBuf.at(0).size / sizeof(i64)));
+            state.process->WriteMemory(posixTimes.data(), request.outputBuf.at(0).address, count * sizeof(i64));
+        } else {
+            count = 0;
+        }
+        response.Push(count);
+        return {};
+    }
 }
@@ -7,6 +7,45 @@
 #include <services/serviceman.h>
 
 namespace skyline::service::timesrv {
+    /**
+     * @brief The TimeZoneRules class holds the rules of the host's time zone compiled into a table of transitions, so converting a time only requires a lookup in it rather than libc evaluating the time zone
+     * @details The table is compiled by probing the host's rules once a week between 1970 and 2100 and bisecting every change down to the second, times outside of it use the closest entry. The transition covering the last converted time is cached as games generally convert the current time every frame
+     */
+    class TimeZoneRules {
+      public:
+        /**
+         * @brief A change in the offset from UTC of the time zone, this is in effect till the next transition
+         */
+        struct Transition {
+            i64 time; //!< The POSIX time at which the transition takes effect
+            i32 offset; //!< The offset from UTC in seconds
+            i32 dst; //!< If DST is in effect
+            u64 name; //!< The abbreviation of the time zone name, this is padded with NULs
+        };
+
+      private:
+        std::vector<Transition> transitions; //!< All transitions in increasing order of time, the first one is at the minimum time so every time is covered by one
+        mutable std::atomic<size_t> cachedIndex{}; //!< The index of the transition that the last lookup resolved to
+
+      public:
+        TimeZoneRules();
+
+        /**
+         * @return The transition that's in effect at the supplied POSIX time
+         */
+        const Transition &Find(i64 time) const;
+
+        /**
+         * @return The transitions that are effective around the supplied local time as if it was in UTC, these are the only candidates for converting it into a POSIX time
+         */
+        std::span<const Transition> FindAround(i64 localTime) const;
+
+        /**
+         * @return The rules of the host's time zone, these are compiled on the first call
+         */
+        static const TimeZoneRules &Host();
+    };
+
     /**
      * @brief ITimeZoneService is used to retrieve and set time (https://switchbrew.org/wiki/PSC_services#ITimeZoneService)
      */
@@ -31,13 +70,15 @@ namespace skyline::service::timesrv {
          */
         struct CalendarAdditionalInfo {
             u32 dayWeek; //!< The amount of days since Sunday
-            u32 dayMonth; //!< The amount of days since the start of the month
+            u32 dayYear; //!< The amount of days since the start of the year
             u64 name; //!< The name of the time zone
             i32 dst; //!< If DST is in effect or not
-            u32 utcRel; //!< The offset of the time from GMT in seconds
+            i32 utcRel; //!< The offset of the time from GMT in seconds
         };
         static_assert(sizeof(CalendarAdditionalInfo) == 0x18);
 
+        const TimeZoneRules &rules; //!< The rules of the device's time zone, this is always the host's time zone
+
       public:
         ITimeZoneService(const DeviceState &state, ServiceManager &manager);
 
@@ -45,5 +86,15 @@ namespace skyline::service::timesrv {
          * @brief This receives a u64 #PosixTime (https://switchbrew.org/wiki/PSC_services#PosixTime), and returns a #CalendarTime (https://switchbrew.org/wiki/PSC_services#CalendarTime), #CalendarAdditionalInfo (https://switchbrew.org/wiki/PSC_services#CalendarAdditionalInfo)
          */
         Result ToCalendarTimeWithMyRule(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        /**
+         * @brief This receives a #CalendarTime in the device's time zone and writes every #PosixTime it corresponds to into a buffer, this is 0 times during a forward transition and 2 during a backward one (https://switchbrew.org/wiki/PSC_services#ToPosixTimeWithMyRule)
+         */
+        Result ToPosixTimeWithMyRule(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x65, ITimeZoneService, ToCalendarTimeWithMyRule),
+            SFUNC(0xCA, ITimeZoneService, ToPosixTimeWithMyRule)
+        )
     };
 }
@@ -6,7 +6,7 @@
 #include "IDisplayService.h"
 
 namespace skyline::service::visrv {
-    IDisplayService::IDisplayService(const DeviceState &state, ServiceManager &manager, const std::unordered_map<u32, std::function<Result(type::KSession &, ipc::IpcRequest &, ipc::IpcResponse &)>> &vTable) : BaseService(state, manager, vTable) {}
+    IDisplayService::IDisplayService(const DeviceState &state, ServiceManager &manager) : BaseService(state, manager) {}
 
     Result IDisplayService::CreateStrayLayer(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         request.Skip<u64>();
@@ -21,7 +21,7 @@ namespace skyline::service::visrv {
 
         response.Push<u64>(0); // There's only one layer
 
-        Parcel parcel(state);
+        Parcel parcel(request.outputBuf.at(0), state);
         LayerParcel data{
             .type = 0x2,
             .pid = 0,
@@ -30,7 +30,7 @@ namespace skyline::service::visrv {
         };
         parcel.Push(data);
 
-        response.Push<u64>(parcel.WriteParcel(request.outputBuf.at(0)));
+        response.Push<u64>(parcel.WriteParcel());
         return {};
     }
 
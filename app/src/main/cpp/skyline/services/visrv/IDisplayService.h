@@ -27,7 +27,7 @@ namespace skyline::service::visrv {
         static_assert(sizeof(LayerParcel) == 0x28);
 
       public:
-        IDisplayService(const DeviceState &state, ServiceManager &manager, const std::unordered_map<u32, std::function<Result(type::KSession & , ipc::IpcRequest & , ipc::IpcResponse & )>> &vTable);
+        IDisplayService(const DeviceState &state, ServiceManager &manager);
 
         /**
          * @brief This creates a stray layer using a display's ID and returns a layer ID and the corresponding buffer ID
@@ -27,5 +27,12 @@ namespace skyline::service::visrv {
          * @brief This takes a layer's ID and adds it to the layer stack
          */
         Result AddToLayerStack(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x7DA, IManagerDisplayService, CreateManagedLayer),
+            SFUNC(0x7DB, IManagerDisplayService, DestroyManagedLayer),
+            SFUNC_BASE(0x7DC, IManagerDisplayService, IDisplayService, CreateStrayLayer),
+            SFUNC(0x1770, IManagerDisplayService, AddToLayerStack)
+        )
     };
 }
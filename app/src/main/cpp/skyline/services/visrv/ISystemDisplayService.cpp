@@ -4,10 +4,7 @@
 #include "ISystemDisplayService.h"
 
 namespace skyline::service::visrv {
-    ISystemDisplayService::ISystemDisplayService(const DeviceState &state, ServiceManager &manager) : IDisplayService(state, manager, {
-        {0x89D, SFUNC(ISystemDisplayService::SetLayerZ)},
-        {0x908, SFUNC(IDisplayService::CreateStrayLayer)}
-    }) {}
+    ISystemDisplayService::ISystemDisplayService(const DeviceState &state, ServiceManager &manager) : IDisplayService(state, manager) {}
 
     Result ISystemDisplayService::SetLayerZ(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response) {
         return {};
@@ -17,5 +17,10 @@ namespace skyline::service::visrv {
          * @brief Sets the Z index of a layer
          */
         Result SetLayerZ(type::KSession &session, ipc::IpcRequest &request, ipc::IpcResponse &response);
+
+        SERVICE_DECL(
+            SFUNC(0x89D, ISystemDisplayService, SetLayerZ),
+            SFUNC_BASE(0x908, ISystemDisplayService, IDisplayService, CreateStrayLayer)
+        )
     };
 }
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <cmath>
+#include <dlfcn.h>
+#include "thermal.h"
+
+namespace skyline::thermal {
+    HeadroomMonitor::HeadroomMonitor() {
+        // libandroid is always loaded into an application so this only retrieves a handle to it, it's never closed
+        auto library{dlopen("libandroid.so", RTLD_NOW | RTLD_NOLOAD)};
+        if (!library)
+            return;
+
+        auto acquireManager{reinterpret_cast<AcquireManagerFunction>(dlsym(library, "AThermal_acquireManager"))};
+        releaseManager = reinterpret_cast<ReleaseManagerFunction>(dlsym(library, "AThermal_releaseManager"));
+        getHeadroom = reinterpret_cast<GetHeadroomFunction>(dlsym(library, "AThermal_getThermalHeadroom"));
+        if (acquireManager && releaseManager && getHeadroom)
+            manager = acquireManager();
+    }
+
+    HeadroomMonitor::~HeadroomMonitor() {
+        if (manager)
+            releaseManager(manager);
+    }
+
+    bool HeadroomMonitor::Update() {
+        if (!manager)
+            return false;
+
+        auto now{util::GetTimeNs()};
+        if (now - pollTimestamp < constant::PollInterval)
+            return false;
+        pollTimestamp = now;
+
+        // The headroom is NaN when it couldn't be determined or the call was rate-limited, the previous state is retained in that case
+        auto polledHeadroom{getHeadroom(manager, constant::ForecastSeconds)};
+        if (std::isnan(polledHeadroom))
+            return false;
+        headroom = polledHeadroom;
+
+        bool wasThrottling{throttling};
+        if (throttling)
+            throttling = headroom >= constant::RecoverHeadroom;
+        else
+            throttling = headroom >= constant::ThrottleHeadroom;
+        return throttling != wasThrottling;
+    }
+}
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+struct AThermalManager;
+
+namespace skyline::thermal {
+    namespace constant {
+        constexpr u64 PollInterval{2'000'000'000}; //!< The interval at which the thermal headroom is polled in nanoseconds, the system rate-limits this to about once a second
+        constexpr i32 ForecastSeconds{10}; //!< The amount of seconds ahead that the thermal headroom is forecast for, this is far enough ahead to act before throttling starts
+        constexpr float ThrottleHeadroom{0.9f}; //!< The headroom at or above which the device is considered to be about to throttle, 1.0 is where the system starts throttling
+        constexpr float RecoverHeadroom{0.75f}; //!< The headroom below which the device is considered to have recovered, this is lower than ThrottleHeadroom so the state doesn't oscillate
+    }
+
+    /**
+     * @brief The HeadroomMonitor class polls the forecast thermal headroom of the device and decides when the emulator should reduce its work ahead of the system throttling
+     * @details The thermal API is only available from API 31 onwards, so it's loaded from libandroid at runtime and the device is never considered to be throttling when it isn't present
+     * @note This must only be used from a single thread
+     */
+    class HeadroomMonitor {
+      private:
+        using AcquireManagerFunction = AThermalManager *(*)();
+        using ReleaseManagerFunction = void (*)(AThermalManager *);
+        using GetHeadroomFunction = float (*)(AThermalManager *, int);
+
+        AThermalManager *manager{};
+        ReleaseManagerFunction releaseManager{};
+        GetHeadroomFunction getHeadroom{};
+
+        u64 pollTimestamp{}; //!< The time at which the headroom was last polled
+        float headroom{}; //!< The most recently polled headroom, this is 0 if it hasn't been polled or couldn't be determined
+        bool throttling{}; //!< If the device is considered to be about to throttle
+
+      public:
+        HeadroomMonitor();
+
+        ~HeadroomMonitor();
+
+        /**
+         * @brief Polls the thermal headroom if it's due and updates if the device is considered to be about to throttle
+         * @return If the throttling state changed after this update
+         */
+        bool Update();
+
+        /**
+         * @return If the device is considered to be about to throttle
+         */
+        bool IsThrottling() const {
+            return throttling;
+        }
+
+        /**
+         * @return The most recently polled headroom
+         */
+        float GetHeadroom() const {
+            return headroom;
+        }
+    };
+}
@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <dlfcn.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/sched.h>
+#include "thread_priority.h"
+
+namespace skyline::priority {
+    HintSession Hints;
+
+    /**
+     * @brief The attributes passed to sched_setattr, this is declared here as the UAPI header declaring it conflicts with the libc declaration of sched_param
+     */
+    struct SchedAttributes {
+        u32 size;
+        u32 policy;
+        u64 flags;
+        i32 nice;
+        u32 priority;
+        u64 runtime;
+        u64 deadline;
+        u64 period;
+        u32 utilMin;
+        u32 utilMax;
+    };
+    static_assert(sizeof(SchedAttributes) == 0x38); // SCHED_ATTR_SIZE_VER1
+
+    Scheduling PromoteThread(ThreadClass threadClass) {
+        // Display threads aren't made real-time as they do a frame's worth of work at a time, that would starve every other thread on the core including the audio ones
+        if (threadClass == ThreadClass::Audio) {
+            sched_param param{.sched_priority = constant::AudioFifoPriority};
+            if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) == 0)
+                return Scheduling::Fifo;
+        }
+
+        if (setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), threadClass == ThreadClass::Audio ? constant::AudioNice : constant::DisplayNice) == 0)
+            return Scheduling::Nice;
+        return Scheduling::Default;
+    }
+
+    const char *GetSchedulingName(Scheduling scheduling) {
+        switch (scheduling) {
+            case Scheduling::Fifo:
+                return "SCHED_FIFO";
+            case Scheduling::Nice:
+                return "Nice";
+            case Scheduling::Default:
+                return "Default";
+        }
+        return "Unknown";
+    }
+
+    HostCoreMap::HostCoreMap() {
+        CPU_ZERO(&big);
+        CPU_ZERO(&little);
+        CPU_ZERO(&all);
+
+        // Cores which are offline or don't expose their frequency are skipped rather than being treated as the slowest ones, they'd end up in the little group otherwise
+        std::vector<std::pair<size_t, u64>> frequencies;
+        auto cores{std::clamp(sysconf(_SC_NPROCESSORS_CONF), 1L, static_cast<long>(CPU_SETSIZE))};
+        for (size_t core{}; core < static_cast<size_t>(cores); core++) {
+            CPU_SET(core, &all);
+
+            u64 frequency{};
+            if (std::ifstream(fmt::format("/sys/devices/system/cpu/cpu{}/cpufreq/cpuinfo_max_freq", core)) >> frequency && frequency)
+                frequencies.emplace_back(core, frequency);
+        }
+
+        // If no core has a readable frequency, they're all treated as equal which puts every core in both groups
+        if (frequencies.empty()) {
+            for (size_t core{}; core < static_cast<size_t>(cores); core++) {
+                CPU_SET(core, &big);
+                CPU_SET(core, &little);
+            }
+            return;
+        }
+
+        auto[lowest, highest]{std::minmax_element(frequencies.begin(), frequencies.end(), [](const auto &a, const auto &b) { return a.second < b.second; })};
+        for (const auto &[core, frequency] : frequencies) {
+            if (frequency == highest->second)
+                CPU_SET(core, &big);
+            if (frequency == lowest->second)
+                CPU_SET(core, &little);
+        }
+    }
+
+    const HostCoreMap &GetHostCoreMap() {
+        static const HostCoreMap hostCoreMap;
+        return hostCoreMap;
+    }
+
+    void HintSession::Load() {
+        loaded = true;
+
+        // libandroid is always loaded into an application so this only retrieves a handle to it, it's never closed
+        auto library{dlopen("libandroid.so", RTLD_NOW | RTLD_NOLOAD)};
+        if (!library)
+            return;
+
+        auto getManager{reinterpret_cast<GetManagerFunction>(dlsym(library, "APerformanceHint_getManager"))};
+        createSession = reinterpret_cast<CreateSessionFunction>(dlsym(library, "APerformanceHint_createSession"));
+        updateTarget = reinterpret_cast<UpdateTargetFunction>(dlsym(library, "APerformanceHint_updateTargetWorkDuration"));
+        reportDuration = reinterpret_cast<ReportDurationFunction>(dlsym(library, "APerformanceHint_reportActualWorkDuration"));
+        closeSession = reinterpret_cast<CloseSessionFunction>(dlsym(library, "APerformanceHint_closeSession"));
+        setPreferPowerEfficiency = reinterpret_cast<SetPreferPowerEfficiencyFunction>(dlsym(library, "APerformanceHint_setPreferPowerEfficiency"));
+        if (getManager && createSession && updateTarget && reportDuration && closeSession)
+            manager = getManager();
+    }
+
+    void HintSession::Recreate() {
+        if (session)
+            closeSession(session);
+        session = threads.empty() ? nullptr : createSession(manager, threads.data(), threads.size(), static_cast<i64>(targetDuration));
+        if (session && boosted && setPreferPowerEfficiency)
+            setPreferPowerEfficiency(session, false);
+    }
+
+    void HintSession::ApplyBoost(i32 tid) {
+        // The utilization clamp isn't permission checked but is limited by the cgroup of the thread, failures are ignored as this is only a hint
+        SchedAttributes attributes{
+            .size = sizeof(SchedAttributes),
+            .flags = SCHED_FLAG_KEEP_ALL | SCHED_FLAG_UTIL_CLAMP_MIN,
+            .utilMin = boosted ? constant::BoostUtilClamp : 0,
+        };
+        syscall(__NR_sched_setattr, tid, &attributes, 0);
+
+        const auto &hostCores{GetHostCoreMap()};
+        sched_setaffinity(tid, sizeof(cpu_set_t), boosted ? &hostCores.big : &hostCores.all);
+    }
+
+    HintSession::~HintSession() {
+        Reset();
+    }
+
+    void HintSession::AddThread() {
+        std::lock_guard lock(mutex);
+        if (!loaded)
+            Load();
+
+        auto tid{static_cast<i32>(gettid())};
+        if (std::find(threads.begin(), threads.end(), tid) != threads.end())
+            return;
+        threads.push_back(tid);
+        if (boosted)
+            ApplyBoost(tid);
+        if (manager)
+            Recreate();
+    }
+
+    void HintSession::RemoveThread() {
+        std::lock_guard lock(mutex);
+        auto thread{std::find(threads.begin(), threads.end(), static_cast<i32>(gettid()))};
+        if (thread == threads.end())
+            return;
+        threads.erase(thread);
+        if (manager)
+            Recreate();
+    }
+
+    void HintSession::SetTargetDuration(u64 duration) {
+        std::lock_guard lock(mutex);
+        if (duration == targetDuration)
+            return;
+
+        targetDuration = duration;
+        if (session)
+            updateTarget(session, static_cast<i64>(duration));
+    }
+
+    void HintSession::ReportDuration(u64 duration) {
+        std::lock_guard lock(mutex);
+        if (session && duration)
+            reportDuration(session, static_cast<i64>(duration));
+    }
+
+    void HintSession::SetBoost(bool boost) {
+        std::lock_guard lock(mutex);
+        if (boost == boosted)
+            return;
+
+        boosted = boost;
+        for (auto tid : threads)
+            ApplyBoost(tid);
+        if (session && setPreferPowerEfficiency)
+            setPreferPowerEfficiency(session, !boost);
+    }
+
+    void HintSession::Reset() {
+        std::lock_guard lock(mutex);
+        if (session)
+            closeSession(session);
+        session = nullptr;
+        threads.clear();
+        targetDuration = constant::DefaultFrameDuration;
+        boosted = false;
+    }
+}
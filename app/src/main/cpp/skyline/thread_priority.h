@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <sched.h>
+#include <common.h>
+
+struct APerformanceHintManager;
+struct APerformanceHintSession;
+
+namespace skyline::priority {
+    namespace constant {
+        constexpr i32 AudioNice{-19}; //!< The nice value of audio threads when they can't be made real-time, this is ANDROID_PRIORITY_URGENT_AUDIO
+        constexpr i32 DisplayNice{-10}; //!< The nice value of threads which produce frames when they can't be made real-time, this is between ANDROID_PRIORITY_URGENT_DISPLAY and ANDROID_PRIORITY_AUDIO
+        constexpr i32 AudioFifoPriority{2}; //!< The SCHED_FIFO priority of audio threads, this is the lowest real-time priority above what the audio HAL uses for clients
+        constexpr u64 DefaultFrameDuration{16'666'666}; //!< The target duration of a frame's work prior to one being presented in nanoseconds
+        constexpr u32 BoostUtilClamp{768}; //!< The minimum utilization clamp of the threads in the hint session while boosted, out of 1024
+    }
+
+    /**
+     * @brief The kinds of host threads that are scheduled above the rest of the emulator
+     */
+    enum class ThreadClass : u8 {
+        Audio, //!< A thread that renders audio, missing its deadline causes an audible underrun
+        Display, //!< A thread that's on the critical path of presenting frames
+    };
+
+    /**
+     * @brief The scheduling that a thread ended up with after being promoted
+     */
+    enum class Scheduling : u8 {
+        Fifo, //!< The thread is real-time with SCHED_FIFO
+        Nice, //!< The thread has the nice value of its class as SCHED_FIFO wasn't permitted
+        Default, //!< Neither were permitted and the thread kept its scheduling
+    };
+
+    /**
+     * @brief Promotes the calling thread to the scheduling of the supplied class, SCHED_FIFO is tried first and the nice value of the class is used when it isn't permitted
+     * @note SCHED_FIFO requires CAP_SYS_NICE or an RLIMIT_RTPRIO that permits it which applications generally don't have, the nice value is a fallback that's always attempted
+     */
+    Scheduling PromoteThread(ThreadClass threadClass);
+
+    /**
+     * @return A human-readable name for the supplied scheduling
+     */
+    const char *GetSchedulingName(Scheduling scheduling);
+
+    /**
+     * @brief This holds the host CPU cores grouped by their maximum frequency
+     */
+    struct HostCoreMap {
+        cpu_set_t big; //!< The host cores with the highest maximum frequency
+        cpu_set_t little; //!< The host cores with the lowest maximum frequency
+        cpu_set_t all; //!< All host cores
+
+        HostCoreMap();
+    };
+
+    /**
+     * @return The host core map, the host topology doesn't change so it's only read once
+     */
+    const HostCoreMap &GetHostCoreMap();
+
+    /**
+     * @brief The HintSession class groups the threads that produce frames (The SVC workers, the GPFIFO worker and the presentation thread) into a single session of the Performance Hint API, it's fed the actual duration of every frame's work so the system can adjust the clocks of the cores that they run on
+     * @details The API is only available from API 33 onwards, so it's loaded from libandroid at runtime and the session is a no-op when it isn't present. A session's threads can't be changed prior to API 34 so it's recreated whenever a thread is added or removed
+     * @details The session can be boosted while the guest requests a boost performance configuration (Such as during loading screens), this moves its threads onto the big cores with a higher minimum utilization clamp and stops the system from preferring power efficiency for them
+     */
+    class HintSession {
+      private:
+        using GetManagerFunction = APerformanceHintManager *(*)();
+        using CreateSessionFunction = APerformanceHintSession *(*)(APerformanceHintManager *, const i32 *, size_t, i64);
+        using UpdateTargetFunction = int (*)(APerformanceHintSession *, i64);
+        using ReportDurationFunction = int (*)(APerformanceHintSession *, i64);
+        using CloseSessionFunction = void (*)(APerformanceHintSession *);
+        using SetPreferPowerEfficiencyFunction = int (*)(APerformanceHintSession *, bool);
+
+        std::mutex mutex;
+        bool loaded{}; //!< If loading the API has been attempted, this is done on the first thread being added
+        APerformanceHintManager *manager{};
+        CreateSessionFunction createSession{};
+        UpdateTargetFunction updateTarget{};
+        ReportDurationFunction reportDuration{};
+        CloseSessionFunction closeSession{};
+        SetPreferPowerEfficiencyFunction setPreferPowerEfficiency{}; //!< This is only available from API 35 onwards, it's optional unlike the rest
+
+        APerformanceHintSession *session{};
+        std::vector<i32> threads; //!< The TIDs of all threads that are in the session, these are tracked even if the API isn't present so they can be boosted
+        u64 targetDuration{constant::DefaultFrameDuration};
+        bool boosted{};
+
+        /**
+         * @brief Loads the functions of the Performance Hint API if they're present, this must be called with the mutex held
+         */
+        void Load();
+
+        /**
+         * @brief Replaces the session with one for the current set of threads, this must be called with the mutex held
+         */
+        void Recreate();
+
+        /**
+         * @brief Applies the placement and utilization clamp for the current boost state to a thread, this must be called with the mutex held
+         */
+        void ApplyBoost(i32 tid);
+
+      public:
+        ~HintSession();
+
+        /**
+         * @brief Adds the calling thread to the session, this is a no-op if it has already been added
+         */
+        void AddThread();
+
+        /**
+         * @brief Removes the calling thread from the session, this must be done prior to a thread that was added exiting as a session can't be created with threads that don't exist
+         */
+        void RemoveThread();
+
+        /**
+         * @brief Updates the duration which the work of every frame should be done within
+         * @param duration The target duration in nanoseconds
+         */
+        void SetTargetDuration(u64 duration);
+
+        /**
+         * @brief Reports the duration of the work that was done to produce a frame
+         * @param duration The duration in nanoseconds
+         */
+        void ReportDuration(u64 duration);
+
+        /**
+         * @brief Boosts the threads in the session or returns them to their default placement
+         * @note Threads added while the session is boosted are boosted as well
+         */
+        void SetBoost(bool boost);
+
+        /**
+         * @brief Closes the session and forgets about all of its threads, this should be done prior to emulation starting
+         */
+        void Reset();
+    };
+
+    extern HintSession Hints; //!< The performance hint session for the emulation session, this is a global as it's shared between the emulation and GPU threads
+}
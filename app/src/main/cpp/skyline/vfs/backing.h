@@ -4,6 +4,7 @@
 #pragma once
 
 #include <common.h>
+#include <footprint.h>
 
 namespace skyline::vfs {
     /**
@@ -62,6 +63,17 @@ namespace skyline::vfs {
             return Read(reinterpret_cast<u8 *>(output), offset, size ? size : sizeof(T));
         }
 
+        /**
+         * @brief Returns a span of the backing's contents that can be accessed directly without copying them out with Read
+         * @param offset The offset of the span in the backing
+         * @param size The size of the span in bytes
+         * @return A span of the contents, this is empty if the backing doesn't support direct access or the range is outside of it
+         * @note The span is only valid for the lifetime of the backing
+         */
+        virtual std::span<const u8> GetSpan(size_t offset, size_t size) {
+            return {};
+        }
+
         /**
          * @brief Writes from a buffer to a particular offset in the backing
          * @param input The object to write to the backing
@@ -93,5 +105,10 @@ namespace skyline::vfs {
         virtual void Resize(size_t size) {
             throw exception("This backing does not support being resized");
         }
+
+        /**
+         * @brief Writes out any writes that have been buffered and ensures that all writes to the backing are durable
+         */
+        virtual void Flush() {}
     };
 }
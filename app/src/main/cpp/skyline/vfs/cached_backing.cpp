@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "cached_backing.h"
+
+namespace skyline::vfs {
+    CachedBacking::CachedBacking(std::shared_ptr<Backing> backing, size_t cacheSize) : Backing(backing->mode, backing->size), backing(std::move(backing)), capacity(std::max(cacheSize / BlockSize, static_cast<size_t>(1))), registration("VFS Block Cache", cache::Priority::Low, [this] { return GetCacheSize(); }, [this](size_t target) { return Evict(target); }) {
+        mode.write = false;
+        mode.append = false;
+    }
+
+    CachedBacking::~CachedBacking() {
+        {
+            std::lock_guard guard(mutex);
+            halt = true;
+        }
+        readAheadCondition.notify_all();
+
+        if (readAheadThread.joinable())
+            readAheadThread.join();
+    }
+
+    bool CachedBacking::CopyFromCache(size_t index, size_t offset, u8 *output, size_t size) {
+        std::lock_guard guard(mutex);
+        auto block{blockMap.find(index)};
+        if (block == blockMap.end())
+            return false;
+
+        blocks.splice(blocks.begin(), blocks, block->second);
+        if (output)
+            std::memcpy(output, block->second->data.data() + offset, size);
+        return true;
+    }
+
+    void CachedBacking::LoadBlock(size_t index, size_t offset, u8 *output, size_t size) {
+        // The block is read without holding the lock so other reads can be served from the cache meanwhile, if it's loaded concurrently then only one copy is kept
+        footprint::Vector<u8, footprint::Subsystem::VfsCache> data(GetBlockSize(index));
+        if (backing->Read(data.data(), index * BlockSize, data.size()) != data.size())
+            throw exception("Failed to read block 0x{:X} of the cached backing", index);
+
+        if (output)
+            std::memcpy(output, data.data() + offset, size);
+
+        std::lock_guard guard(mutex);
+        auto block{blockMap.find(index)};
+        if (block != blockMap.end()) {
+            blocks.splice(blocks.begin(), blocks, block->second);
+            return;
+        }
+
+        if (blocks.size() >= capacity) {
+            blockMap.erase(blocks.back().index);
+            blocks.pop_back();
+        }
+
+        blocks.push_front(Block{index, std::move(data)});
+        blockMap[index] = blocks.begin();
+    }
+
+    void CachedBacking::RequestReadAhead(size_t index) {
+        {
+            std::lock_guard guard(mutex);
+            if (halt)
+                return;
+
+            readAheadIndex = index;
+            readAheadPending = true;
+
+            if (!readAheadThread.joinable())
+                readAheadThread = std::thread(&CachedBacking::ReadAhead, this);
+        }
+        readAheadCondition.notify_one();
+    }
+
+    void CachedBacking::ReadAhead() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            readAheadCondition.wait(lock, [this] { return readAheadPending || halt; });
+            if (halt)
+                return;
+
+            auto start{readAheadIndex};
+            readAheadPending = false;
+            lock.unlock();
+
+            try {
+                auto blockCount{util::AlignUp(size, BlockSize) / BlockSize};
+                for (auto index{start}; index < std::min(start + ReadAheadBlocks, blockCount); index++) {
+                    // A newer request supersedes this one, as the reads have moved on from it
+                    if (readAheadPending || halt)
+                        break;
+                    if (!CopyFromCache(index, 0, nullptr, 0))
+                        LoadBlock(index);
+                }
+            } catch (const std::exception &) {
+                // A failed read-ahead is ignored as the error will be encountered again by the read of the block itself
+            }
+
+            lock.lock();
+        }
+    }
+
+    size_t CachedBacking::Read(u8 *output, size_t offset, size_t size) {
+        if (!mode.read)
+            throw exception("Attempting to read a backing that is not readable");
+
+        if (offset >= this->size || size == 0)
+            return 0;
+
+        size = std::min(size, this->size - offset);
+        auto end{offset + size};
+        bool sequential{sequentialEnd.exchange(end) == offset};
+
+        for (auto position{offset}; position < end;) {
+            auto index{position / BlockSize};
+            auto blockOffset{position % BlockSize};
+            auto copySize{std::min(GetBlockSize(index) - blockOffset, end - position)};
+
+            if (CopyFromCache(index, blockOffset, output, copySize)) {
+                hits++;
+            } else if (blockOffset == 0 && copySize == BlockSize) {
+                // A run of uncached blocks which are entirely covered by the read is read directly into the output, these aren't cached so large reads don't evict everything else
+                auto runEnd{position + BlockSize};
+                while (runEnd + BlockSize <= end && !CopyFromCache(runEnd / BlockSize, 0, nullptr, 0))
+                    runEnd += BlockSize;
+
+                if (backing->Read(output, position, runEnd - position) != runEnd - position)
+                    throw exception("Failed to read 0x{:X} bytes at 0x{:X} from the cached backing", runEnd - position, position);
+
+                misses += (runEnd - position) / BlockSize;
+                output += runEnd - position;
+                position = runEnd;
+                continue;
+            } else {
+                misses++;
+                LoadBlock(index, blockOffset, output, copySize);
+            }
+
+            output += copySize;
+            position += copySize;
+        }
+
+        if (sequential && end < this->size)
+            RequestReadAhead(util::AlignUp(end, BlockSize) / BlockSize);
+
+        return size;
+    }
+
+    size_t CachedBacking::GetCacheSize() {
+        std::lock_guard guard(mutex);
+        size_t size{};
+        for (const auto &block : blocks)
+            size += block.data.size();
+        return size;
+    }
+
+    size_t CachedBacking::Evict(size_t target) {
+        std::lock_guard guard(mutex);
+        size_t freed{};
+        while (freed < target && !blocks.empty()) {
+            freed += blocks.back().data.size();
+            blockMap.erase(blocks.back().index);
+            blocks.pop_back();
+        }
+        return freed;
+    }
+}
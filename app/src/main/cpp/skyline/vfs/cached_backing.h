@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <list>
+#include <condition_variable>
+#include <cache_registry.h>
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The CachedBacking class caches the contents of another backing in fixed-size blocks, this is used to avoid repeatedly reading out expensive backings such as encrypted ones
+     * @note Sequential reads cause the blocks following them to be read ahead on a background thread
+     */
+    class CachedBacking : public Backing {
+      public:
+        static constexpr size_t BlockSize = 0x10000; //!< The size of a single cached block in bytes
+        static constexpr size_t ReadAheadBlocks = 4; //!< The amount of blocks that are read ahead of a sequential read
+
+      private:
+        /**
+         * @brief A single block of the backing that is held in the cache
+         */
+        struct Block {
+            size_t index; //!< The index of the block in the backing
+            footprint::Vector<u8, footprint::Subsystem::VfsCache> data; //!< The contents of the block, this is smaller than the block size for the last block of the backing
+        };
+
+        std::shared_ptr<Backing> backing; //!< The backing that is cached
+        size_t capacity; //!< The maximum amount of blocks that are held in the cache
+
+        std::mutex mutex; //!< This mutex guards the cache and the read-ahead state
+        std::list<Block> blocks; //!< The cached blocks in the order they were last used, the most recently used one is at the front
+        std::unordered_map<size_t, std::list<Block>::iterator> blockMap; //!< A map from the index of a block to its entry in the cache
+
+        std::atomic<size_t> sequentialEnd{}; //!< The end of the last read, a read starting here is considered to be sequential
+        size_t readAheadIndex{}; //!< The index of the first block that should be read ahead
+        std::atomic<bool> readAheadPending{}; //!< If a read-ahead has been requested that the thread hasn't started on
+        std::atomic<bool> halt{}; //!< If the read-ahead thread should exit
+        std::condition_variable readAheadCondition; //!< This is used to wake up the read-ahead thread when a read-ahead is requested
+        std::thread readAheadThread; //!< The thread that reads ahead blocks, it's only started on the first sequential read
+        cache::Registration registration; //!< The registration of the block cache in the cache registry, this is declared last so it's unregistered prior to the cache being destroyed
+
+        /**
+         * @return The size of the block with the specified index, only the last block of the backing can be smaller than BlockSize
+         */
+        inline size_t GetBlockSize(size_t index) {
+            return std::min(BlockSize, size - (index * BlockSize));
+        }
+
+        /**
+         * @brief Copies out a part of a block if it's in the cache and marks it as the most recently used block
+         * @return If the block was in the cache
+         */
+        bool CopyFromCache(size_t index, size_t offset, u8 *output, size_t size);
+
+        /**
+         * @brief Reads a block from the backing and inserts it into the cache, evicting the least recently used block if the cache is full
+         * @param output If this isn't null, the specified part of the block is copied into it
+         */
+        void LoadBlock(size_t index, size_t offset = 0, u8 *output = nullptr, size_t size = 0);
+
+        /**
+         * @brief Requests the blocks starting at the specified index to be read ahead
+         */
+        void RequestReadAhead(size_t index);
+
+        /**
+         * @brief The entry point of the read-ahead thread
+         */
+        void ReadAhead();
+
+        /**
+         * @return The size of the contents of all cached blocks in bytes
+         */
+        size_t GetCacheSize();
+
+        /**
+         * @brief Evicts the least recently used blocks till at least the supplied amount of bytes has been freed or the cache is empty
+         * @return The amount of bytes that were freed
+         */
+        size_t Evict(size_t target);
+
+      public:
+        std::atomic<size_t> hits{}; //!< The amount of block accesses that were served from the cache
+        std::atomic<size_t> misses{}; //!< The amount of block accesses that had to be read from the backing
+
+        /**
+         * @param backing The backing to cache
+         * @param cacheSize The maximum size of the cache in bytes
+         */
+        CachedBacking(std::shared_ptr<Backing> backing, size_t cacheSize = 0x400000);
+
+        ~CachedBacking();
+
+        size_t Read(u8 *output, size_t offset, size_t size);
+    };
+}
@@ -6,7 +6,7 @@
 namespace skyline::vfs {
     constexpr size_t SectorSize = 0x10;
 
-    CtrEncryptedBacking::CtrEncryptedBacking(crypto::KeyStore::Key128 &ctr, crypto::KeyStore::Key128 &key, const std::shared_ptr<Backing> &backing, size_t baseOffset) : Backing({true, false, false}), ctr(ctr), cipher(key, MBEDTLS_CIPHER_AES_128_CTR), backing(backing), baseOffset(baseOffset) {}
+    CtrEncryptedBacking::CtrEncryptedBacking(crypto::KeyStore::Key128 &ctr, crypto::KeyStore::Key128 &key, const std::shared_ptr<Backing> &backing, size_t baseOffset) : Backing({true, false, false}, backing->size), ctr(ctr), cipher(key, MBEDTLS_CIPHER_AES_128_CTR), backing(backing), baseOffset(baseOffset) {}
 
     void CtrEncryptedBacking::UpdateCtr(u64 offset) {
         offset >>= 4;
@@ -19,30 +19,25 @@ namespace skyline::vfs {
         if (size == 0)
             return 0;
 
-        size_t sectorOffset{offset % SectorSize};
-        if (sectorOffset == 0) {
-            UpdateCtr(baseOffset + offset);
-            size_t read{backing->Read(output, offset, size)};
-            if (read != size)
-                return 0;
-            cipher.Decrypt({output, size});
-            return size;
-        }
+        std::lock_guard guard(mutex);
 
-        size_t sectorStart{offset - sectorOffset};
-        std::vector<u8> blockBuf(SectorSize);
-        size_t read{backing->Read(blockBuf.data(), sectorStart, SectorSize)};
-        if (read != SectorSize)
+        // The ciphertext is read directly into the output and decrypted in-place in a single batch
+        size_t read{backing->Read(output, offset, size)};
+        if (read != size)
             return 0;
-        UpdateCtr(baseOffset + sectorStart);
-        cipher.Decrypt(blockBuf);
-        if (size + sectorOffset < SectorSize) {
-            std::memcpy(output, blockBuf.data() + sectorOffset, size);
-            return size;
+
+        if (offset != position) {
+            // The counter is only reset for non-sequential reads, the keystream up to the offset inside of the first sector is discarded
+            size_t sectorOffset{offset % SectorSize};
+            UpdateCtr(baseOffset + offset - sectorOffset);
+            if (sectorOffset) {
+                std::array<u8, SectorSize> keystream{};
+                cipher.Decrypt(keystream.data(), keystream.data(), sectorOffset);
+            }
         }
 
-        size_t readInBlock{SectorSize - sectorOffset};
-        std::memcpy(output, blockBuf.data() + sectorOffset, readInBlock);
-        return readInBlock + Read(output + readInBlock, offset + readInBlock, size - readInBlock);
+        cipher.Decrypt({output, size});
+        position = offset + size;
+        return size;
     }
 }
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <mutex>
 #include <crypto/aes_cipher.h>
 #include <crypto/key_store.h>
 #include "backing.h"
@@ -17,6 +18,10 @@ namespace skyline::vfs {
 
         crypto::AesCipher cipher;
 
+        std::mutex mutex; //!< This mutex guards the counter and the state of the cipher, so the backing can be read from multiple threads
+
+        size_t position{std::numeric_limits<size_t>::max()}; //!< The offset in the backing that the keystream of the cipher is at, a read from this offset continues the keystream without resetting the counter
+
         std::shared_ptr<Backing> backing;
 
         /**
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "ctr_ex_encrypted_backing.h"
+
+namespace skyline::vfs {
+    constexpr size_t SectorSize = 0x10;
+
+    CtrExEncryptedBacking::CtrExEncryptedBacking(const crypto::KeyStore::Key128 &ctr, crypto::KeyStore::Key128 &key, const std::shared_ptr<Backing> &backing, size_t baseOffset, std::vector<Entry> entries) : Backing({true, false, false}, backing->size), ctr(ctr), cipher(key, MBEDTLS_CIPHER_AES_128_CTR), backing(backing), baseOffset(baseOffset), entries(std::move(entries)) {
+        if (this->entries.empty() || this->entries.front().offset != 0)
+            throw exception("The AES-CTR-EX table doesn't start at the beginning of the section");
+    }
+
+    size_t CtrExEncryptedBacking::Read(u8 *output, size_t offset, size_t size) {
+        if (size == 0)
+            return 0;
+
+        // The ciphertext is read directly into the output and every subsection is decrypted in-place
+        size_t read{backing->Read(output, offset, size)};
+        if (read != size)
+            return 0;
+
+        std::lock_guard guard(mutex);
+        auto entry{std::prev(std::upper_bound(entries.begin(), entries.end(), offset, [](size_t offset, const Entry &entry) { return offset < entry.offset; }))};
+        for (size_t position{offset}, end{offset + size}; position < end; entry++) {
+            size_t runEnd{std::next(entry) == entries.end() ? end : std::min<size_t>(end, std::next(entry)->offset)};
+
+            u32 generationBE{__builtin_bswap32(entry->generation)};
+            std::memcpy(ctr.data() + 4, &generationBE, sizeof(u32));
+
+            // Every subsection starts a new keystream, the keystream up to the offset inside of the first sector is discarded
+            size_t sectorOffset{position % SectorSize};
+            u64 counterBE{__builtin_bswap64((baseOffset + position - sectorOffset) >> 4)};
+            std::memcpy(ctr.data() + 8, &counterBE, sizeof(u64));
+            cipher.SetIV(ctr);
+            if (sectorOffset) {
+                std::array<u8, SectorSize> keystream{};
+                cipher.Decrypt(keystream.data(), keystream.data(), sectorOffset);
+            }
+
+            cipher.Decrypt({output + (position - offset), runEnd - position});
+            position = runEnd;
+        }
+
+        return size;
+    }
+}
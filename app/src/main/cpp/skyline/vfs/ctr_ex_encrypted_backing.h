@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <mutex>
+#include <crypto/aes_cipher.h>
+#include <crypto/key_store.h>
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief This backing is used to decrypt the AES-CTR-EX data of a BKTR patch section, it's split into subsections which each substitute their own generation into the counter
+     */
+    class CtrExEncryptedBacking : public Backing {
+      public:
+        /**
+         * @brief An entry of the AES-CTR-EX table, it covers everything from its offset up to the offset of the next entry
+         */
+        struct Entry {
+            u64 offset; //!< The offset of the subsection in the section
+            u32 _pad_;
+            u32 generation; //!< The generation which replaces the generation of the section in the counter
+        };
+        static_assert(sizeof(Entry) == 0x10);
+
+      private:
+        crypto::KeyStore::Key128 ctr; //!< The counter of the section, the generation and offset in it are replaced for every read
+
+        crypto::AesCipher cipher;
+
+        std::mutex mutex; //!< This mutex guards the counter and the state of the cipher, so the backing can be read from multiple threads
+
+        std::shared_ptr<Backing> backing;
+
+        size_t baseOffset; //!< The offset of the section in the NCA, this is used to calculate the counter
+
+        std::vector<Entry> entries; //!< The subsections sorted by their offset, the first one must start at 0
+
+      public:
+        CtrExEncryptedBacking(const crypto::KeyStore::Key128 &ctr, crypto::KeyStore::Key128 &key, const std::shared_ptr<Backing> &backing, size_t baseOffset, std::vector<Entry> entries);
+
+        size_t Read(u8 *output, size_t offset, size_t size) override;
+    };
+}
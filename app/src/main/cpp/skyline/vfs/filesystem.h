@@ -86,5 +86,10 @@ namespace skyline::vfs {
         virtual std::shared_ptr<Directory> OpenDirectory(const std::string &path, Directory::ListMode listMode) {
             throw exception("This filesystem does not support opening directories");
         };
+
+        /**
+         * @brief Ensures that all changes made to the filesystem and its files are durable
+         */
+        virtual void Commit() {}
     };
 }
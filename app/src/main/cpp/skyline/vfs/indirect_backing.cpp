@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "indirect_backing.h"
+
+namespace skyline::vfs {
+    IndirectBacking::IndirectBacking(std::shared_ptr<Backing> base, std::shared_ptr<Backing> patch, std::vector<Entry> entries, size_t size) : Backing({true, false, false}, size), storages{std::move(base), std::move(patch)}, entries(std::move(entries)) {
+        if (this->entries.empty() || this->entries.front().virtualOffset != 0)
+            throw exception("The relocation table doesn't start at the beginning of the section");
+
+        for (const auto &entry : this->entries)
+            if (entry.storageIndex >= storages.size())
+                throw exception("A relocation at 0x{:X} refers to an invalid storage: {}", static_cast<u64>(entry.virtualOffset), static_cast<u32>(entry.storageIndex));
+    }
+
+    size_t IndirectBacking::Read(u8 *output, size_t offset, size_t size) {
+        if (offset >= this->size)
+            return 0;
+        size = std::min(size, this->size - offset);
+
+        auto entry{std::prev(std::upper_bound(entries.begin(), entries.end(), offset, [](size_t offset, const Entry &entry) { return offset < entry.virtualOffset; }))};
+        for (size_t position{offset}, end{offset + size}; position < end; entry++) {
+            size_t runEnd{std::next(entry) == entries.end() ? end : std::min(end, static_cast<size_t>(std::next(entry)->virtualOffset))};
+            if (runEnd == position)
+                continue;
+
+            auto count{runEnd - position};
+            if (storages[entry->storageIndex]->Read(output + (position - offset), entry->physicalOffset + (position - entry->virtualOffset), count) != count)
+                throw exception("Failed to read 0x{:X} bytes relocated from storage {} at 0x{:X}", count, static_cast<u32>(entry->storageIndex), entry->physicalOffset + (position - entry->virtualOffset));
+            position = runEnd;
+        }
+
+        return size;
+    }
+
+    std::span<const u8> IndirectBacking::GetSpan(size_t offset, size_t size) {
+        if (offset > this->size || size > this->size - offset)
+            return {};
+
+        // Only spans entirely within a single run can be accessed directly from the storage they're relocated from
+        auto entry{std::prev(std::upper_bound(entries.begin(), entries.end(), offset, [](size_t offset, const Entry &entry) { return offset < entry.virtualOffset; }))};
+        if (std::next(entry) != entries.end() && offset + size > std::next(entry)->virtualOffset)
+            return {};
+
+        return storages[entry->storageIndex]->GetSpan(entry->physicalOffset + (offset - entry->virtualOffset), size);
+    }
+}
@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The IndirectBacking class provides the BKTR indirect storage of a patch section, it's made up of runs of data that are relocated from either the section of the base NCA or the patch section
+     * @note The relocation table is flattened into a sorted array when it's read out of its bucket tree, every lookup is a binary search over it
+     */
+    class IndirectBacking : public Backing {
+      public:
+        /**
+         * @brief An entry of the relocation table, it covers everything from its virtual offset up to the virtual offset of the next entry
+         */
+        struct __attribute__((packed)) Entry {
+            u64 virtualOffset; //!< The offset of the run in the patched section
+            u64 physicalOffset; //!< The offset of the run in the storage it's relocated from
+            u32 storageIndex; //!< The index of the storage the run is relocated from, 0 is the base section and 1 is the patch section
+        };
+        static_assert(sizeof(Entry) == 0x14);
+
+      private:
+        std::array<std::shared_ptr<Backing>, 2> storages; //!< The backings of the base section and the patch section
+        std::vector<Entry> entries; //!< The runs sorted by their virtual offset, the first one must start at 0
+
+      public:
+        /**
+         * @param base The backing of the entire decrypted section of the base NCA
+         * @param patch The backing of the entire decrypted patch section
+         * @param size The size of the patched section, this is the end offset of the relocation table
+         */
+        IndirectBacking(std::shared_ptr<Backing> base, std::shared_ptr<Backing> patch, std::vector<Entry> entries, size_t size);
+
+        size_t Read(u8 *output, size_t offset, size_t size) override;
+
+        std::span<const u8> GetSpan(size_t offset, size_t size) override;
+    };
+}
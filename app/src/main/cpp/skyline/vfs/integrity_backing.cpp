@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "integrity_backing.h"
+
+namespace skyline::vfs {
+    IntegrityBacking::IntegrityBacking(std::shared_ptr<Backing> backing, std::shared_ptr<Backing> hashTable, size_t blockSize, bool padBlocks) : Backing({true, false, false}, backing->size), backing(std::move(backing)), hashTable(std::move(hashTable)), blockSize(blockSize), padBlocks(padBlocks) {
+        if (!blockSize)
+            throw exception("The block size of an IntegrityBacking cannot be 0");
+        blockCount = (size + blockSize - 1) / blockSize;
+        if (this->hashTable->size < blockCount * sizeof(crypto::Sha256Hash))
+            throw exception("The hash table is too small for 0x{:X} blocks: 0x{:X} bytes", blockCount, this->hashTable->size);
+        verified = std::make_unique<std::atomic<u64>[]>((blockCount + 63) / 64);
+    }
+
+    IntegrityBacking::IntegrityBacking(std::shared_ptr<Backing> backing, std::vector<crypto::Sha256Hash> hashes, size_t blockSize, bool padBlocks) : Backing({true, false, false}, backing->size), backing(std::move(backing)), hashes(std::move(hashes)), blockSize(blockSize), padBlocks(padBlocks) {
+        if (!blockSize)
+            throw exception("The block size of an IntegrityBacking cannot be 0");
+        blockCount = (size + blockSize - 1) / blockSize;
+        if (this->hashes.size() < blockCount)
+            throw exception("There are fewer hashes than blocks: {} < {}", this->hashes.size(), blockCount);
+        verified = std::make_unique<std::atomic<u64>[]>((blockCount + 63) / 64);
+    }
+
+    size_t IntegrityBacking::VerifyBlock(size_t index, u8 *buffer) {
+        size_t offset{index * blockSize}, blockLength{std::min(blockSize, size - offset)};
+        if (backing->Read(buffer, offset, blockLength) != blockLength)
+            return 0;
+
+        size_t hashedLength{blockLength};
+        if (padBlocks && blockLength < blockSize) {
+            std::memset(buffer + blockLength, 0, blockSize - blockLength);
+            hashedLength = blockSize;
+        }
+
+        crypto::Sha256Hash expected;
+        if (hashTable) {
+            if (hashTable->Read(expected.data(), index * sizeof(crypto::Sha256Hash), sizeof(crypto::Sha256Hash)) != sizeof(crypto::Sha256Hash))
+                return 0;
+        } else {
+            expected = hashes[index];
+        }
+
+        if (crypto::Sha256({buffer, hashedLength}) != expected)
+            return 0;
+
+        verified[index / 64].fetch_or(1ULL << (index % 64), std::memory_order_relaxed);
+        return blockLength;
+    }
+
+    size_t IntegrityBacking::Read(u8 *output, size_t offset, size_t size) {
+        if (offset >= this->size || !size)
+            return 0;
+        size = std::min(size, this->size - offset);
+
+        // Runs of verified blocks are read directly, any unverified block is read into a buffer to be verified and copied out of it
+        std::vector<u8> buffer;
+        size_t end{offset + size}, runStart{offset};
+        for (size_t index{offset / blockSize}; index * blockSize < end; index++) {
+            if (IsVerified(index))
+                continue;
+
+            size_t blockStart{std::max(index * blockSize, offset)};
+            if (runStart < blockStart && backing->Read(output + (runStart - offset), runStart, blockStart - runStart) != blockStart - runStart)
+                throw exception("Failed to read 0x{:X} bytes at 0x{:X}", blockStart - runStart, runStart);
+
+            if (buffer.empty())
+                buffer.resize(blockSize);
+            if (!VerifyBlock(index, buffer.data()))
+                throw exception("Block 0x{:X} doesn't match its hash", index);
+
+            runStart = std::min((index + 1) * blockSize, end);
+            std::memcpy(output + (blockStart - offset), buffer.data() + (blockStart - (index * blockSize)), runStart - blockStart);
+        }
+
+        if (runStart < end && backing->Read(output + (runStart - offset), runStart, end - runStart) != end - runStart)
+            throw exception("Failed to read 0x{:X} bytes at 0x{:X}", end - runStart, runStart);
+
+        return size;
+    }
+
+    bool IntegrityBacking::Verify() {
+        // Every thread takes the next group of blocks that share a word of the bitmap, a corrupt block stops all threads as the result is already known
+        size_t groupCount{(blockCount + 63) / 64};
+        std::atomic<size_t> next{};
+        std::atomic<bool> intact{true};
+        auto worker{[&]() {
+            try {
+                std::vector<u8> buffer(blockSize);
+                for (size_t group; intact.load(std::memory_order_relaxed) && (group = next.fetch_add(1, std::memory_order_relaxed)) < groupCount;) {
+                    for (size_t index{group * 64}; index < std::min((group + 1) * 64, blockCount); index++) {
+                        if (!IsVerified(index) && !VerifyBlock(index, buffer.data())) {
+                            intact = false;
+                            break;
+                        }
+                    }
+                }
+            } catch (const std::exception &e) {
+                intact = false;
+            }
+        }};
+
+        std::vector<std::thread> threads;
+        auto threadCount{std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1U), groupCount)};
+        for (size_t thread{1}; thread < threadCount; thread++)
+            threads.emplace_back(worker);
+        worker();
+        for (auto &thread : threads)
+            thread.join();
+
+        return intact;
+    }
+}
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <crypto/sha256.h>
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The IntegrityBacking class verifies the contents of another backing against the SHA-256 hashes of its blocks, every block is verified the first time it's read and is trusted from then on
+     * @note The hashes are either held in memory or read out of another backing, which is an IntegrityBacking itself for all but the topmost level of a hash tree
+     */
+    class IntegrityBacking : public Backing {
+      private:
+        std::shared_ptr<Backing> backing; //!< The backing that is verified
+        std::shared_ptr<Backing> hashTable; //!< A backing with the hashes of all blocks, this is null if they're held in memory
+        std::vector<crypto::Sha256Hash> hashes; //!< The hashes of all blocks, this is only used if there's no hash table backing
+        size_t blockSize; //!< The size of a single hashed block in bytes
+        bool padBlocks; //!< If a partial last block is padded with zeroes to the block size before being hashed
+        size_t blockCount; //!< The amount of blocks in the backing
+        std::unique_ptr<std::atomic<u64>[]> verified; //!< A bitmap of all blocks that have been verified
+
+        inline bool IsVerified(size_t index) {
+            return verified[index / 64].load(std::memory_order_relaxed) & (1ULL << (index % 64));
+        }
+
+        /**
+         * @brief Reads a block into the buffer and verifies it, the block is marked as verified if it matches its hash
+         * @param buffer A buffer that's at least as large as a block
+         * @return The size of the block if it matches its hash, otherwise 0
+         */
+        size_t VerifyBlock(size_t index, u8 *buffer);
+
+      public:
+        /**
+         * @param hashTable A backing that holds a hash for every block of the backing
+         * @param blockSize The size of a single hashed block in bytes
+         * @param padBlocks If a partial last block is padded with zeroes to the block size before being hashed, otherwise only the data in it is hashed
+         */
+        IntegrityBacking(std::shared_ptr<Backing> backing, std::shared_ptr<Backing> hashTable, size_t blockSize, bool padBlocks);
+
+        /**
+         * @param hashes The hashes of every block of the backing
+         */
+        IntegrityBacking(std::shared_ptr<Backing> backing, std::vector<crypto::Sha256Hash> hashes, size_t blockSize, bool padBlocks);
+
+        /**
+         * @note An exception is thrown if any of the read blocks don't match their hash
+         */
+        size_t Read(u8 *output, size_t offset, size_t size);
+
+        /**
+         * @brief Verifies every block that hasn't been verified yet, the blocks are split up across all cores
+         * @return If all blocks match their hashes
+         */
+        bool Verify();
+    };
+}
@@ -0,0 +1,506 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include "region_backing.h"
+#include "layered_filesystem.h"
+
+namespace skyline::vfs {
+    namespace {
+        constexpr u64 DataOffset{0x200}; //!< The offset of the file data in the merged RomFS image
+        constexpr u64 DataAlignment{0x10}; //!< The alignment of the contents of every file in the merged RomFS image
+
+        /**
+         * @brief The header of the index in the metadata cache, this is followed by every CachedDirectory and then every CachedFile
+         */
+        struct IndexHeader {
+            u32 magic; //!< The magic of the index: 'LFS0'
+            u32 directoryCount;
+            u32 fileCount;
+            u32 _pad_;
+            u64 romFsSize; //!< The size of the RomFS the index was built over
+        };
+
+        /**
+         * @note Every entry is directly followed by its path
+         */
+        struct CachedDirectory {
+            i64 modifiedSeconds;
+            i64 modifiedNanoseconds;
+            u32 overridden;
+            u32 pathSize;
+        };
+
+        /**
+         * @note Every entry is directly followed by its path
+         */
+        struct CachedFile {
+            u64 offset;
+            u64 size;
+            u32 overridden;
+            u32 pathSize;
+        };
+
+        template<typename Type>
+        void Append(std::vector<u8> &stream, const Type &item) {
+            auto offset{stream.size()};
+            stream.resize(offset + sizeof(Type));
+            std::memcpy(stream.data() + offset, &item, sizeof(Type));
+        }
+
+        void Append(std::vector<u8> &stream, std::string_view string) {
+            stream.insert(stream.end(), string.begin(), string.end());
+        }
+
+        /**
+         * @return The path without any leading or trailing separators, this is the form paths in the index are in
+         */
+        std::string_view NormalizePath(std::string_view path) {
+            while (!path.empty() && path.front() == '/')
+                path.remove_prefix(1);
+            while (!path.empty() && path.back() == '/')
+                path.remove_suffix(1);
+            return path;
+        }
+
+        /**
+         * @return The name of an entry from its path in the index
+         */
+        std::string_view GetName(std::string_view path) {
+            auto separator{path.rfind('/')};
+            return separator == std::string_view::npos ? path : path.substr(separator + 1);
+        }
+
+        /**
+         * @return The index of the last file that starts at or before the supplied offset in the merged RomFS image, this is the only file that can contain the offset
+         */
+        std::optional<size_t> FindImageFile(const std::vector<LayeredFileSystem::FileEntry> &files, u64 imageOffset) {
+            auto file{std::upper_bound(files.begin(), files.end(), imageOffset, [](u64 imageOffset, const LayeredFileSystem::FileEntry &file) { return imageOffset < file.imageOffset; })};
+            if (file == files.begin())
+                return std::nullopt;
+            return std::distance(files.begin(), file) - 1;
+        }
+    }
+
+    std::shared_ptr<Backing> LayeredFileSystem::LayeredIndex::GetFileBacking(u32 index) {
+        const auto &file{files.at(index)};
+        if (!file.overridden)
+            return std::make_shared<RegionBacking>(romFs, file.offset, file.size);
+
+        std::lock_guard lock(overrideMutex);
+        auto &backing{overrideBackings[index]};
+        if (!backing)
+            backing = overrides->OpenFile(file.path);
+        return backing;
+    }
+
+    LayeredFileSystem::LayeredFileSystem(std::shared_ptr<Backing> romFs, const std::string &overridePath, const std::shared_ptr<MetadataCache> &cache, const std::string &cacheKey) : FileSystem(), index(std::make_shared<LayeredIndex>()) {
+        index->romFs = std::move(romFs);
+        index->overrides = std::make_shared<OsFileSystem>(overridePath);
+
+        auto cached{cache ? cache->Get(cacheKey) : std::nullopt};
+        bool loaded{cached && LoadIndex(*cached, overridePath)};
+        if (!loaded)
+            BuildIndex(overridePath);
+
+        BuildImage();
+
+        if (cache && !loaded)
+            cache->Put(cacheKey, SaveIndex());
+    }
+
+    void LayeredFileSystem::BuildIndex(const std::string &overridePath) {
+        // The entries are collected into ordered maps so an override replaces the RomFS entry at the same path and everything ends up sorted by path
+        std::map<std::string, DirectoryEntry> directories;
+        std::map<std::string, FileEntry> files;
+
+        RomFileSystem base(index->romFs);
+        base.VisitEntries([&](const std::string &path, const RomFileSystem::RomFsFileEntry *file) {
+            if (file)
+                files.emplace(path, FileEntry{.path = path, .offset = base.header.dataOffset + file->offset, .size = file->size});
+            else
+                directories.emplace(path, DirectoryEntry{.path = path});
+        });
+
+        std::vector<std::string> pending{std::string{}};
+        while (!pending.empty()) {
+            auto path{std::move(pending.back())};
+            pending.pop_back();
+
+            auto directory{opendir((overridePath + path).c_str())};
+            if (!directory) {
+                if (path.empty())
+                    throw exception("Failed to open the override directory {}: {}", overridePath, strerror(errno));
+                continue;
+            }
+
+            struct stat directoryStat{};
+            fstat(dirfd(directory), &directoryStat);
+
+            auto &entry{directories[path]};
+            entry.path = path;
+            entry.overridden = true;
+            entry.modified = directoryStat.st_mtim;
+
+            // Overrides that would change the type of a RomFS entry are ignored, a directory can't be turned into a file or the other way around
+            while (auto child{readdir(directory)}) {
+                std::string_view name{child->d_name};
+                if (name == "." || name == "..")
+                    continue;
+
+                struct stat childStat{};
+                if (fstatat(dirfd(directory), child->d_name, &childStat, 0))
+                    continue;
+
+                auto childPath{path.empty() ? std::string(name) : path + '/' + std::string(name)};
+                if (S_ISDIR(childStat.st_mode) && !files.contains(childPath))
+                    pending.push_back(std::move(childPath));
+                else if (S_ISREG(childStat.st_mode) && !directories.contains(childPath))
+                    files[childPath] = FileEntry{.path = childPath, .overridden = true, .size = static_cast<u64>(childStat.st_size)};
+            }
+            closedir(directory);
+        }
+
+        for (auto &[path, directory] : directories)
+            index->directories.push_back(std::move(directory));
+        for (auto &[path, file] : files)
+            index->files.push_back(std::move(file));
+    }
+
+    bool LayeredFileSystem::LoadIndex(std::span<const u8> cached, const std::string &overridePath) {
+        size_t offset{};
+        auto readEntry{[&](auto &entry) {
+            if (sizeof(entry) > cached.size() - offset)
+                return false;
+            std::memcpy(&entry, cached.data() + offset, sizeof(entry));
+            offset += sizeof(entry);
+            return true;
+        }};
+        auto readPath{[&](u32 size, std::string &path) {
+            if (size > cached.size() - offset)
+                return false;
+            path.assign(reinterpret_cast<const char *>(cached.data() + offset), size);
+            offset += size;
+            return true;
+        }};
+
+        IndexHeader header{};
+        if (!readEntry(header) || header.magic != util::MakeMagic<u32>("LFS0") || header.romFsSize != index->romFs->size)
+            return false;
+
+        std::vector<DirectoryEntry> directories(header.directoryCount);
+        for (auto &directory : directories) {
+            CachedDirectory entry{};
+            if (!readEntry(entry) || !readPath(entry.pathSize, directory.path))
+                return false;
+            directory.overridden = entry.overridden;
+            directory.modified = {static_cast<time_t>(entry.modifiedSeconds), static_cast<long>(entry.modifiedNanoseconds)};
+
+            // Any addition, removal or rename in an override directory changes its modification time, so only directories need to be checked for the index to be current
+            if (directory.overridden) {
+                struct stat directoryStat{};
+                if (stat((overridePath + directory.path).c_str(), &directoryStat) || directoryStat.st_mtim.tv_sec != directory.modified.tv_sec || directoryStat.st_mtim.tv_nsec != directory.modified.tv_nsec)
+                    return false;
+            }
+        }
+
+        std::vector<FileEntry> files(header.fileCount);
+        for (auto &file : files) {
+            CachedFile entry{};
+            if (!readEntry(entry) || !readPath(entry.pathSize, file.path))
+                return false;
+            file.overridden = entry.overridden;
+            file.offset = entry.offset;
+            file.size = entry.size;
+        }
+
+        if (offset != cached.size())
+            return false;
+
+        index->directories = std::move(directories);
+        index->files = std::move(files);
+        return true;
+    }
+
+    std::vector<u8> LayeredFileSystem::SaveIndex() {
+        std::vector<u8> stream;
+        Append(stream, IndexHeader{
+            .magic = util::MakeMagic<u32>("LFS0"),
+            .directoryCount = static_cast<u32>(index->directories.size()),
+            .fileCount = static_cast<u32>(index->files.size()),
+            .romFsSize = index->romFs->size,
+        });
+
+        for (const auto &directory : index->directories) {
+            Append(stream, CachedDirectory{
+                .modifiedSeconds = static_cast<i64>(directory.modified.tv_sec),
+                .modifiedNanoseconds = static_cast<i64>(directory.modified.tv_nsec),
+                .overridden = directory.overridden,
+                .pathSize = static_cast<u32>(directory.path.size()),
+            });
+            Append(stream, directory.path);
+        }
+
+        for (const auto &file : index->files) {
+            Append(stream, CachedFile{
+                .offset = file.offset,
+                .size = file.size,
+                .overridden = file.overridden,
+                .pathSize = static_cast<u32>(file.path.size()),
+            });
+            Append(stream, file.path);
+        }
+
+        return stream;
+    }
+
+    void LayeredFileSystem::BuildImage() {
+        using RomFsDirectoryEntry = RomFileSystem::RomFsDirectoryEntry;
+        using RomFsFileEntry = RomFileSystem::RomFsFileEntry;
+
+        auto &directories{index->directories};
+        auto &files{index->files};
+        if (directories.empty() || !directories.front().path.empty())
+            throw exception("The merged tree of a LayeredFileSystem has no root directory");
+
+        for (u32 i{}; i < directories.size(); i++)
+            index->directoryLookup.emplace(directories[i].path, i);
+        for (u32 i{}; i < files.size(); i++)
+            index->fileLookup.emplace(files[i].path, i);
+
+        auto getParent{[&](std::string_view path) {
+            auto separator{path.rfind('/')};
+            auto parent{index->directoryLookup.find(std::string(separator == std::string_view::npos ? std::string_view{} : path.substr(0, separator)))};
+            if (parent == index->directoryLookup.end())
+                throw exception("An entry in a LayeredFileSystem has no parent directory: {}", path);
+            return parent->second;
+        }};
+
+        std::vector<u32> directoryParents(directories.size()), fileParents(files.size());
+        for (u32 i{1}; i < directories.size(); i++)
+            directories[directoryParents[i] = getParent(directories[i].path)].directories.push_back(i);
+        for (u32 i{}; i < files.size(); i++)
+            directories[fileParents[i] = getParent(files[i].path)].files.push_back(i);
+
+        // Every entry in a metadata table is followed by its name padded to a word
+        std::vector<u32> directoryOffsets(directories.size()), fileOffsets(files.size());
+        u32 directoryTableSize{}, fileTableSize{};
+        for (u32 i{}; i < directories.size(); i++) {
+            directoryOffsets[i] = directoryTableSize;
+            directoryTableSize += sizeof(RomFsDirectoryEntry) + util::AlignUp(GetName(directories[i].path).size(), sizeof(u32));
+        }
+        for (u32 i{}; i < files.size(); i++) {
+            fileOffsets[i] = fileTableSize;
+            fileTableSize += sizeof(RomFsFileEntry) + util::AlignUp(GetName(files[i].path).size(), sizeof(u32));
+        }
+
+        std::vector<u32> directorySiblings(directories.size(), constant::RomFsEmptyEntry), fileSiblings(files.size(), constant::RomFsEmptyEntry);
+        for (const auto &directory : directories) {
+            for (size_t i{1}; i < directory.directories.size(); i++)
+                directorySiblings[directory.directories[i - 1]] = directoryOffsets[directory.directories[i]];
+            for (size_t i{1}; i < directory.files.size(); i++)
+                fileSiblings[directory.files[i - 1]] = fileOffsets[directory.files[i]];
+        }
+
+        u64 dataSize{};
+        for (auto &file : files) {
+            dataSize = util::AlignUp(dataSize, DataAlignment);
+            file.imageOffset = DataOffset + dataSize;
+            dataSize += file.size;
+        }
+        index->metadataOffset = util::AlignUp(DataOffset + dataSize, DataAlignment);
+
+        // An odd amount of buckets spreads the entries more evenly than a power of two, official RomFS images do the same
+        auto getBucketCount{[](size_t count) { return std::max<size_t>(count, 3) | 1; }};
+        std::vector<u32> directoryBuckets(getBucketCount(directories.size()), constant::RomFsEmptyEntry), fileBuckets(getBucketCount(files.size()), constant::RomFsEmptyEntry);
+
+        auto directoryHashSize{directoryBuckets.size() * sizeof(u32)}, fileHashSize{fileBuckets.size() * sizeof(u32)};
+        auto &metadata{index->metadata};
+        metadata.resize(directoryHashSize + directoryTableSize + fileHashSize + fileTableSize);
+        auto directoryTable{metadata.data() + directoryHashSize};
+        auto fileTable{directoryTable + directoryTableSize + fileHashSize};
+
+        for (u32 i{}; i < directories.size(); i++) {
+            const auto &directory{directories[i]};
+            auto name{GetName(directory.path)};
+            u32 parentOffset{i ? directoryOffsets[directoryParents[i]] : 0}; // The root directory is its own parent
+            auto &bucket{directoryBuckets[RomFileSystem::RomFsTables::Hash(parentOffset, name) % directoryBuckets.size()]};
+
+            RomFsDirectoryEntry entry{
+                .parentOffset = parentOffset,
+                .siblingOffset = directorySiblings[i],
+                .childOffset = directory.directories.empty() ? constant::RomFsEmptyEntry : directoryOffsets[directory.directories.front()],
+                .fileOffset = directory.files.empty() ? constant::RomFsEmptyEntry : fileOffsets[directory.files.front()],
+                .hashSiblingOffset = bucket,
+                .nameSize = static_cast<u32>(name.size()),
+            };
+            bucket = directoryOffsets[i];
+
+            std::memcpy(directoryTable + directoryOffsets[i], &entry, sizeof(entry));
+            std::memcpy(directoryTable + directoryOffsets[i] + sizeof(entry), name.data(), name.size());
+        }
+
+        for (u32 i{}; i < files.size(); i++) {
+            const auto &file{files[i]};
+            auto name{GetName(file.path)};
+            u32 parentOffset{directoryOffsets[fileParents[i]]};
+            auto &bucket{fileBuckets[RomFileSystem::RomFsTables::Hash(parentOffset, name) % fileBuckets.size()]};
+
+            RomFsFileEntry entry{
+                .parentOffset = parentOffset,
+                .siblingOffset = fileSiblings[i],
+                .offset = file.imageOffset - DataOffset,
+                .size = file.size,
+                .hashSiblingOffset = bucket,
+                .nameSize = static_cast<u32>(name.size()),
+            };
+            bucket = fileOffsets[i];
+
+            std::memcpy(fileTable + fileOffsets[i], &entry, sizeof(entry));
+            std::memcpy(fileTable + fileOffsets[i] + sizeof(entry), name.data(), name.size());
+        }
+
+        std::memcpy(metadata.data(), directoryBuckets.data(), directoryHashSize);
+        std::memcpy(directoryTable + directoryTableSize, fileBuckets.data(), fileHashSize);
+
+        RomFileSystem::RomFsHeader header{
+            .headerSize = sizeof(RomFileSystem::RomFsHeader),
+            .dirHashTableOffset = index->metadataOffset,
+            .dirHashTableSize = directoryHashSize,
+            .dirMetaTableOffset = index->metadataOffset + directoryHashSize,
+            .dirMetaTableSize = directoryTableSize,
+            .fileHashTableOffset = index->metadataOffset + directoryHashSize + directoryTableSize,
+            .fileHashTableSize = fileHashSize,
+            .fileMetaTableOffset = index->metadataOffset + directoryHashSize + directoryTableSize + fileHashSize,
+            .fileMetaTableSize = fileTableSize,
+            .dataOffset = DataOffset,
+        };
+        index->header.resize(DataOffset);
+        std::memcpy(index->header.data(), &header, sizeof(header));
+
+        index->overrideBackings.resize(files.size());
+    }
+
+    std::shared_ptr<Backing> LayeredFileSystem::OpenRomFs() {
+        return std::make_shared<LayeredRomFsBacking>(index);
+    }
+
+    std::shared_ptr<Backing> LayeredFileSystem::OpenFile(const std::string &path, Backing::Mode mode) {
+        auto file{index->fileLookup.find(std::string(NormalizePath(path)))};
+        if (file == index->fileLookup.end())
+            return nullptr;
+
+        return index->GetFileBacking(file->second);
+    }
+
+    std::optional<Directory::EntryType> LayeredFileSystem::GetEntryType(const std::string &path) {
+        std::string normalized{NormalizePath(path)};
+        if (index->fileLookup.contains(normalized))
+            return Directory::EntryType::File;
+        else if (index->directoryLookup.contains(normalized))
+            return Directory::EntryType::Directory;
+
+        return std::nullopt;
+    }
+
+    std::shared_ptr<Directory> LayeredFileSystem::OpenDirectory(const std::string &path, Directory::ListMode listMode) {
+        auto directory{index->directoryLookup.find(std::string(NormalizePath(path)))};
+        if (directory == index->directoryLookup.end())
+            return nullptr;
+
+        return std::make_shared<LayeredFileSystemDirectory>(index, directory->second, listMode);
+    }
+
+    LayeredRomFsBacking::LayeredRomFsBacking(const std::shared_ptr<LayeredFileSystem::LayeredIndex> &index) : Backing({true, false, false}, index->metadataOffset + index->metadata.size()), index(index) {}
+
+    size_t LayeredRomFsBacking::Read(u8 *output, size_t offset, size_t size) {
+        if (offset >= this->size)
+            return 0;
+        size = std::min(size, this->size - offset);
+
+        const auto &files{index->files};
+        for (size_t position{offset}, end{offset + size}; position < end;) {
+            auto target{output + (position - offset)};
+            auto remaining{end - position};
+
+            if (position < index->header.size()) {
+                auto count{std::min(remaining, index->header.size() - position)};
+                std::memcpy(target, index->header.data() + position, count);
+                position += count;
+                continue;
+            } else if (position >= index->metadataOffset) {
+                std::memcpy(target, index->metadata.data() + (position - index->metadataOffset), remaining);
+                break;
+            }
+
+            auto file{FindImageFile(files, position)};
+            if (file && position < files[*file].imageOffset + files[*file].size) {
+                const auto &entry{files[*file]};
+                auto count{std::min<size_t>(remaining, entry.imageOffset + entry.size - position)};
+                auto fileOffset{position - entry.imageOffset};
+
+                size_t read;
+                if (entry.overridden)
+                    read = index->GetFileBacking(static_cast<u32>(*file))->Read(target, fileOffset, count);
+                else
+                    read = index->romFs->Read(target, entry.offset + fileOffset, count);
+
+                // An overridden file that was truncated after the index was built is padded with zeroes to the size it had
+                if (read < count)
+                    std::memset(target + read, 0, count - read);
+                position += count;
+                continue;
+            }
+
+            // Anything between the contents of two files is alignment padding
+            auto next{file ? *file + 1 : 0};
+            auto count{std::min<size_t>(remaining, (next < files.size() ? files[next].imageOffset : index->metadataOffset) - position)};
+            std::memset(target, 0, count);
+            position += count;
+        }
+
+        return size;
+    }
+
+    std::span<const u8> LayeredRomFsBacking::GetSpan(size_t offset, size_t size) {
+        if (offset > this->size || size > this->size - offset)
+            return {};
+
+        if (offset + size <= index->header.size())
+            return std::span(index->header).subspan(offset, size);
+        else if (offset >= index->metadataOffset)
+            return std::span(index->metadata).subspan(offset - index->metadataOffset, size);
+
+        // Only spans entirely within the contents of a single file can be accessed directly from its backing
+        auto file{FindImageFile(index->files, offset)};
+        if (!file)
+            return {};
+
+        const auto &entry{index->files[*file]};
+        if (offset + size > entry.imageOffset + entry.size)
+            return {};
+
+        auto fileOffset{offset - entry.imageOffset};
+        if (entry.overridden)
+            return index->GetFileBacking(static_cast<u32>(*file))->GetSpan(fileOffset, size);
+        return index->romFs->GetSpan(entry.offset + fileOffset, size);
+    }
+
+    LayeredFileSystemDirectory::LayeredFileSystemDirectory(const std::shared_ptr<LayeredFileSystem::LayeredIndex> &index, u32 directory, ListMode listMode) : Directory(listMode), index(index), directory(directory) {}
+
+    std::vector<LayeredFileSystemDirectory::Entry> LayeredFileSystemDirectory::Read() {
+        const auto &entry{index->directories.at(directory)};
+        std::vector<Entry> contents;
+
+        if (listMode.file)
+            for (auto file : entry.files)
+                contents.emplace_back(Entry{std::string(GetName(index->files[file].path)), EntryType::File});
+
+        if (listMode.directory)
+            for (auto child : entry.directories)
+                contents.emplace_back(Entry{std::string(GetName(index->directories[child].path)), EntryType::Directory});
+
+        return contents;
+    }
+}
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <ctime>
+#include "os_filesystem.h"
+#include "rom_filesystem.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The LayeredFileSystem class merges a directory on the host over a RomFS image, files in the directory replace the file at the same path in the RomFS or are added to it
+     * @details The merged tree is resolved into a flat index once when the filesystem is created, every lookup after that is a single hash map lookup which never touches the override directory. The index is persisted in the metadata cache and reused as long as every override directory has the same modification time, so the override directory isn't traversed on every launch either
+     * @note A file that's overwritten in place doesn't change the modification time of its directory, it's read with the size it had when the index was built till something else in its directory changes
+     */
+    class LayeredFileSystem : public FileSystem {
+      public:
+        /**
+         * @brief A directory in the merged tree
+         */
+        struct DirectoryEntry {
+            std::string path; //!< The path of the directory relative to the root, the root directory has an empty path
+            bool overridden; //!< If the directory exists in the override directory
+            timespec modified; //!< The modification time of the directory in the override directory, this is only valid if it's overridden
+            std::vector<u32> directories; //!< The indices of the child directories of this directory
+            std::vector<u32> files; //!< The indices of the child files of this directory
+        };
+
+        /**
+         * @brief A file in the merged tree
+         */
+        struct FileEntry {
+            std::string path; //!< The path of the file relative to the root
+            bool overridden; //!< If the file is read from the override directory rather than the RomFS
+            u64 offset; //!< The offset of the file in the RomFS backing, this is only valid if it isn't overridden
+            u64 size; //!< The size of the file in bytes
+            u64 imageOffset; //!< The offset of the contents of the file in the merged RomFS image
+        };
+
+        /**
+         * @brief The index of the merged tree alongside the metadata of the merged RomFS image, this is shared with any directories and images opened from the filesystem
+         */
+        struct LayeredIndex {
+            std::shared_ptr<Backing> romFs; //!< The backing of the RomFS image that's overridden
+            std::shared_ptr<OsFileSystem> overrides; //!< The override directory
+            std::vector<DirectoryEntry> directories; //!< Every directory in the merged tree sorted by their path, the root directory is always the first
+            std::vector<FileEntry> files; //!< Every file in the merged tree sorted by their path, this results in them also being sorted by their offset in the image
+            std::unordered_map<std::string, u32> directoryLookup; //!< A map from the path of a directory to its index
+            std::unordered_map<std::string, u32> fileLookup; //!< A map from the path of a file to its index
+
+            std::vector<u8> header; //!< The contents of the merged RomFS image before the file data, this is the RomFS header followed by padding
+            std::vector<u8> metadata; //!< The hash and metadata tables of the merged RomFS image, these directly follow the file data
+            u64 metadataOffset; //!< The offset of the metadata tables in the merged RomFS image
+
+            std::mutex overrideMutex; //!< This mutex guards overrideBackings
+            std::vector<std::shared_ptr<Backing>> overrideBackings; //!< The backings of overridden files by their index, these are opened on their first read
+
+            /**
+             * @return The backing of the contents of the file at the supplied index, overridden files are opened the first time this is called for them
+             */
+            std::shared_ptr<Backing> GetFileBacking(u32 index);
+        };
+
+      private:
+        std::shared_ptr<LayeredIndex> index;
+
+        /**
+         * @brief Populates the index by merging the override directory over the RomFS, this traverses the entirety of both
+         */
+        void BuildIndex(const std::string &overridePath);
+
+        /**
+         * @brief Populates the index from an entry in the metadata cache
+         * @return If the entry could be used, it can't if it's malformed or any override directory was modified after it was created
+         */
+        bool LoadIndex(std::span<const u8> cached, const std::string &overridePath);
+
+        /**
+         * @return An entry for the metadata cache holding the index
+         */
+        std::vector<u8> SaveIndex();
+
+        /**
+         * @brief Links every directory to its children, lays out all files in the merged RomFS image and generates its header and metadata tables
+         */
+        void BuildImage();
+
+      public:
+        /**
+         * @param romFs The backing of the RomFS image that's overridden
+         * @param overridePath The path of the override directory, this must exist
+         * @param cache A metadata cache that the index is looked up in and added to, this is optional
+         * @param cacheKey The key of the filesystem's entry in the metadata cache
+         */
+        LayeredFileSystem(std::shared_ptr<Backing> romFs, const std::string &overridePath, const std::shared_ptr<MetadataCache> &cache = nullptr, const std::string &cacheKey = {});
+
+        /**
+         * @return A backing of a RomFS image holding the merged tree, it's never written out and only reads the contents of files from the RomFS or override directory
+         */
+        std::shared_ptr<Backing> OpenRomFs();
+
+        std::shared_ptr<Backing> OpenFile(const std::string &path, Backing::Mode mode = {true, false, false});
+
+        std::optional<Directory::EntryType> GetEntryType(const std::string &path);
+
+        std::shared_ptr<Directory> OpenDirectory(const std::string &path, Directory::ListMode listMode);
+    };
+
+    /**
+     * @brief The LayeredRomFsBacking class provides a RomFS image of the merged tree of a LayeredFileSystem
+     */
+    class LayeredRomFsBacking : public Backing {
+      private:
+        std::shared_ptr<LayeredFileSystem::LayeredIndex> index;
+
+      public:
+        LayeredRomFsBacking(const std::shared_ptr<LayeredFileSystem::LayeredIndex> &index);
+
+        size_t Read(u8 *output, size_t offset, size_t size);
+
+        std::span<const u8> GetSpan(size_t offset, size_t size);
+    };
+
+    /**
+     * @brief The LayeredFileSystemDirectory provides access to directories within a LayeredFileSystem
+     */
+    class LayeredFileSystemDirectory : public Directory {
+      private:
+        std::shared_ptr<LayeredFileSystem::LayeredIndex> index;
+        u32 directory; //!< The index of this directory
+
+      public:
+        LayeredFileSystemDirectory(const std::shared_ptr<LayeredFileSystem::LayeredIndex> &index, u32 directory, ListMode listMode);
+
+        std::vector<Entry> Read();
+    };
+}
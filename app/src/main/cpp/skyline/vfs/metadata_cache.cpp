@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <sys/stat.h>
+#include "os_filesystem.h"
+#include "metadata_cache.h"
+
+namespace skyline::vfs {
+    MetadataCache::MetadataCache(const std::string &path, int romFd) : path(path) {
+        struct stat romStat{};
+        if (fstat(romFd, &romStat))
+            throw exception("Failed to stat the ROM for the metadata cache: {}", strerror(errno));
+
+        identity = CacheHeader{
+            .magic = util::MakeMagic<u32>("MDC0"),
+            .romDevice = static_cast<u64>(romStat.st_dev),
+            .romInode = static_cast<u64>(romStat.st_ino),
+            .romSize = static_cast<u64>(romStat.st_size),
+            .romModifiedSeconds = static_cast<i64>(romStat.st_mtim.tv_sec),
+            .romModifiedNanoseconds = static_cast<i64>(romStat.st_mtim.tv_nsec),
+        };
+        name = fmt::format("{:016X}", util::Hash(std::string_view(reinterpret_cast<const char *>(&identity.romDevice), sizeof(CacheHeader) - offsetof(CacheHeader, romDevice))));
+
+        OsFileSystem directory(path);
+        if (!directory.FileExists(name))
+            return;
+
+        auto backing{directory.OpenFile(name)};
+        std::vector<u8> file(backing->size);
+        backing->Read(file.data(), 0, file.size());
+
+        // A cache file that doesn't match the ROM or is truncated is discarded entirely, it'll be overwritten on the next save
+        CacheHeader header{};
+        if (file.size() < sizeof(CacheHeader))
+            return;
+        std::memcpy(&header, file.data(), sizeof(CacheHeader));
+        if (header.magic != identity.magic || header.romDevice != identity.romDevice || header.romInode != identity.romInode || header.romSize != identity.romSize || header.romModifiedSeconds != identity.romModifiedSeconds || header.romModifiedNanoseconds != identity.romModifiedNanoseconds)
+            return;
+
+        size_t offset{sizeof(CacheHeader)};
+        for (u32 index{}; index < header.entryCount; index++) {
+            u32 sizes[2];
+            if (offset + sizeof(sizes) > file.size())
+                break;
+            std::memcpy(sizes, file.data() + offset, sizeof(sizes));
+            offset += sizeof(sizes);
+
+            if (offset + sizes[0] + sizes[1] > file.size())
+                break;
+            std::string key(reinterpret_cast<const char *>(file.data() + offset), sizes[0]);
+            offset += sizes[0];
+            entries.emplace(std::move(key), std::vector<u8>(file.begin() + offset, file.begin() + offset + sizes[1]));
+            offset += sizes[1];
+        }
+    }
+
+    std::optional<std::vector<u8>> MetadataCache::Get(const std::string &key) {
+        std::lock_guard lock(mutex);
+        auto entry{entries.find(key)};
+        if (entry == entries.end())
+            return std::nullopt;
+        return entry->second;
+    }
+
+    void MetadataCache::Put(const std::string &key, std::span<const u8> data) {
+        std::lock_guard lock(mutex);
+        entries.insert_or_assign(key, std::vector<u8>(data.begin(), data.end()));
+        dirty = true;
+    }
+
+    void MetadataCache::Save() {
+        std::lock_guard lock(mutex);
+        if (!dirty)
+            return;
+
+        // The file is assembled in memory and written out with a single write
+        auto header{identity};
+        header.entryCount = static_cast<u32>(entries.size());
+        std::vector<u8> file(sizeof(CacheHeader));
+        std::memcpy(file.data(), &header, sizeof(CacheHeader));
+
+        for (const auto &[key, data] : entries) {
+            u32 sizes[2]{static_cast<u32>(key.size()), static_cast<u32>(data.size())};
+            file.insert(file.end(), reinterpret_cast<u8 *>(sizes), reinterpret_cast<u8 *>(sizes) + sizeof(sizes));
+            file.insert(file.end(), key.begin(), key.end());
+            file.insert(file.end(), data.begin(), data.end());
+        }
+
+        OsFileSystem directory(path);
+        if (!directory.CreateFile(name, file.size()))
+            throw exception("Failed to create the metadata cache file: {}", name);
+        directory.OpenFile(name, {false, true, false})->Write(file.data(), 0, file.size());
+        dirty = false;
+    }
+}
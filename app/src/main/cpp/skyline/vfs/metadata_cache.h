@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+
+namespace skyline::vfs {
+    /**
+     * @brief The MetadataCache class persists the parsed metadata of a ROM such as decrypted NCA headers and filesystem tables, so relaunching it doesn't need to decrypt or traverse them again
+     * @note Every ROM has its own cache file which is keyed by the identity, size and modification time of the ROM file, any modification to the ROM invalidates it
+     */
+    class MetadataCache {
+      private:
+        /**
+         * @brief The header of a metadata cache file, this is followed by all of its entries
+         * @note Every entry is made up of a u32 key size, a u32 data size, the key and the data
+         */
+        struct CacheHeader {
+            u32 magic; //!< The magic of a metadata cache file: 'MDC0'
+            u32 entryCount; //!< The amount of entries in the file
+            u64 romDevice; //!< The device that holds the ROM file
+            u64 romInode; //!< The inode of the ROM file
+            u64 romSize; //!< The size of the ROM file in bytes
+            i64 romModifiedSeconds; //!< The modification time of the ROM file in seconds
+            i64 romModifiedNanoseconds; //!< The nanoseconds component of the modification time of the ROM file
+        };
+        static_assert(sizeof(CacheHeader) == 0x30);
+
+        std::string path; //!< The directory that holds all metadata cache files
+        std::string name; //!< The name of the cache file of the ROM in the directory
+        CacheHeader identity{}; //!< A header holding the identity of the ROM file which the cache file must match to be used
+        std::mutex mutex; //!< This mutex guards the entries
+        std::unordered_map<std::string, std::vector<u8>> entries; //!< A map from the key of an entry to its data
+        bool dirty{}; //!< If any entries were added since the cache was loaded
+
+      public:
+        /**
+         * @param path The directory that holds all metadata cache files, it's created if it doesn't exist
+         * @param romFd A file descriptor of the ROM that the cache is for
+         */
+        MetadataCache(const std::string &path, int romFd);
+
+        /**
+         * @return The data of an entry, if it exists
+         */
+        std::optional<std::vector<u8>> Get(const std::string &key);
+
+        /**
+         * @brief Adds or replaces an entry, this is only persisted once the cache is saved
+         */
+        void Put(const std::string &key, std::span<const u8> data);
+
+        /**
+         * @brief Writes out the cache file if any entries have been added since it was loaded
+         */
+        void Save();
+    };
+}
@@ -7,6 +7,8 @@ namespace skyline::vfs {
     NACP::NACP(const std::shared_ptr<vfs::Backing> &backing) {
         backing->Read(&nacpContents);
 
+        displayVersion = std::string(nacpContents.displayVersion.data(), strnlen(nacpContents.displayVersion.data(), nacpContents.displayVersion.size()));
+
         // TODO: Select based on language settings, complete struct, yada yada
 
         // Iterate till we get to the first populated entry
@@ -28,9 +28,11 @@ namespace skyline::vfs {
          */
         struct NacpData {
             std::array<ApplicationTitle, 0x10> titleEntries; //!< Title entries for each language
-            u8 _pad0_[0x78];
+            u8 _pad0_[0x60];
+            std::array<char, 0x10> displayVersion; //!< The user-facing version of the application
+            u8 _pad1_[0x8];
             u64 saveDataOwnerId; //!< The ID that should be used for this application's savedata
-            u8 _pad1_[0xF80];
+            u8 _pad2_[0xF80];
         } nacpContents{};
         static_assert(sizeof(NacpData) == 0x4000);
 
@@ -41,5 +43,6 @@ namespace skyline::vfs {
 
         std::string applicationName; //!< The name of the application in the currently selected language
         std::string applicationPublisher; //!< The publisher of the application in the currently selected language
+        std::string displayVersion; //!< The user-facing version of the application
     };
 }
\ No newline at end of file
@@ -3,7 +3,12 @@
 
 #include <crypto/aes_cipher.h>
 #include <loader/loader.h>
+#include <boot_report.h>
 #include "ctr_encrypted_backing.h"
+#include "ctr_ex_encrypted_backing.h"
+#include "indirect_backing.h"
+#include "cached_backing.h"
+#include "ncz_backing.h"
 #include "region_backing.h"
 #include "partition_filesystem.h"
 #include "nca.h"
@@ -13,7 +18,117 @@
 namespace skyline::vfs {
     using namespace loader;
 
-    NCA::NCA(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore) : backing(backing), keyStore(keyStore) {
+    namespace {
+        constexpr size_t BucketTreeNodeSize{0x4000}; //!< The size of every node in a bucket tree
+
+        /**
+         * @brief The header of every node in a bucket tree
+         */
+        struct BucketTreeNodeHeader {
+            u32 index;
+            u32 count; //!< The amount of offsets in the root node or entries in an entry set
+            u64 endOffset; //!< The end of the range covered by entries in the node
+        };
+        static_assert(sizeof(BucketTreeNodeHeader) == 0x10);
+
+        /**
+         * @brief Reads out every entry of a bucket tree into a flat array sorted by their offset, so lookups are a binary search over a single array rather than a traversal of the tree
+         * @param endOffset This is set to the end of the range covered by the last entry
+         * @note The root node is followed by every entry set, trees which need more entry sets than the root node can hold aren't supported
+         */
+        template<typename EntryType>
+        std::vector<EntryType> ReadBucketTree(Backing &backing, u64 offset, u64 size, u32 entryCount, u64 &endOffset) {
+            if (size < BucketTreeNodeSize)
+                throw exception("A bucket tree at 0x{:X} is smaller than a single node: 0x{:X}", offset, size);
+
+            std::vector<u8> tree(size);
+            if (backing.Read(tree.data(), offset, size) != size)
+                throw exception("Failed to read a bucket tree at 0x{:X}", offset);
+
+            BucketTreeNodeHeader root;
+            std::memcpy(&root, tree.data(), sizeof(root));
+            if (root.count > (BucketTreeNodeSize - sizeof(BucketTreeNodeHeader)) / sizeof(u64) || (root.count + 1) * BucketTreeNodeSize > size)
+                throw exception("A bucket tree at 0x{:X} has an invalid amount of entry sets: {}", offset, root.count);
+
+            std::vector<EntryType> entries;
+            entries.reserve(entryCount);
+            for (size_t set{1}; set <= root.count; set++) {
+                auto node{tree.data() + set * BucketTreeNodeSize};
+                BucketTreeNodeHeader header;
+                std::memcpy(&header, node, sizeof(header));
+                if (header.count > (BucketTreeNodeSize - sizeof(BucketTreeNodeHeader)) / sizeof(EntryType))
+                    throw exception("An entry set of a bucket tree at 0x{:X} has an invalid amount of entries: {}", offset, header.count);
+
+                auto setEntries{reinterpret_cast<const EntryType *>(node + sizeof(BucketTreeNodeHeader))};
+                entries.insert(entries.end(), setEntries, setEntries + header.count);
+            }
+
+            if (entries.size() != entryCount)
+                throw exception("A bucket tree at 0x{:X} has {} entries rather than {}", offset, entries.size(), entryCount);
+
+            endOffset = root.endOffset;
+            return entries;
+        }
+    }
+
+    NCA::NCA(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<MetadataCache> &cache, const std::string &cacheKey, std::optional<NcaContentType> sectionFilter, bool verifyIntegrity) : backing(backing), keyStore(keyStore), cache(cache), cacheKey(cacheKey), verifyIntegrity(verifyIntegrity) {
+        if (NczBacking::IsNcz(this->backing)) {
+            this->backing = std::make_shared<NczBacking>(this->backing);
+            compressed = true;
+        }
+
+        // The cached header is stored decrypted and is followed by a byte denoting if the NCA is encrypted, so the header doesn't need to be decrypted again
+        auto cached{cache ? cache->Get(cacheKey + "/header") : std::nullopt};
+        if (cached && cached->size() == sizeof(NcaHeader) + 1 && reinterpret_cast<NcaHeader *>(cached->data())->magic == util::MakeMagic<u32>("NCA3")) {
+            std::memcpy(&header, cached->data(), sizeof(NcaHeader));
+            encrypted = cached->back();
+        } else {
+            ReadHeader();
+        }
+
+        contentType = header.contentType;
+        programId = header.programId;
+        rightsIdEmpty = header.rightsId == crypto::KeyStore::Key128{};
+
+        if (sectionFilter && contentType != *sectionFilter)
+            return;
+
+        for (size_t i{}; i < header.sectionHeaders.size(); i++) {
+            auto &sectionHeader{header.sectionHeaders.at(i)};
+            auto &sectionEntry{header.fsEntries.at(i)};
+
+            if (sectionHeader.fsType == NcaSectionFsType::PFS0 && sectionHeader.hashType == NcaSectionHashType::HierarchicalSha256)
+                ReadPfs0(sectionHeader, sectionEntry, i);
+            else if (sectionHeader.fsType == NcaSectionFsType::RomFs && sectionHeader.hashType == NcaSectionHashType::HierarchicalIntegrity)
+                ReadRomFs(sectionHeader, sectionEntry, i);
+        }
+    }
+
+    bool NCA::Verify() {
+        for (size_t i{}; i < header.sectionHeaders.size(); i++) {
+            auto &sectionHeader{header.sectionHeaders.at(i)};
+            if (!(sectionHeader.fsType == NcaSectionFsType::PFS0 && sectionHeader.hashType == NcaSectionHashType::HierarchicalSha256) && !(sectionHeader.fsType == NcaSectionFsType::RomFs && sectionHeader.hashType == NcaSectionHashType::HierarchicalIntegrity))
+                continue;
+
+            // The hash tree of a patch section covers the patched section, so it can't be verified without the base NCA
+            if (sectionHeader.encryptionType == NcaSectionEncryptionType::BKTR)
+                continue;
+
+            try {
+                auto verified{CreateVerifiedBacking(i)};
+                if (!verified || !verified->Verify())
+                    return false;
+            } catch (const loader_exception &e) {
+                throw;
+            } catch (const std::exception &e) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void NCA::ReadHeader() {
+        boot::ScopedPhase phase(boot::Phase::NcaHeader);
         backing->Read(&header);
 
         if (header.magic != util::MakeMagic<u32>("NCA3")) {
@@ -30,25 +145,24 @@ namespace skyline::vfs {
             encrypted = true;
         }
 
-        contentType = header.contentType;
-        rightsIdEmpty = header.rightsId == crypto::KeyStore::Key128{};
-
-        for (size_t i{}; i < header.sectionHeaders.size(); i++) {
-            auto &sectionHeader{header.sectionHeaders.at(i)};
-            auto &sectionEntry{header.fsEntries.at(i)};
-
-            if (sectionHeader.fsType == NcaSectionFsType::PFS0 && sectionHeader.hashType == NcaSectionHashType::HierarchicalSha256)
-                ReadPfs0(sectionHeader, sectionEntry);
-            else if (sectionHeader.fsType == NcaSectionFsType::RomFs && sectionHeader.hashType == NcaSectionHashType::HierarchicalIntegrity)
-                ReadRomFs(sectionHeader, sectionEntry);
+        if (cache) {
+            std::vector<u8> metadata(reinterpret_cast<u8 *>(&header), reinterpret_cast<u8 *>(&header + 1));
+            metadata.push_back(encrypted);
+            cache->Put(cacheKey + "/header", metadata);
         }
     }
 
-    void NCA::ReadPfs0(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry) {
+    void NCA::ReadPfs0(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry, size_t index) {
         size_t offset{static_cast<size_t>(entry.startOffset) * constant::MediaUnitSize + sectionHeader.sha256HashInfo.pfs0Offset};
         size_t size{constant::MediaUnitSize * static_cast<size_t>(entry.endOffset - entry.startOffset)};
 
-        auto pfs{std::make_shared<PartitionFileSystem>(CreateBacking(sectionHeader, std::make_shared<RegionBacking>(backing, offset, size), offset))};
+        std::shared_ptr<Backing> pfsBacking;
+        if (verifyIntegrity)
+            pfsBacking = CreateVerifiedBacking(index);
+        else
+            pfsBacking = CreateBacking(sectionHeader, std::make_shared<RegionBacking>(backing, offset, size), offset);
+
+        auto pfs{std::make_shared<PartitionFileSystem>(pfsBacking, cache, fmt::format("{}/pfs0@{:X}", cacheKey, offset))};
 
         if (contentType == NcaContentType::Program) {
             // An ExeFS must always contain an NPDM and a main NSO, whereas the logo section will always contain a logo and a startup movie
@@ -61,15 +175,117 @@ namespace skyline::vfs {
         }
     }
 
-    void NCA::ReadRomFs(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry) {
-        size_t offset{static_cast<size_t>(entry.startOffset) * constant::MediaUnitSize + sectionHeader.integrityHashInfo.levels.back().offset};
-        size_t size{sectionHeader.integrityHashInfo.levels.back().size};
+    void NCA::ReadRomFs(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry, size_t index) {
+        // A patch section can only be read once it's applied over the RomFS of its base NCA
+        if (sectionHeader.encryptionType == NcaSectionEncryptionType::BKTR) {
+            patchSection = index;
+            return;
+        }
+
+        // The RomFS is a region of the decrypted section, so the section and the RomFS share their cache of decrypted blocks
+        size_t sectionOffset{static_cast<size_t>(entry.startOffset) * constant::MediaUnitSize};
+        romFsSection = CreateBacking(sectionHeader, std::make_shared<RegionBacking>(backing, sectionOffset, constant::MediaUnitSize * static_cast<size_t>(entry.endOffset - entry.startOffset)), sectionOffset);
 
-        romFs = CreateBacking(sectionHeader, std::make_shared<RegionBacking>(backing, offset, size), offset);
+        if (verifyIntegrity) {
+            romFs = CreateVerifiedBacking(index);
+            return;
+        }
+
+        if (romFsSection) {
+            auto &level{sectionHeader.integrityHashInfo.levels.back()};
+            romFs = std::make_shared<RegionBacking>(romFsSection, level.offset, level.size);
+        }
+    }
+
+    std::shared_ptr<Backing> NCA::CreatePatchedRomFs(const NCA &base) {
+        if (!patchSection)
+            throw exception("Cannot apply an NCA without a patch section");
+        if (!base.romFsSection)
+            throw exception("Cannot apply a patch over an NCA without a RomFS section");
+
+        auto &sectionHeader{header.sectionHeaders.at(*patchSection)};
+        auto &entry{header.fsEntries.at(*patchSection)};
+        auto &indirectInfo{sectionHeader.indirectInfo};
+        auto &aesCtrExInfo{sectionHeader.aesCtrExInfo};
+        if (indirectInfo.magic != util::MakeMagic<u32>("BKTR") || aesCtrExInfo.magic != util::MakeMagic<u32>("BKTR"))
+            throw exception("The patch section has an invalid bucket tree magic");
+
+        size_t sectionOffset{static_cast<size_t>(entry.startOffset) * constant::MediaUnitSize};
+        auto rawSection{std::make_shared<RegionBacking>(backing, sectionOffset, constant::MediaUnitSize * static_cast<size_t>(entry.endOffset - entry.startOffset))};
+
+        // The bucket trees are encrypted with the counter of the section itself, only the data they describe uses the generations from the AES-CTR-EX table
+        auto tables{CreateBacking(sectionHeader, rawSection, sectionOffset)};
+        if (!tables)
+            throw exception("The patch section has an unsupported encryption type");
+
+        u64 patchedSize{};
+        auto relocations{ReadBucketTree<IndirectBacking::Entry>(*tables, indirectInfo.offset, indirectInfo.size, indirectInfo.entryCount, patchedSize)};
+
+        std::shared_ptr<Backing> patch{tables};
+        if (encrypted && !compressed) {
+            u64 subsectionsEnd{};
+            auto subsections{ReadBucketTree<CtrExEncryptedBacking::Entry>(*tables, aesCtrExInfo.offset, aesCtrExInfo.size, aesCtrExInfo.entryCount, subsectionsEnd)};
+
+            // The subsections only cover the data, the bucket trees after it use the generation of the section
+            subsections.push_back({.offset = indirectInfo.offset, .generation = sectionHeader.generation});
+
+            auto key{!rightsIdEmpty ? GetTitleKey() : GetKeyAreaKey(sectionHeader.encryptionType)};
+            patch = std::make_shared<CachedBacking>(std::make_shared<CtrExEncryptedBacking>(GetSectionCtr(sectionHeader), key, rawSection, sectionOffset, std::move(subsections)));
+        }
+
+        auto &level{sectionHeader.integrityHashInfo.levels.back()};
+        if (level.offset + level.size > patchedSize)
+            throw exception("The RomFS of the patch section is outside of the patched section: 0x{:X} + 0x{:X} > 0x{:X}", level.offset, level.size, patchedSize);
+
+        auto indirect{std::make_shared<IndirectBacking>(base.romFsSection, std::move(patch), std::move(relocations), patchedSize)};
+        return std::make_shared<RegionBacking>(std::move(indirect), level.offset, level.size);
+    }
+
+    std::shared_ptr<IntegrityBacking> NCA::CreateVerifiedBacking(size_t index) {
+        auto &sectionHeader{header.sectionHeaders.at(index)};
+        auto &entry{header.fsEntries.at(index)};
+        if (crypto::Sha256({reinterpret_cast<const u8 *>(&sectionHeader), sizeof(NcaSectionHeader)}) != header.sectionHashes.at(index))
+            throw exception("The header of NCA section {} doesn't match its hash", index);
+
+        // The hash tree is read out of the decrypted section, every level is verified by the level above it and the topmost level is verified by the hash in the section header
+        size_t sectionOffset{static_cast<size_t>(entry.startOffset) * constant::MediaUnitSize};
+        auto section{CreateBacking(sectionHeader, std::make_shared<RegionBacking>(backing, sectionOffset, constant::MediaUnitSize * static_cast<size_t>(entry.endOffset - entry.startOffset)), sectionOffset)};
+        if (!section)
+            return nullptr;
+
+        auto region{[&](u64 offset, u64 size) {
+            if (offset + size > section->size)
+                throw exception("A hash level of NCA section {} is outside of the section: 0x{:X} + 0x{:X}", index, offset, size);
+            return std::make_shared<RegionBacking>(section, offset, size);
+        }};
+
+        if (sectionHeader.hashType == NcaSectionHashType::HierarchicalSha256) {
+            auto &hashInfo{sectionHeader.sha256HashInfo};
+            auto hashTable{std::make_shared<IntegrityBacking>(region(hashInfo.hashTableOffset, hashInfo.hashTableSize), std::vector<crypto::Sha256Hash>{hashInfo.hashTableHash}, std::max<size_t>(hashInfo.hashTableSize, 1), false)};
+            return std::make_shared<IntegrityBacking>(region(hashInfo.pfs0Offset, hashInfo.pfs0Size), hashTable, hashInfo.blockSize, false);
+        }
+
+        auto &hashInfo{sectionHeader.integrityHashInfo};
+        if (hashInfo.numLevels < 2 || hashInfo.numLevels - 1 > hashInfo.levels.size() || hashInfo.masterHashSize != sizeof(crypto::Sha256Hash))
+            throw exception("NCA section {} has an invalid hierarchical integrity header", index);
+
+        std::shared_ptr<IntegrityBacking> level;
+        for (size_t levelIndex{}; levelIndex < hashInfo.numLevels - 1; levelIndex++) {
+            auto &levelInfo{hashInfo.levels[levelIndex]};
+            if (levelInfo.blockSize >= 32)
+                throw exception("NCA section {} has an invalid block size in hash level {}: 2^{}", index, levelIndex, levelInfo.blockSize);
+
+            auto levelBacking{region(levelInfo.offset, levelInfo.size)};
+            if (level)
+                level = std::make_shared<IntegrityBacking>(levelBacking, level, 1ULL << levelInfo.blockSize, true);
+            else
+                level = std::make_shared<IntegrityBacking>(levelBacking, std::vector<crypto::Sha256Hash>{hashInfo.masterHash}, 1ULL << levelInfo.blockSize, true);
+        }
+        return level;
     }
 
     std::shared_ptr<Backing> NCA::CreateBacking(const NcaSectionHeader &sectionHeader, std::shared_ptr<Backing> rawBacking, size_t offset) {
-        if (!encrypted)
+        if (!encrypted || compressed)
             return rawBacking;
 
         switch (sectionHeader.encryptionType) {
@@ -78,20 +294,25 @@ namespace skyline::vfs {
             case NcaSectionEncryptionType::CTR:
             case NcaSectionEncryptionType::BKTR: {
                 auto key{!rightsIdEmpty ? GetTitleKey() : GetKeyAreaKey(sectionHeader.encryptionType)};
+                auto ctr{GetSectionCtr(sectionHeader)};
 
-                std::array<u8, 0x10> ctr{};
-                u32 secureValueLE{__builtin_bswap32(sectionHeader.secureValue)};
-                u32 generationLE{__builtin_bswap32(sectionHeader.generation)};
-                std::memcpy(ctr.data(), &secureValueLE, 4);
-                std::memcpy(ctr.data() + 4, &generationLE, 4);
-
-                return std::make_shared<CtrEncryptedBacking>(ctr, key, std::move(rawBacking), offset);
+                // Decrypted blocks are cached as the same regions are read repeatedly, such as the metadata tables of a RomFS
+                return std::make_shared<CachedBacking>(std::make_shared<CtrEncryptedBacking>(ctr, key, std::move(rawBacking), offset));
             }
             default:
                 return nullptr;
         }
     }
 
+    std::array<u8, 0x10> NCA::GetSectionCtr(const NcaSectionHeader &sectionHeader) {
+        std::array<u8, 0x10> ctr{};
+        u32 secureValueLE{__builtin_bswap32(sectionHeader.secureValue)};
+        u32 generationLE{__builtin_bswap32(sectionHeader.generation)};
+        std::memcpy(ctr.data(), &secureValueLE, 4);
+        std::memcpy(ctr.data() + 4, &generationLE, 4);
+        return ctr;
+    }
+
     u8 NCA::GetKeyGeneration() {
         u8 legacyGen{static_cast<u8>(header.legacyKeyGenerationType)};
         u8 gen{static_cast<u8>(header.keyGenerationType)};
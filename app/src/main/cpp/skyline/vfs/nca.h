@@ -7,6 +7,8 @@
 #include <crypto/key_store.h>
 #include <crypto/aes_cipher.h>
 #include "filesystem.h"
+#include "metadata_cache.h"
+#include "integrity_backing.h"
 
 namespace skyline {
     namespace constant {
@@ -113,7 +115,7 @@ namespace skyline {
             struct HierarchicalIntegrityLevel {
                 u64 offset; //!< The offset of the level data
                 u64 size; //!< The size of the level data
-                u32 blockSize; //!< The block size of the level data
+                u32 blockSize; //!< The base 2 logarithm of the block size of the level data
                 u32 _pad_;
             };
             static_assert(sizeof(HierarchicalIntegrityLevel) == 0x18);
@@ -148,6 +150,19 @@ namespace skyline {
             };
             static_assert(sizeof(HierarchicalSha256HashInfo) == 0xF8);
 
+            /**
+             * @brief This holds the location and header of a bucket tree in a patch section (https://switchbrew.org/wiki/NCA#Bucket_Tree)
+             */
+            struct BucketTreeInfo {
+                u64 offset; //!< The offset of the bucket tree from the start of the section
+                u64 size; //!< The size of the bucket tree
+                u32 magic; //!< The bucket tree magic, 'BKTR'
+                u32 version; //!< The version of the bucket tree
+                u32 entryCount; //!< The amount of entries in the bucket tree
+                u32 _pad_;
+            };
+            static_assert(sizeof(BucketTreeInfo) == 0x20);
+
             /**
              * @brief This holds the header of each specific section in an NCA
              */
@@ -161,7 +176,8 @@ namespace skyline {
                     HierarchicalIntegrityHashInfo integrityHashInfo; //!< The HashInfo used for RomFS
                     HierarchicalSha256HashInfo sha256HashInfo; //!< The HashInfo used for PFS0
                 };
-                u8 _pad1_[0x40]; // PatchInfo
+                BucketTreeInfo indirectInfo; //!< The relocation table of a BKTR patch section
+                BucketTreeInfo aesCtrExInfo; //!< The AES-CTR-EX table of a BKTR patch section
                 u32 generation; //!< The generation of the NCA section
                 u32 secureValue; //!< The secure value of the section
                 u8 _pad2_[0x30]; //!< SparseInfo
@@ -199,14 +215,36 @@ namespace skyline {
             std::shared_ptr<Backing> backing; //!< The backing for the NCA
             std::shared_ptr<crypto::KeyStore> keyStore;
             bool encrypted{false};
+            bool compressed{false}; //!< If the NCA is stored as an NCZ, its sections are stored decrypted in that case
             bool rightsIdEmpty;
+            std::shared_ptr<MetadataCache> cache; //!< The metadata cache that the header and PFS0 sections are looked up in, this may be null
+            std::string cacheKey; //!< The prefix of the NCA's entries in the metadata cache
+            bool verifyIntegrity; //!< If the sections are verified against their hashes as they're read
+            std::optional<size_t> patchSection; //!< The index of the BKTR patch section of the NCA, if it has one
 
-            void ReadPfs0(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry);
+            /**
+             * @brief Reads the header from the backing and decrypts it if it's encrypted
+             */
+            void ReadHeader();
 
-            void ReadRomFs(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry);
+            void ReadPfs0(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry, size_t index);
+
+            void ReadRomFs(const NcaSectionHeader &sectionHeader, const NcaFsEntry &entry, size_t index);
 
             std::shared_ptr<Backing> CreateBacking(const NcaSectionHeader &sectionHeader, std::shared_ptr<Backing> rawBacking, size_t offset);
 
+            /**
+             * @return The initial AES-CTR counter of a section, this holds its secure value and generation
+             */
+            static std::array<u8, 0x10> GetSectionCtr(const NcaSectionHeader &sectionHeader);
+
+            /**
+             * @brief Creates a backing for the filesystem data of a section that verifies it against the hash tree of the section
+             * @return The backing of the data, this is null if the section's encryption type isn't supported
+             * @note The section header is verified against its hash in the NCA header, the rest of the hash tree is only verified as it's read
+             */
+            std::shared_ptr<IntegrityBacking> CreateVerifiedBacking(size_t index);
+
             u8 GetKeyGeneration();
 
             crypto::KeyStore::Key128 GetTitleKey();
@@ -217,10 +255,38 @@ namespace skyline {
             std::shared_ptr<FileSystem> exeFs; //!< The PFS0 filesystem for this NCA's ExeFS section
             std::shared_ptr<FileSystem> logo; //!< The PFS0 filesystem for this NCA's logo section
             std::shared_ptr<FileSystem> cnmt; //!< The PFS0 filesystem for this NCA's CNMT section
-            std::shared_ptr<Backing> romFs; //!< The backing for this NCA's RomFS section
+            std::shared_ptr<Backing> romFs; //!< The backing for this NCA's RomFS section, this is null for a patch NCA till its patch is applied with CreatePatchedRomFs
+            std::shared_ptr<Backing> romFsSection; //!< The backing for the entirety of the RomFS section including its hash tree, patches relocate data out of this
             NcaContentType contentType; //!< The content type of the NCA
+            u64 programId; //!< The program ID of the NCA
+
+            /**
+             * @param cache A metadata cache that the decrypted header and PFS0 file tables are looked up in and added to, this is optional
+             * @param cacheKey The prefix of the NCA's entries in the metadata cache, this must be unique within the ROM
+             * @param sectionFilter If this is set, the sections of the NCA are only parsed if it has this content type, this avoids decrypting sections that won't be used
+             * @param verifyIntegrity If the sections should be verified against their hashes as they're read, reading any data that doesn't match its hash throws an exception
+             */
+            NCA(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore, const std::shared_ptr<MetadataCache> &cache = nullptr, const std::string &cacheKey = {}, std::optional<NcaContentType> sectionFilter = std::nullopt, bool verifyIntegrity = false);
+
+            /**
+             * @brief Verifies the entire contents of all sections against their hashes, this reads out the entire NCA so it's only done on request
+             * @return If all sections match their hashes
+             */
+            bool Verify();
+
+            /**
+             * @return If the NCA has a BKTR patch section rather than a regular RomFS section, it needs to be applied over its base NCA
+             */
+            bool IsPatch() const {
+                return patchSection.has_value();
+            }
 
-            NCA(const std::shared_ptr<vfs::Backing> &backing, const std::shared_ptr<crypto::KeyStore> &keyStore);
+            /**
+             * @brief Applies the BKTR patch section of this NCA over the RomFS section of its base NCA
+             * @return A backing of the patched RomFS, its data is relocated out of both NCAs as it's read so neither is merged upfront
+             * @note The base NCA must outlive the returned backing
+             */
+            std::shared_ptr<Backing> CreatePatchedRomFs(const NCA &base);
         };
     }
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include <zstd.h>
+#include "ncz_backing.h"
+
+namespace skyline::vfs {
+    bool NczBacking::IsNcz(const std::shared_ptr<Backing> &backing) {
+        u64 magic{};
+        return backing->size >= HeaderSize + sizeof(SectionHeader) && backing->Read(&magic, HeaderSize) == sizeof(magic) && magic == util::MakeMagic<u64>("NCZSECTN");
+    }
+
+    NczBacking::NczBacking(std::shared_ptr<Backing> backing) : backing(std::move(backing)), context(ZSTD_createDCtx(), ZSTD_freeDCtx), registration("NCZ Block Cache", cache::Priority::Medium, [this] { return GetCacheSize(); }, [this](size_t target) { return Evict(target); }) {
+        if (!context)
+            throw exception("Failed to create a zstd decompression context");
+
+        SectionHeader sectionHeader{};
+        this->backing->Read(&sectionHeader, HeaderSize);
+        if (sectionHeader.magic != util::MakeMagic<u64>("NCZSECTN"))
+            throw exception("Invalid NCZ section header magic");
+
+        size_t offset{HeaderSize + sizeof(SectionHeader) + (sectionHeader.sectionCount * sizeof(SectionEntry))};
+        BlockHeader blockHeader{};
+        if (this->backing->Read(&blockHeader, offset) != sizeof(BlockHeader) || blockHeader.magic != util::MakeMagic<u64>("NCZBLOCK"))
+            throw exception("Only block-compressed NCZs can be read, solid NCZs need to be recompressed with block compression");
+        if (blockHeader.blockSizeExponent < 14 || blockHeader.blockSizeExponent > 32)
+            throw exception("Invalid NCZ block size: 2^{}", blockHeader.blockSizeExponent);
+        offset += sizeof(BlockHeader);
+
+        blockSize = 1ULL << blockHeader.blockSizeExponent;
+        if ((blockHeader.decompressedSize + blockSize - 1) / blockSize != blockHeader.blockCount)
+            throw exception("The NCZ block count doesn't match its decompressed size: {} blocks for 0x{:X} bytes", blockHeader.blockCount, blockHeader.decompressedSize);
+
+        std::vector<u32> compressedSizes(blockHeader.blockCount);
+        if (this->backing->Read(compressedSizes.data(), offset, compressedSizes.size() * sizeof(u32)) != compressedSizes.size() * sizeof(u32))
+            throw exception("The NCZ block size list is truncated");
+        offset += compressedSizes.size() * sizeof(u32);
+
+        // The compressed blocks are stored back to back after the block size list, so the index of their offsets is built up front
+        blockOffsets.reserve(compressedSizes.size() + 1);
+        for (auto compressedSize : compressedSizes) {
+            blockOffsets.push_back(offset);
+            offset += compressedSize;
+        }
+        blockOffsets.push_back(offset);
+        if (offset > this->backing->size)
+            throw exception("The NCZ is truncated: 0x{:X} bytes of data with 0x{:X} bytes in the file", offset, this->backing->size);
+
+        size = HeaderSize + blockHeader.decompressedSize;
+    }
+
+    const footprint::Vector<u8, footprint::Subsystem::VfsCache> &NczBacking::GetBlock(size_t index) {
+        auto cached{blockMap.find(index)};
+        if (cached != blockMap.end()) {
+            blocks.splice(blocks.begin(), blocks, cached->second);
+            return cached->second->data;
+        }
+
+        // The buffer of the least recently used block is reused for the new one when the cache is full
+        footprint::Vector<u8, footprint::Subsystem::VfsCache> data;
+        if (blocks.size() >= CacheCapacity) {
+            data = std::move(blocks.back().data);
+            blockMap.erase(blocks.back().index);
+            blocks.pop_back();
+        }
+        data.resize(std::min(blockSize, size - HeaderSize - (index * blockSize)));
+
+        // Blocks which don't get any smaller when compressed are stored uncompressed
+        size_t compressedSize{blockOffsets[index + 1] - blockOffsets[index]};
+        if (compressedSize >= data.size()) {
+            if (backing->Read(data.data(), blockOffsets[index], data.size()) != data.size())
+                throw exception("Failed to read NCZ block 0x{:X}", index);
+        } else {
+            std::vector<u8> compressed(compressedSize);
+            if (backing->Read(compressed.data(), blockOffsets[index], compressed.size()) != compressed.size())
+                throw exception("Failed to read NCZ block 0x{:X}", index);
+
+            auto result{ZSTD_decompressDCtx(context.get(), data.data(), data.size(), compressed.data(), compressed.size())};
+            if (ZSTD_isError(result) || result != data.size())
+                throw exception("Failed to decompress NCZ block 0x{:X}: {}", index, ZSTD_isError(result) ? ZSTD_getErrorName(result) : "Size mismatch");
+        }
+
+        blocks.push_front(Block{index, std::move(data)});
+        blockMap[index] = blocks.begin();
+        return blocks.front().data;
+    }
+
+    size_t NczBacking::GetCacheSize() {
+        std::lock_guard guard(mutex);
+        size_t size{};
+        for (const auto &block : blocks)
+            size += block.data.size();
+        return size;
+    }
+
+    size_t NczBacking::Evict(size_t target) {
+        std::lock_guard guard(mutex);
+        size_t freed{};
+        while (freed < target && !blocks.empty()) {
+            freed += blocks.back().data.size();
+            blockMap.erase(blocks.back().index);
+            blocks.pop_back();
+        }
+        return freed;
+    }
+
+    size_t NczBacking::Read(u8 *output, size_t offset, size_t size) {
+        if (offset >= this->size || !size)
+            return 0;
+        size = std::min(size, this->size - offset);
+        size_t end{offset + size};
+
+        if (offset < HeaderSize) {
+            size_t headerSize{std::min(end, HeaderSize) - offset};
+            if (backing->Read(output, offset, headerSize) != headerSize)
+                throw exception("Failed to read the NCZ header");
+            output += headerSize;
+            offset += headerSize;
+        }
+
+        std::lock_guard guard(mutex);
+        while (offset < end) {
+            size_t dataOffset{offset - HeaderSize}, blockOffset{dataOffset % blockSize};
+            auto &block{GetBlock(dataOffset / blockSize)};
+            size_t copySize{std::min(block.size() - blockOffset, end - offset)};
+            std::memcpy(output, block.data() + blockOffset, copySize);
+            output += copySize;
+            offset += copySize;
+        }
+
+        return size;
+    }
+}
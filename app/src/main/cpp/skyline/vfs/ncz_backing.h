@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <list>
+#include <cache_registry.h>
+#include "backing.h"
+
+struct ZSTD_DCtx_s;
+
+namespace skyline::vfs {
+    /**
+     * @brief The NczBacking class provides the contents of an NCA from a block-compressed NCZ, blocks are decompressed on demand and the most recently used ones are cached (https://github.com/nicoboss/nsz#ncz)
+     * @note An NCZ holds the sections of an NCA decrypted, so they're provided decrypted rather than being re-encrypted, the header is left encrypted as it's stored as-is
+     */
+    class NczBacking : public Backing {
+      public:
+        static constexpr size_t HeaderSize = 0x4000; //!< The size of the NCA header which is stored uncompressed at the start of an NCZ, the compressed data starts after the NCZ section header that follows it
+        static constexpr size_t CacheCapacity = 8; //!< The maximum amount of decompressed blocks that are cached
+
+      private:
+        /**
+         * @brief The header of the NCZ sections, this follows the NCA header and is followed by the entries of every section
+         */
+        struct SectionHeader {
+            u64 magic; //!< The magic of the section header: 'NCZSECTN'
+            u64 sectionCount; //!< The amount of sections
+        };
+        static_assert(sizeof(SectionHeader) == 0x10);
+
+        /**
+         * @brief The entry of a single section, this holds the encryption that was removed from it
+         */
+        struct SectionEntry {
+            u64 offset; //!< The offset of the section in the NCA
+            u64 size; //!< The size of the section in bytes
+            u64 cryptoType; //!< The encryption type of the section
+            u64 _pad_;
+            std::array<u8, 0x10> cryptoKey; //!< The key that the section was encrypted with
+            std::array<u8, 0x10> cryptoCounter; //!< The initial counter of the section
+        };
+        static_assert(sizeof(SectionEntry) == 0x40);
+
+        /**
+         * @brief The header of the block compression, this follows the section entries and is followed by the compressed size of every block
+         */
+        struct BlockHeader {
+            u64 magic; //!< The magic of the block header: 'NCZBLOCK'
+            u8 version; //!< The version of the block header, always 2
+            u8 type; //!< The type of the block compression, always 1
+            u8 _pad_;
+            u8 blockSizeExponent; //!< The base 2 logarithm of the decompressed size of a block
+            u32 blockCount; //!< The amount of blocks
+            u64 decompressedSize; //!< The total decompressed size of all blocks
+        };
+        static_assert(sizeof(BlockHeader) == 0x18);
+
+        /**
+         * @brief A single decompressed block that is held in the cache
+         */
+        struct Block {
+            size_t index; //!< The index of the block
+            footprint::Vector<u8, footprint::Subsystem::VfsCache> data; //!< The decompressed contents of the block
+        };
+
+        std::shared_ptr<Backing> backing; //!< The backing of the NCZ
+        size_t blockSize; //!< The decompressed size of a block in bytes, only the last block can be smaller
+        std::vector<u64> blockOffsets; //!< The offset of every block in the NCZ followed by the end of the last block
+        std::unique_ptr<ZSTD_DCtx_s, size_t (*)(ZSTD_DCtx_s *)> context; //!< The zstd decompression context that is reused for every block
+
+        std::mutex mutex; //!< This mutex guards the cache and the decompression context
+        std::list<Block> blocks; //!< The cached blocks in the order they were last used, the most recently used one is at the front
+        std::unordered_map<size_t, std::list<Block>::iterator> blockMap; //!< A map from the index of a block to its entry in the cache
+        cache::Registration registration; //!< The registration of the block cache in the cache registry, this is declared last so it's unregistered prior to the cache being destroyed
+
+        /**
+         * @return The decompressed contents of a block, it's decompressed and inserted into the cache if it isn't cached already
+         * @note The mutex must be locked by the calling thread, the returned data is only valid while it's held
+         */
+        const footprint::Vector<u8, footprint::Subsystem::VfsCache> &GetBlock(size_t index);
+
+        /**
+         * @return The size of the contents of all cached blocks in bytes
+         */
+        size_t GetCacheSize();
+
+        /**
+         * @brief Evicts the least recently used blocks till at least the supplied amount of bytes has been freed or the cache is empty
+         * @return The amount of bytes that were freed
+         */
+        size_t Evict(size_t target);
+
+      public:
+        /**
+         * @return If the backing holds an NCZ rather than an NCA
+         */
+        static bool IsNcz(const std::shared_ptr<Backing> &backing);
+
+        NczBacking(std::shared_ptr<Backing> backing);
+
+        size_t Read(u8 *output, size_t offset, size_t size);
+    };
+}
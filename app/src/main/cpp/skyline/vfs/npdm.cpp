@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "npdm.h"
+
+namespace skyline::vfs {
+    NPDM::NPDM(const std::shared_ptr<vfs::Backing> &backing) {
+        backing->Read(&meta);
+
+        if (meta.magic != util::MakeMagic<u32>("META"))
+            throw exception("Invalid NPDM META magic: 0x{:X}", meta.magic);
+    }
+}
@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include <common.h>
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The NPDM class provides access to the process metadata of an application which is found in an NPDM file (https://switchbrew.org/wiki/NPDM)
+     * @note Only the META header is parsed as the ACI and ACID aren't used for anything other than access control which isn't enforced
+     */
+    class NPDM {
+      public:
+        /**
+         * @brief The layout of the address space that the process is created with
+         */
+        enum class ProcessAddressSpace : u8 {
+            AddressSpace32Bit = 0, //!< A 32-bit address space with a reserved region for the map area
+            AddressSpace64BitOld = 1, //!< A 36-bit address space used by 64-bit applications before 2.0.0
+            AddressSpace32BitNoReserved = 2, //!< A 32-bit address space without a reserved region
+            AddressSpace64Bit = 3, //!< A 39-bit address space used by 64-bit applications
+        };
+
+        union MetaFlags {
+            struct {
+                bool is64BitInstruction : 1; //!< If the process executes AArch64 code rather than AArch32 code
+                u8 processAddressSpace : 3; //!< The ProcessAddressSpace of the process
+                bool optimizeMemoryAllocation : 1; //!< If the process's memory should be allocated from the application pool with optimizations for it
+            };
+            u8 raw;
+        };
+        static_assert(sizeof(MetaFlags) == 0x1);
+
+        /**
+         * @brief The META header at the start of an NPDM file
+         */
+        struct NpdmMeta {
+            u32 magic; //!< The magic of the header "META"
+            u32 signatureKeyGeneration; //!< The generation of the key used to sign the ACID
+            u32 _pad0_;
+            MetaFlags flags;
+            u8 _pad1_;
+            u8 mainThreadPriority; //!< The priority of the main thread
+            u8 mainThreadCoreNumber; //!< The core the main thread starts on
+            u32 _pad2_;
+            u32 systemResourceSize; //!< The size of the memory reserved for kernel objects
+            u32 version; //!< The version of the application
+            u32 mainThreadStackSize; //!< The size of the stack of the main thread
+            std::array<char, 0x10> name; //!< The name of the application
+            std::array<char, 0x10> productCode; //!< The product code of the application
+            u8 _pad3_[0x30];
+            u32 aciOffset; //!< The offset of the ACI0 section
+            u32 aciSize; //!< The size of the ACI0 section
+            u32 acidOffset; //!< The offset of the ACID section
+            u32 acidSize; //!< The size of the ACID section
+        } meta{};
+        static_assert(sizeof(NpdmMeta) == 0x80);
+
+        /**
+         * @param backing The backing for the NPDM
+         */
+        NPDM(const std::shared_ptr<vfs::Backing> &backing);
+
+        /**
+         * @return If the process executes AArch64 code rather than AArch32 code
+         */
+        inline bool Is64Bit() {
+            return meta.flags.is64BitInstruction;
+        }
+
+        inline ProcessAddressSpace GetProcessAddressSpace() {
+            return static_cast<ProcessAddressSpace>(meta.flags.processAddressSpace);
+        }
+    };
+}
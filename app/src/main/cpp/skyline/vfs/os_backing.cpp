@@ -13,9 +13,21 @@ namespace skyline::vfs {
             throw exception("Failed to stat fd: {}", strerror(errno));
 
         size = fileInfo.st_size;
+
+        if (mode.read && !mode.write && !mode.append && size) {
+            // The readahead of the mapping is tuned for sequential access as most reads stream through large files such as the RomFS
+            auto address{mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)};
+            if (address != MAP_FAILED) {
+                mapping = reinterpret_cast<u8 *>(address);
+                madvise(mapping, size, MADV_SEQUENTIAL);
+            }
+        }
     }
 
     OsBacking::~OsBacking() {
+        if (mapping)
+            munmap(mapping, size);
+
         if (closable)
             close(fd);
     }
@@ -24,6 +36,15 @@ namespace skyline::vfs {
         if (!mode.read)
             throw exception("Attempting to read a backing that is not readable");
 
+        if (mapping) {
+            if (offset >= this->size)
+                return 0;
+
+            size = std::min(size, this->size - offset);
+            std::memcpy(output, mapping + offset, size);
+            return size;
+        }
+
         auto ret = pread64(fd, output, size, offset);
         if (ret < 0)
             throw exception("Failed to read from fd: {}", strerror(errno));
@@ -31,6 +52,13 @@ namespace skyline::vfs {
         return static_cast<size_t>(ret);
     }
 
+    std::span<const u8> OsBacking::GetSpan(size_t offset, size_t size) {
+        if (!mapping || offset > this->size || size > this->size - offset)
+            return {};
+
+        return {mapping + offset, size};
+    }
+
     size_t OsBacking::Write(u8 *output, size_t offset, size_t size) {
         if (!mode.write)
             throw exception("Attempting to write to a backing that is not writable");
@@ -49,4 +77,9 @@ namespace skyline::vfs {
 
         this->size = size;
     }
-}
\ No newline at end of file
+
+    void OsBacking::Flush() {
+        if ((mode.write || mode.append) && fdatasync(fd))
+            throw exception("Failed to flush fd: {}", strerror(errno));
+    }
+}
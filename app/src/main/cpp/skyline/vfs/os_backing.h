@@ -13,10 +13,12 @@ namespace skyline::vfs {
       private:
         int fd; //!< An FD to the backing
         bool closable; //!< Whether the FD can be closed when the backing is destroyed
+        u8 *mapping{}; //!< A read-only mapping of the entire file, this is only used when the backing is read-only so it can't change size
 
       public:
         /**
          * @param fd The file descriptor of the backing
+         * @note Read-only backings are memory-mapped, reads from them are copied from the page cache without a syscall
          */
         OsBacking(int fd, bool closable = false, Mode = {true, false, false});
 
@@ -24,8 +26,12 @@ namespace skyline::vfs {
 
         size_t Read(u8 *output, size_t offset, size_t size);
 
+        std::span<const u8> GetSpan(size_t offset, size_t size);
+
         size_t Write(u8 *output, size_t offset, size_t size);
 
         void Resize(size_t size);
+
+        void Flush();
     };
 }
\ No newline at end of file
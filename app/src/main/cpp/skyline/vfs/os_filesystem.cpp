@@ -10,7 +10,7 @@
 #include "os_filesystem.h"
 
 namespace skyline::vfs {
-    OsFileSystem::OsFileSystem(const std::string &basePath) : FileSystem(), basePath(basePath) {
+    OsFileSystem::OsFileSystem(const std::string &basePath, bool writeBack) : FileSystem(), basePath(basePath), writeBack(writeBack) {
         if (!DirectoryExists(basePath))
             if (!CreateDirectory(basePath, true))
                 throw exception("Error creating the OS filesystem backing directory");
@@ -63,11 +63,32 @@ namespace skyline::vfs {
         if (!(mode.read || mode.write))
             throw exception("Cannot open a file that is neither readable or writable");
 
+        std::unique_lock lock(writeBackMutex, std::defer_lock);
+        if (writeBack) {
+            lock.lock();
+
+            // A file with buffered writes is either shared with this open if it's writable with the same mode or has its writes written out so they're visible to this open
+            auto [file, end]{writeBackFiles.equal_range(path)};
+            for (; file != end; file++) {
+                if (auto backing{file->second.lock()}) {
+                    if (mode.write && backing->mode.raw == mode.raw)
+                        return backing;
+                    backing->WriteBack();
+                }
+            }
+        }
+
         int fd = open((basePath + path).c_str(), (mode.read && mode.write) ? O_RDWR : (mode.write ? O_WRONLY : O_RDONLY));
         if (fd < 0)
             throw exception("Failed to open file: {}", strerror(errno));
 
-        return std::make_shared<OsBacking>(fd, true, mode);
+        auto backing{std::make_shared<OsBacking>(fd, true, mode)};
+        if (!writeBack || !mode.write)
+            return backing;
+
+        auto writeBackBacking{std::make_shared<WriteBackBacking>(backing)};
+        writeBackFiles.emplace(path, writeBackBacking);
+        return writeBackBacking;
     }
 
     std::optional<Directory::EntryType> OsFileSystem::GetEntryType(const std::string &path) {
@@ -84,4 +105,25 @@ namespace skyline::vfs {
 
         return std::nullopt;
     }
+
+    void OsFileSystem::Commit() {
+        std::lock_guard lock(writeBackMutex);
+        for (auto file{writeBackFiles.begin()}; file != writeBackFiles.end();) {
+            if (auto backing{file->second.lock()}) {
+                backing->Flush();
+                file++;
+                continue;
+            }
+
+            // Files that were closed since the last commit had their writes written out when they were closed, they still need to be made durable
+            int fd = open((basePath + file->first).c_str(), O_RDONLY);
+            if (fd >= 0) {
+                int ret = fdatasync(fd);
+                close(fd);
+                if (ret < 0)
+                    throw exception("Failed to flush file: {}", strerror(errno));
+            }
+            file = writeBackFiles.erase(file);
+        }
+    }
 }
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "filesystem.h"
+#include "write_back_backing.h"
 
 namespace skyline::vfs {
     /**
@@ -12,9 +13,15 @@ namespace skyline::vfs {
     class OsFileSystem : public FileSystem {
       private:
         std::string basePath; //!< The base path for filesystem operations
+        bool writeBack; //!< If writes to files are buffered until they're flushed or the filesystem is committed
+        std::mutex writeBackMutex; //!< This mutex guards writeBackFiles
+        std::unordered_multimap<std::string, std::weak_ptr<WriteBackBacking>> writeBackFiles; //!< A map from the path of every file that was opened as writable since the last commit to its backing, writable opens of a file with the same mode share a backing so they see each other's buffered writes
 
       public:
-        OsFileSystem(const std::string &basePath);
+        /**
+         * @param writeBack If writes to files should be buffered, they're only guaranteed to be durable after the file is flushed or the filesystem is committed
+         */
+        OsFileSystem(const std::string &basePath, bool writeBack = false);
 
         bool CreateFile(const std::string &path, size_t size);
 
@@ -23,5 +30,7 @@ namespace skyline::vfs {
         std::shared_ptr<Backing> OpenFile(const std::string &path, Backing::Mode mode = {true, false, false});
 
         std::optional<Directory::EntryType> GetEntryType(const std::string &path);
+
+        void Commit();
     };
 }
@@ -1,12 +1,25 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <boot_report.h>
 #include "region_backing.h"
 #include "partition_filesystem.h"
 
 namespace skyline::vfs {
-    PartitionFileSystem::PartitionFileSystem(std::shared_ptr<Backing> backing) : FileSystem(), backing(backing) {
-        backing->Read(&header);
+    PartitionFileSystem::PartitionFileSystem(std::shared_ptr<Backing> backing, const std::shared_ptr<MetadataCache> &cache, const std::string &cacheKey) : FileSystem(), backing(backing) {
+        boot::ScopedPhase phase(boot::Phase::FilesystemMount);
+
+        // The header, entries and string table are contiguous so they're read as a single blob, which is what gets cached
+        std::vector<u8> metadata;
+        if (auto cached{cache ? cache->Get(cacheKey) : std::nullopt}; cached && cached->size() >= sizeof(FsHeader)) {
+            std::memcpy(&header, cached->data(), sizeof(FsHeader));
+            if (cached->size() == sizeof(FsHeader) + (header.numFiles * (header.magic == util::MakeMagic<u32>("HFS0") ? sizeof(HashedFileEntry) : sizeof(PartitionFileEntry))) + header.stringTableSize)
+                metadata = std::move(*cached);
+        }
+
+        bool fromCache{!metadata.empty()};
+        if (!fromCache)
+            backing->Read(&header);
 
         if (header.magic == util::MakeMagic<u32>("PFS0"))
             hashed = false;
@@ -19,16 +32,25 @@ namespace skyline::vfs {
         size_t stringTableOffset = sizeof(FsHeader) + (header.numFiles * entrySize);
         fileDataOffset = stringTableOffset + header.stringTableSize;
 
-        std::vector<char> stringTable(header.stringTableSize + 1);
-        backing->Read(stringTable.data(), stringTableOffset, header.stringTableSize);
-        stringTable[header.stringTableSize] = 0;
+        if (!fromCache) {
+            metadata.resize(fileDataOffset);
+            std::memcpy(metadata.data(), &header, sizeof(FsHeader));
+            if (backing->Read(metadata.data() + sizeof(FsHeader), sizeof(FsHeader), fileDataOffset - sizeof(FsHeader)) != fileDataOffset - sizeof(FsHeader))
+                throw exception("Failed to read the partition filesystem metadata");
+            if (cache)
+                cache->Put(cacheKey, metadata);
+        }
 
-        for (u32 entryOffset{sizeof(FsHeader)}; entryOffset < header.numFiles * entrySize; entryOffset += entrySize) {
+        auto stringTable{reinterpret_cast<const char *>(metadata.data() + stringTableOffset)};
+        for (size_t entryOffset{sizeof(FsHeader)}; entryOffset < stringTableOffset; entryOffset += entrySize) {
             PartitionFileEntry entry;
-            backing->Read(&entry, entryOffset);
+            std::memcpy(&entry, metadata.data() + entryOffset, sizeof(PartitionFileEntry));
+
+            if (entry.stringTableOffset >= header.stringTableSize)
+                throw exception("Partition filesystem entry name is outside of the string table: 0x{:X}", entry.stringTableOffset);
 
-            std::string name(&stringTable[entry.stringTableOffset]);
-            fileMap.emplace(name, std::move(entry));
+            std::string name(stringTable + entry.stringTableOffset, strnlen(stringTable + entry.stringTableOffset, header.stringTableSize - entry.stringTableOffset));
+            fileMap.emplace(std::move(name), std::move(entry));
         }
     }
 
@@ -5,6 +5,7 @@
 
 #include <array>
 #include "filesystem.h"
+#include "metadata_cache.h"
 
 namespace skyline::vfs {
     /**
@@ -50,7 +51,11 @@ namespace skyline::vfs {
         std::unordered_map<std::string, PartitionFileEntry> fileMap; //!< A map that maps file names to their corresponding entry
 
       public:
-        PartitionFileSystem(std::shared_ptr<Backing> backing);
+        /**
+         * @param cache A metadata cache that the file table is looked up in and added to, this is optional
+         * @param cacheKey The key of the filesystem's entry in the metadata cache
+         */
+        PartitionFileSystem(std::shared_ptr<Backing> backing, const std::shared_ptr<MetadataCache> &cache = nullptr, const std::string &cacheKey = {});
 
         std::shared_ptr<Backing> OpenFile(const std::string &path, Backing::Mode mode = {true, false, false});
 
@@ -26,9 +26,18 @@ namespace skyline::vfs {
             if (!mode.read)
                 throw exception("Attempting to read a backing that is not readable");
 
-            size = std::min(offset + size, this->size) - offset;
+            if (offset >= this->size)
+                return 0;
+            size = std::min(size, this->size - offset);
 
             return backing->Read(output, baseOffset + offset, size);
         }
+
+        inline std::span<const u8> GetSpan(size_t offset, size_t size) {
+            if (!mode.read || offset + size > this->size)
+                return {};
+
+            return backing->GetSpan(baseOffset + offset, size);
+        }
     };
 }
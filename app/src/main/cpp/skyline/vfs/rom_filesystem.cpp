@@ -1,125 +1,168 @@
 // SPDX-License-Identifier: MPL-2.0
 // Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
 
+#include <boot_report.h>
 #include "region_backing.h"
 #include "rom_filesystem.h"
 
 namespace skyline::vfs {
-    RomFileSystem::RomFileSystem(std::shared_ptr<Backing> backing) : FileSystem(), backing(backing) {
-        backing->Read(&header);
-
-        TraverseDirectory(0, "");
-    }
-
-    void RomFileSystem::TraverseFiles(u32 offset, const std::string &path) {
-        RomFsFileEntry entry{};
-
-        do {
-            backing->Read(&entry, header.fileMetaTableOffset + offset);
+    RomFileSystem::RomFileSystem(std::shared_ptr<Backing> backing, const std::shared_ptr<MetadataCache> &cache, const std::string &cacheKey) : FileSystem(), backing(backing), tables(std::make_shared<RomFsTables>()) {
+        boot::ScopedPhase phase(boot::Phase::FilesystemMount);
+
+        // A cached entry holds the header followed by every table in the order they're read in below
+        auto cached{cache ? cache->Get(cacheKey) : std::nullopt};
+        if (cached && cached->size() >= sizeof(RomFsHeader)) {
+            std::memcpy(&header, cached->data(), sizeof(RomFsHeader));
+            if (cached->size() != sizeof(RomFsHeader) + header.dirMetaTableSize + header.fileMetaTableSize + util::AlignDown(header.dirHashTableSize, sizeof(u32)) + util::AlignDown(header.fileHashTableSize, sizeof(u32)))
+                cached.reset();
+        }
 
-            if (entry.nameSize) {
-                std::vector<char> name(entry.nameSize);
-                backing->Read(name.data(), header.fileMetaTableOffset + offset + sizeof(RomFsFileEntry), entry.nameSize);
+        if (cached) {
+            size_t offset{sizeof(RomFsHeader)};
+            auto copyTable{[&](auto &table, u64 size) {
+                table.resize(size / sizeof(typename std::remove_reference_t<decltype(table)>::value_type));
+                std::memcpy(table.data(), cached->data() + offset, table.size() * sizeof(table[0]));
+                offset += table.size() * sizeof(table[0]);
+            }};
+
+            copyTable(tables->directories, header.dirMetaTableSize);
+            copyTable(tables->files, header.fileMetaTableSize);
+            copyTable(tables->directoryBuckets, header.dirHashTableSize);
+            copyTable(tables->fileBuckets, header.fileHashTableSize);
+            return;
+        }
 
-                std::string fullPath = path + (path.empty() ? "" : "/") + std::string(name.data(), entry.nameSize);
-                fileMap.emplace(fullPath, entry);
-            }
+        backing->Read(&header);
 
-            offset = entry.siblingOffset;
-        } while (offset != constant::RomFsEmptyEntry);
+        // Every table is read with a single read as they're contiguous, so opening the filesystem doesn't need to traverse the entries in the backing
+        auto readTable{[&](auto &table, u64 offset, u64 size) {
+            table.resize(size / sizeof(typename std::remove_reference_t<decltype(table)>::value_type));
+            if (size && backing->Read(reinterpret_cast<u8 *>(table.data()), offset, table.size() * sizeof(table[0])) != table.size() * sizeof(table[0]))
+                throw exception("Failed to read RomFS metadata table at 0x{:X}", offset);
+        }};
+
+        readTable(tables->directories, header.dirMetaTableOffset, header.dirMetaTableSize);
+        readTable(tables->files, header.fileMetaTableOffset, header.fileMetaTableSize);
+        readTable(tables->directoryBuckets, header.dirHashTableOffset, header.dirHashTableSize);
+        readTable(tables->fileBuckets, header.fileHashTableOffset, header.fileHashTableSize);
+
+        if (cache) {
+            std::vector<u8> metadata(reinterpret_cast<u8 *>(&header), reinterpret_cast<u8 *>(&header + 1));
+            auto appendTable{[&](const auto &table) {
+                auto data{reinterpret_cast<const u8 *>(table.data())};
+                metadata.insert(metadata.end(), data, data + table.size() * sizeof(table[0]));
+            }};
+
+            appendTable(tables->directories);
+            appendTable(tables->files);
+            appendTable(tables->directoryBuckets);
+            appendTable(tables->fileBuckets);
+            cache->Put(cacheKey, metadata);
+        }
     }
 
-    void RomFileSystem::TraverseDirectory(u32 offset, const std::string &path) {
-        RomFsDirectoryEntry entry{};
-        backing->Read(&entry, header.dirMetaTableOffset + offset);
-
-        std::string childPath = path;
-        if (entry.nameSize) {
-            std::vector<char> name(entry.nameSize);
-            backing->Read(name.data(), header.dirMetaTableOffset + offset + sizeof(RomFsDirectoryEntry), entry.nameSize);
-            childPath = path + (path.empty() ? "" : "/") + std::string(name.data(), entry.nameSize);
-        }
+    std::optional<u32> RomFileSystem::FindDirectory(std::string_view path) {
+        u32 offset{}; // The root directory is always the first entry in the table
+        while (!path.empty()) {
+            auto separator{path.find('/')};
+            auto name{path.substr(0, separator)};
+            path = separator == std::string_view::npos ? std::string_view{} : path.substr(separator + 1);
 
-        directoryMap.emplace(childPath, entry);
+            if (name.empty())
+                continue;
 
-        if (entry.fileOffset != constant::RomFsEmptyEntry)
-            TraverseFiles(entry.fileOffset, childPath);
+            auto child{RomFsTables::FindEntry<RomFsDirectoryEntry>(tables->directories, tables->directoryBuckets, offset, name)};
+            if (!child)
+                return std::nullopt;
+            offset = *child;
+        }
+        return offset;
+    }
 
-        if (entry.childOffset != constant::RomFsEmptyEntry)
-            TraverseDirectory(entry.childOffset, childPath);
+    std::optional<u32> RomFileSystem::FindFile(std::string_view path) {
+        auto separator{path.rfind('/')};
+        auto parent{separator == std::string_view::npos ? std::optional<u32>{0} : FindDirectory(path.substr(0, separator))};
+        if (!parent)
+            return std::nullopt;
 
-        if (entry.siblingOffset != constant::RomFsEmptyEntry)
-            TraverseDirectory(entry.siblingOffset, path);
+        return RomFsTables::FindEntry<RomFsFileEntry>(tables->files, tables->fileBuckets, *parent, separator == std::string_view::npos ? path : path.substr(separator + 1));
     }
 
     std::shared_ptr<Backing> RomFileSystem::OpenFile(const std::string &path, Backing::Mode mode) {
-        try {
-            const auto &entry = fileMap.at(path);
-            return std::make_shared<RegionBacking>(backing, header.dataOffset + entry.offset, entry.size, mode);
-        } catch (std::out_of_range &e) {
+        auto offset{FindFile(path)};
+        if (!offset)
             return nullptr;
-        }
+
+        const auto &entry{RomFsTables::GetEntry<RomFsFileEntry>(tables->files, *offset)};
+        return std::make_shared<RegionBacking>(backing, header.dataOffset + entry.offset, entry.size, mode);
     }
 
     std::optional<Directory::EntryType> RomFileSystem::GetEntryType(const std::string &path) {
-        if (fileMap.count(path))
+        if (FindFile(path))
             return Directory::EntryType::File;
-        else if (directoryMap.count(path))
+        else if (FindDirectory(path))
             return Directory::EntryType::Directory;
 
         return std::nullopt;
     }
 
     std::shared_ptr<Directory> RomFileSystem::OpenDirectory(const std::string &path, Directory::ListMode listMode) {
-        try {
-            auto &entry = directoryMap.at(path);
-            return std::make_shared<RomFileSystemDirectory>(backing, header, entry, listMode);
-        } catch (std::out_of_range &e) {
+        auto offset{FindDirectory(path)};
+        if (!offset)
             return nullptr;
+
+        return std::make_shared<RomFileSystemDirectory>(tables, RomFsTables::GetEntry<RomFsDirectoryEntry>(tables->directories, *offset), listMode);
+    }
+
+    void RomFileSystem::VisitEntries(const std::function<void(const std::string &path, const RomFsFileEntry *file)> &visitor) {
+        // The directories are traversed with an explicit stack as a RomFS can be nested arbitrarily deep
+        std::vector<std::pair<u32, std::string>> stack{{0, std::string{}}};
+        while (!stack.empty()) {
+            auto [directoryOffset, path]{std::move(stack.back())};
+            stack.pop_back();
+            visitor(path, nullptr);
+
+            const auto &directory{RomFsTables::GetEntry<RomFsDirectoryEntry>(tables->directories, directoryOffset)};
+            auto prefix{path.empty() ? path : path + '/'};
+
+            for (auto offset{directory.fileOffset}; offset != constant::RomFsEmptyEntry;) {
+                const auto &entry{RomFsTables::GetEntry<RomFsFileEntry>(tables->files, offset)};
+                visitor(prefix + std::string(RomFsTables::GetName(entry)), &entry);
+                offset = entry.siblingOffset;
+            }
+
+            for (auto offset{directory.childOffset}; offset != constant::RomFsEmptyEntry;) {
+                const auto &entry{RomFsTables::GetEntry<RomFsDirectoryEntry>(tables->directories, offset)};
+                stack.emplace_back(offset, prefix + std::string(RomFsTables::GetName(entry)));
+                offset = entry.siblingOffset;
+            }
         }
     }
 
-    RomFileSystemDirectory::RomFileSystemDirectory(const std::shared_ptr<Backing> &backing, const RomFileSystem::RomFsHeader &header, const RomFileSystem::RomFsDirectoryEntry &ownEntry, ListMode listMode) : Directory(listMode), backing(backing), header(header), ownEntry(ownEntry) {}
+    RomFileSystemDirectory::RomFileSystemDirectory(const std::shared_ptr<RomFileSystem::RomFsTables> &tables, const RomFileSystem::RomFsDirectoryEntry &ownEntry, ListMode listMode) : Directory(listMode), tables(tables), ownEntry(ownEntry) {}
 
     std::vector<RomFileSystemDirectory::Entry> RomFileSystemDirectory::Read() {
+        using RomFsTables = RomFileSystem::RomFsTables;
         std::vector<Entry> contents;
 
         if (listMode.file) {
-            RomFileSystem::RomFsFileEntry romFsFileEntry;
-            u32 offset = ownEntry.fileOffset;
-
-            do {
-                backing->Read(&romFsFileEntry, header.fileMetaTableOffset + offset);
-
-                if (romFsFileEntry.nameSize) {
-                    std::vector<char> name(romFsFileEntry.nameSize);
-                    backing->Read(name.data(), header.fileMetaTableOffset + offset + sizeof(RomFileSystem::RomFsFileEntry), romFsFileEntry.nameSize);
-
-                    contents.emplace_back(Entry{std::string(name.data(), romFsFileEntry.nameSize), EntryType::File});
-                }
-
-                offset = romFsFileEntry.siblingOffset;
-            } while (offset != constant::RomFsEmptyEntry);
+            for (auto offset{ownEntry.fileOffset}; offset != constant::RomFsEmptyEntry;) {
+                const auto &entry{RomFsTables::GetEntry<RomFileSystem::RomFsFileEntry>(tables->files, offset)};
+                if (entry.nameSize)
+                    contents.emplace_back(Entry{std::string(RomFsTables::GetName(entry)), EntryType::File});
+                offset = entry.siblingOffset;
+            }
         }
 
         if (listMode.directory) {
-            RomFileSystem::RomFsDirectoryEntry romFsDirectoryEntry;
-            u32 offset = ownEntry.childOffset;
-
-            do {
-                backing->Read(&romFsDirectoryEntry, header.dirMetaTableOffset + offset);
-
-                if (romFsDirectoryEntry.nameSize) {
-                    std::vector<char> name(romFsDirectoryEntry.nameSize);
-                    backing->Read(name.data(), header.dirMetaTableOffset + offset + sizeof(RomFileSystem::RomFsDirectoryEntry), romFsDirectoryEntry.nameSize);
-
-                    contents.emplace_back(Entry{std::string(name.data(), romFsDirectoryEntry.nameSize), EntryType::Directory});
-                }
-
-                offset = romFsDirectoryEntry.siblingOffset;
-            } while (offset != constant::RomFsEmptyEntry);
+            for (auto offset{ownEntry.childOffset}; offset != constant::RomFsEmptyEntry;) {
+                const auto &entry{RomFsTables::GetEntry<RomFileSystem::RomFsDirectoryEntry>(tables->directories, offset)};
+                if (entry.nameSize)
+                    contents.emplace_back(Entry{std::string(RomFsTables::GetName(entry)), EntryType::Directory});
+                offset = entry.siblingOffset;
+            }
         }
 
         return contents;
     }
-}
\ No newline at end of file
+}
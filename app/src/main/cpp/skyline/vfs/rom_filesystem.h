@@ -3,7 +3,9 @@
 
 #pragma once
 
+#include <functional>
 #include "filesystem.h"
+#include "metadata_cache.h"
 
 namespace skyline {
     namespace constant {
@@ -15,23 +17,6 @@ namespace skyline {
          * @brief The RomFileSystem class abstracts access to a RomFS image using the vfs::FileSystem api
          */
         class RomFileSystem : public FileSystem {
-          private:
-            std::shared_ptr<Backing> backing; //!< The backing file of the filesystem
-
-            /**
-             * @brief Traverses the sibling files of the given file and adds them to the file map
-             * @param offset The offset of the file entry to traverses the siblings of
-             * @param path The path to the parent directory of the supplied file entry
-             */
-            void TraverseFiles(u32 offset, const std::string &path);
-
-            /**
-             * @brief Traverses the directories within the given directory, adds them to the directory map and calls TraverseFiles on them
-             * @param offset The offset of the directory entry to traverses the directories in
-             * @param path The path to the supplied directory entry
-             */
-            void TraverseDirectory(u32 offset, const std::string &path);
-
           public:
             /**
              * @brief This holds the header of a RomFS image
@@ -58,7 +43,7 @@ namespace skyline {
                 u32 siblingOffset; //!< The offset from the directory metadata base of a sibling directory
                 u32 childOffset; //!< The offset from the directory metadata base of a child directory
                 u32 fileOffset; //!< The offset from the file metadata base of a child file
-                u32 hash; //!< The hash of the directory
+                u32 hashSiblingOffset; //!< The offset from the directory metadata base of the next directory in the same hash table bucket
                 u32 nameSize; //!< The size of the directory's name in bytes
             };
 
@@ -70,20 +55,105 @@ namespace skyline {
                 u32 siblingOffset; //!< The offset from the file metadata base of a sibling file
                 u64 offset; //!< The offset from the file data base of the file contents
                 u64 size; //!< The size of the file in bytes
-                u32 hash; //!< The hash of the file
+                u32 hashSiblingOffset; //!< The offset from the file metadata base of the next file in the same hash table bucket
                 u32 nameSize; //!< The size of the file's name in bytes
             };
 
-            std::unordered_map<std::string, RomFsFileEntry> fileMap; //!< A map that maps file names to their corresponding entry
-            std::unordered_map<std::string, RomFsDirectoryEntry> directoryMap; //!< A map that maps directory names to their corresponding entry
+            /**
+             * @brief This holds the metadata tables of a RomFS image, they're read in their entirety once so every lookup is done in memory without any allocations
+             * @note The name of every entry directly follows it in its metadata table
+             */
+            struct RomFsTables {
+                std::vector<u8> directories; //!< The directory metadata table
+                std::vector<u8> files; //!< The file metadata table
+                std::vector<u32> directoryBuckets; //!< The directory hash table, every bucket holds the offset of the first directory in it
+                std::vector<u32> fileBuckets; //!< The file hash table, every bucket holds the offset of the first file in it
+
+                /**
+                 * @return The entry at the specified offset in a metadata table
+                 */
+                template<typename EntryType>
+                static const EntryType &GetEntry(const std::vector<u8> &table, u32 offset) {
+                    if (static_cast<size_t>(offset) + sizeof(EntryType) > table.size() || static_cast<size_t>(offset) + sizeof(EntryType) + reinterpret_cast<const EntryType *>(table.data() + offset)->nameSize > table.size())
+                        throw exception("RomFS entry at 0x{:X} is outside of its metadata table", offset);
+                    return *reinterpret_cast<const EntryType *>(table.data() + offset);
+                }
+
+                /**
+                 * @return The name of an entry in a metadata table, this must have been returned by GetEntry
+                 */
+                template<typename EntryType>
+                static std::string_view GetName(const EntryType &entry) {
+                    return std::string_view(reinterpret_cast<const char *>(&entry + 1), entry.nameSize);
+                }
+
+                /**
+                 * @return The hash of an entry in a hash table, this is derived from the offset of its parent directory and its name
+                 * @note https://switchbrew.org/wiki/RomFS#Hash_Table
+                 */
+                static u32 Hash(u32 parentOffset, std::string_view name) {
+                    u32 hash{parentOffset ^ 123456789};
+                    for (auto character : name) {
+                        hash = (hash >> 5) | (hash << 27);
+                        hash ^= static_cast<u8>(character);
+                    }
+                    return hash;
+                }
+
+                /**
+                 * @brief Looks up an entry by its parent directory and name using the hash table of its metadata table
+                 * @return The offset of the entry in its metadata table, if one was found
+                 */
+                template<typename EntryType>
+                static std::optional<u32> FindEntry(const std::vector<u8> &table, const std::vector<u32> &buckets, u32 parentOffset, std::string_view name) {
+                    if (buckets.empty())
+                        return std::nullopt;
+
+                    for (auto offset{buckets[Hash(parentOffset, name) % buckets.size()]}; offset != constant::RomFsEmptyEntry;) {
+                        const auto &entry{GetEntry<EntryType>(table, offset)};
+                        if (entry.parentOffset == parentOffset && GetName(entry) == name)
+                            return offset;
+                        offset = entry.hashSiblingOffset;
+                    }
+                    return std::nullopt;
+                }
+            };
 
-            RomFileSystem(std::shared_ptr<Backing> backing);
+          private:
+            std::shared_ptr<Backing> backing; //!< The backing file of the filesystem
+            std::shared_ptr<RomFsTables> tables; //!< The metadata tables of the filesystem, these are shared with any directories opened from it
+
+            /**
+             * @brief Looks up a directory by its path, the root directory has an empty path
+             * @return The offset of the directory in the directory metadata table, if it exists
+             */
+            std::optional<u32> FindDirectory(std::string_view path);
+
+            /**
+             * @brief Looks up a file by its path
+             * @return The offset of the file in the file metadata table, if it exists
+             */
+            std::optional<u32> FindFile(std::string_view path);
+
+          public:
+            /**
+             * @param cache A metadata cache that the header and metadata tables are looked up in and added to, this is optional
+             * @param cacheKey The key of the filesystem's entry in the metadata cache
+             */
+            RomFileSystem(std::shared_ptr<Backing> backing, const std::shared_ptr<MetadataCache> &cache = nullptr, const std::string &cacheKey = {});
 
             std::shared_ptr<Backing> OpenFile(const std::string &path, Backing::Mode mode = {true, false, false});
 
             std::optional<Directory::EntryType> GetEntryType(const std::string &path);
 
             std::shared_ptr<Directory> OpenDirectory(const std::string &path, Directory::ListMode listMode);
+
+            /**
+             * @brief Calls the visitor with the path of every directory and file in the filesystem, every directory is visited before its contents
+             * @param visitor A function taking the path of an entry and its file entry, this is nullptr for directories
+             * @note Paths are relative to the root directory which is visited with an empty path, the offset of a file is relative to the data offset in the header
+             */
+            void VisitEntries(const std::function<void(const std::string &path, const RomFsFileEntry *file)> &visitor);
         };
 
         /**
@@ -92,11 +162,10 @@ namespace skyline {
         class RomFileSystemDirectory : public Directory {
           private:
             RomFileSystem::RomFsDirectoryEntry ownEntry; //!< This directory's entry in the RomFS header
-            RomFileSystem::RomFsHeader header; //!< A header of this files parent RomFS image
-            std::shared_ptr<Backing> backing; //!< The backing of the RomFS image
+            std::shared_ptr<RomFileSystem::RomFsTables> tables; //!< The metadata tables of the parent RomFS image
 
           public:
-            RomFileSystemDirectory(const std::shared_ptr<Backing> &backing, const RomFileSystem::RomFsHeader &header, const RomFileSystem::RomFsDirectoryEntry &ownEntry, ListMode listMode);
+            RomFileSystemDirectory(const std::shared_ptr<RomFileSystem::RomFsTables> &tables, const RomFileSystem::RomFsDirectoryEntry &ownEntry, ListMode listMode);
 
             std::vector<Entry> Read();
         };
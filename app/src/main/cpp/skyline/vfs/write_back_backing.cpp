@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#include "write_back_backing.h"
+
+namespace skyline::vfs {
+    WriteBackBacking::WriteBackBacking(std::shared_ptr<Backing> backing) : Backing(backing->mode, backing->size), backing(std::move(backing)), validSize(size) {}
+
+    WriteBackBacking::~WriteBackBacking() {
+        try {
+            std::lock_guard lock(mutex);
+            WriteBackLocked();
+        } catch (...) {}
+    }
+
+    size_t WriteBackBacking::Read(u8 *output, size_t offset, size_t size) {
+        if (!mode.read)
+            throw exception("Attempting to read a backing that is not readable");
+
+        std::lock_guard lock(mutex);
+        if (offset >= this->size || !size)
+            return 0;
+        size = std::min(size, this->size - offset);
+        auto end{offset + size};
+
+        // Any data past the valid size of the backing is stale as the backing was shrunk, it reads as zeroes until it's overwritten
+        size_t backingEnd{std::min(end, std::max(validSize, offset))};
+        if (backingEnd > offset) {
+            auto read{backing->Read(output, offset, backingEnd - offset)};
+            backingEnd = offset + read;
+        }
+        if (backingEnd < end)
+            std::memset(output + (backingEnd - offset), 0, end - backingEnd);
+
+        // The buffered writes are overlaid on top of the contents of the backing
+        auto extent{extents.upper_bound(offset)};
+        if (extent != extents.begin())
+            extent--;
+        for (; extent != extents.end() && extent->first < end; extent++) {
+            auto extentEnd{extent->first + extent->second.size()};
+            if (extentEnd <= offset)
+                continue;
+
+            auto copyStart{std::max(extent->first, offset)}, copyEnd{std::min(extentEnd, end)};
+            std::memcpy(output + (copyStart - offset), extent->second.data() + (copyStart - extent->first), copyEnd - copyStart);
+        }
+
+        return size;
+    }
+
+    size_t WriteBackBacking::Write(u8 *input, size_t offset, size_t size) {
+        if (!mode.write)
+            throw exception("Attempting to write to a backing that is not writable");
+        if (!size)
+            return 0;
+
+        std::lock_guard lock(mutex);
+        size_t mergedStart{offset}, mergedEnd{offset + size};
+
+        // The write is merged with every extent that it overlaps or is adjacent to
+        auto first{extents.upper_bound(offset)};
+        if (first != extents.begin() && std::prev(first)->first + std::prev(first)->second.size() >= offset)
+            first--;
+        auto last{first};
+        for (; last != extents.end() && last->first <= mergedEnd; last++) {
+            mergedStart = std::min(mergedStart, last->first);
+            mergedEnd = std::max(mergedEnd, last->first + last->second.size());
+        }
+
+        std::vector<u8> merged;
+        if (first != last && first->first == mergedStart) {
+            // The buffer of the first extent is extended in-place, this keeps sequential writes in small chunks from copying the entire extent every time
+            merged = std::move(first->second);
+            dirtySize -= merged.size();
+            merged.resize(mergedEnd - mergedStart);
+            first++;
+        } else {
+            merged.resize(mergedEnd - mergedStart);
+        }
+
+        for (auto extent{first}; extent != last; extent++) {
+            std::memcpy(merged.data() + (extent->first - mergedStart), extent->second.data(), extent->second.size());
+            dirtySize -= extent->second.size();
+        }
+        std::memcpy(merged.data() + (offset - mergedStart), input, size);
+
+        extents.erase(extents.lower_bound(mergedStart), last);
+        dirtySize += merged.size();
+        extents.emplace(mergedStart, std::move(merged));
+
+        this->size = std::max(this->size, offset + size);
+
+        if (dirtySize > MaxDirtySize)
+            WriteBackLocked();
+
+        return size;
+    }
+
+    void WriteBackBacking::Resize(size_t size) {
+        std::lock_guard lock(mutex);
+
+        // Extents past the new size are truncated or dropped entirely
+        auto extent{extents.lower_bound(size)};
+        if (extent != extents.begin()) {
+            auto previous{std::prev(extent)};
+            if (previous->first + previous->second.size() > size) {
+                dirtySize -= previous->first + previous->second.size() - size;
+                previous->second.resize(size - previous->first);
+            }
+        }
+        for (auto dropped{extent}; dropped != extents.end(); dropped++)
+            dirtySize -= dropped->second.size();
+        extents.erase(extent, extents.end());
+
+        validSize = std::min(validSize, size);
+        this->size = size;
+        resized = true;
+    }
+
+    void WriteBackBacking::WriteBackLocked() {
+        if (resized) {
+            // If the backing was shrunk and then grown again, it's shrunk first so the region past the valid size is zero-filled
+            if (validSize < size)
+                backing->Resize(validSize);
+            backing->Resize(size);
+            resized = false;
+        }
+
+        while (!extents.empty()) {
+            auto extent{extents.begin()};
+            if (backing->Write(extent->second.data(), extent->first, extent->second.size()) != extent->second.size())
+                throw exception("Failed to write back 0x{:X} bytes at 0x{:X}", extent->second.size(), extent->first);
+            dirtySize -= extent->second.size();
+            extents.erase(extent);
+        }
+
+        validSize = size;
+    }
+
+    void WriteBackBacking::WriteBack() {
+        std::lock_guard lock(mutex);
+        WriteBackLocked();
+    }
+
+    void WriteBackBacking::Flush() {
+        std::lock_guard lock(mutex);
+        WriteBackLocked();
+        backing->Flush();
+    }
+}
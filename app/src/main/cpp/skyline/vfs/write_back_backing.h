@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: MPL-2.0
+// Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+
+#pragma once
+
+#include "backing.h"
+
+namespace skyline::vfs {
+    /**
+     * @brief The WriteBackBacking class buffers writes and resizes to another backing in memory, they're coalesced into contiguous extents that are only written out when the backing is flushed, destroyed or too much data has been buffered
+     * @note This is used for save data as titles can write it in thousands of tiny chunks, which would otherwise each be a separate write to the underlying file
+     */
+    class WriteBackBacking : public Backing {
+      public:
+        static constexpr size_t MaxDirtySize = 0x400000; //!< The maximum amount of bytes that are buffered, the buffered writes are written out once this is exceeded
+
+      private:
+        std::shared_ptr<Backing> backing; //!< The backing that writes are buffered for
+        std::mutex mutex; //!< This mutex guards the buffered state and all accesses to the backing
+        std::map<size_t, std::vector<u8>> extents; //!< The buffered writes keyed by their offset, they never overlap or touch each other as writes are merged into any extents they touch
+        size_t dirtySize{}; //!< The total size of all buffered extents in bytes
+        size_t validSize; //!< The size of the backing's contents that are still valid, this is lower than its size after it has been shrunk and the data past this should read as zeroes
+        bool resized{}; //!< If the backing has been resized since it was last written back
+
+        /**
+         * @brief Writes out all buffered writes and resizes to the backing
+         * @note The mutex must be locked by the calling thread
+         */
+        void WriteBackLocked();
+
+      public:
+        WriteBackBacking(std::shared_ptr<Backing> backing);
+
+        /**
+         * @note Any buffered writes are written out, failures in doing so are ignored as there's no way to report them
+         */
+        ~WriteBackBacking();
+
+        size_t Read(u8 *output, size_t offset, size_t size);
+
+        size_t Write(u8 *input, size_t offset, size_t size);
+
+        void Resize(size_t size);
+
+        /**
+         * @brief Writes out all buffered writes and resizes to the backing without ensuring that they're durable
+         */
+        void WriteBack();
+
+        void Flush();
+    };
+}
@@ -11,16 +11,21 @@ import android.content.pm.ShortcutInfo
 import android.content.pm.ShortcutManager
 import android.graphics.drawable.Icon
 import android.os.Bundle
+import android.os.Handler
+import android.os.Looper
 import android.view.KeyEvent
 import android.view.LayoutInflater
 import android.view.View
 import android.view.ViewGroup
+import android.widget.Toast
 import androidx.core.content.ContextCompat
 import androidx.core.graphics.drawable.toBitmap
 import com.google.android.material.bottomsheet.BottomSheetBehavior
 import com.google.android.material.bottomsheet.BottomSheetDialogFragment
 import emu.skyline.data.AppItem
 import emu.skyline.loader.LoaderResult
+import emu.skyline.loader.RomFile
+import emu.skyline.loader.RomFormat
 import kotlinx.android.synthetic.main.app_dialog.*
 
 /**
@@ -108,5 +113,26 @@ class AppDialog : BottomSheetDialogFragment() {
 
             shortcutManager.requestPinShortcut(info.build(), null)
         }
+
+        game_verify.isEnabled = item.meta.format == RomFormat.NCA || item.meta.format == RomFormat.NSP || item.meta.format == RomFormat.XCI
+        game_verify.setOnClickListener {
+            val context = requireContext().applicationContext
+            game_verify.isEnabled = false
+            Toast.makeText(context, getString(R.string.verify_started), Toast.LENGTH_SHORT).show()
+
+            // The entire ROM is read out during verification, so it's done on a background thread and the result is shown even if the dialog was closed
+            Thread {
+                val result = RomFile.verify(context, item.meta.format, item.uri)
+                Handler(Looper.getMainLooper()).post {
+                    Toast.makeText(context, context.getString(when (result) {
+                        LoaderResult.Success -> R.string.verify_success
+                        LoaderResult.IntegrityError -> R.string.integrity_error
+                        LoaderResult.ParsingError -> R.string.invalid_file
+                        LoaderResult.MissingTitleKey -> R.string.missing_title_key
+                        else -> R.string.incomplete_prod_keys
+                    }), Toast.LENGTH_LONG).show()
+                }
+            }.start()
+        }
     }
 }
@@ -18,11 +18,26 @@ import emu.skyline.input.*
 import emu.skyline.loader.getRomFormat
 import kotlinx.android.synthetic.main.emu_activity.*
 import java.io.File
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import kotlin.math.abs
 
 class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTouchListener {
     companion object {
         private val Tag = EmulationActivity::class.java.name
+
+        /**
+         * The intent extras for headless emulation, this allows running benchmarks from instrumentation tests or adb, e.g.
+         * `am start -n emu.skyline/.EmulationActivity -d <ROM URI> --ez headless true --ei run_duration 60 --ei frame_dump_interval 600 --es input_script <path>`
+         * A benchmark report is written if `--es report_path <path>` is supplied, it's compared against a prior report with `--es baseline_path <path> --ei regression_threshold <percent>`
+         */
+        const val HEADLESS = "headless"
+        const val HEADLESS_RUN_DURATION = "run_duration"
+        const val HEADLESS_FRAME_DUMP_INTERVAL = "frame_dump_interval"
+        const val HEADLESS_INPUT_SCRIPT = "input_script"
+        const val HEADLESS_REPORT_PATH = "report_path"
+        const val HEADLESS_BASELINE_PATH = "baseline_path"
+        const val HEADLESS_REGRESSION_THRESHOLD = "regression_threshold"
     }
 
     init {
@@ -39,6 +54,11 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
      */
     private lateinit var preferenceFd : ParcelFileDescriptor
 
+    /**
+     * The application Preference XML, SharedPreferences replaces this file rather than writing to it so it has to be reopened to read any changes
+     */
+    private val preferenceFile by lazy { File("${applicationInfo.dataDir}/shared_prefs/${applicationInfo.packageName}_preferences.xml") }
+
     /**
      * The [InputManager] class handles loading/saving the input data
      */
@@ -94,6 +114,25 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
      */
     private external fun setHalt(halt : Boolean)
 
+    /**
+     * This makes the next call to [executeApplication] run without presenting to the surface, this is used for benchmarking
+     *
+     * @param runDuration The duration after which emulation is halted in seconds, it runs indefinitely if this is 0
+     * @param frameDumpInterval The interval between frames that are dumped into the frames directory, no frames are dumped if this is 0
+     * @param inputScript The path to a script of input events to replay, see skyline::headless::ScriptedInput in C++ for the format
+     * @param reportPath The path a JSON benchmark report is written to when emulation ends, see skyline::headless::BenchmarkReport in C++ for the format
+     * @param baselinePath The path to a prior benchmark report that the report is compared against
+     * @param regressionThreshold The percentage by which a metric can be worse than its baseline before it's flagged as a regression
+     */
+    private external fun setHeadless(runDuration : Int, frameDumpInterval : Int, inputScript : String?, reportPath : String?, baselinePath : String?, regressionThreshold : Int)
+
+    /**
+     * This reloads the settings in libskyline from the Preference XML
+     *
+     * @param preferenceFd The file descriptor of the Preference XML
+     */
+    private external fun updateSettings(preferenceFd : Int)
+
     /**
      * This sets the surface object in libskyline to the provided value, emulation is halted if set to null
      *
@@ -106,11 +145,43 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
      */
     private external fun getFps() : Int
 
+    /**
+     * This returns the effective speed of the application as a percentage of its intended speed
+     */
+    private external fun getSpeed() : Int
+
     /**
      * This returns the current frame-time of the application
      */
     private external fun getFrametime() : Float
 
+    /**
+     * This returns the standard deviation of the recent frame-times of the application
+     */
+    private external fun getFrametimeDeviation() : Float
+
+    /**
+     * This returns a table of the amount of calls and their latencies for every SVC and IPC command the application has made, sorted by the total time spent in them
+     */
+    private external fun getCallStatistics() : String
+
+    /**
+     * This returns a direct buffer over skyline::perf::StatisticsBlock in C++, it remains valid for the lifetime of the process
+     */
+    private external fun getPerformanceStatistics() : ByteBuffer
+
+    /**
+     * This reports the host memory used by every subsystem of libskyline when the system is low on memory
+     *
+     * @param level The level of memory pressure passed to [onTrimMemory]
+     */
+    private external fun trimMemory(level : Int)
+
+    /**
+     * This requests a save state of the guest, it's captured on the next presented frame and written to the states directory in the background
+     */
+    private external fun saveState()
+
     /**
      * This initializes a guest controller in libskyline
      *
@@ -129,29 +200,113 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
     private external fun updateControllers()
 
     /**
-     * This sets the state of the buttons specified in the mask on a specific controller
+     * This passes a batch of input events to libskyline, they're applied to the guest together
+     *
+     * @param events A direct buffer of skyline::input::InputEvent in C++, see [inputEvents] for the layout
+     * @param count The amount of events in the buffer
+     */
+    private external fun pushInputEvents(events : ByteBuffer, count : Int)
+
+    /**
+     * The types of events in [inputEvents], this corresponds to skyline::input::InputEventType in C++
+     */
+    private enum class InputEventType {
+        Button,
+        Axis,
+        TouchPoint,
+        TouchCommit,
+    }
+
+    /**
+     * The size of a single skyline::input::InputEvent in C++
+     */
+    private val inputEventSize = 0x20
+
+    /**
+     * A buffer of input events that haven't been passed to libskyline yet, every event is a skyline::input::InputEvent in C++ which is laid out as:
+     * a 32-bit type and 32-bit index followed by either a 64-bit button mask and 32-bit pressed state, a 32-bit axis and 32-bit value, a TouchScreenPoint or a 32-bit touch count
+     */
+    private val inputEvents = ByteBuffer.allocateDirect(64 * inputEventSize).order(ByteOrder.nativeOrder())
+
+    /**
+     * The performance statistics which are published by libskyline on every presented frame, this is a skyline::perf::StatisticsBlock in C++ which is laid out as:
+     * a 32-bit sequence followed by the 32-bit frame-time, 1% low frame-time, SVC time, GPU time, present time, deswizzle time (all in microseconds), audio load (in per-mille), xrun count, thread count, a 64-bit RSS in bytes, the 64-bit memory used by every footprint subsystem in bytes and the 32-bit counts of contended and parked mutex acquisitions during the frame
+     */
+    private val performanceStatistics by lazy { getPerformanceStatistics().order(ByteOrder.nativeOrder()) }
+
+    /**
+     * This returns a description of [performanceStatistics], the block is read again if it was written to while being read
+     */
+    private fun describePerformanceStatistics() : String {
+        val stats = performanceStatistics
+        var description : String
+        do {
+            val sequence = stats.getInt(0)
+            description = "1% Low: ${stats.getInt(8) / 1000f}ms\n" +
+                    "SVC ${stats.getInt(12) / 1000f}ms GPU ${stats.getInt(16) / 1000f}ms\n" +
+                    "Present ${stats.getInt(20) / 1000f}ms Deswizzle ${stats.getInt(24) / 1000f}ms\n" +
+                    "Audio ${stats.getInt(28) / 10f}% (${stats.getInt(32)} XRuns)\n" +
+                    "${stats.getInt(36)} Threads, ${stats.getLong(40) / (1024 * 1024)}MiB RSS\n" +
+                    "Texture ${stats.getLong(48) / (1024 * 1024)}MiB VFS ${stats.getLong(56) / (1024 * 1024)}MiB Audio ${stats.getLong(64) / 1024}KiB\n" +
+                    "Pushbuffer ${stats.getLong(72) / 1024}KiB Patch ${stats.getLong(80) / 1024}KiB\n" +
+                    "Mutex ${stats.getInt(88)} Contended, ${stats.getInt(92)} Parked"
+        } while (sequence and 1 != 0 || sequence != stats.getInt(0))
+        return description
+    }
+
+    /**
+     * The amount of events in [inputEvents]
+     */
+    private var inputEventCount = 0
+
+    /**
+     * This returns the offset of a new event in [inputEvents] after writing its header, the buffer is flushed beforehand if it's full
+     */
+    private fun addInputEvent(type : InputEventType, index : Int) : Int {
+        if ((inputEventCount + 1) * inputEventSize > inputEvents.capacity())
+            flushInputEvents()
+
+        val offset = inputEventCount++ * inputEventSize
+        inputEvents.putInt(offset, type.ordinal)
+        inputEvents.putInt(offset + 4, index)
+        return offset + 8
+    }
+
+    /**
+     * This queues a change to the state of the buttons specified in the mask on a specific controller
      *
      * @param index The index of the controller this is directed to
      * @param mask The mask of the button that are being set
      * @param pressed If the buttons are being pressed or released
      */
-    private external fun setButtonState(index : Int, mask : Long, pressed : Boolean)
+    private fun setButtonState(index : Int, mask : Long, pressed : Boolean) {
+        val offset = addInputEvent(InputEventType.Button, index)
+        inputEvents.putLong(offset, mask)
+        inputEvents.putInt(offset + 8, if (pressed) 1 else 0)
+    }
 
     /**
-     * This sets the value of a specific axis on a specific controller
+     * This queues a change to the value of a specific axis on a specific controller
      *
      * @param index The index of the controller this is directed to
      * @param axis The ID of the axis that is being modified
      * @param value The value to set the axis to
      */
-    private external fun setAxisValue(index : Int, axis : Int, value : Int)
+    private fun setAxisValue(index : Int, axis : Int, value : Int) {
+        val offset = addInputEvent(InputEventType.Axis, index)
+        inputEvents.putInt(offset, axis)
+        inputEvents.putInt(offset + 4, value)
+    }
 
     /**
-     * This sets the values of the points on the guest touch-screen
-     *
-     * @param points An array of skyline::input::TouchScreenPoint in C++ represented as integers
+     * This passes all queued input events to libskyline, it's called once for every host event so that all changes from it are applied together
      */
-    private external fun setTouchState(points : IntArray)
+    private fun flushInputEvents() {
+        if (inputEventCount != 0) {
+            pushInputEvents(inputEvents, inputEventCount)
+            inputEventCount = 0
+        }
+    }
 
     /**
      * This initializes all of the controllers from [input] on the guest
@@ -181,16 +336,26 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
     }
 
     /**
-     * This executes the specified ROM, [preferenceFd] is assumed to be valid beforehand
+     * This executes the specified ROM, [preferenceFd] is reopened for it so the settings are read from the latest Preference XML
      *
      * @param rom The URI of the ROM to execute
+     * @param extras The extras of the intent the ROM was launched with, emulation is headless if [HEADLESS] is set in them
      */
-    private fun executeApplication(rom : Uri) {
+    private fun executeApplication(rom : Uri, extras : Bundle?) {
         val romType = getRomFormat(rom, contentResolver).ordinal
         romFd = contentResolver.openFileDescriptor(rom, "r")!!
 
+        if (this::preferenceFd.isInitialized)
+            preferenceFd.close()
+        preferenceFd = ParcelFileDescriptor.open(preferenceFile, ParcelFileDescriptor.MODE_READ_WRITE)
+
+        val headless = extras?.getBoolean(HEADLESS, false) ?: false
+        if (headless)
+            setHeadless(extras!!.getInt(HEADLESS_RUN_DURATION, 0), extras.getInt(HEADLESS_FRAME_DUMP_INTERVAL, 0), extras.getString(HEADLESS_INPUT_SCRIPT), extras.getString(HEADLESS_REPORT_PATH), extras.getString(HEADLESS_BASELINE_PATH), extras.getInt(HEADLESS_REGRESSION_THRESHOLD, 5))
+
         emulationThread = Thread {
-            surfaceReady.block()
+            if (!headless)
+                surfaceReady.block()
 
             executeApplication(rom.toString(), romType, romFd.fd, preferenceFd.fd, applicationContext.filesDir.canonicalPath + "/")
 
@@ -202,7 +367,7 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
     }
 
     /**
-     * This makes the window fullscreen then sets up [preferenceFd], sets up the performance statistics and finally calls [executeApplication] for executing the application
+     * This makes the window fullscreen then sets up the performance statistics and finally calls [executeApplication] for executing the application
      */
     @SuppressLint("SetTextI18n")
     override fun onCreate(savedInstanceState : Bundle?) {
@@ -225,9 +390,6 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
 
         input = InputManager(this)
 
-        val preference = File("${applicationInfo.dataDir}/shared_prefs/${applicationInfo.packageName}_preferences.xml")
-        preferenceFd = ParcelFileDescriptor.open(preference, ParcelFileDescriptor.MODE_READ_WRITE)
-
         game_view.holder.addCallback(this)
 
         val sharedPreferences = PreferenceManager.getDefaultSharedPreferences(this)
@@ -235,7 +397,7 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
         if (sharedPreferences.getBoolean("perf_stats", false)) {
             perf_stats.postDelayed(object : Runnable {
                 override fun run() {
-                    perf_stats.text = "${getFps()} FPS\n${getFrametime()}ms"
+                    perf_stats.text = "${getFps()} FPS (${getSpeed()}%)\n${getFrametime()}±${getFrametimeDeviation()}ms\n${describePerformanceStatistics()}"
                     perf_stats.postDelayed(this, 250)
                 }
             }, 250)
@@ -248,7 +410,29 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
 
         game_view.setOnTouchListener(this)
 
-        executeApplication(intent.data!!)
+        executeApplication(intent.data!!, intent.extras)
+    }
+
+    /**
+     * This reloads the settings in libskyline as they might have been changed while the activity was in the background
+     *
+     * The Preference XML is opened again as any changes are written to a new file which replaces it, [preferenceFd] would still refer to the file it replaced
+     */
+    override fun onResume() {
+        super.onResume()
+
+        if (this::emulationThread.isInitialized && emulationThread.isAlive)
+            ParcelFileDescriptor.open(preferenceFile, ParcelFileDescriptor.MODE_READ_ONLY).use { updateSettings(it.fd) }
+    }
+
+    /**
+     * This passes any memory pressure on to libskyline while emulation is running
+     */
+    override fun onTrimMemory(level : Int) {
+        super.onTrimMemory(level)
+
+        if (this::emulationThread.isInitialized && emulationThread.isAlive)
+            trimMemory(level)
     }
 
     /**
@@ -264,7 +448,7 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
 
         romFd.close()
 
-        executeApplication(intent?.data!!)
+        executeApplication(intent?.data!!, intent.extras)
 
         super.onNewIntent(intent)
     }
@@ -298,10 +482,12 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
     }
 
     /**
-     * This is purely used for debugging surface changes
+     * This passes the surface into libskyline again so it picks up the new dimensions
      */
     override fun surfaceChanged(holder : SurfaceHolder, format : Int, width : Int, height : Int) {
         Log.d(Tag, "surfaceChanged Holder: $holder, Format: $format, Width: $width, Height: $height")
+        surface = holder.surface
+        setSurface(surface)
     }
 
     /**
@@ -321,6 +507,12 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
         if (event.repeatCount != 0)
             return super.dispatchKeyEvent(event)
 
+        if (event.keyCode == KeyEvent.KEYCODE_F5) {
+            if (event.action == KeyEvent.ACTION_DOWN)
+                saveState()
+            return true
+        }
+
         val action = when (event.action) {
             KeyEvent.ACTION_DOWN -> ButtonState.Pressed
             KeyEvent.ACTION_UP -> ButtonState.Released
@@ -329,13 +521,16 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
 
         return when (val guestEvent = input.eventMap[KeyHostEvent(event.device.descriptor, event.keyCode)]) {
             is ButtonGuestEvent -> {
-                if (guestEvent.button != ButtonId.Menu)
+                if (guestEvent.button != ButtonId.Menu) {
                     setButtonState(guestEvent.id, guestEvent.button.value(), action.state)
+                    flushInputEvents()
+                }
                 true
             }
 
             is AxisGuestEvent -> {
                 setAxisValue(guestEvent.id, guestEvent.axis.ordinal, (if (action == ButtonState.Pressed) if (guestEvent.polarity) Short.MAX_VALUE else Short.MIN_VALUE else 0).toInt())
+                flushInputEvents()
                 true
             }
 
@@ -394,6 +589,8 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
                     axesHistory[axisItem.index] = value
                 }
 
+                // All axes that changed in this event are passed together, so the guest sees a single update for them
+                flushInputEvents()
                 return true
             } else {
                 oldHat = hat
@@ -406,8 +603,6 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
     @SuppressLint("ClickableViewAccessibility")
     override fun onTouch(view : View, event : MotionEvent) : Boolean {
         val count = if(event.action != MotionEvent.ACTION_UP && event.action != MotionEvent.ACTION_CANCEL) event.pointerCount else 0
-        val points = IntArray(count * 5) // This is an array of skyline::input::TouchScreenPoint in C++ as that allows for efficient transfer of values to it
-        var offset = 0
         for (index in 0 until count) {
             val pointer = MotionEvent.PointerCoords()
             event.getPointerCoords(index, pointer)
@@ -415,20 +610,30 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
             val x = 0f.coerceAtLeast(pointer.x * 1280 / view.width).toInt()
             val y = 0f.coerceAtLeast(pointer.y * 720 / view.height).toInt()
 
-            points[offset++] = x
-            points[offset++] = y
-            points[offset++] = pointer.touchMinor.toInt()
-            points[offset++] = pointer.touchMajor.toInt()
-            points[offset++] = (pointer.orientation * 180 / Math.PI).toInt()
+            // This is a skyline::input::TouchScreenPoint in C++
+            val offset = addInputEvent(InputEventType.TouchPoint, index)
+            inputEvents.putInt(offset, x)
+            inputEvents.putInt(offset + 4, y)
+            inputEvents.putInt(offset + 8, pointer.touchMinor.toInt())
+            inputEvents.putInt(offset + 12, pointer.touchMajor.toInt())
+            inputEvents.putInt(offset + 16, (pointer.orientation * 180 / Math.PI).toInt())
         }
 
-        setTouchState(points)
+        inputEvents.putInt(addInputEvent(InputEventType.TouchCommit, 0), count)
+        flushInputEvents()
 
         return true
     }
 
+    /**
+     * This is called by libskyline to play a vibration pattern on a controller
+     *
+     * @param timing The timings of the pattern, this array is reused by libskyline across calls so only the first [count] entries are valid
+     * @param amplitude The amplitudes of the pattern, this is the same size as [timing]
+     * @param count The amount of entries in the pattern
+     */
     @SuppressLint("WrongConstant")
-    fun vibrateDevice(index : Int, timing : LongArray, amplitude : IntArray) {
+    fun vibrateDevice(index : Int, timing : LongArray, amplitude : IntArray, count : Int) {
         val vibrator = if (vibrators[index] != null) {
             vibrators[index]!!
         } else {
@@ -450,7 +655,7 @@ class EmulationActivity : AppCompatActivity(), SurfaceHolder.Callback, View.OnTo
             return
         }
 
-        val effect = VibrationEffect.createWaveform(timing, amplitude, 0)
+        val effect = if (count == timing.size) VibrationEffect.createWaveform(timing, amplitude, 0) else VibrationEffect.createWaveform(timing.copyOf(count), amplitude.copyOf(count), 0)
         vibrator.vibrate(effect)
     }
 
@@ -37,6 +37,7 @@ import kotlinx.android.synthetic.main.main_activity.*
 import kotlinx.android.synthetic.main.titlebar.*
 import java.io.File
 import java.io.IOException
+import java.util.*
 import java.util.concurrent.atomic.AtomicBoolean
 import kotlin.concurrent.thread
 import kotlin.math.ceil
@@ -55,31 +56,33 @@ class MainActivity : AppCompatActivity() {
     private var reloading = AtomicBoolean()
 
     /**
-     * This adds all files in [directory] with [extension] as an entry in [adapter] using [RomFile] to load metadata
+     * This adds all files in [directory] with [extension] to [files], subdirectories are searched recursively
      */
-    private fun addEntries(extension : String, romFormat : RomFormat, directory : DocumentFile, found : Boolean = false) : Boolean {
-        var foundCurrent = found
-
+    private fun findFiles(extension : String, directory : DocumentFile, files : MutableList<Uri>) {
         directory.listFiles().forEach { file ->
-            if (file.isDirectory) {
-                foundCurrent = addEntries(extension, romFormat, file, foundCurrent)
-            } else {
-                if (extension.equals(file.name?.substringAfterLast("."), ignoreCase = true)) {
-                    RomFile(this, romFormat, file.uri).let { romFile ->
-                        val finalFoundCurrent = foundCurrent
-                        runOnUiThread {
-                            if (!finalFoundCurrent) adapter.addHeader(romFormat.name)
+            if (file.isDirectory)
+                findFiles(extension, file, files)
+            else if (extension.equals(file.name?.substringAfterLast("."), ignoreCase = true))
+                files.add(file.uri)
+        }
+    }
+
+    /**
+     * This adds all files in [directory] with [extension] as an entry in [adapter], their metadata is loaded as a batch using [RomFile.loadEntries]
+     */
+    private fun addEntries(extension : String, romFormat : RomFormat, directory : DocumentFile) : Boolean {
+        val files = mutableListOf<Uri>()
+        findFiles(extension, directory, files)
+        if (files.isEmpty()) return false
 
-                            adapter.addItem(AppItem(romFile.appEntry))
-                        }
+        val entries = RomFile.loadEntries(this, romFormat, files)
+        runOnUiThread {
+            adapter.addHeader(extension.toUpperCase(Locale.ROOT))
 
-                        foundCurrent = true
-                    }
-                }
-            }
+            entries.forEach { adapter.addItem(AppItem(it)) }
         }
 
-        return foundCurrent
+        return true
     }
 
     /**
@@ -114,6 +117,9 @@ class MainActivity : AppCompatActivity() {
                 foundRoms = foundRoms or addEntries("nso", RomFormat.NSO, searchLocation)
                 foundRoms = foundRoms or addEntries("nca", RomFormat.NCA, searchLocation)
                 foundRoms = foundRoms or addEntries("nsp", RomFormat.NSP, searchLocation)
+                foundRoms = foundRoms or addEntries("xci", RomFormat.XCI, searchLocation)
+                foundRoms = foundRoms or addEntries("ncz", RomFormat.NCA, searchLocation)
+                foundRoms = foundRoms or addEntries("nsz", RomFormat.NSP, searchLocation)
 
                 runOnUiThread {
                     if (!foundRoms) adapter.addHeader(getString(R.string.no_rom))
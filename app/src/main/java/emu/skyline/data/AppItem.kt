@@ -58,6 +58,8 @@ class AppItem(val meta : AppEntry) : BaseItem() {
         LoaderResult.MissingHeaderKey,
         LoaderResult.MissingTitleKek,
         LoaderResult.MissingKeyArea -> R.string.incomplete_prod_keys
+
+        LoaderResult.IntegrityError -> R.string.integrity_error
     })
 
     /**
@@ -8,7 +8,6 @@ package emu.skyline.loader
 import android.content.ContentResolver
 import android.content.Context
 import android.graphics.Bitmap
-import android.graphics.BitmapFactory
 import android.net.Uri
 import android.provider.OpenableColumns
 import java.io.Serializable
@@ -30,6 +29,7 @@ enum class RomFormat(val format : Int) {
  *
  * @param uri The URL of the ROM
  * @param contentResolver The instance of ContentResolver associated with the current context
+ * @note Compressed NSZs and NCZs resolve to the format they compress as they're loaded by its loader
  */
 fun getRomFormat(uri : Uri, contentResolver : ContentResolver) : RomFormat {
     var uriStr = ""
@@ -38,7 +38,11 @@ fun getRomFormat(uri : Uri, contentResolver : ContentResolver) : RomFormat {
         cursor.moveToFirst()
         uriStr = cursor.getString(nameIndex)
     }
-    return RomFormat.valueOf(uriStr.substring(uriStr.lastIndexOf(".") + 1).toUpperCase(Locale.ROOT))
+    return when (val extension = uriStr.substring(uriStr.lastIndexOf(".") + 1).toUpperCase(Locale.ROOT)) {
+        "NSZ" -> RomFormat.NSP
+        "NCZ" -> RomFormat.NCA
+        else -> RomFormat.valueOf(extension)
+    }
 }
 
 /**
@@ -50,7 +54,8 @@ enum class LoaderResult(val value : Int) {
     MissingHeaderKey(2),
     MissingTitleKey(3),
     MissingTitleKek(4),
-    MissingKeyArea(5);
+    MissingKeyArea(5),
+    IntegrityError(6);
 
     companion object {
         fun get(value : Int) = values().first { value == it.value }
@@ -87,6 +92,12 @@ internal class RomFile(context : Context, format : RomFormat, uri : Uri) {
      */
     private var rawIcon : ByteArray? = null
 
+    /**
+     * The key of the ROM in [ThumbnailStore]
+     * @note This field is filled in by native code
+     */
+    private var thumbnailKey : String? = null
+
     val appEntry : AppEntry
 
     var result = LoaderResult.Success
@@ -104,18 +115,87 @@ internal class RomFile(context : Context, format : RomFormat, uri : Uri) {
         appEntry = applicationName?.let { name ->
             applicationAuthor?.let { author ->
                 rawIcon?.let { icon ->
-                    AppEntry(name, author, BitmapFactory.decodeByteArray(icon, 0, icon.size), format, uri, result)
+                    AppEntry(name, author, ThumbnailStore.get(context, thumbnailKey!!, icon), format, uri, result)
                 }
             }
         } ?: AppEntry(context, format, uri, result)
     }
 
     /**
-     * Parses ROM and writes its metadata to [applicationName], [applicationAuthor] and [rawIcon]
+     * Parses ROM and writes its metadata to [applicationName], [applicationAuthor], [rawIcon] and [thumbnailKey]
      * @param format The format of the ROM
      * @param romFd A file descriptor of the ROM
      * @param appFilesPath Path to internal app data storage, needed to read imported keys
      * @return A pointer to the newly allocated object, or 0 if the ROM is invalid
      */
     private external fun populate(format : Int, romFd : Int, appFilesPath : String) : Int
+
+    companion object {
+        init {
+            System.loadLibrary("skyline")
+        }
+
+        /**
+         * Loads the metadata of multiple ROMs of the same format at once, they're parsed in parallel by native code which reuses the metadata of any ROM that hasn't been modified since it was last loaded
+         * @note Icons are loaded through [ThumbnailStore] so they're only decoded the first time a ROM is loaded
+         *
+         * @return An [AppEntry] for every ROM in [uris], in the same order
+         */
+        fun loadEntries(context : Context, format : RomFormat, uris : List<Uri>) : List<AppEntry> {
+            val names = arrayOfNulls<String>(uris.size)
+            val authors = arrayOfNulls<String>(uris.size)
+            val icons = arrayOfNulls<ByteArray>(uris.size)
+            val thumbnailKeys = arrayOfNulls<String>(uris.size)
+
+            val descriptors = uris.map { context.contentResolver.openFileDescriptor(it, "r")!! }
+            val results = try {
+                populateBatch(format.ordinal, IntArray(descriptors.size) { descriptors[it].fd }, context.filesDir.canonicalPath + "/", names, authors, icons, thumbnailKeys)
+            } finally {
+                descriptors.forEach { it.close() }
+            }
+
+            return uris.mapIndexed { index, uri ->
+                val result = LoaderResult.get(results[index])
+
+                names[index]?.let { name ->
+                    authors[index]?.let { author ->
+                        icons[index]?.let { icon ->
+                            AppEntry(name, author, ThumbnailStore.get(context, thumbnailKeys[index]!!, icon), format, uri, result)
+                        }
+                    }
+                } ?: AppEntry(context, format, uri, result)
+            }
+        }
+
+        /**
+         * Verifies the entire contents of a ROM against the hashes stored in it, this reads out the entire ROM so it should only be done on a background thread
+         *
+         * @return [LoaderResult.Success] if the ROM is intact, [LoaderResult.IntegrityError] if it's corrupt or the error that prevented it from being verified
+         */
+        fun verify(context : Context, format : RomFormat, uri : Uri) : LoaderResult {
+            context.contentResolver.openFileDescriptor(uri, "r")!!.use {
+                return LoaderResult.get(verify(format.ordinal, it.fd, context.filesDir.canonicalPath + "/"))
+            }
+        }
+
+        /**
+         * Verifies a ROM against its hashes, only NCAs and NSPs are supported as other formats don't hold any
+         * @param format The format of the ROM
+         * @param romFd A file descriptor of the ROM
+         * @param appFilesPath Path to internal app data storage, needed to read imported keys
+         * @return The [LoaderResult] of the verification
+         */
+        @JvmStatic
+        private external fun verify(format : Int, romFd : Int, appFilesPath : String) : Int
+
+        /**
+         * Parses multiple ROMs in parallel and writes their metadata to the corresponding elements of [applicationNames], [applicationAuthors], [rawIcons] and [thumbnailKeys]
+         * @param format The format of the ROMs
+         * @param romFds File descriptors of the ROMs
+         * @param appFilesPath Path to internal app data storage, needed to read imported keys and the metadata cache
+         * @return The [LoaderResult] of every ROM
+         */
+        @JvmStatic
+        private external fun populateBatch(format : Int, romFds : IntArray, appFilesPath : String, applicationNames : Array<String?>, applicationAuthors : Array<String?>, rawIcons : Array<ByteArray?>, thumbnailKeys : Array<String?>) : IntArray
+    }
 }
\ No newline at end of file
@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: MPL-2.0
+ * Copyright © 2020 Skyline Team and Contributors (https://github.com/skyline-emu/)
+ */
+
+package emu.skyline.loader
+
+import android.content.Context
+import android.graphics.Bitmap
+import android.graphics.BitmapFactory
+import emu.skyline.R
+import java.io.File
+import java.io.IOException
+import java.nio.ByteBuffer
+import kotlin.math.max
+
+/**
+ * This stores the icons of ROMs as uncompressed RGBA thumbnails at the size they're displayed at in the cache directory, so the library only decodes the JPEG icon of a ROM the first time it's loaded
+ *
+ * @note Thumbnails are keyed by the title ID and version of a ROM which is supplied by native code, an updated ROM gets a new thumbnail
+ */
+internal object ThumbnailStore {
+    /**
+     * The size of the header of a thumbnail file, this is the size it was generated for followed by its width and height
+     */
+    private const val HeaderSize = 3 * Int.SIZE_BYTES
+
+    /**
+     * @return The size that thumbnails are generated at in pixels, this is the width of the largest grid cell
+     */
+    private fun targetSize(context : Context) = context.resources.getDimensionPixelSize(R.dimen.app_thumbnail_size)
+
+    /**
+     * @return The thumbnail of the ROM with [key], this is generated from [icon] and stored if there's no thumbnail for the current display size yet
+     */
+    fun get(context : Context, key : String, icon : ByteArray) : Bitmap? {
+        val file = File(context.cacheDir, "thumbnails/$key")
+        val size = targetSize(context)
+
+        read(file, size)?.let { return it }
+
+        return decode(icon, size)?.also { write(file, size, it) }
+    }
+
+    /**
+     * @return The thumbnail in [file] if it exists and was generated for [size], it's copied directly into a [Bitmap] without any decoding
+     */
+    private fun read(file : File, size : Int) : Bitmap? {
+        val data = try {
+            ByteBuffer.wrap(file.readBytes())
+        } catch (e : IOException) {
+            return null
+        }
+
+        if (data.remaining() < HeaderSize || data.int != size) return null
+        val width = data.int
+        val height = data.int
+        if (width <= 0 || height <= 0 || data.remaining() != width * height * 4) return null
+
+        return Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888).apply { copyPixelsFromBuffer(data) }
+    }
+
+    /**
+     * @return [icon] decoded and downscaled to fit within [size], icons that are already smaller than it are never scaled up
+     */
+    private fun decode(icon : ByteArray, size : Int) : Bitmap? {
+        val options = BitmapFactory.Options().apply { inJustDecodeBounds = true }
+        BitmapFactory.decodeByteArray(icon, 0, icon.size, options)
+        if (options.outWidth <= 0 || options.outHeight <= 0) return null
+
+        // The icon is subsampled by the largest power of two that keeps it larger than the thumbnail while decoding, this is much cheaper than decoding it at its full size
+        var sampleSize = 1
+        while (max(options.outWidth, options.outHeight) / (sampleSize * 2) >= size)
+            sampleSize *= 2
+
+        options.inJustDecodeBounds = false
+        options.inSampleSize = sampleSize
+        options.inPreferredConfig = Bitmap.Config.ARGB_8888
+        val bitmap = BitmapFactory.decodeByteArray(icon, 0, icon.size, options) ?: return null
+
+        val scale = size.toFloat() / max(bitmap.width, bitmap.height)
+        if (scale >= 1f) return bitmap
+
+        return Bitmap.createScaledBitmap(bitmap, max((bitmap.width * scale).toInt(), 1), max((bitmap.height * scale).toInt(), 1), true)
+    }
+
+    /**
+     * Writes [bitmap] to [file] as the thumbnail for [size], this is written to a temporary file first so a partially written thumbnail is never read
+     */
+    private fun write(file : File, size : Int, bitmap : Bitmap) {
+        val data = ByteBuffer.allocate(HeaderSize + bitmap.width * bitmap.height * 4)
+        data.putInt(size).putInt(bitmap.width).putInt(bitmap.height)
+        bitmap.copyPixelsToBuffer(data)
+
+        // The store is purely an optimization, the icon is just decoded again next time if the thumbnail can't be written
+        try {
+            file.parentFile?.mkdirs()
+            val temporary = File(file.parentFile, file.name + ".tmp")
+            temporary.writeBytes(data.array())
+            temporary.renameTo(file)
+        } catch (e : IOException) {
+        }
+    }
+}